@@ -84,6 +84,14 @@ size: $(BUILD)/$(PROJECT).elf
 linkermap: $(BUILD)/$(PROJECT).elf
 	@linkermap -v $<.map
 
+# Flash/RAM breakdown per component, object and symbol. SIZE_BASELINE=<json> to compare against a previous
+# report, SIZE_MAX_GROWTH=<bytes> to fail if total grows more than that
+.PHONY: size-report
+size-report: $(BUILD)/$(PROJECT).elf
+	$(PYTHON) $(TOP)/tools/size_report.py $<.map --json $(BUILD)/$(PROJECT)-size.json \
+	  $(if $(SIZE_BASELINE),--baseline $(SIZE_BASELINE)) $(if $(SIZE_MAX_GROWTH),--max-growth $(SIZE_MAX_GROWTH)) \
+	  $(SIZE_REPORT_OPTION)
+
 # ---------------------------------------
 # Flash Targets
 # ---------------------------------------
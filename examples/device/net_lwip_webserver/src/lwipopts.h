@@ -60,6 +60,7 @@
 #define LWIP_SINGLE_NETIF               1
 
 #define PBUF_POOL_SIZE                  2
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
 
 #define HTTPD_USE_CUSTOM_FSDATA         0
 
@@ -168,12 +168,60 @@ bool dns_query_proc(const char *name, ip4_addr_t *addr)
   return false;
 }
 
+#if CFG_TUD_NCM_ZERO_COPY
+/* pbufs referencing datagrams in NCM receive buffers, returned to the driver when lwIP frees them */
+typedef struct
+{
+  struct pbuf_custom pc; /* must be first */
+  const uint8_t *datagram;
+  bool in_use;
+} rx_pbuf_t;
+
+static rx_pbuf_t rx_pbuf[4];
+
+static void rx_pbuf_free(struct pbuf *p)
+{
+  rx_pbuf_t *rx = (rx_pbuf_t *)p;
+  rx->in_use = false;
+  tud_network_recv_release(rx->datagram);
+}
+
+static struct pbuf *rx_pbuf_alloc(const uint8_t *src, uint16_t size)
+{
+  for (size_t i = 0; i < sizeof(rx_pbuf) / sizeof(rx_pbuf[0]); i++)
+  {
+    rx_pbuf_t *rx = &rx_pbuf[i];
+    if (!rx->in_use)
+    {
+      rx->in_use = true;
+      rx->datagram = src;
+      rx->pc.custom_free_function = rx_pbuf_free;
+      return pbuf_alloced_custom(PBUF_RAW, size, PBUF_REF, &rx->pc, (void *)(uintptr_t)src, size);
+    }
+  }
+  return NULL;
+}
+#endif
+
 bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
 {
   /* this shouldn't happen, but if we get another packet before
   parsing the previous, we must signal our inability to accept it */
   if (received_frame) return false;
 
+#if CFG_TUD_NCM_ZERO_COPY
+  if (size)
+  {
+    /* reference datagram in place, fall back to copying if all custom pbufs are in use */
+    struct pbuf *p = rx_pbuf_alloc(src, size);
+    if (p)
+    {
+      received_frame = p;
+      return true;
+    }
+  }
+#endif
+
   if (size)
   {
     struct pbuf *p = pbuf_alloc(PBUF_RAW, size, PBUF_POOL);
@@ -188,6 +236,11 @@ bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
     }
   }
 
+#if CFG_TUD_NCM_ZERO_COPY
+  /* datagram was copied (or dropped), it is not referenced anymore */
+  tud_network_recv_release(src);
+#endif
+
   return true;
 }
 
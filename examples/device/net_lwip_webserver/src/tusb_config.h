@@ -97,6 +97,10 @@
 #define CFG_TUD_ECM_RNDIS     1
 #define CFG_TUD_NCM           (1-CFG_TUD_ECM_RNDIS)
 
+// NCM: hand received datagrams to lwIP without copying, keep receiving into the second NTB meanwhile
+#define CFG_TUD_NCM_OUT_NTB_N  2
+#define CFG_TUD_NCM_ZERO_COPY  CFG_TUD_NCM
+
 #ifdef __cplusplus
  }
 #endif
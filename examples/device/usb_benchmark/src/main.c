@@ -0,0 +1,451 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* This example is a throughput/latency benchmark for the device stack and its DCD port. A vendor class
+ * driver (implemented in this file with usbd_app_driver_get_cb()) runs source/sink or loopback on
+ *  - bulk endpoints, with transfer size configurable up to BENCH_BULK_BUFSIZE
+ *  - interrupt endpoints
+ *  - isochronous endpoints, in alternate setting 1 of the second interface
+ *
+ * Per-endpoint statistics (CFG_TUD_EDPT_STATS) and CPU load are read by the host with vendor requests,
+ * see usb_descriptors.h. Run usb_benchmark.py on the host to measure MB/s and latency percentiles.
+ *
+ * Note: on Linux/macOS, udev permission may need to be updated by
+ *   - copying '/examples/device/99-tinyusb.rules' file to /etc/udev/rules.d/ then
+ *   - run 'sudo udevadm control --reload-rules && sudo udevadm trigger'
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bsp/board_api.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "usb_descriptors.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+
+/* Blink pattern
+ * - 250 ms  : device not mounted
+ * - 1000 ms : device mounted
+ * - 2500 ms : device is suspended
+ */
+enum  {
+  BLINK_NOT_MOUNTED = 250,
+  BLINK_MOUNTED     = 1000,
+  BLINK_SUSPENDED   = 2500,
+};
+
+static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
+
+typedef struct {
+  uint8_t ep_out;
+  uint8_t ep_in;
+  uint16_t xfer_size; // bytes per transfer
+  uint16_t echo_len;  // loopback: received bytes waiting to be sent back
+  bool echo;          // loopback: out_buf is being sent back on IN endpoint
+  uint8_t* out_buf;
+  uint8_t* in_buf;
+} bench_pipe_t;
+
+enum {
+  PIPE_BULK = 0,
+  PIPE_INT,
+  PIPE_ISO,
+  PIPE_COUNT
+};
+
+typedef struct {
+  TUD_EPBUF_DEF(bulk_out, BENCH_BULK_BUFSIZE);
+  TUD_EPBUF_DEF(bulk_in, BENCH_BULK_BUFSIZE);
+  TUD_EPBUF_DEF(int_out, BENCH_INT_EP_SIZE);
+  TUD_EPBUF_DEF(int_in, BENCH_INT_EP_SIZE);
+  TUD_EPBUF_DEF(iso_out, BENCH_ISO_EP_SIZE);
+  TUD_EPBUF_DEF(iso_in, BENCH_ISO_EP_SIZE);
+} bench_epbuf_t;
+
+CFG_TUD_MEM_SECTION static bench_epbuf_t _bench_epbuf;
+
+static bench_pipe_t _pipe[PIPE_COUNT];
+static uint8_t _bench_rhport;
+static bench_mode_t _bench_mode = BENCH_MODE_SOURCE_SINK;
+static uint8_t _iso_alt;
+static uint8_t const* _iso_alt1_desc; // endpoint descriptors of alternate 1
+
+static uint32_t _load_busy;
+static uint32_t _load_start;
+
+void led_blinking_task(void);
+
+//--------------------------------------------------------------------+
+// Tick counter
+//--------------------------------------------------------------------+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
+  // Cortex-M DWT cycle counter
+  #define DWT_CTRL    (*(volatile uint32_t*) 0xE0001000u)
+  #define DWT_CYCCNT  (*(volatile uint32_t*) 0xE0001004u)
+  #define DEMCR       (*(volatile uint32_t*) 0xE000EDFCu)
+
+  static void bench_ticks_init(void) {
+    DEMCR |= (1u << 24); // TRCENA
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1u;      // CYCCNTENA
+  }
+
+  unsigned long bench_ticks(void) {
+    return DWT_CYCCNT;
+  }
+#else
+  static void bench_ticks_init(void) { }
+
+  unsigned long bench_ticks(void) {
+    return board_millis();
+  }
+#endif
+
+//--------------------------------------------------------------------+
+// Benchmark pipes
+//--------------------------------------------------------------------+
+
+// arm transfers on idle endpoints of a pipe according to current mode
+static void pipe_kick(bench_pipe_t* p) {
+  uint8_t const rhport = _bench_rhport;
+
+  // OUT is re-armed unless its buffer is still held for loopback
+  if (p->ep_out && !p->echo && !p->echo_len && usbd_edpt_claim(rhport, p->ep_out)) {
+    usbd_edpt_xfer(rhport, p->ep_out, p->out_buf, p->xfer_size);
+  }
+
+  if (p->ep_in && usbd_edpt_claim(rhport, p->ep_in)) {
+    if (p->echo_len) {
+      p->echo = true;
+      usbd_edpt_xfer(rhport, p->ep_in, p->out_buf, p->echo_len);
+      p->echo_len = 0;
+    } else if (_bench_mode == BENCH_MODE_SOURCE_SINK) {
+      usbd_edpt_xfer(rhport, p->ep_in, p->in_buf, p->xfer_size);
+    } else {
+      usbd_edpt_release(rhport, p->ep_in);
+    }
+  }
+}
+
+static void pipe_init(bench_pipe_t* p, uint8_t* out_buf, uint8_t* in_buf, uint16_t size) {
+  p->ep_out = p->ep_in = 0;
+  p->xfer_size = size;
+  p->echo_len = 0;
+  p->echo = false;
+  p->out_buf = out_buf;
+  p->in_buf = in_buf;
+
+  // source pattern
+  for (uint16_t i = 0; i < size; i++) {
+    in_buf[i] = (uint8_t) i;
+  }
+}
+
+static bench_pipe_t* pipe_find(uint8_t ep_addr) {
+  for (uint8_t i = 0; i < PIPE_COUNT; i++) {
+    if (_pipe[i].ep_out == ep_addr || _pipe[i].ep_in == ep_addr) {
+      return &_pipe[i];
+    }
+  }
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// Benchmark class driver
+//--------------------------------------------------------------------+
+static void bench_init(void) {
+  pipe_init(&_pipe[PIPE_BULK], _bench_epbuf.bulk_out, _bench_epbuf.bulk_in, BENCH_BULK_BUFSIZE);
+  pipe_init(&_pipe[PIPE_INT], _bench_epbuf.int_out, _bench_epbuf.int_in, BENCH_INT_EP_SIZE);
+  pipe_init(&_pipe[PIPE_ISO], _bench_epbuf.iso_out, _bench_epbuf.iso_in, BENCH_ISO_EP_SIZE);
+}
+
+static void bench_reset(uint8_t rhport) {
+  (void) rhport;
+  for (uint8_t i = 0; i < PIPE_COUNT; i++) {
+    _pipe[i].ep_out = _pipe[i].ep_in = 0;
+    _pipe[i].echo_len = 0;
+    _pipe[i].echo = false;
+  }
+  _iso_alt = 0;
+  _iso_alt1_desc = NULL;
+}
+
+static uint16_t bench_open(uint8_t rhport, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  TU_VERIFY(TUSB_CLASS_VENDOR_SPECIFIC == desc_itf->bInterfaceClass, 0);
+  _bench_rhport = rhport;
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  if (desc_itf->bInterfaceNumber == ITF_NUM_BENCH) {
+    p_desc = tu_desc_next(p_desc);
+    for (uint8_t i = 0; i < desc_itf->bNumEndpoints && p_desc < desc_end; p_desc = tu_desc_next(p_desc)) {
+      if (tu_desc_type(p_desc) != TUSB_DESC_ENDPOINT) continue;
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+
+      bench_pipe_t* p = &_pipe[desc_ep->bmAttributes.xfer == TUSB_XFER_BULK ? PIPE_BULK : PIPE_INT];
+      if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+        p->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p->ep_out = desc_ep->bEndpointAddress;
+      }
+      i++;
+    }
+
+    pipe_kick(&_pipe[PIPE_BULK]);
+    pipe_kick(&_pipe[PIPE_INT]);
+  } else if (desc_itf->bInterfaceNumber == ITF_NUM_BENCH_ISO) {
+    // consume all alternate settings, endpoints are opened by SET_INTERFACE
+    p_desc = tu_desc_next(p_desc);
+    while (p_desc < desc_end && !(tu_desc_type(p_desc) == TUSB_DESC_INTERFACE &&
+                                  ((tusb_desc_interface_t const*) p_desc)->bInterfaceNumber != ITF_NUM_BENCH_ISO)) {
+      if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE) {
+        _iso_alt1_desc = p_desc;
+      }
+  #ifdef TUP_USBIP_FSDEV
+      // fsdev needs packet memory allocated for largest packet size before any endpoint is activated
+      if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+        tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+        usbd_edpt_iso_alloc(rhport, desc_ep->bEndpointAddress, tu_edpt_packet_size(desc_ep));
+      }
+  #endif
+      p_desc = tu_desc_next(p_desc);
+    }
+  } else {
+    return 0;
+  }
+
+  return (uint16_t) (p_desc - (uint8_t const*) desc_itf);
+}
+
+// open/close isochronous endpoints of alternate setting 1
+static bool bench_iso_set_alt(uint8_t rhport, uint8_t alt) {
+  bench_pipe_t* p = &_pipe[PIPE_ISO];
+  TU_VERIFY(alt <= 1 && _iso_alt1_desc);
+
+  if (p->ep_out) usbd_edpt_close(rhport, p->ep_out);
+  if (p->ep_in) usbd_edpt_close(rhport, p->ep_in);
+  p->ep_out = p->ep_in = 0;
+  p->echo_len = 0;
+  p->echo = false;
+  _iso_alt = alt;
+
+  if (alt == 1) {
+    tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) _iso_alt1_desc;
+    uint8_t const* p_desc = tu_desc_next(_iso_alt1_desc);
+    for (uint8_t i = 0; i < desc_itf->bNumEndpoints; p_desc = tu_desc_next(p_desc)) {
+      if (tu_desc_type(p_desc) != TUSB_DESC_ENDPOINT) continue;
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+  #ifdef TUP_USBIP_FSDEV
+      TU_ASSERT(usbd_edpt_iso_activate(rhport, desc_ep));
+  #else
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep));
+  #endif
+      if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+        p->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p->ep_out = desc_ep->bEndpointAddress;
+      }
+      i++;
+    }
+    pipe_kick(p);
+  }
+
+  return true;
+}
+
+static bool bench_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+  if (stage != CONTROL_STAGE_SETUP) return true;
+  TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD &&
+            tu_u16_low(request->wIndex) == ITF_NUM_BENCH_ISO);
+
+  switch (request->bRequest) {
+    case TUSB_REQ_SET_INTERFACE:
+      TU_VERIFY(bench_iso_set_alt(rhport, tu_u16_low(request->wValue)));
+      return tud_control_status(rhport, request);
+
+    case TUSB_REQ_GET_INTERFACE:
+      return tud_control_xfer(rhport, request, &_iso_alt, 1);
+
+    default:
+      return false;
+  }
+}
+
+static bool bench_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) rhport;
+  (void) result;
+
+  bench_pipe_t* p = pipe_find(ep_addr);
+  TU_VERIFY(p);
+
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) {
+    if (_bench_mode == BENCH_MODE_LOOPBACK && xferred_bytes) {
+      p->echo_len = (uint16_t) xferred_bytes;
+    }
+  } else {
+    p->echo = false;
+  }
+
+  pipe_kick(p);
+  return true;
+}
+
+static usbd_class_driver_t const _bench_driver = {
+#if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
+  .name            = "BENCH",
+#endif
+  .init            = bench_init,
+  .reset           = bench_reset,
+  .open            = bench_open,
+  .control_xfer_cb = bench_control_xfer_cb,
+  .xfer_cb         = bench_xfer_cb,
+  .sof             = NULL,
+  .xfer_isr        = NULL,
+};
+
+// Implement callback to add our custom driver
+usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count) {
+  *driver_count = 1;
+  return &_bench_driver;
+}
+
+//--------------------------------------------------------------------+
+// Vendor requests
+//--------------------------------------------------------------------+
+
+// Invoked when a control transfer occurred on an interface of this class
+// Driver response accordingly to the request and the transfer stage (setup/data/ack)
+// return false to stall control endpoint (e.g unsupported request)
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+  // nothing to with DATA & ACK stage
+  if (stage != CONTROL_STAGE_SETUP) return true;
+
+  switch (request->bRequest) {
+    case BENCH_REQ_SET_MODE:
+      TU_VERIFY(request->wValue <= BENCH_MODE_LOOPBACK);
+      _bench_mode = (bench_mode_t) request->wValue;
+      // idle IN endpoints start sourcing again
+      for (uint8_t i = 0; i < PIPE_COUNT; i++) {
+        pipe_kick(&_pipe[i]);
+      }
+      return tud_control_status(rhport, request);
+
+    case BENCH_REQ_GET_LOAD: {
+      static bench_load_t load;
+      uint32_t const now = (uint32_t) bench_ticks();
+      load.busy_ticks = _load_busy;
+      load.total_ticks = now - _load_start;
+      _load_busy = 0;
+      _load_start = now;
+      return tud_control_xfer(rhport, request, &load, sizeof(load));
+    }
+
+    case BENCH_REQ_SET_XFER_SIZE:
+      // applies from the next bulk transfer
+      TU_VERIFY(request->wValue && request->wValue <= BENCH_BULK_BUFSIZE);
+      _pipe[PIPE_BULK].xfer_size = request->wValue;
+      return tud_control_status(rhport, request);
+
+    case BENCH_REQ_CLEAR_STATS:
+      tud_edpt_stats_clear();
+      return tud_control_status(rhport, request);
+
+    default:
+      return false;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when device is mounted
+void tud_mount_cb(void) {
+  blink_interval_ms = BLINK_MOUNTED;
+}
+
+// Invoked when device is unmounted
+void tud_umount_cb(void) {
+  blink_interval_ms = BLINK_NOT_MOUNTED;
+}
+
+// Invoked when usb bus is suspended
+// remote_wakeup_en : if host allow us  to perform remote wakeup
+// Within 7ms, device must draw an average of current less than 2.5 mA from bus
+void tud_suspend_cb(bool remote_wakeup_en) {
+  (void) remote_wakeup_en;
+  blink_interval_ms = BLINK_SUSPENDED;
+}
+
+// Invoked when usb bus is resumed
+void tud_resume_cb(void) {
+  blink_interval_ms = tud_mounted() ? BLINK_MOUNTED : BLINK_NOT_MOUNTED;
+}
+
+/*------------- MAIN -------------*/
+int main(void) {
+  board_init();
+  bench_ticks_init();
+
+  // init device stack on configured roothub port
+  tud_init(BOARD_TUD_RHPORT);
+
+  if (board_init_after_tusb) {
+    board_init_after_tusb();
+  }
+
+  _load_start = (uint32_t) bench_ticks();
+
+  while (1) {
+    // CPU load: time spent in stack and benchmark driver (interrupts included) versus idle loop
+    uint32_t const start = (uint32_t) bench_ticks();
+    tud_task(); // tinyusb device task
+    _load_busy += (uint32_t) bench_ticks() - start;
+
+    led_blinking_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// BLINKING TASK
+//--------------------------------------------------------------------+
+void led_blinking_task(void) {
+  static uint32_t start_ms = 0;
+  static bool led_state = false;
+
+  // Blink every interval ms
+  if (board_millis() - start_ms < blink_interval_ms) return; // not enough time
+  start_ms += blink_interval_ms;
+
+  board_led_write(led_state);
+  led_state = 1 - led_state; // toggle
+}
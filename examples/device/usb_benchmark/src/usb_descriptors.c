@@ -0,0 +1,201 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "bsp/board_api.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+
+#define USB_PID   0x4100
+
+//--------------------------------------------------------------------+
+// Device Descriptors
+//--------------------------------------------------------------------+
+tusb_desc_device_t const desc_device =
+{
+    .bLength            = sizeof(tusb_desc_device_t),
+    .bDescriptorType    = TUSB_DESC_DEVICE,
+    .bcdUSB             = 0x0200,
+    .bDeviceClass       = 0x00,
+    .bDeviceSubClass    = 0x00,
+    .bDeviceProtocol    = 0x00,
+    .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+
+    .idVendor           = 0xCafe,
+    .idProduct          = USB_PID,
+    .bcdDevice          = 0x0100,
+
+    .iManufacturer      = 0x01,
+    .iProduct           = 0x02,
+    .iSerialNumber      = 0x03,
+
+    .bNumConfigurations = 0x01
+};
+
+// Invoked when received GET DEVICE DESCRIPTOR
+// Application return pointer to descriptor
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return (uint8_t const *) &desc_device;
+}
+
+//--------------------------------------------------------------------+
+// Configuration Descriptor
+//--------------------------------------------------------------------+
+
+#if CFG_TUSB_MCU == OPT_MCU_LPC175X_6X || CFG_TUSB_MCU == OPT_MCU_LPC177X_8X || CFG_TUSB_MCU == OPT_MCU_LPC40XX
+  // LPC 17xx and 40xx endpoint type (bulk/interrupt/iso) are fixed by its number
+  // 0 control, 1 In, 2 Bulk, 3 Iso, 4 In etc ...
+  #define EPNUM_BULK_OUT   2
+  #define EPNUM_BULK_IN    2
+  #define EPNUM_INT_OUT    1
+  #define EPNUM_INT_IN     1
+  #define EPNUM_ISO_OUT    3
+  #define EPNUM_ISO_IN     3
+#elif CFG_TUSB_MCU == OPT_MCU_SAMG || CFG_TUSB_MCU == OPT_MCU_SAMX7X || \
+      CFG_TUSB_MCU == OPT_MCU_FT90X || CFG_TUSB_MCU == OPT_MCU_FT93X
+  // These MCUs don't support a same endpoint number with different direction IN and OUT
+  //    e.g EP1 OUT & EP1 IN cannot exist together
+  #define EPNUM_BULK_OUT   1
+  #define EPNUM_BULK_IN    2
+  #define EPNUM_INT_OUT    3
+  #define EPNUM_INT_IN     4
+  #define EPNUM_ISO_OUT    5
+  #define EPNUM_ISO_IN     6
+#else
+  #define EPNUM_BULK_OUT   1
+  #define EPNUM_BULK_IN    1
+  #define EPNUM_INT_OUT    2
+  #define EPNUM_INT_IN     2
+  #define EPNUM_ISO_OUT    3
+  #define EPNUM_ISO_IN     3
+#endif
+
+#define BENCH_ITF_DESC_LEN   (9 + 4*7)
+#define BENCH_ISO_DESC_LEN   (9 + 9 + 2*7)
+#define CONFIG_TOTAL_LEN     (TUD_CONFIG_DESC_LEN + BENCH_ITF_DESC_LEN + BENCH_ISO_DESC_LEN)
+
+// Interface number, alternate setting, number of endpoints, string index
+#define BENCH_INTERFACE(_itfnum, _alt, _ep_count, _stridx) \
+  9, TUSB_DESC_INTERFACE, _itfnum, _alt, _ep_count, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, _stridx
+
+// Endpoint address, attributes, size, interval
+#define BENCH_ENDPOINT(_addr, _attr, _size, _interval) \
+  7, TUSB_DESC_ENDPOINT, _addr, _attr, U16_TO_U8S_LE(_size), _interval
+
+uint8_t const desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
+
+  BENCH_INTERFACE(ITF_NUM_BENCH, 0, 4, 4),
+  BENCH_ENDPOINT(EPNUM_BULK_OUT, TUSB_XFER_BULK, BENCH_BULK_EP_SIZE, 0),
+  BENCH_ENDPOINT(0x80 | EPNUM_BULK_IN, TUSB_XFER_BULK, BENCH_BULK_EP_SIZE, 0),
+  BENCH_ENDPOINT(EPNUM_INT_OUT, TUSB_XFER_INTERRUPT, BENCH_INT_EP_SIZE, 1),
+  BENCH_ENDPOINT(0x80 | EPNUM_INT_IN, TUSB_XFER_INTERRUPT, BENCH_INT_EP_SIZE, 1),
+
+  // alternate 0 without endpoint so that isochronous bandwidth is only reserved on demand
+  BENCH_INTERFACE(ITF_NUM_BENCH_ISO, 0, 0, 5),
+  BENCH_INTERFACE(ITF_NUM_BENCH_ISO, 1, 2, 5),
+  BENCH_ENDPOINT(EPNUM_ISO_OUT, TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS, BENCH_ISO_EP_SIZE, 1),
+  BENCH_ENDPOINT(0x80 | EPNUM_ISO_IN, TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS, BENCH_ISO_EP_SIZE, 1),
+};
+
+TU_VERIFY_STATIC(sizeof(desc_configuration) == CONFIG_TOTAL_LEN, "Incorrect size");
+
+// Invoked when received GET CONFIGURATION DESCRIPTOR
+// Application return pointer to descriptor
+// Descriptor contents must exist long enough for transfer to complete
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  (void) index; // for multiple configurations
+  return desc_configuration;
+}
+
+//--------------------------------------------------------------------+
+// String Descriptors
+//--------------------------------------------------------------------+
+
+// String Descriptor Index
+enum {
+  STRID_LANGID = 0,
+  STRID_MANUFACTURER,
+  STRID_PRODUCT,
+  STRID_SERIAL,
+};
+
+// array of pointer to string descriptors
+char const *string_desc_arr[] =
+{
+  (const char[]) { 0x09, 0x04 }, // 0: is supported language is English (0x0409)
+  "TinyUSB",                     // 1: Manufacturer
+  "TinyUSB Benchmark",           // 2: Product
+  NULL,                          // 3: Serials will use unique ID if possible
+  "Bulk & Interrupt",            // 4: Benchmark Interface
+  "Isochronous"                  // 5: Benchmark ISO Interface
+};
+
+static uint16_t _desc_str[32 + 1];
+
+// Invoked when received GET STRING DESCRIPTOR request
+// Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
+uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+  (void) langid;
+  size_t chr_count;
+
+  switch ( index ) {
+    case STRID_LANGID:
+      memcpy(&_desc_str[1], string_desc_arr[0], 2);
+      chr_count = 1;
+      break;
+
+    case STRID_SERIAL:
+      chr_count = board_usb_get_serial(_desc_str + 1, 32);
+      break;
+
+    default:
+      // Note: the 0xEE index string is a Microsoft OS 1.0 Descriptors.
+      // https://docs.microsoft.com/en-us/windows-hardware/drivers/usbcon/microsoft-defined-usb-descriptors
+
+      if ( !(index < sizeof(string_desc_arr) / sizeof(string_desc_arr[0])) ) return NULL;
+
+      const char *str = string_desc_arr[index];
+
+      // Cap at max char
+      chr_count = strlen(str);
+      size_t const max_count = sizeof(_desc_str) / sizeof(_desc_str[0]) - 1; // -1 for string type
+      if ( chr_count > max_count ) chr_count = max_count;
+
+      // Convert ASCII string into UTF-16
+      for ( size_t i = 0; i < chr_count; i++ ) {
+        _desc_str[1 + i] = str[i];
+      }
+      break;
+  }
+
+  // first byte is length (including header), second byte is string type
+  _desc_str[0] = (uint16_t) ((TUSB_DESC_STRING << 8) | (2 * chr_count + 2));
+
+  return _desc_str;
+}
@@ -0,0 +1,62 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef USB_DESCRIPTORS_H_
+#define USB_DESCRIPTORS_H_
+
+enum {
+  ITF_NUM_BENCH = 0, // bulk + interrupt endpoints
+  ITF_NUM_BENCH_ISO, // alternate 1: isochronous endpoints (alternate 0 has zero bandwidth)
+  ITF_NUM_TOTAL
+};
+
+// Vendor requests, recipient device, wIndex is ignored unless noted
+enum {
+  BENCH_REQ_SET_MODE       = 1, // OUT: wValue = bench_mode_t
+  BENCH_REQ_GET_LOAD       = 2, // IN : bench_load_t since last request, then reset
+  BENCH_REQ_GET_EDPT_STATS = 3, // IN : tusb_edpt_stats_t of endpoint in wIndex (CFG_TUD_EDPT_STATS_VENDOR_REQUEST)
+  BENCH_REQ_SET_XFER_SIZE  = 4, // OUT: wValue = bytes per bulk transfer (up to BENCH_BULK_BUFSIZE)
+  BENCH_REQ_CLEAR_STATS    = 5, // OUT: clear endpoint statistics
+};
+
+typedef enum {
+  BENCH_MODE_SOURCE_SINK = 0, // IN endpoints keep sending, OUT endpoints keep receiving
+  BENCH_MODE_LOOPBACK    = 1, // data received on OUT endpoint is sent back on IN endpoint of same type
+} bench_mode_t;
+
+// CPU load: ratio of busy to total ticks, in unit of bench_ticks()
+typedef struct TU_ATTR_PACKED {
+  uint32_t busy_ticks;  // spent in tud_task() and benchmark driver
+  uint32_t total_ticks; // elapsed
+} bench_load_t;
+
+#define BENCH_BULK_EP_SIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#define BENCH_INT_EP_SIZE    64
+#define BENCH_ISO_EP_SIZE    (TUD_OPT_HIGH_SPEED ? 1024 : 256)
+#define BENCH_BULK_BUFSIZE   (TUD_OPT_HIGH_SPEED ? 16384 : 4096)
+
+extern uint8_t const desc_configuration[];
+
+#endif /* USB_DESCRIPTORS_H_ */
@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+#
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 Ha Thach (tinyusb.org)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+# Host side of usb_benchmark example: measure throughput, transfer latency percentiles and device CPU load.
+# Require libusb and its python binding: pip install libusb1
+#
+# Examples:
+#   usb_benchmark.py --pipe bulk --dir in --size 16384 --duration 5
+#   usb_benchmark.py --pipe int --dir loop
+#   usb_benchmark.py --pipe iso --dir out
+#   usb_benchmark.py --pipe bulk --dir in --json   # machine readable result for regression tracking
+
+import argparse
+import json
+import struct
+import sys
+import time
+
+import usb1
+
+USB_VID = 0xcafe
+USB_PID = 0x4100
+
+ITF_NUM_BENCH = 0
+ITF_NUM_BENCH_ISO = 1
+
+# must match usb_descriptors.h
+BENCH_REQ_SET_MODE = 1
+BENCH_REQ_GET_LOAD = 2
+BENCH_REQ_GET_EDPT_STATS = 3
+BENCH_REQ_SET_XFER_SIZE = 4
+BENCH_REQ_CLEAR_STATS = 5
+
+BENCH_MODE_SOURCE_SINK = 0
+BENCH_MODE_LOOPBACK = 1
+
+REQ_TYPE = usb1.TYPE_VENDOR | usb1.RECIPIENT_DEVICE
+TIMEOUT_MS = 1000
+
+XFER_TYPE = {'iso': usb1.TRANSFER_TYPE_ISOCHRONOUS, 'bulk': usb1.TRANSFER_TYPE_BULK,
+             'int': usb1.TRANSFER_TYPE_INTERRUPT}
+
+
+def find_endpoints(device, pipe):
+    """Return (ep_out, ep_out_size, ep_in, ep_in_size) of the pipe from configuration descriptor"""
+    ep_out = ep_in = None
+    for setting in device.iterSettings():
+        for ep in setting:
+            if (ep.getAttributes() & 0x03) != XFER_TYPE[pipe]:
+                continue
+            size = ep.getMaxPacketSize() & 0x7ff
+            if ep.getAddress() & 0x80:
+                ep_in = (ep.getAddress(), size)
+            else:
+                ep_out = (ep.getAddress(), size)
+    return ep_out[0], ep_out[1], ep_in[0], ep_in[1]
+
+
+def open_device(context, vid, pid, serial):
+    """Open benchmark device, optionally selected by serial number when several boards are connected"""
+    if not serial:
+        return context.openByVendorIDAndProductID(vid, pid, skip_on_error=True)
+    for device in context.getDeviceIterator(skip_on_error=True):
+        if device.getVendorID() == vid and device.getProductID() == pid:
+            handle = device.open()
+            if handle.getSerialNumber() == serial:
+                return handle
+            handle.close()
+    return None
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    k = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[k]
+
+
+def read_load(handle):
+    busy, total = struct.unpack('<II', handle.controlRead(REQ_TYPE, BENCH_REQ_GET_LOAD, 0, 0, 8, TIMEOUT_MS))
+    return busy, total
+
+
+def read_edpt_stats(handle, ep_addr):
+    data = handle.controlRead(REQ_TYPE, BENCH_REQ_GET_EDPT_STATS, 0, ep_addr, 256, TIMEOUT_MS)
+    xfer_count, nbytes, errors, stalls, armed, idle = struct.unpack_from('<IIHHII', data)
+    bins = (len(data) - 20) // 4
+    hist = list(struct.unpack_from('<%dI' % bins, data, 20))
+    return {'xfer_count': xfer_count, 'bytes': nbytes, 'errors': errors, 'stalls': stalls,
+            'armed_ticks': armed, 'idle_ticks': idle, 'latency_hist': hist}
+
+
+def run_sync(handle, pipe, direction, ep_out, ep_in, size, duration):
+    """Bulk/interrupt: back to back synchronous transfers, return (bytes, latencies in seconds)"""
+    if pipe == 'bulk':
+        read, write = handle.bulkRead, handle.bulkWrite
+    else:
+        read, write = handle.interruptRead, handle.interruptWrite
+
+    payload = bytes(i & 0xff for i in range(size))
+    latencies = []
+    total = 0
+    end = time.perf_counter() + duration
+    while time.perf_counter() < end:
+        start = time.perf_counter()
+        if direction == 'in':
+            total += len(read(ep_in, size, TIMEOUT_MS))
+        elif direction == 'out':
+            total += write(ep_out, payload, TIMEOUT_MS)
+        else:
+            write(ep_out, payload, TIMEOUT_MS)
+            total += len(read(ep_in, size, TIMEOUT_MS))
+        latencies.append(time.perf_counter() - start)
+    return total, latencies
+
+
+def run_iso(context, handle, direction, ep_out, ep_in, packet_size, duration, packets_per_xfer=8, xfer_count=4):
+    """Isochronous: keep xfer_count transfers of packets_per_xfer packets in flight"""
+    ep = ep_in if direction == 'in' else ep_out
+    state = {'bytes': 0, 'latencies': [], 'running': True, 'inflight': 0}
+
+    def callback(transfer):
+        state['inflight'] -= 1
+        if transfer.getStatus() != usb1.TRANSFER_COMPLETED:
+            return
+        for status, buf in transfer.iterISO():
+            if status == usb1.TRANSFER_COMPLETED:
+                state['bytes'] += len(buf)
+        now = time.perf_counter()
+        state['latencies'].append(now - transfer.getUserData())
+        if state['running']:
+            transfer.setUserData(now)
+            transfer.submit()
+            state['inflight'] += 1
+
+    transfers = []
+    for _ in range(xfer_count):
+        transfer = handle.getTransfer(iso_packets=packets_per_xfer)
+        if direction == 'in':
+            transfer.setIsochronous(ep, packet_size * packets_per_xfer, callback=callback)
+        else:
+            transfer.setIsochronous(ep, bytes(packet_size * packets_per_xfer), callback=callback)
+        transfers.append(transfer)
+
+    for transfer in transfers:
+        transfer.setUserData(time.perf_counter())
+        transfer.submit()
+        state['inflight'] += 1
+
+    end = time.perf_counter() + duration
+    while time.perf_counter() < end:
+        context.handleEventsTimeout(0.1)
+
+    state['running'] = False
+    while state['inflight']:
+        context.handleEventsTimeout(0.1)
+
+    return state['bytes'], state['latencies']
+
+
+def main():
+    parser = argparse.ArgumentParser(description='TinyUSB benchmark host tool')
+    parser.add_argument('--pipe', choices=['bulk', 'int', 'iso'], default='bulk')
+    parser.add_argument('--dir', choices=['in', 'out', 'loop'], default='in',
+                        help='in: device source, out: device sink, loop: device loopback')
+    parser.add_argument('--size', type=int, default=0, help='bytes per bulk/interrupt transfer, default 4096 for bulk and endpoint size for interrupt')
+    parser.add_argument('--duration', type=float, default=5.0, help='seconds')
+    parser.add_argument('--vid', type=lambda x: int(x, 0), default=USB_VID)
+    parser.add_argument('--pid', type=lambda x: int(x, 0), default=USB_PID)
+    parser.add_argument('--serial', default=None, help='serial number of device to test')
+    parser.add_argument('--json', action='store_true', help='print result as json')
+    args = parser.parse_args()
+
+    if args.pipe == 'iso' and args.dir == 'loop':
+        sys.exit('loopback is not supported on isochronous pipe')
+
+    with usb1.USBContext() as context:
+        handle = open_device(context, args.vid, args.pid, args.serial)
+        if handle is None:
+            sys.exit('Benchmark device %04x:%04x not found' % (args.vid, args.pid))
+
+        device = handle.getDevice()
+        ep_out, ep_out_size, ep_in, ep_in_size = find_endpoints(device, args.pipe)
+
+        handle.claimInterface(ITF_NUM_BENCH)
+        if args.pipe == 'iso':
+            handle.claimInterface(ITF_NUM_BENCH_ISO)
+            handle.setInterfaceAltSetting(ITF_NUM_BENCH_ISO, 1)
+
+        # IN transfer already armed by device in previous mode completes with its data first
+        mode = BENCH_MODE_LOOPBACK if args.dir == 'loop' else BENCH_MODE_SOURCE_SINK
+        handle.controlWrite(REQ_TYPE, BENCH_REQ_SET_MODE, mode, 0, b'', TIMEOUT_MS)
+
+        size = args.size
+        if args.pipe == 'bulk':
+            size = size or 4096
+            handle.controlWrite(REQ_TYPE, BENCH_REQ_SET_XFER_SIZE, size, 0, b'', TIMEOUT_MS)
+        elif args.pipe == 'int':
+            size = size or ep_in_size
+
+        handle.controlWrite(REQ_TYPE, BENCH_REQ_CLEAR_STATS, 0, 0, b'', TIMEOUT_MS)
+        read_load(handle)
+
+        wall_start = time.perf_counter()
+        if args.pipe == 'iso':
+            total, latencies = run_iso(context, handle, args.dir, ep_out, ep_in,
+                                       ep_in_size if args.dir == 'in' else ep_out_size, args.duration)
+        else:
+            total, latencies = run_sync(handle, args.pipe, args.dir, ep_out, ep_in, size, args.duration)
+        wall = time.perf_counter() - wall_start
+
+        busy, ticks = read_load(handle)
+        stats = {}
+        for ep in ([ep_in] if args.dir == 'in' else [ep_out] if args.dir == 'out' else [ep_out, ep_in]):
+            stats['0x%02x' % ep] = read_edpt_stats(handle, ep)
+
+        handle.controlWrite(REQ_TYPE, BENCH_REQ_SET_MODE, BENCH_MODE_SOURCE_SINK, 0, b'', TIMEOUT_MS)
+        if args.pipe == 'iso':
+            handle.setInterfaceAltSetting(ITF_NUM_BENCH_ISO, 0)
+
+    latencies.sort()
+    tick_hz = ticks / wall if wall else 0
+    result = {
+        'pipe': args.pipe,
+        'dir': args.dir,
+        'size': size,
+        'duration_s': wall,
+        'bytes': total,
+        'MBps': total / wall / 1e6 if wall else 0,
+        'transfers': len(latencies),
+        'latency_us': {p: percentile(latencies, p) * 1e6 for p in (50, 90, 99, 100)},
+        'cpu_load': busy / ticks if ticks else 0,
+        'tick_hz': tick_hz,
+        'edpt_stats': stats,
+    }
+
+    if args.json:
+        print(json.dumps(result, indent=2))
+        return
+
+    print('%s %s: %d bytes in %.2f s = %.3f MB/s (%d transfers)' %
+          (args.pipe, args.dir, total, wall, result['MBps'], len(latencies)))
+    print('latency p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us' %
+          tuple(result['latency_us'][p] for p in (50, 90, 99, 100)))
+    print('device CPU load %.1f %% (tick rate ~%.0f Hz)' % (100 * result['cpu_load'], tick_hz))
+    for ep, s in stats.items():
+        armed = s['armed_ticks'] / tick_hz * 1e3 if tick_hz else 0
+        idle = s['idle_ticks'] / tick_hz * 1e3 if tick_hz else 0
+        print('EP %s: %d transfers, %d bytes, %d errors, %d stalls, armed %.1f ms, idle %.1f ms' %
+              (ep, s['xfer_count'], s['bytes'], s['errors'], s['stalls'], armed, idle))
+        hist = s['latency_hist']
+        for n, count in enumerate(hist):
+            if count:
+                lo = 0 if n == 0 else 1 << (n - 1)
+                hi = '' if n == len(hist) - 1 else '%d' % ((1 << n) - 1)
+                print('  arm->complete %8d..%-8s ticks: %d' % (lo, hi, count))
+
+
+if __name__ == '__main__':
+    main()
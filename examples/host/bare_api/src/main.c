@@ -35,8 +35,6 @@
 #include "bsp/board_api.h"
 #include "tusb.h"
 
-// English
-#define LANGUAGE_ID 0x0409
 #define BUF_COUNT   4
 
 
@@ -50,7 +48,6 @@ uint8_t buf_owner[BUF_COUNT] = { 0 }; // device address that owns buffer
 //--------------------------------------------------------------------+
 void led_blinking_task(void);
 
-static void print_utf16(uint16_t *temp_buf, size_t buf_len);
 void print_device_descriptor(tuh_xfer_t* xfer);
 void parse_config_descriptor(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg);
 
@@ -127,33 +124,22 @@ void print_device_descriptor(tuh_xfer_t* xfer)
   printf("  idProduct           0x%04x\r\n" , desc_device.idProduct);
   printf("  bcdDevice           %04x\r\n"   , desc_device.bcdDevice);
 
-  // Get String descriptor using Sync API
-  uint16_t temp_buf[128];
+  // Strings are already fetched during enumeration (CFG_TUH_STRING_CACHE)
+  char const* str;
 
-  printf("  iManufacturer       %u     "     , desc_device.iManufacturer);
-  if (XFER_RESULT_SUCCESS == tuh_descriptor_get_manufacturer_string_sync(daddr, LANGUAGE_ID, temp_buf, sizeof(temp_buf)) )
-  {
-    print_utf16(temp_buf, TU_ARRAY_SIZE(temp_buf));
-  }
-  printf("\r\n");
+  str = tuh_manufacturer_string_get(daddr);
+  printf("  iManufacturer       %u     %s\r\n", desc_device.iManufacturer, str ? str : "");
 
-  printf("  iProduct            %u     "     , desc_device.iProduct);
-  if (XFER_RESULT_SUCCESS == tuh_descriptor_get_product_string_sync(daddr, LANGUAGE_ID, temp_buf, sizeof(temp_buf)))
-  {
-    print_utf16(temp_buf, TU_ARRAY_SIZE(temp_buf));
-  }
-  printf("\r\n");
+  str = tuh_product_string_get(daddr);
+  printf("  iProduct            %u     %s\r\n", desc_device.iProduct, str ? str : "");
 
-  printf("  iSerialNumber       %u     "     , desc_device.iSerialNumber);
-  if (XFER_RESULT_SUCCESS == tuh_descriptor_get_serial_string_sync(daddr, LANGUAGE_ID, temp_buf, sizeof(temp_buf)))
-  {
-    print_utf16(temp_buf, TU_ARRAY_SIZE(temp_buf));
-  }
-  printf("\r\n");
+  str = tuh_serial_string_get(daddr);
+  printf("  iSerialNumber       %u     %s\r\n", desc_device.iSerialNumber, str ? str : "");
 
   printf("  bNumConfigurations  %u\r\n"     , desc_device.bNumConfigurations);
 
   // Get configuration descriptor with sync API
+  uint16_t temp_buf[128];
   if (XFER_RESULT_SUCCESS == tuh_descriptor_get_configuration_sync(daddr, 0, temp_buf, sizeof(temp_buf)))
   {
     parse_config_descriptor(daddr, (tusb_desc_configuration_t*) temp_buf);
@@ -369,56 +355,3 @@ void led_blinking_task(void)
   board_led_write(led_state);
   led_state = 1 - led_state; // toggle
 }
-
-//--------------------------------------------------------------------+
-// String Descriptor Helper
-//--------------------------------------------------------------------+
-
-static void _convert_utf16le_to_utf8(const uint16_t *utf16, size_t utf16_len, uint8_t *utf8, size_t utf8_len) {
-    // TODO: Check for runover.
-    (void)utf8_len;
-    // Get the UTF-16 length out of the data itself.
-
-    for (size_t i = 0; i < utf16_len; i++) {
-        uint16_t chr = utf16[i];
-        if (chr < 0x80) {
-            *utf8++ = chr & 0xffu;
-        } else if (chr < 0x800) {
-            *utf8++ = (uint8_t)(0xC0 | (chr >> 6 & 0x1F));
-            *utf8++ = (uint8_t)(0x80 | (chr >> 0 & 0x3F));
-        } else {
-            // TODO: Verify surrogate.
-            *utf8++ = (uint8_t)(0xE0 | (chr >> 12 & 0x0F));
-            *utf8++ = (uint8_t)(0x80 | (chr >> 6 & 0x3F));
-            *utf8++ = (uint8_t)(0x80 | (chr >> 0 & 0x3F));
-        }
-        // TODO: Handle UTF-16 code points that take two entries.
-    }
-}
-
-// Count how many bytes a utf-16-le encoded string will take in utf-8.
-static int _count_utf8_bytes(const uint16_t *buf, size_t len) {
-    size_t total_bytes = 0;
-    for (size_t i = 0; i < len; i++) {
-        uint16_t chr = buf[i];
-        if (chr < 0x80) {
-            total_bytes += 1;
-        } else if (chr < 0x800) {
-            total_bytes += 2;
-        } else {
-            total_bytes += 3;
-        }
-        // TODO: Handle UTF-16 code points that take two entries.
-    }
-    return (int) total_bytes;
-}
-
-static void print_utf16(uint16_t *temp_buf, size_t buf_len) {
-    if ((temp_buf[0] & 0xff) == 0) return;  // empty
-    size_t utf16_len = ((temp_buf[0] & 0xff) - 2) / sizeof(uint16_t);
-    size_t utf8_len = (size_t) _count_utf8_bytes(temp_buf + 1, utf16_len);
-    _convert_utf16le_to_utf8(temp_buf + 1, utf16_len, (uint8_t *) temp_buf, sizeof(uint16_t) * buf_len);
-    ((uint8_t*) temp_buf)[utf8_len] = '\0';
-
-    printf((char*)temp_buf);
-}
@@ -101,6 +101,10 @@
 // Size of buffer to hold descriptors and other data used for enumeration
 #define CFG_TUH_ENUMERATION_BUFSIZE 256
 
+// Fetch manufacturer, product and serial strings during enumeration
+#define CFG_TUH_STRING_CACHE        1
+#define CFG_TUH_STRING_CACHE_LEN    64
+
 // only hub class is enabled
 #define CFG_TUH_HUB                 1
 
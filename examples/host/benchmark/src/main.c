@@ -0,0 +1,314 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Host benchmark: measures how long each enumeration phase takes and the read throughput of every
+ * attached MSC/CDC device. Plug devices directly or through a hub, the example prints
+ * - one line per enumerated device with per-phase duration (reset, addr0, set address, descriptors,
+ *   set configuration, class mount) and time since boot
+ * - once per second: KB/s per device and aggregate over all devices
+ *
+ * MSC devices are read continuously with READ10 from LBA 0 (wrapping), CDC devices are drained with tuh_cdc_read()
+ * so the throughput depends on what the attached device sends.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bsp/board_api.h"
+#include "tusb.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+enum {
+  REPORT_INTERVAL_MS = 1000,
+  MSC_READ_BLOCKS = 8,  // blocks per READ10, buffer is sized for 512-byte blocks
+};
+
+void led_blinking_task(void);
+static void report_task(void);
+
+#if CFG_TUH_ENABLED && CFG_TUH_MAX3421
+// API to read/rite MAX3421's register. Implemented by TinyUSB
+extern uint8_t tuh_max3421_reg_read(uint8_t rhport, uint8_t reg, bool in_isr);
+extern bool tuh_max3421_reg_write(uint8_t rhport, uint8_t reg, uint8_t data, bool in_isr);
+#endif
+
+/*------------- MAIN -------------*/
+int main(void) {
+  board_init();
+
+  printf("TinyUSB Host Benchmark Example\r\n");
+
+  // init host stack on configured roothub port
+  tuh_init(BOARD_TUH_RHPORT);
+
+  if (board_init_after_tusb) {
+    board_init_after_tusb();
+  }
+
+#if CFG_TUH_ENABLED && CFG_TUH_MAX3421
+  // FeatherWing MAX3421E use MAX3421E's GPIO0 for VBUS enable
+  enum { IOPINS1_ADDR  = 20u << 3, /* 0xA0 */ };
+  tuh_max3421_reg_write(BOARD_TUH_RHPORT, IOPINS1_ADDR, 0x01, false);
+#endif
+
+  while (1) {
+    // tinyusb host task
+    tuh_task();
+
+    led_blinking_task();
+    report_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// Enumeration timing
+//--------------------------------------------------------------------+
+// A device being enumerated is identified by its attach point since address is not assigned yet
+typedef struct {
+  uint8_t rhport;
+  uint8_t hub_addr;
+  uint8_t hub_port;
+  uint8_t active;
+  uint32_t boot_ms;                           // attach time since boot
+  uint32_t phase_ms[TUH_ENUM_PHASE_ABORTED];  // start time of each phase
+} enum_timing_t;
+
+static enum_timing_t _enum_timing[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB];
+
+static enum_timing_t* enum_timing_find(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port, bool alloc) {
+  enum_timing_t* free_slot = NULL;
+  for (size_t i = 0; i < TU_ARRAY_SIZE(_enum_timing); i++) {
+    enum_timing_t* t = &_enum_timing[i];
+    if (t->active) {
+      if (t->rhport == rhport && t->hub_addr == hub_addr && t->hub_port == hub_port) {
+        return t;
+      }
+    } else if (free_slot == NULL) {
+      free_slot = t;
+    }
+  }
+  return alloc ? free_slot : NULL;
+}
+
+static uint32_t phase_duration(enum_timing_t const* t, tuh_enum_phase_t phase) {
+  return t->phase_ms[phase + 1] - t->phase_ms[phase];
+}
+
+void tuh_enum_phase_cb(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port, uint8_t daddr, tuh_enum_phase_t phase) {
+  uint32_t const now = board_millis();
+  enum_timing_t* t = enum_timing_find(rhport, hub_addr, hub_port, phase == TUH_ENUM_PHASE_ATTACH);
+  if (t == NULL) {
+    return;
+  }
+
+  if (phase == TUH_ENUM_PHASE_ATTACH) {
+    memset(t, 0, sizeof(enum_timing_t));
+    t->rhport = rhport;
+    t->hub_addr = hub_addr;
+    t->hub_port = hub_port;
+    t->active = 1;
+    t->boot_ms = now;
+  }
+
+  if (phase == TUH_ENUM_PHASE_ABORTED) {
+    printf("[enum] rhport %u hub %u port %u: aborted after %lu ms\r\n", rhport, hub_addr, hub_port,
+           (unsigned long) (now - t->boot_ms));
+    t->active = 0;
+    return;
+  }
+
+  t->phase_ms[phase] = now;
+
+  if (phase == TUH_ENUM_PHASE_MOUNTED) {
+    // durations in ms: reset + debounce, addr0 descriptor, set address, device + config descriptor,
+    // set configuration, class driver mount
+    printf("[enum] addr %u (hub %u port %u): reset %lu, addr0 %lu, set_addr %lu, desc %lu, set_config %lu, "
+           "class %lu, total %lu ms (attached at %lu ms)\r\n",
+           daddr, hub_addr, hub_port,
+           (unsigned long) phase_duration(t, TUH_ENUM_PHASE_ATTACH),
+           (unsigned long) phase_duration(t, TUH_ENUM_PHASE_ADDR0_DESC),
+           (unsigned long) phase_duration(t, TUH_ENUM_PHASE_SET_ADDR),
+           (unsigned long) (t->phase_ms[TUH_ENUM_PHASE_SET_CONFIG] - t->phase_ms[TUH_ENUM_PHASE_DEVICE_DESC]),
+           (unsigned long) phase_duration(t, TUH_ENUM_PHASE_SET_CONFIG),
+           (unsigned long) phase_duration(t, TUH_ENUM_PHASE_CLASS_MOUNT),
+           (unsigned long) (now - t->boot_ms),
+           (unsigned long) t->boot_ms);
+    t->active = 0;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Throughput
+//--------------------------------------------------------------------+
+typedef struct {
+  uint32_t bytes;  // bytes received in current interval
+  uint8_t msc;
+  uint8_t cdc;
+} dev_stat_t;
+
+static dev_stat_t _dev_stat[CFG_TUH_DEVICE_MAX + 1]; // index by device address
+
+#if CFG_TUH_MSC
+typedef struct {
+  uint32_t lba;
+  uint32_t block_count;
+  uint16_t blocks_per_xfer;
+} msc_bench_t;
+
+static msc_bench_t _msc_bench[CFG_TUH_DEVICE_MAX];
+CFG_TUH_MEM_SECTION static TU_ATTR_ALIGNED(4) uint8_t _msc_buf[CFG_TUH_DEVICE_MAX][MSC_READ_BLOCKS * 512];
+
+static bool msc_read_next(uint8_t dev_addr);
+
+static bool msc_read_complete_cb(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data) {
+  msc_bench_t* bench = &_msc_bench[dev_addr - 1];
+  if (cb_data->csw->status != MSC_CSW_STATUS_PASSED) {
+    printf("[msc] addr %u: read10 failed at lba %lu, stop\r\n", dev_addr, (unsigned long) bench->lba);
+    return false;
+  }
+
+  _dev_stat[dev_addr].bytes += cb_data->cbw->total_bytes;
+  bench->lba += bench->blocks_per_xfer;
+  if (bench->lba + bench->blocks_per_xfer > bench->block_count) {
+    bench->lba = 0;
+  }
+
+  return msc_read_next(dev_addr);
+}
+
+static bool msc_read_next(uint8_t dev_addr) {
+  msc_bench_t const* bench = &_msc_bench[dev_addr - 1];
+  return tuh_msc_read10(dev_addr, 0, _msc_buf[dev_addr - 1], bench->lba, bench->blocks_per_xfer,
+                        msc_read_complete_cb, 0);
+}
+
+void tuh_msc_mount_cb(uint8_t dev_addr) {
+  uint32_t const block_size = tuh_msc_get_block_size(dev_addr, 0);
+  msc_bench_t* bench = &_msc_bench[dev_addr - 1];
+
+  if (block_size == 0 || block_size > sizeof(_msc_buf[0])) {
+    printf("[msc] addr %u: unsupported block size %lu\r\n", dev_addr, (unsigned long) block_size);
+    return;
+  }
+
+  bench->lba = 0;
+  bench->block_count = tuh_msc_get_block_count(dev_addr, 0);
+  bench->blocks_per_xfer = (uint16_t) tu_min32(sizeof(_msc_buf[0]) / block_size, bench->block_count);
+  _dev_stat[dev_addr].msc = 1;
+
+  printf("[msc] addr %u: %lu blocks of %lu bytes, reading %u blocks per READ10\r\n", dev_addr,
+         (unsigned long) bench->block_count, (unsigned long) block_size, bench->blocks_per_xfer);
+  msc_read_next(dev_addr);
+}
+
+void tuh_msc_umount_cb(uint8_t dev_addr) {
+  _dev_stat[dev_addr].msc = 0;
+}
+#endif
+
+#if CFG_TUH_CDC
+void tuh_cdc_rx_cb(uint8_t idx) {
+  static uint8_t buf[CFG_TUH_CDC_RX_BUFSIZE];
+  tuh_itf_info_t itf_info = {0};
+  tuh_cdc_itf_get_info(idx, &itf_info);
+
+  uint32_t count;
+  while ((count = tuh_cdc_read(idx, buf, sizeof(buf))) > 0) {
+    _dev_stat[itf_info.daddr].bytes += count;
+  }
+}
+
+void tuh_cdc_mount_cb(uint8_t idx) {
+  tuh_itf_info_t itf_info = {0};
+  tuh_cdc_itf_get_info(idx, &itf_info);
+  _dev_stat[itf_info.daddr].cdc = 1;
+  printf("[cdc] addr %u: itf %u mounted\r\n", itf_info.daddr, itf_info.desc.bInterfaceNumber);
+}
+
+void tuh_cdc_umount_cb(uint8_t idx) {
+  tuh_itf_info_t itf_info = {0};
+  tuh_cdc_itf_get_info(idx, &itf_info);
+  _dev_stat[itf_info.daddr].cdc = 0;
+}
+#endif
+
+// Print per-device and aggregate throughput every REPORT_INTERVAL_MS
+static void report_task(void) {
+  static uint32_t start_ms = 0;
+  uint32_t const elapsed_ms = board_millis() - start_ms;
+  if (elapsed_ms < REPORT_INTERVAL_MS) {
+    return;
+  }
+  start_ms += elapsed_ms;
+
+  uint32_t total = 0;
+  uint8_t count = 0;
+  for (uint8_t daddr = 1; daddr < TU_ARRAY_SIZE(_dev_stat); daddr++) {
+    dev_stat_t* stat = &_dev_stat[daddr];
+    if (stat->msc || stat->cdc) {
+      printf("%s addr %u: %lu KB/s | ", stat->msc ? "msc" : "cdc", daddr,
+             (unsigned long) (stat->bytes / elapsed_ms)); // bytes per ms ~ KB/s
+      total += stat->bytes;
+      count++;
+    }
+    stat->bytes = 0;
+  }
+
+  if (count) {
+    printf("total %lu KB/s\r\n", (unsigned long) (total / elapsed_ms));
+  }
+}
+
+//--------------------------------------------------------------------+
+// TinyUSB Callbacks
+//--------------------------------------------------------------------+
+void tuh_mount_cb(uint8_t dev_addr) {
+  (void) dev_addr;
+}
+
+void tuh_umount_cb(uint8_t dev_addr) {
+  printf("A device with address %d is unmounted \r\n", dev_addr);
+  _dev_stat[dev_addr].bytes = 0;
+}
+
+//--------------------------------------------------------------------+
+// Blinking Task
+//--------------------------------------------------------------------+
+void led_blinking_task(void) {
+  const uint32_t interval_ms = 1000;
+  static uint32_t start_ms = 0;
+
+  static bool led_state = false;
+
+  // Blink every interval ms
+  if (board_millis() - start_ms < interval_ms) return; // not enough time
+  start_ms += interval_ms;
+
+  board_led_write(led_state);
+  led_state = 1 - led_state; // toggle
+}
@@ -51,7 +51,6 @@ static CLI_UINT cli_buffer[BYTES_TO_CLI_UINTS(CLI_BUFFER_SIZE)];
 
 //------------- Elm Chan FatFS -------------//
 static FATFS fatfs[CFG_TUH_DEVICE_MAX]; // for simplicity only support 1 LUN per device
-static volatile bool _disk_busy[CFG_TUH_DEVICE_MAX];
 
 static scsi_inquiry_resp_t inquiry_resp;
 
@@ -63,8 +62,6 @@ bool cli_init(void);
 
 bool msc_app_init(void)
 {
-  for(size_t i=0; i<CFG_TUH_DEVICE_MAX; i++) _disk_busy[i] = false;
-
   // disable stdout buffered for echoing typing command
   #ifndef __ICCARM__ // TODO IAR doesn't support stream control ?
   setbuf(stdout, NULL);
@@ -176,21 +173,6 @@ void tuh_msc_umount_cb(uint8_t dev_addr)
 // DiskIO
 //--------------------------------------------------------------------+
 
-static void wait_for_disk_io(BYTE pdrv)
-{
-  while(_disk_busy[pdrv])
-  {
-    tuh_task();
-  }
-}
-
-static bool disk_io_complete(uint8_t dev_addr, tuh_msc_complete_data_t const * cb_data)
-{
-  (void) dev_addr; (void) cb_data;
-  _disk_busy[dev_addr-1] = false;
-  return true;
-}
-
 DSTATUS disk_status (
 	BYTE pdrv		/* Physical drive nmuber to identify the drive */
 )
@@ -217,11 +199,7 @@ DRESULT disk_read (
 	uint8_t const dev_addr = pdrv + 1;
 	uint8_t const lun = 0;
 
-	_disk_busy[pdrv] = true;
-	tuh_msc_read10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
-
-	return RES_OK;
+	return tuh_msc_read10_sync(dev_addr, lun, buff, sector, (uint16_t) count) ? RES_OK : RES_ERROR;
 }
 
 #if FF_FS_READONLY == 0
@@ -236,11 +214,7 @@ DRESULT disk_write (
 	uint8_t const dev_addr = pdrv + 1;
 	uint8_t const lun = 0;
 
-	_disk_busy[pdrv] = true;
-	tuh_msc_write10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
-
-	return RES_OK;
+	return tuh_msc_write10_sync(dev_addr, lun, buff, sector, (uint16_t) count) ? RES_OK : RES_ERROR;
 }
 
 #endif
@@ -256,8 +230,13 @@ DRESULT disk_ioctl (
   switch ( cmd )
   {
     case CTRL_SYNC:
+#if CFG_TUH_MSC_CACHE_BLOCKS
+      // write back cached blocks
+      return tuh_msc_cache_flush_sync(dev_addr) ? RES_OK : RES_ERROR;
+#else
       // nothing to do since we do blocking
       return RES_OK;
+#endif
 
     case GET_SECTOR_COUNT:
       *((DWORD*) buff) = (WORD) tuh_msc_get_block_count(dev_addr, lun);
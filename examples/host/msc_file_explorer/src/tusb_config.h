@@ -113,6 +113,9 @@
 //------------- MSC -------------//
 #define CFG_TUH_MSC_MAXLUN    4 // typical for most card reader
 
+// blocking API used by FatFs diskio
+#define CFG_TUH_MSC_SYNC      1
+
 #ifdef __cplusplus
  }
 #endif
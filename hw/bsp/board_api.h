@@ -114,6 +114,16 @@ static inline uint32_t board_millis(void) {
   return (((uint64_t)rt_tick_get()) * 1000 / RT_TICK_PER_SECOND);
 }
 
+#elif CFG_TUSB_OS == OPT_OS_THREADX
+static inline uint32_t board_millis(void) {
+  return (uint32_t) (((uint64_t) tx_time_get()) * 1000 / TX_TIMER_TICKS_PER_SECOND);
+}
+
+#elif CFG_TUSB_OS == OPT_OS_ZEPHYR
+static inline uint32_t board_millis(void) {
+  return k_uptime_get_32();
+}
+
 #elif CFG_TUSB_OS == OPT_OS_CUSTOM
 // Implement your own board_millis() in any of .c file
 
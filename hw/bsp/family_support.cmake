@@ -203,6 +203,21 @@ function(family_configure_common TARGET RTOS)
   # Generate linker map file
   if (CMAKE_C_COMPILER_ID STREQUAL "GNU")
     target_link_options(${TARGET} PUBLIC "LINKER:-Map=$<TARGET_FILE:${TARGET}>.map")
+
+    # flash/RAM breakdown per component: cmake --build . --target <example>-size_report
+    # -DSIZE_BASELINE=<json> to compare against a previous report
+    find_package(Python3 COMPONENTS Interpreter QUIET)
+    if (Python3_FOUND)
+      set(SIZE_REPORT_ARGS --json $<TARGET_FILE:${TARGET}>-size.json)
+      if (DEFINED SIZE_BASELINE)
+        list(APPEND SIZE_REPORT_ARGS --baseline ${SIZE_BASELINE})
+      endif ()
+      add_custom_target(${TARGET}-size_report
+        COMMAND ${Python3_EXECUTABLE} ${TOP}/tools/size_report.py $<TARGET_FILE:${TARGET}>.map ${SIZE_REPORT_ARGS}
+        DEPENDS ${TARGET}
+        VERBATIM
+        )
+    endif ()
     if (CMAKE_C_COMPILER_VERSION VERSION_GREATER_EQUAL 12.0)
       target_link_options(${TARGET} PUBLIC "LINKER:--no-warn-rwx-segments")
     endif ()
@@ -253,9 +253,15 @@ void rndis_class_set_handler(uint8_t *data, int size)
         m->Status = RNDIS_STATUS_SUCCESS;
         m->DeviceFlags = RNDIS_DF_CONNECTIONLESS;
         m->Medium = RNDIS_MEDIUM_802_3;
+#if CFG_TUD_RNDIS_PACKETS_PER_XFER > 1
+        m->MaxPacketsPerTransfer = CFG_TUD_RNDIS_PACKETS_PER_XFER;
+        m->MaxTransferSize = TUD_RNDIS_XFER_SIZE;
+        m->PacketAlignmentFactor = 3; /* 2^3 = 8 bytes */
+#else
         m->MaxPacketsPerTransfer = 1;
         m->MaxTransferSize = CFG_TUD_NET_MTU + sizeof(rndis_data_packet_t);
         m->PacketAlignmentFactor = 0;
+#endif
         m->AfListOffset = 0;
         m->AfListSize = 0;
         rndis_state = rndis_initialized;
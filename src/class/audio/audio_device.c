@@ -86,7 +86,8 @@
     CFG_TUSB_MCU == OPT_MCU_LPC18XX   || \
     CFG_TUSB_MCU == OPT_MCU_LPC43XX   || \
     CFG_TUSB_MCU == OPT_MCU_MIMXRT1XXX    || \
-    CFG_TUSB_MCU == OPT_MCU_MSP432E4
+    CFG_TUSB_MCU == OPT_MCU_MSP432E4      || \
+    CFG_TUD_EDPT_XFER_FIFO_FALLBACK
   #if TUD_AUDIO_PREFER_RING_BUFFER
     #define  USE_LINEAR_BUFFER     0
   #else
@@ -124,21 +125,21 @@
 
 // EP IN software buffers and mutexes
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
-  #if CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
     IN_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_in_sw_buf_1[CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_in_ff_mutex_wr_1; // No need for read mutex as only USB driver reads from FIFO
     #endif
   #endif // CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ > 0
 
-  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
     IN_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_in_sw_buf_2[CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_in_ff_mutex_wr_2; // No need for read mutex as only USB driver reads from FIFO
     #endif
   #endif // CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ > 0
 
-  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
     IN_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_in_sw_buf_3[CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_in_ff_mutex_wr_3; // No need for read mutex as only USB driver reads from FIFO
@@ -150,36 +151,36 @@
 // - target MCU is not capable of handling a ring buffer FIFO e.g. no hardware buffer is available or driver is would need to be changed dramatically OR
 // - the software encoding is used - in this case the linear buffers serve as a target memory where logical channels are encoded into
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && (USE_LINEAR_BUFFER || CFG_TUD_AUDIO_ENABLE_ENCODING)
-  #if CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX > 0
+  #if CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_in_1[CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX];
   #endif
 
-  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX > 0
+  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_in_2[CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX];
   #endif
 
-  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX > 0
+  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_in_3[CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX];
   #endif
 #endif // CFG_TUD_AUDIO_ENABLE_EP_IN && (USE_LINEAR_BUFFER || CFG_TUD_AUDIO_ENABLE_DECODING)
 
 // EP OUT software buffers and mutexes
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
-  #if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
     OUT_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_out_sw_buf_1[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_out_ff_mutex_rd_1; // No need for write mutex as only USB driver writes into FIFO
     #endif
   #endif // CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ > 0
 
-  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
     OUT_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_out_sw_buf_2[CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_out_ff_mutex_rd_2; // No need for write mutex as only USB driver writes into FIFO
     #endif
   #endif // CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ > 0
 
-  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ > 0
+  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
     OUT_SW_BUF_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_ep_out_sw_buf_3[CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ];
     #if CFG_FIFO_MUTEX
     osal_mutex_def_t ep_out_ff_mutex_rd_3; // No need for write mutex as only USB driver writes into FIFO
@@ -191,19 +192,46 @@
 // - target MCU is not capable of handling a ring buffer FIFO e.g. no hardware buffer is available or driver is would need to be changed dramatically OR
 // - the software encoding is used - in this case the linear buffers serve as a target memory where logical channels are encoded into
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && (USE_LINEAR_BUFFER || CFG_TUD_AUDIO_ENABLE_DECODING)
-  #if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX > 0
+  #if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_out_1[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX];
   #endif
 
-  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX > 0
+  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_out_2[CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX];
   #endif
 
-  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX > 0
+  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
     CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t lin_buf_out_3[CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX];
   #endif
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT && (USE_LINEAR_BUFFER || CFG_TUD_AUDIO_ENABLE_DECODING)
 
+// EP buffer arenas - partitioned into EP FIFO and linear buffer by set interface for the active alternate setting
+#if CFG_TUD_AUDIO_ENABLE_EP_IN || CFG_TUD_AUDIO_ENABLE_EP_OUT
+  #if CFG_TUD_AUDIO_FUNC_1_ARENA_SZ > 0
+    CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_arena_1[CFG_TUD_AUDIO_FUNC_1_ARENA_SZ];
+    #if CFG_FIFO_MUTEX
+      osal_mutex_def_t arena_ff_mutex_wr_1;
+      osal_mutex_def_t arena_ff_mutex_rd_1;
+    #endif
+  #endif
+
+  #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ > 0
+    CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_arena_2[CFG_TUD_AUDIO_FUNC_2_ARENA_SZ];
+    #if CFG_FIFO_MUTEX
+      osal_mutex_def_t arena_ff_mutex_wr_2;
+      osal_mutex_def_t arena_ff_mutex_rd_2;
+    #endif
+  #endif
+
+  #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ > 0
+    CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t audio_arena_3[CFG_TUD_AUDIO_FUNC_3_ARENA_SZ];
+    #if CFG_FIFO_MUTEX
+      osal_mutex_def_t arena_ff_mutex_wr_3;
+      osal_mutex_def_t arena_ff_mutex_rd_3;
+    #endif
+  #endif
+#endif
+
 // Control buffers
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t ctrl_buf_1[CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ];
 
@@ -218,6 +246,15 @@ CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t ctrl_buf_3[CFG_TUD_AUDIO_FUNC_3_C
 // Active alternate setting of interfaces
 uint8_t alt_setting_1[CFG_TUD_AUDIO_FUNC_1_N_AS_INT];
 
+// Max number of AS interfaces of all functions, used to size per function lookup table
+#if CFG_TUD_AUDIO > 2
+  #define AUDIOD_N_AS_INT_MAX   TU_MAX(1, TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_AS_INT, TU_MAX(CFG_TUD_AUDIO_FUNC_2_N_AS_INT, CFG_TUD_AUDIO_FUNC_3_N_AS_INT)))
+#elif CFG_TUD_AUDIO > 1
+  #define AUDIOD_N_AS_INT_MAX   TU_MAX(1, TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_AS_INT, CFG_TUD_AUDIO_FUNC_2_N_AS_INT))
+#else
+  #define AUDIOD_N_AS_INT_MAX   TU_MAX(1, CFG_TUD_AUDIO_FUNC_1_N_AS_INT)
+#endif
+
 #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_N_AS_INT > 0
 uint8_t alt_setting_2[CFG_TUD_AUDIO_FUNC_2_N_AS_INT];
 #endif
@@ -279,20 +316,64 @@ uint8_t alt_setting_3[CFG_TUD_AUDIO_FUNC_3_N_AS_INT];
   #endif
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+// Sample format conversion between support FIFOs and EP
+typedef struct
+{
+  // Set by application
+  uint8_t ff_n_bytes;       // Sample size in support FIFOs, 0: same as EP i.e. no conversion
+  bool ff_float;            // Support FIFO samples are IEEE 754 single precision
+  bool dither;              // Apply TPDF dither when reducing resolution
+
+  // Selected by set interface for active alternate setting
+  bool active;              // Conversion is required
+  bool ep_float;            // EP samples are IEEE 754 single precision
+  uint8_t n_bits;           // Requantize to this resolution, 0: no requantization
+  uint32_t rand;            // Dither noise generator state
+} audiod_conv_t;
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+#define AUDIOD_RS_TAPS     8
+#define AUDIOD_RS_PHASES   32
+
+// Fractional resampler of RX stream, steered by fill level of support FIFOs
+typedef struct
+{
+  bool enabled;             // Set by application
+  bool active;              // Stream of current alternate setting is resampled
+  bool primed;              // Support FIFO was filled to half, level is tracked from then on
+  uint8_t n_hist;           // Number of valid history frames, output starts when history is full
+  int64_t pos;              // Position of next output frame after center tap in input frames, 32.32
+  int32_t step;             // Deviation of input step per output frame from 1, 0.32
+  int32_t integ;            // Integral part of level controller, 0.32
+  int32_t level;            // Filtered level error in frames, 24.8
+  int32_t hist[AUDIOD_RS_TAPS][CFG_TUD_AUDIO_RESAMPLER_CHANNELS_MAX]; // Last input frames, left justified
+} audiod_resampler_t;
+#endif
+
 typedef struct
 {
   uint8_t rhport;
   uint8_t const * p_desc;       // Pointer pointing to Standard AC Interface Descriptor(4.7.1) - Audio Control descriptor defining audio function
 
+  // Lookup tables built once in audiod_open() such that class requests and EP events resolve without walking descriptors
+  uint8_t itf_first;            // Interface number of AC interface, AS interfaces follow contiguously (see IAD)
+  uint8_t itf_count;            // Number of interfaces including AC interface
+  uint32_t ep_map;              // Streaming EPs: bit n for OUT EP n, bit 16+n for IN EP n
+  uint32_t entity_map[8];       // Entity IDs defined in class specific AC descriptors
+  uint16_t as_itf_ofs[AUDIOD_N_AS_INT_MAX]; // Offset from p_desc to alternate setting zero of AS interface (itf_first + 1 + idx), 0 if not found
+  uint8_t stream_dir;           // Streaming directions found in AS interfaces: bit 0 OUT data EP, bit 1 IN data EP
+
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
   uint8_t ep_in;                // TX audio data EP.
-  uint16_t ep_in_sz;            // Current size of TX EP
+  uint16_t ep_in_sz;            // Current size of TX EP, per (micro)frame including high-bandwidth transactions
   uint8_t ep_in_as_intf_num;    // Corresponding Standard AS Interface Descriptor (4.9.1) belonging to output terminal to which this EP belongs - 0 is invalid (this fits to UAC2 specification since AS interfaces can not have interface number equal to zero)
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
   uint8_t ep_out;               // Incoming (into uC) audio data EP.
-  uint16_t ep_out_sz;           // Current size of RX EP
+  uint16_t ep_out_sz;           // Current size of RX EP, per (micro)frame including high-bandwidth transactions
   uint8_t ep_out_as_intf_num;   // Corresponding Standard AS Interface Descriptor (4.9.1) belonging to input terminal to which this EP belongs - 0 is invalid (this fits to UAC2 specification since AS interfaces can not have interface number equal to zero)
 
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
@@ -303,6 +384,8 @@ typedef struct
 
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
   uint8_t ep_int_ctr;           // Audio control interrupt EP.
+  uint8_t int_ctr_rd;           // Index of oldest queued interrupt message
+  uint8_t int_ctr_count;        // Number of queued interrupt messages
 #endif
 
   /*------------- From this point, data is not cleared by bus reset -------------*/
@@ -313,8 +396,13 @@ typedef struct
   uint8_t * ctrl_buf;
   uint8_t ctrl_buf_sz;
 
+  // EP buffer arena, NULL if EP buffers are statically sized
+  uint8_t * arena;
+  uint16_t arena_sz;
+
   // Current active alternate settings
   uint8_t * alt_setting;   // We need to save the current alternate setting this way, because it is possible that there are AS interfaces which do not have an EP!
+  uint8_t n_as_itf;        // Number of AS interfaces i.e. size of alt_setting
 
   // EP Transfer buffers and FIFOs
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -340,12 +428,18 @@ typedef struct
         uint32_t mclk_freq;
       }fixed;
 
-#if 0 // implement later
       struct {
-        uint32_t nominal_value;
-        uint32_t threshold_bytes;
+        uint32_t nominal_value;   // 16.16
+        uint32_t kp;
+        uint32_t ki;
+        int32_t  correction_max;
+        int32_t  integral;        // accumulated level error in bytes
+        int32_t  correction;      // last correction
+        uint16_t target;
+        uint16_t level;
+        uint16_t level_min;
+        uint16_t level_max;
       }fifo_count;
-#endif
     }compute;
 
   } feedback;
@@ -360,6 +454,12 @@ typedef struct
   // Audio control interrupt buffer - no FIFO - 6 Bytes according to UAC 2 specification (p. 74)
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
   CFG_TUSB_MEM_ALIGN uint8_t ep_int_ctr_buf[CFG_TUD_AUDIO_INT_CTR_EP_IN_SW_BUFFER_SIZE];
+
+  // Messages waiting for the interrupt EP to become idle
+  uint8_t int_ctr_queue[CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH][CFG_TUD_AUDIO_INT_CTR_EP_IN_SW_BUFFER_SIZE];
+  uint8_t int_ctr_queue_len[CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH];
+  OSAL_MUTEX_DEF(int_ctr_mutex_def);
+  osal_mutex_t int_ctr_mutex;
 #endif
 
   // Decoding parameters - parameters are set when alternate AS interface is set by host
@@ -373,6 +473,12 @@ typedef struct
   uint8_t n_bytes_per_sampe_rx;
   uint8_t n_channels_per_ff_rx;
   uint8_t n_ff_used_rx;
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  audiod_conv_t conv_rx;
+#endif
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+  audiod_resampler_t rs_rx;
+#endif
 #endif
 #endif
 
@@ -393,6 +499,9 @@ typedef struct
   audio_data_format_type_I_t format_type_I_tx;
   uint8_t n_channels_per_ff_tx;
   uint8_t n_ff_used_tx;
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION && CFG_TUD_AUDIO_ENABLE_ENCODING
+  audiod_conv_t conv_tx;
+#endif
 #endif
 #endif
 
@@ -407,6 +516,8 @@ typedef struct
   tu_fifo_t * tx_supp_ff;
   uint8_t n_tx_supp_ff;
   uint16_t tx_supp_ff_sz_max;
+  uint8_t * tx_supp_ff_buf;     // Internal buffers of support FIFOs (n_tx_supp_ff x tx_supp_ff_sz_max)
+  uint8_t tx_supp_ff_app;       // Bit mask of support FIFOs running on an application owned buffer
 #endif
 
   // Linear buffer in case target MCU is not capable of handling a ring buffer FIFO e.g. no hardware buffer is available or driver is would need to be changed dramatically OR the support FIFOs are used
@@ -442,7 +553,28 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
-static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received);
+static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint8_t const* src_buf, uint16_t n_bytes_received);
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+#if CFG_TUD_AUDIO > 2
+  #define AUDIOD_EP_OUT_SZ_MAX  TU_MAX(CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX, TU_MAX(CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX, CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX))
+#elif CFG_TUD_AUDIO > 1
+  #define AUDIOD_EP_OUT_SZ_MAX  TU_MAX(CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX, CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX)
+#else
+  #define AUDIOD_EP_OUT_SZ_MAX  CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX
+#endif
+
+// Output of a packet is at most one frame longer per 1/MAX_PPM input frames plus one frame
+#define AUDIOD_RS_BUF_SZ   (AUDIOD_EP_OUT_SZ_MAX + AUDIOD_EP_OUT_SZ_MAX * CFG_TUD_AUDIO_RESAMPLER_MAX_PPM / 1000000 + \
+                            2 * 4 * CFG_TUD_AUDIO_RESAMPLER_CHANNELS_MAX)
+
+// Resampled packet, decoded into support FIFOs right after it is produced
+CFG_TUSB_MEM_ALIGN static uint8_t _audiod_rs_buf[AUDIOD_RS_BUF_SZ];
+
+static void audiod_resampler_reset(audiod_function_t* audio);
+static void audiod_resampler_track_level(audiod_function_t* audio);
+static uint16_t audiod_resample_rx(audiod_function_t* audio, uint16_t n_bytes_received);
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -456,13 +588,22 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 
-static bool audiod_get_AS_interface_index_global(uint8_t itf, uint8_t *func_id, uint8_t *idxItf, uint8_t const **pp_desc_int);
+static bool audiod_get_AS_interface_index_global(uint8_t rhport, uint8_t itf, uint8_t *func_id, uint8_t *idxItf, uint8_t const **pp_desc_int);
 static bool audiod_get_AS_interface_index(uint8_t itf, audiod_function_t * audio, uint8_t *idxItf, uint8_t const **pp_desc_int);
-static bool audiod_verify_entity_exists(uint8_t itf, uint8_t entityID, uint8_t *func_id);
-static bool audiod_verify_itf_exists(uint8_t itf, uint8_t *func_id);
-static bool audiod_verify_ep_exists(uint8_t ep, uint8_t *func_id);
+static bool audiod_verify_entity_exists(uint8_t rhport, uint8_t itf, uint8_t entityID, uint8_t *func_id);
+static bool audiod_verify_itf_exists(uint8_t rhport, uint8_t itf, uint8_t *func_id);
+static bool audiod_verify_ep_exists(uint8_t rhport, uint8_t ep, uint8_t *func_id);
+static bool audiod_build_lookup(audiod_function_t* audio);
 static uint8_t audiod_get_audio_fct_idx(audiod_function_t * audio);
 
+#if CFG_TUD_AUDIO_ENABLE_EP_IN || CFG_TUD_AUDIO_ENABLE_EP_OUT
+static bool audiod_arena_partition(audiod_function_t* audio, uint8_t dir);
+#endif
+
+#if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
+static bool audiod_int_ctr_xmit(audiod_function_t* audio);
+#endif
+
 #if (CFG_TUD_AUDIO_ENABLE_EP_IN && (CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL || CFG_TUD_AUDIO_ENABLE_ENCODING)) || (CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING)
 static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const * p_desc, uint8_t const * p_desc_end, uint8_t const as_itf);
 
@@ -479,6 +620,7 @@ static uint16_t audiod_tx_packet_size(const uint16_t* norminal_size, uint16_t da
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, uint32_t mclk_freq);
+static void set_fb_params_fifo_count(audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, audio_feedback_params_t const* fb_param);
 #endif
 
 bool tud_audio_n_mounted(uint8_t func_id)
@@ -535,6 +677,15 @@ tu_fifo_t* tud_audio_n_get_ep_out_ff(uint8_t func_id)
   return NULL;
 }
 
+#if CFG_TUSB_FIFO_STATS
+bool tud_audio_n_get_ep_out_ff_stats(uint8_t func_id, tu_fifo_stats_t* stats)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_stats_get(&_audiod_fct[func_id].ep_out_ff, stats);
+  return true;
+}
+#endif
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -562,6 +713,39 @@ tu_fifo_t* tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
   if(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff) return &_audiod_fct[func_id].rx_supp_ff[ff_idx];
   return NULL;
 }
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+bool tud_audio_n_set_rx_support_ff_format(uint8_t func_id, uint8_t n_bytes_per_sample, bool is_float, bool dither)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && n_bytes_per_sample <= 4 && (!is_float || n_bytes_per_sample == 4));
+  audiod_conv_t* conv = &_audiod_fct[func_id].conv_rx;
+
+  // Takes effect with next set interface
+  conv->ff_n_bytes = n_bytes_per_sample;
+  conv->ff_float   = is_float;
+  conv->dither     = dither;
+
+  return true;
+}
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+bool tud_audio_n_set_rx_resampler(uint8_t func_id, bool enable)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO);
+
+  // Takes effect with next set interface
+  _audiod_fct[func_id].rs_rx.enabled = enable;
+  return true;
+}
+
+int32_t tud_audio_n_get_rx_resampler_ppm(uint8_t func_id)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO, 0);
+  audiod_resampler_t const* rs = &_audiod_fct[func_id].rs_rx;
+  return rs->active ? rs->step / 4295 : 0;
+}
+#endif
 #endif
 
 // This function is called once an audio packet is received by the USB and is responsible for putting data from USB memory into EP_OUT_FIFO (or support FIFOs + decoding of received stream into audio channels).
@@ -602,7 +786,19 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
       switch (audio->format_type_I_rx)
       {
         case AUDIO_DATA_FORMAT_TYPE_I_PCM:
-          TU_VERIFY(audiod_decode_type_I_pcm(rhport, audio, n_bytes_received));
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+        case AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT:
+#endif
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+          if (audio->rs_rx.active)
+          {
+            uint16_t const n_bytes = audiod_resample_rx(audio, n_bytes_received);
+            TU_VERIFY(audiod_decode_type_I_pcm(rhport, audio, _audiod_rs_buf, n_bytes));
+            audiod_resampler_track_level(audio);
+            break;
+          }
+#endif
+          TU_VERIFY(audiod_decode_type_I_pcm(rhport, audio, audio->lin_buf_out, n_bytes_received));
           break;
 
         default:
@@ -649,70 +845,228 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 
 #endif //CFG_TUD_AUDIO_ENABLE_EP_OUT
 
-// The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0
-#if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
+#if (CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT) || (CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN)
+
+// Max number of support FIFOs of all functions, interleave kernels are only generated for FIFO counts that can occur
+#define AUDIOD_N_TX_SUPP_FF_MAX  TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO, TU_MAX(CFG_TUD_AUDIO_FUNC_2_N_TX_SUPP_SW_FIFO, CFG_TUD_AUDIO_FUNC_3_N_TX_SUPP_SW_FIFO))
+#define AUDIOD_N_RX_SUPP_FF_MAX  TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_RX_SUPP_SW_FIFO, TU_MAX(CFG_TUD_AUDIO_FUNC_2_N_RX_SUPP_SW_FIFO, CFG_TUD_AUDIO_FUNC_3_N_RX_SUPP_SW_FIFO))
+
+// Interleave kernel: copy slots (one sample of all channels in a support FIFO) between contiguous FIFO memory and
+// linear EP buffer, where slots of the n_ff used FIFOs alternate. A slot is n_unit words of 16 or 32 bit. Kernels
+// are always inlined with constant n_unit/n_ff from the dispatchers, so that compiler generates a specialized loop
+// for each format (unrolled, paired or multiple load/store) instead of one loop with runtime stride.
+#define AUDIOD_INTERLEAVE_KERNEL_DEF(_bits) \
+TU_ATTR_ALWAYS_INLINE static inline uint##_bits##_t * audiod_interleave##_bits(uint##_bits##_t * ff, uint##_bits##_t const * ff_end, \
+                                                                           uint##_bits##_t * lin, uint8_t const n_unit, \
+                                                                           uint8_t const n_ff, bool const encode) \
+{ \
+  if (n_ff == 1) \
+  { \
+    /* nothing to interleave */ \
+    size_t const nbytes = (size_t) ((uint8_t const *) ff_end - (uint8_t const *) ff); \
+    if (encode) memcpy(lin, ff, nbytes); \
+    else        memcpy(ff, lin, nbytes); \
+    return (uint##_bits##_t *) ((uint8_t *) lin + nbytes); \
+  } \
+  while (ff < ff_end) \
+  { \
+    for (uint8_t i = 0; i < n_unit; i++) \
+    { \
+      if (encode) *lin++ = *ff++; \
+      else        *ff++ = *lin++; \
+    } \
+    lin += n_unit * (n_ff - 1); \
+  } \
+  return lin; \
+}
 
-// Decoding according to 2.3.1.5 Audio Streams
+AUDIOD_INTERLEAVE_KERNEL_DEF(16)
+AUDIOD_INTERLEAVE_KERNEL_DEF(32)
 
-// Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+// Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
+TU_ATTR_ALWAYS_INLINE static inline void * audiod_interleave(uint16_t const nBytesPerSample, void * ff, const void * ff_end,
+                                                             void * lin, uint8_t const n_ff, bool const encode)
+{
+  switch (nBytesPerSample)
+  {
+    case 1:  return audiod_interleave16((uint16_t *) ff, (uint16_t const *) ff_end, (uint16_t *) lin, 1, n_ff, encode);
+    case 2:  return audiod_interleave32((uint32_t *) ff, (uint32_t const *) ff_end, (uint32_t *) lin, 1, n_ff, encode);
+    case 3:  return audiod_interleave16((uint16_t *) ff, (uint16_t const *) ff_end, (uint16_t *) lin, 3, n_ff, encode);
+    default: return audiod_interleave32((uint32_t *) ff, (uint32_t const *) ff_end, (uint32_t *) lin, 2, n_ff, encode);
+  }
+}
+
+// Convert number of bytes between support FIFO and EP sample size
+TU_ATTR_ALWAYS_INLINE static inline uint16_t audiod_conv_n_bytes(uint16_t n_bytes, uint8_t from_sample_sz, uint8_t to_sample_sz)
+{
+  if (from_sample_sz == to_sample_sz) return n_bytes;
+  return (uint16_t) ((n_bytes / from_sample_sz) * to_sample_sz);
+}
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+
+// Select conversion for active alternate setting, called from audiod_parse_for_AS_params()
+static void audiod_conv_select(audiod_conv_t* conv, uint8_t ep_n_bytes, uint8_t ep_n_bits, bool ep_float, bool encode)
 {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t * dst16 = dst;
-  uint16_t * src16 = src;
-  const uint16_t * dst_end16 = dst_end;
-  uint32_t * dst32 = dst;
-  uint32_t * src32 = src;
-  const uint32_t * dst_end32 = dst_end;
+  conv->ep_float = ep_float;
+  conv->active   = (conv->ff_n_bytes != 0) && (conv->ff_n_bytes != ep_n_bytes || conv->ff_float != ep_float);
+  conv->n_bits   = 0;
+
+  if (!conv->active) return;
+
+  // Requantize only if destination has less resolution than source, float destination takes everything
+  if (ep_n_bits == 0 || ep_n_bits > 8*ep_n_bytes) ep_n_bits = (uint8_t) (8*ep_n_bytes);
+  uint8_t const ff_bits  = (uint8_t) (conv->ff_float ? 32 : 8*conv->ff_n_bytes);
+  uint8_t const ep_bits  = (uint8_t) (ep_float ? 32 : ep_n_bits);
+  uint8_t const src_bits = encode ? ff_bits : ep_bits;
+  uint8_t const dst_bits = encode ? ep_bits : ff_bits;
+  bool const dst_float   = encode ? ep_float : conv->ff_float;
+
+  if (!dst_float && dst_bits < src_bits) conv->n_bits = dst_bits;
+  if (conv->rand == 0) conv->rand = 0x12345678u;
+}
 
-  if (nBytesPerSample == 1)
+// Read sample as 32-bit left-justified integer
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_conv_get(uint8_t const * p, uint8_t n_bytes, bool is_float)
+{
+  if (is_float)
   {
-    while(dst16 < dst_end16)
-    {
-      *dst16++ = *src16++;
-      src16 += n_ff_used - 1;
-    }
-    return src16;
+    float f;
+    memcpy(&f, p, 4);
+    if (f >=  1.0f) return INT32_MAX;
+    if (f <= -1.0f) return INT32_MIN;
+    return (int32_t) (f * 2147483648.0f);
   }
-  else if (nBytesPerSample == 2)
+
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < n_bytes; i++) v |= ((uint32_t) p[i]) << (8*(4 - n_bytes + i));
+  return (int32_t) v;
+}
+
+// Write 32-bit left-justified integer sample, lower bytes are truncated
+TU_ATTR_ALWAYS_INLINE static inline void audiod_conv_put(uint8_t * p, int32_t v, uint8_t n_bytes, bool is_float)
+{
+  if (is_float)
   {
-    while(dst32 < dst_end32)
-    {
-      *dst32++ = *src32++;
-      src32 += n_ff_used - 1;
-    }
-    return src32;
+    float const f = (float) v * (1.0f / 2147483648.0f);
+    memcpy(p, &f, 4);
+    return;
   }
-  else if (nBytesPerSample == 3)
+
+  for (uint8_t i = 0; i < n_bytes; i++) p[i] = (uint8_t) (((uint32_t) v) >> (8*(4 - n_bytes + i)));
+}
+
+// Reduce resolution to n_bits by truncation, or with dither: add triangular noise of +-1 LSB and round
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_conv_requantize(audiod_conv_t* conv, int32_t v)
+{
+  if (conv->n_bits == 0) return v;
+
+  uint32_t const lsb_mask = TU_BIT(32 - conv->n_bits) - 1;
+
+  if (conv->dither)
   {
-    while(dst16 < dst_end16)
-    {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      src16 += 3 * (n_ff_used - 1);
-    }
-    return src16;
+    // xorshift32, two uniform values summed up give triangular distribution
+    uint32_t r = conv->rand;
+    r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+    uint32_t const r1 = r & lsb_mask;
+    r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+    uint32_t const r2 = r & lsb_mask;
+    conv->rand = r;
+
+    // Zero mean noise plus half LSB such that truncation below rounds
+    int64_t const d = (int64_t) v + (int64_t) r1 + (int64_t) r2 - (int64_t) lsb_mask + (int64_t) ((lsb_mask + 1) >> 1);
+    if      (d > INT32_MAX) v = INT32_MAX;
+    else if (d < INT32_MIN) v = INT32_MIN;
+    else                    v = (int32_t) d;
   }
-  else // nBytesPerSample == 4
+
+  return (int32_t) (((uint32_t) v) & ~lsb_mask);
+}
+
+// Convert and (de)interleave one support FIFO from/into linear EP buffer, sample by sample. Used in place of the
+// interleave kernels if support FIFO and EP sample format differ, such that conversion needs no additional pass.
+static uint8_t * audiod_conv_interleave(audiod_conv_t* conv, uint8_t * ff, uint8_t const * ff_end, uint8_t * lin,
+                                        uint8_t ep_n_bytes, uint8_t n_ch_per_ff, uint8_t n_ff, bool encode)
+{
+  uint8_t const ff_n_bytes = conv->ff_n_bytes;
+  uint16_t const lin_skip  = (uint16_t) ((n_ff - 1) * n_ch_per_ff * ep_n_bytes);
+
+  while (ff < ff_end)
   {
-    while(dst32 < dst_end32)
+    for (uint8_t ch = 0; ch < n_ch_per_ff; ch++)
     {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      src32 += 2 * (n_ff_used - 1);
+      if (encode)
+      {
+        int32_t const v = audiod_conv_requantize(conv, audiod_conv_get(ff, ff_n_bytes, conv->ff_float));
+        audiod_conv_put(lin, v, ep_n_bytes, conv->ep_float);
+      }
+      else
+      {
+        int32_t const v = audiod_conv_requantize(conv, audiod_conv_get(lin, ep_n_bytes, conv->ep_float));
+        audiod_conv_put(ff, v, ff_n_bytes, conv->ff_float);
+      }
+      ff  += ff_n_bytes;
+      lin += ep_n_bytes;
     }
-    return src32;
+    lin += lin_skip;
   }
+
+  return lin;
 }
 
-static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received)
+#endif // CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+
+#endif
+
+// The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0
+#if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
+
+// Decoding according to 2.3.1.5 Audio Streams
+
+// Sample size in RX support FIFOs
+TU_ATTR_ALWAYS_INLINE static inline uint8_t audiod_rx_ff_n_bytes(audiod_function_t const * audio)
+{
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  if (audio->conv_rx.active) return audio->conv_rx.ff_n_bytes;
+#endif
+  return audio->n_bytes_per_sampe_rx;
+}
+
+// Helper function
+static inline void * audiod_interleaved_copy_bytes_fast_decode(audiod_function_t* audio, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+{
+  uint16_t const nBytesPerSample = audio->n_bytes_per_sampe_rx;
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  if (audio->conv_rx.active)
+  {
+    // Conversion is fused into de-interleaving
+    return audiod_conv_interleave(&audio->conv_rx, (uint8_t *) dst, (uint8_t const *) dst_end, (uint8_t *) src,
+                                  audio->n_bytes_per_sampe_rx, audio->n_channels_per_ff_rx, n_ff_used, false);
+  }
+#endif
+
+  // Specialized for common number of used FIFOs, generic loop otherwise
+  switch (n_ff_used)
+  {
+    case 1: return audiod_interleave(nBytesPerSample, dst, dst_end, src, 1, false);
+#if AUDIOD_N_RX_SUPP_FF_MAX >= 2
+    case 2: return audiod_interleave(nBytesPerSample, dst, dst_end, src, 2, false);
+#endif
+#if AUDIOD_N_RX_SUPP_FF_MAX >= 4
+    case 4: return audiod_interleave(nBytesPerSample, dst, dst_end, src, 4, false);
+#endif
+    default: return audiod_interleave(nBytesPerSample, dst, dst_end, src, n_ff_used, false);
+  }
+}
+
+static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint8_t const* src_buf, uint16_t n_bytes_received)
 {
   (void) rhport;
 
   // Determine amount of samples
   uint8_t const n_ff_used               = audio->n_ff_used_rx;
-  uint16_t const nBytesPerFFToRead      = n_bytes_received / n_ff_used;
+  uint16_t const nBytesPerFFToRead      = audiod_conv_n_bytes(n_bytes_received / n_ff_used, audio->n_bytes_per_sampe_rx, audiod_rx_ff_n_bytes(audio));
   uint8_t cnt_ff;
 
   // Decode
@@ -728,16 +1082,16 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
     if (info.len_lin != 0)
     {
       info.len_lin = tu_min16(nBytesPerFFToRead, info.len_lin);
-      src = &audio->lin_buf_out[cnt_ff*audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx];
+      src = (uint8_t *) (uintptr_t) &src_buf[cnt_ff*audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx];
       dst_end = info.ptr_lin + info.len_lin;
-      src = audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_lin, dst_end, src, n_ff_used);
+      src = audiod_interleaved_copy_bytes_fast_decode(audio, info.ptr_lin, dst_end, src, n_ff_used);
 
       // Handle wrapped part of FIFO
       info.len_wrap = tu_min16(nBytesPerFFToRead - info.len_lin, info.len_wrap);
       if (info.len_wrap != 0)
       {
         dst_end = info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_wrap, dst_end, src, n_ff_used);
+        audiod_interleaved_copy_bytes_fast_decode(audio, info.ptr_wrap, dst_end, src, n_ff_used);
       }
       tu_fifo_advance_write_pointer(&audio->rx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
     }
@@ -748,6 +1102,161 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 
   return true;
 }
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+
+// Windowed sinc (Kaiser, beta 6) fractional delay kernel, row p interpolates at p/32 after center tap 3. Rows sum to 1.0 in 2.14
+static const int16_t _audiod_rs_kernel[AUDIOD_RS_PHASES][AUDIOD_RS_TAPS] =
+{
+  {      0,      0,      0,  16384,      0,      0,      0,      0 },
+  {    -26,    119,   -412,  16356,    448,   -128,     29,     -2 },
+  {    -50,    227,   -787,  16271,    932,   -266,     62,     -5 },
+  {    -69,    324,  -1124,  16127,   1449,   -412,     97,     -8 },
+  {    -86,    410,  -1423,  15927,   1998,   -564,    135,    -13 },
+  {   -100,    485,  -1684,  15670,   2577,   -723,    176,    -17 },
+  {   -111,    548,  -1908,  15364,   3182,   -886,    218,    -23 },
+  {   -119,    600,  -2094,  15003,   3812,  -1051,    262,    -29 },
+  {   -124,    641,  -2244,  14593,   4463,  -1218,    308,    -35 },
+  {   -127,    672,  -2360,  14141,   5131,  -1383,    353,    -43 },
+  {   -128,    692,  -2442,  13644,   5814,  -1545,    399,    -50 },
+  {   -127,    703,  -2492,  13110,   6507,  -1703,    445,    -59 },
+  {   -124,    705,  -2512,  12539,   7207,  -1853,    489,    -67 },
+  {   -120,    699,  -2505,  11939,   7909,  -1994,    531,    -75 },
+  {   -114,    685,  -2471,  11310,   8610,  -2122,    570,    -84 },
+  {   -108,    664,  -2414,  10660,   9305,  -2237,    606,    -92 },
+  {   -100,    638,  -2335,   9989,   9989,  -2335,    638,   -100 },
+  {    -92,    606,  -2237,   9305,  10660,  -2414,    664,   -108 },
+  {    -84,    570,  -2122,   8610,  11310,  -2471,    685,   -114 },
+  {    -75,    531,  -1994,   7909,  11939,  -2505,    699,   -120 },
+  {    -67,    489,  -1853,   7207,  12539,  -2512,    705,   -124 },
+  {    -59,    445,  -1703,   6507,  13110,  -2492,    703,   -127 },
+  {    -50,    399,  -1545,   5814,  13644,  -2442,    692,   -128 },
+  {    -43,    353,  -1383,   5131,  14141,  -2360,    672,   -127 },
+  {    -35,    308,  -1218,   4463,  14593,  -2244,    641,   -124 },
+  {    -29,    262,  -1051,   3812,  15003,  -2094,    600,   -119 },
+  {    -23,    218,   -886,   3182,  15364,  -1908,    548,   -111 },
+  {    -17,    176,   -723,   2577,  15670,  -1684,    485,   -100 },
+  {    -13,    135,   -564,   1998,  15927,  -1423,    410,    -86 },
+  {     -8,     97,   -412,   1449,  16127,  -1124,    324,    -69 },
+  {     -5,     62,   -266,    932,  16271,   -787,    227,    -50 },
+  {     -2,     29,   -128,    448,  16356,   -412,    119,    -26 },
+};
+
+// Ratio limit in 0.32
+#define AUDIOD_RS_STEP_MAX   ((int32_t) (4295 * CFG_TUD_AUDIO_RESAMPLER_MAX_PPM))
+
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_rs_clamp(int32_t v)
+{
+  return (v > AUDIOD_RS_STEP_MAX) ? AUDIOD_RS_STEP_MAX : ((v < -AUDIOD_RS_STEP_MAX) ? -AUDIOD_RS_STEP_MAX : v);
+}
+
+static void audiod_resampler_reset(audiod_function_t* audio)
+{
+  audiod_resampler_t* rs = &audio->rs_rx;
+
+  rs->active = rs->enabled && audio->format_type_I_rx == AUDIO_DATA_FORMAT_TYPE_I_PCM &&
+               audio->n_channels_rx <= CFG_TUD_AUDIO_RESAMPLER_CHANNELS_MAX;
+#if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  // Asynchronous stream is rate matched by feedback
+  if (audio->ep_fb != 0) rs->active = false;
+#endif
+
+  rs->primed = false;
+  rs->n_hist = 0;
+  rs->pos    = 0;
+  rs->step   = 0;
+  rs->integ  = 0;
+  rs->level  = 0;
+}
+
+// Steer ratio with a PI controller on the filtered distance of support FIFO level from half full, measured after
+// a packet is written
+static void audiod_resampler_track_level(audiod_function_t* audio)
+{
+  audiod_resampler_t* rs = &audio->rs_rx;
+  tu_fifo_t* ff = &audio->rx_supp_ff[0];
+  uint16_t const frame_sz = (uint16_t) (audiod_rx_ff_n_bytes(audio) * audio->n_channels_per_ff_rx);
+
+  int32_t const err = ((int32_t) tu_fifo_count(ff) - (int32_t) (ff->depth / 2u)) / frame_sz;
+
+  // Initial fill of FIFO is no clock drift
+  if (!rs->primed)
+  {
+    if (err < 0) return;
+    rs->primed = true;
+  }
+
+  rs->level += ((err * 256) - rs->level) / 16;
+
+  // ~8 ppm per frame of error, integral settles a drift of several hundred ppm within a few hundred packets
+  rs->integ = audiod_rs_clamp(rs->integ + rs->level / 4);
+  rs->step  = audiod_rs_clamp(rs->integ + rs->level * 128);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_rs_load(uint8_t const * src, uint8_t n_bytes)
+{
+  uint32_t v = 0;
+  for (uint8_t b = 0; b < n_bytes; b++) v |= (uint32_t) src[b] << (8u * (4u - n_bytes + b));
+  return (int32_t) v;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void audiod_rs_store(uint8_t * dst, int32_t v, uint8_t n_bytes)
+{
+  uint32_t const u = (uint32_t) v;
+  for (uint8_t b = 0; b < n_bytes; b++) dst[b] = (uint8_t) (u >> (8u * (4u - n_bytes + b)));
+}
+
+// Resample received packet from linear buffer into _audiod_rs_buf, return number of bytes produced
+static uint16_t audiod_resample_rx(audiod_function_t* audio, uint16_t n_bytes_received)
+{
+  audiod_resampler_t* rs = &audio->rs_rx;
+  uint8_t const n_bytes = audio->n_bytes_per_sampe_rx;
+  uint8_t const n_ch = audio->n_channels_rx;
+  uint16_t const frame_sz = (uint16_t) (n_bytes * n_ch);
+  uint16_t const n_frames = n_bytes_received / frame_sz;
+  uint8_t const * src = audio->lin_buf_out;
+  uint8_t * dst = _audiod_rs_buf;
+  uint8_t const * dst_end = _audiod_rs_buf + sizeof(_audiod_rs_buf) - frame_sz;
+
+  // Input step per output frame is 1 + step
+  int64_t const step = ((int64_t) 1 << 32) + rs->step;
+
+  for (uint16_t i = 0; i < n_frames; i++, src += frame_sz)
+  {
+    memmove(&rs->hist[0], &rs->hist[1], sizeof(rs->hist[0]) * (AUDIOD_RS_TAPS - 1));
+    for (uint8_t ch = 0; ch < n_ch; ch++) rs->hist[AUDIOD_RS_TAPS - 1][ch] = audiod_rs_load(src + ch * n_bytes, n_bytes);
+
+    if (rs->n_hist < AUDIOD_RS_TAPS)
+    {
+      rs->n_hist++;
+      continue;
+    }
+
+    // Emit output frames located between center tap and the one after it. Multiply-accumulate maps to SMLAL on Cortex-M4/M7
+    while (rs->pos < ((int64_t) 1 << 32) && dst <= dst_end)
+    {
+      int16_t const * h = _audiod_rs_kernel[(uint32_t) rs->pos >> 27];
+      for (uint8_t ch = 0; ch < n_ch; ch++)
+      {
+        int64_t acc = 0;
+        for (uint8_t k = 0; k < AUDIOD_RS_TAPS; k++) acc += (int64_t) h[k] * rs->hist[k][ch];
+        acc >>= 14;
+        if (acc > INT32_MAX) acc = INT32_MAX;
+        if (acc < INT32_MIN) acc = INT32_MIN;
+        audiod_rs_store(dst + ch * n_bytes, (int32_t) acc, n_bytes);
+      }
+      dst += frame_sz;
+      rs->pos += step;
+    }
+
+    // Next input frame becomes center tap, output is dropped if buffer is full
+    rs->pos -= (int64_t) 1 << 32;
+    if (rs->pos < 0) rs->pos = 0;
+  }
+
+  return (uint16_t) (dst - _audiod_rs_buf);
+}
+#endif
 #endif //CFG_TUD_AUDIO_ENABLE_DECODING
 
 //--------------------------------------------------------------------+
@@ -785,6 +1294,15 @@ tu_fifo_t* tud_audio_n_get_ep_in_ff(uint8_t func_id)
   return NULL;
 }
 
+#if CFG_TUSB_FIFO_STATS
+bool tud_audio_n_get_ep_in_ff_stats(uint8_t func_id, tu_fifo_stats_t* stats)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_stats_get(&_audiod_fct[func_id].ep_in_ff, stats);
+  return true;
+}
+#endif
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -822,27 +1340,128 @@ tu_fifo_t* tud_audio_n_get_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
   return NULL;
 }
 
+bool tud_audio_n_set_tx_support_ff_buffer(uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t depth)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && ff_idx < _audiod_fct[func_id].n_tx_supp_ff && ff_idx < 8);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  tu_fifo_t* ff = &audio->tx_supp_ff[ff_idx];
+
+  if ( buffer == NULL )
+  {
+    // Revert to internal buffer, depth is adjusted to the sample format with next set interface
+    audio->tx_supp_ff_app = (uint8_t) tu_bit_clear(audio->tx_supp_ff_app, ff_idx);
+    return tu_fifo_config(ff, audio->tx_supp_ff_buf + ff_idx * audio->tx_supp_ff_sz_max, audio->tx_supp_ff_sz_max, 1, true);
+  }
+
+  TU_VERIFY(depth > 0);
+  TU_VERIFY(tu_fifo_config(ff, buffer, depth, 1, true));
+  audio->tx_supp_ff_app = (uint8_t) tu_bit_set(audio->tx_supp_ff_app, ff_idx);
+
+  return true;
+}
+
+uint16_t tud_audio_n_set_tx_support_ff_wr_pos(uint8_t func_id, uint8_t ff_idx, uint16_t wr_pos)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_tx_supp_ff);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  tu_fifo_t* ff = &audio->tx_supp_ff[ff_idx];
+
+  TU_VERIFY(tu_bit_test(audio->tx_supp_ff_app, ff_idx) && wr_pos < ff->depth);
+
+  // Number of bytes the producer (e.g. I2S DMA) wrote since last update. It may have lapped the reader once,
+  // which is caught by the overflow correction of the read side in audiod_encode_type_I_pcm()
+  uint16_t const cur_pos = (uint16_t) (ff->wr_idx % ff->depth);
+  uint16_t const n = (uint16_t) ((wr_pos >= cur_pos) ? (wr_pos - cur_pos) : (ff->depth - cur_pos + wr_pos));
+
+  if ( n ) tu_fifo_advance_write_pointer(ff, n);
+
+  return n;
+}
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+bool tud_audio_n_set_tx_support_ff_format(uint8_t func_id, uint8_t n_bytes_per_sample, bool is_float, bool dither)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && n_bytes_per_sample <= 4 && (!is_float || n_bytes_per_sample == 4));
+  audiod_conv_t* conv = &_audiod_fct[func_id].conv_tx;
+
+  // Takes effect with next set interface
+  conv->ff_n_bytes = n_bytes_per_sample;
+  conv->ff_float   = is_float;
+  conv->dither     = dither;
+
+  return true;
+}
+#endif
+
 #endif
 
 
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
 
-// If no interrupt transmit is pending bytes get written into buffer and a transmit is scheduled - once transmit completed tud_audio_int_ctr_done_cb() is called in inform user
+// Message gets queued and transmitted as soon as the interrupt EP is idle - once transmit completed tud_audio_int_ctr_done_cb() is called to inform user.
+// A message identical to one still waiting in the queue is dropped since the host reads the current value of the control anyway.
 uint16_t tud_audio_int_ctr_n_write(uint8_t func_id, uint8_t const* buffer, uint16_t len)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  TU_VERIFY(len > 0 && len <= CFG_TUD_AUDIO_INT_CTR_EP_IN_SW_BUFFER_SIZE);
 
-  // We write directly into the EP's buffer - abort if previous transfer not complete
-  TU_VERIFY(!usbd_edpt_busy(_audiod_fct[func_id].rhport, _audiod_fct[func_id].ep_int_ctr));
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  bool queued = false;
 
-  TU_VERIFY(tu_memcpy_s(_audiod_fct[func_id].ep_int_ctr_buf, CFG_TUD_AUDIO_INT_CTR_EP_IN_SW_BUFFER_SIZE,  buffer, len)==0);
+  (void) osal_mutex_lock(audio->int_ctr_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
 
-  // Schedule transmit
-  TU_VERIFY(usbd_edpt_xfer(_audiod_fct[func_id].rhport, _audiod_fct[func_id].ep_int_ctr, _audiod_fct[func_id].ep_int_ctr_buf, len));
+  // Coalesce with pending message
+  for (uint8_t cnt = 0; cnt < audio->int_ctr_count && !queued; cnt++)
+  {
+    uint8_t const idx = (uint8_t) ((audio->int_ctr_rd + cnt) % CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH);
+    queued = (audio->int_ctr_queue_len[idx] == len) && (0 == memcmp(audio->int_ctr_queue[idx], buffer, len));
+  }
+
+  if (!queued && audio->int_ctr_count < CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH)
+  {
+    uint8_t const idx = (uint8_t) ((audio->int_ctr_rd + audio->int_ctr_count) % CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH);
+    memcpy(audio->int_ctr_queue[idx], buffer, len);
+    audio->int_ctr_queue_len[idx] = (uint8_t) len;
+    audio->int_ctr_count++;
+    queued = true;
+  }
+
+  (void) osal_mutex_unlock(audio->int_ctr_mutex);
+
+  TU_VERIFY(queued);
+  TU_VERIFY(audiod_int_ctr_xmit(audio));
 
   return true;
 }
 
+// Transmit oldest queued interrupt message if the interrupt EP is idle
+static bool audiod_int_ctr_xmit(audiod_function_t* audio)
+{
+  bool ret = true;
+
+  (void) osal_mutex_lock(audio->int_ctr_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  if (audio->int_ctr_count > 0 && usbd_edpt_claim(audio->rhport, audio->ep_int_ctr))
+  {
+    uint8_t const idx = audio->int_ctr_rd;
+    uint16_t const len = audio->int_ctr_queue_len[idx];
+
+    memcpy(audio->ep_int_ctr_buf, audio->int_ctr_queue[idx], len);
+    audio->int_ctr_rd = (uint8_t) ((idx + 1) % CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH);
+    audio->int_ctr_count--;
+
+    if (!usbd_edpt_xfer(audio->rhport, audio->ep_int_ctr, audio->ep_int_ctr_buf, len))
+    {
+      usbd_edpt_release(audio->rhport, audio->ep_int_ctr);
+      ret = false;
+    }
+  }
+
+  (void) osal_mutex_unlock(audio->int_ctr_mutex);
+
+  return ret;
+}
+
 #endif
 
 // This function is called once a transmit of an audio packet was successfully completed. Here, we encode samples and place it in IN EP's buffer for next transmission.
@@ -884,7 +1503,9 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
       switch (audio->format_type_I_tx)
       {
         case AUDIO_DATA_FORMAT_TYPE_I_PCM:
-
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+        case AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT:
+#endif
           n_bytes_tx = audiod_encode_type_I_pcm(rhport, audio);
           break;
 
@@ -951,55 +1572,40 @@ range [-1, +1)
  * does not change the number of bytes per sample.
  * */
 
+// Sample size in TX support FIFOs
+TU_ATTR_ALWAYS_INLINE static inline uint8_t audiod_tx_ff_n_bytes(audiod_function_t const * audio)
+{
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  if (audio->conv_tx.active) return audio->conv_tx.ff_n_bytes;
+#endif
+  return audio->n_bytes_per_sampe_tx;
+}
+
 // Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+static inline void * audiod_interleaved_copy_bytes_fast_encode(audiod_function_t* audio, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
 {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t * dst16 = dst;
-  uint16_t * src16 = src;
-  const uint16_t * src_end16 = src_end;
-  uint32_t * dst32 = dst;
-  uint32_t * src32 = src;
-  const uint32_t * src_end32 = src_end;
+  uint16_t const nBytesPerSample = audio->n_bytes_per_sampe_tx;
 
-  if (nBytesPerSample == 1)
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  if (audio->conv_tx.active)
   {
-    while(src16 < src_end16)
-    {
-      *dst16++ = *src16++;
-      dst16 += n_ff_used - 1;
-    }
-    return dst16;
+    // Conversion is fused into interleaving
+    return audiod_conv_interleave(&audio->conv_tx, (uint8_t *) src, (uint8_t const *) src_end, (uint8_t *) dst,
+                                  audio->n_bytes_per_sampe_tx, audio->n_channels_per_ff_tx, n_ff_used, true);
   }
-  else if (nBytesPerSample == 2)
-  {
-    while(src32 < src_end32)
-    {
-      *dst32++ = *src32++;
-      dst32 += n_ff_used - 1;
-    }
-    return dst32;
-  }
-  else if (nBytesPerSample == 3)
-  {
-    while(src16 < src_end16)
-    {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      dst16 += 3 * (n_ff_used - 1);
-    }
-    return dst16;
-  }
-  else // nBytesPerSample == 4
+#endif
+
+  // Specialized for common number of used FIFOs, generic loop otherwise
+  switch (n_ff_used)
   {
-    while(src32 < src_end32)
-    {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      dst32 += 2 * (n_ff_used - 1);
-    }
-    return dst32;
+    case 1: return audiod_interleave(nBytesPerSample, src, src_end, dst, 1, true);
+#if AUDIOD_N_TX_SUPP_FF_MAX >= 2
+    case 2: return audiod_interleave(nBytesPerSample, src, src_end, dst, 2, true);
+#endif
+#if AUDIOD_N_TX_SUPP_FF_MAX >= 4
+    case 4: return audiod_interleave(nBytesPerSample, src, src_end, dst, 4, true);
+#endif
+    default: return audiod_interleave(nBytesPerSample, src, src_end, dst, n_ff_used, true);
   }
 }
 
@@ -1011,8 +1617,10 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   // We encode directly into IN EP's linear buffer - abort if previous transfer not complete
   TU_VERIFY(!usbd_edpt_busy(rhport, audio->ep_in));
 
-  // Determine amount of samples
+  // Determine amount of samples, support FIFO and EP sample size differ if samples are converted
   uint8_t const n_ff_used               = audio->n_ff_used_tx;
+  uint8_t const n_bytes_ff              = audiod_tx_ff_n_bytes(audio);
+  uint8_t const n_bytes_ep              = audio->n_bytes_per_sampe_tx;
   uint16_t nBytesPerFFToSend            = tu_fifo_count(&audio->tx_supp_ff[0]);
   uint8_t cnt_ff;
 
@@ -1030,16 +1638,18 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
                                          audio->packet_sz_tx[1] / n_ff_used,
                                          audio->packet_sz_tx[2] / n_ff_used};
   // packet_sz_tx is based on total packet size, here we want size for each support buffer.
-  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, audio->tx_supp_ff[0].depth, audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, audiod_conv_n_bytes(nBytesPerFFToSend, n_bytes_ff, n_bytes_ep),
+                                            audiod_conv_n_bytes(audio->tx_supp_ff[0].depth, n_bytes_ff, n_bytes_ep), audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = audiod_conv_n_bytes(nBytesPerFFToSend, n_bytes_ep, n_bytes_ff);
   // Check if there is enough data
   if (nBytesPerFFToSend == 0)    return 0;
 #else
   // Check if there is enough data
   if (nBytesPerFFToSend == 0)    return 0;
   // Limit to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
-  nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, audiod_conv_n_bytes(audio->ep_in_sz / n_ff_used, n_bytes_ep, n_bytes_ff));
   // Round to full number of samples (flooring)
-  uint16_t const nSlotSize = audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx;
+  uint16_t const nSlotSize = audio->n_channels_per_ff_tx * n_bytes_ff;
   nBytesPerFFToSend = (nBytesPerFFToSend / nSlotSize) * nSlotSize;
 #endif
 
@@ -1059,7 +1669,7 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
     {
       info.len_lin = tu_min16(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
       src_end = (uint8_t *)info.ptr_lin + info.len_lin;
-      dst = audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_lin, src_end, dst, n_ff_used);
+      dst = audiod_interleaved_copy_bytes_fast_encode(audio, info.ptr_lin, src_end, dst, n_ff_used);
 
       // Limit up to desired length
       info.len_wrap = tu_min16(nBytesPerFFToSend - info.len_lin, info.len_wrap);
@@ -1068,14 +1678,14 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
       if (info.len_wrap != 0)
       {
         src_end = (uint8_t *)info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_wrap, src_end, dst, n_ff_used);
+        audiod_interleaved_copy_bytes_fast_encode(audio, info.ptr_wrap, src_end, dst, n_ff_used);
       }
 
       tu_fifo_advance_read_pointer(&audio->tx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
     }
   }
 
-  return nBytesPerFFToSend * n_ff_used;
+  return audiod_conv_n_bytes(nBytesPerFFToSend, n_bytes_ff, n_bytes_ep) * n_ff_used;
 }
 #endif //CFG_TUD_AUDIO_ENABLE_ENCODING
 
@@ -1120,32 +1730,97 @@ void audiod_init(void)
 #endif
     }
 
+#if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
+    audio->int_ctr_mutex = osal_mutex_create(&audio->int_ctr_mutex_def);
+#endif
+
     // Initialize active alternate interface buffers
     switch (i)
     {
 #if CFG_TUD_AUDIO_FUNC_1_N_AS_INT > 0
       case 0:
         audio->alt_setting = alt_setting_1;
+        audio->n_as_itf = CFG_TUD_AUDIO_FUNC_1_N_AS_INT;
         break;
 #endif
 #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_N_AS_INT > 0
       case 1:
         audio->alt_setting = alt_setting_2;
+        audio->n_as_itf = CFG_TUD_AUDIO_FUNC_2_N_AS_INT;
         break;
 #endif
 #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_N_AS_INT > 0
       case 2:
         audio->alt_setting = alt_setting_3;
+        audio->n_as_itf = CFG_TUD_AUDIO_FUNC_3_N_AS_INT;
         break;
 #endif
     }
 
+    // Initialize EP buffer arena if used - set interface partitions it for the active alternate setting
+#if CFG_TUD_AUDIO_ENABLE_EP_IN || CFG_TUD_AUDIO_ENABLE_EP_OUT
+    switch (i)
+    {
+#if CFG_TUD_AUDIO_FUNC_1_ARENA_SZ > 0
+      case 0:
+        audio->arena    = audio_arena_1;
+        audio->arena_sz = CFG_TUD_AUDIO_FUNC_1_ARENA_SZ;
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+        tu_fifo_config_mutex(&audio->ep_in_ff, osal_mutex_create(&arena_ff_mutex_wr_1), NULL);
+#endif
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+        tu_fifo_config_mutex(&audio->ep_out_ff, NULL, osal_mutex_create(&arena_ff_mutex_rd_1));
+#endif
+        break;
+#endif
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ > 0
+      case 1:
+        audio->arena    = audio_arena_2;
+        audio->arena_sz = CFG_TUD_AUDIO_FUNC_2_ARENA_SZ;
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+        tu_fifo_config_mutex(&audio->ep_in_ff, osal_mutex_create(&arena_ff_mutex_wr_2), NULL);
+#endif
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+        tu_fifo_config_mutex(&audio->ep_out_ff, NULL, osal_mutex_create(&arena_ff_mutex_rd_2));
+#endif
+        break;
+#endif
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ > 0
+      case 2:
+        audio->arena    = audio_arena_3;
+        audio->arena_sz = CFG_TUD_AUDIO_FUNC_3_ARENA_SZ;
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+        tu_fifo_config_mutex(&audio->ep_in_ff, osal_mutex_create(&arena_ff_mutex_wr_3), NULL);
+#endif
+#if CFG_FIFO_MUTEX && CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+        tu_fifo_config_mutex(&audio->ep_out_ff, NULL, osal_mutex_create(&arena_ff_mutex_rd_3));
+#endif
+        break;
+#endif
+      default:
+        audio->arena    = NULL;
+        audio->arena_sz = 0;
+        break;
+    }
+
+    // Until the first set interface the EP FIFOs own one half each such that the application can already access them
+    if (audio->arena)
+    {
+  #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+      tu_fifo_config(&audio->ep_in_ff, audio->arena, audio->arena_sz / 2, 1, true);
+  #endif
+  #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+      tu_fifo_config(&audio->ep_out_ff, audio->arena + audio->arena_sz / 2, audio->arena_sz / 2, 1, true);
+  #endif
+    }
+#endif
+
     // Initialize IN EP FIFO if required
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
 
     switch (i)
     {
-#if CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
       case 0:
         tu_fifo_config(&audio->ep_in_ff, audio_ep_in_sw_buf_1, CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1153,7 +1828,7 @@ void audiod_init(void)
 #endif
         break;
 #endif
-#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
       case 1:
         tu_fifo_config(&audio->ep_in_ff, audio_ep_in_sw_buf_2, CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1161,7 +1836,7 @@ void audiod_init(void)
 #endif
         break;
 #endif
-#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
       case 2:
         tu_fifo_config(&audio->ep_in_ff, audio_ep_in_sw_buf_3, CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1176,17 +1851,17 @@ void audiod_init(void)
 #if USE_LINEAR_BUFFER_TX
     switch (i)
     {
-#if CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX > 0
+#if CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
       case 0:
         audio->lin_buf_in = lin_buf_in_1;
         break;
 #endif
-#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX > 0
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
       case 1:
         audio->lin_buf_in = lin_buf_in_2;
         break;
 #endif
-#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX > 0
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
       case 2:
         audio->lin_buf_in = lin_buf_in_3;
         break;
@@ -1199,7 +1874,7 @@ void audiod_init(void)
 
     switch (i)
     {
-#if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
       case 0:
         tu_fifo_config(&audio->ep_out_ff, audio_ep_out_sw_buf_1, CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1207,7 +1882,7 @@ void audiod_init(void)
 #endif
         break;
 #endif
-#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
       case 1:
         tu_fifo_config(&audio->ep_out_ff, audio_ep_out_sw_buf_2, CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1215,7 +1890,7 @@ void audiod_init(void)
 #endif
         break;
 #endif
-#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ > 0
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
       case 2:
         tu_fifo_config(&audio->ep_out_ff, audio_ep_out_sw_buf_3, CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ, 1, true);
 #if CFG_FIFO_MUTEX
@@ -1230,17 +1905,17 @@ void audiod_init(void)
 #if USE_LINEAR_BUFFER_RX
     switch (i)
     {
-#if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX > 0
+#if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0
       case 0:
         audio->lin_buf_out = lin_buf_out_1;
         break;
 #endif
-#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX > 0
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0
       case 1:
         audio->lin_buf_out = lin_buf_out_2;
         break;
 #endif
-#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX > 0
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX > 0 && CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0
       case 2:
         audio->lin_buf_out = lin_buf_out_3;
         break;
@@ -1258,6 +1933,8 @@ void audiod_init(void)
         audio->tx_supp_ff = tx_supp_ff_1;
         audio->n_tx_supp_ff = CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO;
         audio->tx_supp_ff_sz_max = CFG_TUD_AUDIO_FUNC_1_TX_SUPP_SW_FIFO_SZ;
+        audio->tx_supp_ff_buf = &tx_supp_ff_buf_1[0][0];
+        audio->tx_supp_ff_app = 0;
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO; cnt++)
         {
           tu_fifo_config(&tx_supp_ff_1[cnt], tx_supp_ff_buf_1[cnt], CFG_TUD_AUDIO_FUNC_1_TX_SUPP_SW_FIFO_SZ, 1, true);
@@ -1274,6 +1951,8 @@ void audiod_init(void)
         audio->tx_supp_ff = tx_supp_ff_2;
         audio->n_tx_supp_ff = CFG_TUD_AUDIO_FUNC_2_N_TX_SUPP_SW_FIFO;
         audio->tx_supp_ff_sz_max = CFG_TUD_AUDIO_FUNC_2_TX_SUPP_SW_FIFO_SZ;
+        audio->tx_supp_ff_buf = &tx_supp_ff_buf_2[0][0];
+        audio->tx_supp_ff_app = 0;
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_2_N_TX_SUPP_SW_FIFO; cnt++)
         {
           tu_fifo_config(&tx_supp_ff_2[cnt], tx_supp_ff_buf_2[cnt], CFG_TUD_AUDIO_FUNC_2_TX_SUPP_SW_FIFO_SZ, 1, true);
@@ -1290,6 +1969,8 @@ void audiod_init(void)
         audio->tx_supp_ff = tx_supp_ff_3;
         audio->n_tx_supp_ff = CFG_TUD_AUDIO_FUNC_3_N_TX_SUPP_SW_FIFO;
         audio->tx_supp_ff_sz_max = CFG_TUD_AUDIO_FUNC_3_TX_SUPP_SW_FIFO_SZ;
+        audio->tx_supp_ff_buf = &tx_supp_ff_buf_3[0][0];
+        audio->tx_supp_ff_app = 0;
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_3_N_TX_SUPP_SW_FIFO; cnt++)
         {
           tu_fifo_config(&tx_supp_ff_3[cnt], tx_supp_ff_buf_3[cnt], CFG_TUD_AUDIO_FUNC_3_TX_SUPP_SW_FIFO_SZ, 1, true);
@@ -1406,11 +2087,13 @@ void audiod_init(void)
 
 void audiod_reset(uint8_t rhport)
 {
-  (void) rhport;
-
   for(uint8_t i=0; i<CFG_TUD_AUDIO; i++)
   {
     audiod_function_t* audio = &_audiod_fct[i];
+
+    // function is opened on other port
+    if (audio->p_desc && audio->rhport != rhport) continue;
+
     tu_memclr(audio, ITF_MEM_RESET_SIZE);
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -1483,6 +2166,8 @@ uint16_t audiod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
 #endif
       }
 
+      TU_ASSERT(audiod_build_lookup(&_audiod_fct[i]), 0);
+
 #if USE_ISO_EP_ALLOCATION
       {
   #if CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -1521,13 +2206,13 @@ uint16_t audiod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_IN
                   ep_in = desc_ep->bEndpointAddress;
-                  ep_in_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_in_size);
+                  ep_in_size = TU_MAX(tu_edpt_hb_size(desc_ep), ep_in_size);
   #endif
                 } else
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_OUT
                   ep_out = desc_ep->bEndpointAddress;
-                  ep_out_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_out_size);
+                  ep_out_size = TU_MAX(tu_edpt_hb_size(desc_ep), ep_out_size);
   #endif
                 }
               }
@@ -1615,7 +2300,7 @@ static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const *
   uint8_t func_id, idxItf;
   uint8_t const *dummy;
 
-  TU_VERIFY(audiod_get_AS_interface_index_global(itf, &func_id, &idxItf, &dummy));
+  TU_VERIFY(audiod_get_AS_interface_index_global(rhport, itf, &func_id, &idxItf, &dummy));
   TU_VERIFY(tud_control_xfer(rhport, p_request, &_audiod_fct[func_id].alt_setting[idxItf], 1));
 
   TU_LOG2("  Get itf: %u - current alt: %u\r\n", itf, _audiod_fct[func_id].alt_setting[idxItf]);
@@ -1646,7 +2331,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
   // Find index of audio streaming interface and index of interface
   uint8_t func_id, idxItf;
   uint8_t const *p_desc;
-  TU_VERIFY(audiod_get_AS_interface_index_global(itf, &func_id, &idxItf, &p_desc));
+  TU_VERIFY(audiod_get_AS_interface_index_global(rhport, itf, &func_id, &idxItf, &p_desc));
 
   audiod_function_t* audio = &_audiod_fct[func_id];
 
@@ -1755,7 +2440,8 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_in = ep_addr;
             audio->ep_in_as_intf_num = itf;
-            audio->ep_in_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_in_sz = tu_edpt_hb_size(desc_ep);
+            TU_ASSERT(audiod_arena_partition(audio, TUSB_DIR_IN));
 
             // If software encoding is enabled, parse for the corresponding parameters - doing this here means only AS interfaces with EPs get scanned for parameters
   #if CFG_TUD_AUDIO_ENABLE_ENCODING || CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
@@ -1763,11 +2449,19 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
-            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx))
-               * (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx));
+            const uint16_t tx_slot_size = (uint16_t) (audio->n_channels_per_ff_tx * audiod_tx_ff_n_bytes(audio));
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / tx_slot_size) * tx_slot_size);
             for (uint8_t cnt = 0; cnt < audio->n_tx_supp_ff; cnt++)
             {
-              tu_fifo_config(&audio->tx_supp_ff[cnt], audio->tx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
+              if ( tu_bit_test(audio->tx_supp_ff_app, cnt) )
+              {
+                // Application owned buffer keeps its depth, which must hold whole slots as well
+                TU_ASSERT( (audio->tx_supp_ff[cnt].depth % tx_slot_size) == 0 );
+              }
+              else
+              {
+                tu_fifo_config(&audio->tx_supp_ff[cnt], audio->tx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
+              }
             }
             audio->n_ff_used_tx = audio->n_channels_tx / audio->n_channels_per_ff_tx;
             TU_ASSERT( audio->n_ff_used_tx <= audio->n_tx_supp_ff );
@@ -1787,14 +2481,15 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_out = ep_addr;
             audio->ep_out_as_intf_num = itf;
-            audio->ep_out_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_out_sz = tu_edpt_hb_size(desc_ep);
+            TU_ASSERT(audiod_arena_partition(audio, TUSB_DIR_OUT));
 
   #if CFG_TUD_AUDIO_ENABLE_DECODING
             audiod_parse_for_AS_params(audio, p_desc_parse_for_params, p_desc_end, itf);
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
-            const uint16_t active_fifo_depth = (audio->rx_supp_ff_sz_max / audio->n_bytes_per_sampe_rx) * audio->n_bytes_per_sampe_rx;
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->rx_supp_ff_sz_max / audiod_rx_ff_n_bytes(audio)) * audiod_rx_ff_n_bytes(audio));
             for (uint8_t cnt = 0; cnt < audio->n_rx_supp_ff; cnt++)
             {
               tu_fifo_config(&audio->rx_supp_ff[cnt], audio->rx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
@@ -1831,6 +2526,11 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
 
       TU_VERIFY(foundEPs == nEps);
 
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+      // Feedback EP of alternate setting is known now
+      if (audio->ep_out_as_intf_num == itf) audiod_resampler_reset(audio);
+#endif
+
       // Invoke one callback for a final set interface
       if (tud_audio_set_itf_cb) TU_VERIFY(tud_audio_set_itf_cb(rhport, p_request));
 
@@ -1839,12 +2539,13 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
       if (tud_audio_feedback_params_cb)
       {
         audio_feedback_params_t fb_param;
+        tu_memclr(&fb_param, sizeof(fb_param));
 
         tud_audio_feedback_params_cb(func_id, alt, &fb_param);
         audio->feedback.compute_method = fb_param.method;
 
         // Minimal/Maximum value in 16.16 format for full speed (1ms per frame) or high speed (125 us per frame)
-        uint32_t const frame_div  = (TUSB_SPEED_FULL == tud_speed_get()) ? 1000 : 8000;
+        uint32_t const frame_div  = (TUSB_SPEED_FULL == tud_n_speed_get(rhport)) ? 1000 : 8000;
         audio->feedback.min_value = (fb_param.sample_freq/frame_div - 1) << 16;
         audio->feedback.max_value = (fb_param.sample_freq/frame_div + 1) << 16;
 
@@ -1856,17 +2557,13 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq);
           break;
 
-          #if 0 // implement later
           case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
-          {
-            uint64_t fb64 = ((uint64_t) fb_param.sample_freq) << 16;
-            audio->feedback.compute.fifo_count.nominal_value = (uint32_t) (fb64 / frame_div);
-            audio->feedback.compute.fifo_count.threshold_bytes = fb_param.fifo_count.threshold_bytes;
+            set_fb_params_fifo_count(audio, fb_param.sample_freq, frame_div, &fb_param);
+            tud_audio_n_fb_set(func_id, audio->feedback.compute.fifo_count.nominal_value);
 
-            tud_audio_fb_set(audio->feedback.compute.fifo_count.nominal_value);
-          }
+            // Controller runs from SOF
+            usbd_sof_enable(rhport, true);
           break;
-          #endif
 
           // nothing to do
           default: break;
@@ -1926,7 +2623,7 @@ static bool audiod_control_complete(uint8_t rhport, tusb_control_request_t const
           if (tud_audio_set_req_entity_cb)
           {
             // Check if entity is present and get corresponding driver index
-            TU_VERIFY(audiod_verify_entity_exists(itf, entityID, &func_id));
+            TU_VERIFY(audiod_verify_entity_exists(rhport, itf, entityID, &func_id));
 
             // Invoke callback
             return tud_audio_set_req_entity_cb(rhport, p_request, _audiod_fct[func_id].ctrl_buf);
@@ -1942,7 +2639,7 @@ static bool audiod_control_complete(uint8_t rhport, tusb_control_request_t const
           if (tud_audio_set_req_itf_cb)
           {
             // Find index of audio driver structure and verify interface really exists
-            TU_VERIFY(audiod_verify_itf_exists(itf, &func_id));
+            TU_VERIFY(audiod_verify_itf_exists(rhport, itf, &func_id));
 
             // Invoke callback
             return tud_audio_set_req_itf_cb(rhport, p_request, _audiod_fct[func_id].ctrl_buf);
@@ -1963,7 +2660,7 @@ static bool audiod_control_complete(uint8_t rhport, tusb_control_request_t const
         if (tud_audio_set_req_ep_cb)
         {
           // Check if entity is present and get corresponding driver index
-          TU_VERIFY(audiod_verify_ep_exists(ep, &func_id));
+          TU_VERIFY(audiod_verify_ep_exists(rhport, ep, &func_id));
 
           // Invoke callback
           return tud_audio_set_req_ep_cb(rhport, p_request, _audiod_fct[func_id].ctrl_buf);
@@ -2021,7 +2718,7 @@ static bool audiod_control_request(uint8_t rhport, tusb_control_request_t const
         if (entityID != 0)
         {
           // Find index of audio driver structure and verify entity really exists
-          TU_VERIFY(audiod_verify_entity_exists(itf, entityID, &func_id));
+          TU_VERIFY(audiod_verify_entity_exists(rhport, itf, entityID, &func_id));
 
           // In case we got a get request invoke callback - callback needs to answer as defined in UAC2 specification page 89 - 5. Requests
           if (p_request->bmRequestType_bit.direction == TUSB_DIR_IN)
@@ -2040,7 +2737,7 @@ static bool audiod_control_request(uint8_t rhport, tusb_control_request_t const
         else
         {
           // Find index of audio driver structure and verify interface really exists
-          TU_VERIFY(audiod_verify_itf_exists(itf, &func_id));
+          TU_VERIFY(audiod_verify_itf_exists(rhport, itf, &func_id));
 
           // In case we got a get request invoke callback - callback needs to answer as defined in UAC2 specification page 89 - 5. Requests
           if (p_request->bmRequestType_bit.direction == TUSB_DIR_IN)
@@ -2064,7 +2761,7 @@ static bool audiod_control_request(uint8_t rhport, tusb_control_request_t const
         uint8_t ep = TU_U16_LOW(p_request->wIndex);
 
         // Find index of audio driver structure and verify EP really exists
-        TU_VERIFY(audiod_verify_ep_exists(ep, &func_id));
+        TU_VERIFY(audiod_verify_ep_exists(rhport, ep, &func_id));
 
         // In case we got a get request invoke callback - callback needs to answer as defined in UAC2 specification page 89 - 5. Requests
         if (p_request->bmRequestType_bit.direction == TUSB_DIR_IN)
@@ -2119,6 +2816,7 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   for (uint8_t func_id = 0; func_id < CFG_TUD_AUDIO; func_id++)
   {
     audiod_function_t* audio = &_audiod_fct[func_id];
+    if (audio->rhport != rhport) continue;
 
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
 
@@ -2132,6 +2830,9 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
       // I assume here, that things above are handled by PHY
       // All transmission is done - what remains to do is to inform job was completed
 
+      // Send next queued message
+      TU_VERIFY(audiod_int_ctr_xmit(audio));
+
       if (tud_audio_int_ctr_done_cb) TU_VERIFY(tud_audio_int_ctr_done_cb(rhport, (uint16_t) xferred_bytes));
     }
 
@@ -2197,7 +2898,7 @@ static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, u
 
   // n_frames_min is ceil(2^10 * f_s / f_m) for full speed and ceil(2^13 * f_s / f_m) for high speed
   // this lower limit ensures the measures feedback value has sufficient precision
-  uint32_t const k = (TUSB_SPEED_FULL == tud_speed_get()) ? 10 : 13;
+  uint32_t const k = (TUSB_SPEED_FULL == tud_n_speed_get(audio->rhport)) ? 10 : 13;
   uint32_t const n_frame = (1UL << audio->feedback.frame_shift);
 
   if ( (((1UL << k) * sample_freq / mclk_freq) + 1) > n_frame )
@@ -2224,6 +2925,85 @@ static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, u
   return true;
 }
 
+// OUT FIFO used as controlled variable of FIFO count feedback
+static inline tu_fifo_t* audiod_fb_fifo(audiod_function_t* audio)
+{
+#if CFG_TUD_AUDIO_ENABLE_DECODING
+  return &audio->rx_supp_ff[0];
+#else
+  return &audio->ep_out_ff;
+#endif
+}
+
+static void set_fb_params_fifo_count(audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, audio_feedback_params_t const* fb_param)
+{
+  uint16_t const depth = audiod_fb_fifo(audio)->depth;
+  uint16_t const half_depth = tu_max16(depth / 2, 2);
+
+  audio->feedback.compute.fifo_count.nominal_value = (uint32_t) ((((uint64_t) sample_freq) << 16) / frame_div);
+  audio->feedback.compute.fifo_count.target = fb_param->fifo_count.target_bytes ? fb_param->fifo_count.target_bytes : half_depth;
+
+  // Default: full correction of one sample per frame when FIFO is half depth off target
+  audio->feedback.compute.fifo_count.kp = fb_param->fifo_count.kp ? fb_param->fifo_count.kp : (uint32_t) ((1ULL << 32) / half_depth);
+  audio->feedback.compute.fifo_count.ki = fb_param->fifo_count.ki ? fb_param->fifo_count.ki : audio->feedback.compute.fifo_count.kp / 64;
+  audio->feedback.compute.fifo_count.correction_max = (int32_t) (fb_param->fifo_count.correction_max ? fb_param->fifo_count.correction_max : (1UL << 16));
+
+  audio->feedback.compute.fifo_count.integral   = 0;
+  audio->feedback.compute.fifo_count.correction = 0;
+  audio->feedback.compute.fifo_count.level      = 0;
+  audio->feedback.compute.fifo_count.level_min  = UINT16_MAX;
+  audio->feedback.compute.fifo_count.level_max  = 0;
+}
+
+// Fixed-point PI controller, invoked every feedback interval from SOF ISR
+TU_ATTR_FAST_FUNC static void audiod_fb_fifo_count_update(uint8_t func_id, audiod_function_t* audio)
+{
+  uint16_t const level = tu_fifo_count(audiod_fb_fifo(audio));
+
+  audio->feedback.compute.fifo_count.level = level;
+  if (level < audio->feedback.compute.fifo_count.level_min) audio->feedback.compute.fifo_count.level_min = level;
+  if (level > audio->feedback.compute.fifo_count.level_max) audio->feedback.compute.fifo_count.level_max = level;
+
+  // FIFO above target: host sends faster than we consume, request less samples
+  int32_t const err = (int32_t) level - (int32_t) audio->feedback.compute.fifo_count.target;
+  int32_t const integral = audio->feedback.compute.fifo_count.integral + err;
+  int32_t const corr_max = audio->feedback.compute.fifo_count.correction_max;
+
+  int64_t corr = -(((int64_t) audio->feedback.compute.fifo_count.kp * err + (int64_t) audio->feedback.compute.fifo_count.ki * integral) >> 16);
+
+  // Anti windup: only integrate while correction is not saturated
+  if      (corr >  corr_max) corr =  corr_max;
+  else if (corr < -corr_max) corr = -corr_max;
+  else                       audio->feedback.compute.fifo_count.integral = integral;
+
+  audio->feedback.compute.fifo_count.correction = (int32_t) corr;
+
+  uint32_t feedback = (uint32_t) ((int64_t) audio->feedback.compute.fifo_count.nominal_value + corr);
+  if ( feedback > audio->feedback.max_value ) feedback = audio->feedback.max_value;
+  if ( feedback < audio->feedback.min_value ) feedback = audio->feedback.min_value;
+
+  tud_audio_n_fb_set(func_id, feedback);
+}
+
+bool tud_audio_n_get_fb_fifo_stats(uint8_t func_id, audio_feedback_fifo_stats_t* stats)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  TU_VERIFY(audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT);
+
+  stats->level      = audio->feedback.compute.fifo_count.level;
+  stats->level_min  = audio->feedback.compute.fifo_count.level_min;
+  stats->level_max  = audio->feedback.compute.fifo_count.level_max;
+  stats->target     = audio->feedback.compute.fifo_count.target;
+  stats->correction = audio->feedback.compute.fifo_count.correction;
+  stats->feedback   = (uint32_t) ((int64_t) audio->feedback.compute.fifo_count.nominal_value + audio->feedback.compute.fifo_count.correction);
+
+  audio->feedback.compute.fifo_count.level_min = UINT16_MAX;
+  audio->feedback.compute.fifo_count.level_max = 0;
+
+  return true;
+}
+
 uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles)
 {
   audiod_function_t* audio = &_audiod_fct[func_id];
@@ -2279,22 +3059,33 @@ TU_ATTR_FAST_FUNC void audiod_sof_isr (uint8_t rhport, uint32_t frame_count)
   {
     audiod_function_t* audio = &_audiod_fct[i];
 
-    if (audio->ep_fb != 0)
+    if (audio->ep_fb != 0 && audio->rhport == rhport)
     {
       // HS shift need to be adjusted since SOF event is generated for frame only
-      uint8_t const hs_adjust = (TUSB_SPEED_HIGH == tud_speed_get()) ? 3 : 0;
+      uint8_t const hs_adjust = (TUSB_SPEED_HIGH == tud_n_speed_get(rhport)) ? 3 : 0;
       uint32_t const interval = 1UL << (audio->feedback.frame_shift - hs_adjust);
       if ( 0 == (frame_count & (interval-1)) )
       {
-        if(tud_audio_feedback_interval_isr) tud_audio_feedback_interval_isr(i, frame_count, audio->feedback.frame_shift);
+        if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT)
+        {
+          audiod_fb_fifo_count_update(i, audio);
+        }
+        else if(tud_audio_feedback_interval_isr)
+        {
+          tud_audio_feedback_interval_isr(i, frame_count, audio->feedback.frame_shift);
+        }
       }
     }
   }
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 }
 
-bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const * p_request, void* data, uint16_t len)
+// Resolve audio function of a control IN request and track data the driver depends on
+static bool audiod_control_in_prepare(uint8_t rhport, tusb_control_request_t const * p_request, void const* data, uint16_t len, uint8_t* p_func_id)
 {
+  (void) data;
+  (void) len;
+
   // Handles only sending of data not receiving
   if (p_request->bmRequestType_bit.direction == TUSB_DIR_OUT) return false;
 
@@ -2313,12 +3104,12 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
       if (entityID != 0)
       {
         // Find index of audio driver structure and verify entity really exists
-        TU_VERIFY(audiod_verify_entity_exists(itf, entityID, &func_id));
+        TU_VERIFY(audiod_verify_entity_exists(rhport, itf, entityID, &func_id));
       }
       else
       {
         // Find index of audio driver structure and verify interface really exists
-        TU_VERIFY(audiod_verify_itf_exists(itf, &func_id));
+        TU_VERIFY(audiod_verify_itf_exists(rhport, itf, &func_id));
       }
     }
     break;
@@ -2328,7 +3119,7 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
       uint8_t ep = TU_U16_LOW(p_request->wIndex);
 
       // Find index of audio driver structure and verify EP really exists
-      TU_VERIFY(audiod_verify_ep_exists(ep, &func_id));
+      TU_VERIFY(audiod_verify_ep_exists(rhport, ep, &func_id));
     }
     break;
 
@@ -2336,12 +3127,6 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
     default: TU_LOG2("  Unsupported recipient: %d\r\n", p_request->bmRequestType_bit.recipient); TU_BREAKPOINT(); return false;
   }
 
-  // Crop length
-  if (len > _audiod_fct[func_id].ctrl_buf_sz) len = _audiod_fct[func_id].ctrl_buf_sz;
-
-  // Copy into buffer
-  TU_VERIFY(0 == tu_memcpy_s(_audiod_fct[func_id].ctrl_buf, _audiod_fct[func_id].ctrl_buf_sz, data, (size_t)len));
-
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
   // Find data for sampling_frequency_control
   if (p_request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS && p_request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE)
@@ -2350,45 +3135,168 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
     uint8_t ctrlSel = TU_U16_HIGH(p_request->wValue);
     if (_audiod_fct[func_id].bclock_id_tx == entityID && ctrlSel == AUDIO_CS_CTRL_SAM_FREQ && p_request->bRequest == AUDIO_CS_REQ_CUR)
     {
-      _audiod_fct[func_id].sample_rate_tx = tu_unaligned_read32(_audiod_fct[func_id].ctrl_buf);
+      if (len >= 4) _audiod_fct[func_id].sample_rate_tx = tu_unaligned_read32(data);
     }
   }
 #endif
 
+  *p_func_id = func_id;
+  return true;
+}
+
+bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const * p_request, void* data, uint16_t len)
+{
+  uint8_t func_id;
+  TU_VERIFY(audiod_control_in_prepare(rhport, p_request, data, len, &func_id));
+
+  // Crop length
+  if (len > _audiod_fct[func_id].ctrl_buf_sz) len = _audiod_fct[func_id].ctrl_buf_sz;
+
+  // Copy into buffer
+  TU_VERIFY(0 == tu_memcpy_s(_audiod_fct[func_id].ctrl_buf, _audiod_fct[func_id].ctrl_buf_sz, data, (size_t)len));
+
   // Schedule transmit
   return tud_control_xfer(rhport, p_request, (void*)_audiod_fct[func_id].ctrl_buf, len);
 }
 
+bool tud_audio_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const * p_request, void const* data, uint16_t len)
+{
+  uint8_t func_id;
+  TU_VERIFY(audiod_control_in_prepare(rhport, p_request, data, len, &func_id));
+
+  // Schedule transmit directly from application storage
+  return tud_control_xfer(rhport, p_request, (void*) (uintptr_t) data, len);
+}
+
+// Build lookup tables of audio function from its descriptors, called once by audiod_open()
+static bool audiod_build_lookup(audiod_function_t* audio)
+{
+  uint8_t const *p_desc     = audio->p_desc;
+  uint8_t const *p_desc_end = audio->p_desc + audio->desc_length - TUD_AUDIO_DESC_IAD_LEN;
+
+  audio->itf_first = ((tusb_desc_interface_t const *) p_desc)->bInterfaceNumber;
+  audio->itf_count = 1;
+  audio->ep_map    = 0;
+  audio->stream_dir = 0;
+  tu_memclr(audio->entity_map, sizeof(audio->entity_map));
+  tu_memclr(audio->as_itf_ofs, sizeof(audio->as_itf_ofs));
+
+  // Entities are defined between CS AC header and end of CS AC descriptors
+  p_desc = tu_desc_next(p_desc);                                                              // Points to CS AC descriptor
+  uint8_t const *p_ac_end = ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength + p_desc;
+  p_desc = tu_desc_next(p_desc);                                                              // Get past CS AC descriptor
+
+  while (p_desc < p_ac_end)
+  {
+    uint8_t const entity_id = p_desc[3];  // Entity IDs are always at offset 3
+    audio->entity_map[entity_id >> 5] |= TU_BIT(entity_id & 0x1F);
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  // AS interfaces and their EPs
+  while (p_desc < p_desc_end)
+  {
+    if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE)
+    {
+      tusb_desc_interface_t const * desc_itf = (tusb_desc_interface_t const *) p_desc;
+      TU_ASSERT(desc_itf->bInterfaceNumber > audio->itf_first);
+
+      uint8_t const idx = (uint8_t) (desc_itf->bInterfaceNumber - audio->itf_first - 1);
+      TU_ASSERT(idx < audio->n_as_itf && idx < AUDIOD_N_AS_INT_MAX);
+
+      if (desc_itf->bAlternateSetting == 0) audio->as_itf_ofs[idx] = (uint16_t) (p_desc - audio->p_desc);
+      audio->itf_count = tu_max8(audio->itf_count, (uint8_t) (idx + 2));
+    }
+    else if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT)
+    {
+      tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+      uint8_t const ep_addr = desc_ep->bEndpointAddress;
+      audio->ep_map |= TU_BIT(tu_edpt_number(ep_addr) + (tu_edpt_dir(ep_addr) == TUSB_DIR_IN ? 16 : 0));
+
+      // Feedback EPs (usage type 1) and the interrupt EP carry no audio data
+      if (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS && desc_ep->bmAttributes.usage != 1) audio->stream_dir |= (uint8_t) TU_BIT(tu_edpt_dir(ep_addr) == TUSB_DIR_IN ? 1 : 0);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return true;
+}
+
+#if CFG_TUD_AUDIO_ENABLE_EP_IN || CFG_TUD_AUDIO_ENABLE_EP_OUT
+// Place linear buffer and EP FIFO of given direction into its share of the arena, sized for the EP of the active alternate setting
+static bool audiod_arena_partition(audiod_function_t* audio, uint8_t dir)
+{
+  if (audio->arena == NULL) return true;
+
+  // IN share starts at bottom, OUT share ends at top - hence repartitioning one direction never touches the other one
+  uint16_t const share = (uint16_t) tu_align4(audio->stream_dir == 0x03 ? audio->arena_sz / 2u : audio->arena_sz);
+  uint8_t * buf = (dir == TUSB_DIR_IN) ? audio->arena : (audio->arena + audio->arena_sz - share);
+  uint16_t ep_sz = 0;
+
+#if CFG_TUD_AUDIO_ENABLE_EP_IN
+  if (dir == TUSB_DIR_IN) ep_sz = audio->ep_in_sz;
+#endif
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT
+  if (dir == TUSB_DIR_OUT) ep_sz = audio->ep_out_sz;
+#endif
+
+  TU_ASSERT(ep_sz > 0 && share >= 2 * ep_sz);
+
+  uint16_t remain = share;
+  uint16_t const lin_sz = (uint16_t) tu_align4(ep_sz + 3u);
+  (void) lin_sz;
+
+#if USE_LINEAR_BUFFER_TX
+  if (dir == TUSB_DIR_IN)
+  {
+    audio->lin_buf_in = buf;
+    buf    += lin_sz;
+    remain  = (uint16_t) (remain - lin_sz);
+  }
+#endif
+#if USE_LINEAR_BUFFER_RX
+  if (dir == TUSB_DIR_OUT)
+  {
+    audio->lin_buf_out = buf;
+    buf    += lin_sz;
+    remain  = (uint16_t) (remain - lin_sz);
+  }
+#endif
+
+  // FIFO holds whole packets such that a packet never gets split by a wrap
+  uint16_t depth = (uint16_t) ((remain / ep_sz) * ep_sz);
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  while ( depth && !tu_is_power_of_two(depth) ) depth = (uint16_t) (depth & (depth - 1));
+#endif
+  TU_ASSERT(depth >= ep_sz);
+
+#if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+  if (dir == TUSB_DIR_IN) TU_ASSERT(tu_fifo_config(&audio->ep_in_ff, buf, depth, 1, true));
+#endif
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+  if (dir == TUSB_DIR_OUT) TU_ASSERT(tu_fifo_config(&audio->ep_out_ff, buf, depth, 1, true));
+#endif
+  (void) buf;
+
+  return true;
+}
+#endif
+
 // This helper function finds for a given audio function and AS interface number the index of the attached driver structure, the index of the interface in the audio function
 // (e.g. the std. AS interface with interface number 15 is the first AS interface for the given audio function and thus gets index zero), and
 // finally a pointer to the std. AS interface, where the pointer always points to the first alternate setting i.e. alternate interface zero.
 static bool audiod_get_AS_interface_index(uint8_t itf, audiod_function_t * audio, uint8_t *idxItf, uint8_t const **pp_desc_int)
 {
-  if (audio->p_desc)
+  if (audio->p_desc && itf > audio->itf_first)
   {
-    // Get pointer at end
-    uint8_t const *p_desc_end = audio->p_desc + audio->desc_length - TUD_AUDIO_DESC_IAD_LEN;
+    // AS interfaces are numbered contiguously after AC interface
+    uint8_t const idx = (uint8_t) (itf - audio->itf_first - 1);
 
-    // Advance past AC descriptors
-    uint8_t const *p_desc = tu_desc_next(audio->p_desc);
-    p_desc += ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength;
-
-    uint8_t tmp = 0;
-    while (p_desc < p_desc_end)
+    if (idx < audio->n_as_itf && audio->as_itf_ofs[idx] != 0)
     {
-      // We assume the number of alternate settings is increasing thus we return the index of alternate setting zero!
-      if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && ((tusb_desc_interface_t const * )p_desc)->bAlternateSetting == 0)
-      {
-        if (((tusb_desc_interface_t const * )p_desc)->bInterfaceNumber == itf)
-        {
-          *idxItf = tmp;
-          *pp_desc_int = p_desc;
-          return true;
-        }
-        // Increase index, bytes read, and pointer
-        tmp++;
-      }
-      p_desc = tu_desc_next(p_desc);
+      *idxItf = idx;
+      *pp_desc_int = audio->p_desc + audio->as_itf_ofs[idx];
+      return true;
     }
   }
   return false;
@@ -2397,13 +3305,13 @@ static bool audiod_get_AS_interface_index(uint8_t itf, audiod_function_t * audio
 // This helper function finds for a given AS interface number the index of the attached driver structure, the index of the interface in the audio function
 // (e.g. the std. AS interface with interface number 15 is the first AS interface for the given audio function and thus gets index zero), and
 // finally a pointer to the std. AS interface, where the pointer always points to the first alternate setting i.e. alternate interface zero.
-static bool audiod_get_AS_interface_index_global(uint8_t itf, uint8_t *func_id, uint8_t *idxItf, uint8_t const **pp_desc_int)
+static bool audiod_get_AS_interface_index_global(uint8_t rhport, uint8_t itf, uint8_t *func_id, uint8_t *idxItf, uint8_t const **pp_desc_int)
 {
   // Loop over audio driver interfaces
   uint8_t i;
   for (i = 0; i < CFG_TUD_AUDIO; i++)
   {
-    if (audiod_get_AS_interface_index(itf, &_audiod_fct[i], idxItf, pp_desc_int))
+    if (_audiod_fct[i].rhport == rhport && audiod_get_AS_interface_index(itf, &_audiod_fct[i], idxItf, pp_desc_int))
     {
       *func_id = i;
       return true;
@@ -2414,81 +3322,45 @@ static bool audiod_get_AS_interface_index_global(uint8_t itf, uint8_t *func_id,
 }
 
 // Verify an entity with the given ID exists and returns also the corresponding driver index
-static bool audiod_verify_entity_exists(uint8_t itf, uint8_t entityID, uint8_t *func_id)
+static bool audiod_verify_entity_exists(uint8_t rhport, uint8_t itf, uint8_t entityID, uint8_t *func_id)
 {
   uint8_t i;
   for (i = 0; i < CFG_TUD_AUDIO; i++)
   {
     // Look for the correct driver by checking if the unique standard AC interface number fits
-    if (_audiod_fct[i].p_desc && ((tusb_desc_interface_t const *)_audiod_fct[i].p_desc)->bInterfaceNumber == itf)
+    if (_audiod_fct[i].p_desc && _audiod_fct[i].rhport == rhport && _audiod_fct[i].itf_first == itf &&
+        (_audiod_fct[i].entity_map[entityID >> 5] & TU_BIT(entityID & 0x1F)))
     {
-      // Get pointers after class specific AC descriptors and end of AC descriptors - entities are defined in between
-      uint8_t const *p_desc = tu_desc_next(_audiod_fct[i].p_desc);                                          // Points to CS AC descriptor
-      uint8_t const *p_desc_end = ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength + p_desc;
-      p_desc = tu_desc_next(p_desc);                                                                            // Get past CS AC descriptor
-
-      while (p_desc < p_desc_end)
-      {
-        if (p_desc[3] == entityID)  // Entity IDs are always at offset 3
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
-      }
+      *func_id = i;
+      return true;
     }
   }
   return false;
 }
 
-static bool audiod_verify_itf_exists(uint8_t itf, uint8_t *func_id)
+static bool audiod_verify_itf_exists(uint8_t rhport, uint8_t itf, uint8_t *func_id)
 {
   uint8_t i;
   for (i = 0; i < CFG_TUD_AUDIO; i++)
   {
-    if (_audiod_fct[i].p_desc)
+    if (_audiod_fct[i].p_desc && _audiod_fct[i].rhport == rhport && itf >= _audiod_fct[i].itf_first && itf < _audiod_fct[i].itf_first + _audiod_fct[i].itf_count)
     {
-      // Get pointer at beginning and end
-      uint8_t const *p_desc = _audiod_fct[i].p_desc;
-      uint8_t const *p_desc_end = _audiod_fct[i].p_desc + _audiod_fct[i].desc_length - TUD_AUDIO_DESC_IAD_LEN;
-
-      while (p_desc < p_desc_end)
-      {
-        if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && ((tusb_desc_interface_t const *)_audiod_fct[i].p_desc)->bInterfaceNumber == itf)
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
-      }
+      *func_id = i;
+      return true;
     }
   }
   return false;
 }
 
-static bool audiod_verify_ep_exists(uint8_t ep, uint8_t *func_id)
+static bool audiod_verify_ep_exists(uint8_t rhport, uint8_t ep, uint8_t *func_id)
 {
   uint8_t i;
   for (i = 0; i < CFG_TUD_AUDIO; i++)
   {
-    if (_audiod_fct[i].p_desc)
+    if (_audiod_fct[i].p_desc && _audiod_fct[i].rhport == rhport && (_audiod_fct[i].ep_map & TU_BIT(tu_edpt_number(ep) + (tu_edpt_dir(ep) == TUSB_DIR_IN ? 16 : 0))))
     {
-      // Get pointer at end
-      uint8_t const *p_desc_end = _audiod_fct[i].p_desc + _audiod_fct[i].desc_length;
-
-      // Advance past AC descriptors - EP we look for are streaming EPs
-      uint8_t const *p_desc = tu_desc_next(_audiod_fct[i].p_desc);
-      p_desc += ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength;
-
-      while (p_desc < p_desc_end)
-      {
-        if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT && ((tusb_desc_endpoint_t const * )p_desc)->bEndpointAddress == ep)
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
-      }
+      *func_id = i;
+      return true;
     }
   }
   return false;
@@ -2510,6 +3382,10 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
   if (as_itf != audio->ep_out_as_intf_num) return;
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+  uint8_t bit_resolution = 0;
+#endif
+
   p_desc = tu_desc_next(p_desc);    // Exclude standard AS interface descriptor of current alternate interface descriptor
 
   while (p_desc < p_desc_end)
@@ -2562,6 +3438,9 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
       if (as_itf == audio->ep_in_as_intf_num)
       {
         audio->n_bytes_per_sampe_tx = ((audio_desc_type_I_format_t const * )p_desc)->bSubslotSize;
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+        bit_resolution = ((audio_desc_type_I_format_t const * )p_desc)->bBitResolution;
+#endif
       }
 #endif
 
@@ -2569,6 +3448,9 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
       if (as_itf == audio->ep_out_as_intf_num)
       {
         audio->n_bytes_per_sampe_rx = ((audio_desc_type_I_format_t const * )p_desc)->bSubslotSize;
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+        bit_resolution = ((audio_desc_type_I_format_t const * )p_desc)->bBitResolution;
+#endif
       }
 #endif
     }
@@ -2578,6 +3460,25 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
 
     p_desc = tu_desc_next(p_desc);
   }
+
+  // Select sample format conversion between support FIFOs and EP for this alternate setting
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+#if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+  if (as_itf == audio->ep_in_as_intf_num)
+  {
+    audiod_conv_select(&audio->conv_tx, audio->n_bytes_per_sampe_tx, bit_resolution,
+                       (audio->format_type_I_tx & AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT) != 0, true);
+  }
+#endif
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+  if (as_itf == audio->ep_out_as_intf_num)
+  {
+    audiod_conv_select(&audio->conv_rx, audio->n_bytes_per_sampe_rx, bit_resolution,
+                       (audio->format_type_I_rx & AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT) != 0, false);
+  }
+#endif
+  (void) bit_resolution;
+#endif
 }
 #endif
 
@@ -2591,10 +3492,10 @@ static bool audiod_calc_tx_packet_sz(audiod_function_t* audio)
   TU_VERIFY(audio->interval_tx);
   TU_VERIFY(audio->sample_rate_tx);
 
-  const uint8_t interval = (tud_speed_get() == TUSB_SPEED_FULL) ? audio->interval_tx : 1 << (audio->interval_tx - 1);
+  const uint8_t interval = (tud_n_speed_get(audio->rhport) == TUSB_SPEED_FULL) ? audio->interval_tx : 1 << (audio->interval_tx - 1);
 
-  const uint16_t sample_normimal = (uint16_t)(audio->sample_rate_tx * interval / ((tud_speed_get() == TUSB_SPEED_FULL) ? 1000 : 8000));
-  const uint16_t sample_reminder = (uint16_t)(audio->sample_rate_tx * interval % ((tud_speed_get() == TUSB_SPEED_FULL) ? 1000 : 8000));
+  const uint16_t sample_normimal = (uint16_t)(audio->sample_rate_tx * interval / ((tud_n_speed_get(audio->rhport) == TUSB_SPEED_FULL) ? 1000 : 8000));
+  const uint16_t sample_reminder = (uint16_t)(audio->sample_rate_tx * interval % ((tud_n_speed_get(audio->rhport) == TUSB_SPEED_FULL) ? 1000 : 8000));
 
   const uint16_t packet_sz_tx_min = (uint16_t)((sample_normimal - 1) * audio->n_channels_tx * audio->n_bytes_per_sampe_tx);
   const uint16_t packet_sz_tx_norm = (uint16_t)(sample_normimal * audio->n_channels_tx * audio->n_bytes_per_sampe_tx);
@@ -2679,7 +3580,7 @@ bool tud_audio_n_fb_set(uint8_t func_id, uint32_t feedback)
 
   // Format the feedback value
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION
-  if ( TUSB_SPEED_FULL == tud_speed_get() )
+  if ( TUSB_SPEED_FULL == tud_n_speed_get(_audiod_fct[func_id].rhport) )
   {
     uint8_t * fb = (uint8_t *) &_audiod_fct[func_id].feedback.value;
 
@@ -2690,12 +3591,11 @@ bool tud_audio_n_fb_set(uint8_t func_id, uint32_t feedback)
     // 4th byte is needed to work correctly with MS Windows
     *fb = 0;
   }else
-#else
+#endif
   {
     // Send value as-is, caller will choose the appropriate format
     _audiod_fct[func_id].feedback.value = feedback;
   }
-#endif
 
   // Schedule a transmit with the new value if EP is not busy - this triggers repetitive scheduling of the feedback value
   if (!usbd_edpt_busy(_audiod_fct[func_id].rhport, _audiod_fct[func_id].ep_fb))
@@ -82,7 +82,8 @@
 #endif
 #endif
 
-// End point sizes IN BYTES - Limits: Full Speed <= 1023, High Speed <= 1024
+// End point sizes IN BYTES per (micro)frame - Limits: Full Speed <= 1023, High Speed <= 1024 or up to 3072 with
+// high-bandwidth endpoint (see TUD_AUDIO_DESC_STD_AS_ISO_EP)
 #ifndef CFG_TUD_AUDIO_ENABLE_EP_IN
 #define CFG_TUD_AUDIO_ENABLE_EP_IN 0   // TX
 #endif
@@ -145,37 +146,52 @@
 #define CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ               0
 #endif
 
+// Arena for EP software FIFOs and linear buffers of an audio function - if > 0 it replaces the static per direction buffers
+// above. Set interface partitions it according to the selected alternate setting: each streaming direction present in the
+// descriptor owns an equal share (IN from bottom, OUT from top), the linear buffer (if required) takes one packet of the
+// active EP size and the EP software FIFO gets the rest rounded down to whole packets. Hence low sample rates get deeper FIFOs
+// from the same RAM. Each share must hold at least two packets of the biggest EP size. Support FIFOs are not put into the arena.
+#ifndef CFG_TUD_AUDIO_FUNC_1_ARENA_SZ
+#define CFG_TUD_AUDIO_FUNC_1_ARENA_SZ                       0
+#endif
+#ifndef CFG_TUD_AUDIO_FUNC_2_ARENA_SZ
+#define CFG_TUD_AUDIO_FUNC_2_ARENA_SZ                       0
+#endif
+#ifndef CFG_TUD_AUDIO_FUNC_3_ARENA_SZ
+#define CFG_TUD_AUDIO_FUNC_3_ARENA_SZ                       0
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
-#if CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 
 #if CFG_TUD_AUDIO > 1
-#if CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_2_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_2_EP_IN_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 #endif
 
 #if CFG_TUD_AUDIO > 2
-#if CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_3_EP_IN_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_3_EP_IN_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 #endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
-#if CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_1_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 
 #if CFG_TUD_AUDIO > 1
-#if CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_2_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_2_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_2_EP_OUT_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 #endif
 
 #if CFG_TUD_AUDIO > 2
-#if CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX
+#if CFG_TUD_AUDIO_FUNC_3_ARENA_SZ == 0 && CFG_TUD_AUDIO_FUNC_3_EP_OUT_SW_BUF_SZ < CFG_TUD_AUDIO_FUNC_3_EP_OUT_SZ_MAX
 #error EP software buffer size MUST BE at least as big as maximum EP size
 #endif
 #endif
@@ -205,6 +221,11 @@
 #define CFG_TUD_AUDIO_INT_CTR_EP_IN_SW_BUFFER_SIZE          6                             // Buffer size of audio control interrupt EP - 6 Bytes according to UAC 2 specification (p. 74)
 #endif
 
+// Number of interrupt messages which can wait for the interrupt EP, identical waiting messages are merged
+#ifndef CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH
+#define CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH                   4
+#endif
+
 // Use software encoding/decoding
 
 // The software coding feature of the driver is not mandatory. It is useful if, for instance, you have two I2S streams which need to be interleaved
@@ -238,6 +259,14 @@
 // - tud_audio_rx_done_pre_read_cb() or tud_audio_rx_done_post_read_cb()
 // to write/read from/into the EP_X_SW_BUFFER_FIFOs at the right time.
 //
+// If samples already arrive in a ring buffer owned by the application (e.g. circular I2S DMA buffer), the copy into
+// the TX support FIFOs can be avoided entirely: register the buffer with
+// - tud_audio_n_set_tx_support_ff_buffer()
+// and report the position the producer writes next into with
+// - tud_audio_n_set_tx_support_ff_wr_pos()
+// e.g. from the DMA half/full transfer interrupt. The encoder then interleaves straight from this buffer into the EP
+// buffer. Buffer depth must be a multiple of (channels per FIFO x bytes per sample) of all alternate settings.
+//
 // If you need a different encoding which is not support so far implement it in the
 // - audio_tx_done_cb()
 // - audio_rx_done_cb()
@@ -268,6 +297,44 @@
 #define CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING                0
 #endif
 
+// Sample format conversion between support FIFOs and EP. The application sets the format of its support FIFOs with
+// tud_audio_n_set_tx_support_ff_format() / tud_audio_n_set_rx_support_ff_format(). If it differs from the format of
+// the alternate setting chosen by host, samples are converted (truncated/extended, optionally dithered, float <-> integer)
+// while being (de)interleaved i.e. no extra pass over the data is needed. Requires TYPE_I encoding/decoding.
+#ifndef CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+#define CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION              0
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION && ((CFG_TUD_AUDIO_ENABLE_ENCODING && !CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING) || (CFG_TUD_AUDIO_ENABLE_DECODING && !CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING))
+#error CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION requires CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING/DECODING
+#endif
+
+// Fractional resampler in front of RX support FIFOs for adaptive/synchronous OUT streams i.e. without feedback EP.
+// Enabled by application with tud_audio_n_set_rx_resampler(), the ratio is steered by the fill level of the support
+// FIFOs towards half full so that clock drift between host and codec neither over- nor underflows them. Integer PCM
+// is interpolated with an 8 tap, 32 phase fixed-point polyphase kernel. Requires TYPE_I decoding.
+#ifndef CFG_TUD_AUDIO_ENABLE_RESAMPLING
+#define CFG_TUD_AUDIO_ENABLE_RESAMPLING                     0
+#endif
+
+// Maximum number of channels of a resampled stream
+#ifndef CFG_TUD_AUDIO_RESAMPLER_CHANNELS_MAX
+#define CFG_TUD_AUDIO_RESAMPLER_CHANNELS_MAX                2
+#endif
+
+// Maximum deviation of resampling ratio from 1 in ppm
+#ifndef CFG_TUD_AUDIO_RESAMPLER_MAX_PPM
+#define CFG_TUD_AUDIO_RESAMPLER_MAX_PPM                     1000
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING && !(CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING)
+#error CFG_TUD_AUDIO_ENABLE_RESAMPLING requires CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+#endif
+
+#if CFG_TUD_AUDIO_RESAMPLER_MAX_PPM > 10000
+#error CFG_TUD_AUDIO_RESAMPLER_MAX_PPM must not exceed 10000
+#endif
+
 // Type I Coding parameters not given within UAC2 descriptors
 // It would be possible to allow for a more flexible setting and not fix this parameter as done below. However, this is most often not needed and kept for later if really necessary. The more flexible setting could be implemented within set_interface(), however, how the values are saved per alternate setting is to be determined!
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
@@ -371,6 +438,9 @@ uint16_t tud_audio_n_available                    (uint8_t func_id);
 uint16_t tud_audio_n_read                         (uint8_t func_id, void* buffer, uint16_t bufsize);
 bool     tud_audio_n_clear_ep_out_ff              (uint8_t func_id);                          // Delete all content in the EP OUT FIFO
 tu_fifo_t*   tud_audio_n_get_ep_out_ff            (uint8_t func_id);
+#if CFG_TUSB_FIFO_STATS
+bool     tud_audio_n_get_ep_out_ff_stats          (uint8_t func_id, tu_fifo_stats_t* stats);
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -378,12 +448,22 @@ bool     tud_audio_n_clear_rx_support_ff          (uint8_t func_id, uint8_t ff_i
 uint16_t tud_audio_n_available_support_ff         (uint8_t func_id, uint8_t ff_idx);
 uint16_t tud_audio_n_read_support_ff              (uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize);
 tu_fifo_t* tud_audio_n_get_rx_support_ff          (uint8_t func_id, uint8_t ff_idx);
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+bool     tud_audio_n_set_rx_support_ff_format     (uint8_t func_id, uint8_t n_bytes_per_sample, bool is_float, bool dither); // n_bytes_per_sample = 0: same as alternate setting
+#endif
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+bool     tud_audio_n_set_rx_resampler             (uint8_t func_id, bool enable);          // Takes effect with next set interface
+int32_t  tud_audio_n_get_rx_resampler_ppm         (uint8_t func_id);                       // Current ratio deviation, positive if host is faster than consumer
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
 uint16_t tud_audio_n_write                        (uint8_t func_id, const void * data, uint16_t len);
 bool     tud_audio_n_clear_ep_in_ff               (uint8_t func_id);                          // Delete all content in the EP IN FIFO
 tu_fifo_t*   tud_audio_n_get_ep_in_ff             (uint8_t func_id);
+#if CFG_TUSB_FIFO_STATS
+bool     tud_audio_n_get_ep_in_ff_stats           (uint8_t func_id, tu_fifo_stats_t* stats);
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -391,9 +471,15 @@ uint16_t tud_audio_n_flush_tx_support_ff          (uint8_t func_id);      // For
 bool     tud_audio_n_clear_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
 uint16_t tud_audio_n_write_support_ff             (uint8_t func_id, uint8_t ff_idx, const void * data, uint16_t len);
 tu_fifo_t* tud_audio_n_get_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
+bool     tud_audio_n_set_tx_support_ff_buffer     (uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t depth); // Use application owned ring buffer, NULL to revert to internal buffer
+uint16_t tud_audio_n_set_tx_support_ff_wr_pos     (uint8_t func_id, uint8_t ff_idx, uint16_t wr_pos);              // Update write position (byte offset) of application owned buffer, return number of new bytes
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+bool     tud_audio_n_set_tx_support_ff_format     (uint8_t func_id, uint8_t n_bytes_per_sample, bool is_float, bool dither); // n_bytes_per_sample = 0: same as alternate setting
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
+// Queue an interrupt message (up to CFG_TUD_AUDIO_INT_CTR_QUEUE_DEPTH), a message identical to a waiting one is merged into it
 uint16_t    tud_audio_int_ctr_n_write             (uint8_t func_id, uint8_t const* buffer, uint16_t len);
 #endif
 
@@ -418,6 +504,13 @@ static inline bool     tud_audio_clear_rx_support_ff        (uint8_t ff_idx);
 static inline uint16_t tud_audio_available_support_ff       (uint8_t ff_idx);
 static inline uint16_t tud_audio_read_support_ff            (uint8_t ff_idx, void* buffer, uint16_t bufsize);
 static inline tu_fifo_t* tud_audio_get_rx_support_ff        (uint8_t ff_idx);
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+static inline bool     tud_audio_set_rx_support_ff_format   (uint8_t n_bytes_per_sample, bool is_float, bool dither);
+#endif
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+static inline bool     tud_audio_set_rx_resampler           (bool enable);
+static inline int32_t  tud_audio_get_rx_resampler_ppm       (void);
+#endif
 #endif
 
 // TX API
@@ -433,6 +526,11 @@ static inline uint16_t tud_audio_flush_tx_support_ff        (void);
 static inline uint16_t tud_audio_clear_tx_support_ff        (uint8_t ff_idx);
 static inline uint16_t tud_audio_write_support_ff           (uint8_t ff_idx, const void * data, uint16_t len);
 static inline tu_fifo_t* tud_audio_get_tx_support_ff        (uint8_t ff_idx);
+static inline bool     tud_audio_set_tx_support_ff_buffer   (uint8_t ff_idx, void* buffer, uint16_t depth);
+static inline uint16_t tud_audio_set_tx_support_ff_wr_pos   (uint8_t ff_idx, uint16_t wr_pos);
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+static inline bool     tud_audio_set_tx_support_ff_format   (uint8_t n_bytes_per_sample, bool is_float, bool dither);
+#endif
 #endif
 
 // INT CTR API
@@ -449,6 +547,11 @@ static inline uint16_t tud_audio_int_ctr_write              (uint8_t const* buff
 // If the request's wLength is zero, a status packet is sent instead.
 bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const * p_request, void* data, uint16_t len);
 
+// Schedule a transmit of control EP data directly from application storage, without copying it into the control buffer.
+// Same checks as tud_audio_buffer_and_schedule_control_xfer() apply, data must stay valid until the transfer completed
+// (e.g. static or tied to the entity) and is not cropped to the size of the control buffer.
+bool tud_audio_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const * p_request, void const* data, uint16_t len);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
@@ -504,9 +607,7 @@ enum {
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2,
-
-  // impelemnt later
-  // AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+  AUDIO_FEEDBACK_METHOD_FIFO_COUNT
 };
 
 typedef struct {
@@ -518,14 +619,31 @@ typedef struct {
       uint32_t mclk_freq; // Main clock frequency in Hz i.e. master clock to which sample clock is based on
     }frequency;
 
-#if 0 // implement later
+    // Closed loop: fixed-point PI controller keeps fill level of OUT FIFO (first RX support FIFO if decoding is enabled)
+    // at target, updated every feedback interval from SOF. Gains are 16.16, in feedback units (1/65536 sample per
+    // (micro)frame) per byte of level error. Zero fields select defaults.
     struct {
-      uint32_t threshold_bytes; // minimum number of bytes received to be considered as filled/ready
+      uint16_t target_bytes;    // target fill level, default: half of FIFO depth
+      uint32_t kp;              // proportional gain, default: one sample per frame at half FIFO depth error
+      uint32_t ki;              // integral gain per feedback interval, default: kp/64
+      uint32_t correction_max;  // max deviation from nominal feedback in 16.16, default: one sample per frame
     }fifo_count;
-#endif
   };
 }audio_feedback_params_t;
 
+// Telemetry of AUDIO_FEEDBACK_METHOD_FIFO_COUNT controller
+typedef struct {
+  uint16_t level;           // FIFO level in bytes at last update
+  uint16_t level_min;       // min/max FIFO level since last tud_audio_n_get_fb_fifo_stats()
+  uint16_t level_max;
+  uint16_t target;          // target FIFO level in bytes
+  int32_t  correction;      // last correction of nominal feedback in 16.16
+  uint32_t feedback;        // last feedback value in 16.16
+}audio_feedback_fifo_stats_t;
+
+// Get telemetry of FIFO count feedback controller, min/max are reset afterwards
+bool tud_audio_n_get_fb_fifo_stats(uint8_t func_id, audio_feedback_fifo_stats_t* stats);
+
 // Invoked when needed to set feedback parameters
 TU_ATTR_WEAK void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf, audio_feedback_params_t* feedback_param);
 
@@ -622,6 +740,25 @@ static inline tu_fifo_t* tud_audio_get_rx_support_ff(uint8_t ff_idx)
   return tud_audio_n_get_rx_support_ff(0, ff_idx);
 }
 
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+static inline bool tud_audio_set_rx_support_ff_format(uint8_t n_bytes_per_sample, bool is_float, bool dither)
+{
+  return tud_audio_n_set_rx_support_ff_format(0, n_bytes_per_sample, is_float, dither);
+}
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_RESAMPLING
+static inline bool tud_audio_set_rx_resampler(bool enable)
+{
+  return tud_audio_n_set_rx_resampler(0, enable);
+}
+
+static inline int32_t tud_audio_get_rx_resampler_ppm(void)
+{
+  return tud_audio_n_get_rx_resampler_ppm(0);
+}
+#endif
+
 #endif
 
 // TX API
@@ -667,6 +804,23 @@ static inline tu_fifo_t* tud_audio_get_tx_support_ff(uint8_t ff_idx)
   return tud_audio_n_get_tx_support_ff(0, ff_idx);
 }
 
+static inline bool tud_audio_set_tx_support_ff_buffer(uint8_t ff_idx, void* buffer, uint16_t depth)
+{
+  return tud_audio_n_set_tx_support_ff_buffer(0, ff_idx, buffer, depth);
+}
+
+static inline uint16_t tud_audio_set_tx_support_ff_wr_pos(uint8_t ff_idx, uint16_t wr_pos)
+{
+  return tud_audio_n_set_tx_support_ff_wr_pos(0, ff_idx, wr_pos);
+}
+
+#if CFG_TUD_AUDIO_ENABLE_FORMAT_CONVERSION
+static inline bool tud_audio_set_tx_support_ff_format(uint8_t n_bytes_per_sample, bool is_float, bool dither)
+{
+  return tud_audio_n_set_tx_support_ff_format(0, n_bytes_per_sample, is_float, dither);
+}
+#endif
+
 #endif
 
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
@@ -0,0 +1,832 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_AUDIO)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "audio_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_AUDIO_LOG_LEVEL
+  #define CFG_TUH_AUDIO_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_AUDIO_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// UAC1 control selector of sampling frequency endpoint control (UAC1 A.10.2)
+#define UAC1_EP_CTRL_SAMPLING_FREQ   0x01
+
+// Explicit feedback is 10.14 (3 bytes) for full speed, 16.16 (4 bytes) for highspeed
+#define AUDIOH_FB_BUFSIZE            4
+
+enum {
+  STREAM_IDLE = 0,
+  STREAM_SET_ALT,
+  STREAM_SET_RATE,
+  STREAM_RUNNING,
+  STREAM_STOPPING
+};
+
+// Terminal or clock entity of AudioControl interface
+typedef struct {
+  uint8_t id;
+  uint8_t subtype;
+  uint8_t source;     // clock entity of terminal, first clock input of selector/multiplier
+  uint8_t controls;   // bmControls of clock source
+} audioh_entity_t;
+
+typedef struct {
+  tuh_audio_format_t fmt;
+  bool rate_ctrl;     // UAC1: sampling frequency control is supported by data endpoint
+  tusb_desc_endpoint_t ep_data;
+  tusb_desc_endpoint_t ep_fb;
+} audioh_alt_t;
+
+typedef struct {
+  uint8_t itf_num;
+  uint8_t dir;
+  uint8_t terminal_link;
+  uint8_t alt_count;
+  audioh_alt_t alt[CFG_TUH_AUDIO_ALT_MAX];
+
+  uint8_t state;
+  uint8_t alt_idx;    // selected format
+  uint32_t rate;
+  uint8_t frame_size; // channels * subslot
+  uint8_t ep_data;
+  uint8_t ep_fb;
+  uint16_t pkt_max;   // max bytes of a packet including additional highspeed transactions
+  uint8_t pkt_count;  // packets per transfer
+  uint8_t buf_idx;    // transfer buffer submitted next
+  uint32_t pkt_nominal; // samples per packet from rate, 16.16
+  uint32_t pkt_samples; // samples per packet in use, from feedback if available, 16.16
+  uint32_t pkt_acc;
+
+  tuh_iso_packet_t iso_pkt[2][CFG_TUH_AUDIO_PACKETS_PER_XFER];
+  tuh_iso_packet_t fb_pkt;
+  tu_fifo_t ff;
+
+  uint8_t ff_buf[CFG_TUH_AUDIO_FIFO_SIZE];
+  TUH_EPBUF_DEF(ep_buf0, CFG_TUH_AUDIO_EP_BUFSIZE);
+  TUH_EPBUF_DEF(ep_buf1, CFG_TUH_AUDIO_EP_BUFSIZE);
+  TUH_EPBUF_DEF(fb_buf, AUDIOH_FB_BUFSIZE);
+} audioh_stream_t;
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;    // AudioControl interface
+  uint8_t itf_last;   // last AudioStreaming interface
+  uint8_t protocol;   // AUDIO_INT_PROTOCOL_CODE_UNDEF (UAC1) or AUDIO_INT_PROTOCOL_CODE_V2
+  bool mounted;
+
+  uint8_t entity_count;
+  audioh_entity_t entity[CFG_TUH_AUDIO_ENTITY_MAX];
+
+  uint8_t stream_count;
+  audioh_stream_t stream[CFG_TUH_AUDIO_STREAM_MAX];
+
+  TUH_EPBUF_DEF(ctrl_buf, 4);
+} audioh_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static audioh_interface_t _audioh_itf[CFG_TUH_AUDIO];
+
+// user_data of stream transfers: function index in high byte, stream index in low byte
+#define STREAM_USER_DATA(_idx, _stm)   ((uintptr_t) (((_idx) << 8) | (_stm)))
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline audioh_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_AUDIO, NULL);
+  audioh_interface_t* p_audio = &_audioh_itf[idx];
+  return (p_audio->daddr != 0) ? p_audio : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_uac2(audioh_interface_t const* p_audio) {
+  return p_audio->protocol == AUDIO_INT_PROTOCOL_CODE_V2;
+}
+
+static audioh_stream_t* get_stream(uint8_t idx, uint8_t stm) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->mounted && stm < p_audio->stream_count, NULL);
+  return &p_audio->stream[stm];
+}
+
+static audioh_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    if (_audioh_itf[i].daddr == 0) return &_audioh_itf[i];
+  }
+  return NULL;
+}
+
+static void stream_clear(audioh_stream_t* stm) {
+  tu_memclr(stm, offsetof(audioh_stream_t, ff_buf));
+}
+
+static audioh_entity_t const* find_entity(audioh_interface_t const* p_audio, uint8_t id) {
+  for (uint8_t i = 0; i < p_audio->entity_count; i++) {
+    if (p_audio->entity[i].id == id) return &p_audio->entity[i];
+  }
+  return NULL;
+}
+
+// Follow clock of stream terminal through selectors/multipliers to its clock source
+static audioh_entity_t const* find_clock_source(audioh_interface_t const* p_audio, uint8_t terminal_id) {
+  audioh_entity_t const* entity = find_entity(p_audio, terminal_id);
+  TU_VERIFY(entity, NULL);
+
+  // bounded to guard against clock loop
+  for (uint8_t n = 0; n < CFG_TUH_AUDIO_ENTITY_MAX; n++) {
+    entity = find_entity(p_audio, entity->source);
+    TU_VERIFY(entity, NULL);
+    if (entity->subtype == AUDIO_CS_AC_INTERFACE_CLOCK_SOURCE) return entity;
+  }
+  return NULL;
+}
+
+static bool format_has_rate(tuh_audio_format_t const* fmt, uint32_t rate) {
+  if (fmt->rate_count == 0) return true; // UAC2: rates are not described by descriptors
+  if (fmt->rate_continuous) return fmt->rates[0] <= rate && rate <= fmt->rates[1];
+  for (uint8_t i = 0; i < fmt->rate_count; i++) {
+    if (fmt->rates[i] == rate) return true;
+  }
+  return false;
+}
+
+// Service interval of an isochronous endpoint in (micro)frames
+static uint32_t iso_interval(tusb_desc_endpoint_t const* desc_ep) {
+  return 1u << (tu_min8(tu_max8(desc_ep->bInterval, 1), 16) - 1);
+}
+
+//--------------------------------------------------------------------+
+// Streaming
+//--------------------------------------------------------------------+
+static void stream_xfer_cb(tuh_xfer_t* xfer);
+
+static bool fb_submit(audioh_interface_t* p_audio, uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+  stm->fb_pkt.length = AUDIOH_FB_BUFSIZE;
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_audio->daddr,
+    .ep_addr     = stm->ep_fb,
+    .buffer      = stm->fb_buf,
+    .complete_cb = stream_xfer_cb,
+    .user_data   = STREAM_USER_DATA(idx, stm_idx)
+  };
+  return tuh_edpt_iso_xfer(&xfer, &stm->fb_pkt, 1);
+}
+
+// Size OUT packets with a fractional sample accumulator and fill them from sample ring, pad with silence on underrun
+static void stream_fill_out(audioh_stream_t* stm, uint8_t* buf, tuh_iso_packet_t* pkts) {
+  uint16_t const pkt_max = (uint16_t) (stm->pkt_max - stm->pkt_max % stm->frame_size);
+
+  for (uint8_t n = 0; n < stm->pkt_count; n++) {
+    stm->pkt_acc += stm->pkt_samples;
+    uint32_t const samples = stm->pkt_acc >> 16;
+    stm->pkt_acc &= 0xffffu;
+
+    uint16_t const len = (uint16_t) tu_min32(samples * stm->frame_size, pkt_max);
+    uint16_t count = (uint16_t) tu_min32(tu_fifo_count(&stm->ff), len);
+    count = (uint16_t) (count - count % stm->frame_size);
+
+    tu_fifo_read_n(&stm->ff, buf, count);
+    tu_memclr(buf + count, len - count);
+
+    pkts[n].length = len;
+    buf += len;
+  }
+}
+
+static bool stream_submit(audioh_interface_t* p_audio, uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+  uint8_t* buf = stm->buf_idx ? stm->ep_buf1 : stm->ep_buf0;
+  tuh_iso_packet_t* pkts = stm->iso_pkt[stm->buf_idx];
+
+  if (stm->dir == TUSB_DIR_IN) {
+    for (uint8_t n = 0; n < stm->pkt_count; n++) pkts[n].length = stm->pkt_max;
+  } else {
+    stream_fill_out(stm, buf, pkts);
+  }
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_audio->daddr,
+    .ep_addr     = stm->ep_data,
+    .buffer      = buf,
+    .complete_cb = stream_xfer_cb,
+    .user_data   = STREAM_USER_DATA(idx, stm_idx)
+  };
+  TU_VERIFY(tuh_edpt_iso_xfer(&xfer, pkts, stm->pkt_count));
+
+  stm->buf_idx ^= 1;
+  return true;
+}
+
+// Convert explicit feedback to samples per packet 16.16, values too far from nominal rate are ignored
+static void stream_process_feedback(audioh_interface_t* p_audio, audioh_stream_t* stm, uint32_t len) {
+  TU_VERIFY(len >= 3,);
+  uint8_t const* fb = stm->fb_buf;
+
+  uint32_t value;
+  if (len >= 4) {
+    // 16.16, also used by some full speed devices
+    value = tu_u32(fb[3], fb[2], fb[1], fb[0]);
+  } else {
+    value = tu_u32(0, fb[2], fb[1], fb[0]) << 2; // 10.14
+  }
+
+  audioh_alt_t const* alt = &stm->alt[stm->alt_idx];
+  value *= iso_interval(&alt->ep_data);
+
+  uint32_t const margin = stm->pkt_nominal / 4;
+  if (value + margin >= stm->pkt_nominal && value <= stm->pkt_nominal + margin) {
+    stm->pkt_samples = value;
+  } else {
+    TU_LOG_DRV("[%u] Audio feedback %lu out of range\r\n", p_audio->daddr, (unsigned long) value);
+  }
+}
+
+static void stream_xfer_cb(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uint8_t const stm_idx = (uint8_t) (xfer->user_data & 0xff);
+
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->daddr == xfer->daddr && stm_idx < p_audio->stream_count,);
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+  TU_VERIFY(stm->state == STREAM_RUNNING,);
+
+  if (xfer->ep_addr == stm->ep_fb) {
+    if (xfer->result == XFER_RESULT_SUCCESS) stream_process_feedback(p_audio, stm, stm->fb_pkt.actual_len);
+    (void) fb_submit(p_audio, idx, stm_idx);
+    return;
+  }
+
+  // keep endpoint busy with the other buffer while this one is processed
+  uint8_t const done = stm->buf_idx ^ 1;
+  if (!stream_submit(p_audio, idx, stm_idx)) {
+    TU_LOG_DRV("[%u] Audio stream %u stopped\r\n", p_audio->daddr, stm_idx);
+    stm->state = STREAM_IDLE;
+  }
+
+  if (stm->dir == TUSB_DIR_IN) {
+    uint8_t const* buf = done ? stm->ep_buf1 : stm->ep_buf0;
+    tuh_iso_packet_t const* pkts = stm->iso_pkt[done];
+    uint32_t total = 0;
+
+    // packets are laid out back to back with their requested length
+    for (uint8_t n = 0; n < stm->pkt_count; n++) {
+      if (pkts[n].result == XFER_RESULT_SUCCESS && pkts[n].actual_len) {
+        tu_fifo_write_n(&stm->ff, buf, pkts[n].actual_len);
+        total += pkts[n].actual_len;
+      }
+      buf += pkts[n].length;
+    }
+
+    if (tuh_audio_rx_cb) tuh_audio_rx_cb(idx, stm_idx, total);
+  } else {
+    if (tuh_audio_tx_cb) tuh_audio_tx_cb(idx, stm_idx);
+  }
+}
+
+static bool stream_start(audioh_interface_t* p_audio, uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+  audioh_alt_t const* alt = &stm->alt[stm->alt_idx];
+  uint8_t const daddr = p_audio->daddr;
+
+  TU_ASSERT(tuh_edpt_open(daddr, &alt->ep_data));
+  stm->ep_data = alt->ep_data.bEndpointAddress;
+
+  uint16_t const wmax = tu_le16toh(alt->ep_data.wMaxPacketSize);
+  stm->pkt_max = (uint16_t) (tu_edpt_packet_size(&alt->ep_data) * (1 + ((wmax >> 11) & 0x03)));
+  stm->pkt_count = (uint8_t) tu_min32(CFG_TUH_AUDIO_PACKETS_PER_XFER, CFG_TUH_AUDIO_EP_BUFSIZE / stm->pkt_max);
+  TU_ASSERT(stm->pkt_count); // packet is larger than CFG_TUH_AUDIO_EP_BUFSIZE
+
+  uint32_t const pkt_per_sec = (tuh_speed_get(daddr) == TUSB_SPEED_HIGH ? 8000u : 1000u) / iso_interval(&alt->ep_data);
+  stm->pkt_nominal = (uint32_t) (((uint64_t) stm->rate << 16) / pkt_per_sec);
+  stm->pkt_samples = stm->pkt_nominal;
+  stm->pkt_acc = 0;
+  stm->buf_idx = 0;
+  tu_fifo_clear(&stm->ff);
+
+  stm->state = STREAM_RUNNING;
+  TU_ASSERT(stream_submit(p_audio, idx, stm_idx));
+
+  // explicit feedback of asynchronous sink
+  if (stm->dir == TUSB_DIR_OUT && alt->ep_fb.bLength) {
+    if (tuh_edpt_open(daddr, &alt->ep_fb)) {
+      stm->ep_fb = alt->ep_fb.bEndpointAddress;
+      (void) fb_submit(p_audio, idx, stm_idx);
+    }
+  }
+
+  TU_LOG_DRV("[%u] Audio stream %u running: %lu Hz, %u packets of %u bytes\r\n", daddr, stm_idx, (unsigned long) stm->rate,
+             stm->pkt_count, stm->pkt_max);
+  return true;
+}
+
+static void stream_control_cb(tuh_xfer_t* xfer);
+
+// Set sample rate: clock source frequency control (UAC2) or sampling frequency control of data endpoint (UAC1)
+static bool stream_set_rate(audioh_interface_t* p_audio, uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+  audioh_alt_t const* alt = &stm->alt[stm->alt_idx];
+  uint8_t recipient;
+  uint16_t index;
+  uint16_t len;
+
+  if (is_uac2(p_audio)) {
+    audioh_entity_t const* clock = find_clock_source(p_audio, stm->terminal_link);
+    // frequency control must be host programmable
+    if (!(clock && (clock->controls & 0x03) == 0x03)) return false;
+    recipient = TUSB_REQ_RCPT_INTERFACE;
+    index = (uint16_t) ((clock->id << 8) | p_audio->itf_num);
+    len = 4;
+  } else {
+    if (!alt->rate_ctrl) return false;
+    recipient = TUSB_REQ_RCPT_ENDPOINT;
+    index = alt->ep_data.bEndpointAddress;
+    len = 3;
+  }
+
+  uint32_t const rate = tu_htole32(stm->rate);
+  memcpy(p_audio->ctrl_buf, &rate, 4);
+
+  tusb_control_request_t const req = {
+    .bmRequestType_bit = {
+      .recipient = recipient,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = TUSB_DIR_OUT
+    },
+    .bRequest = AUDIO_CS_REQ_CUR,
+    .wValue   = tu_htole16((uint16_t) ((is_uac2(p_audio) ? AUDIO_CS_CTRL_SAM_FREQ : UAC1_EP_CTRL_SAMPLING_FREQ) << 8)),
+    .wIndex   = tu_htole16(index),
+    .wLength  = tu_htole16(len)
+  };
+
+  tuh_xfer_t ctrl = {
+    .daddr       = p_audio->daddr,
+    .ep_addr     = 0,
+    .setup       = &req,
+    .buffer      = p_audio->ctrl_buf,
+    .complete_cb = stream_control_cb,
+    .user_data   = STREAM_USER_DATA(idx, stm_idx)
+  };
+
+  stm->state = STREAM_SET_RATE;
+  return tuh_control_xfer(&ctrl);
+}
+
+static void stream_open_complete(uint8_t idx, uint8_t stm_idx, audioh_stream_t* stm, bool success) {
+  if (!success) stm->state = STREAM_IDLE;
+  if (tuh_audio_stream_open_cb) tuh_audio_stream_open_cb(idx, stm_idx, success);
+}
+
+static void stream_control_cb(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uint8_t const stm_idx = (uint8_t) (xfer->user_data & 0xff);
+
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->daddr == xfer->daddr && stm_idx < p_audio->stream_count,);
+  audioh_stream_t* stm = &p_audio->stream[stm_idx];
+
+  switch (stm->state) {
+    case STREAM_SET_ALT:
+      if (xfer->result != XFER_RESULT_SUCCESS) {
+        stream_open_complete(idx, stm_idx, stm, false);
+        break;
+      }
+      // rate is fixed if it can not be controlled
+      if (stream_set_rate(p_audio, idx, stm_idx)) break;
+      stream_open_complete(idx, stm_idx, stm, stream_start(p_audio, idx, stm_idx));
+      break;
+
+    case STREAM_SET_RATE:
+      stream_open_complete(idx, stm_idx, stm,
+                           xfer->result == XFER_RESULT_SUCCESS && stream_start(p_audio, idx, stm_idx));
+      break;
+
+    case STREAM_STOPPING:
+      stm->state = STREAM_IDLE;
+      break;
+
+    default:
+      break;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+uint8_t tuh_audio_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_interface_t const* p_audio = &_audioh_itf[idx];
+    if (p_audio->daddr == daddr && p_audio->itf_num == itf_num) return idx;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_audio_mounted(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio);
+  return p_audio->mounted;
+}
+
+uint8_t tuh_audio_version(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->mounted, 0);
+  return is_uac2(p_audio) ? 2 : 1;
+}
+
+uint8_t tuh_audio_stream_count(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->mounted, 0);
+  return p_audio->stream_count;
+}
+
+bool tuh_audio_stream_info(uint8_t idx, uint8_t stm_idx, tuh_audio_stream_info_t* info) {
+  audioh_stream_t const* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && info);
+
+  info->itf_num = stm->itf_num;
+  info->dir = stm->dir;
+  info->terminal_link = stm->terminal_link;
+  info->format_count = stm->alt_count;
+  info->feedback = false;
+  for (uint8_t i = 0; i < stm->alt_count; i++) {
+    if (stm->alt[i].ep_fb.bLength) info->feedback = true;
+  }
+  return true;
+}
+
+bool tuh_audio_stream_format(uint8_t idx, uint8_t stm_idx, uint8_t n, tuh_audio_format_t* format) {
+  audioh_stream_t const* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && format && n < stm->alt_count);
+  *format = stm->alt[n].fmt;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Streaming API
+//--------------------------------------------------------------------+
+bool tuh_audio_stream_open(uint8_t idx, uint8_t stm_idx, uint8_t channels, uint8_t bit_resolution, uint32_t rate) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && rate && stm->state == STREAM_IDLE);
+
+  uint8_t n;
+  for (n = 0; n < stm->alt_count; n++) {
+    tuh_audio_format_t const* fmt = &stm->alt[n].fmt;
+    if ((channels == 0 || channels == fmt->channels) &&
+        (bit_resolution == 0 || bit_resolution == fmt->bit_resolution) && format_has_rate(fmt, rate)) {
+      break;
+    }
+  }
+  TU_VERIFY(n < stm->alt_count);
+
+  stm->alt_idx = n;
+  stm->rate = rate;
+  stm->frame_size = (uint8_t) (stm->alt[n].fmt.channels * stm->alt[n].fmt.subslot_size);
+  stm->ep_fb = 0;
+  stm->state = STREAM_SET_ALT;
+
+  if (!tuh_interface_set(p_audio->daddr, stm->itf_num, stm->alt[n].fmt.alt, stream_control_cb,
+                         STREAM_USER_DATA(idx, stm_idx))) {
+    stm->state = STREAM_IDLE;
+    return false;
+  }
+  return true;
+}
+
+bool tuh_audio_stream_close(uint8_t idx, uint8_t stm_idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && stm->state == STREAM_RUNNING);
+
+  stm->state = STREAM_STOPPING;
+  (void) tuh_edpt_abort_xfer(p_audio->daddr, stm->ep_data);
+  if (stm->ep_fb) (void) tuh_edpt_abort_xfer(p_audio->daddr, stm->ep_fb);
+
+  if (!tuh_interface_set(p_audio->daddr, stm->itf_num, 0, stream_control_cb, STREAM_USER_DATA(idx, stm_idx))) {
+    stm->state = STREAM_IDLE;
+  }
+  return true;
+}
+
+bool tuh_audio_stream_active(uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t const* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm);
+  return stm->state == STREAM_RUNNING;
+}
+
+uint8_t tuh_audio_stream_frame_size(uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t const* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && stm->state == STREAM_RUNNING, 0);
+  return stm->frame_size;
+}
+
+uint32_t tuh_audio_read(uint8_t idx, uint8_t stm_idx, void* buffer, uint32_t bufsize) {
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && stm->dir == TUSB_DIR_IN, 0);
+  return tu_fifo_read_n(&stm->ff, buffer, (tu_fifo_idx_t) tu_min32(bufsize, CFG_TUH_AUDIO_FIFO_SIZE));
+}
+
+uint32_t tuh_audio_write(uint8_t idx, uint8_t stm_idx, void const* buffer, uint32_t bufsize) {
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && stm->dir == TUSB_DIR_OUT, 0);
+  return tu_fifo_write_n(&stm->ff, buffer, (tu_fifo_idx_t) tu_min32(bufsize, CFG_TUH_AUDIO_FIFO_SIZE));
+}
+
+uint32_t tuh_audio_available(uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm, 0);
+  return tu_fifo_count(&stm->ff);
+}
+
+uint32_t tuh_audio_write_available(uint8_t idx, uint8_t stm_idx) {
+  audioh_stream_t* stm = get_stream(idx, stm_idx);
+  TU_VERIFY(stm && stm->dir == TUSB_DIR_OUT, 0);
+  return tu_fifo_remaining(&stm->ff);
+}
+
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+void audioh_init(void) {
+  tu_memclr(_audioh_itf, sizeof(_audioh_itf));
+}
+
+bool audioh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  // streaming endpoints complete through stream_xfer_cb()
+  (void) daddr;
+  (void) ep_addr;
+  (void) result;
+  (void) xferred_bytes;
+  return true;
+}
+
+void audioh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_interface_t* p_audio = &_audioh_itf[idx];
+    if (p_audio->daddr == daddr) {
+      TU_LOG_DRV("  Audio close addr = %u index = %u\r\n", daddr, idx);
+      if (p_audio->mounted && tuh_audio_umount_cb) tuh_audio_umount_cb(idx);
+      for (uint8_t i = 0; i < CFG_TUH_AUDIO_STREAM_MAX; i++) stream_clear(&p_audio->stream[i]);
+      tu_memclr(p_audio, offsetof(audioh_interface_t, stream));
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+// Record terminals and clock entities of AudioControl interface
+static void parse_ac_entity(audioh_interface_t* p_audio, uint8_t const* p_desc) {
+  uint8_t const len = tu_desc_len(p_desc);
+  uint8_t const subtype = p_desc[2];
+  uint8_t source;
+  uint8_t controls = 0;
+
+  switch (subtype) {
+    case AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL:
+      TU_VERIFY(len >= 8,);
+      source = p_desc[7];
+      break;
+
+    case AUDIO_CS_AC_INTERFACE_OUTPUT_TERMINAL:
+      TU_VERIFY(len >= 9,);
+      source = p_desc[8];
+      break;
+
+    case AUDIO_CS_AC_INTERFACE_CLOCK_SOURCE:
+      TU_VERIFY(is_uac2(p_audio) && len >= 6,);
+      source = 0;
+      controls = p_desc[5];
+      break;
+
+    case AUDIO_CS_AC_INTERFACE_CLOCK_SELECTOR:
+      TU_VERIFY(is_uac2(p_audio) && len >= 6 && p_desc[4],);
+      source = p_desc[5];
+      break;
+
+    case AUDIO_CS_AC_INTERFACE_CLOCK_MULTIPLIER:
+      TU_VERIFY(is_uac2(p_audio) && len >= 5,);
+      source = p_desc[4];
+      break;
+
+    default:
+      return;
+  }
+
+  // UAC1 terminals have no clock
+  if (!is_uac2(p_audio)) source = 0;
+
+  if (p_audio->entity_count < CFG_TUH_AUDIO_ENTITY_MAX) {
+    audioh_entity_t* entity = &p_audio->entity[p_audio->entity_count++];
+    entity->id = p_desc[3];
+    entity->subtype = subtype;
+    entity->source = source;
+    entity->controls = controls;
+  } else {
+    TU_LOG_DRV("  Audio entity %u not recorded, try to increase CFG_TUH_AUDIO_ENTITY_MAX\r\n", p_desc[3]);
+  }
+}
+
+// Type I format: UAC1 also has channels and sample rates, UAC2 only has sample size
+static void parse_format_type(audioh_interface_t const* p_audio, tuh_audio_format_t* fmt, uint8_t const* p_desc) {
+  uint8_t const len = tu_desc_len(p_desc);
+  TU_VERIFY(p_desc[3] == AUDIO_FORMAT_TYPE_I,);
+
+  if (is_uac2(p_audio)) {
+    TU_VERIFY(len >= 6,);
+    fmt->subslot_size = p_desc[4];
+    fmt->bit_resolution = p_desc[5];
+  } else {
+    TU_VERIFY(len >= 8,);
+    fmt->channels = p_desc[4];
+    fmt->subslot_size = p_desc[5];
+    fmt->bit_resolution = p_desc[6];
+
+    uint8_t const freq_type = p_desc[7];
+    uint8_t const count = freq_type ? freq_type : 2;
+    fmt->rate_continuous = (freq_type == 0);
+    fmt->rate_count = 0;
+    for (uint8_t i = 0; i < count && fmt->rate_count < CFG_TUH_AUDIO_RATE_MAX; i++) {
+      uint8_t const* rate = p_desc + 8 + 3 * i;
+      if (rate + 3 > p_desc + len) break;
+      fmt->rates[fmt->rate_count++] = tu_u32(0, rate[2], rate[1], rate[0]);
+    }
+    if (fmt->rate_continuous && fmt->rate_count < 2) fmt->rate_count = 0;
+  }
+}
+
+// Keep alternate setting if it is PCM with a data endpoint
+static void commit_alt(audioh_stream_t* stm, audioh_alt_t* alt) {
+  TU_VERIFY(alt && alt->fmt.channels && alt->fmt.subslot_size && alt->ep_data.bLength,);
+  uint8_t const dir = tu_edpt_dir(alt->ep_data.bEndpointAddress);
+  TU_VERIFY(stm->alt_count == 0 || stm->dir == dir,);
+  stm->dir = dir;
+  stm->alt_count++;
+}
+
+bool audioh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_AUDIO == desc_itf->bInterfaceClass && AUDIO_SUBCLASS_CONTROL == desc_itf->bInterfaceSubClass);
+  TU_LOG_DRV("[%u] Audio opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
+
+  audioh_interface_t* p_audio = find_new_itf();
+  TU_ASSERT(p_audio); // not enough interface, try to increase CFG_TUH_AUDIO
+
+  p_audio->daddr = daddr;
+  p_audio->itf_num = desc_itf->bInterfaceNumber;
+  p_audio->itf_last = desc_itf->bInterfaceNumber;
+  p_audio->protocol = desc_itf->bInterfaceProtocol;
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  uint8_t const* desc_end = ((uint8_t const*) desc_itf) + max_len;
+
+  bool in_ac = true;
+  audioh_stream_t* stm = NULL;
+  audioh_alt_t* alt = NULL;
+
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+
+    if (TUSB_DESC_INTERFACE == desc_type) {
+      tusb_desc_interface_t const* desc_as = (tusb_desc_interface_t const*) p_desc;
+      if (TUSB_CLASS_AUDIO != desc_as->bInterfaceClass || AUDIO_SUBCLASS_CONTROL == desc_as->bInterfaceSubClass) break;
+
+      if (stm) commit_alt(stm, alt);
+      in_ac = false;
+      stm = NULL;
+      alt = NULL;
+      p_audio->itf_last = tu_max8(p_audio->itf_last, desc_as->bInterfaceNumber);
+
+      // MIDI streaming interface is skipped
+      if (AUDIO_SUBCLASS_STREAMING == desc_as->bInterfaceSubClass) {
+        for (uint8_t i = 0; i < p_audio->stream_count; i++) {
+          if (p_audio->stream[i].itf_num == desc_as->bInterfaceNumber) stm = &p_audio->stream[i];
+        }
+        if (stm == NULL && p_audio->stream_count < CFG_TUH_AUDIO_STREAM_MAX) {
+          stm = &p_audio->stream[p_audio->stream_count++];
+          stm->itf_num = desc_as->bInterfaceNumber;
+        }
+
+        // alternate 0 is zero-bandwidth
+        if (stm && desc_as->bAlternateSetting && desc_as->bNumEndpoints && stm->alt_count < CFG_TUH_AUDIO_ALT_MAX) {
+          alt = &stm->alt[stm->alt_count];
+          tu_memclr(alt, sizeof(audioh_alt_t));
+          alt->fmt.alt = desc_as->bAlternateSetting;
+        }
+      }
+    } else if (TUSB_DESC_CS_INTERFACE == desc_type && tu_desc_len(p_desc) >= 4) {
+      if (in_ac) {
+        parse_ac_entity(p_audio, p_desc);
+      } else if (stm && p_desc[2] == AUDIO_CS_AS_INTERFACE_AS_GENERAL) {
+        stm->terminal_link = p_desc[3];
+        if (alt && is_uac2(p_audio) && tu_desc_len(p_desc) >= 11 && p_desc[5] == AUDIO_FORMAT_TYPE_I) {
+          alt->fmt.channels = p_desc[10];
+        }
+      } else if (alt && p_desc[2] == AUDIO_CS_AS_INTERFACE_FORMAT_TYPE) {
+        parse_format_type(p_audio, &alt->fmt, p_desc);
+      }
+    } else if (TUSB_DESC_ENDPOINT == desc_type && alt) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_ISOCHRONOUS == desc_ep->bmAttributes.xfer) {
+        // UAC1 synch endpoint has no usage type, it is the endpoint in opposite direction of data
+        bool const is_fb = (desc_ep->bmAttributes.usage == 1) ||
+                           (alt->ep_data.bLength &&
+                            tu_edpt_dir(desc_ep->bEndpointAddress) != tu_edpt_dir(alt->ep_data.bEndpointAddress));
+        tusb_desc_endpoint_t* ep = is_fb ? &alt->ep_fb : &alt->ep_data;
+        memcpy(ep, desc_ep, sizeof(tusb_desc_endpoint_t));
+        ep->bLength = sizeof(tusb_desc_endpoint_t); // UAC1 endpoint descriptor is 9 bytes
+      }
+    } else if (TUSB_DESC_CS_ENDPOINT == desc_type && alt && !is_uac2(p_audio) && tu_desc_len(p_desc) >= 4 &&
+               p_desc[2] == AUDIO_CS_EP_SUBTYPE_GENERAL) {
+      alt->rate_ctrl = (p_desc[3] & 0x01) != 0;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+  if (stm) commit_alt(stm, alt);
+
+  // drop streams without usable format
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < p_audio->stream_count; i++) {
+    if (p_audio->stream[i].alt_count) {
+      if (count != i) memcpy(&p_audio->stream[count], &p_audio->stream[i], offsetof(audioh_stream_t, ff_buf));
+      count++;
+    }
+  }
+  p_audio->stream_count = count;
+
+  if (count == 0) {
+    TU_LOG_DRV("  Audio function has no PCM stream\r\n");
+    for (uint8_t i = 0; i < CFG_TUH_AUDIO_STREAM_MAX; i++) stream_clear(&p_audio->stream[i]);
+    tu_memclr(p_audio, offsetof(audioh_interface_t, stream));
+    return false;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    audioh_stream_t* s = &p_audio->stream[i];
+    // capture ring overwrites oldest samples to bound latency
+    tu_fifo_config(&s->ff, s->ff_buf, CFG_TUH_AUDIO_FIFO_SIZE, 1, s->dir == TUSB_DIR_IN);
+    TU_LOG_DRV("  Audio stream %u: interface %u %s, %u formats\r\n", i, s->itf_num,
+               s->dir == TUSB_DIR_IN ? "IN" : "OUT", s->alt_count);
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Set Configure
+//--------------------------------------------------------------------+
+bool audioh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_audio_itf_get_index(daddr, itf_num);
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_ASSERT(p_audio);
+
+  // streaming interfaces are in zero-bandwidth alternate after SET_CONFIGURATION, nothing to configure
+  p_audio->mounted = true;
+  TU_LOG_DRV("[%u] Audio mounted: UAC%u, %u streams\r\n", daddr, is_uac2(p_audio) ? 2 : 1, p_audio->stream_count);
+  if (tuh_audio_mount_cb) tuh_audio_mount_cb(idx);
+
+  // itf_last to account for streaming interfaces as well
+  usbh_driver_set_config_complete(daddr, p_audio->itf_last);
+  return true;
+}
+
+#endif
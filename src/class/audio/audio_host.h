@@ -0,0 +1,188 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_AUDIO_HOST_H_
+#define _TUSB_AUDIO_HOST_H_
+
+#include "audio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//
+// Host driver for USB Audio Class 1.0 and 2.0 functions (microphones, DACs, headsets). Each AudioStreaming
+// interface is a stream, which is opened with a PCM format and sample rate and then runs continuously:
+// - IN (capture) stream: received packets are pushed into a receive ring, read with tuh_audio_read().
+//   The ring overwrites the oldest samples when it is not drained in time to keep latency bounded.
+// - OUT (playback) stream: samples written with tuh_audio_write() are sent in packets sized from the sample
+//   rate, or from the explicit feedback endpoint of asynchronous sinks. Silence is sent on underrun.
+// Two transfers of CFG_TUH_AUDIO_PACKETS_PER_XFER packets are used in turn so that the next one is submitted
+// before received data is copied. API must be called from the same task as tuh_task().
+// Require CFG_TUH_API_EDPT_XFER and a host controller with isochronous support.
+//--------------------------------------------------------------------+
+
+// Maximum number of AudioStreaming interfaces per audio function
+#ifndef CFG_TUH_AUDIO_STREAM_MAX
+  #define CFG_TUH_AUDIO_STREAM_MAX        2
+#endif
+
+// Maximum number of alternate settings (formats) recorded per AudioStreaming interface
+#ifndef CFG_TUH_AUDIO_ALT_MAX
+  #define CFG_TUH_AUDIO_ALT_MAX           4
+#endif
+
+// Maximum number of discrete sample rates recorded per format (UAC1)
+#ifndef CFG_TUH_AUDIO_RATE_MAX
+  #define CFG_TUH_AUDIO_RATE_MAX          4
+#endif
+
+// Maximum number of terminal and clock entities recorded per audio function
+#ifndef CFG_TUH_AUDIO_ENTITY_MAX
+  #define CFG_TUH_AUDIO_ENTITY_MAX        8
+#endif
+
+// Number of isochronous packets (service intervals) per transfer, latency of a stream is about 2 transfers
+#ifndef CFG_TUH_AUDIO_PACKETS_PER_XFER
+  #define CFG_TUH_AUDIO_PACKETS_PER_XFER  8
+#endif
+
+// Size of each of the 2 transfer buffers of a stream, limits packets per transfer for large packets
+#ifndef CFG_TUH_AUDIO_EP_BUFSIZE
+  #define CFG_TUH_AUDIO_EP_BUFSIZE        1024
+#endif
+
+// Size of sample ring of each stream
+#ifndef CFG_TUH_AUDIO_FIFO_SIZE
+  #define CFG_TUH_AUDIO_FIFO_SIZE         2048
+#endif
+
+// PCM format of an alternate setting of an AudioStreaming interface
+typedef struct {
+  uint8_t alt;                // alternate setting
+  uint8_t channels;
+  uint8_t subslot_size;       // bytes per sample of a channel
+  uint8_t bit_resolution;
+  bool    rate_continuous;    // rates[0] - rates[1] is a continuous range
+  uint8_t rate_count;         // 0 if sample rates are not described by descriptors (UAC2)
+  uint32_t rates[CFG_TUH_AUDIO_RATE_MAX];
+} tuh_audio_format_t;
+
+typedef struct {
+  uint8_t itf_num;            // AudioStreaming interface number
+  uint8_t dir;                // TUSB_DIR_IN for capture, TUSB_DIR_OUT for playback
+  uint8_t terminal_link;      // terminal ID the interface is connected to
+  uint8_t format_count;
+  bool    feedback;           // at least one format has an explicit feedback endpoint
+} tuh_audio_stream_info_t;
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+
+// Get audio function index from device address + AudioControl interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_audio_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Check if audio function is mounted
+bool tuh_audio_mounted(uint8_t idx);
+
+// Get Audio Device Class version: 1 or 2, 0 if not mounted
+uint8_t tuh_audio_version(uint8_t idx);
+
+// Get number of AudioStreaming interfaces
+uint8_t tuh_audio_stream_count(uint8_t idx);
+
+// Get information of a stream
+bool tuh_audio_stream_info(uint8_t idx, uint8_t stm, tuh_audio_stream_info_t* info);
+
+// Get n-th format of a stream
+bool tuh_audio_stream_format(uint8_t idx, uint8_t stm, uint8_t n, tuh_audio_format_t* format);
+
+//--------------------------------------------------------------------+
+// Streaming API
+//--------------------------------------------------------------------+
+
+// Select format matching channels and bit resolution (0 matches any), set sample rate and start streaming.
+// tuh_audio_stream_open_cb() is invoked when stream is running or failed to start
+bool tuh_audio_stream_open(uint8_t idx, uint8_t stm, uint8_t channels, uint8_t bit_resolution, uint32_t rate);
+
+// Stop streaming and select zero-bandwidth alternate setting
+bool tuh_audio_stream_close(uint8_t idx, uint8_t stm);
+
+// Check if stream is running
+bool tuh_audio_stream_active(uint8_t idx, uint8_t stm);
+
+// Get bytes per audio frame (all channels of a sample) of the running stream, 0 if not running
+uint8_t tuh_audio_stream_frame_size(uint8_t idx, uint8_t stm);
+
+// Read captured samples of an IN stream, return number of bytes read
+uint32_t tuh_audio_read(uint8_t idx, uint8_t stm, void* buffer, uint32_t bufsize);
+
+// Queue samples to an OUT stream, should be whole audio frames. Return number of bytes queued
+uint32_t tuh_audio_write(uint8_t idx, uint8_t stm, void const* buffer, uint32_t bufsize);
+
+// Number of bytes in sample ring: captured bytes of IN stream, or queued bytes of OUT stream
+uint32_t tuh_audio_available(uint8_t idx, uint8_t stm);
+
+// Number of bytes that can be queued to an OUT stream
+uint32_t tuh_audio_write_available(uint8_t idx, uint8_t stm);
+
+//--------------------------------------------------------------------+
+// Application Callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when an audio function is mounted
+TU_ATTR_WEAK void tuh_audio_mount_cb(uint8_t idx);
+
+// Invoked when an audio function is unmounted
+TU_ATTR_WEAK void tuh_audio_umount_cb(uint8_t idx);
+
+// Invoked when tuh_audio_stream_open() completes
+TU_ATTR_WEAK void tuh_audio_stream_open_cb(uint8_t idx, uint8_t stm, bool success);
+
+// Invoked when a transfer of an IN stream is received, with number of bytes pushed to sample ring
+TU_ATTR_WEAK void tuh_audio_rx_cb(uint8_t idx, uint8_t stm, uint32_t xferred_bytes);
+
+// Invoked when a transfer of an OUT stream is sent, sample ring can be refilled
+TU_ATTR_WEAK void tuh_audio_tx_cb(uint8_t idx, uint8_t stm);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void audioh_init(void);
+bool audioh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool audioh_set_config(uint8_t daddr, uint8_t itf_num);
+bool audioh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void audioh_close(uint8_t daddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TUSB_AUDIO_HOST_H_ */
@@ -0,0 +1,319 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_BRIDGE
+
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+
+#include "usb_bridge.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t d_itf;     // device side interface number
+  uint8_t d_ep;      // device side endpoint address, 0 if not bound
+  uint8_t h_daddr;   // host side device address, 0 if not attached
+  uint8_t h_ep;      // host side endpoint address
+
+  uint8_t d_rhport;
+  bool    d_ready;   // device side endpoint opened
+
+  // ring: buffers [tx_idx, tx_idx+count) are filled and waiting to be sent, reception goes to rx_idx
+  uint8_t rx_idx;
+  uint8_t tx_idx;
+  uint8_t count;
+  bool    rx_busy;
+  bool    tx_busy;
+
+  uint16_t len[CFG_TUSB_BRIDGE_BUFNUM];
+} bridge_pipe_t;
+
+typedef struct {
+  TUD_EPBUF_DEF(buf, CFG_TUSB_BRIDGE_BUFNUM * CFG_TUSB_BRIDGE_BUFSIZE);
+} bridge_epbuf_t;
+
+static bridge_pipe_t _bridge_pipe[CFG_TUSB_BRIDGE];
+CFG_TUD_MEM_SECTION static bridge_epbuf_t _bridge_epbuf[CFG_TUSB_BRIDGE];
+
+#if OSAL_MUTEX_REQUIRED
+// pipe state is shared by usbd and usbh task
+static OSAL_MUTEX_DEF(_bridge_mutex_def);
+static osal_mutex_t _bridge_mutex;
+
+#define _bridge_lock()    osal_mutex_lock(_bridge_mutex, OSAL_TIMEOUT_WAIT_FOREVER)
+#define _bridge_unlock()  osal_mutex_unlock(_bridge_mutex)
+#else
+#define _bridge_lock()
+#define _bridge_unlock()
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* pipe_buf(uint8_t idx, uint8_t buf_idx) {
+  return _bridge_epbuf[idx].buf + buf_idx * CFG_TUSB_BRIDGE_BUFSIZE;
+}
+
+// data flows from attached device to our host (host IN -> device IN), otherwise from our host to attached device
+TU_ATTR_ALWAYS_INLINE static inline bool pipe_h2d(bridge_pipe_t const* p) {
+  return tu_edpt_dir(p->h_ep) == TUSB_DIR_IN;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool pipe_ready(bridge_pipe_t const* p) {
+  return p->d_ready && p->h_daddr != 0;
+}
+
+//--------------------------------------------------------------------+
+// Forwarding
+//--------------------------------------------------------------------+
+static void host_xfer_complete(tuh_xfer_t* xfer);
+
+// submit transfer on host or device side of pipe
+static bool side_xfer(uint8_t idx, bool host_side, uint8_t buf_idx, uint16_t len) {
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+  uint8_t* buf = pipe_buf(idx, buf_idx);
+
+  if (host_side) {
+    tuh_xfer_t xfer = {
+      .daddr       = p->h_daddr,
+      .ep_addr     = p->h_ep,
+      .buflen      = len,
+      .buffer      = buf,
+      .complete_cb = host_xfer_complete,
+      .user_data   = idx
+    };
+    return tuh_edpt_xfer(&xfer);
+  } else {
+    TU_VERIFY(usbd_edpt_claim(p->d_rhport, p->d_ep));
+    if (!usbd_edpt_xfer(p->d_rhport, p->d_ep, buf, len)) {
+      usbd_edpt_release(p->d_rhport, p->d_ep);
+      return false;
+    }
+    return true;
+  }
+}
+
+// start reception into next free buffer and/or sending of oldest filled buffer
+static void pipe_kick(uint8_t idx) {
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+  if (!pipe_ready(p)) return;
+
+  bool const h2d = pipe_h2d(p);
+
+  // buffer being received is not counted yet
+  if (!p->rx_busy && p->count < CFG_TUSB_BRIDGE_BUFNUM) {
+    if (side_xfer(idx, h2d, p->rx_idx, CFG_TUSB_BRIDGE_BUFSIZE)) p->rx_busy = true;
+  }
+
+  if (!p->tx_busy && p->count) {
+    if (side_xfer(idx, !h2d, p->tx_idx, p->len[p->tx_idx])) p->tx_busy = true;
+  }
+}
+
+// completion of receiving or sending side
+static void pipe_xfer_done(uint8_t idx, bool host_side, xfer_result_t result, uint32_t xferred_bytes) {
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+
+  _bridge_lock();
+
+  if (host_side == pipe_h2d(p)) {
+    // receiving side, failed reception is not resubmitted until pipe is re-attached/configured
+    if (p->rx_busy) {
+      p->rx_busy = false;
+      if (result == XFER_RESULT_SUCCESS) {
+        p->len[p->rx_idx] = (uint16_t) xferred_bytes;
+        p->rx_idx = (uint8_t) ((p->rx_idx + 1) % CFG_TUSB_BRIDGE_BUFNUM);
+        p->count++;
+        pipe_kick(idx);
+      }
+    }
+  } else {
+    // sending side: buffer is released even if failed
+    if (p->tx_busy) {
+      p->tx_busy = false;
+      p->tx_idx = (uint8_t) ((p->tx_idx + 1) % CFG_TUSB_BRIDGE_BUFNUM);
+      p->count--;
+      pipe_kick(idx);
+    }
+  }
+
+  _bridge_unlock();
+}
+
+static void host_xfer_complete(tuh_xfer_t* xfer) {
+  pipe_xfer_done((uint8_t) xfer->user_data, true, xfer->result, xfer->actual_len);
+}
+
+// one side went away: drop queued buffers, keep the one still in flight on the other side
+static void pipe_flush(bridge_pipe_t* p, bool host_side) {
+  bool const rx_side_gone = (host_side == pipe_h2d(p));
+
+  if (rx_side_gone) {
+    p->rx_busy = false;
+  } else {
+    p->tx_busy = false;
+  }
+
+  if (p->tx_busy) {
+    // only buffer being sent is kept
+    p->count  = 1;
+    p->rx_idx = (uint8_t) ((p->tx_idx + 1) % CFG_TUSB_BRIDGE_BUFNUM);
+  } else if (p->rx_busy) {
+    // only buffer being received is kept
+    p->count  = 0;
+    p->tx_idx = p->rx_idx;
+  } else {
+    p->count  = 0;
+    p->rx_idx = 0;
+    p->tx_idx = 0;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tusb_bridge_device_bind(uint8_t idx, uint8_t itf_num, uint8_t ep_addr) {
+  TU_VERIFY(idx < CFG_TUSB_BRIDGE && tu_edpt_number(ep_addr) != 0);
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+
+  _bridge_lock();
+  p->d_itf = itf_num;
+  p->d_ep  = ep_addr;
+  _bridge_unlock();
+
+  return true;
+}
+
+bool tusb_bridge_host_attach(uint8_t idx, uint8_t daddr, uint8_t ep_addr) {
+  TU_VERIFY(idx < CFG_TUSB_BRIDGE && daddr != 0);
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+
+  // data either flows host IN -> device IN or device OUT -> host OUT
+  TU_VERIFY(p->d_ep == 0 || tu_edpt_dir(p->d_ep) == tu_edpt_dir(ep_addr));
+
+  _bridge_lock();
+  p->h_daddr = daddr;
+  p->h_ep    = ep_addr;
+  pipe_kick(idx);
+  _bridge_unlock();
+
+  return true;
+}
+
+void tusb_bridge_host_detach(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUSB_BRIDGE,);
+  bridge_pipe_t* p = &_bridge_pipe[idx];
+
+  _bridge_lock();
+  if (p->h_daddr) {
+    // transfers of removed device are not completed by usbh
+    pipe_flush(p, true);
+    p->h_daddr = 0;
+  }
+  _bridge_unlock();
+}
+
+bool tusb_bridge_ready(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUSB_BRIDGE);
+  return pipe_ready(&_bridge_pipe[idx]);
+}
+
+//--------------------------------------------------------------------+
+// USBD Driver API
+//--------------------------------------------------------------------+
+void bridged_init(void) {
+  tu_memclr(_bridge_pipe, sizeof(_bridge_pipe));
+#if OSAL_MUTEX_REQUIRED
+  _bridge_mutex = osal_mutex_create(&_bridge_mutex_def);
+#endif
+}
+
+void bridged_reset(uint8_t rhport) {
+  (void) rhport;
+
+  _bridge_lock();
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE; i++) {
+    bridge_pipe_t* p = &_bridge_pipe[i];
+    if (p->d_ready) {
+      pipe_flush(p, false);
+      p->d_ready = false;
+    }
+  }
+  _bridge_unlock();
+}
+
+uint16_t bridged_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len) {
+  // claim interface only if any pipe is bound to it
+  bool bound = false;
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE; i++) {
+    if (_bridge_pipe[i].d_ep && _bridge_pipe[i].d_itf == itf_desc->bInterfaceNumber) bound = true;
+  }
+  TU_VERIFY(bound, 0);
+
+  uint8_t const* p_desc  = (uint8_t const*) itf_desc;
+  uint8_t const* desc_end = p_desc + max_len;
+  uint16_t drv_len = tu_desc_len(p_desc);
+  p_desc = tu_desc_next(p_desc);
+
+  // all endpoints of interface (and its class-specific descriptors) until next interface
+  while (p_desc < desc_end && tu_desc_type(p_desc) != TUSB_DESC_INTERFACE &&
+         tu_desc_type(p_desc) != TUSB_DESC_INTERFACE_ASSOCIATION) {
+    if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+
+      for (uint8_t i = 0; i < CFG_TUSB_BRIDGE; i++) {
+        bridge_pipe_t* p = &_bridge_pipe[i];
+        if (p->d_itf == itf_desc->bInterfaceNumber && p->d_ep == desc_ep->bEndpointAddress) {
+          _bridge_lock();
+          p->d_rhport = rhport;
+          p->d_ready  = true;
+          pipe_kick(i);
+          _bridge_unlock();
+        }
+      }
+    }
+
+    drv_len += tu_desc_len(p_desc);
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return drv_len;
+}
+
+bool bridged_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE; i++) {
+    bridge_pipe_t* p = &_bridge_pipe[i];
+    if (p->d_ready && p->d_rhport == rhport && p->d_ep == ep_addr) {
+      pipe_xfer_done(i, false, result, xferred_bytes);
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+#ifndef _TUSB_USB_BRIDGE_H_
+#define _TUSB_USB_BRIDGE_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Bridge pipe connects an endpoint of a device attached to our host port with an endpoint of our device port.
+// Data is received into a ring of CFG_TUSB_BRIDGE_BUFNUM shared buffers on one side and each filled buffer is
+// submitted as is on the other side (never copied). Reception pauses while all buffers are in use (flow
+// control) and resumes as soon as one is sent. Transfer boundaries are preserved: each received transfer
+// (ended by short packet or full buffer) is sent as one transfer, zero-length included.
+//
+// Direction follows the endpoints: host IN -> device IN, or device OUT -> host OUT.
+//  - Device side: pipe is bound to an interface/endpoint of our configuration descriptor, the interface
+//    is claimed and its endpoints opened by the bridge driver on SET_CONFIGURATION.
+//  - Host side: application opens the endpoint of attached device (e.g tuh_edpt_open() in tuh_mount_cb())
+//    then attaches it to the pipe. Requires CFG_TUH_API_EDPT_XFER.
+// Forwarding starts when both sides are ready, and only buffers not in flight are dropped when one side
+// goes away. Buffers are placed in CFG_TUD_MEM_SECTION which must also be accessible by host controller.
+//--------------------------------------------------------------------+
+
+// Number of buffers in the ring of each pipe
+#ifndef CFG_TUSB_BRIDGE_BUFNUM
+  #define CFG_TUSB_BRIDGE_BUFNUM    2
+#endif
+
+// Size of each buffer, should be a multiple of max packet size of both endpoints
+#ifndef CFG_TUSB_BRIDGE_BUFSIZE
+  #define CFG_TUSB_BRIDGE_BUFSIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Bind pipe to an endpoint of device side interface itf_num, effective on next SET_CONFIGURATION
+bool tusb_bridge_device_bind(uint8_t idx, uint8_t itf_num, uint8_t ep_addr);
+
+// Attach pipe to an opened endpoint of attached device daddr, forwarding starts when device side is configured
+bool tusb_bridge_host_attach(uint8_t idx, uint8_t daddr, uint8_t ep_addr);
+
+// Detach host side e.g in tuh_umount_cb(), data not in flight is dropped
+void tusb_bridge_host_detach(uint8_t idx);
+
+// Check if both sides of pipe are ready and forwarding
+bool tusb_bridge_ready(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     bridged_init(void);
+void     bridged_reset(uint8_t rhport);
+uint16_t bridged_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
+bool     bridged_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_USB_BRIDGE_H_ */
@@ -37,19 +37,55 @@
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
 typedef struct
 {
+  void* data;
+  uint16_t len;
+} btd_tx_item_t;
+
+typedef struct
+{
+  tu_fifo_t ff;
+  btd_tx_item_t ff_buf[CFG_TUD_BTH_TX_QUEUE_DEPTH];
+  OSAL_MUTEX_DEF(ff_mutex);
+} btd_tx_queue_t;
+#endif
+
+typedef struct
+{
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_ev;
   uint8_t ep_acl_in;
   uint8_t ep_acl_out;
-  uint8_t ep_voice[2];  // Not used yet
-  uint8_t ep_voice_size[2][CFG_TUD_BTH_ISO_ALT_COUNT];
+  uint8_t ep_voice[2];
+  uint16_t ep_voice_size[2][CFG_TUD_BTH_ISO_ALT_COUNT];
+
+#if CFG_TUD_BTH_SCO
+  uint8_t const* desc_iso; // first alternate setting of isochronous interface
+  uint16_t desc_iso_len;
+  uint8_t sco_alt;
+  bool sco_tx_started;     // IN ring was half filled, a packet is sent every (micro)frame
+
+  // Voice rings, sized to whole packets of selected alternate setting
+  tu_fifo_t sco_rx_ff;
+  tu_fifo_t sco_tx_ff;
+  uint8_t sco_rx_ff_buf[CFG_TUD_BTH_SCO_PACKETS * CFG_TUD_BTH_SCO_EPSIZE];
+  uint8_t sco_tx_ff_buf[CFG_TUD_BTH_SCO_PACKETS * CFG_TUD_BTH_SCO_EPSIZE];
+  OSAL_MUTEX_DEF(sco_rx_ff_mutex);
+  OSAL_MUTEX_DEF(sco_tx_ff_mutex);
+#endif
 
   // Endpoint Transfer buffer
-  CFG_TUSB_MEM_ALIGN bt_hci_cmd_t hci_cmd;
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_BTH_DATA_EPSIZE];
+  TUD_EPBUF_TYPE_DEF(bt_hci_cmd_t, hci_cmd);
+  TUD_EPBUF_DEF(epout_buf, CFG_TUD_BTH_DATA_EPSIZE);
 
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+  // Packets submitted by application for event and ACL IN endpoint
+  btd_tx_queue_t ev_queue;
+  btd_tx_queue_t acl_queue;
+#endif
 } btd_interface_t;
 
 //--------------------------------------------------------------------+
@@ -57,9 +93,36 @@ typedef struct
 //--------------------------------------------------------------------+
 CFG_TUD_MEM_SECTION btd_interface_t _btd_itf;
 
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+// Start next queued packet if endpoint is idle. Item is removed from queue once
+// endpoint is claimed, completion is reported in the same order.
+static void bt_tx_queue_kick(btd_tx_queue_t* queue, uint8_t ep)
+{
+  uint8_t const rhport = _btd_itf.rhport;
+
+  if ( !usbd_edpt_claim(rhport, ep) ) return;
+
+  btd_tx_item_t item;
+  if ( !tu_fifo_read(&queue->ff, &item) || !usbd_edpt_xfer(rhport, ep, item.data, item.len) )
+  {
+    usbd_edpt_release(rhport, ep);
+  }
+}
+
+static bool bt_tx_data(btd_tx_queue_t* queue, uint8_t ep, void *data, uint16_t len)
+{
+  TU_VERIFY(ep && tud_n_ready(_btd_itf.rhport));
+
+  btd_tx_item_t const item = { .data = data, .len = len };
+  TU_VERIFY(tu_fifo_write(&queue->ff, &item));
+
+  bt_tx_queue_kick(queue, ep);
+  return true;
+}
+#else
 static bool bt_tx_data(uint8_t ep, void *data, uint16_t len)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _btd_itf.rhport;
 
   // skip if previous transfer not complete
   TU_VERIFY(!usbd_edpt_busy(rhport, ep));
@@ -68,16 +131,173 @@ static bool bt_tx_data(uint8_t ep, void *data, uint16_t len)
 
   return true;
 }
+#endif
+
+#if CFG_TUD_BTH_SCO
+// Send next IN packet: nothing (ZLP) until ring is half filled, then one packet per (micro)frame
+static void sco_tx_xfer(uint8_t rhport)
+{
+  tu_fifo_t* ff = &_btd_itf.sco_tx_ff;
+  uint8_t const ep = _btd_itf.ep_voice[TUSB_DIR_IN];
+  uint16_t const ep_size = _btd_itf.ep_voice_size[TUSB_DIR_IN][_btd_itf.sco_alt];
+  uint16_t count = tu_fifo_count(ff);
+
+  if ( !_btd_itf.sco_tx_started ) _btd_itf.sco_tx_started = (count >= tu_fifo_depth(ff) / 2);
+
+  // underrun: buffer again to get back to constant latency
+  if ( count == 0 ) _btd_itf.sco_tx_started = false;
+
+  if ( _btd_itf.sco_tx_started )
+  {
+    TU_ASSERT(usbd_edpt_xfer_fifo(rhport, ep, ff, tu_min16(count, ep_size)), );
+  }else
+  {
+    TU_ASSERT(usbd_edpt_xfer(rhport, ep, NULL, 0), );
+  }
+}
+
+static void sco_rx_xfer(uint8_t rhport)
+{
+  uint16_t const ep_size = _btd_itf.ep_voice_size[TUSB_DIR_OUT][_btd_itf.sco_alt];
+
+  // ring is overwritable: oldest data is dropped if application does not keep up
+  TU_ASSERT(usbd_edpt_xfer_fifo(rhport, _btd_itf.ep_voice[TUSB_DIR_OUT], &_btd_itf.sco_rx_ff, ep_size), );
+}
+
+static void sco_ff_config(tu_fifo_t* ff, uint8_t* buf, uint16_t ep_size, bool overwritable)
+{
+  // FIFO holds whole packets such that a packet never gets split by a wrap
+  uint16_t depth = (uint16_t) (CFG_TUD_BTH_SCO_PACKETS * ep_size);
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  while ( depth && !tu_is_power_of_two(depth) ) depth = (uint16_t) (depth & (depth - 1));
+#endif
+  tu_fifo_config(ff, buf, depth, 1, overwritable);
+}
+
+static bool sco_set_interface(uint8_t rhport, uint8_t alt)
+{
+  TU_VERIFY(alt < CFG_TUD_BTH_ISO_ALT_COUNT);
+
+  // stop streaming of previous alternate
+  if ( _btd_itf.sco_alt )
+  {
+    for ( uint8_t dir = 0; dir < 2; dir++ )
+    {
+      if ( _btd_itf.ep_voice_size[dir][_btd_itf.sco_alt] ) usbd_edpt_close(rhport, _btd_itf.ep_voice[dir]);
+    }
+  }
+  _btd_itf.sco_alt = 0;
+  _btd_itf.sco_tx_started = false;
+  tu_fifo_clear(&_btd_itf.sco_rx_ff);
+  tu_fifo_clear(&_btd_itf.sco_tx_ff);
+
+  if ( alt )
+  {
+    // activate endpoints of selected alternate
+    uint8_t const* p_desc = _btd_itf.desc_iso;
+    uint8_t const* desc_end = p_desc + _btd_itf.desc_iso_len;
+    bool in_alt = false;
+
+    while ( p_desc < desc_end )
+    {
+      if ( TUSB_DESC_INTERFACE == tu_desc_type(p_desc) )
+      {
+        in_alt = (((tusb_desc_interface_t const*) p_desc)->bAlternateSetting == alt);
+      }
+      else if ( in_alt && TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+      {
+        tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+        if ( tu_edpt_packet_size(desc_ep) ) TU_ASSERT(usbd_edpt_iso_activate(rhport, desc_ep));
+      }
+      p_desc = tu_desc_next(p_desc);
+    }
+
+    uint16_t const out_size = _btd_itf.ep_voice_size[TUSB_DIR_OUT][alt];
+    uint16_t const in_size  = _btd_itf.ep_voice_size[TUSB_DIR_IN][alt];
+    _btd_itf.sco_alt = alt;
+
+    if ( out_size )
+    {
+      sco_ff_config(&_btd_itf.sco_rx_ff, _btd_itf.sco_rx_ff_buf, out_size, true);
+      sco_rx_xfer(rhport);
+    }
+
+    if ( in_size )
+    {
+      sco_ff_config(&_btd_itf.sco_tx_ff, _btd_itf.sco_tx_ff_buf, in_size, false);
+      sco_tx_xfer(rhport);
+    }
+  }
+
+  if (tud_bt_sco_set_itf_cb) tud_bt_sco_set_itf_cb(alt);
+
+  return true;
+}
+#endif
 
 //--------------------------------------------------------------------+
 // READ API
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_BTH_SCO
+uint8_t tud_bt_sco_alt(void)
+{
+  return _btd_itf.sco_alt;
+}
+
+uint32_t tud_bt_sco_available(void)
+{
+  return tu_fifo_count(&_btd_itf.sco_rx_ff);
+}
+
+uint32_t tud_bt_sco_read(void* buffer, uint32_t bufsize)
+{
+  TU_VERIFY(_btd_itf.sco_alt, 0);
+  return tu_fifo_read_n(&_btd_itf.sco_rx_ff, buffer, (uint16_t) tu_min32(bufsize, UINT16_MAX));
+}
+#endif
 
 //--------------------------------------------------------------------+
 // WRITE API
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_BTH_SCO
+uint32_t tud_bt_sco_write_available(void)
+{
+  return _btd_itf.sco_alt ? tu_fifo_remaining(&_btd_itf.sco_tx_ff) : 0;
+}
+
+uint32_t tud_bt_sco_write(void const* buffer, uint32_t bufsize)
+{
+  TU_VERIFY(_btd_itf.sco_alt && _btd_itf.ep_voice_size[TUSB_DIR_IN][_btd_itf.sco_alt], 0);
+  return tu_fifo_write_n(&_btd_itf.sco_tx_ff, buffer, (uint16_t) tu_min32(bufsize, UINT16_MAX));
+}
+#endif
+
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+
+bool tud_bt_event_send(void *event, uint16_t event_len)
+{
+  return bt_tx_data(&_btd_itf.ev_queue, _btd_itf.ep_ev, event, event_len);
+}
+
+bool tud_bt_acl_data_send(void *event, uint16_t event_len)
+{
+  return bt_tx_data(&_btd_itf.acl_queue, _btd_itf.ep_acl_in, event, event_len);
+}
+
+uint16_t tud_bt_event_send_available(void)
+{
+  return tu_fifo_remaining(&_btd_itf.ev_queue.ff);
+}
+
+uint16_t tud_bt_acl_data_send_available(void)
+{
+  return tu_fifo_remaining(&_btd_itf.acl_queue.ff);
+}
+
+#else
+
 bool tud_bt_event_send(void *event, uint16_t event_len)
 {
   return bt_tx_data(_btd_itf.ep_ev, event, event_len);
@@ -88,17 +308,59 @@ bool tud_bt_acl_data_send(void *event, uint16_t event_len)
   return bt_tx_data(_btd_itf.ep_acl_in, event, event_len);
 }
 
+uint16_t tud_bt_event_send_available(void)
+{
+  return usbd_edpt_busy(_btd_itf.rhport, _btd_itf.ep_ev) ? 0 : 1;
+}
+
+uint16_t tud_bt_acl_data_send_available(void)
+{
+  return usbd_edpt_busy(_btd_itf.rhport, _btd_itf.ep_acl_in) ? 0 : 1;
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
 void btd_init(void)
 {
   tu_memclr(&_btd_itf, sizeof(_btd_itf));
+
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+  btd_tx_queue_t* queues[] = { &_btd_itf.ev_queue, &_btd_itf.acl_queue };
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    tu_fifo_config(&queues[i]->ff, queues[i]->ff_buf, CFG_TUD_BTH_TX_QUEUE_DEPTH, sizeof(btd_tx_item_t), false);
+    tu_fifo_config_mutex(&queues[i]->ff, osal_mutex_create(&queues[i]->ff_mutex), NULL);
+  }
+#endif
+
+#if CFG_TUD_BTH_SCO
+  // depth is set per alternate setting
+  tu_fifo_config(&_btd_itf.sco_rx_ff, _btd_itf.sco_rx_ff_buf, sizeof(_btd_itf.sco_rx_ff_buf), 1, true);
+  tu_fifo_config(&_btd_itf.sco_tx_ff, _btd_itf.sco_tx_ff_buf, sizeof(_btd_itf.sco_tx_ff_buf), 1, false);
+  tu_fifo_config_mutex(&_btd_itf.sco_rx_ff, NULL, osal_mutex_create(&_btd_itf.sco_rx_ff_mutex));
+  tu_fifo_config_mutex(&_btd_itf.sco_tx_ff, osal_mutex_create(&_btd_itf.sco_tx_ff_mutex), NULL);
+#endif
 }
 
 void btd_reset(uint8_t rhport)
 {
   (void)rhport;
+
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+  tu_fifo_clear(&_btd_itf.ev_queue.ff);
+  tu_fifo_clear(&_btd_itf.acl_queue.ff);
+#endif
+
+#if CFG_TUD_BTH_SCO
+  // endpoints are closed by usbd
+  _btd_itf.sco_alt = 0;
+  _btd_itf.sco_tx_started = false;
+  tu_fifo_clear(&_btd_itf.sco_rx_ff);
+  tu_fifo_clear(&_btd_itf.sco_tx_ff);
+#endif
 }
 
 uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len)
@@ -116,6 +378,7 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
 
   TU_ASSERT(itf_desc->bNumEndpoints == 3 && max_len >= hci_itf_size);
 
+  _btd_itf.rhport  = rhport;
   _btd_itf.itf_num = itf_desc->bInterfaceNumber;
 
   desc_ep = (tusb_desc_endpoint_t const *) tu_desc_next(itf_desc);
@@ -143,20 +406,24 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
 
   uint8_t dir;
 
+#if CFG_TUD_BTH_SCO
+  _btd_itf.desc_iso = (uint8_t const *) itf_desc;
+#endif
+
   desc_ep = (tusb_desc_endpoint_t const *)tu_desc_next(itf_desc);
   TU_ASSERT(itf_desc->bAlternateSetting < CFG_TUD_BTH_ISO_ALT_COUNT, 0);
   TU_ASSERT(desc_ep->bDescriptorType == TUSB_DESC_ENDPOINT, 0);
   dir = tu_edpt_dir(desc_ep->bEndpointAddress);
   _btd_itf.ep_voice[dir] = desc_ep->bEndpointAddress;
   // Store endpoint size for alternative
-  _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = (uint8_t) tu_edpt_packet_size(desc_ep);
+  _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = tu_edpt_packet_size(desc_ep);
 
   desc_ep = (tusb_desc_endpoint_t const *)tu_desc_next(desc_ep);
   TU_ASSERT(desc_ep->bDescriptorType == TUSB_DESC_ENDPOINT, 0);
   dir = tu_edpt_dir(desc_ep->bEndpointAddress);
   _btd_itf.ep_voice[dir] = desc_ep->bEndpointAddress;
   // Store endpoint size for alternative
-  _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = (uint8_t) tu_edpt_packet_size(desc_ep);
+  _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = tu_edpt_packet_size(desc_ep);
   drv_len += iso_alt_itf_size;
 
   for (int i = 1; i < CFG_TUD_BTH_ISO_ALT_COUNT && drv_len + iso_alt_itf_size <= max_len; ++i) {
@@ -177,17 +444,30 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
     // Verify that alternative endpoint are same as first ones
     TU_ASSERT(desc_ep->bDescriptorType == TUSB_DESC_ENDPOINT &&
               _btd_itf.ep_voice[dir] == desc_ep->bEndpointAddress, 0);
-    _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = (uint8_t) tu_edpt_packet_size(desc_ep);
+    _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = tu_edpt_packet_size(desc_ep);
 
     desc_ep = (tusb_desc_endpoint_t const *)tu_desc_next(desc_ep);
     dir = tu_edpt_dir(desc_ep->bEndpointAddress);
     // Verify that alternative endpoint are same as first ones
     TU_ASSERT(desc_ep->bDescriptorType == TUSB_DESC_ENDPOINT &&
               _btd_itf.ep_voice[dir] == desc_ep->bEndpointAddress, 0);
-    _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = (uint8_t) tu_edpt_packet_size(desc_ep);
+    _btd_itf.ep_voice_size[dir][itf_desc->bAlternateSetting] = tu_edpt_packet_size(desc_ep);
     drv_len += iso_alt_itf_size;
   }
 
+#if CFG_TUD_BTH_SCO
+  _btd_itf.desc_iso_len = (uint16_t) (drv_len - hci_itf_size);
+
+  // Allocate packet buffer of isochronous endpoints for largest alternate, activated on SET_INTERFACE
+  for (uint8_t d = 0; d < 2; d++)
+  {
+    uint16_t max_size = 0;
+    for (uint8_t alt = 0; alt < CFG_TUD_BTH_ISO_ALT_COUNT; alt++) max_size = tu_max16(max_size, _btd_itf.ep_voice_size[d][alt]);
+    TU_ASSERT(max_size <= CFG_TUD_BTH_SCO_EPSIZE, 0);
+    if (max_size) TU_ASSERT(usbd_edpt_iso_alloc(rhport, _btd_itf.ep_voice[d], max_size), 0);
+  }
+#endif
+
   return drv_len;
 }
 
@@ -196,8 +476,6 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
 // return false to stall control endpoint (e.g unsupported request)
 bool btd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request)
 {
-  (void)rhport;
-
   if ( stage == CONTROL_STAGE_SETUP )
   {
     if (request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
@@ -210,9 +488,21 @@ bool btd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t c
     }
     else if (request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE)
     {
-      if (request->bRequest == TUSB_REQ_SET_INTERFACE && _btd_itf.itf_num + 1 == request->wIndex)
+      if (request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && _btd_itf.itf_num + 1 == request->wIndex)
       {
-        // TODO: Set interface it would involve changing size of endpoint size
+#if CFG_TUD_BTH_SCO
+        if (request->bRequest == TUSB_REQ_SET_INTERFACE)
+        {
+          TU_VERIFY(sco_set_interface(rhport, (uint8_t) request->wValue));
+          return tud_control_status(rhport, request);
+        }
+        else if (request->bRequest == TUSB_REQ_GET_INTERFACE)
+        {
+          return tud_control_xfer(rhport, request, &_btd_itf.sco_alt, 1);
+        }
+#endif
+        // Alternate settings are acknowledged by usbd
+        return false;
       }
       else
       {
@@ -249,12 +539,30 @@ bool btd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t
   }
   else if (ep_addr == _btd_itf.ep_ev)
   {
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+    // keep endpoint busy before notifying application
+    bt_tx_queue_kick(&_btd_itf.ev_queue, _btd_itf.ep_ev);
+#endif
     if (tud_bt_event_sent_cb) tud_bt_event_sent_cb((uint16_t)xferred_bytes);
   }
   else if (ep_addr == _btd_itf.ep_acl_in)
   {
+#if CFG_TUD_BTH_TX_QUEUE_DEPTH
+    bt_tx_queue_kick(&_btd_itf.acl_queue, _btd_itf.ep_acl_in);
+#endif
     if (tud_bt_acl_data_sent_cb) tud_bt_acl_data_sent_cb((uint16_t)xferred_bytes);
   }
+#if CFG_TUD_BTH_SCO
+  else if (ep_addr == _btd_itf.ep_voice[TUSB_DIR_OUT] && _btd_itf.sco_alt)
+  {
+    // data is already in ring, no application involvement per packet
+    sco_rx_xfer(rhport);
+  }
+  else if (ep_addr == _btd_itf.ep_voice[TUSB_DIR_IN] && _btd_itf.sco_alt)
+  {
+    sco_tx_xfer(rhport);
+  }
+#endif
 
   return true;
 }
@@ -47,6 +47,29 @@
 #define CFG_TUD_BTH_HISTORICAL_COMPATIBLE 0
 #endif
 
+// Number of event and ACL packets that can be submitted while a previous one is still being sent.
+// Queued packets are sent from the application buffers back to back. 0 means send fails when busy.
+#ifndef CFG_TUD_BTH_TX_QUEUE_DEPTH
+#define CFG_TUD_BTH_TX_QUEUE_DEPTH   0
+#endif
+
+// Stream SCO voice over the isochronous interface when host selects alternate setting 1 or above.
+// Without it, alternate settings are acknowledged but no voice data is exchanged.
+#ifndef CFG_TUD_BTH_SCO
+#define CFG_TUD_BTH_SCO              0
+#endif
+
+// Largest isochronous packet size among alternate settings
+#ifndef CFG_TUD_BTH_SCO_EPSIZE
+#define CFG_TUD_BTH_SCO_EPSIZE       64
+#endif
+
+// Depth of voice rings in packets of the selected alternate setting. IN starts sending once half of the
+// ring is filled so that it runs with constant latency, and restarts buffering on underrun.
+#ifndef CFG_TUD_BTH_SCO_PACKETS
+#define CFG_TUD_BTH_SCO_PACKETS      8
+#endif
+
 typedef struct TU_ATTR_PACKED
 {
   uint16_t op_code;
@@ -78,6 +101,8 @@ TU_ATTR_WEAK void tud_bt_acl_data_received_cb(void *acl_data, uint16_t data_len)
 
 // Called when event sent with tud_bt_event_send() was delivered to BT stack.
 // Controller can release/reuse buffer with Event packet at this point.
+// With CFG_TUD_BTH_TX_QUEUE_DEPTH, packets complete in submission order and the next
+// queued one is already being sent when this is invoked.
 TU_ATTR_WEAK void tud_bt_event_sent_cb(uint16_t sent_bytes);
 
 // Called when ACL data that was sent with tud_bt_acl_data_send()
@@ -100,6 +125,31 @@ bool tud_bt_event_send(void *event, uint16_t event_len);
 // and must not be reused till tud_bt_acl_data_sent_cb() is called.
 bool tud_bt_acl_data_send(void *acl_data, uint16_t data_len);
 
+// Number of event/ACL packets that can still be submitted without failing
+uint16_t tud_bt_event_send_available(void);
+uint16_t tud_bt_acl_data_send_available(void);
+
+#if CFG_TUD_BTH_SCO
+// Currently selected alternate setting of isochronous interface, 0 means no voice connection
+uint8_t  tud_bt_sco_alt(void);
+
+// Number of received HCI SCO bytes available for reading
+uint32_t tud_bt_sco_available(void);
+
+// Read HCI SCO data received from host. Byte stream is as sent by host, i.e SCO packets (3-byte header
+// followed by data) may span multiple isochronous packets. Oldest data is dropped if not read in time.
+uint32_t tud_bt_sco_read(void* buffer, uint32_t bufsize);
+
+// Number of bytes that can be written
+uint32_t tud_bt_sco_write_available(void);
+
+// Queue HCI SCO data to host, it is sent one isochronous packet per (micro)frame, return number of bytes queued
+uint32_t tud_bt_sco_write(void const* buffer, uint32_t bufsize);
+
+// Invoked when host selects alternate setting of isochronous interface, voice rings are cleared
+TU_ATTR_WEAK void tud_bt_sco_set_itf_cb(uint8_t alt);
+#endif
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
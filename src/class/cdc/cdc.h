@@ -205,6 +205,15 @@ typedef enum {
   CDC_LINE_CODING_PARITY_SPACE = 4,
 } cdc_line_coding_parity_t;
 
+/// ECM 6.2.4 SetEthernetPacketFilter bitmap (wValue)
+typedef enum {
+  CDC_PACKET_TYPE_PROMISCUOUS   = 0x01,
+  CDC_PACKET_TYPE_ALL_MULTICAST = 0x02,
+  CDC_PACKET_TYPE_DIRECTED      = 0x04,
+  CDC_PACKET_TYPE_BROADCAST     = 0x08,
+  CDC_PACKET_TYPE_MULTICAST     = 0x10, ///< multicast addresses set with SetEthernetMulticastFilters
+} cdc_ethernet_packet_filter_t;
+
 //--------------------------------------------------------------------+
 // Management Element Notification (Notification Endpoint)
 //--------------------------------------------------------------------+
@@ -50,6 +50,7 @@ enum
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_notif;
   uint8_t ep_in;
@@ -58,23 +59,44 @@ typedef struct
   // Bit 0:  DTR (Data Terminal Ready), Bit 1: RTS (Request to Send)
   uint8_t line_state;
 
+  // TUD_CDC_FLUSH_TIMEOUT: SOF count since last write while data is pending
+  volatile bool     tx_pending;
+  volatile uint16_t tx_idle_sof;
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
-  char    wanted_char;
+  char    wanted_char[CFG_TUD_CDC_WANTED_CHAR_NUM];
+  uint8_t wanted_count;
+
+  // TX auto flush policy
+  uint8_t  flush_mode;
+  uint16_t flush_param;
   TU_ATTR_ALIGNED(4) cdc_line_coding_t line_coding;
 
   // FIFO
   tu_fifo_t rx_ff;
   tu_fifo_t tx_ff;
 
+#if CFG_TUD_CDC_RX_FIFO_XFER
+  CFG_TUSB_MEM_ALIGN uint8_t rx_ff_buf[CFG_TUD_CDC_RX_BUFSIZE];
+#else
   uint8_t rx_ff_buf[CFG_TUD_CDC_RX_BUFSIZE];
+#endif
+#if CFG_TUD_CDC_TX_FIFO_XFER
+  CFG_TUSB_MEM_ALIGN uint8_t tx_ff_buf[CFG_TUD_CDC_TX_BUFSIZE];
+#else
   uint8_t tx_ff_buf[CFG_TUD_CDC_TX_BUFSIZE];
+#endif
 
   OSAL_MUTEX_DEF(rx_ff_mutex);
   OSAL_MUTEX_DEF(tx_ff_mutex);
 
-  // Endpoint Transfer buffer
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CDC_EP_BUFSIZE];
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CDC_EP_BUFSIZE];
+  // Endpoint Transfer buffer, not needed when data is transferred directly from/to rx_ff/tx_ff
+#if !CFG_TUD_CDC_RX_FIFO_XFER
+  TUD_EPBUF_DEF(epout_buf, CFG_TUD_CDC_EP_BUFSIZE);
+#endif
+#if !CFG_TUD_CDC_TX_FIFO_XFER
+  TUD_EPBUF_DEF(epin_buf, CFG_TUD_CDC_EP_BUFSIZE);
+#endif
 
 }cdcd_interface_t;
 
@@ -87,14 +109,14 @@ CFG_TUD_MEM_SECTION tu_static cdcd_interface_t _cdcd_itf[CFG_TUD_CDC];
 
 static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = p_cdc->rhport;
   uint16_t available = tu_fifo_remaining(&p_cdc->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
   // and slowly move it to the FIFO when read().
   // This pre-check reduces endpoint claiming
-  TU_VERIFY(available >= sizeof(p_cdc->epout_buf));
+  TU_VERIFY(available >= CFG_TUD_CDC_EP_BUFSIZE);
 
   // claim endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_out));
@@ -102,9 +124,13 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   // fifo can be changed before endpoint is claimed
   available = tu_fifo_remaining(&p_cdc->rx_ff);
 
-  if ( available >= sizeof(p_cdc->epout_buf) )
+  if ( available >= CFG_TUD_CDC_EP_BUFSIZE )
   {
-    return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, sizeof(p_cdc->epout_buf));
+#if CFG_TUD_CDC_RX_FIFO_XFER
+    return usbd_edpt_xfer_fifo(rhport, p_cdc->ep_out, &p_cdc->rx_ff, CFG_TUD_CDC_EP_BUFSIZE);
+#else
+    return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, CFG_TUD_CDC_EP_BUFSIZE);
+#endif
   }else
   {
     // Release endpoint since we don't make any transfer
@@ -120,7 +146,7 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
 bool tud_cdc_n_connected(uint8_t itf)
 {
   // DTR (bit 0) active  is considered as connected
-  return tud_ready() && tu_bit_test(_cdcd_itf[itf].line_state, 0);
+  return tud_n_ready(_cdcd_itf[itf].rhport) && tu_bit_test(_cdcd_itf[itf].line_state, 0);
 }
 
 uint8_t tud_cdc_n_get_line_state (uint8_t itf)
@@ -135,7 +161,68 @@ void tud_cdc_n_get_line_coding (uint8_t itf, cdc_line_coding_t* coding)
 
 void tud_cdc_n_set_wanted_char (uint8_t itf, char wanted)
 {
-  _cdcd_itf[itf].wanted_char = wanted;
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  p_cdc->wanted_char[0] = wanted;
+  p_cdc->wanted_count = (((signed char) wanted) != -1) ? 1 : 0;
+}
+
+bool tud_cdc_n_set_wanted_chars (uint8_t itf, char const* chars, uint8_t count)
+{
+  TU_VERIFY(count <= CFG_TUD_CDC_WANTED_CHAR_NUM);
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  p_cdc->wanted_count = 0; // disable while updating
+  if (count) memcpy(p_cdc->wanted_char, chars, count);
+  p_cdc->wanted_count = count;
+  return true;
+}
+
+// Index of first byte matching any of chars, len if none. Scan a word at a time: a byte of (word ^ pattern) is
+// zero where it matches, which is detected for all 4 bytes at once with the "has zero byte" trick.
+static uint32_t find_any_char(uint8_t const* buf, uint32_t len, char const* chars, uint8_t count)
+{
+  uint32_t i = 0;
+
+  // head bytes until word aligned, word loop stops at the word containing a match
+  for ( ; i < len && ((uintptr_t) (buf + i) & 3u); i++ )
+  {
+    if ( memchr(chars, buf[i], count) ) return i;
+  }
+
+  for ( ; i + 4 <= len; i += 4 )
+  {
+    uint32_t word;
+    memcpy(&word, buf + i, 4);
+
+    uint32_t hit = 0;
+    for ( uint8_t k = 0; k < count; k++ )
+    {
+      uint32_t const x = word ^ (0x01010101u * (uint8_t) chars[k]);
+      hit |= (x - 0x01010101u) & ~x & 0x80808080u;
+    }
+    if ( hit ) break;
+  }
+
+  for ( ; i < len; i++ )
+  {
+    if ( memchr(chars, buf[i], count) ) return i;
+  }
+
+  return len;
+}
+
+// Invoke tud_cdc_rx_wanted_cb() for every wanted char in received data
+static void rx_wanted_scan(uint8_t itf, cdcd_interface_t* p_cdc, uint8_t const* buf, uint32_t len)
+{
+  while ( len )
+  {
+    uint32_t const idx = find_any_char(buf, len, p_cdc->wanted_char, p_cdc->wanted_count);
+    if ( idx == len ) break;
+
+    if ( !tu_fifo_empty(&p_cdc->rx_ff) ) tud_cdc_rx_wanted_cb(itf, (char) buf[idx]);
+
+    buf += idx + 1;
+    len -= idx + 1;
+  }
 }
 
 
@@ -160,6 +247,39 @@ bool tud_cdc_n_peek(uint8_t itf, uint8_t* chr)
   return tu_fifo_peek(&_cdcd_itf[itf].rx_ff, chr);
 }
 
+uint32_t tud_cdc_n_read_line(uint8_t itf, void* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  char const newline = '\n';
+  char const* chars = p_cdc->wanted_count ? p_cdc->wanted_char : &newline;
+  uint8_t const count = p_cdc->wanted_count ? p_cdc->wanted_count : 1;
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(&p_cdc->rx_ff, &info);
+  uint32_t const available = (uint32_t) info.len_lin + info.len_wrap;
+
+  // look for terminator in linear then wrapped part
+  uint32_t idx = find_any_char((uint8_t const*) info.ptr_lin, info.len_lin, chars, count);
+  if ( idx == info.len_lin && info.len_wrap )
+  {
+    idx += find_any_char((uint8_t const*) info.ptr_wrap, info.len_wrap, chars, count);
+  }
+
+  uint32_t len;
+  if ( idx < available )
+  {
+    len = idx + 1;
+  }else if ( available >= bufsize || tu_fifo_full(&p_cdc->rx_ff) )
+  {
+    len = available; // line does not fit
+  }else
+  {
+    return 0;
+  }
+
+  return tud_cdc_n_read(itf, buffer, tu_min32(len, bufsize));
+}
+
 void tud_cdc_n_read_flush (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
@@ -170,42 +290,142 @@ void tud_cdc_n_read_flush (uint8_t itf)
 //--------------------------------------------------------------------+
 // WRITE API
 //--------------------------------------------------------------------+
-uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+// flush according to interface policy, default is when queue more than packet size
+static void _auto_flush(uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) TU_MIN(bufsize, UINT16_MAX));
+  uint16_t threshold = BULK_PACKET_SIZE;
 
-  // flush if queue more than packet size
-  // may need to suppress -Wunreachable-code since most of the time CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE
-  if ( (tu_fifo_count(&p_cdc->tx_ff) >= BULK_PACKET_SIZE) || ((CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE) && tu_fifo_full(&p_cdc->tx_ff)) )
+  switch ( p_cdc->flush_mode )
+  {
+    case TUD_CDC_FLUSH_IMMEDIATE:
+      threshold = 1;
+    break;
+
+    case TUD_CDC_FLUSH_THRESHOLD:
+      threshold = p_cdc->flush_param;
+    break;
+
+    case TUD_CDC_FLUSH_TIMEOUT:
+      // restart idle timer, pending data is flushed by cdcd_sof()
+      p_cdc->tx_idle_sof = 0;
+      p_cdc->tx_pending  = true;
+    break;
+
+    default: break;
+  }
+
+  if ( (tu_fifo_count(&p_cdc->tx_ff) >= threshold) || tu_fifo_full(&p_cdc->tx_ff) )
   {
     tud_cdc_n_write_flush(itf);
   }
+}
+
+// flush from usbd task when TUD_CDC_FLUSH_TIMEOUT expires
+static void _timeout_flush(void* param)
+{
+  tud_cdc_n_write_flush((uint8_t) (uintptr_t) param);
+}
+
+bool tud_cdc_n_set_flush_mode(uint8_t itf, tud_cdc_flush_mode_t mode, uint16_t param)
+{
+  TU_VERIFY(itf < CFG_TUD_CDC && mode <= TUD_CDC_FLUSH_TIMEOUT);
+  TU_VERIFY((mode != TUD_CDC_FLUSH_THRESHOLD && mode != TUD_CDC_FLUSH_TIMEOUT) || param > 0);
+
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  p_cdc->tx_pending  = false;
+  p_cdc->flush_param = param;
+  p_cdc->flush_mode  = (uint8_t) mode;
+
+  // SOF is the timeout clock, it is enabled by cdcd_open() if not mounted yet.
+  // SOF is not disabled when leaving timeout mode since other drivers may need it.
+  if ( mode == TUD_CDC_FLUSH_TIMEOUT && p_cdc->ep_in && tud_n_mounted(p_cdc->rhport) ) usbd_sof_enable(p_cdc->rhport, true);
+
+  return true;
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) TU_MIN(bufsize, UINT16_MAX));
+
+  _auto_flush(itf);
 
   return ret;
 }
 
+uint32_t tud_cdc_n_write_reserve(uint8_t itf, tu_fifo_buffer_info_t* info)
+{
+  return tu_fifo_write_reserve(&_cdcd_itf[itf].tx_ff, info);
+}
+
+uint32_t tud_cdc_n_write_commit(uint8_t itf, uint32_t count)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  tu_fifo_write_commit(&p_cdc->tx_ff, (uint16_t) TU_MIN(count, UINT16_MAX));
+
+  _auto_flush(itf);
+
+  return count;
+}
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+uint32_t tud_cdc_n_write_msg(uint8_t itf, void const* buffer, uint32_t bufsize)
+{
+  TU_VERIFY(bufsize <= UINT16_MAX, 0);
+  uint16_t const ret = tu_fifo_mp_write_n(&_cdcd_itf[itf].tx_ff, buffer, (uint16_t) bufsize);
+
+  _auto_flush(itf);
+
+  return ret;
+}
+
+uint32_t tud_cdc_n_write_msg_reserve(uint8_t itf, uint32_t count, tu_fifo_buffer_info_t* info)
+{
+  TU_VERIFY(count <= UINT16_MAX, 0);
+  return tu_fifo_mp_write_reserve(&_cdcd_itf[itf].tx_ff, (uint16_t) count, info);
+}
+
+void tud_cdc_n_write_msg_commit(uint8_t itf)
+{
+  tu_fifo_mp_write_commit(&_cdcd_itf[itf].tx_ff);
+  _auto_flush(itf);
+}
+#endif
+
 uint32_t tud_cdc_n_write_flush (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
 
+  uint8_t const rhport = p_cdc->rhport;
+
   // Skip if usb is not ready yet
-  TU_VERIFY( tud_ready(), 0 );
+  TU_VERIFY( tud_n_ready(rhport), 0 );
 
   // No data to send
   if ( !tu_fifo_count(&p_cdc->tx_ff) ) return 0;
 
-  uint8_t const rhport = 0;
-
   // Claim the endpoint
   TU_VERIFY( usbd_edpt_claim(rhport, p_cdc->ep_in), 0 );
 
+#if CFG_TUD_CDC_TX_FIFO_XFER
+  // Send the linear part of FIFO in one transfer, the wrapped part (if any) goes in the next one
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(&p_cdc->tx_ff, &info);
+  uint16_t const count = info.len_lin;
+#else
   // Pull data from FIFO
   uint16_t const count = tu_fifo_read_n(&p_cdc->tx_ff, p_cdc->epin_buf, sizeof(p_cdc->epin_buf));
+#endif
 
   if ( count )
   {
+#if CFG_TUD_CDC_TX_FIFO_XFER
+    TU_ASSERT( usbd_edpt_xfer_fifo(rhport, p_cdc->ep_in, &p_cdc->tx_ff, count), 0 );
+#else
     TU_ASSERT( usbd_edpt_xfer(rhport, p_cdc->ep_in, p_cdc->epin_buf, count), 0 );
+#endif
     return count;
   }else
   {
@@ -226,6 +446,16 @@ bool tud_cdc_n_write_clear (uint8_t itf)
   return tu_fifo_clear(&_cdcd_itf[itf].tx_ff);
 }
 
+#if CFG_TUSB_FIFO_STATS
+bool tud_cdc_n_fifo_stats(uint8_t itf, tu_fifo_stats_t* rx_stats, tu_fifo_stats_t* tx_stats)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  if ( rx_stats ) tu_fifo_stats_get(&p_cdc->rx_ff, rx_stats);
+  if ( tx_stats ) tu_fifo_stats_get(&p_cdc->tx_ff, tx_stats);
+  return true;
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -237,7 +467,8 @@ void cdcd_init(void)
   {
     cdcd_interface_t* p_cdc = &_cdcd_itf[i];
 
-    p_cdc->wanted_char = (char) -1;
+    p_cdc->wanted_char[0] = (char) -1;
+    p_cdc->wanted_count = 0;
 
     // default line coding is : stop bit = 1, parity = none, data bits = 8
     p_cdc->line_coding.bit_rate  = 115200;
@@ -260,12 +491,13 @@ void cdcd_init(void)
 
 void cdcd_reset(uint8_t rhport)
 {
-  (void) rhport;
-
   for(uint8_t i=0; i<CFG_TUD_CDC; i++)
   {
     cdcd_interface_t* p_cdc = &_cdcd_itf[i];
 
+    // interface is opened on other port
+    if ( p_cdc->ep_in && p_cdc->rhport != rhport ) continue;
+
     tu_memclr(p_cdc, ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&p_cdc->rx_ff);
     tu_fifo_clear(&p_cdc->tx_ff);
@@ -292,6 +524,7 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(p_cdc, 0);
 
   //------------- Control Interface -------------//
+  p_cdc->rhport  = rhport;
   p_cdc->itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -333,9 +566,29 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   // Prepare for incoming data
   _prep_out_transaction(p_cdc);
 
+  // SOF is used as flush timer
+  if ( p_cdc->flush_mode == TUD_CDC_FLUSH_TIMEOUT ) usbd_sof_enable(rhport, true);
+
   return drv_len;
 }
 
+void cdcd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) frame_count;
+
+  for(uint8_t itf=0; itf<CFG_TUD_CDC; itf++)
+  {
+    cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+    if ( p_cdc->rhport != rhport ) continue;
+
+    if ( p_cdc->tx_pending && (++p_cdc->tx_idle_sof >= p_cdc->flush_param) )
+    {
+      p_cdc->tx_pending = false;
+      usbd_defer_func(_timeout_flush, (void*) (uintptr_t) itf, true);
+    }
+  }
+}
+
 // Invoked when a control transfer occurred on an interface of this class
 // Driver response accordingly to the request and the transfer stage (setup/data/ack)
 // return false to stall control endpoint (e.g unsupported request)
@@ -352,7 +605,7 @@ bool cdcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
   {
     if (itf >= TU_ARRAY_SIZE(_cdcd_itf)) return false;
 
-    if ( p_cdc->itf_num == request->wIndex ) break;
+    if ( p_cdc->rhport == rhport && p_cdc->itf_num == request->wIndex ) break;
   }
 
   switch ( request->bRequest )
@@ -432,26 +685,43 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   for (itf = 0; itf < CFG_TUD_CDC; itf++)
   {
     p_cdc = &_cdcd_itf[itf];
-    if ( ( ep_addr == p_cdc->ep_out ) || ( ep_addr == p_cdc->ep_in ) ) break;
+    if ( p_cdc->rhport == rhport && (( ep_addr == p_cdc->ep_out ) || ( ep_addr == p_cdc->ep_in )) ) break;
   }
   TU_ASSERT(itf < CFG_TUD_CDC);
 
   // Received new data
   if ( ep_addr == p_cdc->ep_out )
   {
-    tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
-
-    // Check for wanted char and invoke callback if needed
-    if ( tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1) )
+#if CFG_TUD_CDC_RX_FIFO_XFER
+    // Data is already written to rx_ff by the port driver
+    if ( tud_cdc_rx_wanted_cb && p_cdc->wanted_count )
     {
-      for ( uint32_t i = 0; i < xferred_bytes; i++ )
+      // Newly received bytes are the last xferred_bytes of the fifo content: scan the 2 spans in place
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_read_info(&p_cdc->rx_ff, &info);
+
+      uint32_t const count = (uint32_t) info.len_lin + info.len_wrap;
+      uint32_t const start = (count > xferred_bytes) ? (count - xferred_bytes) : 0;
+
+      if ( start < info.len_lin )
       {
-        if ( (p_cdc->wanted_char == p_cdc->epout_buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff) )
-        {
-          tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
-        }
+        rx_wanted_scan(itf, p_cdc, (uint8_t const*) info.ptr_lin + start, info.len_lin - start);
+      }
+      uint32_t const wrap_start = (start > info.len_lin) ? (start - info.len_lin) : 0;
+      if ( wrap_start < info.len_wrap )
+      {
+        rx_wanted_scan(itf, p_cdc, (uint8_t const*) info.ptr_wrap + wrap_start, info.len_wrap - wrap_start);
       }
     }
+#else
+    tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
+
+    // Check for wanted char and invoke callback if needed, endpoint buffer is still hot in cache
+    if ( tud_cdc_rx_wanted_cb && p_cdc->wanted_count )
+    {
+      rx_wanted_scan(itf, p_cdc, p_cdc->epout_buf, xferred_bytes);
+    }
+#endif
 
     // invoke receive callback (if there is still data)
     if (tud_cdc_rx_cb && !tu_fifo_empty(&p_cdc->rx_ff) ) tud_cdc_rx_cb(itf);
@@ -41,6 +41,25 @@
   #define CFG_TUD_CDC_EP_BUFSIZE    (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Receive OUT data directly into RX FIFO with usbd_edpt_xfer_fifo() instead of copying it from
+// the endpoint buffer. Opt-in, requires TUD_EDPT_XFER_FIFO. With dwc2 DMA also enable
+// CFG_TUD_EDPT_XFER_FIFO_FALLBACK for unaligned FIFO spans.
+#ifndef CFG_TUD_CDC_RX_FIFO_XFER
+  #define CFG_TUD_CDC_RX_FIFO_XFER  0
+#endif
+
+// Send IN data directly from TX FIFO with usbd_edpt_xfer_fifo(). A transfer is not limited to
+// CFG_TUD_CDC_EP_BUFSIZE but can carry the whole linear part of the FIFO. Opt-in, requires
+// TUD_EDPT_XFER_FIFO. With dwc2 DMA also enable CFG_TUD_EDPT_XFER_FIFO_FALLBACK for unaligned FIFO spans.
+#ifndef CFG_TUD_CDC_TX_FIFO_XFER
+  #define CFG_TUD_CDC_TX_FIFO_XFER  0
+#endif
+
+// Max number of characters that trigger tud_cdc_rx_wanted_cb(), see tud_cdc_n_set_wanted_chars()
+#ifndef CFG_TUD_CDC_WANTED_CHAR_NUM
+  #define CFG_TUD_CDC_WANTED_CHAR_NUM  1
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -50,6 +69,15 @@
  *  \defgroup   CDC_Serial_Device Device
  *  @{ */
 
+// TX auto flush policy, see tud_cdc_n_set_flush_mode()
+typedef enum
+{
+  TUD_CDC_FLUSH_PACKET = 0, ///< (default) flush when TX FIFO has at least a bulk packet
+  TUD_CDC_FLUSH_IMMEDIATE , ///< flush on every write
+  TUD_CDC_FLUSH_THRESHOLD , ///< flush when TX FIFO has at least param bytes
+  TUD_CDC_FLUSH_TIMEOUT   , ///< flush full packets, remaining data is flushed after param SOFs without new write
+} tud_cdc_flush_mode_t;
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Ports)
 // CFG_TUD_CDC > 1
@@ -67,6 +95,9 @@ void     tud_cdc_n_get_line_coding (uint8_t itf, cdc_line_coding_t* coding);
 // Set special character that will trigger tud_cdc_rx_wanted_cb() callback on receiving
 void     tud_cdc_n_set_wanted_char (uint8_t itf, char wanted);
 
+// Set up to CFG_TUD_CDC_WANTED_CHAR_NUM characters that trigger tud_cdc_rx_wanted_cb(), count = 0 to disable
+bool     tud_cdc_n_set_wanted_chars(uint8_t itf, char const* chars, uint8_t count);
+
 // Get the number of bytes available for reading
 uint32_t tud_cdc_n_available       (uint8_t itf);
 
@@ -77,6 +108,10 @@ uint32_t tud_cdc_n_read            (uint8_t itf, void* buffer, uint32_t bufsize)
 static inline
 int32_t  tud_cdc_n_read_char       (uint8_t itf);
 
+// Read a complete line terminated by any of wanted chars ('\n' if none is set), terminator included.
+// Return 0 if line is not complete yet, or partial line if it is longer than bufsize or fills the FIFO
+uint32_t tud_cdc_n_read_line       (uint8_t itf, void* buffer, uint32_t bufsize);
+
 // Clear the received FIFO
 void     tud_cdc_n_read_flush      (uint8_t itf);
 
@@ -94,6 +129,25 @@ uint32_t tud_cdc_n_write_char      (uint8_t itf, char ch);
 static inline
 uint32_t tud_cdc_n_write_str       (uint8_t itf, char const* str);
 
+// Reserve free space in TX FIFO to build data in place (zero-copy), return number of reserved bytes
+// in up to two spans. Must be followed by tud_cdc_n_write_commit()
+uint32_t tud_cdc_n_write_reserve   (uint8_t itf, tu_fifo_buffer_info_t* info);
+
+// Commit bytes written into reserved space, data may remain in the FIFO for a while
+uint32_t tud_cdc_n_write_commit    (uint8_t itf, uint32_t count);
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+// Lock-free message write for multiple tasks e.g logging: the whole message is queued contiguously and never
+// interleaved with other writers, or nothing is written (return 0) if there is not enough room. Must not be
+// mixed with other write functions on the same interface.
+uint32_t tud_cdc_n_write_msg         (uint8_t itf, void const* buffer, uint32_t bufsize);
+
+// Reserve exactly count bytes for a message to build in place, must be followed by tud_cdc_n_write_msg_commit()
+// which always sends the whole reservation
+uint32_t tud_cdc_n_write_msg_reserve (uint8_t itf, uint32_t count, tu_fifo_buffer_info_t* info);
+void     tud_cdc_n_write_msg_commit  (uint8_t itf);
+#endif
+
 // Force sending data if possible, return number of forced bytes
 uint32_t tud_cdc_n_write_flush     (uint8_t itf);
 
@@ -103,6 +157,16 @@ uint32_t tud_cdc_n_write_available (uint8_t itf);
 // Clear the transmit FIFO
 bool tud_cdc_n_write_clear (uint8_t itf);
 
+// Set auto flush policy of tud_cdc_n_write() and tud_cdc_n_write_commit(), param is the byte threshold
+// for TUD_CDC_FLUSH_THRESHOLD or number of SOF (1 ms full speed, 125 us high speed) for TUD_CDC_FLUSH_TIMEOUT.
+// TUD_CDC_FLUSH_TIMEOUT enables SOF interrupt.
+bool tud_cdc_n_set_flush_mode (uint8_t itf, tud_cdc_flush_mode_t mode, uint16_t param);
+
+#if CFG_TUSB_FIFO_STATS
+// Get statistics of RX and TX FIFO, either can be NULL
+bool tud_cdc_n_fifo_stats(uint8_t itf, tu_fifo_stats_t* rx_stats, tu_fifo_stats_t* tx_stats);
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Single Port)
 //--------------------------------------------------------------------+
@@ -114,15 +178,22 @@ static inline void     tud_cdc_set_wanted_char (char wanted);
 static inline uint32_t tud_cdc_available       (void);
 static inline int32_t  tud_cdc_read_char       (void);
 static inline uint32_t tud_cdc_read            (void* buffer, uint32_t bufsize);
+static inline uint32_t tud_cdc_read_line       (void* buffer, uint32_t bufsize);
 static inline void     tud_cdc_read_flush      (void);
 static inline bool     tud_cdc_peek            (uint8_t* ui8);
 
 static inline uint32_t tud_cdc_write_char      (char ch);
 static inline uint32_t tud_cdc_write           (void const* buffer, uint32_t bufsize);
 static inline uint32_t tud_cdc_write_str       (char const* str);
+static inline uint32_t tud_cdc_write_reserve   (tu_fifo_buffer_info_t* info);
+static inline uint32_t tud_cdc_write_commit    (uint32_t count);
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+static inline uint32_t tud_cdc_write_msg       (void const* buffer, uint32_t bufsize);
+#endif
 static inline uint32_t tud_cdc_write_flush     (void);
 static inline uint32_t tud_cdc_write_available (void);
 static inline bool     tud_cdc_write_clear     (void);
+static inline bool     tud_cdc_set_flush_mode  (tud_cdc_flush_mode_t mode, uint16_t param);
 
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
@@ -200,6 +271,11 @@ static inline uint32_t tud_cdc_read (void* buffer, uint32_t bufsize)
   return tud_cdc_n_read(0, buffer, bufsize);
 }
 
+static inline uint32_t tud_cdc_read_line (void* buffer, uint32_t bufsize)
+{
+  return tud_cdc_n_read_line(0, buffer, bufsize);
+}
+
 static inline void tud_cdc_read_flush (void)
 {
   tud_cdc_n_read_flush(0);
@@ -225,6 +301,23 @@ static inline uint32_t tud_cdc_write_str (char const* str)
   return tud_cdc_n_write_str(0, str);
 }
 
+static inline uint32_t tud_cdc_write_reserve (tu_fifo_buffer_info_t* info)
+{
+  return tud_cdc_n_write_reserve(0, info);
+}
+
+static inline uint32_t tud_cdc_write_commit (uint32_t count)
+{
+  return tud_cdc_n_write_commit(0, count);
+}
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+static inline uint32_t tud_cdc_write_msg (void const* buffer, uint32_t bufsize)
+{
+  return tud_cdc_n_write_msg(0, buffer, bufsize);
+}
+#endif
+
 static inline uint32_t tud_cdc_write_flush (void)
 {
   return tud_cdc_n_write_flush(0);
@@ -240,6 +333,11 @@ static inline bool tud_cdc_write_clear(void)
   return tud_cdc_n_write_clear(0);
 }
 
+static inline bool tud_cdc_set_flush_mode(tud_cdc_flush_mode_t mode, uint16_t param)
+{
+  return tud_cdc_n_set_flush_mode(0, mode, param);
+}
+
 /** @} */
 /** @} */
 
@@ -251,6 +349,7 @@ void     cdcd_reset           (uint8_t rhport);
 uint16_t cdcd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     cdcd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     cdcd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     cdcd_sof             (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
@@ -66,6 +66,10 @@ typedef struct {
   // 1 byte padding
   #endif
 
+  #if CFG_TUH_CDC_FTDI
+  uint8_t ftdi_status[2]; // last reported modem & line status
+  #endif
+
   tuh_xfer_cb_t user_control_cb;
 
   struct {
@@ -73,10 +77,18 @@ typedef struct {
     tu_edpt_stream_t rx;
 
     uint8_t tx_ff_buf[CFG_TUH_CDC_TX_BUFSIZE];
-    CFG_TUH_MEM_ALIGN uint8_t tx_ep_buf[CFG_TUH_CDC_TX_EPSIZE];
+    #if CFG_TUH_CDC_TX_DOUBLE_BUFFER
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED uint8_t tx_ep_buf[2][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_CDC_TX_EPSIZE)];
+    #else
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED uint8_t tx_ep_buf[1][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_CDC_TX_EPSIZE)];
+    #endif
 
-    uint8_t rx_ff_buf[CFG_TUH_CDC_TX_BUFSIZE];
-    CFG_TUH_MEM_ALIGN uint8_t rx_ep_buf[CFG_TUH_CDC_TX_EPSIZE];
+    uint8_t rx_ff_buf[CFG_TUH_CDC_RX_BUFSIZE];
+    #if CFG_TUH_CDC_RX_DOUBLE_BUFFER
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED uint8_t rx_ep_buf[2][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_CDC_RX_EPSIZE)];
+    #else
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED uint8_t rx_ep_buf[1][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_CDC_RX_EPSIZE)];
+    #endif
   } stream;
 } cdch_interface_t;
 
@@ -109,6 +121,7 @@ static bool ftdi_sio_set_baudrate(cdch_interface_t* p_cdc, uint32_t baudrate, tu
 static bool ftdi_set_data_format(cdch_interface_t* p_cdc, uint8_t stop_bits, uint8_t parity, uint8_t data_bits, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool ftdi_set_line_coding(cdch_interface_t* p_cdc, cdc_line_coding_t const* line_coding, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool ftdi_sio_set_modem_ctrl(cdch_interface_t* p_cdc, uint16_t line_state, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+static void ftdi_rx_xfer_complete(cdch_interface_t* p_cdc, uint8_t idx, uint8_t const* rx_buf, uint32_t xferred_bytes);
 #endif
 
 //------------- CP210X prototypes -------------//
@@ -258,6 +271,10 @@ static cdch_interface_t* make_new_itf(uint8_t daddr, tusb_desc_interface_t const
       p_cdc->bInterfaceSubClass = itf_desc->bInterfaceSubClass;
       p_cdc->bInterfaceProtocol = itf_desc->bInterfaceProtocol;
       p_cdc->line_state         = 0;
+      #if CFG_TUH_CDC_FTDI
+      p_cdc->ftdi_status[0]     = 0;
+      p_cdc->ftdi_status[1]     = 0;
+      #endif
       return p_cdc;
     }
   }
@@ -629,11 +646,15 @@ void cdch_init(void) {
 
     tu_edpt_stream_init(&p_cdc->stream.tx, true, true, false,
                         p_cdc->stream.tx_ff_buf, CFG_TUH_CDC_TX_BUFSIZE,
-                        p_cdc->stream.tx_ep_buf, CFG_TUH_CDC_TX_EPSIZE);
+                        p_cdc->stream.tx_ep_buf[0], CFG_TUH_CDC_TX_EPSIZE);
+    tu_edpt_stream_set_ep_buf_num(&p_cdc->stream.tx, TU_ARRAY_SIZE(p_cdc->stream.tx_ep_buf),
+                                  sizeof(p_cdc->stream.tx_ep_buf[0]));
 
     tu_edpt_stream_init(&p_cdc->stream.rx, true, false, false,
                         p_cdc->stream.rx_ff_buf, CFG_TUH_CDC_RX_BUFSIZE,
-                        p_cdc->stream.rx_ep_buf, CFG_TUH_CDC_RX_EPSIZE);
+                        p_cdc->stream.rx_ep_buf[0], CFG_TUH_CDC_RX_EPSIZE);
+    tu_edpt_stream_set_ep_buf_num(&p_cdc->stream.rx, TU_ARRAY_SIZE(p_cdc->stream.rx_ep_buf),
+                                  sizeof(p_cdc->stream.rx_ep_buf[0]));
   }
 }
 
@@ -673,15 +694,18 @@ bool cdch_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t
       tu_edpt_stream_write_zlp_if_needed(&p_cdc->stream.tx, xferred_bytes);
     }
   } else if ( ep_addr == p_cdc->stream.rx.ep_addr ) {
+    // with double buffer, next transfer is posted to the spare buffer right away.
+    // Otherwise it is posted by tu_edpt_stream_read_xfer() once received data is in fifo.
+    uint8_t const* rx_buf = tu_edpt_stream_read_xfer_rotate(&p_cdc->stream.rx, xferred_bytes);
+
     #if CFG_TUH_CDC_FTDI
     if (p_cdc->serial_drid == SERIAL_DRIVER_FTDI) {
-      // FTDI reserve 2 bytes for status
-      // uint8_t status[2] = {p_cdc->stream.rx.ep_buf[0], p_cdc->stream.rx.ep_buf[1]};
-      tu_edpt_stream_read_xfer_complete_offset(&p_cdc->stream.rx, xferred_bytes, 2);
+      // FTDI reserve 2 bytes for status in every packet
+      ftdi_rx_xfer_complete(p_cdc, idx, rx_buf, xferred_bytes);
     }else
     #endif
     {
-      tu_edpt_stream_read_xfer_complete(&p_cdc->stream.rx, xferred_bytes);
+      tu_fifo_write_n(&p_cdc->stream.rx.ff, rx_buf, (uint16_t) xferred_bytes);
     }
 
     // invoke receive callback
@@ -724,9 +748,10 @@ bool cdch_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_d
   (void) rhport;
 
   // For CDC: only support ACM subclass
-  // Note: Protocol 0xFF can be RNDIS device
+  // Note: Protocol 0xFF can be RNDIS device, which is left to RNDIS driver if enabled
   if (TUSB_CLASS_CDC                           == itf_desc->bInterfaceClass &&
-      CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == itf_desc->bInterfaceSubClass) {
+      CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == itf_desc->bInterfaceSubClass &&
+      !(CFG_TUH_CDC_RNDIS && 0xFF == itf_desc->bInterfaceProtocol)) {
     return acm_open(daddr, itf_desc, max_len);
   }
   else if (SERIAL_DRIVER_COUNT > 1 &&
@@ -916,7 +941,7 @@ static bool acm_set_line_coding(cdch_interface_t* p_cdc, cdc_line_coding_t const
   };
 
   // use usbh enum buf to hold line coding since user line_coding variable does not live long enough
-  uint8_t* enum_buf = usbh_get_enum_buf();
+  uint8_t* enum_buf = usbh_get_enum_buf(p_cdc->daddr);
   memcpy(enum_buf, line_coding, sizeof(cdc_line_coding_t));
 
   p_cdc->user_control_cb = complete_cb;
@@ -1043,6 +1068,33 @@ static bool ftdi_sio_set_modem_ctrl(cdch_interface_t* p_cdc, uint16_t line_state
   return true;
 }
 
+// Each packet starts with modem & line status bytes: move only payload of every packet to rx fifo
+// and report status change. Status-only packets (sent every 40 ms when idle) carry no payload.
+static void ftdi_rx_xfer_complete(cdch_interface_t* p_cdc, uint8_t idx, uint8_t const* rx_buf, uint32_t xferred_bytes) {
+  tu_edpt_stream_t* rx = &p_cdc->stream.rx;
+  uint16_t const packet_size = rx->ep_packetsize;
+  uint8_t status[2] = { p_cdc->ftdi_status[0], p_cdc->ftdi_status[1] };
+
+  for (uint32_t offset = 0; offset + 2 <= xferred_bytes; offset += packet_size) {
+    uint8_t const* packet = rx_buf + offset;
+    uint16_t const len = (uint16_t) tu_min32(packet_size, xferred_bytes - offset);
+
+    // only modem lines and line errors, data ready & transmitter empty change all the time
+    status[0] = packet[0] & (FTDI_RS0_CTS | FTDI_RS0_DSR | FTDI_RS0_RI | FTDI_RS0_RLSD);
+    status[1] = packet[1] & (FTDI_RS_OE | FTDI_RS_PE | FTDI_RS_FE | FTDI_RS_BI);
+
+    if (len > 2) {
+      tu_fifo_write_n(&rx->ff, packet + 2, (uint16_t) (len - 2));
+    }
+  }
+
+  if (status[0] != p_cdc->ftdi_status[0] || status[1] != p_cdc->ftdi_status[1]) {
+    p_cdc->ftdi_status[0] = status[0];
+    p_cdc->ftdi_status[1] = status[1];
+    if (tuh_cdc_serial_status_cb) tuh_cdc_serial_status_cb(idx, status[0], status[1]);
+  }
+}
+
 static uint32_t ftdi_232bm_baud_base_to_divisor(uint32_t baud, uint32_t base) {
   const uint8_t divfrac[8] = { 0, 3, 2, 4, 1, 5, 6, 7 };
   uint32_t divisor;
@@ -1182,7 +1234,7 @@ static bool cp210x_set_request(cdch_interface_t* p_cdc, uint8_t command, uint16_
   uint8_t* enum_buf = NULL;
 
   if (buffer && length > 0) {
-    enum_buf = usbh_get_enum_buf();
+    enum_buf = usbh_get_enum_buf(p_cdc->daddr);
     tu_memcpy_s(enum_buf, CFG_TUH_ENUMERATION_BUFSIZE, buffer, length);
   }
 
@@ -1316,7 +1368,7 @@ static bool ch34x_set_request(cdch_interface_t* p_cdc, uint8_t direction, uint8_
   uint8_t* enum_buf = NULL;
 
   if (buffer && length > 0) {
-    enum_buf = usbh_get_enum_buf();
+    enum_buf = usbh_get_enum_buf(p_cdc->daddr);
     if (direction == TUSB_DIR_OUT) {
       tu_memcpy_s(enum_buf, CFG_TUH_ENUMERATION_BUFSIZE, buffer, length);
     }
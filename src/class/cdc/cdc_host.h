@@ -57,6 +57,13 @@
 #define CFG_TUH_CDC_RX_EPSIZE  USBH_EPSIZE_BULK_MAX
 #endif
 
+// Use 2 RX endpoint buffers: next IN transfer is posted into the spare buffer as soon as one completes,
+// before received data is moved to RX FIFO and tuh_cdc_rx_cb() is invoked. This shortens the time
+// device is NAKed on non flow-controlled links. RX FIFO must have room for both buffers.
+#ifndef CFG_TUH_CDC_RX_DOUBLE_BUFFER
+#define CFG_TUH_CDC_RX_DOUBLE_BUFFER  0
+#endif
+
 // TX FIFO size
 #ifndef CFG_TUH_CDC_TX_BUFSIZE
 #define CFG_TUH_CDC_TX_BUFSIZE USBH_EPSIZE_BULK_MAX
@@ -67,6 +74,12 @@
 #define CFG_TUH_CDC_TX_EPSIZE  USBH_EPSIZE_BULK_MAX
 #endif
 
+// Use 2 TX endpoint buffers: while one OUT transfer is in flight, next data is copied from TX FIFO to the
+// spare buffer, so that it is posted right when current transfer completes.
+#ifndef CFG_TUH_CDC_TX_DOUBLE_BUFFER
+#define CFG_TUH_CDC_TX_DOUBLE_BUFFER  0
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -189,6 +202,11 @@ TU_ATTR_WEAK extern void tuh_cdc_rx_cb(uint8_t idx);
 // Invoked when a TX is complete and therefore space becomes available in TX buffer
 TU_ATTR_WEAK extern void tuh_cdc_tx_complete_cb(uint8_t idx);
 
+// Invoked when modem or line status reported in-band by serial bridge is changed (FTDI only for now).
+// modem_status: CTS, DSR, RI, RLSD (FTDI_RS0_*), line_status: overrun, parity, framing, break (FTDI_RS_*)
+// as defined in serial/ftdi_sio.h
+TU_ATTR_WEAK extern void tuh_cdc_serial_status_cb(uint8_t idx, uint8_t modem_status, uint8_t line_status);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
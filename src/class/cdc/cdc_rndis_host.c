@@ -26,264 +26,705 @@
 
 #include "tusb_option.h"
 
-#if (CFG_TUH_ENABLED && CFG_TUH_CDC && CFG_TUH_CDC_RNDIS)
+#if (CFG_TUH_ENABLED && CFG_TUH_CDC_RNDIS)
 
-//--------------------------------------------------------------------+
-// INCLUDE
-//--------------------------------------------------------------------+
-#include "common/tusb_common.h"
-#include "cdc_host.h"
-#include "cdc_rndis_host.h"
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
 
-#if 0  // TODO remove subtask related macros later
-// Sub Task
-#define OSAL_SUBTASK_BEGIN
-#define OSAL_SUBTASK_END                    return TUSB_ERROR_NONE;
+#include "cdc_rndis_host.h"
 
-#define STASK_RETURN(_error)                return _error;
-#define STASK_INVOKE(_subtask, _status)     (_status) = _subtask
-#define STASK_ASSERT(_cond)                 TU_VERIFY(_cond, TUSB_ERROR_OSAL_TASK_FAILED)
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_CDC_RNDIS_LOG_LEVEL
+  #define CFG_TUH_CDC_RNDIS_LOG_LEVEL   CFG_TUH_LOG_LEVEL
 #endif
 
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_CDC_RNDIS_LOG_LEVEL, __VA_ARGS__)
+
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
-#define RNDIS_MSG_PAYLOAD_MAX   (1024*4)
 
-CFG_TUH_MEM_SECTION static uint8_t msg_notification[CFG_TUH_DEVICE_MAX][8];
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN static uint8_t msg_payload[RNDIS_MSG_PAYLOAD_MAX];
+// Control messages of host are at most 32 bytes, responses we care about are below 64 bytes
+#define RNDISH_CTRL_BUFSIZE     128
+#define RNDISH_NOTIF_BUFSIZE    8
+
+// Packet message header in front of each Ethernet frame
+#define RNDISH_PACKET_HDR_LEN   ((uint16_t) sizeof(rndis_msg_packet_t))
+
+// Device answers GET_ENCAPSULATED_RESPONSE with a single zero byte until response is ready
+#define RNDISH_RESPONSE_RETRY   8
+
+#define RNDISH_RX_IDLE          0xff
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;      // communication interface
+  uint8_t itf_data;     // data interface
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_out_size;
+
+  bool mounted;         // Enumeration is complete
+  bool link_up;
+  bool ctrl_busy;       // encapsulated message is being exchanged after mounted
+  uint8_t retry;        // response polls left
+  uint8_t mac[6];
+  uint32_t request_id;
+
+  // limits of OUT direction reported by device
+  uint16_t tx_xfer_max;
+  uint8_t  tx_packets_max;
+  uint8_t  tx_align;
+
+  uint8_t rx_pending;   // receive buffer of the pending IN transfer
+  uint8_t rx_ref[CFG_TUH_CDC_RNDIS_RX_BUFNUM]; // frames held by application, +1 while being processed
+
+  uint8_t  tx_fill;     // transmit buffer frames are written to, the other one may be in flight
+  uint8_t  tx_count;    // packet messages in fill buffer
+  uint16_t tx_len;      // bytes used in fill buffer
+  uint16_t tx_last;     // offset of last packet message in fill buffer
+  uint16_t tx_reserve_off;
+  uint16_t tx_reserve_len;
+
+  TUH_EPBUF_DEF(ctrl_buf, RNDISH_CTRL_BUFSIZE);
+  TUH_EPBUF_DEF(notif_buf, RNDISH_NOTIF_BUFSIZE);
+  CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED
+  uint8_t rx_buf[CFG_TUH_CDC_RNDIS_RX_BUFNUM][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_CDC_RNDIS_RX_BUFSIZE)];
+  TUH_EPBUF_DEF(tx_buf0, CFG_TUH_CDC_RNDIS_TX_BUFSIZE);
+  TUH_EPBUF_DEF(tx_buf1, CFG_TUH_CDC_RNDIS_TX_BUFSIZE);
+} rndish_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static rndish_interface_t _rndish_itf[CFG_TUH_CDC_RNDIS];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline rndish_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_CDC_RNDIS, NULL);
+  rndish_interface_t* p_rndis = &_rndish_itf[idx];
+  return (p_rndis->daddr != 0) ? p_rndis : NULL;
+}
+
+static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_CDC_RNDIS; idx++) {
+    rndish_interface_t const* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr &&
+        (p_rndis->ep_in == ep_addr || p_rndis->ep_out == ep_addr || p_rndis->ep_notif == ep_addr)) {
+      return idx;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
 
-static rndish_data_t rndish_data[CFG_TUH_DEVICE_MAX];
+static rndish_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_CDC_RNDIS; i++) {
+    if (_rndish_itf[i].daddr == 0) return &_rndish_itf[i];
+  }
+  return NULL;
+}
 
-// TODO Microsoft requires message length for any get command must be at least 4096 bytes
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* get_tx_buf(rndish_interface_t* p_rndis, uint8_t buf_idx) {
+  return buf_idx ? p_rndis->tx_buf1 : p_rndis->tx_buf0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t msg_read32(uint8_t const* msg, uint16_t offset) {
+  return tu_le32toh(tu_unaligned_read32(msg + offset));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void msg_write32(uint8_t* msg, uint16_t offset, uint32_t value) {
+  tu_unaligned_write32(msg + offset, tu_htole32(value));
+}
+
+// Offset of next packet message in fill buffer, concatenated messages are aligned as requested by device
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tx_next_offset(rndish_interface_t const* p_rndis) {
+  if (p_rndis->tx_count == 0) return 0;
+  uint32_t const align = 1ul << p_rndis->tx_align;
+  return (uint16_t) tu_align(p_rndis->tx_len + align - 1, align);
+}
 
 //--------------------------------------------------------------------+
-// INTERNAL OBJECT & FUNCTION DECLARATION
+// Transfer
 //--------------------------------------------------------------------+
-static tusb_error_t rndis_body_subtask(void);
-static tusb_error_t send_message_get_response_subtask( uint8_t dev_addr, cdch_data_t *p_cdc,
-                                                       uint8_t * p_mess, uint32_t mess_length,
-                                                       uint8_t *p_response );
+
+// Arm a free receive buffer, buffers held by application or being processed are skipped
+static bool rx_start(rndish_interface_t* p_rndis) {
+  TU_VERIFY(p_rndis->mounted && p_rndis->rx_pending == RNDISH_RX_IDLE);
+
+  uint8_t buf_idx;
+  for (buf_idx = 0; buf_idx < CFG_TUH_CDC_RNDIS_RX_BUFNUM; buf_idx++) {
+    if (p_rndis->rx_ref[buf_idx] == 0) break;
+  }
+  TU_VERIFY(buf_idx < CFG_TUH_CDC_RNDIS_RX_BUFNUM);
+
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_in));
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_in, p_rndis->rx_buf[buf_idx], CFG_TUH_CDC_RNDIS_RX_BUFSIZE)) {
+    (void) usbh_edpt_release(p_rndis->daddr, p_rndis->ep_in);
+    return false;
+  }
+
+  p_rndis->rx_pending = buf_idx;
+  return true;
+}
+
+static bool notif_start(rndish_interface_t* p_rndis) {
+  TU_VERIFY(p_rndis->ep_notif);
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_notif));
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_notif, p_rndis->notif_buf, RNDISH_NOTIF_BUFSIZE)) {
+    (void) usbh_edpt_release(p_rndis->daddr, p_rndis->ep_notif);
+    return false;
+  }
+  return true;
+}
+
+// Send fill buffer if bulk OUT is idle then swap buffers
+static bool tx_send(rndish_interface_t* p_rndis) {
+  TU_VERIFY(p_rndis->tx_count && p_rndis->tx_reserve_len == 0);
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_out));
+
+  uint8_t* buf = get_tx_buf(p_rndis, p_rndis->tx_fill);
+  uint16_t len = p_rndis->tx_len;
+
+  // RNDIS terminates transfer of packet size multiple with a one-byte short packet instead of ZLP,
+  // tx_xfer_max leaves room for it
+  if ((len % p_rndis->ep_out_size) == 0) buf[len++] = 0;
+
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_out, buf, len)) {
+    (void) usbh_edpt_release(p_rndis->daddr, p_rndis->ep_out);
+    return false;
+  }
+
+  p_rndis->tx_fill ^= 1;
+  p_rndis->tx_count = 0;
+  p_rndis->tx_len = 0;
+
+  return true;
+}
+
+// De-aggregate packet messages of a receive transfer and pass each frame to application
+static void rx_process(uint8_t idx, rndish_interface_t* p_rndis, uint8_t buf_idx, uint16_t len) {
+  uint8_t const* buf = p_rndis->rx_buf[buf_idx];
+  uint16_t offset = 0;
+
+  while ((uint32_t) offset + RNDISH_PACKET_HDR_LEN <= len) {
+    uint8_t const* msg = buf + offset;
+    uint32_t const msg_type = msg_read32(msg, offsetof(rndis_msg_packet_t, type));
+    uint32_t const msg_len = msg_read32(msg, offsetof(rndis_msg_packet_t, length));
+    if (msg_type != RNDIS_MSG_PACKET || msg_len < RNDISH_PACKET_HDR_LEN || offset + msg_len > len) break;
+
+    // data offset is relative to data_offset field
+    uint32_t const data_offset = offsetof(rndis_msg_packet_t, data_offset) +
+                                 msg_read32(msg, offsetof(rndis_msg_packet_t, data_offset));
+    uint32_t const data_len = msg_read32(msg, offsetof(rndis_msg_packet_t, data_length));
+
+    if (data_len && data_offset + data_len <= msg_len && tuh_rndis_rx_cb) {
+      if (tuh_rndis_rx_cb(idx, msg + data_offset, (uint16_t) data_len)) p_rndis->rx_ref[buf_idx]++;
+    }
+
+    offset = (uint16_t) (offset + msg_len);
+  }
+}
 
 //--------------------------------------------------------------------+
-// APPLICATION API
+// Interface API
 //--------------------------------------------------------------------+
-tusb_error_t tusbh_cdc_rndis_get_mac_addr(uint8_t dev_addr, uint8_t mac_address[6])
-{
-  TU_ASSERT( tusbh_cdc_rndis_is_mounted(dev_addr),  TUSB_ERROR_CDCH_DEVICE_NOT_MOUNTED);
-  TU_VERIFY( mac_address,  TUSB_ERROR_INVALID_PARA);
+uint8_t tuh_rndis_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_CDC_RNDIS; idx++) {
+    rndish_interface_t const* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr && p_rndis->itf_num == itf_num) return idx;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_rndis_mounted(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis);
+  return p_rndis->mounted;
+}
+
+bool tuh_rndis_get_mac(uint8_t idx, uint8_t mac[6]) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted);
+  memcpy(mac, p_rndis->mac, 6);
+  return true;
+}
 
-  memcpy(mac_address, rndish_data[dev_addr-1].mac_address, 6);
+bool tuh_rndis_link_up(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted);
+  return p_rndis->link_up;
+}
 
-  return TUSB_ERROR_NONE;
+//--------------------------------------------------------------------+
+// Receive API
+//--------------------------------------------------------------------+
+void tuh_rndis_rx_free(uint8_t idx, uint8_t const* frame) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis,);
+
+  for (uint8_t buf_idx = 0; buf_idx < CFG_TUH_CDC_RNDIS_RX_BUFNUM; buf_idx++) {
+    uint8_t const* buf = p_rndis->rx_buf[buf_idx];
+    if (frame >= buf && frame < buf + CFG_TUH_CDC_RNDIS_RX_BUFSIZE) {
+      TU_VERIFY(p_rndis->rx_ref[buf_idx],);
+      p_rndis->rx_ref[buf_idx]--;
+
+      // all buffers were held: endpoint is idle
+      (void) rx_start(p_rndis);
+      return;
+    }
+  }
 }
 
 //--------------------------------------------------------------------+
-// IMPLEMENTATION
+// Transmit API
 //--------------------------------------------------------------------+
+uint8_t* tuh_rndis_xmit_reserve(uint8_t idx, uint16_t len) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted && len, NULL);
+
+  // second attempt after sending full fill buffer if bus is idle
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint16_t const offset = tx_next_offset(p_rndis);
+    if (p_rndis->tx_count < p_rndis->tx_packets_max &&
+        (uint32_t) offset + RNDISH_PACKET_HDR_LEN + len <= p_rndis->tx_xfer_max) {
+      p_rndis->tx_reserve_off = offset;
+      p_rndis->tx_reserve_len = len;
+      return get_tx_buf(p_rndis, p_rndis->tx_fill) + offset + RNDISH_PACKET_HDR_LEN;
+    }
+
+    // frame does not fit into an empty buffer, or both buffers are in use
+    p_rndis->tx_reserve_len = 0;
+    if (!tx_send(p_rndis)) return NULL;
+  }
 
-// To enable the TASK_ASSERT style (quick return on false condition) in a real RTOS, a task must act as a wrapper
-// and is used mainly to call subtasks. Within a subtask return statement can be called freely, the task with
-// forever loop cannot have any return at all.
-OSAL_TASK_FUNCTION(cdch_rndis_task) (void* param;)
-{
-  OSAL_TASK_BEGIN
-  rndis_body_subtask();
-  OSAL_TASK_END
+  return NULL;
 }
 
-static tusb_error_t rndis_body_subtask(void)
-{
-  static uint8_t relative_addr;
+bool tuh_rndis_xmit_commit(uint8_t idx, uint16_t len) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->tx_reserve_len && len <= p_rndis->tx_reserve_len);
 
-  OSAL_SUBTASK_BEGIN
+  p_rndis->tx_reserve_len = 0;
+  if (len == 0) return true; // cancel reservation
 
-  for (relative_addr = 0; relative_addr < CFG_TUH_DEVICE_MAX; relative_addr++)
-  {
+  uint8_t* buf = get_tx_buf(p_rndis, p_rndis->tx_fill);
+  uint16_t const offset = p_rndis->tx_reserve_off;
 
+  // previous message length includes padding up to this one
+  if (p_rndis->tx_count) {
+    msg_write32(buf + p_rndis->tx_last, offsetof(rndis_msg_packet_t, length), (uint32_t) (offset - p_rndis->tx_last));
   }
 
-  osal_task_delay(100);
+  uint8_t* msg = buf + offset;
+  tu_memclr(msg, RNDISH_PACKET_HDR_LEN);
+  msg_write32(msg, offsetof(rndis_msg_packet_t, type), RNDIS_MSG_PACKET);
+  msg_write32(msg, offsetof(rndis_msg_packet_t, length), (uint32_t) (RNDISH_PACKET_HDR_LEN + len));
+  msg_write32(msg, offsetof(rndis_msg_packet_t, data_offset), RNDISH_PACKET_HDR_LEN - offsetof(rndis_msg_packet_t, data_offset));
+  msg_write32(msg, offsetof(rndis_msg_packet_t, data_length), len);
+
+  p_rndis->tx_last = offset;
+  p_rndis->tx_len = (uint16_t) (offset + RNDISH_PACKET_HDR_LEN + len);
+  p_rndis->tx_count++;
+
+  // send now if idle, otherwise frame is concatenated and sent when current transfer completes
+  (void) tx_send(p_rndis);
+
+  return true;
+}
+
+bool tuh_rndis_xmit(uint8_t idx, void const* frame, uint16_t len) {
+  uint8_t* buf = tuh_rndis_xmit_reserve(idx, len);
+  TU_VERIFY(buf);
+  memcpy(buf, frame, len);
+  return tuh_rndis_xmit_commit(idx, len);
+}
+
+bool tuh_rndis_xmit_flush(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted);
+  return tx_send(p_rndis);
+}
+
+//--------------------------------------------------------------------+
+// Control Message
+//--------------------------------------------------------------------+
+
+static bool encapsulated_xfer(rndish_interface_t* p_rndis, uint8_t dir, uint16_t len,
+                              tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  tusb_control_request_t const req = {
+    .bmRequestType_bit = {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = dir
+    },
+    .bRequest = (dir == TUSB_DIR_OUT) ? CDC_REQUEST_SEND_ENCAPSULATED_COMMAND : CDC_REQUEST_GET_ENCAPSULATED_RESPONSE,
+    .wValue   = 0,
+    .wIndex   = tu_htole16((uint16_t) p_rndis->itf_num),
+    .wLength  = tu_htole16(len)
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_rndis->daddr,
+    .ep_addr     = 0,
+    .setup       = &req,
+    .buffer      = p_rndis->ctrl_buf,
+    .complete_cb = complete_cb,
+    .user_data   = user_data
+  };
+
+  return tuh_control_xfer(&xfer);
+}
 
-  OSAL_SUBTASK_END
+// Build message header in control buffer: type, length, request id
+static uint8_t* msg_prepare(rndish_interface_t* p_rndis, uint32_t type, uint16_t len) {
+  uint8_t* msg = p_rndis->ctrl_buf;
+  tu_memclr(msg, len);
+  msg_write32(msg, 0, type);
+  msg_write32(msg, 4, len);
+  msg_write32(msg, 8, ++p_rndis->request_id);
+  return msg;
+}
+
+static void status_complete(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) xfer->user_data;
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->daddr == xfer->daddr,);
+
+  p_rndis->ctrl_busy = false;
+  if (xfer->result != XFER_RESULT_SUCCESS || xfer->actual_len < 12 ||
+      xfer->setup->bRequest != CDC_REQUEST_GET_ENCAPSULATED_RESPONSE) {
+    return;
+  }
+
+  uint8_t const* msg = p_rndis->ctrl_buf;
+  uint32_t const msg_type = msg_read32(msg, 0);
+
+  if (msg_type == RNDIS_MSG_INDICATE_STATUS) {
+    uint32_t const status = msg_read32(msg, 8);
+    if (status == RNDIS_STATUS_MEDIA_CONNECT || status == RNDIS_STATUS_MEDIA_DISCONNECT) {
+      bool const up = (status == RNDIS_STATUS_MEDIA_CONNECT);
+      if (up != p_rndis->link_up) {
+        p_rndis->link_up = up;
+        TU_LOG_DRV("[%u] RNDIS link %s\r\n", p_rndis->daddr, up ? "up" : "down");
+        if (tuh_rndis_link_cb) tuh_rndis_link_cb(idx, up);
+      }
+    }
+  } else if (msg_type == RNDIS_MSG_KEEP_ALIVE) {
+    // device checks that host is alive
+    uint32_t const request_id = msg_read32(msg, 8);
+    uint8_t* reply = p_rndis->ctrl_buf;
+    tu_memclr(reply, sizeof(rndis_msg_keep_alive_cmplt_t));
+    msg_write32(reply, 0, RNDIS_MSG_KEEP_ALIVE_CMPLT);
+    msg_write32(reply, 4, sizeof(rndis_msg_keep_alive_cmplt_t));
+    msg_write32(reply, 8, request_id);
+    msg_write32(reply, 12, RNDIS_STATUS_SUCCESS);
+    p_rndis->ctrl_busy = encapsulated_xfer(p_rndis, TUSB_DIR_OUT, sizeof(rndis_msg_keep_alive_cmplt_t),
+                                           status_complete, idx);
+  }
 }
 
 //--------------------------------------------------------------------+
-// RNDIS-CDC Driver API
+// USBH API
 //--------------------------------------------------------------------+
-void rndish_init(void)
-{
-  tu_memclr(rndish_data, sizeof(rndish_data_t)*CFG_TUH_DEVICE_MAX);
+void rndish_init(void) {
+  tu_memclr(_rndish_itf, sizeof(_rndish_itf));
+}
+
+bool rndish_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_epaddr(daddr, ep_addr);
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis);
 
-  //------------- Task creation -------------//
+  if (ep_addr == p_rndis->ep_out) {
+    // packets concatenated while previous transfer was in flight
+    (void) tx_send(p_rndis);
 
-  //------------- semaphore creation for notification pipe -------------//
-  for(uint8_t i=0; i<CFG_TUH_DEVICE_MAX; i++)
-  {
-    rndish_data[i].sem_notification_hdl = osal_semaphore_create( OSAL_SEM_REF(rndish_data[i].semaphore_notification) );
+    if (tuh_rndis_tx_complete_cb) tuh_rndis_tx_complete_cb(idx);
+  } else if (ep_addr == p_rndis->ep_in) {
+    uint8_t const buf_idx = p_rndis->rx_pending;
+    p_rndis->rx_pending = RNDISH_RX_IDLE;
+    TU_VERIFY(result == XFER_RESULT_SUCCESS && buf_idx < CFG_TUH_CDC_RNDIS_RX_BUFNUM);
+
+    // keep endpoint busy with another buffer while this one is processed
+    p_rndis->rx_ref[buf_idx]++;
+    (void) rx_start(p_rndis);
+
+    rx_process(idx, p_rndis, buf_idx, (uint16_t) xferred_bytes);
+
+    p_rndis->rx_ref[buf_idx]--;
+    (void) rx_start(p_rndis);
+  } else if (ep_addr == p_rndis->ep_notif) {
+    TU_VERIFY(result == XFER_RESULT_SUCCESS);
+
+    // RESPONSE_AVAILABLE: read the message e.g status indication
+    if (xferred_bytes >= 1 && p_rndis->notif_buf[0] == CDC_NOTIF_RESPONSE_AVAILABLE && !p_rndis->ctrl_busy) {
+      p_rndis->ctrl_busy = encapsulated_xfer(p_rndis, TUSB_DIR_IN, RNDISH_CTRL_BUFSIZE, status_complete, idx);
+    }
+
+    (void) notif_start(p_rndis);
   }
+
+  return true;
 }
 
-void rndish_close(uint8_t dev_addr)
-{
-  osal_semaphore_reset( rndish_data[dev_addr-1].sem_notification_hdl );
-//  tu_memclr(&rndish_data[dev_addr-1], sizeof(rndish_data_t)); TODO need to move semaphore & its handle out before memclr
+void rndish_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_CDC_RNDIS; idx++) {
+    rndish_interface_t* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr) {
+      TU_LOG_DRV("  RNDISh close addr = %u index = %u\r\n", daddr, idx);
+      if (p_rndis->mounted && tuh_rndis_umount_cb) tuh_rndis_umount_cb(idx);
+      tu_memclr(p_rndis, offsetof(rndish_interface_t, ctrl_buf));
+    }
+  }
 }
 
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
 
-static rndis_msg_initialize_t const msg_init =
-{
-    .type          = RNDIS_MSG_INITIALIZE,
-    .length        = sizeof(rndis_msg_initialize_t),
-    .request_id    = 1, // TODO should use some magic number
-    .major_version = 1,
-    .minor_version = 0,
-    .max_xfer_size = 0x4000 // TODO mimic windows
-};
+// Communication interface of RNDIS function, as used by Windows, Android and Linux gadget
+static bool is_rndis_itf(tusb_desc_interface_t const* desc_itf) {
+  uint8_t const cls = desc_itf->bInterfaceClass;
+  uint8_t const subclass = desc_itf->bInterfaceSubClass;
+  uint8_t const protocol = desc_itf->bInterfaceProtocol;
 
-static rndis_msg_query_t const msg_query_permanent_addr =
-{
-    .type          = RNDIS_MSG_QUERY,
-    .length        = sizeof(rndis_msg_query_t)+6,
-    .request_id    = 1,
-    .oid           = RNDIS_OID_802_3_PERMANENT_ADDRESS,
-    .buffer_length = 6,
-    .buffer_offset = 20,
-};
+  return (cls == TUSB_CLASS_CDC && subclass == CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL && protocol == 0xFF) ||
+         (cls == TUSB_CLASS_WIRELESS_CONTROLLER && subclass == 0x01 && protocol == 0x03) ||
+         (cls == TUSB_CLASS_MISC && subclass == 0x04 && protocol == 0x01);
+}
 
-static rndis_msg_set_t const msg_set_packet_filter =
-{
-    .type          = RNDIS_MSG_SET,
-    .length        = sizeof(rndis_msg_set_t)+4,
-    .request_id    = 1,
-    .oid           = RNDIS_OID_GEN_CURRENT_PACKET_FILTER,
-    .buffer_length = 4,
-    .buffer_offset = 20,
-};
+bool rndish_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(is_rndis_itf(desc_itf));
+  TU_LOG_DRV("[%u] RNDIS opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
 
-tusb_error_t rndish_open_subtask(uint8_t dev_addr, cdch_data_t *p_cdc)
-{
-  tusb_error_t error;
-
-  OSAL_SUBTASK_BEGIN
-
-  //------------- Message Initialize -------------//
-  memcpy(msg_payload, &msg_init, sizeof(rndis_msg_initialize_t));
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_initialize_t),
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  // TODO currently not support multiple data packets per xfer
-  rndis_msg_initialize_cmplt_t * const p_init_cmpt = (rndis_msg_initialize_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_init_cmpt->type == RNDIS_MSG_INITIALIZE_CMPLT && p_init_cmpt->status == RNDIS_STATUS_SUCCESS &&
-                 p_init_cmpt->max_packet_per_xfer == 1 && p_init_cmpt->max_xfer_size <= RNDIS_MSG_PAYLOAD_MAX);
-  rndish_data[dev_addr-1].max_xfer_size = p_init_cmpt->max_xfer_size;
-
-  //------------- Message Query 802.3 Permanent Address -------------//
-  memcpy(msg_payload, &msg_query_permanent_addr, sizeof(rndis_msg_query_t));
-  tu_memclr(msg_payload + sizeof(rndis_msg_query_t), 6); // 6 bytes for MAC address
-
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_query_t) + 6,
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  rndis_msg_query_cmplt_t * const p_query_cmpt = (rndis_msg_query_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_query_cmpt->type == RNDIS_MSG_QUERY_CMPLT && p_query_cmpt->status == RNDIS_STATUS_SUCCESS);
-  memcpy(rndish_data[dev_addr-1].mac_address, msg_payload + 8 + p_query_cmpt->buffer_offset, 6);
-
-  //------------- Set OID_GEN_CURRENT_PACKET_FILTER to (DIRECTED | MULTICAST | BROADCAST) -------------//
-  memcpy(msg_payload, &msg_set_packet_filter, sizeof(rndis_msg_set_t));
-  tu_memclr(msg_payload + sizeof(rndis_msg_set_t), 4); // 4 bytes for filter flags
-  ((rndis_msg_set_t*) msg_payload)->oid_buffer[0] = (RNDIS_PACKET_TYPE_DIRECTED | RNDIS_PACKET_TYPE_MULTICAST | RNDIS_PACKET_TYPE_BROADCAST);
-
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_set_t) + 4,
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  rndis_msg_set_cmplt_t * const p_set_cmpt = (rndis_msg_set_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_set_cmpt->type == RNDIS_MSG_SET_CMPLT && p_set_cmpt->status == RNDIS_STATUS_SUCCESS);
-
-  tusbh_cdc_rndis_mounted_cb(dev_addr);
-
-  OSAL_SUBTASK_END
-}
-
-void rndish_xfer_isr(cdch_data_t *p_cdc, pipe_handle_t pipe_hdl, xfer_result_t event, uint32_t xferred_bytes)
-{
-  if ( pipehandle_is_equal(pipe_hdl, p_cdc->pipe_notification) )
-  {
-    osal_semaphore_post( rndish_data[pipe_hdl.dev_addr-1].sem_notification_hdl );
+  rndish_interface_t* p_rndis = find_new_itf();
+  TU_ASSERT(p_rndis); // not enough interface, try to increase CFG_TUH_CDC_RNDIS
+
+  p_rndis->daddr = daddr;
+  p_rndis->itf_num = desc_itf->bInterfaceNumber;
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  uint8_t const* desc_end = ((uint8_t const*) desc_itf) + max_len;
+
+  //------------- Communication interface: functional descriptors + notification endpoint -------------//
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer && TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+        p_rndis->ep_notif = desc_ep->bEndpointAddress;
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
   }
+
+  //------------- Data interface: bulk pair in alternate 0 -------------//
+  if (p_desc < desc_end && TUSB_DESC_INTERFACE == tu_desc_type(p_desc) &&
+      TUSB_CLASS_CDC_DATA == ((tusb_desc_interface_t const*) p_desc)->bInterfaceClass) {
+    p_rndis->itf_data = ((tusb_desc_interface_t const*) p_desc)->bInterfaceNumber;
+    p_desc = tu_desc_next(p_desc);
+
+    while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+      if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+        tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+        TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+        TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+        if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+          p_rndis->ep_in = desc_ep->bEndpointAddress;
+        } else {
+          p_rndis->ep_out = desc_ep->bEndpointAddress;
+          p_rndis->ep_out_size = tu_edpt_packet_size(desc_ep);
+        }
+      }
+      p_desc = tu_desc_next(p_desc);
+    }
+  }
+
+  if (!(p_rndis->ep_in && p_rndis->ep_out && p_rndis->ep_out_size)) {
+    TU_LOG_DRV("  RNDIS data interface has no bulk endpoints\r\n");
+    tu_memclr(p_rndis, offsetof(rndish_interface_t, ctrl_buf));
+    return false;
+  }
+
+  return true;
 }
 
 //--------------------------------------------------------------------+
-// INTERNAL & HELPER
+// Set Configure
 //--------------------------------------------------------------------+
-static tusb_error_t send_message_get_response_subtask( uint8_t dev_addr, cdch_data_t *p_cdc,
-                                                       uint8_t * p_mess, uint32_t mess_length,
-                                                       uint8_t *p_response)
-{
-  tusb_error_t error;
-
-  OSAL_SUBTASK_BEGIN
-
-  //------------- Send RNDIS Control Message -------------//
-  STASK_INVOKE(
-      usbh_control_xfer_subtask( dev_addr, bm_request_type(TUSB_DIR_OUT, TUSB_REQ_TYPE_CLASS, TUSB_REQ_RCPT_INTERFACE),
-                                 CDC_REQUEST_SEND_ENCAPSULATED_COMMAND, 0, p_cdc->interface_number,
-                                 mess_length, p_mess),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  //------------- waiting for Response Available notification -------------//
-  (void) usbh_edpt_xfer(p_cdc->pipe_notification, msg_notification[dev_addr-1], 8);
-  osal_semaphore_wait(rndish_data[dev_addr-1].sem_notification_hdl, OSAL_TIMEOUT_NORMAL, &error);
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-  STASK_ASSERT(msg_notification[dev_addr-1][0] == 1);
-
-  //------------- Get RNDIS Message Initialize Complete -------------//
-  STASK_INVOKE(
-    usbh_control_xfer_subtask( dev_addr, bm_request_type(TUSB_DIR_IN, TUSB_REQ_TYPE_CLASS, TUSB_REQ_RCPT_INTERFACE),
-                               CDC_REQUEST_GET_ENCAPSULATED_RESPONSE, 0, p_cdc->interface_number,
-                               RNDIS_MSG_PAYLOAD_MAX, p_response),
-    error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  OSAL_SUBTASK_END
-}
-
-//static tusb_error_t send_process_msg_initialize_subtask(uint8_t dev_addr, cdch_data_t *p_cdc)
-//{
-//  tusb_error_t error;
-//
-//  OSAL_SUBTASK_BEGIN
-//
-//  *((rndis_msg_initialize_t*) msg_payload) = (rndis_msg_initialize_t)
-//                                            {
-//                                                .type          = RNDIS_MSG_INITIALIZE,
-//                                                .length        = sizeof(rndis_msg_initialize_t),
-//                                                .request_id    = 1, // TODO should use some magic number
-//                                                .major_version = 1,
-//                                                .minor_version = 0,
-//                                                .max_xfer_size = 0x4000 // TODO mimic windows
-//                                            };
-//
-//
-//
-//  OSAL_SUBTASK_END
-//}
+
+enum {
+  CONFIG_INITIALIZE = 0,
+  CONFIG_QUERY_MAC,
+  CONFIG_SET_PACKET_FILTER,
+};
+
+// user_data of internal control transfer: interface index in high byte, command in low byte. Response flag is
+// set while encapsulated response of the command is read.
+#define CONFIG_RESPONSE                  0x80u
+#define CONFIG_USER_DATA(_idx, _state)   ((uintptr_t) (((_idx) << 8) | (_state)))
+
+static void process_set_config(tuh_xfer_t* xfer);
+
+static bool config_command(rndish_interface_t* p_rndis, uint8_t idx, uint16_t len, uint8_t state) {
+  return encapsulated_xfer(p_rndis, TUSB_DIR_OUT, len, process_set_config, CONFIG_USER_DATA(idx, state));
+}
+
+static bool config_response(rndish_interface_t* p_rndis, uint8_t idx, uint8_t state) {
+  return encapsulated_xfer(p_rndis, TUSB_DIR_IN, RNDISH_CTRL_BUFSIZE, process_set_config,
+                           CONFIG_USER_DATA(idx, state | CONFIG_RESPONSE));
+}
+
+static bool send_initialize(rndish_interface_t* p_rndis, uint8_t idx) {
+  uint8_t* msg = msg_prepare(p_rndis, RNDIS_MSG_INITIALIZE, sizeof(rndis_msg_initialize_t));
+  msg_write32(msg, offsetof(rndis_msg_initialize_t, major_version), 1);
+  msg_write32(msg, offsetof(rndis_msg_initialize_t, minor_version), 0);
+  msg_write32(msg, offsetof(rndis_msg_initialize_t, max_xfer_size), CFG_TUH_CDC_RNDIS_RX_BUFSIZE);
+  return config_command(p_rndis, idx, sizeof(rndis_msg_initialize_t), CONFIG_INITIALIZE);
+}
+
+// Query without data, or Set with a 32-bit value right after the header
+static bool send_oid(rndish_interface_t* p_rndis, uint8_t idx, uint32_t type, uint32_t oid, bool has_value,
+                     uint32_t value, uint8_t state) {
+  uint16_t const buflen = has_value ? 4 : 0;
+  uint16_t const len = (uint16_t) (sizeof(rndis_msg_query_t) + buflen);
+  uint8_t* msg = msg_prepare(p_rndis, type, len);
+  msg_write32(msg, offsetof(rndis_msg_query_t, oid), oid);
+  msg_write32(msg, offsetof(rndis_msg_query_t, buffer_length), buflen);
+  // offset is relative to request_id field
+  msg_write32(msg, offsetof(rndis_msg_query_t, buffer_offset), buflen ? sizeof(rndis_msg_query_t) - 8 : 0);
+  if (has_value) msg_write32(msg, sizeof(rndis_msg_query_t), value);
+  return config_command(p_rndis, idx, len, state);
+}
+
+static void config_mount_complete(rndish_interface_t* p_rndis, uint8_t idx) {
+  p_rndis->mounted = true;
+  p_rndis->link_up = true; // until reported otherwise
+  p_rndis->rx_pending = RNDISH_RX_IDLE;
+  p_rndis->tx_fill = 0;
+
+  TU_LOG_DRV("[%u] RNDIS mounted: MAC %02X:%02X:%02X:%02X:%02X:%02X, %u packets/xfer of %u bytes\r\n",
+             p_rndis->daddr, p_rndis->mac[0], p_rndis->mac[1], p_rndis->mac[2], p_rndis->mac[3], p_rndis->mac[4],
+             p_rndis->mac[5], p_rndis->tx_packets_max, p_rndis->tx_xfer_max);
+
+  if (tuh_rndis_mount_cb) tuh_rndis_mount_cb(idx);
+
+  (void) rx_start(p_rndis);
+  (void) notif_start(p_rndis);
+}
+
+bool rndish_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_rndis_itf_get_index(daddr, itf_num);
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_ASSERT(p_rndis);
+
+  TU_ASSERT(send_initialize(p_rndis, idx));
+  return true;
+}
+
+// Handle encapsulated response of a command, return false if it is not successful
+static bool config_parse_response(rndish_interface_t* p_rndis, uint8_t cmd, uint16_t len) {
+  static uint32_t const cmplt_type[] = {
+    [CONFIG_INITIALIZE]        = RNDIS_MSG_INITIALIZE_CMPLT,
+    [CONFIG_QUERY_MAC]         = RNDIS_MSG_QUERY_CMPLT,
+    [CONFIG_SET_PACKET_FILTER] = RNDIS_MSG_SET_CMPLT,
+  };
+
+  uint8_t const* msg = p_rndis->ctrl_buf;
+  TU_VERIFY(len >= sizeof(rndis_msg_set_cmplt_t) && msg_read32(msg, 0) == cmplt_type[cmd] &&
+            msg_read32(msg, 8) == p_rndis->request_id && msg_read32(msg, 12) == RNDIS_STATUS_SUCCESS);
+
+  switch (cmd) {
+    case CONFIG_INITIALIZE: {
+      TU_VERIFY(len >= offsetof(rndis_msg_initialize_cmplt_t, reserved));
+      uint32_t const packets_max = msg_read32(msg, offsetof(rndis_msg_initialize_cmplt_t, max_packet_per_xfer));
+      uint32_t const xfer_max = msg_read32(msg, offsetof(rndis_msg_initialize_cmplt_t, max_xfer_size));
+      uint32_t const align = msg_read32(msg, offsetof(rndis_msg_initialize_cmplt_t, packet_alignment_factor));
+
+      // one byte is reserved for short packet termination. Messages are at least 4-byte aligned for headers
+      p_rndis->tx_xfer_max = (uint16_t) tu_min32(CFG_TUH_CDC_RNDIS_TX_BUFSIZE - 1, xfer_max);
+      p_rndis->tx_packets_max = (uint8_t) tu_max32(1, tu_min32(CFG_TUH_CDC_RNDIS_TX_PACKETS_MAX, packets_max));
+      p_rndis->tx_align = (uint8_t) tu_min32(tu_max32(2, align), 7);
+      break;
+    }
+
+    case CONFIG_QUERY_MAC: {
+      uint32_t const buflen = msg_read32(msg, offsetof(rndis_msg_query_cmplt_t, buffer_length));
+      uint32_t const bufoff = 8 + msg_read32(msg, offsetof(rndis_msg_query_cmplt_t, buffer_offset));
+      TU_VERIFY(buflen >= 6 && bufoff + 6 <= len);
+      memcpy(p_rndis->mac, msg + bufoff, 6);
+      break;
+    }
+
+    default: break;
+  }
+
+  return true;
+}
+
+static void process_set_config(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uint8_t const state = (uint8_t) (xfer->user_data & 0xff);
+  uint8_t const cmd = state & (uint8_t) ~CONFIG_RESPONSE;
+  uint8_t const daddr = xfer->daddr;
+
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->daddr == daddr,);
+  uint8_t const itf_last = tu_max8(p_rndis->itf_num, p_rndis->itf_data);
+
+  if (xfer->result != XFER_RESULT_SUCCESS) {
+    TU_LOG_DRV("[%u] RNDIS configuration failed at state %02X\r\n", daddr, state);
+    usbh_driver_set_config_complete(daddr, itf_last);
+    return;
+  }
+
+  if (!(state & CONFIG_RESPONSE)) {
+    // command is sent, read its response
+    p_rndis->retry = RNDISH_RESPONSE_RETRY;
+    TU_ASSERT(config_response(p_rndis, idx, cmd),);
+    return;
+  }
+
+  // response is not ready yet
+  if (xfer->actual_len < sizeof(rndis_msg_set_cmplt_t) && p_rndis->retry) {
+    p_rndis->retry--;
+    TU_ASSERT(config_response(p_rndis, idx, cmd),);
+    return;
+  }
+
+  if (!config_parse_response(p_rndis, cmd, (uint16_t) xfer->actual_len)) {
+    TU_LOG_DRV("[%u] RNDIS command %u is rejected\r\n", daddr, cmd);
+    usbh_driver_set_config_complete(daddr, itf_last);
+    return;
+  }
+
+  switch (cmd) {
+    case CONFIG_INITIALIZE:
+      TU_ASSERT(send_oid(p_rndis, idx, RNDIS_MSG_QUERY, RNDIS_OID_802_3_PERMANENT_ADDRESS, false, 0,
+                         CONFIG_QUERY_MAC),);
+      break;
+
+    case CONFIG_QUERY_MAC:
+      // receive directed, multicast and broadcast frames
+      TU_ASSERT(send_oid(p_rndis, idx, RNDIS_MSG_SET, RNDIS_OID_GEN_CURRENT_PACKET_FILTER, true,
+                         RNDIS_PACKET_TYPE_DIRECTED | RNDIS_PACKET_TYPE_MULTICAST | RNDIS_PACKET_TYPE_BROADCAST,
+                         CONFIG_SET_PACKET_FILTER),);
+      break;
+
+    case CONFIG_SET_PACKET_FILTER:
+      config_mount_complete(p_rndis, idx);
+      // itf_last to account for data interface as well
+      usbh_driver_set_config_complete(daddr, itf_last);
+      break;
+
+    default:
+      break;
+  }
+}
+
 #endif
@@ -31,8 +31,6 @@
 #ifndef _TUSB_CDC_RNDIS_HOST_H_
 #define _TUSB_CDC_RNDIS_HOST_H_
 
-#include "common/tusb_common.h"
-#include "host/usbh.h"
 #include "cdc_rndis.h"
 
 #ifdef __cplusplus
@@ -40,19 +38,113 @@
 #endif
 
 //--------------------------------------------------------------------+
-// INTERNAL RNDIS-CDC Driver API
+// Class Driver Configuration
+//
+// Host driver for RNDIS devices e.g USB tethering of Android phones. CFG_TUH_CDC_RNDIS is the number of RNDIS
+// interfaces that can be mounted. Ethernet frames are passed to and from the network stack without copy:
+// - Each receive transfer may carry several RNDIS packet messages, each frame is handed to tuh_rndis_rx_cb()
+//   pointing into the receive buffer. The next free receive buffer is armed before frames are processed.
+//   Application (e.g lwIP with a custom/reference pbuf) can keep a frame by returning true from the callback
+//   and give it back later with tuh_rndis_rx_free(), the buffer is re-used once all its frames are freed.
+// - Transmitted frames are written in-place with tuh_rndis_xmit_reserve() + tuh_rndis_xmit_commit(). Frames
+//   queued while a transfer is in progress are concatenated, up to the limits reported by device.
+// API must be called from the same task as tuh_task().
 //--------------------------------------------------------------------+
-typedef struct {
-  OSAL_SEM_DEF(semaphore_notification);
-  osal_semaphore_handle_t sem_notification_hdl;  // used to wait on notification pipe
-  uint32_t max_xfer_size; // got from device's msg initialize complete
-  uint8_t mac_address[6];
-}rndish_data_t;
 
+// Size of each receive buffer, also reported to device as maximum transfer size it may send
+#ifndef CFG_TUH_CDC_RNDIS_RX_BUFSIZE
+  #define CFG_TUH_CDC_RNDIS_RX_BUFSIZE      2048
+#endif
+
+// Number of receive buffers: one is armed while others are processed or held by application
+#ifndef CFG_TUH_CDC_RNDIS_RX_BUFNUM
+  #define CFG_TUH_CDC_RNDIS_RX_BUFNUM       2
+#endif
+
+// Size of each of the 2 transmit buffers
+#ifndef CFG_TUH_CDC_RNDIS_TX_BUFSIZE
+  #define CFG_TUH_CDC_RNDIS_TX_BUFSIZE      2048
+#endif
+
+// Maximum number of packets concatenated into a transmit transfer, further limited by device
+#ifndef CFG_TUH_CDC_RNDIS_TX_PACKETS_MAX
+  #define CFG_TUH_CDC_RNDIS_TX_PACKETS_MAX  8
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_CDC_RNDIS_RX_BUFNUM >= 2 && CFG_TUH_CDC_RNDIS_RX_BUFNUM <= 8, "RNDIS host needs 2 to 8 receive buffers");
+TU_VERIFY_STATIC(CFG_TUH_CDC_RNDIS_RX_BUFSIZE <= UINT16_MAX && CFG_TUH_CDC_RNDIS_TX_BUFSIZE <= UINT16_MAX,
+                 "RNDIS host only supports 16-bit transfers");
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + communication interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_rndis_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Check if interface is mounted
+bool tuh_rndis_mounted(uint8_t idx);
+
+// Get MAC address of device (802.3 permanent address)
+bool tuh_rndis_get_mac(uint8_t idx, uint8_t mac[6]);
+
+// Check if network link is up, as reported by media connect/disconnect status indication
+bool tuh_rndis_link_up(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Receive API
+//--------------------------------------------------------------------+
+
+// Give back a frame kept by returning true from tuh_rndis_rx_cb()
+void tuh_rndis_rx_free(uint8_t idx, uint8_t const* frame);
+
+//--------------------------------------------------------------------+
+// Transmit API
+//--------------------------------------------------------------------+
+
+// Reserve space for an Ethernet frame of up to len bytes in transmit buffer. Return NULL if both buffers
+// are in use, in which case application should retry after tuh_rndis_tx_complete_cb()
+uint8_t* tuh_rndis_xmit_reserve(uint8_t idx, uint16_t len);
+
+// Commit reserved frame with its actual length (<= reserved length). Frame is sent immediately if bus
+// is idle, otherwise it is concatenated and sent when current transfer completes
+bool tuh_rndis_xmit_commit(uint8_t idx, uint16_t len);
+
+// Copy and queue an Ethernet frame, same as reserve + memcpy + commit
+bool tuh_rndis_xmit(uint8_t idx, void const* frame, uint16_t len);
+
+// Send pending frames if bus is idle. Return true if a transfer is started
+bool tuh_rndis_xmit_flush(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when an RNDIS interface is mounted
+TU_ATTR_WEAK void tuh_rndis_mount_cb(uint8_t idx);
+
+// Invoked when an RNDIS interface is unmounted. Frames still held by application are invalid afterwards
+TU_ATTR_WEAK void tuh_rndis_umount_cb(uint8_t idx);
+
+// Invoked for each received Ethernet frame, frame points into receive buffer. Return false if frame is only
+// used within the callback, or true to keep it until tuh_rndis_rx_free() is called
+TU_ATTR_WEAK bool tuh_rndis_rx_cb(uint8_t idx, uint8_t const* frame, uint16_t len);
+
+// Invoked when network link state changes
+TU_ATTR_WEAK void tuh_rndis_link_cb(uint8_t idx, bool up);
+
+// Invoked when a transmit transfer completes and a buffer becomes available
+TU_ATTR_WEAK void tuh_rndis_tx_complete_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
 void rndish_init(void);
-bool rndish_open_subtask(uint8_t dev_addr, cdch_data_t *p_cdc);
-void rndish_xfer_isr(cdch_data_t *p_cdc, pipe_handle_t pipe_hdl, xfer_result_t event, uint32_t xferred_bytes);
-void rndish_close(uint8_t dev_addr);
+bool rndish_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool rndish_set_config(uint8_t daddr, uint8_t itf_num);
+bool rndish_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void rndish_close(uint8_t daddr);
 
 #ifdef __cplusplus
  }
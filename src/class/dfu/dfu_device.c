@@ -47,6 +47,42 @@
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
+#if CFG_TUD_DFU_DECOMPRESS
+#define DZ_WINDOW_SIZE  (1u << CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS)
+
+// heatshrink token fields
+enum
+{
+  DZ_FIELD_TAG = 0,
+  DZ_FIELD_LITERAL,
+  DZ_FIELD_INDEX,
+  DZ_FIELD_COUNT,
+};
+
+typedef struct
+{
+  bool enabled;        // current download is compressed
+  bool flash_pending;  // out_buf is being flashed
+  bool in_cb;          // tud_dfu_download_cb() is being invoked by decompress_run()
+
+  uint8_t field;       // token field being read
+  uint8_t need;        // remaining bits of field
+  uint8_t in_mask;     // next bit of transfer_buf[in_pos]
+  uint16_t bits;       // field value read so far
+  uint16_t in_pos;
+
+  uint16_t index;      // back-reference distance
+  uint16_t count;      // remaining bytes of back-reference
+  uint16_t head;       // window write position
+
+  uint16_t out_len;
+  uint16_t out_block;
+
+  uint8_t out_buf[CFG_TUD_DFU_XFER_BUFSIZE];
+  uint8_t window[DZ_WINDOW_SIZE];
+} dfu_decompress_t;
+#endif
+
 typedef struct
 {
   uint8_t attrs;
@@ -59,7 +95,17 @@ typedef struct
   uint16_t block;
   uint16_t length;
 
-  CFG_TUSB_MEM_ALIGN uint8_t transfer_buf[CFG_TUD_DFU_XFER_BUFSIZE];
+#if CFG_TUD_DFU_PIPELINE
+  bool flash_busy;  // tud_dfu_download_cb() block is being flashed
+  uint8_t buf_idx;  // transfer buffer receiving next block
+  TUD_EPBUF_DEF(transfer_buf2, CFG_TUD_DFU_XFER_BUFSIZE);
+#endif
+
+  TUD_EPBUF_DEF(transfer_buf, CFG_TUD_DFU_XFER_BUFSIZE);
+
+#if CFG_TUD_DFU_DECOMPRESS
+  dfu_decompress_t dz;
+#endif
 } dfu_state_ctx_t;
 
 // Only a single dfu state is allowed
@@ -70,7 +116,127 @@ static void reset_state(void)
   _dfu_ctx.state = DFU_IDLE;
   _dfu_ctx.status = DFU_STATUS_OK;
   _dfu_ctx.flashing_in_progress = false;
+#if CFG_TUD_DFU_PIPELINE
+  _dfu_ctx.flash_busy = false;
+  _dfu_ctx.buf_idx = 0;
+#endif
+#if CFG_TUD_DFU_DECOMPRESS
+  _dfu_ctx.dz.enabled = false;
+  _dfu_ctx.dz.flash_pending = false;
+#endif
+}
+
+// Buffer for the next download block
+static uint8_t* download_buf(void)
+{
+#if CFG_TUD_DFU_PIPELINE
+  if (_dfu_ctx.buf_idx) return _dfu_ctx.transfer_buf2;
+#endif
+  return _dfu_ctx.transfer_buf;
+}
+
+#if CFG_TUD_DFU_DECOMPRESS
+static void decompress_start(void)
+{
+  dfu_decompress_t* dz = &_dfu_ctx.dz;
+  tu_memclr(dz, sizeof(dfu_decompress_t));
+
+  dz->enabled = tud_dfu_compressed_cb && tud_dfu_compressed_cb(_dfu_ctx.alt);
+  dz->field   = DZ_FIELD_TAG;
+  dz->need    = 1;
+}
+
+static inline void decompress_emit(dfu_decompress_t* dz, uint8_t c)
+{
+  dz->out_buf[dz->out_len++] = c;
+  dz->window[dz->head++ & (DZ_WINDOW_SIZE-1)] = c;
+}
+
+// Decode received block into out_buf, return true if out_buf is full, false if input is consumed
+static bool decompress_fill(void)
+{
+  dfu_decompress_t* dz = &_dfu_ctx.dz;
+  uint8_t const* in = _dfu_ctx.transfer_buf;
+
+  while (1)
+  {
+    // copy back-reference from window
+    while ( dz->count && dz->out_len < CFG_TUD_DFU_XFER_BUFSIZE )
+    {
+      decompress_emit(dz, dz->window[(uint16_t) (dz->head - dz->index) & (DZ_WINDOW_SIZE-1)]);
+      dz->count--;
+    }
+
+    if ( dz->out_len == CFG_TUD_DFU_XFER_BUFSIZE ) return true;
+
+    // fields are MSB first and can span DNLOAD blocks
+    while ( dz->need )
+    {
+      if ( dz->in_pos >= _dfu_ctx.length ) return false;
+
+      dz->bits = (uint16_t) ((dz->bits << 1) | ((in[dz->in_pos] & dz->in_mask) ? 1 : 0));
+      dz->need--;
+
+      dz->in_mask >>= 1;
+      if ( !dz->in_mask )
+      {
+        dz->in_mask = 0x80;
+        dz->in_pos++;
+      }
+    }
+
+    switch ( dz->field )
+    {
+      case DZ_FIELD_TAG:
+        dz->field = dz->bits ? DZ_FIELD_LITERAL : DZ_FIELD_INDEX;
+        dz->need  = dz->bits ? 8 : CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS;
+      break;
+
+      case DZ_FIELD_LITERAL:
+        decompress_emit(dz, (uint8_t) dz->bits);
+        dz->field = DZ_FIELD_TAG;
+        dz->need  = 1;
+      break;
+
+      case DZ_FIELD_INDEX:
+        dz->index = (uint16_t) (dz->bits + 1);
+        dz->field = DZ_FIELD_COUNT;
+        dz->need  = CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS;
+      break;
+
+      case DZ_FIELD_COUNT:
+      default:
+        dz->count = (uint16_t) (dz->bits + 1);
+        dz->field = DZ_FIELD_TAG;
+        dz->need  = 1;
+      break;
+    }
+
+    dz->bits = 0;
+  }
+}
+
+// Decode received block and flash every full output block, state is DFU_DNBUSY
+static void decompress_run(void)
+{
+  dfu_decompress_t* dz = &_dfu_ctx.dz;
+
+  while ( decompress_fill() )
+  {
+    dz->flash_pending = true;
+    dz->in_cb = true;
+    tud_dfu_download_cb(_dfu_ctx.alt, dz->out_block, dz->out_buf, dz->out_len);
+    dz->in_cb = false;
+
+    // flashing asynchronously or failed: resumed by tud_dfu_finish_flashing()
+    if ( dz->flash_pending || _dfu_ctx.state != DFU_DNBUSY ) return;
+  }
+
+  // received block is consumed, ready for the next one
+  _dfu_ctx.flashing_in_progress = false;
+  _dfu_ctx.state = DFU_DNLOAD_SYNC;
 }
+#endif
 
 static bool reply_getstatus(uint8_t rhport, tusb_control_request_t const * request, dfu_state_t state, dfu_status_t status, uint32_t timeout);
 static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
@@ -294,7 +460,7 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
 
           uint16_t const xfer_len = tud_dfu_upload_cb(_dfu_ctx.alt, request->wValue, _dfu_ctx.transfer_buf, request->wLength);
 
-          return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, xfer_len);
+          return tud_control_xfer_direct(rhport, request, _dfu_ctx.transfer_buf, xfer_len);
         }
       break;
 
@@ -312,11 +478,17 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
           _dfu_ctx.block  = request->wValue;
           _dfu_ctx.length = request->wLength;
 
+#if CFG_TUD_DFU_DECOMPRESS
+          if ( _dfu_ctx.state == DFU_IDLE ) decompress_start();
+          _dfu_ctx.dz.in_pos  = 0;
+          _dfu_ctx.dz.in_mask = 0x80;
+#endif
+
           if ( request->wLength )
           {
             // Download with payload -> transition to DOWNLOAD SYNC
             _dfu_ctx.state = DFU_DNLOAD_SYNC;
-            return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, request->wLength);
+            return tud_control_xfer_direct(rhport, request, download_buf(), request->wLength);
           }
           else
           {
@@ -356,6 +528,52 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
 
 void tud_dfu_finish_flashing(uint8_t status)
 {
+#if CFG_TUD_DFU_DECOMPRESS
+  if ( _dfu_ctx.dz.flash_pending )
+  {
+    _dfu_ctx.dz.flash_pending = false;
+
+    if ( status == DFU_STATUS_OK )
+    {
+      _dfu_ctx.dz.out_len = 0;
+      _dfu_ctx.dz.out_block++;
+
+      if ( _dfu_ctx.state == DFU_DNBUSY )
+      {
+        // continue decoding current block, or let decompress_run() loop if invoked from its callback
+        if ( !_dfu_ctx.dz.in_cb ) decompress_run();
+        return;
+      }
+      else if ( _dfu_ctx.state == DFU_MANIFEST )
+      {
+        // last partial block is flashed
+        tud_dfu_manifest_cb(_dfu_ctx.alt);
+        return;
+      }
+    }
+  }
+#endif
+
+#if CFG_TUD_DFU_PIPELINE
+  if ( _dfu_ctx.flash_busy )
+  {
+    // Block of the other buffer is done, the pending one (if any) is started on next GETSTATUS
+    _dfu_ctx.flash_busy = false;
+
+    if ( status == DFU_STATUS_OK )
+    {
+      if (_dfu_ctx.state == DFU_DNBUSY) _dfu_ctx.state = DFU_DNLOAD_SYNC;
+    }
+    else
+    {
+      _dfu_ctx.flashing_in_progress = false;
+      _dfu_ctx.state = DFU_ERROR;
+      _dfu_ctx.status = (dfu_status_t)status;
+    }
+    return;
+  }
+#endif
+
   _dfu_ctx.flashing_in_progress = false;
 
   if ( status == DFU_STATUS_OK )
@@ -378,6 +596,42 @@ void tud_dfu_finish_flashing(uint8_t status)
   }
 }
 
+#if CFG_TUD_DFU_PIPELINE
+static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  // Received block is flashed as soon as the previous one is finished, host can send the next block meanwhile
+  if ( stage == CONTROL_STAGE_SETUP )
+  {
+    // only transition to next state on CONTROL_STAGE_ACK
+    if ( _dfu_ctx.flash_busy )
+    {
+      return reply_getstatus(rhport, request, DFU_DNBUSY, _dfu_ctx.status, tud_dfu_get_timeout_cb(_dfu_ctx.alt, DFU_DNBUSY));
+    }
+    else
+    {
+      return reply_getstatus(rhport, request, DFU_DNLOAD_IDLE, _dfu_ctx.status, 0);
+    }
+  }
+  else if ( stage == CONTROL_STAGE_ACK )
+  {
+    if ( _dfu_ctx.flash_busy )
+    {
+      _dfu_ctx.state = DFU_DNBUSY;
+    }
+    else
+    {
+      // hand over the received buffer, next block goes to the other one
+      uint8_t const* data = download_buf();
+      _dfu_ctx.buf_idx ^= 1;
+      _dfu_ctx.flash_busy = true;
+      _dfu_ctx.state = DFU_DNLOAD_IDLE;
+      tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block, data, _dfu_ctx.length);
+    }
+  }
+
+  return true;
+}
+#else
 static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
   if ( stage == CONTROL_STAGE_SETUP )
@@ -404,7 +658,16 @@ static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_cont
     if ( _dfu_ctx.flashing_in_progress )
     {
       _dfu_ctx.state = DFU_DNBUSY;
-      tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block, _dfu_ctx.transfer_buf, _dfu_ctx.length);
+#if CFG_TUD_DFU_DECOMPRESS
+      if ( _dfu_ctx.dz.enabled )
+      {
+        decompress_run();
+      }
+      else
+#endif
+      {
+        tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block, _dfu_ctx.transfer_buf, _dfu_ctx.length);
+      }
     }else
     {
       _dfu_ctx.state = DFU_DNLOAD_IDLE;
@@ -413,6 +676,7 @@ static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_cont
 
   return true;
 }
+#endif
 
 static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
@@ -422,6 +686,14 @@ static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_cont
     dfu_state_t next_state;
     uint32_t timeout;
 
+#if CFG_TUD_DFU_PIPELINE
+    // last block is still being flashed, keep host polling in manifest sync
+    if ( _dfu_ctx.flash_busy )
+    {
+      return reply_getstatus(rhport, request, DFU_MANIFEST_SYNC, _dfu_ctx.status, tud_dfu_get_timeout_cb(_dfu_ctx.alt, DFU_DNBUSY));
+    }
+#endif
+
     if ( _dfu_ctx.flashing_in_progress )
     {
       next_state = DFU_MANIFEST;
@@ -437,10 +709,25 @@ static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_cont
   }
   else if ( stage == CONTROL_STAGE_ACK )
   {
+#if CFG_TUD_DFU_PIPELINE
+    if ( _dfu_ctx.flash_busy ) return true;
+#endif
+
     if ( _dfu_ctx.flashing_in_progress )
     {
       _dfu_ctx.state = DFU_MANIFEST;
-      tud_dfu_manifest_cb(_dfu_ctx.alt);
+#if CFG_TUD_DFU_DECOMPRESS
+      // flush remaining decompressed data, tud_dfu_manifest_cb() follows its tud_dfu_finish_flashing()
+      if ( _dfu_ctx.dz.enabled && _dfu_ctx.dz.out_len )
+      {
+        _dfu_ctx.dz.flash_pending = true;
+        tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.dz.out_block, _dfu_ctx.dz.out_buf, _dfu_ctx.dz.out_len);
+      }
+      else
+#endif
+      {
+        tud_dfu_manifest_cb(_dfu_ctx.alt);
+      }
     }
     else
     {
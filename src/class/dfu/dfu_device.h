@@ -41,6 +41,45 @@
   #error "CFG_TUD_DFU_XFER_BUFSIZE must be defined, it has to be set to the buffer size used in TUD_DFU_DESCRIPTOR"
 #endif
 
+// Pipelined download: a second transfer buffer accepts the next block while the previous one is
+// still being flashed. tud_dfu_download_cb() is invoked and host is answered dfuDNLOAD-IDLE right away,
+// dfuDNBUSY is reported only when a new block arrives before tud_dfu_finish_flashing() of the previous one.
+#ifndef CFG_TUD_DFU_PIPELINE
+  #define CFG_TUD_DFU_PIPELINE 0
+#endif
+
+// Streaming decompression of downloaded image. For alt settings where tud_dfu_compressed_cb() returns true,
+// DNLOAD payload is a heatshrink stream (e.g. produced by 'heatshrink -e -w 8 -l 4') which is decoded on the fly:
+// tud_dfu_download_cb() is then invoked with decompressed blocks of CFG_TUD_DFU_XFER_BUFSIZE bytes (the last one
+// may be shorter) numbered from 0, so flashing logic is the same as for an uncompressed image.
+// RAM cost is CFG_TUD_DFU_XFER_BUFSIZE for output plus 2^CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS for the window.
+#ifndef CFG_TUD_DFU_DECOMPRESS
+  #define CFG_TUD_DFU_DECOMPRESS 0
+#endif
+
+// Must match the -w and -l parameters of the encoder
+#ifndef CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS
+  #define CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS 8
+#endif
+
+#ifndef CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS
+  #define CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS 4
+#endif
+
+#if CFG_TUD_DFU_DECOMPRESS
+  #if CFG_TUD_DFU_PIPELINE
+    #error "CFG_TUD_DFU_DECOMPRESS is not supported with CFG_TUD_DFU_PIPELINE"
+  #endif
+
+  #if CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS < 4 || CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS > 15
+    #error "CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS must be in range 4-15"
+  #endif
+
+  #if CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS < 3 || CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS >= CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS
+    #error "CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_BITS must be at least 3 and less than CFG_TUD_DFU_DECOMPRESS_WINDOW_BITS"
+  #endif
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -59,11 +98,16 @@ void tud_dfu_finish_flashing(uint8_t status);
 // Invoked right before tud_dfu_download_cb() (state=DFU_DNBUSY) or tud_dfu_manifest_cb() (state=DFU_MANIFEST)
 // Application return timeout in milliseconds (bwPollTimeout) for the next download/manifest operation.
 // During this period, USB host won't try to communicate with us.
+// With CFG_TUD_DFU_PIPELINE, it is invoked with state=DFU_DNBUSY while the previous block is still being
+// flashed and should return the remaining time of that operation.
 uint32_t tud_dfu_get_timeout_cb(uint8_t alt, uint8_t state);
 
 // Invoked when received DFU_DNLOAD (wLength>0) following by DFU_GETSTATUS (state=DFU_DNBUSY) requests
 // This callback could be returned before flashing op is complete (async).
 // Once finished flashing, application must call tud_dfu_finish_flashing()
+// With CFG_TUD_DFU_DECOMPRESS, a single DNLOAD block can expand to several decompressed blocks: the next one
+// is passed from within tud_dfu_finish_flashing(). The last block is flushed in state DFU_MANIFEST right before
+// tud_dfu_manifest_cb().
 void tud_dfu_download_cb (uint8_t alt, uint16_t block_num, uint8_t const *data, uint16_t length);
 
 // Invoked when download process is complete, received DFU_DNLOAD (wLength=0) following by DFU_GETSTATUS (state=Manifest)
@@ -76,6 +120,10 @@ void tud_dfu_manifest_cb(uint8_t alt);
 // Return the number of written bytes
 TU_ATTR_WEAK uint16_t tud_dfu_upload_cb(uint8_t alt, uint16_t block_num, uint8_t* data, uint16_t length);
 
+// Invoked at the start of a download with CFG_TUD_DFU_DECOMPRESS
+// Return true if the image sent to this alt setting is heatshrink compressed
+TU_ATTR_WEAK bool tud_dfu_compressed_cb(uint8_t alt);
+
 // Invoked when a DFU_DETACH request is received
 TU_ATTR_WEAK void tud_dfu_detach_cb(void);
 
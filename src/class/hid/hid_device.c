@@ -41,6 +41,7 @@
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;        // optional Out endpoint
@@ -50,22 +51,57 @@ typedef struct
   uint8_t idle_rate;     // up to application to handle idle rate
   uint16_t report_desc_len;
 
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_HID_EP_BUFSIZE];
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_HID_EP_BUFSIZE];
+  TUD_EPBUF_DEF(epin_buf, CFG_TUD_HID_EP_BUFSIZE);
+  TUD_EPBUF_DEF(epout_buf, CFG_TUD_HID_EP_BUFSIZE);
 
   // TODO save hid descriptor since host can specifically request this after enumeration
   // Note: HID descriptor may be not available from application after enumeration
   tusb_hid_descriptor_hid_t const * hid_descriptor;
+
+#if CFG_TUD_HID_HIGH_RATE
+  uint32_t last_complete_us;
+  tud_hid_rate_stats_t stats;
+#endif
 } hidd_interface_t;
 
 CFG_TUD_MEM_SECTION tu_static hidd_interface_t _hidd_itf[CFG_TUD_HID];
 
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+// How a new report can be merged into this pending one
+enum {
+  HIDD_MERGE_NONE = 0,
+  HIDD_MERGE_LATEST, // tud_hid_report_merge_cb() or replace
+  HIDD_MERGE_MOUSE,  // accumulate hid_mouse_report_t movement
+};
+
+typedef struct
+{
+  uint8_t  report_id;
+  uint8_t  merge;
+  uint16_t len; // including report ID
+  uint8_t  data[CFG_TUD_HID_EP_BUFSIZE];
+} hidd_report_entry_t;
+
+typedef struct
+{
+  hidd_report_entry_t entry[CFG_TUD_HID_REPORT_QUEUE_DEPTH];
+  uint8_t rd;
+  uint8_t count;
+
+  // not cleared by reset
+  OSAL_MUTEX_DEF(mutex_def);
+  osal_mutex_t mutex;
+} hidd_report_queue_t;
+
+tu_static hidd_report_queue_t _hidd_queue[CFG_TUD_HID];
+#endif
+
 /*------------- Helpers -------------*/
-static inline uint8_t get_index_by_itfnum(uint8_t itf_num)
+static inline uint8_t get_index_by_itfnum(uint8_t rhport, uint8_t itf_num)
 {
 	for (uint8_t i=0; i < CFG_TUD_HID; i++ )
 	{
-		if ( itf_num == _hidd_itf[i].itf_num ) return i;
+		if ( itf_num == _hidd_itf[i].itf_num && rhport == _hidd_itf[i].rhport ) return i;
 	}
 
 	return 0xFF;
@@ -76,15 +112,132 @@ static inline uint8_t get_index_by_itfnum(uint8_t itf_num)
 //--------------------------------------------------------------------+
 bool tud_hid_n_ready(uint8_t instance)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _hidd_itf[instance].rhport;
   uint8_t const ep_in = _hidd_itf[instance].ep_in;
-  return tud_ready() && (ep_in != 0) && !usbd_edpt_busy(rhport, ep_in);
+  return tud_n_ready(rhport) && (ep_in != 0) && !usbd_edpt_busy(rhport, ep_in);
+}
+
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+// Accumulate movement of boot mouse report, only if buttons are the same and no axis overflows
+static bool hidd_mouse_merge(uint8_t* pending, uint8_t const* report)
+{
+  hid_mouse_report_t cur, add;
+  memcpy(&cur, pending, sizeof(cur));
+  memcpy(&add, report, sizeof(add));
+  TU_VERIFY(cur.buttons == add.buttons);
+
+  int16_t const x     = (int16_t) (cur.x     + add.x);
+  int16_t const y     = (int16_t) (cur.y     + add.y);
+  int16_t const wheel = (int16_t) (cur.wheel + add.wheel);
+  int16_t const pan   = (int16_t) (cur.pan   + add.pan);
+  TU_VERIFY(x     >= INT8_MIN && x     <= INT8_MAX && y   >= INT8_MIN && y   <= INT8_MAX &&
+            wheel >= INT8_MIN && wheel <= INT8_MAX && pan >= INT8_MIN && pan <= INT8_MAX);
+
+  cur.x     = (int8_t) x;
+  cur.y     = (int8_t) y;
+  cur.wheel = (int8_t) wheel;
+  cur.pan   = (int8_t) pan;
+  memcpy(pending, &cur, sizeof(cur));
+
+  return true;
 }
 
+// Merge report into the most recent pending report with the same ID, if it allows so
+static bool hidd_queue_merge(uint8_t instance, uint8_t report_id, uint8_t merge, void const* report, uint16_t len)
+{
+  hidd_report_queue_t* q = &_hidd_queue[instance];
+  uint8_t const id_len = report_id ? 1 : 0;
+
+  for (uint8_t i = q->count; i > 0; i--)
+  {
+    hidd_report_entry_t* entry = &q->entry[(q->rd + i - 1) % CFG_TUD_HID_REPORT_QUEUE_DEPTH];
+
+    if (entry->report_id != report_id) continue;
+
+    // only the latest report with this ID can be merged, otherwise order is lost
+    TU_VERIFY(entry->merge == merge && entry->len == len + id_len);
+
+    uint8_t* pending = entry->data + id_len;
+    if (merge == HIDD_MERGE_MOUSE) return hidd_mouse_merge(pending, (uint8_t const*) report);
+
+    if (tud_hid_report_merge_cb)
+    {
+      return tud_hid_report_merge_cb(instance, report_id, pending, (uint8_t const*) report, len);
+    }
+
+    memcpy(pending, report, len);
+    return true;
+  }
+
+  return false;
+}
+
+// Send oldest pending report if endpoint is free. Must be called with queue mutex locked
+static bool hidd_queue_xmit(uint8_t instance)
+{
+  hidd_interface_t* p_hid = &_hidd_itf[instance];
+  uint8_t const rhport = p_hid->rhport;
+  hidd_report_queue_t* q = &_hidd_queue[instance];
+
+  TU_VERIFY(q->count > 0);
+  TU_VERIFY(usbd_edpt_claim(rhport, p_hid->ep_in));
+
+  hidd_report_entry_t const* entry = &q->entry[q->rd];
+  uint16_t const len = entry->len;
+  memcpy(p_hid->epin_buf, entry->data, len);
+
+  q->rd = (uint8_t) ((q->rd + 1) % CFG_TUD_HID_REPORT_QUEUE_DEPTH);
+  q->count--;
+
+  return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
+}
+
+static bool hidd_report(uint8_t instance, uint8_t report_id, void const* report, uint16_t len, uint8_t merge)
+{
+  hidd_interface_t* p_hid = &_hidd_itf[instance];
+  hidd_report_queue_t* q = &_hidd_queue[instance];
+  uint16_t const id_len = report_id ? 1 : 0;
+
+  TU_VERIFY(p_hid->ep_in && (len + id_len) <= CFG_TUD_HID_EP_BUFSIZE);
+
+  (void) osal_mutex_lock(q->mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  bool ret = true;
+
+  if ( !(merge != HIDD_MERGE_NONE && hidd_queue_merge(instance, report_id, merge, report, len)) )
+  {
+    if (q->count < CFG_TUD_HID_REPORT_QUEUE_DEPTH)
+    {
+      hidd_report_entry_t* entry = &q->entry[(q->rd + q->count) % CFG_TUD_HID_REPORT_QUEUE_DEPTH];
+      if (report_id) entry->data[0] = report_id;
+      memcpy(entry->data + id_len, report, len);
+      entry->report_id = report_id;
+      entry->merge     = merge;
+      entry->len       = (uint16_t) (len + id_len);
+      q->count++;
+    }else
+    {
+      ret = false;
+    }
+  }
+
+  // kick off if endpoint is idle, otherwise sent from hidd_xfer_cb()
+  (void) hidd_queue_xmit(instance);
+
+  (void) osal_mutex_unlock(q->mutex);
+
+  return ret;
+}
+#endif
+
 bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const* report, uint16_t len)
 {
-  uint8_t const rhport = 0;
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  hid_report_policy_t const policy = tud_hid_report_policy_cb ? tud_hid_report_policy_cb(instance, report_id) : HID_REPORT_POLICY_QUEUE;
+  return hidd_report(instance, report_id, report, len, (policy == HID_REPORT_POLICY_LATEST) ? HIDD_MERGE_LATEST : HIDD_MERGE_NONE);
+#else
   hidd_interface_t * p_hid = &_hidd_itf[instance];
+  uint8_t const rhport = p_hid->rhport;
 
   // claim endpoint
   TU_VERIFY( usbd_edpt_claim(rhport, p_hid->ep_in) );
@@ -101,6 +254,31 @@ bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const* report, u
   }
 
   return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
+#endif
+}
+
+bool tud_hid_n_rate_stats(uint8_t instance, tud_hid_rate_stats_t* stats, bool clear)
+{
+#if CFG_TUD_HID_HIGH_RATE
+  TU_VERIFY(instance < CFG_TUD_HID && stats);
+  hidd_interface_t* p_hid = &_hidd_itf[instance];
+
+  // stats are updated in ISR
+  usbd_int_set(false);
+  *stats = p_hid->stats;
+  if (clear)
+  {
+    uint32_t const interval_us = p_hid->stats.interval_us;
+    tu_memclr(&p_hid->stats, sizeof(p_hid->stats));
+    p_hid->stats.interval_us = interval_us;
+  }
+  usbd_int_set(true);
+
+  return true;
+#else
+  (void) instance; (void) stats; (void) clear;
+  return false;
+#endif
 }
 
 uint8_t tud_hid_n_interface_protocol(uint8_t instance)
@@ -143,7 +321,11 @@ bool tud_hid_n_mouse_report(uint8_t instance, uint8_t report_id,
     .pan     = horizontal
   };
 
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  return hidd_report(instance, report_id, &report, sizeof(report), HIDD_MERGE_MOUSE);
+#else
   return tud_hid_n_report(instance, report_id, &report, sizeof(report));
+#endif
 }
 
 bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id,
@@ -160,7 +342,11 @@ bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id,
     .buttons = buttons,
   };
 
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  return hidd_report(instance, report_id, &report, sizeof(report), HIDD_MERGE_LATEST);
+#else
   return tud_hid_n_report(instance, report_id, &report, sizeof(report));
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -168,13 +354,29 @@ bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id,
 //--------------------------------------------------------------------+
 void hidd_init(void)
 {
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+  {
+    _hidd_queue[i].mutex = osal_mutex_create(&_hidd_queue[i].mutex_def);
+  }
+#endif
+
   hidd_reset(0);
 }
 
 void hidd_reset(uint8_t rhport)
 {
-  (void) rhport;
-  tu_memclr(_hidd_itf, sizeof(_hidd_itf));
+  for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+  {
+    // interface is opened on other port
+    if (_hidd_itf[i].ep_in && _hidd_itf[i].rhport != rhport) continue;
+
+    tu_memclr(&_hidd_itf[i], sizeof(hidd_interface_t));
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+    _hidd_queue[i].rd    = 0;
+    _hidd_queue[i].count = 0;
+#endif
+  }
 }
 
 uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t max_len)
@@ -199,6 +401,7 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint1
     }
   }
   TU_ASSERT(p_hid, 0);
+  p_hid->rhport = rhport;
 
   uint8_t const *p_desc = (uint8_t const *) desc_itf;
 
@@ -211,6 +414,21 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint1
   p_desc = tu_desc_next(p_desc);
   TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in), 0);
 
+#if CFG_TUD_HID_HIGH_RATE
+  for (uint8_t i = 0; i < desc_itf->bNumEndpoints; i++)
+  {
+    tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+    if (desc_ep->bEndpointAddress == p_hid->ep_in)
+    {
+      // HS: 2^(bInterval-1) microframes, FS: bInterval frames
+      uint8_t const binterval = desc_ep->bInterval;
+      p_hid->stats.interval_us = (tud_n_speed_get(rhport) == TUSB_SPEED_HIGH) ?
+          (125u << (tu_max8(tu_min8(binterval, 16), 1) - 1)) : 1000u * tu_max8(binterval, 1);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+#endif
+
   if ( desc_itf->bInterfaceSubClass == HID_SUBCLASS_BOOT ) p_hid->itf_protocol = desc_itf->bInterfaceProtocol;
 
   p_hid->protocol_mode = HID_PROTOCOL_REPORT; // Per Specs: default is report mode
@@ -239,7 +457,7 @@ bool hidd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
 {
   TU_VERIFY(request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE);
 
-  uint8_t const hid_itf = get_index_by_itfnum((uint8_t) request->wIndex);
+  uint8_t const hid_itf = get_index_by_itfnum(rhport, (uint8_t) request->wIndex);
   TU_VERIFY(hid_itf < CFG_TUD_HID);
 
   hidd_interface_t* p_hid = &_hidd_itf[hid_itf];
@@ -390,7 +608,7 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   for (instance = 0; instance < CFG_TUD_HID; instance++)
   {
     p_hid = &_hidd_itf[instance];
-    if ( (ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in) ) break;
+    if ( p_hid->rhport == rhport && ((ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in)) ) break;
   }
   TU_ASSERT(instance < CFG_TUD_HID);
 
@@ -401,6 +619,13 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     {
       tud_hid_report_complete_cb(instance, p_hid->epin_buf, (uint16_t) xferred_bytes);
     }
+
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+    // send next pending report right away, reports queued by the callback above are sent after older ones
+    (void) osal_mutex_lock(_hidd_queue[instance].mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    (void) hidd_queue_xmit(instance);
+    (void) osal_mutex_unlock(_hidd_queue[instance].mutex);
+#endif
   }
   // Received report
   else if (ep_addr == p_hid->ep_out)
@@ -412,4 +637,65 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 }
 
+#if CFG_TUD_HID_HIGH_RATE
+// Record timing of IN completion
+TU_ATTR_FAST_FUNC static void hidd_rate_stats_update(hidd_interface_t* p_hid)
+{
+  tud_hid_rate_stats_t* stats = &p_hid->stats;
+  stats->complete_count++;
+
+  if (!tud_hid_time_us_cb) return;
+
+  uint32_t const now = tud_hid_time_us_cb();
+  if (stats->complete_count > 1)
+  {
+    uint32_t const delta    = now - p_hid->last_complete_us;
+    uint32_t const interval = tu_max32(stats->interval_us, 1);
+
+    if (stats->complete_count == 2 || delta < stats->delta_min_us) stats->delta_min_us = delta;
+    if (delta > stats->delta_max_us) stats->delta_max_us = delta;
+    if (delta > interval + interval/2) stats->late_count++;
+
+    uint32_t const n = (delta + interval/2) / interval;
+    stats->delta_hist[tu_min32(tu_max32(n, 1), TU_ARRAY_SIZE(stats->delta_hist)) - 1]++;
+  }
+  p_hid->last_complete_us = now;
+}
+
+// Sample and re-arm next report right in ISR context, otherwise defer completion to hidd_xfer_cb()
+TU_ATTR_FAST_FUNC bool hidd_xfer_isr(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  (void) xferred_bytes;
+
+  uint8_t instance;
+  for (instance = 0; instance < CFG_TUD_HID; instance++)
+  {
+    if (ep_addr == _hidd_itf[instance].ep_in && rhport == _hidd_itf[instance].rhport) break;
+  }
+  TU_VERIFY(instance < CFG_TUD_HID);
+
+  hidd_interface_t* p_hid = &_hidd_itf[instance];
+  hidd_rate_stats_update(p_hid);
+
+  TU_VERIFY(result == XFER_RESULT_SUCCESS && tud_hid_report_isr_cb);
+
+#if CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  // queued reports go first, sent by hidd_xfer_cb()
+  TU_VERIFY(_hidd_queue[instance].count == 0);
+#endif
+
+  uint16_t const len = tud_hid_report_isr_cb(instance, p_hid->epin_buf, CFG_TUD_HID_EP_BUFSIZE);
+  if (len == 0 || len > CFG_TUD_HID_EP_BUFSIZE)
+  {
+    p_hid->stats.idle_count++;
+    return false;
+  }
+
+  TU_VERIFY(usbd_edpt_xfer(rhport, ep_addr, p_hid->epin_buf, len));
+  p_hid->stats.rearm_count++;
+
+  return true;
+}
+#endif
+
 #endif
@@ -47,6 +47,40 @@
   #define CFG_TUD_HID_EP_BUFSIZE     64
 #endif
 
+// Number of reports that can be pending per instance while the IN endpoint is busy. Queued reports are
+// sent in order as soon as the previous one completes. 0 means no queue: tud_hid_n_report() fails when busy
+#ifndef CFG_TUD_HID_REPORT_QUEUE_DEPTH
+  #define CFG_TUD_HID_REPORT_QUEUE_DEPTH  0
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_HID_REPORT_QUEUE_DEPTH < 256, "Report queue depth is not correct");
+
+// High-rate mode for HS peripherals polled every microframe: on IN completion, the next report is sampled
+// with tud_hid_report_isr_cb() and re-armed right away in the USB interrupt instead of waiting for the
+// application task. Completion timing is collected and available with tud_hid_n_rate_stats()
+#ifndef CFG_TUD_HID_HIGH_RATE
+  #define CFG_TUD_HID_HIGH_RATE  0
+#endif
+
+// How a report is handled when it can not be sent immediately (report queue only)
+typedef enum {
+  HID_REPORT_POLICY_QUEUE = 0, // report is queued and never lost, e.g keyboard key down/up sequence
+  HID_REPORT_POLICY_LATEST,    // report is merged into a pending report with the same ID, e.g mouse, gamepad state
+} hid_report_policy_t;
+
+// IN completion timing of high-rate mode
+typedef struct {
+  uint32_t interval_us;      // polling interval of IN endpoint
+  uint32_t complete_count;   // reports completed
+  uint32_t rearm_count;      // reports sampled and re-armed in ISR
+  uint32_t idle_count;       // completions without a new report from tud_hid_report_isr_cb()
+  // below require tud_hid_time_us_cb()
+  uint32_t late_count;       // completions more than 1.5 polling interval apart
+  uint32_t delta_min_us;     // shortest/longest time between two completions
+  uint32_t delta_max_us;
+  uint32_t delta_hist[4];    // time between two completions rounded to 1, 2, 3 and 4+ polling intervals
+} tud_hid_rate_stats_t;
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Instances)
 // CFG_TUD_HID > 1
@@ -55,13 +89,17 @@
 // Check if the interface is ready to use
 bool tud_hid_n_ready(uint8_t instance);
 
+// Get IN completion timing of high-rate mode (CFG_TUD_HID_HIGH_RATE), optionally clear it afterwards
+bool tud_hid_n_rate_stats(uint8_t instance, tud_hid_rate_stats_t* stats, bool clear);
+
 // Get interface supported protocol (bInterfaceProtocol) check out hid_interface_protocol_enum_t for possible values
 uint8_t tud_hid_n_interface_protocol(uint8_t instance);
 
 // Get current active protocol: HID_PROTOCOL_BOOT (0) or HID_PROTOCOL_REPORT (1)
 uint8_t tud_hid_n_get_protocol(uint8_t instance);
 
-// Send report to host
+// Send report to host. With CFG_TUD_HID_REPORT_QUEUE_DEPTH > 0 report is queued if endpoint is busy,
+// handled according to tud_hid_report_policy_cb(). Return false if report can not be sent or queued
 bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const* report, uint16_t len);
 
 // KEYBOARD: convenient helper to send keyboard report if application
@@ -70,10 +108,12 @@ bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modi
 
 // MOUSE: convenient helper to send mouse report if application
 // use template layout report as defined by hid_mouse_report_t
+// With report queue, movement is accumulated into pending report as long as buttons do not change
 bool tud_hid_n_mouse_report(uint8_t instance, uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
 
 // Gamepad: convenient helper to send gamepad report if application
 // use template layout report TUD_HID_REPORT_DESC_GAMEPAD
+// With report queue, pending report is replaced by the latest state
 bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id, int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons);
 
 //--------------------------------------------------------------------+
@@ -118,6 +158,23 @@ TU_ATTR_WEAK bool tud_hid_set_idle_cb(uint8_t instance, uint8_t idle_rate);
 // Note: For composite reports, report[0] is report ID
 TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len);
 
+// Invoked to get policy of report sent with tud_hid_n_report() when it must be queued (report queue only).
+// Default is HID_REPORT_POLICY_QUEUE for all reports
+TU_ATTR_WEAK hid_report_policy_t tud_hid_report_policy_cb(uint8_t instance, uint8_t report_id);
+
+// Invoked to merge a new report into a pending one with the same ID and HID_REPORT_POLICY_LATEST policy
+// (report queue only). pending and report exclude report ID. Application can sum relative fields and
+// replace absolute ones. Return false to queue report separately. Default replaces pending report
+TU_ATTR_WEAK bool tud_hid_report_merge_cb(uint8_t instance, uint8_t report_id, uint8_t* pending, uint8_t const* report, uint16_t len);
+
+// Invoked in ISR context when previous IN report completes (high-rate mode only). Application samples current
+// state into report (including report ID if used) and returns its length to send it right away, in which case
+// tud_hid_report_complete_cb() is not invoked. Return 0 without touching report to complete in task context
+TU_ATTR_WEAK uint16_t tud_hid_report_isr_cb(uint8_t instance, uint8_t* report, uint16_t bufsize);
+
+// Invoked in ISR context to get a free running timestamp in microseconds for completion timing (high-rate mode only)
+TU_ATTR_WEAK uint32_t tud_hid_time_us_cb(void);
+
 
 //--------------------------------------------------------------------+
 // Inline Functions
@@ -410,6 +467,7 @@ void     hidd_reset           (uint8_t rhport);
 uint16_t hidd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     hidd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     hidd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+bool     hidd_xfer_isr        (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
 
 #ifdef __cplusplus
  }
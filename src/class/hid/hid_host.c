@@ -60,8 +60,17 @@ typedef struct {
   uint16_t epin_size;
   uint16_t epout_size;
 
-  CFG_TUH_MEM_ALIGN uint8_t epin_buf[CFG_TUH_HID_EPIN_BUFSIZE];
-  CFG_TUH_MEM_ALIGN uint8_t epout_buf[CFG_TUH_HID_EPOUT_BUFSIZE];
+#if CFG_TUH_HID_AUTO_RECEIVE
+  bool    epin_auto;      // continuous polling is active
+  uint8_t epin_active;    // buffer of the pending IN transfer
+#endif
+
+  TUH_EPBUF_DEF(epin_buf, CFG_TUH_HID_EPIN_BUFSIZE);
+  TUH_EPBUF_DEF(epout_buf, CFG_TUH_HID_EPOUT_BUFSIZE);
+
+#if CFG_TUH_HID_AUTO_RECEIVE
+  TUH_EPBUF_DEF(epin_buf2, CFG_TUH_HID_EPIN_BUFSIZE);
+#endif
 } hidh_interface_t;
 
 CFG_TUH_MEM_SECTION
@@ -90,6 +99,15 @@ static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
   return TUSB_INDEX_INVALID_8;
 }
 
+// Get IN buffer of pending transfer
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* get_epin_buf(hidh_interface_t* p_hid) {
+#if CFG_TUH_HID_AUTO_RECEIVE
+  return p_hid->epin_active ? p_hid->epin_buf2 : p_hid->epin_buf;
+#else
+  return p_hid->epin_buf;
+#endif
+}
+
 static hidh_interface_t* find_new_itf(void) {
   for (uint8_t i = 0; i < CFG_TUH_HID; i++) {
     if (_hidh_itf[i].daddr == 0) return &_hidh_itf[i];
@@ -310,19 +328,31 @@ bool tuh_hid_receive_report(uint8_t daddr, uint8_t idx) {
   hidh_interface_t* p_hid = get_hid_itf(daddr, idx);
   TU_VERIFY(p_hid);
 
+#if CFG_TUH_HID_AUTO_RECEIVE
+  // already polling, report will be received anyway
+  if (p_hid->epin_auto) return true;
+#endif
+
   // claim endpoint
   TU_VERIFY(usbh_edpt_claim(daddr, p_hid->ep_in));
 
-  if (!usbh_edpt_xfer(daddr, p_hid->ep_in, p_hid->epin_buf, p_hid->epin_size)) {
+  if (!usbh_edpt_xfer(daddr, p_hid->ep_in, get_epin_buf(p_hid), p_hid->epin_size)) {
     usbh_edpt_release(daddr, p_hid->ep_in);
     return false;
   }
 
+#if CFG_TUH_HID_AUTO_RECEIVE
+  p_hid->epin_auto = true;
+#endif
+
   return true;
 }
 bool tuh_hid_receive_abort(uint8_t dev_addr, uint8_t idx) {
   hidh_interface_t* p_hid = get_hid_itf(dev_addr, idx);
   TU_VERIFY(p_hid);
+#if CFG_TUH_HID_AUTO_RECEIVE
+  p_hid->epin_auto = false;
+#endif
   return tuh_edpt_abort_xfer(dev_addr, p_hid->ep_in);
 }
 
@@ -386,9 +416,23 @@ bool hidh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t
   TU_VERIFY(p_hid);
 
   if (dir == TUSB_DIR_IN) {
+    uint8_t const* report = get_epin_buf(p_hid);
+
+#if CFG_TUH_HID_AUTO_RECEIVE
+    // re-arm on the other buffer before application processes this report
+    if (p_hid->epin_auto) {
+      p_hid->epin_active ^= 1;
+      p_hid->epin_auto = (result == XFER_RESULT_SUCCESS) && usbh_edpt_claim(daddr, ep_addr);
+      if (p_hid->epin_auto && !usbh_edpt_xfer(daddr, ep_addr, get_epin_buf(p_hid), p_hid->epin_size)) {
+        usbh_edpt_release(daddr, ep_addr);
+        p_hid->epin_auto = false;
+      }
+    }
+#endif
+
     TU_LOG_DRV("  Get Report callback (%u, %u)\r\n", daddr, idx);
-    TU_LOG3_MEM(p_hid->epin_buf, xferred_bytes, 2);
-    tuh_hid_report_received_cb(daddr, idx, p_hid->epin_buf, (uint16_t) xferred_bytes);
+    TU_LOG3_MEM(report, xferred_bytes, 2);
+    tuh_hid_report_received_cb(daddr, idx, report, (uint16_t) xferred_bytes);
   } else {
     if (tuh_hid_report_sent_cb) {
       tuh_hid_report_sent_cb(daddr, idx, p_hid->epout_buf, (uint16_t) xferred_bytes);
@@ -406,6 +450,9 @@ void hidh_close(uint8_t daddr) {
       if (tuh_hid_umount_cb) tuh_hid_umount_cb(daddr, i);
       p_hid->daddr = 0;
       p_hid->mounted = false;
+#if CFG_TUH_HID_AUTO_RECEIVE
+      p_hid->epin_auto = false;
+#endif
     }
   }
 }
@@ -425,23 +472,19 @@ bool hidh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_
   uint16_t const drv_len = (uint16_t) (sizeof(tusb_desc_interface_t) + sizeof(tusb_hid_descriptor_hid_t) +
                                        desc_itf->bNumEndpoints * sizeof(tusb_desc_endpoint_t));
   TU_ASSERT(max_len >= drv_len);
-  uint8_t const* p_desc = (uint8_t const*) desc_itf;
 
   //------------- HID descriptor -------------//
-  p_desc = tu_desc_next(p_desc);
-  tusb_hid_descriptor_hid_t const* desc_hid = (tusb_hid_descriptor_hid_t const*) p_desc;
-  TU_ASSERT(HID_DESC_TYPE_HID == desc_hid->bDescriptorType);
+  tusb_hid_descriptor_hid_t const* desc_hid = (tusb_hid_descriptor_hid_t const*) usbh_desc_itf_cs(desc_itf);
+  TU_ASSERT(desc_hid && HID_DESC_TYPE_HID == desc_hid->bDescriptorType);
 
   hidh_interface_t* p_hid = find_new_itf();
   TU_ASSERT(p_hid); // not enough interface, try to increase CFG_TUH_HID
   p_hid->daddr = daddr;
 
   //------------- Endpoint Descriptors -------------//
-  p_desc = tu_desc_next(p_desc);
-  tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
-
-  for (int i = 0; i < desc_itf->bNumEndpoints; i++) {
-    TU_ASSERT(TUSB_DESC_ENDPOINT == desc_ep->bDescriptorType);
+  for (uint8_t i = 0; i < desc_itf->bNumEndpoints; i++) {
+    tusb_desc_endpoint_t const* desc_ep = usbh_desc_itf_edpt(desc_itf, i);
+    TU_ASSERT(desc_ep);
     TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
 
     if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
@@ -451,9 +494,6 @@ bool hidh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_
       p_hid->ep_out = desc_ep->bEndpointAddress;
       p_hid->epout_size = tu_edpt_packet_size(desc_ep);
     }
-
-    p_desc = tu_desc_next(p_desc);
-    desc_ep = (tusb_desc_endpoint_t const*) p_desc;
   }
 
   p_hid->itf_num = desc_itf->bInterfaceNumber;
@@ -541,13 +581,13 @@ static void process_set_config(tuh_xfer_t* xfer) {
         config_driver_mount_complete(daddr, idx, NULL, 0);
       } else {
         tuh_descriptor_get_hid_report(daddr, itf_num, p_hid->report_desc_type, 0,
-                                      usbh_get_enum_buf(), p_hid->report_desc_len,
+                                      usbh_get_enum_buf(daddr), p_hid->report_desc_len,
                                       process_set_config, CONFIG_COMPLETE);
       }
       break;
 
     case CONFIG_COMPLETE: {
-      uint8_t const* desc_report = usbh_get_enum_buf();
+      uint8_t const* desc_report = usbh_get_enum_buf(daddr);
       uint16_t const desc_len = tu_le16toh(xfer->setup->wLength);
 
       config_driver_mount_complete(daddr, idx, desc_report, desc_len);
@@ -702,4 +742,257 @@ uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr,
   return report_num;
 }
 
+//--------------------------------------------------------------------+
+// Report Field Parser
+//--------------------------------------------------------------------+
+
+enum {
+  HID_PARSER_USAGE_MAX  = 16, // usages of a main item
+  HID_PARSER_REPORT_MAX = 16, // report IDs in a descriptor
+  HID_PARSER_STACK_MAX  = 2,  // Push/Pop depth
+};
+
+typedef struct {
+  uint16_t usage_page;
+  uint8_t  report_id;
+  uint8_t  report_size;
+  uint16_t report_count;
+  int32_t  logical_min;
+  int32_t  logical_max;
+  uint32_t logical_max_raw; // unsigned interpretation of logical maximum
+} hid_parser_global_t;
+
+// Read item data of 0, 1, 2 or 4 bytes
+static uint32_t hid_item_data(uint8_t const* data, uint8_t size, bool is_signed) {
+  switch (size) {
+    case 1: return is_signed ? (uint32_t) (int32_t) (int8_t) data[0] : data[0];
+    case 2: {
+      uint16_t const u16 = tu_unaligned_read16(data);
+      return is_signed ? (uint32_t) (int32_t) (int16_t) u16 : u16;
+    }
+    case 4: return tu_unaligned_read32(data);
+    default: return 0;
+  }
+}
+
+uint16_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint16_t max_fields,
+                                     uint8_t const* desc_report, uint16_t desc_len) {
+  hid_parser_global_t global;
+  hid_parser_global_t stack[HID_PARSER_STACK_MAX];
+  uint8_t stack_depth = 0;
+  tu_memclr(&global, sizeof(global));
+
+  // local items, cleared after each main item
+  uint32_t usages[HID_PARSER_USAGE_MAX];
+  uint8_t usage_count = 0;
+  uint32_t usage_min = 0, usage_max = 0;
+  bool has_range = false;
+
+  // bit offset of next input field per report ID
+  struct {
+    uint8_t  report_id;
+    uint16_t bits;
+  } offsets[HID_PARSER_REPORT_MAX];
+  uint8_t offset_count = 1;
+  offsets[0].report_id = 0;
+  offsets[0].bits = 0;
+  uint8_t offset_idx = 0;
+
+  uint16_t field_count = 0;
+
+  while (desc_len) {
+    uint8_t const header = *desc_report++;
+    desc_len--;
+
+    uint8_t const tag  = (uint8_t) (header >> 4);
+    uint8_t const type = (uint8_t) ((header >> 2) & 0x03);
+    uint8_t const size = (header & 0x03) == 3 ? 4 : (header & 0x03);
+
+    if (tag == 0x0F && type == 3) {
+      // long item: skip
+      TU_VERIFY(desc_len >= 2, field_count);
+      uint8_t const long_size = (uint8_t) (desc_report[0] + 2);
+      TU_VERIFY(desc_len >= long_size, field_count);
+      desc_report += long_size;
+      desc_len = (uint16_t) (desc_len - long_size);
+      continue;
+    }
+    TU_VERIFY(desc_len >= size, field_count);
+
+    uint32_t const udata = hid_item_data(desc_report, size, false);
+
+    switch (type) {
+      case RI_TYPE_MAIN:
+        if (tag == RI_MAIN_INPUT) {
+          uint8_t const flags = (uint8_t) udata;
+          uint16_t const base = offsets[offset_idx].bits;
+          bool const is_signed = global.logical_min < 0;
+
+          // many descriptors encode unsigned logical maximum in too few bytes
+          int32_t const logical_max = (!is_signed && global.logical_max < global.logical_min) ?
+                                      (int32_t) global.logical_max_raw : global.logical_max;
+
+          for (uint16_t i = 0; i < global.report_count && !(flags & HID_CONSTANT); i++) {
+            if (global.report_size == 0 || global.report_size > 32) break;
+            if (field_count >= max_fields) return field_count;
+
+            uint32_t usage;
+            if (!(flags & HID_VARIABLE)) {
+              usage = has_range ? usage_min : (usage_count ? usages[0] : 0);
+            } else if (i < usage_count) {
+              usage = usages[i];
+            } else if (has_range) {
+              usage = tu_min32(usage_min + i, usage_max);
+            } else {
+              usage = usage_count ? usages[usage_count - 1] : 0;
+            }
+
+            tuh_hid_field_t* field = &fields[field_count++];
+            // 32-bit usage contains its own usage page
+            field->usage_page  = (usage >> 16) ? (uint16_t) (usage >> 16) : global.usage_page;
+            field->usage       = (uint16_t) usage;
+            field->bit_offset  = (uint16_t) (base + i * global.report_size);
+            field->bit_size    = global.report_size;
+            field->report_id   = global.report_id;
+            field->flags       = flags;
+            field->is_signed   = is_signed ? 1 : 0;
+            field->logical_min = global.logical_min;
+            field->logical_max = logical_max;
+          }
+
+          offsets[offset_idx].bits = (uint16_t) (base + global.report_count * global.report_size);
+        }
+
+        // Output, Feature, Collection and End Collection only reset local items
+        usage_count = 0;
+        has_range = false;
+        usage_min = usage_max = 0;
+        break;
+
+      case RI_TYPE_GLOBAL:
+        switch (tag) {
+          case RI_GLOBAL_USAGE_PAGE: global.usage_page = (uint16_t) udata; break;
+
+          case RI_GLOBAL_LOGICAL_MIN:
+            global.logical_min = (int32_t) hid_item_data(desc_report, size, true);
+            break;
+
+          case RI_GLOBAL_LOGICAL_MAX:
+            global.logical_max = (int32_t) hid_item_data(desc_report, size, true);
+            global.logical_max_raw = udata;
+            break;
+
+          case RI_GLOBAL_REPORT_SIZE: global.report_size = (uint8_t) tu_min32(udata, 0xFF); break;
+          case RI_GLOBAL_REPORT_COUNT: global.report_count = (uint16_t) tu_min32(udata, 0xFFFF); break;
+
+          case RI_GLOBAL_REPORT_ID: {
+            global.report_id = (uint8_t) udata;
+
+            for (offset_idx = 0; offset_idx < offset_count; offset_idx++) {
+              if (offsets[offset_idx].report_id == global.report_id) break;
+            }
+
+            if (offset_idx == offset_count) {
+              TU_VERIFY(offset_count < HID_PARSER_REPORT_MAX, field_count);
+              offsets[offset_count].report_id = global.report_id;
+              offsets[offset_count].bits = 0;
+              offset_count++;
+            }
+            break;
+          }
+
+          case RI_GLOBAL_PUSH:
+            TU_VERIFY(stack_depth < HID_PARSER_STACK_MAX, field_count);
+            stack[stack_depth++] = global;
+            break;
+
+          case RI_GLOBAL_POP:
+            TU_VERIFY(stack_depth > 0, field_count);
+            global = stack[--stack_depth];
+            break;
+
+          default: break;
+        }
+        break;
+
+      case RI_TYPE_LOCAL:
+        switch (tag) {
+          case RI_LOCAL_USAGE:
+            if (usage_count < HID_PARSER_USAGE_MAX) usages[usage_count++] = udata;
+            break;
+
+          case RI_LOCAL_USAGE_MIN:
+            usage_min = udata;
+            has_range = true;
+            break;
+
+          case RI_LOCAL_USAGE_MAX:
+            usage_max = udata;
+            has_range = true;
+            break;
+
+          default: break;
+        }
+        break;
+
+      default: break;
+    }
+
+    desc_report += size;
+    desc_len = (uint16_t) (desc_len - size);
+  }
+
+  TU_LOG_DRV("HID parsed %u input fields\r\n", field_count);
+  return field_count;
+}
+
+int32_t tuh_hid_field_value(tuh_hid_field_t const* field, uint8_t const* data, uint16_t len) {
+  uint16_t const byte_offset = field->bit_offset >> 3;
+  uint8_t const shift = field->bit_offset & 0x07;
+  uint8_t const size = field->bit_size;
+  uint8_t const nbytes = (uint8_t) ((shift + size + 7) >> 3);
+
+  TU_VERIFY(byte_offset + nbytes <= len, 0);
+
+  // gather up to 5 bytes, little endian
+  uint64_t raw = 0;
+  for (uint8_t i = 0; i < nbytes; i++) {
+    raw |= ((uint64_t) data[byte_offset + i]) << (8 * i);
+  }
+
+  uint32_t value = (uint32_t) (raw >> shift);
+  if (size < 32) {
+    uint32_t const mask = (1UL << size) - 1;
+    value &= mask;
+    if (field->is_signed && (value & (1UL << (size - 1)))) value |= ~mask;
+  }
+
+  return (int32_t) value;
+}
+
+uint16_t tuh_hid_report_decode(tuh_hid_field_t const* fields, uint16_t field_count, int32_t* values,
+                               uint8_t const* report, uint16_t len) {
+  TU_VERIFY(field_count && len, 0);
+
+  // report ID is only present if descriptor declares them
+  uint8_t report_id = 0;
+  if (fields[0].report_id) {
+    report_id = report[0];
+    report++;
+    len--;
+  }
+
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < field_count; i++) {
+    tuh_hid_field_t const* field = &fields[i];
+    if (field->report_id != report_id) continue;
+    if (((field->bit_offset + field->bit_size + 7) >> 3) > len) continue;
+
+    values[i] = tuh_hid_field_value(field, report, len);
+    count++;
+  }
+
+  return count;
+}
+
 #endif
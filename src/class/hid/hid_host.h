@@ -46,6 +46,13 @@ extern "C" {
 #define CFG_TUH_HID_EPOUT_BUFSIZE 64
 #endif
 
+// Continuous polling: once started with tuh_hid_receive_report(), interrupt IN is re-armed automatically
+// on a second buffer before tuh_hid_report_received_cb() is invoked for the previous report, so that
+// endpoint never idles while application processes a report. Stop with tuh_hid_receive_abort()
+#ifndef CFG_TUH_HID_AUTO_RECEIVE
+#define CFG_TUH_HID_AUTO_RECEIVE 0
+#endif
+
 
 typedef struct {
   uint8_t report_id;
@@ -57,6 +64,19 @@ typedef struct {
 //  uint8_t out_len;     // length of OUT report
 } tuh_hid_report_info_t;
 
+// Field of an input report compiled from report descriptor by tuh_hid_parse_report_fields()
+typedef struct {
+  uint16_t usage_page;
+  uint16_t usage;       // usage of variable field, usage minimum of array field (value is index from it)
+  uint16_t bit_offset;  // from start of report data, report ID excluded
+  uint8_t  bit_size;    // 1 to 32 bits
+  uint8_t  report_id;
+  uint8_t  flags;       // data of Input item e.g HID_VARIABLE, HID_RELATIVE
+  uint8_t  is_signed;   // logical minimum is negative: value is sign extended
+  int32_t  logical_min;
+  int32_t  logical_max;
+} tuh_hid_field_t;
+
 //--------------------------------------------------------------------+
 // Interface API
 //--------------------------------------------------------------------+
@@ -88,6 +108,21 @@ bool tuh_hid_mounted(uint8_t dev_addr, uint8_t idx);
 TU_ATTR_UNUSED uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* reports_info_arr, uint8_t arr_count,
                                                        uint8_t const* desc_report, uint16_t desc_len);
 
+// Compile all input reports of report descriptor into a flat table of fields, one per element of each
+// Input item (constant padding is skipped) and return number of fields. Table should be built once e.g
+// in tuh_hid_mount_cb() so that received reports are decoded without parsing the descriptor again.
+uint16_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint16_t max_fields,
+                                     uint8_t const* desc_report, uint16_t desc_len);
+
+// Extract value of a field from report data (report ID excluded), 0 if data is too short
+int32_t tuh_hid_field_value(tuh_hid_field_t const* field, uint8_t const* data, uint16_t len);
+
+// Decode received input report (starting with report ID if descriptor uses them) with compiled fields:
+// values[i] is updated for every field[i] of this report, other entries are left untouched.
+// Return number of updated values
+uint16_t tuh_hid_report_decode(tuh_hid_field_t const* fields, uint16_t field_count, int32_t* values,
+                               uint8_t const* report, uint16_t len);
+
 //--------------------------------------------------------------------+
 // Control Endpoint API
 //--------------------------------------------------------------------+
@@ -120,9 +155,10 @@ bool tuh_hid_receive_ready(uint8_t dev_addr, uint8_t idx);
 // Try to receive next report on Interrupt Endpoint. Immediately return
 // - true If succeeded, tuh_hid_report_received_cb() callback will be invoked when report is available
 // - false if failed to queue the transfer e.g endpoint is busy
+// With CFG_TUH_HID_AUTO_RECEIVE, this starts continuous polling and returns true while it is active
 bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx);
 
-// Abort receiving report on Interrupt Endpoint
+// Abort receiving report on Interrupt Endpoint, also stop continuous polling
 bool tuh_hid_receive_abort(uint8_t dev_addr, uint8_t idx);
 
 // Check if HID interface is ready to send report
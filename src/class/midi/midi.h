@@ -52,9 +52,71 @@ typedef enum
 
 typedef enum
 {
-  MIDI_CS_ENDPOINT_GENERAL = 0x01
+  MIDI_CS_ENDPOINT_GENERAL     = 0x01,
+  MIDI_CS_ENDPOINT_GENERAL_2_0 = 0x02, // USB MIDI 2.0
 } midi_cs_endpoint_subtype_t;
 
+//------------- USB MIDI 2.0 -------------//
+
+// MIDI Streaming subclass release of alternate settings
+enum
+{
+  MIDI_BCD_MSC_1_0 = 0x0100,
+  MIDI_BCD_MSC_2_0 = 0x0200,
+};
+
+// Group Terminal Block descriptor type, requested by GET_DESCRIPTOR with wValue = (type << 8) | alternate
+enum
+{
+  MIDI_DESC_TYPE_GR_TRM_BLOCK = 0x26
+};
+
+typedef enum
+{
+  MIDI_GR_TRM_BLOCK_HEADER = 0x01,
+  MIDI_GR_TRM_BLOCK        = 0x02,
+} midi_gr_trm_block_subtype_t;
+
+typedef enum
+{
+  MIDI_GR_TRM_BLOCK_TYPE_BIDIRECTIONAL = 0x00,
+  MIDI_GR_TRM_BLOCK_TYPE_IN_ONLY       = 0x01,
+  MIDI_GR_TRM_BLOCK_TYPE_OUT_ONLY      = 0x02,
+} midi_gr_trm_block_type_t;
+
+// Default protocol of Group Terminal Block
+typedef enum
+{
+  MIDI_GR_TRM_PROTOCOL_UNKNOWN           = 0x00,
+  MIDI_GR_TRM_PROTOCOL_MIDI_1_0_64       = 0x01,
+  MIDI_GR_TRM_PROTOCOL_MIDI_1_0_64_JRTS  = 0x02,
+  MIDI_GR_TRM_PROTOCOL_MIDI_1_0_128      = 0x03,
+  MIDI_GR_TRM_PROTOCOL_MIDI_1_0_128_JRTS = 0x04,
+  MIDI_GR_TRM_PROTOCOL_MIDI_2_0          = 0x11,
+  MIDI_GR_TRM_PROTOCOL_MIDI_2_0_JRTS     = 0x12,
+} midi_gr_trm_protocol_t;
+
+// Universal MIDI Packet message type (4 most significant bits of first word)
+typedef enum
+{
+  MIDI_UMP_MT_UTILITY       = 0x0,
+  MIDI_UMP_MT_SYSTEM        = 0x1,
+  MIDI_UMP_MT_MIDI1_CHANNEL = 0x2,
+  MIDI_UMP_MT_DATA64        = 0x3,
+  MIDI_UMP_MT_MIDI2_CHANNEL = 0x4,
+  MIDI_UMP_MT_DATA128       = 0x5,
+  MIDI_UMP_MT_FLEX_DATA     = 0xD,
+  MIDI_UMP_MT_STREAM        = 0xF,
+} midi_ump_message_type_t;
+
+// Number of 32-bit words of an Universal MIDI Packet from its first word
+TU_ATTR_ALWAYS_INLINE static inline uint8_t midi_ump_word_count(uint32_t word0)
+{
+  // MT 0x0-0xF: 1 1 1 2 2 4 1 1 2 2 2 3 3 4 4 4
+  static const uint8_t count[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+  return count[word0 >> 28];
+}
+
 typedef enum
 {
   MIDI_JACK_EMBEDDED = 0x01,
@@ -81,6 +143,14 @@ typedef enum
   MIDI_CIN_1BYTE_DATA = 15
 } midi_code_index_number_t;
 
+// Number of MIDI data bytes carried by an event packet from its Code Index Number, 0 for reserved CINs
+TU_ATTR_ALWAYS_INLINE static inline uint8_t midi_cin_data_length(uint8_t code_index)
+{
+  // CIN 0x0-0xF: 0 0 2 3 3 1 2 3 3 3 3 3 2 2 3 1
+  static const uint8_t length[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+  return length[code_index & 0x0f];
+}
+
 // MIDI 1.0 status byte
 enum
 {
@@ -201,6 +271,41 @@ typedef struct TU_ATTR_PACKED
     uint8_t  iElement;          \
  }
 
+/// MIDI 2.0 Class-Specific Endpoint Descriptor with single Group Terminal Block
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength            ; ///< Size of this descriptor in bytes.
+  uint8_t bDescriptorType    ; ///< Descriptor Type, must be Class-Specific Endpoint
+  uint8_t bDescriptorSubType ; ///< MIDI_CS_ENDPOINT_GENERAL_2_0
+  uint8_t bNumGrpTrmBlock    ; ///< Number of Group Terminal Blocks associated with this endpoint
+  uint8_t baAssoGrpTrmBlkID  ; ///< ID of associated Group Terminal Block
+} midi2_desc_cs_endpoint_t;
+
+/// MIDI 2.0 Group Terminal Block Header Descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  bLength            ; ///< Size of this descriptor in bytes: 5
+  uint8_t  bDescriptorType    ; ///< MIDI_DESC_TYPE_GR_TRM_BLOCK
+  uint8_t  bDescriptorSubType ; ///< MIDI_GR_TRM_BLOCK_HEADER
+  uint16_t wTotalLength       ; ///< Header and all Group Terminal Block descriptors
+} midi2_desc_gr_trm_block_header_t;
+
+/// MIDI 2.0 Group Terminal Block Descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  bLength            ; ///< Size of this descriptor in bytes: 13
+  uint8_t  bDescriptorType    ; ///< MIDI_DESC_TYPE_GR_TRM_BLOCK
+  uint8_t  bDescriptorSubType ; ///< MIDI_GR_TRM_BLOCK
+  uint8_t  bGrpTrmBlkID       ; ///< ID of this block
+  uint8_t  bGrpTrmBlkType     ; ///< Bidirectional, In or Out only
+  uint8_t  nGroupTrm          ; ///< First group (0-based)
+  uint8_t  nNumGroupTrm       ; ///< Number of groups
+  uint8_t  iBlockItem         ; ///< string descriptor
+  uint8_t  bMIDIProtocol      ; ///< Default protocol
+  uint16_t wMaxInputBandwidth ; ///< In units of 4 KB/s, 0 is unknown
+  uint16_t wMaxOutputBandwidth; ///< In units of 4 KB/s, 0 is unknown
+} midi2_desc_gr_trm_block_t;
+
 /** @} */
 
 #ifdef __cplusplus
@@ -49,10 +49,15 @@ typedef struct
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;
 
+#if CFG_TUD_MIDI2
+  uint8_t alt_setting; // 0: MIDI 1.0 event packets, 1: MIDI 2.0 UMP
+#endif
+
   // For Stream read()/write() API
   // Messages are always 4 bytes long, queue them for reading and writing so the
   // callers can use the Stream interface with single-byte read/write calls.
@@ -72,8 +77,8 @@ typedef struct
   #endif
 
   // Endpoint Transfer buffer
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_MIDI_EP_BUFSIZE];
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_MIDI_EP_BUFSIZE];
+  TUD_EPBUF_DEF(epout_buf, CFG_TUD_MIDI_EP_BUFSIZE);
+  TUD_EPBUF_DEF(epin_buf, CFG_TUD_MIDI_EP_BUFSIZE);
 
 } midid_interface_t;
 
@@ -84,15 +89,33 @@ typedef struct
 //--------------------------------------------------------------------+
 CFG_TUD_MEM_SECTION midid_interface_t _midid_itf[CFG_TUD_MIDI];
 
+#if CFG_TUD_MIDI2
+static uint8_t const _midi2_default_gtb[] =
+{
+  TUD_MIDI2_GTB_HEADER(1),
+  TUD_MIDI2_GTB(1, MIDI_GR_TRM_BLOCK_TYPE_BIDIRECTIONAL, 0, 1, 0, MIDI_GR_TRM_PROTOCOL_MIDI_2_0)
+};
+#endif
+
 bool tud_midi_n_mounted (uint8_t itf)
 {
   midid_interface_t* midi = &_midid_itf[itf];
   return midi->ep_in && midi->ep_out;
 }
 
-static void _prep_out_transaction (midid_interface_t* p_midi)
+#if CFG_TUSB_FIFO_STATS
+bool tud_midi_n_fifo_stats(uint8_t itf, tu_fifo_stats_t* rx_stats, tu_fifo_stats_t* tx_stats)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  if ( rx_stats ) tu_fifo_stats_get(&midi->rx_ff, rx_stats);
+  if ( tx_stats ) tu_fifo_stats_get(&midi->tx_ff, tx_stats);
+  return true;
+}
+#endif
+
+static void midid_prep_out_transaction (midid_interface_t* p_midi)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = p_midi->rhport;
   uint16_t available = tu_fifo_remaining(&p_midi->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
@@ -138,6 +161,9 @@ uint32_t tud_midi_n_stream_read(uint8_t itf, uint8_t cable_num, void* buffer, ui
   uint8_t* buf8 = (uint8_t*) buffer;
 
   midid_interface_t* midi = &_midid_itf[itf];
+#if CFG_TUD_MIDI2
+  TU_VERIFY(midi->alt_setting == 0, 0);
+#endif
   midid_stream_t* stream = &midi->stream_read;
 
   uint32_t total_read = 0;
@@ -206,7 +232,7 @@ bool tud_midi_n_packet_read (uint8_t itf, uint8_t packet[4])
   TU_VERIFY(midi->ep_out);
 
   uint32_t const num_read = tu_fifo_read_n(&midi->rx_ff, packet, 4);
-  _prep_out_transaction(midi);
+  midid_prep_out_transaction(midi);
   return (num_read == 4);
 }
 
@@ -219,12 +245,13 @@ static uint32_t write_flush(midid_interface_t* midi)
   // No data to send
   if ( !tu_fifo_count(&midi->tx_ff) ) return 0;
 
-  uint8_t const rhport = 0;
+  uint8_t const rhport = midi->rhport;
 
   // skip if previous transfer not complete
   TU_VERIFY( usbd_edpt_claim(rhport, midi->ep_in), 0 );
 
-  uint16_t count = tu_fifo_read_n(&midi->tx_ff, midi->epin_buf, CFG_TUD_MIDI_EP_BUFSIZE);
+  // fifo only holds whole event packets
+  uint16_t count = tu_fifo_read_n(&midi->tx_ff, midi->epin_buf, CFG_TUD_MIDI_EP_BUFSIZE & ~3u);
 
   if (count)
   {
@@ -238,16 +265,70 @@ static uint32_t write_flush(midid_interface_t* midi)
   }
 }
 
+// Convert run of SysEx data bytes to 3-byte SysEx packets in batches without going through
+// per-byte state machine. Stop at first status byte or less than 3 bytes left. Return consumed bytes
+static uint32_t stream_write_sysex(midid_interface_t* midi, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize)
+{
+  enum { BATCH_PACKETS = 16 };
+  uint8_t batch[BATCH_PACKETS*4];
+  uint8_t const header = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_START);
+
+  uint32_t consumed = 0;
+  while (1)
+  {
+    uint16_t const room = (uint16_t) tu_min16(tu_fifo_remaining(&midi->tx_ff) / 4, BATCH_PACKETS);
+
+    uint16_t n_packets = 0;
+    while ( n_packets < room && (bufsize - consumed) >= 3 )
+    {
+      uint8_t const* data = buffer + consumed;
+      if ( (data[0] | data[1] | data[2]) & 0x80 ) break;
+
+      uint8_t* packet = batch + 4*n_packets;
+      packet[0] = header;
+      packet[1] = data[0];
+      packet[2] = data[1];
+      packet[3] = data[2];
+
+      n_packets++;
+      consumed += 3;
+    }
+
+    if ( n_packets == 0 ) break;
+
+    uint16_t const count = tu_fifo_write_n(&midi->tx_ff, batch, (uint16_t) (4*n_packets));
+
+    // FIFO overflown, since we already check fifo remaining. It is probably race condition
+    TU_ASSERT(count == 4*n_packets, consumed);
+
+    // keep endpoint busy while converting the rest
+    write_flush(midi);
+  }
+
+  return consumed;
+}
+
 uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize)
 {
   midid_interface_t* midi = &_midid_itf[itf];
   TU_VERIFY(midi->ep_in, 0);
+#if CFG_TUD_MIDI2
+  TU_VERIFY(midi->alt_setting == 0, 0);
+#endif
 
   midid_stream_t* stream = &midi->stream_write;
 
   uint32_t i = 0;
   while ( (i < bufsize) && (tu_fifo_remaining(&midi->tx_ff) >= 4) )
   {
+    // On-going SysEx at packet boundary: convert data bytes in bulk
+    if ( stream->index == 0 && (stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START )
+    {
+      uint32_t const consumed = stream_write_sysex(midi, cable_num, buffer + i, bufsize - i);
+      i += consumed;
+      if ( consumed ) continue;
+    }
+
     uint8_t const data = buffer[i];
     i++;
 
@@ -370,6 +451,105 @@ bool tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4])
   return true;
 }
 
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const packets[][4], uint32_t n_packets)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in, 0);
+
+  n_packets = tu_min32(n_packets, tu_fifo_remaining(&midi->tx_ff) / 4);
+  if ( n_packets == 0 ) return 0;
+
+  uint16_t const count = tu_fifo_write_n(&midi->tx_ff, packets, (uint16_t) (4*n_packets));
+  write_flush(midi);
+
+  return count / 4;
+}
+
+//--------------------------------------------------------------------+
+// MIDI 2.0 UMP API
+//--------------------------------------------------------------------+
+#if CFG_TUD_MIDI2
+
+bool tud_midi_n_ump_mode(uint8_t itf)
+{
+  return _midid_itf[itf].alt_setting == 1;
+}
+
+uint32_t tud_midi_n_ump_available(uint8_t itf)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->alt_setting == 1, 0);
+  return tu_fifo_count(&midi->rx_ff) / 4;
+}
+
+uint32_t tud_midi_n_ump_read(uint8_t itf, uint32_t* words, uint32_t n_words)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_out && midi->alt_setting == 1, 0);
+
+  uint32_t i = 0;
+  while ( i < n_words )
+  {
+    uint32_t word0;
+    if ( tu_fifo_peek_n(&midi->rx_ff, &word0, 4) != 4 ) break;
+
+    // only read whole packets
+    uint8_t const count = midi_ump_word_count(tu_le32toh(word0));
+    if ( (i + count > n_words) || (tu_fifo_count(&midi->rx_ff) < 4*count) ) break;
+
+    tu_fifo_read_n(&midi->rx_ff, words + i, (uint16_t) (4*count));
+    for ( uint8_t k = 0; k < count; k++ ) words[i+k] = tu_le32toh(words[i+k]);
+
+    i += count;
+  }
+
+  midid_prep_out_transaction(midi);
+
+  return i;
+}
+
+uint32_t tud_midi_n_ump_write(uint8_t itf, uint32_t const* words, uint32_t n_words)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in && midi->alt_setting == 1, 0);
+
+  uint32_t i = 0;
+  while ( i < n_words )
+  {
+    // only write whole packets
+    uint8_t const count = midi_ump_word_count(words[i]);
+    if ( (i + count > n_words) || (tu_fifo_remaining(&midi->tx_ff) < 4*count) ) break;
+
+    uint32_t ump[4];
+    for ( uint8_t k = 0; k < count; k++ ) ump[k] = tu_htole32(words[i+k]);
+    tu_fifo_write_n(&midi->tx_ff, ump, (uint16_t) (4*count));
+
+    i += count;
+  }
+
+  write_flush(midi);
+
+  return i;
+}
+
+// Switch between MIDI 1.0 and UMP, data queued in the other format is dropped
+static void midi2_set_alt(uint8_t itf, uint8_t alt)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+
+  midi->alt_setting = alt;
+  tu_memclr(&midi->stream_write, sizeof(midi->stream_write));
+  tu_memclr(&midi->stream_read, sizeof(midi->stream_read));
+  tu_fifo_clear(&midi->rx_ff);
+  tu_fifo_clear(&midi->tx_ff);
+
+  midid_prep_out_transaction(midi);
+
+  if (tud_midi2_set_itf_cb) tud_midi2_set_itf_cb(itf, alt);
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -394,11 +574,13 @@ void midid_init(void)
 
 void midid_reset(uint8_t rhport)
 {
-  (void) rhport;
-
   for(uint8_t i=0; i<CFG_TUD_MIDI; i++)
   {
     midid_interface_t* midi = &_midid_itf[i];
+
+    // interface is opened on other port
+    if ( (midi->ep_in || midi->ep_out) && midi->rhport != rhport ) continue;
+
     tu_memclr(midi, ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&midi->rx_ff);
     tu_fifo_clear(&midi->tx_ff);
@@ -442,6 +624,7 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
   }
   TU_ASSERT(p_midi);
 
+  p_midi->rhport  = rhport;
   p_midi->itf_num = desc_midi->bInterfaceNumber;
   (void) p_midi->itf_num;
 
@@ -476,8 +659,28 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
     p_desc   = tu_desc_next(p_desc);
   }
 
+#if CFG_TUD_MIDI2
+  // Alternate settings of MIDI Streaming interface (MIDI 2.0), endpoints are shared with alternate 0
+  while ( (drv_len < max_len) && (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) &&
+          (((tusb_desc_interface_t const *) p_desc)->bInterfaceNumber == desc_midi->bInterfaceNumber) )
+  {
+    do
+    {
+      if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+      {
+        uint8_t const ep_addr = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
+        TU_ASSERT(ep_addr == p_midi->ep_in || ep_addr == p_midi->ep_out, 0);
+      }
+
+      drv_len += tu_desc_len(p_desc);
+      p_desc   = tu_desc_next(p_desc);
+    } while ( (drv_len < max_len) && (TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) &&
+              (TUSB_DESC_INTERFACE_ASSOCIATION != tu_desc_type(p_desc)) );
+  }
+#endif
+
   // Prepare for incoming data
-  _prep_out_transaction(p_midi);
+  midid_prep_out_transaction(p_midi);
 
   return drv_len;
 }
@@ -487,18 +690,66 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
 // return false to stall control endpoint (e.g unsupported request)
 bool midid_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
+#if CFG_TUD_MIDI2
+  TU_VERIFY(request->bmRequestType_bit.type      == TUSB_REQ_TYPE_STANDARD &&
+            request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE);
+
+  // only MIDI Streaming interface has alternate settings
+  uint8_t itf;
+  for (itf = 0; itf < CFG_TUD_MIDI; itf++)
+  {
+    if ( _midid_itf[itf].rhport == rhport && _midid_itf[itf].itf_num == tu_u16_low(request->wIndex) && _midid_itf[itf].ep_in ) break;
+  }
+  TU_VERIFY(itf < CFG_TUD_MIDI);
+  midid_interface_t* p_midi = &_midid_itf[itf];
+
+  if ( stage != CONTROL_STAGE_SETUP ) return true;
+
+  switch ( request->bRequest )
+  {
+    case TUSB_REQ_GET_INTERFACE:
+      TU_VERIFY(tud_control_xfer(rhport, request, &p_midi->alt_setting, 1));
+    break;
+
+    case TUSB_REQ_SET_INTERFACE:
+    {
+      uint8_t const alt = tu_u16_low(request->wValue);
+      TU_VERIFY(alt <= 1);
+      midi2_set_alt(itf, alt);
+      TU_VERIFY(tud_control_status(rhport, request));
+    }
+    break;
+
+    case TUSB_REQ_GET_DESCRIPTOR:
+    {
+      TU_VERIFY(tu_u16_high(request->wValue) == MIDI_DESC_TYPE_GR_TRM_BLOCK);
+
+      uint8_t const* desc = tud_midi2_descriptor_group_terminal_block_cb ?
+                            tud_midi2_descriptor_group_terminal_block_cb(itf) : _midi2_default_gtb;
+      TU_VERIFY(desc);
+
+      uint16_t const len = tu_unaligned_read16(desc + offsetof(midi2_desc_gr_trm_block_header_t, wTotalLength));
+      TU_VERIFY(tud_control_xfer(rhport, request, (void*)(uintptr_t) desc, len));
+    }
+    break;
+
+    default: return false;
+  }
+
+  return true;
+#else
   (void) rhport;
   (void) stage;
   (void) request;
 
   // driver doesn't support any request yet
   return false;
+#endif
 }
 
 bool midid_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
   (void) result;
-  (void) rhport;
 
   uint8_t itf;
   midid_interface_t* p_midi;
@@ -507,7 +758,7 @@ bool midid_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32
   for (itf = 0; itf < CFG_TUD_MIDI; itf++)
   {
     p_midi = &_midid_itf[itf];
-    if ( ( ep_addr == p_midi->ep_out ) || ( ep_addr == p_midi->ep_in ) ) break;
+    if ( p_midi->rhport == rhport && (( ep_addr == p_midi->ep_out ) || ( ep_addr == p_midi->ep_in )) ) break;
   }
   TU_ASSERT(itf < CFG_TUD_MIDI);
 
@@ -522,7 +773,7 @@ bool midid_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32
     // prepare for next
     // TODO for now ep_out is not used by public API therefore there is no race condition,
     // and does not need to claim like ep_in
-    _prep_out_transaction(p_midi);
+    midid_prep_out_transaction(p_midi);
   }
   else if ( ep_addr == p_midi->ep_in )
   {
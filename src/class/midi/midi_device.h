@@ -43,6 +43,12 @@
   #define CFG_TUD_MIDI_EP_BUFSIZE     (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// USB MIDI 2.0: MIDI Streaming interface has alternate setting 1 exchanging Universal MIDI Packets (UMP),
+// use TUD_MIDI2_DESCRIPTOR(). MIDI 1.0 event packets are used until host selects alternate setting 1
+#ifndef CFG_TUD_MIDI2
+  #define CFG_TUD_MIDI2               0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -75,6 +81,28 @@ bool     tud_midi_n_packet_read  (uint8_t itf, uint8_t packet[4]);
 // Write event packet            (4 bytes)
 bool     tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4]);
 
+// Write multiple event packets  (4 bytes each), return number of packets written
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const packets[][4], uint32_t n_packets);
+
+#if CFG_TUD_MIDI2
+// Check if host selected MIDI 2.0 alternate setting, i.e UMP is exchanged instead of event packets
+bool     tud_midi_n_ump_mode      (uint8_t itf);
+
+// Get the number of 32-bit UMP words available for reading
+uint32_t tud_midi_n_ump_available (uint8_t itf);
+
+// Read whole UMPs into words (native endian), return number of words read
+uint32_t tud_midi_n_ump_read      (uint8_t itf, uint32_t* words, uint32_t n_words);
+
+// Write whole UMPs from words (native endian), return number of words written
+uint32_t tud_midi_n_ump_write     (uint8_t itf, uint32_t const* words, uint32_t n_words);
+#endif
+
+#if CFG_TUSB_FIFO_STATS
+// Get statistics of RX and TX FIFO, either can be NULL
+bool     tud_midi_n_fifo_stats   (uint8_t itf, tu_fifo_stats_t* rx_stats, tu_fifo_stats_t* tx_stats);
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Single Interface)
 //--------------------------------------------------------------------+
@@ -86,6 +114,7 @@ static inline uint32_t tud_midi_stream_write (uint8_t cable_num, uint8_t const*
 
 static inline bool     tud_midi_packet_read  (uint8_t packet[4]);
 static inline bool     tud_midi_packet_write (uint8_t const packet[4]);
+static inline uint32_t tud_midi_packet_write_n (uint8_t const packets[][4], uint32_t n_packets);
 
 //------------- Deprecated API name  -------------//
 // TODO remove after 0.10.0 release
@@ -120,6 +149,15 @@ static inline bool tud_midi_receive(uint8_t packet[4])
 //--------------------------------------------------------------------+
 TU_ATTR_WEAK void tud_midi_rx_cb(uint8_t itf);
 
+#if CFG_TUD_MIDI2
+// Invoked when host selects MIDI 1.0 (alternate 0) or MIDI 2.0 UMP (alternate 1) setting. FIFOs are cleared
+TU_ATTR_WEAK void tud_midi2_set_itf_cb(uint8_t itf, uint8_t alt);
+
+// Invoked when received GET_DESCRIPTOR for Group Terminal Blocks, return TUD_MIDI2_GTB_HEADER() followed by
+// TUD_MIDI2_GTB() blocks. Default is a single bidirectional block for group 1 with MIDI 2.0 protocol
+TU_ATTR_WEAK uint8_t const* tud_midi2_descriptor_group_terminal_block_cb(uint8_t itf);
+#endif
+
 //--------------------------------------------------------------------+
 // Inline Functions
 //--------------------------------------------------------------------+
@@ -154,6 +192,11 @@ static inline bool tud_midi_packet_write (uint8_t const packet[4])
   return tud_midi_n_packet_write(0, packet);
 }
 
+static inline uint32_t tud_midi_packet_write_n (uint8_t const packets[][4], uint32_t n_packets)
+{
+  return tud_midi_n_packet_write_n(0, packets, n_packets);
+}
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
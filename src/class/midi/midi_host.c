@@ -0,0 +1,675 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_MIDI)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "midi_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_MIDI_LOG_LEVEL
+  #define CFG_TUH_MIDI_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_MIDI_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC((CFG_TUH_MIDI_RX_EPSIZE % 4) == 0 && (CFG_TUH_MIDI_TX_EPSIZE % 4) == 0,
+                 "MIDI endpoint size must be multiple of event packet");
+TU_VERIFY_STATIC(CFG_TUH_MIDI_CABLE_MAX >= 1 && CFG_TUH_MIDI_CABLE_MAX <= 16, "MIDI has 1 to 16 cables");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t buffer[4];
+  uint8_t index;
+  uint8_t total;
+} midih_stream_t;
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_first;  // first bound interface: Audio Control if present, otherwise MIDI Streaming
+  uint8_t itf_last;   // last bound interface
+  uint8_t itf_num;    // MIDI Streaming interface
+
+  uint8_t rx_cables;
+  uint8_t tx_cables;
+  bool mounted;       // Enumeration is complete
+
+  // For Stream read()/write() API: event packet being split into/built from bytes
+  midih_stream_t stream_read;
+  uint8_t read_cable;
+  midih_stream_t stream_write[CFG_TUH_MIDI_CABLE_MAX];
+
+  struct {
+    tu_edpt_stream_t tx;
+    tu_edpt_stream_t rx;
+
+    // single TX buffer: packets queued while a transfer is in flight are batched into the next one
+    uint8_t tx_ff_buf[CFG_TUH_MIDI_TX_BUFSIZE];
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED
+    uint8_t tx_ep_buf[TUH_EPBUF_DCACHE_SIZE(CFG_TUH_MIDI_TX_EPSIZE)];
+
+    // double RX buffer: IN endpoint is re-armed before received packets are moved to fifo
+    uint8_t rx_ff_buf[CFG_TUH_MIDI_RX_BUFSIZE];
+    CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED
+    uint8_t rx_ep_buf[2][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_MIDI_RX_EPSIZE)];
+  } ep_stream;
+} midih_interface_t;
+
+#define ITF_MEM_RESET_SIZE   offsetof(midih_interface_t, ep_stream)
+
+CFG_TUH_MEM_SECTION
+static midih_interface_t midih_data[CFG_TUH_MIDI];
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+static inline midih_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_MIDI, NULL);
+  midih_interface_t* p_midi = &midih_data[idx];
+
+  return (p_midi->daddr != 0) ? p_midi : NULL;
+}
+
+static inline uint8_t get_idx_by_ep_addr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t* p_midi = &midih_data[i];
+    if ((p_midi->daddr == daddr) &&
+        (ep_addr == p_midi->ep_stream.rx.ep_addr || ep_addr == p_midi->ep_stream.tx.ep_addr)) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+static inline uint8_t get_idx_by_first_itf(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t const* p_midi = &midih_data[i];
+    if (p_midi->daddr == daddr && p_midi->itf_first == itf_num) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+static midih_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    if (midih_data[i].daddr == 0) return &midih_data[i];
+  }
+
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// APPLICATION API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_midi_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t const* p_midi = &midih_data[i];
+    if (p_midi->daddr == daddr && p_midi->itf_num == itf_num) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_midi_itf_get_info(uint8_t idx, tuh_itf_info_t* info) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && info);
+
+  info->daddr = p_midi->daddr;
+
+  // re-construct descriptor
+  tusb_desc_interface_t* desc = &info->desc;
+  desc->bLength            = sizeof(tusb_desc_interface_t);
+  desc->bDescriptorType    = TUSB_DESC_INTERFACE;
+
+  desc->bInterfaceNumber   = p_midi->itf_num;
+  desc->bAlternateSetting  = 0;
+  desc->bNumEndpoints      = (uint8_t) ((p_midi->ep_stream.rx.ep_addr ? 1u : 0u) + (p_midi->ep_stream.tx.ep_addr ? 1u : 0u));
+  desc->bInterfaceClass    = TUSB_CLASS_AUDIO;
+  desc->bInterfaceSubClass = AUDIO_SUBCLASS_MIDI_STREAMING;
+  desc->bInterfaceProtocol = AUDIO_FUNC_PROTOCOL_CODE_UNDEF;
+  desc->iInterface         = 0; // not used yet
+
+  return true;
+}
+
+bool tuh_midi_mounted(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi);
+  return p_midi->mounted;
+}
+
+uint8_t tuh_midi_get_rx_cable_count(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+  return p_midi->rx_cables;
+}
+
+uint8_t tuh_midi_get_tx_cable_count(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+  return p_midi->tx_cables;
+}
+
+//--------------------------------------------------------------------+
+// Read
+//--------------------------------------------------------------------+
+
+uint32_t tuh_midi_packet_available(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+
+  return tu_edpt_stream_read_available(&p_midi->ep_stream.rx) / 4;
+}
+
+static uint32_t packet_read_n(midih_interface_t* p_midi, void* packets, uint32_t n_packets) {
+  tu_edpt_stream_t* rx = &p_midi->ep_stream.rx;
+
+  // fifo only holds whole event packets
+  n_packets = tu_min32(n_packets, tu_fifo_count(&rx->ff) / 4);
+  if (n_packets == 0) return 0;
+
+  return tu_edpt_stream_read(rx, packets, 4*n_packets) / 4;
+}
+
+bool tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.rx.ep_addr);
+
+  return 1 == packet_read_n(p_midi, packet, 1);
+}
+
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t packets[][4], uint32_t n_packets) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.rx.ep_addr, 0);
+
+  return packet_read_n(p_midi, packets, n_packets);
+}
+
+uint32_t tuh_midi_stream_read(uint8_t idx, uint8_t* p_cable_num, void* buffer, uint32_t bufsize) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.rx.ep_addr && p_cable_num && bufsize, 0);
+
+  tu_fifo_t* ff = &p_midi->ep_stream.rx.ff;
+  midih_stream_t* stream = &p_midi->stream_read;
+  uint8_t* buf8 = (uint8_t*) buffer;
+
+  uint32_t total_read = 0;
+  while (bufsize) {
+    // Get new packet from fifo, then set packet expected bytes
+    if (stream->total == 0) {
+      // peek first so that packet of another cable is left for next call
+      if (4 != tu_fifo_peek_n(ff, stream->buffer, 4)) break;
+
+      uint8_t const cable_num = stream->buffer[0] >> 4;
+      if (total_read && cable_num != p_midi->read_cable) break;
+
+      tu_fifo_advance_read_pointer(ff, 4);
+
+      // reserved CIN (misc, cable event) has no data, skip this packet
+      uint8_t const length = midi_cin_data_length(stream->buffer[0]);
+      if (length == 0) continue;
+
+      stream->total = length;
+      stream->index = 0;
+      p_midi->read_cable = cable_num;
+    }
+
+    // Copy data up to bufsize, skip the header (1st byte) in the buffer
+    uint8_t const count = (uint8_t) tu_min32((uint32_t) (stream->total - stream->index), bufsize);
+    memcpy(buf8, stream->buffer + 1 + stream->index, count);
+
+    total_read += count;
+    stream->index += count;
+    buf8 += count;
+    bufsize -= count;
+
+    // complete current event packet, reset stream
+    if (stream->total == stream->index) {
+      stream->index = 0;
+      stream->total = 0;
+    }
+  }
+
+  *p_cable_num = p_midi->read_cable;
+
+  // fifo has room now, re-arm IN endpoint if it was paused
+  tu_edpt_stream_read_xfer(&p_midi->ep_stream.rx);
+
+  return total_read;
+}
+
+bool tuh_midi_read_clear(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.rx.ep_addr);
+
+  p_midi->stream_read.index = p_midi->stream_read.total = 0;
+  bool ret = tu_edpt_stream_clear(&p_midi->ep_stream.rx);
+  tu_edpt_stream_read_xfer(&p_midi->ep_stream.rx);
+  return ret;
+}
+
+//--------------------------------------------------------------------+
+// Write
+//--------------------------------------------------------------------+
+
+uint32_t tuh_midi_packet_write_available(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.tx.ep_addr, 0);
+
+  return tu_edpt_stream_write_available(&p_midi->ep_stream.tx) / 4;
+}
+
+static uint32_t packet_write_n(midih_interface_t* p_midi, void const* packets, uint32_t n_packets) {
+  tu_edpt_stream_t* tx = &p_midi->ep_stream.tx;
+
+  // only write whole event packets
+  n_packets = tu_min32(n_packets, tu_fifo_remaining(&tx->ff) / 4);
+  if (n_packets == 0) return 0;
+
+  uint16_t const count = tu_fifo_write_n(&tx->ff, packets, (uint16_t) (4*n_packets));
+
+  // MIDI is latency sensitive: send right away if endpoint is idle, otherwise packets are batched
+  // into the transfer posted when current one completes
+  tu_edpt_stream_write_xfer(tx);
+
+  return count / 4;
+}
+
+bool tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.tx.ep_addr);
+
+  return 1 == packet_write_n(p_midi, packet, 1);
+}
+
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const packets[][4], uint32_t n_packets) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.tx.ep_addr, 0);
+
+  return packet_write_n(p_midi, packets, n_packets);
+}
+
+// Convert run of SysEx data bytes to 3-byte SysEx packets in batches without going through
+// per-byte state machine. Stop at first status byte or less than 3 bytes left. Return consumed bytes
+static uint32_t stream_write_sysex(midih_interface_t* p_midi, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize) {
+  enum { BATCH_PACKETS = 16 };
+  uint8_t batch[BATCH_PACKETS*4];
+  uint8_t const header = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_START);
+  tu_edpt_stream_t* tx = &p_midi->ep_stream.tx;
+
+  uint32_t consumed = 0;
+  while (1) {
+    uint16_t const room = (uint16_t) tu_min16(tu_fifo_remaining(&tx->ff) / 4, BATCH_PACKETS);
+
+    uint16_t n_packets = 0;
+    while (n_packets < room && (bufsize - consumed) >= 3) {
+      uint8_t const* data = buffer + consumed;
+      if ((data[0] | data[1] | data[2]) & 0x80) break;
+
+      uint8_t* packet = batch + 4*n_packets;
+      packet[0] = header;
+      packet[1] = data[0];
+      packet[2] = data[1];
+      packet[3] = data[2];
+
+      n_packets++;
+      consumed += 3;
+    }
+
+    if (n_packets == 0) break;
+
+    uint16_t const count = tu_fifo_write_n(&tx->ff, batch, (uint16_t) (4*n_packets));
+
+    // FIFO overflown, since we already check fifo remaining. It is probably race condition
+    TU_ASSERT(count == 4*n_packets, consumed);
+
+    // keep endpoint busy while converting the rest
+    tu_edpt_stream_write_xfer(tx);
+  }
+
+  return consumed;
+}
+
+uint32_t tuh_midi_stream_write(uint8_t idx, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.tx.ep_addr && cable_num < CFG_TUH_MIDI_CABLE_MAX, 0);
+
+  tu_edpt_stream_t* tx = &p_midi->ep_stream.tx;
+  midih_stream_t* stream = &p_midi->stream_write[cable_num];
+
+  uint32_t i = 0;
+  while ((i < bufsize) && (tu_fifo_remaining(&tx->ff) >= 4)) {
+    // On-going SysEx at packet boundary: convert data bytes in bulk
+    if (stream->index == 0 && (stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START) {
+      uint32_t const consumed = stream_write_sysex(p_midi, cable_num, buffer + i, bufsize - i);
+      i += consumed;
+      if (consumed) continue;
+    }
+
+    uint8_t const data = buffer[i];
+    i++;
+
+    if (stream->index == 0) {
+      //------------- New event packet -------------//
+      uint8_t const msg = data >> 4;
+
+      stream->index = 2;
+      stream->buffer[1] = data;
+
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START) {
+        // Still in a SysEx transmit
+        if (data == MIDI_STATUS_SYSEX_END) {
+          stream->buffer[0] = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_END_1BYTE);
+          stream->total = 2;
+        } else {
+          stream->total = 4;
+        }
+      } else if ((msg >= 0x8 && msg <= 0xB) || msg == 0xE) {
+        // Channel Voice Messages
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->total = 4;
+      } else if (msg == 0xC || msg == 0xD) {
+        // Channel Voice Messages, two-byte variants (Program Change and Channel Pressure)
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->total = 3;
+      } else if (msg == 0xf) {
+        // System message
+        if (data == MIDI_STATUS_SYSEX_START) {
+          stream->buffer[0] = MIDI_CIN_SYSEX_START;
+          stream->total = 4;
+        } else if (data == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME || data == MIDI_STATUS_SYSCOM_SONG_SELECT) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_2BYTE;
+          stream->total = 3;
+        } else if (data == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_3BYTE;
+          stream->total = 4;
+        } else {
+          stream->buffer[0] = MIDI_CIN_SYSEX_END_1BYTE;
+          stream->total = 2;
+        }
+        stream->buffer[0] |= (uint8_t) (cable_num << 4);
+      } else {
+        // Pack individual bytes if we don't support packing them into words.
+        stream->buffer[0] = (uint8_t) (cable_num << 4 | 0xf);
+        stream->buffer[2] = 0;
+        stream->buffer[3] = 0;
+        stream->index = 2;
+        stream->total = 2;
+      }
+    } else {
+      //------------- On-going (buffering) packet -------------//
+      TU_ASSERT(stream->index < 4, i);
+      stream->buffer[stream->index] = data;
+      stream->index++;
+
+      // See if this byte ends a SysEx.
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START && data == MIDI_STATUS_SYSEX_END) {
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | (MIDI_CIN_SYSEX_START + (stream->index - 1)));
+        stream->total = stream->index;
+      }
+    }
+
+    // Send out packet
+    if (stream->index == stream->total) {
+      // zeroes unused bytes
+      for (uint8_t k = stream->total; k < 4; k++) stream->buffer[k] = 0;
+
+      uint16_t const count = tu_fifo_write_n(&tx->ff, stream->buffer, 4);
+
+      // complete current event packet, reset stream
+      stream->index = stream->total = 0;
+
+      // FIFO overflown, since we already check fifo remaining. It is probably race condition
+      TU_ASSERT(count == 4, i);
+    }
+  }
+
+  tu_edpt_stream_write_xfer(tx);
+
+  return i;
+}
+
+uint32_t tuh_midi_write_flush(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_stream.tx.ep_addr, 0);
+
+  return tu_edpt_stream_write_xfer(&p_midi->ep_stream.tx);
+}
+
+bool tuh_midi_write_clear(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi);
+
+  tu_memclr(p_midi->stream_write, sizeof(p_midi->stream_write));
+  return tu_edpt_stream_clear(&p_midi->ep_stream.tx);
+}
+
+//--------------------------------------------------------------------+
+// CLASS-USBH API
+//--------------------------------------------------------------------+
+
+void midih_init(void) {
+  tu_memclr(midih_data, sizeof(midih_data));
+
+  for (size_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t* p_midi = &midih_data[i];
+
+    tu_edpt_stream_init(&p_midi->ep_stream.tx, true, true, false,
+                        p_midi->ep_stream.tx_ff_buf, CFG_TUH_MIDI_TX_BUFSIZE,
+                        p_midi->ep_stream.tx_ep_buf, CFG_TUH_MIDI_TX_EPSIZE);
+
+    tu_edpt_stream_init(&p_midi->ep_stream.rx, true, false, false,
+                        p_midi->ep_stream.rx_ff_buf, CFG_TUH_MIDI_RX_BUFSIZE,
+                        p_midi->ep_stream.rx_ep_buf[0], CFG_TUH_MIDI_RX_EPSIZE);
+    tu_edpt_stream_set_ep_buf_num(&p_midi->ep_stream.rx, TU_ARRAY_SIZE(p_midi->ep_stream.rx_ep_buf),
+                                  sizeof(p_midi->ep_stream.rx_ep_buf[0]));
+  }
+}
+
+void midih_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_MIDI; idx++) {
+    midih_interface_t* p_midi = &midih_data[idx];
+    if (p_midi->daddr == daddr) {
+      TU_LOG_DRV("  MIDIh close addr = %u index = %u\r\n", daddr, idx);
+
+      // Invoke application callback
+      if (tuh_midi_umount_cb) tuh_midi_umount_cb(idx);
+
+      tu_memclr(p_midi, ITF_MEM_RESET_SIZE);
+      tu_edpt_stream_close(&p_midi->ep_stream.tx);
+      tu_edpt_stream_close(&p_midi->ep_stream.rx);
+    }
+  }
+}
+
+// Move received event packets to fifo in runs, dropping zero padding that some devices use to fill
+// fixed-size transfers. Trailing partial packet is discarded
+static void rx_packets_to_fifo(tu_fifo_t* ff, uint8_t const* buf, uint32_t len) {
+  uint32_t const end = len & ~3u;
+  uint32_t start = 0;
+
+  for (uint32_t i = 0; i < end; i += 4) {
+    if (0 == buf[i]) {
+      if (i > start) tu_fifo_write_n(ff, buf + start, (uint16_t) (i - start));
+      start = i + 4;
+    }
+  }
+
+  if (end > start) tu_fifo_write_n(ff, buf + start, (uint16_t) (end - start));
+}
+
+bool midih_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_ASSERT(p_midi);
+
+  if (ep_addr == p_midi->ep_stream.tx.ep_addr) {
+    // TODO handle stall response, retry failed transfer ...
+    TU_ASSERT(event == XFER_RESULT_SUCCESS);
+
+    // invoke tx complete callback to possibly refill tx fifo
+    if (tuh_midi_tx_complete_cb) tuh_midi_tx_complete_cb(idx);
+
+    if (0 == tu_edpt_stream_write_xfer(&p_midi->ep_stream.tx)) {
+      // If there is no data left, a ZLP should be sent if:
+      // - xferred_bytes is multiple of EP Packet size and not zero
+      tu_edpt_stream_write_zlp_if_needed(&p_midi->ep_stream.tx, xferred_bytes);
+    }
+  } else if (ep_addr == p_midi->ep_stream.rx.ep_addr) {
+    TU_ASSERT(event == XFER_RESULT_SUCCESS);
+
+    // next transfer is posted to the spare buffer right away, before packets are copied to fifo
+    uint8_t const* rx_buf = tu_edpt_stream_read_xfer_rotate(&p_midi->ep_stream.rx, xferred_bytes);
+    if (rx_buf) rx_packets_to_fifo(&p_midi->ep_stream.rx.ff, rx_buf, xferred_bytes);
+
+    // invoke receive callback
+    if (tuh_midi_rx_cb && tu_fifo_count(&p_midi->ep_stream.rx.ff)) tuh_midi_rx_cb(idx);
+
+    // prepare for next transfer if needed
+    tu_edpt_stream_read_xfer(&p_midi->ep_stream.rx);
+  } else {
+    TU_ASSERT(false);
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool midih_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_AUDIO == desc_itf->bInterfaceClass &&
+            (AUDIO_SUBCLASS_CONTROL == desc_itf->bInterfaceSubClass ||
+             AUDIO_SUBCLASS_MIDI_STREAMING == desc_itf->bInterfaceSubClass));
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  uint8_t itf_last = desc_itf->bInterfaceNumber;
+  tusb_desc_interface_t const* desc_ms = NULL;
+  tusb_desc_endpoint_t const* ep_in  = NULL;
+  tusb_desc_endpoint_t const* ep_out = NULL;
+  tusb_desc_endpoint_t const* ep_last = NULL;
+  bool in_ms = false;
+  uint8_t rx_cables = 0;
+  uint8_t tx_cables = 0;
+
+  // Audio Control interface (if any) is skipped. Only alternate 0 (MIDI 1.0 event packets) of the first MIDI
+  // Streaming interface is used, later ones e.g MIDI 2.0 alternate are ignored
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+
+    if (TUSB_DESC_INTERFACE == desc_type) {
+      tusb_desc_interface_t const* desc = (tusb_desc_interface_t const*) p_desc;
+      itf_last = tu_max8(itf_last, desc->bInterfaceNumber);
+
+      in_ms = (desc_ms == NULL && AUDIO_SUBCLASS_MIDI_STREAMING == desc->bInterfaceSubClass &&
+               desc->bAlternateSetting == 0);
+      if (in_ms) desc_ms = desc;
+      ep_last = NULL;
+    } else if (TUSB_DESC_ENDPOINT == desc_type && in_ms) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      ep_last = NULL;
+      if (TUSB_XFER_BULK == desc_ep->bmAttributes.xfer || TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer) {
+        if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+          if (!ep_in) ep_last = ep_in = desc_ep;
+        } else {
+          if (!ep_out) ep_last = ep_out = desc_ep;
+        }
+      }
+    } else if (TUSB_DESC_CS_ENDPOINT == desc_type && ep_last && tu_desc_len(p_desc) >= 4 &&
+               MIDI_CS_ENDPOINT_GENERAL == p_desc[2]) {
+      // bNumEmbMIDIJack: number of virtual cables of this endpoint
+      if (ep_last == ep_in) {
+        rx_cables = p_desc[3];
+      } else {
+        tx_cables = p_desc[3];
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_VERIFY(desc_ms && (ep_in || ep_out));
+
+  midih_interface_t* p_midi = find_new_itf();
+  TU_ASSERT(p_midi); // not enough interface, try to increase CFG_TUH_MIDI
+
+  TU_LOG_DRV("[%u] MIDI opening Interface %u: %u IN, %u OUT cables\r\n", daddr, desc_ms->bInterfaceNumber,
+             rx_cables, tx_cables);
+
+  p_midi->daddr     = daddr;
+  p_midi->itf_first = desc_itf->bInterfaceNumber;
+  p_midi->itf_last  = itf_last;
+  p_midi->itf_num   = desc_ms->bInterfaceNumber;
+  p_midi->rx_cables = ep_in ? tu_max8(rx_cables, 1) : 0;
+  p_midi->tx_cables = ep_out ? tu_max8(tx_cables, 1) : 0;
+
+  if (ep_in) {
+    TU_ASSERT(tuh_edpt_open(daddr, ep_in));
+    tu_edpt_stream_open(&p_midi->ep_stream.rx, daddr, ep_in);
+  }
+
+  if (ep_out) {
+    TU_ASSERT(tuh_edpt_open(daddr, ep_out));
+    tu_edpt_stream_open(&p_midi->ep_stream.tx, daddr, ep_out);
+  }
+
+  return true;
+}
+
+bool midih_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = get_idx_by_first_itf(daddr, itf_num);
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_ASSERT(p_midi);
+
+  TU_LOG_DRV("[%u] MIDI mounted\r\n", daddr);
+  p_midi->mounted = true;
+  if (tuh_midi_mount_cb) tuh_midi_mount_cb(idx);
+
+  // IN endpoint is kept armed from now on, as long as RX FIFO has room
+  if (p_midi->ep_stream.rx.ep_addr) tu_edpt_stream_read_xfer(&p_midi->ep_stream.rx);
+
+  // notify usbh that driver enumeration is complete, itf_last to account for MIDI Streaming interface as well
+  usbh_driver_set_config_complete(daddr, p_midi->itf_last);
+
+  return true;
+}
+
+#endif
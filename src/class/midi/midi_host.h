@@ -0,0 +1,163 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_MIDI_HOST_H_
+#define _TUSB_MIDI_HOST_H_
+
+#include "class/audio/audio.h"
+#include "midi.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// CFG_TUH_MIDI is the number of MIDI Streaming interfaces (across all devices) that can be mounted
+
+// RX Endpoint size: max bytes of each IN transfer, multiple of 4-byte event packet and packet size.
+// IN endpoint is double buffered: next transfer is posted as soon as one completes, so that the
+// device can send dense data (e.g MPE, clock) back-to-back without NAK while received packets are processed.
+#ifndef CFG_TUH_MIDI_RX_EPSIZE
+#define CFG_TUH_MIDI_RX_EPSIZE   USBH_EPSIZE_BULK_MAX
+#endif
+
+// RX FIFO size, should have room for 2 transfers
+#ifndef CFG_TUH_MIDI_RX_BUFSIZE
+#define CFG_TUH_MIDI_RX_BUFSIZE  (2*CFG_TUH_MIDI_RX_EPSIZE)
+#endif
+
+// TX Endpoint size: max bytes of each OUT transfer, multiple of 4-byte event packet.
+// All event packets queued while a transfer is in flight are sent by the next one.
+#ifndef CFG_TUH_MIDI_TX_EPSIZE
+#define CFG_TUH_MIDI_TX_EPSIZE   USBH_EPSIZE_BULK_MAX
+#endif
+
+// TX FIFO size
+#ifndef CFG_TUH_MIDI_TX_BUFSIZE
+#define CFG_TUH_MIDI_TX_BUFSIZE  (2*CFG_TUH_MIDI_TX_EPSIZE)
+#endif
+
+// Max number of virtual cables per direction that have their own stream write state (running SysEx),
+// packets of higher cable number are still received and can be sent with the packet API
+#ifndef CFG_TUH_MIDI_CABLE_MAX
+#define CFG_TUH_MIDI_CABLE_MAX   4
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + MIDI Streaming interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_midi_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Get Interface information of MIDI Streaming interface
+// return true if index is correct and interface is currently mounted
+bool tuh_midi_itf_get_info(uint8_t idx, tuh_itf_info_t* info);
+
+// Check if a interface is mounted
+bool tuh_midi_mounted(uint8_t idx);
+
+// Get number of virtual cables (embedded jacks) of IN (device to host) and OUT endpoints
+uint8_t tuh_midi_get_rx_cable_count(uint8_t idx);
+uint8_t tuh_midi_get_tx_cable_count(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Read API
+//--------------------------------------------------------------------+
+
+// Get the number of event packets available for reading
+uint32_t tuh_midi_packet_available(uint8_t idx);
+
+// Read event packet (4 bytes)
+bool     tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]);
+
+// Read multiple event packets (4 bytes each), return number of packets read
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t packets[][4], uint32_t n_packets);
+
+// Read MIDI byte stream of a single cable: return bytes of consecutive event packets with the same cable number,
+// reading stops before a packet of another cable so that each call demultiplexes one cable. Cable number of
+// returned bytes is stored in p_cable_num.
+uint32_t tuh_midi_stream_read(uint8_t idx, uint8_t* p_cable_num, void* buffer, uint32_t bufsize);
+
+// Clear the received FIFO
+bool     tuh_midi_read_clear(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Write API
+//--------------------------------------------------------------------+
+
+// Get the number of event packets that can be written
+uint32_t tuh_midi_packet_write_available(uint8_t idx);
+
+// Write event packet (4 bytes)
+bool     tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]);
+
+// Write multiple event packets (4 bytes each), return number of packets written
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const packets[][4], uint32_t n_packets);
+
+// Write MIDI byte stream to a cable, converting it to event packets. Return number of consumed bytes
+uint32_t tuh_midi_stream_write(uint8_t idx, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize);
+
+// Send queued event packets if endpoint is idle, return number of bytes submitted
+uint32_t tuh_midi_write_flush(uint8_t idx);
+
+// Clear the transmit FIFO
+bool     tuh_midi_write_clear(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when a device with MIDI Streaming interface is mounted
+TU_ATTR_WEAK extern void tuh_midi_mount_cb(uint8_t idx);
+
+// Invoked when a device with MIDI Streaming interface is unmounted
+TU_ATTR_WEAK extern void tuh_midi_umount_cb(uint8_t idx);
+
+// Invoked when received new event packets
+TU_ATTR_WEAK extern void tuh_midi_rx_cb(uint8_t idx);
+
+// Invoked when an OUT transfer is complete and therefore space becomes available in TX FIFO
+TU_ATTR_WEAK extern void tuh_midi_tx_complete_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void midih_init       (void);
+bool midih_open       (uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool midih_set_config (uint8_t dev_addr, uint8_t itf_num);
+bool midih_xfer_cb    (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void midih_close      (uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_MIDI_HOST_H_ */
@@ -58,7 +58,8 @@ typedef enum
 {
   MSC_PROTOCOL_CBI              = 0 ,  ///< Control/Bulk/Interrupt protocol (with command completion interrupt)
   MSC_PROTOCOL_CBI_NO_INTERRUPT = 1 ,  ///< Control/Bulk/Interrupt protocol (without command completion interrupt)
-  MSC_PROTOCOL_BOT              = 0x50 ///< Bulk-Only Transport
+  MSC_PROTOCOL_BOT              = 0x50 ,  ///< Bulk-Only Transport
+  MSC_PROTOCOL_UAS              = 0x62    ///< USB Attached SCSI
 }msc_protocol_type_t;
 
 /// MassStorage Class-Specific Control Request
@@ -115,14 +116,47 @@ typedef enum
   SCSI_CMD_MODE_SELECT_6                = 0x15, ///<  provides a means for the application client to specify medium, logical unit, or peripheral device parameters to the device server. Device servers that implement the MODE SELECT(6) command shall also implement the MODE SENSE(6) command. Application clients should issue MODE SENSE(6) prior to each MODE SELECT(6) to determine supported mode pages, page lengths, and other parameters.
   SCSI_CMD_MODE_SENSE_6                 = 0x1A, ///< provides a means for a device server to report parameters to an application client. It is a complementary command to the MODE SELECT(6) command. Device servers that implement the MODE SENSE(6) command shall also implement the MODE SELECT(6) command.
   SCSI_CMD_START_STOP_UNIT              = 0x1B,
+  SCSI_CMD_SEND_DIAGNOSTIC              = 0x1D, ///< The SEND DIAGNOSTIC command requests a self-test, optionally with a parameter list in data-out.
   SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL = 0x1E,
   SCSI_CMD_READ_CAPACITY_10             = 0x25, ///< The SCSI Read Capacity command is used to obtain data capacity information from a target device.
   SCSI_CMD_REQUEST_SENSE                = 0x03, ///< The SCSI Request Sense command is part of the SCSI computer protocol standard. This command is used to obtain sense data -- status/error information -- from a target device.
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests that the device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_SYNCHRONIZE_CACHE_10         = 0x35, ///< The SYNCHRONIZE CACHE (10) command requests that the device server write cached data of the specified range (all if zero) to the medium.
+  SCSI_CMD_WRITE_BUFFER                 = 0x3B, ///< The WRITE BUFFER command transfers data-out to a buffer of the device server e.g for firmware download.
+  SCSI_CMD_WRITE_SAME_10                = 0x41, ///< The WRITE SAME (10) command writes a single block of data-out to a range of blocks, or unmaps the range if UNMAP bit is set.
+  SCSI_CMD_UNMAP                        = 0x42, ///< The UNMAP command requests that the device server deallocate (trim) one or more LBA ranges listed in the parameter data.
+  SCSI_CMD_MODE_SELECT_10               = 0x55, ///< The MODE SELECT (10) command is the 10-byte CDB variant of MODE SELECT (6).
+  SCSI_CMD_READ_16                      = 0x88, ///< The READ (16) command is the 64-bit LBA, 32-bit transfer length variant of READ (10).
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< The WRITE (16) command is the 64-bit LBA, 32-bit transfer length variant of WRITE (10).
+  SCSI_CMD_SYNCHRONIZE_CACHE_16         = 0x91, ///< The SYNCHRONIZE CACHE (16) command is the 64-bit LBA variant of SYNCHRONIZE CACHE (10).
+  SCSI_CMD_WRITE_SAME_16                = 0x93, ///< The WRITE SAME (16) command is the 64-bit LBA, 32-bit length variant of WRITE SAME (10).
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< SERVICE ACTION IN (16), the actual command is selected by the service action field e.g READ CAPACITY (16)
+  SCSI_CMD_REPORT_LUNS                  = 0xA0, ///< The REPORT LUNS command requests the logical unit inventory, mostly used by UAS host
 }scsi_cmd_type_t;
 
+/// SCSI Service Action for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+enum {
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10,
+};
+
+/// SCSI Vital Product Data (VPD) page code, requested by Inquiry with EVPD bit set
+enum {
+  SCSI_VPD_PAGE_SUPPORTED_PAGES = 0x00,
+  SCSI_VPD_PAGE_BLOCK_LIMITS    = 0xB0,
+  SCSI_VPD_PAGE_LOGICAL_BLOCK_PROVISIONING = 0xB2,
+};
+
+/// SCSI Status
+typedef enum
+{
+  SCSI_STATUS_GOOD            = 0x00,
+  SCSI_STATUS_CHECK_CONDITION = 0x02,
+  SCSI_STATUS_BUSY            = 0x08,
+  SCSI_STATUS_TASK_SET_FULL   = 0x28,
+}scsi_status_type_t;
+
 /// SCSI Sense Key
 typedef enum
 {
@@ -169,6 +203,9 @@ typedef struct TU_ATTR_PACKED
 
 TU_VERIFY_STATIC(sizeof(scsi_inquiry_t) == 6, "size is not correct");
 
+/// Enable Vital Product Data bit in the reserved1 field of \ref scsi_inquiry_t
+#define SCSI_INQUIRY_EVPD  0x01u
+
 /// SCSI Inquiry Response Data
 typedef struct TU_ATTR_PACKED
 {
@@ -375,6 +412,232 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  flags       ;
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Command (Service Action In 16)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< lower 5 bits, \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
+  uint64_t lba            ;
+  uint32_t alloc_length   ; ///< maximum number of bytes for the response
+  uint8_t  partial_medium_indicator ;
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t last_lba          ; ///< The last Logical Block Address of the device
+  uint32_t block_size        ; ///< Block size in bytes
+  uint8_t  protection        ;
+  uint8_t  lb_per_pb_exp     ; ///< logical blocks per physical block exponent
+  uint16_t lowest_aligned_lba;
+  uint8_t  reserved[16]      ;
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Block Limits VPD page (0xB0) Response Data. All lengths are in logical blocks, 0 means not reported
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  peripheral_device_type  ;
+  uint8_t  page_code               ; ///< \ref SCSI_VPD_PAGE_BLOCK_LIMITS
+  uint16_t page_length             ; ///< 0x3C
+  uint8_t  wsnz                    ;
+  uint8_t  max_compare_write_len   ;
+  uint16_t opt_xfer_len_granularity;
+  uint32_t max_xfer_len            ; ///< Maximum number of blocks in a single READ/WRITE command
+  uint32_t opt_xfer_len            ; ///< Optimal number of blocks in a single READ/WRITE command
+  uint32_t max_prefetch_len        ;
+  uint32_t max_unmap_lba_count     ;
+  uint32_t max_unmap_desc_count    ;
+  uint32_t opt_unmap_granularity   ;
+  uint32_t unmap_granularity_align ;
+  uint64_t max_write_same_len      ;
+  uint8_t  reserved[20]            ;
+} scsi_vpd_block_limits_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_vpd_block_limits_t) == 64, "size is not correct");
+
+/// SCSI Logical Block Provisioning VPD page (0xB2) Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  peripheral_device_type;
+  uint8_t  page_code             ; ///< \ref SCSI_VPD_PAGE_LOGICAL_BLOCK_PROVISIONING
+  uint16_t page_length           ; ///< 0x04
+  uint8_t  threshold_exponent    ;
+  uint8_t  flags                 ; ///< bit7 LBPU: UNMAP, bit6 LBPWS: WRITE SAME(16) unmap, bit5 LBPWS10: WRITE SAME(10) unmap
+  uint8_t  provisioning_type     ; ///< lower 3 bits, 0 = full, 2 = thin provisioned
+  uint8_t  reserved              ;
+} scsi_vpd_lb_provisioning_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_vpd_lb_provisioning_t) == 8, "size is not correct");
+
+/// SCSI UNMAP parameter list header, followed by block descriptors
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t data_length     ; ///< number of bytes following this field
+  uint16_t desc_data_length; ///< number of bytes of all block descriptors
+  uint8_t  reserved[4]     ;
+} scsi_unmap_param_header_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_param_header_t) == 8, "size is not correct");
+
+/// SCSI UNMAP block descriptor, all fields are in Big Endian
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t lba        ;
+  uint32_t block_count;
+  uint8_t  reserved[4];
+} scsi_unmap_block_desc_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_block_desc_t) == 16, "size is not correct");
+
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS)
+// NOTE: All multi-byte fields in Information Unit (IU) are in Big Endian
+//--------------------------------------------------------------------+
+
+/// UAS Pipe Usage descriptor type, follows each endpoint descriptor of UAS interface
+#define UAS_DESC_TYPE_PIPE_USAGE  0x24
+
+/// UAS Pipe ID in Pipe Usage descriptor
+typedef enum
+{
+  UAS_PIPE_ID_COMMAND  = 1,
+  UAS_PIPE_ID_STATUS   = 2,
+  UAS_PIPE_ID_DATA_IN  = 3,
+  UAS_PIPE_ID_DATA_OUT = 4,
+}uas_pipe_id_t;
+
+/// UAS Information Unit ID
+typedef enum
+{
+  UAS_IU_ID_COMMAND     = 0x01,
+  UAS_IU_ID_SENSE       = 0x03,
+  UAS_IU_ID_RESPONSE    = 0x04,
+  UAS_IU_ID_TASK_MGMT   = 0x05,
+  UAS_IU_ID_READ_READY  = 0x06,
+  UAS_IU_ID_WRITE_READY = 0x07,
+}uas_iu_id_t;
+
+/// UAS Task Attribute in Command IU
+typedef enum
+{
+  UAS_TASK_ATTR_SIMPLE        = 0,
+  UAS_TASK_ATTR_HEAD_OF_QUEUE = 1,
+  UAS_TASK_ATTR_ORDERED       = 2,
+  UAS_TASK_ATTR_ACA           = 4,
+}uas_task_attr_t;
+
+/// UAS Task Management Function
+typedef enum
+{
+  UAS_TMF_ABORT_TASK         = 0x01,
+  UAS_TMF_ABORT_TASK_SET     = 0x02,
+  UAS_TMF_CLEAR_TASK_SET     = 0x04,
+  UAS_TMF_LOGICAL_UNIT_RESET = 0x08,
+  UAS_TMF_IT_NEXUS_RESET     = 0x10,
+  UAS_TMF_CLEAR_ACA          = 0x40,
+  UAS_TMF_QUERY_TASK         = 0x80,
+  UAS_TMF_QUERY_TASK_SET     = 0x81,
+  UAS_TMF_QUERY_ASYNC_EVENT  = 0x82,
+}uas_tmf_type_t;
+
+/// UAS Response Code in Response IU
+typedef enum
+{
+  UAS_RESPONSE_TMF_COMPLETE      = 0x00,
+  UAS_RESPONSE_INVALID_IU        = 0x02,
+  UAS_RESPONSE_TMF_NOT_SUPPORTED = 0x04,
+  UAS_RESPONSE_TMF_FAILED        = 0x05,
+  UAS_RESPONSE_TMF_SUCCEEDED     = 0x08,
+  UAS_RESPONSE_INCORRECT_LUN     = 0x09,
+  UAS_RESPONSE_OVERLAPPED_TAG    = 0x0A,
+}uas_response_code_t;
+
+/// UAS Command IU (host to device on Command pipe)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id       ; ///< \ref UAS_IU_ID_COMMAND
+  uint8_t  reserved    ;
+  uint16_t tag         ; ///< Tag identifying this command
+  uint8_t  attribute   ; ///< bit 2:0 task attribute, bit 6:3 command priority
+  uint8_t  reserved2   ;
+  uint8_t  add_cdb_len ; ///< bit 7:2 additional CDB length in dwords
+  uint8_t  reserved3   ;
+  uint8_t  lun[8]      ; ///< Logical unit number in SAM format
+  uint8_t  cdb[16]     ;
+} uas_iu_command_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_command_t) == 32, "size is not correct");
+
+/// UAS Task Management IU (host to device on Command pipe)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id     ; ///< \ref UAS_IU_ID_TASK_MGMT
+  uint8_t  reserved  ;
+  uint16_t tag       ;
+  uint8_t  function  ; ///< \ref uas_tmf_type_t
+  uint8_t  reserved2 ;
+  uint16_t task_tag  ; ///< Tag of the command to be managed
+  uint8_t  lun[8]    ;
+} uas_iu_task_mgmt_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_task_mgmt_t) == 16, "size is not correct");
+
+/// UAS Sense IU (device to host on Status pipe), completes a command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id            ; ///< \ref UAS_IU_ID_SENSE
+  uint8_t  reserved         ;
+  uint16_t tag              ;
+  uint16_t status_qualifier ;
+  uint8_t  status           ; ///< \ref scsi_status_type_t
+  uint8_t  reserved2[7]     ;
+  uint16_t sense_len        ; ///< Length of sense data
+  uint8_t  sense[18]        ; ///< Fixed format sense data
+} uas_iu_sense_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_sense_t) == 34, "size is not correct");
+
+/// UAS Response IU (device to host on Status pipe), completes a task management or invalid IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id         ; ///< \ref UAS_IU_ID_RESPONSE
+  uint8_t  reserved      ;
+  uint16_t tag           ;
+  uint8_t  add_info[3]   ;
+  uint8_t  response_code ; ///< \ref uas_response_code_t
+} uas_iu_response_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_response_t) == 8, "size is not correct");
+
+/// UAS Read Ready/Write Ready IU (device to host on Status pipe), start data phase of a command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id    ; ///< \ref UAS_IU_ID_READ_READY or \ref UAS_IU_ID_WRITE_READY
+  uint8_t  reserved ;
+  uint16_t tag      ;
+} uas_iu_ready_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_ready_t) == 4, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
@@ -53,12 +53,21 @@ enum
   MSC_STAGE_NEED_RESET,
 };
 
+enum
+{
+  MSC_ASYNC_NONE = 0,
+  MSC_ASYNC_READ,
+  MSC_ASYNC_PREFETCH,
+  MSC_ASYNC_WRITE,
+};
+
 typedef struct
 {
   // TODO optimize alignment
-  CFG_TUSB_MEM_ALIGN msc_cbw_t cbw;
-  CFG_TUSB_MEM_ALIGN msc_csw_t csw;
+  TUD_EPBUF_TYPE_DEF(msc_cbw_t, cbw);
+  TUD_EPBUF_TYPE_DEF(msc_csw_t, csw);
 
+  uint8_t  rhport;
   uint8_t  itf_num;
   uint8_t  ep_in;
   uint8_t  ep_out;
@@ -72,19 +81,88 @@ typedef struct
   uint8_t sense_key;
   uint8_t add_sense_code;
   uint8_t add_sense_qualifier;
+
+  // Asynchronous READ10/WRITE10 callback
+  volatile uint8_t async_op; // MSC_ASYNC_*
+  uint8_t  async_wait;       // data stage waits for async read ahead
+  uint32_t async_len;        // WRITE10: bytes passed to callback
+  volatile int32_t async_result;
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+  // Ping-pong buffer state of READ10/WRITE10, reset for each command
+  struct {
+    uint8_t  buf_idx;      // READ10: buffer on the wire, WRITE10: next buffer to pass to application
+    uint8_t  rx_armed;     // WRITE10: OUT transfer is in progress
+    uint8_t  rx_idx;       // WRITE10: buffer of in progress OUT transfer
+    uint8_t  retry_pending;// WRITE10: write10 callback is deferred since application is not ready
+    uint32_t buf_len[2];   // WRITE10: received bytes not yet consumed by application
+    uint32_t rx_total;     // WRITE10: received bytes so far
+    uint32_t prefetch_pos; // READ10: position of data read ahead into other buffer
+    uint32_t prefetch_len; // READ10: number of bytes read ahead, 0 if none
+  } pp;
+#endif
 }mscd_interface_t;
 
+typedef struct {
+  TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE);
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+  TUD_EPBUF_DEF(buf2, CFG_TUD_MSC_EP_BUFSIZE);
+#endif
+} mscd_epbuf_t;
+
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static mscd_interface_t _mscd_itf;
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t _mscd_buf[CFG_TUD_MSC_EP_BUFSIZE];
+#if CFG_TUD_ARENA_SIZE
+// allocated from usbd arena when interface is opened
+tu_static mscd_epbuf_t* _mscd_epbuf_ptr;
+#define _mscd_epbuf  (*_mscd_epbuf_ptr)
+#else
+CFG_TUD_MEM_SECTION tu_static mscd_epbuf_t _mscd_epbuf;
+#endif
+
+#if CFG_TUD_MSC_MEMMAP
+// LUNs served directly from memory
+typedef struct {
+  uint8_t* base;
+  uint32_t block_count;
+  uint16_t block_size;
+  bool     writable;
+} mscd_memmap_t;
+
+tu_static mscd_memmap_t _mscd_memmap[CFG_TUD_MSC_MEMMAP];
+
+TU_ATTR_ALWAYS_INLINE static inline mscd_memmap_t const* memmap_get(uint8_t lun)
+{
+  return (lun < CFG_TUD_MSC_MEMMAP && _mscd_memmap[lun].base) ? &_mscd_memmap[lun] : NULL;
+}
+#endif
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* rdwr10_buf(uint8_t idx)
+{
+  return idx ? _mscd_epbuf.buf2 : _mscd_epbuf.buf;
+}
+#endif
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
+static int32_t proc_builtin_scsi_out(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t const* buffer, uint32_t bufsize);
 static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_read10_result(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes);
 
 static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
 static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static void proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc);
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+static void proc_read10_prefetch(mscd_interface_t* p_msc, uint32_t pos);
+static void proc_write10_consume(uint8_t rhport, mscd_interface_t* p_msc);
+static bool proc_write10_pp_result(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes);
+#else
+static void proc_write10_result(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes, int32_t nbytes);
+#endif
 
 TU_ATTR_ALWAYS_INLINE static inline bool is_data_in(uint8_t dir)
 {
@@ -132,25 +210,52 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   }
 }
 
-static inline uint32_t rdwr10_get_lba(uint8_t const command[])
+TU_ATTR_ALWAYS_INLINE static inline bool is_rdwr16_cmd(uint8_t cmd)
 {
-  // use offsetof to avoid pointer to the odd/unaligned address
-  uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
+  return (cmd == SCSI_CMD_READ_16) || (cmd == SCSI_CMD_WRITE_16);
+}
 
+TU_ATTR_ALWAYS_INLINE static inline bool is_read_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_READ_10) || (cmd == SCSI_CMD_READ_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_write_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_WRITE_10) || (cmd == SCSI_CMD_WRITE_16);
+}
+
+static inline uint64_t rdwr_get_lba(uint8_t const command[])
+{
+  // use offsetof to avoid pointer to the odd/unaligned address
   // lba is in Big Endian
+  if ( is_rdwr16_cmd(command[0]) )
+  {
+    uint32_t const lba_hi = tu_unaligned_read32(command + offsetof(scsi_write16_t, lba));
+    uint32_t const lba_lo = tu_unaligned_read32(command + offsetof(scsi_write16_t, lba) + 4);
+    return (((uint64_t) tu_ntohl(lba_hi)) << 32) | tu_ntohl(lba_lo);
+  }
+
+  uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
   return tu_ntohl(lba);
 }
 
-static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw)
+static inline uint32_t rdwr_get_blockcount(msc_cbw_t const* cbw)
 {
+  if ( is_rdwr16_cmd(cbw->command[0]) )
+  {
+    uint32_t const block_count = tu_unaligned_read32(cbw->command + offsetof(scsi_write16_t, block_count));
+    return tu_ntohl(block_count);
+  }
+
   uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
   return tu_ntohs(block_count);
 }
 
-static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw)
+static inline uint16_t rdwr_get_blocksize(msc_cbw_t const* cbw)
 {
   // first extract block count in the command
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
 
   // invalid block count
   if (block_count == 0) return 0;
@@ -158,10 +263,313 @@ static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw)
   return (uint16_t) (cbw->total_bytes / block_count);
 }
 
-uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
+// READ/WRITE command small enough to go through sector cache
+static inline bool rdwr_cacheable(msc_cbw_t const* cbw)
+{
+  return mscd_cacheable(rdwr_get_blocksize(cbw), rdwr_get_blockcount(cbw));
+}
+
+//--------------------------------------------------------------------+
+// Sector Cache
+//--------------------------------------------------------------------+
+
+// READ16/WRITE16 use 64-bit lba callbacks if implemented, otherwise fall back to READ10/WRITE10 ones.
+// rdwr_validate_cmd() already rejected lba that does not fit 32-bit in the later case
+static int32_t invoke_read_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  if ( tud_msc_read16_cb ) return tud_msc_read16_cb(lun, lba, offset, buffer, bufsize);
+  return tud_msc_read10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+static int32_t invoke_write_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  if ( tud_msc_write16_cb ) return tud_msc_write16_cb(lun, lba, offset, buffer, bufsize);
+  return tud_msc_write10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+#if CFG_TUD_MSC_CACHE_BLOCKS
+
+#define CACHE_BS   CFG_TUD_MSC_CACHE_BLOCK_SIZE
+
+typedef struct {
+  uint64_t lba;
+  uint32_t age;
+  uint8_t  lun;
+  uint8_t  valid;
+  uint8_t  dirty;
+} mscd_cache_line_t;
+
+tu_static mscd_cache_line_t _mscd_cache_line[CFG_TUD_MSC_CACHE_BLOCKS];
+tu_static uint32_t _mscd_cache_age;
+
+// lines are contiguous so that adjacent dirty lines of consecutive blocks are written with one callback
+tu_static uint8_t _mscd_cache_buf[CFG_TUD_MSC_CACHE_BLOCKS][CACHE_BS];
+
+TU_ATTR_ALWAYS_INLINE static inline bool cache_line_match(mscd_cache_line_t const* line, uint8_t lun,
+                                                          uint64_t lba, uint64_t count)
+{
+  return line->valid && (line->lun == lun) && (line->lba >= lba) && (line->lba - lba < count);
+}
+
+// find line holding a block, return -1 if not cached
+static int cache_find(uint8_t lun, uint64_t lba)
+{
+  for ( int i = 0; i < CFG_TUD_MSC_CACHE_BLOCKS; i++ )
+  {
+    if ( cache_line_match(&_mscd_cache_line[i], lun, lba, 1) ) return i;
+  }
+  return -1;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void cache_touch(int idx)
+{
+  _mscd_cache_line[idx].age = ++_mscd_cache_age;
+}
+
+// copy a block into its line, allocating a free or least recently used clean line if not cached yet.
+// Return -1 if all lines are dirty
+static int cache_put(uint8_t lun, uint64_t lba, uint8_t const* data, bool dirty)
+{
+  int idx = cache_find(lun, lba);
+
+  if ( idx < 0 )
+  {
+    for ( int i = 0; i < CFG_TUD_MSC_CACHE_BLOCKS; i++ )
+    {
+      mscd_cache_line_t const* line = &_mscd_cache_line[i];
+      if ( !line->valid )
+      {
+        idx = i;
+        break;
+      }
+
+      if ( !line->dirty && (idx < 0 || (int32_t) (line->age - _mscd_cache_line[idx].age) < 0) ) idx = i;
+    }
+    TU_VERIFY(idx >= 0, -1);
+
+    mscd_cache_line_t* line = &_mscd_cache_line[idx];
+    line->lun   = lun;
+    line->lba   = lba;
+    line->valid = 1;
+    line->dirty = 0;
+  }
+
+  cache_touch(idx);
+  memcpy(_mscd_cache_buf[idx], data, CACHE_BS);
+  if ( dirty ) _mscd_cache_line[idx].dirty = 1;
+
+  return idx;
+}
+
+// discard cached blocks in range, including dirty ones
+static void cache_invalidate(uint8_t lun, uint64_t lba, uint64_t count)
+{
+  for ( int i = 0; i < CFG_TUD_MSC_CACHE_BLOCKS; i++ )
+  {
+    mscd_cache_line_t* line = &_mscd_cache_line[i];
+    if ( cache_line_match(line, lun, lba, count) ) tu_varclr(line);
+  }
+}
+
+#endif
+
+#if CFG_TUD_MSC_CACHE_BLOCKS && CFG_TUD_MSC_CACHE_WRITE_BACK
+// write dirty lines of a LUN (all LUNs if 0xff) in lba order, consecutive blocks in adjacent lines are coalesced
+static bool cache_flush(uint8_t lun)
+{
+  while ( 1 )
+  {
+    // dirty line with the lowest lba
+    int idx = -1;
+    for ( int i = 0; i < CFG_TUD_MSC_CACHE_BLOCKS; i++ )
+    {
+      mscd_cache_line_t const* line = &_mscd_cache_line[i];
+      if ( line->valid && line->dirty && (lun == 0xff || line->lun == lun) &&
+           (idx < 0 || line->lun < _mscd_cache_line[idx].lun ||
+            (line->lun == _mscd_cache_line[idx].lun && line->lba < _mscd_cache_line[idx].lba)) )
+      {
+        idx = i;
+      }
+    }
+    if ( idx < 0 ) return true;
+
+    mscd_cache_line_t const* first = &_mscd_cache_line[idx];
+    int count = 1;
+    while ( (idx + count < CFG_TUD_MSC_CACHE_BLOCKS) &&
+            _mscd_cache_line[idx + count].dirty && cache_line_match(&_mscd_cache_line[idx + count], first->lun, first->lba + (uint64_t) count, 1) )
+    {
+      count++;
+    }
+
+    uint32_t const total = (uint32_t) count * CACHE_BS;
+    uint32_t written = 0;
+    while ( written < total )
+    {
+      int32_t const nbytes = invoke_write_cb(first->lun, first->lba + written / CACHE_BS, written % CACHE_BS,
+                                             _mscd_cache_buf[idx] + written, total - written);
+
+      // not ready or asynchronous completion is not supported for flushing
+      if ( nbytes <= 0 ) return false;
+      written += (uint32_t) nbytes;
+    }
+
+    for ( int i = idx; i < idx + count; i++ ) _mscd_cache_line[i].dirty = 0;
+  }
+}
+
+// write dirty lines overlapped by an uncached access so that application storage is up to date
+static bool cache_sync(uint8_t lun, uint64_t lba, uint64_t count)
+{
+  for ( int i = 0; i < CFG_TUD_MSC_CACHE_BLOCKS; i++ )
+  {
+    mscd_cache_line_t const* line = &_mscd_cache_line[i];
+    if ( line->dirty && cache_line_match(line, lun, lba, count) ) return cache_flush(lun);
+  }
+  return true;
+}
+#else
+TU_ATTR_ALWAYS_INLINE static inline bool cache_flush(uint8_t lun)
+{
+  (void) lun;
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool cache_sync(uint8_t lun, uint64_t lba, uint64_t count)
+{
+  (void) lun; (void) lba; (void) count;
+  return true;
+}
+#endif
+
+bool mscd_cacheable(uint16_t block_size, uint32_t cmd_blocks)
+{
+#if CFG_TUD_MSC_CACHE_BLOCKS
+  return (block_size == CACHE_BS) && (cmd_blocks <= CFG_TUD_MSC_CACHE_CMD_BLOCKS);
+#else
+  (void) block_size; (void) cmd_blocks;
+  return false;
+#endif
+}
+
+bool tud_msc_cache_flush(uint8_t lun)
+{
+  return cache_flush(lun);
+}
+
+void tud_msc_cache_invalidate(uint8_t lun)
+{
+#if CFG_TUD_MSC_CACHE_BLOCKS
+  cache_invalidate(lun, 0, UINT64_MAX);
+#else
+  (void) lun;
+#endif
+}
+
+int32_t mscd_invoke_read(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize, bool cacheable)
+{
+#if CFG_TUD_MSC_MEMMAP
+  // copy for drivers that need data in their own buffer e.g UAS
+  mscd_memmap_t const* mm = memmap_get(lun);
+  if ( mm )
+  {
+    memcpy(buffer, mm->base + (size_t) lba*mm->block_size + offset, bufsize);
+    return (int32_t) bufsize;
+  }
+#endif
+
+#if CFG_TUD_MSC_CACHE_BLOCKS
+  uint8_t* buf8 = (uint8_t*) buffer;
+
+  if ( cacheable && (offset == 0) && (bufsize >= CACHE_BS) )
+  {
+    // serve leading cached blocks, caller requests the rest again
+    uint32_t count = 0;
+    int idx;
+    while ( (count + CACHE_BS <= bufsize) && (idx = cache_find(lun, lba + count / CACHE_BS)) >= 0 )
+    {
+      cache_touch(idx);
+      memcpy(buf8 + count, _mscd_cache_buf[idx], CACHE_BS);
+      count += CACHE_BS;
+    }
+    if ( count ) return (int32_t) count;
+
+    // read up to next cached block since it may be newer than storage
+    uint32_t len = CACHE_BS;
+    while ( (len + CACHE_BS <= bufsize) && (cache_find(lun, lba + len / CACHE_BS) < 0) ) len += CACHE_BS;
+    if ( len + CACHE_BS > bufsize ) len = bufsize;
+
+    int32_t const nbytes = invoke_read_cb(lun, lba, 0, buffer, len);
+
+    for ( uint32_t pos = 0; (nbytes > 0) && (pos + CACHE_BS <= (uint32_t) nbytes); pos += CACHE_BS )
+    {
+      (void) cache_put(lun, lba + pos / CACHE_BS, buf8 + pos, false);
+    }
+    return nbytes;
+  }
+
+  if ( !cache_sync(lun, lba, (offset + bufsize + CACHE_BS - 1) / CACHE_BS) ) return -1;
+#else
+  (void) cacheable;
+#endif
+
+  return invoke_read_cb(lun, lba, offset, buffer, bufsize);
+}
+
+int32_t mscd_invoke_write(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize, bool cacheable)
+{
+#if CFG_TUD_MSC_MEMMAP
+  mscd_memmap_t const* mm = memmap_get(lun);
+  if ( mm )
+  {
+    memcpy(mm->base + (size_t) lba*mm->block_size + offset, buffer, bufsize);
+    return (int32_t) bufsize;
+  }
+#endif
+
+#if CFG_TUD_MSC_CACHE_BLOCKS
+  bool const whole_blocks = cacheable && (offset == 0) && (bufsize >= CACHE_BS);
+
+  #if CFG_TUD_MSC_CACHE_WRITE_BACK
+  if ( whole_blocks )
+  {
+    // keep in cache, flush all dirty lines if there is no room. A trailing partial block is passed again by caller
+    uint32_t count = 0;
+    while ( count + CACHE_BS <= bufsize )
+    {
+      if ( (cache_put(lun, lba + count / CACHE_BS, buffer + count, true) < 0) &&
+           (!cache_flush(0xff) || cache_put(lun, lba + count / CACHE_BS, buffer + count, true) < 0) )
+      {
+        return count ? (int32_t) count : -1;
+      }
+      count += CACHE_BS;
+    }
+    return (int32_t) count;
+  }
+  #endif
+
+  // cached copies become stale, partially overwritten dirty blocks must reach storage first
+  uint64_t const nblk = (offset + bufsize + CACHE_BS - 1) / CACHE_BS;
+  if ( !cache_sync(lun, lba, nblk) ) return -1;
+  cache_invalidate(lun, lba, nblk);
+
+  int32_t const nbytes = invoke_write_cb(lun, lba, offset, buffer, bufsize);
+
+  // write-through: keep blocks written synchronously
+  for ( uint32_t pos = 0; whole_blocks && (nbytes > 0) && (pos + CACHE_BS <= (uint32_t) nbytes); pos += CACHE_BS )
+  {
+    (void) cache_put(lun, lba + pos / CACHE_BS, buffer + pos, false);
+  }
+  return nbytes;
+#else
+  (void) cacheable;
+  return invoke_write_cb(lun, lba, offset, buffer, bufsize);
+#endif
+}
+
+uint8_t rdwr_validate_cmd(msc_cbw_t const* cbw)
 {
   uint8_t status = MSC_CSW_STATUS_PASSED;
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
 
   if ( cbw->total_bytes == 0 )
   {
@@ -175,12 +583,12 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
     }
   }else
   {
-    if ( SCSI_CMD_READ_10 == cbw->command[0] && !is_data_in(cbw->dir) )
+    if ( is_read_cmd(cbw->command[0]) && !is_data_in(cbw->dir) )
     {
       TU_LOG_DRV("  SCSI case 10 (Ho <> Di)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
-    else if ( SCSI_CMD_WRITE_10 == cbw->command[0] && is_data_in(cbw->dir) )
+    else if ( is_write_cmd(cbw->command[0]) && is_data_in(cbw->dir) )
     {
       TU_LOG_DRV("  SCSI case 8 (Hi <> Do)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
@@ -195,6 +603,30 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
       TU_LOG_DRV(" Computed block size = 0. SCSI case 7 Hi < Di (READ10) or case 13 Ho < Do (WRIT10)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
+    else
+    {
+      bool const has_cb16 = is_read_cmd(cbw->command[0]) ? (tud_msc_read16_cb != NULL) : (tud_msc_write16_cb != NULL);
+      uint64_t const last_lba = rdwr_get_lba(cbw->command) + block_count - 1;
+
+      if ( !has_cb16 && (last_lba > UINT32_MAX) )
+      {
+        TU_LOG_DRV("  SCSI lba exceeds 32-bit without 64-bit lba callback\r\n");
+        tud_msc_set_sense(cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+        status = MSC_CSW_STATUS_FAILED;
+      }
+
+      #if CFG_TUD_MSC_MEMMAP
+      // memory mapped LUN must not be accessed beyond its storage
+      mscd_memmap_t const* mm = memmap_get(cbw->lun);
+      if ( mm && (status == MSC_CSW_STATUS_PASSED) &&
+           ((last_lba >= mm->block_count) || (cbw->total_bytes != block_count * mm->block_size)) )
+      {
+        TU_LOG_DRV("  SCSI access beyond memory mapped LUN\r\n");
+        tud_msc_set_sense(cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+        status = MSC_CSW_STATUS_FAILED;
+      }
+      #endif
+    }
   }
 
   return status;
@@ -217,7 +649,12 @@ TU_ATTR_UNUSED tu_static tu_lookup_entry_t const _msc_scsi_cmd_lookup[] =
   { .key = SCSI_CMD_REQUEST_SENSE                , .data = "Request Sense" },
   { .key = SCSI_CMD_READ_FORMAT_CAPACITY         , .data = "Read Format Capacity" },
   { .key = SCSI_CMD_READ_10                      , .data = "Read10" },
-  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" }
+  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" },
+  { .key = SCSI_CMD_READ_16                      , .data = "Read16" },
+  { .key = SCSI_CMD_WRITE_16                     , .data = "Write16" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_10         , .data = "Synchronize Cache10" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_16         , .data = "Synchronize Cache16" },
+  { .key = SCSI_CMD_SERVICE_ACTION_IN_16         , .data = "Service Action In16" }
 };
 
 TU_ATTR_UNUSED tu_static tu_lookup_table_t const _msc_scsi_cmd_table =
@@ -242,12 +679,45 @@ bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, u
   return true;
 }
 
+bool tud_msc_memmap_lun(uint8_t lun, void const* base, uint32_t block_count, uint16_t block_size, bool writable)
+{
+#if CFG_TUD_MSC_MEMMAP
+  TU_VERIFY(lun < CFG_TUD_MSC_MEMMAP);
+  TU_VERIFY(base == NULL || (block_count > 0 && block_size > 0));
+
+  mscd_memmap_t* mm = &_mscd_memmap[lun];
+  mm->base        = (uint8_t*) (uintptr_t) base;
+  mm->block_count = block_count;
+  mm->block_size  = block_size;
+  mm->writable    = writable;
+
+  return true;
+#else
+  (void) lun; (void) base; (void) block_count; (void) block_size; (void) writable;
+  return false;
+#endif
+}
+
 static inline void set_sense_medium_not_present(uint8_t lun)
 {
   // default sense is NOT READY, MEDIUM NOT PRESENT
   tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
 }
 
+//--------------------------------------------------------------------+
+// Shared with UAS driver
+//--------------------------------------------------------------------+
+int32_t mscd_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize)
+{
+  return proc_builtin_scsi(lun, scsi_cmd, buffer, bufsize);
+}
+
+uint8_t mscd_sense_key(uint8_t lun)
+{
+  (void) lun;
+  return _mscd_itf.sense_key;
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -276,8 +746,15 @@ uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(max_len >= drv_len, 0);
 
   mscd_interface_t * p_msc = &_mscd_itf;
+  p_msc->rhport  = rhport;
   p_msc->itf_num = itf_desc->bInterfaceNumber;
 
+#if CFG_TUD_ARENA_SIZE
+  mscd_epbuf_t* epbuf = (mscd_epbuf_t*) usbd_arena_alloc(rhport, sizeof(mscd_epbuf_t));
+  TU_ASSERT(epbuf != NULL, 0);
+  _mscd_epbuf_ptr = epbuf;
+#endif
+
   // Open endpoint pair
   TU_ASSERT( usbd_open_edpt_pair(rhport, tu_desc_next(itf_desc), 2, TUSB_XFER_BULK, &p_msc->ep_out, &p_msc->ep_in), 0 );
 
@@ -427,18 +904,24 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
       p_msc->stage = MSC_STAGE_DATA;
       p_msc->total_len = p_cbw->total_bytes;
       p_msc->xferred_len = 0;
+      p_msc->async_op = MSC_ASYNC_NONE;
+      p_msc->async_wait = 0;
+
+      #if CFG_TUD_MSC_DOUBLE_BUFFER
+      tu_varclr(&p_msc->pp);
+      #endif
 
-      // Read10 or Write10
-      if ( (SCSI_CMD_READ_10 == p_cbw->command[0]) || (SCSI_CMD_WRITE_10 == p_cbw->command[0]) )
+      // Read10/16 or Write10/16
+      if ( is_read_cmd(p_cbw->command[0]) || is_write_cmd(p_cbw->command[0]) )
       {
-        uint8_t const status = rdwr10_validate_cmd(p_cbw);
+        uint8_t const status = rdwr_validate_cmd(p_cbw);
 
         if ( status != MSC_CSW_STATUS_PASSED)
         {
           fail_scsi_op(rhport, p_msc, status);
         }else if ( p_cbw->total_bytes )
         {
-          if (SCSI_CMD_READ_10 == p_cbw->command[0])
+          if ( is_read_cmd(p_cbw->command[0]) )
           {
             proc_read10_cmd(rhport, p_msc);
           }else
@@ -458,7 +941,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // 2. IN & Zero: Process if is built-in, else Invoke app callback. Skip DATA if zero length
         if ( (p_cbw->total_bytes > 0 ) && !is_data_in(p_cbw->dir) )
         {
-          if (p_cbw->total_bytes > sizeof(_mscd_buf))
+          if (p_cbw->total_bytes > sizeof(_mscd_epbuf.buf))
           {
             TU_LOG_DRV("  SCSI reject non READ10/WRITE10 with large data\r\n");
             fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
@@ -466,17 +949,17 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
           {
             // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
             // but it is OK to just receive data then responded with failed status
-            TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, (uint16_t) p_msc->total_len) );
+            TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf.buf, (uint16_t) p_msc->total_len) );
           }
         }else
         {
           // First process if it is a built-in commands
-          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_buf, sizeof(_mscd_buf));
+          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, sizeof(_mscd_epbuf.buf));
 
           // Invoke user callback if not built-in
           if ( (resplen < 0) && (p_msc->sense_key == 0) )
           {
-            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, (uint16_t) p_msc->total_len);
           }
 
           if ( resplen < 0 )
@@ -509,7 +992,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
             {
               // cannot return more than host expect
               p_msc->total_len = tu_min32((uint32_t) resplen, p_cbw->total_bytes);
-              TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) p_msc->total_len) );
+              TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf.buf, (uint16_t) p_msc->total_len) );
             }
           }
         }
@@ -518,9 +1001,9 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
 
     case MSC_STAGE_DATA:
       TU_LOG_DRV("  SCSI Data [Lun%u]\r\n", p_cbw->lun);
-      //TU_LOG_MEM(MSC_DEBUG, _mscd_buf, xferred_bytes, 2);
+      //TU_LOG_MEM(MSC_DEBUG, _mscd_epbuf.buf, xferred_bytes, 2);
 
-      if (SCSI_CMD_READ_10 == p_cbw->command[0])
+      if ( is_read_cmd(p_cbw->command[0]) )
       {
         p_msc->xferred_len += xferred_bytes;
 
@@ -533,8 +1016,26 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
           proc_read10_cmd(rhport, p_msc);
         }
       }
-      else if (SCSI_CMD_WRITE_10 == p_cbw->command[0])
+      else if ( is_write_cmd(p_cbw->command[0]) )
       {
+        #if CFG_TUD_MSC_MEMMAP
+        if ( memmap_get(p_cbw->lun) )
+        {
+          // data is already received into mapped memory
+          p_msc->xferred_len += xferred_bytes;
+
+          if ( p_msc->xferred_len >= p_msc->total_len )
+          {
+            // Data Stage is complete
+            p_msc->stage = MSC_STAGE_STATUS;
+          }else
+          {
+            proc_write10_cmd(rhport, p_msc);
+          }
+          break;
+        }
+        #endif
+
         proc_write10_new_data(rhport, p_msc, xferred_bytes);
       }
       else
@@ -544,7 +1045,14 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // OUT transfer, invoke callback if needed
         if ( !is_data_in(p_cbw->dir) )
         {
-          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+          // First process if it is a built-in commands with parameter data e.g UNMAP
+          int32_t cb_result = proc_builtin_scsi_out(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, p_msc->xferred_len);
+
+          // Invoke user callback if not built-in
+          if ( (cb_result < 0) && (p_msc->sense_key == 0) )
+          {
+            cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, (uint16_t) p_msc->total_len);
+          }
 
           if ( cb_result < 0 )
           {
@@ -587,10 +1095,12 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         switch(p_cbw->command[0])
         {
           case SCSI_CMD_READ_10:
+          case SCSI_CMD_READ_16:
             if ( tud_msc_read10_complete_cb ) tud_msc_read10_complete_cb(p_cbw->lun);
           break;
 
           case SCSI_CMD_WRITE_10:
+          case SCSI_CMD_WRITE_16:
             if ( tud_msc_write10_complete_cb ) tud_msc_write10_complete_cb(p_cbw->lun);
           break;
 
@@ -610,6 +1120,16 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     default : break;
   }
 
+  proc_stage_status(rhport, p_msc);
+
+  return true;
+}
+
+// Send status if data stage is complete
+static void proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
   if ( p_msc->stage == MSC_STAGE_STATUS )
   {
     // skip status if epin is currently stalled, will do it when received Clear Stall request
@@ -622,7 +1142,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         usbd_edpt_stall(rhport, p_msc->ep_in);
       }else
       {
-        TU_ASSERT( send_csw(rhport, p_msc) );
+        TU_ASSERT( send_csw(rhport, p_msc), );
       }
     }
 
@@ -637,40 +1157,286 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     }
     #endif
   }
-
-  return true;
 }
 
 /*------------------------------------------------------------------*/
 /* SCSI Command Process
  *------------------------------------------------------------------*/
 
-// return response's length (copied to buffer). Negative if it is not an built-in command or indicate Failed status (CSW)
-// In case of a failed status, sense key must be set for reason of failure
-static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize)
+// get disk size, 64-bit block count callback is preferred if implemented
+void mscd_get_capacity(uint8_t lun, uint64_t* block_count, uint16_t* block_size)
 {
-  (void) bufsize; // TODO refractor later
-  int32_t resplen;
+#if CFG_TUD_MSC_MEMMAP
+  mscd_memmap_t const* mm = memmap_get(lun);
+  if ( mm )
+  {
+    *block_count = mm->block_count;
+    *block_size  = mm->block_size;
+    return;
+  }
+#endif
+
+  if ( tud_msc_capacity16_cb )
+  {
+    tud_msc_capacity16_cb(lun, block_count, block_size);
+  }else
+  {
+    uint32_t count32 = 0;
+    tud_msc_capacity_cb(lun, &count32, block_size);
+    *block_count = count32;
+  }
+}
+
+// write protection, memory mapped LUN reports its registered flag
+bool mscd_lun_writable(uint8_t lun)
+{
+#if CFG_TUD_MSC_MEMMAP
+  mscd_memmap_t const* mm = memmap_get(lun);
+  if ( mm ) return mm->writable;
+#endif
+
+  return tud_msc_is_writable_cb ? tud_msc_is_writable_cb(lun) : true;
+}
 
+// Deallocate a range of blocks for UNMAP/WRITE SAME, return 0 if success, negative with sense set if failed
+static int32_t proc_unmap_range(uint8_t lun, uint64_t lba, uint32_t block_count)
+{
   mscd_interface_t* p_msc = &_mscd_itf;
 
-  switch ( scsi_cmd[0] )
+  if ( !mscd_lun_writable(lun) )
   {
-    case SCSI_CMD_TEST_UNIT_READY:
-      resplen = 0;
-      if ( !tud_msc_test_unit_ready_cb(lun) )
-      {
-        // Failed status response
-        resplen = - 1;
+    tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00); // Write protected
+    return -1;
+  }
 
-        // set default sense if not set by callback
-        if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
-      }
-    break;
+  uint64_t disk_blocks;
+  uint16_t block_size;
+  mscd_get_capacity(lun, &disk_blocks, &block_size);
+
+  if ( (lba > disk_blocks) || (block_count > disk_blocks - lba) )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+    return -1;
+  }
+
+  #if CFG_TUD_MSC_CACHE_BLOCKS
+  cache_invalidate(lun, lba, block_count);
+  #endif
+
+  if ( block_count && !tud_msc_unmap_cb(lun, lba, block_count) )
+  {
+    // set default sense if not set by callback
+    if ( p_msc->sense_key == 0 ) tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // Write error
+    return -1;
+  }
+
+  return 0;
+}
+
+// WRITE SAME (10/16) with UNMAP bit: data-out block (if any) is ignored and the range is deallocated
+static int32_t proc_write_same_unmap(uint8_t lun, uint8_t const scsi_cmd[16])
+{
+  uint64_t lba;
+  uint32_t block_count;
+
+  if ( scsi_cmd[0] == SCSI_CMD_WRITE_SAME_10 )
+  {
+    lba         = tu_ntohl(tu_unaligned_read32(scsi_cmd + 2));
+    block_count = tu_ntohs(tu_unaligned_read16(scsi_cmd + 7));
+  }else
+  {
+    lba         = (((uint64_t) tu_ntohl(tu_unaligned_read32(scsi_cmd + 2))) << 32) | tu_ntohl(tu_unaligned_read32(scsi_cmd + 6));
+    block_count = tu_ntohl(tu_unaligned_read32(scsi_cmd + 10));
+  }
+
+  // zero length (rest of medium) is not supported, WSNZ bit is set in Block Limits page
+  if ( block_count == 0 )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00); // Invalid field in CDB
+    return -1;
+  }
+
+  return proc_unmap_range(lun, lba, block_count);
+}
+
+// UNMAP parameter list: 8-byte header followed by 16-byte block descriptors. All descriptors are validated
+// before any of them is deallocated.
+static int32_t proc_unmap_cmd(uint8_t lun, uint8_t const* buffer, uint32_t bufsize)
+{
+  // parameter list length = 0 is not an error, nothing to unmap
+  if ( bufsize < sizeof(scsi_unmap_param_header_t) ) return 0;
+
+  uint32_t const desc_len = tu_min32(tu_ntohs(tu_unaligned_read16(buffer + offsetof(scsi_unmap_param_header_t, desc_data_length))),
+                                     bufsize - sizeof(scsi_unmap_param_header_t));
+  uint8_t const* desc_list = buffer + sizeof(scsi_unmap_param_header_t);
+  uint32_t const desc_count = desc_len / sizeof(scsi_unmap_block_desc_t);
+
+  uint64_t disk_blocks;
+  uint16_t block_size;
+  mscd_get_capacity(lun, &disk_blocks, &block_size);
+
+  for(uint8_t pass = 0; pass < 2; pass++)
+  {
+    for(uint32_t i = 0; i < desc_count; i++)
+    {
+      uint8_t const* p_desc = desc_list + i*sizeof(scsi_unmap_block_desc_t);
+      uint64_t const lba = (((uint64_t) tu_ntohl(tu_unaligned_read32(p_desc))) << 32) | tu_ntohl(tu_unaligned_read32(p_desc + 4));
+      uint32_t const block_count = tu_ntohl(tu_unaligned_read32(p_desc + offsetof(scsi_unmap_block_desc_t, block_count)));
+
+      if ( pass == 0 )
+      {
+        if ( (lba > disk_blocks) || (block_count > disk_blocks - lba) )
+        {
+          tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+          return -1;
+        }
+      }else
+      {
+        TU_VERIFY(proc_unmap_range(lun, lba, block_count) == 0, -1);
+      }
+    }
+  }
+
+  return 0;
+}
+
+// return 0 if command with data-out is processed, negative if it is not an built-in command or indicate Failed status
+// (sense key is set in this case)
+static int32_t proc_builtin_scsi_out(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t const* buffer, uint32_t bufsize)
+{
+  if ( !tud_msc_unmap_cb ) return -1;
+
+  switch ( scsi_cmd[0] )
+  {
+    case SCSI_CMD_UNMAP:
+      return proc_unmap_cmd(lun, buffer, bufsize);
+
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16:
+      // only UNMAP bit is built-in, normal WRITE SAME is passed to application
+      if ( scsi_cmd[1] & 0x08u ) return proc_write_same_unmap(lun, scsi_cmd);
+      return -1;
+
+    default: return -1;
+  }
+}
+
+// Inquiry with EVPD: Supported Pages, Block Limits and Logical Block Provisioning (if unmap is implemented)
+// are built-in, other pages are not supported
+static int32_t proc_inquiry_vpd(uint8_t lun, uint8_t page_code, uint8_t* buffer, uint32_t bufsize)
+{
+  int32_t resplen;
+
+  switch ( page_code )
+  {
+    case SCSI_VPD_PAGE_SUPPORTED_PAGES:
+    {
+      uint8_t supported_pages[] = { 0x00, SCSI_VPD_PAGE_SUPPORTED_PAGES, 0x00, 3,
+                                    SCSI_VPD_PAGE_SUPPORTED_PAGES, SCSI_VPD_PAGE_BLOCK_LIMITS,
+                                    SCSI_VPD_PAGE_LOGICAL_BLOCK_PROVISIONING };
+
+      resplen = sizeof(supported_pages);
+      if ( !tud_msc_unmap_cb )
+      {
+        supported_pages[3]--;
+        resplen--;
+      }
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, supported_pages, (size_t) resplen), -1);
+    }
+    break;
+
+    case SCSI_VPD_PAGE_BLOCK_LIMITS:
+    {
+      // zero means no limit/not reported
+      uint32_t max_blocks = 0;
+      uint32_t opt_blocks = 0;
+
+      if ( tud_msc_block_limits_cb ) tud_msc_block_limits_cb(lun, &max_blocks, &opt_blocks);
+
+      scsi_vpd_block_limits_t block_limits;
+      tu_varclr(&block_limits);
+
+      block_limits.page_code    = SCSI_VPD_PAGE_BLOCK_LIMITS;
+      block_limits.page_length  = tu_htons(sizeof(scsi_vpd_block_limits_t) - 4);
+      block_limits.max_xfer_len = tu_htonl(max_blocks);
+      block_limits.opt_xfer_len = tu_htonl(opt_blocks);
+
+      if ( tud_msc_unmap_cb )
+      {
+        // no limit on unmap range, number of descriptors is bounded by endpoint buffer
+        block_limits.wsnz                 = 1;
+        block_limits.max_unmap_lba_count  = tu_htonl(UINT32_MAX);
+        block_limits.max_unmap_desc_count = tu_htonl((CFG_TUD_MSC_EP_BUFSIZE - sizeof(scsi_unmap_param_header_t)) / sizeof(scsi_unmap_block_desc_t));
+
+        uint8_t* p_ws_len = ((uint8_t*) &block_limits) + offsetof(scsi_vpd_block_limits_t, max_write_same_len);
+        tu_unaligned_write32(p_ws_len + 4, tu_htonl(UINT32_MAX));
+      }
+
+      resplen = sizeof(block_limits);
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &block_limits, (size_t) resplen), -1);
+    }
+    break;
+
+    case SCSI_VPD_PAGE_LOGICAL_BLOCK_PROVISIONING:
+      if ( tud_msc_unmap_cb )
+      {
+        scsi_vpd_lb_provisioning_t lbp;
+        tu_varclr(&lbp);
+
+        lbp.page_code         = SCSI_VPD_PAGE_LOGICAL_BLOCK_PROVISIONING;
+        lbp.page_length       = tu_htons(sizeof(scsi_vpd_lb_provisioning_t) - 4);
+        lbp.flags             = 0x80u | 0x40u | 0x20u; // LBPU, LBPWS, LBPWS10
+        lbp.provisioning_type = 2; // thin provisioned
+
+        resplen = sizeof(lbp);
+        TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &lbp, (size_t) resplen), -1);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    default:
+      resplen = -1;
+      tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00); // Invalid field in CDB
+    break;
+  }
+
+  return resplen;
+}
+
+// return response's length (copied to buffer). Negative if it is not an built-in command or indicate Failed status (CSW)
+// In case of a failed status, sense key must be set for reason of failure
+static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize)
+{
+  (void) bufsize; // TODO refractor later
+  int32_t resplen;
+
+  mscd_interface_t* p_msc = &_mscd_itf;
+
+  switch ( scsi_cmd[0] )
+  {
+    case SCSI_CMD_TEST_UNIT_READY:
+      resplen = 0;
+      if ( !tud_msc_test_unit_ready_cb(lun) )
+      {
+        // Failed status response
+        resplen = - 1;
+
+        // set default sense if not set by callback
+        if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
+      }
+    break;
 
     case SCSI_CMD_START_STOP_UNIT:
       resplen = 0;
 
+      // host stops or ejects the unit after this, write cached data first
+      if ( !cache_flush(lun) )
+      {
+        resplen = -1;
+        tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // Write error
+        break;
+      }
+
       if (tud_msc_start_stop_cb)
       {
         scsi_start_stop_unit_t const * start_stop = (scsi_start_stop_unit_t const *) scsi_cmd;
@@ -687,12 +1453,10 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
     case SCSI_CMD_READ_CAPACITY_10:
     {
-      uint32_t block_count;
-      uint32_t block_size;
-      uint16_t block_size_u16;
+      uint64_t block_count;
+      uint16_t block_size;
 
-      tud_msc_capacity_cb(lun, &block_count, &block_size_u16);
-      block_size = (uint32_t) block_size_u16;
+      mscd_get_capacity(lun, &block_count, &block_size);
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
@@ -706,8 +1470,9 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       {
         scsi_read_capacity10_resp_t read_capa10;
 
-        read_capa10.last_lba   = tu_htonl(block_count-1);
-        read_capa10.block_size = tu_htonl(block_size);
+        // last lba 0xFFFFFFFF tells host to use READ CAPACITY(16)
+        read_capa10.last_lba   = tu_htonl((uint32_t) tu_min64(block_count-1, UINT32_MAX));
+        read_capa10.block_size = tu_htonl((uint32_t) block_size);
 
         resplen = sizeof(read_capa10);
         TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa10, (size_t) resplen));
@@ -715,6 +1480,63 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
     break;
 
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+    {
+      // other service actions are passed to application
+      if ( (scsi_cmd[1] & 0x1Fu) != SCSI_SERVICE_ACTION_READ_CAPACITY_16 )
+      {
+        resplen = -1;
+        break;
+      }
+
+      uint64_t block_count;
+      uint16_t block_size;
+
+      mscd_get_capacity(lun, &block_count, &block_size);
+
+      if (block_count == 0 || block_size == 0)
+      {
+        resplen = -1;
+
+        // set default sense if not set by callback
+        if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
+      }else
+      {
+        scsi_read_capacity16_resp_t read_capa16;
+        tu_varclr(&read_capa16);
+
+        // 64-bit lba is in Big Endian
+        uint64_t const last_lba = block_count - 1;
+        uint8_t* p_lba = ((uint8_t*) &read_capa16) + offsetof(scsi_read_capacity16_resp_t, last_lba);
+        tu_unaligned_write32(p_lba    , tu_htonl((uint32_t) (last_lba >> 32)));
+        tu_unaligned_write32(p_lba + 4, tu_htonl((uint32_t) last_lba));
+        read_capa16.block_size = tu_htonl((uint32_t) block_size);
+
+        // LBPME: logical block provisioning management is enabled
+        if ( tud_msc_unmap_cb ) read_capa16.lowest_aligned_lba = tu_htons(0x8000);
+
+        resplen = sizeof(read_capa16);
+        TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa16, (size_t) resplen));
+      }
+    }
+    break;
+
+    case SCSI_CMD_UNMAP:
+      // no parameter data means nothing to unmap
+      resplen = tud_msc_unmap_cb ? 0 : -1;
+    break;
+
+    case SCSI_CMD_WRITE_SAME_16:
+      // with NDOB (no data-out buffer) and UNMAP bits, other variants are passed to application
+      if ( tud_msc_unmap_cb && ((scsi_cmd[1] & 0x09u) == 0x09u) )
+      {
+        resplen = proc_write_same_unmap(lun, scsi_cmd);
+      }else
+      {
+        resplen = -1;
+      }
+    break;
+
     case SCSI_CMD_READ_FORMAT_CAPACITY:
     {
       scsi_read_format_capacity_data_t read_fmt_capa =
@@ -725,10 +1547,10 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
           .block_size_u16  = 0
       };
 
-      uint32_t block_count;
+      uint64_t block_count;
       uint16_t block_size;
 
-      tud_msc_capacity_cb(lun, &block_count, &block_size);
+      mscd_get_capacity(lun, &block_count, &block_size);
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
@@ -740,7 +1562,7 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
         if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
       }else
       {
-        read_fmt_capa.block_num = tu_htonl(block_count);
+        read_fmt_capa.block_num = tu_htonl((uint32_t) tu_min64(block_count, UINT32_MAX));
         read_fmt_capa.block_size_u16 = tu_htons(block_size);
 
         resplen = sizeof(read_fmt_capa);
@@ -751,6 +1573,12 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
     case SCSI_CMD_INQUIRY:
     {
+      if ( scsi_cmd[1] & SCSI_INQUIRY_EVPD )
+      {
+        resplen = proc_inquiry_vpd(lun, scsi_cmd[2], buffer, bufsize);
+        break;
+      }
+
       scsi_inquiry_resp_t inquiry_rsp =
       {
           .is_removable         = 1,
@@ -782,19 +1610,40 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
           .block_descriptor_len = 0  // no block descriptor are included
       };
 
-      bool writable = true;
-      if ( tud_msc_is_writable_cb )
+      mode_resp.write_protected = !mscd_lun_writable(lun);
+
+      resplen = sizeof(mode_resp);
+
+      #if CFG_TUD_MSC_CACHE_BLOCKS && CFG_TUD_MSC_CACHE_WRITE_BACK
+      // Caching mode page with WCE (write cache enable) so that host issues SYNCHRONIZE CACHE
+      uint8_t const page_code = scsi_cmd[2] & 0x3Fu;
+      if ( (page_code == 0x08) || (page_code == 0x3F) )
       {
-        writable = tud_msc_is_writable_cb(lun);
-      }
+        uint8_t caching_page[20] = { 0x08, 0x12, 0x04 };
+        mode_resp.data_len += sizeof(caching_page);
 
-      mode_resp.write_protected = !writable;
+        TU_VERIFY(0 == tu_memcpy_s(buffer + resplen, bufsize - (uint32_t) resplen, caching_page, sizeof(caching_page)));
+        resplen += (int32_t) sizeof(caching_page);
+      }
+      #endif
 
-      resplen = sizeof(mode_resp);
-      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &mode_resp, (size_t) resplen));
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &mode_resp, sizeof(mode_resp)));
     }
     break;
 
+    #if CFG_TUD_MSC_CACHE_BLOCKS && CFG_TUD_MSC_CACHE_WRITE_BACK
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+    case SCSI_CMD_SYNCHRONIZE_CACHE_16:
+      // whole LUN is flushed regardless of the range
+      resplen = 0;
+      if ( !cache_flush(lun) )
+      {
+        resplen = -1;
+        tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // Write error
+      }
+    break;
+    #endif
+
     case SCSI_CMD_REQUEST_SENSE:
     {
       scsi_sense_fixed_resp_t sense_rsp =
@@ -828,22 +1677,94 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
   return resplen;
 }
 
+#if CFG_TUD_MSC_MEMMAP
+// Transfer next chunk of READ10/WRITE10 straight from/to mapped memory, as much as a single transfer can carry
+static void proc_memmap_xfer(uint8_t rhport, mscd_interface_t* p_msc, mscd_memmap_t const* mm, uint8_t ep_addr)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  // multiple of both full and high speed bulk packet size
+  enum { MEMMAP_XFER_MAX = 0x8000 };
+
+  uint8_t* addr = mm->base + (size_t) rdwr_get_lba(p_cbw->command)*mm->block_size + p_msc->xferred_len;
+  uint16_t const nbytes = (uint16_t) tu_min32(MEMMAP_XFER_MAX, p_cbw->total_bytes - p_msc->xferred_len);
+
+  TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, addr, nbytes), );
+}
+#endif
+
 static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
+#if CFG_TUD_MSC_MEMMAP
+  mscd_memmap_t const* mm = memmap_get(p_cbw->lun);
+  if ( mm )
+  {
+    proc_memmap_xfer(rhport, p_msc, mm, p_msc->ep_in);
+    return;
+  }
+#endif
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+  // asynchronous read ahead is still in progress, continue when it is done
+  if ( p_msc->async_op == MSC_ASYNC_PREFETCH )
+  {
+    p_msc->async_wait = 1;
+    return;
+  }
+
+  // next chunk is already read into other buffer while previous one was on the wire
+  if ( p_msc->pp.prefetch_len && (p_msc->pp.prefetch_pos == p_msc->xferred_len) )
+  {
+    uint32_t const prefetch_len = p_msc->pp.prefetch_len;
+    p_msc->pp.prefetch_len = 0;
+    p_msc->pp.buf_idx ^= 1;
+
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, rdwr10_buf(p_msc->pp.buf_idx), (uint16_t) prefetch_len), );
+    proc_read10_prefetch(p_msc, p_msc->xferred_len + prefetch_len);
+    return;
+  }
+  p_msc->pp.prefetch_len = 0;
+
+  uint8_t* buffer = rdwr10_buf(p_msc->pp.buf_idx);
+#else
+  uint8_t* buffer = _mscd_epbuf.buf;
+#endif
+
   // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
 
   // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
 
   // remaining bytes capped at class buffer
-  int32_t nbytes = (int32_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
+  int32_t nbytes = (int32_t) tu_min32(sizeof(_mscd_epbuf.buf), p_cbw->total_bytes-p_msc->xferred_len);
 
   // Application can consume smaller bytes
   uint32_t const offset = p_msc->xferred_len % block_sz;
-  nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_buf, (uint32_t) nbytes);
+
+  // set before invoking callback since application can complete right away
+  p_msc->async_op = MSC_ASYNC_READ;
+  nbytes = mscd_invoke_read(p_cbw->lun, lba, offset, buffer, (uint32_t) nbytes, rdwr_cacheable(p_cbw));
+
+  // wait for tud_msc_async_done()
+  if ( nbytes == TUD_MSC_ASYNC ) return;
+
+  p_msc->async_op = MSC_ASYNC_NONE;
+  proc_read10_result(rhport, p_msc, nbytes);
+}
+
+// process result of read10 callback
+static void proc_read10_result(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+  uint8_t* buffer = rdwr10_buf(p_msc->pp.buf_idx);
+#else
+  uint8_t* buffer = _mscd_epbuf.buf;
+#endif
 
   if ( nbytes < 0 )
   {
@@ -862,21 +1783,45 @@ static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
   }
   else
   {
-    TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) nbytes), );
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, buffer, (uint16_t) nbytes), );
+
+    #if CFG_TUD_MSC_DOUBLE_BUFFER
+    proc_read10_prefetch(p_msc, p_msc->xferred_len + (uint32_t) nbytes);
+    #endif
   }
 }
 
-static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+// Read next chunk into the other buffer while current one is being transferred.
+// Errors and not ready are ignored here, they are handled when the chunk is read again by proc_read10_cmd()
+static void proc_read10_prefetch(mscd_interface_t* p_msc, uint32_t pos)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
-  bool writable = true;
 
-  if ( tud_msc_is_writable_cb )
-  {
-    writable = tud_msc_is_writable_cb(p_cbw->lun);
-  }
+  if ( pos >= p_cbw->total_bytes ) return;
+
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (pos / block_sz);
+  uint32_t const offset = pos % block_sz;
+  uint32_t const nbytes = tu_min32(sizeof(_mscd_epbuf.buf), p_cbw->total_bytes - pos);
+
+  p_msc->pp.prefetch_pos = pos;
+  p_msc->async_op = MSC_ASYNC_PREFETCH;
 
-  if ( !writable )
+  int32_t const count = mscd_invoke_read(p_cbw->lun, lba, offset, rdwr10_buf(p_msc->pp.buf_idx ^ 1), nbytes,
+                                         rdwr_cacheable(p_cbw));
+  if ( count == TUD_MSC_ASYNC ) return;
+
+  p_msc->async_op = MSC_ASYNC_NONE;
+  if ( count > 0 ) p_msc->pp.prefetch_len = (uint32_t) count;
+}
+#endif
+
+static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  if ( !mscd_lun_writable(p_cbw->lun) )
   {
     // Not writable, complete this SCSI op with error
     // Sense = Write protected
@@ -885,27 +1830,185 @@ static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
     return;
   }
 
+#if CFG_TUD_MSC_MEMMAP
+  mscd_memmap_t const* mm = memmap_get(p_cbw->lun);
+  if ( mm )
+  {
+    proc_memmap_xfer(rhport, p_msc, mm, p_msc->ep_out);
+    return;
+  }
+#endif
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+  // next buffer to receive is the one application is consuming if empty, else the other one
+  uint8_t const idx = p_msc->pp.buf_len[p_msc->pp.buf_idx] ? (p_msc->pp.buf_idx ^ 1) : p_msc->pp.buf_idx;
+
+  // skip if transfer is already in progress, all data is requested or no free buffer
+  if ( p_msc->pp.rx_armed || (p_msc->pp.rx_total >= p_cbw->total_bytes) || p_msc->pp.buf_len[idx] ) return;
+
+  uint16_t nbytes = (uint16_t) tu_min32(sizeof(_mscd_epbuf.buf), p_cbw->total_bytes - p_msc->pp.rx_total);
+
+  p_msc->pp.rx_armed = 1;
+  p_msc->pp.rx_idx = idx;
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, rdwr10_buf(idx), nbytes), );
+#else
   // remaining bytes capped at class buffer
-  uint16_t nbytes = (uint16_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
+  uint16_t nbytes = (uint16_t) tu_min32(sizeof(_mscd_epbuf.buf), p_cbw->total_bytes-p_msc->xferred_len);
 
   // Write10 callback will be called later when usb transfer complete
-  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, nbytes), );
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf.buf, nbytes), );
+#endif
+}
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+
+// Deferred write10 callback when application was not ready or consumed partially
+static void proc_write10_retry(void* param)
+{
+  mscd_interface_t* p_msc = (mscd_interface_t*) param;
+
+  uint8_t const rhport = p_msc->rhport;
+
+  // skip if command is aborted (e.g bot reset) meanwhile
+  if ( !p_msc->pp.retry_pending ) return;
+  p_msc->pp.retry_pending = 0;
+
+  proc_write10_consume(rhport, p_msc);
+  proc_stage_status(rhport, p_msc);
+}
+
+// Pass received data to application in order, also re-arm OUT transfer as soon as a buffer is free
+static void proc_write10_consume(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
+
+  while ( (p_msc->stage == MSC_STAGE_DATA) && (p_msc->async_op == MSC_ASYNC_NONE) &&
+          p_msc->pp.buf_len[p_msc->pp.buf_idx] )
+  {
+    uint8_t const idx = p_msc->pp.buf_idx;
+
+    uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+    uint32_t const offset = p_msc->xferred_len % block_sz;
+
+    // set before invoking callback since application can complete right away
+    p_msc->async_op = MSC_ASYNC_WRITE;
+    int32_t const nbytes = mscd_invoke_write(p_cbw->lun, lba, offset, rdwr10_buf(idx), p_msc->pp.buf_len[idx],
+                                               rdwr_cacheable(p_cbw));
+
+    // wait for tud_msc_async_done()
+    if ( nbytes == TUD_MSC_ASYNC ) break;
+
+    p_msc->async_op = MSC_ASYNC_NONE;
+    if ( !proc_write10_pp_result(rhport, p_msc, nbytes) ) break;
+  }
+}
+
+// process result of write10 callback for current buffer, return true if buffer is fully consumed
+static bool proc_write10_pp_result(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  uint8_t const idx = p_msc->pp.buf_idx;
+  uint8_t* buffer = rdwr10_buf(idx);
+  uint32_t const len = p_msc->pp.buf_len[idx];
+
+  if ( nbytes < 0 )
+  {
+    // negative means error -> failed this scsi op
+    TU_LOG_DRV("  tud_msc_write10_cb() return -1\r\n");
+
+    // update actual byte before failed
+    p_msc->xferred_len += len;
+    p_msc->pp.buf_len[0] = p_msc->pp.buf_len[1] = 0;
+
+    set_sense_medium_not_present(p_cbw->lun);
+    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    return false;
+  }
+  else if ( (uint32_t) nbytes < len )
+  {
+    // Application consume less than what we got (including zero), invoke callback again later
+    if ( nbytes > 0 )
+    {
+      p_msc->xferred_len += (uint32_t) nbytes;
+      p_msc->pp.buf_len[idx] = len - (uint32_t) nbytes;
+      memmove(buffer, buffer + nbytes, p_msc->pp.buf_len[idx]);
+    }
+
+    if ( !p_msc->pp.retry_pending )
+    {
+      p_msc->pp.retry_pending = 1;
+      usbd_defer_func(proc_write10_retry, p_msc, false);
+    }
+    return false;
+  }
+  else
+  {
+    // buffer is consumed, use it for next OUT transfer
+    p_msc->xferred_len += len;
+    p_msc->pp.buf_len[idx] = 0;
+    p_msc->pp.buf_idx ^= 1;
+
+    if ( p_msc->xferred_len >= p_msc->total_len )
+    {
+      // Data Stage is complete
+      p_msc->stage = MSC_STAGE_STATUS;
+    }else
+    {
+      proc_write10_cmd(rhport, p_msc);
+    }
+    return true;
+  }
 }
 
+// process new data arrived from WRITE10
+static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  p_msc->pp.rx_armed = 0;
+  p_msc->pp.buf_len[p_msc->pp.rx_idx] = xferred_bytes;
+  p_msc->pp.rx_total += xferred_bytes;
+
+  // receive next chunk into the other buffer while application is writing this one
+  proc_write10_cmd(rhport, p_msc);
+
+  // wait for deferred or asynchronous callback if application is not ready
+  if ( !p_msc->pp.retry_pending && (p_msc->async_op == MSC_ASYNC_NONE) )
+  {
+    proc_write10_consume(rhport, p_msc);
+  }
+}
+
+#else
+
 // process new data arrived from WRITE10
 static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
 
   // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
 
-  // Invoke callback to consume new data
+  // Invoke callback to consume new data, set async before since application can complete right away
   uint32_t const offset = p_msc->xferred_len % block_sz;
-  int32_t nbytes = tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_buf, xferred_bytes);
+  p_msc->async_op = MSC_ASYNC_WRITE;
+  p_msc->async_len = xferred_bytes;
+  int32_t nbytes = mscd_invoke_write(p_cbw->lun, lba, offset, _mscd_epbuf.buf, xferred_bytes, rdwr_cacheable(p_cbw));
+
+  // wait for tud_msc_async_done()
+  if ( nbytes == TUD_MSC_ASYNC ) return;
+
+  p_msc->async_op = MSC_ASYNC_NONE;
+  proc_write10_result(rhport, p_msc, xferred_bytes, nbytes);
+}
+
+// process result of write10 callback
+static void proc_write10_result(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes, int32_t nbytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   if ( nbytes < 0 )
   {
@@ -928,7 +2031,7 @@ static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint3
       if ( nbytes > 0 )
       {
         p_msc->xferred_len += (uint16_t) nbytes;
-        memmove(_mscd_buf, _mscd_buf+nbytes, left_over);
+        memmove(_mscd_epbuf.buf, _mscd_epbuf.buf+nbytes, left_over);
       }
 
       // simulate an transfer complete with adjusted parameters --> callback will be invoked with adjusted parameter
@@ -953,3 +2056,70 @@ static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint3
 }
 
 #endif
+
+//--------------------------------------------------------------------+
+// Asynchronous READ10/WRITE10
+//--------------------------------------------------------------------+
+
+// Resume data stage in usbd task with result of asynchronous callback
+static void proc_async_done(void* param)
+{
+  mscd_interface_t* p_msc = (mscd_interface_t*) param;
+
+  uint8_t const rhport = p_msc->rhport;
+
+  uint8_t const op = p_msc->async_op;
+  int32_t const result = p_msc->async_result;
+  p_msc->async_op = MSC_ASYNC_NONE;
+
+  // skip if command is aborted (e.g bot reset) meanwhile
+  if ( p_msc->stage != MSC_STAGE_DATA ) return;
+
+  switch ( op )
+  {
+    case MSC_ASYNC_READ:
+      proc_read10_result(rhport, p_msc, result);
+    break;
+
+#if CFG_TUD_MSC_DOUBLE_BUFFER
+    case MSC_ASYNC_PREFETCH:
+      if ( result > 0 ) p_msc->pp.prefetch_len = (uint32_t) result;
+
+      // previous chunk is already transferred
+      if ( p_msc->async_wait )
+      {
+        p_msc->async_wait = 0;
+        proc_read10_cmd(rhport, p_msc);
+      }
+    break;
+
+    case MSC_ASYNC_WRITE:
+      if ( proc_write10_pp_result(rhport, p_msc, result) ) proc_write10_consume(rhport, p_msc);
+    break;
+#else
+    case MSC_ASYNC_WRITE:
+      proc_write10_result(rhport, p_msc, p_msc->async_len, result);
+    break;
+#endif
+
+    default: break;
+  }
+
+  proc_stage_status(rhport, p_msc);
+}
+
+bool tud_msc_async_done_ext(uint8_t lun, int32_t bytes, bool in_isr)
+{
+  mscd_interface_t* p_msc = &_mscd_itf;
+
+  // no asynchronous callback in progress
+  TU_VERIFY(p_msc->async_op != MSC_ASYNC_NONE && lun == p_msc->cbw.lun);
+  TU_VERIFY(bytes != TUD_MSC_ASYNC);
+
+  p_msc->async_result = bytes;
+  usbd_defer_func(proc_async_done, p_msc, in_isr);
+
+  return true;
+}
+
+#endif
@@ -50,13 +50,79 @@
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 
+// Use 2 buffers of CFG_TUD_MSC_EP_BUFSIZE for READ10/WRITE10 so that tud_msc_read10_cb() of the next chunk
+// and tud_msc_write10_cb() of the previous chunk run while the other buffer is being transferred
+#ifndef CFG_TUD_MSC_DOUBLE_BUFFER
+  #define CFG_TUD_MSC_DOUBLE_BUFFER   0
+#endif
+
+// Number of LUNs (starting from 0) that can be registered with tud_msc_memmap_lun() to be served directly
+// from memory (RAM disk, XIP flash image) without read10/write10 callbacks. 0 to disable.
+#ifndef CFG_TUD_MSC_MEMMAP
+  #define CFG_TUD_MSC_MEMMAP          0
+#endif
+
+// Number of blocks in optional sector cache shared by all LUNs, placed underneath read10/write10 callbacks so that
+// hot spots host re-reads constantly (FAT, directories) are served from RAM. Only used for LUNs whose block size is
+// CFG_TUD_MSC_CACHE_BLOCK_SIZE and for commands of at most CFG_TUD_MSC_CACHE_CMD_BLOCKS blocks, large sequential
+// transfers go straight to callbacks and do not evict metadata.
+// - Blocks not in cache are read by callback then kept, least recently used ones are replaced
+// - Write-through by default: cache is updated once write10 callback succeeds
+// - CFG_TUD_MSC_CACHE_WRITE_BACK: writes are kept in cache and passed to write10 callback on SYNCHRONIZE CACHE,
+//   START STOP UNIT, tud_msc_cache_flush() or when all lines are dirty. Adjacent blocks are coalesced into one
+//   callback. Mode Sense reports write cache enabled so that host issues SYNCHRONIZE CACHE. Requires write10
+//   callback to complete synchronously (no TUD_MSC_ASYNC) when flushing.
+#ifndef CFG_TUD_MSC_CACHE_BLOCKS
+  #define CFG_TUD_MSC_CACHE_BLOCKS      0
+#endif
+
+#ifndef CFG_TUD_MSC_CACHE_BLOCK_SIZE
+  #define CFG_TUD_MSC_CACHE_BLOCK_SIZE  512
+#endif
+
+#ifndef CFG_TUD_MSC_CACHE_CMD_BLOCKS
+  #define CFG_TUD_MSC_CACHE_CMD_BLOCKS  8
+#endif
+
+#ifndef CFG_TUD_MSC_CACHE_WRITE_BACK
+  #define CFG_TUD_MSC_CACHE_WRITE_BACK  0
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
 
+// Returned by tud_msc_read10_cb()/tud_msc_write10_cb() to indicate I/O is started and will be completed
+// later with tud_msc_async_done(). Other negative values still indicate an error.
+#define TUD_MSC_ASYNC   (-2)
+
 // Set SCSI sense response
 bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier);
 
+// Complete an asynchronous read10/write10 callback with its result (number of bytes, 0 for not ready or negative for
+// error) as it would have been returned by the callback. Can be called from any context, data stage is resumed in
+// usbd task. Buffer passed to the callback must stay untouched until then.
+bool tud_msc_async_done_ext(uint8_t lun, int32_t bytes, bool in_isr);
+
+TU_ATTR_ALWAYS_INLINE static inline
+bool tud_msc_async_done(uint8_t lun, int32_t bytes) {
+  return tud_msc_async_done_ext(lun, bytes, false);
+}
+
+// Serve LUN directly from memory mapped storage of block_count * block_size bytes at base, NULL to unregister.
+// READ10/WRITE10 (and 16) are transferred by endpoint straight from/to this memory without callbacks or copying,
+// capacity and write protection are reported from here as well. Memory must be accessible by the USB controller
+// (DMA capable region, cache line aligned if dcache is enabled), otherwise use the read10/write10 callbacks.
+// Requires CFG_TUD_MSC_MEMMAP > lun, should be called when LUN is idle e.g before tud_init() or while unmounted.
+bool tud_msc_memmap_lun(uint8_t lun, void const* base, uint32_t block_count, uint16_t block_size, bool writable);
+
+// Write dirty blocks of sector cache to write10 callback e.g before power down or in tud_umount_cb(), also used
+// by SYNCHRONIZE CACHE. Always true if CFG_TUD_MSC_CACHE_WRITE_BACK is not enabled.
+bool tud_msc_cache_flush(uint8_t lun);
+
+// Discard cached blocks of LUN including dirty ones, e.g application changed the storage or medium is removed
+void tud_msc_cache_invalidate(uint8_t lun);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -73,6 +139,8 @@ bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, u
 //
 //   - read < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                      and return failed status in command status wrapper phase.
+//
+//   - TUD_MSC_ASYNC  : Read is started and buffer will be filled later, application must then call tud_msc_async_done()
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
 
 // Invoked when received SCSI WRITE10 command
@@ -88,6 +156,8 @@ int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buf
 //   - write < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                       and return failed status in command status wrapper phase.
 //
+//   - TUD_MSC_ASYNC   : Write is started, application must call tud_msc_async_done() when it is complete
+//
 // TODO change buffer to const uint8_t*
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
 
@@ -105,8 +175,8 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_siz
 
 /**
  * Invoked when received an SCSI command not in built-in list below.
- * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
- * - READ10 and WRITE10 has their own callbacks
+ * - READ_CAPACITY10, READ_CAPACITY16, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
+ * - READ10/16 and WRITE10/16 has their own callbacks
  *
  * \param[in]   lun         Logical unit number
  * \param[in]   scsi_cmd    SCSI command contents which application must examine to response accordingly
@@ -134,10 +204,10 @@ TU_ATTR_WEAK bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bo
 // Invoked when received REQUEST_SENSE
 TU_ATTR_WEAK int32_t tud_msc_request_sense_cb(uint8_t lun, void* buffer, uint16_t bufsize);
 
-// Invoked when Read10 command is complete
+// Invoked when Read10/Read16 command is complete
 TU_ATTR_WEAK void tud_msc_read10_complete_cb(uint8_t lun);
 
-// Invoke when Write10 command is complete, can be used to flush flash caching
+// Invoke when Write10/Write16 command is complete, can be used to flush flash caching
 TU_ATTR_WEAK void tud_msc_write10_complete_cb(uint8_t lun);
 
 // Invoked when command in tud_msc_scsi_cb is complete
@@ -146,6 +216,29 @@ TU_ATTR_WEAK void tud_msc_scsi_complete_cb(uint8_t lun, uint8_t const scsi_cmd[1
 // Invoked to check if device is writable as part of SCSI WRITE10
 TU_ATTR_WEAK bool tud_msc_is_writable_cb(uint8_t lun);
 
+// Invoked when received SCSI READ16 command, same as tud_msc_read10_cb() but with 64-bit lba.
+// If not implemented, tud_msc_read10_cb() is used and READ16 beyond 32-bit lba is failed with LBA out of range.
+TU_ATTR_WEAK int32_t tud_msc_read16_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+
+// Invoked when received SCSI WRITE16 command, same as tud_msc_write10_cb() but with 64-bit lba.
+// If not implemented, tud_msc_write10_cb() is used and WRITE16 beyond 32-bit lba is failed with LBA out of range.
+TU_ATTR_WEAK int32_t tud_msc_write16_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
+// Invoked to determine disk size with 64-bit block count (> 2TB with 512 bytes block), used instead of
+// tud_msc_capacity_cb() if implemented. READ_CAPACITY_10 reports 0xFFFFFFFF so that host uses READ_CAPACITY_16
+TU_ATTR_WEAK void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint16_t* block_size);
+
+// Invoked when received Inquiry for Block Limits VPD page. Application update maximum and optimal number of
+// blocks per READ/WRITE command, host typically splits its requests accordingly. Zero means not reported.
+TU_ATTR_WEAK void tud_msc_block_limits_cb(uint8_t lun, uint32_t* max_xfer_blocks, uint32_t* opt_xfer_blocks);
+
+// Invoked when host deallocates (trim) a range of blocks with SCSI UNMAP or WRITE SAME with UNMAP bit, range is
+// already validated against disk capacity. Implementing this callback advertises thin provisioning so that host
+// can discard unused blocks e.g erase flash sectors early. Return false to fail the command (default sense is
+// MEDIUM ERROR if not set by callback). Note: UAS does not carry UNMAP parameter data, only WRITE SAME(16) with
+// NDOB bit is supported there.
+TU_ATTR_WEAK bool tud_msc_unmap_cb(uint8_t lun, uint64_t lba, uint32_t block_count);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -155,6 +248,15 @@ uint16_t mscd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     mscd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
 bool     mscd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
 
+// Built-in SCSI commands, sense data and read/write callback dispatch, shared with UAS driver
+int32_t  mscd_builtin_scsi    (uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
+uint8_t  mscd_sense_key       (uint8_t lun);
+void     mscd_get_capacity    (uint8_t lun, uint64_t* block_count, uint16_t* block_size);
+bool     mscd_lun_writable    (uint8_t lun);
+bool     mscd_cacheable       (uint16_t block_size, uint32_t cmd_blocks);
+int32_t  mscd_invoke_read     (uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize, bool cacheable);
+int32_t  mscd_invoke_write    (uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize, bool cacheable);
+
 #ifdef __cplusplus
  }
 #endif
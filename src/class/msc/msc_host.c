@@ -50,6 +50,32 @@ enum {
   MSC_STAGE_STATUS,
 };
 
+#if CFG_TUH_MSC_CACHE_BLOCKS
+typedef struct {
+  uint8_t  daddr;  // 0 if line is free
+  uint8_t  lun;
+  bool     valid;  // data is ready
+  bool     dirty;  // data is newer than device
+  bool     busy;   // buffer is used by an on-going read-ahead or flush transfer
+  uint32_t lba;
+  uint32_t age;    // last access, for LRU eviction
+} msch_cache_line_t;
+
+// cached READ10 in progress
+typedef struct {
+  bool in_use;
+  uint8_t ra_count;
+  uint16_t block_count;
+  uint32_t lba;
+  void* buffer;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t complete_arg;
+
+  uint8_t ra_line[CFG_TUH_MSC_CACHE_READAHEAD];
+  tuh_msc_sg_t sg[1 + CFG_TUH_MSC_CACHE_READAHEAD]; // application buffer then read-ahead lines
+} msch_cache_read_t;
+#endif
+
 typedef struct {
   uint8_t itf_num;
   uint8_t ep_in;
@@ -68,11 +94,53 @@ typedef struct {
   //------------- SCSI -------------//
   uint8_t stage;
   void* buffer;
+  tuh_msc_sg_t const* sg_list; // if not NULL, data stage uses this list instead of buffer
+  uint8_t sg_count;
   tuh_msc_complete_cb_t complete_cb;
   uintptr_t complete_arg;
 
-  CFG_TUH_MEM_ALIGN msc_cbw_t cbw;
-  CFG_TUH_MEM_ALIGN msc_csw_t csw;
+  // data stage progress, split into chunks of at most CFG_TUH_MSC_XFER_MAX bytes
+  uint8_t  sg_idx;
+  uint32_t sg_offset;
+  uint32_t data_xferred;
+  uint16_t data_chunk;
+
+  TUH_EPBUF_TYPE_DEF(msc_cbw_t, cbw);
+  TUH_EPBUF_TYPE_DEF(msc_csw_t, csw);
+
+#if CFG_TUH_MSC_QUEUE_DEPTH
+  // commands submitted while another one is in progress, started from msch_xfer_cb() after its CSW
+  struct {
+    msc_cbw_t cbw;
+    void* buffer;
+    tuh_msc_sg_t const* sg_list;
+    uint8_t sg_count;
+    tuh_msc_complete_cb_t complete_cb;
+    uintptr_t complete_arg;
+  } queue[CFG_TUH_MSC_QUEUE_DEPTH];
+
+  uint8_t queue_rd;
+  uint8_t queue_count;
+#endif
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+  struct {
+    // sequential read detection
+    uint8_t  last_lun;
+    uint32_t next_lba;
+
+    // one per command that can be in progress or queued
+    msch_cache_read_t read[CFG_TUH_MSC_QUEUE_DEPTH + 1];
+
+    struct {
+      bool active;
+      uint8_t count;
+      tuh_msc_flush_cb_t complete_cb;
+      uint8_t line[CFG_TUH_MSC_CACHE_BLOCKS];
+      tuh_msc_sg_t sg[CFG_TUH_MSC_CACHE_BLOCKS];
+    } flush;
+  } cache;
+#endif
 } msch_interface_t;
 
 CFG_TUH_MEM_SECTION static msch_interface_t _msch_itf[CFG_TUH_DEVICE_MAX];
@@ -126,28 +194,102 @@ static inline void cbw_init(msc_cbw_t* cbw, uint8_t lun) {
   cbw->lun       = lun;
 }
 
-bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data,
-                          tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+// start command currently loaded in interface
+static bool scsi_command_start(uint8_t daddr, msch_interface_t* p_msc) {
+  // claim endpoint
+  if (!usbh_edpt_claim(daddr, p_msc->ep_out)) {
+    p_msc->stage = MSC_STAGE_IDLE;
+    return false;
+  }
+
+  p_msc->stage = MSC_STAGE_CMD;
+
+  if (!usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) {
+    usbh_edpt_release(daddr, p_msc->ep_out);
+    p_msc->stage = MSC_STAGE_IDLE;
+    return false;
+  }
+
+  return true;
+}
+
+static bool scsi_command_submit(uint8_t daddr, msc_cbw_t const* cbw, void* data,
+                                tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                                tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(daddr);
   TU_VERIFY(p_msc->configured);
 
-  // claim endpoint
-  TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_out));
+#if CFG_TUH_MSC_QUEUE_DEPTH
+  // Bulk-Only Transport executes one command at a time: queue if busy or others are already waiting
+  if (p_msc->stage != MSC_STAGE_IDLE || p_msc->queue_count) {
+    TU_VERIFY(p_msc->queue_count < CFG_TUH_MSC_QUEUE_DEPTH);
+
+    uint8_t const idx = (uint8_t) ((p_msc->queue_rd + p_msc->queue_count) % CFG_TUH_MSC_QUEUE_DEPTH);
+    p_msc->queue[idx].cbw          = *cbw;
+    p_msc->queue[idx].buffer       = data;
+    p_msc->queue[idx].sg_list      = sg_list;
+    p_msc->queue[idx].sg_count     = sg_count;
+    p_msc->queue[idx].complete_cb  = complete_cb;
+    p_msc->queue[idx].complete_arg = arg;
+    p_msc->queue_count++;
+
+    return true;
+  }
+#endif
 
   p_msc->cbw = *cbw;
-  p_msc->stage = MSC_STAGE_CMD;
   p_msc->buffer = data;
+  p_msc->sg_list = sg_list;
+  p_msc->sg_count = sg_count;
   p_msc->complete_cb = complete_cb;
   p_msc->complete_arg = arg;
 
-  if (!usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) {
-    usbh_edpt_release(daddr, p_msc->ep_out);
-    return false;
+  return scsi_command_start(daddr, p_msc);
+}
+
+bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data,
+                          tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  return scsi_command_submit(daddr, cbw, data, NULL, 0, complete_cb, arg);
+}
+
+bool tuh_msc_scsi_command_sg(uint8_t daddr, msc_cbw_t const* cbw, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  TU_VERIFY(sg_list && sg_count);
+
+  // list must be large enough for the whole data stage
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < sg_count; i++) {
+    total += sg_list[i].len;
   }
+  TU_VERIFY(total >= cbw->total_bytes);
 
-  return true;
+  return scsi_command_submit(daddr, cbw, sg_list[0].buffer, sg_list, sg_count, complete_cb, arg);
 }
 
+#if CFG_TUH_MSC_QUEUE_DEPTH
+// start next queued command if any, drop those that fail to start
+static void scsi_command_start_next(uint8_t daddr, msch_interface_t* p_msc) {
+  while (p_msc->queue_count) {
+    uint8_t const idx = p_msc->queue_rd;
+    p_msc->queue_rd = (uint8_t) ((p_msc->queue_rd + 1) % CFG_TUH_MSC_QUEUE_DEPTH);
+    p_msc->queue_count--;
+
+    p_msc->cbw          = p_msc->queue[idx].cbw;
+    p_msc->buffer       = p_msc->queue[idx].buffer;
+    p_msc->sg_list      = p_msc->queue[idx].sg_list;
+    p_msc->sg_count     = p_msc->queue[idx].sg_count;
+    p_msc->complete_cb  = p_msc->queue[idx].complete_cb;
+    p_msc->complete_arg = p_msc->queue[idx].complete_arg;
+
+    if (scsi_command_start(daddr, p_msc)) {
+      return;
+    }
+
+    TU_LOG_DRV("  MSCh failed to start queued command, opcode = 0x%02X\r\n", p_msc->cbw.command[0]);
+  }
+}
+#endif
+
 bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_resp_t* response,
                            tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(dev_addr);
@@ -219,50 +361,703 @@ bool tuh_msc_request_sense(uint8_t dev_addr, uint8_t lun, void* response,
   return tuh_msc_scsi_command(dev_addr, &cbw, response, complete_cb, arg);
 }
 
-bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count,
-                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+static bool read10_cbw_init(msc_cbw_t* cbw, uint8_t dev_addr, uint8_t lun, uint32_t lba, uint16_t block_count) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   TU_VERIFY(p_msc->mounted);
 
-  msc_cbw_t cbw;
-  cbw_init(&cbw, lun);
+  cbw_init(cbw, lun);
 
-  cbw.total_bytes = block_count * p_msc->capacity[lun].block_size;
-  cbw.dir = TUSB_DIR_IN_MASK;
-  cbw.cmd_len = sizeof(scsi_read10_t);
+  cbw->total_bytes = block_count * p_msc->capacity[lun].block_size;
+  cbw->dir = TUSB_DIR_IN_MASK;
+  cbw->cmd_len = sizeof(scsi_read10_t);
 
   scsi_read10_t const cmd_read10 = {
       .cmd_code    = SCSI_CMD_READ_10,
       .lba         = tu_htonl(lba),
       .block_count = tu_htons(block_count)
   };
-  memcpy(cbw.command, &cmd_read10, cbw.cmd_len);
+  memcpy(cbw->command, &cmd_read10, cbw->cmd_len);
 
-  return tuh_msc_scsi_command(dev_addr, &cbw, buffer, complete_cb, arg);
+  return true;
 }
 
-bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count,
-                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+static bool write10_cbw_init(msc_cbw_t* cbw, uint8_t dev_addr, uint8_t lun, uint32_t lba, uint16_t block_count) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   TU_VERIFY(p_msc->mounted);
 
-  msc_cbw_t cbw;
-  cbw_init(&cbw, lun);
+  cbw_init(cbw, lun);
 
-  cbw.total_bytes = block_count * p_msc->capacity[lun].block_size;
-  cbw.dir         = TUSB_DIR_OUT;
-  cbw.cmd_len     = sizeof(scsi_write10_t);
+  cbw->total_bytes = block_count * p_msc->capacity[lun].block_size;
+  cbw->dir         = TUSB_DIR_OUT;
+  cbw->cmd_len     = sizeof(scsi_write10_t);
 
   scsi_write10_t const cmd_write10 = {
       .cmd_code    = SCSI_CMD_WRITE_10,
       .lba         = tu_htonl(lba),
       .block_count = tu_htons(block_count)
   };
-  memcpy(cbw.command, &cmd_write10, cbw.cmd_len);
+  memcpy(cbw->command, &cmd_write10, cbw->cmd_len);
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Block Cache
+//--------------------------------------------------------------------+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+
+static msch_cache_line_t _msch_cache_line[CFG_TUH_MSC_CACHE_BLOCKS];
+static uint32_t _msch_cache_age;
+
+CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
+static uint8_t _msch_cache_buf[CFG_TUH_MSC_CACHE_BLOCKS][CFG_TUH_MSC_CACHE_BLOCK_SIZE];
+
+static int cache_flush_run(uint8_t daddr);
+
+TU_ATTR_ALWAYS_INLINE static inline bool cache_usable(uint8_t daddr, uint8_t lun) {
+  msch_interface_t const* p_msc = get_itf(daddr);
+  return lun < CFG_TUH_MSC_MAXLUN && p_msc->capacity[lun].block_size == CFG_TUH_MSC_CACHE_BLOCK_SIZE;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void cache_touch(msch_cache_line_t* line) {
+  line->age = ++_msch_cache_age;
+}
+
+// find line holding a block, return -1 if not cached
+static int cache_find(uint8_t daddr, uint8_t lun, uint32_t lba) {
+  for (int i = 0; i < CFG_TUH_MSC_CACHE_BLOCKS; i++) {
+    msch_cache_line_t const* line = &_msch_cache_line[i];
+    if (line->daddr == daddr && line->lun == lun && line->lba == lba) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// get a free or least recently used clean line for a block, return -1 if all lines are dirty or busy
+static int cache_alloc(uint8_t daddr, uint8_t lun, uint32_t lba) {
+  int idx = -1;
+  for (int i = 0; i < CFG_TUH_MSC_CACHE_BLOCKS; i++) {
+    msch_cache_line_t const* line = &_msch_cache_line[i];
+    if (line->busy || line->dirty) {
+      continue;
+    }
+
+    if (line->daddr == 0) {
+      idx = i;
+      break;
+    }
+
+    if (idx < 0 || (int32_t) (line->age - _msch_cache_line[idx].age) < 0) {
+      idx = i;
+    }
+  }
+
+  if (idx >= 0) {
+    msch_cache_line_t* line = &_msch_cache_line[idx];
+    line->daddr = daddr;
+    line->lun   = lun;
+    line->lba   = lba;
+    line->valid = false;
+    cache_touch(line);
+  }
+
+  return idx;
+}
+
+// release line once its transfer is complete, line may have been detached in the meantime
+static void cache_release(msch_cache_line_t* line, bool keep) {
+  line->busy = false;
+  if (line->daddr == 0 || !keep) {
+    tu_memclr(line, sizeof(msch_cache_line_t));
+  }
+}
+
+// complete a request served entirely from cache
+static bool cache_complete_now(uint8_t daddr, msc_cbw_t const* cbw, void* buffer,
+                               tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msc_csw_t const csw = {
+      .signature    = MSC_CSW_SIGNATURE,
+      .tag          = cbw->tag,
+      .data_residue = 0,
+      .status       = MSC_CSW_STATUS_PASSED
+  };
+
+  tuh_msc_complete_data_t const cb_data = {
+      .cbw = cbw,
+      .csw = &csw,
+      .scsi_data = buffer,
+      .user_arg = arg
+  };
+
+  if (complete_cb) {
+    complete_cb(daddr, &cb_data);
+  }
+  return true;
+}
+
+static bool cache_read_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  msch_cache_read_t* ctx = (msch_cache_read_t*) cb_data->user_arg;
+  uint8_t const lun = cb_data->cbw->lun;
+  bool const success = (cb_data->csw->status == MSC_CSW_STATUS_PASSED);
+  uint8_t* buf8 = (uint8_t*) ctx->buffer;
+
+  for (uint16_t i = 0; i < ctx->block_count; i++) {
+    uint8_t* blk = buf8 + i * CFG_TUH_MSC_CACHE_BLOCK_SIZE;
+    int idx = cache_find(daddr, lun, ctx->lba + i);
+
+    if (idx >= 0 && _msch_cache_line[idx].valid && (_msch_cache_line[idx].dirty || _msch_cache_line[idx].busy)) {
+      // cache holds data that is not written to device yet (or still being flushed)
+      memcpy(blk, _msch_cache_buf[idx], CFG_TUH_MSC_CACHE_BLOCK_SIZE);
+    } else if (success) {
+      if (idx < 0) {
+        idx = cache_alloc(daddr, lun, ctx->lba + i);
+      }
+      if (idx >= 0 && !_msch_cache_line[idx].busy) {
+        memcpy(_msch_cache_buf[idx], blk, CFG_TUH_MSC_CACHE_BLOCK_SIZE);
+        _msch_cache_line[idx].valid = true;
+        cache_touch(&_msch_cache_line[idx]);
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < ctx->ra_count; i++) {
+    msch_cache_line_t* line = &_msch_cache_line[ctx->ra_line[i]];
+    line->valid = success;
+    cache_release(line, success);
+  }
+
+  // report the command as requested by application
+  msc_cbw_t cbw;
+  read10_cbw_init(&cbw, daddr, lun, ctx->lba, ctx->block_count);
+
+  tuh_msc_complete_data_t const app_data = {
+      .cbw = &cbw,
+      .csw = cb_data->csw,
+      .scsi_data = ctx->buffer,
+      .user_arg = ctx->complete_arg
+  };
+
+  tuh_msc_complete_cb_t const complete_cb = ctx->complete_cb;
+  ctx->in_use = false;
+
+  if (complete_cb) {
+    complete_cb(daddr, &app_data);
+  }
+
+  return true;
+}
+
+static bool cache_read10(uint8_t daddr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count,
+                         tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  uint8_t* buf8 = (uint8_t*) buffer;
+
+  bool const sequential = (lun == p_msc->cache.last_lun && lba == p_msc->cache.next_lba);
+  p_msc->cache.last_lun = lun;
+  p_msc->cache.next_lba = lba + block_count;
+
+  // serve from cache if all blocks are present
+  bool hit = true;
+  for (uint16_t i = 0; i < block_count && hit; i++) {
+    int const idx = cache_find(daddr, lun, lba + i);
+    hit = (idx >= 0) && _msch_cache_line[idx].valid;
+  }
+
+  if (hit) {
+    for (uint16_t i = 0; i < block_count; i++) {
+      int const idx = cache_find(daddr, lun, lba + i);
+      memcpy(buf8 + i * CFG_TUH_MSC_CACHE_BLOCK_SIZE, _msch_cache_buf[idx], CFG_TUH_MSC_CACHE_BLOCK_SIZE);
+      cache_touch(&_msch_cache_line[idx]);
+    }
+
+    msc_cbw_t cbw;
+    read10_cbw_init(&cbw, daddr, lun, lba, block_count);
+    return cache_complete_now(daddr, &cbw, buffer, complete_cb, arg);
+  }
+
+  msch_cache_read_t* ctx = NULL;
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(p_msc->cache.read); i++) {
+    if (!p_msc->cache.read[i].in_use) {
+      ctx = &p_msc->cache.read[i];
+      break;
+    }
+  }
+  TU_VERIFY(ctx);
+
+  // sequential stream: fetch following blocks into cache lines within the same command
+  ctx->ra_count = 0;
+  if (sequential) {
+    uint32_t ra_lba = lba + block_count;
+    while (ctx->ra_count < CFG_TUH_MSC_CACHE_READAHEAD && ra_lba < p_msc->capacity[lun].block_count &&
+           (uint32_t) block_count + ctx->ra_count < UINT16_MAX && cache_find(daddr, lun, ra_lba) < 0) {
+      int const idx = cache_alloc(daddr, lun, ra_lba);
+      if (idx < 0) {
+        break;
+      }
+
+      _msch_cache_line[idx].busy = true;
+      ctx->ra_line[ctx->ra_count] = (uint8_t) idx;
+      ctx->sg[1 + ctx->ra_count].buffer = _msch_cache_buf[idx];
+      ctx->sg[1 + ctx->ra_count].len    = CFG_TUH_MSC_CACHE_BLOCK_SIZE;
+      ctx->ra_count++;
+      ra_lba++;
+    }
+  }
+
+  ctx->in_use       = true;
+  ctx->block_count  = block_count;
+  ctx->lba          = lba;
+  ctx->buffer       = buffer;
+  ctx->complete_cb  = complete_cb;
+  ctx->complete_arg = arg;
+  ctx->sg[0].buffer = buffer;
+  ctx->sg[0].len    = (uint32_t) block_count * CFG_TUH_MSC_CACHE_BLOCK_SIZE;
+
+  msc_cbw_t cbw;
+  read10_cbw_init(&cbw, daddr, lun, lba, (uint16_t) (block_count + ctx->ra_count));
+
+  if (!tuh_msc_scsi_command_sg(daddr, &cbw, ctx->sg, (uint8_t) (1 + ctx->ra_count), cache_read_complete, (uintptr_t) ctx)) {
+    for (uint8_t i = 0; i < ctx->ra_count; i++) {
+      cache_release(&_msch_cache_line[ctx->ra_line[i]], false);
+    }
+    ctx->in_use = false;
+    return false;
+  }
+
+  return true;
+}
+
+static bool cache_write10(uint8_t daddr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count,
+                          tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  uint8_t const* buf8 = (uint8_t const*) buffer;
+
+  // detach lines whose buffer is used by a transfer, they can not be modified
+  uint32_t need = 0;
+  for (uint16_t i = 0; i < block_count; i++) {
+    int const idx = cache_find(daddr, lun, lba + i);
+    if (idx >= 0 && _msch_cache_line[idx].busy) {
+      _msch_cache_line[idx].daddr = 0;
+      need++;
+    } else if (idx < 0) {
+      need++;
+    }
+  }
+
+  // lines that can be evicted for blocks not cached yet
+  uint32_t avail = 0;
+  for (uint8_t i = 0; i < CFG_TUH_MSC_CACHE_BLOCKS; i++) {
+    msch_cache_line_t const* line = &_msch_cache_line[i];
+    bool const in_range = (line->daddr == daddr && line->lun == lun && line->lba - lba < block_count);
+    if (!line->busy && !line->dirty && !in_range) {
+      avail++;
+    }
+  }
+
+  if (need <= avail) {
+    // write-back
+    for (uint16_t i = 0; i < block_count; i++) {
+      int idx = cache_find(daddr, lun, lba + i);
+      if (idx < 0) {
+        idx = cache_alloc(daddr, lun, lba + i);
+      }
+      TU_ASSERT(idx >= 0);
+
+      msch_cache_line_t* line = &_msch_cache_line[idx];
+      memcpy(_msch_cache_buf[idx], buf8 + i * CFG_TUH_MSC_CACHE_BLOCK_SIZE, CFG_TUH_MSC_CACHE_BLOCK_SIZE);
+      line->valid = true;
+      line->dirty = true;
+      cache_touch(line);
+    }
+
+    msc_cbw_t cbw;
+    write10_cbw_init(&cbw, daddr, lun, lba, block_count);
+    return cache_complete_now(daddr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
+  }
+
+  // write-through, cached blocks will match device once complete
+  for (uint16_t i = 0; i < block_count; i++) {
+    int const idx = cache_find(daddr, lun, lba + i);
+    if (idx >= 0) {
+      memcpy(_msch_cache_buf[idx], buf8 + i * CFG_TUH_MSC_CACHE_BLOCK_SIZE, CFG_TUH_MSC_CACHE_BLOCK_SIZE);
+      _msch_cache_line[idx].valid = true;
+      _msch_cache_line[idx].dirty = false;
+    }
+  }
+
+  msc_cbw_t cbw;
+  write10_cbw_init(&cbw, daddr, lun, lba, block_count);
+  TU_VERIFY(tuh_msc_scsi_command(daddr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg));
+
+  // make room for following writes
+  if (!get_itf(daddr)->cache.flush.active) {
+    (void) tuh_msc_cache_flush(daddr, NULL);
+  }
+
+  return true;
+}
+
+static bool cache_flush_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  bool success = (cb_data->csw->status == MSC_CSW_STATUS_PASSED);
+
+  for (uint8_t i = 0; i < p_msc->cache.flush.count; i++) {
+    msch_cache_line_t* line = &_msch_cache_line[p_msc->cache.flush.line[i]];
+    if (!success && line->daddr) {
+      line->dirty = true;
+    }
+    cache_release(line, true);
+  }
+
+  if (success) {
+    int const count = cache_flush_run(daddr);
+    if (count > 0) {
+      return true;
+    }
+    success = (count == 0);
+  }
+
+  p_msc->cache.flush.active = false;
+  if (p_msc->cache.flush.complete_cb) {
+    p_msc->cache.flush.complete_cb(daddr, success);
+  }
+
+  return true;
+}
+
+// write next run of adjacent dirty blocks, return number of blocks, 0 if nothing is dirty or -1 if failed
+static int cache_flush_run(uint8_t daddr) {
+  msch_interface_t* p_msc = get_itf(daddr);
+
+  // lowest dirty block is the start of a run
+  int first = -1;
+  for (int i = 0; i < CFG_TUH_MSC_CACHE_BLOCKS; i++) {
+    msch_cache_line_t const* line = &_msch_cache_line[i];
+    if (line->daddr != daddr || !line->dirty || line->busy) {
+      continue;
+    }
+
+    if (first < 0 || line->lun < _msch_cache_line[first].lun ||
+        (line->lun == _msch_cache_line[first].lun && line->lba < _msch_cache_line[first].lba)) {
+      first = i;
+    }
+  }
+
+  if (first < 0) {
+    return 0;
+  }
+
+  uint8_t const lun = _msch_cache_line[first].lun;
+  uint32_t const lba = _msch_cache_line[first].lba;
+
+  uint8_t count = 0;
+  int idx = first;
+  while (idx >= 0 && _msch_cache_line[idx].dirty && !_msch_cache_line[idx].busy) {
+    msch_cache_line_t* line = &_msch_cache_line[idx];
+    line->busy  = true;
+    line->dirty = false;
+
+    p_msc->cache.flush.line[count]      = (uint8_t) idx;
+    p_msc->cache.flush.sg[count].buffer = _msch_cache_buf[idx];
+    p_msc->cache.flush.sg[count].len    = CFG_TUH_MSC_CACHE_BLOCK_SIZE;
+    count++;
+
+    if (count == CFG_TUH_MSC_CACHE_BLOCKS) {
+      break;
+    }
+    idx = cache_find(daddr, lun, lba + count);
+  }
+  p_msc->cache.flush.count = count;
+
+  msc_cbw_t cbw;
+  if (!write10_cbw_init(&cbw, daddr, lun, lba, count) ||
+      !tuh_msc_scsi_command_sg(daddr, &cbw, p_msc->cache.flush.sg, count, cache_flush_complete, 0)) {
+    for (uint8_t i = 0; i < count; i++) {
+      msch_cache_line_t* line = &_msch_cache_line[p_msc->cache.flush.line[i]];
+      if (line->daddr) {
+        line->dirty = true;
+      }
+      cache_release(line, true);
+    }
+    p_msc->cache.flush.count = 0;
+    return -1;
+  }
+
+  return count;
+}
+
+bool tuh_msc_cache_flush(uint8_t dev_addr, tuh_msc_flush_cb_t complete_cb) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted && !p_msc->cache.flush.active);
+
+  p_msc->cache.flush.active = true;
+  p_msc->cache.flush.complete_cb = complete_cb;
+
+  int const count = cache_flush_run(dev_addr);
+  if (count > 0) {
+    return true;
+  }
+
+  p_msc->cache.flush.active = false;
+  TU_VERIFY(count == 0);
+
+  if (complete_cb) {
+    complete_cb(dev_addr, true);
+  }
+  return true;
+}
+
+// drop all cached blocks of a device
+static void cache_invalidate(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_MSC_CACHE_BLOCKS; i++) {
+    msch_cache_line_t* line = &_msch_cache_line[i];
+    if (line->daddr == daddr) {
+      if (line->dirty) {
+        TU_LOG_DRV("  MSCh discard dirty block lba = %lu\r\n", (unsigned long) line->lba);
+      }
+      tu_memclr(line, sizeof(msch_cache_line_t));
+    }
+  }
+}
+
+#endif
+
+bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count,
+                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+#if CFG_TUH_MSC_CACHE_BLOCKS
+  if (tuh_msc_mounted(dev_addr) && cache_usable(dev_addr, lun)) {
+    return cache_read10(dev_addr, lun, buffer, lba, block_count, complete_cb, arg);
+  }
+#endif
+
+  msc_cbw_t cbw;
+  TU_VERIFY(read10_cbw_init(&cbw, dev_addr, lun, lba, block_count));
+  return tuh_msc_scsi_command(dev_addr, &cbw, buffer, complete_cb, arg);
+}
+
+bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+#if CFG_TUH_MSC_CACHE_BLOCKS
+  if (tuh_msc_mounted(dev_addr) && cache_usable(dev_addr, lun)) {
+    return cache_write10(dev_addr, lun, buffer, lba, block_count, complete_cb, arg);
+  }
+#endif
 
+  msc_cbw_t cbw;
+  TU_VERIFY(write10_cbw_init(&cbw, dev_addr, lun, lba, block_count));
   return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
 }
 
+bool tuh_msc_read10_sg(uint8_t dev_addr, uint8_t lun, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                       uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msc_cbw_t cbw;
+  TU_VERIFY(read10_cbw_init(&cbw, dev_addr, lun, lba, block_count));
+  return tuh_msc_scsi_command_sg(dev_addr, &cbw, sg_list, sg_count, complete_cb, arg);
+}
+
+bool tuh_msc_write10_sg(uint8_t dev_addr, uint8_t lun, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                        uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msc_cbw_t cbw;
+  TU_VERIFY(write10_cbw_init(&cbw, dev_addr, lun, lba, block_count));
+  return tuh_msc_scsi_command_sg(dev_addr, &cbw, sg_list, sg_count, complete_cb, arg);
+}
+
+//--------------------------------------------------------------------+
+// Blocking API
+//--------------------------------------------------------------------+
+#if CFG_TUH_MSC_SYNC
+
+#define MSCH_SYNC_POLLING  (CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO)
+
+enum {
+  MSCH_SYNC_SCSI = 0,
+  MSCH_SYNC_READ10,
+  MSCH_SYNC_WRITE10,
+  MSCH_SYNC_FLUSH,
+};
+
+// one blocking command per device at a time, result is signalled from complete callback in usbh task
+typedef struct {
+#if !MSCH_SYNC_POLLING
+  osal_mutex_def_t     mutex_def;
+  osal_mutex_t         mutex;
+  osal_semaphore_def_t sem_def;
+  osal_semaphore_t     sem;
+#endif
+
+  volatile bool pending;
+  volatile bool success;
+
+  uint8_t  op;
+  uint8_t  lun;
+  uint16_t block_count;
+  uint32_t lba;
+  void*    buffer;
+  msc_cbw_t cbw;
+} msch_sync_t;
+
+static msch_sync_t _msch_sync[CFG_TUH_DEVICE_MAX];
+
+static void sync_init(void) {
+  tu_memclr(_msch_sync, sizeof(_msch_sync));
+#if !MSCH_SYNC_POLLING
+  for (uint8_t i = 0; i < CFG_TUH_DEVICE_MAX; i++) {
+    _msch_sync[i].mutex = osal_mutex_create(&_msch_sync[i].mutex_def);
+    _msch_sync[i].sem   = osal_semaphore_create(&_msch_sync[i].sem_def);
+  }
+#endif
+}
+
+// complete blocking command of a device, also when it is unplugged meanwhile
+static void sync_done(uint8_t daddr, bool success) {
+  msch_sync_t* s = &_msch_sync[daddr - 1];
+  if (!s->pending) {
+    return;
+  }
+
+  s->success = success;
+  s->pending = false;
+#if !MSCH_SYNC_POLLING
+  (void) osal_semaphore_post(s->sem, false);
+#endif
+}
+
+static bool sync_complete_cb(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  sync_done(daddr, cb_data->csw->status == MSC_CSW_STATUS_PASSED);
+  return true;
+}
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+static void sync_flush_cb(uint8_t daddr, bool success) {
+  sync_done(daddr, success);
+}
+#endif
+
+// submit blocking command in usbh task context
+static void sync_submit(void* param) {
+  msch_sync_t* s = (msch_sync_t*) param;
+  uint8_t const daddr = (uint8_t) (s - _msch_sync + 1);
+  bool ret = false;
+
+  switch (s->op) {
+    case MSCH_SYNC_SCSI:
+      ret = tuh_msc_scsi_command(daddr, &s->cbw, s->buffer, sync_complete_cb, 0);
+      break;
+
+    case MSCH_SYNC_READ10:
+      ret = tuh_msc_read10(daddr, s->lun, s->buffer, s->lba, s->block_count, sync_complete_cb, 0);
+      break;
+
+    case MSCH_SYNC_WRITE10:
+      ret = tuh_msc_write10(daddr, s->lun, s->buffer, s->lba, s->block_count, sync_complete_cb, 0);
+      break;
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+    case MSCH_SYNC_FLUSH:
+      ret = tuh_msc_cache_flush(daddr, sync_flush_cb);
+      break;
+#endif
+
+    default: break;
+  }
+
+  if (!ret) {
+    sync_done(daddr, false);
+  }
+}
+
+static bool sync_run(uint8_t daddr, msch_sync_t* s) {
+  s->success = false;
+  s->pending = true;
+
+#if MSCH_SYNC_POLLING
+  // Note: can be called within a callback i.e part of tuh_task(), therefore tuh_task() is invoked here
+  sync_submit(s);
+  while (s->pending) {
+    if (tuh_task_event_ready()) {
+      tuh_task();
+    }
+  }
+  (void) daddr;
+#else
+  // command queue of msc driver is only accessed in usbh task
+  osal_semaphore_reset(s->sem);
+  usbh_defer_func(sync_submit, s, false);
+  (void) osal_semaphore_wait(s->sem, OSAL_TIMEOUT_WAIT_FOREVER);
+  (void) daddr;
+#endif
+
+  bool const success = s->success;
+
+#if !MSCH_SYNC_POLLING
+  (void) osal_mutex_unlock(s->mutex);
+#endif
+
+  return success;
+}
+
+// lock blocking context of a device, released by sync_run()
+static msch_sync_t* sync_acquire(uint8_t daddr) {
+  TU_VERIFY(daddr > 0 && daddr <= CFG_TUH_DEVICE_MAX && tuh_msc_mounted(daddr), NULL);
+  msch_sync_t* s = &_msch_sync[daddr - 1];
+
+#if !MSCH_SYNC_POLLING
+  (void) osal_mutex_lock(s->mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+#endif
+
+  return s;
+}
+
+bool tuh_msc_scsi_command_sync(uint8_t daddr, msc_cbw_t const* cbw, void* data) {
+  msch_sync_t* s = sync_acquire(daddr);
+  TU_VERIFY(s);
+
+  s->op     = MSCH_SYNC_SCSI;
+  s->cbw    = *cbw;
+  s->buffer = data;
+
+  return sync_run(daddr, s);
+}
+
+bool tuh_msc_read10_sync(uint8_t daddr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count) {
+  msch_sync_t* s = sync_acquire(daddr);
+  TU_VERIFY(s);
+
+  s->op          = MSCH_SYNC_READ10;
+  s->lun         = lun;
+  s->buffer      = buffer;
+  s->lba         = lba;
+  s->block_count = block_count;
+
+  return sync_run(daddr, s);
+}
+
+bool tuh_msc_write10_sync(uint8_t daddr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count) {
+  msch_sync_t* s = sync_acquire(daddr);
+  TU_VERIFY(s);
+
+  s->op          = MSCH_SYNC_WRITE10;
+  s->lun         = lun;
+  s->buffer      = (void*) (uintptr_t) buffer;
+  s->lba         = lba;
+  s->block_count = block_count;
+
+  return sync_run(daddr, s);
+}
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+bool tuh_msc_cache_flush_sync(uint8_t daddr) {
+  msch_sync_t* s = sync_acquire(daddr);
+  TU_VERIFY(s);
+
+  s->op = MSCH_SYNC_FLUSH;
+
+  return sync_run(daddr, s);
+}
+#endif
+
+#endif
+
 #if 0
 // MSC interface Reset (not used now)
 bool tuh_msc_reset(uint8_t dev_addr) {
@@ -286,6 +1081,12 @@ bool tuh_msc_reset(uint8_t dev_addr) {
 //--------------------------------------------------------------------+
 void msch_init(void) {
   tu_memclr(_msch_itf, sizeof(_msch_itf));
+#if CFG_TUH_MSC_CACHE_BLOCKS
+  tu_memclr(_msch_cache_line, sizeof(_msch_cache_line));
+#endif
+#if CFG_TUH_MSC_SYNC
+  sync_init();
+#endif
 }
 
 void msch_close(uint8_t dev_addr) {
@@ -300,9 +1101,58 @@ void msch_close(uint8_t dev_addr) {
     if (tuh_msc_umount_cb) tuh_msc_umount_cb(dev_addr);
   }
 
+#if CFG_TUH_MSC_CACHE_BLOCKS
+  // device is gone, un-flushed writes are lost
+  cache_invalidate(dev_addr);
+#endif
+
+#if CFG_TUH_MSC_SYNC
+  // pending commands are dropped, wake up blocking caller
+  sync_done(dev_addr, false);
+#endif
+
   tu_memclr(p_msc, sizeof(msch_interface_t));
 }
 
+// queue next data stage chunk, return false if there is nothing left to transfer
+static bool data_stage_xfer_next(uint8_t dev_addr, msch_interface_t* p_msc) {
+  msc_cbw_t const * cbw = &p_msc->cbw;
+
+  uint32_t const remaining = cbw->total_bytes - p_msc->data_xferred;
+  if (remaining == 0) {
+    return false;
+  }
+
+  // current segment: either the single buffer or scatter-gather entry
+  uint8_t* seg_buf;
+  uint32_t seg_len;
+  if (p_msc->sg_list) {
+    // skip empty or fully consumed entries
+    while (p_msc->sg_idx < p_msc->sg_count && p_msc->sg_offset >= p_msc->sg_list[p_msc->sg_idx].len) {
+      p_msc->sg_idx++;
+      p_msc->sg_offset = 0;
+    }
+    if (p_msc->sg_idx >= p_msc->sg_count) {
+      return false;
+    }
+
+    seg_buf = (uint8_t*) p_msc->sg_list[p_msc->sg_idx].buffer;
+    seg_len = p_msc->sg_list[p_msc->sg_idx].len;
+  } else {
+    seg_buf = (uint8_t*) p_msc->buffer;
+    seg_len = cbw->total_bytes;
+  }
+
+  uint32_t len = tu_min32(seg_len - p_msc->sg_offset, remaining);
+  len = tu_min32(len, CFG_TUH_MSC_XFER_MAX);
+  p_msc->data_chunk = (uint16_t) len;
+
+  uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
+  TU_ASSERT(usbh_edpt_xfer(dev_addr, ep_data, seg_buf + p_msc->sg_offset, p_msc->data_chunk));
+
+  return true;
+}
+
 bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   msc_cbw_t const * cbw = &p_msc->cbw;
@@ -313,11 +1163,14 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
       // Must be Command Block
       TU_ASSERT(ep_addr == p_msc->ep_out && event == XFER_RESULT_SUCCESS && xferred_bytes == sizeof(msc_cbw_t));
 
+      p_msc->sg_idx       = 0;
+      p_msc->sg_offset    = 0;
+      p_msc->data_xferred = 0;
+
       if (cbw->total_bytes && p_msc->buffer) {
         // Data stage if any
         p_msc->stage = MSC_STAGE_DATA;
-        uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
-        TU_ASSERT(usbh_edpt_xfer(dev_addr, ep_data, p_msc->buffer, (uint16_t) cbw->total_bytes));
+        TU_ASSERT(data_stage_xfer_next(dev_addr, p_msc));
       } else {
         // Status stage
         p_msc->stage = MSC_STAGE_STATUS;
@@ -326,25 +1179,50 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
       break;
 
     case MSC_STAGE_DATA:
+      p_msc->data_xferred += xferred_bytes;
+      p_msc->sg_offset    += xferred_bytes;
+
+      // continue with next chunk unless device ended data stage early with a short packet
+      if (event == XFER_RESULT_SUCCESS && xferred_bytes == p_msc->data_chunk && data_stage_xfer_next(dev_addr, p_msc)) {
+        break;
+      }
+
       // Status stage
       p_msc->stage = MSC_STAGE_STATUS;
       TU_ASSERT(usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) &p_msc->csw, (uint16_t) sizeof(msc_csw_t)));
       break;
 
-    case MSC_STAGE_STATUS:
+    case MSC_STAGE_STATUS: {
       // SCSI op is complete
       p_msc->stage = MSC_STAGE_IDLE;
 
-      if (p_msc->complete_cb) {
-        tuh_msc_complete_data_t const cb_data = {
-            .cbw = cbw,
-            .csw = csw,
-            .scsi_data = p_msc->buffer,
-            .user_arg = p_msc->complete_arg
-        };
-        p_msc->complete_cb(dev_addr, &cb_data);
+      tuh_msc_complete_cb_t const complete_cb = p_msc->complete_cb;
+#if CFG_TUH_MSC_QUEUE_DEPTH
+      // keep a copy of completed command, then start next one right away without waiting for application
+      msc_cbw_t const cbw_done = *cbw;
+      msc_csw_t const csw_done = *csw;
+      tuh_msc_complete_data_t const cb_data = {
+          .cbw = &cbw_done,
+          .csw = &csw_done,
+          .scsi_data = p_msc->buffer,
+          .user_arg = p_msc->complete_arg
+      };
+
+      scsi_command_start_next(dev_addr, p_msc);
+#else
+      tuh_msc_complete_data_t const cb_data = {
+          .cbw = cbw,
+          .csw = csw,
+          .scsi_data = p_msc->buffer,
+          .user_arg = p_msc->complete_arg
+      };
+#endif
+
+      if (complete_cb) {
+        complete_cb(dev_addr, &cb_data);
       }
       break;
+    }
 
       // unknown state
     default:
@@ -373,10 +1251,10 @@ bool msch_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* de
   TU_ASSERT(drv_len <= max_len);
 
   msch_interface_t* p_msc = get_itf(dev_addr);
-  tusb_desc_endpoint_t const* ep_desc = (tusb_desc_endpoint_t const*) tu_desc_next(desc_itf);
 
-  for (uint32_t i = 0; i < 2; i++) {
-    TU_ASSERT(TUSB_DESC_ENDPOINT == ep_desc->bDescriptorType && TUSB_XFER_BULK == ep_desc->bmAttributes.xfer);
+  for (uint8_t i = 0; i < 2; i++) {
+    tusb_desc_endpoint_t const* ep_desc = usbh_desc_itf_edpt(desc_itf, i);
+    TU_ASSERT(ep_desc && TUSB_XFER_BULK == ep_desc->bmAttributes.xfer);
     TU_ASSERT(tuh_edpt_open(dev_addr, ep_desc));
 
     if (TUSB_DIR_IN == tu_edpt_dir(ep_desc->bEndpointAddress)) {
@@ -384,8 +1262,6 @@ bool msch_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* de
     } else {
       p_msc->ep_out = ep_desc->bEndpointAddress;
     }
-
-    ep_desc = (tusb_desc_endpoint_t const*) tu_desc_next(ep_desc);
   }
 
   p_msc->itf_num = desc_itf->bInterfaceNumber;
@@ -41,6 +41,52 @@
 #define CFG_TUH_MSC_MAXLUN  4
 #endif
 
+// Number of SCSI commands per device that can be queued while another one is in progress.
+// Queued commands are started from the driver right after the previous CSW is received, each completes
+// with its own callback. 0 means tuh_msc_scsi_command() and friends fail when the interface is busy.
+#ifndef CFG_TUH_MSC_QUEUE_DEPTH
+#define CFG_TUH_MSC_QUEUE_DEPTH  0
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_MSC_QUEUE_DEPTH < 256, "Queue depth is not correct");
+
+// Max bytes per bulk transfer in data stage, larger data is split into chained transfers within one CBW.
+// Must be multiple of endpoint packet size, default is largest multiple of 512 that fits uint16_t.
+#ifndef CFG_TUH_MSC_XFER_MAX
+#define CFG_TUH_MSC_XFER_MAX  (UINT16_MAX - 511)
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_MSC_XFER_MAX > 0 && CFG_TUH_MSC_XFER_MAX <= UINT16_MAX, "Transfer size is not correct");
+
+// Number of blocks in optional block cache shared by all devices, placed underneath tuh_msc_read10() and
+// tuh_msc_write10(). Only used for LUNs whose block size is CFG_TUH_MSC_CACHE_BLOCK_SIZE.
+// - Reads fully served from cache and cached writes complete before the function returns
+// - Sequential reads also fetch next CFG_TUH_MSC_CACHE_READAHEAD blocks into cache within the same READ10
+// - Writes are kept in cache (write-back) and only written to device by tuh_msc_cache_flush(), adjacent blocks
+//   are coalesced into one WRITE10. Writes that do not fit are written through and start a flush.
+#ifndef CFG_TUH_MSC_CACHE_BLOCKS
+#define CFG_TUH_MSC_CACHE_BLOCKS  0
+#endif
+
+#ifndef CFG_TUH_MSC_CACHE_BLOCK_SIZE
+#define CFG_TUH_MSC_CACHE_BLOCK_SIZE  512
+#endif
+
+#ifndef CFG_TUH_MSC_CACHE_READAHEAD
+#define CFG_TUH_MSC_CACHE_READAHEAD  ((CFG_TUH_MSC_CACHE_BLOCKS + 3) / 4)
+#endif
+
+// Enable blocking API e.g tuh_msc_read10_sync() for file systems such as FatFs diskio
+#ifndef CFG_TUH_MSC_SYNC
+#define CFG_TUH_MSC_SYNC  0
+#endif
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+TU_VERIFY_STATIC(CFG_TUH_MSC_CACHE_BLOCKS < 256, "Cache size is not correct");
+TU_VERIFY_STATIC(CFG_TUH_MSC_CACHE_READAHEAD > 0 && CFG_TUH_MSC_CACHE_READAHEAD <= CFG_TUH_MSC_CACHE_BLOCKS,
+                 "Read-ahead size is not correct");
+#endif
+
 typedef struct {
   msc_cbw_t const* cbw; // SCSI command
   msc_csw_t const* csw; // SCSI status
@@ -48,8 +94,16 @@ typedef struct {
   uintptr_t user_arg;   // user argument
 }tuh_msc_complete_data_t;
 
+// Scatter-gather entry for data stage
+typedef struct {
+  void* buffer;
+  uint32_t len;
+} tuh_msc_sg_t;
+
 typedef bool (*tuh_msc_complete_cb_t)(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 
+typedef void (*tuh_msc_flush_cb_t)(uint8_t dev_addr, bool success);
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -72,9 +126,16 @@ uint32_t tuh_msc_get_block_size(uint8_t dev_addr, uint8_t lun);
 
 // Perform a full SCSI command (cbw, data, csw) in non-blocking manner.
 // Complete callback is invoked when SCSI op is complete.
-// return true if success, false if there is already pending operation.
+// return true if success, false if there is already pending operation and CFG_TUH_MSC_QUEUE_DEPTH is 0
+// or the command queue is full.
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Same as tuh_msc_scsi_command() but data stage is scattered/gathered across a list of buffers. Length of
+// each entry except the last one should be multiple of endpoint packet size (e.g block size). The list must
+// stay valid until complete callback, scsi_data in callback is the first entry's buffer.
+bool tuh_msc_scsi_command_sg(uint8_t daddr, msc_cbw_t const* cbw, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 // Perform SCSI Inquiry command
 // Complete callback is invoked when SCSI op is complete.
 bool tuh_msc_inquiry(uint8_t dev_addr, uint8_t lun, scsi_inquiry_resp_t* response, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
@@ -95,12 +156,43 @@ bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void * buffer, uint32_t lba,
 // Complete callback is invoked when SCSI op is complete.
 bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const * buffer, uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read 10 command with scatter-gather list, see tuh_msc_scsi_command_sg()
+bool tuh_msc_read10_sg(uint8_t dev_addr, uint8_t lun, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                       uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
+// Perform SCSI Write 10 command with scatter-gather list, see tuh_msc_scsi_command_sg()
+bool tuh_msc_write10_sg(uint8_t dev_addr, uint8_t lun, tuh_msc_sg_t const* sg_list, uint8_t sg_count,
+                        uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 // Perform SCSI Read Capacity 10 command
 // Complete callback is invoked when SCSI op is complete.
 // Note: during enumeration, host stack already carried out this request. Application can retrieve capacity by
 // simply call tuh_msc_get_block_count() and tuh_msc_get_block_size()
 bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_resp_t* response, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+#if CFG_TUH_MSC_CACHE_BLOCKS
+// Write all dirty cached blocks of device with WRITE10, complete callback is invoked when done (before
+// returning if there is nothing to write). Application must flush before removing the device, cached writes
+// can only be discarded once it is unplugged.
+bool tuh_msc_cache_flush(uint8_t dev_addr, tuh_msc_flush_cb_t complete_cb);
+#endif
+
+#if CFG_TUH_MSC_SYNC
+//------------- Blocking API -------------//
+// Blocking versions of above functions, return true if command is completed with passed status (CSW).
+// With RTOS, command is submitted from tuh_task() and caller waits on a semaphore posted by the complete callback,
+// therefore it can be called from any task other than the one running tuh_task(). Without RTOS, tuh_task() is
+// invoked until it completes. Commands of a device are executed one at a time, blocking calls from multiple tasks
+// wait for each other while async ones are queued: set CFG_TUH_MSC_QUEUE_DEPTH if both are mixed.
+bool tuh_msc_scsi_command_sync(uint8_t daddr, msc_cbw_t const* cbw, void* data);
+bool tuh_msc_read10_sync(uint8_t daddr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count);
+bool tuh_msc_write10_sync(uint8_t daddr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count);
+
+#if CFG_TUH_MSC_CACHE_BLOCKS
+bool tuh_msc_cache_flush_sync(uint8_t daddr);
+#endif
+#endif
+
 //------------- Application Callback -------------//
 
 // Invoked when a device with MassStorage interface is mounted
@@ -0,0 +1,991 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUD_ENABLED && CFG_TUD_MSC_UAS)
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+
+#include "uas_device.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUD_MSC_LOG_LEVEL
+  #define CFG_TUD_MSC_LOG_LEVEL   CFG_TUD_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUD_MSC_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+#define UASD_NO_CMD   0xFFu
+
+enum
+{
+  UAS_CMD_FREE = 0,
+  UAS_CMD_QUEUED,      // received, waiting to be executed
+  UAS_CMD_READY,       // data phase is prepared, READ READY/WRITE READY IU is not sent yet
+  UAS_CMD_DATA,        // data phase in progress
+  UAS_CMD_STATUS,      // completed, Sense IU is not sent yet
+  UAS_CMD_STATUS_SENT, // Sense IU is on status pipe
+};
+
+typedef struct
+{
+  uint8_t  state;
+  uint8_t  lun;
+  uint8_t  attr;
+  uint8_t  scsi_status;
+
+  uint16_t tag;
+  uint16_t block_size;  // READ/WRITE only
+
+  uint32_t seq;         // arrival order
+  uint32_t total_len;
+  uint32_t xferred_len;
+
+  uint8_t  cdb[16];
+  uint8_t  sense[18];   // fixed sense data, captured when completed with CHECK CONDITION
+}uasd_cmd_t;
+
+typedef struct
+{
+  uint8_t rhport;
+  uint8_t itf_num;
+  uint8_t ep_cmd;
+  uint8_t ep_status;
+  uint8_t ep_data_in;
+  uint8_t ep_data_out;
+
+  uint8_t active;        // command owning data pipes and data buffer
+  uint8_t status_cmd;    // command whose IU is on status pipe, UASD_NO_CMD for Response IU
+  bool    status_busy;
+
+  uint32_t seq;
+
+  // WRITE: data received into buffer, buf_pos is what application already consumed
+  uint32_t buf_len;
+  uint32_t buf_pos;
+
+  // Response IU for task management or rejected IU
+  bool     resp_pending;
+  uint8_t  resp_code;
+  uint16_t resp_tag;
+
+  uasd_cmd_t cmd[CFG_TUD_MSC_UAS_QUEUE_DEPTH];
+}uasd_interface_t;
+
+typedef union
+{
+  uas_iu_command_t   command;
+  uas_iu_task_mgmt_t task_mgmt;
+}uasd_cmd_iu_t;
+
+typedef union
+{
+  uas_iu_sense_t    sense;
+  uas_iu_response_t response;
+  uas_iu_ready_t    ready;
+}uasd_status_iu_t;
+
+typedef struct {
+  TUD_EPBUF_TYPE_DEF(uasd_cmd_iu_t, cmd_iu);
+  TUD_EPBUF_TYPE_DEF(uasd_status_iu_t, status_iu);
+  TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE);
+} uasd_epbuf_t;
+
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uasd_interface_t _uasd_itf;
+CFG_TUD_MEM_SECTION tu_static uasd_epbuf_t _uasd_epbuf;
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+static void proc_read(uint8_t rhport, uasd_interface_t* p_uas);
+static void proc_write_consume(uint8_t rhport, uasd_interface_t* p_uas);
+static void schedule(uint8_t rhport, uasd_interface_t* p_uas);
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_read_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_READ_10) || (cmd == SCSI_CMD_READ_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_write_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_WRITE_10) || (cmd == SCSI_CMD_WRITE_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_rdwr_cmd(uint8_t cmd)
+{
+  return is_read_cmd(cmd) || is_write_cmd(cmd);
+}
+
+// sequence number comparison, robust to wrap around
+TU_ATTR_ALWAYS_INLINE static inline bool seq_before(uint32_t a, uint32_t b)
+{
+  return ((int32_t) (a - b)) < 0;
+}
+
+static uint64_t cdb_get_lba(uint8_t const cdb[16])
+{
+  // lba is in Big Endian
+  if ( (cdb[0] == SCSI_CMD_READ_16) || (cdb[0] == SCSI_CMD_WRITE_16) )
+  {
+    uint32_t const lba_hi = tu_unaligned_read32(cdb + offsetof(scsi_read16_t, lba));
+    uint32_t const lba_lo = tu_unaligned_read32(cdb + offsetof(scsi_read16_t, lba) + 4);
+    return (((uint64_t) tu_ntohl(lba_hi)) << 32) | tu_ntohl(lba_lo);
+  }
+
+  return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read10_t, lba)));
+}
+
+static uint32_t cdb_get_blockcount(uint8_t const cdb[16])
+{
+  if ( (cdb[0] == SCSI_CMD_READ_16) || (cdb[0] == SCSI_CMD_WRITE_16) )
+  {
+    return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read16_t, block_count)));
+  }
+
+  return tu_ntohs(tu_unaligned_read16(cdb + offsetof(scsi_read10_t, block_count)));
+}
+
+// UAS Command IU does not carry transfer length (unlike CBW), use allocation length of the CDB instead.
+// Its location is determined by the CDB group code
+static uint32_t cdb_get_alloc_length(uint8_t const cdb[16])
+{
+  switch ( cdb[0] )
+  {
+    case SCSI_CMD_READ_CAPACITY_10: return sizeof(scsi_read_capacity10_resp_t);
+    case SCSI_CMD_INQUIRY         : return tu_ntohs(tu_unaligned_read16(cdb + 3));
+    default: break;
+  }
+
+  switch ( cdb[0] >> 5 )
+  {
+    case 0 : return cdb[4];                                       // 6-byte CDB
+    case 1 :
+    case 2 : return tu_ntohs(tu_unaligned_read16(cdb + 7));       // 10-byte CDB
+    case 4 : return tu_ntohl(tu_unaligned_read32(cdb + 10));      // 16-byte CDB
+    case 5 : return tu_ntohl(tu_unaligned_read32(cdb + 6));       // 12-byte CDB
+    default: return 0;
+  }
+}
+
+// Non READ/WRITE command that carries a parameter list in data-out, which is not supported yet: it must be failed
+// instead of running as a data-in command, otherwise host's data-out would never be taken
+static bool is_param_out_cmd(uint8_t const cdb[16])
+{
+  switch ( cdb[0] )
+  {
+    case SCSI_CMD_MODE_SELECT_6  : return cdb[4] != 0;
+    case SCSI_CMD_MODE_SELECT_10 : return tu_unaligned_read16(cdb + 7) != 0;
+    case SCSI_CMD_SEND_DIAGNOSTIC: return tu_unaligned_read16(cdb + 3) != 0;
+    case SCSI_CMD_WRITE_BUFFER   : return (cdb[6] | cdb[7] | cdb[8]) != 0;
+    case SCSI_CMD_UNMAP          : return tu_unaligned_read16(cdb + 7) != 0;
+    case SCSI_CMD_WRITE_SAME_10  : return true;
+    case SCSI_CMD_WRITE_SAME_16  : return (cdb[1] & 0x01u) == 0; // no NDOB bit
+    default: return false;
+  }
+}
+
+static uint8_t get_maxlun(void)
+{
+  return tud_msc_get_maxlun_cb ? tud_msc_get_maxlun_cb() : 1;
+}
+
+static uint8_t find_cmd(uasd_interface_t const* p_uas, uint16_t tag)
+{
+  for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+  {
+    if ( (p_uas->cmd[i].state != UAS_CMD_FREE) && (p_uas->cmd[i].tag == tag) ) return i;
+  }
+  return UASD_NO_CMD;
+}
+
+static uint8_t find_state(uasd_interface_t const* p_uas, uint8_t state)
+{
+  for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+  {
+    if ( p_uas->cmd[i].state == state ) return i;
+  }
+  return UASD_NO_CMD;
+}
+
+static inline bool prepare_cmd_iu(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  return usbd_edpt_xfer(rhport, p_uas->ep_cmd, (uint8_t*) &_uasd_epbuf.cmd_iu, sizeof(uas_iu_command_t));
+}
+
+static bool send_status_iu(uint8_t rhport, uasd_interface_t* p_uas, uint8_t cmd_idx, uint16_t len)
+{
+  p_uas->status_busy = true;
+  p_uas->status_cmd  = cmd_idx;
+  return usbd_edpt_xfer(rhport, p_uas->ep_status, (uint8_t*) &_uasd_epbuf.status_iu, len);
+}
+
+static void complete_cmd(uasd_interface_t* p_uas, uint8_t idx, uint8_t scsi_status)
+{
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  p_cmd->scsi_status = scsi_status;
+
+  if ( scsi_status == SCSI_STATUS_CHECK_CONDITION )
+  {
+    // failed but sense key is not set: default to Illegal Request
+    if ( mscd_sense_key(p_cmd->lun) == 0 ) tud_msc_set_sense(p_cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+
+    // Sense data is returned with Sense IU instead of REQUEST SENSE: capture it now, this also clears sense
+    uint8_t const req_sense[16] = { SCSI_CMD_REQUEST_SENSE, 0, 0, 0, sizeof(p_cmd->sense), 0 };
+    tu_memclr(p_cmd->sense, sizeof(p_cmd->sense));
+    (void) mscd_builtin_scsi(p_cmd->lun, req_sense, p_cmd->sense, sizeof(p_cmd->sense));
+  }
+
+  p_cmd->state = UAS_CMD_STATUS;
+  if ( p_uas->active == idx ) p_uas->active = UASD_NO_CMD;
+}
+
+// abort command that has not started its data phase yet
+static bool abort_cmd(uasd_interface_t* p_uas, uint8_t idx)
+{
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  switch ( p_cmd->state )
+  {
+    case UAS_CMD_QUEUED:
+    case UAS_CMD_READY:
+    case UAS_CMD_STATUS:
+      if ( p_uas->active == idx ) p_uas->active = UASD_NO_CMD;
+      p_cmd->state = UAS_CMD_FREE;
+      return true;
+
+    case UAS_CMD_STATUS_SENT:
+      // already completed, slot is released when Sense IU is sent
+      return true;
+
+    default: return false;
+  }
+}
+
+static void retry_func(void* param)
+{
+  (void) param;
+
+  uasd_interface_t* p_uas = &_uasd_itf;
+  uint8_t const rhport = p_uas->rhport;
+
+  // command is aborted or bus is reset while waiting
+  if ( (p_uas->active == UASD_NO_CMD) || (p_uas->cmd[p_uas->active].state != UAS_CMD_DATA) ) return;
+
+  if ( is_read_cmd(p_uas->cmd[p_uas->active].cdb[0]) )
+  {
+    proc_read(rhport, p_uas);
+  }else
+  {
+    proc_write_consume(rhport, p_uas);
+  }
+
+  schedule(rhport, p_uas);
+}
+
+// application is not ready, invoke read/write callback again later
+static inline void defer_retry(void)
+{
+  usbd_defer_func(retry_func, NULL, false);
+}
+
+//--------------------------------------------------------------------+
+// USBD Driver API
+//--------------------------------------------------------------------+
+void uasd_init(void)
+{
+  tu_memclr(&_uasd_itf, sizeof(uasd_interface_t));
+  _uasd_itf.active     = UASD_NO_CMD;
+  _uasd_itf.status_cmd = UASD_NO_CMD;
+}
+
+void uasd_reset(uint8_t rhport)
+{
+  (void) rhport;
+  uasd_init();
+}
+
+uint16_t uasd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
+{
+  TU_VERIFY(TUSB_CLASS_MSC    == itf_desc->bInterfaceClass &&
+            MSC_SUBCLASS_SCSI == itf_desc->bInterfaceSubClass &&
+            MSC_PROTOCOL_UAS  == itf_desc->bInterfaceProtocol, 0);
+
+  TU_ASSERT(itf_desc->bNumEndpoints == 4, 0);
+
+  uasd_interface_t* p_uas = &_uasd_itf;
+  p_uas->rhport  = rhport;
+  p_uas->itf_num = itf_desc->bInterfaceNumber;
+
+  uint8_t const* p_desc   = tu_desc_next(itf_desc);
+  uint8_t const* desc_end = ((uint8_t const*) itf_desc) + max_len;
+  uint8_t ep_addr = 0;
+
+  // Each endpoint is followed by Pipe Usage descriptor (after SS Endpoint Companion if any)
+  while ( (p_desc < desc_end) && (tu_desc_type(p_desc) != TUSB_DESC_INTERFACE) )
+  {
+    if ( tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT )
+    {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer, 0);
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+      ep_addr = desc_ep->bEndpointAddress;
+    }
+    else if ( (tu_desc_type(p_desc) == UAS_DESC_TYPE_PIPE_USAGE) && ep_addr )
+    {
+      switch ( p_desc[2] )
+      {
+        case UAS_PIPE_ID_COMMAND : p_uas->ep_cmd      = ep_addr; break;
+        case UAS_PIPE_ID_STATUS  : p_uas->ep_status   = ep_addr; break;
+        case UAS_PIPE_ID_DATA_IN : p_uas->ep_data_in  = ep_addr; break;
+        case UAS_PIPE_ID_DATA_OUT: p_uas->ep_data_out = ep_addr; break;
+        default: break;
+      }
+      ep_addr = 0;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_uas->ep_cmd && p_uas->ep_status && p_uas->ep_data_in && p_uas->ep_data_out, 0);
+
+  uint16_t const drv_len = (uint16_t) (p_desc - (uint8_t const*) itf_desc);
+
+  // Prepare for Command IU
+  TU_ASSERT( prepare_cmd_iu(rhport, p_uas), drv_len );
+
+  return drv_len;
+}
+
+// UAS does not define any class specific request
+bool uasd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  (void) rhport;
+  (void) stage;
+  (void) request;
+
+  return false;
+}
+
+//--------------------------------------------------------------------+
+// Command Pipe
+//--------------------------------------------------------------------+
+static uint8_t proc_task_mgmt(uasd_interface_t* p_uas, uas_iu_task_mgmt_t const* iu)
+{
+  uint8_t const lun = iu->lun[1];
+
+  TU_LOG_DRV("  UAS Task Management 0x%02X\r\n", iu->function);
+
+  switch ( iu->function )
+  {
+    case UAS_TMF_ABORT_TASK:
+    {
+      uint8_t const idx = find_cmd(p_uas, tu_ntohs(iu->task_tag));
+      if ( idx == UASD_NO_CMD ) return UAS_RESPONSE_TMF_COMPLETE;
+      return abort_cmd(p_uas, idx) ? UAS_RESPONSE_TMF_COMPLETE : UAS_RESPONSE_TMF_FAILED;
+    }
+
+    case UAS_TMF_ABORT_TASK_SET:
+    case UAS_TMF_CLEAR_TASK_SET:
+    case UAS_TMF_LOGICAL_UNIT_RESET:
+    case UAS_TMF_IT_NEXUS_RESET:
+    {
+      bool all_aborted = true;
+
+      for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+      {
+        uasd_cmd_t const* p_cmd = &p_uas->cmd[i];
+        if ( (p_cmd->state != UAS_CMD_FREE) && ((iu->function == UAS_TMF_IT_NEXUS_RESET) || (p_cmd->lun == lun)) )
+        {
+          if ( !abort_cmd(p_uas, i) ) all_aborted = false;
+        }
+      }
+
+      if ( (iu->function == UAS_TMF_LOGICAL_UNIT_RESET) || (iu->function == UAS_TMF_IT_NEXUS_RESET) )
+      {
+        tud_msc_set_sense(lun, 0, 0, 0);
+      }
+
+      return all_aborted ? UAS_RESPONSE_TMF_COMPLETE : UAS_RESPONSE_TMF_FAILED;
+    }
+
+    case UAS_TMF_QUERY_TASK:
+      return (find_cmd(p_uas, tu_ntohs(iu->task_tag)) != UASD_NO_CMD) ? UAS_RESPONSE_TMF_SUCCEEDED : UAS_RESPONSE_TMF_COMPLETE;
+
+    case UAS_TMF_QUERY_TASK_SET:
+      for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+      {
+        if ( (p_uas->cmd[i].state != UAS_CMD_FREE) && (p_uas->cmd[i].lun == lun) ) return UAS_RESPONSE_TMF_SUCCEEDED;
+      }
+      return UAS_RESPONSE_TMF_COMPLETE;
+
+    default: return UAS_RESPONSE_TMF_NOT_SUPPORTED;
+  }
+}
+
+static void proc_cmd_iu(uasd_interface_t* p_uas, uint32_t xferred_bytes)
+{
+  uint8_t  const iu_id = _uasd_epbuf.cmd_iu.command.iu_id;
+  uint16_t const tag   = tu_ntohs(_uasd_epbuf.cmd_iu.command.tag);
+  uint8_t resp_code;
+
+  if ( (iu_id == UAS_IU_ID_COMMAND) && (xferred_bytes >= sizeof(uas_iu_command_t)) )
+  {
+    uas_iu_command_t const* iu = &_uasd_epbuf.cmd_iu.command;
+    uint8_t const lun = iu->lun[1];
+
+    if ( find_cmd(p_uas, tag) != UASD_NO_CMD )
+    {
+      resp_code = UAS_RESPONSE_OVERLAPPED_TAG;
+    }
+    else if ( (iu->add_cdb_len >> 2) != 0 )
+    {
+      // CDB longer than 16 bytes is not supported
+      resp_code = UAS_RESPONSE_INVALID_IU;
+    }
+    else if ( lun >= get_maxlun() )
+    {
+      resp_code = UAS_RESPONSE_INCORRECT_LUN;
+    }
+    else
+    {
+      // command pipe is only armed when there is a free slot
+      uint8_t const idx = find_state(p_uas, UAS_CMD_FREE);
+      TU_ASSERT(idx != UASD_NO_CMD, );
+
+      uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+      tu_varclr(p_cmd);
+
+      p_cmd->state = UAS_CMD_QUEUED;
+      p_cmd->tag   = tag;
+      p_cmd->lun   = lun;
+      p_cmd->attr  = iu->attribute & 0x07u;
+      p_cmd->seq   = p_uas->seq++;
+      memcpy(p_cmd->cdb, iu->cdb, sizeof(p_cmd->cdb));
+
+      TU_LOG_DRV("  UAS Command [Lun%u] tag = %u, opcode = 0x%02X\r\n", lun, tag, p_cmd->cdb[0]);
+      return;
+    }
+  }
+  else if ( (iu_id == UAS_IU_ID_TASK_MGMT) && (xferred_bytes >= sizeof(uas_iu_task_mgmt_t)) )
+  {
+    resp_code = proc_task_mgmt(p_uas, &_uasd_epbuf.cmd_iu.task_mgmt);
+  }
+  else
+  {
+    resp_code = UAS_RESPONSE_INVALID_IU;
+  }
+
+  p_uas->resp_pending = true;
+  p_uas->resp_code    = resp_code;
+  p_uas->resp_tag     = tag;
+}
+
+//--------------------------------------------------------------------+
+// SCSI Command Process
+//--------------------------------------------------------------------+
+static int32_t proc_report_luns(uint8_t* buffer, uint32_t bufsize)
+{
+  uint8_t const maxlun = get_maxlun();
+  uint32_t const list_len = 8u * maxlun;
+
+  TU_VERIFY(8 + list_len <= bufsize, -1);
+  tu_memclr(buffer, 8 + list_len);
+
+  tu_unaligned_write32(buffer, tu_htonl(list_len));
+
+  // single level lun, peripheral device addressing
+  for(uint8_t i=0; i<maxlun; i++) buffer[8 + 8*i + 1] = i;
+
+  return (int32_t) (8 + list_len);
+}
+
+static void exec_rdwr(uasd_interface_t* p_uas, uint8_t idx)
+{
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+  uint8_t const lun = p_cmd->lun;
+
+  uint64_t const lba         = cdb_get_lba(p_cmd->cdb);
+  uint32_t const block_count = cdb_get_blockcount(p_cmd->cdb);
+
+  uint64_t disk_blocks = 0;
+  uint16_t block_size  = 0;
+  mscd_get_capacity(lun, &disk_blocks, &block_size);
+
+  bool const has_cb16 = is_read_cmd(p_cmd->cdb[0]) ? (tud_msc_read16_cb != NULL) : (tud_msc_write16_cb != NULL);
+  uint64_t const total_len = ((uint64_t) block_count) * block_size;
+
+  if ( (disk_blocks == 0) || (block_size == 0) )
+  {
+    // not ready, e.g medium not present
+    if ( mscd_sense_key(lun) == 0 ) tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else if ( (lba + block_count > disk_blocks) || (!has_cb16 && (lba + block_count > ((uint64_t) UINT32_MAX) + 1)) )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else if ( total_len > UINT32_MAX )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00); // Invalid field in CDB
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else if ( is_write_cmd(p_cmd->cdb[0]) && !mscd_lun_writable(lun) )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else if ( block_count == 0 )
+  {
+    complete_cmd(p_uas, idx, SCSI_STATUS_GOOD);
+  }
+  else
+  {
+    p_cmd->block_size = block_size;
+    p_cmd->total_len  = (uint32_t) total_len;
+    p_cmd->state      = UAS_CMD_READY;
+  }
+}
+
+// Execute command: READ/WRITE only prepare data phase, others are processed right away and
+// their response (if any) is kept in buffer until data phase
+static void exec_cmd(uasd_interface_t* p_uas, uint8_t idx)
+{
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+  uint8_t const lun = p_cmd->lun;
+
+  TU_LOG_DRV("  UAS Execute [Lun%u] tag = %u\r\n", lun, p_cmd->tag);
+
+  p_uas->active = idx;
+  p_cmd->xferred_len = 0;
+  p_cmd->total_len   = 0;
+  tud_msc_set_sense(lun, 0, 0, 0);
+
+  if ( is_rdwr_cmd(p_cmd->cdb[0]) )
+  {
+    exec_rdwr(p_uas, idx);
+    return;
+  }
+
+  if ( is_param_out_cmd(p_cmd->cdb) )
+  {
+    TU_LOG_DRV("  UAS data-out command is not supported\r\n");
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00); // Invalid command operation code
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+    return;
+  }
+
+  uint32_t const alloc_len = cdb_get_alloc_length(p_cmd->cdb);
+  int32_t resplen;
+
+  if ( p_cmd->cdb[0] == SCSI_CMD_REPORT_LUNS )
+  {
+    resplen = proc_report_luns(_uasd_epbuf.buf, sizeof(_uasd_epbuf.buf));
+  }else
+  {
+    // First process if it is a built-in commands
+    resplen = mscd_builtin_scsi(lun, p_cmd->cdb, _uasd_epbuf.buf, sizeof(_uasd_epbuf.buf));
+
+    // Invoke user callback if not built-in
+    if ( (resplen < 0) && (mscd_sense_key(lun) == 0) )
+    {
+      resplen = tud_msc_scsi_cb(lun, p_cmd->cdb, _uasd_epbuf.buf, (uint16_t) tu_min32(alloc_len, sizeof(_uasd_epbuf.buf)));
+    }
+  }
+
+  if ( resplen < 0 )
+  {
+    TU_LOG_DRV("  SCSI unsupported or failed command\r\n");
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else
+  {
+    // cannot return more than host allocated
+    p_cmd->total_len = tu_min32((uint32_t) resplen, alloc_len);
+
+    if ( p_cmd->total_len == 0 )
+    {
+      complete_cmd(p_uas, idx, SCSI_STATUS_GOOD);
+    }else
+    {
+      p_cmd->state = UAS_CMD_READY;
+    }
+  }
+}
+
+// Pick next command to execute:
+// - HEAD OF QUEUE first
+// - commands newer than first ORDERED one must wait for it, which waits for all older ones
+// - commands that do not access media are executed before READ/WRITE since they complete immediately
+static uint8_t next_cmd(uasd_interface_t const* p_uas)
+{
+  bool     has_ordered = false;
+  uint32_t ordered_seq = 0;
+  bool     has_queued  = false;
+  uint32_t oldest_seq  = 0;
+
+  for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+  {
+    uasd_cmd_t const* p_cmd = &p_uas->cmd[i];
+    if ( p_cmd->state != UAS_CMD_QUEUED ) continue;
+
+    if ( !has_queued || seq_before(p_cmd->seq, oldest_seq) )
+    {
+      has_queued = true;
+      oldest_seq = p_cmd->seq;
+    }
+
+    if ( (p_cmd->attr == UAS_TASK_ATTR_ORDERED) && (!has_ordered || seq_before(p_cmd->seq, ordered_seq)) )
+    {
+      has_ordered = true;
+      ordered_seq = p_cmd->seq;
+    }
+  }
+
+  uint8_t best      = UASD_NO_CMD;
+  uint8_t best_rank = 0;
+
+  for(uint8_t i=0; i<CFG_TUD_MSC_UAS_QUEUE_DEPTH; i++)
+  {
+    uasd_cmd_t const* p_cmd = &p_uas->cmd[i];
+    if ( p_cmd->state != UAS_CMD_QUEUED ) continue;
+
+    uint8_t rank;
+    if ( p_cmd->attr == UAS_TASK_ATTR_HEAD_OF_QUEUE )
+    {
+      rank = 3;
+    }
+    else if ( has_ordered && !seq_before(p_cmd->seq, ordered_seq) && (p_cmd->seq != oldest_seq) )
+    {
+      continue;
+    }
+    else
+    {
+      rank = is_rdwr_cmd(p_cmd->cdb[0]) ? 1 : 2;
+    }
+
+    if ( (rank > best_rank) || ((rank == best_rank) && seq_before(p_cmd->seq, p_uas->cmd[best].seq)) )
+    {
+      best      = i;
+      best_rank = rank;
+    }
+  }
+
+  return best;
+}
+
+//--------------------------------------------------------------------+
+// Data Pipes
+//--------------------------------------------------------------------+
+static void proc_read(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  uint8_t const idx = p_uas->active;
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  // Adjust lba with transferred bytes
+  uint64_t const lba    = cdb_get_lba(p_cmd->cdb) + (p_cmd->xferred_len / p_cmd->block_size);
+  uint32_t const offset = p_cmd->xferred_len % p_cmd->block_size;
+
+  // remaining bytes capped at class buffer
+  uint32_t const nbytes = tu_min32(sizeof(_uasd_epbuf.buf), p_cmd->total_len - p_cmd->xferred_len);
+
+  int32_t const count = mscd_invoke_read(p_cmd->lun, lba, offset, _uasd_epbuf.buf, nbytes,
+                                         mscd_cacheable(p_cmd->block_size, cdb_get_blockcount(p_cmd->cdb)));
+
+  if ( (count < 0) || ((uint32_t) count > nbytes) )
+  {
+    TU_LOG_DRV("  tud_msc_read10_cb() return -1\r\n");
+    if ( mscd_sense_key(p_cmd->lun) == 0 ) tud_msc_set_sense(p_cmd->lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+
+    // Sense IU terminates the data phase, host cancels its pending data transfer
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+  }
+  else if ( count == 0 )
+  {
+    // not ready, call again later
+    defer_retry();
+  }
+  else
+  {
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_uas->ep_data_in, _uasd_epbuf.buf, (uint16_t) count), );
+  }
+}
+
+// Pass received data to application, receive next chunk when it is fully consumed
+static void proc_write_consume(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  uint8_t const idx = p_uas->active;
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  while ( p_uas->buf_pos < p_uas->buf_len )
+  {
+    uint64_t const lba       = cdb_get_lba(p_cmd->cdb) + (p_cmd->xferred_len / p_cmd->block_size);
+    uint32_t const offset    = p_cmd->xferred_len % p_cmd->block_size;
+    uint32_t const remaining = p_uas->buf_len - p_uas->buf_pos;
+
+    int32_t const count = mscd_invoke_write(p_cmd->lun, lba, offset, _uasd_epbuf.buf + p_uas->buf_pos, remaining,
+                                            mscd_cacheable(p_cmd->block_size, cdb_get_blockcount(p_cmd->cdb)));
+
+    if ( (count < 0) || ((uint32_t) count > remaining) )
+    {
+      TU_LOG_DRV("  tud_msc_write10_cb() return -1\r\n");
+      if ( mscd_sense_key(p_cmd->lun) == 0 ) tud_msc_set_sense(p_cmd->lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+      complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+      return;
+    }
+    else if ( count == 0 )
+    {
+      // not ready, call again later with the same data
+      defer_retry();
+      return;
+    }
+
+    p_uas->buf_pos     += (uint32_t) count;
+    p_cmd->xferred_len += (uint32_t) count;
+  }
+
+  if ( p_cmd->xferred_len >= p_cmd->total_len )
+  {
+    complete_cmd(p_uas, idx, SCSI_STATUS_GOOD);
+  }else
+  {
+    uint16_t const nbytes = (uint16_t) tu_min32(sizeof(_uasd_epbuf.buf), p_cmd->total_len - p_cmd->xferred_len);
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_uas->ep_data_out, _uasd_epbuf.buf, nbytes), );
+  }
+}
+
+// Ready IU is sent, start data phase
+static void start_data(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  uasd_cmd_t* p_cmd = &p_uas->cmd[p_uas->active];
+
+  if ( is_read_cmd(p_cmd->cdb[0]) )
+  {
+    proc_read(rhport, p_uas);
+  }
+  else if ( is_write_cmd(p_cmd->cdb[0]) )
+  {
+    p_uas->buf_len = 0;
+    p_uas->buf_pos = 0;
+    proc_write_consume(rhport, p_uas);
+  }
+  else
+  {
+    // response is already in buffer
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_uas->ep_data_in, _uasd_epbuf.buf, (uint16_t) p_cmd->total_len), );
+  }
+}
+
+static void proc_data_done(uint8_t rhport, uasd_interface_t* p_uas, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes)
+{
+  uint8_t const idx = p_uas->active;
+
+  // command is aborted or reset
+  if ( (idx == UASD_NO_CMD) || (p_uas->cmd[idx].state != UAS_CMD_DATA) ) return;
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  if ( event != XFER_RESULT_SUCCESS )
+  {
+    complete_cmd(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+    return;
+  }
+
+  if ( ep_addr == p_uas->ep_data_out )
+  {
+    p_uas->buf_len = xferred_bytes;
+    p_uas->buf_pos = 0;
+    proc_write_consume(rhport, p_uas);
+  }
+  else
+  {
+    p_cmd->xferred_len += xferred_bytes;
+
+    if ( p_cmd->xferred_len >= p_cmd->total_len )
+    {
+      complete_cmd(p_uas, idx, SCSI_STATUS_GOOD);
+    }
+    else if ( is_read_cmd(p_cmd->cdb[0]) )
+    {
+      proc_read(rhport, p_uas);
+    }
+    else
+    {
+      // short response
+      complete_cmd(p_uas, idx, SCSI_STATUS_GOOD);
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Status Pipe
+//--------------------------------------------------------------------+
+static void proc_status_done(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  uint8_t const idx = p_uas->status_cmd;
+
+  p_uas->status_busy = false;
+  p_uas->status_cmd  = UASD_NO_CMD;
+
+  // Response IU
+  if ( idx == UASD_NO_CMD ) return;
+
+  uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+
+  if ( p_cmd->state == UAS_CMD_STATUS_SENT )
+  {
+    TU_LOG_DRV("  UAS Status [Lun%u] tag = %u, status = %u\r\n", p_cmd->lun, p_cmd->tag, p_cmd->scsi_status);
+
+    switch ( p_cmd->cdb[0] )
+    {
+      case SCSI_CMD_READ_10:
+      case SCSI_CMD_READ_16:
+        if ( tud_msc_read10_complete_cb ) tud_msc_read10_complete_cb(p_cmd->lun);
+      break;
+
+      case SCSI_CMD_WRITE_10:
+      case SCSI_CMD_WRITE_16:
+        if ( tud_msc_write10_complete_cb ) tud_msc_write10_complete_cb(p_cmd->lun);
+      break;
+
+      default:
+        if ( tud_msc_scsi_complete_cb ) tud_msc_scsi_complete_cb(p_cmd->lun, p_cmd->cdb);
+      break;
+    }
+
+    p_cmd->state = UAS_CMD_FREE;
+  }
+  else if ( (p_cmd->state == UAS_CMD_DATA) && (p_uas->active == idx) )
+  {
+    start_data(rhport, p_uas);
+  }
+}
+
+// Status pipe carries Response IU first, then Sense IU of completed commands, then Ready IU of active command
+static void send_next_status(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  uint8_t idx;
+
+  if ( p_uas->resp_pending )
+  {
+    uas_iu_response_t* resp_iu = &_uasd_epbuf.status_iu.response;
+    tu_varclr(resp_iu);
+
+    resp_iu->iu_id         = UAS_IU_ID_RESPONSE;
+    resp_iu->tag           = tu_htons(p_uas->resp_tag);
+    resp_iu->response_code = p_uas->resp_code;
+
+    p_uas->resp_pending = false;
+    TU_ASSERT( send_status_iu(rhport, p_uas, UASD_NO_CMD, sizeof(uas_iu_response_t)), );
+  }
+  else if ( (idx = find_state(p_uas, UAS_CMD_STATUS)) != UASD_NO_CMD )
+  {
+    uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+    uas_iu_sense_t* sense_iu = &_uasd_epbuf.status_iu.sense;
+    tu_varclr(sense_iu);
+
+    sense_iu->iu_id  = UAS_IU_ID_SENSE;
+    sense_iu->tag    = tu_htons(p_cmd->tag);
+    sense_iu->status = p_cmd->scsi_status;
+
+    uint16_t len = (uint16_t) offsetof(uas_iu_sense_t, sense);
+    if ( p_cmd->scsi_status == SCSI_STATUS_CHECK_CONDITION )
+    {
+      sense_iu->sense_len = tu_htons((uint16_t) sizeof(sense_iu->sense));
+      memcpy(sense_iu->sense, p_cmd->sense, sizeof(sense_iu->sense));
+      len = (uint16_t) sizeof(uas_iu_sense_t);
+    }
+
+    p_cmd->state = UAS_CMD_STATUS_SENT;
+    TU_ASSERT( send_status_iu(rhport, p_uas, idx, len), );
+  }
+  else if ( (p_uas->active != UASD_NO_CMD) && (p_uas->cmd[p_uas->active].state == UAS_CMD_READY) )
+  {
+    idx = p_uas->active;
+    uasd_cmd_t* p_cmd = &p_uas->cmd[idx];
+    uas_iu_ready_t* ready_iu = &_uasd_epbuf.status_iu.ready;
+    tu_varclr(ready_iu);
+
+    ready_iu->iu_id = is_write_cmd(p_cmd->cdb[0]) ? UAS_IU_ID_WRITE_READY : UAS_IU_ID_READ_READY;
+    ready_iu->tag   = tu_htons(p_cmd->tag);
+
+    p_cmd->state = UAS_CMD_DATA;
+    TU_ASSERT( send_status_iu(rhport, p_uas, idx, sizeof(uas_iu_ready_t)), );
+  }
+}
+
+static void schedule(uint8_t rhport, uasd_interface_t* p_uas)
+{
+  // execute queued commands while data pipes are free, commands without data phase complete immediately
+  while ( p_uas->active == UASD_NO_CMD )
+  {
+    uint8_t const idx = next_cmd(p_uas);
+    if ( idx == UASD_NO_CMD ) break;
+    exec_cmd(p_uas, idx);
+  }
+
+  if ( !p_uas->status_busy ) send_next_status(rhport, p_uas);
+
+  // accept next IU if there is room for it
+  if ( !p_uas->resp_pending && (find_state(p_uas, UAS_CMD_FREE) != UASD_NO_CMD) &&
+       !usbd_edpt_busy(rhport, p_uas->ep_cmd) )
+  {
+    TU_ASSERT( prepare_cmd_iu(rhport, p_uas), );
+  }
+}
+
+bool uasd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes)
+{
+  uasd_interface_t* p_uas = &_uasd_itf;
+
+  if ( ep_addr == p_uas->ep_cmd )
+  {
+    if ( event == XFER_RESULT_SUCCESS ) proc_cmd_iu(p_uas, xferred_bytes);
+  }
+  else if ( ep_addr == p_uas->ep_status )
+  {
+    proc_status_done(rhport, p_uas);
+  }
+  else if ( (ep_addr == p_uas->ep_data_in) || (ep_addr == p_uas->ep_data_out) )
+  {
+    proc_data_done(rhport, p_uas, ep_addr, event, xferred_bytes);
+  }
+  else
+  {
+    return false;
+  }
+
+  schedule(rhport, p_uas);
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_UAS_DEVICE_H_
+#define _TUSB_UAS_DEVICE_H_
+
+#include "common/tusb_common.h"
+#include "msc.h"
+#include "msc_device.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//
+// USB Attached SCSI (UAS) interface with Command, Status, Data-In and Data-Out pipes, use
+// TUD_MSC_UAS_DESCRIPTOR() in configuration descriptor. UAS shares SCSI handling and all tud_msc_*
+// callbacks with MSC BOT driver, therefore CFG_TUD_MSC must also be enabled.
+// - Multiple tagged commands are queued and can complete out of order: commands that do not access
+//   media are executed before queued READ/WRITE, HEAD OF QUEUE task attribute is executed first.
+// - Data phases are serialized with READ READY/WRITE READY IUs (USB 2.0 mode), streams are not supported.
+// - Data-Out is only supported for WRITE10/WRITE16, TUD_MSC_ASYNC is not supported.
+//--------------------------------------------------------------------+
+
+#if CFG_TUD_MSC_UAS && !CFG_TUD_MSC
+  #error CFG_TUD_MSC_UAS requires CFG_TUD_MSC
+#endif
+
+// Number of commands that can be in flight
+#ifndef CFG_TUD_MSC_UAS_QUEUE_DEPTH
+  #define CFG_TUD_MSC_UAS_QUEUE_DEPTH   4
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_UAS_QUEUE_DEPTH > 0 && CFG_TUD_MSC_UAS_QUEUE_DEPTH < 255, "Queue depth is not correct");
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     uasd_init            (void);
+void     uasd_reset           (uint8_t rhport);
+uint16_t uasd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
+bool     uasd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
+bool     uasd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_UAS_DEVICE_H_ */
@@ -42,6 +42,7 @@ void rndis_class_set_handler(uint8_t *data, int size); /* found in ./misc/networ
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;      // Index number of Management Interface, +1 for Data Interface
   uint8_t itf_data_alt; // Alternate setting of Data Interface. 0 : inactive, 1 : active
 
@@ -56,16 +57,45 @@ typedef struct
   // keep a copy of endpoint attribute instead
   uint8_t const * ecm_desc_epdata;
 
+#if CFG_TUD_NET_PACKET_FILTER
+  netd_packet_filter_t filter; // ECM only
+#endif
+
 } netd_interface_t;
 
 #define CFG_TUD_NET_PACKET_PREFIX_LEN sizeof(rndis_data_packet_t)
 #define CFG_TUD_NET_PACKET_SUFFIX_LEN 0
 
+TU_VERIFY_STATIC(sizeof(rndis_data_packet_t) == 44, "TUD_RNDIS_XFER_SIZE assumes 44 bytes packet header");
+TU_VERIFY_STATIC(TUD_RNDIS_XFER_SIZE <= UINT16_MAX, "RNDIS transfer size must fit 16-bit");
+
+#if CFG_TUD_RNDIS_PACKETS_PER_XFER > 1
+  #define NETD_XFER_SIZE   TUD_RNDIS_XFER_SIZE
+  #define NETD_TX_BUF_N    2
+#else
+  #define NETD_XFER_SIZE   (CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN)
+  #define NETD_TX_BUF_N    1
+#endif
+
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t received[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t received[NETD_XFER_SIZE];
 
+// one buffer is filled with packet messages while the other is being sent
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t transmitted[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t transmitted[NETD_TX_BUF_N][NETD_XFER_SIZE];
+
+typedef struct
+{
+  uint16_t rx_len;     // received transfer length
+  uint16_t rx_offset;  // next packet message in received transfer
+
+  uint8_t  tx_fill;    // transmit buffer packets are added to
+  uint8_t  tx_count;   // packets in fill buffer
+  uint16_t tx_len;     // bytes in fill buffer
+  uint16_t tx_max;     // transfer size limit: host MaxTransferSize (RNDIS)
+} netd_xfer_t;
+
+tu_static netd_xfer_t _netd_xfer;
 
 struct ecm_notify_struct
 {
@@ -109,20 +139,70 @@ CFG_TUD_MEM_SECTION tu_static netd_interface_t _netd_itf;
 
 tu_static bool can_xmit;
 
+#if CFG_TUD_NET_PACKET_FILTER
+// SET_ETHERNET_MULTICAST_FILTERS data stage
+tu_static uint8_t _netd_mc_list[6*CFG_TUD_NET_MC_FILTER_MAX];
+#endif
+
+// Hand next packet message of received transfer to application, return false once transfer is consumed
+static bool rndis_rx_next(void)
+{
+  while (_netd_xfer.rx_offset + sizeof(rndis_data_packet_t) <= _netd_xfer.rx_len)
+  {
+    uint16_t const offset = _netd_xfer.rx_offset;
+    rndis_data_packet_t *r = (rndis_data_packet_t *) ((void*) &received[offset]);
+    uint32_t const msg_len = r->MessageLength;
+
+    if ( (r->MessageType != REMOTE_NDIS_PACKET_MSG) || (msg_len < sizeof(rndis_data_packet_t)) ||
+         (msg_len > (uint32_t) (_netd_xfer.rx_len - offset)) )
+    {
+      break;
+    }
+
+    _netd_xfer.rx_offset = (uint16_t) (offset + msg_len);
+
+    uint32_t const data_offset = r->DataOffset + offsetof(rndis_data_packet_t, DataOffset);
+    if ( (data_offset + r->DataLength) <= msg_len )
+    {
+      if ( tud_network_recv_cb(&received[offset + data_offset], (uint16_t) r->DataLength) ) return true;
+    }
+    /* packet was not accepted: continue with next one */
+  }
+
+  _netd_xfer.rx_len = 0;
+  return false;
+}
+
 void tud_network_recv_renew(void)
 {
-  usbd_edpt_xfer(0, _netd_itf.ep_out, received, sizeof(received));
+  // remaining packet messages of an aggregated transfer are handed over first
+  if ( !_netd_itf.ecm_mode && rndis_rx_next() ) return;
+
+  usbd_edpt_xfer(_netd_itf.rhport, _netd_itf.ep_out, received, sizeof(received));
 }
 
 static void do_in_xfer(uint8_t *buf, uint16_t len)
 {
   can_xmit = false;
-  usbd_edpt_xfer(0, _netd_itf.ep_in, buf, len);
+  usbd_edpt_xfer(_netd_itf.rhport, _netd_itf.ep_in, buf, len);
+}
+
+// Send fill buffer, packets are then added to the other buffer
+static void netd_tx_send(void)
+{
+  uint8_t *buf = transmitted[_netd_xfer.tx_fill];
+  uint16_t const len = _netd_xfer.tx_len;
+
+  _netd_xfer.tx_fill  = (uint8_t) ((_netd_xfer.tx_fill + 1) % NETD_TX_BUF_N);
+  _netd_xfer.tx_len   = 0;
+  _netd_xfer.tx_count = 0;
+
+  do_in_xfer(buf, len);
 }
 
 void netd_report(uint8_t *buf, uint16_t len)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _netd_itf.rhport;
 
   // skip if previous report not yet acknowledged by host
   if ( usbd_edpt_busy(rhport, _netd_itf.ep_notif) ) return;
@@ -135,6 +215,11 @@ void netd_report(uint8_t *buf, uint16_t len)
 void netd_init(void)
 {
   tu_memclr(&_netd_itf, sizeof(_netd_itf));
+  tu_memclr(&_netd_xfer, sizeof(_netd_xfer));
+  _netd_xfer.tx_max = NETD_XFER_SIZE;
+#if CFG_TUD_NET_PACKET_FILTER
+  netd_packet_filter_reset(&_netd_itf.filter);
+#endif
 }
 
 void netd_reset(uint8_t rhport)
@@ -163,6 +248,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   _netd_itf.ecm_mode = is_ecm;
 
   //------------- Management Interface -------------//
+  _netd_itf.rhport  = rhport;
   _netd_itf.itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -308,11 +394,23 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
         if (_netd_itf.ecm_mode)
         {
           /* the only required CDC-ECM Management Element Request is SetEthernetPacketFilter */
-          if (0x43 /* SET_ETHERNET_PACKET_FILTER */ == request->bRequest)
+          if (CDC_REQUEST_SET_ETHERNET_PACKET_FILTER == request->bRequest)
           {
+#if CFG_TUD_NET_PACKET_FILTER
+            _netd_itf.filter.packet_type = request->wValue;
+#endif
             tud_control_xfer(rhport, request, NULL, 0);
             ecm_report(true);
           }
+#if CFG_TUD_NET_PACKET_FILTER
+          else if (CDC_REQUEST_SET_ETHERNET_MULTICAST_FILTERS == request->bRequest)
+          {
+            // list of wValue 6-byte addresses, applied in data stage
+            TU_VERIFY(request->wValue <= CFG_TUD_NET_MC_FILTER_MAX && request->wLength == 6*request->wValue);
+            if (0 == request->wValue) netd_packet_filter_set_multicast(&_netd_itf.filter, NULL, 0);
+            tud_control_xfer(rhport, request, _netd_mc_list, request->wLength);
+          }
+#endif
         }
         else
         {
@@ -336,13 +434,26 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
   }
   else if ( stage == CONTROL_STAGE_DATA )
   {
-    // Handle RNDIS class control OUT only
+    // Handle class control OUT data: RNDIS messages and ECM multicast filters
     if (request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
         request->bmRequestType_bit.direction == TUSB_DIR_OUT   &&
         _netd_itf.itf_num == request->wIndex)
     {
+#if CFG_TUD_NET_PACKET_FILTER
+      if ( _netd_itf.ecm_mode && CDC_REQUEST_SET_ETHERNET_MULTICAST_FILTERS == request->bRequest )
+      {
+        netd_packet_filter_set_multicast(&_netd_itf.filter, _netd_mc_list, request->wValue);
+      }
+#endif
       if ( !_netd_itf.ecm_mode )
       {
+        // host's receive limit for aggregated IN transfers
+        rndis_initialize_msg_t const *init_msg = (rndis_initialize_msg_t const *) ((void*) notify.rndis_buf);
+        if ( (init_msg->MessageType == REMOTE_NDIS_INITIALIZE_MSG) && init_msg->MaxTransferSize )
+        {
+          _netd_xfer.tx_max = (uint16_t) tu_min32(init_msg->MaxTransferSize, NETD_XFER_SIZE);
+        }
+
         rndis_class_set_handler(notify.rndis_buf, request->wLength);
       }
     }
@@ -353,28 +464,28 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
 
 static void handle_incoming_packet(uint32_t len)
 {
-  uint8_t *pnt = received;
-  uint32_t size = 0;
-
   if (_netd_itf.ecm_mode)
   {
-    size = len;
+#if CFG_TUD_NET_PACKET_FILTER
+    /* frames rejected by host's packet filter are dropped before reaching the network stack */
+    if (!netd_packet_filter_accept(&_netd_itf.filter, received, (uint16_t) len))
+    {
+      tud_network_recv_renew();
+      return;
+    }
+#endif
+    if (!tud_network_recv_cb(received, (uint16_t) len))
+    {
+      /* if a buffer was never handled by user code, we must renew on the user's behalf */
+      tud_network_recv_renew();
+    }
   }
   else
   {
-    rndis_data_packet_t *r = (rndis_data_packet_t *) ((void*) pnt);
-    if (len >= sizeof(rndis_data_packet_t))
-      if ( (r->MessageType == REMOTE_NDIS_PACKET_MSG) && (r->MessageLength <= len))
-        if ( (r->DataOffset + offsetof(rndis_data_packet_t, DataOffset) + r->DataLength) <= len)
-        {
-          pnt = &received[r->DataOffset + offsetof(rndis_data_packet_t, DataOffset)];
-          size = r->DataLength;
-        }
-  }
-
-  if (!tud_network_recv_cb(pnt, (uint16_t) size))
-  {
-    /* if a buffer was never handled by user code, we must renew on the user's behalf */
+    /* transfer may contain several packet messages: they are handed over one at a time, each
+     * tud_network_recv_renew() moves to the next one and re-arms endpoint once all are consumed */
+    _netd_xfer.rx_len    = (uint16_t) len;
+    _netd_xfer.rx_offset = 0;
     tud_network_recv_renew();
   }
 }
@@ -403,6 +514,9 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     {
       /* we're finally finished */
       can_xmit = true;
+
+      /* send packets queued meanwhile */
+      if ( _netd_xfer.tx_len ) netd_tx_send();
     }
   }
 
@@ -416,35 +530,51 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 
 bool tud_network_can_xmit(uint16_t size)
 {
-  (void)size;
+  // with a single buffer, it is in use until transfer completes
+  if ( (NETD_TX_BUF_N == 1) && !can_xmit ) return false;
+
+  // ECM sends one frame per transfer
+  if ( _netd_itf.ecm_mode ) return (_netd_xfer.tx_count == 0);
 
-  return can_xmit;
+  uint32_t const msg_len = tu_align((uint32_t) (CFG_TUD_NET_PACKET_PREFIX_LEN + size + TUD_RNDIS_PACKET_MSG_ALIGN - 1),
+                                    TUD_RNDIS_PACKET_MSG_ALIGN);
+  return (_netd_xfer.tx_count < CFG_TUD_RNDIS_PACKETS_PER_XFER) &&
+         (_netd_xfer.tx_len + msg_len <= _netd_xfer.tx_max);
 }
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  uint8_t *data;
+  uint8_t *msg;
   uint16_t len;
 
-  if (!can_xmit)
-    return;
+  if ( (NETD_TX_BUF_N == 1) && !can_xmit ) return;
+  if ( _netd_itf.ecm_mode && _netd_xfer.tx_count ) return;
+  if ( _netd_xfer.tx_count >= CFG_TUD_RNDIS_PACKETS_PER_XFER ) return;
 
+  msg = transmitted[_netd_xfer.tx_fill] + _netd_xfer.tx_len;
   len = (_netd_itf.ecm_mode) ? 0 : CFG_TUD_NET_PACKET_PREFIX_LEN;
-  data = transmitted + len;
 
-  len += tud_network_xmit_cb(data, ref, arg);
+  len += tud_network_xmit_cb(msg + len, ref, arg);
 
   if (!_netd_itf.ecm_mode)
   {
-    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
+    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) msg);
     memset(hdr, 0, sizeof(rndis_data_packet_t));
+    hdr->DataLength = len - sizeof(rndis_data_packet_t);
+
+    // pad message so that next one is aligned in aggregated transfer
+    len = (uint16_t) tu_align((uint32_t) (len + TUD_RNDIS_PACKET_MSG_ALIGN - 1), TUD_RNDIS_PACKET_MSG_ALIGN);
+
     hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
     hdr->MessageLength = len;
     hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
-    hdr->DataLength = len - sizeof(rndis_data_packet_t);
   }
 
-  do_in_xfer(transmitted, len);
+  _netd_xfer.tx_len = (uint16_t) (_netd_xfer.tx_len + len);
+  _netd_xfer.tx_count++;
+
+  // send now if idle, otherwise packet is sent with the next transfer
+  if ( can_xmit ) netd_tx_send();
 }
 
 #endif
@@ -45,54 +45,31 @@
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
-#define NTH16_SIGNATURE      0x484D434E
-#define NDP16_SIGNATURE_NCM0 0x304D434E
-#define NDP16_SIGNATURE_NCM1 0x314D434E
+// NTB format selected by SET_NTB_FORMAT
+enum {
+  NCM_NTB_FORMAT_16 = 0,
+  NCM_NTB_FORMAT_32 = 1,
+};
 
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wLength;
-  uint16_t bmNtbFormatsSupported;
-  uint32_t dwNtbInMaxSize;
-  uint16_t wNdbInDivisor;
-  uint16_t wNdbInPayloadRemainder;
-  uint16_t wNdbInAlignment;
-  uint16_t wReserved;
-  uint32_t dwNtbOutMaxSize;
-  uint16_t wNdbOutDivisor;
-  uint16_t wNdbOutPayloadRemainder;
-  uint16_t wNdbOutAlignment;
-  uint16_t wNtbOutMaxDatagrams;
-} ntb_parameters_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wHeaderLength;
-  uint16_t wSequence;
-  uint16_t wBlockLength;
-  uint16_t wNdpIndex;
-} nth16_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wDatagramIndex;
-  uint16_t wDatagramLength;
-} ndp16_datagram_t;
+// usbd transfer length is 16-bit: larger NTBs are sent/received in chunks of multiple of max packet size
+#define NCM_XFER_CHUNK_MAX   (UINT16_MAX - 511)
 
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wLength;
-  uint16_t wNextNdpIndex;
-  ndp16_datagram_t datagram[];
-} ndp16_t;
+#if !CFG_TUD_NCM_NTB32
+TU_VERIFY_STATIC(CFG_TUD_NCM_IN_NTB_MAX_SIZE <= UINT16_MAX && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= UINT16_MAX,
+                 "NTB larger than 64 KB requires CFG_TUD_NCM_NTB32");
+#endif
 
 typedef union TU_ATTR_PACKED {
   struct {
     nth16_t nth;
     ndp16_t ndp;
   };
+#if CFG_TUD_NCM_NTB32
+  struct {
+    nth32_t nth32;
+    ndp32_t ndp32;
+  };
+#endif
   uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
 } transmit_ntb_t;
 
@@ -104,6 +81,7 @@ struct ecm_notify_struct
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;      // Index number of Management Interface, +1 for Data Interface
   uint8_t itf_data_alt; // Alternate setting of Data Interface. 0 : inactive, 1 : active
 
@@ -111,8 +89,21 @@ typedef struct
   uint8_t ep_in;
   uint8_t ep_out;
 
-  const ndp16_t *ndp;
-  uint8_t num_datagrams, current_datagram_index;
+  uint16_t ntb_format;   // NCM_NTB_FORMAT_16 or NCM_NTB_FORMAT_32
+
+  const uint8_t *ndp;    // NDP16 or NDP32 of NTB at rx_head
+  uint16_t num_datagrams, current_datagram_index;
+
+  uint8_t  rx_head;               // Index in receive_ntb[] whose datagrams are being consumed by the stack
+  uint8_t  rx_count;              // Number of received NTBs starting from rx_head
+  bool     rx_armed;              // OUT transfer is armed into receive_ntb[(rx_head + rx_count) % CFG_TUD_NCM_OUT_NTB_N]
+  uint32_t rx_len[CFG_TUD_NCM_OUT_NTB_N];
+  uint32_t rx_offset;             // Bytes received so far into the NTB being received
+  uint16_t rx_chunk;              // Size of armed OUT transfer
+#if CFG_TUD_NCM_ZERO_COPY
+  uint8_t  rx_held;               // Number of consumed NTBs before rx_head that are not reclaimed yet
+  uint8_t  rx_pin[CFG_TUD_NCM_OUT_NTB_N]; // Number of datagrams of each NTB not released by the stack
+#endif
 
   enum {
     REPORT_SPEED,
@@ -121,16 +112,30 @@ typedef struct
   } report_state;
   bool report_pending;
 
-  uint8_t  current_ntb;           // Index in transmit_ntb[] that is currently being filled with datagrams
+  uint8_t  tx_head;               // Index in transmit_ntb[] of the oldest NTB queued or being sent
+  uint8_t  tx_count;              // Number of NTBs queued or being sent, the next one is being filled
   uint8_t  datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
-  uint16_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
-  uint16_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
+  uint32_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
+  uint32_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
+  uint32_t tx_offset;             // Bytes of transmit_ntb[tx_head] already sent
   uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 
   uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
 
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+  volatile uint32_t sof_ticks;    // SOF counter, incremented in ISR
+  volatile uint32_t hold_deadline;
+  volatile bool     holding;      // NTB being filled is held for aggregation until hold_deadline
+  volatile bool     hold_expired;
+  uint32_t last_tx_tick;          // sof_ticks when the last NTB was sent
+#endif
+
   bool transferring;
 
+#if CFG_TUD_NET_PACKET_FILTER
+  netd_packet_filter_t filter;
+#endif
+
 } ncm_interface_t;
 
 //--------------------------------------------------------------------+
@@ -139,7 +144,7 @@ typedef struct
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_parameters = {
     .wLength                 = sizeof(ntb_parameters_t),
-    .bmNtbFormatsSupported   = 0x01,
+    .bmNtbFormatsSupported   = CFG_TUD_NCM_NTB32 ? 0x03 : 0x01,
     .dwNtbInMaxSize          = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
     .wNdbInDivisor           = 4,
     .wNdbInPayloadRemainder  = 0,
@@ -152,33 +157,81 @@ CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_para
     .wNtbOutMaxDatagrams     = 0
 };
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static transmit_ntb_t transmit_ntb[2];
+TU_VERIFY_STATIC(CFG_TUD_NCM_IN_NTB_N >= 2 && CFG_TUD_NCM_IN_NTB_N < 256, "Number of IN NTBs is not correct");
+TU_VERIFY_STATIC(CFG_TUD_NCM_OUT_NTB_N >= 1 && CFG_TUD_NCM_OUT_NTB_N < 256, "Number of OUT NTBs is not correct");
+
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static transmit_ntb_t transmit_ntb[CFG_TUD_NCM_IN_NTB_N];
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_N][CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 
 tu_static ncm_interface_t ncm_interface;
 
+#if CFG_TUD_NET_PACKET_FILTER
+// SET_ETHERNET_MULTICAST_FILTERS data stage
+tu_static uint8_t ncm_mc_list[6*CFG_TUD_NET_MC_FILTER_MAX];
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline transmit_ntb_t* ncm_filling_ntb(void) {
+  return &transmit_ntb[(ncm_interface.tx_head + ncm_interface.tx_count) % CFG_TUD_NCM_IN_NTB_N];
+}
+
 /*
  * Set up the NTB state in ncm_interface to be ready to add datagrams.
  */
 static void ncm_prepare_for_tx(void) {
   ncm_interface.datagram_count = 0;
   // datagrams start after all the headers
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32) {
+    ncm_interface.next_datagram_offset = sizeof(nth32_t) + sizeof(ndp32_t)
+        + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp32_datagram_t));
+    return;
+  }
+#endif
   ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
       + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
 }
 
+TU_ATTR_ALWAYS_INLINE static inline uint32_t ncm_ntb_length(transmit_ntb_t const *ntb) {
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32) {
+    return ntb->nth32.dwBlockLength;
+  }
+#endif
+  return ntb->nth.wBlockLength;
+}
+
 /*
- * If not already transmitting, start sending the current NTB to the host and swap buffers
- * to start filling the other one with datagrams.
+ * Complete headers of the NTB being filled and queue it for transmission, then start filling the next one.
+ * Caller must make sure a free NTB is available i.e tx_count + 1 < CFG_TUD_NCM_IN_NTB_N.
  */
-static void ncm_start_tx(void) {
-  if (ncm_interface.transferring) {
+static void ncm_queue_ntb(void) {
+  transmit_ntb_t *ntb = ncm_filling_ntb();
+  size_t ntb_length = ncm_interface.next_datagram_offset;
+
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32) {
+    // Fill in NTB header
+    ntb->nth32.dwSignature = NTH32_SIGNATURE;
+    ntb->nth32.wHeaderLength = sizeof(nth32_t);
+    ntb->nth32.wSequence = ncm_interface.nth_sequence++;
+    ntb->nth32.dwBlockLength = ntb_length;
+    ntb->nth32.dwNdpIndex = sizeof(nth32_t);
+
+    // Fill in NDP32 header and terminator
+    ntb->ndp32.dwSignature = NDP32_SIGNATURE_NCM0;
+    ntb->ndp32.wLength = sizeof(ndp32_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp32_datagram_t);
+    ntb->ndp32.wReserved6 = 0;
+    ntb->ndp32.dwNextNdpIndex = 0;
+    ntb->ndp32.dwReserved12 = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = 0;
+
+    ncm_interface.tx_count++;
+    ncm_prepare_for_tx();
     return;
   }
-
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t ntb_length = ncm_interface.next_datagram_offset;
+#endif
 
   // Fill in NTB header
   ntb->nth.dwSignature = NTH16_SIGNATURE;
@@ -194,13 +247,83 @@ static void ncm_start_tx(void) {
   ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
   ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
 
+  ncm_interface.tx_count++;
+  ncm_prepare_for_tx();
+}
+
+/*
+ * Send next chunk of NTB at tx_head.
+ */
+static void ncm_tx_xfer(void) {
+  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.tx_head];
+  uint32_t const len = tu_min32(ncm_ntb_length(ntb) - ncm_interface.tx_offset, NCM_XFER_CHUNK_MAX);
+  usbd_edpt_xfer(ncm_interface.rhport, ncm_interface.ep_in, ntb->data + ncm_interface.tx_offset, (uint16_t) len);
+}
+
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+/*
+ * Decide whether the NTB being filled should be held to aggregate more datagrams: only when traffic is
+ * dense i.e the previous NTB was sent within the budget, and the NTB still has room for a full datagram.
+ */
+static bool ncm_tx_hold(void) {
+  if (ncm_interface.hold_expired ||
+      ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb ||
+      ncm_interface.next_datagram_offset + CFG_TUD_NET_MTU > ncm_interface.ntb_in_size) {
+    return false;
+  }
+
+  if (ncm_interface.holding) {
+    return true;
+  }
+
+  // SOF interval is 125 us for high speed and 1 ms for full speed
+  uint32_t const sof_us = (tud_n_speed_get(ncm_interface.rhport) == TUSB_SPEED_HIGH) ? 125 : 1000;
+  uint32_t const budget = (CFG_TUD_NCM_TX_AGGREGATION_US + sof_us - 1) / sof_us;
+  uint32_t const now = ncm_interface.sof_ticks;
+
+  if (now - ncm_interface.last_tx_tick >= budget) {
+    return false; // sparse traffic: send right away
+  }
+
+  ncm_interface.hold_deadline = now + budget;
+  ncm_interface.holding = true;
+  return true;
+}
+#endif
+
+/*
+ * If not already transmitting, start sending the oldest queued NTB to the host. If nothing is queued,
+ * the NTB being filled is sent and the next one starts to be filled with datagrams.
+ */
+static void ncm_start_tx(void) {
+  if (ncm_interface.transferring) {
+    return;
+  }
+
+  if (ncm_interface.tx_count == 0) {
+    if (ncm_interface.datagram_count == 0) {
+      return;
+    }
+
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+    if (ncm_tx_hold()) {
+      return;
+    }
+#endif
+
+    ncm_queue_ntb();
+  }
+
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+  ncm_interface.holding = false;
+  ncm_interface.hold_expired = false;
+  ncm_interface.last_tx_tick = ncm_interface.sof_ticks;
+#endif
+
   // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ntb->data, ntb_length);
+  ncm_interface.tx_offset = 0;
+  ncm_tx_xfer();
   ncm_interface.transferring = true;
-
-  // Swap to the other NTB and clear it out
-  ncm_interface.current_ntb = 1 - ncm_interface.current_ntb;
-  ncm_prepare_for_tx();
 }
 
 tu_static struct ecm_notify_struct ncm_notify_connected =
@@ -232,20 +355,204 @@ tu_static struct ecm_notify_struct ncm_notify_speed_change =
     .uplink = 10000000,
 };
 
-void tud_network_recv_renew(void)
+/*
+ * Arm OUT transfer for next chunk of the NTB being received.
+ */
+static void ncm_rx_xfer(void)
+{
+  uint8_t const idx = (ncm_interface.rx_head + ncm_interface.rx_count) % CFG_TUD_NCM_OUT_NTB_N;
+  ncm_interface.rx_chunk = (uint16_t) tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE - ncm_interface.rx_offset, NCM_XFER_CHUNK_MAX);
+  ncm_interface.rx_armed = usbd_edpt_xfer(ncm_interface.rhport, ncm_interface.ep_out, receive_ntb[idx] + ncm_interface.rx_offset, ncm_interface.rx_chunk);
+}
+
+/*
+ * Arm the next OUT transfer if there is a free receive NTB.
+ */
+static void ncm_rx_arm(void)
+{
+  uint8_t in_use = ncm_interface.rx_count;
+#if CFG_TUD_NCM_ZERO_COPY
+  in_use += ncm_interface.rx_held;
+#endif
+
+  if (ncm_interface.rx_armed || in_use >= CFG_TUD_NCM_OUT_NTB_N) {
+    return;
+  }
+
+  ncm_interface.rx_offset = 0;
+  ncm_rx_xfer();
+}
+
+#if CFG_TUD_NCM_ZERO_COPY
+/*
+ * Free consumed NTBs, in reception order, once the stack has released all their datagrams.
+ */
+static void ncm_rx_reclaim(void)
 {
-  if (!ncm_interface.num_datagrams)
+  while (ncm_interface.rx_held)
   {
-    usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb, sizeof(receive_ntb));
+    uint8_t const idx = (ncm_interface.rx_head + CFG_TUD_NCM_OUT_NTB_N - ncm_interface.rx_held) % CFG_TUD_NCM_OUT_NTB_N;
+    if (ncm_interface.rx_pin[idx])
+    {
+      break;
+    }
+    ncm_interface.rx_held--;
+  }
+}
+
+void tud_network_recv_release(const uint8_t *datagram)
+{
+  uintptr_t const offset = (uintptr_t) datagram - (uintptr_t) receive_ntb[0];
+  TU_ASSERT(datagram >= receive_ntb[0] && offset < sizeof(receive_ntb), );
+
+  uint8_t const idx = (uint8_t) (offset / CFG_TUD_NCM_OUT_NTB_MAX_SIZE);
+  TU_VERIFY(ncm_interface.rx_pin[idx], ); // datagram may be stale after bus reset
+  ncm_interface.rx_pin[idx]--;
+
+  ncm_rx_reclaim();
+  ncm_rx_arm();
+}
+#endif
+
+/*
+ * Get index and length of datagram entry i in NDP of NTB at rx_head.
+ */
+static void ncm_rx_datagram(uint16_t i, uint32_t *index, uint32_t *length)
+{
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32)
+  {
+    const ndp32_t *ndp = (const ndp32_t *)ncm_interface.ndp;
+    *index  = ndp->datagram[i].dwDatagramIndex;
+    *length = ndp->datagram[i].dwDatagramLength;
     return;
   }
+#endif
+
+  const ndp16_t *ndp = (const ndp16_t *)ncm_interface.ndp;
+  *index  = ndp->datagram[i].wDatagramIndex;
+  *length = ndp->datagram[i].wDatagramLength;
+}
+
+/*
+ * Validate NTB at rx_head and set up its datagram list, return false if NTB is malformed.
+ */
+static bool ncm_rx_parse(void)
+{
+  uint8_t const *ntb = receive_ntb[ncm_interface.rx_head];
+  uint32_t const len = ncm_interface.rx_len[ncm_interface.rx_head];
+  uint32_t num_datagrams;
+
+  ncm_interface.current_datagram_index = 0;
+  ncm_interface.num_datagrams = 0;
+
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32)
+  {
+    TU_VERIFY(len >= sizeof(nth32_t));
+
+    const nth32_t *hdr = (const nth32_t *)ntb;
+    TU_ASSERT(hdr->dwSignature == NTH32_SIGNATURE);
+    TU_ASSERT(hdr->dwNdpIndex >= sizeof(nth32_t) && hdr->dwNdpIndex <= len - sizeof(ndp32_t));
+
+    const ndp32_t *ndp = (const ndp32_t *)(ntb + hdr->dwNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP32_SIGNATURE_NCM0 || ndp->dwSignature == NDP32_SIGNATURE_NCM1);
+    TU_ASSERT(ndp->wLength >= sizeof(ndp32_t) && hdr->dwNdpIndex + ndp->wLength <= len);
+
+    num_datagrams = (ndp->wLength - sizeof(ndp32_t)) / sizeof(ndp32_datagram_t);
+    ncm_interface.ndp = (const uint8_t *)ndp;
+  }
+  else
+#endif
+  {
+    TU_VERIFY(len >= sizeof(nth16_t));
+
+    const nth16_t *hdr = (const nth16_t *)ntb;
+    TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE);
+    TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len);
+
+    const ndp16_t *ndp = (const ndp16_t *)(ntb + hdr->wNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1);
+    TU_ASSERT(ndp->wLength >= sizeof(ndp16_t) && hdr->wNdpIndex + ndp->wLength <= len);
+
+    num_datagrams = (ndp->wLength - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t);
+    ncm_interface.ndp = (const uint8_t *)ndp;
+  }
+
+  // datagram list ends with a null entry, also stop at an entry outside of the NTB
+  for (uint16_t i = 0; i < num_datagrams && i < UINT16_MAX; i++)
+  {
+    uint32_t index, length;
+    ncm_rx_datagram(i, &index, &length);
+    if (!index || !length || index > len || length > len - index)
+    {
+      break;
+    }
+    ncm_interface.num_datagrams++;
+  }
+
+  return true;
+}
+
+/*
+ * Hand the next datagram to the stack, NTBs that are fully consumed are released for reception.
+ */
+static void ncm_rx_process(void)
+{
+  while (ncm_interface.rx_count)
+  {
+    if (ncm_interface.num_datagrams)
+    {
+      uint32_t index, length;
+      ncm_rx_datagram(ncm_interface.current_datagram_index, &index, &length);
+      ncm_interface.current_datagram_index++;
+      ncm_interface.num_datagrams--;
+
+#if CFG_TUD_NET_PACKET_FILTER
+      // datagrams rejected by host's packet filter are dropped before reaching the network stack
+      if (!netd_packet_filter_accept(&ncm_interface.filter, receive_ntb[ncm_interface.rx_head] + index, (uint16_t) length)) {
+        continue;
+      }
+#endif
 
-  const ndp16_t *ndp = ncm_interface.ndp;
-  const int i = ncm_interface.current_datagram_index;
-  ncm_interface.current_datagram_index++;
-  ncm_interface.num_datagrams--;
+#if CFG_TUD_NCM_ZERO_COPY
+      // pin NTB until the datagram is released, unless it was not accepted
+      uint8_t const head = ncm_interface.rx_head;
+      ncm_interface.rx_pin[head]++;
+      if (!tud_network_recv_cb(receive_ntb[head] + index, (uint16_t) length)) {
+        tud_network_recv_release(receive_ntb[head]);
+      }
+#else
+      tud_network_recv_cb(receive_ntb[ncm_interface.rx_head] + index, (uint16_t) length);
+#endif
+      return;
+    }
+
+    // current NTB is consumed, release it then move to the next received one
+    ncm_interface.rx_head = (ncm_interface.rx_head + 1) % CFG_TUD_NCM_OUT_NTB_N;
+    ncm_interface.rx_count--;
+#if CFG_TUD_NCM_ZERO_COPY
+    ncm_interface.rx_held++;
+    ncm_rx_reclaim();
+#endif
+    ncm_rx_arm();
 
-  tud_network_recv_cb(receive_ntb + ndp->datagram[i].wDatagramIndex, ndp->datagram[i].wDatagramLength);
+    if (ncm_interface.rx_count)
+    {
+      ncm_rx_parse();
+    }
+  }
+}
+
+void tud_network_recv_renew(void)
+{
+  if (!ncm_interface.rx_count)
+  {
+    ncm_rx_arm();
+    return;
+  }
+
+  ncm_rx_process();
 }
 
 //--------------------------------------------------------------------+
@@ -257,6 +564,9 @@ void netd_init(void)
   tu_memclr(&ncm_interface, sizeof(ncm_interface));
   ncm_interface.ntb_in_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
   ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
+#if CFG_TUD_NET_PACKET_FILTER
+  netd_packet_filter_reset(&ncm_interface.filter);
+#endif
   ncm_prepare_for_tx();
 }
 
@@ -273,6 +583,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(0 == ncm_interface.ep_notif, 0);
 
   //------------- Management Interface -------------//
+  ncm_interface.rhport  = rhport;
   ncm_interface.itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -323,7 +634,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
 
 static void ncm_report(void)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = ncm_interface.rhport;
   if (ncm_interface.report_state == REPORT_SPEED) {
     ncm_notify_speed_change.header.wIndex = ncm_interface.itf_num;
     usbd_edpt_xfer(rhport, ncm_interface.ep_notif, (uint8_t *) &ncm_notify_speed_change, sizeof(ncm_notify_speed_change));
@@ -346,6 +657,14 @@ TU_ATTR_WEAK void tud_network_link_state_cb(bool state)
 // return false to stall control endpoint (e.g unsupported request)
 bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
+#if CFG_TUD_NET_PACKET_FILTER
+  if ( stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+       ncm_interface.itf_num == request->wIndex && NCM_SET_ETHERNET_MULTICAST_FILTERS == request->bRequest )
+  {
+    netd_packet_filter_set_multicast(&ncm_interface.filter, ncm_mc_list, request->wValue);
+  }
+#endif
+
   if ( stage != CONTROL_STAGE_SETUP ) return true;
 
   switch ( request->bmRequestType_bit.type )
@@ -373,9 +692,20 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
           if (req_alt != ncm_interface.itf_data_alt) {
             ncm_interface.itf_data_alt = req_alt;
 
+            // function reverts to NTB16 when data interface is deactivated
+            if (req_alt == 0 && ncm_interface.ntb_format != NCM_NTB_FORMAT_16) {
+              ncm_interface.ntb_format = NCM_NTB_FORMAT_16;
+              ncm_prepare_for_tx();
+            }
+
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+            // SOF is the aggregation clock
+            usbd_sof_enable(rhport, ncm_interface.itf_data_alt);
+#endif
+
             if (ncm_interface.itf_data_alt) {
               if (!usbd_edpt_busy(rhport, ncm_interface.ep_out)) {
-                tud_network_recv_renew(); // prepare for incoming datagrams
+                ncm_rx_arm(); // prepare for incoming datagrams
               }
               if (!ncm_interface.report_pending) {
                 ncm_report();
@@ -401,6 +731,34 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       {
         tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
       }
+      else if (NCM_GET_NTB_FORMAT == request->bRequest)
+      {
+        tud_control_xfer(rhport, request, &ncm_interface.ntb_format, sizeof(ncm_interface.ntb_format));
+      }
+      else if (NCM_SET_NTB_FORMAT == request->bRequest)
+      {
+        // format can only be changed while data interface is inactive
+        TU_VERIFY(request->wValue <= (CFG_TUD_NCM_NTB32 ? NCM_NTB_FORMAT_32 : NCM_NTB_FORMAT_16));
+        TU_VERIFY(ncm_interface.itf_data_alt == 0);
+
+        ncm_interface.ntb_format = request->wValue;
+        ncm_prepare_for_tx();
+        tud_control_status(rhport, request);
+      }
+#if CFG_TUD_NET_PACKET_FILTER
+      else if (NCM_SET_ETHERNET_PACKET_FILTER == request->bRequest)
+      {
+        ncm_interface.filter.packet_type = request->wValue;
+        tud_control_status(rhport, request);
+      }
+      else if (NCM_SET_ETHERNET_MULTICAST_FILTERS == request->bRequest)
+      {
+        // list of wValue 6-byte addresses, applied in data stage
+        TU_VERIFY(request->wValue <= CFG_TUD_NET_MC_FILTER_MAX && request->wLength == 6*request->wValue);
+        if (0 == request->wValue) netd_packet_filter_set_multicast(&ncm_interface.filter, NULL, 0);
+        tud_control_xfer(rhport, request, ncm_mc_list, request->wLength);
+      }
+#endif
 
       break;
 
@@ -413,32 +771,29 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
 static void handle_incoming_datagram(uint32_t len)
 {
-  uint32_t size = len;
+  uint8_t const idx = (ncm_interface.rx_head + ncm_interface.rx_count) % CFG_TUD_NCM_OUT_NTB_N;
+  ncm_interface.rx_armed = false;
+  ncm_interface.rx_offset += len;
 
-  if (len == 0) {
+  // NTB larger than one transfer continues until a short packet
+  if (len == ncm_interface.rx_chunk && ncm_interface.rx_offset < CFG_TUD_NCM_OUT_NTB_MAX_SIZE)
+  {
+    ncm_rx_xfer();
     return;
   }
 
-  TU_ASSERT(size >= sizeof(nth16_t), );
-
-  const nth16_t *hdr = (const nth16_t *)receive_ntb;
-  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
-  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+  ncm_interface.rx_len[idx] = ncm_interface.rx_offset;
+  ncm_interface.rx_count++;
 
-  const ndp16_t *ndp = (const ndp16_t *)(receive_ntb + hdr->wNdpIndex);
-  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
-  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+  // receive next NTB while this one is consumed
+  ncm_rx_arm();
 
-  int num_datagrams = (ndp->wLength - 12) / 4;
-  ncm_interface.current_datagram_index = 0;
-  ncm_interface.num_datagrams = 0;
-  ncm_interface.ndp = ndp;
-  for (int i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength; i++)
+  // start consuming if the stack is not busy with previous NTBs
+  if (ncm_interface.rx_count == 1)
   {
-    ncm_interface.num_datagrams++;
+    ncm_rx_parse();
+    ncm_rx_process();
   }
-
-  tud_network_recv_renew();
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
@@ -455,12 +810,23 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   /* data transmission finished */
   if (ep_addr == ncm_interface.ep_in )
   {
+    // NTB larger than one transfer continues with next chunk
+    if (ncm_interface.transferring) {
+      ncm_interface.tx_offset += xferred_bytes;
+      if (ncm_interface.tx_offset < ncm_ntb_length(&transmit_ntb[ncm_interface.tx_head])) {
+        ncm_tx_xfer();
+        return true;
+      }
+    }
+
     if (ncm_interface.transferring) {
       ncm_interface.transferring = false;
+      ncm_interface.tx_head = (ncm_interface.tx_head + 1) % CFG_TUD_NCM_IN_NTB_N;
+      ncm_interface.tx_count--;
     }
 
-    // If there are datagrams queued up that we tried to send while this NTB was being emitted, send them now
-    if (ncm_interface.datagram_count && ncm_interface.itf_data_alt == 1) {
+    // If there are NTBs queued or datagrams that we tried to send while this NTB was being emitted, send them now
+    if ((ncm_interface.tx_count || ncm_interface.datagram_count) && ncm_interface.itf_data_alt == 1) {
       ncm_start_tx();
     }
   }
@@ -474,11 +840,43 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 }
 
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+static void ncm_tx_hold_expired(void *param)
+{
+  (void) param;
+
+  if (ncm_interface.itf_data_alt == 1) {
+    ncm_start_tx();
+  }
+}
+
+void netd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  uint32_t const now = ++ncm_interface.sof_ticks;
+
+  // send held NTB from task context once its budget runs out
+  if (ncm_interface.holding && !ncm_interface.hold_expired && (int32_t) (now - ncm_interface.hold_deadline) >= 0) {
+    ncm_interface.hold_expired = true;
+    usbd_defer_func(ncm_tx_hold_expired, NULL, true);
+  }
+}
+#endif
+
 // poll network driver for its ability to accept another packet to transmit
 bool tud_network_can_xmit(uint16_t size)
 {
   TU_VERIFY(ncm_interface.itf_data_alt == 1);
 
+  // queue the NTB being filled if it has no room left and a free one is available
+  if (ncm_interface.datagram_count && ncm_interface.tx_count + 1 < CFG_TUD_NCM_IN_NTB_N &&
+      (ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb ||
+       ncm_interface.next_datagram_offset + size > ncm_interface.ntb_in_size)) {
+    ncm_queue_ntb();
+  }
+
   if (ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb) {
     TU_LOG_DRV("NTB full [by count]\r\n");
     return false;
@@ -495,13 +893,21 @@ bool tud_network_can_xmit(uint16_t size)
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
+  transmit_ntb_t *ntb = ncm_filling_ntb();
   size_t next_datagram_offset = ncm_interface.next_datagram_offset;
 
   uint16_t size = tud_network_xmit_cb(ntb->data + next_datagram_offset, ref, arg);
 
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = ncm_interface.next_datagram_offset;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+#if CFG_TUD_NCM_NTB32
+  if (ncm_interface.ntb_format == NCM_NTB_FORMAT_32) {
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = ncm_interface.next_datagram_offset;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = size;
+  } else
+#endif
+  {
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = (uint16_t) ncm_interface.next_datagram_offset;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  }
 
   ncm_interface.datagram_count++;
   next_datagram_offset += size;
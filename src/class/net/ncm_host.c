@@ -0,0 +1,677 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_NCM)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "ncm_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_NCM_LOG_LEVEL
+  #define CFG_TUH_NCM_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_NCM_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// Notification is 8 bytes header + up to 8 bytes data (CONNECTION_SPEED_CHANGE)
+#define NCMH_NOTIF_BUFSIZE   16
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;      // communication interface
+  uint8_t itf_data;     // data interface
+  uint8_t data_alt;     // alternate setting of data interface with bulk endpoints
+  uint8_t subclass;     // ECM or NCM
+  uint8_t mac_str_idx;  // iMACAddress
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_out_size;
+
+  bool mounted;         // Enumeration is complete
+  bool link_up;
+  uint8_t mac[6];
+
+  // NTB parameters of OUT direction (NCM only)
+  uint16_t tx_ntb_max;
+  uint16_t tx_divisor;
+  uint16_t tx_remainder;
+  uint16_t tx_ndp_align;
+  uint8_t  tx_datagrams_max;
+
+  uint8_t rx_idx;       // receive buffer of the pending IN transfer
+
+  uint8_t  tx_fill;     // transmit buffer frames are written to, the other one may be in flight
+  bool     tx_zlp;      // zero-length packet is pending to terminate the sent buffer
+  uint16_t tx_sequence;
+  uint16_t tx_len;      // bytes used in fill buffer including NCM header
+  uint8_t  tx_count;    // datagrams in fill buffer
+  uint16_t tx_reserve_off;
+  uint16_t tx_reserve_len;
+  ndp16_datagram_t tx_datagram[CFG_TUH_NCM_TX_DATAGRAMS_MAX];
+
+  TUH_EPBUF_DEF(notif_buf, NCMH_NOTIF_BUFSIZE);
+  TUH_EPBUF_DEF(rx_buf0, CFG_TUH_NCM_RX_BUFSIZE);
+  TUH_EPBUF_DEF(rx_buf1, CFG_TUH_NCM_RX_BUFSIZE);
+  TUH_EPBUF_DEF(tx_buf0, CFG_TUH_NCM_TX_BUFSIZE);
+  TUH_EPBUF_DEF(tx_buf1, CFG_TUH_NCM_TX_BUFSIZE);
+} ncmh_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static ncmh_interface_t _ncmh_itf[CFG_TUH_NCM];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline ncmh_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_NCM, NULL);
+  ncmh_interface_t* p_ncm = &_ncmh_itf[idx];
+  return (p_ncm->daddr != 0) ? p_ncm : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_ncm(ncmh_interface_t const* p_ncm) {
+  return p_ncm->subclass == CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL;
+}
+
+static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t const* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr &&
+        (p_ncm->ep_in == ep_addr || p_ncm->ep_out == ep_addr || p_ncm->ep_notif == ep_addr)) {
+      return idx;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static ncmh_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_NCM; i++) {
+    if (_ncmh_itf[i].daddr == 0) return &_ncmh_itf[i];
+  }
+  return NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* get_rx_buf(ncmh_interface_t* p_ncm, uint8_t buf_idx) {
+  return buf_idx ? p_ncm->rx_buf1 : p_ncm->rx_buf0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* get_tx_buf(ncmh_interface_t* p_ncm, uint8_t buf_idx) {
+  return buf_idx ? p_ncm->tx_buf1 : p_ncm->tx_buf0;
+}
+
+// Space reserved at the start of an NCM transmit buffer for NTH16 + NDP16 with all datagram entries
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tx_ndp_offset(ncmh_interface_t const* p_ncm) {
+  return (uint16_t) tu_align((uint32_t) sizeof(nth16_t) + p_ncm->tx_ndp_align - 1, p_ncm->tx_ndp_align);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tx_header_len(ncmh_interface_t const* p_ncm) {
+  return (uint16_t) (tx_ndp_offset(p_ncm) + sizeof(ndp16_t) +
+                     (p_ncm->tx_datagrams_max + 1) * sizeof(ndp16_datagram_t));
+}
+
+// Offset of next datagram in fill buffer: datagram must start at
+// offset % wNdpOutDivisor == wNdpOutPayloadRemainder
+static uint16_t tx_next_offset(ncmh_interface_t const* p_ncm) {
+  if (!is_ncm(p_ncm)) return 0;
+
+  uint16_t const offset = p_ncm->tx_count ? p_ncm->tx_len : tx_header_len(p_ncm);
+  uint16_t const divisor = p_ncm->tx_divisor;
+  uint16_t const pad = (uint16_t) ((divisor + p_ncm->tx_remainder % divisor - offset % divisor) % divisor);
+  return (uint16_t) (offset + pad);
+}
+
+//--------------------------------------------------------------------+
+// Transfer
+//--------------------------------------------------------------------+
+
+static bool rx_start(ncmh_interface_t* p_ncm) {
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_in));
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_in, get_rx_buf(p_ncm, p_ncm->rx_idx), CFG_TUH_NCM_RX_BUFSIZE)) {
+    (void) usbh_edpt_release(p_ncm->daddr, p_ncm->ep_in);
+    return false;
+  }
+  return true;
+}
+
+static bool notif_start(ncmh_interface_t* p_ncm) {
+  TU_VERIFY(p_ncm->ep_notif);
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_notif));
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_notif, p_ncm->notif_buf, NCMH_NOTIF_BUFSIZE)) {
+    (void) usbh_edpt_release(p_ncm->daddr, p_ncm->ep_notif);
+    return false;
+  }
+  return true;
+}
+
+// Send fill buffer if bulk OUT is idle, NCM header is built from datagram table then buffers are swapped
+static bool tx_send(ncmh_interface_t* p_ncm) {
+  TU_VERIFY(p_ncm->tx_count && p_ncm->tx_reserve_len == 0);
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_out));
+
+  uint8_t* buf = get_tx_buf(p_ncm, p_ncm->tx_fill);
+  uint16_t const len = p_ncm->tx_len;
+
+  if (is_ncm(p_ncm)) {
+    uint16_t const ndp_offset = tx_ndp_offset(p_ncm);
+
+    nth16_t* nth = (nth16_t*) buf;
+    nth->dwSignature   = tu_htole32(NTH16_SIGNATURE);
+    nth->wHeaderLength = tu_htole16(sizeof(nth16_t));
+    nth->wSequence     = tu_htole16(p_ncm->tx_sequence++);
+    nth->wBlockLength  = tu_htole16(len);
+    nth->wNdpIndex     = tu_htole16(ndp_offset);
+
+    ndp16_t* ndp = (ndp16_t*) (buf + ndp_offset);
+    ndp->dwSignature   = tu_htole32(NDP16_SIGNATURE_NCM0);
+    ndp->wLength       = tu_htole16((uint16_t) (sizeof(ndp16_t) + (p_ncm->tx_count + 1) * sizeof(ndp16_datagram_t)));
+    ndp->wNextNdpIndex = 0;
+    for (uint8_t i = 0; i < p_ncm->tx_count; i++) {
+      ndp->datagram[i].wDatagramIndex  = tu_htole16(p_ncm->tx_datagram[i].wDatagramIndex);
+      ndp->datagram[i].wDatagramLength = tu_htole16(p_ncm->tx_datagram[i].wDatagramLength);
+    }
+    ndp->datagram[p_ncm->tx_count].wDatagramIndex  = 0;
+    ndp->datagram[p_ncm->tx_count].wDatagramLength = 0;
+  }
+
+  // Transfer is terminated by a short packet: NTB of exactly dwNtbOutMaxSize is the only exception
+  p_ncm->tx_zlp = (len % p_ncm->ep_out_size) == 0 && !(is_ncm(p_ncm) && len == p_ncm->tx_ntb_max);
+
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_out, buf, len)) {
+    (void) usbh_edpt_release(p_ncm->daddr, p_ncm->ep_out);
+    return false;
+  }
+
+  p_ncm->tx_fill ^= 1;
+  p_ncm->tx_count = 0;
+  p_ncm->tx_len = 0;
+
+  return true;
+}
+
+// De-aggregate received NTB16 and pass each datagram to application
+static void rx_process_ntb(uint8_t idx, uint8_t const* buf, uint16_t len) {
+  TU_VERIFY(len >= sizeof(nth16_t),);
+
+  nth16_t const* nth = (nth16_t const*) buf;
+  TU_VERIFY(tu_le32toh(nth->dwSignature) == NTH16_SIGNATURE && tu_le16toh(nth->wHeaderLength) == sizeof(nth16_t),);
+
+  uint16_t const block_len = tu_min16(tu_le16toh(nth->wBlockLength), len);
+  uint16_t ndp_offset = tu_le16toh(nth->wNdpIndex);
+
+  // NDP chain is bounded to guard against malformed NTB
+  for (uint8_t n = 0; n < 8 && ndp_offset >= sizeof(nth16_t); n++) {
+    TU_VERIFY(ndp_offset + sizeof(ndp16_t) <= block_len,);
+
+    ndp16_t const* ndp = (ndp16_t const*) (buf + ndp_offset);
+    uint32_t const signature = tu_le32toh(ndp->dwSignature);
+    TU_VERIFY(signature == NDP16_SIGNATURE_NCM0 || signature == NDP16_SIGNATURE_NCM1,);
+
+    uint16_t const ndp_len = tu_le16toh(ndp->wLength);
+    TU_VERIFY(ndp_len >= sizeof(ndp16_t) && ndp_offset + ndp_len <= block_len,);
+
+    uint16_t const count = (uint16_t) ((ndp_len - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t));
+    for (uint16_t i = 0; i < count; i++) {
+      uint16_t const dg_index = tu_le16toh(ndp->datagram[i].wDatagramIndex);
+      uint16_t const dg_len = tu_le16toh(ndp->datagram[i].wDatagramLength);
+      if (dg_index == 0 || dg_len == 0) break;
+
+      if ((uint32_t) dg_index + dg_len <= block_len) {
+        if (tuh_ncm_rx_cb) tuh_ncm_rx_cb(idx, buf + dg_index, dg_len);
+      }
+    }
+
+    ndp_offset = tu_le16toh(ndp->wNextNdpIndex);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t const* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr && p_ncm->itf_num == itf_num) return idx;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_ncm_mounted(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm);
+  return p_ncm->mounted;
+}
+
+uint8_t tuh_ncm_subclass(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm, 0);
+  return p_ncm->subclass;
+}
+
+bool tuh_ncm_get_mac(uint8_t idx, uint8_t mac[6]) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+  memcpy(mac, p_ncm->mac, 6);
+  return true;
+}
+
+bool tuh_ncm_link_up(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+  return p_ncm->link_up;
+}
+
+//--------------------------------------------------------------------+
+// Transmit API
+//--------------------------------------------------------------------+
+uint8_t* tuh_ncm_xmit_reserve(uint8_t idx, uint16_t len) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted && len, NULL);
+
+  uint16_t const limit = is_ncm(p_ncm) ? p_ncm->tx_ntb_max : CFG_TUH_NCM_TX_BUFSIZE;
+
+  // second attempt after sending full fill buffer if bus is idle
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint16_t const offset = tx_next_offset(p_ncm);
+    if (p_ncm->tx_count < p_ncm->tx_datagrams_max && (uint32_t) offset + len <= limit) {
+      p_ncm->tx_reserve_off = offset;
+      p_ncm->tx_reserve_len = len;
+      return get_tx_buf(p_ncm, p_ncm->tx_fill) + offset;
+    }
+
+    // frame does not fit into an empty buffer, or both buffers are in use
+    p_ncm->tx_reserve_len = 0;
+    if (!tx_send(p_ncm)) return NULL;
+  }
+
+  return NULL;
+}
+
+bool tuh_ncm_xmit_commit(uint8_t idx, uint16_t len) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->tx_reserve_len && len <= p_ncm->tx_reserve_len);
+
+  p_ncm->tx_reserve_len = 0;
+  if (len == 0) return true; // cancel reservation
+
+  ndp16_datagram_t* datagram = &p_ncm->tx_datagram[p_ncm->tx_count++];
+  datagram->wDatagramIndex = p_ncm->tx_reserve_off;
+  datagram->wDatagramLength = len;
+  p_ncm->tx_len = (uint16_t) (p_ncm->tx_reserve_off + len);
+
+  // send now if idle, otherwise frame is aggregated and sent when current transfer completes
+  (void) tx_send(p_ncm);
+
+  return true;
+}
+
+bool tuh_ncm_xmit(uint8_t idx, void const* frame, uint16_t len) {
+  uint8_t* buf = tuh_ncm_xmit_reserve(idx, len);
+  TU_VERIFY(buf);
+  memcpy(buf, frame, len);
+  return tuh_ncm_xmit_commit(idx, len);
+}
+
+bool tuh_ncm_xmit_flush(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+  return tx_send(p_ncm);
+}
+
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+void ncmh_init(void) {
+  tu_memclr(_ncmh_itf, sizeof(_ncmh_itf));
+}
+
+bool ncmh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_epaddr(daddr, ep_addr);
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm);
+
+  if (ep_addr == p_ncm->ep_out) {
+    if (p_ncm->tx_zlp && result == XFER_RESULT_SUCCESS) {
+      p_ncm->tx_zlp = false;
+      if (usbh_edpt_claim(daddr, ep_addr)) {
+        if (usbh_edpt_xfer(daddr, ep_addr, NULL, 0)) return true;
+        (void) usbh_edpt_release(daddr, ep_addr);
+      }
+    }
+    p_ncm->tx_zlp = false;
+
+    // frames aggregated while previous transfer was in flight
+    (void) tx_send(p_ncm);
+
+    if (tuh_ncm_tx_complete_cb) tuh_ncm_tx_complete_cb(idx);
+  } else if (ep_addr == p_ncm->ep_in) {
+    TU_VERIFY(result == XFER_RESULT_SUCCESS);
+
+    uint8_t const* buf = get_rx_buf(p_ncm, p_ncm->rx_idx);
+    uint16_t const len = (uint16_t) xferred_bytes;
+
+    // keep endpoint busy with the other buffer while this one is processed
+    p_ncm->rx_idx ^= 1;
+    (void) rx_start(p_ncm);
+
+    if (is_ncm(p_ncm)) {
+      rx_process_ntb(idx, buf, len);
+    } else if (len && tuh_ncm_rx_cb) {
+      tuh_ncm_rx_cb(idx, buf, len);
+    }
+  } else if (ep_addr == p_ncm->ep_notif) {
+    TU_VERIFY(result == XFER_RESULT_SUCCESS);
+
+    if (xferred_bytes >= sizeof(tusb_control_request_t)) {
+      tusb_control_request_t const* notif = (tusb_control_request_t const*) p_ncm->notif_buf;
+      if (notif->bRequest == CDC_NOTIF_NETWORK_CONNECTION) {
+        bool const up = (tu_le16toh(notif->wValue) != 0);
+        if (up != p_ncm->link_up) {
+          p_ncm->link_up = up;
+          TU_LOG_DRV("[%u] NCM link %s\r\n", daddr, up ? "up" : "down");
+          if (tuh_ncm_link_cb) tuh_ncm_link_cb(idx, up);
+        }
+      }
+    }
+
+    (void) notif_start(p_ncm);
+  }
+
+  return true;
+}
+
+void ncmh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr) {
+      TU_LOG_DRV("  NCMh close addr = %u index = %u\r\n", daddr, idx);
+      if (p_ncm->mounted && tuh_ncm_umount_cb) tuh_ncm_umount_cb(idx);
+      tu_memclr(p_ncm, offsetof(ncmh_interface_t, notif_buf));
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+bool ncmh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_CDC == desc_itf->bInterfaceClass &&
+            (CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == desc_itf->bInterfaceSubClass ||
+             CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == desc_itf->bInterfaceSubClass));
+  TU_LOG_DRV("[%u] NCM opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
+
+  ncmh_interface_t* p_ncm = find_new_itf();
+  TU_ASSERT(p_ncm); // not enough interface, try to increase CFG_TUH_NCM
+
+  p_ncm->daddr = daddr;
+  p_ncm->itf_num = desc_itf->bInterfaceNumber;
+  p_ncm->subclass = desc_itf->bInterfaceSubClass;
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  uint8_t const* desc_end = ((uint8_t const*) desc_itf) + max_len;
+
+  //------------- Communication interface: functional descriptors + notification endpoint -------------//
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && tu_desc_len(p_desc) >= 4 &&
+        CDC_FUNC_DESC_ETHERNET_NETWORKING == p_desc[2]) {
+      p_ncm->mac_str_idx = p_desc[3];
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer && TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+        p_ncm->ep_notif = desc_ep->bEndpointAddress;
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  //------------- Data interface: alternate 0 has no endpoint, bulk pair is in alternate 1 -------------//
+  bool bulk_itf = false;
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* desc_data = (tusb_desc_interface_t const*) p_desc;
+      if (TUSB_CLASS_CDC_DATA != desc_data->bInterfaceClass) break;
+
+      p_ncm->itf_data = desc_data->bInterfaceNumber;
+      bulk_itf = (desc_data->bNumEndpoints == 2 && p_ncm->ep_in == 0);
+      if (bulk_itf) p_ncm->data_alt = desc_data->bAlternateSetting;
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) && bulk_itf) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+      if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        p_ncm->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p_ncm->ep_out = desc_ep->bEndpointAddress;
+        p_ncm->ep_out_size = tu_edpt_packet_size(desc_ep);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  if (!(p_ncm->ep_in && p_ncm->ep_out && p_ncm->ep_out_size)) {
+    TU_LOG_DRV("  NCM data interface has no bulk endpoints\r\n");
+    tu_memclr(p_ncm, offsetof(ncmh_interface_t, notif_buf));
+    return false;
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Set Configure
+//--------------------------------------------------------------------+
+
+enum {
+  CONFIG_GET_NTB_PARAMETERS = 0,
+  CONFIG_SET_NTB_INPUT_SIZE,
+  CONFIG_GET_MAC_ADDRESS,
+  CONFIG_SET_INTERFACE,
+  CONFIG_COMPLETE
+};
+
+// user_data of internal control transfer: interface index in high byte, next state in low byte
+#define CONFIG_USER_DATA(_idx, _state)   ((uintptr_t) (((_idx) << 8) | (_state)))
+
+static void process_set_config(tuh_xfer_t* xfer);
+
+static bool ncm_control_class(ncmh_interface_t* p_ncm, uint8_t idx, uint8_t request, uint8_t dir,
+                              uint16_t len, uint8_t next_state) {
+  tusb_control_request_t const req = {
+    .bmRequestType_bit = {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = dir
+    },
+    .bRequest = request,
+    .wValue   = 0,
+    .wIndex   = tu_htole16((uint16_t) p_ncm->itf_num),
+    .wLength  = tu_htole16(len)
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_ncm->daddr,
+    .ep_addr     = 0,
+    .setup       = &req,
+    .buffer      = usbh_get_enum_buf(p_ncm->daddr),
+    .complete_cb = process_set_config,
+    .user_data   = CONFIG_USER_DATA(idx, next_state)
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+// iMACAddress is 12 hex digits in UTF-16LE
+static void parse_mac_string(ncmh_interface_t* p_ncm, uint8_t const* desc_str, uint16_t len) {
+  TU_VERIFY(len >= 2 + 24 && desc_str[0] >= 2 + 24 && desc_str[1] == TUSB_DESC_STRING,);
+
+  for (uint8_t i = 0; i < 12; i++) {
+    uint8_t const c = desc_str[2 + 2 * i];
+    uint8_t nibble;
+    if (c >= '0' && c <= '9') {
+      nibble = (uint8_t) (c - '0');
+    } else if (c >= 'A' && c <= 'F') {
+      nibble = (uint8_t) (c - 'A' + 10);
+    } else if (c >= 'a' && c <= 'f') {
+      nibble = (uint8_t) (c - 'a' + 10);
+    } else {
+      return;
+    }
+    p_ncm->mac[i / 2] = (uint8_t) ((p_ncm->mac[i / 2] << 4) | nibble);
+  }
+}
+
+static void config_mount_complete(ncmh_interface_t* p_ncm, uint8_t idx) {
+  p_ncm->mounted = true;
+  p_ncm->rx_idx = 0;
+  p_ncm->tx_fill = 0;
+
+  TU_LOG_DRV("[%u] NCM mounted: %s, MAC %02X:%02X:%02X:%02X:%02X:%02X\r\n", p_ncm->daddr,
+             is_ncm(p_ncm) ? "NCM" : "ECM", p_ncm->mac[0], p_ncm->mac[1], p_ncm->mac[2],
+             p_ncm->mac[3], p_ncm->mac[4], p_ncm->mac[5]);
+
+  if (tuh_ncm_mount_cb) tuh_ncm_mount_cb(idx);
+
+  (void) rx_start(p_ncm);
+  (void) notif_start(p_ncm);
+}
+
+bool ncmh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_ncm_itf_get_index(daddr, itf_num);
+  TU_ASSERT(idx < CFG_TUH_NCM);
+
+  tusb_control_request_t request;
+  request.bRequest = 0;
+  request.wLength = 0;
+
+  tuh_xfer_t xfer;
+  xfer.daddr = daddr;
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.setup = &request;
+  xfer.user_data = CONFIG_USER_DATA(idx, CONFIG_GET_NTB_PARAMETERS);
+
+  // fake request to kick-off the set config process
+  process_set_config(&xfer);
+
+  return true;
+}
+
+static void process_set_config(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uint8_t const state = (uint8_t) (xfer->user_data & 0xff);
+  uint8_t const daddr = xfer->daddr;
+
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->daddr == daddr,);
+  uint8_t const itf_last = tu_max8(p_ncm->itf_num, p_ncm->itf_data);
+
+  // SET_NTB_INPUT_SIZE is optional and MAC string is not required to operate, their errors are ignored
+  if (xfer->result != XFER_RESULT_SUCCESS && state != CONFIG_GET_MAC_ADDRESS && state != CONFIG_SET_INTERFACE) {
+    TU_LOG_DRV("[%u] NCM configuration failed at state %u\r\n", daddr, state);
+    usbh_driver_set_config_complete(daddr, itf_last);
+    return;
+  }
+
+  switch (state) {
+    case CONFIG_GET_NTB_PARAMETERS:
+      p_ncm->tx_ntb_max = CFG_TUH_NCM_TX_BUFSIZE;
+      p_ncm->tx_divisor = 4;
+      p_ncm->tx_remainder = 0;
+      p_ncm->tx_ndp_align = 4;
+      p_ncm->tx_datagrams_max = is_ncm(p_ncm) ? CFG_TUH_NCM_TX_DATAGRAMS_MAX : 1;
+
+      if (is_ncm(p_ncm)) {
+        TU_ASSERT(ncm_control_class(p_ncm, idx, NCM_GET_NTB_PARAMETERS, TUSB_DIR_IN, sizeof(ntb_parameters_t),
+                                    CONFIG_SET_NTB_INPUT_SIZE),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_NTB_INPUT_SIZE:
+      if (is_ncm(p_ncm)) {
+        ntb_parameters_t const* param = (ntb_parameters_t const*) usbh_get_enum_buf(daddr);
+        uint32_t const out_max = tu_le32toh(param->dwNtbOutMaxSize);
+        uint16_t const divisor = tu_le16toh(param->wNdbOutDivisor);
+        uint16_t const ndp_align = tu_le16toh(param->wNdbOutAlignment);
+        uint16_t const datagrams_max = tu_le16toh(param->wNtbOutMaxDatagrams);
+
+        if (out_max && out_max < CFG_TUH_NCM_TX_BUFSIZE) p_ncm->tx_ntb_max = (uint16_t) out_max;
+        if (divisor) p_ncm->tx_divisor = divisor;
+        p_ncm->tx_remainder = tu_le16toh(param->wNdbOutPayloadRemainder);
+        if (ndp_align > 4) p_ncm->tx_ndp_align = ndp_align;
+        if (datagrams_max && datagrams_max < CFG_TUH_NCM_TX_DATAGRAMS_MAX) p_ncm->tx_datagrams_max = (uint8_t) datagrams_max;
+
+        // limit NTB size sent by device to our receive buffer
+        if (tu_le32toh(param->dwNtbInMaxSize) > CFG_TUH_NCM_RX_BUFSIZE) {
+          uint32_t const in_max = tu_htole32(CFG_TUH_NCM_RX_BUFSIZE);
+          memcpy(usbh_get_enum_buf(daddr), &in_max, 4);
+          TU_ASSERT(ncm_control_class(p_ncm, idx, NCM_SET_NTB_INPUT_SIZE, TUSB_DIR_OUT, 4, CONFIG_GET_MAC_ADDRESS),);
+          break;
+        }
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_GET_MAC_ADDRESS:
+      if (p_ncm->mac_str_idx) {
+        TU_ASSERT(tuh_descriptor_get_string(daddr, p_ncm->mac_str_idx, 0x0409, usbh_get_enum_buf(daddr), 2 + 24,
+                                            process_set_config, CONFIG_USER_DATA(idx, CONFIG_SET_INTERFACE)),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_INTERFACE:
+      if (p_ncm->mac_str_idx && xfer->result == XFER_RESULT_SUCCESS) {
+        parse_mac_string(p_ncm, usbh_get_enum_buf(daddr), (uint16_t) xfer->actual_len);
+      }
+
+      // bulk endpoints are only active in alternate setting of data interface
+      TU_ASSERT(tuh_interface_set(daddr, p_ncm->itf_data, p_ncm->data_alt,
+                                  process_set_config, CONFIG_USER_DATA(idx, CONFIG_COMPLETE)),);
+      break;
+
+    case CONFIG_COMPLETE:
+      config_mount_complete(p_ncm, idx);
+      // itf_last to account for data interface as well
+      usbh_driver_set_config_complete(daddr, itf_last);
+      break;
+
+    default:
+      break;
+  }
+}
+
+#endif
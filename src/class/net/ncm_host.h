@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_NCM_HOST_H_
+#define _TUSB_NCM_HOST_H_
+
+#include "class/cdc/cdc.h"
+#include "ncm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//
+// Host driver for USB Ethernet adapters implementing CDC-ECM or CDC-NCM. Ethernet frames are passed to
+// and from the network stack without copy:
+// - Received frames point directly into the receive buffer, which is re-armed with a second buffer
+//   before frames of the previous transfer are handed to tuh_ncm_rx_cb().
+// - Transmitted frames are written in-place with tuh_ncm_xmit_reserve() + tuh_ncm_xmit_commit(). With NCM,
+//   frames queued while a transfer is in progress are aggregated into a single NTB for the next transfer.
+// API must be called from the same task as tuh_task().
+//--------------------------------------------------------------------+
+
+// Size of each of the 2 receive buffers: maximum NTB size (NCM) or Ethernet frame size (ECM)
+#ifndef CFG_TUH_NCM_RX_BUFSIZE
+  #define CFG_TUH_NCM_RX_BUFSIZE          2048
+#endif
+
+// Size of each of the 2 transmit buffers: maximum NTB size (NCM) or Ethernet frame size (ECM)
+#ifndef CFG_TUH_NCM_TX_BUFSIZE
+  #define CFG_TUH_NCM_TX_BUFSIZE          2048
+#endif
+
+// Maximum number of datagrams aggregated into a transmit NTB
+#ifndef CFG_TUH_NCM_TX_DATAGRAMS_MAX
+  #define CFG_TUH_NCM_TX_DATAGRAMS_MAX    8
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_NCM_RX_BUFSIZE <= UINT16_MAX && CFG_TUH_NCM_TX_BUFSIZE <= UINT16_MAX,
+                 "NCM host only supports 16-bit NTB");
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + communication interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Check if interface is mounted
+bool tuh_ncm_mounted(uint8_t idx);
+
+// Get interface subclass: CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL or CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL
+uint8_t tuh_ncm_subclass(uint8_t idx);
+
+// Get MAC address of adapter (from iMACAddress string)
+bool tuh_ncm_get_mac(uint8_t idx, uint8_t mac[6]);
+
+// Check if network link is up, as reported by NETWORK_CONNECTION notification
+bool tuh_ncm_link_up(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Transmit API
+//--------------------------------------------------------------------+
+
+// Reserve space for an Ethernet frame of up to len bytes in transmit buffer. Return NULL if both buffers
+// are in use, in which case application should retry after tuh_ncm_tx_complete_cb()
+uint8_t* tuh_ncm_xmit_reserve(uint8_t idx, uint16_t len);
+
+// Commit reserved frame with its actual length (<= reserved length). Frame is sent immediately if bus
+// is idle, otherwise it is aggregated and sent when current transfer completes
+bool tuh_ncm_xmit_commit(uint8_t idx, uint16_t len);
+
+// Copy and queue an Ethernet frame, same as reserve + memcpy + commit
+bool tuh_ncm_xmit(uint8_t idx, void const* frame, uint16_t len);
+
+// Send pending frames if bus is idle. Return true if a transfer is started
+bool tuh_ncm_xmit_flush(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when an ECM/NCM interface is mounted
+TU_ATTR_WEAK void tuh_ncm_mount_cb(uint8_t idx);
+
+// Invoked when an ECM/NCM interface is unmounted
+TU_ATTR_WEAK void tuh_ncm_umount_cb(uint8_t idx);
+
+// Invoked for each received Ethernet frame. Frame points into receive buffer and is only valid
+// until the callback returns
+TU_ATTR_WEAK void tuh_ncm_rx_cb(uint8_t idx, uint8_t const* frame, uint16_t len);
+
+// Invoked when network link state changes
+TU_ATTR_WEAK void tuh_ncm_link_cb(uint8_t idx, bool up);
+
+// Invoked when a transmit transfer completes and a buffer becomes available
+TU_ATTR_WEAK void tuh_ncm_tx_complete_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void ncmh_init(void);
+bool ncmh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool ncmh_set_config(uint8_t daddr, uint8_t itf_num);
+bool ncmh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void ncmh_close(uint8_t daddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TUSB_NCM_HOST_H_ */
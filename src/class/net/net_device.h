@@ -44,6 +44,18 @@
 #define CFG_TUD_NET_MTU           1514
 #endif
 
+// RNDIS: maximum number of REMOTE_NDIS_PACKET_MSG aggregated into a bulk transfer. Host is allowed to pack
+// that many messages into an OUT transfer, and messages queued while an IN transfer is in progress are sent
+// together in the next one (up to host's MaxTransferSize). Uses a second transmit buffer when larger than 1.
+#ifndef CFG_TUD_RNDIS_PACKETS_PER_XFER
+#define CFG_TUD_RNDIS_PACKETS_PER_XFER 1
+#endif
+
+// RNDIS packet message (44 bytes header + frame) padded to 8 bytes when aggregated
+#define TUD_RNDIS_PACKET_MSG_ALIGN  ((CFG_TUD_RNDIS_PACKETS_PER_XFER > 1) ? 8 : 1)
+#define TUD_RNDIS_XFER_SIZE         (CFG_TUD_RNDIS_PACKETS_PER_XFER * \
+                                     ((44 + CFG_TUD_NET_MTU + TUD_RNDIS_PACKET_MSG_ALIGN - 1) & ~(TUD_RNDIS_PACKET_MSG_ALIGN - 1)))
+
 #ifndef CFG_TUD_NCM_IN_NTB_MAX_SIZE
 #define CFG_TUD_NCM_IN_NTB_MAX_SIZE 3200
 #endif
@@ -56,10 +68,41 @@
 #define CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB 8
 #endif
 
+// Number of NTBs for transmitting (IN to host): one is filled with datagrams while the others are queued or
+// being sent. Must be at least 2.
+#ifndef CFG_TUD_NCM_IN_NTB_N
+#define CFG_TUD_NCM_IN_NTB_N 2
+#endif
+
+// Number of NTBs for receiving (OUT from host): next OUT transfer is armed into a free NTB while the stack
+// consumes datagrams of the previous ones.
+#ifndef CFG_TUD_NCM_OUT_NTB_N
+#define CFG_TUD_NCM_OUT_NTB_N 1
+#endif
+
+// Zero-copy reception: datagram passed to tud_network_recv_cb() stays valid after tud_network_recv_renew()
+// until it is released with tud_network_recv_release(), its NTB is only reused once all its datagrams are
+// released. CFG_TUD_NCM_OUT_NTB_N should be at least 2 so that reception can continue meanwhile.
+#ifndef CFG_TUD_NCM_ZERO_COPY
+#define CFG_TUD_NCM_ZERO_COPY 0
+#endif
+
+// Transmit aggregation budget in microseconds, 0 to disable. When the previous NTB was sent less than this
+// budget ago, a new NTB is held (up to the budget, in SOF intervals) to collect more datagrams, unless it gets
+// full first. Sparse traffic is still sent right away.
+#ifndef CFG_TUD_NCM_TX_AGGREGATION_US
+#define CFG_TUD_NCM_TX_AGGREGATION_US 0
+#endif
+
 #ifndef CFG_TUD_NCM_ALIGNMENT
 #define CFG_TUD_NCM_ALIGNMENT 4
 #endif
 
+// Support NTB32 format (selected by host with SET_NTB_FORMAT), required for NTBs larger than 64 KB
+#ifndef CFG_TUD_NCM_NTB32
+#define CFG_TUD_NCM_NTB32 0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -71,6 +114,10 @@
 // indicate to network driver that client has finished with the packet provided to network_recv_cb()
 void tud_network_recv_renew(void);
 
+// (NCM with CFG_TUD_NCM_ZERO_COPY) indicate to network driver that client no longer references a datagram
+// provided to tud_network_recv_cb() and accepted. Must be called from the same context as tud_network_recv_renew()
+void tud_network_recv_release(const uint8_t *datagram);
+
 // poll network driver for its ability to accept another packet to transmit
 bool tud_network_can_xmit(uint16_t size);
 
@@ -109,8 +156,67 @@ void     netd_reset           (uint8_t rhport);
 uint16_t netd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     netd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     netd_sof             (uint8_t rhport, uint32_t frame_count);
 void     netd_report          (uint8_t *buf, uint16_t len);
 
+#if CFG_TUD_NET_PACKET_FILTER
+//------------- ECM/NCM packet filter -------------//
+
+// Host receive filter set by SET_ETHERNET_PACKET_FILTER and SET_ETHERNET_MULTICAST_FILTERS
+typedef struct {
+  uint16_t packet_type;  // cdc_ethernet_packet_filter_t bitmap
+  uint8_t  mc_hash[8];   // multicast address hash: bit is top 6 bits of address CRC-32
+} netd_packet_filter_t;
+
+// Initial filter accepts everything until host sets one, same as before filtering was supported
+TU_ATTR_ALWAYS_INLINE static inline void netd_packet_filter_reset(netd_packet_filter_t* filter) {
+  filter->packet_type = CDC_PACKET_TYPE_PROMISCUOUS | CDC_PACKET_TYPE_ALL_MULTICAST |
+                        CDC_PACKET_TYPE_DIRECTED | CDC_PACKET_TYPE_BROADCAST;
+  tu_memclr(filter->mc_hash, sizeof(filter->mc_hash));
+}
+
+static inline uint8_t netd_packet_filter_hash(uint8_t const mac[6]) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (uint8_t i = 0; i < 6; i++) {
+    crc ^= mac[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ ((crc & 1u) ? 0xEDB88320u : 0);
+    }
+  }
+  return (uint8_t) (crc >> 26);
+}
+
+// Replace multicast hash with list of count 6-byte addresses
+static inline void netd_packet_filter_set_multicast(netd_packet_filter_t* filter, uint8_t const* list, uint16_t count) {
+  tu_memclr(filter->mc_hash, sizeof(filter->mc_hash));
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t const h = netd_packet_filter_hash(list + 6*i);
+    filter->mc_hash[h >> 3] |= (uint8_t) TU_BIT(h & 7);
+  }
+}
+
+// Check destination address of a received Ethernet frame against the filter. Unicast frames are not matched
+// against a station address: the driver does not know the device's address, the network stack checks it anyway.
+static inline bool netd_packet_filter_accept(netd_packet_filter_t const* filter, uint8_t const* frame, uint16_t len) {
+  uint16_t const type = filter->packet_type;
+
+  if (type & CDC_PACKET_TYPE_PROMISCUOUS) return true;
+  if (len < 6) return false;
+
+  if (!(frame[0] & 0x01)) return (type & CDC_PACKET_TYPE_DIRECTED) != 0;
+
+  static uint8_t const broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  if (0 == memcmp(frame, broadcast, 6)) return (type & CDC_PACKET_TYPE_BROADCAST) != 0;
+
+  if (type & CDC_PACKET_TYPE_ALL_MULTICAST) return true;
+  if (type & CDC_PACKET_TYPE_MULTICAST) {
+    uint8_t const h = netd_packet_filter_hash(frame);
+    return (filter->mc_hash[h >> 3] & TU_BIT(h & 7)) != 0;
+  }
+  return false;
+}
+#endif
+
 #ifdef __cplusplus
  }
 #endif
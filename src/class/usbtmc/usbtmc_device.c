@@ -86,6 +86,9 @@ tu_static char logMsg[150];
 // imposes a minimum buffer size of 32 bytes.
 #define USBTMCD_BUFFER_SIZE (TUD_OPT_HIGH_SPEED ? 512 : 64)
 
+// Largest bulk IN transfer queued directly from application buffer, whole number of buffers (packets)
+#define USBTMCD_BULK_IN_XFER_MAX ((0xFFFFu / USBTMCD_BUFFER_SIZE) * USBTMCD_BUFFER_SIZE)
+
 /*
  * The state machine does not allow simultaneous reading and writing. This is
  * consistent with USBTMC.
@@ -126,10 +129,10 @@ typedef struct
   uint8_t ep_int_in;
   // IN buffer is only used for first packet, not the remainder
   // in order to deal with prepending header
-  CFG_TUSB_MEM_ALIGN uint8_t ep_bulk_in_buf[USBTMCD_BUFFER_SIZE];
+  TUD_EPBUF_DEF(ep_bulk_in_buf, USBTMCD_BUFFER_SIZE);
   uint32_t ep_bulk_in_wMaxPacketSize;
   // OUT buffer receives one packet at a time
-  CFG_TUSB_MEM_ALIGN uint8_t ep_bulk_out_buf[USBTMCD_BUFFER_SIZE];
+  TUD_EPBUF_DEF(ep_bulk_out_buf, USBTMCD_BUFFER_SIZE);
   uint32_t ep_bulk_out_wMaxPacketSize;
 
   uint32_t transfer_size_remaining; // also used for requested length for bulk IN.
@@ -139,6 +142,7 @@ typedef struct
   uint8_t lastBulkInTag; // used for aborts (mostly)
 
   uint8_t const * devInBuffer; // pointer to application-layer used for transmissions
+  uint32_t devInSegRemaining;  // bytes left in current application segment pointed by devInBuffer
 
   usbtmc_capabilities_specific_t const * capabilities;
 } usbtmc_interface_state_t;
@@ -186,6 +190,33 @@ bool atomicChangeState(usbtmcd_state_enum expectedState, usbtmcd_state_enum newS
   return ret;
 }
 
+// Copy message data into bulk IN buffer starting at offset. When current segment is consumed before
+// the buffer is full, the next one is pulled from application. Return number of bytes in buffer.
+static uint32_t bulkIn_fill(uint32_t offset)
+{
+  const uint32_t txBufLen = sizeof(usbtmc_state.ep_bulk_in_buf);
+
+  while(offset < txBufLen && usbtmc_state.transfer_size_remaining > 0u)
+  {
+    if(usbtmc_state.devInSegRemaining == 0u)
+    {
+      size_t segLen = tud_usbtmc_msgBulkIn_segment_cb ? tud_usbtmc_msgBulkIn_segment_cb(&usbtmc_state.devInBuffer) : 0u;
+      TU_ASSERT(segLen > 0u, offset);
+      usbtmc_state.devInSegRemaining = tu_min32((uint32_t) segLen, usbtmc_state.transfer_size_remaining);
+    }
+
+    uint32_t const count = tu_min32(txBufLen - offset, usbtmc_state.devInSegRemaining);
+    memcpy((uint8_t*)(usbtmc_state.ep_bulk_in_buf) + offset, usbtmc_state.devInBuffer, count);
+    usbtmc_state.devInBuffer += count;
+    usbtmc_state.devInSegRemaining -= count;
+    usbtmc_state.transfer_size_remaining -= count;
+    usbtmc_state.transfer_size_sent += count;
+    offset += count;
+  }
+
+  return offset;
+}
+
 // called from app
 // We keep a reference to the buffer, so it MUST not change until the app is
 // notified that the transfer is complete.
@@ -197,18 +228,29 @@ bool tud_usbtmc_transmit_dev_msg_data(
     const void * data, size_t len,
     bool endOfMessage,
     bool usingTermChar)
+{
+  return tud_usbtmc_transmit_dev_msg_data_stream(data, len, len, endOfMessage, usingTermChar);
+}
+
+// First segment is sent together with the header, remaining segments of total_len are
+// pulled with tud_usbtmc_msgBulkIn_segment_cb() as the transfer progresses.
+bool tud_usbtmc_transmit_dev_msg_data_stream(
+    const void * data, size_t len, size_t total_len,
+    bool endOfMessage,
+    bool usingTermChar)
 {
   const unsigned int txBufLen = sizeof(usbtmc_state.ep_bulk_in_buf);
 
 #ifndef NDEBUG
   TU_ASSERT(len > 0u);
-  TU_ASSERT(len <= usbtmc_state.transfer_size_remaining);
+  TU_ASSERT(len <= total_len);
+  TU_ASSERT(total_len <= usbtmc_state.transfer_size_remaining);
   TU_ASSERT(usbtmc_state.transfer_size_sent == 0u);
   if(usingTermChar)
   {
     TU_ASSERT(usbtmc_state.capabilities->bmDevCapabilities.canEndBulkInOnTermChar);
     TU_ASSERT(termCharRequested);
-    TU_ASSERT(((uint8_t const*)data)[len-1u] == termChar);
+    if (len == total_len) TU_ASSERT(((uint8_t const*)data)[len-1u] == termChar);
   }
 #endif
 
@@ -218,20 +260,16 @@ bool tud_usbtmc_transmit_dev_msg_data(
   hdr->header.MsgID = USBTMC_MSGID_DEV_DEP_MSG_IN;
   hdr->header.bTag = usbtmc_state.lastBulkInTag;
   hdr->header.bTagInverse = (uint8_t)~(usbtmc_state.lastBulkInTag);
-  hdr->TransferSize = len;
+  hdr->TransferSize = total_len;
   hdr->bmTransferAttributes.EOM = endOfMessage;
   hdr->bmTransferAttributes.UsingTermChar = usingTermChar;
 
-  // Copy in the header
-  const size_t headerLen = sizeof(*hdr);
-  const size_t dataLen = ((headerLen + hdr->TransferSize) <= txBufLen) ?
-                            len : (txBufLen - headerLen);
-  const size_t packetLen = headerLen + dataLen;
-
-  memcpy((uint8_t*)(usbtmc_state.ep_bulk_in_buf) + headerLen, data, dataLen);
-  usbtmc_state.transfer_size_remaining = len - dataLen;
-  usbtmc_state.transfer_size_sent = dataLen;
-  usbtmc_state.devInBuffer = (uint8_t const*) data + (dataLen);
+  // Copy in the header, followed by as much data as fits
+  usbtmc_state.transfer_size_remaining = total_len;
+  usbtmc_state.transfer_size_sent = 0u;
+  usbtmc_state.devInBuffer = (uint8_t const*) data;
+  usbtmc_state.devInSegRemaining = len;
+  const size_t packetLen = bulkIn_fill(sizeof(*hdr));
 
   bool stateChanged =
       atomicChangeState(STATE_TX_REQUESTED, (packetLen >= txBufLen) ? STATE_TX_INITIATED : STATE_TX_SHORTED);
@@ -538,22 +576,26 @@ bool usbtmcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint
       break;
 
     case STATE_TX_INITIATED:
-      if(usbtmc_state.transfer_size_remaining >= sizeof(usbtmc_state.ep_bulk_in_buf))
+      if(usbtmc_state.devInSegRemaining >= sizeof(usbtmc_state.ep_bulk_in_buf))
       {
+        // Queue as many whole buffers as possible directly from the application segment
+        uint32_t const xferLen = tu_min32(usbtmc_state.devInSegRemaining - (usbtmc_state.devInSegRemaining % USBTMCD_BUFFER_SIZE),
+                                          USBTMCD_BULK_IN_XFER_MAX);
         // FIXME! This removes const below!
         TU_VERIFY( usbd_edpt_xfer(rhport, usbtmc_state.ep_bulk_in,
-            (void*)(uintptr_t) usbtmc_state.devInBuffer, sizeof(usbtmc_state.ep_bulk_in_buf)));
-        usbtmc_state.devInBuffer += sizeof(usbtmc_state.ep_bulk_in_buf);
-        usbtmc_state.transfer_size_remaining -= sizeof(usbtmc_state.ep_bulk_in_buf);
-        usbtmc_state.transfer_size_sent += sizeof(usbtmc_state.ep_bulk_in_buf);
+            (void*)(uintptr_t) usbtmc_state.devInBuffer, (uint16_t) xferLen));
+        usbtmc_state.devInBuffer += xferLen;
+        usbtmc_state.devInSegRemaining -= xferLen;
+        usbtmc_state.transfer_size_remaining -= xferLen;
+        usbtmc_state.transfer_size_sent += xferLen;
       }
-      else // last packet
+      else // tail of segment, or last packet
       {
-        size_t packetLen = usbtmc_state.transfer_size_remaining;
-        memcpy(usbtmc_state.ep_bulk_in_buf, usbtmc_state.devInBuffer, usbtmc_state.transfer_size_remaining);
-          usbtmc_state.transfer_size_sent += sizeof(usbtmc_state.transfer_size_remaining);
-        usbtmc_state.transfer_size_remaining = 0;
-        usbtmc_state.devInBuffer = NULL;
+        size_t packetLen = bulkIn_fill(0);
+        if(usbtmc_state.transfer_size_remaining == 0u)
+        {
+          usbtmc_state.devInBuffer = NULL;
+        }
         TU_VERIFY( usbd_edpt_xfer(rhport, usbtmc_state.ep_bulk_in, usbtmc_state.ep_bulk_in_buf, (uint16_t)packetLen) );
         if(((packetLen % usbtmc_state.ep_bulk_in_wMaxPacketSize) != 0) || (packetLen == 0 ))
         {
@@ -706,6 +748,7 @@ bool usbtmcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request
     {
       rsp.USBTMC_status = USBTMC_STATUS_SUCCESS;
     usbtmc_state.transfer_size_remaining = 0u;
+    usbtmc_state.devInSegRemaining = 0u;
       // Check if we've queued a short packet
       criticalEnter();
       usbtmc_state.state = ((usbtmc_state.transfer_size_sent % usbtmc_state.ep_bulk_in_wMaxPacketSize) == 0) ?
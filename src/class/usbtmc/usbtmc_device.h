@@ -63,6 +63,9 @@ void tud_usbtmc_bulkOut_clearFeature_cb(void); // Notice to clear and abort the
 
 bool tud_usbtmc_msgBulkIn_request_cb(usbtmc_msg_request_dev_dep_in const * request);
 bool tud_usbtmc_msgBulkIn_complete_cb(void);
+// Streaming transmit: return next segment of message data and its length. Previous segment is no longer
+// referenced once this is invoked. Segments of at least one packet are sent without copying.
+TU_ATTR_WEAK size_t tud_usbtmc_msgBulkIn_segment_cb(uint8_t const ** data);
 void tud_usbtmc_bulkIn_clearFeature_cb(void); // Notice to clear and abort the pending BULK out transfer
 
 bool tud_usbtmc_initiate_abort_bulk_in_cb(uint8_t *tmcResult);
@@ -93,6 +96,12 @@ bool tud_usbtmc_transmit_dev_msg_data(
     const void * data, size_t len,
     bool endOfMessage, bool usingTermChar);
 
+// Transmit total_len bytes of message data, starting with the first segment (data, len).
+// Remaining segments are requested with tud_usbtmc_msgBulkIn_segment_cb()
+bool tud_usbtmc_transmit_dev_msg_data_stream(
+    const void * data, size_t len, size_t total_len,
+    bool endOfMessage, bool usingTermChar);
+
 bool tud_usbtmc_start_bus_read(void);
 
 
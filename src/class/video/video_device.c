@@ -98,6 +98,25 @@ typedef union {
   tusb_desc_video_frame_framebased_t  frame_based;
 } tusb_desc_cs_video_frm_t;
 
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+/* frame waiting for transfer */
+typedef struct TU_ATTR_PACKED {
+  uint8_t *buffer;
+  uint32_t bufsize;
+  uint32_t pts;
+  bool     in_place;
+} videod_frame_t;
+#endif
+
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+/* encoded slice waiting for transfer */
+typedef struct TU_ATTR_PACKED {
+  uint8_t const *buffer;
+  uint32_t bufsize;
+  bool     end_of_frame;
+} videod_slice_t;
+#endif
+
 /* video streaming interface */
 typedef struct TU_ATTR_PACKED {
   uint8_t index_vc;  /* index of bound video control interface */
@@ -114,8 +133,35 @@ typedef struct TU_ATTR_PACKED {
   uint32_t max_payload_transfer_size;
   uint8_t  error_code;/* error code */
   uint8_t  state;    /* 0:probing 1:committed 2:streaming */
+  uint8_t  in_place; /* payload headers are written in front of payload data into the frame buffer */
+  uint8_t *saved_at; /* frame buffer location overwritten by the payload header in transfer */
+  uint8_t  saved_len;
+  uint8_t  saved[TUD_VIDEO_FRAME_HEADROOM]; /* original bytes at saved_at */
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+  uint8_t  queue_rd;    /* index of the oldest queued frame */
+  uint8_t  queue_count; /* number of queued frames */
+  videod_frame_t queue[CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH];
+#endif
+  /* Index of format and frame descriptors, offsets from the video control interface descriptor */
+  uint8_t  num_fmt;      /* number of indexed formats, 0 if not indexed */
+  uint8_t  frm_first[CFG_TUD_VIDEO_STREAMING_MAX_FORMATS]; /* first frm_ofs entry of each format */
+  uint8_t  frm_count[CFG_TUD_VIDEO_STREAMING_MAX_FORMATS]; /* number of frames of each format */
+  uint16_t fmt_ofs[CFG_TUD_VIDEO_STREAMING_MAX_FORMATS];
+  uint16_t frm_ofs[CFG_TUD_VIDEO_STREAMING_MAX_FRAMES];
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+  uint8_t  slice_rd;     /* index of the oldest queued slice */
+  uint8_t  slice_count;  /* number of queued slices */
+  uint8_t  slicing;      /* a frame is built from slices */
+  uint8_t  slice_busy;   /* a payload built from slices is in transfer */
+  uint8_t  slice_eof;    /* the payload in transfer ends the frame */
+  uint32_t slice_offset; /* offset in the oldest slice */
+  videod_slice_t slices[CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH];
+#endif
   /*------------- From this point, data is not cleared by bus reset -------------*/
-  CFG_TUSB_MEM_ALIGN uint8_t ep_buf[CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE]; /* EP transfer buffer for streaming */
+  TUD_EPBUF_DEF(ep_buf, CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE); /* EP transfer buffer for streaming */
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  tud_video_converter_t const *converter; /* pixel format conversion while copying into the EP buffer */
+#endif
 } videod_streaming_interface_t;
 
 /* video control interface */
@@ -126,6 +172,7 @@ typedef struct TU_ATTR_PACKED {
   uint8_t     stm[CFG_TUD_VIDEO_STREAMING]; /* Indices of streaming interface */
   uint8_t error_code;  /* error code */
   uint8_t power_mode;
+  uint8_t rhport;      /* port this interface is opened on */
 
   /*------------- From this point, data is not cleared by bus reset -------------*/
   // CFG_TUSB_MEM_ALIGN uint8_t ctl_buf[64]; /* EP transfer buffer for interrupt transfer */
@@ -140,6 +187,21 @@ typedef struct TU_ATTR_PACKED {
 CFG_TUD_MEM_SECTION tu_static videod_interface_t _videod_itf[CFG_TUD_VIDEO];
 CFG_TUD_MEM_SECTION tu_static videod_streaming_interface_t _videod_streaming_itf[CFG_TUD_VIDEO_STREAMING];
 
+/* Frame and slice queues are accessed by application and USBD task */
+#if (CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH || CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH) && OSAL_MUTEX_REQUIRED
+tu_static osal_mutex_def_t _videod_queue_mutexdef;
+tu_static osal_mutex_t     _videod_queue_mutex;
+  #define _queue_lock()    osal_mutex_lock(_videod_queue_mutex, OSAL_TIMEOUT_WAIT_FOREVER)
+  #define _queue_unlock()  osal_mutex_unlock(_videod_queue_mutex)
+#else
+  #define _queue_lock()
+  #define _queue_unlock()
+#endif
+
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+tu_static volatile uint16_t _videod_sof_count; /* 11 bit USB frame number of the latest SOF */
+#endif
+
 tu_static uint8_t const _cap_get     = 0x1u; /* support for GET */
 tu_static uint8_t const _cap_get_set = 0x3u; /* support for GET and SET */
 
@@ -351,7 +413,7 @@ static inline void const *_find_desc_format(void const *beg, void const *end, ui
     if ((fmt == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED ||
          fmt == VIDEO_CS_ITF_VS_FORMAT_MJPEG ||
          fmt == VIDEO_CS_ITF_VS_FORMAT_DV ||
-         fmt == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) &&
+         fmt == VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED) &&
         fmtnum == p[3]) {
       return cur;
     }
@@ -377,9 +439,110 @@ static inline void const *_find_desc_frame(void const *beg, void const *end, uin
   return end;
 }
 
+/** Index the format and frame descriptors of the video streaming interface, so that probe and commit
+ *  negotiation does not walk the descriptors for each request. The index is left empty if the descriptors
+ *  exceed CFG_TUD_VIDEO_STREAMING_MAX_FORMATS or CFG_TUD_VIDEO_STREAMING_MAX_FRAMES. */
+static void _index_vs_descriptors(videod_streaming_interface_t *stm)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  tusb_desc_vs_itf_t const *vs = (tusb_desc_vs_itf_t const*)(desc + stm->desc.beg);
+  void const *end = _end_of_streaming_descriptor(vs);
+  TU_ASSERT(end <= (void const*)(desc + stm->desc.end), );
+
+  uint_fast8_t const num_fmt = vs->stm.bNumFormats;
+  if (!num_fmt || num_fmt > CFG_TUD_VIDEO_STREAMING_MAX_FORMATS) return;
+
+  uint_fast8_t num_frm = 0;
+  int_fast16_t cur_fmt = -1;
+  for (void const *cur = _find_desc(tu_desc_next(vs), end, TUSB_DESC_CS_INTERFACE); cur < end;
+       cur = _find_desc(tu_desc_next(cur), end, TUSB_DESC_CS_INTERFACE)) {
+    uint8_t const *p = (uint8_t const *)cur;
+    switch (p[2]) {
+      case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+      case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+      case VIDEO_CS_ITF_VS_FORMAT_DV:
+      case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED: {
+        tusb_desc_cs_video_fmt_t const *fmt = (tusb_desc_cs_video_fmt_t const*)cur;
+        if (!fmt->bFormatIndex || fmt->bFormatIndex > num_fmt) return;
+        if (num_frm + fmt->bNumFrameDescriptors > CFG_TUD_VIDEO_STREAMING_MAX_FRAMES) return;
+        cur_fmt = fmt->bFormatIndex - 1;
+        stm->fmt_ofs[cur_fmt]   = (uint16_t) (p - desc);
+        stm->frm_first[cur_fmt] = (uint8_t) num_frm;
+        stm->frm_count[cur_fmt] = fmt->bNumFrameDescriptors;
+        num_frm += fmt->bNumFrameDescriptors;
+        break;
+      }
+
+      case VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED:
+      case VIDEO_CS_ITF_VS_FRAME_MJPEG:
+      case VIDEO_CS_ITF_VS_FRAME_FRAME_BASED: {
+        uint_fast8_t const frmnum = p[3];
+        if (cur_fmt < 0 || !frmnum || frmnum > stm->frm_count[cur_fmt]) return;
+        stm->frm_ofs[stm->frm_first[cur_fmt] + frmnum - 1] = (uint16_t) (p - desc);
+        break;
+      }
+
+      default: break;
+    }
+  }
+  stm->num_fmt = (uint8_t) num_fmt;
+}
+
+/** Return the format descriptor with the specified format number, or end if not found. */
+static void const *_lookup_format(videod_streaming_interface_t const *stm, void const *beg, void const *end, uint_fast8_t fmtnum)
+{
+  if (!stm->num_fmt) return _find_desc_format(beg, end, fmtnum);
+  if (!fmtnum || fmtnum > stm->num_fmt || !stm->fmt_ofs[fmtnum - 1]) return end;
+  return _videod_itf[stm->index_vc].beg + stm->fmt_ofs[fmtnum - 1];
+}
+
+/** Return the frame descriptor with the specified frame number of the format, or end if not found. */
+static void const *_lookup_frame(videod_streaming_interface_t const *stm, uint_fast8_t fmtnum,
+                                 void const *beg, void const *end, uint_fast8_t frmnum)
+{
+  if (!stm->num_fmt) return _find_desc_frame(beg, end, frmnum);
+  if (!fmtnum || fmtnum > stm->num_fmt || !frmnum || frmnum > stm->frm_count[fmtnum - 1]) return end;
+  uint16_t const ofs = stm->frm_ofs[stm->frm_first[fmtnum - 1] + frmnum - 1];
+  if (!ofs) return end;
+  return _videod_itf[stm->index_vc].beg + ofs;
+}
+
 /** Set uniquely determined values to variables that have not been set
  *
  * @param[in,out] param       Target */
+/** Frame interval fields are located behind dwBytesPerLine for frame based and behind dwMaxVideoFrameBufferSize
+ *  for uncompressed and MJPEG frames. */
+static uint_fast8_t _frm_interval_type(tusb_desc_cs_video_fmt_t const *fmt, tusb_desc_cs_video_frm_t const *frm)
+{
+  if (VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED == fmt->bDescriptorSubType) return frm->frame_based.bFrameIntervalType;
+  return frm->uncompressed.bFrameIntervalType;
+}
+
+static uint_fast32_t _frm_default_interval(tusb_desc_cs_video_fmt_t const *fmt, tusb_desc_cs_video_frm_t const *frm)
+{
+  if (VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED == fmt->bDescriptorSubType) return frm->frame_based.dwDefaultFrameInterval;
+  return frm->uncompressed.dwDefaultFrameInterval;
+}
+
+static uint_fast32_t _frm_interval(tusb_desc_cs_video_fmt_t const *fmt, tusb_desc_cs_video_frm_t const *frm, uint_fast8_t idx)
+{
+  if (VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED == fmt->bDescriptorSubType) return frm->frame_based.dwFrameInterval[idx];
+  return frm->uncompressed.dwFrameInterval[idx];
+}
+
+/** Maximum frame size: compressed frames are variable in size and bounded by the YUV422 frame size. */
+static uint_fast32_t _frm_max_size(tusb_desc_cs_video_fmt_t const *fmt, tusb_desc_cs_video_frm_t const *frm)
+{
+  switch (fmt->bDescriptorSubType) {
+    case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+      return (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
+    case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+    case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+      return (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
+    default: return 0;
+  }
+}
+
 static bool _update_streaming_parameters(videod_streaming_interface_t const *stm,
                                          video_probe_and_commit_control_t *param)
 {
@@ -406,7 +569,7 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
   param->bBitDepthLuma    = 8;
 
   void const *end = _end_of_streaming_descriptor(vs);
-  tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
+  tusb_desc_cs_video_fmt_t const *fmt = _lookup_format(stm, tu_desc_next(vs), end, fmtnum);
   TU_ASSERT(fmt != end);
 
   switch (fmt->bDescriptorSubType) {
@@ -414,6 +577,7 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
       param->wCompQuality = 1; /* 1 to 10000 */
       break;
   case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+  case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
       break;
     default: return false;
   }
@@ -425,32 +589,24 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
     frmnum = 1;
     param->bFrameIndex = 1;
   }
-  tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
+  tusb_desc_cs_video_frm_t const *frm = _lookup_frame(stm, fmtnum, tu_desc_next(fmt), end, frmnum);
   TU_ASSERT(frm != end);
 
   /* Set the parameters determined by the frame  */
   uint_fast32_t frame_size = param->dwMaxVideoFrameSize;
   if (!frame_size) {
-    switch (fmt->bDescriptorSubType) {
-      case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
-        break;
-      case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
-        break;
-      default: break;
-    }
+    frame_size = _frm_max_size(fmt, frm);
     param->dwMaxVideoFrameSize = frame_size;
   }
 
   uint_fast32_t interval = param->dwFrameInterval;
   if (!interval) {
-    if ((1 < frm->uncompressed.bFrameIntervalType) ||
-        ((0 == frm->uncompressed.bFrameIntervalType) &&
-         (frm->uncompressed.dwFrameInterval[1] != frm->uncompressed.dwFrameInterval[0]))) {
+    if ((1 < _frm_interval_type(fmt, frm)) ||
+        ((0 == _frm_interval_type(fmt, frm)) &&
+         (_frm_interval(fmt, frm, 1) != _frm_interval(fmt, frm, 0)))) {
       return true;
     }
-    interval = frm->uncompressed.dwFrameInterval[0];
+    interval = _frm_interval(fmt, frm, 0);
     param->dwFrameInterval = interval;
   }
   uint_fast32_t interval_ms = interval / 10000;
@@ -505,7 +661,7 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     tusb_desc_vs_itf_t const *vs = _get_desc_vs(stm);
     TU_ASSERT(vs);
     void const *end = _end_of_streaming_descriptor(vs);
-    tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
+    tusb_desc_cs_video_fmt_t const *fmt = _lookup_format(stm, tu_desc_next(vs), end, fmtnum);
     switch (request) {
       case VIDEO_REQUEST_GET_MAX:
         frmnum = fmt->bNumFrameDescriptors;
@@ -521,6 +677,9 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
         case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
           frmnum = fmt->mjpeg.bDefaultFrameIndex;
           break;
+        case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+          frmnum = fmt->frame_based.bDefaultFrameIndex;
+          break;
         default: return false;
         }
         break;
@@ -528,17 +687,9 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     }
     param->bFrameIndex = (uint8_t)frmnum;
     /* Set the parameters determined by the frame */
-    tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
-    uint_fast32_t frame_size;
-    switch (fmt->bDescriptorSubType) {
-      case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
-        break;
-      case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
-        break;
-      default: return false;
-    }
+    tusb_desc_cs_video_frm_t const *frm = _lookup_frame(stm, fmtnum, tu_desc_next(fmt), end, frmnum);
+    uint_fast32_t frame_size = _frm_max_size(fmt, frm);
+    if (!frame_size) return false;
     param->dwMaxVideoFrameSize = frame_size;
     return true;
   }
@@ -547,17 +698,17 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     tusb_desc_vs_itf_t const *vs = _get_desc_vs(stm);
     TU_ASSERT(vs);
     void const *end = _end_of_streaming_descriptor(vs);
-    tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
-    tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
+    tusb_desc_cs_video_fmt_t const *fmt = _lookup_format(stm, tu_desc_next(vs), end, fmtnum);
+    tusb_desc_cs_video_frm_t const *frm = _lookup_frame(stm, fmtnum, tu_desc_next(fmt), end, frmnum);
 
     uint_fast32_t interval, interval_ms;
     switch (request) {
       case VIDEO_REQUEST_GET_MAX:
         {
           uint_fast32_t min_interval, max_interval;
-          uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
-          max_interval = num_intervals ? frm->uncompressed.dwFrameInterval[num_intervals - 1]: frm->uncompressed.dwFrameInterval[1];
-          min_interval = frm->uncompressed.dwFrameInterval[0];
+          uint_fast8_t num_intervals = _frm_interval_type(fmt, frm);
+          max_interval = num_intervals ? _frm_interval(fmt, frm, num_intervals - 1): _frm_interval(fmt, frm, 1);
+          min_interval = _frm_interval(fmt, frm, 0);
           interval = max_interval;
           interval_ms = min_interval / 10000;
         }
@@ -565,25 +716,25 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
       case VIDEO_REQUEST_GET_MIN:
         {
           uint_fast32_t min_interval, max_interval;
-          uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
-          max_interval = num_intervals ? frm->uncompressed.dwFrameInterval[num_intervals - 1]: frm->uncompressed.dwFrameInterval[1];
-          min_interval = frm->uncompressed.dwFrameInterval[0];
+          uint_fast8_t num_intervals = _frm_interval_type(fmt, frm);
+          max_interval = num_intervals ? _frm_interval(fmt, frm, num_intervals - 1): _frm_interval(fmt, frm, 1);
+          min_interval = _frm_interval(fmt, frm, 0);
           interval = min_interval;
           interval_ms = max_interval / 10000;
         }
         break;
       case VIDEO_REQUEST_GET_DEF:
-        interval = frm->uncompressed.dwDefaultFrameInterval;
+        interval = _frm_default_interval(fmt, frm);
         interval_ms = interval / 10000;
         break;
       case VIDEO_REQUEST_GET_RES:
         {
-          uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
+          uint_fast8_t num_intervals = _frm_interval_type(fmt, frm);
           if (num_intervals) {
             interval = 0;
             interval_ms = 0;
           } else {
-            interval = frm->uncompressed.dwFrameInterval[2];
+            interval = _frm_interval(fmt, frm, 2);
             interval_ms = interval / 10000;
           }
         }
@@ -687,6 +838,49 @@ static bool _init_vs_configuration(videod_streaming_interface_t *stm)
   return _update_streaming_parameters(stm, param);
 }
 
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+/** Read the source clock of the video function the streaming interface belongs to. */
+static uint32_t _read_clock(videod_streaming_interface_t const *stm)
+{
+  return tud_video_clock_cb ? tud_video_clock_cb(stm->index_vc, stm->index_vs) : 0;
+}
+#endif
+
+/** Update the payload header for the start of a new frame. */
+static void _begin_frame(videod_streaming_interface_t *stm, uint32_t pts)
+{
+  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
+  hdr->FrameID   ^= 1;
+  hdr->EndOfFrame = 0;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  tu_unaligned_write32(&stm->ep_buf[2], pts);
+#else
+  (void) pts;
+#endif
+}
+
+/** Put back frame buffer bytes overwritten by the payload header of an in place transfer. */
+static void _restore_in_payload(videod_streaming_interface_t *stm)
+{
+  if (!stm->saved_at) return;
+  memcpy(stm->saved_at, stm->saved, stm->saved_len);
+  stm->saved_at = NULL;
+}
+
+/** Drop queued slices and the frame built from them. Must be called with the queue locked. */
+static void _clear_slices(videod_streaming_interface_t *stm)
+{
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+  stm->slice_count  = 0;
+  stm->slicing      = 0;
+  stm->slice_busy   = 0;
+  stm->slice_eof    = 0;
+  stm->slice_offset = 0;
+#else
+  (void) stm;
+#endif
+}
+
 /** Set the alternate setting to own video streaming interface.
  *
  * @param[in,out] stm      Streaming interface context.
@@ -708,9 +902,16 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   }
 
   /* clear transfer management information */
+  _restore_in_payload(stm);
+  _queue_lock();
   stm->buffer  = NULL;
   stm->bufsize = 0;
   stm->offset  = 0;
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+  stm->queue_count = 0;
+#endif
+  _clear_slices(stm);
+  _queue_unlock();
 
   /* Find a alternate interface */
   uint8_t const *beg = desc + stm->desc.beg;
@@ -731,9 +932,11 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
     tusb_desc_endpoint_t const *ep = (tusb_desc_endpoint_t const*)cur;
     uint_fast32_t max_size = stm->max_payload_transfer_size;
     if (altnum) {
+      /* A payload is sent within one (micro)frame, high bandwidth EPs have up to 2 additional transactions */
+      uint_fast32_t const mult = 1u + ((tu_le16toh(ep->wMaxPacketSize) >> 11) & 0x3u);
       if ((TUSB_XFER_ISOCHRONOUS == ep->bmAttributes.xfer) &&
-          (tu_edpt_packet_size(ep) < max_size)) {
-        /* FS must be less than or equal to max packet size */
+          (tu_edpt_packet_size(ep) * mult < max_size)) {
+        /* Payload must be less than or equal to max packet size times transactions per microframe */
         return false;
       }
     } else {
@@ -746,30 +949,211 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   if (altnum) {
     stm->state = VS_STATE_STREAMING;
   }
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  /* SOF counter is part of SCR */
+  if (stm->desc.ep[0]) usbd_sof_enable(rhport, true);
+#endif
   TU_LOG_DRV("    done\r\n");
   return true;
 }
 
-/** Prepare the next packet payload. */
-static uint_fast16_t _prepare_in_payload(videod_streaming_interface_t *stm)
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+/* Expand RGB565 to 8 bit components, conversion to YUV uses BT.601 limited range */
+static inline void _rgb565_to_rgb888(uint_fast16_t px, int_fast16_t *r, int_fast16_t *g, int_fast16_t *b)
+{
+  uint_fast16_t const r5 = (px >> 11) & 0x1Fu;
+  uint_fast16_t const g6 = (px >> 5) & 0x3Fu;
+  uint_fast16_t const b5 = px & 0x1Fu;
+  *r = (int_fast16_t) ((r5 << 3) | (r5 >> 2));
+  *g = (int_fast16_t) ((g6 << 2) | (g6 >> 4));
+  *b = (int_fast16_t) ((b5 << 3) | (b5 >> 2));
+}
+
+static inline uint8_t _rgb_to_y(int_fast16_t r, int_fast16_t g, int_fast16_t b)
 {
-  uint_fast16_t remaining = stm->bufsize - stm->offset;
-  uint_fast16_t hdr_len   = stm->ep_buf[0];
-  uint_fast16_t pkt_len   = stm->max_payload_transfer_size;
-  if (hdr_len + remaining < pkt_len) {
-    pkt_len = hdr_len + remaining;
+  return (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static void _convert_rgb565_yuy2(uint8_t *dst, uint8_t const *src, uint_fast32_t dst_len)
+{
+  for (uint_fast32_t i = 0; i < dst_len; i += 4, src += 4, dst += 4) {
+    int_fast16_t r0, g0, b0, r1, g1, b1;
+    _rgb565_to_rgb888(tu_unaligned_read16(src), &r0, &g0, &b0);
+    _rgb565_to_rgb888(tu_unaligned_read16(src + 2), &r1, &g1, &b1);
+    /* chroma of the pixel pair */
+    int_fast32_t const r = r0 + r1, g = g0 + g1, b = b0 + b1;
+    dst[0] = _rgb_to_y(r0, g0, b0);
+    dst[1] = (uint8_t) (((-38 * r - 74 * g + 112 * b + 256) >> 9) + 128);
+    dst[2] = _rgb_to_y(r1, g1, b1);
+    dst[3] = (uint8_t) (((112 * r - 94 * g - 18 * b + 256) >> 9) + 128);
   }
-  uint_fast16_t data_len = pkt_len - hdr_len;
-  memcpy(&stm->ep_buf[hdr_len], stm->buffer + stm->offset, data_len);
-  stm->offset += data_len;
-  remaining -= data_len;
-  if (!remaining) {
-    tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
-    hdr->EndOfFrame = 1;
+}
+
+static void _convert_rgb565_y8(uint8_t *dst, uint8_t const *src, uint_fast32_t dst_len)
+{
+  for (uint_fast32_t i = 0; i < dst_len; ++i, src += 2) {
+    int_fast16_t r, g, b;
+    _rgb565_to_rgb888(tu_unaligned_read16(src), &r, &g, &b);
+    dst[i] = _rgb_to_y(r, g, b);
   }
-  return hdr_len + data_len;
 }
 
+tud_video_converter_t const tud_video_convert_rgb565_yuy2 = { _convert_rgb565_yuy2, 4, 4 };
+tud_video_converter_t const tud_video_convert_rgb565_y8   = { _convert_rgb565_y8,   2, 1 };
+#endif
+
+/** Byte size of the payload data of a frame buffer with bufsize bytes. */
+static uint32_t _frame_out_size(videod_streaming_interface_t const *stm, uint32_t bufsize)
+{
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  tud_video_converter_t const *conv = stm->converter;
+  if (conv) return bufsize / conv->src_unit * conv->dst_unit;
+#else
+  (void) stm;
+#endif
+  return bufsize;
+}
+
+/** Number of payloads to be packed into one transfer.
+ *  Bulk transfers carry as many payloads as fit into the EP buffer. Since the host takes a short packet as the end of a
+ *  payload, this requires payloads to end on a packet boundary. */
+static uint_fast16_t _payloads_per_xfer(videod_streaming_interface_t const *stm)
+{
+  uint_fast32_t max_payload = stm->max_payload_transfer_size;
+  if (stm->in_place || !max_payload) return 1;
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  /* converted payloads are rounded to whole pixel units */
+  if (stm->converter) return 1;
+#endif
+  tusb_desc_endpoint_t const *ep = (tusb_desc_endpoint_t const*)(_videod_itf[stm->index_vc].beg + stm->desc.ep[0]);
+  if (TUSB_XFER_BULK != ep->bmAttributes.xfer) return 1;
+  uint_fast16_t mps = tu_edpt_packet_size(ep);
+  if (!mps || (max_payload % mps) || (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < 2 * max_payload)) return 1;
+  return (uint_fast16_t) (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE / max_payload);
+}
+
+/** Prepare the next packet payload or payloads.
+ *  Return the packet to be transferred, either EP buffer or frame buffer location in case of in place transfer. */
+static uint8_t *_prepare_in_payload(videod_streaming_interface_t *stm, uint_fast16_t *len)
+{
+  uint_fast16_t hdr_len = stm->ep_buf[0];
+  uint_fast16_t num     = _payloads_per_xfer(stm);
+  uint_fast16_t total   = 0;
+  uint8_t *pkt = stm->ep_buf;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  /* scrSourceClock: source time clock and SOF counter at the time this payload is prepared */
+  tu_unaligned_write32(&stm->ep_buf[6], _read_clock(stm));
+  tu_unaligned_write16(&stm->ep_buf[10], _videod_sof_count);
+#endif
+  for (uint_fast16_t n = 0; n < num && stm->offset < stm->bufsize; ++n) {
+    uint_fast32_t remaining = stm->bufsize - stm->offset;
+    uint_fast16_t pkt_len   = stm->max_payload_transfer_size;
+    if (hdr_len + remaining < pkt_len) {
+      pkt_len = (uint_fast16_t) (hdr_len + remaining);
+    }
+    uint_fast16_t data_len = pkt_len - hdr_len;
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+    tud_video_converter_t const *conv = stm->converter;
+    if (conv && data_len != remaining) {
+      data_len = (uint_fast16_t) (data_len - data_len % conv->dst_unit);
+      pkt_len  = hdr_len + data_len;
+    }
+#endif
+    if (data_len == remaining) {
+      tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
+      hdr->EndOfFrame = 1;
+    }
+    if (stm->in_place) {
+      /* The header overlaps the tail of the previous payload which is already sent, or the headroom */
+      _restore_in_payload(stm);
+      pkt = stm->buffer + stm->offset - hdr_len;
+      memcpy(stm->saved, pkt, hdr_len);
+      memcpy(pkt, stm->ep_buf, hdr_len);
+      stm->saved_at  = pkt;
+      stm->saved_len = (uint8_t) hdr_len;
+    } else {
+      /* The header of the first payload is the template itself */
+      uint8_t *dst = &stm->ep_buf[total];
+      if (n) memcpy(dst, stm->ep_buf, hdr_len);
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+      if (conv) {
+        conv->convert(dst + hdr_len, stm->buffer + stm->offset / conv->dst_unit * conv->src_unit, data_len);
+      } else
+#endif
+      {
+        memcpy(dst + hdr_len, stm->buffer + stm->offset, data_len);
+      }
+    }
+    stm->offset += data_len;
+    total       += pkt_len;
+  }
+  *len = total;
+  return pkt;
+}
+
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+/** Prepare the next payload from queued slices. A payload is filled across slices, but never across frames.
+ *  Return the number of slices which are completely copied into the EP buffer. */
+static uint_fast8_t _prepare_in_slice_payload(videod_streaming_interface_t *stm, uint_fast16_t *len)
+{
+  uint_fast16_t const hdr_len = stm->ep_buf[0];
+  uint_fast16_t const max_len = stm->max_payload_transfer_size;
+  uint_fast16_t total    = hdr_len;
+  uint_fast8_t  released = 0;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  tu_unaligned_write32(&stm->ep_buf[6], _read_clock(stm));
+  tu_unaligned_write16(&stm->ep_buf[10], _videod_sof_count);
+#endif
+  _queue_lock();
+  while (stm->slice_count && total < max_len) {
+    videod_slice_t const *slc = &stm->slices[stm->slice_rd];
+    uint_fast32_t const remaining = slc->bufsize - stm->slice_offset;
+    uint_fast16_t const data_len  = (uint_fast16_t) tu_min32(remaining, max_len - total);
+    memcpy(&stm->ep_buf[total], slc->buffer + stm->slice_offset, data_len);
+    total             += data_len;
+    stm->slice_offset += data_len;
+    if (stm->slice_offset < slc->bufsize) break;
+
+    /* slice is consumed */
+    bool const eof = slc->end_of_frame;
+    stm->slice_offset = 0;
+    stm->slice_rd     = (uint8_t) ((stm->slice_rd + 1) % CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH);
+    stm->slice_count--;
+    released++;
+    if (eof) {
+      ((tusb_video_payload_header_t*)stm->ep_buf)->EndOfFrame = 1;
+      stm->slice_eof = 1;
+      break;
+    }
+  }
+  _queue_unlock();
+  *len = total;
+  return released;
+}
+
+/** Start the transfer of the next payload built from queued slices. */
+static bool _xfer_slice_payload(uint8_t rhport, videod_streaming_interface_t *stm, uint8_t ep_addr)
+{
+  if (!stm->slicing) {
+    /* first slice of a new frame */
+    stm->slicing = 1;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+    _begin_frame(stm, _read_clock(stm));
+#else
+    _begin_frame(stm, 0);
+#endif
+  }
+  TU_VERIFY( usbd_edpt_claim(rhport, ep_addr) );
+  uint_fast16_t pkt_len;
+  uint_fast8_t released = _prepare_in_slice_payload(stm, &pkt_len);
+  TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, stm->ep_buf, (uint16_t) pkt_len) );
+  if (tud_video_slice_xfer_complete_cb) {
+    while (released--) tud_video_slice_xfer_complete_cb(stm->index_vc, stm->index_vs);
+  }
+  return true;
+}
+#endif
+
 /** Handle a standard request to the video control interface. */
 static int handle_video_ctl_std_req(uint8_t rhport, uint8_t stage,
                                     tusb_control_request_t const *request,
@@ -1034,13 +1418,24 @@ static int handle_video_stm_cs_req(uint8_t rhport, uint8_t stage,
             }
             if (VIDEO_ERROR_NONE == ret) {
               self->state   = VS_STATE_COMMITTED;
+              _restore_in_payload(self);
+              _queue_lock();
               self->buffer  = NULL;
               self->bufsize = 0;
               self->offset  = 0;
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+              self->queue_count = 0;
+#endif
+              _clear_slices(self);
+              _queue_unlock();
               /* initialize payload header */
               tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)self->ep_buf;
-              hdr->bHeaderLength = sizeof(*hdr);
+              hdr->bHeaderLength = TUD_VIDEO_PAYLOAD_HEADER_LEN;
               hdr->bmHeaderInfo  = 0;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+              hdr->PresentationTime     = 1;
+              hdr->SourceClockReference = 1;
+#endif
             }
           }
           return VIDEO_ERROR_NONE;
@@ -1129,16 +1524,54 @@ bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
   return true;
 }
 
-bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+static bool _frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize, bool in_place)
 {
   TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
   TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
   if (!buffer || !bufsize) return false;
   videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
-  if (!stm || !stm->desc.ep[0] || stm->buffer) return false;
+  if (!stm || !stm->desc.ep[0]) return false;
   if (stm->state == VS_STATE_PROBING) return false;
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  /* payload headers cannot be placed into an unconverted frame */
+  if (in_place && stm->converter) return false;
+#endif
+
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  uint32_t const pts = _read_clock(stm);
+#else
+  uint32_t const pts = 0;
+#endif
+
+  _queue_lock();
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+  if (stm->slice_busy || stm->slicing) {
+    /* A frame is streamed from slices */
+    _queue_unlock();
+    return false;
+  }
+#endif
+  if (stm->buffer) {
+    /* A frame is in transfer, queue this one */
+    bool queued = false;
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+    if (stm->queue_count < CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH) {
+      videod_frame_t *frm = &stm->queue[(stm->queue_rd + stm->queue_count) % CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH];
+      frm->buffer   = (uint8_t*)buffer;
+      frm->bufsize  = bufsize;
+      frm->pts      = pts;
+      frm->in_place = in_place;
+      stm->queue_count++;
+      queued = true;
+    }
+#endif
+    _queue_unlock();
+    return queued;
+  }
+  _queue_unlock();
 
   /* Find EP address */
+  uint8_t const rhport = _videod_itf[stm->index_vc].rhport;
   uint8_t const *desc = _videod_itf[stm->index_vc].beg;
   uint8_t ep_addr = 0;
   for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO_STREAMING; ++i) {
@@ -1149,18 +1582,75 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
   }
   if (!ep_addr) return false;
 
-  TU_VERIFY( usbd_edpt_claim(0, ep_addr) );
+  TU_VERIFY( usbd_edpt_claim(rhport, ep_addr) );
   /* update the packet header */
-  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
-  hdr->FrameID   ^= 1;
-  hdr->EndOfFrame = 0;
+  _begin_frame(stm, pts);
   /* update the packet data */
   stm->buffer     = (uint8_t*)buffer;
-  stm->bufsize    = bufsize;
-  uint_fast16_t pkt_len = _prepare_in_payload(stm);
-  TU_ASSERT( usbd_edpt_xfer(0, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
+  stm->bufsize    = _frame_out_size(stm, bufsize);
+  stm->in_place   = in_place;
+  uint_fast16_t pkt_len;
+  uint8_t *pkt = _prepare_in_payload(stm, &pkt_len);
+  TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, pkt, (uint16_t) pkt_len), 0);
+  return true;
+}
+
+bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+{
+  return _frame_xfer(ctl_idx, stm_idx, buffer, bufsize, false);
+}
+
+bool tud_video_n_frame_xfer_in_place(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+{
+  return _frame_xfer(ctl_idx, stm_idx, buffer, bufsize, true);
+}
+
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+bool tud_video_n_set_converter(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, tud_video_converter_t const *converter)
+{
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
+  TU_VERIFY(!converter || (converter->convert && converter->src_unit && converter->dst_unit));
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  TU_VERIFY(stm);
+  /* not while a frame is in transfer */
+  TU_VERIFY(!stm->buffer);
+  stm->converter = converter;
   return true;
 }
+#endif
+
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+bool tud_video_n_slice_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void const *buffer, size_t bufsize, bool end_of_frame)
+{
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
+  if (!bufsize ? !end_of_frame : !buffer) return false;
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  if (!stm || !stm->desc.ep[0]) return false;
+  if (stm->state == VS_STATE_PROBING) return false;
+
+  _queue_lock();
+  if (stm->buffer || (stm->slice_count == CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH)) {
+    /* A whole frame is in transfer or no room for the slice */
+    _queue_unlock();
+    return false;
+  }
+  videod_slice_t *slc = &stm->slices[(stm->slice_rd + stm->slice_count) % CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH];
+  slc->buffer       = (uint8_t const*) buffer;
+  slc->bufsize      = bufsize;
+  slc->end_of_frame = end_of_frame;
+  stm->slice_count++;
+  /* Otherwise the slice is picked up when the payload in transfer is completed */
+  bool const start = !stm->slice_busy;
+  stm->slice_busy = 1;
+  _queue_unlock();
+
+  if (!start) return true;
+  uint8_t const ep_addr = _desc_ep_addr(_videod_itf[stm->index_vc].beg + stm->desc.ep[0]);
+  return _xfer_slice_payload(_videod_itf[stm->index_vc].rhport, stm, ep_addr);
+}
+#endif
 
 //--------------------------------------------------------------------+
 // USBD Driver API
@@ -1175,19 +1665,24 @@ void videod_init(void)
     videod_streaming_interface_t *stm = &_videod_streaming_itf[i];
     tu_memclr(stm, ITF_STM_MEM_RESET_SIZE);
   }
+#if (CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH || CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH) && OSAL_MUTEX_REQUIRED
+  _videod_queue_mutex = osal_mutex_create(&_videod_queue_mutexdef);
+#endif
 }
 
 void videod_reset(uint8_t rhport)
 {
-  (void) rhport;
-  for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO; ++i) {
-    videod_interface_t* ctl = &_videod_itf[i];
-    tu_memclr(ctl, sizeof(*ctl));
-  }
+  /* skip interfaces opened on other port, streaming ones first since they refer to their control interface */
   for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO_STREAMING; ++i) {
     videod_streaming_interface_t *stm = &_videod_streaming_itf[i];
+    if (stm->desc.beg && _videod_itf[stm->index_vc].rhport != rhport) continue;
     tu_memclr(stm, ITF_STM_MEM_RESET_SIZE);
   }
+  for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO; ++i) {
+    videod_interface_t* ctl = &_videod_itf[i];
+    if (ctl->beg && ctl->rhport != rhport) continue;
+    tu_memclr(ctl, sizeof(*ctl));
+  }
 }
 
 uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
@@ -1209,6 +1704,7 @@ uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
   uint8_t const *end = (uint8_t const*)itf_desc + max_len;
   self->beg = (uint8_t const*) itf_desc;
   self->len = max_len;
+  self->rhport = rhport;
 
   /*------------- Video Control Interface -------------*/
   TU_VERIFY(_open_vc_itf(rhport, self, 0), 0);
@@ -1233,6 +1729,7 @@ uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
     cur = _next_desc_itf(cur, end);
     stm->desc.end = (uint16_t) ((uintptr_t)cur - (uintptr_t)itf_desc);
     stm->state = VS_STATE_PROBING;
+    _index_vs_descriptors(stm);
     if (0 == stm_idx && 1 == bInCollection) {
       /* If there is only one streaming interface and no alternate settings,
        * host may not issue set_interface so open the streaming interface here. */
@@ -1259,7 +1756,7 @@ bool videod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_
   uint_fast8_t itf;
   for (itf = 0; itf < CFG_TUD_VIDEO; ++itf) {
     void const *desc = _videod_itf[itf].beg;
-    if (!desc) continue;
+    if (!desc || _videod_itf[itf].rhport != rhport) continue;
     if (itfnum == _desc_itfnum(desc)) break;
   }
 
@@ -1273,7 +1770,7 @@ bool videod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_
   /* Identify which streaming interface to use */
   for (itf = 0; itf < CFG_TUD_VIDEO_STREAMING; ++itf) {
     videod_streaming_interface_t *stm = &_videod_streaming_itf[itf];
-    if (!stm->desc.beg) continue;
+    if (!stm->desc.beg || _videod_itf[stm->index_vc].rhport != rhport) continue;
     uint8_t const *desc = _videod_itf[stm->index_vc].beg;
     if (itfnum == _desc_itfnum(desc + stm->desc.beg)) break;
   }
@@ -1300,20 +1797,64 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
     uint_fast16_t const ep_ofs = stm->desc.ep[0];
     if (!ep_ofs) continue;
     ctl = &_videod_itf[stm->index_vc];
+    if (ctl->rhport != rhport) continue;
     uint8_t const *desc = ctl->beg;
     if (ep_addr == _desc_ep_addr(desc + ep_ofs)) break;
   }
 
   TU_ASSERT(itf < CFG_TUD_VIDEO_STREAMING);
+#if CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+  if (stm->slice_busy) {
+    _queue_lock();
+    bool const frame_done = stm->slice_eof;
+    if (frame_done) {
+      stm->slicing   = 0;
+      stm->slice_eof = 0;
+    }
+    /* Wait for the next slice if none is queued */
+    bool const more = (stm->slice_count != 0);
+    if (!more) stm->slice_busy = 0;
+    _queue_unlock();
+    if (more) {
+      TU_ASSERT(_xfer_slice_payload(rhport, stm, ep_addr));
+    }
+    if (frame_done && tud_video_frame_xfer_complete_cb) {
+      tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
+    }
+    return true;
+  }
+#endif
   if (stm->offset < stm->bufsize) {
     /* Claim the endpoint */
     TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
-    uint_fast16_t pkt_len = _prepare_in_payload(stm);
-    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
+    uint_fast16_t pkt_len;
+    uint8_t *pkt = _prepare_in_payload(stm, &pkt_len);
+    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, pkt, (uint16_t) pkt_len), 0);
   } else {
+    _restore_in_payload(stm);
+    _queue_lock();
     stm->buffer  = NULL;
     stm->bufsize = 0;
     stm->offset  = 0;
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+    /* Start the next queued frame right away to avoid a gap on the bus */
+    if (stm->queue_count) {
+      videod_frame_t const *frm = &stm->queue[stm->queue_rd];
+      stm->queue_rd = (uint8_t) ((stm->queue_rd + 1) % CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH);
+      stm->queue_count--;
+      stm->buffer   = frm->buffer;
+      stm->bufsize  = _frame_out_size(stm, frm->bufsize);
+      stm->in_place = frm->in_place;
+      _begin_frame(stm, frm->pts);
+    }
+#endif
+    _queue_unlock();
+    if (stm->buffer) {
+      TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
+      uint_fast16_t pkt_len;
+      uint8_t *pkt = _prepare_in_payload(stm, &pkt_len);
+      TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, pkt, (uint16_t) pkt_len), 0);
+    }
     if (tud_video_frame_xfer_complete_cb) {
       tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
     }
@@ -1321,4 +1862,14 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   return true;
 }
 
+void videod_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  _videod_sof_count = (uint16_t) (frame_count & 0x7FFu);
+#else
+  (void) frame_count;
+#endif
+}
+
 #endif
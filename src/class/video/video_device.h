@@ -35,6 +35,65 @@
 extern "C" {
 #endif
 
+/* Number of frames which can be queued per streaming interface while another frame is transferred.
+ * A queued frame starts right after the last payload of the previous frame. */
+#ifndef CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH
+#define CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH   0
+#endif
+
+/* Number of encoded slices which can be queued per streaming interface by tud_video_n_slice_xfer().
+ * Slices are copied into the EP buffer as payloads are built, hence a frame is streamed while it is
+ * still being encoded, without a frame sized buffer. */
+#ifndef CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+#define CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH   0
+#endif
+
+/* Size of the per streaming interface index of format and frame descriptors used by probe and commit
+ * negotiation. Descriptors exceeding it are searched at each request instead. */
+#ifndef CFG_TUD_VIDEO_STREAMING_MAX_FORMATS
+#define CFG_TUD_VIDEO_STREAMING_MAX_FORMATS   4
+#endif
+
+/* Total number of frame descriptors of all formats */
+#ifndef CFG_TUD_VIDEO_STREAMING_MAX_FRAMES
+#define CFG_TUD_VIDEO_STREAMING_MAX_FRAMES    8
+#endif
+
+/* Pixel format conversion while frame data is copied into the EP buffer, see tud_video_n_set_converter() */
+#ifndef CFG_TUD_VIDEO_STREAMING_CONVERT
+#define CFG_TUD_VIDEO_STREAMING_CONVERT   0
+#endif
+
+/* Fill PTS and SCR of payload headers. The source clock is read by tud_video_clock_cb(): PTS is sampled
+ * when a frame is passed to tud_video_n_frame_xfer(), SCR for each payload together with the SOF counter. */
+#ifndef CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+#define CFG_TUD_VIDEO_STREAMING_TIMESTAMP   0
+#endif
+
+/* Payload header length: bHeaderLength, bmHeaderInfo and optionally dwPresentationTime, scrSourceClock */
+#if CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+  #define TUD_VIDEO_PAYLOAD_HEADER_LEN   (sizeof(tusb_video_payload_header_t) + 10)
+#else
+  #define TUD_VIDEO_PAYLOAD_HEADER_LEN   sizeof(tusb_video_payload_header_t)
+#endif
+
+/* Bytes to be reserved in front of a frame buffer passed to tud_video_n_frame_xfer_in_place() */
+#define TUD_VIDEO_FRAME_HEADROOM   TUD_VIDEO_PAYLOAD_HEADER_LEN
+
+/* Pixel format converter, each src_unit bytes of the frame buffer become dst_unit bytes of payload data */
+typedef struct {
+  /* Convert dst_len bytes of payload data, dst_len is a multiple of dst_unit */
+  void (*convert)(uint8_t *dst, uint8_t const *src, uint_fast32_t dst_len);
+  uint8_t src_unit;
+  uint8_t dst_unit;
+} tud_video_converter_t;
+
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+/* Built-in converters: little endian RGB565 to YUY2 (TUD_VIDEO_GUID_YUY2) and to 8 bit luma only */
+extern tud_video_converter_t const tud_video_convert_rgb565_yuy2;
+extern tud_video_converter_t const tud_video_convert_rgb565_y8;
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Ports)
 // CFG_TUD_VIDEO > 1
@@ -47,6 +106,9 @@ extern "C" {
 bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
 /** Transfer a frame
+ *
+ * If a frame is in transfer already, the frame is queued (up to CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_DEPTH).
+ * tud_video_frame_xfer_complete_cb() is invoked for each frame in the order of this call.
  *
  * @param[in] ctl_idx    Destination control interface index
  * @param[in] stm_idx    Destination streaming interface index
@@ -54,6 +116,45 @@ bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
  * @param[in] bufsize    Byte size of the frame buffer */
 bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
 
+/** Transfer a frame without copying it into the EP buffer
+ *
+ * Payload headers are written into the frame buffer in front of each payload, the bytes they overwrite
+ * belong to the previous payload which is already sent and are restored after each transfer. Hence the
+ * frame buffer content is unchanged once the transfer completed.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] buffer     Frame buffer, TUD_VIDEO_FRAME_HEADROOM bytes in front of it must be writable and
+ *                       reserved for the driver. The whole memory must be accessible by the USB controller.
+ *                       The caller must not use this buffer until the operation is completed.
+ * @param[in] bufsize    Byte size of the frame buffer */
+bool tud_video_n_frame_xfer_in_place(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
+
+/** Set the pixel format converter applied to frames passed to tud_video_n_frame_xfer(), requires CFG_TUD_VIDEO_STREAMING_CONVERT
+ *
+ * A frame is converted payload by payload while it is copied into the EP buffer, so no second frame buffer is
+ * needed. bufsize passed to tud_video_n_frame_xfer() is the size of the source frame. Not applicable to in place
+ * transfers and slices.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] converter  Converter, e.g. &tud_video_convert_rgb565_yuy2, or NULL to send frames as is */
+bool tud_video_n_set_converter(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, tud_video_converter_t const *converter);
+
+/** Append an encoded slice to the frame being streamed, requires CFG_TUD_VIDEO_STREAMING_SLICE_QUEUE_DEPTH
+ *
+ * The first slice after the end of a frame starts a new frame. Payloads are sent as soon as slice data is
+ * available, so frame size need not be known in advance (MJPEG or frame based formats with variable size).
+ * Cannot be mixed with tud_video_n_frame_xfer() while a frame is streamed from slices.
+ *
+ * @param[in] ctl_idx      Destination control interface index
+ * @param[in] stm_idx      Destination streaming interface index
+ * @param[in] buffer       Slice data. The caller must not use this buffer until tud_video_slice_xfer_complete_cb().
+ * @param[in] bufsize      Byte size of the slice, may be 0 to only mark the end of the frame
+ * @param[in] end_of_frame This slice is the last one of the frame
+ * @return false if the slice queue is full or a whole frame is in transfer */
+bool tud_video_n_slice_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void const *buffer, size_t bufsize, bool end_of_frame);
+
 /*------------- Optional callbacks -------------*/
 /** Invoked when compeletion of a frame transfer
  *
@@ -61,6 +162,20 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
  * @param[in] stm_idx    Destination streaming interface index */
 TU_ATTR_WEAK void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
+/** Invoked when a slice passed to tud_video_n_slice_xfer() is copied into the EP buffer, in the order of the calls.
+ *  tud_video_frame_xfer_complete_cb() is invoked once the last payload of the frame is sent.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index */
+TU_ATTR_WEAK void tud_video_slice_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+
+/** Invoked to read the source clock for PTS and SCR of payload headers, required with CFG_TUD_VIDEO_STREAMING_TIMESTAMP
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @return Source clock in units of dwClockFrequency */
+TU_ATTR_WEAK uint32_t tud_video_clock_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
@@ -89,6 +204,7 @@ void     videod_reset          (uint8_t rhport);
 uint16_t videod_open           (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     videod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     videod_xfer_cb        (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     videod_sof            (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
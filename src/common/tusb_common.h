@@ -75,6 +75,56 @@
 #include "tusb_verify.h"
 #include "tusb_types.h"
 #include "tusb_debug.h"
+#include "tusb_prof.h"
+
+//--------------------------------------------------------------------+
+// Endpoint Buffer
+// With D-Cache enabled, endpoint buffer starts at and is padded to a cache line, cache maintenance done
+// by controller driver for DMA transfer therefore never shares a line with other (CPU) data.
+// - TUx_EPBUF_DEF(name, size) declares uint8_t name[size]
+// - TUx_EPBUF_TYPE_DEF(type, name) declares type name
+// Both are anonymous union, and must be used as struct member e.g
+//   typedef struct { TUD_EPBUF_DEF(epout, 64); } xxx_epbuf_t;
+//--------------------------------------------------------------------+
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  #define TUD_EPBUF_DCACHE_SIZE(_size)  (TU_DIV_CEIL(_size, CFG_TUD_MEM_DCACHE_LINE_SIZE) * CFG_TUD_MEM_DCACHE_LINE_SIZE)
+  #define TUD_EPBUF_DCACHE_ALIGNED      TU_ATTR_ALIGNED(CFG_TUD_MEM_DCACHE_LINE_SIZE)
+#else
+  #define TUD_EPBUF_DCACHE_SIZE(_size)  (_size)
+  #define TUD_EPBUF_DCACHE_ALIGNED
+#endif
+
+#define TUD_EPBUF_DEF(_name, _size) \
+  union { \
+    CFG_TUD_MEM_ALIGN uint8_t _name[_size]; \
+    TUD_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUD_EPBUF_DCACHE_SIZE(_size)]; \
+  }
+
+#define TUD_EPBUF_TYPE_DEF(_type, _name) \
+  union { \
+    CFG_TUD_MEM_ALIGN _type _name; \
+    TUD_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUD_EPBUF_DCACHE_SIZE(sizeof(_type))]; \
+  }
+
+#if CFG_TUH_MEM_DCACHE_ENABLE
+  #define TUH_EPBUF_DCACHE_SIZE(_size)  (TU_DIV_CEIL(_size, CFG_TUH_MEM_DCACHE_LINE_SIZE) * CFG_TUH_MEM_DCACHE_LINE_SIZE)
+  #define TUH_EPBUF_DCACHE_ALIGNED      TU_ATTR_ALIGNED(CFG_TUH_MEM_DCACHE_LINE_SIZE)
+#else
+  #define TUH_EPBUF_DCACHE_SIZE(_size)  (_size)
+  #define TUH_EPBUF_DCACHE_ALIGNED
+#endif
+
+#define TUH_EPBUF_DEF(_name, _size) \
+  union { \
+    CFG_TUH_MEM_ALIGN uint8_t _name[_size]; \
+    TUH_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUH_EPBUF_DCACHE_SIZE(_size)]; \
+  }
+
+#define TUH_EPBUF_TYPE_DEF(_type, _name) \
+  union { \
+    CFG_TUH_MEM_ALIGN _type _name; \
+    TUH_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUH_EPBUF_DCACHE_SIZE(sizeof(_type))]; \
+  }
 
 //--------------------------------------------------------------------+
 // Optional API implemented by application if needed
@@ -149,6 +199,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool     tu_bit_test (uint32_t value, uint8_
 TU_ATTR_ALWAYS_INLINE static inline uint8_t  tu_min8  (uint8_t  x, uint8_t y ) { return (x < y) ? x : y; }
 TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_min16 (uint16_t x, uint16_t y) { return (x < y) ? x : y; }
 TU_ATTR_ALWAYS_INLINE static inline uint32_t tu_min32 (uint32_t x, uint32_t y) { return (x < y) ? x : y; }
+TU_ATTR_ALWAYS_INLINE static inline uint64_t tu_min64 (uint64_t x, uint64_t y) { return (x < y) ? x : y; }
 
 //------------- Max -------------//
 TU_ATTR_ALWAYS_INLINE static inline uint8_t  tu_max8  (uint8_t  x, uint8_t y ) { return (x > y) ? x : y; }
@@ -169,6 +169,22 @@
     #define TU_BSWAP32(u32) (__builtin_bswap32(u32))
   #endif
 
+  // Branch prediction hint, e.g for error path
+  #define TU_LIKELY(_cond)              __builtin_expect(!!(_cond), 1)
+  #define TU_UNLIKELY(_cond)            __builtin_expect(!!(_cond), 0)
+
+  // Acquire/Release ordering, used to publish index shared by a single producer and a single consumer
+  #define tu_atomic_load_acquire(_ptr)        __atomic_load_n((_ptr), __ATOMIC_ACQUIRE)
+  #define tu_atomic_store_release(_ptr, _val) __atomic_store_n((_ptr), (_val), __ATOMIC_RELEASE)
+
+  // Fences ordering plain (e.g memcpy) accesses against an index/sequence access, used by seqlock style readers
+  #define tu_atomic_fence_acquire()           __atomic_thread_fence(__ATOMIC_ACQUIRE)
+  #define tu_atomic_fence_release()           __atomic_thread_fence(__ATOMIC_RELEASE)
+
+  // Strong compare-and-swap, on failure *_expected_ptr is updated with the current value
+  #define tu_atomic_cas(_ptr, _expected_ptr, _desired) \
+    __atomic_compare_exchange_n((_ptr), (_expected_ptr), (_desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
 	#ifndef __ARMCC_VERSION
   // List of obsolete callback function that is renamed and should not be defined.
   // Put it here since only gcc support this pragma
@@ -201,6 +217,9 @@
   #define TU_BSWAP16(u16) (__builtin_bswap16(u16))
   #define TU_BSWAP32(u32) (__builtin_bswap32(u32))
 
+  #define TU_LIKELY(_cond)              __builtin_expect(!!(_cond), 1)
+  #define TU_UNLIKELY(_cond)            __builtin_expect(!!(_cond), 0)
+
 #elif defined(__ICCARM__)
   #include <intrinsics.h>
   #define TU_ATTR_ALIGNED(Bytes)        __attribute__ ((aligned(Bytes)))
@@ -260,6 +279,23 @@
   #error "Compiler attribute porting is required"
 #endif
 
+// Fallback for compiler without branch prediction builtin
+#ifndef TU_LIKELY
+  #define TU_LIKELY(_cond)              (_cond)
+  #define TU_UNLIKELY(_cond)            (_cond)
+#endif
+
+// Fallback for compiler without atomic builtins: rely on volatile access of the (aligned) index
+#ifndef tu_atomic_load_acquire
+  #define tu_atomic_load_acquire(_ptr)        (*(_ptr))
+  #define tu_atomic_store_release(_ptr, _val) (*(_ptr) = (_val))
+#endif
+
+#ifndef tu_atomic_fence_acquire
+  #define tu_atomic_fence_acquire()
+  #define tu_atomic_fence_release()
+#endif
+
 
 #if (TU_BYTE_ORDER == TU_LITTLE_ENDIAN)
 
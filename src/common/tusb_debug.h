@@ -164,6 +164,105 @@ static inline const char* tu_lookup_find(tu_lookup_table_t const* p_table, uint3
   #define TU_LOG3_HEX(...)
 #endif
 
+//--------------------------------------------------------------------+
+// Trace
+// CFG_TUSB_TRACE records compact binary events of the hot path into a RAM ring buffer. Records can be
+// dumped by debugger, read back with tu_trace_read() and sent over a vendor endpoint, or forwarded as they
+// are recorded to SEGGER RTT/SystemView or ITM by defining CFG_TUSB_TRACE_SINK(record).
+//--------------------------------------------------------------------+
+#if CFG_TUSB_TRACE
+
+typedef enum {
+  TU_TRACE_ISR_ENTER = 0, // param: rhport
+  TU_TRACE_ISR_EXIT,      // param: rhport
+  TU_TRACE_EVENT_POST,    // param: event id, arg: queue depth after post (OS NONE/PICO only, 0 otherwise)
+  TU_TRACE_TASK_DISPATCH, // param: event id, arg: queue latency (CFG_TUx_EVENT_TIMESTAMP only, saturated)
+  TU_TRACE_XFER_CB_START, // param: endpoint address, arg: transferred bytes
+  TU_TRACE_XFER_CB_END,   // param: endpoint address
+  TU_TRACE_EDPT_XFER,     // param: endpoint address, arg: total bytes
+  TU_TRACE_USER = 0x80    // application events start here
+} tu_trace_id_t;
+
+typedef struct {
+  uint32_t timestamp; // CFG_TUSB_TRACE_TIMESTAMP()
+  uint8_t  id;        // tu_trace_id_t
+  uint8_t  param;
+  uint16_t arg;
+} tu_trace_record_t;
+
+TU_VERIFY_STATIC(sizeof(tu_trace_record_t) == 8, "size is not correct");
+TU_VERIFY_STATIC((CFG_TUSB_TRACE_DEPTH & (CFG_TUSB_TRACE_DEPTH - 1)) == 0, "CFG_TUSB_TRACE_DEPTH must be power of 2");
+
+// Record an event, safe to call from both ISR and task
+void tu_trace_record(uint8_t id, uint8_t param, uint16_t arg);
+
+// Copy up to count latest records, oldest first. Return number of records copied.
+uint32_t tu_trace_read(tu_trace_record_t* records, uint32_t count);
+
+// Total number of records since boot (including overwritten ones)
+uint32_t tu_trace_total(void);
+
+#define TU_TRACE(_id, _param, _arg)   tu_trace_record((uint8_t) (_id), (uint8_t) (_param), (uint16_t) (_arg))
+
+#else
+
+#define TU_TRACE(_id, _param, _arg)
+
+#endif
+
+//--------------------------------------------------------------------+
+// Capture
+// CFG_TUSB_CAPTURE records USB transactions seen by usbd/usbh as a stream of variable length records
+// (tu_capture_header_t followed by data_len payload bytes) into a RAM ring buffer. Stream it out with
+// tu_capture_read() e.g over UART, SEGGER RTT or a vendor interface, or forward each record as it is written by
+// defining CFG_TUSB_CAPTURE_SINK(record, size). tools/capture_to_pcapng.py converts the stream to USBPcap pcapng.
+//--------------------------------------------------------------------+
+#if CFG_TUSB_CAPTURE
+
+#define TU_CAPTURE_SYNC  0xA5u
+
+typedef enum {
+  TU_CAPTURE_SETUP = 0, // setup packet received (device) or sent (host), payload: 8 bytes request
+  TU_CAPTURE_SUBMIT,    // transfer queued, len: total bytes, payload: data of OUT (host) / IN (device) transfer
+  TU_CAPTURE_COMPLETE,  // transfer complete, len: transferred bytes, payload: data of IN (host) / OUT (device) transfer
+  TU_CAPTURE_HOST = 0x80 // or'ed with above: record of usbh, usbd otherwise
+} tu_capture_type_t;
+
+typedef struct TU_ATTR_PACKED {
+  uint8_t  sync;      // TU_CAPTURE_SYNC, to re-synchronize a stream joined mid-way
+  uint8_t  type;      // tu_capture_type_t
+  uint8_t  rhport;
+  uint8_t  ep_addr;
+  uint32_t timestamp; // CFG_TUSB_CAPTURE_TIMESTAMP()
+  uint16_t seq;       // incremented for every record including dropped ones
+  uint16_t len;
+  uint8_t  daddr;     // device address (host), 0 for device
+  uint8_t  result;    // xfer_result_t of completion
+  uint16_t data_len;  // number of payload bytes following this header
+} tu_capture_header_t;
+
+TU_VERIFY_STATIC(sizeof(tu_capture_header_t) == 16, "size is not correct");
+TU_VERIFY_STATIC((CFG_TUSB_CAPTURE_BUFSIZE & (CFG_TUSB_CAPTURE_BUFSIZE - 1)) == 0, "CFG_TUSB_CAPTURE_BUFSIZE must be power of 2");
+
+// Write a record, payload is truncated to CFG_TUSB_CAPTURE_PAYLOAD. Whole record is dropped if buffer is full.
+// Safe from any context with CFG_TUSB_FIFO_MULTI_PRODUCER, otherwise only from a single task (or main loop).
+void tu_capture_record(uint8_t type, uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint16_t len, uint8_t result,
+                       void const* data, uint16_t data_len);
+
+// Read up to bufsize bytes of captured stream. Return number of bytes read.
+uint32_t tu_capture_read(void* buffer, uint32_t bufsize);
+
+// Number of records dropped since boot because buffer was full
+uint32_t tu_capture_dropped(void);
+
+#define TU_CAPTURE(...)   tu_capture_record(__VA_ARGS__)
+
+#else
+
+#define TU_CAPTURE(...)
+
+#endif
+
 #ifdef __cplusplus
  }
 #endif
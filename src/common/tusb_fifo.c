@@ -36,7 +36,7 @@
 #pragma diag_suppress = Pa082
 #endif
 
-#if OSAL_MUTEX_REQUIRED
+#if CFG_FIFO_MUTEX
 
 TU_ATTR_ALWAYS_INLINE static inline void _ff_lock(osal_mutex_t mutex)
 {
@@ -55,6 +55,12 @@ TU_ATTR_ALWAYS_INLINE static inline void _ff_unlock(osal_mutex_t mutex)
 
 #endif
 
+// Index owned by the other side (rd_idx for writer, wr_idx for reader) is loaded with acquire and
+// own index is stored with release, so that buffer content is always copied before the index that
+// covers it is published. This is what makes single producer/single consumer safe without mutex.
+#define _ff_load_idx(_idx_ptr)          tu_atomic_load_acquire(_idx_ptr)
+#define _ff_store_idx(_idx_ptr, _val)   tu_atomic_store_release(_idx_ptr, _val)
+
 /** \enum tu_fifo_copy_mode_t
  * \brief Write modes intended to allow special read and write functions to be able to
  *        copy data to and from USB hardware FIFOs as needed for e.g. STM32s and others
@@ -65,12 +71,17 @@ typedef enum
   TU_FIFO_COPY_CST_FULL_WORDS, ///< Copy from/to a constant source/destination address - required for e.g. STM32 to write into USB hardware FIFO
 } tu_fifo_copy_mode_t;
 
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable)
 {
   // Limit index space to 2*depth - this allows for a fast "modulo" calculation
-  // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
-  // only if overflow happens once (important for unsupervised DMA applications)
-  if (depth > 0x8000) return false;
+  // but limits the maximum depth to 2^16/2 = 2^15 (2^31 with CFG_TUSB_FIFO_IDX32) and buffer overflows
+  // are detectable only if overflow happens once (important for unsupervised DMA applications)
+  if (depth > TU_FIFO_DEPTH_MAX) return false;
+
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  // masked index arithmetic is used unconditionally, assert since most drivers don't check the result
+  TU_ASSERT(tu_is_power_of_two(depth));
+#endif
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
@@ -82,29 +93,123 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   f->rd_idx       = 0;
   f->wr_idx       = 0;
 
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+  f->mp_state     = 0;
+#endif
+
+#if CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+  f->ow_claim_seq = 0;
+  f->ow_wr_seq    = 0;
+  f->ow_rd_seq    = 0;
+#endif
+
+#if CFG_TUSB_FIFO_STATS
+  tu_varclr(&f->stats);
+#endif
+
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
 
   return true;
 }
 
+#if CFG_TUSB_FIFO_IDX32
+  #define _ff_min(_x, _y)   tu_min32(_x, _y)
+#else
+  #define _ff_min(_x, _y)   tu_min16(_x, _y)
+#endif
+
 //--------------------------------------------------------------------+
 // Pull & Push
 //--------------------------------------------------------------------+
 
+// Copy linear segment between fifo and application buffer
+TU_ATTR_FAST_FUNC static void _ff_memcpy(void* dst, const void* src, tu_fifo_idx_t len)
+{
+#if TUP_FIFO_WORD_COPY
+  uint8_t* dst8 = (uint8_t*) dst;
+  uint8_t const* src8 = (uint8_t const*) src;
+
+  // word copy is only possible if both have the same alignment, otherwise let memcpy() handle it
+  if ( (len >= 16) && ((((uintptr_t) dst8) & 3) == (((uintptr_t) src8) & 3)) )
+  {
+    // head bytes to reach word boundary
+    while ( ((uintptr_t) dst8) & 3 )
+    {
+      *dst8++ = *src8++;
+      len--;
+    }
+
+    uint32_t* dst32 = (uint32_t*) (uintptr_t) dst8;
+    uint32_t const* src32 = (uint32_t const*) (uintptr_t) src8;
+
+    // 4 words per loop, compiler can use LDM/STM
+    while ( len >= 16 )
+    {
+      uint32_t const w0 = src32[0];
+      uint32_t const w1 = src32[1];
+      uint32_t const w2 = src32[2];
+      uint32_t const w3 = src32[3];
+      dst32[0] = w0;
+      dst32[1] = w1;
+      dst32[2] = w2;
+      dst32[3] = w3;
+
+      dst32 += 4;
+      src32 += 4;
+      len   -= 16;
+    }
+
+    while ( len >= 4 )
+    {
+      *dst32++ = *src32++;
+      len -= 4;
+    }
+
+    dst = dst32;
+    src = src32;
+  }
+#endif
+
+  memcpy(dst, src, len);
+}
+
 // Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
 // Code adapted from dcd_synopsys.c
 // TODO generalize with configurable 1 byte or 4 byte each read
-static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t len)
+TU_ATTR_FAST_FUNC static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, tu_fifo_idx_t len)
 {
   volatile const uint32_t * reg_rx = (volatile const uint32_t *) app_buf;
 
   // Reading full available 32 bit words from const app address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+  tu_fifo_idx_t full_words = len >> 2;
+
+  if ( (((uintptr_t) ff_buf) & 3) == 0 )
+  {
+    // aligned fifo buffer: plain word store, avoid byte access of unaligned write on strict align MCUs
+    uint32_t* ff32 = (uint32_t*) (uintptr_t) ff_buf;
+
+    while ( full_words >= 4 )
+    {
+      ff32[0] = *reg_rx;
+      ff32[1] = *reg_rx;
+      ff32[2] = *reg_rx;
+      ff32[3] = *reg_rx;
+      ff32 += 4;
+      full_words -= 4;
+    }
+
+    while ( full_words-- ) *ff32++ = *reg_rx;
+
+    ff_buf = (uint8_t*) ff32;
+  }
+  else
   {
-    tu_unaligned_write32(ff_buf, *reg_rx);
-    ff_buf += 4;
+    while(full_words--)
+    {
+      tu_unaligned_write32(ff_buf, *reg_rx);
+      ff_buf += 4;
+    }
   }
 
   // Read the remaining 1-3 bytes from const app address
@@ -118,16 +223,39 @@ static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t
 
 // Intended to be used to write to hardware USB FIFO in e.g. STM32
 // where all data is written to a constant address in full word copies
-static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t len)
+TU_ATTR_FAST_FUNC static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, tu_fifo_idx_t len)
 {
   volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
   // Write full available 32 bit words to const address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+  tu_fifo_idx_t full_words = len >> 2;
+
+  if ( (((uintptr_t) ff_buf) & 3) == 0 )
+  {
+    // aligned fifo buffer: plain word load, avoid byte access of unaligned read on strict align MCUs
+    uint32_t const* ff32 = (uint32_t const*) (uintptr_t) ff_buf;
+
+    while ( full_words >= 4 )
+    {
+      *reg_tx = ff32[0];
+      *reg_tx = ff32[1];
+      *reg_tx = ff32[2];
+      *reg_tx = ff32[3];
+      ff32 += 4;
+      full_words -= 4;
+    }
+
+    while ( full_words-- ) *reg_tx = *ff32++;
+
+    ff_buf = (uint8_t const*) ff32;
+  }
+  else
   {
-    *reg_tx = tu_unaligned_read32(ff_buf);
-    ff_buf += 4;
+    while(full_words--)
+    {
+      *reg_tx = tu_unaligned_read32(ff_buf);
+      ff_buf += 4;
+    }
   }
 
   // Write the remaining 1-3 bytes into const address
@@ -142,19 +270,19 @@ static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t
 }
 
 // send one item to fifo WITHOUT updating write pointer
-static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
+static inline void _ff_push(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(f->buffer + (rel * f->item_size), app_buf, f->item_size);
 }
 
 // send n items to fifo WITHOUT updating write pointer
-static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static void _ff_push_n(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t n, tu_fifo_idx_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - wr_ptr;
-  uint16_t const wrap_count = n - lin_count;
+  tu_fifo_idx_t const lin_count = f->depth - wr_ptr;
+  tu_fifo_idx_t const wrap_count = n - lin_count;
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  tu_fifo_idx_t lin_bytes = lin_count * f->item_size;
+  tu_fifo_idx_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (wr_ptr * f->item_size);
@@ -165,18 +293,18 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
       if(n <= lin_count)
       {
         // Linear only
-        memcpy(ff_buf, app_buf, n*f->item_size);
+        _ff_memcpy(ff_buf, app_buf, n*f->item_size);
       }
       else
       {
         // Wrap around
 
         // Write data to linear part of buffer
-        memcpy(ff_buf, app_buf, lin_bytes);
+        _ff_memcpy(ff_buf, app_buf, lin_bytes);
 
         // Write data wrapped around
         // TU_ASSERT(nWrap_bytes <= f->depth, );
-        memcpy(f->buffer, ((uint8_t const*) app_buf) + lin_bytes, wrap_bytes);
+        _ff_memcpy(f->buffer, ((uint8_t const*) app_buf) + lin_bytes, wrap_bytes);
       }
       break;
 
@@ -192,7 +320,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         // Wrap around case
 
         // Write full words to linear part of buffer
-        uint16_t nLin_4n_bytes = lin_bytes & 0xFFFC;
+        tu_fifo_idx_t nLin_4n_bytes = lin_bytes & ~3u;
         _ff_push_const_addr(ff_buf, app_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -202,7 +330,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         {
           volatile const uint32_t * rx_fifo = (volatile const uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) _ff_min(wrap_bytes, 4-rem);
           wrap_bytes -= remrem;
 
           uint32_t tmp32 = *rx_fifo;
@@ -229,19 +357,19 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
 }
 
 // get one item from fifo WITHOUT updating read pointer
-static inline void _ff_pull(tu_fifo_t* f, void * app_buf, uint16_t rel)
+static inline void _ff_pull(tu_fifo_t* f, void * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(app_buf, f->buffer + (rel * f->item_size), f->item_size);
 }
 
 // get n items from fifo WITHOUT updating read pointer
-static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static void _ff_pull_n(tu_fifo_t* f, void* app_buf, tu_fifo_idx_t n, tu_fifo_idx_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - rd_ptr;
-  uint16_t const wrap_count = n - lin_count; // only used if wrapped
+  tu_fifo_idx_t const lin_count = f->depth - rd_ptr;
+  tu_fifo_idx_t const wrap_count = n - lin_count; // only used if wrapped
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  tu_fifo_idx_t lin_bytes = lin_count * f->item_size;
+  tu_fifo_idx_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rd_ptr * f->item_size);
@@ -252,17 +380,17 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
       if ( n <= lin_count )
       {
         // Linear only
-        memcpy(app_buf, ff_buf, n*f->item_size);
+        _ff_memcpy(app_buf, ff_buf, n*f->item_size);
       }
       else
       {
         // Wrap around
 
         // Read data from linear part of buffer
-        memcpy(app_buf, ff_buf, lin_bytes);
+        _ff_memcpy(app_buf, ff_buf, lin_bytes);
 
         // Read data wrapped part
-        memcpy((uint8_t*) app_buf + lin_bytes, f->buffer, wrap_bytes);
+        _ff_memcpy((uint8_t*) app_buf + lin_bytes, f->buffer, wrap_bytes);
       }
     break;
 
@@ -277,7 +405,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         // Wrap around case
 
         // Read full words from linear part of buffer
-        uint16_t lin_4n_bytes = lin_bytes & 0xFFFC;
+        tu_fifo_idx_t lin_4n_bytes = lin_bytes & ~3u;
         _ff_pull_const_addr(app_buf, ff_buf, lin_4n_bytes);
         ff_buf += lin_4n_bytes;
 
@@ -287,7 +415,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         {
           volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) _ff_min(wrap_bytes, 4-rem);
           wrap_bytes -= remrem;
 
           uint32_t tmp32=0;
@@ -320,44 +448,104 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
 // Helper
 //--------------------------------------------------------------------+
 
+// With power of two depth, index space [0, 2*depth) wraps naturally and all index arithmetic
+// reduces to masking. Note: depth = TU_FIFO_DEPTH_MAX gives an all-ones mask which is tu_fifo_idx_t wrap-around.
+TU_ATTR_ALWAYS_INLINE static inline
+bool _ff_depth_pow2(tu_fifo_idx_t depth)
+{
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  (void) depth;
+  return true;
+#else
+  return (depth & (depth - 1)) == 0;
+#endif
+}
+
 // return only the index difference and as such can be used to determine an overflow i.e overflowable count
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_count(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
+tu_fifo_idx_t _ff_count(tu_fifo_idx_t depth, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
+  if ( _ff_depth_pow2(depth) )
+  {
+    return (tu_fifo_idx_t) ((wr_idx - rd_idx) & (2*depth - 1));
+  }
+
   // In case we have non-power of two depth we need a further modification
   if (wr_idx >= rd_idx)
   {
-    return (uint16_t) (wr_idx - rd_idx);
+    return (tu_fifo_idx_t) (wr_idx - rd_idx);
   } else
   {
-    return (uint16_t) (2*depth - (rd_idx - wr_idx));
+    return (tu_fifo_idx_t) (2*depth - (rd_idx - wr_idx));
   }
 }
 
 // return remaining slot in fifo
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
+tu_fifo_idx_t _ff_remaining(tu_fifo_idx_t depth, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
-  uint16_t const count = _ff_count(depth, wr_idx, rd_idx);
+  tu_fifo_idx_t const count = _ff_count(depth, wr_idx, rd_idx);
   return (depth > count) ? (depth - count) : 0;
 }
 
+//--------------------------------------------------------------------+
+// Statistics
+//--------------------------------------------------------------------+
+#if CFG_TUSB_FIFO_STATS
+
+// Writer statistics, called with indices before write index is advanced. Only modified by writer.
+TU_ATTR_FAST_FUNC static void _ff_stats_write(tu_fifo_t* f, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx, tu_fifo_idx_t requested, tu_fifo_idx_t written)
+{
+  tu_fifo_stats_t* stats = &f->stats;
+  tu_fifo_idx_t const count = _ff_count(f->depth, wr_idx, rd_idx);
+
+  if ( count == 0 ) stats->writes_since_empty = 0;
+  stats->writes_since_empty++;
+
+  stats->write_total += written;
+
+  // dropped (non-overwritable) or overwritten (overwritable) data
+  if ( (written < requested) || (count + written > f->depth) ) stats->overflow_count++;
+
+  tu_fifo_idx_t const new_count = (tu_fifo_idx_t) tu_min32((uint32_t) count + written, f->depth);
+  if ( new_count > stats->max_count ) stats->max_count = new_count;
+}
+
+// Reader statistics. Only modified by reader.
+TU_ATTR_FAST_FUNC static void _ff_stats_read(tu_fifo_t* f, tu_fifo_idx_t requested, tu_fifo_idx_t read)
+{
+  f->stats.read_total += read;
+  if ( read < requested ) f->stats.underflow_count++;
+}
+
+#else
+
+#define _ff_stats_write(_f, _wr_idx, _rd_idx, _requested, _written)
+#define _ff_stats_read(_f, _requested, _read)
+
+#endif
+
 //--------------------------------------------------------------------+
 // Index Helper
 //--------------------------------------------------------------------+
 
 // Advance an absolute index
 // "absolute" index is only in the range of [0..2*depth)
-static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
+TU_ATTR_FAST_FUNC static tu_fifo_idx_t advance_index(tu_fifo_idx_t depth, tu_fifo_idx_t idx, tu_fifo_idx_t offset)
 {
+  if ( _ff_depth_pow2(depth) )
+  {
+    return (tu_fifo_idx_t) ((idx + offset) & (2*depth - 1));
+  }
+
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx + offset);
+  tu_fifo_idx_t new_idx = (tu_fifo_idx_t) (idx + offset);
   if ( (idx > new_idx) || (new_idx >= 2*depth) )
   {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx + non_used_index_space);
+    tu_fifo_idx_t const non_used_index_space = (tu_fifo_idx_t) (TU_FIFO_IDX_MAX - (2*depth-1));
+    new_idx = (tu_fifo_idx_t) (new_idx + non_used_index_space);
   }
 
   return new_idx;
@@ -365,16 +553,16 @@ static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
 
 #if 0 // not used but
 // Backward an absolute index
-static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
+static tu_fifo_idx_t backward_index(tu_fifo_idx_t depth, tu_fifo_idx_t idx, tu_fifo_idx_t offset)
 {
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx - offset);
+  tu_fifo_idx_t new_idx = (tu_fifo_idx_t) (idx - offset);
   if ( (idx < new_idx) || (new_idx >= 2*depth) )
   {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx - non_used_index_space);
+    tu_fifo_idx_t const non_used_index_space = (tu_fifo_idx_t) (TU_FIFO_IDX_MAX - (2*depth-1));
+    new_idx = (tu_fifo_idx_t) (new_idx - non_used_index_space);
   }
 
   return new_idx;
@@ -383,8 +571,13 @@ static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
 
 // index to pointer, simply an modulo with minus.
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t idx2ptr(uint16_t depth, uint16_t idx)
+tu_fifo_idx_t idx2ptr(tu_fifo_idx_t depth, tu_fifo_idx_t idx)
 {
+  if ( _ff_depth_pow2(depth) )
+  {
+    return (tu_fifo_idx_t) (idx & (depth - 1));
+  }
+
   // Only run at most 3 times since index is limit in the range of [0..2*depth)
   while ( idx >= depth ) idx -= depth;
   return idx;
@@ -394,9 +587,9 @@ uint16_t idx2ptr(uint16_t depth, uint16_t idx)
 // When an overwritable fifo is overflowed, rd_idx will be re-index so that it forms
 // an full fifo i.e _ff_count() = depth
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
+tu_fifo_idx_t _ff_correct_read_index(tu_fifo_t* f, tu_fifo_idx_t wr_idx)
 {
-  uint16_t rd_idx;
+  tu_fifo_idx_t rd_idx;
   if ( wr_idx >= f->depth )
   {
     rd_idx = wr_idx - f->depth;
@@ -412,9 +605,9 @@ uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16_t rd_idx)
+static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return false;
@@ -426,7 +619,7 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
     cnt = f->depth;
   }
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f->depth, rd_idx);
 
   // Peek data
   _ff_pull(f, p_buffer, rd_ptr);
@@ -436,9 +629,9 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint16_t wr_idx, uint16_t rd_idx, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static tu_fifo_idx_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return 0;
@@ -453,7 +646,7 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   // Check if we can read something at and after offset - if too less is available we read what remains
   if ( cnt < n ) n = cnt;
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f->depth, rd_idx);
 
   // Peek data
   _ff_pull_n(f, p_buffer, n, rd_ptr, copy_mode);
@@ -461,25 +654,29 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   return n;
 }
 
-static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static tu_fifo_idx_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   if ( n == 0 ) return 0;
 
   _ff_lock(f->mutex_wr);
 
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
+  tu_fifo_idx_t wr_idx = f->wr_idx;
+  tu_fifo_idx_t rd_idx = _ff_load_idx(&f->rd_idx);
 
   uint8_t const* buf8 = (uint8_t const*) data;
 
+#if CFG_TUSB_FIFO_STATS
+  tu_fifo_idx_t const n_requested = n;
+#endif
+
   TU_LOG(TU_FIFO_DBG, "rd = %3u, wr = %3u, count = %3u, remain = %3u, n = %3u:  ",
                        rd_idx, wr_idx, _ff_count(f->depth, wr_idx, rd_idx), _ff_remaining(f->depth, wr_idx, rd_idx), n);
 
   if ( !f->overwritable )
   {
     // limit up to full
-    uint16_t const remain = _ff_remaining(f->depth, wr_idx, rd_idx);
-    n = tu_min16(n, remain);
+    tu_fifo_idx_t const remain = _ff_remaining(f->depth, wr_idx, rd_idx);
+    n = _ff_min(n, remain);
   }
   else
   {
@@ -506,7 +703,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     }
     else
     {
-      uint16_t const overflowable_count = _ff_count(f->depth, wr_idx, rd_idx);
+      tu_fifo_idx_t const overflowable_count = _ff_count(f->depth, wr_idx, rd_idx);
       if (overflowable_count + n >= 2*f->depth)
       {
         // Double overflowed
@@ -528,9 +725,11 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     }
   }
 
+  _ff_stats_write(f, f->wr_idx, rd_idx, n_requested, n);
+
   if (n)
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+    tu_fifo_idx_t wr_ptr = idx2ptr(f->depth, wr_idx);
 
     TU_LOG(TU_FIFO_DBG, "actual_n = %u, wr_ptr = %u", n, wr_ptr);
 
@@ -538,7 +737,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     _ff_push_n(f, buf8, n, wr_ptr, copy_mode);
 
     // Advance index
-    f->wr_idx = advance_index(f->depth, wr_idx, n);
+    _ff_store_idx(&f->wr_idx, advance_index(f->depth, wr_idx, n));
 
     TU_LOG(TU_FIFO_DBG, "\tnew_wr = %u\r\n", f->wr_idx);
   }
@@ -548,16 +747,22 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
   return n;
 }
 
-static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static tu_fifo_idx_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   _ff_lock(f->mutex_rd);
 
+#if CFG_TUSB_FIFO_STATS
+  tu_fifo_idx_t const n_requested = n;
+#endif
+
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
-  n = _tu_fifo_peek_n(f, buffer, n, f->wr_idx, f->rd_idx, copy_mode);
+  n = _tu_fifo_peek_n(f, buffer, n, _ff_load_idx(&f->wr_idx), f->rd_idx, copy_mode);
+
+  _ff_stats_read(f, n_requested, n);
 
   // Advance read pointer
-  f->rd_idx = advance_index(f->depth, f->rd_idx, n);
+  _ff_store_idx(&f->rd_idx, advance_index(f->depth, f->rd_idx, n));
 
   _ff_unlock(f->mutex_rd);
   return n;
@@ -582,9 +787,9 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_count(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_count(tu_fifo_t* f)
 {
-  return tu_min16(_ff_count(f->depth, f->wr_idx, f->rd_idx), f->depth);
+  return _ff_min(_ff_count(f->depth, f->wr_idx, f->rd_idx), f->depth);
 }
 
 /******************************************************************************/
@@ -636,7 +841,7 @@ bool tu_fifo_full(tu_fifo_t* f)
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_remaining(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_remaining(tu_fifo_t* f)
 {
   return _ff_remaining(f->depth, f->wr_idx, f->rd_idx);
 }
@@ -697,10 +902,12 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
 
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
-  bool ret = _tu_fifo_peek(f, buffer, f->wr_idx, f->rd_idx);
+  bool ret = _tu_fifo_peek(f, buffer, _ff_load_idx(&f->wr_idx), f->rd_idx);
+
+  _ff_stats_read(f, 1, ret);
 
   // Advance pointer
-  f->rd_idx = advance_index(f->depth, f->rd_idx, ret);
+  _ff_store_idx(&f->rd_idx, advance_index(f->depth, f->rd_idx, ret));
 
   _ff_unlock(f->mutex_rd);
   return ret;
@@ -722,12 +929,12 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
     @returns number of items read from the FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_INC);
 }
 
-uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
@@ -748,7 +955,7 @@ uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint1
 bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
 {
   _ff_lock(f->mutex_rd);
-  bool ret = _tu_fifo_peek(f, p_buffer, f->wr_idx, f->rd_idx);
+  bool ret = _tu_fifo_peek(f, p_buffer, _ff_load_idx(&f->wr_idx), f->rd_idx);
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -768,10 +975,10 @@ bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
     @returns Number of bytes written to p_buffer
  */
 /******************************************************************************/
-uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n)
 {
   _ff_lock(f->mutex_rd);
-  uint16_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+  tu_fifo_idx_t ret = _tu_fifo_peek_n(f, p_buffer, n, _ff_load_idx(&f->wr_idx), f->rd_idx, TU_FIFO_COPY_INC);
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -796,23 +1003,23 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
 {
   _ff_lock(f->mutex_wr);
 
-  bool ret;
-  uint16_t const wr_idx = f->wr_idx;
+  tu_fifo_idx_t const wr_idx = f->wr_idx;
+  tu_fifo_idx_t const rd_idx = _ff_load_idx(&f->rd_idx);
 
-  if ( tu_fifo_full(f) && !f->overwritable )
-  {
-    ret = false;
-  }else
+  // non-overwritable fifo rejects data when full
+  bool const ret = f->overwritable || (_ff_count(f->depth, wr_idx, rd_idx) < f->depth);
+
+  _ff_stats_write(f, wr_idx, rd_idx, 1, ret);
+
+  if ( ret )
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+    tu_fifo_idx_t wr_ptr = idx2ptr(f->depth, wr_idx);
 
     // Write data
     _ff_push(f, data, wr_ptr);
 
     // Advance pointer
-    f->wr_idx = advance_index(f->depth, wr_idx, 1);
-
-    ret = true;
+    _ff_store_idx(&f->wr_idx, advance_index(f->depth, wr_idx, 1));
   }
 
   _ff_unlock(f->mutex_wr);
@@ -834,7 +1041,7 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_INC);
 }
@@ -854,7 +1061,7 @@ uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
@@ -875,6 +1082,16 @@ bool tu_fifo_clear(tu_fifo_t *f)
   f->rd_idx = 0;
   f->wr_idx = 0;
 
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+  f->mp_state = 0;
+#endif
+
+#if CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+  f->ow_claim_seq = 0;
+  f->ow_wr_seq    = 0;
+  f->ow_rd_seq    = 0;
+#endif
+
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
   return true;
@@ -919,9 +1136,10 @@ bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
                 Number of items the write pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
+TU_ATTR_FAST_FUNC void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->wr_idx = advance_index(f->depth, f->wr_idx, n);
+  _ff_stats_write(f, f->wr_idx, f->rd_idx, n, n);
+  _ff_store_idx(&f->wr_idx, advance_index(f->depth, f->wr_idx, n));
 }
 
 /******************************************************************************/
@@ -940,44 +1158,19 @@ void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
                 Number of items the read pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
+TU_ATTR_FAST_FUNC void tu_fifo_advance_read_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->rd_idx = advance_index(f->depth, f->rd_idx, n);
+  _ff_stats_read(f, n, n);
+  _ff_store_idx(&f->rd_idx, advance_index(f->depth, f->rd_idx, n));
 }
 
-/******************************************************************************/
-/*!
-   @brief Get read info
+//--------------------------------------------------------------------+
+// Linear span helper
+//--------------------------------------------------------------------+
 
-   Returns the length and pointer from which bytes can be read in a linear manner.
-   This is of major interest for DMA transmissions. If returned length is zero the
-   corresponding pointer is invalid.
-   The read pointer does NOT get advanced, use tu_fifo_advance_read_pointer() to
-   do so!
-   @param[in]       f
-                    Pointer to FIFO
-   @param[out]      *info
-                    Pointer to struct which holds the desired infos
- */
-/******************************************************************************/
-void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+// Fill info with readable spans for cnt items starting from rd_idx
+TU_ATTR_FAST_FUNC static void _ff_fill_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx, tu_fifo_idx_t cnt)
 {
-  // Operate on temporary values in case they change in between
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
-
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
-
-  // Check overflow and correct if required - may happen in case a DMA wrote too fast
-  if (cnt > f->depth)
-  {
-    _ff_lock(f->mutex_rd);
-    rd_idx = _ff_correct_read_index(f, wr_idx);
-    _ff_unlock(f->mutex_rd);
-
-    cnt = f->depth;
-  }
-
   // Check if fifo is empty
   if (cnt == 0)
   {
@@ -989,11 +1182,11 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t wr_ptr = idx2ptr(f->depth, wr_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f->depth, rd_idx);
 
   // Copy pointer to buffer to start reading from
-  info->ptr_lin = &f->buffer[rd_ptr];
+  info->ptr_lin = &f->buffer[rd_ptr * f->item_size];
 
   // Check if there is a wrap around necessary
   if (wr_ptr > rd_ptr)
@@ -1013,26 +1206,10 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 }
 
-/******************************************************************************/
-/*!
-   @brief Get linear write info
-
-   Returns the length and pointer to which bytes can be written into FIFO in a linear manner.
-   This is of major interest for DMA transmissions not using circular mode. If a returned length is zero the
-   corresponding pointer is invalid. The returned lengths summed up are the currently free space in the FIFO.
-   The write pointer does NOT get advanced, use tu_fifo_advance_write_pointer() to do so!
-   TAKE CARE TO NOT OVERFLOW THE BUFFER MORE THAN TWO TIMES THE FIFO DEPTH - IT CAN NOT RECOVERE OTHERWISE!
-   @param[in]       f
-                    Pointer to FIFO
-   @param[out]      *info
-                    Pointer to struct which holds the desired infos
- */
-/******************************************************************************/
-void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+// Fill info with writable spans for remaining free items starting from wr_idx
+TU_ATTR_FAST_FUNC static tu_fifo_idx_t _ff_fill_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
-  uint16_t remain = _ff_remaining(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t remain = _ff_remaining(f->depth, wr_idx, rd_idx);
 
   if (remain == 0)
   {
@@ -1040,15 +1217,15 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
     info->len_wrap = 0;
     info->ptr_lin  = NULL;
     info->ptr_wrap = NULL;
-    return;
+    return 0;
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t wr_ptr = idx2ptr(f->depth, wr_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f->depth, rd_idx);
 
   // Copy pointer to buffer to start writing to
-  info->ptr_lin = &f->buffer[wr_ptr];
+  info->ptr_lin = &f->buffer[wr_ptr * f->item_size];
 
   if (wr_ptr < rd_ptr)
   {
@@ -1063,4 +1240,742 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
     info->len_wrap = remain - info->len_lin; // Remaining length - n already was limited to remain or FIFO depth
     info->ptr_wrap = f->buffer;              // Always start of buffer
   }
+
+  return remain;
+}
+
+/******************************************************************************/
+/*!
+   @brief Get read info
+
+   Returns the length and pointer from which bytes can be read in a linear manner.
+   This is of major interest for DMA transmissions. If returned length is zero the
+   corresponding pointer is invalid.
+   The read pointer does NOT get advanced, use tu_fifo_advance_read_pointer() to
+   do so!
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which holds the desired infos
+ */
+/******************************************************************************/
+TU_ATTR_FAST_FUNC void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+{
+  // Operate on temporary values in case they change in between
+  tu_fifo_idx_t wr_idx = _ff_load_idx(&f->wr_idx);
+  tu_fifo_idx_t rd_idx = f->rd_idx;
+
+  tu_fifo_idx_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+
+  // Check overflow and correct if required - may happen in case a DMA wrote too fast
+  if (cnt > f->depth)
+  {
+    _ff_lock(f->mutex_rd);
+    rd_idx = _ff_correct_read_index(f, wr_idx);
+    _ff_unlock(f->mutex_rd);
+
+    cnt = f->depth;
+  }
+
+  _ff_fill_read_info(f, info, wr_idx, rd_idx, cnt);
+}
+
+/******************************************************************************/
+/*!
+   @brief Get linear write info
+
+   Returns the length and pointer to which bytes can be written into FIFO in a linear manner.
+   This is of major interest for DMA transmissions not using circular mode. If a returned length is zero the
+   corresponding pointer is invalid. The returned lengths summed up are the currently free space in the FIFO.
+   The write pointer does NOT get advanced, use tu_fifo_advance_write_pointer() to do so!
+   TAKE CARE TO NOT OVERFLOW THE BUFFER MORE THAN TWO TIMES THE FIFO DEPTH - IT CAN NOT RECOVERE OTHERWISE!
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which holds the desired infos
+ */
+/******************************************************************************/
+TU_ATTR_FAST_FUNC void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+{
+  (void) _ff_fill_write_info(f, info, f->wr_idx, _ff_load_idx(&f->rd_idx));
+}
+
+/******************************************************************************/
+/*!
+   @brief Reserve free space for zero-copy writing
+
+   Lock the write side of FIFO and return up to two linear spans (linear part
+   and wrapped part) of free space, application can then build its data directly
+   in FIFO memory. Data is published by tu_fifo_write_commit() which also unlocks
+   the write side, therefore every reserve MUST be followed by a commit (with
+   n = 0 if nothing is written). Overwritable FIFO only offers free space i.e
+   unread data is never overwritten by a reservation.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which holds the reserved spans
+   @returns Number of reserved items (len_lin + len_wrap)
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_write_reserve(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+{
+  _ff_lock(f->mutex_wr);
+  return _ff_fill_write_info(f, info, f->wr_idx, _ff_load_idx(&f->rd_idx));
+}
+
+/******************************************************************************/
+/*!
+   @brief Commit items written into a reservation
+
+   Publish n items written into spans returned by tu_fifo_write_reserve() and
+   unlock the write side. n must not exceed the reserved count.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items written
+ */
+/******************************************************************************/
+void tu_fifo_write_commit(tu_fifo_t *f, tu_fifo_idx_t n)
+{
+  if (n)
+  {
+    _ff_stats_write(f, f->wr_idx, f->rd_idx, n, n);
+    _ff_store_idx(&f->wr_idx, advance_index(f->depth, f->wr_idx, n));
+  }
+  _ff_unlock(f->mutex_wr);
+}
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+
+// Multi-producer state is a single word updated by CAS: reserve index in lower half, number of producers
+// holding a reservation in upper half. Published wr_idx is only written by a producer that is the only one
+// in flight, i.e all data up to reserve index is written. Such a writer is unique until its commit CAS
+// succeeds, therefore wr_idx never moves backward and no producer ever waits for another one.
+#define MP_INFLIGHT_ONE   0x10000u
+
+/******************************************************************************/
+/*!
+   @brief Reserve space for a message from one of multiple producers
+
+   Claim exactly n contiguous items (in FIFO order) by CAS on the reserve index.
+   The reservation is all or nothing, returned spans (linear and wrapped part)
+   sum up to n. Must be followed by tu_fifo_mp_write_commit().
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items to reserve
+   @param[out]      *info
+                    Pointer to struct which holds the reserved spans
+   @returns n if reserved, 0 if there is not enough free space
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_mp_write_reserve(tu_fifo_t *f, tu_fifo_idx_t n, tu_fifo_buffer_info_t *info)
+{
+  uint32_t state = tu_atomic_load_acquire(&f->mp_state);
+  tu_fifo_idx_t start;
+
+  while (1)
+  {
+    start = (tu_fifo_idx_t) state;
+
+    // rd_idx only advances, a stale value under-estimates the free space
+    if ( n == 0 || _ff_remaining(f->depth, start, _ff_load_idx(&f->rd_idx)) < n )
+    {
+      info->len_lin  = 0;
+      info->len_wrap = 0;
+      info->ptr_lin  = NULL;
+      info->ptr_wrap = NULL;
+      return 0;
+    }
+
+    uint32_t const desired = ((state & 0xFFFF0000u) + MP_INFLIGHT_ONE) | advance_index(f->depth, start, n);
+    if ( tu_atomic_cas(&f->mp_state, &state, desired) ) break;
+  }
+
+  tu_fifo_idx_t const wr_ptr = idx2ptr(f->depth, start);
+  tu_fifo_idx_t const lin    = _ff_min(n, (tu_fifo_idx_t) (f->depth - wr_ptr));
+
+  info->ptr_lin  = &f->buffer[wr_ptr * f->item_size];
+  info->len_lin  = lin;
+  info->len_wrap = (tu_fifo_idx_t) (n - lin);
+  info->ptr_wrap = info->len_wrap ? f->buffer : NULL;
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Commit a message reserved by tu_fifo_mp_write_reserve()
+
+   Release the reservation. The last producer in flight publishes all reserved
+   data (including reservations of producers committed before it).
+
+   @param[in]       f
+                    Pointer to FIFO
+ */
+/******************************************************************************/
+void tu_fifo_mp_write_commit(tu_fifo_t *f)
+{
+  uint32_t state = tu_atomic_load_acquire(&f->mp_state);
+
+  while (1)
+  {
+    if ( (state >> 16) == 1 )
+    {
+      // only producer in flight: everything up to reserve index is written
+      _ff_store_idx(&f->wr_idx, (tu_fifo_idx_t) state);
+    }
+
+    // on failure another producer has reserved in between, retry (it will publish its own data)
+    if ( tu_atomic_cas(&f->mp_state, &state, state - MP_INFLIGHT_ONE) ) break;
+  }
+}
+
+/******************************************************************************/
+/*!
+   @brief Write a message from one of multiple producers
+
+   Copy n items as one message that is never interleaved with other producers'
+   data. All or nothing, nothing is written if there is not enough free space.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       data
+                    Pointer to message
+   @param[in]       n
+                    Number of items
+   @returns n if written, 0 otherwise
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_mp_write_n(tu_fifo_t *f, const void * data, tu_fifo_idx_t n)
+{
+  tu_fifo_buffer_info_t info;
+  if ( 0 == tu_fifo_mp_write_reserve(f, n, &info) ) return 0;
+
+  tu_fifo_idx_t const lin_bytes = (tu_fifo_idx_t) (info.len_lin * f->item_size);
+  _ff_memcpy(info.ptr_lin, data, lin_bytes);
+  if ( info.len_wrap )
+  {
+    _ff_memcpy(info.ptr_wrap, ((uint8_t const*) data) + lin_bytes, (tu_fifo_idx_t) (info.len_wrap * f->item_size));
+  }
+
+  tu_fifo_mp_write_commit(f);
+  return n;
+}
+
+#endif
+
+#if CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+
+// Lock-free overwrite works like a seqlock: writer claims slots (ow_claim_seq) before overwriting them and
+// publishes them (ow_wr_seq) afterwards. Sequences are free running 32-bit item counts, slot is sequence masked
+// by depth (power of two) so that wrap-around of the sequence does not break the slot order. Reader copies
+// optimistically and then checks the claim: item with sequence s is intact if s >= claim - depth.
+TU_ATTR_ALWAYS_INLINE static inline
+tu_fifo_idx_t _ff_ow_ptr(tu_fifo_idx_t depth, uint32_t seq)
+{
+  return (tu_fifo_idx_t) (seq & (uint32_t) (depth - 1u));
+}
+
+/******************************************************************************/
+/*!
+   @brief Write n items, overwriting oldest ones if full, without any lock
+
+   Wait-free for a single writer e.g ISR. Reader state is never touched, if more
+   than depth items are written only the newest depth items are stored.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       data
+                    Pointer to items
+   @param[in]       n
+                    Number of items
+   @returns n, 0 if depth is not power of two
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_ow_write_n(tu_fifo_t *f, const void * data, tu_fifo_idx_t n)
+{
+  if ( n == 0 || !_ff_depth_pow2(f->depth) ) return 0;
+
+  uint32_t const wr_seq = f->ow_wr_seq; // only modified by this writer
+  tu_fifo_idx_t const skip = (n > f->depth) ? (tu_fifo_idx_t) (n - f->depth) : 0;
+
+  // claim slots before overwriting them, so that a reader copying them concurrently discards its copy
+  f->ow_claim_seq = wr_seq + n;
+  tu_atomic_fence_release();
+
+  _ff_push_n(f, ((uint8_t const*) data) + skip * f->item_size, (tu_fifo_idx_t) (n - skip),
+             _ff_ow_ptr(f->depth, wr_seq + skip), TU_FIFO_COPY_INC);
+
+  tu_atomic_store_release(&f->ow_wr_seq, wr_seq + n);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Read up to n oldest items written by tu_fifo_ow_write_n()
+
+   Lock-free: if the writer has lapped the reader, or overwrote items while they
+   were copied, reader skips to the oldest intact item (and retries the copy).
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      buffer
+                    Pointer to buffer for items
+   @param[in]       n
+                    Maximum number of items to read
+   @param[out]      lost
+                    Number of items skipped since previous read (can be NULL)
+   @returns number of items read
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_ow_read_n(tu_fifo_t *f, void * buffer, tu_fifo_idx_t n, uint32_t* lost)
+{
+  uint32_t rd_seq = f->ow_rd_seq;
+  uint32_t skipped = 0;
+  tu_fifo_idx_t count = 0;
+
+  while ( _ff_depth_pow2(f->depth) )
+  {
+    uint32_t const wr_seq = tu_atomic_load_acquire(&f->ow_wr_seq);
+
+    // lapped: oldest item still in fifo is depth behind the writer
+    if ( (int32_t) (wr_seq - rd_seq) > (int32_t) f->depth )
+    {
+      skipped += wr_seq - f->depth - rd_seq;
+      rd_seq   = wr_seq - f->depth;
+    }
+
+    // reader may be ahead of a write (larger than depth) that has not been published yet
+    int32_t const available = (int32_t) (wr_seq - rd_seq);
+    count = (available > 0) ? (tu_fifo_idx_t) tu_min32((uint32_t) available, n) : 0;
+    if ( count == 0 ) break;
+
+    _ff_pull_n(f, buffer, count, _ff_ow_ptr(f->depth, rd_seq), TU_FIFO_COPY_INC);
+
+    // copy is valid only if none of its slots has been claimed by writer meanwhile
+    tu_atomic_fence_acquire();
+    uint32_t const oldest = f->ow_claim_seq - f->depth;
+    if ( (int32_t) (oldest - rd_seq) <= 0 ) break;
+
+    skipped += oldest - rd_seq;
+    rd_seq   = oldest;
+  }
+
+  f->ow_rd_seq = rd_seq + count;
+  if ( lost ) *lost = skipped;
+
+  return count;
+}
+
+/******************************************************************************/
+/*!
+   @brief Number of items available to tu_fifo_ow_read_n(), at most depth
+
+   @param[in]       f
+                    Pointer to FIFO
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_ow_count(tu_fifo_t *f)
+{
+  int32_t const count = (int32_t) (tu_atomic_load_acquire(&f->ow_wr_seq) - f->ow_rd_seq);
+  if ( count <= 0 ) return 0;
+  return (tu_fifo_idx_t) tu_min32((uint32_t) count, f->depth);
+}
+
+#endif
+
+/******************************************************************************/
+/*!
+   @brief Reserve available data for zero-copy reading
+
+   Lock the read side of FIFO and return up to two linear spans (linear part and
+   wrapped part) of available data, which can be consumed directly from FIFO
+   memory. Overflow is checked and corrected as with tu_fifo_read_n(). Every
+   reserve MUST be followed by tu_fifo_read_commit() (with n = 0 if nothing is
+   consumed) which also unlocks the read side.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which holds the reserved spans
+   @returns Number of reserved items (len_lin + len_wrap)
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_read_reserve(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+{
+  _ff_lock(f->mutex_rd);
+
+  tu_fifo_idx_t wr_idx = _ff_load_idx(&f->wr_idx);
+  tu_fifo_idx_t rd_idx = f->rd_idx;
+  tu_fifo_idx_t cnt    = _ff_count(f->depth, wr_idx, rd_idx);
+
+  // Check overflow and correct if required
+  if (cnt > f->depth)
+  {
+    rd_idx = _ff_correct_read_index(f, wr_idx);
+    cnt    = f->depth;
+  }
+
+  _ff_fill_read_info(f, info, wr_idx, rd_idx, cnt);
+
+  return cnt;
+}
+
+/******************************************************************************/
+/*!
+   @brief Consume items from a read reservation
+
+   Remove n items consumed from spans returned by tu_fifo_read_reserve() and
+   unlock the read side. n must not exceed the reserved count.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items consumed
+ */
+/******************************************************************************/
+void tu_fifo_read_commit(tu_fifo_t *f, tu_fifo_idx_t n)
+{
+  if (n)
+  {
+    _ff_stats_read(f, n, n);
+    _ff_store_idx(&f->rd_idx, advance_index(f->depth, f->rd_idx, n));
+  }
+  _ff_unlock(f->mutex_rd);
+}
+
+#if CFG_TUSB_FIFO_STATS
+/******************************************************************************/
+/*!
+   @brief Get fifo statistics
+
+   Statistics are collected since tu_fifo_config() or tu_fifo_stats_clear().
+   Counters are in unit of items (bytes for most class driver fifos).
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *stats
+                    Pointer to struct which holds the statistics
+ */
+/******************************************************************************/
+void tu_fifo_stats_get(tu_fifo_t *f, tu_fifo_stats_t* stats)
+{
+  (*stats) = f->stats;
+}
+
+void tu_fifo_stats_clear(tu_fifo_t *f)
+{
+  _ff_lock(f->mutex_wr);
+  _ff_lock(f->mutex_rd);
+
+  tu_varclr(&f->stats);
+
+  _ff_unlock(f->mutex_wr);
+  _ff_unlock(f->mutex_rd);
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Hardware FIFO / Packet Memory Access
+//--------------------------------------------------------------------+
+#define HWFIFO_WIDTH(_access)   ((uint8_t) ((_access) & 0x0Fu))
+#define HWFIFO_STRIDE(_access)  ((uintptr_t) (((_access) >> 4) & 0x0Fu))
+#define HWFIFO_NARROW(_access)  (((_access) & 0x100u) != 0)
+
+// Write count full-width accesses, return next controller address
+TU_ATTR_FAST_FUNC static uintptr_t _hwfifo_write_full(uintptr_t hw, uint8_t const* src, uint16_t count, tu_hwfifo_access_t access)
+{
+  uintptr_t const stride = HWFIFO_STRIDE(access);
+
+  switch ( HWFIFO_WIDTH(access) )
+  {
+    case 4:
+      if ( (((uintptr_t) src) & 3) == 0 )
+      {
+        // aligned buffer: plain word load, avoid byte access of unaligned read on strict align MCUs
+        uint32_t const* src32 = (uint32_t const*) (uintptr_t) src;
+        while ( count-- )
+        {
+          *(volatile uint32_t*) hw = *src32++;
+          hw += stride;
+        }
+      }
+      else
+      {
+        while ( count-- )
+        {
+          *(volatile uint32_t*) hw = tu_unaligned_read32(src);
+          src += 4;
+          hw  += stride;
+        }
+      }
+    break;
+
+    case 2:
+      while ( count-- )
+      {
+        *(volatile uint16_t*) hw = tu_unaligned_read16(src);
+        src += 2;
+        hw  += stride;
+      }
+    break;
+
+    default:
+      while ( count-- )
+      {
+        *(volatile uint8_t*) hw = *src++;
+        hw += stride;
+      }
+    break;
+  }
+
+  return hw;
+}
+
+// Read count full-width accesses, return next controller address
+TU_ATTR_FAST_FUNC static uintptr_t _hwfifo_read_full(uintptr_t hw, uint8_t* dst, uint16_t count, tu_hwfifo_access_t access)
+{
+  uintptr_t const stride = HWFIFO_STRIDE(access);
+
+  switch ( HWFIFO_WIDTH(access) )
+  {
+    case 4:
+      if ( (((uintptr_t) dst) & 3) == 0 )
+      {
+        // aligned buffer: plain word store, avoid byte access of unaligned write on strict align MCUs
+        uint32_t* dst32 = (uint32_t*) (uintptr_t) dst;
+        while ( count-- )
+        {
+          *dst32++ = *(volatile uint32_t const*) hw;
+          hw += stride;
+        }
+      }
+      else
+      {
+        while ( count-- )
+        {
+          tu_unaligned_write32(dst, *(volatile uint32_t const*) hw);
+          dst += 4;
+          hw  += stride;
+        }
+      }
+    break;
+
+    case 2:
+      while ( count-- )
+      {
+        tu_unaligned_write16(dst, *(volatile uint16_t const*) hw);
+        dst += 2;
+        hw  += stride;
+      }
+    break;
+
+    default:
+      while ( count-- )
+      {
+        *dst++ = *(volatile uint8_t const*) hw;
+        hw += stride;
+      }
+    break;
+  }
+
+  return hw;
+}
+
+TU_ATTR_FAST_FUNC static uintptr_t _hwfifo_write(uintptr_t hw, uint8_t const* src, uint16_t len, tu_hwfifo_access_t access)
+{
+  uint8_t const width = HWFIFO_WIDTH(access);
+  uint8_t rem = (uint8_t) (len & (width - 1u));
+
+  hw   = _hwfifo_write_full(hw, src, (uint16_t) (len >> (width >> 1)), access);
+  src += len - rem;
+
+  if ( rem )
+  {
+    uintptr_t const stride = HWFIFO_STRIDE(access);
+
+    if ( HWFIFO_NARROW(access) )
+    {
+      if ( rem >= 2 )
+      {
+        *(volatile uint16_t*) hw = tu_unaligned_read16(src);
+        src += 2;
+        rem -= 2;
+        if ( stride ) hw += 2;
+      }
+
+      if ( rem )
+      {
+        *(volatile uint8_t*) hw = *src;
+        if ( stride ) hw += 1;
+      }
+    }
+    else
+    {
+      // single zero-padded access, controller only takes the valid bytes
+      uint32_t tmp32 = 0;
+      memcpy(&tmp32, src, rem);
+
+      if ( width == 4 )
+      {
+        *(volatile uint32_t*) hw = tmp32;
+      }
+      else
+      {
+        *(volatile uint16_t*) hw = (uint16_t) tmp32;
+      }
+      hw += stride;
+    }
+  }
+
+  return hw;
+}
+
+TU_ATTR_FAST_FUNC static uintptr_t _hwfifo_read(uintptr_t hw, uint8_t* dst, uint16_t len, tu_hwfifo_access_t access)
+{
+  uint8_t const width = HWFIFO_WIDTH(access);
+  uint8_t rem = (uint8_t) (len & (width - 1u));
+
+  hw   = _hwfifo_read_full(hw, dst, (uint16_t) (len >> (width >> 1)), access);
+  dst += len - rem;
+
+  if ( rem )
+  {
+    uintptr_t const stride = HWFIFO_STRIDE(access);
+
+    if ( HWFIFO_NARROW(access) )
+    {
+      if ( rem >= 2 )
+      {
+        tu_unaligned_write16(dst, *(volatile uint16_t const*) hw);
+        dst += 2;
+        rem -= 2;
+        if ( stride ) hw += 2;
+      }
+
+      if ( rem )
+      {
+        *dst = *(volatile uint8_t const*) hw;
+        if ( stride ) hw += 1;
+      }
+    }
+    else
+    {
+      // single full-width access, only take the valid bytes
+      uint32_t tmp32 = (width == 4) ? *(volatile uint32_t const*) hw : *(volatile uint16_t const*) hw;
+      memcpy(dst, &tmp32, rem);
+      hw += stride;
+    }
+  }
+
+  return hw;
+}
+
+TU_ATTR_FAST_FUNC void tu_hwfifo_write(volatile void* hwfifo, const void* src, uint16_t len, tu_hwfifo_access_t access)
+{
+  (void) _hwfifo_write((uintptr_t) hwfifo, (uint8_t const*) src, len, access);
+}
+
+TU_ATTR_FAST_FUNC void tu_hwfifo_read(const volatile void* hwfifo, void* dst, uint16_t len, tu_hwfifo_access_t access)
+{
+  (void) _hwfifo_read((uintptr_t) hwfifo, (uint8_t*) dst, len, access);
+}
+
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_hwfifo_write_from_fifo(volatile void* hwfifo, tu_fifo_t* f, uint16_t len, tu_hwfifo_access_t access)
+{
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(f, &info);
+
+  uint16_t const cnt_lin  = (uint16_t) TU_MIN(len, info.len_lin);
+  uint16_t       cnt_wrap = (uint16_t) TU_MIN((uint16_t) (len - cnt_lin), info.len_wrap);
+  uint16_t const total    = cnt_lin + cnt_wrap;
+
+  uintptr_t hw = (uintptr_t) hwfifo;
+  uint8_t const* lin  = (uint8_t const*) info.ptr_lin;
+  uint8_t const* wrap = (uint8_t const*) info.ptr_wrap;
+
+  if ( cnt_wrap == 0 )
+  {
+    (void) _hwfifo_write(hw, lin, cnt_lin, access);
+  }
+  else
+  {
+    // If linear part does not end on an access boundary, its last bytes are combined with the first
+    // wrapped bytes so that controller side is written as a continuous stream
+    uint8_t const width   = HWFIFO_WIDTH(access);
+    uint8_t const lin_rem = (uint8_t) (cnt_lin & (width - 1u));
+
+    hw = _hwfifo_write(hw, lin, cnt_lin - lin_rem, access);
+
+    if ( lin_rem )
+    {
+      uint8_t tmp[4];
+      uint8_t const take = (uint8_t) TU_MIN(width - lin_rem, cnt_wrap);
+
+      memcpy(tmp, lin + cnt_lin - lin_rem, lin_rem);
+      memcpy(tmp + lin_rem, wrap, take);
+      hw = _hwfifo_write(hw, tmp, lin_rem + take, access);
+
+      wrap     += take;
+      cnt_wrap -= take;
+    }
+
+    (void) _hwfifo_write(hw, wrap, cnt_wrap, access);
+  }
+
+  tu_fifo_advance_read_pointer(f, total);
+
+  return total;
+}
+
+TU_ATTR_FAST_FUNC tu_fifo_idx_t tu_hwfifo_read_to_fifo(const volatile void* hwfifo, tu_fifo_t* f, uint16_t len, tu_hwfifo_access_t access)
+{
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_write_info(f, &info);
+
+  uint16_t const cnt_lin  = (uint16_t) TU_MIN(len, info.len_lin);
+  uint16_t       cnt_wrap = (uint16_t) TU_MIN((uint16_t) (len - cnt_lin), info.len_wrap);
+  uint16_t const total    = cnt_lin + cnt_wrap;
+
+  uintptr_t hw = (uintptr_t) hwfifo;
+  uint8_t* lin  = (uint8_t*) info.ptr_lin;
+  uint8_t* wrap = (uint8_t*) info.ptr_wrap;
+
+  if ( cnt_wrap == 0 )
+  {
+    (void) _hwfifo_read(hw, lin, cnt_lin, access);
+  }
+  else
+  {
+    // If linear part does not end on an access boundary, the access straddling the wrap is read into
+    // a temporary buffer then split between end of linear and start of wrapped part
+    uint8_t const width   = HWFIFO_WIDTH(access);
+    uint8_t const lin_rem = (uint8_t) (cnt_lin & (width - 1u));
+
+    hw = _hwfifo_read(hw, lin, cnt_lin - lin_rem, access);
+
+    if ( lin_rem )
+    {
+      uint8_t tmp[4];
+      uint8_t const take = (uint8_t) TU_MIN(width - lin_rem, cnt_wrap);
+
+      hw = _hwfifo_read(hw, tmp, lin_rem + take, access);
+      memcpy(lin + cnt_lin - lin_rem, tmp, lin_rem);
+      memcpy(wrap, tmp + lin_rem, take);
+
+      wrap     += take;
+      cnt_wrap -= take;
+    }
+
+    (void) _hwfifo_read(hw, wrap, cnt_wrap, access);
+  }
+
+  tu_fifo_advance_write_pointer(f, total);
+
+  return total;
 }
@@ -46,7 +46,29 @@ extern "C" {
 
 // mutex is only needed for RTOS
 // for OS None, we don't get preempted
-#define CFG_FIFO_MUTEX      OSAL_MUTEX_REQUIRED
+// for CFG_TUSB_FIFO_SPSC, there is only one writer and one reader which are synchronized by
+// acquire/release on wr_idx/rd_idx. A FIFO can also be made lock-free individually by passing NULL
+// as its mutex to tu_fifo_config_mutex().
+#define CFG_FIFO_MUTEX      (OSAL_MUTEX_REQUIRED && !CFG_TUSB_FIFO_SPSC)
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER && !defined(tu_atomic_cas)
+  #error "CFG_TUSB_FIFO_MULTI_PRODUCER requires atomic compare-and-swap (tu_atomic_cas) support from compiler"
+#endif
+
+// Index/count type, 32-bit index lifts the depth limit for large (high speed audio/video/network) buffers
+#if CFG_TUSB_FIFO_IDX32
+  typedef uint32_t tu_fifo_idx_t;
+  #define TU_FIFO_IDX_MAX     UINT32_MAX
+  #define TU_FIFO_DEPTH_MAX   0x80000000u
+
+  #if CFG_TUSB_FIFO_MULTI_PRODUCER
+    #error "CFG_TUSB_FIFO_MULTI_PRODUCER packs reserve index into 16 bits and does not support CFG_TUSB_FIFO_IDX32"
+  #endif
+#else
+  typedef uint16_t tu_fifo_idx_t;
+  #define TU_FIFO_IDX_MAX     UINT16_MAX
+  #define TU_FIFO_DEPTH_MAX   0x8000u
+#endif
 
 /* Write/Read index is always in the range of:
  *      0 .. 2*depth-1
@@ -104,38 +126,73 @@ extern "C" {
  *      | R | 1 | 2 | W | 4 | 5 |
 
  */
+#if CFG_TUSB_FIFO_STATS
+typedef struct
+{
+  tu_fifo_idx_t max_count          ; // high-water mark: max number of items ever in fifo
+  uint32_t      write_total        ; // total items written
+  uint32_t      read_total         ; // total items read
+  uint32_t      overflow_count     ; // number of writes where data was dropped or overwritten
+  uint32_t      underflow_count    ; // number of reads returning less items than requested
+  uint32_t      writes_since_empty ; // number of writes since fifo was last seen empty by writer
+} tu_fifo_stats_t;
+#endif
+
 typedef struct
 {
   uint8_t* buffer          ; // buffer pointer
-  uint16_t depth           ; // max items
+  tu_fifo_idx_t depth      ; // max items
 
   struct TU_ATTR_PACKED {
     uint16_t item_size : 15; // size of each item
     bool overwritable  : 1 ; // ovwerwritable when full
   };
 
-  volatile uint16_t wr_idx ; // write index
-  volatile uint16_t rd_idx ; // read index
+  volatile tu_fifo_idx_t wr_idx ; // write index
+  volatile tu_fifo_idx_t rd_idx ; // read index
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+  volatile uint32_t mp_state; // multi-producer: reserve index (bit 15..0), producers in flight (bit 31..16)
+#endif
+
+#if CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+  volatile uint32_t ow_claim_seq; // lock-free overwrite: items claimed by writer i.e being written up to here
+  volatile uint32_t ow_wr_seq;    // lock-free overwrite: items written (free running)
+  uint32_t          ow_rd_seq;    // lock-free overwrite: items read or skipped by reader (free running)
+#endif
 
-#if OSAL_MUTEX_REQUIRED
+#if CFG_FIFO_MUTEX
   osal_mutex_t mutex_wr;
   osal_mutex_t mutex_rd;
 #endif
 
+#if CFG_TUSB_FIFO_STATS
+  tu_fifo_stats_t stats;
+#endif
+
 } tu_fifo_t;
 
 typedef struct
 {
-  uint16_t len_lin  ; ///< linear length in item size
-  uint16_t len_wrap ; ///< wrapped length in item size
-  void * ptr_lin    ; ///< linear part start pointer
-  void * ptr_wrap   ; ///< wrapped part start pointer
+  tu_fifo_idx_t len_lin  ; ///< linear length in item size
+  tu_fifo_idx_t len_wrap ; ///< wrapped length in item size
+  void * ptr_lin         ; ///< linear part start pointer
+  void * ptr_wrap        ; ///< wrapped part start pointer
 } tu_fifo_buffer_info_t;
 
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  // masked index arithmetic is used unconditionally: fail to compile (negative array size) if
+  // statically initialized fifo has non power of two depth
+  #define _TU_FIFO_DEPTH(_depth) \
+    ((tu_fifo_idx_t) ((_depth) + 0*sizeof(char[(((_depth) & ((_depth) - 1)) == 0) ? 1 : -1])))
+#else
+  #define _TU_FIFO_DEPTH(_depth) (_depth)
+#endif
+
 #define TU_FIFO_INIT(_buffer, _depth, _type, _overwritable) \
 {                                                           \
   .buffer               = _buffer,                          \
-  .depth                = _depth,                           \
+  .depth                = _TU_FIFO_DEPTH(_depth),           \
   .item_size            = sizeof(_type),                    \
   .overwritable         = _overwritable,                    \
 }
@@ -147,9 +204,9 @@ typedef struct
 
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable);
 bool tu_fifo_clear(tu_fifo_t *f);
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable);
 
-#if OSAL_MUTEX_REQUIRED
+#if CFG_FIFO_MUTEX
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_fifo_config_mutex(tu_fifo_t *f, osal_mutex_t wr_mutex, osal_mutex_t rd_mutex)
 {
@@ -163,34 +220,34 @@ void tu_fifo_config_mutex(tu_fifo_t *f, osal_mutex_t wr_mutex, osal_mutex_t rd_m
 
 #endif
 
-bool     tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
-uint16_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, uint16_t n);
-uint16_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, uint16_t n);
+bool          tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
+tu_fifo_idx_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, tu_fifo_idx_t n);
 
-bool     tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
-uint16_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, uint16_t n);
+bool          tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, tu_fifo_idx_t n);
 
-bool     tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
+bool          tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
 
-uint16_t tu_fifo_count                  (tu_fifo_t* f);
-uint16_t tu_fifo_remaining              (tu_fifo_t* f);
-bool     tu_fifo_empty                  (tu_fifo_t* f);
-bool     tu_fifo_full                   (tu_fifo_t* f);
-bool     tu_fifo_overflowed             (tu_fifo_t* f);
-void     tu_fifo_correct_read_pointer   (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_count                  (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_remaining              (tu_fifo_t* f);
+bool          tu_fifo_empty                  (tu_fifo_t* f);
+bool          tu_fifo_full                   (tu_fifo_t* f);
+bool          tu_fifo_overflowed             (tu_fifo_t* f);
+void          tu_fifo_correct_read_pointer   (tu_fifo_t* f);
 
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t tu_fifo_depth(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_depth(tu_fifo_t* f)
 {
   return f->depth;
 }
 
 // Pointer modifications intended to be used in combinations with DMAs.
 // USE WITH CARE - NO SAFETY CHECKS CONDUCTED HERE! NOT MUTEX PROTECTED!
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
-void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n);
+void tu_fifo_advance_read_pointer (tu_fifo_t *f, tu_fifo_idx_t n);
 
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
@@ -198,6 +255,78 @@ void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
 void tu_fifo_get_read_info (tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 
+// Zero-copy access: reserve returns up to two linear spans (in items) to write into or read from
+// directly, commit then publishes/consumes n items. Reserve holds the write/read mutex until commit,
+// therefore every reserve must be paired with a commit (n = 0 if unused).
+tu_fifo_idx_t tu_fifo_write_reserve(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
+void          tu_fifo_write_commit (tu_fifo_t *f, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_reserve (tu_fifo_t *f, tu_fifo_buffer_info_t *info);
+void          tu_fifo_read_commit  (tu_fifo_t *f, tu_fifo_idx_t n);
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+// Lock-free multi-producer write: reserve exactly n contiguous items (all or nothing, return 0 if there is not
+// enough free space) from any task/ISR, fill them then commit. Messages from different producers are never
+// interleaved, data is published once all earlier reservations are committed. Every reserve must be paired
+// with a commit and the whole reservation is always published. Never overwrites, a FIFO written with this
+// API must not be written by other write functions (reading, clear and config are not changed).
+tu_fifo_idx_t tu_fifo_mp_write_reserve(tu_fifo_t *f, tu_fifo_idx_t n, tu_fifo_buffer_info_t *info);
+void          tu_fifo_mp_write_commit (tu_fifo_t *f);
+tu_fifo_idx_t tu_fifo_mp_write_n      (tu_fifo_t *f, const void * data, tu_fifo_idx_t n);
+#endif
+
+#if CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+// Lock-free overwrite: a single writer stores n items wait-free in constant time (only the newest depth items if n
+// is larger), overwriting the oldest data when full and never touching reader state, e.g from an ISR. A single
+// reader copies up to n of the oldest items still in FIFO: if it has been lapped, or data was overwritten while
+// being copied, it resynchronizes to the oldest valid item and reports the number of items skipped in *lost
+// (can be NULL). Depth must be power of two. A FIFO used with this API must not be used with other read/write
+// functions (clear and config are not changed).
+tu_fifo_idx_t tu_fifo_ow_write_n(tu_fifo_t *f, const void * data, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_ow_read_n (tu_fifo_t *f, void * buffer, tu_fifo_idx_t n, uint32_t* lost);
+tu_fifo_idx_t tu_fifo_ow_count  (tu_fifo_t *f);
+#endif
+
+#if CFG_TUSB_FIFO_STATS
+// Statistics (high-water mark, totals, overflow/underflow) for sizing fifo depth
+void     tu_fifo_stats_get    (tu_fifo_t *f, tu_fifo_stats_t* stats);
+void     tu_fifo_stats_clear  (tu_fifo_t *f);
+#endif
+
+//--------------------------------------------------------------------+
+// Hardware FIFO / Packet Memory Access
+//--------------------------------------------------------------------+
+// Packet copy between memory and a controller FIFO data register or dedicated packet memory, used by
+// PIO-mode DCDs/HCDs. The access descriptor describes how the controller side must be accessed:
+// - width : bus access width in bytes: 1, 2 or 4. Memory side can be any alignment.
+// - stride: address increment in bytes after each access. 0 for a fixed FIFO data register, width for
+//           linear packet memory, larger e.g for 16-bit packet memory mapped in 32-bit words (stm32 fsdev 1x2)
+// - narrow: trailing bytes (less than width) are transferred with narrower 16/8-bit accesses (e.g musb).
+//           Otherwise a single zero-padded access is used and controller only takes the valid bytes (e.g dwc2)
+typedef uint16_t tu_hwfifo_access_t;
+
+#define TU_HWFIFO_ACCESS(_width, _stride, _narrow) \
+  ((tu_hwfifo_access_t) (((_width) & 0x0Fu) | (((_stride) & 0x0Fu) << 4) | ((_narrow) ? 0x100u : 0u)))
+
+// Common access styles
+#define TU_HWFIFO_REG8            TU_HWFIFO_ACCESS(1, 0, false) // byte data register e.g samg UDP_FDR
+#define TU_HWFIFO_REG32           TU_HWFIFO_ACCESS(4, 0, false) // 32-bit data register, padded tail e.g dwc2
+#define TU_HWFIFO_REG32_NARROW    TU_HWFIFO_ACCESS(4, 0, true)  // 32-bit data register with 16/8-bit tail e.g musb
+#define TU_HWFIFO_MEM8            TU_HWFIFO_ACCESS(1, 1, false) // byte-only packet memory e.g nuc12x
+#define TU_HWFIFO_MEM16           TU_HWFIFO_ACCESS(2, 2, false) // 16-bit packet memory
+#define TU_HWFIFO_MEM32           TU_HWFIFO_ACCESS(4, 4, false) // 32-bit packet memory
+
+// Copy len bytes from memory to controller (IN direction)
+void          tu_hwfifo_write(volatile void* hwfifo, const void* src, uint16_t len, tu_hwfifo_access_t access);
+
+// Copy len bytes from controller to memory (OUT direction)
+void          tu_hwfifo_read (const volatile void* hwfifo, void* dst, uint16_t len, tu_hwfifo_access_t access);
+
+// Same as above but from/to a byte fifo, wrapped part is handled so that the controller side is always
+// accessed as a continuous stream. Up to len bytes is transferred (limited by fifo count/remaining), return
+// number of bytes transferred. Fifo pointers are advanced without locking i.e intended for ISR context.
+tu_fifo_idx_t tu_hwfifo_write_from_fifo(volatile void* hwfifo, tu_fifo_t* f, uint16_t len, tu_hwfifo_access_t access);
+tu_fifo_idx_t tu_hwfifo_read_to_fifo   (const volatile void* hwfifo, tu_fifo_t* f, uint16_t len, tu_hwfifo_access_t access);
+
 
 #ifdef __cplusplus
 }
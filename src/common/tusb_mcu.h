@@ -47,6 +47,18 @@
   #define TUP_ARCH_STRICT_ALIGN   1
 #endif
 
+//------------- FIFO bulk copy -------------//
+// Linear segment of tu_fifo is copied with word (4x unrolled) load/store when source and destination
+// share the same alignment, instead of libc memcpy(). Useful for ARMv6-M (M0/M0+) where newlib-nano
+// memcpy() is a byte loop. Other architecture have an optimized (LDM/STM burst, vector) memcpy().
+#ifndef TUP_FIFO_WORD_COPY
+  #if defined(__ARM_ARCH_6M__)
+    #define TUP_FIFO_WORD_COPY    1
+  #else
+    #define TUP_FIFO_WORD_COPY    0
+  #endif
+#endif
+
 /* USB Controller Attributes for Device, Host or MCU (both)
  * - ENDPOINT_MAX: max (logical) number of endpoint
  * - ENDPOINT_EXCLUSIVE_NUMBER: endpoint number with different direction IN and OUT aren't allowed,
@@ -322,6 +334,13 @@
   #define TUP_USBIP_DWC2
   #define TUP_DCD_ENDPOINT_MAX    6
 
+  // placed in internal RAM by esp-idf linker script, not affected by flash cache misses
+  #define TU_ATTR_FAST_FUNC       __attribute__((section(".iram1.tinyusb")))
+
+  #if TU_CHECK_MCU(OPT_MCU_ESP32S3)
+    #define TUP_MCU_MULTIPLE_CORE 1
+  #endif
+
 //--------------------------------------------------------------------+
 // Dialog
 //--------------------------------------------------------------------+
@@ -335,6 +354,7 @@
   #define TUP_DCD_ENDPOINT_MAX    16
 
   #define TU_ATTR_FAST_FUNC       __attribute__((section(".time_critical.tinyusb")))
+  #define TUP_MCU_MULTIPLE_CORE   1
 
 //--------------------------------------------------------------------+
 // Silabs
@@ -429,9 +449,64 @@
   #define TUP_RHPORT_HIGHSPEED    0
 #endif
 
+// dcd_edpt_xfer_fifo() of the port driver can transfer directly from/to a ring buffer fifo
+// dwc2 except esp32sx (since it may use dcd_esp32sx)
+#ifndef TUP_DCD_EDPT_XFER_FIFO
+  #if (defined(TUP_USBIP_DWC2) && !TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)) || \
+      defined(TUP_USBIP_FSDEV)          || \
+      CFG_TUSB_MCU == OPT_MCU_RX63X     || \
+      CFG_TUSB_MCU == OPT_MCU_RX65X     || \
+      CFG_TUSB_MCU == OPT_MCU_RX72N     || \
+      CFG_TUSB_MCU == OPT_MCU_LPC18XX   || \
+      CFG_TUSB_MCU == OPT_MCU_LPC43XX   || \
+      CFG_TUSB_MCU == OPT_MCU_MIMXRT1XXX    || \
+      CFG_TUSB_MCU == OPT_MCU_MSP432E4  || \
+      CFG_TUSB_MCU == OPT_MCU_CH32V307  || \
+      CFG_TUSB_MCU == OPT_MCU_CH32F20X
+    #define TUP_DCD_EDPT_XFER_FIFO  1
+  #else
+    #define TUP_DCD_EDPT_XFER_FIFO  0
+  #endif
+#endif
+
+// dcd_edpt_xfer() can be called on a busy endpoint: the transfer is appended to the hardware descriptor list
+// of the one in progress and transfers complete in order. Used by CFG_TUD_EDPT_XFER_QUEUE.
+#ifndef TUP_DCD_EDPT_XFER_APPEND
+  #if TU_CHECK_MCU(OPT_MCU_LPC18XX, OPT_MCU_LPC43XX, OPT_MCU_MIMXRT1XXX)
+    #define TUP_DCD_EDPT_XFER_APPEND  1
+  #else
+    #define TUP_DCD_EDPT_XFER_APPEND  0
+  #endif
+#endif
+
+// Number of device controllers the DCD can drive at the same time, each one with its own rhport state.
+// Used by CFG_TUD_RHPORT_NUM.
+#ifndef TUP_DCD_RHPORT_NUM
+  #if TU_CHECK_MCU(OPT_MCU_LPC18XX, OPT_MCU_LPC43XX, OPT_MCU_MIMXRT1XXX)
+    #define TUP_DCD_RHPORT_NUM  2
+  #else
+    #define TUP_DCD_RHPORT_NUM  1
+  #endif
+#endif
+
+// Application can relocate interrupt handlers, fifo copy and event queue (hot path) e.g to ITCM/DTCM by
+// defining CFG_TUSB_FAST_CODE_SECTION / CFG_TUSB_FAST_DATA_SECTION as attribute similar to CFG_TUSB_MEM_SECTION
+// e.g __attribute__((section(".itcm")))
+#ifdef CFG_TUSB_FAST_CODE_SECTION
+  #undef  TU_ATTR_FAST_FUNC
+  #define TU_ATTR_FAST_FUNC       CFG_TUSB_FAST_CODE_SECTION
+#endif
+
 // fast function, normally mean placing function in SRAM
 #ifndef TU_ATTR_FAST_FUNC
   #define TU_ATTR_FAST_FUNC
 #endif
 
+// fast data, must not be used for buffers accessed by USB controller (see CFG_TUSB_MEM_SECTION)
+#ifdef CFG_TUSB_FAST_DATA_SECTION
+  #define TU_ATTR_FAST_DATA       CFG_TUSB_FAST_DATA_SECTION
+#else
+  #define TU_ATTR_FAST_DATA
+#endif
+
 #endif
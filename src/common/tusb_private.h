@@ -54,9 +54,16 @@ typedef struct {
   uint16_t ep_packetsize;
   uint16_t ep_bufsize;
 
-  // TODO xfer_fifo can skip this buffer
+  // current endpoint buffer, NULL for device stream to transfer directly with fifo (dcd_edpt_xfer_fifo)
   uint8_t* ep_buf;
 
+  // multiple endpoint buffers: next transfer is prepared in/posted with a spare buffer
+  uint8_t* ep_buf_base;
+  uint16_t ep_buf_stride; // distance between endpoint buffers
+  uint8_t  ep_buf_num;
+  uint8_t  ep_buf_idx;
+  uint16_t tx_staged;     // bytes already copied from fifo to the spare buffer, sent by next transfer
+
   tu_fifo_t ff;
 
   // mutex: read if ep rx, write if e tx
@@ -64,6 +71,50 @@ typedef struct {
 
 }tu_edpt_stream_t;
 
+typedef struct {
+  tusb_edpt_stats_t stats;
+  uint32_t last_time; // time of last arm or completion
+  uint8_t  armed;
+  uint8_t  active;    // idle time is only accounted after the first transfer
+} tu_edpt_stats_state_t;
+
+//--------------------------------------------------------------------+
+// Class Driver Dispatch
+//--------------------------------------------------------------------+
+
+// Invoke _member of entry _idx in const driver _table of _count elements. Each case indexes the table with a constant
+// so that compiler can fold the function pointer and emit a direct (or inlined) call. Optional NULL member is
+// skipped. _ret is either empty or an assignment e.g "result =" for member with return value.
+#define TU_DRIVER_DISPATCH_MAX  16
+
+#define _TU_DRIVER_CASE(_n, _table, _count, _ret, _member, ...) \
+  case _n:                                                      \
+    if ((_n) < (_count) && _table[(_n) < (_count) ? (_n) : 0]._member) { \
+      _ret _table[(_n) < (_count) ? (_n) : 0]._member(__VA_ARGS__);      \
+    }                                                           \
+    break;
+
+#define TU_DRIVER_DISPATCH(_table, _count, _idx, _ret, _member, ...) \
+  switch (_idx) {                                                   \
+    _TU_DRIVER_CASE(0 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(1 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(2 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(3 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(4 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(5 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(6 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(7 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(8 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(9 , _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(10, _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(11, _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(12, _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(13, _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(14, _table, _count, _ret, _member, __VA_ARGS__) \
+    _TU_DRIVER_CASE(15, _table, _count, _ret, _member, __VA_ARGS__) \
+    default: break;                                                 \
+  }
+
 //--------------------------------------------------------------------+
 // Endpoint
 //--------------------------------------------------------------------+
@@ -77,6 +128,10 @@ void tu_edpt_bind_driver(uint8_t ep2drv[][2], tusb_desc_interface_t const* p_des
 // Calculate total length of n interfaces (depending on IAD)
 uint16_t tu_desc_get_interface_total_len(tusb_desc_interface_t const* desc_itf, uint8_t itf_count, uint16_t max_len);
 
+// Update endpoint statistics when a transfer is armed/completed
+void tu_edpt_stats_arm(tu_edpt_stats_state_t* s);
+void tu_edpt_stats_complete(tu_edpt_stats_state_t* s, uint8_t result, uint32_t xferred_bytes);
+
 // Claim an endpoint with provided mutex
 bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 
@@ -87,16 +142,29 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 // Endpoint Stream
 //--------------------------------------------------------------------+
 
-// Init an stream, should only be called once
+// Init an stream, should only be called once. Device stream can pass NULL ep_buf to transfer directly from/to
+// fifo if DCD supports dcd_edpt_xfer_fifo(), ep_bufsize is then max bytes of each transfer.
 bool tu_edpt_stream_init(tu_edpt_stream_t* s, bool is_host, bool is_tx, bool overwritable,
                          void* ff_buf, uint16_t ff_bufsize, uint8_t* ep_buf, uint16_t ep_bufsize);
 
+// Use num endpoint buffers placed stride bytes apart starting at ep_buf of init: rx posts next transfer right when
+// one completes, before received data is moved to fifo. tx copies next transfer to spare buffer while one is in
+// flight. Should be called once after init
+TU_ATTR_ALWAYS_INLINE static inline
+void tu_edpt_stream_set_ep_buf_num(tu_edpt_stream_t* s, uint8_t num, uint16_t stride) {
+  s->ep_buf_num = num;
+  s->ep_buf_stride = stride;
+}
+
 // Open an stream for an endpoint
 // hwid is either device address (host mode) or rhport (device mode)
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_edpt_stream_open(tu_edpt_stream_t* s, uint8_t hwid, tusb_desc_endpoint_t const *desc_ep)
 {
   tu_fifo_clear(&s->ff);
+  s->ep_buf_idx = 0;
+  s->ep_buf = s->ep_buf_base;
+  s->tx_staged = 0;
   s->hwid = hwid;
   s->ep_addr = desc_ep->bEndpointAddress;
   s->ep_packetsize = tu_edpt_packet_size(desc_ep);
@@ -113,6 +181,7 @@ void tu_edpt_stream_close(tu_edpt_stream_t* s)
 TU_ATTR_ALWAYS_INLINE static inline
 bool tu_edpt_stream_clear(tu_edpt_stream_t* s)
 {
+  s->tx_staged = 0;
   return tu_fifo_clear(&s->ff);
 }
 
@@ -146,17 +215,24 @@ uint32_t tu_edpt_stream_read(tu_edpt_stream_t* s, void* buffer, uint32_t bufsize
 // Start an usb transfer if endpoint is not busy
 uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s);
 
+// Get buffer of completed transfer, for use in transfer complete callback by driver parsing received data itself.
+// With multiple endpoint buffers: switch to a spare one and post next transfer if fifo has room for both
+// received and next data. NULL if data is already in fifo (xfer fifo).
+uint8_t const* tu_edpt_stream_read_xfer_rotate(tu_edpt_stream_t* s, uint32_t xferred_bytes);
+
 // Must be called in the transfer complete callback
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_edpt_stream_read_xfer_complete(tu_edpt_stream_t* s, uint32_t xferred_bytes) {
-  tu_fifo_write_n(&s->ff, s->ep_buf, (uint16_t) xferred_bytes);
+  uint8_t const* rx_buf = tu_edpt_stream_read_xfer_rotate(s, xferred_bytes);
+  if (rx_buf) tu_fifo_write_n(&s->ff, rx_buf, (uint16_t) xferred_bytes);
 }
 
 // Same as tu_edpt_stream_read_xfer_complete but skip the first n bytes
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_edpt_stream_read_xfer_complete_offset(tu_edpt_stream_t* s, uint32_t xferred_bytes, uint32_t skip_offset) {
-  if (skip_offset < xferred_bytes) {
-    tu_fifo_write_n(&s->ff, s->ep_buf + skip_offset, (uint16_t) (xferred_bytes - skip_offset));
+  uint8_t const* rx_buf = tu_edpt_stream_read_xfer_rotate(s, xferred_bytes - tu_min32(skip_offset, xferred_bytes));
+  if (rx_buf && skip_offset < xferred_bytes) {
+    tu_fifo_write_n(&s->ff, rx_buf + skip_offset, (uint16_t) (xferred_bytes - skip_offset));
   }
 }
 
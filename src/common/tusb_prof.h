@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_PROF_H_
+#define _TUSB_PROF_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// ISR Profiling
+// CFG_TUSB_PROF measures duration of dcd_int_handler() and of each interrupt source it services, with
+// CFG_TUSB_PROF_TIMESTAMP() e.g a cycle counter. Whole ISR (TU_PROF_ISR) is recorded for every port by
+// tud_int_handler(), the breakdown by source is recorded by ports that are instrumented with
+// TU_PROF_BEGIN()/TU_PROF_END(). Sources can nest e.g FIFO copy within transfer complete processing, so they
+// do not add up to the ISR total.
+//--------------------------------------------------------------------+
+
+typedef enum {
+  TU_PROF_ISR = 0, // whole interrupt handler
+  TU_PROF_BUS,     // bus reset, suspend, resume, connection change
+  TU_PROF_SETUP,   // setup packet received
+  TU_PROF_XFER,    // endpoint transfer complete/continue processing
+  TU_PROF_FIFO,    // copy between packet memory/FIFO and buffer
+  TU_PROF_SOF,     // start of frame
+  TU_PROF_SOURCE_COUNT
+} tu_prof_source_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t max;   // longest duration
+  uint64_t total; // sum of all durations, average = total/count
+} tu_prof_stat_t;
+
+#if CFG_TUSB_PROF
+
+// Record a duration of an interrupt source, called from ISR
+void tu_prof_record(uint8_t rhport, uint8_t source, uint32_t duration);
+
+// Get statistics of an interrupt source. Return false if rhport or source is out of range
+bool tu_prof_get(uint8_t rhport, tu_prof_source_t source, tu_prof_stat_t* stat);
+
+// Clear statistics of all sources of a port
+void tu_prof_clear(uint8_t rhport);
+
+#define TU_PROF_BEGIN(_src)           uint32_t const _tu_prof_start_##_src = (uint32_t) CFG_TUSB_PROF_TIMESTAMP()
+#define TU_PROF_END(_rhport, _src)    \
+  tu_prof_record(_rhport, _src, (uint32_t) CFG_TUSB_PROF_TIMESTAMP() - _tu_prof_start_##_src)
+
+#else
+
+#define TU_PROF_BEGIN(_src)
+#define TU_PROF_END(_rhport, _src)
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_PROF_H_ */
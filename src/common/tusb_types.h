@@ -229,6 +229,41 @@ typedef enum {
   XFER_RESULT_INVALID
 } xfer_result_t;
 
+// Per-endpoint runtime statistics (CFG_TUD_EDPT_STATS / CFG_TUH_EDPT_STATS). Time is in unit of
+// CFG_TUSB_EDPT_STATS_TIMESTAMP()
+typedef struct {
+  uint32_t xfer_count;  // completed transfers
+  uint32_t bytes;       // transferred bytes
+  uint16_t error_count; // transfers completed with failed or timeout result
+  uint16_t stall_count; // transfers completed with stalled result or endpoint stalled by stack
+  uint32_t armed_time;  // total time armed waiting for the other side: host stopped polling if large
+  uint32_t idle_time;   // total time not armed between completion and next transfer: application starved if large
+
+  // Arm-to-complete latency: bin 0 for 0, bin n for [2^(n-1), 2^n), last bin also counts longer ones
+  uint32_t latency_hist[CFG_TUSB_EDPT_STATS_HIST_BINS];
+} tusb_edpt_stats_t;
+
+// Number of event ids counted in tusb_event_queue_stats_t, must cover both dcd and hcd event ids
+#define TUSB_EVENT_QUEUE_STATS_ID_NUM   12
+
+// Event queue statistics of usbd/usbh task (CFG_TUD_TASK_QUEUE_STATS / CFG_TUH_TASK_QUEUE_STATS).
+// High-water marks are only available with OPT_OS_NONE and OPT_OS_PICO, 0 otherwise
+typedef struct {
+  uint16_t queue_size;    // CFG_TUx_TASK_QUEUE_SZ
+  uint16_t count_max;     // high-water mark of queue
+  uint16_t hi_queue_size; // CFG_TUx_TASK_QUEUE_HI_SZ, 0 if not enabled
+  uint16_t hi_count_max;  // high-water mark of high priority queue
+  uint32_t posted;        // events queued
+  uint32_t overflow;      // events dropped because queue is full, not including rescued ones
+  uint32_t xfer_rescued;  // transfer completions kept per endpoint instead of dropped (CFG_TUx_TASK_XFER_RESCUE)
+  uint16_t overflow_by_event[TUSB_EVENT_QUEUE_STATS_ID_NUM]; // dropped events by event id
+
+  // Queue to dispatch latency in CFG_TUSB_EVENT_TIMESTAMP() unit (CFG_TUx_EVENT_TIMESTAMP), 0 if not enabled
+  uint32_t dispatched;    // events dispatched
+  uint32_t latency_max;
+  uint32_t latency_total; // average is latency_total / dispatched
+} tusb_event_queue_stats_t;
+
 // TODO remove
 enum {
   DESC_OFFSET_LEN  = 0,
@@ -496,6 +531,16 @@ TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_packet_size(tusb_desc_endpo
   return tu_le16toh(desc_ep->wMaxPacketSize) & TU_GENMASK(10, 0);
 }
 
+// Transactions per (micro)frame: 2 or 3 for highspeed high-bandwidth periodic endpoint, otherwise 1
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_edpt_hb_mult(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint8_t) (1u + ((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x3u));
+}
+
+// Bytes per (micro)frame i.e packet size times transactions per (micro)frame
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_hb_size(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint16_t) (tu_edpt_packet_size(desc_ep) * tu_edpt_hb_mult(desc_ep));
+}
+
 #if CFG_TUSB_DEBUG
 TU_ATTR_ALWAYS_INLINE static inline const char *tu_edpt_dir_str(tusb_dir_t dir) {
   tu_static const char *str[] = {"out", "in"};
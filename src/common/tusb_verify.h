@@ -76,7 +76,10 @@
 #endif
 
 // Halt CPU (breakpoint) when hitting error, only apply for Cortex M3, M4, M7, M33. M55
-#if defined(__ARM_ARCH_7M__) || defined (__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
+#if CFG_TUSB_RELEASE
+  #define TU_BREAKPOINT() do {} while (0)
+
+#elif defined(__ARM_ARCH_7M__) || defined (__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
   #define TU_BREAKPOINT() do                                                                                \
   {                                                                                                         \
     volatile uint32_t* ARM_CM_DHCSR =  ((volatile uint32_t*) 0xE000EDF0UL); /* Cortex M CoreDebug->DHCSR */ \
@@ -113,14 +116,22 @@
 
 /*------------------------------------------------------------------*/
 /* ASSERT
- * basically TU_VERIFY with TU_BREAKPOINT() as handler
+ * basically TU_VERIFY with TU_BREAKPOINT() as handler, failure is a firmware bug hence hinted as unlikely.
+ * With CFG_TUSB_RELEASE it only returns.
  * - 1 arg : return false if failed
  * - 2 arg : return error if failed
  *------------------------------------------------------------------*/
-#define TU_ASSERT_DEFINE(_cond, _ret)                                 \
-  do {                                                                \
-    if ( !(_cond) ) { _MESS_FAILED(); TU_BREAKPOINT(); return _ret; } \
+#if CFG_TUSB_RELEASE
+#define TU_ASSERT_DEFINE(_cond, _ret)                \
+  do {                                               \
+    if ( TU_UNLIKELY(!(_cond)) ) { return _ret; }    \
   } while(0)
+#else
+#define TU_ASSERT_DEFINE(_cond, _ret)                                              \
+  do {                                                                             \
+    if ( TU_UNLIKELY(!(_cond)) ) { _MESS_FAILED(); TU_BREAKPOINT(); return _ret; } \
+  } while(0)
+#endif
 
 #define TU_ASSERT_1ARGS(_cond)         TU_ASSERT_DEFINE(_cond, false)
 #define TU_ASSERT_2ARGS(_cond, _ret)   TU_ASSERT_DEFINE(_cond, _ret)
@@ -52,12 +52,14 @@ typedef enum {
   DCD_EVENT_BUS_RESET,
   DCD_EVENT_UNPLUGGED,
   DCD_EVENT_SOF,
-  DCD_EVENT_SUSPEND, // TODO LPM Sleep L1 support
-  DCD_EVENT_RESUME,
+  DCD_EVENT_SUSPEND,
+  DCD_EVENT_RESUME, // from both suspend (L2) and LPM sleep (L1)
 
   DCD_EVENT_SETUP_RECEIVED,
   DCD_EVENT_XFER_COMPLETE,
 
+  DCD_EVENT_LPM_SLEEP, // LPM L1 sleep
+
   // Not an DCD event, just a convenient way to defer ISR function
   USBD_EVENT_FUNC_CALL,
 
@@ -89,12 +91,22 @@ typedef struct TU_ATTR_ALIGNED(4) {
       uint32_t len;
     }xfer_complete;
 
+    // LPM_SLEEP
+    struct {
+      uint8_t besl;          // Best Effort Service Latency requested by host
+      uint8_t remote_wakeup; // host allows remote wakeup from L1
+    }lpm_sleep;
+
     // FUNC_CALL
     struct {
       void (*func) (void*);
       void* param;
     }func_call;
   };
+
+#if CFG_TUD_EVENT_TIMESTAMP
+  uint32_t timestamp; // CFG_TUSB_EVENT_TIMESTAMP() when event is queued
+#endif
 } dcd_event_t;
 
 //TU_VERIFY_STATIC(sizeof(dcd_event_t) <= 12, "size is not correct");
@@ -122,8 +134,14 @@ void dcd_dcache_clean_invalidate(void const* addr, uint32_t data_size) TU_ATTR_W
 // Initialize controller to device mode
 void dcd_init(uint8_t rhport);
 
-// Interrupt Handler
+// Switch dual-role controller running as host to device mode (CFG_TUSB_OTG). Clock and PHY set up by hcd_init()
+// are kept, controller is left as after dcd_init(). Optional, dcd_init() is used if not implemented
+void dcd_role_enter(uint8_t rhport) TU_ATTR_WEAK;
+
+// Interrupt Handler, also declared by usbd.h if included first
+#ifndef _TUSB_USBD_H_
 void dcd_int_handler(uint8_t rhport);
+#endif
 
 // Enable device interrupt
 void dcd_int_enable (uint8_t rhport);
@@ -154,6 +172,10 @@ void dcd_sof_enable(uint8_t rhport, bool en);
 // May help DCD to prepare for next control transfer, this API is optional.
 void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request_t const * request);
 
+// Invoked by SET_CONFIGURATION before endpoints of the configuration are opened. DCD can plan its endpoint
+// buffer/FIFO allocation with all endpoints (including alternate settings) in mind. This API is optional.
+void dcd_edpt_config_plan     (uint8_t rhport, tusb_desc_configuration_t const * desc_cfg) TU_ATTR_WEAK;
+
 // Configure endpoint's registers according to descriptor
 bool dcd_edpt_open            (uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 
@@ -182,6 +204,7 @@ void dcd_edpt_clear_stall     (uint8_t rhport, uint8_t ep_addr);
 
 // Allocate packet buffer used by ISO endpoints
 // Some MCU need manual packet buffer allocation, we allocate the largest size to avoid clustering
+// largest_packet_size includes additional transactions of high-bandwidth endpoint i.e up to 3x1024
 TU_ATTR_WEAK bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size);
 
 // Configure and enable an ISO endpoint according to descriptor
@@ -226,6 +249,14 @@ TU_ATTR_ALWAYS_INLINE static inline void dcd_event_xfer_complete (uint8_t rhport
   dcd_event_handler(&event, in_isr);
 }
 
+// helper to send LPM L1 sleep event
+TU_ATTR_ALWAYS_INLINE static inline void dcd_event_lpm_sleep(uint8_t rhport, uint8_t besl, bool remote_wakeup, bool in_isr) {
+  dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_LPM_SLEEP };
+  event.lpm_sleep.besl          = besl;
+  event.lpm_sleep.remote_wakeup = remote_wakeup ? 1 : 0;
+  dcd_event_handler(&event, in_isr);
+}
+
 TU_ATTR_ALWAYS_INLINE static inline void dcd_event_sof(uint8_t rhport, uint32_t frame_count, bool in_isr) {
   dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_SOF };
   event.sof.frame_count = frame_count;
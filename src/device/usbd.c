@@ -42,6 +42,31 @@
   #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+// Size of high priority event queue (0 to disable). Bus reset, setup, suspend/resume and control endpoint
+// events are put in this queue and always processed before pending (bulk) transfer completions.
+// It should hold a whole control transfer e.g setup + data stages + status i.e 8 or more.
+#ifndef CFG_TUD_TASK_QUEUE_HI_SZ
+  #define CFG_TUD_TASK_QUEUE_HI_SZ   0
+#endif
+
+// Work budget of one tud_task_ext() call to bound its latency in a bare-metal superloop: return after
+// processing this many events (0 is unlimited), or after this many microseconds measured with
+// tud_task_time_us_cb() (0 is unlimited). Budget is checked between events, remaining ones are left in
+// queue and reported by tud_task_event_ready().
+#ifndef CFG_TUD_TASK_EVENT_MAX
+  #define CFG_TUD_TASK_EVENT_MAX   0
+#endif
+
+#ifndef CFG_TUD_TASK_TIME_BUDGET_US
+  #define CFG_TUD_TASK_TIME_BUDGET_US   0
+#endif
+
+// Transfer completion that does not fit in the full event queue is kept per endpoint and processed once queue is
+// drained, instead of being dropped which leaves the endpoint busy forever.
+#ifndef CFG_TUD_TASK_XFER_RESCUE
+  #define CFG_TUD_TASK_XFER_RESCUE   0
+#endif
+
 //--------------------------------------------------------------------+
 // Callback weak stubs (called if application does not provide)
 //--------------------------------------------------------------------+
@@ -51,13 +76,69 @@ TU_ATTR_WEAK void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_is
   (void)in_isr;
 }
 
+// Cache maintenance for DMA capable controllers, implemented by port (or application) with data cache
+TU_ATTR_WEAK void dcd_dcache_clean(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+}
+
+TU_ATTR_WEAK void dcd_dcache_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+}
+
+TU_ATTR_WEAK void dcd_dcache_clean_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+}
+
 //--------------------------------------------------------------------+
 // Device Data
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_EDPT_XFER_QUEUE
+// Transfers queued on a busy endpoint, submitted to DCD in order on completion of the active one
+typedef struct {
+  struct {
+    uint8_t* buffer;
+    uint16_t total_bytes;
+  } desc[CFG_TUD_EDPT_XFER_QUEUE];
+
+  volatile uint8_t rd_idx; // next queued transfer, advanced in ISR
+  volatile uint8_t count;  // number of queued transfers not yet submitted to DCD
+  volatile uint8_t active; // DCD has a transfer in progress
+  uint8_t pending;         // number of transfers whose completion is not yet processed by usbd task
+} usbd_xfer_queue_t;
+#endif
+
+#if CFG_TUD_EDPT_XFER_COALESCE
+// Completion events merged into the one still waiting in usbd queue
+typedef struct {
+  volatile uint8_t enabled : 1;
+  volatile uint8_t queued  : 1; // a completion event of this endpoint is in usbd queue
+  volatile uint8_t extra_count; // number of completions merged into the queued event
+  volatile uint8_t extra_result;
+  volatile uint32_t extra_len;
+} usbd_xfer_coalesce_t;
+#endif
+
 // Invalid driver ID in itf2drv[] ep2drv[][] mapping
 enum { DRVID_INVALID = 0xFFu };
 
+#if CFG_TUD_CONFIG_CACHE
+// Interface-to-driver index of a configuration descriptor, built on first SET_CONFIGURATION
+typedef struct {
+  uintptr_t desc_cfg;
+  uint16_t total_len;
+  uint8_t func_count;
+  struct {
+    uint16_t offset;  // offset of (first) interface descriptor of the function
+    uint8_t drv_id;
+    uint8_t itf_count;
+  } func[CFG_TUD_INTERFACE_MAX];
+} usbd_config_index_t;
+
+tu_static usbd_config_index_t _usbd_cfg_cache[CFG_TUD_CONFIG_CACHE];
+tu_static uint8_t _usbd_cfg_cache_next;
+#endif
+
 typedef struct {
   struct TU_ATTR_PACKED {
     volatile uint8_t connected    : 1;
@@ -67,6 +148,8 @@ typedef struct {
     uint8_t remote_wakeup_en      : 1; // enable/disable by host
     uint8_t remote_wakeup_support : 1; // configuration descriptor's attribute
     uint8_t self_powered          : 1; // configuration descriptor's attribute
+    volatile uint8_t lpm_sleep    : 1; // suspended is LPM L1 sleep
+    uint8_t lpm_remote_wakeup     : 1; // remote wakeup allowed by host in LPM token
   };
   volatile uint8_t cfg_num; // current active configuration (0x00 is not configured)
   uint8_t speed;
@@ -77,9 +160,54 @@ typedef struct {
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+#if CFG_TUD_EDPT_XFER_QUEUE
+  usbd_xfer_queue_t ep_queue[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_XFER_COALESCE
+  usbd_xfer_coalesce_t ep_coalesce[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
 }usbd_device_t;
 
-tu_static usbd_device_t _usbd_dev;
+TU_ATTR_FAST_DATA tu_static usbd_device_t _usbd_dev[CFG_TUD_RHPORT_NUM];
+
+#if CFG_TUD_ARENA_SIZE
+// RAM shared by class drivers of active configuration
+typedef struct {
+  TUD_EPBUF_DEF(buf, CFG_TUD_ARENA_SIZE);
+} usbd_arena_t;
+
+CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(CFG_TUD_ARENA_ALIGN) tu_static usbd_arena_t _usbd_arena[CFG_TUD_RHPORT_NUM];
+tu_static uint32_t _usbd_arena_used[CFG_TUD_RHPORT_NUM];
+
+TU_VERIFY_STATIC(CFG_TUD_RHPORT_NUM == 1 || (sizeof(usbd_arena_t) % CFG_TUD_ARENA_ALIGN) == 0,
+                 "CFG_TUD_ARENA_SIZE must be multiple of CFG_TUD_ARENA_ALIGN with multiple ports");
+#endif
+
+#if CFG_TUD_ISO_STREAM
+tu_static usbd_iso_stream_t* _usbd_iso_stream[CFG_TUD_RHPORT_NUM][CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+// fifo transfer with dcd_edpt_xfer() in segments
+typedef struct {
+  tu_fifo_t* ff;
+  uint16_t total;   // bytes of whole transfer
+  uint16_t xferred; // bytes of completed segments
+  uint16_t seg_len; // bytes of current segment
+  uint8_t  ep_addr; // 0 if slot is free
+  uint8_t  rhport;
+  bool     bounce;  // current segment uses bounce buffer
+  TUD_EPBUF_DEF(bounce_buf, CFG_TUD_EDPT_XFER_FIFO_BOUNCE_SIZE);
+} usbd_xfer_fifo_t;
+
+CFG_TUD_MEM_SECTION tu_static usbd_xfer_fifo_t _usbd_xfer_fifo[CFG_TUD_EDPT_XFER_FIFO_FALLBACK];
+
+// packet size of endpoints, bit 15 set for ISO which can not be split into segments
+enum { XFER_FIFO_MPS_ISO = 0x8000u };
+tu_static uint16_t _usbd_xfer_fifo_mps[CFG_TUD_RHPORT_NUM][CFG_TUD_ENDPPOINT_MAX][2];
+#endif
 
 //--------------------------------------------------------------------+
 // Class Driver
@@ -92,6 +220,19 @@ tu_static usbd_device_t _usbd_dev;
 
 // Built-in class drivers
 tu_static usbd_class_driver_t const _usbd_driver[] = {
+    // bridge claims only interfaces bound by application, before other drivers
+    #if CFG_TUSB_BRIDGE
+    {
+        DRIVER_NAME("BRIDGE")
+        .init             = bridged_init,
+        .reset            = bridged_reset,
+        .open             = bridged_open,
+        .control_xfer_cb  = NULL,
+        .xfer_cb          = bridged_xfer_cb,
+        .sof              = NULL
+    },
+    #endif
+
     #if CFG_TUD_CDC
     {
         DRIVER_NAME("CDC")
@@ -100,7 +241,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = cdcd_open,
         .control_xfer_cb  = cdcd_control_xfer_cb,
         .xfer_cb          = cdcd_xfer_cb,
-        .sof              = NULL
+        .sof              = cdcd_sof
     },
     #endif
 
@@ -116,6 +257,18 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
     },
     #endif
 
+    #if CFG_TUD_MSC_UAS
+    {
+        DRIVER_NAME("UAS")
+        .init             = uasd_init,
+        .reset            = uasd_reset,
+        .open             = uasd_open,
+        .control_xfer_cb  = uasd_control_xfer_cb,
+        .xfer_cb          = uasd_xfer_cb,
+        .sof              = NULL
+    },
+    #endif
+
     #if CFG_TUD_HID
     {
       DRIVER_NAME("HID")
@@ -124,7 +277,10 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
       .open             = hidd_open,
       .control_xfer_cb  = hidd_control_xfer_cb,
       .xfer_cb          = hidd_xfer_cb,
-      .sof              = NULL
+      .sof              = NULL,
+      #if CFG_TUD_HID_HIGH_RATE
+      .xfer_isr         = hidd_xfer_isr
+      #endif
     },
     #endif
 
@@ -148,7 +304,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
       .open             = videod_open,
       .control_xfer_cb  = videod_control_xfer_cb,
       .xfer_cb          = videod_xfer_cb,
-      .sof              = NULL
+      .sof              = videod_sof
     },
     #endif
 
@@ -220,7 +376,11 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
       .open             = netd_open,
       .control_xfer_cb  = netd_control_xfer_cb,
       .xfer_cb          = netd_xfer_cb,
-      .sof                  = NULL,
+      #if CFG_TUD_NCM && CFG_TUD_NCM_TX_AGGREGATION_US
+      .sof              = netd_sof,
+      #else
+      .sof              = NULL,
+      #endif
     },
     #endif
 
@@ -258,18 +418,181 @@ TU_ATTR_ALWAYS_INLINE static inline usbd_class_driver_t const * get_driver(uint8
   return driver;
 }
 
+// Invoke _member of driver (previously obtained by get_driver(_drvid)) with _ret assignment (can be empty)
+#if CFG_TUD_DRIVER_STATIC_DISPATCH
+TU_VERIFY_STATIC(BUILTIN_DRIVER_COUNT <= TU_DRIVER_DISPATCH_MAX, "too many built-in drivers for static dispatch");
+
+#define DRIVER_CALL(_drvid, _driver, _ret, _member, ...)                                        \
+  do {                                                                                          \
+    if ((_drvid) >= _app_driver_count) {                                                        \
+      TU_DRIVER_DISPATCH(_usbd_driver, BUILTIN_DRIVER_COUNT, (_drvid) - _app_driver_count, _ret, \
+                         _member, __VA_ARGS__)                                                  \
+    } else {                                                                                    \
+      _ret (_driver)->_member(__VA_ARGS__);                                                     \
+    }                                                                                           \
+  } while (0)
+#else
+#define DRIVER_CALL(_drvid, _driver, _ret, _member, ...) \
+  do { (void) (_drvid); _ret (_driver)->_member(__VA_ARGS__); } while (0)
+#endif
+
 //--------------------------------------------------------------------+
 // DCD Event
 //--------------------------------------------------------------------+
 
 enum { RHPORT_INVALID = 0xFFu };
-tu_static uint8_t _usbd_rhport = RHPORT_INVALID;
+tu_static uint8_t _usbd_rhport = RHPORT_INVALID; // first initialized port, used by API without rhport
+tu_static uint8_t _usbd_cur_rhport; // port of event being processed by usbd task
+
+#if CFG_TUD_RHPORT_NUM > 1
+TU_VERIFY_STATIC(CFG_TUD_RHPORT_NUM <= TUP_DCD_RHPORT_NUM, "port driver does not support this many controllers");
+TU_VERIFY_STATIC(CFG_TUD_TASK_QUEUE_HI_SZ == 0, "high priority queue is not supported with multiple ports");
+
+tu_static bool _usbd_port_inited[CFG_TUD_RHPORT_NUM];
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t resolve_rhport(uint8_t rhport) {
+  return rhport;
+}
+#else
+// Class drivers may pass 0 (e.g from API without rhport), single state always belongs to the initialized port
+TU_ATTR_ALWAYS_INLINE static inline uint8_t resolve_rhport(uint8_t rhport) {
+  (void) rhport;
+  return _usbd_rhport;
+}
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline usbd_device_t* get_device(uint8_t rhport) {
+  return &_usbd_dev[usbd_port_id(rhport)];
+}
+
+// SOF interrupt is enabled by class drivers for periodic work
+tu_static volatile bool _usbd_sof_enabled[CFG_TUD_RHPORT_NUM];
+
+#if CFG_TUD_SOF_SCHED
+tu_static usbd_sof_sched_t* volatile _usbd_sof_sched[CFG_TUD_RHPORT_NUM];
+tu_static bool _usbd_sof_legacy[CFG_TUD_RHPORT_NUM]; // requested by usbd_sof_enable()
+#endif
+
+#if CFG_TUD_EDPT_STATS
+// kept across bus reset, only cleared by tud_edpt_stats_clear()
+tu_static tu_edpt_stats_state_t _usbd_edpt_stats[CFG_TUD_RHPORT_NUM][CFG_TUD_ENDPPOINT_MAX][2];
+  #define EDPT_STATS_ARM(_rhport, _epnum, _dir) \
+    tu_edpt_stats_arm(&_usbd_edpt_stats[usbd_port_id(_rhport)][_epnum][_dir])
+
+static bool edpt_stats_get(uint8_t rhport, uint8_t ep_addr, tusb_edpt_stats_t* stats);
+#else
+  #define EDPT_STATS_ARM(_rhport, _epnum, _dir)
+#endif
 
-// Event queue
+#if CFG_TUSB_CAPTURE && CFG_TUSB_CAPTURE_PAYLOAD
+// buffer of OUT transfer in progress, captured on completion. Not known for fifo and queued transfers
+tu_static uint8_t* _usbd_capture_buf[CFG_TUD_RHPORT_NUM][CFG_TUD_ENDPPOINT_MAX];
+#endif
+
+// Event queue, TU_ATTR_FAST_DATA applies to its buffer
 // usbd_int_set() is used as mutex in OS NONE config
-OSAL_QUEUE_DEF(usbd_int_set, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
+TU_ATTR_FAST_DATA OSAL_QUEUE_DEF(usbd_int_set, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
 tu_static osal_queue_t _usbd_q;
 
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+TU_ATTR_FAST_DATA OSAL_QUEUE_DEF(usbd_int_set, _usbd_qdef_hi, CFG_TUD_TASK_QUEUE_HI_SZ, dcd_event_t);
+tu_static osal_queue_t _usbd_q_hi;
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_high_priority_event(dcd_event_t const * event) {
+  switch (event->event_id) {
+    case DCD_EVENT_XFER_COMPLETE:
+      return tu_edpt_number(event->xfer_complete.ep_addr) == 0;
+
+    case DCD_EVENT_BUS_RESET:
+    case DCD_EVENT_UNPLUGGED:
+    case DCD_EVENT_SETUP_RECEIVED:
+    case DCD_EVENT_SUSPEND:
+    case DCD_EVENT_RESUME:
+    case DCD_EVENT_LPM_SLEEP:
+      return true;
+
+    default:
+      return false;
+  }
+}
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS
+tu_static tusb_event_queue_stats_t _usbd_q_stats;
+TU_VERIFY_STATIC(DCD_EVENT_COUNT <= TUSB_EVENT_QUEUE_STATS_ID_NUM, "TUSB_EVENT_QUEUE_STATS_ID_NUM is too small");
+
+TU_ATTR_ALWAYS_INLINE static inline void queue_stats_posted(osal_queue_t q, uint16_t* count_max) {
+  _usbd_q_stats.posted++;
+  #if CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO
+  uint16_t const count = (uint16_t) tu_fifo_count(&q->ff);
+  if (count > *count_max) *count_max = count;
+  #else
+  (void) q;
+  (void) count_max;
+  #endif
+}
+#endif
+
+#if CFG_TUD_EVENT_TIMESTAMP
+tu_static uint32_t _usbd_event_timestamp; // of event being dispatched by tud_task()
+#endif
+
+#if CFG_TUD_TASK_XFER_RESCUE
+typedef struct {
+  uint32_t len;
+#if CFG_TUD_EVENT_TIMESTAMP
+  uint32_t timestamp;
+#endif
+  uint8_t result;            // first non-success result
+  volatile uint8_t count;    // number of completions kept, len is their sum
+} usbd_xfer_rescue_t;
+
+tu_static usbd_xfer_rescue_t _usbd_xfer_rescue[CFG_TUD_RHPORT_NUM][CFG_TUD_ENDPPOINT_MAX][2];
+tu_static volatile bool _usbd_xfer_rescue_any;
+tu_static uint8_t _usbd_xfer_rescue_extra; // completions merged into the rescued event being dispatched
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS || CFG_TUD_TASK_XFER_RESCUE
+// Event queue is full: keep transfer completion per endpoint if possible, return true if it is rescued.
+// With CFG_TUD_EDPT_XFER_QUEUE the next queued transfer is started from ISR, so endpoint can complete again
+// before its completion is processed: completions are merged into the slot like transfer complete coalescing.
+TU_ATTR_FAST_FUNC static bool queue_event_overflow(dcd_event_t const * event) {
+#if CFG_TUD_TASK_XFER_RESCUE
+  if (event->event_id == DCD_EVENT_XFER_COMPLETE) {
+    uint8_t const ep_addr = event->xfer_complete.ep_addr;
+    uint8_t const epnum = tu_edpt_number(ep_addr);
+    if (epnum < CFG_TUD_ENDPPOINT_MAX) {
+      usbd_xfer_rescue_t* r = &_usbd_xfer_rescue[usbd_port_id(event->rhport)][epnum][tu_edpt_dir(ep_addr)];
+      if (r->count < UINT8_MAX) {
+        if (r->count == 0) {
+          r->len = event->xfer_complete.len;
+          r->result = event->xfer_complete.result;
+          #if CFG_TUD_EVENT_TIMESTAMP
+          r->timestamp = event->timestamp;
+          #endif
+        } else {
+          r->len += event->xfer_complete.len;
+          if (r->result == XFER_RESULT_SUCCESS) r->result = event->xfer_complete.result;
+        }
+        r->count++;
+        _usbd_xfer_rescue_any = true;
+        #if CFG_TUD_TASK_QUEUE_STATS
+        _usbd_q_stats.xfer_rescued++;
+        #endif
+        return true;
+      }
+    }
+  }
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS
+  _usbd_q_stats.overflow++;
+  if (event->event_id < TUSB_EVENT_QUEUE_STATS_ID_NUM) _usbd_q_stats.overflow_by_event[event->event_id]++;
+#endif
+  return false;
+}
+#endif
+
 // Mutex for claiming endpoint
 #if OSAL_MUTEX_REQUIRED
   tu_static osal_mutex_def_t _ubsd_mutexdef;
@@ -279,7 +602,46 @@ tu_static osal_queue_t _usbd_q;
 #endif
 
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(dcd_event_t const * event, bool in_isr) {
+#if CFG_TUD_EVENT_TIMESTAMP
+  dcd_event_t stamped = *event;
+  stamped.timestamp = CFG_TUSB_EVENT_TIMESTAMP();
+  event = &stamped;
+#endif
+
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+  bool ret;
+  if (is_high_priority_event(event)) {
+    ret = osal_queue_send(_usbd_q_hi, event, in_isr);
+  #if CFG_TUD_TASK_QUEUE_STATS
+    if (ret) queue_stats_posted(_usbd_q_hi, &_usbd_q_stats.hi_count_max);
+  #endif
+
+  #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
+    // usbd task blocks on normal queue, wake it up with an empty function call. If the normal queue is full,
+    // task is not blocked anyway.
+    dcd_event_t const event_wakeup = { .rhport = event->rhport, .event_id = USBD_EVENT_FUNC_CALL };
+    (void) osal_queue_send(_usbd_q, &event_wakeup, in_isr);
+  #endif
+  } else {
+    ret = osal_queue_send(_usbd_q, event, in_isr);
+  #if CFG_TUD_TASK_QUEUE_STATS
+    if (ret) queue_stats_posted(_usbd_q, &_usbd_q_stats.count_max);
+  #endif
+  }
+#else
   bool ret = osal_queue_send(_usbd_q, event, in_isr);
+  #if CFG_TUD_TASK_QUEUE_STATS
+  if (ret) queue_stats_posted(_usbd_q, &_usbd_q_stats.count_max);
+  #endif
+#endif
+#if CFG_TUD_TASK_QUEUE_STATS || CFG_TUD_TASK_XFER_RESCUE
+  if (!ret) ret = queue_event_overflow(event);
+#endif
+#if CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO
+  TU_TRACE(TU_TRACE_EVENT_POST, event->event_id, tu_fifo_count(&_usbd_q->ff));
+#else
+  TU_TRACE(TU_TRACE_EVENT_POST, event->event_id, 0);
+#endif
   tud_event_hook_cb(event->rhport, event->event_id, in_isr);
   return ret;
 }
@@ -291,11 +653,21 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num);
 static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const * p_request);
 
-// from usbd_control.c
-void usbd_control_reset(void);
-void usbd_control_set_request(tusb_control_request_t const *request);
-void usbd_control_set_complete_callback( usbd_control_xfer_cb_t fp );
-bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+#if CFG_TUD_EDPT_XFER_QUEUE
+static bool edpt_xfer_enqueue(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes);
+static void edpt_xfer_queue_next(uint8_t rhport, uint8_t ep_addr, bool in_isr);
+static bool edpt_xfer_queue_done(uint8_t rhport, uint8_t epnum, uint8_t dir, uint8_t count);
+static void edpt_xfer_queue_reset(uint8_t rhport, uint8_t epnum, uint8_t dir);
+#else
+  #define edpt_xfer_queue_reset(_rhport, _epnum, _dir)
+#endif
+
+#if CFG_TUD_EDPT_XFER_COALESCE
+static void queue_xfer_complete(dcd_event_t const* event, bool in_isr);
+static uint8_t edpt_xfer_coalesce_take(dcd_event_t* event);
+#else
+  #define queue_xfer_complete(_event, _in_isr)  queue_event(_event, _in_isr)
+#endif
 
 
 //--------------------------------------------------------------------+
@@ -311,6 +683,7 @@ tu_static char const* const _usbd_event_str[DCD_EVENT_COUNT] = {
     "Resume",
     "Setup Received",
     "Xfer Complete",
+    "LPM Sleep",
     "Func Call"
 };
 
@@ -330,39 +703,80 @@ void usbd_driver_print_control_complete_name(usbd_control_xfer_cb_t callback) {
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
+uint8_t tud_current_rhport(void) {
+  return _usbd_cur_rhport;
+}
+
+tusb_speed_t tud_n_speed_get(uint8_t rhport) {
+  TU_VERIFY(tud_n_inited(rhport), TUSB_SPEED_INVALID);
+  return (tusb_speed_t) get_device(rhport)->speed;
+}
+
+bool tud_n_connected(uint8_t rhport) {
+  return tud_n_inited(rhport) && get_device(rhport)->connected;
+}
+
+bool tud_n_mounted(uint8_t rhport) {
+  return tud_n_inited(rhport) && get_device(rhport)->cfg_num;
+}
+
+bool tud_n_suspended(uint8_t rhport) {
+  return tud_n_inited(rhport) && get_device(rhport)->suspended;
+}
+
+bool tud_n_remote_wakeup(uint8_t rhport) {
+  usbd_device_t const* dev = get_device(rhport);
+
+  // only wake up host if this feature is supported and enabled and we are suspended
+  TU_VERIFY(tud_n_suspended(rhport));
+  if (dev->lpm_sleep) {
+    // L1: permission is given by bRemoteWake of the LPM token
+    TU_VERIFY(dev->lpm_remote_wakeup);
+  } else {
+    TU_VERIFY(dev->remote_wakeup_support && dev->remote_wakeup_en);
+  }
+  dcd_remote_wakeup(rhport);
+  return true;
+}
+
+bool tud_n_disconnect(uint8_t rhport) {
+  TU_VERIFY(dcd_disconnect);
+  dcd_disconnect(rhport);
+  return true;
+}
+
+bool tud_n_connect(uint8_t rhport) {
+  TU_VERIFY(dcd_connect);
+  dcd_connect(rhport);
+  return true;
+}
+
 tusb_speed_t tud_speed_get(void) {
-  return (tusb_speed_t) _usbd_dev.speed;
+  return tud_n_speed_get(_usbd_rhport);
 }
 
 bool tud_connected(void) {
-  return _usbd_dev.connected;
+  return tud_n_connected(_usbd_rhport);
 }
 
 bool tud_mounted(void) {
-  return _usbd_dev.cfg_num ? true : false;
+  return tud_n_mounted(_usbd_rhport);
 }
 
 bool tud_suspended(void) {
-  return _usbd_dev.suspended;
+  return tud_n_suspended(_usbd_rhport);
 }
 
 bool tud_remote_wakeup(void) {
-  // only wake up host if this feature is supported and enabled and we are suspended
-  TU_VERIFY (_usbd_dev.suspended && _usbd_dev.remote_wakeup_support && _usbd_dev.remote_wakeup_en);
-  dcd_remote_wakeup(_usbd_rhport);
-  return true;
+  return tud_n_remote_wakeup(_usbd_rhport);
 }
 
 bool tud_disconnect(void) {
-  TU_VERIFY(dcd_disconnect);
-  dcd_disconnect(_usbd_rhport);
-  return true;
+  return tud_n_disconnect(_usbd_rhport);
 }
 
 bool tud_connect(void) {
-  TU_VERIFY(dcd_connect);
-  dcd_connect(_usbd_rhport);
-  return true;
+  return tud_n_connect(_usbd_rhport);
 }
 
 //--------------------------------------------------------------------+
@@ -372,18 +786,21 @@ bool tud_inited(void) {
   return _usbd_rhport != RHPORT_INVALID;
 }
 
-bool tud_init(uint8_t rhport) {
-  // skip if already initialized
-  if (tud_inited()) return true;
+bool tud_n_inited(uint8_t rhport) {
+#if CFG_TUD_RHPORT_NUM > 1
+  return (rhport < CFG_TUD_RHPORT_NUM) && _usbd_port_inited[rhport];
+#else
+  return (rhport != RHPORT_INVALID) && (rhport == _usbd_rhport);
+#endif
+}
 
-  TU_LOG_USBD("USBD init on controller %u\r\n", rhport);
+// Init stack state shared by all ports
+static bool usbd_init_common(void) {
   TU_LOG_INT(CFG_TUD_LOG_LEVEL, sizeof(usbd_device_t));
   TU_LOG_INT(CFG_TUD_LOG_LEVEL, sizeof(dcd_event_t));
   TU_LOG_INT(CFG_TUD_LOG_LEVEL, sizeof(tu_fifo_t));
   TU_LOG_INT(CFG_TUD_LOG_LEVEL, sizeof(tu_edpt_stream_t));
 
-  tu_varclr(&_usbd_dev);
-
 #if OSAL_MUTEX_REQUIRED
   // Init device mutex
   _usbd_mutex = osal_mutex_create(&_ubsd_mutexdef);
@@ -394,6 +811,15 @@ bool tud_init(uint8_t rhport) {
   _usbd_q = osal_queue_create(&_usbd_qdef);
   TU_ASSERT(_usbd_q);
 
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+  _usbd_q_hi = osal_queue_create(&_usbd_qdef_hi);
+  TU_ASSERT(_usbd_q_hi);
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS
+  tu_varclr(&_usbd_q_stats);
+#endif
+
   // Get application driver if available
   if (usbd_app_driver_get_cb) {
     _app_driver = usbd_app_driver_get_cb(&_app_driver_count);
@@ -407,7 +833,36 @@ bool tud_init(uint8_t rhport) {
     driver->init();
   }
 
-  _usbd_rhport = rhport;
+  return true;
+}
+
+bool tud_init(uint8_t rhport) {
+  // skip if already initialized, single port stack only runs on one controller
+#if CFG_TUD_RHPORT_NUM > 1
+  if (tud_n_inited(rhport)) return true;
+  TU_ASSERT(rhport < CFG_TUD_RHPORT_NUM);
+#else
+  if (tud_inited()) return true;
+#endif
+
+  TU_LOG_USBD("USBD init on controller %u\r\n", rhport);
+
+  tu_memclr(get_device(rhport), sizeof(usbd_device_t));
+
+  if (!tud_inited()) {
+    TU_ASSERT(usbd_init_common());
+    _usbd_rhport = rhport;
+    _usbd_cur_rhport = rhport;
+  }
+
+#if CFG_TUD_RHPORT_NUM > 1
+  _usbd_port_inited[rhport] = true;
+#endif
+
+#if CFG_TUSB_OTG
+  // dual-role port running as host: controller is switched to device mode by tusb_role_switch()
+  if (tusb_role_get(rhport) == TUSB_ROLE_HOST) return true;
+#endif
 
   // Init device controller driver
   dcd_init(rhport);
@@ -416,29 +871,170 @@ bool tud_init(uint8_t rhport) {
   return true;
 }
 
+#if CFG_TUD_RHPORT_NUM > 1
+// Driver is bound to configuration of other port but not this one: it must keep its state on reset of this port
+static bool driver_used_by_other_port(uint8_t rhport, uint8_t drvid) {
+  if (memchr(_usbd_dev[rhport].itf2drv, drvid, CFG_TUD_INTERFACE_MAX)) return false;
+
+  for (uint8_t p = 0; p < CFG_TUD_RHPORT_NUM; p++) {
+    if (p != rhport && memchr(_usbd_dev[p].itf2drv, drvid, CFG_TUD_INTERFACE_MAX)) return true;
+  }
+  return false;
+}
+#endif
+
 static void configuration_reset(uint8_t rhport) {
   for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
     usbd_class_driver_t const* driver = get_driver(i);
     TU_ASSERT(driver,);
+#if CFG_TUD_RHPORT_NUM > 1
+    if (driver_used_by_other_port(rhport, i)) continue;
+#endif
     driver->reset(rhport);
   }
 
-  tu_varclr(&_usbd_dev);
-  memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
-  memset(_usbd_dev.ep2drv, DRVID_INVALID, sizeof(_usbd_dev.ep2drv)); // invalid mapping
+#if CFG_TUD_ARENA_SIZE
+  _usbd_arena_used[usbd_port_id(rhport)] = 0; // drivers are reset, release all buffers of previous configuration
+#endif
+
+#if CFG_TUD_ISO_STREAM
+  tu_varclr(&_usbd_iso_stream[usbd_port_id(rhport)]);
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  for (uint8_t i = 0; i < CFG_TUD_EDPT_XFER_FIFO_FALLBACK; i++) {
+    if (usbd_port_id(_usbd_xfer_fifo[i].rhport) == usbd_port_id(rhport)) _usbd_xfer_fifo[i].ep_addr = 0;
+  }
+#endif
+
+#if CFG_TUD_SOF_SCHED
+  if (_usbd_sof_sched[usbd_port_id(rhport)]) {
+    _usbd_sof_sched[usbd_port_id(rhport)] = NULL;
+    usbd_sof_enable(rhport, _usbd_sof_legacy[usbd_port_id(rhport)]);
+  }
+#endif
+
+  usbd_device_t* dev = get_device(rhport);
+  tu_memclr(dev, sizeof(usbd_device_t));
+  memset(dev->itf2drv, DRVID_INVALID, sizeof(dev->itf2drv)); // invalid mapping
+  memset(dev->ep2drv, DRVID_INVALID, sizeof(dev->ep2drv)); // invalid mapping
 }
 
 static void usbd_reset(uint8_t rhport) {
   configuration_reset(rhport);
-  usbd_control_reset();
+  usbd_control_reset(rhport);
+#if CFG_TUD_TASK_XFER_RESCUE
+  // drop stale completions, flag of other ports is cleared by next scan
+  #if CFG_TUD_RHPORT_NUM == 1
+  _usbd_xfer_rescue_any = false;
+  #endif
+  tu_varclr(&_usbd_xfer_rescue[usbd_port_id(rhport)]);
+#endif
+}
+
+#if CFG_TUD_TASK_XFER_RESCUE
+// Take a transfer completion kept while event queue was full, it is processed after queued events
+static bool xfer_rescue_take(dcd_event_t* event) {
+  if (!_usbd_xfer_rescue_any) return false;
+  _usbd_xfer_rescue_any = false; // clear before scanning, ISR sets it again after marking an endpoint
+
+  for (uint8_t port = 0; port < CFG_TUD_RHPORT_NUM; port++) {
+    for (uint8_t epnum = 0; epnum < CFG_TUD_ENDPPOINT_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        usbd_xfer_rescue_t* r = &_usbd_xfer_rescue[port][epnum][dir];
+        if (r->count) {
+          tu_memclr(event, sizeof(dcd_event_t));
+          event->rhport = resolve_rhport(port);
+          event->event_id = DCD_EVENT_XFER_COMPLETE;
+          event->xfer_complete.ep_addr = tu_edpt_addr(epnum, dir);
+
+          usbd_int_set(false);
+          event->xfer_complete.len = r->len;
+          event->xfer_complete.result = r->result;
+          #if CFG_TUD_EVENT_TIMESTAMP
+          event->timestamp = r->timestamp;
+          #endif
+          _usbd_xfer_rescue_extra = (uint8_t) (r->count - 1);
+          r->count = 0;
+          usbd_int_set(true);
+
+          _usbd_xfer_rescue_any = true; // there may be more
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+#endif
+
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+// Bus reset/unplugged overtakes pending events in normal queue. Drop stale transfer complete events,
+// function calls are still executed.
+static void flush_normal_queue(void) {
+  dcd_event_t event;
+  while (osal_queue_receive(_usbd_q, &event, 0)) {
+    if (event.event_id == USBD_EVENT_FUNC_CALL && event.func_call.func) {
+      event.func_call.func(event.func_call.param);
+    }
+  }
+}
+#endif
+
+#if CFG_TUSB_OTG
+// Drop events of previous session, deferred function calls are still invoked
+static void drop_queued_events(osal_queue_t q) {
+  dcd_event_t event;
+  while (osal_queue_receive(q, &event, 0)) {
+    if (event.event_id == USBD_EVENT_FUNC_CALL && event.func_call.func) {
+      event.func_call.func(event.func_call.param);
+    }
+  }
+}
+
+void usbd_role_exit(uint8_t rhport) {
+  dcd_int_disable(rhport);
+  if (dcd_disconnect) dcd_disconnect(rhport);
+
+  usbd_device_t* dev = get_device(rhport);
+  bool const mounted = (dev->cfg_num != 0);
+
+  drop_queued_events(_usbd_q);
+  #if CFG_TUD_TASK_QUEUE_HI_SZ
+  drop_queued_events(_usbd_q_hi);
+  #endif
+
+  usbd_reset(rhport); // also clears device state with invalid driver mapping
+
+  if (mounted && tud_umount_cb) tud_umount_cb();
 }
+#endif
 
 bool tud_task_event_ready(void) {
   // Skip if stack is not initialized
   if (!tud_inited()) return false;
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+  if (!osal_queue_empty(_usbd_q_hi)) return true;
+#endif
+#if CFG_TUD_TASK_XFER_RESCUE
+  if (_usbd_xfer_rescue_any) return true;
+#endif
   return !osal_queue_empty(_usbd_q);
 }
 
+uint32_t tud_task_next_deadline_ms(void) {
+  if (!tud_inited()) return OSAL_TIMEOUT_WAIT_FOREVER;
+  if (tud_task_event_ready()) return 0;
+
+  // SOF is not generated while bus is suspended
+  for (uint8_t port = 0; port < CFG_TUD_RHPORT_NUM; port++) {
+    if (_usbd_sof_enabled[port] && !_usbd_dev[port].suspended) return 1;
+  }
+
+  return OSAL_TIMEOUT_WAIT_FOREVER;
+}
+
 /* USB Device Driver task
  * This top level thread manages all device controller event and delegates events to class-specific drivers.
  * This should be called periodically within the mainloop or rtos thread.
@@ -459,46 +1055,88 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
   // Skip if stack is not initialized
   if (!tud_inited()) return;
 
+#if CFG_TUD_TASK_EVENT_MAX
+  uint32_t event_count = 0;
+#endif
+#if CFG_TUD_TASK_TIME_BUDGET_US
+  uint32_t const start_us = tud_task_time_us_cb ? tud_task_time_us_cb() : 0;
+#endif
+
   // Loop until there is no more events in the queue
   while (1) {
     dcd_event_t event;
+#if CFG_TUD_TASK_XFER_RESCUE
+    _usbd_xfer_rescue_extra = 0;
+#endif
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+    // always process high priority events first
+    if (!osal_queue_receive(_usbd_q_hi, &event, 0))
+#endif
+#if CFG_TUD_TASK_XFER_RESCUE
+    if (!osal_queue_receive(_usbd_q, &event, 0) && !xfer_rescue_take(&event))
+#endif
     if (!osal_queue_receive(_usbd_q, &event, timeout_ms)) return;
 
 #if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
     if (event.event_id == DCD_EVENT_SETUP_RECEIVED) TU_LOG_USBD("\r\n"); // extra line for setup
     TU_LOG_USBD("USBD %s ", event.event_id < DCD_EVENT_COUNT ? _usbd_event_str[event.event_id] : "CORRUPTED");
 #endif
+#if CFG_TUD_EVENT_TIMESTAMP
+    _usbd_event_timestamp = event.timestamp;
+    uint32_t const latency = (uint32_t) CFG_TUSB_EVENT_TIMESTAMP() - event.timestamp;
+  #if CFG_TUD_TASK_QUEUE_STATS
+    // only updated by task, ISR does not touch these
+    _usbd_q_stats.dispatched++;
+    _usbd_q_stats.latency_total += latency;
+    if (latency > _usbd_q_stats.latency_max) _usbd_q_stats.latency_max = latency;
+  #endif
+    TU_TRACE(TU_TRACE_TASK_DISPATCH, event.event_id, tu_min32(latency, UINT16_MAX));
+    (void) latency;
+#else
+    TU_TRACE(TU_TRACE_TASK_DISPATCH, event.event_id, 0);
+#endif
+
+    // function call event is not bound to a port
+    if (event.event_id != USBD_EVENT_FUNC_CALL) _usbd_cur_rhport = event.rhport;
+    usbd_device_t* dev = get_device(event.rhport);
 
     switch (event.event_id) {
       case DCD_EVENT_BUS_RESET:
         TU_LOG_USBD(": %s Speed\r\n", tu_str_speed[event.bus_reset.speed]);
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+        flush_normal_queue();
+#endif
         usbd_reset(event.rhport);
-        _usbd_dev.speed = event.bus_reset.speed;
+        dev->speed = event.bus_reset.speed;
         break;
 
       case DCD_EVENT_UNPLUGGED:
         TU_LOG_USBD("\r\n");
+#if CFG_TUD_TASK_QUEUE_HI_SZ
+        flush_normal_queue();
+#endif
         usbd_reset(event.rhport);
         if (tud_umount_cb) tud_umount_cb();
         break;
 
       case DCD_EVENT_SETUP_RECEIVED:
-        _usbd_dev.setup_count--;
+        dev->setup_count--;
         TU_LOG_BUF(CFG_TUD_LOG_LEVEL, &event.setup_received, 8);
-        if (_usbd_dev.setup_count) {
+        TU_CAPTURE(TU_CAPTURE_SETUP, event.rhport, 0, 0, 8, XFER_RESULT_SUCCESS, &event.setup_received, 8);
+        if (dev->setup_count) {
           TU_LOG_USBD("  Skipped since there is other SETUP in queue\r\n");
           break;
         }
 
         // Mark as connected after receiving 1st setup packet.
         // But it is easier to set it every time instead of wasting time to check then set
-        _usbd_dev.connected = 1;
+        dev->connected = 1;
 
         // mark both in & out control as free
-        _usbd_dev.ep_status[0][TUSB_DIR_OUT].busy = 0;
-        _usbd_dev.ep_status[0][TUSB_DIR_OUT].claimed = 0;
-        _usbd_dev.ep_status[0][TUSB_DIR_IN].busy = 0;
-        _usbd_dev.ep_status[0][TUSB_DIR_IN].claimed = 0;
+        dev->ep_status[0][TUSB_DIR_OUT].busy = 0;
+        dev->ep_status[0][TUSB_DIR_OUT].claimed = 0;
+        dev->ep_status[0][TUSB_DIR_IN].busy = 0;
+        dev->ep_status[0][TUSB_DIR_IN].claimed = 0;
 
         // Process control request
         if (!process_control_request(event.rhport, &event.setup_received)) {
@@ -515,20 +1153,59 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         uint8_t const epnum = tu_edpt_number(ep_addr);
         uint8_t const ep_dir = tu_edpt_dir(ep_addr);
 
+#if CFG_TUD_EDPT_XFER_COALESCE
+        // pick up completions merged into this event
+        uint8_t merged_count = edpt_xfer_coalesce_take(&event);
+#else
+        uint8_t merged_count = 0;
+#endif
+#if CFG_TUD_TASK_XFER_RESCUE
+        // completions merged into rescued event while event queue was full
+        merged_count = (uint8_t) (merged_count + _usbd_xfer_rescue_extra);
+#endif
+        if (merged_count) {
+          TU_LOG_USBD("(+%u merged) ", merged_count);
+        }
+        (void) merged_count;
+
         TU_LOG_USBD("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
 
-        _usbd_dev.ep_status[epnum][ep_dir].busy = 0;
-        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+#if CFG_TUSB_CAPTURE
+        uint8_t const* capture_data = NULL;
+  #if CFG_TUSB_CAPTURE_PAYLOAD
+        if (ep_dir == TUSB_DIR_OUT) {
+          capture_data = _usbd_capture_buf[usbd_port_id(event.rhport)][epnum];
+          _usbd_capture_buf[usbd_port_id(event.rhport)][epnum] = NULL;
+        }
+  #endif
+        TU_CAPTURE(TU_CAPTURE_COMPLETE, event.rhport, 0, ep_addr, (uint16_t) event.xfer_complete.len,
+                   event.xfer_complete.result, capture_data, (uint16_t) event.xfer_complete.len);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+        // endpoint is still busy if there are other transfers queued/in progress
+        if (epnum && !edpt_xfer_queue_done(event.rhport, epnum, ep_dir, 1 + merged_count)) {
+          // skip clearing busy and claimed
+        } else
+#endif
+        {
+          dev->ep_status[epnum][ep_dir].busy = 0;
+          dev->ep_status[epnum][ep_dir].claimed = 0;
+        }
 
         if (0 == epnum) {
           usbd_control_xfer_cb(event.rhport, ep_addr, (xfer_result_t) event.xfer_complete.result,
                                event.xfer_complete.len);
         } else {
-          usbd_class_driver_t const* driver = get_driver(_usbd_dev.ep2drv[epnum][ep_dir]);
+          uint8_t const drvid = dev->ep2drv[epnum][ep_dir];
+          usbd_class_driver_t const* driver = get_driver(drvid);
           TU_ASSERT(driver,);
 
           TU_LOG_USBD("  %s xfer callback\r\n", driver->name);
-          driver->xfer_cb(event.rhport, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
+          TU_TRACE(TU_TRACE_XFER_CB_START, ep_addr, event.xfer_complete.len);
+          DRIVER_CALL(drvid, driver, , xfer_cb, event.rhport, ep_addr, (xfer_result_t) event.xfer_complete.result,
+                      event.xfer_complete.len);
+          TU_TRACE(TU_TRACE_XFER_CB_END, ep_addr, 0);
         }
         break;
       }
@@ -537,17 +1214,29 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         // NOTE: When plugging/unplugging device, the D+/D- state are unstable and
         // can accidentally meet the SUSPEND condition ( Bus Idle for 3ms ), which result in a series of event
         // e.g suspend -> resume -> unplug/plug. Skip suspend/resume if not connected
-        if (_usbd_dev.connected) {
-          TU_LOG_USBD(": Remote Wakeup = %u\r\n", _usbd_dev.remote_wakeup_en);
-          if (tud_suspend_cb) tud_suspend_cb(_usbd_dev.remote_wakeup_en);
+        if (dev->connected) {
+          TU_LOG_USBD(": Remote Wakeup = %u\r\n", dev->remote_wakeup_en);
+          if (tud_suspend_cb) tud_suspend_cb(dev->remote_wakeup_en);
         } else {
           TU_LOG_USBD(" Skipped\r\n");
         }
         break;
 
-      case DCD_EVENT_RESUME:
-        if (_usbd_dev.connected) {
-          TU_LOG_USBD("\r\n");
+#if CFG_TUD_LPM
+      case DCD_EVENT_LPM_SLEEP:
+        if (dev->connected) {
+          TU_LOG_USBD(": BESL = %u us, Remote Wakeup = %u\r\n", tud_lpm_besl_us(event.lpm_sleep.besl),
+                      event.lpm_sleep.remote_wakeup);
+          if (tud_lpm_sleep_cb) tud_lpm_sleep_cb(event.lpm_sleep.besl, event.lpm_sleep.remote_wakeup);
+        } else {
+          TU_LOG_USBD(" Skipped\r\n");
+        }
+        break;
+#endif
+
+      case DCD_EVENT_RESUME:
+        if (dev->connected) {
+          TU_LOG_USBD("\r\n");
           if (tud_resume_cb) tud_resume_cb();
         } else {
           TU_LOG_USBD(" Skipped\r\n");
@@ -565,9 +1254,17 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         break;
     }
 
+#if CFG_TUD_TASK_EVENT_MAX
+    // leave remaining events for next call
+    if (++event_count >= CFG_TUD_TASK_EVENT_MAX) return;
+#endif
+#if CFG_TUD_TASK_TIME_BUDGET_US
+    if (tud_task_time_us_cb && (tud_task_time_us_cb() - start_us) >= CFG_TUD_TASK_TIME_BUDGET_US) return;
+#endif
+
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbd_q)) return;
+    if (!tud_task_event_ready()) return;
 #endif
   }
 }
@@ -577,23 +1274,38 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
 //--------------------------------------------------------------------+
 
 // Helper to invoke class driver control request handler
-static bool invoke_class_control(uint8_t rhport, usbd_class_driver_t const * driver, tusb_control_request_t const * request) {
-  usbd_control_set_complete_callback(driver->control_xfer_cb);
+static bool invoke_class_control(uint8_t rhport, uint8_t drvid, usbd_class_driver_t const * driver,
+                                 tusb_control_request_t const * request) {
+  bool ret = false;
+  usbd_control_set_complete_callback(rhport, driver->control_xfer_cb);
   TU_LOG_USBD("  %s control request\r\n", driver->name);
-  return driver->control_xfer_cb(rhport, CONTROL_STAGE_SETUP, request);
+  DRIVER_CALL(drvid, driver, ret =, control_xfer_cb, rhport, CONTROL_STAGE_SETUP, request);
+  return ret;
 }
 
 // This handles the actual request and its response.
 // return false will cause its caller to stall control endpoint
 static bool process_control_request(uint8_t rhport, tusb_control_request_t const * p_request) {
-  usbd_control_set_complete_callback(NULL);
+  usbd_device_t* dev = get_device(rhport);
+
+  usbd_control_set_complete_callback(rhport, NULL);
   TU_ASSERT(p_request->bmRequestType_bit.type < TUSB_REQ_TYPE_INVALID);
 
   // Vendor request
   if ( p_request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR ) {
+#if CFG_TUD_EDPT_STATS && CFG_TUD_EDPT_STATS_VENDOR_REQUEST
+    // endpoint statistics exporter: wIndex is endpoint address, data is tusb_edpt_stats_t (little endian)
+    if (p_request->bRequest == CFG_TUD_EDPT_STATS_VENDOR_REQUEST &&
+        p_request->bmRequestType_bit.direction == TUSB_DIR_IN) {
+      tu_static tusb_edpt_stats_t stats_report;
+      TU_VERIFY(edpt_stats_get(rhport, tu_u16_low(p_request->wIndex), &stats_report));
+      return tud_control_xfer(rhport, p_request, &stats_report, sizeof(stats_report));
+    }
+#endif
+
     TU_VERIFY(tud_vendor_control_xfer_cb);
 
-    usbd_control_set_complete_callback(tud_vendor_control_xfer_cb);
+    usbd_control_set_complete_callback(rhport, tud_vendor_control_xfer_cb);
     return tud_vendor_control_xfer_cb(rhport, CONTROL_STAGE_SETUP, p_request);
   }
 
@@ -609,13 +1321,14 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
     case TUSB_REQ_RCPT_DEVICE:
       if ( TUSB_REQ_TYPE_CLASS == p_request->bmRequestType_bit.type ) {
         uint8_t const itf = tu_u16_low(p_request->wIndex);
-        TU_VERIFY(itf < TU_ARRAY_SIZE(_usbd_dev.itf2drv));
+        TU_VERIFY(itf < TU_ARRAY_SIZE(dev->itf2drv));
 
-        usbd_class_driver_t const * driver = get_driver(_usbd_dev.itf2drv[itf]);
+        uint8_t const drvid = dev->itf2drv[itf];
+        usbd_class_driver_t const * driver = get_driver(drvid);
         TU_VERIFY(driver);
 
         // forward to class driver: "non-STD request to Interface"
-        return invoke_class_control(rhport, driver, p_request);
+        return invoke_class_control(rhport, drvid, driver, p_request);
       }
 
       if ( TUSB_REQ_TYPE_STANDARD != p_request->bmRequestType_bit.type ) {
@@ -629,14 +1342,14 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           // Depending on mcu, status phase could be sent either before or after changing device address,
           // or even require stack to not response with status at all
           // Therefore DCD must take full responsibility to response and include zlp status packet if needed.
-          usbd_control_set_request(p_request); // set request since DCD has no access to tud_control_status() API
+          usbd_control_set_request(rhport, p_request); // set request since DCD has no access to tud_control_status() API
           dcd_set_address(rhport, (uint8_t) p_request->wValue);
           // skip tud_control_status()
-          _usbd_dev.addressed = 1;
+          dev->addressed = 1;
         break;
 
         case TUSB_REQ_GET_CONFIGURATION: {
-          uint8_t cfg_num = _usbd_dev.cfg_num;
+          uint8_t cfg_num = dev->cfg_num;
           tud_control_xfer(rhport, p_request, &cfg_num, 1);
         }
         break;
@@ -645,19 +1358,19 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           uint8_t const cfg_num = (uint8_t) p_request->wValue;
 
           // Only process if new configure is different
-          if (_usbd_dev.cfg_num != cfg_num) {
-            if ( _usbd_dev.cfg_num ) {
+          if (dev->cfg_num != cfg_num) {
+            if ( dev->cfg_num ) {
               // already configured: need to clear all endpoints and driver first
-              TU_LOG_USBD("  Clear current Configuration (%u) before switching\r\n", _usbd_dev.cfg_num);
+              TU_LOG_USBD("  Clear current Configuration (%u) before switching\r\n", dev->cfg_num);
 
               // close all non-control endpoints, cancel all pending transfers if any
               dcd_edpt_close_all(rhport);
 
               // close all drivers and current configured state except bus speed
-              uint8_t const speed = _usbd_dev.speed;
+              uint8_t const speed = dev->speed;
               configuration_reset(rhport);
 
-              _usbd_dev.speed = speed; // restore speed
+              dev->speed = speed; // restore speed
             }
 
             // Handle the new configuration and execute the corresponding callback
@@ -670,7 +1383,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
             }
           }
 
-          _usbd_dev.cfg_num = cfg_num;
+          dev->cfg_num = cfg_num;
           tud_control_status(rhport, p_request);
         }
         break;
@@ -686,7 +1399,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           TU_LOG_USBD("    Enable Remote Wakeup\r\n");
 
           // Host may enable remote wake up before suspending especially HID device
-          _usbd_dev.remote_wakeup_en = true;
+          dev->remote_wakeup_en = true;
           tud_control_status(rhport, p_request);
         break;
 
@@ -697,7 +1410,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           TU_LOG_USBD("    Disable Remote Wakeup\r\n");
 
           // Host may disable remote wake up after resuming
-          _usbd_dev.remote_wakeup_en = false;
+          dev->remote_wakeup_en = false;
           tud_control_status(rhport, p_request);
         break;
 
@@ -705,7 +1418,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           // Device status bit mask
           // - Bit 0: Self Powered
           // - Bit 1: Remote Wakeup enabled
-          uint16_t status = (uint16_t) ((_usbd_dev.self_powered ? 1u : 0u) | (_usbd_dev.remote_wakeup_en ? 2u : 0u));
+          uint16_t status = (uint16_t) ((dev->self_powered ? 1u : 0u) | (dev->remote_wakeup_en ? 2u : 0u));
           tud_control_xfer(rhport, p_request, &status, 2);
           break;
         }
@@ -718,14 +1431,15 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
     //------------- Class/Interface Specific Request -------------//
     case TUSB_REQ_RCPT_INTERFACE: {
       uint8_t const itf = tu_u16_low(p_request->wIndex);
-      TU_VERIFY(itf < TU_ARRAY_SIZE(_usbd_dev.itf2drv));
+      TU_VERIFY(itf < TU_ARRAY_SIZE(dev->itf2drv));
 
-      usbd_class_driver_t const * driver = get_driver(_usbd_dev.itf2drv[itf]);
+      uint8_t const drvid = dev->itf2drv[itf];
+      usbd_class_driver_t const * driver = get_driver(drvid);
       TU_VERIFY(driver);
 
       // all requests to Interface (STD or Class) is forwarded to class driver.
       // notable requests are: GET HID REPORT DESCRIPTOR, SET_INTERFACE, GET_INTERFACE
-      if ( !invoke_class_control(rhport, driver, p_request) ) {
+      if ( !invoke_class_control(rhport, drvid, driver, p_request) ) {
         // For GET_INTERFACE and SET_INTERFACE, it is mandatory to respond even if the class
         // driver doesn't use alternate settings or implement this
         TU_VERIFY(TUSB_REQ_TYPE_STANDARD == p_request->bmRequestType_bit.type);
@@ -734,7 +1448,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           case TUSB_REQ_GET_INTERFACE:
           case TUSB_REQ_SET_INTERFACE:
             // Clear complete callback if driver set since it can also stall the request.
-            usbd_control_set_complete_callback(NULL);
+            usbd_control_set_complete_callback(rhport, NULL);
 
             if (TUSB_REQ_GET_INTERFACE == p_request->bRequest) {
               uint8_t alternate = 0;
@@ -756,13 +1470,14 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
       uint8_t const ep_num  = tu_edpt_number(ep_addr);
       uint8_t const ep_dir  = tu_edpt_dir(ep_addr);
 
-      TU_ASSERT(ep_num < TU_ARRAY_SIZE(_usbd_dev.ep2drv) );
-      usbd_class_driver_t const * driver = get_driver(_usbd_dev.ep2drv[ep_num][ep_dir]);
+      TU_ASSERT(ep_num < TU_ARRAY_SIZE(dev->ep2drv) );
+      uint8_t const drvid = dev->ep2drv[ep_num][ep_dir];
+      usbd_class_driver_t const * driver = get_driver(drvid);
 
       if ( TUSB_REQ_TYPE_STANDARD != p_request->bmRequestType_bit.type ) {
         // Forward class request to its driver
         TU_VERIFY(driver);
-        return invoke_class_control(rhport, driver, p_request);
+        return invoke_class_control(rhport, drvid, driver, p_request);
       } else {
         // Handle STD request to endpoint
         switch ( p_request->bRequest ) {
@@ -788,11 +1503,11 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 
               // STD request must always be ACKed regardless of driver returned value
               // Also clear complete callback if driver set since it can also stall the request.
-              (void) invoke_class_control(rhport, driver, p_request);
-              usbd_control_set_complete_callback(NULL);
+              (void) invoke_class_control(rhport, drvid, driver, p_request);
+              usbd_control_set_complete_callback(rhport, NULL);
 
               // skip ZLP status if driver already did that
-              if ( !_usbd_dev.ep_status[0][TUSB_DIR_IN].busy ) tud_control_status(rhport, p_request);
+              if ( !dev->ep_status[0][TUSB_DIR_IN].busy ) tud_control_status(rhport, p_request);
             }
           }
           break;
@@ -815,6 +1530,72 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
   return true;
 }
 
+// Bind interfaces and endpoints of a function opened by driver
+static bool bind_function(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t drv_len, uint8_t drv_id, uint8_t itf_count)
+{
+  usbd_device_t* dev = get_device(rhport);
+
+  // bind (associated) interfaces to found driver
+  for(uint8_t i=0; i<itf_count; i++)
+  {
+    uint8_t const itf_num = desc_itf->bInterfaceNumber+i;
+
+    // Interface number must not be used already
+    TU_ASSERT(itf_num < CFG_TUD_INTERFACE_MAX && DRVID_INVALID == dev->itf2drv[itf_num]);
+    dev->itf2drv[itf_num] = drv_id;
+  }
+
+  // bind all endpoints to found driver
+  tu_edpt_bind_driver(dev->ep2drv, desc_itf, drv_len, drv_id);
+
+  return true;
+}
+
+void tud_config_cache_clear(void)
+{
+#if CFG_TUD_CONFIG_CACHE
+  tu_varclr(&_usbd_cfg_cache);
+  _usbd_cfg_cache_next = 0;
+#endif
+}
+
+#if CFG_TUD_CONFIG_CACHE
+static usbd_config_index_t* config_cache_find(tusb_desc_configuration_t const * desc_cfg)
+{
+  for(uint8_t i=0; i<CFG_TUD_CONFIG_CACHE; i++)
+  {
+    usbd_config_index_t* index = &_usbd_cfg_cache[i];
+    if ( index->desc_cfg == (uintptr_t) desc_cfg && index->total_len == tu_le16toh(desc_cfg->wTotalLength) )
+    {
+      return index;
+    }
+  }
+  return NULL;
+}
+
+// Open drivers with cached index, no driver probing
+static bool config_cache_open(uint8_t rhport, usbd_config_index_t const * index)
+{
+  uint8_t const * desc_cfg = (uint8_t const *) index->desc_cfg;
+
+  for(uint8_t f=0; f<index->func_count; f++)
+  {
+    tusb_desc_interface_t const * desc_itf = (tusb_desc_interface_t const *) (desc_cfg + index->func[f].offset);
+    uint16_t const remaining_len = (uint16_t) (index->total_len - index->func[f].offset);
+
+    usbd_class_driver_t const *driver = get_driver(index->func[f].drv_id);
+    TU_ASSERT(driver);
+    uint16_t const drv_len = driver->open(rhport, desc_itf, remaining_len);
+    TU_ASSERT( (sizeof(tusb_desc_interface_t) <= drv_len) && (drv_len <= remaining_len) );
+
+    TU_LOG_USBD("  %s opened\r\n", driver->name);
+    TU_ASSERT(bind_function(rhport, desc_itf, drv_len, index->func[f].drv_id, index->func[f].itf_count));
+  }
+
+  return true;
+}
+#endif
+
 // Process Set Configure Request
 // This function parse configuration descriptor & open drivers accordingly
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
@@ -824,8 +1605,21 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
   TU_ASSERT(desc_cfg != NULL && desc_cfg->bDescriptorType == TUSB_DESC_CONFIGURATION);
 
   // Parse configuration descriptor
-  _usbd_dev.remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1u : 0u;
-  _usbd_dev.self_powered          = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED ) ? 1u : 0u;
+  usbd_device_t* dev = get_device(rhport);
+  dev->remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1u : 0u;
+  dev->self_powered          = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED ) ? 1u : 0u;
+
+  // let DCD plan its endpoint buffer before any endpoint is opened
+  if ( dcd_edpt_config_plan ) dcd_edpt_config_plan(rhport, desc_cfg);
+
+#if CFG_TUD_CONFIG_CACHE
+  usbd_config_index_t const * cached = config_cache_find(desc_cfg);
+  if ( cached ) return config_cache_open(rhport, cached);
+
+  // build index in next slot (round-robin), only kept if all interfaces are opened
+  usbd_config_index_t* index = &_usbd_cfg_cache[_usbd_cfg_cache_next];
+  tu_varclr(index);
+#endif
 
   // Parse interface descriptor
   uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
@@ -882,18 +1676,15 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
           #endif
         }
 
-        // bind (associated) interfaces to found driver
-        for(uint8_t i=0; i<assoc_itf_count; i++)
-        {
-          uint8_t const itf_num = desc_itf->bInterfaceNumber+i;
-
-          // Interface number must not be used already
-          TU_ASSERT(DRVID_INVALID == _usbd_dev.itf2drv[itf_num]);
-          _usbd_dev.itf2drv[itf_num] = drv_id;
-        }
+        TU_ASSERT(bind_function(rhport, desc_itf, drv_len, drv_id, assoc_itf_count));
 
-        // bind all endpoints to found driver
-        tu_edpt_bind_driver(_usbd_dev.ep2drv, desc_itf, drv_len, drv_id);
+#if CFG_TUD_CONFIG_CACHE
+        TU_ASSERT(index->func_count < CFG_TUD_INTERFACE_MAX);
+        index->func[index->func_count].offset    = (uint16_t) ((uintptr_t) desc_itf - (uintptr_t) desc_cfg);
+        index->func[index->func_count].drv_id    = drv_id;
+        index->func[index->func_count].itf_count = assoc_itf_count;
+        index->func_count++;
+#endif
 
         // next Interface
         p_desc += drv_len;
@@ -906,6 +1697,12 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
     TU_ASSERT(drv_id < TOTAL_DRIVER_COUNT);
   }
 
+#if CFG_TUD_CONFIG_CACHE
+  index->desc_cfg  = (uintptr_t) desc_cfg;
+  index->total_len = tu_le16toh(desc_cfg->wTotalLength);
+  _usbd_cfg_cache_next = (uint8_t) ((_usbd_cfg_cache_next + 1) % CFG_TUD_CONFIG_CACHE);
+#endif
+
   return true;
 }
 
@@ -925,7 +1722,7 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 
       // Only response with exactly 1 Packet if: not addressed and host requested more data than device descriptor has.
       // This only happens with the very first get device descriptor and EP0 size = 8 or 16.
-      if ((CFG_TUD_ENDPOINT0_SIZE < sizeof(tusb_desc_device_t)) && !_usbd_dev.addressed &&
+      if ((CFG_TUD_ENDPOINT0_SIZE < sizeof(tusb_desc_device_t)) && !get_device(rhport)->addressed &&
           ((tusb_control_request_t const*) p_request)->wLength > sizeof(tusb_desc_device_t))
       {
         // Hack here: we modify the request length to prevent usbd_control response with zlp
@@ -1018,14 +1815,219 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+
+#if CFG_TUD_ISO_STREAM
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* iso_stream_slot(usbd_iso_stream_t const* s, uint16_t idx) {
+  return s->buffer + (idx & (s->num_slots - 1u)) * s->slot_size;
+}
+
+// Arm next packet of the stream, called at start and on every completion
+TU_ATTR_FAST_FUNC static bool iso_stream_arm(uint8_t rhport, usbd_iso_stream_t* s) {
+  if (tu_edpt_dir(s->ep_addr) == TUSB_DIR_IN) {
+    if (s->wr_idx != s->rd_idx) {
+      s->slot_armed = true;
+      return dcd_edpt_xfer(rhport, s->ep_addr, iso_stream_slot(s, s->rd_idx),
+                           s->length[s->rd_idx & (s->num_slots - 1u)]);
+    }
+    // nothing to send in this frame, keep endpoint armed with ZLP
+    s->slot_armed = false;
+    return dcd_edpt_xfer(rhport, s->ep_addr, NULL, 0);
+  } else {
+    // slot at wr_idx is never visible to class
+    return dcd_edpt_xfer(rhport, s->ep_addr, iso_stream_slot(s, s->wr_idx), s->slot_size);
+  }
+}
+
+// Return true if completion belongs to a stream and is consumed in ISR
+TU_ATTR_FAST_FUNC static bool iso_stream_isr(dcd_event_t const* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum == 0 || epnum >= CFG_TUD_ENDPPOINT_MAX) return false;
+
+  usbd_iso_stream_t* s = _usbd_iso_stream[usbd_port_id(event->rhport)][epnum][tu_edpt_dir(ep_addr)];
+  if (s == NULL) return false;
+
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
+    if (s->slot_armed) {
+      s->rd_idx++; // slot is sent, free it for class
+    } else {
+      s->missed++;
+    }
+  } else {
+    if (usbd_iso_stream_count(s) < s->num_slots - 1u) {
+      s->length[s->wr_idx & (s->num_slots - 1u)] = (uint16_t) event->xfer_complete.len;
+      s->wr_idx++;
+    } else {
+      s->missed++; // ring is full: drop packet, re-use the same slot
+    }
+  }
+
+  iso_stream_arm(event->rhport, s);
+  return true;
+}
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+// slots are shared by all ports: a free slot (ep_addr = 0) is found for any port
+static usbd_xfer_fifo_t* xfer_fifo_find(uint8_t rhport, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUD_EDPT_XFER_FIFO_FALLBACK; i++) {
+    usbd_xfer_fifo_t* x = &_usbd_xfer_fifo[i];
+    if (x->ep_addr == ep_addr && (ep_addr == 0 || usbd_port_id(x->rhport) == usbd_port_id(rhport))) return x;
+  }
+  return NULL;
+}
+
+// Start next segment: linear span of fifo as is if possible, otherwise one packet through bounce buffer
+TU_ATTR_FAST_FUNC static bool xfer_fifo_segment(uint8_t rhport, usbd_xfer_fifo_t* x) {
+  uint8_t const ep_addr = x->ep_addr;
+  uint16_t const mps_info = _usbd_xfer_fifo_mps[usbd_port_id(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint16_t const mps = mps_info & (uint16_t) ~XFER_FIFO_MPS_ISO;
+  bool const is_iso = (mps_info & XFER_FIFO_MPS_ISO) != 0;
+  bool const is_in = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN);
+  uint16_t const remaining = (uint16_t) (x->total - x->xferred);
+
+  tu_fifo_buffer_info_t info;
+  if (is_in) {
+    tu_fifo_get_read_info(x->ff, &info);
+  } else {
+    tu_fifo_get_write_info(x->ff, &info);
+  }
+
+  uint16_t len = tu_min16(info.len_lin, remaining);
+  if (len < remaining) {
+    // segment must end on packet boundary, ISO packet can not be split at all
+    len = is_iso ? 0 : (uint16_t) (len - (len % mps));
+  }
+
+  uint8_t* buf = (uint8_t*) info.ptr_lin;
+  x->bounce = (len == 0) || ((uintptr_t) buf & 3u);
+  if (x->bounce) {
+    len = is_iso ? remaining : tu_min16(remaining, mps);
+    TU_ASSERT(len <= CFG_TUD_EDPT_XFER_FIFO_BOUNCE_SIZE);
+    buf = x->bounce_buf;
+    if (is_in) len = tu_fifo_read_n(x->ff, buf, len);
+  }
+
+  x->seg_len = len;
+  return dcd_edpt_xfer(rhport, ep_addr, buf, len);
+}
+
+TU_ATTR_FAST_FUNC static bool xfer_fifo_start(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  TU_ASSERT(ff->item_size == 1);
+
+  // re-use slot of the same endpoint (e.g aborted transfer) or a free one
+  usbd_xfer_fifo_t* x = xfer_fifo_find(rhport, ep_addr);
+  if (x == NULL) x = xfer_fifo_find(rhport, 0);
+  TU_ASSERT(x);
+
+  // IN: only what is available in fifo
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) total_bytes = tu_min16(total_bytes, tu_fifo_count(ff));
+
+  x->ff = ff;
+  x->total = total_bytes;
+  x->xferred = 0;
+  x->rhport = rhport;
+  x->ep_addr = ep_addr;
+
+  if (!xfer_fifo_segment(rhport, x)) {
+    x->ep_addr = 0;
+    return false;
+  }
+  return true;
+}
+
+// Return true if completion is a non-final segment of a fifo transfer (next one is started). Otherwise
+// *p_event points to a copy with length of whole transfer if the completion ends a fifo transfer.
+TU_ATTR_FAST_FUNC static bool xfer_fifo_isr(dcd_event_t const** p_event, dcd_event_t* final_event) {
+  dcd_event_t const* event = *p_event;
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  if (ep_addr == 0) return false;
+
+  usbd_xfer_fifo_t* x = xfer_fifo_find(event->rhport, ep_addr);
+  if (x == NULL) return false;
+
+  uint16_t const len = (uint16_t) tu_min32(event->xfer_complete.len, x->seg_len);
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) {
+    if (x->bounce) {
+      tu_fifo_write_n(x->ff, x->bounce_buf, len);
+    } else {
+      tu_fifo_advance_write_pointer(x->ff, len);
+    }
+  } else if (!x->bounce) {
+    tu_fifo_advance_read_pointer(x->ff, len);
+  }
+  x->xferred = (uint16_t) (x->xferred + len);
+
+  // continue unless failed, all done or short packet
+  if (event->xfer_complete.result == XFER_RESULT_SUCCESS && x->xferred < x->total && len == x->seg_len) {
+    if (xfer_fifo_segment(event->rhport, x)) return true;
+  }
+
+  *final_event = *event;
+  final_event->xfer_complete.len = x->xferred;
+  *p_event = final_event;
+  x->ep_addr = 0;
+  return false;
+}
+#endif
+
+// Invoke driver's xfer_isr() if available, return true if the completion is consumed in ISR context
+TU_ATTR_FAST_FUNC static bool edpt_xfer_isr(dcd_event_t const* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  if (epnum == 0 || epnum >= CFG_TUD_ENDPPOINT_MAX) return false;
+  usbd_device_t* dev = get_device(event->rhport);
+
+  uint8_t const drvid = dev->ep2drv[epnum][dir];
+  usbd_class_driver_t const* driver = get_driver(drvid);
+  if (!(driver && driver->xfer_isr)) return false;
+
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+  // Release endpoint so that driver can re-arm it within handler
+#if CFG_TUD_EDPT_XFER_QUEUE
+  usbd_xfer_queue_t* q = &dev->ep_queue[epnum][dir];
+  if (q->pending) q->pending--;
+  ep_state->busy = (q->pending ? 1 : 0);
+#else
+  ep_state->busy = 0;
+#endif
+  if (!ep_state->busy) ep_state->claimed = 0;
+
+  bool handled = false;
+  DRIVER_CALL(drvid, driver, handled =, xfer_isr, event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result,
+              event->xfer_complete.len);
+  if (handled) {
+    return true;
+  }
+
+  // deferred to xfer_cb() in usbd task, which will release the endpoint
+#if CFG_TUD_EDPT_XFER_QUEUE
+  q->pending++;
+#endif
+  ep_state->busy = 1;
+
+  return false;
+}
+
 TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr) {
   bool send = false;
+  usbd_device_t* dev = get_device(event->rhport);
+
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  // segment of fifo transfer: start next one, only completion of the whole transfer is reported
+  dcd_event_t fifo_event;
+  if (event->event_id == DCD_EVENT_XFER_COMPLETE && xfer_fifo_isr(&event, &fifo_event)) return;
+#endif
+
   switch (event->event_id) {
     case DCD_EVENT_UNPLUGGED:
-      _usbd_dev.connected = 0;
-      _usbd_dev.addressed = 0;
-      _usbd_dev.cfg_num = 0;
-      _usbd_dev.suspended = 0;
+      dev->connected = 0;
+      dev->addressed = 0;
+      dev->cfg_num = 0;
+      dev->suspended = 0;
       send = true;
       break;
 
@@ -1034,16 +2036,29 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
       // can accidentally meet the SUSPEND condition ( Bus Idle for 3ms ).
       // In addition, some MCUs such as SAMD or boards that haven no VBUS detection cannot distinguish
       // suspended vs disconnected. We will skip handling SUSPEND/RESUME event if not currently connected
-      if (_usbd_dev.connected) {
-        _usbd_dev.suspended = 1;
+      if (dev->connected) {
+        dev->suspended = 1;
+        dev->lpm_sleep = 0;
         send = true;
       }
       break;
 
+#if CFG_TUD_LPM
+    case DCD_EVENT_LPM_SLEEP:
+      if (dev->connected) {
+        dev->suspended = 1;
+        dev->lpm_sleep = 1;
+        dev->lpm_remote_wakeup = event->lpm_sleep.remote_wakeup;
+        send = true;
+      }
+      break;
+#endif
+
     case DCD_EVENT_RESUME:
       // skip event if not connected (especially required for SAMD)
-      if (_usbd_dev.connected) {
-        _usbd_dev.suspended = 0;
+      if (dev->connected) {
+        dev->suspended = 0;
+        dev->lpm_sleep = 0;
         send = true;
       }
       break;
@@ -1051,18 +2066,29 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
     case DCD_EVENT_SOF:
       // Some MCUs after running dcd_remote_wakeup() does not have way to detect the end of remote wakeup
       // which last 1-15 ms. DCD can use SOF as a clear indicator that bus is back to operational
-      if (_usbd_dev.suspended) {
-        _usbd_dev.suspended = 0;
+      if (dev->suspended) {
+        dev->suspended = 0;
+        dev->lpm_sleep = 0;
 
         dcd_event_t const event_resume = {.rhport = event->rhport, .event_id = DCD_EVENT_RESUME};
         queue_event(&event_resume, in_isr);
       }
 
+#if CFG_TUD_SOF_SCHED
+      // single pass over all periodic registrations
+      for (usbd_sof_sched_t* s = _usbd_sof_sched[usbd_port_id(event->rhport)]; s != NULL; s = s->next) {
+        if (--s->countdown == 0) {
+          s->countdown = s->period;
+          s->cb(event->rhport, event->sof.frame_count, s->arg);
+        }
+      }
+#endif
+
       // SOF driver handler in ISR context
       for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
         usbd_class_driver_t const* driver = get_driver(i);
         if (driver && driver->sof) {
-          driver->sof(event->rhport, event->sof.frame_count);
+          DRIVER_CALL(i, driver, , sof, event->rhport, event->sof.frame_count);
         }
       }
 
@@ -1070,10 +2096,27 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
       break;
 
     case DCD_EVENT_SETUP_RECEIVED:
-      _usbd_dev.setup_count++;
+      dev->setup_count++;
       send = true;
       break;
 
+    case DCD_EVENT_XFER_COMPLETE:
+#if CFG_TUD_EDPT_STATS
+      if (tu_edpt_number(event->xfer_complete.ep_addr) < CFG_TUD_ENDPPOINT_MAX) {
+        tu_edpt_stats_complete(&_usbd_edpt_stats[usbd_port_id(event->rhport)][tu_edpt_number(event->xfer_complete.ep_addr)]
+                                                [tu_edpt_dir(event->xfer_complete.ep_addr)],
+                               event->xfer_complete.result, event->xfer_complete.len);
+      }
+#endif
+#if CFG_TUD_ISO_STREAM
+      if (iso_stream_isr(event)) break;
+#endif
+      // skip usbd task if completion is handled in ISR context by class driver
+      if (!edpt_xfer_isr(event)) {
+        queue_xfer_complete(event, in_isr);
+      }
+      break;
+
     default:
       send = true;
       break;
@@ -1082,6 +2125,13 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
   if (send) {
     queue_event(event, in_isr);
   }
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+  // chain next queued transfer after queuing this completion to keep event order
+  if (event->event_id == DCD_EVENT_XFER_COMPLETE) {
+    edpt_xfer_queue_next(event->rhport, event->xfer_complete.ep_addr, in_isr);
+  }
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -1090,6 +2140,15 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
 
 void usbd_int_set(bool enabled)
 {
+#if CFG_TUD_RHPORT_NUM > 1
+  // event queue is shared by all ports
+  for (uint8_t rhport = 0; rhport < CFG_TUD_RHPORT_NUM; rhport++)
+  {
+    if (!_usbd_port_inited[rhport]) continue;
+    if (enabled) dcd_int_enable(rhport);
+    else         dcd_int_disable(rhport);
+  }
+#else
   if (enabled)
   {
     dcd_int_enable(_usbd_rhport);
@@ -1097,6 +2156,7 @@ void usbd_int_set(bool enabled)
   {
     dcd_int_disable(_usbd_rhport);
   }
+#endif
 }
 
 // Parse consecutive endpoint descriptors (IN & OUT)
@@ -1135,44 +2195,369 @@ void usbd_defer_func(osal_task_func_t func, void* param, bool in_isr) {
   queue_event(&event, in_isr);
 }
 
+#if CFG_TUD_ARENA_SIZE
+void* usbd_arena_alloc(uint8_t rhport, uint32_t size) {
+  uint8_t const port = usbd_port_id(rhport);
+  TU_VERIFY(size <= usbd_arena_remaining(rhport), NULL);
+
+  // round up so that next allocation is also aligned (and does not share a cache line)
+  uint32_t const aligned_size = tu_div_ceil(size, CFG_TUD_ARENA_ALIGN) * CFG_TUD_ARENA_ALIGN;
+  TU_VERIFY(aligned_size <= usbd_arena_remaining(rhport), NULL);
+
+  void* buf = &_usbd_arena[port].buf[_usbd_arena_used[port]];
+  _usbd_arena_used[port] += aligned_size;
+  TU_LOG_USBD("  Arena alloc %u bytes, %u left\r\n", (unsigned int) size, (unsigned int) usbd_arena_remaining(rhport));
+
+  return buf;
+}
+
+uint32_t usbd_arena_remaining(uint8_t rhport) {
+  return CFG_TUD_ARENA_SIZE - _usbd_arena_used[usbd_port_id(rhport)];
+}
+#endif
+
+//--------------------------------------------------------------------+
+// USBD ISO Stream
+//--------------------------------------------------------------------+
+#if CFG_TUD_ISO_STREAM
+bool usbd_edpt_iso_stream_start(uint8_t rhport, uint8_t ep_addr, usbd_iso_stream_t* stream) {
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  TU_ASSERT(epnum && epnum < CFG_TUD_ENDPPOINT_MAX);
+  TU_ASSERT(stream->buffer && stream->length && stream->slot_size);
+  TU_ASSERT(stream->num_slots >= 2 && tu_is_power_of_two(stream->num_slots));
+
+  // endpoint is owned by stream until stopped
+  TU_VERIFY(usbd_edpt_claim(rhport, ep_addr));
+  dev->ep_status[epnum][dir].busy = 1;
+  dev->ep_status[epnum][dir].claimed = 0;
+
+  stream->ep_addr = ep_addr;
+  stream->wr_idx = 0;
+  stream->rd_idx = 0;
+  stream->slot_armed = false;
+  stream->missed = 0;
+
+  TU_LOG_USBD("  ISO stream start EP %02X: %u slots x %u bytes\r\n", ep_addr, stream->num_slots, stream->slot_size);
+
+  // register before arming: completion can fire right away
+  dcd_int_disable(rhport);
+  _usbd_iso_stream[usbd_port_id(rhport)][epnum][dir] = stream;
+  bool const ret = iso_stream_arm(rhport, stream);
+  if (!ret) {
+    _usbd_iso_stream[usbd_port_id(rhport)][epnum][dir] = NULL;
+    dev->ep_status[epnum][dir].busy = 0;
+  }
+  dcd_int_enable(rhport);
+
+  return ret;
+}
+
+void usbd_edpt_iso_stream_stop(uint8_t rhport, uint8_t ep_addr) {
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  TU_VERIFY(epnum && epnum < CFG_TUD_ENDPPOINT_MAX,);
+
+  dcd_int_disable(rhport);
+  _usbd_iso_stream[usbd_port_id(rhport)][epnum][dir] = NULL;
+  dev->ep_status[epnum][dir].busy = 0;
+  dcd_int_enable(rhport);
+}
+
+uint8_t* usbd_iso_stream_write_slot(usbd_iso_stream_t* stream) {
+  if (usbd_iso_stream_count(stream) >= stream->num_slots) return NULL;
+  return iso_stream_slot(stream, stream->wr_idx);
+}
+
+void usbd_iso_stream_commit(usbd_iso_stream_t* stream, uint16_t len) {
+  TU_VERIFY(usbd_iso_stream_count(stream) < stream->num_slots,);
+  stream->length[stream->wr_idx & (stream->num_slots - 1u)] = tu_min16(len, stream->slot_size);
+  stream->wr_idx++; // publish after length is written
+}
+
+uint8_t* usbd_iso_stream_read_slot(usbd_iso_stream_t* stream, uint16_t* len) {
+  if (stream->wr_idx == stream->rd_idx) return NULL;
+  *len = stream->length[stream->rd_idx & (stream->num_slots - 1u)];
+  return iso_stream_slot(stream, stream->rd_idx);
+}
+
+void usbd_iso_stream_release(usbd_iso_stream_t* stream) {
+  TU_VERIFY(stream->wr_idx != stream->rd_idx,);
+  stream->rd_idx++;
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Endpoint API
 //--------------------------------------------------------------------+
 
 bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
-  TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
+  TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) dev->speed));
+
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  _usbd_xfer_fifo_mps[usbd_port_id(rhport)][tu_edpt_number(desc_ep->bEndpointAddress)][tu_edpt_dir(desc_ep->bEndpointAddress)] =
+      (uint16_t) (tu_edpt_packet_size(desc_ep) |
+                  (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS ? XFER_FIFO_MPS_ISO : 0));
+#endif
 
   return dcd_edpt_open(rhport, desc_ep);
 }
 
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr) {
-  (void) rhport;
+  usbd_device_t* dev = get_device(rhport);
 
   // TODO add this check later, also make sure we don't starve an out endpoint while suspending
   // TU_VERIFY(tud_ready());
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
-  tu_edpt_state_t* ep_state = &_usbd_dev.ep_status[epnum][dir];
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
 
   return tu_edpt_claim(ep_state, _usbd_mutex);
 }
 
 bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr) {
-  (void) rhport;
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
-  tu_edpt_state_t* ep_state = &_usbd_dev.ep_status[epnum][dir];
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
 
   return tu_edpt_release(ep_state, _usbd_mutex);
 }
 
+//--------------------------------------------------------------------+
+// Endpoint Transfer Queue
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_XFER_QUEUE
+
+static bool edpt_xfer_enqueue(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+  usbd_device_t* dev = get_device(rhport);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+  usbd_xfer_queue_t* q = &dev->ep_queue[epnum][dir];
+
+  // Attempt to transfer on a stalled endpoint
+  TU_ASSERT(!ep_state->stalled);
+
+  // ISR can chain queued transfer and clear active
+  usbd_int_set(false);
+
+#if TUP_DCD_EDPT_XFER_APPEND
+  // DCD appends to the transfer in progress, nothing is held back in software
+  bool const available = (q->pending <= CFG_TUD_EDPT_XFER_QUEUE);
+  bool const submit = available;
+#else
+  bool const available = (q->count < CFG_TUD_EDPT_XFER_QUEUE);
+  bool const submit = available && !q->active;
+#endif
+
+  if (available) {
+    if (submit) {
+      q->active = 1;
+    } else {
+      uint8_t const idx = (uint8_t) ((q->rd_idx + q->count) % CFG_TUD_EDPT_XFER_QUEUE);
+      q->desc[idx].buffer = buffer;
+      q->desc[idx].total_bytes = total_bytes;
+      q->count++;
+    }
+
+    q->pending++;
+    ep_state->busy = 1;
+  }
+
+  usbd_int_set(true);
+
+  // Attempt to transfer on an endpoint with full queue, sound like an race condition !
+  TU_ASSERT(available);
+
+  if (!submit) {
+    TU_LOG_USBD("    Queued behind %u transfer(s)\r\n", q->count);
+    return true;
+  }
+
+  EDPT_STATS_ARM(rhport, epnum, dir);
+  if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
+    return true;
+  } else {
+    // DCD error, mark endpoint as ready to allow next transfer if nothing else is pending
+    usbd_int_set(false);
+    q->active = 0;
+    q->pending--;
+    if (q->pending == 0) {
+      ep_state->busy = 0;
+      ep_state->claimed = 0;
+    }
+    usbd_int_set(true);
+
+    TU_LOG_USBD("FAILED\r\n");
+    TU_BREAKPOINT();
+    return false;
+  }
+}
+
+// Called by dcd_event_handler() on transfer complete, submit next queued transfer if any
+TU_ATTR_FAST_FUNC static void edpt_xfer_queue_next(uint8_t rhport, uint8_t ep_addr, bool in_isr) {
+  usbd_device_t* dev = get_device(rhport);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum == 0 || epnum >= CFG_TUD_ENDPPOINT_MAX) return;
+
+  usbd_xfer_queue_t* q = &dev->ep_queue[epnum][tu_edpt_dir(ep_addr)];
+  q->active = 0;
+
+  while (q->count) {
+    uint8_t* buffer = q->desc[q->rd_idx].buffer;
+    uint16_t const total_bytes = q->desc[q->rd_idx].total_bytes;
+
+    q->rd_idx = (uint8_t) ((q->rd_idx + 1) % CFG_TUD_EDPT_XFER_QUEUE);
+    q->count--;
+
+    EDPT_STATS_ARM(rhport, epnum, tu_edpt_dir(ep_addr));
+    if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
+      q->active = 1;
+      break;
+    }
+
+    // DCD error, report as failed so that class driver still get a callback for each transfer
+    dcd_event_t const event_failed = {
+        .rhport = rhport,
+        .event_id = DCD_EVENT_XFER_COMPLETE,
+        .xfer_complete = {
+            .ep_addr = ep_addr,
+            .result = XFER_RESULT_FAILED,
+            .len = 0
+        }
+    };
+    queue_xfer_complete(&event_failed, in_isr);
+  }
+}
+
+// Called by usbd task when processing transfer complete, return true if no more transfer is pending
+static bool edpt_xfer_queue_done(uint8_t rhport, uint8_t epnum, uint8_t dir, uint8_t count) {
+  usbd_device_t* dev = get_device(rhport);
+  usbd_xfer_queue_t* q = &dev->ep_queue[epnum][dir];
+
+  usbd_int_set(false);
+  q->pending = (q->pending > count) ? (uint8_t) (q->pending - count) : 0;
+  bool const done = (q->pending == 0);
+  usbd_int_set(true);
+
+  return done;
+}
+
+// Drop all queued transfers e.g when endpoint is stalled or closed
+static void edpt_xfer_queue_reset(uint8_t rhport, uint8_t epnum, uint8_t dir) {
+  usbd_device_t* dev = get_device(rhport);
+  usbd_int_set(false);
+  tu_varclr(&dev->ep_queue[epnum][dir]);
+  usbd_int_set(true);
+}
+
+#endif
+
+//--------------------------------------------------------------------+
+// Transfer Complete Coalescing
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_XFER_COALESCE
+
+// Merge completion into the event of the same endpoint still waiting in usbd queue, or queue it
+TU_ATTR_FAST_FUNC static void queue_xfer_complete(dcd_event_t const* event, bool in_isr) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+
+  if (epnum && epnum < CFG_TUD_ENDPPOINT_MAX) {
+    usbd_xfer_coalesce_t* c = &get_device(event->rhport)->ep_coalesce[epnum][tu_edpt_dir(ep_addr)];
+
+    if (c->enabled) {
+      if (c->queued && c->extra_count < UINT8_MAX) {
+        c->extra_count++;
+        c->extra_len += event->xfer_complete.len;
+        if (event->xfer_complete.result != XFER_RESULT_SUCCESS && c->extra_result == XFER_RESULT_SUCCESS) {
+          c->extra_result = event->xfer_complete.result;
+        }
+        return;
+      }
+
+      c->extra_count = 0;
+      c->extra_len = 0;
+      c->extra_result = XFER_RESULT_SUCCESS;
+      c->queued = queue_event(event, in_isr) ? 1 : 0;
+      return;
+    }
+  }
+
+  queue_event(event, in_isr);
+}
+
+// Called by usbd task, add merged completions to the event and return number of merged completions
+static uint8_t edpt_xfer_coalesce_take(dcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum == 0 || epnum >= CFG_TUD_ENDPPOINT_MAX) return 0;
+
+  usbd_xfer_coalesce_t* c = &get_device(event->rhport)->ep_coalesce[epnum][tu_edpt_dir(ep_addr)];
+  uint8_t count = 0;
+
+  usbd_int_set(false);
+  if (c->queued) {
+    count = c->extra_count;
+    event->xfer_complete.len += c->extra_len;
+    if (event->xfer_complete.result == XFER_RESULT_SUCCESS) event->xfer_complete.result = c->extra_result;
+    c->queued = 0;
+  }
+  usbd_int_set(true);
+
+  return count;
+}
+
+#endif
+
+void usbd_edpt_xfer_coalesce(uint8_t rhport, uint8_t ep_addr, bool en) {
+#if CFG_TUD_EDPT_XFER_COALESCE
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum && epnum < CFG_TUD_ENDPPOINT_MAX,);
+
+  get_device(rhport)->ep_coalesce[epnum][tu_edpt_dir(ep_addr)].enabled = en ? 1 : 0;
+#else
+  (void) rhport;
+  (void) ep_addr;
+  (void) en;
+#endif
+}
+
+bool usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr) {
+#if CFG_TUD_EDPT_XFER_QUEUE
+  usbd_device_t const* dev = get_device(rhport);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+#if TUP_DCD_EDPT_XFER_APPEND
+  uint8_t const queued = dev->ep_queue[epnum][dir].pending;
+  return epnum && !dev->ep_status[epnum][dir].stalled && (queued <= CFG_TUD_EDPT_XFER_QUEUE);
+#else
+  return epnum && !dev->ep_status[epnum][dir].stalled &&
+         (dev->ep_queue[epnum][dir].count < CFG_TUD_EDPT_XFER_QUEUE);
+#endif
+#else
+  (void) rhport;
+  (void) ep_addr;
+  return false;
+#endif
+}
+
 bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
@@ -1181,20 +2566,34 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
   // TU_VERIFY(tud_ready());
 
   TU_LOG_USBD("  Queue EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
+  TU_TRACE(TU_TRACE_EDPT_XFER, ep_addr, total_bytes);
+  TU_CAPTURE(TU_CAPTURE_SUBMIT, rhport, 0, ep_addr, total_bytes, XFER_RESULT_SUCCESS,
+             (dir == TUSB_DIR_IN) ? buffer : NULL, total_bytes);
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+  if (epnum != 0) {
+    return edpt_xfer_enqueue(rhport, ep_addr, buffer, total_bytes);
+  }
+#endif
+
+#if CFG_TUSB_CAPTURE && CFG_TUSB_CAPTURE_PAYLOAD
+  if (dir == TUSB_DIR_OUT) _usbd_capture_buf[usbd_port_id(rhport)][epnum] = buffer;
+#endif
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
-  TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
+  TU_ASSERT(dev->ep_status[epnum][dir].busy == 0);
 
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer()
   // could return and USBD task can preempt and clear the busy
-  _usbd_dev.ep_status[epnum][dir].busy = 1;
+  dev->ep_status[epnum][dir].busy = 1;
 
+  EDPT_STATS_ARM(rhport, epnum, dir);
   if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
     return true;
   } else {
     // DCD error, mark endpoint as ready to allow next transfer
-    _usbd_dev.ep_status[epnum][dir].busy = 0;
-    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+    dev->ep_status[epnum][dir].busy = 0;
+    dev->ep_status[epnum][dir].claimed = 0;
     TU_LOG_USBD("FAILED\r\n");
     TU_BREAKPOINT();
     return false;
@@ -1206,27 +2605,37 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
 // success message. If total_bytes is too big, the FIFO will copy only what is available
 // into the USB buffer!
 bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   TU_LOG_USBD("  Queue ISO EP %02X with %u bytes ... ", ep_addr, total_bytes);
+  TU_CAPTURE(TU_CAPTURE_SUBMIT, rhport, 0, ep_addr, total_bytes, XFER_RESULT_SUCCESS, NULL, 0);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
-  TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
+  TU_ASSERT(dev->ep_status[epnum][dir].busy == 0);
 
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer() could return
   // and usbd task can preempt and clear the busy
-  _usbd_dev.ep_status[epnum][dir].busy = 1;
+  dev->ep_status[epnum][dir].busy = 1;
 
-  if (dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes)) {
+  EDPT_STATS_ARM(rhport, epnum, dir);
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  // port may also decline a fifo transfer it can not do natively e.g unaligned span with dwc2 DMA
+  bool const ok = (dcd_edpt_xfer_fifo && dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes)) ||
+                  xfer_fifo_start(rhport, ep_addr, ff, total_bytes);
+#else
+  bool const ok = dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes);
+#endif
+  if (ok) {
     TU_LOG_USBD("OK\r\n");
     return true;
   } else {
     // DCD error, mark endpoint as ready to allow next transfer
-    _usbd_dev.ep_status[epnum][dir].busy = 0;
-    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+    dev->ep_status[epnum][dir].busy = 0;
+    dev->ep_status[epnum][dir].claimed = 0;
     TU_LOG_USBD("failed\r\n");
     TU_BREAKPOINT();
     return false;
@@ -1234,59 +2643,118 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_
 }
 
 bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr) {
-  (void) rhport;
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
-  return _usbd_dev.ep_status[epnum][dir].busy;
+  return dev->ep_status[epnum][dir].busy;
 }
 
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   // only stalled if currently cleared
-  if (!_usbd_dev.ep_status[epnum][dir].stalled) {
+  if (!dev->ep_status[epnum][dir].stalled) {
     TU_LOG_USBD("    Stall EP %02X\r\n", ep_addr);
     dcd_edpt_stall(rhport, ep_addr);
-    _usbd_dev.ep_status[epnum][dir].stalled = 1;
-    _usbd_dev.ep_status[epnum][dir].busy = 1;
+    edpt_xfer_queue_reset(rhport, epnum, dir);
+#if CFG_TUD_EDPT_STATS
+    _usbd_edpt_stats[usbd_port_id(rhport)][epnum][dir].stats.stall_count++;
+#endif
+    dev->ep_status[epnum][dir].stalled = 1;
+    dev->ep_status[epnum][dir].busy = 1;
   }
 }
 
 void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   // only clear if currently stalled
-  if (_usbd_dev.ep_status[epnum][dir].stalled) {
+  if (dev->ep_status[epnum][dir].stalled) {
     TU_LOG_USBD("    Clear Stall EP %02X\r\n", ep_addr);
     dcd_edpt_clear_stall(rhport, ep_addr);
-    _usbd_dev.ep_status[epnum][dir].stalled = 0;
-    _usbd_dev.ep_status[epnum][dir].busy = 0;
+    dev->ep_status[epnum][dir].stalled = 0;
+    dev->ep_status[epnum][dir].busy = 0;
   }
 }
 
 bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr) {
-  (void) rhport;
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
-  return _usbd_dev.ep_status[epnum][dir].stalled;
+  return dev->ep_status[epnum][dir].stalled;
+}
+
+#if CFG_TUD_EDPT_STATS
+static bool edpt_stats_get(uint8_t rhport, uint8_t ep_addr, tusb_edpt_stats_t* stats) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum < CFG_TUD_ENDPPOINT_MAX && stats);
+
+  // snapshot consistent with completion updated in ISR
+  usbd_int_set(false);
+  *stats = _usbd_edpt_stats[usbd_port_id(rhport)][epnum][tu_edpt_dir(ep_addr)].stats;
+  usbd_int_set(true);
+
+  return true;
 }
 
+bool tud_edpt_stats_get(uint8_t ep_addr, tusb_edpt_stats_t* stats) {
+  return edpt_stats_get(_usbd_rhport, ep_addr, stats);
+}
+
+void tud_edpt_stats_clear(void) {
+  usbd_int_set(false);
+  tu_varclr(&_usbd_edpt_stats);
+  usbd_int_set(true);
+}
+#endif
+
+#if CFG_TUD_EVENT_TIMESTAMP
+uint32_t tud_event_timestamp(void) {
+  return _usbd_event_timestamp;
+}
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS
+bool tud_event_queue_stats(tusb_event_queue_stats_t* stats) {
+  TU_VERIFY(stats);
+
+  // snapshot consistent with counters updated in ISR
+  usbd_int_set(false);
+  *stats = _usbd_q_stats;
+  usbd_int_set(true);
+
+  stats->queue_size = CFG_TUD_TASK_QUEUE_SZ;
+  stats->hi_queue_size = CFG_TUD_TASK_QUEUE_HI_SZ;
+
+  return true;
+}
+
+void tud_event_queue_stats_clear(void) {
+  usbd_int_set(false);
+  tu_varclr(&_usbd_q_stats);
+  usbd_int_set(true);
+}
+#endif
+
 /**
  * usbd_edpt_close will disable an endpoint.
  * In progress transfers on this EP may be delivered after this call.
  */
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   TU_ASSERT(dcd_edpt_close, /**/);
   TU_LOG_USBD("  CLOSING Endpoint: 0x%02X\r\n", ep_addr);
@@ -1295,23 +2763,82 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   dcd_edpt_close(rhport, ep_addr);
-  _usbd_dev.ep_status[epnum][dir].stalled = 0;
-  _usbd_dev.ep_status[epnum][dir].busy = 0;
-  _usbd_dev.ep_status[epnum][dir].claimed = 0;
+  edpt_xfer_queue_reset(rhport, epnum, dir);
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  usbd_xfer_fifo_t* x = xfer_fifo_find(rhport, ep_addr);
+  if (x) x->ep_addr = 0;
+#endif
+  dev->ep_status[epnum][dir].stalled = 0;
+  dev->ep_status[epnum][dir].busy = 0;
+  dev->ep_status[epnum][dir].claimed = 0;
 
   return;
 }
 
 void usbd_sof_enable(uint8_t rhport, bool en) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  uint8_t const port = usbd_port_id(rhport);
 
   // TODO: Check needed if all drivers including the user sof_cb does not need an active SOF ISR any more.
   // Only if all drivers switched off SOF calls the SOF interrupt may be disabled
+#if CFG_TUD_SOF_SCHED
+  _usbd_sof_legacy[port] = en;
+  en = en || (_usbd_sof_sched[port] != NULL); // scheduler keeps SOF running
+#endif
+  _usbd_sof_enabled[port] = en;
   dcd_sof_enable(rhport, en);
 }
 
+#if CFG_TUD_SOF_SCHED
+bool usbd_sof_sched_add(uint8_t rhport, usbd_sof_sched_t* sched, uint16_t period, usbd_sof_sched_cb_t cb, void* arg) {
+  rhport = resolve_rhport(rhport);
+  uint8_t const port = usbd_port_id(rhport);
+  TU_ASSERT(sched && cb && period);
+
+  sched->cb = cb;
+  sched->arg = arg;
+  sched->period = period;
+  sched->countdown = period;
+
+  dcd_int_disable(rhport);
+  bool const first = (_usbd_sof_sched[port] == NULL);
+  usbd_sof_sched_t* s = _usbd_sof_sched[port];
+  while (s && s != sched) s = s->next;
+  if (s == NULL) {
+    // not yet registered
+    sched->next = _usbd_sof_sched[port];
+    _usbd_sof_sched[port] = sched;
+  }
+  dcd_int_enable(rhport);
+
+  if (first && !_usbd_sof_enabled[port]) {
+    _usbd_sof_enabled[port] = true;
+    dcd_sof_enable(rhport, true);
+  }
+
+  return true;
+}
+
+void usbd_sof_sched_remove(uint8_t rhport, usbd_sof_sched_t* sched) {
+  rhport = resolve_rhport(rhport);
+  uint8_t const port = usbd_port_id(rhport);
+
+  dcd_int_disable(rhport);
+  usbd_sof_sched_t* volatile* pp = &_usbd_sof_sched[port];
+  while (*pp && *pp != sched) pp = &(*pp)->next;
+  if (*pp) *pp = sched->next;
+  bool const empty = (_usbd_sof_sched[port] == NULL);
+  dcd_int_enable(rhport);
+
+  if (empty && !_usbd_sof_legacy[port] && _usbd_sof_enabled[port]) {
+    _usbd_sof_enabled[port] = false;
+    dcd_sof_enable(rhport, false);
+  }
+}
+#endif
+
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
 
   TU_ASSERT(dcd_edpt_iso_alloc);
   TU_ASSERT(tu_edpt_number(ep_addr) < CFG_TUD_ENDPPOINT_MAX);
@@ -1320,18 +2847,23 @@ bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packe
 }
 
 bool usbd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
-  rhport = _usbd_rhport;
+  rhport = resolve_rhport(rhport);
+  usbd_device_t* dev = get_device(rhport);
 
   uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
   uint8_t const dir = tu_edpt_dir(desc_ep->bEndpointAddress);
 
   TU_ASSERT(dcd_edpt_iso_activate);
   TU_ASSERT(epnum < CFG_TUD_ENDPPOINT_MAX);
-  TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
-
-  _usbd_dev.ep_status[epnum][dir].stalled = 0;
-  _usbd_dev.ep_status[epnum][dir].busy = 0;
-  _usbd_dev.ep_status[epnum][dir].claimed = 0;
+  TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) dev->speed));
+
+  edpt_xfer_queue_reset(rhport, epnum, dir);
+  dev->ep_status[epnum][dir].stalled = 0;
+  dev->ep_status[epnum][dir].busy = 0;
+  dev->ep_status[epnum][dir].claimed = 0;
+#if CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  _usbd_xfer_fifo_mps[usbd_port_id(rhport)][epnum][dir] = (uint16_t) (tu_edpt_packet_size(desc_ep) | XFER_FIFO_MPS_ISO);
+#endif
   return dcd_edpt_iso_activate(rhport, desc_ep);
 }
 
@@ -43,6 +43,12 @@ bool tud_init (uint8_t rhport);
 // Check if device stack is already initialized
 bool tud_inited(void);
 
+// Check if device stack is initialized on rhport
+bool tud_n_inited(uint8_t rhport);
+
+// Port of the event processed by tud_task(), e.g to tell ports apart in descriptor and mount callbacks
+uint8_t tud_current_rhport(void);
+
 // Task function should be called in main/rtos loop, extended version of tud_task()
 // - timeout_ms: millisecond to wait, zero = no wait, 0xFFFFFFFF = wait forever
 // - in_isr: if function is called in ISR
@@ -57,12 +63,30 @@ void tud_task (void) {
 // Check if there is pending events need processing by tud_task()
 bool tud_task_event_ready(void);
 
+// Milliseconds application can sleep (WFI loop, RTOS tickless idle or tud_task_ext() timeout) before the
+// stack needs attention. New events wake up the application with tud_event_hook_cb().
+// - 0: events are pending, tud_task() should run now
+// - 1: class drivers do per-frame work on SOF interrupt, next one is due within a frame
+// - UINT32_MAX: stack only needs to run on USB interrupt
+uint32_t tud_task_next_deadline_ms(void);
+
 #ifndef _TUSB_DCD_H_
 extern void dcd_int_handler(uint8_t rhport);
 #endif
 
 // Interrupt handler, name alias to DCD
-#define tud_int_handler   dcd_int_handler
+#if CFG_TUSB_TRACE || CFG_TUSB_PROF
+  #define tud_int_handler(_rhport)                \
+    do {                                          \
+      TU_TRACE(TU_TRACE_ISR_ENTER, _rhport, 0);   \
+      TU_PROF_BEGIN(TU_PROF_ISR);                 \
+      dcd_int_handler(_rhport);                   \
+      TU_PROF_END(_rhport, TU_PROF_ISR);          \
+      TU_TRACE(TU_TRACE_ISR_EXIT, _rhport, 0);    \
+    } while (0)
+#else
+  #define tud_int_handler   dcd_int_handler
+#endif
 
 // Get current bus speed
 tusb_speed_t tud_speed_get(void);
@@ -94,14 +118,61 @@ bool tud_disconnect(void);
 // Return false on unsupported MCUs
 bool tud_connect(void);
 
+// Same as above for a specific port, API without rhport works on the first initialized port
+tusb_speed_t tud_n_speed_get(uint8_t rhport);
+bool tud_n_connected(uint8_t rhport);
+bool tud_n_mounted(uint8_t rhport);
+bool tud_n_suspended(uint8_t rhport);
+bool tud_n_remote_wakeup(uint8_t rhport);
+bool tud_n_disconnect(uint8_t rhport);
+bool tud_n_connect(uint8_t rhport);
+
+TU_ATTR_ALWAYS_INLINE static inline
+bool tud_n_ready(uint8_t rhport) {
+  return tud_n_mounted(rhport) && !tud_n_suspended(rhport);
+}
+
 // Carry out Data and Status stage of control transfer
 // - If len = 0, it is equivalent to sending status only
 // - If len > wLength : it will be truncated
 bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len);
 
+// Same as tud_control_xfer() but buffer is handed to the DCD without copying to the internal EP0 buffer.
+// Buffer must be reachable by USB DMA (e.g TUD_EPBUF_DEF) and stay valid until the status stage.
+// With CFG_TUD_CONTROL_MULTI_PACKET the whole data stage is a single transfer.
+bool tud_control_xfer_direct(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len);
+
 // Send STATUS (zero length) packet
 bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request);
 
+// Drop configuration index cached by CFG_TUD_CONFIG_CACHE. Must be called if application modifies
+// a configuration descriptor in place (same address and wTotalLength) with different interfaces.
+void tud_config_cache_clear(void);
+
+#if CFG_TUD_EDPT_STATS
+// Get runtime statistics of an endpoint, accumulated since tud_init() or tud_edpt_stats_clear()
+bool tud_edpt_stats_get(uint8_t ep_addr, tusb_edpt_stats_t* stats);
+
+// Clear statistics of all endpoints
+void tud_edpt_stats_clear(void);
+#endif
+
+#if CFG_TUD_TASK_QUEUE_STATS
+// Get event queue statistics, accumulated since tud_init() or tud_event_queue_stats_clear(). Non-zero overflow
+// means CFG_TUD_TASK_QUEUE_SZ is too small: dropped transfer completions leave endpoints busy forever unless
+// CFG_TUD_TASK_XFER_RESCUE is enabled.
+bool tud_event_queue_stats(tusb_event_queue_stats_t* stats);
+
+// Clear event queue statistics
+void tud_event_queue_stats_clear(void);
+#endif
+
+#if CFG_TUD_EVENT_TIMESTAMP
+// Timestamp (CFG_TUSB_EVENT_TIMESTAMP) of the event being dispatched by tud_task(), i.e when the controller
+// reported it. Valid in callbacks invoked from tud_task() e.g class driver xfer_cb() or tud_xxx_rx_cb()
+uint32_t tud_event_timestamp(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -143,12 +214,28 @@ TU_ATTR_WEAK void tud_umount_cb(void);
 // Within 7ms, device must draw an average of current less than 2.5 mA from bus
 TU_ATTR_WEAK void tud_suspend_cb(bool remote_wakeup_en);
 
-// Invoked when usb bus is resumed
+// Invoked when usb bus is resumed, from either suspend or LPM sleep
 TU_ATTR_WEAK void tud_resume_cb(void);
 
+#if CFG_TUD_LPM
+// Invoked when host puts link into LPM L1 sleep (CFG_TUD_LPM). Unlike suspend, resume is signaled within
+// tens of microseconds: device may gate clocks but must be able to resume within the requested BESL.
+TU_ATTR_WEAK void tud_lpm_sleep_cb(uint8_t besl, bool remote_wakeup_en);
+
+// Convert BESL to microseconds (USB 2.0 LPM ECN table X-X1)
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tud_lpm_besl_us(uint8_t besl) {
+  static const uint16_t besl_us[16] = { 125, 150, 200, 300, 400, 500, 1000, 2000,
+                                        3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000 };
+  return besl_us[besl & 0x0F];
+}
+#endif
+
 // Invoked when there is a new usb event, which need to be processed by tud_task()/tud_task_ext()
 void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 
+// Invoked to get a free running timestamp in microseconds for tud_task_ext() time budget (CFG_TUD_TASK_TIME_BUDGET_US)
+TU_ATTR_WEAK uint32_t tud_task_time_us_cb(void);
+
 // Invoked when received control request with VENDOR TYPE
 TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 
@@ -166,6 +253,14 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
 #define TUD_BOS_PLATFORM_DESCRIPTOR(...) \
   4+TU_ARGS_NUM(__VA_ARGS__), TUSB_DESC_DEVICE_CAPABILITY, DEVICE_CAPABILITY_PLATFORM, 0x00, __VA_ARGS__
 
+//------------- USB 2.0 Extension -------------//
+#define TUD_BOS_USB20_EXT_DESC_LEN      7
+
+// Declare LPM with BESL support, baseline and deep BESL (0-15) are the resume latency device prefers
+#define TUD_BOS_USB20_EXT_LPM_DESCRIPTOR(_baseline_besl, _deep_besl) \
+  TUD_BOS_USB20_EXT_DESC_LEN, TUSB_DESC_DEVICE_CAPABILITY, DEVICE_CAPABILITY_USB20_EXTENSION, \
+  U32_TO_U8S_LE(TU_BIT(1) | TU_BIT(2) | TU_BIT(3) | TU_BIT(4) | (((_baseline_besl) & 0x0Fu) << 8) | (((_deep_besl) & 0x0Fu) << 12))
+
 //------------- WebUSB BOS Platform -------------//
 
 // Descriptor Length
@@ -247,6 +342,26 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
 
+// Length of template descriptor: 53 bytes
+#define TUD_MSC_UAS_DESC_LEN    (9 + 4*(7 + 4))
+
+// Interface number, string index, EP Command Out, Status In, Data In & Data Out address, EP size
+#define TUD_MSC_UAS_DESCRIPTOR(_itfnum, _stridx, _epcmd, _epstatus, _epdatain, _epdataout, _epsize) \
+  /* Interface */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 4, TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI, MSC_PROTOCOL_UAS, _stridx,\
+  /* Command pipe */\
+  7, TUSB_DESC_ENDPOINT, _epcmd, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_COMMAND, 0,\
+  /* Status pipe */\
+  7, TUSB_DESC_ENDPOINT, _epstatus, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_STATUS, 0,\
+  /* Data-In pipe */\
+  7, TUSB_DESC_ENDPOINT, _epdatain, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_DATA_IN, 0,\
+  /* Data-Out pipe */\
+  7, TUSB_DESC_ENDPOINT, _epdataout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_DATA_OUT, 0
+
 
 //--------------------------------------------------------------------+
 // HID Descriptor Templates
@@ -265,6 +380,12 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
 
+// Polling interval in microseconds to bInterval of high speed interrupt endpoint (2^(bInterval-1) microframes),
+// e.g TUD_HID_HS_INTERVAL(125) = 1 for 8 kHz polling. Interval is rounded up, up to 16 ms
+#define TUD_HID_HS_INTERVAL(_us) \
+  ((_us) <= 125 ? 1 : (_us) <= 250 ? 2 : (_us) <= 500 ? 3 : (_us) <= 1000 ? 4 : \
+   (_us) <= 2000 ? 5 : (_us) <= 4000 ? 6 : (_us) <= 8000 ? 7 : 8)
+
 // Length of template descriptor: 32 bytes
 #define TUD_HID_INOUT_DESC_LEN    (9 + 9 + 7 + 7)
 
@@ -342,6 +463,42 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   TUD_MIDI_DESC_EP(_epin, _epsize, 1),\
   TUD_MIDI_JACKID_OUT_EMB(1)
 
+// MIDI 2.0: alternate setting 1 of MIDI Streaming interface carrying Universal MIDI Packets,
+// endpoints are shared with alternate setting 0 and associated with Group Terminal Block 1.
+// Group Terminal Blocks are provided by tud_midi2_descriptor_group_terminal_block_cb()
+#define TUD_MIDI2_DESC_ALT_LEN (9 + 7 + 2 * (7 + 5))
+#define TUD_MIDI2_DESC_ALT(_itfnum, _epout, _epin, _epsize) \
+  /* MIDI Streaming (MS) Interface, alternate 1 */\
+  9, TUSB_DESC_INTERFACE, (uint8_t)((_itfnum) + 1), 1, 2, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_MIDI_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,\
+  /* MS Header 2.0 */\
+  7, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_HEADER, U16_TO_U8S_LE(MIDI_BCD_MSC_2_0), U16_TO_U8S_LE(7),\
+  /* Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  /* MS Endpoint 2.0 */\
+  5, TUSB_DESC_CS_ENDPOINT, MIDI_CS_ENDPOINT_GENERAL_2_0, 1, 1,\
+  /* Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  /* MS Endpoint 2.0 */\
+  5, TUSB_DESC_CS_ENDPOINT, MIDI_CS_ENDPOINT_GENERAL_2_0, 1, 1
+
+// Length of template descriptor: MIDI 1.0 descriptor + 40 bytes
+#define TUD_MIDI2_DESC_LEN (TUD_MIDI_DESC_LEN + TUD_MIDI2_DESC_ALT_LEN)
+
+// MIDI 2.0 descriptor: MIDI 1.0 simple descriptor as alternate 0 and UMP as alternate 1
+#define TUD_MIDI2_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  TUD_MIDI_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize),\
+  TUD_MIDI2_DESC_ALT(_itfnum, _epout, _epin, _epsize)
+
+// Group Terminal Block descriptors, returned by tud_midi2_descriptor_group_terminal_block_cb()
+#define TUD_MIDI2_GTB_HEADER_LEN  5
+#define TUD_MIDI2_GTB_LEN         13
+#define TUD_MIDI2_GTB_HEADER(_numblocks) \
+  TUD_MIDI2_GTB_HEADER_LEN, MIDI_DESC_TYPE_GR_TRM_BLOCK, MIDI_GR_TRM_BLOCK_HEADER, U16_TO_U8S_LE(TUD_MIDI2_GTB_HEADER_LEN + (_numblocks) * TUD_MIDI2_GTB_LEN)
+
+// Block ID, type (midi_gr_trm_block_type_t), first group, number of groups, string index, protocol (midi_gr_trm_protocol_t)
+#define TUD_MIDI2_GTB(_id, _type, _group, _numgroups, _stridx, _protocol) \
+  TUD_MIDI2_GTB_LEN, MIDI_DESC_TYPE_GR_TRM_BLOCK, MIDI_GR_TRM_BLOCK, _id, _type, _group, _numgroups, _stridx, _protocol, U16_TO_U8S_LE(0), U16_TO_U8S_LE(0)
+
 //--------------------------------------------------------------------+
 // Audio v2.0 Descriptor Templates
 //--------------------------------------------------------------------+
@@ -409,9 +566,18 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   TUD_AUDIO_DESC_TYPE_I_FORMAT_LEN, TUSB_DESC_CS_INTERFACE, AUDIO_CS_AS_INTERFACE_FORMAT_TYPE, AUDIO_FORMAT_TYPE_I, _subslotsize, _bitresolution
 
 /* Standard AS Isochronous Audio Data Endpoint Descriptor(4.10.1.1) */
+/* _maxEPsize is in bytes per (micro)frame: above 1024 (highspeed only, up to 3072) it is split into 2 or 3
+   transactions per micro-frame of a high-bandwidth endpoint */
 #define TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN 7
 #define TUD_AUDIO_DESC_STD_AS_ISO_EP(_ep, _attr, _maxEPsize, _interval) \
-  TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN, TUSB_DESC_ENDPOINT, _ep, _attr, U16_TO_U8S_LE(_maxEPsize), _interval
+  TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN, TUSB_DESC_ENDPOINT, _ep, _attr, U16_TO_U8S_LE(TUD_AUDIO_EP_WMAXPACKETSIZE(_maxEPsize)), _interval
+
+// Transactions per micro-frame needed for _size bytes
+#define TUD_AUDIO_EP_MULT(_size)  ((_size) > 1024 ? ((_size) + 1023) / 1024 : 1)
+
+// wMaxPacketSize of isochronous endpoint carrying _size bytes per (micro)frame, same as _size up to 1024
+#define TUD_AUDIO_EP_WMAXPACKETSIZE(_size) \
+  ((((_size) + TUD_AUDIO_EP_MULT(_size) - 1) / TUD_AUDIO_EP_MULT(_size)) | ((TUD_AUDIO_EP_MULT(_size) - 1) << 11))
 
 /* Class-Specific AS Isochronous Audio Data Endpoint Descriptor(4.10.1.2) */
 #define TUD_AUDIO_DESC_CS_AS_ISO_EP_LEN 8
@@ -572,6 +738,7 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   TUD_AUDIO_DESC_STD_AS_ISO_FB_EP(/*_ep*/ _epfb, /*_interval*/ 1)\
 
 //   Calculate wMaxPacketSize of Endpoints
+//   in bytes per (micro)frame, on highspeed more than 1024 needs a high-bandwidth endpoint
 #define TUD_AUDIO_EP_SIZE(_maxFrequency, _nBytesPerSample, _nChannels) \
     ((((_maxFrequency + (TUD_OPT_HIGH_SPEED ? 7999 : 999)) / (TUD_OPT_HIGH_SPEED ? 8000 : 1000)) + 1) * _nBytesPerSample * _nChannels)
 
@@ -698,6 +865,14 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
 // Length of template descriptor: 71 bytes
 #define TUD_CDC_ECM_DESC_LEN  (8+9+5+5+13+7+9+9+7+7)
 
+// wNumberMCFilters of Ethernet Networking Functional Descriptor: imperfect (hash) filtering with
+// CFG_TUD_NET_MC_FILTER_MAX addresses when packet filter is supported by ECM/NCM driver
+#if CFG_TUD_NET_PACKET_FILTER
+  #define TUD_CDC_ETH_MC_FILTERS  (0x8000 | CFG_TUD_NET_MC_FILTER_MAX)
+#else
+  #define TUD_CDC_ETH_MC_FILTERS  0
+#endif
+
 // CDC-ECM Descriptor Template
 // Interface number, description string index, MAC address string index, EP notification address and size, EP data address (out, in), and size, max segment size.
 #define TUD_CDC_ECM_DESCRIPTOR(_itfnum, _desc_stridx, _mac_stridx, _ep_notif, _ep_notif_size, _epout, _epin, _epsize, _maxsegmentsize) \
@@ -710,7 +885,7 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* CDC-ECM Union */\
   5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_UNION, _itfnum, (uint8_t)((_itfnum) + 1),\
   /* CDC-ECM Functional Descriptor */\
-  13, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_ETHERNET_NETWORKING, _mac_stridx, 0, 0, 0, 0, U16_TO_U8S_LE(_maxsegmentsize), U16_TO_U8S_LE(0), 0,\
+  13, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_ETHERNET_NETWORKING, _mac_stridx, 0, 0, 0, 0, U16_TO_U8S_LE(_maxsegmentsize), U16_TO_U8S_LE(TUD_CDC_ETH_MC_FILTERS), 0,\
   /* Endpoint Notification */\
   7, TUSB_DESC_ENDPOINT, _ep_notif, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_ep_notif_size), 1,\
   /* CDC Data Interface (default inactive) */\
@@ -829,6 +1004,9 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
 // Length of template descriptor
 #define TUD_CDC_NCM_DESC_LEN  (8+9+5+5+13+6+7+9+9+7+7)
 
+// bmNetworkCapabilities of NCM Functional Descriptor, D0: SetEthernetPacketFilter
+#define TUD_CDC_NCM_CAPABILITIES  (CFG_TUD_NET_PACKET_FILTER ? 0x01 : 0x00)
+
 // CDC-ECM Descriptor Template
 // Interface number, description string index, MAC address string index, EP notification address and size, EP data address (out, in), and size, max segment size.
 #define TUD_CDC_NCM_DESCRIPTOR(_itfnum, _desc_stridx, _mac_stridx, _ep_notif, _ep_notif_size, _epout, _epin, _epsize, _maxsegmentsize) \
@@ -841,9 +1019,9 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* CDC-NCM Union */\
   5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_UNION, _itfnum, (uint8_t)((_itfnum) + 1),\
   /* CDC-NCM Functional Descriptor */\
-  13, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_ETHERNET_NETWORKING, _mac_stridx, 0, 0, 0, 0, U16_TO_U8S_LE(_maxsegmentsize), U16_TO_U8S_LE(0), 0, \
+  13, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_ETHERNET_NETWORKING, _mac_stridx, 0, 0, 0, 0, U16_TO_U8S_LE(_maxsegmentsize), U16_TO_U8S_LE(TUD_CDC_ETH_MC_FILTERS), 0, \
   /* CDC-NCM Functional Descriptor */\
-  6, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_NCM, U16_TO_U8S_LE(0x0100), 0, \
+  6, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_NCM, U16_TO_U8S_LE(0x0100), TUD_CDC_NCM_CAPABILITIES, \
   /* Endpoint Notification */\
   7, TUSB_DESC_ENDPOINT, _ep_notif, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_ep_notif_size), 50,\
   /* CDC Data Interface (default inactive) */\
@@ -44,10 +44,6 @@ TU_ATTR_WEAK void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
-#if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
-extern void usbd_driver_print_control_complete_name(usbd_control_xfer_cb_t callback);
-#endif
-
 enum {
   EDPT_CTRL_OUT = 0x00,
   EDPT_CTRL_IN = 0x80
@@ -58,13 +54,18 @@ typedef struct {
   uint8_t* buffer;
   uint16_t data_len;
   uint16_t total_xferred;
+  uint16_t xact_len;   // length of the data stage transaction in progress
+  bool direct;         // buffer is owned by caller and used directly by DCD
   usbd_control_xfer_cb_t complete_cb;
 } usbd_control_xfer_t;
 
-tu_static usbd_control_xfer_t _ctrl_xfer;
+tu_static usbd_control_xfer_t _ctrl_xfer[CFG_TUD_RHPORT_NUM];
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN
-tu_static uint8_t _usbd_ctrl_buf[CFG_TUD_ENDPOINT0_SIZE];
+typedef struct {
+  TUD_EPBUF_DEF(buf, CFG_TUD_ENDPOINT0_SIZE);
+} usbd_ctrl_epbuf_t;
+
+CFG_TUD_MEM_SECTION tu_static usbd_ctrl_epbuf_t _ctrl_epbuf[CFG_TUD_RHPORT_NUM];
 
 //--------------------------------------------------------------------+
 // Application API
@@ -79,10 +80,12 @@ static inline bool _status_stage_xact(uint8_t rhport, tusb_control_request_t con
 
 // Status phase
 bool tud_control_status(uint8_t rhport, tusb_control_request_t const* request) {
-  _ctrl_xfer.request = (*request);
-  _ctrl_xfer.buffer = NULL;
-  _ctrl_xfer.total_xferred = 0;
-  _ctrl_xfer.data_len = 0;
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
+  ctrl->request = (*request);
+  ctrl->buffer = NULL;
+  ctrl->total_xferred = 0;
+  ctrl->data_len = 0;
+  ctrl->direct = false;
 
   return _status_stage_xact(rhport, request);
 }
@@ -90,36 +93,41 @@ bool tud_control_status(uint8_t rhport, tusb_control_request_t const* request) {
 // Queue a transaction in Data Stage
 // Each transaction has up to Endpoint0's max packet size.
 // This function can also transfer an zero-length packet
+// Direct transfer with CFG_TUD_CONTROL_MULTI_PACKET queues the rest of data stage at once.
 static bool _data_stage_xact(uint8_t rhport) {
-  uint16_t const xact_len = tu_min16(_ctrl_xfer.data_len - _ctrl_xfer.total_xferred,
-                                     CFG_TUD_ENDPOINT0_SIZE);
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
+  uint16_t const remaining = ctrl->data_len - ctrl->total_xferred;
+  uint16_t const xact_len = (CFG_TUD_CONTROL_MULTI_PACKET && ctrl->direct) ? remaining :
+                            tu_min16(remaining, CFG_TUD_ENDPOINT0_SIZE);
+  uint8_t const ep_addr = (ctrl->request.bmRequestType_bit.direction == TUSB_DIR_IN) ? EDPT_CTRL_IN : EDPT_CTRL_OUT;
 
-  uint8_t ep_addr = EDPT_CTRL_OUT;
+  ctrl->xact_len = xact_len;
 
-  if (_ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN) {
-    ep_addr = EDPT_CTRL_IN;
-    if (xact_len) {
-      TU_VERIFY(0 == tu_memcpy_s(_usbd_ctrl_buf, CFG_TUD_ENDPOINT0_SIZE, _ctrl_xfer.buffer, xact_len));
-    }
+  if (ctrl->direct) {
+    return usbd_edpt_xfer(rhport, ep_addr, xact_len ? ctrl->buffer : NULL, xact_len);
   }
 
-  return usbd_edpt_xfer(rhport, ep_addr, xact_len ? _usbd_ctrl_buf : NULL, xact_len);
+  if (ep_addr == EDPT_CTRL_IN && xact_len) {
+    TU_VERIFY(0 == tu_memcpy_s(_ctrl_epbuf[usbd_port_id(rhport)].buf, CFG_TUD_ENDPOINT0_SIZE, ctrl->buffer, xact_len));
+  }
+
+  return usbd_edpt_xfer(rhport, ep_addr, xact_len ? _ctrl_epbuf[usbd_port_id(rhport)].buf : NULL, xact_len);
 }
 
-// Transmit data to/from the control endpoint.
-// If the request's wLength is zero, a status packet is sent instead.
-bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len) {
-  _ctrl_xfer.request = (*request);
-  _ctrl_xfer.buffer = (uint8_t*) buffer;
-  _ctrl_xfer.total_xferred = 0U;
-  _ctrl_xfer.data_len = tu_min16(len, request->wLength);
+static bool _control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len, bool direct) {
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
+  ctrl->request = (*request);
+  ctrl->buffer = (uint8_t*) buffer;
+  ctrl->total_xferred = 0U;
+  ctrl->data_len = tu_min16(len, request->wLength);
+  ctrl->direct = direct;
 
   if (request->wLength > 0U) {
-    if (_ctrl_xfer.data_len > 0U) {
+    if (ctrl->data_len > 0U) {
       TU_ASSERT(buffer);
     }
 
-//    TU_LOG2("  Control total data length is %u bytes\r\n", _ctrl_xfer.data_len);
+//    TU_LOG2("  Control total data length is %u bytes\r\n", ctrl->data_len);
 
     // Data stage
     TU_ASSERT(_data_stage_xact(rhport));
@@ -131,29 +139,37 @@ bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, voi
   return true;
 }
 
+// Transmit data to/from the control endpoint.
+// If the request's wLength is zero, a status packet is sent instead.
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len) {
+  return _control_xfer(rhport, request, buffer, len, false);
+}
+
+bool tud_control_xfer_direct(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len) {
+  return _control_xfer(rhport, request, buffer, len, true);
+}
+
 //--------------------------------------------------------------------+
 // USBD API
 //--------------------------------------------------------------------+
-void usbd_control_reset(void);
-void usbd_control_set_request(tusb_control_request_t const* request);
-void usbd_control_set_complete_callback(usbd_control_xfer_cb_t fp);
-bool usbd_control_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
-
-void usbd_control_reset(void) {
-  tu_varclr(&_ctrl_xfer);
+void usbd_control_reset(uint8_t rhport) {
+  tu_varclr(&_ctrl_xfer[usbd_port_id(rhport)]);
 }
 
 // Set complete callback
-void usbd_control_set_complete_callback(usbd_control_xfer_cb_t fp) {
-  _ctrl_xfer.complete_cb = fp;
+void usbd_control_set_complete_callback(uint8_t rhport, usbd_control_xfer_cb_t fp) {
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
+  ctrl->complete_cb = fp;
 }
 
 // for dcd_set_address where DCD is responsible for status response
-void usbd_control_set_request(tusb_control_request_t const* request) {
-  _ctrl_xfer.request = (*request);
-  _ctrl_xfer.buffer = NULL;
-  _ctrl_xfer.total_xferred = 0;
-  _ctrl_xfer.data_len = 0;
+void usbd_control_set_request(uint8_t rhport, tusb_control_request_t const* request) {
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
+  ctrl->request = (*request);
+  ctrl->buffer = NULL;
+  ctrl->total_xferred = 0;
+  ctrl->data_len = 0;
+  ctrl->direct = false;
 }
 
 // callback when a transaction complete on
@@ -161,51 +177,56 @@ void usbd_control_set_request(tusb_control_request_t const* request) {
 // - Status stage
 bool usbd_control_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
   (void) result;
+  usbd_control_xfer_t* ctrl = &_ctrl_xfer[usbd_port_id(rhport)];
 
   // Endpoint Address is opposite to direction bit, this is Status Stage complete event
-  if (tu_edpt_dir(ep_addr) != _ctrl_xfer.request.bmRequestType_bit.direction) {
+  if (tu_edpt_dir(ep_addr) != ctrl->request.bmRequestType_bit.direction) {
     TU_ASSERT(0 == xferred_bytes);
 
     // invoke optional dcd hook if available
-    dcd_edpt0_status_complete(rhport, &_ctrl_xfer.request);
+    dcd_edpt0_status_complete(rhport, &ctrl->request);
 
-    if (_ctrl_xfer.complete_cb) {
+    if (ctrl->complete_cb) {
       // TODO refactor with usbd_driver_print_control_complete_name
-      _ctrl_xfer.complete_cb(rhport, CONTROL_STAGE_ACK, &_ctrl_xfer.request);
+      ctrl->complete_cb(rhport, CONTROL_STAGE_ACK, &ctrl->request);
     }
 
     return true;
   }
 
-  if (_ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_OUT) {
-    TU_VERIFY(_ctrl_xfer.buffer);
-    memcpy(_ctrl_xfer.buffer, _usbd_ctrl_buf, xferred_bytes);
-    TU_LOG_MEM(CFG_TUD_LOG_LEVEL, _usbd_ctrl_buf, xferred_bytes, 2);
+  if (ctrl->request.bmRequestType_bit.direction == TUSB_DIR_OUT) {
+    TU_VERIFY(ctrl->buffer);
+    if (!ctrl->direct) {
+      memcpy(ctrl->buffer, _ctrl_epbuf[usbd_port_id(rhport)].buf, xferred_bytes);
+    }
+    TU_LOG_MEM(CFG_TUD_LOG_LEVEL, ctrl->buffer, xferred_bytes, 2);
   }
 
-  _ctrl_xfer.total_xferred += (uint16_t) xferred_bytes;
-  _ctrl_xfer.buffer += xferred_bytes;
+  ctrl->total_xferred += (uint16_t) xferred_bytes;
+  ctrl->buffer += xferred_bytes;
 
   // Data Stage is complete when all request's length are transferred or
-  // a short packet is sent including zero-length packet.
-  if ((_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) ||
-      (xferred_bytes < CFG_TUD_ENDPOINT0_SIZE)) {
+  // a short packet is sent including zero-length packet. A multi-packet transaction
+  // ends with a short packet if fewer bytes than queued or not a multiple of packet size.
+  if ((ctrl->request.wLength == ctrl->total_xferred) ||
+      (xferred_bytes == 0) || (xferred_bytes < ctrl->xact_len) ||
+      (xferred_bytes % CFG_TUD_ENDPOINT0_SIZE)) {
     // DATA stage is complete
     bool is_ok = true;
 
     // invoke complete callback if set
     // callback can still stall control in status phase e.g out data does not make sense
-    if (_ctrl_xfer.complete_cb) {
+    if (ctrl->complete_cb) {
       #if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
-      usbd_driver_print_control_complete_name(_ctrl_xfer.complete_cb);
+      usbd_driver_print_control_complete_name(ctrl->complete_cb);
       #endif
 
-      is_ok = _ctrl_xfer.complete_cb(rhport, CONTROL_STAGE_DATA, &_ctrl_xfer.request);
+      is_ok = ctrl->complete_cb(rhport, CONTROL_STAGE_DATA, &ctrl->request);
     }
 
     if (is_ok) {
       // Send status
-      TU_ASSERT(_status_stage_xact(rhport, &_ctrl_xfer.request));
+      TU_ASSERT(_status_stage_xact(rhport, &ctrl->request));
     } else {
       // Stall both IN and OUT control endpoint
       dcd_edpt_stall(rhport, EDPT_CTRL_OUT);
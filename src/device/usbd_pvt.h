@@ -50,6 +50,11 @@ typedef struct {
   bool     (* control_xfer_cb  ) (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
   bool     (* xfer_cb          ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
   void     (* sof              ) (uint8_t rhport, uint32_t frame_count); // optional
+
+  // optional: invoked in ISR context on transfer complete of driver's endpoints for latency-critical drivers.
+  // Return true if the completion is fully handled, false to defer it to xfer_cb() in usbd task as usual.
+  // Only ISR-safe API can be used within, see docs/reference/concurrency.rst
+  bool     (* xfer_isr         ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 } usbd_class_driver_t;
 
 // Invoked when initializing device stack to get additional class drivers.
@@ -61,9 +66,30 @@ typedef bool (*usbd_control_xfer_cb_t)(uint8_t rhport, uint8_t stage, tusb_contr
 
 void usbd_int_set(bool enabled);
 
+// usbd_control.c
+void usbd_control_reset(uint8_t rhport);
+void usbd_control_set_request(uint8_t rhport, tusb_control_request_t const* request);
+void usbd_control_set_complete_callback(uint8_t rhport, usbd_control_xfer_cb_t fp);
+bool usbd_control_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+
+#if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
+// usbd.c: print the name of control complete driver
+void usbd_driver_print_control_complete_name(usbd_control_xfer_cb_t callback);
+#endif
+
+// Index of per-port state for rhport
+TU_ATTR_ALWAYS_INLINE static inline uint8_t usbd_port_id(uint8_t rhport) {
+#if CFG_TUD_RHPORT_NUM > 1
+  return rhport;
+#else
+  (void) rhport;
+  return 0;
+#endif
+}
+
 //--------------------------------------------------------------------+
 // USBD Endpoint API
-// Note: rhport should be 0 since device stack only support 1 rhport for now
+// Note: with CFG_TUD_RHPORT_NUM = 1, rhport is ignored and the initialized port is used
 //--------------------------------------------------------------------+
 
 // Open an endpoint
@@ -88,6 +114,16 @@ bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr);
 // Check if endpoint is busy transferring
 bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr);
 
+// Check if another transfer can be queued with usbd_edpt_xfer() while endpoint is busy (CFG_TUD_EDPT_XFER_QUEUE).
+// Note: unlike claim, this does not reserve the queue slot
+bool usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr);
+
+// Opt-in merging of transfer complete events (CFG_TUD_EDPT_XFER_COALESCE). Completions of the endpoint arriving
+// while a previous one is still waiting in usbd queue are merged into it: xfer_cb() is invoked once with the
+// total number of bytes and the first non-success result. Only suitable for drivers that do not rely on the
+// size of individual transfers.
+void usbd_edpt_xfer_coalesce(uint8_t rhport, uint8_t ep_addr, bool en);
+
 // Stall endpoint
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr);
 
@@ -97,12 +133,58 @@ void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr);
 // Check if endpoint is stalled
 bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr);
 
-// Allocate packet buffer used by ISO endpoints
+// Allocate packet buffer used by ISO endpoints. Size is per (micro)frame i.e up to 3x1024 for highspeed
+// high-bandwidth endpoint (see tu_edpt_hb_size())
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size);
 
 // Configure and enable an ISO endpoint according to descriptor
 bool usbd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpoint_desc);
 
+#if CFG_TUD_ISO_STREAM
+// Ring of per-(micro)frame packet slots for an always-armed ISO endpoint. Once started, usbd re-arms the
+// endpoint in ISR on every completion so a late usbd task never misses a frame, class only moves ring positions:
+// - IN : class fills slots with usbd_iso_stream_write_slot()/commit(), a ZLP is sent when ring is empty
+// - OUT: usbd fills slots, class consumes them with usbd_iso_stream_read_slot()/release(). One slot is always
+//        reserved for hardware, packets are dropped when the other slots are not released in time.
+// Buffer, length and (power of 2) num_slots are set by class, other fields are managed by usbd.
+typedef struct {
+  uint8_t*  buffer;     // num_slots * slot_size bytes
+  uint16_t* length;     // num_slots entries, bytes in each slot
+  uint16_t  slot_size;
+  uint8_t   num_slots;
+
+  uint8_t   ep_addr;
+  volatile uint16_t wr_idx; // free-running, producer: class (IN) or ISR (OUT)
+  volatile uint16_t rd_idx; // free-running, consumer: ISR (IN) or class (OUT)
+  bool      slot_armed;     // IN: hardware is sending slot at rd_idx (otherwise a ZLP)
+  uint32_t  missed;         // IN: empty ring at frame (ZLP sent), OUT: ring full (packet dropped)
+} usbd_iso_stream_t;
+
+// Start streaming on an opened ISO endpoint, endpoint stays busy until stopped
+bool usbd_edpt_iso_stream_start(uint8_t rhport, uint8_t ep_addr, usbd_iso_stream_t* stream);
+
+// Stop streaming, transfer currently armed in hardware is aborted by closing/re-activating the endpoint
+void usbd_edpt_iso_stream_stop(uint8_t rhport, uint8_t ep_addr);
+
+// IN: get next free slot to fill, NULL if ring is full
+uint8_t* usbd_iso_stream_write_slot(usbd_iso_stream_t* stream);
+
+// IN: queue filled slot with len bytes for transmission
+void usbd_iso_stream_commit(usbd_iso_stream_t* stream, uint16_t len);
+
+// OUT: get oldest received slot and its length, NULL if ring is empty
+uint8_t* usbd_iso_stream_read_slot(usbd_iso_stream_t* stream, uint16_t* len);
+
+// OUT: give slot returned by usbd_iso_stream_read_slot() back to hardware
+void usbd_iso_stream_release(usbd_iso_stream_t* stream);
+
+// Number of slots queued: IN pending transmission, OUT received but not released
+TU_ATTR_ALWAYS_INLINE static inline
+uint16_t usbd_iso_stream_count(usbd_iso_stream_t const* stream) {
+  return (uint16_t) (stream->wr_idx - stream->rd_idx);
+}
+#endif
+
 // Check if endpoint is ready (not busy and not stalled)
 TU_ATTR_ALWAYS_INLINE static inline
 bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
@@ -112,6 +194,26 @@ bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
 // Enable SOF interrupt
 void usbd_sof_enable(uint8_t rhport, bool en);
 
+#if CFG_TUD_SOF_SCHED
+typedef void (*usbd_sof_sched_cb_t)(uint8_t rhport, uint32_t frame_count, void* arg);
+
+// Periodic SOF registration, storage is provided by caller and must stay valid until removed
+typedef struct usbd_sof_sched_s {
+  struct usbd_sof_sched_s* next;
+  usbd_sof_sched_cb_t cb;
+  void*    arg;
+  uint16_t period;    // number of SOFs: frames on full speed, microframes on high speed
+  uint16_t countdown;
+} usbd_sof_sched_t;
+
+// Invoke cb in ISR context every period SOFs. SOF interrupt is enabled while any registration exists, all
+// registrations are served in a single dispatch per SOF and dropped when configuration is reset.
+bool usbd_sof_sched_add(uint8_t rhport, usbd_sof_sched_t* sched, uint16_t period, usbd_sof_sched_cb_t cb, void* arg);
+
+// Remove registration, SOF interrupt is disabled when there is no more user
+void usbd_sof_sched_remove(uint8_t rhport, usbd_sof_sched_t* sched);
+#endif
+
 /*------------------------------------------------------------------*/
 /* Helper
  *------------------------------------------------------------------*/
@@ -119,6 +221,20 @@ void usbd_sof_enable(uint8_t rhport, bool en);
 bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in);
 void usbd_defer_func(osal_task_func_t func, void *param, bool in_isr);
 
+#if CFG_TUSB_OTG
+// Leave device role of dual-role port: stop controller, reset configuration and drop pending events
+void usbd_role_exit(uint8_t rhport);
+#endif
+
+#if CFG_TUD_ARENA_SIZE
+// Allocate buffer from arena of active configuration, aligned to CFG_TUD_ARENA_ALIGN. Should be called in driver's
+// open(), memory is released by usbd when configuration of rhport is reset. Return NULL if arena is exhausted.
+void* usbd_arena_alloc(uint8_t rhport, uint32_t size);
+
+// Number of bytes left in arena of rhport, e.g for driver to size optional larger buffer
+uint32_t usbd_arena_remaining(uint8_t rhport);
+#endif
+
 #ifdef __cplusplus
  }
 #endif
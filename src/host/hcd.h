@@ -30,6 +30,7 @@
 #include "common/tusb_common.h"
 #include "osal/osal.h"
 #include "common/tusb_fifo.h"
+#include "host/usbh.h"
 
 #ifdef __cplusplus
  extern "C" {
@@ -58,6 +59,7 @@ typedef enum
   HCD_EVENT_DEVICE_ATTACH,
   HCD_EVENT_DEVICE_REMOVE,
   HCD_EVENT_XFER_COMPLETE,
+  HCD_EVENT_DEVICE_RESUME, // resume signaling (remote wakeup) detected or completed on suspended port
 
   // Not an HCD event, just a convenient way to defer ISR function
   USBH_EVENT_FUNC_CALL,
@@ -73,7 +75,7 @@ typedef struct
 
   union
   {
-    // Attach, Remove
+    // Attach, Remove, Resume
     struct {
       uint8_t hub_addr;
       uint8_t hub_port;
@@ -94,6 +96,9 @@ typedef struct
     }func_call;
   };
 
+#if CFG_TUH_EVENT_TIMESTAMP
+  uint32_t timestamp; // CFG_TUSB_EVENT_TIMESTAMP() when event is queued
+#endif
 } hcd_event_t;
 
 typedef struct
@@ -102,6 +107,7 @@ typedef struct
   uint8_t hub_addr;
   uint8_t hub_port;
   uint8_t speed;
+  uint8_t hub_multi_tt; // parent hub has one Transaction Translator per port
 } hcd_devtree_info_t;
 
 //--------------------------------------------------------------------+
@@ -130,6 +136,10 @@ bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void* cfg_param) TU_AT
 // Initialize controller to host mode
 bool hcd_init(uint8_t rhport);
 
+// Switch dual-role controller running as device to host mode (CFG_TUSB_OTG). Clock and PHY set up by dcd_init()
+// are kept, controller is left as after hcd_init(). Optional, hcd_init() is used if not implemented
+bool hcd_role_enter(uint8_t rhport) TU_ATTR_WEAK;
+
 // Interrupt Handler
 void hcd_int_handler(uint8_t rhport, bool in_isr);
 
@@ -159,6 +169,16 @@ void hcd_port_reset_end(uint8_t rhport);
 // Get port link speed
 tusb_speed_t hcd_port_speed_get(uint8_t rhport);
 
+// Optional: selectively suspend roothub port, controller stops sending SOF and traffic to it
+bool hcd_port_suspend(uint8_t rhport) TU_ATTR_WEAK;
+
+// Optional: drive resume signaling on suspended roothub port. USB specs: it should last at least 20ms, then
+// hcd_port_resume_end() is invoked. HCD should send HCD_EVENT_DEVICE_RESUME when remote wakeup is detected.
+bool hcd_port_resume(uint8_t rhport) TU_ATTR_WEAK;
+
+// Optional: complete resume signaling, may be required by some controllers
+void hcd_port_resume_end(uint8_t rhport) TU_ATTR_WEAK;
+
 // HCD closes all opened endpoints belong to this device
 void hcd_device_close(uint8_t rhport, uint8_t dev_addr);
 
@@ -172,6 +192,11 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const * e
 // Submit a transfer, when complete hcd_event_xfer_complete() must be invoked
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen);
 
+// optional: submit an isochronous transfer of packet_count packets laid out back to back in buffer, one packet
+// per service interval. Per-packet actual length and result must be written back before hcd_event_xfer_complete()
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer,
+                       tuh_iso_packet_t* packets, uint16_t packet_count) TU_ATTR_WEAK;
+
 // Abort a queued transfer. Note: it can only abort transfer that has not been started
 // Return true if a queued transfer is aborted, false if there is no transfer to abort
 bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr);
@@ -220,6 +245,18 @@ void hcd_event_device_remove(uint8_t rhport, bool in_isr) {
   hcd_event_handler(&event, in_isr);
 }
 
+// Helper to send remote wakeup/resume event of roothub port
+TU_ATTR_ALWAYS_INLINE static inline
+void hcd_event_device_resume(uint8_t rhport, bool in_isr) {
+  hcd_event_t event;
+  event.rhport              = rhport;
+  event.event_id            = HCD_EVENT_DEVICE_RESUME;
+  event.connection.hub_addr = 0;
+  event.connection.hub_port = 0;
+
+  hcd_event_handler(&event, in_isr);
+}
+
 // Helper to send USB transfer event
 TU_ATTR_ALWAYS_INLINE static inline
 void hcd_event_xfer_complete(uint8_t dev_addr, uint8_t ep_addr, uint32_t xferred_bytes, xfer_result_t result, bool in_isr) {
@@ -45,14 +45,25 @@ typedef struct
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t port_count;
+  uint8_t multi_tt;
 
-  CFG_TUH_MEM_ALIGN uint8_t status_change;
-  CFG_TUH_MEM_ALIGN hub_port_status_response_t port_status;
-  CFG_TUH_MEM_ALIGN hub_status_response_t hub_status;
+  uint8_t status_pending; // status changes not handled yet
+  uint8_t port_busy;      // a hub/port status change is being handled
+  uint16_t pwr_good_ms;   // power on to power good time of ports
+
+  usbh_timer_t timer;
+
+  TUH_EPBUF_TYPE_DEF(uint8_t, status_change);
+  TUH_EPBUF_TYPE_DEF(hub_port_status_response_t, port_status);
+  TUH_EPBUF_TYPE_DEF(hub_status_response_t, hub_status);
 } hub_interface_t;
 
 CFG_TUH_MEM_SECTION static hub_interface_t hub_data[CFG_TUH_HUB];
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN static uint8_t _hub_buffer[sizeof(descriptor_hub_desc_t)];
+typedef struct {
+  TUH_EPBUF_DEF(buf, sizeof(descriptor_hub_desc_t));
+} hub_epbuf_t;
+
+CFG_TUH_MEM_SECTION static hub_epbuf_t _hub_epbuf;
 
 TU_ATTR_ALWAYS_INLINE
 static inline hub_interface_t* get_itf(uint8_t dev_addr)
@@ -194,7 +205,7 @@ bool hub_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf
   TU_VERIFY(TUSB_CLASS_HUB == itf_desc->bInterfaceClass &&
             0              == itf_desc->bInterfaceSubClass);
 
-  // hub driver does not support multiple TT yet
+  // default setting is single TT (or full speed hub)
   TU_VERIFY(itf_desc->bInterfaceProtocol <= 1);
 
   // msc driver length is fixed
@@ -202,14 +213,31 @@ bool hub_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf
   TU_ASSERT(drv_len <= max_len);
 
   //------------- Interrupt Status endpoint -------------//
-  tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *) tu_desc_next(itf_desc);
+  tusb_desc_endpoint_t const *desc_ep = usbh_desc_itf_edpt(itf_desc, 0);
 
-  TU_ASSERT(TUSB_DESC_ENDPOINT  == desc_ep->bDescriptorType &&
-            TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer, 0);
-
-  TU_ASSERT(tuh_edpt_open(dev_addr, desc_ep));
+  TU_ASSERT(desc_ep && TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer, 0);
 
   hub_interface_t* p_hub = get_itf(dev_addr);
+  p_hub->multi_tt = 0;
+
+#if CFG_TUH_HUB_MULTI_TT
+  // Multi-TT hub has alternate setting 1 with protocol 2, which has its own status endpoint
+  tusb_desc_interface_t const* desc_alt = usbh_desc_itf_next(itf_desc);
+  if ( desc_alt && (uint8_t const*) desc_alt < (uint8_t const*) itf_desc + max_len &&
+       itf_desc->bInterfaceNumber == desc_alt->bInterfaceNumber &&
+       1 == desc_alt->bAlternateSetting && 2 == desc_alt->bInterfaceProtocol )
+  {
+    tusb_desc_endpoint_t const* desc_ep_alt = usbh_desc_itf_edpt(desc_alt, 0);
+    if ( desc_ep_alt && TUSB_XFER_INTERRUPT == desc_ep_alt->bmAttributes.xfer )
+    {
+      TU_LOG_DRV("  HUB multi-TT\r\n");
+      desc_ep = desc_ep_alt;
+      p_hub->multi_tt = 1;
+    }
+  }
+#endif
+
+  TU_ASSERT(tuh_edpt_open(dev_addr, desc_ep));
 
   p_hub->itf_num = itf_desc->bInterfaceNumber;
   p_hub->ep_in   = desc_ep->bEndpointAddress;
@@ -217,6 +245,12 @@ bool hub_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf
   return true;
 }
 
+bool hub_is_multi_tt(uint8_t dev_addr)
+{
+  TU_VERIFY(dev_addr > CFG_TUH_DEVICE_MAX);
+  return get_itf(dev_addr)->multi_tt;
+}
+
 void hub_close(uint8_t dev_addr)
 {
   TU_VERIFY(dev_addr > CFG_TUH_DEVICE_MAX, );
@@ -224,16 +258,11 @@ void hub_close(uint8_t dev_addr)
 
   if (p_hub->ep_in) {
     TU_LOG_DRV("  HUB close addr = %d\r\n", dev_addr);
+    usbh_timer_stop(&p_hub->timer);
     tu_memclr(p_hub, sizeof( hub_interface_t));
   }
 }
 
-bool hub_edpt_status_xfer(uint8_t dev_addr)
-{
-  hub_interface_t* hub_itf = get_itf(dev_addr);
-  return usbh_edpt_xfer(dev_addr, hub_itf->ep_in, &hub_itf->status_change, 1);
-}
-
 
 //--------------------------------------------------------------------+
 // Set Configure
@@ -241,12 +270,41 @@ bool hub_edpt_status_xfer(uint8_t dev_addr)
 
 static void config_set_port_power (tuh_xfer_t* xfer);
 static void config_port_power_complete (tuh_xfer_t* xfer);
+static bool config_get_hub_desc(uint8_t dev_addr);
+
+#if CFG_TUH_HUB_MULTI_TT
+static void config_set_multi_tt_complete (tuh_xfer_t* xfer)
+{
+  if (XFER_RESULT_SUCCESS != xfer->result)
+  {
+    // hub is still using its default (single TT) setting
+    TU_LOG1("HUB failed to enable multi-TT\r\n");
+    get_itf(xfer->daddr)->multi_tt = 0;
+  }
+
+  config_get_hub_desc(xfer->daddr);
+}
+#endif
 
 bool hub_set_config(uint8_t dev_addr, uint8_t itf_num)
 {
   hub_interface_t* p_hub = get_itf(dev_addr);
   TU_ASSERT(itf_num == p_hub->itf_num);
 
+#if CFG_TUH_HUB_MULTI_TT
+  if (p_hub->multi_tt)
+  {
+    // Select multi-TT alternate setting
+    TU_ASSERT( tuh_interface_set(dev_addr, itf_num, 1, config_set_multi_tt_complete, 0) );
+    return true;
+  }
+#endif
+
+  return config_get_hub_desc(dev_addr);
+}
+
+static bool config_get_hub_desc(uint8_t dev_addr)
+{
   // Get Hub Descriptor
   tusb_control_request_t const request =
   {
@@ -267,7 +325,7 @@ bool hub_set_config(uint8_t dev_addr, uint8_t itf_num)
     .daddr       = dev_addr,
     .ep_addr     = 0,
     .setup       = &request,
-    .buffer      = _hub_buffer,
+    .buffer      = _hub_epbuf.buf,
     .complete_cb = config_set_port_power,
     .user_data    = 0
   };
@@ -285,8 +343,9 @@ static void config_set_port_power (tuh_xfer_t* xfer)
   hub_interface_t* p_hub = get_itf(daddr);
 
   // only use number of ports in hub descriptor
-  descriptor_hub_desc_t const* desc_hub = (descriptor_hub_desc_t const*) _hub_buffer;
+  descriptor_hub_desc_t const* desc_hub = (descriptor_hub_desc_t const*) _hub_epbuf.buf;
   p_hub->port_count = desc_hub->bNbrPorts;
+  p_hub->pwr_good_ms = (uint16_t) (2u * desc_hub->bPwrOn2PwrGood);
 
   // May need to GET_STATUS
 
@@ -295,6 +354,17 @@ static void config_set_port_power (tuh_xfer_t* xfer)
   hub_port_set_feature(daddr, hub_port, HUB_FEATURE_PORT_POWER, config_port_power_complete, 0);
 }
 
+static void config_power_good(uintptr_t arg)
+{
+  uint8_t const daddr = (uint8_t) arg;
+  hub_interface_t* p_hub = get_itf(daddr);
+
+  // queue notification status endpoint and complete the SET CONFIGURATION
+  TU_ASSERT( usbh_edpt_xfer(daddr, p_hub->ep_in, &p_hub->status_change, 1), );
+
+  usbh_driver_set_config_complete(daddr, p_hub->itf_num);
+}
+
 static void config_port_power_complete (tuh_xfer_t* xfer)
 {
   TU_ASSERT(XFER_RESULT_SUCCESS == xfer->result, );
@@ -304,11 +374,9 @@ static void config_port_power_complete (tuh_xfer_t* xfer)
 
   if (xfer->setup->wIndex == p_hub->port_count)
   {
-    // All ports are power -> queue notification status endpoint and
-    // complete the SET CONFIGURATION
-    TU_ASSERT( usbh_edpt_xfer(daddr, p_hub->ep_in, &p_hub->status_change, 1), );
-
-    usbh_driver_set_config_complete(daddr, p_hub->itf_num);
+    // All ports are power -> wait for power good (without blocking other devices) before
+    // connection status is valid
+    usbh_timer_start(&p_hub->timer, p_hub->pwr_good_ms, config_power_good, daddr);
   }else
   {
     // power next port
@@ -319,13 +387,66 @@ static void config_port_power_complete (tuh_xfer_t* xfer)
 
 //--------------------------------------------------------------------+
 // Connection Changes
+//
+// All changes reported by a status notification are recorded in status_pending and handled back-to-back,
+// one hub/port at a time, without waiting for next interrupt poll. Every change bit of a port is cleared in
+// the same sequence. Port with new connection is reset last, next pending port is processed when usbh
+// re-arms hub status i.e once device is addressed (address 0 is free) or enumeration is complete.
 //--------------------------------------------------------------------+
 
 static void hub_port_get_status_complete (tuh_xfer_t* xfer);
 static void hub_get_status_complete (tuh_xfer_t* xfer);
+static void hub_clear_change_complete (tuh_xfer_t* xfer);
+static void port_clear_change_complete (tuh_xfer_t* xfer);
 static void connection_clear_conn_change_complete (tuh_xfer_t* xfer);
 static void connection_port_reset_complete (tuh_xfer_t* xfer);
 
+// Start handling next pending status change
+static bool status_pending_process(uint8_t dev_addr)
+{
+  hub_interface_t* p_hub = get_itf(dev_addr);
+
+  for (uint8_t port = 0; port <= p_hub->port_count && port < 8; port++)
+  {
+    if ( tu_bit_test(p_hub->status_pending, port) )
+    {
+      p_hub->status_pending = (uint8_t) tu_bit_clear(p_hub->status_pending, port);
+      p_hub->port_busy = 1;
+
+      bool const ret = (port == 0) ?
+          hub_port_get_status(dev_addr, 0, &p_hub->hub_status, hub_get_status_complete, 0) :
+          hub_port_get_status(dev_addr, port, &p_hub->port_status, hub_port_get_status_complete, 0);
+
+      if (ret) return true;
+
+      // control transfer failed, changes will be reported again by next notification
+      p_hub->port_busy = 0;
+      p_hub->status_pending = 0;
+      break;
+    }
+  }
+
+  p_hub->status_pending = 0;
+  TU_VERIFY(!usbh_edpt_busy(dev_addr, p_hub->ep_in));
+  return usbh_edpt_xfer(dev_addr, p_hub->ep_in, &p_hub->status_change, 1);
+}
+
+bool hub_edpt_status_xfer(uint8_t dev_addr)
+{
+  hub_interface_t* p_hub = get_itf(dev_addr);
+  // skip if a hub/port status change is being handled, it will continue once done
+  TU_VERIFY(!p_hub->port_busy);
+  return status_pending_process(dev_addr);
+}
+
+// Current hub/port is done, continue with next pending change
+static void status_change_done(uint8_t dev_addr)
+{
+  hub_interface_t* p_hub = get_itf(dev_addr);
+  p_hub->port_busy = 0;
+  (void) hub_edpt_status_xfer(dev_addr);
+}
+
 // callback as response of interrupt endpoint polling
 bool hub_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
   (void) xferred_bytes; // TODO can be more than 1 for hub with lots of ports
@@ -337,128 +458,150 @@ bool hub_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32
   uint8_t const status_change = p_hub->status_change;
   TU_LOG2("  Hub Status Change = 0x%02X\r\n", status_change);
 
-  if ( status_change == 0 ) {
-    // The status change event was neither for the hub, nor for any of its ports.
-    // This shouldn't happen, but it does with some devices.
-    // Initiate the next interrupt poll here.
-    return hub_edpt_status_xfer(dev_addr);
-  }
-
-  if (tu_bit_test(status_change, 0)) {
-    // Hub bit 0 is for the hub device events
-    if (hub_port_get_status(dev_addr, 0, &p_hub->hub_status, hub_get_status_complete, 0) == false) {
-      //Hub status control transfer failed, retry
-      hub_edpt_status_xfer(dev_addr);
-    }
-  }
-  else {
-    // Hub bits 1 to n are hub port events
-    for (uint8_t port=1; port <= p_hub->port_count; port++) {
-      if ( tu_bit_test(status_change, port) ) {
-        if (hub_port_get_status(dev_addr, port, &p_hub->port_status, hub_port_get_status_complete, 0) == false) {
-          //Hub status control transfer failed, retry
-          hub_edpt_status_xfer(dev_addr);
-        }
-        break;
-      }
-    }
-  }
-
-  // NOTE: next status transfer is queued by usbh.c after handling this request
-  return true;
-}
+  // The status change event can be neither for the hub, nor for any of its ports.
+  // This shouldn't happen, but it does with some devices. Next interrupt poll is initiated then.
+  p_hub->status_pending |= status_change;
 
-static void hub_clear_feature_complete_stub(tuh_xfer_t* xfer)
-{
-  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
-  hub_edpt_status_xfer(xfer->daddr);
+  if (p_hub->port_busy) return true;
+  return status_pending_process(dev_addr);
 }
 
-static void hub_get_status_complete (tuh_xfer_t* xfer)
+static void hub_clear_change_complete (tuh_xfer_t* xfer)
 {
-  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
-
   uint8_t const daddr = xfer->daddr;
   hub_interface_t* p_hub = get_itf(daddr);
-  uint8_t const port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
-  TU_ASSERT(port_num == 0 , );
 
-  TU_LOG2("HUB Got hub status, addr = %u, status = %04x\r\n", daddr, p_hub->hub_status.change.value);
+  if (xfer->result != XFER_RESULT_SUCCESS)
+  {
+    status_change_done(daddr);
+    return;
+  }
 
   if (p_hub->hub_status.change.local_power_source)
   {
     TU_LOG2("HUB Local Power Change, addr = %u\r\n", daddr);
-    hub_port_clear_feature(daddr, port_num, HUB_FEATURE_HUB_LOCAL_POWER_CHANGE, hub_clear_feature_complete_stub, 0);
+    p_hub->hub_status.change.local_power_source = 0;
+    hub_port_clear_feature(daddr, 0, HUB_FEATURE_HUB_LOCAL_POWER_CHANGE, hub_clear_change_complete, 0);
   }
   else if (p_hub->hub_status.change.over_current)
   {
     TU_LOG1("HUB Over Current, addr = %u\r\n", daddr);
-    hub_port_clear_feature(daddr, port_num, HUB_FEATURE_HUB_OVER_CURRENT_CHANGE, hub_clear_feature_complete_stub, 0);
+    p_hub->hub_status.change.over_current = 0;
+    hub_port_clear_feature(daddr, 0, HUB_FEATURE_HUB_OVER_CURRENT_CHANGE, hub_clear_change_complete, 0);
+  }
+  else
+  {
+    status_change_done(daddr);
   }
 }
 
-static void hub_port_get_status_complete (tuh_xfer_t* xfer)
+static void hub_get_status_complete (tuh_xfer_t* xfer)
 {
-  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
+  TU_LOG2("HUB Got hub status, addr = %u, status = %04x\r\n", xfer->daddr, get_itf(xfer->daddr)->hub_status.change.value);
 
+  // clear all hub changes
+  hub_clear_change_complete(xfer);
+}
+
+static void port_clear_change_complete (tuh_xfer_t* xfer)
+{
   uint8_t const daddr = xfer->daddr;
   hub_interface_t* p_hub = get_itf(daddr);
   uint8_t const port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
 
-  // Connection change
-  if (p_hub->port_status.change.connection)
+  if (xfer->result != XFER_RESULT_SUCCESS)
+  {
+    status_change_done(daddr);
+    return;
+  }
+
+  // Clear other port status changes first. TODO Not currently handled - just cleared.
+  uint8_t feature = 0;
+  if (p_hub->port_status.change.port_enable)
+  {
+    p_hub->port_status.change.port_enable = 0;
+    feature = HUB_FEATURE_PORT_ENABLE_CHANGE;
+  }
+  else if (p_hub->port_status.change.suspend)
+  {
+    p_hub->port_status.change.suspend = 0;
+    feature = HUB_FEATURE_PORT_SUSPEND_CHANGE;
+
+    // resume is complete: remote wakeup of a selectively suspended device, or requested by host
+    if (!p_hub->port_status.status.suspend)
+    {
+      hcd_event_t event =
+      {
+        .rhport     = usbh_get_rhport(daddr),
+        .event_id   = HCD_EVENT_DEVICE_RESUME,
+        .connection =
+        {
+          .hub_addr = daddr,
+          .hub_port = port_num
+        }
+      };
+
+      hcd_event_handler(&event, false);
+    }
+  }
+  else if (p_hub->port_status.change.over_current)
+  {
+    p_hub->port_status.change.over_current = 0;
+    feature = HUB_FEATURE_PORT_OVER_CURRENT_CHANGE;
+  }
+  else if (p_hub->port_status.change.reset)
+  {
+    p_hub->port_status.change.reset = 0;
+    feature = HUB_FEATURE_PORT_RESET_CHANGE;
+  }
+  // Other changes are: L1 state
+  // TODO clear change
+
+  if (feature)
+  {
+    hub_port_clear_feature(daddr, port_num, feature, port_clear_change_complete, 0);
+  }
+  else if (p_hub->port_status.change.connection)
   {
     // Port is powered and enabled
     //TU_VERIFY(port_status.status_current.port_power && port_status.status_current.port_enable, );
 
     // Acknowledge Port Connection Change
     hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_CONNECTION_CHANGE, connection_clear_conn_change_complete, 0);
-  }else
+  }
+  else
   {
-    // Clear other port status change interrupts. TODO Not currently handled - just cleared.
-    if (p_hub->port_status.change.port_enable)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_ENABLE_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.suspend)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_SUSPEND_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.over_current)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_OVER_CURRENT_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.reset)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_RESET_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    // Other changes are: L1 state
-    // TODO clear change
-
-    else
-    {
-      // prepare for next hub status
-      // TODO continue with status_change, or maybe we can do it again with status
-      hub_edpt_status_xfer(daddr);
-    }
+    status_change_done(daddr);
   }
 }
 
-static void connection_clear_conn_change_complete (tuh_xfer_t* xfer)
+static void hub_port_get_status_complete (tuh_xfer_t* xfer)
 {
-  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
+  // clear all changes of this port, connection change is handled last
+  port_clear_change_complete(xfer);
+}
 
+static void connection_clear_conn_change_complete (tuh_xfer_t* xfer)
+{
   uint8_t const daddr = xfer->daddr;
   hub_interface_t* p_hub = get_itf(daddr);
   uint8_t const port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
 
+  if (xfer->result != XFER_RESULT_SUCCESS)
+  {
+    status_change_done(daddr);
+    return;
+  }
+
   if ( p_hub->port_status.status.connection )
   {
     // Reset port if attach event
     hub_port_reset(daddr, port_num, connection_port_reset_complete, 0);
   }else
   {
-    // submit detach event
+    // submit detach event, usbh will re-arm hub status after processing it
+    p_hub->port_busy = 0;
+
     hcd_event_t event =
     {
       .rhport     = usbh_get_rhport(daddr),
@@ -476,13 +619,19 @@ static void connection_clear_conn_change_complete (tuh_xfer_t* xfer)
 
 static void connection_port_reset_complete (tuh_xfer_t* xfer)
 {
-  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
-
   uint8_t const daddr = xfer->daddr;
-  // hub_interface_t* p_hub = get_itf(daddr);
+  hub_interface_t* p_hub = get_itf(daddr);
   uint8_t const port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
 
-  // submit attach event
+  if (xfer->result != XFER_RESULT_SUCCESS)
+  {
+    status_change_done(daddr);
+    return;
+  }
+
+  // submit attach event, usbh will re-arm hub status when address 0 is free
+  p_hub->port_busy = 0;
+
   hcd_event_t event =
   {
     .rhport     = usbh_get_rhport(daddr),
@@ -42,6 +42,12 @@
  extern "C" {
 #endif
 
+// Select multi-TT alternate setting of high speed hubs that support it, providing one Transaction Translator
+// per port for full/low speed devices. Host controller driver must handle split transactions per TT.
+#ifndef CFG_TUH_HUB_MULTI_TT
+  #define CFG_TUH_HUB_MULTI_TT 0
+#endif
+
 //D1...D0: Logical Power Switching Mode
 //00:  Ganged power switching (all ports’power at
 //once)
@@ -186,6 +192,9 @@ bool hub_port_get_status    (uint8_t hub_addr, uint8_t hub_port, void* resp,
 // Get status from Interrupt endpoint
 bool hub_edpt_status_xfer(uint8_t dev_addr);
 
+// Check if hub operates with one Transaction Translator per port
+bool hub_is_multi_tt(uint8_t dev_addr);
+
 // Reset a port
 static inline bool hub_port_reset(uint8_t hub_addr, uint8_t hub_port,
                                   tuh_xfer_cb_t complete_cb, uintptr_t user_data)
@@ -40,6 +40,31 @@
   #define CFG_TUH_TASK_QUEUE_SZ   16
 #endif
 
+// Size of high priority event queue (0 to disable). Attach, remove, resume, control endpoint and hub status
+// events are put in this queue and always processed before pending (bulk) transfer completions, so that
+// enumeration is not delayed by a streaming device.
+#ifndef CFG_TUH_TASK_QUEUE_HI_SZ
+  #define CFG_TUH_TASK_QUEUE_HI_SZ   0
+#endif
+
+// Work budget of one tuh_task_ext() call to bound its latency in a bare-metal superloop: return after
+// processing this many events (0 is unlimited), or after this many microseconds measured with
+// tuh_task_time_us_cb() (0 is unlimited). Budget is checked between events, remaining ones are left in
+// queue and reported by tuh_task_event_ready().
+#ifndef CFG_TUH_TASK_EVENT_MAX
+  #define CFG_TUH_TASK_EVENT_MAX   0
+#endif
+
+#ifndef CFG_TUH_TASK_TIME_BUDGET_US
+  #define CFG_TUH_TASK_TIME_BUDGET_US   0
+#endif
+
+// Completion of non-control transfer that does not fit in the full event queue is kept per endpoint and processed
+// once queue is drained, instead of being dropped which leaves the endpoint busy forever.
+#ifndef CFG_TUH_TASK_XFER_RESCUE
+  #define CFG_TUH_TASK_XFER_RESCUE   0
+#endif
+
 #ifndef CFG_TUH_INTERFACE_MAX
   #define CFG_TUH_INTERFACE_MAX   8
 #endif
@@ -69,6 +94,52 @@ typedef struct {
   };
 } usbh_dev0_t;
 
+// Non-control endpoint, either embedded in device or allocated from a shared pool (CFG_TUH_ENDPOINT_POOL_NUM)
+typedef struct {
+  tu_edpt_state_t state;
+  uint8_t drv_id; // driver ( 0xff is invalid )
+
+#if CFG_TUH_ENDPOINT_POOL_NUM
+  uint8_t daddr; // 0 if not used
+  uint8_t ep_addr;
+#endif
+
+#if CFG_TUH_API_EDPT_XFER
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+#endif
+
+#if CFG_TUH_PERIODIC_BW
+  uint16_t bw_cost;  // bus time in byte times per (micro)frame, 0 if not periodic
+  uint8_t  bw_period;
+  uint8_t  bw_phase;
+#endif
+
+#if CFG_TUH_EDPT_STATS
+  tu_edpt_stats_state_t stats;
+#endif
+
+#if CFG_TUH_TASK_XFER_RESCUE
+  uint32_t rescue_len; // completion kept while event queue was full
+  #if CFG_TUH_EVENT_TIMESTAMP
+  uint32_t rescue_timestamp;
+  #endif
+  uint8_t  rescue_result;
+  volatile uint8_t rescue_pending;
+#endif
+
+#if CFG_TUSB_CAPTURE && CFG_TUSB_CAPTURE_PAYLOAD
+  uint8_t* capture_buf; // buffer of IN transfer in progress, captured on completion
+#endif
+
+#if CFG_TUH_SUSPEND
+  uint8_t* buffer; // current transfer, restarted when device is resumed
+  uint16_t buflen;
+  uint8_t  pm_restart : 1; // transfer is taken off the schedule (or not started) while device is suspended
+  uint8_t  pm_iso     : 1; // isochronous transfer can't be restarted
+#endif
+} usbh_edpt_t;
+
 typedef struct {
   // port, must be same layout as usbh_dev0_t
   uint8_t rhport;
@@ -82,10 +153,16 @@ typedef struct {
     volatile uint8_t addressed  : 1; // After SET_ADDR
     volatile uint8_t configured : 1; // After SET_CONFIG and all drivers are configured
     volatile uint8_t suspended  : 1; // Bus suspended
+             uint8_t remote_wakeup : 1; // Configuration supports remote wakeup
 
     // volatile uint8_t removing : 1; // Physically disconnected, waiting to be processed by usbh
   };
 
+#if CFG_TUH_SUSPEND
+  uint8_t pm_state;      // selective suspend state
+  usbh_timer_t pm_timer; // idle timeout, resume signaling and recovery
+#endif
+
   // Device Descriptor
   uint8_t  ep0_size;
 
@@ -96,25 +173,39 @@ typedef struct {
   uint8_t  i_product;
   uint8_t  i_serial;
 
+#if CFG_TUH_STRING_CACHE
+  // Strings prefetched in enumeration, UTF-8 and null-terminated, empty if not available
+  uint16_t langid;
+  char str_cache[3][CFG_TUH_STRING_CACHE_LEN]; // manufacturer, product, serial
+#endif
+
   // Configuration Descriptor
   // uint8_t interface_count; // bNumInterfaces alias
 
   // Endpoint & Interface
   uint8_t itf2drv[CFG_TUH_INTERFACE_MAX];  // map interface number to driver (0xff is invalid)
-  uint8_t ep2drv[CFG_TUH_ENDPOINT_MAX][2]; // map endpoint to driver ( 0xff is invalid ), can use only 4-bit each
-
-  tu_edpt_state_t ep_status[CFG_TUH_ENDPOINT_MAX][2];
-
-#if CFG_TUH_API_EDPT_XFER
+#if !CFG_TUH_ENDPOINT_POOL_NUM
   // TODO array can be CFG_TUH_ENDPOINT_MAX-1
-  struct {
-    tuh_xfer_cb_t complete_cb;
-    uintptr_t user_data;
-  }ep_callback[CFG_TUH_ENDPOINT_MAX][2];
+  usbh_edpt_t ep[CFG_TUH_ENDPOINT_MAX][2];
 #endif
-
 } usbh_device_t;
 
+#if CFG_TUH_SUSPEND
+// Selective suspend state of a device
+enum {
+  PM_ACTIVE = 0,
+  PM_SUSPENDING, // enabling remote wakeup, then suspending its port
+  PM_SUSPENDED,
+  PM_RESUMING,   // resume signaling on its port
+  PM_RECOVERY    // resume recovery before device is ready
+};
+
+enum {
+  PM_RESUME_SIGNAL_MS   = 20, // USB 2.0 7.1.7.7 TDRSMDN
+  PM_RESUME_RECOVERY_MS = 10  // USB 2.0 7.1.7.7 TRSMRCY
+};
+#endif
+
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
@@ -125,6 +216,17 @@ typedef struct {
 #endif
 
 static usbh_class_driver_t const usbh_class_drivers[] = {
+    #if CFG_TUH_CDC_RNDIS
+    {
+        DRIVER_NAME("RNDIS")
+        .init       = rndish_init,
+        .open       = rndish_open,
+        .set_config = rndish_set_config,
+        .xfer_cb    = rndish_xfer_cb,
+        .close      = rndish_close
+    },
+    #endif
+
     #if CFG_TUH_CDC
     {
         DRIVER_NAME("CDC")
@@ -169,14 +271,48 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
     },
     #endif
 
+    #if CFG_TUH_AUDIO
+    {
+        DRIVER_NAME("AUDIO")
+        .init       = audioh_init,
+        .open       = audioh_open,
+        .set_config = audioh_set_config,
+        .xfer_cb    = audioh_xfer_cb,
+        .close      = audioh_close
+    },
+    #endif
+
+    #if CFG_TUH_MIDI
+    {
+        DRIVER_NAME("MIDI")
+        .init       = midih_init,
+        .open       = midih_open,
+        .set_config = midih_set_config,
+        .xfer_cb    = midih_xfer_cb,
+        .close      = midih_close
+    },
+    #endif
+
+    #if CFG_TUH_NCM
+    {
+        DRIVER_NAME("NCM")
+        .init       = ncmh_init,
+        .open       = ncmh_open,
+        .set_config = ncmh_set_config,
+        .xfer_cb    = ncmh_xfer_cb,
+        .close      = ncmh_close
+    },
+    #endif
+
     #if CFG_TUH_VENDOR
     {
-      DRIVER_NAME("VENDOR")
-      .init       = cush_init,
-      .open       = cush_open_subtask,
-      .xfer_cb    = cush_isr,
-      .close      = cush_close
-    }
+        DRIVER_NAME("VENDOR")
+        .init       = vendorh_init,
+        .open       = vendorh_open,
+        .set_config = vendorh_set_config,
+        .xfer_cb    = vendorh_xfer_cb,
+        .close      = vendorh_close
+    },
     #endif
 };
 
@@ -201,6 +337,24 @@ static inline usbh_class_driver_t const *get_driver(uint8_t drv_id) {
   return driver;
 }
 
+// Invoke _member of driver (previously obtained by get_driver(_drv_id)) with _ret assignment (can be empty)
+#if CFG_TUH_DRIVER_STATIC_DISPATCH
+TU_VERIFY_STATIC(BUILTIN_DRIVER_COUNT <= TU_DRIVER_DISPATCH_MAX, "too many built-in drivers for static dispatch");
+
+#define DRIVER_CALL(_drv_id, _driver, _ret, _member, ...)                                                 \
+  do {                                                                                                    \
+    if ((_drv_id) >= _app_driver_count) {                                                                 \
+      TU_DRIVER_DISPATCH(usbh_class_drivers, BUILTIN_DRIVER_COUNT, (_drv_id) - _app_driver_count, _ret,   \
+                         _member, __VA_ARGS__)                                                            \
+    } else {                                                                                              \
+      _ret (_driver)->_member(__VA_ARGS__);                                                               \
+    }                                                                                                     \
+  } while (0)
+#else
+#define DRIVER_CALL(_drv_id, _driver, _ret, _member, ...) \
+  do { (void) (_drv_id); _ret (_driver)->_member(__VA_ARGS__); } while (0)
+#endif
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -226,19 +380,126 @@ static usbh_device_t _usbh_devices[TOTAL_DEVICES];
   #define _usbh_mutex   NULL
 #endif
 
-// Event queue
+// Event queue, TU_ATTR_FAST_DATA applies to its buffer
 // usbh_int_set is used as mutex in OS NONE config
-OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+TU_ATTR_FAST_DATA OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
 static osal_queue_t _usbh_q;
 
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
-static uint8_t _usbh_ctrl_buf[CFG_TUH_ENUMERATION_BUFSIZE];
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+TU_ATTR_FAST_DATA OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef_hi, CFG_TUH_TASK_QUEUE_HI_SZ, hcd_event_t);
+static osal_queue_t _usbh_q_hi;
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_high_priority_event(hcd_event_t const * event) {
+  switch (event->event_id) {
+    case HCD_EVENT_XFER_COMPLETE:
+      // control endpoint or hub status endpoint
+      return tu_edpt_number(event->xfer_complete.ep_addr) == 0 ||
+             (CFG_TUH_HUB > 0 && event->dev_addr > CFG_TUH_DEVICE_MAX);
+
+    case HCD_EVENT_DEVICE_ATTACH:
+    case HCD_EVENT_DEVICE_REMOVE:
+    case HCD_EVENT_DEVICE_RESUME:
+      return true;
+
+    default:
+      return false;
+  }
+}
+#endif
+
+// Number of events dropped because event queue is full
+static volatile uint32_t _usbh_q_overflow;
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+static volatile uint32_t _usbh_q_hi_overflow;
+#endif
+
+#if CFG_TUH_TASK_QUEUE_STATS
+static tusb_event_queue_stats_t _usbh_q_stats;
+TU_VERIFY_STATIC(HCD_EVENT_COUNT <= TUSB_EVENT_QUEUE_STATS_ID_NUM, "TUSB_EVENT_QUEUE_STATS_ID_NUM is too small");
+#endif
+
+#if CFG_TUH_TASK_XFER_RESCUE
+static volatile bool _usbh_xfer_rescue_any;
+#endif
+
+#if CFG_TUH_EVENT_TIMESTAMP
+static uint32_t _usbh_event_timestamp; // of event being dispatched by tuh_task()
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_ENUMERATION_NUM > 0, "CFG_TUH_ENUMERATION_NUM must be at least 1");
+
+// Enumeration of a device: it uses address 0 (dev0) until SET_ADDRESS is complete, then continues with its
+// new address, which allows next device to start its enumeration if there are more than one slot.
+typedef struct {
+  TUH_EPBUF_DEF(buf, CFG_TUH_ENUMERATION_BUFSIZE); // enumeration buffer
+
+  uint8_t rhport;
+  uint8_t hub_addr;
+  uint8_t hub_port;
+  uint8_t daddr;        // 0 while in addressing phase
+  uint8_t failed_count; // for retry
+  uint8_t phase;        // tuh_enum_phase_t
+  bool    used;
+
+  uint8_t delay_state; // enumeration state to resume when timer expires, 0 to retry failed transfer
+  usbh_timer_t timer;  // debounce delay or retry backoff
+
+  tuh_xfer_t retry_xfer;
+  tusb_control_request_t retry_setup;
+
+  #if CFG_TUH_DESC_CACHE
+  tusb_desc_device_t desc_device; // cache key
+  #endif
+} usbh_enum_t;
+
+CFG_TUH_MEM_SECTION static usbh_enum_t _usbh_enum[CFG_TUH_ENUMERATION_NUM];
+
+static usbh_timer_t* _usbh_timer_list; // running software timers
+
+#if CFG_TUH_DESC_CACHE && CFG_TUH_DESC_CACHE_NUM
+// Configuration descriptor cache, entry is replaced in least-recently-used order
+typedef struct {
+  tusb_desc_device_t desc_device;
+  uint16_t len;       // 0 if not used
+  uint32_t last_used;
+  uint8_t desc_config[CFG_TUH_DESC_CACHE_BUFSIZE];
+} usbh_desc_cache_t;
+
+static usbh_desc_cache_t _usbh_desc_cache[CFG_TUH_DESC_CACHE_NUM];
+static uint32_t _usbh_desc_cache_stamp;
+#endif
+
+// Configuration descriptor being parsed, with index of its interfaces and endpoints built in a single pass.
+// Offsets are from start of configuration descriptor.
+typedef struct {
+  uint16_t offset;    // interface descriptor
+  uint16_t len;       // interface and its descriptors until next interface or IAD
+  uint16_t cs_offset; // first class-specific descriptor, 0 if none
+  uint8_t  ep_first;  // first endpoint in ep_offset[]
+  uint8_t  ep_count;
+} usbh_cfg_index_itf_t;
+
+typedef struct {
+  uint8_t const* desc_cfg; // NULL if not parsing configuration
+  uint16_t total_len;
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  uint8_t itf_count;       // 0 if index is not available (too many descriptors)
+  uint8_t ep_count;
+  uint8_t last;            // last looked up interface, drivers tend to look up the same one repeatedly
+  usbh_cfg_index_itf_t itf[CFG_TUH_CONFIG_INDEX_ITF_MAX];
+  uint16_t ep_offset[CFG_TUH_CONFIG_INDEX_EP_MAX];
+#endif
+} usbh_cfg_index_t;
+
+static usbh_cfg_index_t _usbh_cfg_index;
 
 // Control transfers: since most controllers do not support multiple control transfers
 // on multiple devices concurrently and control transfers are not used much except for
-// enumeration, we will only execute control transfers one at a time.
-CFG_TUH_MEM_SECTION struct {
-  CFG_TUH_MEM_ALIGN tusb_control_request_t request;
+// enumeration, by default we only execute control transfers one at a time. With CFG_TUH_CTRL_XFER_NUM > 1
+// transfers of different devices run concurrently, each device still has at most one on-going transfer.
+typedef struct {
+  TUH_EPBUF_TYPE_DEF(tusb_control_request_t, request);
   uint8_t* buffer;
   tuh_xfer_cb_t complete_cb;
   uintptr_t user_data;
@@ -246,7 +507,87 @@ CFG_TUH_MEM_SECTION struct {
   uint8_t daddr;
   volatile uint8_t stage;
   volatile uint16_t actual_len;
-}_ctrl_xfer;
+} usbh_ctrl_xfer_t;
+
+CFG_TUH_MEM_SECTION static usbh_ctrl_xfer_t _ctrl_xfer[CFG_TUH_CTRL_XFER_NUM];
+
+// on-going control transfer of a device
+static usbh_ctrl_xfer_t* ctrl_xfer_find(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_CTRL_XFER_NUM; i++) {
+    usbh_ctrl_xfer_t* ctrl = &_ctrl_xfer[i];
+    if (ctrl->stage != CONTROL_STAGE_IDLE && ctrl->daddr == daddr) return ctrl;
+  }
+  return NULL;
+}
+
+// get an idle context for device, NULL if device already has a transfer or all are busy. Must hold usbh mutex
+static usbh_ctrl_xfer_t* ctrl_xfer_alloc(uint8_t daddr) {
+  if (ctrl_xfer_find(daddr)) return NULL;
+  for (uint8_t i = 0; i < CFG_TUH_CTRL_XFER_NUM; i++) {
+    if (_ctrl_xfer[i].stage == CONTROL_STAGE_IDLE) return &_ctrl_xfer[i];
+  }
+  return NULL;
+}
+
+// With parallel enumeration, control transfers of enumerating devices (and their drivers) overlap.
+// Transfers with complete callback are queued instead of failing when control pipe is busy.
+#if CFG_TUH_ENUMERATION_NUM > 1
+  #define CTRL_XFER_QUEUE_DEPTH   (CFG_TUH_ENUMERATION_NUM + CFG_TUH_HUB + 1)
+#else
+  #define CTRL_XFER_QUEUE_DEPTH   0
+#endif
+
+#if CTRL_XFER_QUEUE_DEPTH
+typedef struct {
+  tusb_control_request_t request;
+  uint8_t* buffer;
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+  uint8_t daddr;
+} usbh_ctrl_queued_t;
+
+static struct {
+  usbh_ctrl_queued_t xfer[CTRL_XFER_QUEUE_DEPTH];
+  uint8_t rd_idx;
+  uint8_t count;
+} _ctrl_queue;
+#endif
+
+// Non-control transfers submitted by tuh_edpt_xfer() while endpoint is busy
+#if CFG_TUH_API_EDPT_XFER && CFG_TUH_API_EDPT_XFER_QUEUE_NUM
+  #define EDPT_XFER_QUEUE_NUM   CFG_TUH_API_EDPT_XFER_QUEUE_NUM
+#else
+  #define EDPT_XFER_QUEUE_NUM   0
+#endif
+
+#if EDPT_XFER_QUEUE_NUM
+typedef struct {
+  uint8_t* buffer;
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+  uint32_t seq; // submission order
+  uint16_t buflen;
+  uint8_t daddr; // 0 if not used
+  uint8_t ep_addr;
+} usbh_edpt_queued_t;
+
+static struct {
+  usbh_edpt_queued_t xfer[EDPT_XFER_QUEUE_NUM];
+  uint32_t seq;
+} _edpt_queue;
+#endif
+
+#if CFG_TUH_ENDPOINT_POOL_NUM
+// Endpoints allocated when opened and freed when device is removed
+static usbh_edpt_t _usbh_edpt_pool[CFG_TUH_ENDPOINT_POOL_NUM];
+#endif
+
+#if CFG_TUH_PERIODIC_BW
+// Periodic (interrupt & isochronous) bandwidth accounting of the root bus: load of each (micro)frame slot
+// in byte times. Slot is a frame (1ms) on full-speed root port, microframe (125us) on high-speed one.
+#define PERIODIC_SLOT_NUM   32
+static uint16_t _usbh_periodic_load[PERIODIC_SLOT_NUM];
+#endif
 
 //------------- Helper Function -------------//
 
@@ -255,8 +596,134 @@ TU_ATTR_ALWAYS_INLINE static inline usbh_device_t* get_device(uint8_t dev_addr)
   return &_usbh_devices[dev_addr-1];
 }
 
-static bool enum_new_device(hcd_event_t* event);
+// Get endpoint of an device, NULL if not opened
+static usbh_edpt_t* get_edpt(uint8_t daddr, uint8_t ep_addr) {
+#if CFG_TUH_ENDPOINT_POOL_NUM
+  TU_VERIFY(daddr, NULL);
+  for (uint8_t i = 0; i < CFG_TUH_ENDPOINT_POOL_NUM; i++) {
+    usbh_edpt_t* ep = &_usbh_edpt_pool[i];
+    if (ep->daddr == daddr && ep->ep_addr == ep_addr) return ep;
+  }
+  return NULL;
+#else
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev, NULL);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum < CFG_TUH_ENDPOINT_MAX, NULL);
+  return &dev->ep[epnum][tu_edpt_dir(ep_addr)];
+#endif
+}
+
+// Get endpoint of an device, allocate it from pool if needed
+static usbh_edpt_t* edpt_alloc(uint8_t daddr, uint8_t ep_addr) {
+  usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+#if CFG_TUH_ENDPOINT_POOL_NUM
+  for (uint8_t i = 0; ep == NULL && i < CFG_TUH_ENDPOINT_POOL_NUM; i++) {
+    if (_usbh_edpt_pool[i].daddr == 0) {
+      ep = &_usbh_edpt_pool[i];
+      tu_memclr(ep, sizeof(usbh_edpt_t));
+      ep->daddr = daddr;
+      ep->ep_addr = ep_addr;
+      ep->drv_id = TUSB_INDEX_INVALID_8;
+    }
+  }
+  if (ep == NULL) {
+    TU_LOG_USBH("[%u] Endpoint pool is full\r\n", daddr);
+  }
+#endif
+  return ep;
+}
+
+#if CFG_TUH_PERIODIC_BW
+static void periodic_bw_free(usbh_edpt_t* ep) {
+  if (ep->bw_cost) {
+    for (uint8_t i = ep->bw_phase; i < PERIODIC_SLOT_NUM; i += ep->bw_period) {
+      _usbh_periodic_load[i] = (uint16_t) (_usbh_periodic_load[i] - ep->bw_cost);
+    }
+    ep->bw_cost = 0;
+  }
+}
+
+// Admission control for periodic endpoint: find the least loaded phase for its polling period and
+// reserve bus time in every slot polled. Return false if periodic budget would be exceeded.
+// Devices behind a transaction translator (full/low speed on high speed root) are not accounted.
+static bool periodic_bw_alloc(uint8_t daddr, usbh_edpt_t* ep, tusb_desc_endpoint_t const* desc_ep) {
+  periodic_bw_free(ep);
+
+  uint8_t const xfer_type = desc_ep->bmAttributes.xfer;
+  if (xfer_type != TUSB_XFER_INTERRUPT && xfer_type != TUSB_XFER_ISOCHRONOUS) return true;
+
+  bool const root_hs = (hcd_port_speed_get(usbh_get_rhport(daddr)) == TUSB_SPEED_HIGH);
+  tusb_speed_t const speed = tuh_speed_get(daddr);
+  if (root_hs != (speed == TUSB_SPEED_HIGH)) return true;
+
+  uint16_t const wmax = tu_le16toh(desc_ep->wMaxPacketSize);
+  uint32_t const data_time = (uint32_t) tu_edpt_packet_size(desc_ep) * 7 / 6; // worst case bit stuffing
+  uint32_t cost;
+  uint16_t budget;
+  uint32_t interval;
+
+  if (root_hs) {
+    // 80% of 7500 byte times per microframe, up to 3 transactions per microframe (high bandwidth)
+    cost = (data_time + (xfer_type == TUSB_XFER_ISOCHRONOUS ? 38 : 55)) * (1 + ((wmax >> 11) & 0x03));
+    budget = 6000;
+    interval = 1u << (tu_min8(tu_max8(desc_ep->bInterval, 1), 16) - 1);
+  } else {
+    // 90% of 1500 byte times per frame, low speed is 8 times slower
+    cost = data_time + (xfer_type == TUSB_XFER_ISOCHRONOUS ? 9 : 13);
+    if (speed == TUSB_SPEED_LOW) cost *= 8;
+    budget = 1350;
+    interval = (xfer_type == TUSB_XFER_ISOCHRONOUS) ? (1u << (tu_min8(tu_max8(desc_ep->bInterval, 1), 16) - 1)) : desc_ep->bInterval;
+  }
+
+  // polling period is the largest power of 2 that is within interval
+  uint8_t period = 1;
+  while (period < PERIODIC_SLOT_NUM && (uint32_t) (period << 1) <= interval) period <<= 1;
+
+  uint8_t best_phase = 0;
+  uint16_t best_load = UINT16_MAX;
+  for (uint8_t phase = 0; phase < period; phase++) {
+    uint16_t load = 0;
+    for (uint8_t i = phase; i < PERIODIC_SLOT_NUM; i += period) {
+      load = tu_max16(load, _usbh_periodic_load[i]);
+    }
+    if (load < best_load) {
+      best_load = load;
+      best_phase = phase;
+    }
+  }
+
+  if (best_load + cost > budget) {
+    TU_LOG_USBH("[%u] Not enough periodic bandwidth for EP %02X\r\n", daddr, desc_ep->bEndpointAddress);
+    return false;
+  }
+
+  ep->bw_cost = (uint16_t) cost;
+  ep->bw_period = period;
+  ep->bw_phase = best_phase;
+  for (uint8_t i = best_phase; i < PERIODIC_SLOT_NUM; i += period) {
+    _usbh_periodic_load[i] = (uint16_t) (_usbh_periodic_load[i] + cost);
+  }
+
+  return true;
+}
+#endif
+
+static usbh_enum_t* enum_get(uint8_t daddr);
+static usbh_enum_t* enum_alloc(void);
+static bool enum_new_device(usbh_enum_t* e, hcd_event_t* event);
+static uint32_t timer_remaining(void);
+static uint32_t timer_process(void);
+static void enum_phase(usbh_enum_t* e, tuh_enum_phase_t phase);
 static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
+
+#if CFG_TUH_SUSPEND
+static void pm_idle_restart(uint8_t daddr);
+static void pm_resume_detected(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
+#endif
+#if EDPT_XFER_QUEUE_NUM
+static void _edpt_xfer_start_queued(uint8_t daddr, uint8_t ep_addr);
+#endif
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 
@@ -269,8 +736,91 @@ TU_ATTR_WEAK void osal_task_delay(uint32_t msec) {
 }
 #endif
 
+#if CFG_TUH_TASK_QUEUE_STATS
+TU_ATTR_ALWAYS_INLINE static inline void queue_stats_posted(osal_queue_t q, uint16_t* count_max) {
+  _usbh_q_stats.posted++;
+  #if CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO
+  uint16_t const count = (uint16_t) tu_fifo_count(&q->ff);
+  if (count > *count_max) *count_max = count;
+  #else
+  (void) q;
+  (void) count_max;
+  #endif
+}
+#endif
+
+// Event queue is full: keep transfer completion per endpoint if possible, return true if it is rescued.
+// Endpoint can't complete again before its completion is processed, one slot per endpoint is enough.
+TU_ATTR_FAST_FUNC static bool queue_event_overflow(hcd_event_t const * event) {
+#if CFG_TUH_TASK_XFER_RESCUE
+  if (event->event_id == HCD_EVENT_XFER_COMPLETE && tu_edpt_number(event->xfer_complete.ep_addr) != 0) {
+    usbh_edpt_t* ep = get_edpt(event->dev_addr, event->xfer_complete.ep_addr);
+    if (ep && !ep->rescue_pending) {
+      ep->rescue_len = event->xfer_complete.len;
+      ep->rescue_result = event->xfer_complete.result;
+      #if CFG_TUH_EVENT_TIMESTAMP
+      ep->rescue_timestamp = event->timestamp;
+      #endif
+      ep->rescue_pending = 1;
+      _usbh_xfer_rescue_any = true;
+      #if CFG_TUH_TASK_QUEUE_STATS
+      _usbh_q_stats.xfer_rescued++;
+      #endif
+      return true;
+    }
+  }
+#endif
+
+#if CFG_TUH_TASK_QUEUE_STATS
+  _usbh_q_stats.overflow++;
+  if (event->event_id < TUSB_EVENT_QUEUE_STATS_ID_NUM) _usbh_q_stats.overflow_by_event[event->event_id]++;
+#else
+  (void) event;
+#endif
+  return false;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(hcd_event_t const * event, bool in_isr) {
+#if CFG_TUH_EVENT_TIMESTAMP
+  hcd_event_t stamped = *event;
+  stamped.timestamp = CFG_TUSB_EVENT_TIMESTAMP();
+  event = &stamped;
+#endif
+
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+  bool ret;
+  if (is_high_priority_event(event)) {
+    ret = osal_queue_send(_usbh_q_hi, event, in_isr);
+  #if CFG_TUH_TASK_QUEUE_STATS
+    if (ret) queue_stats_posted(_usbh_q_hi, &_usbh_q_stats.hi_count_max);
+  #endif
+    if (!ret && !(ret = queue_event_overflow(event))) _usbh_q_hi_overflow++;
+
+  #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
+    // usbh task blocks on normal queue, wake it up with an empty function call. If the normal queue is full,
+    // task is not blocked anyway.
+    hcd_event_t const event_wakeup = { .rhport = event->rhport, .event_id = USBH_EVENT_FUNC_CALL };
+    (void) osal_queue_send(_usbh_q, &event_wakeup, in_isr);
+  #endif
+  } else {
+    ret = osal_queue_send(_usbh_q, event, in_isr);
+  #if CFG_TUH_TASK_QUEUE_STATS
+    if (ret) queue_stats_posted(_usbh_q, &_usbh_q_stats.count_max);
+  #endif
+    if (!ret && !(ret = queue_event_overflow(event))) _usbh_q_overflow++;
+  }
+#else
   bool ret = osal_queue_send(_usbh_q, event, in_isr);
+  #if CFG_TUH_TASK_QUEUE_STATS
+  if (ret) queue_stats_posted(_usbh_q, &_usbh_q_stats.count_max);
+  #endif
+  if (!ret && !(ret = queue_event_overflow(event))) _usbh_q_overflow++;
+#endif
+#if CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO
+  TU_TRACE(TU_TRACE_EVENT_POST, event->event_id, tu_fifo_count(&_usbh_q->ff));
+#else
+  TU_TRACE(TU_TRACE_EVENT_POST, event->event_id, 0);
+#endif
   tuh_event_hook_cb(event->rhport, event->event_id, in_isr);
   return ret;
 }
@@ -279,6 +829,12 @@ TU_ATTR_ALWAYS_INLINE static inline bool queue_event(hcd_event_t const * event,
 // Device API
 //--------------------------------------------------------------------+
 
+bool tuh_suspended(uint8_t daddr) {
+  usbh_device_t *dev = get_device(daddr);
+  TU_VERIFY(dev);
+  return dev->suspended;
+}
+
 bool tuh_mounted(uint8_t dev_addr) {
   usbh_device_t *dev = get_device(dev_addr);
   TU_VERIFY(dev);
@@ -297,6 +853,31 @@ bool tuh_vid_pid_get(uint8_t dev_addr, uint16_t *vid, uint16_t *pid) {
   return true;
 }
 
+#if CFG_TUH_STRING_CACHE
+uint16_t tuh_langid_get(uint8_t daddr) {
+  usbh_device_t const* dev = get_device(daddr);
+  return (dev && dev->addressed) ? dev->langid : 0;
+}
+
+static char const* string_cache_get(uint8_t daddr, uint8_t idx) {
+  usbh_device_t const* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->addressed && dev->str_cache[idx][0], NULL);
+  return dev->str_cache[idx];
+}
+
+char const* tuh_manufacturer_string_get(uint8_t daddr) {
+  return string_cache_get(daddr, 0);
+}
+
+char const* tuh_product_string_get(uint8_t daddr) {
+  return string_cache_get(daddr, 1);
+}
+
+char const* tuh_serial_string_get(uint8_t daddr) {
+  return string_cache_get(daddr, 2);
+}
+#endif
+
 tusb_speed_t tuh_speed_get(uint8_t dev_addr) {
   usbh_device_t *dev = get_device(dev_addr);
   return (tusb_speed_t) (dev ? get_device(dev_addr)->speed : _dev0.speed);
@@ -329,9 +910,37 @@ bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
 }
 
 static void clear_device(usbh_device_t* dev) {
+#if CFG_TUH_ENDPOINT_POOL_NUM
+  // free endpoints of this device
+  uint8_t const daddr = (uint8_t) (dev - _usbh_devices + 1);
+  for (uint8_t i = 0; i < CFG_TUH_ENDPOINT_POOL_NUM; i++) {
+    usbh_edpt_t* ep = &_usbh_edpt_pool[i];
+    if (ep->daddr == daddr) {
+      #if CFG_TUH_PERIODIC_BW
+      periodic_bw_free(ep);
+      #endif
+      ep->daddr = 0;
+    }
+  }
+#elif CFG_TUH_PERIODIC_BW
+  for (uint8_t epnum = 0; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    periodic_bw_free(&dev->ep[epnum][0]);
+    periodic_bw_free(&dev->ep[epnum][1]);
+  }
+#endif
+
+#if CFG_TUH_SUSPEND
+  usbh_timer_stop(&dev->pm_timer);
+#endif
+
   tu_memclr(dev, sizeof(usbh_device_t));
   memset(dev->itf2drv, TUSB_INDEX_INVALID_8, sizeof(dev->itf2drv)); // invalid mapping
-  memset(dev->ep2drv , TUSB_INDEX_INVALID_8, sizeof(dev->ep2drv )); // invalid mapping
+
+#if !CFG_TUH_ENDPOINT_POOL_NUM
+  for (uint8_t epnum = 0; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    dev->ep[epnum][0].drv_id = dev->ep[epnum][1].drv_id = TUSB_INDEX_INVALID_8; // invalid mapping
+  }
+#endif
 }
 
 bool tuh_inited(void) {
@@ -354,6 +963,21 @@ bool tuh_init(uint8_t controller_id) {
   _usbh_q = osal_queue_create( &_usbh_qdef );
   TU_ASSERT(_usbh_q != NULL);
 
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+  _usbh_q_hi = osal_queue_create(&_usbh_qdef_hi);
+  TU_ASSERT(_usbh_q_hi != NULL);
+#endif
+  _usbh_q_overflow = 0;
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+  _usbh_q_hi_overflow = 0;
+#endif
+#if CFG_TUH_TASK_QUEUE_STATS
+  tu_varclr(&_usbh_q_stats);
+#endif
+#if CFG_TUH_TASK_XFER_RESCUE
+  _usbh_xfer_rescue_any = false;
+#endif
+
 #if OSAL_MUTEX_REQUIRED
   // Init mutex
   _usbh_mutex = osal_mutex_create(&_usbh_mutexdef);
@@ -368,7 +992,12 @@ bool tuh_init(uint8_t controller_id) {
   // Device
   tu_memclr(&_dev0, sizeof(_dev0));
   tu_memclr(_usbh_devices, sizeof(_usbh_devices));
-  tu_memclr(&_ctrl_xfer, sizeof(_ctrl_xfer));
+  tu_memclr(_ctrl_xfer, sizeof(_ctrl_xfer));
+  tu_memclr(_usbh_enum, sizeof(_usbh_enum));
+  _usbh_timer_list = NULL;
+#if CTRL_XFER_QUEUE_DEPTH
+  tu_memclr(&_ctrl_queue, sizeof(_ctrl_queue));
+#endif
 
   for(uint8_t i=0; i<TOTAL_DEVICES; i++) {
     clear_device(&_usbh_devices[i]);
@@ -385,6 +1014,11 @@ bool tuh_init(uint8_t controller_id) {
 
   _usbh_controller = controller_id;;
 
+#if CFG_TUSB_OTG
+  // dual-role port running as device: controller is switched to host mode by tusb_role_switch()
+  if (tusb_role_get(controller_id) == TUSB_ROLE_DEVICE) return true;
+#endif
+
   TU_ASSERT(hcd_init(controller_id));
   hcd_int_enable(controller_id);
 
@@ -394,10 +1028,97 @@ bool tuh_init(uint8_t controller_id) {
 bool tuh_task_event_ready(void) {
   // Skip if stack is not initialized
   if ( !tuh_inited() ) return false;
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+  if (!osal_queue_empty(_usbh_q_hi)) return true;
+#endif
+#if CFG_TUH_TASK_XFER_RESCUE
+  if (_usbh_xfer_rescue_any) return true;
+#endif
 
   return !osal_queue_empty(_usbh_q);
 }
 
+#if CFG_TUH_EVENT_TIMESTAMP
+uint32_t tuh_event_timestamp(void) {
+  return _usbh_event_timestamp;
+}
+#endif
+
+#if CFG_TUH_TASK_QUEUE_STATS
+bool tuh_event_queue_stats(tusb_event_queue_stats_t* stats) {
+  TU_VERIFY(stats);
+
+  // snapshot consistent with counters updated in ISR
+  usbh_int_set(false);
+  *stats = _usbh_q_stats;
+  usbh_int_set(true);
+
+  stats->queue_size = CFG_TUH_TASK_QUEUE_SZ;
+  stats->hi_queue_size = CFG_TUH_TASK_QUEUE_HI_SZ;
+
+  return true;
+}
+
+void tuh_event_queue_stats_clear(void) {
+  usbh_int_set(false);
+  tu_varclr(&_usbh_q_stats);
+  usbh_int_set(true);
+}
+#endif
+
+#if CFG_TUH_TASK_XFER_RESCUE
+// Take a transfer completion kept while event queue was full, it is processed after queued events
+static bool xfer_rescue_take(hcd_event_t* event) {
+  if (!_usbh_xfer_rescue_any) return false;
+  _usbh_xfer_rescue_any = false; // clear before scanning, ISR sets it again after marking an endpoint
+
+  for (uint8_t daddr = 1; daddr <= TOTAL_DEVICES; daddr++) {
+    usbh_device_t const* dev = get_device(daddr);
+    if (!dev->connected) continue;
+
+    for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+        usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+        if (ep && ep->rescue_pending) {
+          tu_memclr(event, sizeof(hcd_event_t));
+          event->rhport = dev->rhport;
+          event->event_id = HCD_EVENT_XFER_COMPLETE;
+          event->dev_addr = daddr;
+          event->xfer_complete.ep_addr = ep_addr;
+          event->xfer_complete.len = ep->rescue_len;
+          event->xfer_complete.result = ep->rescue_result;
+          #if CFG_TUH_EVENT_TIMESTAMP
+          event->timestamp = ep->rescue_timestamp;
+          #endif
+          ep->rescue_pending = 0;
+
+          _usbh_xfer_rescue_any = true; // there may be more
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+#endif
+
+void tuh_task_queue_overflow_get(uint32_t* normal, uint32_t* high) {
+  if (normal) *normal = _usbh_q_overflow;
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+  if (high) *high = _usbh_q_hi_overflow;
+#else
+  if (high) *high = 0;
+#endif
+}
+
+uint32_t tuh_task_next_deadline_ms(void) {
+  // Enumeration debounce delay needs tuh_task() to run when it expires, everything else is driven by host
+  // controller interrupt
+  return tuh_task_event_ready() ? 0 : timer_remaining();
+}
+
 /* USB Host Driver task
  * This top level thread manages all host controller event and delegates events to class-specific drivers.
  * This should be called periodically within the mainloop or rtos thread.
@@ -422,20 +1143,59 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
   // Skip if stack is not initialized
   if (!tuh_inited()) return;
 
+#if CFG_TUH_TASK_EVENT_MAX
+  uint32_t event_count = 0;
+#endif
+#if CFG_TUH_TASK_TIME_BUDGET_US
+  uint32_t const start_us = tuh_task_time_us_cb ? tuh_task_time_us_cb() : 0;
+#endif
+
   // Loop until there is no more events in the queue
   while (1) {
+    // run expired timers, don't wait for event longer than the next one
+    uint32_t const timer_remain = timer_process();
+    uint32_t const wait_ms = tu_min32(timeout_ms, timer_remain);
+
     hcd_event_t event;
-    if (!osal_queue_receive(_usbh_q, &event, timeout_ms)) return;
+#if CFG_TUH_TASK_QUEUE_HI_SZ
+    // always process high priority events first
+    if (!osal_queue_receive(_usbh_q_hi, &event, 0))
+#endif
+#if CFG_TUH_TASK_XFER_RESCUE
+    if (!osal_queue_receive(_usbh_q, &event, 0) && !xfer_rescue_take(&event))
+#endif
+    if (!osal_queue_receive(_usbh_q, &event, wait_ms)) return;
+#if CFG_TUH_EVENT_TIMESTAMP
+    _usbh_event_timestamp = event.timestamp;
+    uint32_t const latency = (uint32_t) CFG_TUSB_EVENT_TIMESTAMP() - event.timestamp;
+  #if CFG_TUH_TASK_QUEUE_STATS
+    // only updated by task, ISR does not touch these
+    _usbh_q_stats.dispatched++;
+    _usbh_q_stats.latency_total += latency;
+    if (latency > _usbh_q_stats.latency_max) _usbh_q_stats.latency_max = latency;
+  #endif
+    TU_TRACE(TU_TRACE_TASK_DISPATCH, event.event_id, tu_min32(latency, UINT16_MAX));
+    (void) latency;
+#else
+    TU_TRACE(TU_TRACE_TASK_DISPATCH, event.event_id, 0);
+#endif
 
     switch (event.event_id) {
-      case HCD_EVENT_DEVICE_ATTACH:
-        // due to the shared _usbh_ctrl_buf, we must complete enumerating one device before enumerating another one.
+      case HCD_EVENT_DEVICE_ATTACH: {
+        // only one device can be at address 0, and each enumerating device needs its own enumeration buffer.
+        // Attach is deferred until current device is addressed and an enumeration slot is available.
         // TODO better to have an separated queue for newly attached devices
-        if (_dev0.enumerating) {
+        usbh_enum_t* e = _dev0.enumerating ? NULL : enum_alloc();
+        if (e == NULL) {
           TU_LOG_USBH("[%u:] USBH Defer Attach until current enumeration complete\r\n", event.rhport);
 
-          bool is_empty = osal_queue_empty(_usbh_q);
+          bool is_empty = !tuh_task_event_ready();
+          #if CFG_TUH_TASK_QUEUE_HI_SZ
+          // defer to normal queue, otherwise it would be received again before anything else
+          (void) osal_queue_send(_usbh_q, &event, in_isr);
+          #else
           queue_event(&event, in_isr);
+          #endif
 
           if (is_empty) {
             // Exit if this is the only event in the queue, otherwise we may loop forever
@@ -444,9 +1204,10 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
         } else {
           TU_LOG_USBH("[%u:] USBH DEVICE ATTACH\r\n", event.rhport);
           _dev0.enumerating = 1;
-          enum_new_device(&event);
+          enum_new_device(e, &event);
         }
         break;
+      }
 
       case HCD_EVENT_DEVICE_REMOVE:
         TU_LOG_USBH("[%u:%u:%u] USBH DEVICE REMOVED\r\n", event.rhport, event.connection.hub_addr, event.connection.hub_port);
@@ -464,7 +1225,6 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
       case HCD_EVENT_XFER_COMPLETE: {
         uint8_t const ep_addr = event.xfer_complete.ep_addr;
         uint8_t const epnum = tu_edpt_number(ep_addr);
-        uint8_t const ep_dir = (uint8_t) tu_edpt_dir(ep_addr);
 
         TU_LOG_USBH("on EP %02X with %u bytes: %s\r\n", ep_addr, (unsigned int) event.xfer_complete.len, tu_str_xfer_result[event.xfer_complete.result]);
 
@@ -476,16 +1236,31 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
           usbh_device_t* dev = get_device(event.dev_addr);
           TU_VERIFY(dev && dev->connected,);
 
-          dev->ep_status[epnum][ep_dir].busy = 0;
-          dev->ep_status[epnum][ep_dir].claimed = 0;
-
           if (0 == epnum) {
             usbh_control_xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
           } else {
+            usbh_edpt_t* ep = get_edpt(event.dev_addr, ep_addr);
+            TU_ASSERT(ep,);
+            ep->state.busy = 0;
+            ep->state.claimed = 0;
+            #if CFG_TUH_EDPT_STATS
+            tu_edpt_stats_complete(&ep->stats, event.xfer_complete.result, event.xfer_complete.len);
+            #endif
+            #if CFG_TUSB_CAPTURE
+              #if CFG_TUSB_CAPTURE_PAYLOAD
+            uint8_t const* capture_data = ep->capture_buf;
+              #else
+            uint8_t const* capture_data = NULL;
+              #endif
+            TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_COMPLETE, event.rhport, event.dev_addr, ep_addr,
+                       (uint16_t) event.xfer_complete.len, event.xfer_complete.result, capture_data,
+                       (uint16_t) event.xfer_complete.len);
+            #endif
+
             // Prefer application callback over built-in one if available. This occurs when tuh_edpt_xfer() is used
             // with enabled driver e.g HID endpoint
             #if CFG_TUH_API_EDPT_XFER
-            tuh_xfer_cb_t const complete_cb = dev->ep_callback[epnum][ep_dir].complete_cb;
+            tuh_xfer_cb_t const complete_cb = ep->complete_cb;
             if ( complete_cb ) {
               // re-construct xfer info
               tuh_xfer_t xfer = {
@@ -496,18 +1271,26 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
                   .buflen      = 0,    // not available
                   .buffer      = NULL, // not available
                   .complete_cb = complete_cb,
-                  .user_data   = dev->ep_callback[epnum][ep_dir].user_data
+                  .user_data   = ep->user_data
               };
+
+              #if EDPT_XFER_QUEUE_NUM
+              // start queued transfer first to minimize gap, follow-up transfer from the callback is queued behind
+              _edpt_xfer_start_queued(event.dev_addr, ep_addr);
+              #endif
+
               complete_cb(&xfer);
             }else
             #endif
             {
-              uint8_t drv_id = dev->ep2drv[epnum][ep_dir];
+              uint8_t drv_id = ep->drv_id;
               usbh_class_driver_t const* driver = get_driver(drv_id);
               if (driver) {
                 TU_LOG_USBH("%s xfer callback\r\n", driver->name);
-                driver->xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result,
-                                event.xfer_complete.len);
+                TU_TRACE(TU_TRACE_XFER_CB_START, ep_addr, event.xfer_complete.len);
+                DRIVER_CALL(drv_id, driver, , xfer_cb, event.dev_addr, ep_addr,
+                            (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
+                TU_TRACE(TU_TRACE_XFER_CB_END, ep_addr, 0);
               } else {
                 // no driver/callback responsible for this transfer
                 TU_ASSERT(false,);
@@ -515,9 +1298,18 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
             }
           }
         }
+        #if CFG_TUH_SUSPEND
+        pm_idle_restart(event.dev_addr);
+        #endif
         break;
       }
 
+      #if CFG_TUH_SUSPEND
+      case HCD_EVENT_DEVICE_RESUME:
+        pm_resume_detected(event.rhport, event.connection.hub_addr, event.connection.hub_port);
+        break;
+      #endif
+
       case USBH_EVENT_FUNC_CALL:
         if (event.func_call.func) event.func_call.func(event.func_call.param);
         break;
@@ -526,9 +1318,17 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
         break;
     }
 
+#if CFG_TUH_TASK_EVENT_MAX
+    // leave remaining events for next call
+    if (++event_count >= CFG_TUH_TASK_EVENT_MAX) return;
+#endif
+#if CFG_TUH_TASK_TIME_BUDGET_US
+    if (tuh_task_time_us_cb && (tuh_task_time_us_cb() - start_us) >= CFG_TUH_TASK_TIME_BUDGET_US) return;
+#endif
+
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbh_q)) return;
+    if (!tuh_task_event_ready()) return;
 #endif
   }
 }
@@ -554,27 +1354,64 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
   } else {
     usbh_device_t const* dev = get_device(daddr);
     if (dev && dev->connected == 0) return false;
+
+    #if CFG_TUH_SUSPEND
+    // resume suspended device, control transfer should be retried when it is ready (tuh_resume_cb).
+    // Request to enable remote wakeup is sent while suspending.
+    if (dev && dev->suspended && dev->pm_state != PM_SUSPENDING) {
+      (void) tuh_resume(daddr);
+      return false;
+    }
+    #endif
   }
 
+#if CTRL_XFER_QUEUE_DEPTH
+  bool queued = false;
+#elif CFG_TUH_CTRL_XFER_NUM == 1
   // pre-check to help reducing mutex lock
-  TU_VERIFY(_ctrl_xfer.stage == CONTROL_STAGE_IDLE);
+  TU_VERIFY(_ctrl_xfer[0].stage == CONTROL_STAGE_IDLE);
+#endif
   (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
 
-  bool const is_idle = (_ctrl_xfer.stage == CONTROL_STAGE_IDLE);
+  usbh_ctrl_xfer_t* ctrl = ctrl_xfer_alloc(daddr);
+  bool const is_idle = (ctrl != NULL);
   if (is_idle) {
-    _ctrl_xfer.stage       = CONTROL_STAGE_SETUP;
-    _ctrl_xfer.daddr       = daddr;
-    _ctrl_xfer.actual_len  = 0;
-
-    _ctrl_xfer.request     = (*xfer->setup);
-    _ctrl_xfer.buffer      = xfer->buffer;
-    _ctrl_xfer.complete_cb = xfer->complete_cb;
-    _ctrl_xfer.user_data   = xfer->user_data;
+    ctrl->stage       = CONTROL_STAGE_SETUP;
+    ctrl->daddr       = daddr;
+    ctrl->actual_len  = 0;
+
+    ctrl->request     = (*xfer->setup);
+    ctrl->buffer      = xfer->buffer;
+    ctrl->complete_cb = xfer->complete_cb;
+    ctrl->user_data   = xfer->user_data;
+  }
+#if CTRL_XFER_QUEUE_DEPTH
+  else if (xfer->complete_cb && _ctrl_queue.count < CTRL_XFER_QUEUE_DEPTH) {
+    // queue and start when control pipe is idle
+    uint8_t const wr_idx = (uint8_t) ((_ctrl_queue.rd_idx + _ctrl_queue.count) % CTRL_XFER_QUEUE_DEPTH);
+    usbh_ctrl_queued_t* qxfer = &_ctrl_queue.xfer[wr_idx];
+
+    qxfer->request     = (*xfer->setup);
+    qxfer->buffer      = xfer->buffer;
+    qxfer->complete_cb = xfer->complete_cb;
+    qxfer->user_data   = xfer->user_data;
+    qxfer->daddr       = daddr;
+
+    _ctrl_queue.count++;
+    queued = true;
   }
+#endif
 
   (void) osal_mutex_unlock(_usbh_mutex);
 
-  TU_VERIFY(is_idle);
+#if CTRL_XFER_QUEUE_DEPTH
+  if (queued) {
+    TU_LOG_USBH("[%u] Control transfer queued\r\n", daddr);
+    return true;
+  }
+#endif
+
+  TU_VERIFY(ctrl);
   const uint8_t rhport = usbh_get_rhport(daddr);
 
   TU_LOG_USBH("[%u:%u] %s: ", rhport, daddr,
@@ -582,18 +1419,20 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
                   tu_str_std_request[xfer->setup->bRequest] : "Class Request");
   TU_LOG_BUF_USBH(xfer->setup, 8);
 
+  TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_SETUP, rhport, daddr, 0, 8, XFER_RESULT_SUCCESS, &ctrl->request, 8);
+
   if (xfer->complete_cb) {
-    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t const*) &_ctrl_xfer.request) );
+    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t const*) &ctrl->request) );
   }else {
     // blocking if complete callback is not provided
     // change callback to internal blocking, and result as user argument
     volatile xfer_result_t result = XFER_RESULT_INVALID;
 
     // use user_data to point to xfer_result_t
-    _ctrl_xfer.user_data   = (uintptr_t) &result;
-    _ctrl_xfer.complete_cb = _control_blocking_complete_cb;
+    ctrl->user_data   = (uintptr_t) &result;
+    ctrl->complete_cb = _control_blocking_complete_cb;
 
-    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t*) &_ctrl_xfer.request) );
+    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t*) &ctrl->request) );
 
     while (result == XFER_RESULT_INVALID) {
       // Note: this can be called within an callback ie. part of tuh_task()
@@ -609,35 +1448,114 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
       *((xfer_result_t*) xfer->user_data) = result;
     }
     xfer->result     = result;
-    xfer->actual_len = _ctrl_xfer.actual_len;
+    xfer->actual_len = ctrl->actual_len;
   }
 
   return true;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline void _set_control_xfer_stage(uint8_t stage) {
+TU_ATTR_ALWAYS_INLINE static inline void _set_control_xfer_stage(usbh_ctrl_xfer_t* ctrl, uint8_t stage) {
   (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
-  _ctrl_xfer.stage = stage;
+  ctrl->stage = stage;
   (void) osal_mutex_unlock(_usbh_mutex);
 }
 
-static void _control_xfer_complete(uint8_t daddr, xfer_result_t result) {
+// abort (without HCD) on-going control transfer of a device
+static void _control_xfer_reset(uint8_t daddr) {
+  usbh_ctrl_xfer_t* ctrl = ctrl_xfer_find(daddr);
+  if (ctrl) _set_control_xfer_stage(ctrl, CONTROL_STAGE_IDLE);
+}
+
+#if CTRL_XFER_QUEUE_DEPTH
+// Start queued control transfers in order, skipping devices that already have one on-going
+static void _control_xfer_start_queued(void) {
+  while (1) {
+    usbh_ctrl_xfer_t* ctrl = NULL;
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+    for (uint8_t i = 0; i < _ctrl_queue.count; i++) {
+      uint8_t const idx = (uint8_t) ((_ctrl_queue.rd_idx + i) % CTRL_XFER_QUEUE_DEPTH);
+      usbh_ctrl_queued_t const* qxfer = &_ctrl_queue.xfer[idx];
+
+      ctrl = ctrl_xfer_alloc(qxfer->daddr);
+      if (ctrl) {
+        ctrl->stage       = CONTROL_STAGE_SETUP;
+        ctrl->daddr       = qxfer->daddr;
+        ctrl->actual_len  = 0;
+        ctrl->request     = qxfer->request;
+        ctrl->buffer      = qxfer->buffer;
+        ctrl->complete_cb = qxfer->complete_cb;
+        ctrl->user_data   = qxfer->user_data;
+
+        // remove entry, keeping order of the others
+        for (uint8_t j = i; j > 0; j--) {
+          _ctrl_queue.xfer[(_ctrl_queue.rd_idx + j) % CTRL_XFER_QUEUE_DEPTH] =
+              _ctrl_queue.xfer[(_ctrl_queue.rd_idx + j - 1) % CTRL_XFER_QUEUE_DEPTH];
+        }
+        _ctrl_queue.rd_idx = (uint8_t) ((_ctrl_queue.rd_idx + 1) % CTRL_XFER_QUEUE_DEPTH);
+        _ctrl_queue.count--;
+        break;
+      }
+    }
+
+    (void) osal_mutex_unlock(_usbh_mutex);
+
+    if (!ctrl) return;
+
+    uint8_t const daddr = ctrl->daddr;
+    uint8_t const rhport = usbh_get_rhport(daddr);
+    TU_LOG_USBH("[%u:%u] Start queued control transfer\r\n", rhport, daddr);
+    TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_SETUP, rhport, daddr, 0, 8, XFER_RESULT_SUCCESS, &ctrl->request, 8);
+
+    if (hcd_setup_send(rhport, daddr, (uint8_t const*) &ctrl->request)) {
+      if (CFG_TUH_CTRL_XFER_NUM == 1) return;
+    } else {
+      // failed to start, try next one
+      _set_control_xfer_stage(ctrl, CONTROL_STAGE_IDLE);
+    }
+  }
+}
+
+// Remove queued control transfers of a device
+static void _control_xfer_purge_queued(uint8_t daddr) {
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < _ctrl_queue.count; i++) {
+    usbh_ctrl_queued_t const* qxfer = &_ctrl_queue.xfer[(_ctrl_queue.rd_idx + i) % CTRL_XFER_QUEUE_DEPTH];
+    if (qxfer->daddr != daddr) {
+      _ctrl_queue.xfer[(_ctrl_queue.rd_idx + count) % CTRL_XFER_QUEUE_DEPTH] = *qxfer;
+      count++;
+    }
+  }
+  _ctrl_queue.count = count;
+
+  (void) osal_mutex_unlock(_usbh_mutex);
+}
+#endif
+
+static void _control_xfer_complete(usbh_ctrl_xfer_t* ctrl, xfer_result_t result) {
   TU_LOG_USBH("\r\n");
 
   // duplicate xfer since user can execute control transfer within callback
-  tusb_control_request_t const request = _ctrl_xfer.request;
+  tusb_control_request_t const request = ctrl->request;
   tuh_xfer_t xfer_temp = {
-    .daddr       = daddr,
+    .daddr       = ctrl->daddr,
     .ep_addr     = 0,
     .result      = result,
     .setup       = &request,
-    .actual_len  = (uint32_t) _ctrl_xfer.actual_len,
-    .buffer      = _ctrl_xfer.buffer,
-    .complete_cb = _ctrl_xfer.complete_cb,
-    .user_data   = _ctrl_xfer.user_data
+    .actual_len  = (uint32_t) ctrl->actual_len,
+    .buffer      = ctrl->buffer,
+    .complete_cb = ctrl->complete_cb,
+    .user_data   = ctrl->user_data
   };
 
-  _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+  _set_control_xfer_stage(ctrl, CONTROL_STAGE_IDLE);
+
+#if CTRL_XFER_QUEUE_DEPTH
+  // start queued transfer first so that follow-up transfer from the callback is queued behind others
+  _control_xfer_start_queued();
+#endif
 
   if (xfer_temp.complete_cb) {
     xfer_temp.complete_cb(&xfer_temp);
@@ -648,21 +1566,30 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
   (void) ep_addr;
 
   const uint8_t rhport = usbh_get_rhport(daddr);
-  tusb_control_request_t const * request = &_ctrl_xfer.request;
+  usbh_ctrl_xfer_t* ctrl = ctrl_xfer_find(daddr);
+  TU_VERIFY(ctrl);
+  tusb_control_request_t const * request = &ctrl->request;
+
+  TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_COMPLETE, rhport, daddr, ep_addr, (uint16_t) xferred_bytes, result,
+             (ctrl->stage == CONTROL_STAGE_DATA && tu_edpt_dir(ep_addr) == TUSB_DIR_IN) ? ctrl->buffer : NULL,
+             (uint16_t) xferred_bytes);
 
   if (XFER_RESULT_SUCCESS != result) {
     TU_LOG_USBH("[%u:%u] Control %s, xferred_bytes = %lu\r\n", rhport, daddr, result == XFER_RESULT_STALLED ? "STALLED" : "FAILED", xferred_bytes);
     TU_LOG_BUF_USBH(request, 8);
 
     // terminate transfer if any stage failed
-    _control_xfer_complete(daddr, result);
+    _control_xfer_complete(ctrl, result);
   }else {
-    switch(_ctrl_xfer.stage) {
+    switch(ctrl->stage) {
       case CONTROL_STAGE_SETUP:
         if (request->wLength) {
           // DATA stage: initial data toggle is always 1
-          _set_control_xfer_stage(CONTROL_STAGE_DATA);
-          TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), _ctrl_xfer.buffer, request->wLength) );
+          _set_control_xfer_stage(ctrl, CONTROL_STAGE_DATA);
+          TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_SUBMIT, rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction),
+                     request->wLength, XFER_RESULT_SUCCESS,
+                     request->bmRequestType_bit.direction == TUSB_DIR_OUT ? ctrl->buffer : NULL, request->wLength);
+          TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), ctrl->buffer, request->wLength) );
           return true;
         }
         TU_ATTR_FALLTHROUGH;
@@ -670,13 +1597,15 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
       case CONTROL_STAGE_DATA:
         if (request->wLength) {
           TU_LOG_USBH("[%u:%u] Control data:\r\n", rhport, daddr);
-          TU_LOG_MEM_USBH(_ctrl_xfer.buffer, xferred_bytes, 2);
+          TU_LOG_MEM_USBH(ctrl->buffer, xferred_bytes, 2);
         }
 
-        _ctrl_xfer.actual_len = (uint16_t) xferred_bytes;
+        ctrl->actual_len = (uint16_t) xferred_bytes;
 
         // ACK stage: toggle is always 1
-        _set_control_xfer_stage(CONTROL_STAGE_ACK);
+        _set_control_xfer_stage(ctrl, CONTROL_STAGE_ACK);
+        TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_SUBMIT, rhport, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction),
+                   0, XFER_RESULT_SUCCESS, NULL, 0);
         TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction), NULL, 0) );
         break;
 
@@ -691,7 +1620,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
           }
         }
 
-        _control_xfer_complete(daddr, result);
+        _control_xfer_complete(ctrl, result);
         break;
       }
 
@@ -706,12 +1635,117 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
 //
 //--------------------------------------------------------------------+
 
+#if EDPT_XFER_QUEUE_NUM
+// Add transfer to queue, return false if queue is full
+static bool _edpt_xfer_enqueue(tuh_xfer_t const* xfer) {
+  bool ret = false;
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  for (uint8_t i = 0; i < EDPT_XFER_QUEUE_NUM; i++) {
+    usbh_edpt_queued_t* qxfer = &_edpt_queue.xfer[i];
+    if (qxfer->daddr == 0) {
+      qxfer->daddr       = xfer->daddr;
+      qxfer->ep_addr     = xfer->ep_addr;
+      qxfer->buffer      = xfer->buffer;
+      qxfer->buflen      = (uint16_t) xfer->buflen;
+      qxfer->complete_cb = xfer->complete_cb;
+      qxfer->user_data   = xfer->user_data;
+      qxfer->seq         = _edpt_queue.seq++;
+      ret = true;
+      break;
+    }
+  }
+
+  (void) osal_mutex_unlock(_usbh_mutex);
+  return ret;
+}
+
+// Start oldest queued transfer of an endpoint if any
+static void _edpt_xfer_start_queued(uint8_t daddr, uint8_t ep_addr) {
+  while (1) {
+    usbh_edpt_queued_t qxfer = { .daddr = 0 };
+
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    usbh_edpt_queued_t* oldest = NULL;
+    for (uint8_t i = 0; i < EDPT_XFER_QUEUE_NUM; i++) {
+      usbh_edpt_queued_t* cur = &_edpt_queue.xfer[i];
+      // unsigned difference to handle sequence wrap around
+      if (cur->daddr == daddr && cur->ep_addr == ep_addr &&
+          (oldest == NULL || (int32_t) (cur->seq - oldest->seq) < 0)) {
+        oldest = cur;
+      }
+    }
+    if (oldest) {
+      qxfer = *oldest;
+      oldest->daddr = 0;
+    }
+    (void) osal_mutex_unlock(_usbh_mutex);
+
+    if (qxfer.daddr == 0) return;
+
+    if (usbh_edpt_claim(daddr, ep_addr)) {
+      if (usbh_edpt_xfer_with_callback(daddr, ep_addr, qxfer.buffer, qxfer.buflen,
+                                       qxfer.complete_cb, qxfer.user_data)) {
+        return;
+      }
+      usbh_edpt_release(daddr, ep_addr);
+    } else {
+      // endpoint is already used again (e.g by its class driver): put transfer back, retry on next completion
+      (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+      for (uint8_t i = 0; i < EDPT_XFER_QUEUE_NUM; i++) {
+        if (_edpt_queue.xfer[i].daddr == 0) {
+          _edpt_queue.xfer[i] = qxfer;
+          break;
+        }
+      }
+      (void) osal_mutex_unlock(_usbh_mutex);
+      return;
+    }
+
+    // failed to start, report error and try next one
+    TU_LOG_USBH("[%u] Failed to start queued transfer on EP %02X\r\n", daddr, ep_addr);
+    tuh_xfer_t xfer = {
+      .daddr       = daddr,
+      .ep_addr     = ep_addr,
+      .result      = XFER_RESULT_FAILED,
+      .actual_len  = 0,
+      .buflen      = qxfer.buflen,
+      .buffer      = qxfer.buffer,
+      .complete_cb = qxfer.complete_cb,
+      .user_data   = qxfer.user_data
+    };
+    qxfer.complete_cb(&xfer);
+  }
+}
+
+// Remove queued transfers of a device (ep_addr = 0 for all endpoints)
+static void _edpt_xfer_purge_queued(uint8_t daddr, uint8_t ep_addr) {
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  for (uint8_t i = 0; i < EDPT_XFER_QUEUE_NUM; i++) {
+    usbh_edpt_queued_t* qxfer = &_edpt_queue.xfer[i];
+    if (qxfer->daddr == daddr && (ep_addr == 0 || qxfer->ep_addr == ep_addr)) {
+      qxfer->daddr = 0;
+    }
+  }
+  (void) osal_mutex_unlock(_usbh_mutex);
+}
+#endif
+
 bool tuh_edpt_xfer(tuh_xfer_t* xfer) {
   uint8_t const daddr = xfer->daddr;
   uint8_t const ep_addr = xfer->ep_addr;
 
   TU_VERIFY(daddr && ep_addr);
+
+  #if EDPT_XFER_QUEUE_NUM
+  // endpoint is busy: queue transfer with callback behind the current one
+  if (!usbh_edpt_claim(daddr, ep_addr)) {
+    TU_VERIFY(xfer->complete_cb && get_device(daddr) && get_device(daddr)->connected);
+    return _edpt_xfer_enqueue(xfer);
+  }
+  #else
   TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+  #endif
 
   if (!usbh_edpt_xfer_with_callback(daddr, ep_addr, xfer->buffer, (uint16_t) xfer->buflen,
                                     xfer->complete_cb, xfer->user_data)) {
@@ -722,6 +1756,47 @@ bool tuh_edpt_xfer(tuh_xfer_t* xfer) {
   return true;
 }
 
+#if CFG_TUH_API_EDPT_XFER
+bool tuh_edpt_iso_xfer(tuh_xfer_t* xfer, tuh_iso_packet_t* packets, uint16_t packet_count) {
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const ep_addr = xfer->ep_addr;
+
+  TU_VERIFY(daddr && tu_edpt_number(ep_addr) && xfer->complete_cb && packets && packet_count);
+  TU_VERIFY(hcd_edpt_iso_xfer); // host controller does not support isochronous
+
+  usbh_device_t* dev = get_device(daddr);
+  usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+  TU_VERIFY(dev && ep);
+  TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+
+  // Set busy first since the transfer can be complete before hcd_edpt_iso_xfer() returns
+  ep->state.busy  = 1;
+  ep->complete_cb = xfer->complete_cb;
+  ep->user_data   = xfer->user_data;
+  #if CFG_TUH_SUSPEND
+  ep->pm_iso = 1;
+  #endif
+
+  if (!hcd_edpt_iso_xfer(dev->rhport, daddr, ep_addr, xfer->buffer, packets, packet_count)) {
+    ep->state.busy = 0;
+    usbh_edpt_release(daddr, ep_addr);
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+#if CFG_TUH_EDPT_STATS
+bool tuh_edpt_stats_get(uint8_t daddr, uint8_t ep_addr, tusb_edpt_stats_t* stats) {
+  TU_VERIFY(tu_edpt_number(ep_addr) && stats);
+  usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+  TU_VERIFY(ep);
+  *stats = ep->stats.stats;
+  return true;
+}
+#endif
+
 bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(daddr);
   TU_VERIFY(dev);
@@ -729,21 +1804,38 @@ bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr) {
   TU_LOG_USBH("[%u] Aborted transfer on EP %02X\r\n", daddr, ep_addr);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   if ( epnum == 0 ) {
-    // control transfer: only 1 control at a time, check if we are aborting the current one
-    TU_VERIFY(daddr == _ctrl_xfer.daddr && _ctrl_xfer.stage != CONTROL_STAGE_IDLE);
+    // control transfer: only 1 control at a time per device, check if we are aborting the current one
+    usbh_ctrl_xfer_t* ctrl = ctrl_xfer_find(daddr);
+    TU_VERIFY(ctrl);
     TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
     // reset control transfer state to idle
-    _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+    _set_control_xfer_stage(ctrl, CONTROL_STAGE_IDLE);
+    #if CTRL_XFER_QUEUE_DEPTH
+    _control_xfer_start_queued();
+    #endif
   } else {
+    #if EDPT_XFER_QUEUE_NUM
+    // also drop transfers queued behind the current one
+    _edpt_xfer_purge_queued(daddr, ep_addr);
+    #endif
+
     // non-control skip if not busy
-    TU_VERIFY(dev->ep_status[epnum][dir].busy);
-    TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
+    usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+    TU_VERIFY(ep && ep->state.busy);
+    #if CFG_TUH_SUSPEND
+    if (ep->pm_restart) {
+      // transfer is not on the schedule while device is suspended
+      ep->pm_restart = 0;
+    } else
+    #endif
+    {
+      TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
+    }
     // mark as ready and release endpoint if transfer is aborted
-    dev->ep_status[epnum][dir].busy = false;
-    tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex);
+    ep->state.busy = false;
+    tu_edpt_release(&ep->state, _usbh_mutex);
   }
 
   return true;
@@ -758,8 +1850,10 @@ uint8_t usbh_get_rhport(uint8_t dev_addr) {
   return dev ? dev->rhport : _dev0.rhport;
 }
 
-uint8_t *usbh_get_enum_buf(void) {
-  return _usbh_ctrl_buf;
+uint8_t *usbh_get_enum_buf(uint8_t daddr) {
+  // buffer of device being enumerated, otherwise the first one is shared
+  usbh_enum_t* e = enum_get(daddr);
+  return e ? e->buf : _usbh_enum[0].buf;
 }
 
 void usbh_int_set(bool enabled) {
@@ -780,6 +1874,58 @@ void usbh_defer_func(osal_task_func_t func, void *param, bool in_isr) {
   queue_event(&event, in_isr);
 }
 
+//--------------------------------------------------------------------+
+// Timer
+//--------------------------------------------------------------------+
+void usbh_timer_start(usbh_timer_t* timer, uint32_t ms, usbh_timer_cb_t cb, uintptr_t arg) {
+  usbh_timer_stop(timer);
+
+  timer->cb    = cb;
+  timer->arg   = arg;
+  timer->ms    = ms;
+  timer->start = hcd_frame_number(_usbh_controller);
+  timer->next  = _usbh_timer_list;
+  _usbh_timer_list = timer;
+}
+
+void usbh_timer_stop(usbh_timer_t* timer) {
+  for (usbh_timer_t** pp = &_usbh_timer_list; *pp; pp = &(*pp)->next) {
+    if (*pp == timer) {
+      *pp = timer->next;
+      timer->next = NULL;
+      return;
+    }
+  }
+}
+
+static uint32_t timer_remaining(void) {
+  uint32_t remain = OSAL_TIMEOUT_WAIT_FOREVER;
+  if (_usbh_timer_list) {
+    uint32_t const now = hcd_frame_number(_usbh_controller);
+    for (usbh_timer_t const* t = _usbh_timer_list; t; t = t->next) {
+      uint32_t const elapsed = now - t->start;
+      remain = tu_min32(remain, (elapsed >= t->ms) ? 0 : (t->ms - elapsed));
+    }
+  }
+  return remain;
+}
+
+// Invoke callback of expired timers, return ms until next one expires
+static uint32_t timer_process(void) {
+  usbh_timer_t* t = _usbh_timer_list;
+  while (t) {
+    if ((hcd_frame_number(_usbh_controller) - t->start) >= t->ms) {
+      // unlink before invoking since callback can restart it or modify the list: rescan from head
+      usbh_timer_stop(t);
+      t->cb(t->arg);
+      t = _usbh_timer_list;
+    } else {
+      t = t->next;
+    }
+  }
+  return timer_remaining();
+}
+
 //--------------------------------------------------------------------+
 // Endpoint API
 //--------------------------------------------------------------------+
@@ -790,10 +1936,10 @@ bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(dev_addr);
   TU_ASSERT(dev && dev->connected);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
+  usbh_edpt_t* ep = get_edpt(dev_addr, ep_addr);
+  TU_ASSERT(ep);
 
-  TU_VERIFY(tu_edpt_claim(&dev->ep_status[epnum][dir], _usbh_mutex));
+  TU_VERIFY(tu_edpt_claim(&ep->state, _usbh_mutex));
   TU_LOG_USBH("[%u] Claimed EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
@@ -805,10 +1951,10 @@ bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev && dev->connected);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
+  usbh_edpt_t* ep = get_edpt(dev_addr, ep_addr);
+  TU_VERIFY(ep);
 
-  TU_VERIFY(tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex));
+  TU_VERIFY(tu_edpt_release(&ep->state, _usbh_mutex));
   TU_LOG_USBH("[%u] Released EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
@@ -824,22 +1970,46 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
-  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+  usbh_edpt_t* ep = get_edpt(dev_addr, ep_addr);
+  TU_VERIFY(ep);
+  tu_edpt_state_t* ep_state = &ep->state;
 
   TU_LOG_USBH("  Queue EP %02X with %u bytes ... \r\n", ep_addr, total_bytes);
+  TU_TRACE(TU_TRACE_EDPT_XFER, ep_addr, total_bytes);
+  TU_CAPTURE(TU_CAPTURE_HOST | TU_CAPTURE_SUBMIT, dev->rhport, dev_addr, ep_addr, total_bytes, XFER_RESULT_SUCCESS,
+             (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) ? buffer : NULL, total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(ep_state->busy == 0);
 
+#if CFG_TUSB_CAPTURE && CFG_TUSB_CAPTURE_PAYLOAD
+  ep->capture_buf = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) ? buffer : NULL;
+#endif
+
   // Set busy first since the actual transfer can be complete before hcd_edpt_xfer()
   // could return and USBH task can preempt and clear the busy
   ep_state->busy = 1;
 
 #if CFG_TUH_API_EDPT_XFER
-  dev->ep_callback[epnum][dir].complete_cb = complete_cb;
-  dev->ep_callback[epnum][dir].user_data   = user_data;
+  ep->complete_cb = complete_cb;
+  ep->user_data   = user_data;
+#endif
+
+#if CFG_TUH_EDPT_STATS
+  tu_edpt_stats_arm(&ep->stats);
+#endif
+
+#if CFG_TUH_SUSPEND
+  ep->buffer = buffer;
+  ep->buflen = total_bytes;
+  ep->pm_iso = 0;
+  if (dev->suspended) {
+    // started when device is resumed, sending data to suspended device resumes it
+    TU_LOG_USBH("deferred (suspended)\r\n");
+    ep->pm_restart = 1;
+    if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) (void) tuh_resume(dev_addr);
+    return true;
+  }
 #endif
 
   if (hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes)) {
@@ -871,17 +2041,19 @@ static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size) {
 
 bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* desc_ep) {
   TU_ASSERT(tu_edpt_validate(desc_ep, tuh_speed_get(dev_addr)));
+  usbh_edpt_t* ep = edpt_alloc(dev_addr, desc_ep->bEndpointAddress);
+  TU_ASSERT(ep);
+  #if CFG_TUH_PERIODIC_BW
+  TU_VERIFY(periodic_bw_alloc(dev_addr, ep, desc_ep));
+  #endif
   return hcd_edpt_open(usbh_get_rhport(dev_addr), dev_addr, desc_ep);
 }
 
 bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr) {
-  usbh_device_t* dev = get_device(dev_addr);
-  TU_VERIFY(dev);
+  usbh_edpt_t* ep = get_edpt(dev_addr, ep_addr);
+  TU_VERIFY(ep);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
-
-  return dev->ep_status[epnum][dir].busy;
+  return ep->state.busy;
 }
 
 //--------------------------------------------------------------------+
@@ -901,6 +2073,12 @@ void hcd_devtree_get_info(uint8_t dev_addr, hcd_devtree_info_t* devtree_info) {
     devtree_info->hub_port = _dev0.hub_port;
     devtree_info->speed = _dev0.speed;
   }
+
+  #if CFG_TUH_HUB
+  devtree_info->hub_multi_tt = devtree_info->hub_addr ? hub_is_multi_tt(devtree_info->hub_addr) : 0;
+  #else
+  devtree_info->hub_multi_tt = 0;
+  #endif
 }
 
 TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr) {
@@ -976,6 +2154,59 @@ bool tuh_descriptor_get_string(uint8_t daddr, uint8_t index, uint16_t language_i
   return _get_descriptor(daddr, TUSB_DESC_STRING, index, language_id, buffer, len, complete_cb, user_data);
 }
 
+size_t tuh_string_desc_to_utf8(void const* desc, char* utf8, size_t bufsize) {
+  TU_VERIFY(bufsize, 0);
+  uint8_t const* p8 = (uint8_t const*) desc;
+  size_t const count = (p8[0] >= 2) ? (p8[0] - 2u) / 2u : 0; // number of UTF-16 code units
+  size_t len = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint32_t cp = tu_le16toh(tu_unaligned_read16(p8 + 2 + 2 * i));
+
+    // combine surrogate pair, lone surrogate is replaced by U+FFFD
+    if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < count) {
+      uint16_t const low = tu_le16toh(tu_unaligned_read16(p8 + 4 + 2 * i));
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        i++;
+      }
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF) {
+      cp = 0xFFFD;
+    }
+
+    uint8_t enc[4];
+    uint8_t n;
+    if (cp < 0x80) {
+      enc[0] = (uint8_t) cp;
+      n = 1;
+    } else if (cp < 0x800) {
+      enc[0] = (uint8_t) (0xC0 | (cp >> 6));
+      enc[1] = (uint8_t) (0x80 | (cp & 0x3F));
+      n = 2;
+    } else if (cp < 0x10000) {
+      enc[0] = (uint8_t) (0xE0 | (cp >> 12));
+      enc[1] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+      enc[2] = (uint8_t) (0x80 | (cp & 0x3F));
+      n = 3;
+    } else {
+      enc[0] = (uint8_t) (0xF0 | (cp >> 18));
+      enc[1] = (uint8_t) (0x80 | ((cp >> 12) & 0x3F));
+      enc[2] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+      enc[3] = (uint8_t) (0x80 | (cp & 0x3F));
+      n = 4;
+    }
+
+    // truncate at character boundary, keep room for null terminator
+    if (len + n >= bufsize) break;
+    memcpy(utf8 + len, enc, n);
+    len += n;
+  }
+
+  utf8[len] = '\0';
+  return len;
+}
+
 // Get manufacturer string descriptor
 bool tuh_descriptor_get_manufacturer_string(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len,
                                             tuh_xfer_cb_t complete_cb, uintptr_t user_data)
@@ -1060,7 +2291,7 @@ bool tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt,
   TU_LOG_USBH("Set Interface %u Alternate %u\r\n", itf_num, itf_alt);
   tusb_control_request_t const request = {
       .bmRequestType_bit = {
-          .recipient = TUSB_REQ_RCPT_DEVICE,
+          .recipient = TUSB_REQ_RCPT_INTERFACE,
           .type      = TUSB_REQ_TYPE_STANDARD,
           .direction = TUSB_DIR_OUT
       },
@@ -1174,63 +2405,390 @@ static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hu
   uint8_t nop_count = 0;
 #endif
 
-  for (uint8_t dev_id = 0; dev_id < TOTAL_DEVICES; dev_id++) {
-    usbh_device_t *dev = &_usbh_devices[dev_id];
-    uint8_t const daddr = dev_id + 1;
-
-    // hub_addr = 0 means roothub, hub_port = 0 means all devices of downstream hub
-    if (dev->rhport == rhport && dev->connected &&
-        (hub_addr == 0 || dev->hub_addr == hub_addr) &&
-        (hub_port == 0 || dev->hub_port == hub_port)) {
-      TU_LOG_USBH("Device unplugged address = %u\r\n", daddr);
+  for (uint8_t dev_id = 0; dev_id < TOTAL_DEVICES; dev_id++) {
+    usbh_device_t *dev = &_usbh_devices[dev_id];
+    uint8_t const daddr = dev_id + 1;
+
+    // hub_addr = 0 means roothub, hub_port = 0 means all devices of downstream hub
+    if (dev->rhport == rhport && dev->connected &&
+        (hub_addr == 0 || dev->hub_addr == hub_addr) &&
+        (hub_port == 0 || dev->hub_port == hub_port)) {
+      TU_LOG_USBH("Device unplugged address = %u\r\n", daddr);
+
+      if (is_hub_addr(daddr)) {
+        TU_LOG_USBH("  is a HUB device %u\r\n", daddr);
+
+        // Submit removed event If the device itself is a hub (un-rolled recursive)
+        // TODO a better to unroll recursrive is using array of removing_hubs and mark it here
+        hcd_event_t event;
+        event.rhport = rhport;
+        event.event_id = HCD_EVENT_DEVICE_REMOVE;
+        event.connection.hub_addr = daddr;
+        event.connection.hub_port = 0;
+
+        hcd_event_handler(&event, false);
+      } else {
+        // Invoke callback before closing driver (maybe call it later ?)
+        if (tuh_umount_cb) tuh_umount_cb(daddr);
+      }
+
+      // Close class driver
+      for (uint8_t drv_id = 0; drv_id < TOTAL_DRIVER_COUNT; drv_id++) {
+        usbh_class_driver_t const * driver = get_driver(drv_id);
+        if ( driver ) driver->close(daddr);
+      }
+
+      hcd_device_close(rhport, daddr);
+      clear_device(dev);
+      // abort on-going control xfer if any
+      _control_xfer_reset(daddr);
+      #if CTRL_XFER_QUEUE_DEPTH
+      _control_xfer_purge_queued(daddr);
+      #endif
+      #if EDPT_XFER_QUEUE_NUM
+      _edpt_xfer_purge_queued(daddr, 0);
+      #endif
+    }
+  }
+
+  // stop enumeration of unplugged devices (addressed or still at address 0)
+  for (uint8_t i = 0; i < CFG_TUH_ENUMERATION_NUM; i++) {
+    usbh_enum_t* e = &_usbh_enum[i];
+    if (e->used && e->rhport == rhport &&
+        (hub_addr == 0 || e->hub_addr == hub_addr) &&
+        (hub_port == 0 || e->hub_port == hub_port)) {
+      if (e->daddr == 0) {
+        _dev0.enumerating = 0;
+        _control_xfer_reset(0);
+        #if CTRL_XFER_QUEUE_DEPTH
+        _control_xfer_purge_queued(0);
+        #endif
+      }
+      enum_phase(e, TUH_ENUM_PHASE_ABORTED);
+      usbh_timer_stop(&e->timer);
+      e->used = false;
+    }
+  }
+
+  #if CTRL_XFER_QUEUE_DEPTH
+  _control_xfer_start_queued();
+  #endif
+}
+
+#if CFG_TUSB_OTG
+// Drop events of previous session, deferred function calls are still invoked
+static void drop_queued_events(osal_queue_t q) {
+  hcd_event_t event;
+  while (osal_queue_receive(q, &event, 0)) {
+    if (event.event_id == USBH_EVENT_FUNC_CALL && event.func_call.func) {
+      event.func_call.func(event.func_call.param);
+    }
+  }
+}
+
+void usbh_role_exit(uint8_t rhport) {
+  hcd_int_disable(rhport);
+
+  // remove all devices of roothub while controller is still in host mode to close their endpoints
+  process_removing_device(rhport, 0, 0);
+
+  drop_queued_events(_usbh_q);
+  #if CFG_TUH_TASK_QUEUE_HI_SZ
+  drop_queued_events(_usbh_q_hi);
+  #endif
+  #if CFG_TUH_TASK_XFER_RESCUE
+  _usbh_xfer_rescue_any = false;
+  #endif
+
+  tu_memclr(&_dev0, sizeof(_dev0));
+}
+#endif
+
+#if CFG_TUH_SUSPEND
+//--------------------------------------------------------------------+
+// Selective Suspend
+// Pending transfers are aborted and marked with pm_restart while device is suspended, together with the ones
+// submitted meanwhile they are started again when device is resumed. Hub is not suspended.
+//--------------------------------------------------------------------+
+
+enum {
+  PM_PENDING_IN  = TU_BIT(0),
+  PM_PENDING_OUT = TU_BIT(1),
+  PM_PENDING_ISO = TU_BIT(2)
+};
+
+static void pm_timer_expired(uintptr_t arg);
+
+// Get kinds of pending transfer on non-control endpoints of device
+static uint8_t pm_edpt_pending(uint8_t daddr) {
+  uint8_t pending = 0;
+  for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      usbh_edpt_t const* ep = get_edpt(daddr, tu_edpt_addr(epnum, dir));
+      if (ep && ep->state.busy) {
+        pending |= ep->pm_iso ? PM_PENDING_ISO : (dir ? PM_PENDING_IN : PM_PENDING_OUT);
+      }
+    }
+  }
+  return pending;
+}
+
+// Take pending transfers off the schedule (suspend) or start them again (resume)
+static void pm_edpt_xfer_all(uint8_t daddr, bool restart) {
+  usbh_device_t const* dev = get_device(daddr);
+  for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+      usbh_edpt_t* ep = get_edpt(daddr, ep_addr);
+      if (ep == NULL || !ep->state.busy) continue;
+
+      if (restart) {
+        if (ep->pm_restart) {
+          ep->pm_restart = 0;
+          if (!hcd_edpt_xfer(dev->rhport, daddr, ep_addr, ep->buffer, ep->buflen)) {
+            TU_LOG_USBH("[%u] Failed to restart EP %02X\r\n", daddr, ep_addr);
+            ep->state.busy = 0;
+            ep->state.claimed = 0;
+          }
+        }
+      } else if (!ep->pm_restart && hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr)) {
+        // transfer not aborted (e.g completed) is left to HCD
+        ep->pm_restart = 1;
+      }
+    }
+  }
+}
+
+static void pm_idle_restart(uint8_t daddr) {
+#if CFG_TUH_SUSPEND_IDLE_MS
+  usbh_device_t* dev = get_device(daddr);
+  if (dev && dev->configured && !dev->suspended && !is_hub_addr(daddr)) {
+    usbh_timer_start(&dev->pm_timer, CFG_TUH_SUSPEND_IDLE_MS, pm_timer_expired, daddr);
+  }
+#else
+  (void) daddr;
+#endif
+}
+
+// Device is active again: suspend is aborted or resume is complete
+static void pm_set_active(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  dev->pm_state = PM_ACTIVE;
+  dev->suspended = 0;
+  pm_edpt_xfer_all(daddr, true);
+  pm_idle_restart(daddr);
+}
+
+static void pm_suspend_complete(uint8_t daddr, bool success) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected && dev->pm_state == PM_SUSPENDING,);
+
+  if (!success) {
+    TU_LOG_USBH("[%u] Failed to suspend\r\n", daddr);
+    pm_set_active(daddr);
+    return;
+  }
+
+  TU_LOG_USBH("[%u] Suspended\r\n", daddr);
+  dev->pm_state = PM_SUSPENDED;
+  if (tuh_suspend_cb) tuh_suspend_cb(daddr);
+
+  // OUT transfer submitted while suspending
+  if (pm_edpt_pending(daddr) & PM_PENDING_OUT) (void) tuh_resume(daddr);
+}
+
+#if CFG_TUH_HUB
+static void pm_hub_suspend_complete(tuh_xfer_t* xfer) {
+  pm_suspend_complete((uint8_t) xfer->user_data, xfer->result == XFER_RESULT_SUCCESS);
+}
+#endif
+
+static void pm_suspend_port(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+
+  // control transfer submitted while suspending
+  if (ctrl_xfer_find(daddr)) {
+    pm_suspend_complete(daddr, false);
+    return;
+  }
+
+  pm_edpt_xfer_all(daddr, false);
+
+#if CFG_TUH_HUB
+  if (dev->hub_addr) {
+    if (!hub_port_set_feature(dev->hub_addr, dev->hub_port, HUB_FEATURE_PORT_SUSPEND, pm_hub_suspend_complete, daddr)) {
+      pm_suspend_complete(daddr, false);
+    }
+    return;
+  }
+#endif
+
+  pm_suspend_complete(daddr, hcd_port_suspend(dev->rhport));
+}
+
+static void pm_remote_wakeup_complete(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected && dev->pm_state == PM_SUSPENDING,);
+
+  // device data may be lost if it can't wake us up
+  if (xfer->result != XFER_RESULT_SUCCESS) {
+    pm_suspend_complete(daddr, false);
+  } else {
+    pm_suspend_port(daddr);
+  }
+}
+
+bool tuh_suspend(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->configured && !dev->suspended && !is_hub_addr(daddr));
+  TU_VERIFY(dev->hub_addr || (hcd_port_suspend && hcd_port_resume)); // roothub port suspend is not supported
+  TU_VERIFY(!(pm_edpt_pending(daddr) & PM_PENDING_ISO));
+
+  TU_LOG_USBH("[%u] Suspending\r\n", daddr);
+  usbh_timer_stop(&dev->pm_timer);
+  dev->pm_state = PM_SUSPENDING;
+  dev->suspended = 1;
+
+  if (dev->remote_wakeup) {
+    tusb_control_request_t const request = {
+        .bmRequestType_bit = {
+            .recipient = TUSB_REQ_RCPT_DEVICE,
+            .type      = TUSB_REQ_TYPE_STANDARD,
+            .direction = TUSB_DIR_OUT
+        },
+        .bRequest = TUSB_REQ_SET_FEATURE,
+        .wValue   = tu_htole16(TUSB_REQ_FEATURE_REMOTE_WAKEUP),
+        .wIndex   = 0,
+        .wLength  = 0
+    };
+    tuh_xfer_t xfer = {
+        .daddr       = daddr,
+        .ep_addr     = 0,
+        .setup       = &request,
+        .buffer      = NULL,
+        .complete_cb = pm_remote_wakeup_complete,
+        .user_data   = 0
+    };
+
+    if (!tuh_control_xfer(&xfer)) {
+      pm_set_active(daddr);
+      return false;
+    }
+  } else {
+    pm_suspend_port(daddr);
+  }
+
+  return true;
+}
+
+#if CFG_TUH_HUB
+static void pm_hub_resume_complete(tuh_xfer_t* xfer) {
+  uint8_t const daddr = (uint8_t) xfer->user_data;
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected && dev->pm_state == PM_RESUMING,);
+
+  if (xfer->result != XFER_RESULT_SUCCESS) {
+    TU_LOG_USBH("[%u] Failed to resume\r\n", daddr);
+    dev->pm_state = PM_SUSPENDED;
+    return;
+  }
+
+  // hub drives resume signaling for TDRSMDN then port is enabled again
+  usbh_timer_start(&dev->pm_timer, PM_RESUME_SIGNAL_MS, pm_timer_expired, daddr);
+}
+#endif
+
+bool tuh_resume(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected && dev->pm_state == PM_SUSPENDED);
+
+  TU_LOG_USBH("[%u] Resuming\r\n", daddr);
+  dev->pm_state = PM_RESUMING;
+
+#if CFG_TUH_HUB
+  if (dev->hub_addr) {
+    if (!hub_port_clear_feature(dev->hub_addr, dev->hub_port, HUB_FEATURE_PORT_SUSPEND, pm_hub_resume_complete, daddr)) {
+      dev->pm_state = PM_SUSPENDED;
+      return false;
+    }
+    return true;
+  }
+#endif
+
+  if (!hcd_port_resume(dev->rhport)) {
+    dev->pm_state = PM_SUSPENDED;
+    return false;
+  }
+  usbh_timer_start(&dev->pm_timer, PM_RESUME_SIGNAL_MS, pm_timer_expired, daddr);
 
-      if (is_hub_addr(daddr)) {
-        TU_LOG_USBH("  is a HUB device %u\r\n", daddr);
+  return true;
+}
 
-        // Submit removed event If the device itself is a hub (un-rolled recursive)
-        // TODO a better to unroll recursrive is using array of removing_hubs and mark it here
-        hcd_event_t event;
-        event.rhport = rhport;
-        event.event_id = HCD_EVENT_DEVICE_REMOVE;
-        event.connection.hub_addr = daddr;
-        event.connection.hub_port = 0;
+// Remote wakeup (or end of resume) is reported by HCD for roothub port, by hub status change for hub port
+static void pm_resume_detected(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port) {
+  for (uint8_t dev_id = 0; dev_id < TOTAL_DEVICES; dev_id++) {
+    usbh_device_t* dev = &_usbh_devices[dev_id];
+    uint8_t const daddr = dev_id + 1;
 
-        hcd_event_handler(&event, false);
+    if (dev->rhport == rhport && dev->connected && dev->hub_addr == hub_addr && dev->hub_port == hub_port &&
+        dev->pm_state == PM_SUSPENDED) {
+      TU_LOG_USBH("[%u] Remote wakeup\r\n", daddr);
+      if (hub_addr) {
+        // hub has already finished resume signaling
+        dev->pm_state = PM_RECOVERY;
+        usbh_timer_start(&dev->pm_timer, PM_RESUME_RECOVERY_MS, pm_timer_expired, daddr);
       } else {
-        // Invoke callback before closing driver (maybe call it later ?)
-        if (tuh_umount_cb) tuh_umount_cb(daddr);
-      }
-
-      // Close class driver
-      for (uint8_t drv_id = 0; drv_id < TOTAL_DRIVER_COUNT; drv_id++) {
-        usbh_class_driver_t const * driver = get_driver(drv_id);
-        if ( driver ) driver->close(daddr);
+        (void) tuh_resume(daddr);
       }
+      return;
+    }
+  }
+}
 
-      hcd_device_close(rhport, daddr);
-      clear_device(dev);
-      // abort on-going control xfer if any
-      if (_ctrl_xfer.daddr == daddr) _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+static void pm_timer_expired(uintptr_t arg) {
+  uint8_t const daddr = (uint8_t) arg;
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected,);
+
+  switch (dev->pm_state) {
+    case PM_ACTIVE: {
+      // idle timeout: don't miss data of device that can't wake us up, don't delay data sent to device
+      uint8_t const pending = pm_edpt_pending(daddr);
+      bool const idle = !ctrl_xfer_find(daddr) && !(pending & (PM_PENDING_OUT | PM_PENDING_ISO)) &&
+                        (dev->remote_wakeup || !(pending & PM_PENDING_IN));
+      if (!(idle && tuh_suspend(daddr))) pm_idle_restart(daddr);
+      break;
     }
+
+    case PM_RESUMING:
+      if (!dev->hub_addr && hcd_port_resume_end) hcd_port_resume_end(dev->rhport);
+      dev->pm_state = PM_RECOVERY;
+      usbh_timer_start(&dev->pm_timer, PM_RESUME_RECOVERY_MS, pm_timer_expired, daddr);
+      break;
+
+    case PM_RECOVERY:
+      TU_LOG_USBH("[%u] Resumed\r\n", daddr);
+      pm_set_active(daddr);
+      if (tuh_resume_cb) tuh_resume_cb(daddr);
+      break;
+
+    default: break;
   }
 }
+#endif
 
 //--------------------------------------------------------------------+
 // Enumeration Process
 // is a lengthy process with a series of control transfer to configure
 // newly attached device.
-// NOTE: due to the shared _usbh_ctrl_buf, we must complete enumerating
-// one device before enumerating another one.
+// NOTE: only one device can be at address 0. With CFG_TUH_ENUMERATION_NUM > 1
+// next device starts its enumeration once the previous one is addressed.
 //--------------------------------------------------------------------+
 
-enum {
-  ENUM_RESET_DELAY = 50, // USB specs: 10 to 50ms
-  ENUM_CONTACT_DEBOUNCING_DELAY = 450, // when plug/unplug a device, physical connection can be bouncing and may
-                                       // generate a series of attach/detach event. This delay wait for stable connection
-};
-
 enum {
   ENUM_IDLE,
+  ENUM_DEBOUNCED,       // connection is stable after debounce delay
   ENUM_RESET_1,         // 1st reset when attached
   //ENUM_HUB_GET_STATUS_1,
   ENUM_HUB_CLEAR_RESET_1,
@@ -1241,15 +2799,200 @@ enum {
   ENUM_SET_ADDR,
 
   ENUM_GET_DEVICE_DESC,
+  ENUM_PARSE_DEVICE_DESC,
   ENUM_GET_9BYTE_CONFIG_DESC,
   ENUM_GET_FULL_CONFIG_DESC,
   ENUM_SET_CONFIG,
   ENUM_CONFIG_DRIVER
 };
 
-static bool enum_request_set_addr(void);
+static bool enum_request_set_addr(usbh_enum_t* e);
+#if CFG_TUH_STRING_CACHE
+enum {
+  STRING_SLOT_LANGID = 0,
+  STRING_SLOT_MANUFACTURER,
+  STRING_SLOT_PRODUCT,
+  STRING_SLOT_SERIAL,
+  STRING_SLOT_COUNT
+};
+static bool enum_string_request(usbh_enum_t* e, uint8_t slot);
+#endif
 static bool _parse_configuration_descriptor (uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg);
-static void enum_full_complete(void);
+static void enum_full_complete(usbh_enum_t* e);
+
+// enumeration of a device, daddr = 0 is the one in addressing phase
+#if CFG_TUH_DESC_CACHE
+// Load cached configuration descriptor into buf if its header matches the 9-byte header already in buf
+static bool desc_cache_load(tusb_desc_device_t const* desc_device, uint8_t* buf, uint16_t total_len) {
+  uint8_t header[sizeof(tusb_desc_configuration_t)];
+  memcpy(header, buf, sizeof(header));
+
+  #if CFG_TUH_DESC_CACHE_NUM
+  for (uint8_t i = 0; i < CFG_TUH_DESC_CACHE_NUM; i++) {
+    usbh_desc_cache_t* entry = &_usbh_desc_cache[i];
+    if (entry->len == total_len && 0 == memcmp(&entry->desc_device, desc_device, sizeof(tusb_desc_device_t)) &&
+        0 == memcmp(entry->desc_config, header, sizeof(header))) {
+      memcpy(buf, entry->desc_config, total_len);
+      entry->last_used = ++_usbh_desc_cache_stamp;
+      return true;
+    }
+  }
+  #endif
+
+  if (tuh_descriptor_cache_load_cb) {
+    uint16_t const len = tuh_descriptor_cache_load_cb(desc_device, buf, CFG_TUH_ENUMERATION_BUFSIZE);
+    if (len == total_len && 0 == memcmp(buf, header, sizeof(header))) {
+      return true;
+    }
+
+    // restore header, full descriptor will be fetched
+    memcpy(buf, header, sizeof(header));
+  }
+
+  return false;
+}
+
+static void desc_cache_store(tusb_desc_device_t const* desc_device, uint8_t const* desc_config, uint16_t len) {
+  #if CFG_TUH_DESC_CACHE_NUM
+  if (len <= CFG_TUH_DESC_CACHE_BUFSIZE) {
+    // replace entry of the same device, otherwise unused or least recently used one
+    usbh_desc_cache_t* entry = &_usbh_desc_cache[0];
+    for (uint8_t i = 0; i < CFG_TUH_DESC_CACHE_NUM; i++) {
+      usbh_desc_cache_t* cur = &_usbh_desc_cache[i];
+      if (cur->len && 0 == memcmp(&cur->desc_device, desc_device, sizeof(tusb_desc_device_t))) {
+        entry = cur;
+        break;
+      }
+      if (entry->len && (cur->len == 0 || cur->last_used < entry->last_used)) {
+        entry = cur;
+      }
+    }
+
+    entry->desc_device = *desc_device;
+    entry->len = len;
+    entry->last_used = ++_usbh_desc_cache_stamp;
+    memcpy(entry->desc_config, desc_config, len);
+  }
+  #endif
+
+  if (tuh_descriptor_cache_store_cb) {
+    tuh_descriptor_cache_store_cb(desc_device, desc_config, len);
+  }
+}
+
+void tuh_descriptor_cache_clear(void) {
+  #if CFG_TUH_DESC_CACHE_NUM
+  tu_memclr(_usbh_desc_cache, sizeof(_usbh_desc_cache));
+  #endif
+}
+#endif
+
+static usbh_enum_t* enum_get(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_ENUMERATION_NUM; i++) {
+    usbh_enum_t* e = &_usbh_enum[i];
+    if (e->used && e->daddr == daddr) return e;
+  }
+  return NULL;
+}
+
+static usbh_enum_t* enum_alloc(void) {
+  for (uint8_t i = 0; i < CFG_TUH_ENUMERATION_NUM; i++) {
+    usbh_enum_t* e = &_usbh_enum[i];
+    if (!e->used) return e;
+  }
+  return NULL;
+}
+
+static void process_enumeration(tuh_xfer_t* xfer);
+
+static void enum_timer_expired(uintptr_t arg) {
+  usbh_enum_t* e = (usbh_enum_t*) arg;
+  if (!e->used) return;
+
+  if (e->delay_state) {
+    // resume enumeration
+    tuh_xfer_t xfer;
+    xfer.daddr     = e->daddr;
+    xfer.result    = XFER_RESULT_SUCCESS;
+    xfer.user_data = e->delay_state;
+    e->delay_state = 0;
+    process_enumeration(&xfer);
+  } else {
+    // retry failed transfer
+    TU_LOG1("Enumeration attempt %u\r\n", e->failed_count);
+    if (!tuh_control_xfer(&e->retry_xfer)) enum_full_complete(e);
+  }
+}
+
+// Resume enumeration with next_state after ms without blocking tuh_task()
+static void enum_delay(usbh_enum_t* e, uint16_t ms, uint8_t next_state) {
+  e->delay_state = next_state;
+  usbh_timer_start(&e->timer, ms, enum_timer_expired, (uintptr_t) e);
+}
+
+static void enum_phase(usbh_enum_t* e, tuh_enum_phase_t phase) {
+  e->phase = (uint8_t) phase;
+  if (tuh_enum_phase_cb) tuh_enum_phase_cb(e->rhport, e->hub_addr, e->hub_port, e->daddr, phase);
+}
+
+#if CFG_TUH_STRING_CACHE
+static void enum_string_complete(tuh_xfer_t* xfer);
+
+// Request string of slot or next one that device has, return false if there is none left
+static bool enum_string_request(usbh_enum_t* e, uint8_t slot) {
+  usbh_device_t* dev = get_device(e->daddr);
+  TU_VERIFY(dev);
+  uint16_t const len = tu_min16(CFG_TUH_ENUMERATION_BUFSIZE, 255);
+
+  if (slot == STRING_SLOT_LANGID) {
+    // Only fetch language ID table if device has any string
+    if (dev->i_manufacturer || dev->i_product || dev->i_serial) {
+      TU_LOG_USBH("Get String Descriptor: Language ID\r\n");
+      return tuh_descriptor_get_string(e->daddr, 0, 0, e->buf, len, enum_string_complete, STRING_SLOT_LANGID);
+    }
+    return false;
+  }
+
+  uint8_t const str_index[] = {dev->i_manufacturer, dev->i_product, dev->i_serial};
+  for (; slot < STRING_SLOT_COUNT; slot++) {
+    uint8_t const index = str_index[slot - STRING_SLOT_MANUFACTURER];
+    if (index) {
+      TU_LOG_USBH("Get String Descriptor: index %u\r\n", index);
+      return tuh_descriptor_get_string(e->daddr, index, dev->langid, e->buf, len, enum_string_complete, slot);
+    }
+  }
+
+  return false;
+}
+
+// Strings are optional: failed or stalled request is skipped without retry. Next request is submitted from
+// completion so that strings are fetched back to back before resuming with configuration descriptor.
+static void enum_string_complete(tuh_xfer_t* xfer) {
+  usbh_enum_t* e = enum_get(xfer->daddr);
+  usbh_device_t* dev = get_device(xfer->daddr);
+  if (e == NULL || dev == NULL) return; // unplugged
+
+  uint8_t const slot = (uint8_t) xfer->user_data;
+  uint8_t const* desc = e->buf;
+  bool const valid = (xfer->result == XFER_RESULT_SUCCESS) && xfer->actual_len >= 2 &&
+                     desc[1] == TUSB_DESC_STRING && desc[0] <= xfer->actual_len;
+
+  if (slot == STRING_SLOT_LANGID) {
+    // use first language, english (US) if not available
+    dev->langid = (valid && desc[0] >= 4) ? tu_le16toh(tu_unaligned_read16(desc + 2)) : 0x0409;
+  } else if (valid) {
+    tuh_string_desc_to_utf8(desc, dev->str_cache[slot - STRING_SLOT_MANUFACTURER], CFG_TUH_STRING_CACHE_LEN);
+  }
+
+  if (!enum_string_request(e, slot + 1)) {
+    tuh_xfer_t xfer_cfg;
+    xfer_cfg.daddr     = xfer->daddr;
+    xfer_cfg.result    = XFER_RESULT_SUCCESS;
+    xfer_cfg.user_data = ENUM_GET_9BYTE_CONFIG_DESC;
+    process_enumeration(&xfer_cfg);
+  }
+}
+#endif
 
 // process device enumeration
 static void process_enumeration(tuh_xfer_t* xfer) {
@@ -1258,40 +3001,70 @@ static void process_enumeration(tuh_xfer_t* xfer) {
     ATTEMPT_COUNT_MAX = 3,
     ATTEMPT_DELAY_MS = 100
   };
-  static uint8_t failed_count = 0;
+  uint8_t const daddr = xfer->daddr;
+  uintptr_t const state = xfer->user_data;
 
-  if (XFER_RESULT_SUCCESS != xfer->result) {
-    // retry if not reaching max attempt
-    bool retry = _dev0.enumerating && (failed_count < ATTEMPT_COUNT_MAX);
-    if ( retry ) {
-      failed_count++;
-      osal_task_delay(ATTEMPT_DELAY_MS); // delay a bit
-      TU_LOG1("Enumeration attempt %u\r\n", failed_count);
-      retry = tuh_control_xfer(xfer);
-    }
+  // Until SET_ADDRESS is complete (including hub port requests) the transfer belongs to the device at address 0.
+  // Device is unplugged if its enumeration is not found.
+  uint8_t const enum_addr = (state <= ENUM_GET_DEVICE_DESC) ? 0 : daddr;
+  usbh_enum_t* e = enum_get(enum_addr);
+  if (e == NULL || (enum_addr == 0 && !_dev0.enumerating)) return;
 
-    if (!retry) {
-      enum_full_complete();
+  if (XFER_RESULT_SUCCESS != xfer->result) {
+    // retry after a bit if not reaching max attempt. Setup packet is copied since xfer is temporary
+    if (e->failed_count < ATTEMPT_COUNT_MAX) {
+      e->failed_count++;
+      e->retry_setup = *xfer->setup;
+      e->retry_xfer = *xfer;
+      e->retry_xfer.setup = &e->retry_setup;
+      e->delay_state = 0;
+      usbh_timer_start(&e->timer, ATTEMPT_DELAY_MS, enum_timer_expired, (uintptr_t) e);
+    } else {
+      enum_full_complete(e);
     }
 
     return;
   }
-  failed_count = 0;
-
-  uint8_t const daddr = xfer->daddr;
-  uintptr_t const state = xfer->user_data;
+  e->failed_count = 0;
 
   switch (state) {
+    case ENUM_DEBOUNCED:
+      if (e->hub_addr == 0) {
+        // device unplugged while delaying
+        if (!hcd_port_connect_status(_dev0.rhport)) {
+          enum_full_complete(e);
+          return;
+        }
+
+        _dev0.speed = hcd_port_speed_get(_dev0.rhport);
+        TU_LOG_USBH("%s Speed\r\n", tu_str_speed[_dev0.speed]);
+
+        // fake transfer to kick-off the enumeration process
+        tuh_xfer_t xfer0;
+        xfer0.daddr = 0;
+        xfer0.result = XFER_RESULT_SUCCESS;
+        xfer0.user_data = ENUM_ADDR0_DEVICE_DESC;
+        process_enumeration(&xfer0);
+      }
+      #if CFG_TUH_HUB
+      else {
+        // ENUM_HUB_GET_STATUS
+        TU_ASSERT(hub_port_get_status(e->hub_addr, e->hub_port, e->buf,
+                                      process_enumeration, ENUM_HUB_CLEAR_RESET_1),);
+      }
+      #endif
+      break;
+
     #if CFG_TUH_HUB
     //case ENUM_HUB_GET_STATUS_1: break;
 
     case ENUM_HUB_CLEAR_RESET_1: {
       hub_port_status_response_t port_status;
-      memcpy(&port_status, _usbh_ctrl_buf, sizeof(hub_port_status_response_t));
+      memcpy(&port_status, e->buf, sizeof(hub_port_status_response_t));
 
       if (!port_status.status.connection) {
         // device unplugged while delaying, nothing else to do
-        enum_full_complete();
+        enum_full_complete(e);
         return;
       }
 
@@ -1300,25 +3073,25 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 
       // Acknowledge Port Reset Change
       if (port_status.change.reset) {
-        hub_port_clear_reset_change(_dev0.hub_addr, _dev0.hub_port,
+        hub_port_clear_reset_change(e->hub_addr, e->hub_port,
                                     process_enumeration, ENUM_ADDR0_DEVICE_DESC);
       }
       break;
     }
 
     case ENUM_HUB_GET_STATUS_2:
-      osal_task_delay(ENUM_RESET_DELAY);
-      TU_ASSERT(hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf,
+      osal_task_delay(CFG_TUH_ENUM_RESET_DELAY_MS);
+      TU_ASSERT(hub_port_get_status(e->hub_addr, e->hub_port, e->buf,
                                     process_enumeration, ENUM_HUB_CLEAR_RESET_2),);
       break;
 
     case ENUM_HUB_CLEAR_RESET_2: {
       hub_port_status_response_t port_status;
-      memcpy(&port_status, _usbh_ctrl_buf, sizeof(hub_port_status_response_t));
+      memcpy(&port_status, e->buf, sizeof(hub_port_status_response_t));
 
       // Acknowledge Port Reset Change if Reset Successful
       if (port_status.change.reset) {
-        TU_ASSERT(hub_port_clear_reset_change(_dev0.hub_addr, _dev0.hub_port,
+        TU_ASSERT(hub_port_clear_reset_change(e->hub_addr, e->hub_port,
                                               process_enumeration, ENUM_SET_ADDR),);
       }
       break;
@@ -1326,13 +3099,15 @@ static void process_enumeration(tuh_xfer_t* xfer) {
     #endif
 
     case ENUM_ADDR0_DEVICE_DESC: {
+      enum_phase(e, TUH_ENUM_PHASE_ADDR0_DESC);
+
       // TODO probably doesn't need to open/close each enumeration
       uint8_t const addr0 = 0;
       TU_ASSERT(usbh_edpt_control_open(addr0, 8),);
 
       // Get first 8 bytes of device descriptor for Control Endpoint size
       TU_LOG_USBH("Get 8 byte of Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(addr0, _usbh_ctrl_buf, 8,
+      TU_ASSERT(tuh_descriptor_get_device(addr0, e->buf, 8,
                                           process_enumeration, ENUM_SET_ADDR),);
       break;
     }
@@ -1342,7 +3117,7 @@ static void process_enumeration(tuh_xfer_t* xfer) {
         // TODO not used by now, but may be needed for some devices !?
         // Reset device again before Set Address
         TU_LOG_USBH("Port reset2 \r\n");
-        if (_dev0.hub_addr == 0) {
+        if (e->hub_addr == 0) {
           // connected directly to roothub
           hcd_port_reset( _dev0.rhport );
           osal_task_delay(RESET_DELAY); // TODO may not work for no-OS on MCU that require reset_end() since
@@ -1353,7 +3128,7 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 #if CFG_TUH_HUB
         else {
           // after RESET_DELAY the hub_port_reset() already complete
-          TU_ASSERT( hub_port_reset(_dev0.hub_addr, _dev0.hub_port,
+          TU_ASSERT( hub_port_reset(e->hub_addr, e->hub_port,
                                     process_enumeration, ENUM_HUB_GET_STATUS_2), );
           break;
         }
@@ -1362,7 +3137,7 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 #endif
 
     case ENUM_SET_ADDR:
-      enum_request_set_addr();
+      enum_request_set_addr(e);
       break;
 
     case ENUM_GET_DEVICE_DESC: {
@@ -1372,21 +3147,29 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       TU_ASSERT(new_dev,);
       new_dev->addressed = 1;
 
-      // Close device 0
+      // Close device 0, enumeration continues with new address
       hcd_device_close(_dev0.rhport, 0);
+      e->daddr = new_addr;
+      _dev0.enumerating = 0;
+      enum_phase(e, TUH_ENUM_PHASE_DEVICE_DESC);
+
+      #if CFG_TUH_HUB && CFG_TUH_ENUMERATION_NUM > 1
+      // address 0 is free: resume hub status to pick up next attached device
+      if (e->hub_addr) hub_edpt_status_xfer(e->hub_addr);
+      #endif
 
       // open control pipe for new address
       TU_ASSERT(usbh_edpt_control_open(new_addr, new_dev->ep0_size),);
 
       // Get full device descriptor
       TU_LOG_USBH("Get Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(new_addr, _usbh_ctrl_buf, sizeof(tusb_desc_device_t),
-                                          process_enumeration, ENUM_GET_9BYTE_CONFIG_DESC),);
+      TU_ASSERT(tuh_descriptor_get_device(new_addr, e->buf, sizeof(tusb_desc_device_t),
+                                          process_enumeration, ENUM_PARSE_DEVICE_DESC),);
       break;
     }
 
-    case ENUM_GET_9BYTE_CONFIG_DESC: {
-      tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) _usbh_ctrl_buf;
+    case ENUM_PARSE_DEVICE_DESC: {
+      tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) e->buf;
       usbh_device_t* dev = get_device(daddr);
       TU_ASSERT(dev,);
 
@@ -1396,40 +3179,92 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       dev->i_product = desc_device->iProduct;
       dev->i_serial = desc_device->iSerialNumber;
 
-      //  if (tuh_attach_cb) tuh_attach_cb((tusb_desc_device_t*) _usbh_ctrl_buf);
+      #if CFG_TUH_DESC_CACHE
+      e->desc_device = *desc_device;
+      #endif
 
-      // Get 9-byte for total length
+      //  if (tuh_attach_cb) tuh_attach_cb((tusb_desc_device_t*) e->buf);
+
+      #if CFG_TUH_STRING_CACHE
+      // continue with ENUM_GET_9BYTE_CONFIG_DESC once all strings are fetched
+      if (enum_string_request(e, STRING_SLOT_LANGID)) break;
+      #endif
+      TU_ATTR_FALLTHROUGH;
+    }
+
+    case ENUM_GET_9BYTE_CONFIG_DESC: {
+      enum_phase(e, TUH_ENUM_PHASE_CONFIG_DESC);
       uint8_t const config_idx = CONFIG_NUM - 1;
+      #if CFG_TUH_ENUM_CONFIG_SPECULATIVE
+      // Ask for the whole buffer: most devices reply with the full descriptor and a short packet
+      TU_LOG_USBH("Get Configuration[0] Descriptor (%u bytes)\r\n", CFG_TUH_ENUMERATION_BUFSIZE);
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, e->buf, CFG_TUH_ENUMERATION_BUFSIZE,
+                                                 process_enumeration, ENUM_GET_FULL_CONFIG_DESC),);
+      #else
+      // Get 9-byte for total length
       TU_LOG_USBH("Get Configuration[0] Descriptor (9 bytes)\r\n");
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_ctrl_buf, 9,
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, e->buf, 9,
                                                  process_enumeration, ENUM_GET_FULL_CONFIG_DESC),);
+      #endif
       break;
     }
 
     case ENUM_GET_FULL_CONFIG_DESC: {
-      uint8_t const* desc_config = _usbh_ctrl_buf;
+      uint8_t const* desc_config = e->buf;
+      TU_ASSERT(xfer->actual_len >= sizeof(tusb_desc_configuration_t),);
 
       // Use offsetof to avoid pointer to the odd/misaligned address
       uint16_t const total_len = tu_le16toh(
           tu_unaligned_read16(desc_config + offsetof(tusb_desc_configuration_t, wTotalLength)));
 
+      #if CFG_TUH_ENUM_CONFIG_SPECULATIVE
+      // speculative fetch already got the whole descriptor
+      if (total_len <= xfer->actual_len) {
+        #if CFG_TUH_DESC_CACHE
+        desc_cache_store(&e->desc_device, e->buf, total_len);
+        #endif
+        enum_phase(e, TUH_ENUM_PHASE_SET_CONFIG);
+        TU_ASSERT(tuh_configuration_set(daddr, CONFIG_NUM, process_enumeration, ENUM_CONFIG_DRIVER),);
+        break;
+      }
+      TU_LOG_USBH("Configuration[0] Descriptor truncated (%u/%u)\r\n", (unsigned) xfer->actual_len, total_len);
+      #endif
+
       // TODO not enough buffer to hold configuration descriptor
       TU_ASSERT(total_len <= CFG_TUH_ENUMERATION_BUFSIZE,);
 
+      #if CFG_TUH_DESC_CACHE
+      // 9-byte header matches cached descriptor of the same device: skip the full read
+      if (desc_cache_load(&e->desc_device, e->buf, total_len)) {
+        TU_LOG_USBH("Configuration[0] Descriptor from cache\r\n");
+        enum_phase(e, TUH_ENUM_PHASE_SET_CONFIG);
+        TU_ASSERT(tuh_configuration_set(daddr, CONFIG_NUM, process_enumeration, ENUM_CONFIG_DRIVER),);
+        break;
+      }
+      #endif
+
       // Get full configuration descriptor
       uint8_t const config_idx = CONFIG_NUM - 1;
       TU_LOG_USBH("Get Configuration[0] Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_ctrl_buf, total_len,
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, e->buf, total_len,
                                                  process_enumeration, ENUM_SET_CONFIG),);
       break;
     }
 
     case ENUM_SET_CONFIG:
+      #if CFG_TUH_DESC_CACHE
+      if (xfer->actual_len == tu_le16toh(xfer->setup->wLength)) {
+        desc_cache_store(&e->desc_device, e->buf, (uint16_t) xfer->actual_len);
+      }
+      #endif
+
+      enum_phase(e, TUH_ENUM_PHASE_SET_CONFIG);
       TU_ASSERT(tuh_configuration_set(daddr, CONFIG_NUM, process_enumeration, ENUM_CONFIG_DRIVER),);
       break;
 
     case ENUM_CONFIG_DRIVER: {
       TU_LOG_USBH("Device configured\r\n");
+      enum_phase(e, TUH_ENUM_PHASE_CLASS_MOUNT);
       usbh_device_t* dev = get_device(daddr);
       TU_ASSERT(dev,);
 
@@ -1437,7 +3272,7 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 
       // Parse configuration & set up drivers
       // driver_open() must not make any usb transfer
-      TU_ASSERT(_parse_configuration_descriptor(daddr, (tusb_desc_configuration_t*) _usbh_ctrl_buf),);
+      TU_ASSERT(_parse_configuration_descriptor(daddr, (tusb_desc_configuration_t*) e->buf),);
 
       // Start the Set Configuration process for interfaces (itf = TUSB_INDEX_INVALID_8)
       // Since driver can perform control transfer within its set_config, this is done asynchronously.
@@ -1449,55 +3284,42 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 
     default:
       // stop enumeration if unknown state
-      enum_full_complete();
+      enum_full_complete(e);
       break;
   }
 }
 
-static bool enum_new_device(hcd_event_t* event) {
+static bool enum_new_device(usbh_enum_t* e, hcd_event_t* event) {
   _dev0.rhport = event->rhport;
   _dev0.hub_addr = event->connection.hub_addr;
   _dev0.hub_port = event->connection.hub_port;
 
-  if (_dev0.hub_addr == 0) {
+  e->used         = true;
+  e->daddr        = 0;
+  e->failed_count = 0;
+  e->rhport       = event->rhport;
+  e->hub_addr     = event->connection.hub_addr;
+  e->hub_port     = event->connection.hub_port;
+  enum_phase(e, TUH_ENUM_PHASE_ATTACH);
+
+  tuh_enum_timing_t timing = {
+    .reset_ms    = CFG_TUH_ENUM_RESET_DELAY_MS,
+    .debounce_ms = CFG_TUH_ENUM_DEBOUNCE_DELAY_MS
+  };
+  if (tuh_enum_timing_cb) tuh_enum_timing_cb(e->rhport, e->hub_addr, e->hub_port, &timing);
+
+  if (e->hub_addr == 0) {
     // connected/disconnected directly with roothub
     hcd_port_reset(_dev0.rhport);
-    osal_task_delay(ENUM_RESET_DELAY); // TODO may not work for no-OS on MCU that require reset_end() since
+    osal_task_delay(timing.reset_ms); // TODO may not work for no-OS on MCU that require reset_end() since
     // sof of controller may not running while resetting
     hcd_port_reset_end(_dev0.rhport);
-
-    // wait until device connection is stable TODO non blocking
-    osal_task_delay(ENUM_CONTACT_DEBOUNCING_DELAY);
-
-    // device unplugged while delaying
-    if (!hcd_port_connect_status(_dev0.rhport)) {
-      enum_full_complete();
-      return true;
-    }
-
-    _dev0.speed = hcd_port_speed_get(_dev0.rhport);
-    TU_LOG_USBH("%s Speed\r\n", tu_str_speed[_dev0.speed]);
-
-    // fake transfer to kick-off the enumeration process
-    tuh_xfer_t xfer;
-    xfer.daddr = 0;
-    xfer.result = XFER_RESULT_SUCCESS;
-    xfer.user_data = ENUM_ADDR0_DEVICE_DESC;
-
-    process_enumeration(&xfer);
   }
-#if CFG_TUH_HUB
-  else {
-    // connected/disconnected via external hub
-    // wait until device connection is stable TODO non blocking
-    osal_task_delay(ENUM_CONTACT_DEBOUNCING_DELAY);
+  // connected via external hub: port is already reset by hub driver
 
-    // ENUM_HUB_GET_STATUS
-    //TU_ASSERT( hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf, enum_hub_get_status0_complete, 0) );
-    TU_ASSERT(hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf,
-                                  process_enumeration, ENUM_HUB_CLEAR_RESET_1));
-  }
-#endif // hub
+  // when plug/unplug a device, physical connection can be bouncing and may generate a series of attach/detach
+  // events: wait until connection is stable, other events are still processed meanwhile
+  enum_delay(e, timing.debounce_ms, ENUM_DEBOUNCED);
 
   return true;
 }
@@ -1521,18 +3343,19 @@ static uint8_t get_new_address(bool is_hub) {
   return 0; // invalid address
 }
 
-static bool enum_request_set_addr(void) {
-  tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) _usbh_ctrl_buf;
+static bool enum_request_set_addr(usbh_enum_t* e) {
+  tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) e->buf;
 
   // Get new address
   uint8_t const new_addr = get_new_address(desc_device->bDeviceClass == TUSB_CLASS_HUB);
   TU_ASSERT(new_addr != 0);
   TU_LOG_USBH("Set Address = %d\r\n", new_addr);
+  enum_phase(e, TUH_ENUM_PHASE_SET_ADDR);
 
   usbh_device_t* new_dev = get_device(new_addr);
   new_dev->rhport = _dev0.rhport;
-  new_dev->hub_addr = _dev0.hub_addr;
-  new_dev->hub_port = _dev0.hub_port;
+  new_dev->hub_addr = e->hub_addr;
+  new_dev->hub_port = e->hub_port;
   new_dev->speed = _dev0.speed;
   new_dev->connected = 1;
   new_dev->ep0_size = desc_device->bMaxPacketSize0;
@@ -1561,7 +3384,211 @@ static bool enum_request_set_addr(void) {
   return true;
 }
 
-static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg) {
+//--------------------------------------------------------------------+
+// Configuration Descriptor Index
+//--------------------------------------------------------------------+
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+static void cfg_index_build(void) {
+  usbh_cfg_index_t* idx = &_usbh_cfg_index;
+  uint8_t const* p_desc = idx->desc_cfg;
+  uint8_t const* desc_end = p_desc + idx->total_len;
+  usbh_cfg_index_itf_t* cur = NULL;
+
+  idx->itf_count = idx->ep_count = idx->last = 0;
+  p_desc = tu_desc_next(p_desc);
+
+  while (p_desc < desc_end) {
+    uint8_t const desc_len = tu_desc_len(p_desc);
+    uint16_t const offset = (uint16_t) (p_desc - idx->desc_cfg);
+    if (desc_len < 2 || p_desc + desc_len > desc_end) break; // malformed, index what is valid so far
+
+    switch (tu_desc_type(p_desc)) {
+      case TUSB_DESC_INTERFACE:
+        if (idx->itf_count == CFG_TUH_CONFIG_INDEX_ITF_MAX) {
+          idx->itf_count = 0;
+          return;
+        }
+        cur = &idx->itf[idx->itf_count++];
+        cur->offset    = offset;
+        cur->len       = 0;
+        cur->cs_offset = 0;
+        cur->ep_first  = idx->ep_count;
+        cur->ep_count  = 0;
+        break;
+
+      case TUSB_DESC_INTERFACE_ASSOCIATION:
+        cur = NULL;
+        break;
+
+      case TUSB_DESC_ENDPOINT:
+        if (cur) {
+          if (idx->ep_count == CFG_TUH_CONFIG_INDEX_EP_MAX) {
+            idx->itf_count = 0;
+            return;
+          }
+          idx->ep_offset[idx->ep_count++] = offset;
+          cur->ep_count++;
+        }
+        break;
+
+      default:
+        if (cur && cur->ep_count == 0 && cur->cs_offset == 0) {
+          cur->cs_offset = offset;
+        }
+        break;
+    }
+
+    if (cur) cur->len = (uint16_t) (cur->len + desc_len);
+    p_desc += desc_len;
+  }
+}
+
+// Index entry of interface descriptor, NULL if not indexed
+static usbh_cfg_index_itf_t const* cfg_index_find(tusb_desc_interface_t const* desc_itf) {
+  usbh_cfg_index_t* idx = &_usbh_cfg_index;
+  if (idx->itf_count == 0) return NULL;
+
+  uint16_t const offset = (uint16_t) ((uint8_t const*) desc_itf - idx->desc_cfg);
+  if (idx->itf[idx->last].offset == offset) return &idx->itf[idx->last];
+
+  // entries are sorted by offset
+  uint8_t lo = 0;
+  uint8_t hi = idx->itf_count;
+  while (lo < hi) {
+    uint8_t const mid = (uint8_t) ((lo + hi) / 2);
+    if (idx->itf[mid].offset == offset) {
+      idx->last = mid;
+      return &idx->itf[mid];
+    } else if (idx->itf[mid].offset < offset) {
+      lo = (uint8_t) (mid + 1);
+    } else {
+      hi = mid;
+    }
+  }
+
+  return NULL;
+}
+#endif
+
+// descriptor is within the configuration being parsed
+static bool cfg_desc_contains(void const* desc) {
+  uint8_t const* p_desc = (uint8_t const*) desc;
+  return _usbh_cfg_index.desc_cfg && p_desc > _usbh_cfg_index.desc_cfg &&
+         p_desc < _usbh_cfg_index.desc_cfg + _usbh_cfg_index.total_len;
+}
+
+tusb_desc_endpoint_t const* usbh_desc_itf_edpt(tusb_desc_interface_t const* desc_itf, uint8_t idx) {
+  TU_VERIFY(cfg_desc_contains(desc_itf), NULL);
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  usbh_cfg_index_itf_t const* entry = cfg_index_find(desc_itf);
+  if (entry) {
+    TU_VERIFY(idx < entry->ep_count, NULL);
+    return (tusb_desc_endpoint_t const*) (_usbh_cfg_index.desc_cfg + _usbh_cfg_index.ep_offset[entry->ep_first + idx]);
+  }
+#endif
+
+  uint8_t const* desc_end = _usbh_cfg_index.desc_cfg + _usbh_cfg_index.total_len;
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+    if (TUSB_DESC_INTERFACE == desc_type || TUSB_DESC_INTERFACE_ASSOCIATION == desc_type) break;
+    if (TUSB_DESC_ENDPOINT == desc_type) {
+      if (idx == 0) return (tusb_desc_endpoint_t const*) p_desc;
+      idx--;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return NULL;
+}
+
+uint8_t const* usbh_desc_itf_cs(tusb_desc_interface_t const* desc_itf) {
+  TU_VERIFY(cfg_desc_contains(desc_itf), NULL);
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  usbh_cfg_index_itf_t const* entry = cfg_index_find(desc_itf);
+  if (entry) {
+    return entry->cs_offset ? _usbh_cfg_index.desc_cfg + entry->cs_offset : NULL;
+  }
+#endif
+
+  uint8_t const* desc_end = _usbh_cfg_index.desc_cfg + _usbh_cfg_index.total_len;
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  if (p_desc >= desc_end) return NULL;
+
+  uint8_t const desc_type = tu_desc_type(p_desc);
+  TU_VERIFY(TUSB_DESC_INTERFACE != desc_type && TUSB_DESC_INTERFACE_ASSOCIATION != desc_type &&
+            TUSB_DESC_ENDPOINT != desc_type, NULL);
+  return p_desc;
+}
+
+tusb_desc_interface_t const* usbh_desc_itf_next(tusb_desc_interface_t const* desc_itf) {
+  TU_VERIFY(cfg_desc_contains(desc_itf), NULL);
+
+  uint8_t const* desc_end = _usbh_cfg_index.desc_cfg + _usbh_cfg_index.total_len;
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  usbh_cfg_index_itf_t const* entry = cfg_index_find(desc_itf);
+  if (entry) {
+    usbh_cfg_index_t* idx = &_usbh_cfg_index;
+    uint8_t const next = (uint8_t) (entry - idx->itf + 1);
+    return (next < idx->itf_count) ? (tusb_desc_interface_t const*) (idx->desc_cfg + idx->itf[next].offset) : NULL;
+  }
+#endif
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) return (tusb_desc_interface_t const*) p_desc;
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return NULL;
+}
+
+// Bind endpoint to driver
+static void edpt_bind_ep(uint8_t dev_addr, uint8_t ep_addr, uint8_t drv_id) {
+  usbh_edpt_t* ep = edpt_alloc(dev_addr, ep_addr);
+  if (ep) {
+    TU_LOG_USBH("  Bind EP %02x to driver id %u\r\n", ep_addr, drv_id);
+    ep->drv_id = drv_id;
+  }
+}
+
+// Bind all endpoints of interface(s) to driver
+static void edpt_bind_driver(uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t desc_len, uint8_t drv_id) {
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + desc_len;
+
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  usbh_cfg_index_t* idx = &_usbh_cfg_index;
+  usbh_cfg_index_itf_t const* entry = cfg_index_find(desc_itf);
+  if (entry) {
+    // all interfaces (alternate settings) within driver's descriptors
+    uint16_t const end_offset = (uint16_t) (desc_end - idx->desc_cfg);
+    for (; entry < idx->itf + idx->itf_count && entry->offset < end_offset; entry++) {
+      for (uint8_t i = 0; i < entry->ep_count; i++) {
+        tusb_desc_endpoint_t const* desc_ep =
+            (tusb_desc_endpoint_t const*) (idx->desc_cfg + idx->ep_offset[entry->ep_first + i]);
+        edpt_bind_ep(dev_addr, desc_ep->bEndpointAddress, drv_id);
+      }
+    }
+    return;
+  }
+#endif
+
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      edpt_bind_ep(dev_addr, ((tusb_desc_endpoint_t const*) p_desc)->bEndpointAddress, drv_id);
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+}
+
+// open class drivers for interfaces of configuration
+static bool config_open_drivers(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg) {
   usbh_device_t* dev = get_device(dev_addr);
   uint16_t const total_len = tu_le16toh(desc_cfg->wTotalLength);
   uint8_t const* desc_end = ((uint8_t const*) desc_cfg) + total_len;
@@ -1588,6 +3615,19 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     TU_ASSERT( TUSB_DESC_INTERFACE == tu_desc_type(p_desc) );
     tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
 
+#if CFG_TUH_AUDIO
+    // UAC1 has no IAD: AudioControl interface header lists its streaming interfaces in bInCollection
+    if (1                      == assoc_itf_count              &&
+        TUSB_CLASS_AUDIO       == desc_itf->bInterfaceClass    &&
+        AUDIO_SUBCLASS_CONTROL == desc_itf->bInterfaceSubClass) {
+      uint8_t const* p_header = tu_desc_next(desc_itf);
+      if (p_header < desc_end && TUSB_DESC_CS_INTERFACE == tu_desc_type(p_header) && tu_desc_len(p_header) >= 8 &&
+          AUDIO_CS_AC_INTERFACE_HEADER == p_header[2] && AUDIO_FUNC_PROTOCOL_CODE_UNDEF == desc_itf->bInterfaceProtocol) {
+        assoc_itf_count = (uint8_t) (1 + p_header[7]);
+      }
+    }
+#endif
+
 #if CFG_TUH_MIDI
     // MIDI has 2 interfaces (Audio Control v1 + MIDIStreaming) but does not have IAD
     // manually force associated count = 2
@@ -1609,6 +3649,26 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     }
 #endif
 
+#if CFG_TUH_CDC_RNDIS
+    // RNDIS devices without IAD: communication interface is followed by its data interface
+    if (1                                        == assoc_itf_count              &&
+        ((TUSB_CLASS_CDC                           == desc_itf->bInterfaceClass    &&
+          CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == desc_itf->bInterfaceSubClass) ||
+         TUSB_CLASS_WIRELESS_CONTROLLER            == desc_itf->bInterfaceClass)) {
+      assoc_itf_count = 2;
+    }
+#endif
+
+#if CFG_TUH_NCM
+    // ECM/NCM adapters commonly use device class instead of IAD to combine communication and data interfaces
+    if (1                                        == assoc_itf_count              &&
+        TUSB_CLASS_CDC                           == desc_itf->bInterfaceClass    &&
+        (CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == desc_itf->bInterfaceSubClass ||
+         CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL  == desc_itf->bInterfaceSubClass)) {
+      assoc_itf_count = 2;
+    }
+#endif
+
     uint16_t const drv_len = tu_desc_get_interface_total_len(desc_itf, assoc_itf_count, (uint16_t) (desc_end-p_desc));
     TU_ASSERT(drv_len >= sizeof(tusb_desc_interface_t));
 
@@ -1629,7 +3689,7 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
         }
 
         // bind all endpoints to found driver
-        tu_edpt_bind_driver(dev->ep2drv, desc_itf, drv_len, drv_id);
+        edpt_bind_driver(dev_addr, desc_itf, drv_len, drv_id);
 
         break; // exit driver find loop
       }
@@ -1644,9 +3704,25 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     p_desc += drv_len;
   }
 
+  dev->remote_wakeup = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1 : 0;
+
   return true;
 }
 
+static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg) {
+  // index is only valid while drivers are opened
+  _usbh_cfg_index.desc_cfg  = (uint8_t const*) desc_cfg;
+  _usbh_cfg_index.total_len = tu_le16toh(desc_cfg->wTotalLength);
+#if CFG_TUH_CONFIG_INDEX_ITF_MAX
+  cfg_index_build();
+#endif
+
+  bool const ret = config_open_drivers(dev_addr, desc_cfg);
+  _usbh_cfg_index.desc_cfg = NULL;
+
+  return ret;
+}
+
 void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
   usbh_device_t* dev = get_device(dev_addr);
 
@@ -1665,24 +3741,36 @@ void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
 
   // all interface are configured
   if (itf_num == CFG_TUH_INTERFACE_MAX) {
-    enum_full_complete();
+    usbh_enum_t* e = enum_get(dev_addr);
+    if (e) {
+      enum_phase(e, TUH_ENUM_PHASE_MOUNTED);
+      enum_full_complete(e);
+    }
 
     if (is_hub_addr(dev_addr)) {
       TU_LOG_USBH("HUB address = %u is mounted\r\n", dev_addr);
     }else {
       // Invoke callback if available
       if (tuh_mount_cb) tuh_mount_cb(dev_addr);
+
+      #if CFG_TUH_SUSPEND
+      pm_idle_restart(dev_addr);
+      #endif
     }
   }
 }
 
-static void enum_full_complete(void) {
-  // mark enumeration as complete
-  _dev0.enumerating = 0;
+static void enum_full_complete(usbh_enum_t* e) {
+  if (e->phase != TUH_ENUM_PHASE_MOUNTED) enum_phase(e, TUH_ENUM_PHASE_ABORTED);
+
+  // mark enumeration as complete, release address 0 if device is not addressed yet
+  if (e->daddr == 0) _dev0.enumerating = 0;
+  usbh_timer_stop(&e->timer);
+  e->used = false;
 
 #if CFG_TUH_HUB
   // get next hub status
-  if (_dev0.hub_addr) hub_edpt_status_xfer(_dev0.hub_addr);
+  if (e->hub_addr) hub_edpt_status_xfer(e->hub_addr);
 #endif
 
 }
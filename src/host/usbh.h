@@ -67,6 +67,13 @@ struct tuh_xfer_s {
   // uint32_t timeout_ms;    // place holder, not supported yet
 };
 
+// Isochronous packet, packets of a transfer are laid out back to back in the transfer buffer
+typedef struct {
+  uint16_t length;       // OUT: number of bytes to send, IN: max number of bytes to receive
+  uint16_t actual_len;   // number of bytes transferred, updated on completion
+  xfer_result_t result;  // result of this packet, updated on completion
+} tuh_iso_packet_t;
+
 // Subject to change
 typedef struct {
   uint8_t daddr;
@@ -93,9 +100,55 @@ TU_ATTR_WEAK void tuh_mount_cb (uint8_t daddr);
 // Invoked when a device is unmounted (detached)
 TU_ATTR_WEAK void tuh_umount_cb(uint8_t daddr);
 
+// Invoked when a device is selectively suspended, by tuh_suspend() or idle timeout (CFG_TUH_SUSPEND)
+TU_ATTR_WEAK void tuh_suspend_cb(uint8_t daddr);
+
+// Invoked when a suspended device is resumed, by tuh_resume() or its remote wakeup (CFG_TUH_SUSPEND)
+TU_ATTR_WEAK void tuh_resume_cb(uint8_t daddr);
+
+// Phase of device enumeration reported by tuh_enum_phase_cb()
+typedef enum {
+  TUH_ENUM_PHASE_ATTACH = 0,  // device attached, port reset and debounce delay
+  TUH_ENUM_PHASE_ADDR0_DESC,  // reset complete, get first 8 bytes of device descriptor at address 0
+  TUH_ENUM_PHASE_SET_ADDR,    // set address
+  TUH_ENUM_PHASE_DEVICE_DESC, // addressed, get device descriptor (and strings with CFG_TUH_STRING_CACHE)
+  TUH_ENUM_PHASE_CONFIG_DESC, // get configuration descriptor
+  TUH_ENUM_PHASE_SET_CONFIG,  // set configuration
+  TUH_ENUM_PHASE_CLASS_MOUNT, // class drivers open and configure interfaces
+  TUH_ENUM_PHASE_MOUNTED,     // all interfaces configured, followed by tuh_mount_cb() (except hub)
+  TUH_ENUM_PHASE_ABORTED,     // enumeration failed or device unplugged
+} tuh_enum_phase_t;
+
+// Invoked when enumeration of a device enters a new phase e.g to timestamp each phase. Device is identified by
+// rhport + hub address/port, daddr is 0 until address is set.
+TU_ATTR_WEAK void tuh_enum_phase_cb(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port, uint8_t daddr,
+                                    tuh_enum_phase_t phase);
+
+// Enumeration timing of a port, pre-filled with CFG_TUH_ENUM_RESET_DELAY_MS/CFG_TUH_ENUM_DEBOUNCE_DELAY_MS
+typedef struct {
+  uint16_t reset_ms;    // root port reset duration
+  uint16_t debounce_ms; // wait for stable connection before enumerating
+} tuh_enum_timing_t;
+
+// Invoked when a device is attached to override its enumeration timing e.g fast attach for a device known to be
+// soldered-down. Debounce delay does not block tuh_task(), other devices are still serviced meanwhile.
+TU_ATTR_WEAK void tuh_enum_timing_cb(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port, tuh_enum_timing_t* timing);
+
 // Invoked when there is a new usb event, which need to be processed by tuh_task()/tuh_task_ext()
 void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 
+// Invoked to get a free running timestamp in microseconds for tuh_task_ext() time budget (CFG_TUH_TASK_TIME_BUDGET_US)
+TU_ATTR_WEAK uint32_t tuh_task_time_us_cb(void);
+
+#if CFG_TUH_DESC_CACHE
+// Invoked on descriptor cache miss (CFG_TUH_DESC_CACHE) to load configuration descriptor previously stored
+// with tuh_descriptor_cache_store_cb() e.g from flash. Return number of bytes copied, 0 if not available.
+TU_ATTR_WEAK uint16_t tuh_descriptor_cache_load_cb(tusb_desc_device_t const* desc_device, uint8_t* desc_config, uint16_t bufsize);
+
+// Invoked when configuration descriptor of a device is fetched during enumeration, application can persist it
+TU_ATTR_WEAK void tuh_descriptor_cache_store_cb(tusb_desc_device_t const* desc_device, uint8_t const* desc_config, uint16_t len);
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -126,6 +179,34 @@ void tuh_task(void) {
 // Check if there is pending events need processing by tuh_task()
 bool tuh_task_event_ready(void);
 
+// Get number of events dropped since init because event queue is full: normal and high priority
+// (CFG_TUH_TASK_QUEUE_HI_SZ) queue. Non-zero means CFG_TUH_TASK_QUEUE_SZ or CFG_TUH_TASK_QUEUE_HI_SZ is too small.
+void tuh_task_queue_overflow_get(uint32_t* normal, uint32_t* high);
+
+#if CFG_TUH_TASK_QUEUE_STATS
+// Get event queue statistics, accumulated since tuh_init() or tuh_event_queue_stats_clear()
+bool tuh_event_queue_stats(tusb_event_queue_stats_t* stats);
+
+// Clear event queue statistics
+void tuh_event_queue_stats_clear(void);
+#endif
+
+#if CFG_TUH_EVENT_TIMESTAMP
+// Timestamp (CFG_TUSB_EVENT_TIMESTAMP) of the event being dispatched by tuh_task(), i.e when the controller
+// reported it. Valid in callbacks invoked from tuh_task() e.g class driver xfer_cb() or transfer complete_cb
+uint32_t tuh_event_timestamp(void);
+#endif
+
+// Milliseconds application can sleep before tuh_task() needs to run: 0 if events are pending, time left of
+// enumeration debounce delay, or UINT32_MAX if stack only needs to run on host controller interrupt.
+// New events are signaled by tuh_event_hook_cb()
+uint32_t tuh_task_next_deadline_ms(void);
+
+#if CFG_TUH_DESC_CACHE
+// Invalidate all descriptor cache entries in RAM
+void tuh_descriptor_cache_clear(void);
+#endif
+
 #ifndef _TUSB_HCD_H_
 extern void hcd_int_handler(uint8_t rhport, bool in_isr);
 #endif
@@ -134,8 +215,19 @@ extern void hcd_int_handler(uint8_t rhport, bool in_isr);
 // - tuh_int_handler(rhport) --> hcd_int_handler(rhport, true)
 // - tuh_int_handler(rhport, in_isr) --> hcd_int_handler(rhport, in_isr)
 // Note: this is similar to TU_VERIFY(), _GET_3RD_ARG() is defined in tusb_verify.h
-#define _tuh_int_handler_1arg(_rhport)            hcd_int_handler(_rhport, true)
-#define _tuh_int_hanlder_2arg(_rhport, _in_isr)   hcd_int_handler(_rhport, _in_isr)
+#if CFG_TUSB_TRACE
+  #define _tuh_int_handler_traced(_rhport, _in_isr) \
+    do {                                          \
+      TU_TRACE(TU_TRACE_ISR_ENTER, _rhport, 0);   \
+      hcd_int_handler(_rhport, _in_isr);          \
+      TU_TRACE(TU_TRACE_ISR_EXIT, _rhport, 0);    \
+    } while (0)
+  #define _tuh_int_handler_1arg(_rhport)            _tuh_int_handler_traced(_rhport, true)
+  #define _tuh_int_hanlder_2arg(_rhport, _in_isr)   _tuh_int_handler_traced(_rhport, _in_isr)
+#else
+  #define _tuh_int_handler_1arg(_rhport)            hcd_int_handler(_rhport, true)
+  #define _tuh_int_hanlder_2arg(_rhport, _in_isr)   hcd_int_handler(_rhport, _in_isr)
+#endif
 #define tuh_int_handler(...)   _GET_3RD_ARG(__VA_ARGS__, _tuh_int_hanlder_2arg, _tuh_int_handler_1arg, _dummy)(__VA_ARGS__)
 
 // Check if roothub port is initialized and active as a host
@@ -151,19 +243,35 @@ bool tuh_rhport_reset_bus(uint8_t rhport, bool active);
 // Get VID/PID of device
 bool tuh_vid_pid_get(uint8_t daddr, uint16_t* vid, uint16_t* pid);
 
+#if CFG_TUH_STRING_CACHE
+// Language ID used to fetch cached strings i.e first one of device, 0 if device has no string
+uint16_t tuh_langid_get(uint8_t daddr);
+
+// UTF-8 manufacturer/product/serial string fetched during enumeration, NULL if device has none or request failed.
+// Available from tuh_mount_cb() until device is unmounted.
+char const* tuh_manufacturer_string_get(uint8_t daddr);
+char const* tuh_product_string_get(uint8_t daddr);
+char const* tuh_serial_string_get(uint8_t daddr);
+#endif
+
 // Get speed of device
 tusb_speed_t tuh_speed_get(uint8_t daddr);
 
 // Check if device is connected and configured
 bool tuh_mounted(uint8_t daddr);
 
-// Check if device is suspended
-TU_ATTR_ALWAYS_INLINE static inline
-bool tuh_suspended(uint8_t daddr) {
-  // TODO implement suspend & resume on host
-  (void) daddr;
-  return false;
-}
+// Check if device is suspended (or still suspending/resuming)
+bool tuh_suspended(uint8_t daddr);
+
+#if CFG_TUH_SUSPEND
+// Selectively suspend a mounted (non-hub) device, remote wakeup is enabled first if device supports it.
+// Pending transfers are aborted and restarted when resumed. tuh_suspend_cb() is invoked when complete.
+bool tuh_suspend(uint8_t daddr);
+
+// Resume a suspended device, tuh_resume_cb() is invoked when it is ready to communicate with.
+// OUT or control transfer on a suspended device also resumes it.
+bool tuh_resume(uint8_t daddr);
+#endif
 
 // Check if device is ready to communicate with
 TU_ATTR_ALWAYS_INLINE static inline
@@ -183,15 +291,32 @@ bool tuh_control_xfer(tuh_xfer_t* xfer);
 // Submit a bulk/interrupt transfer
 //  - async: complete callback invoked when finished.
 //  - sync : blocking if complete callback is NULL.
+//  - with CFG_TUH_API_EDPT_XFER_QUEUE_NUM, async transfer on a busy endpoint is queued and started when previous one completes
 bool tuh_edpt_xfer(tuh_xfer_t* xfer);
 
+#if CFG_TUH_API_EDPT_XFER
+// Submit an isochronous transfer of packet_count packets, one per service interval of the endpoint
+//  - async only: complete callback is required, xfer->buflen is not used.
+//  - packet length and result are updated in packets[] before complete callback is invoked, actual_len of
+//    the transfer is the sum of all packets. Resubmit from callback for continuous streaming.
+//  - require host controller support e.g EHCI with CFG_TUH_EHCI_ISO_EDPT_MAX (highspeed device only)
+bool tuh_edpt_iso_xfer(tuh_xfer_t* xfer, tuh_iso_packet_t* packets, uint16_t packet_count);
+#endif
+
 // Open a non-control endpoint
 bool tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const * desc_ep);
 
-// Abort a queued transfer. Note: it can only abort transfer that has not been started
+// Abort a queued transfer, transfers waiting in software queue of the endpoint are also dropped.
+// Note: it can only abort transfer that has not been started
 // Return true if a queued transfer is aborted, false if there is no transfer to abort
 bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr);
 
+#if CFG_TUH_EDPT_STATS
+// Get runtime statistics of a non-control endpoint, accumulated since it is opened.
+// Completion is timestamped in tuh_task(), latency therefore includes task scheduling delay
+bool tuh_edpt_stats_get(uint8_t daddr, uint8_t ep_addr, tusb_edpt_stats_t* stats);
+#endif
+
 // Set Configuration (control transfer)
 // config_num = 0 will un-configure device. Note: config_num = config_descriptor_index + 1
 // true on success, false if there is on-going control transfer or incorrect parameters
@@ -250,6 +375,10 @@ bool tuh_descriptor_get_product_string(uint8_t daddr, uint16_t language_id, void
 bool tuh_descriptor_get_serial_string(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len,
                                       tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 
+// Convert string descriptor (UTF-16LE) to null-terminated UTF-8, truncated at character boundary to fit bufsize.
+// Return length of UTF-8 string
+size_t tuh_string_desc_to_utf8(void const* desc, char* utf8, size_t bufsize);
+
 //--------------------------------------------------------------------+
 // Descriptors Synchronous (blocking)
 //--------------------------------------------------------------------+
@@ -71,12 +71,52 @@ void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num);
 
 uint8_t usbh_get_rhport(uint8_t dev_addr);
 
-uint8_t* usbh_get_enum_buf(void);
+// Get enumeration buffer of a device, shared buffer is returned if device is not being enumerated
+uint8_t* usbh_get_enum_buf(uint8_t daddr);
+
+// Descriptors of an interface (alternate setting) of the configuration being parsed, looked up from an index built
+// once by usbh (CFG_TUH_CONFIG_INDEX_ITF_MAX). Only valid within class driver open(), return NULL otherwise.
+// Endpoint descriptor at idx of interface, NULL if interface has fewer endpoints
+tusb_desc_endpoint_t const* usbh_desc_itf_edpt(tusb_desc_interface_t const* desc_itf, uint8_t idx);
+
+// First class-specific descriptor between interface and its endpoints e.g HID or CDC functional descriptor.
+// NULL if there is none
+uint8_t const* usbh_desc_itf_cs(tusb_desc_interface_t const* desc_itf);
+
+// Next interface descriptor (alternate setting or next interface) in configuration, NULL if none
+tusb_desc_interface_t const* usbh_desc_itf_next(tusb_desc_interface_t const* desc_itf);
 
 void usbh_int_set(bool enabled);
 
 void usbh_defer_func(osal_task_func_t func, void *param, bool in_isr);
 
+#if CFG_TUSB_OTG
+// Leave host role of dual-role port: stop controller, remove all devices and drop pending events
+void usbh_role_exit(uint8_t rhport);
+#endif
+
+//--------------------------------------------------------------------+
+// Timer API
+// One-shot software timers run from tuh_task(), timed by host controller frame number. Timer storage is owned
+// by the caller and must stay valid until it expires or is stopped. Must be called in task context.
+//--------------------------------------------------------------------+
+
+typedef void (*usbh_timer_cb_t)(uintptr_t arg);
+
+typedef struct usbh_timer {
+  struct usbh_timer* next;
+  usbh_timer_cb_t cb;
+  uintptr_t arg;
+  uint32_t start; // frame number
+  uint32_t ms;
+} usbh_timer_t;
+
+// Invoke cb(arg) from tuh_task() after ms, restart timer if it is already running
+void usbh_timer_start(usbh_timer_t* timer, uint32_t ms, usbh_timer_cb_t cb, uintptr_t arg);
+
+// Stop timer if running, its callback will not be invoked
+void usbh_timer_stop(usbh_timer_t* timer);
+
 //--------------------------------------------------------------------+
 // USBH Endpoint API
 //--------------------------------------------------------------------+
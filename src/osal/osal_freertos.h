@@ -52,6 +52,36 @@ extern "C" {
 
 typedef SemaphoreHandle_t osal_semaphore_t;
 typedef SemaphoreHandle_t osal_mutex_t;
+
+#if CFG_TUSB_OS_FREERTOS_NOTIFY
+
+// ESP-IDF FreeRTOS is SMP with spinlock based critical section
+#if TUP_MCU_MULTIPLE_CORE || TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)
+  #error "CFG_TUSB_OS_FREERTOS_NOTIFY is not supported on multi-core MCUs"
+#endif
+
+// Ring buffer with indices in [0, 2*depth) to tell full from empty. Each queue is posted by a single
+// interrupt (or task context within critical section) and read by a single task.
+typedef struct
+{
+  uint16_t depth;
+  uint16_t item_sz;
+  void*    buf;
+
+  volatile uint16_t wr_idx;
+  volatile uint16_t rd_idx;
+  TaskHandle_t volatile task; // task waiting in osal_queue_receive()
+} osal_queue_def_t;
+
+typedef osal_queue_def_t* osal_queue_t;
+
+// _int_set is not used with an RTOS
+#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type) \
+  static _type _name##_##buf[_depth];\
+  osal_queue_def_t _name = { .depth = _depth, .item_sz = sizeof(_type), .buf = _name##_##buf };
+
+#else
+
 typedef QueueHandle_t osal_queue_t;
 
 typedef struct
@@ -80,6 +110,8 @@ typedef struct
   static _type _name##_##buf[_depth];\
   osal_queue_def_t _name = { .depth = _depth, .item_sz = sizeof(_type), .buf = _name##_##buf, _OSAL_Q_NAME(_name) };
 
+#endif
+
 //--------------------------------------------------------------------+
 // TASK API
 //--------------------------------------------------------------------+
@@ -165,6 +197,81 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hd
 // QUEUE API
 //--------------------------------------------------------------------+
 
+#if CFG_TUSB_OS_FREERTOS_NOTIFY
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t _osal_q_advance(osal_queue_t qhdl, uint16_t idx) {
+  idx++;
+  return (idx >= 2*qhdl->depth) ? 0 : idx;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void* _osal_q_slot(osal_queue_t qhdl, uint16_t idx) {
+  if (idx >= qhdl->depth) idx -= qhdl->depth;
+  return ((uint8_t*) qhdl->buf) + idx * qhdl->item_sz;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef) {
+  qdef->wr_idx = qdef->rd_idx = 0;
+  qdef->task = NULL;
+  return qdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
+  TickType_t ticks = _osal_ms2tick(msec);
+  qhdl->task = xTaskGetCurrentTaskHandle();
+
+  while (1) {
+    uint16_t const rd_idx = qhdl->rd_idx;
+    if (rd_idx != tu_atomic_load_acquire(&qhdl->wr_idx)) {
+      memcpy(data, _osal_q_slot(qhdl, rd_idx), qhdl->item_sz);
+      tu_atomic_store_release(&qhdl->rd_idx, _osal_q_advance(qhdl, rd_idx));
+      return true;
+    }
+
+    if (ticks == 0) return false;
+
+    // notification given after the check above is kept pending, so that there is no lost wake-up.
+    // A stale one (event already consumed) only causes an extra loop
+    if (ulTaskNotifyTake(pdTRUE, ticks) == 0) ticks = 0;
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const *data, bool in_isr) {
+  if (!in_isr) taskENTER_CRITICAL();
+
+  uint16_t const wr_idx = qhdl->wr_idx;
+  uint16_t const rd_idx = tu_atomic_load_acquire(&qhdl->rd_idx);
+  uint16_t const count = (uint16_t) ((wr_idx >= rd_idx) ? (wr_idx - rd_idx) : (2*qhdl->depth - rd_idx + wr_idx));
+  bool const full = (count >= qhdl->depth);
+
+  if (!full) {
+    memcpy(_osal_q_slot(qhdl, wr_idx), data, qhdl->item_sz);
+    tu_atomic_store_release(&qhdl->wr_idx, _osal_q_advance(qhdl, wr_idx));
+  }
+
+  TaskHandle_t const task = qhdl->task;
+
+  if (!in_isr) taskEXIT_CRITICAL();
+
+  if (full) return false;
+  if (task == NULL) return true;
+
+  if (!in_isr) {
+    xTaskNotifyGive(task);
+  } else {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  }
+
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_empty(osal_queue_t qhdl) {
+  return qhdl->rd_idx == tu_atomic_load_acquire(&qhdl->wr_idx);
+}
+
+#else
+
 TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef) {
   osal_queue_t q;
 
@@ -207,6 +314,8 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_empty(osal_queue_t qhdl) {
   return uxQueueMessagesWaiting(qhdl) == 0;
 }
 
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -54,6 +54,32 @@ TU_ATTR_ALWAYS_INLINE static inline osal_semaphore_t osal_semaphore_create(osal_
   return semdef;
 }
 
+#if TUP_MCU_MULTIPLE_CORE
+// Semaphore may be posted and taken from different cores: update count with atomic operations.
+// MCUs without native atomic instructions (e.g RP2040 Cortex-M0+) rely on the SDK libatomic helpers.
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr) {
+  (void) in_isr;
+  (void) __atomic_fetch_add(&sem_hdl->count, 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// TODO blocking for now
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_wait(osal_semaphore_t sem_hdl, uint32_t msec) {
+  (void) msec;
+
+  uint16_t count = __atomic_load_n(&sem_hdl->count, __ATOMIC_RELAXED);
+  while (1) {
+    if (count == 0) {
+      count = __atomic_load_n(&sem_hdl->count, __ATOMIC_RELAXED);
+    } else if (__atomic_compare_exchange_n(&sem_hdl->count, &count, (uint16_t) (count - 1), false,
+                                           __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  return true;
+}
+#else
 TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr) {
   (void) in_isr;
   sem_hdl->count++;
@@ -69,6 +95,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_wait(osal_semaphore_t se
 
   return true;
 }
+#endif
 
 TU_ATTR_ALWAYS_INLINE static inline void osal_semaphore_reset(osal_semaphore_t sem_hdl) {
   sem_hdl->count = 0;
@@ -114,6 +141,9 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hd
 typedef struct {
   void (* interrupt_set)(bool);
   tu_fifo_t ff;
+#if TUP_MCU_MULTIPLE_CORE
+  volatile bool spinlock; // USB interrupt only masks the local core, posting from the other core needs a spinlock
+#endif
 } osal_queue_def_t;
 
 typedef osal_queue_def_t* osal_queue_t;
@@ -126,14 +156,29 @@ typedef osal_queue_def_t* osal_queue_t;
     .ff = TU_FIFO_INIT(_name##_buf, _depth, _type, false) \
   }
 
+#if TUP_MCU_MULTIPLE_CORE
+TU_ATTR_ALWAYS_INLINE static inline void _osal_q_spin_lock(osal_queue_t qhdl) {
+  while (__atomic_test_and_set(&qhdl->spinlock, __ATOMIC_ACQUIRE)) {}
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void _osal_q_spin_unlock(osal_queue_t qhdl) {
+  __atomic_clear(&qhdl->spinlock, __ATOMIC_RELEASE);
+}
+#else
+  #define _osal_q_spin_lock(_qhdl)
+  #define _osal_q_spin_unlock(_qhdl)
+#endif
+
 // lock queue by disable USB interrupt
 TU_ATTR_ALWAYS_INLINE static inline void _osal_q_lock(osal_queue_t qhdl) {
   // disable dcd/hcd interrupt
   qhdl->interrupt_set(false);
+  _osal_q_spin_lock(qhdl);
 }
 
 // unlock queue
 TU_ATTR_ALWAYS_INLINE static inline void _osal_q_unlock(osal_queue_t qhdl) {
+  _osal_q_spin_unlock(qhdl);
   // enable dcd/hcd interrupt
   qhdl->interrupt_set(true);
 }
@@ -146,21 +191,31 @@ TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_de
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
   (void) msec; // not used, always behave as msec = 0
 
+#if CFG_TUSB_OS_NONE_LOCKFREE_QUEUE
+  // consumer only advances read index, published after event is copied out
+  return tu_fifo_read(&qhdl->ff, data);
+#else
   _osal_q_lock(qhdl);
   bool success = tu_fifo_read(&qhdl->ff, data);
   _osal_q_unlock(qhdl);
 
   return success;
+#endif
 }
 
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const* data, bool in_isr) {
-  if (!in_isr) {
+  if (in_isr) {
+    // ISR already runs with its own interrupt masked, but may race with a sender on the other core
+    _osal_q_spin_lock(qhdl);
+  } else {
     _osal_q_lock(qhdl);
   }
 
   bool success = tu_fifo_write(&qhdl->ff, data);
 
-  if (!in_isr) {
+  if (in_isr) {
+    _osal_q_spin_unlock(qhdl);
+  } else {
     _osal_q_unlock(qhdl);
   }
 
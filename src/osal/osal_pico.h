@@ -129,7 +129,20 @@ TU_ATTR_ALWAYS_INLINE static inline void _osal_q_unlock(osal_queue_t qhdl)
 
 TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
 {
-  critical_section_init(&qdef->critsec);
+  // Each queue gets its own hardware spinlock if one is available, so that it does not contend with other
+  // queues or SDK users of the shared striped spinlocks. Lock is kept when queue is created again (re-init)
+  if ( !critical_section_is_initialized(&qdef->critsec) )
+  {
+    int const lock_num = spin_lock_claim_unused(false);
+    if ( lock_num >= 0 )
+    {
+      critical_section_init_with_lock_num(&qdef->critsec, (uint) lock_num);
+    }else
+    {
+      critical_section_init(&qdef->critsec);
+    }
+  }
+
   tu_fifo_clear(&qdef->ff);
   return (osal_queue_t) qdef;
 }
@@ -138,26 +151,26 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, v
 {
   (void) msec; // not used, always behave as msec = 0
 
-  // TODO: revisit... docs say that mutexes are never used from IRQ context,
-  //  however osal_queue_recieve may be. therefore my assumption is that
-  //  the fifo mutex is not populated for queues used from an IRQ context
-  //assert(!qhdl->ff.mutex);
-
+  // Fifo mutex is not populated for queues used from an IRQ context, queue lock is used instead
+#if CFG_TUSB_OS_PICO_LOCKFREE_QUEUE
+  // Single consumer only advances read index. fifo loads write index with acquire and stores read index with
+  // release (DMB on Cortex-M0+), which orders event copy against the other core's and ISR's index updates.
+  return tu_fifo_read(&qhdl->ff, data);
+#else
   _osal_q_lock(qhdl);
   bool success = tu_fifo_read(&qhdl->ff, data);
   _osal_q_unlock(qhdl);
 
   return success;
+#endif
 }
 
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const * data, bool in_isr)
 {
-  // TODO: revisit... docs say that mutexes are never used from IRQ context,
-  //  however osal_queue_recieve may be. therefore my assumption is that
-  //  the fifo mutex is not populated for queues used from an IRQ context
-  //assert(!qhdl->ff.mutex);
   (void) in_isr;
 
+  // Senders can be USB ISR, other ISRs (nested on same core) and tasks on both cores: serialize them with
+  // queue spinlock, interrupts are masked only while the event is copied
   _osal_q_lock(qhdl);
   bool success = tu_fifo_write(&qhdl->ff, data);
   _osal_q_unlock(qhdl);
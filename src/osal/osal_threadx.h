@@ -0,0 +1,147 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+
+#ifndef _TUSB_OSAL_THREADX_H_
+#define _TUSB_OSAL_THREADX_H_
+
+// ThreadX (Azure RTOS) Headers
+#include TU_INCLUDE_PATH(CFG_TUSB_OS_INC_PATH,tx_api.h)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// TASK API
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline ULONG _osal_ms2tick(uint32_t msec) {
+  if ( msec == OSAL_TIMEOUT_WAIT_FOREVER ) return TX_WAIT_FOREVER;
+  if ( msec == 0 ) return TX_NO_WAIT;
+
+  ULONG ticks = (ULONG) (((uint64_t) msec * TX_TIMER_TICKS_PER_SECOND) / 1000);
+
+  // TX_TIMER_TICKS_PER_SECOND is less than 1000 and 1 tick > 1 ms
+  // we still need to delay at least 1 tick
+  if ( ticks == 0 ) ticks = 1;
+
+  return ticks;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_task_delay(uint32_t msec) {
+  tx_thread_sleep(_osal_ms2tick(msec));
+}
+
+//--------------------------------------------------------------------+
+// Semaphore API
+//--------------------------------------------------------------------+
+// Objects are created without name, which is only used by debugger
+typedef TX_SEMAPHORE osal_semaphore_def_t;
+typedef TX_SEMAPHORE* osal_semaphore_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_semaphore_t osal_semaphore_create(osal_semaphore_def_t* semdef) {
+  return (tx_semaphore_create(semdef, TX_NULL, 0) == TX_SUCCESS) ? semdef : NULL;
+}
+
+// tx_semaphore_put() is ISR safe
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr) {
+  (void) in_isr;
+  return tx_semaphore_put(sem_hdl) == TX_SUCCESS;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_wait(osal_semaphore_t sem_hdl, uint32_t msec) {
+  return tx_semaphore_get(sem_hdl, _osal_ms2tick(msec)) == TX_SUCCESS;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_semaphore_reset(osal_semaphore_t const sem_hdl) {
+  while ( tx_semaphore_get(sem_hdl, TX_NO_WAIT) == TX_SUCCESS ) {}
+}
+
+//--------------------------------------------------------------------+
+// MUTEX API (priority inheritance)
+//--------------------------------------------------------------------+
+typedef TX_MUTEX osal_mutex_def_t;
+typedef TX_MUTEX* osal_mutex_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_mutex_t osal_mutex_create(osal_mutex_def_t* mdef) {
+  return (tx_mutex_create(mdef, TX_NULL, TX_INHERIT) == TX_SUCCESS) ? mdef : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_lock(osal_mutex_t mutex_hdl, uint32_t msec) {
+  return tx_mutex_get(mutex_hdl, _osal_ms2tick(msec)) == TX_SUCCESS;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hdl) {
+  return tx_mutex_put(mutex_hdl) == TX_SUCCESS;
+}
+
+//--------------------------------------------------------------------+
+// QUEUE API
+//--------------------------------------------------------------------+
+
+// ThreadX messages are counted in ULONG words (1 to 16), event types are word multiple
+#define _OSAL_Q_WORDS(_type) ((sizeof(_type) + sizeof(ULONG) - 1) / sizeof(ULONG))
+
+// _int_set is not used with an RTOS
+#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type) \
+  TU_VERIFY_STATIC(sizeof(_type) % sizeof(ULONG) == 0 && _OSAL_Q_WORDS(_type) <= 16, "unsupported queue item size");\
+  static ULONG _name##_##buf[(_depth)*_OSAL_Q_WORDS(_type)];\
+  osal_queue_def_t _name = { .depth = _depth, .item_words = _OSAL_Q_WORDS(_type), .buf = _name##_##buf };
+
+typedef struct {
+  uint16_t depth;
+  uint16_t item_words;
+  ULONG*   buf;
+
+  TX_QUEUE sq;
+} osal_queue_def_t;
+
+typedef TX_QUEUE* osal_queue_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef) {
+  UINT const res = tx_queue_create(&qdef->sq, TX_NULL, qdef->item_words, qdef->buf,
+                                   (ULONG) qdef->depth * qdef->item_words * sizeof(ULONG));
+  return (res == TX_SUCCESS) ? &qdef->sq : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
+  return tx_queue_receive(qhdl, data, _osal_ms2tick(msec)) == TX_SUCCESS;
+}
+
+// Sending from ISR must not wait
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const* data, bool in_isr) {
+  return tx_queue_send(qhdl, (VOID*) (uintptr_t) data, in_isr ? TX_NO_WAIT : TX_WAIT_FOREVER) == TX_SUCCESS;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_empty(osal_queue_t qhdl) {
+  return qhdl->tx_queue_enqueued == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,6 +31,17 @@
 #include <stdatomic.h>
 #include "host/hcd.h"
 
+// FIFO load of at least this many bytes in interrupt context is done with tuh_max3421_spi_xfer_async_api()
+// if the application implements it (e.g with SPI DMA)
+#ifndef CFG_TUH_MAX3421_SPI_ASYNC_THRESHOLD
+  #define CFG_TUH_MAX3421_SPI_ASYNC_THRESHOLD 16
+#endif
+
+// Consecutive NAKs of a non-control endpoint that are retried right away, after that it backs off for 1, 2, 4 ..
+// up to NAK_BACKOFF_MAX frames so that an idle endpoint does not keep bus and SPI busy with retries
+#define NAK_RETRY_MAX     4
+#define NAK_BACKOFF_MAX   8
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
@@ -190,9 +201,30 @@ typedef struct {
   uint16_t total_len;
   uint16_t xferred_len;
   uint8_t* buf;
+
+  struct TU_ATTR_PACKED {
+    uint8_t nak_count   : 4; // consecutive NAKs since last back off
+    uint8_t nak_backoff : 4; // current back off in frames
+  };
+  uint8_t nak_wait;          // frames left before endpoint is scheduled again
 } max3421_ep_t;
 
-TU_VERIFY_STATIC(sizeof(max3421_ep_t) == 12, "size is not correct");
+TU_VERIFY_STATIC(sizeof(max3421_ep_t) == 16, "size is not correct");
+
+// Register writes and optional FIFO load of a transaction, sent under a single SPI lock.
+// Each register access still needs its own CS cycle (command byte first)
+enum {
+  BATCH_REG_MAX = 4 // peraddr, hctl, sndbc, hxfr
+};
+
+typedef struct {
+  uint8_t const* fifo_buf;
+  uint8_t fifo_reg;
+  uint8_t fifo_len;
+
+  uint8_t count;
+  uint8_t reg[BATCH_REG_MAX][2]; // command, data
+} max3421_batch_t;
 
 typedef struct {
   // cached register
@@ -206,6 +238,13 @@ typedef struct {
   atomic_flag busy; // busy transferring
   volatile uint16_t frame_count;
 
+  // async FIFO load: staged in interrupt handler, started when it returns
+  max3421_batch_t async_batch;
+  bool async_staged;
+  bool async_unsupported;   // tuh_max3421_spi_xfer_async_api() returned false
+  volatile bool spi_async;  // async SPI transfer in progress
+  volatile bool spi_locked; // locked by thread context
+
   max3421_ep_t ep[CFG_TUH_MAX3421_ENDPOINT_TOTAL]; // [0] is reserved for addr0
 
   OSAL_MUTEX_DEF(spi_mutexdef);
@@ -232,6 +271,18 @@ extern bool tuh_max3421_spi_xfer_api(uint8_t rhport, uint8_t const* tx_buf, uint
 // API to enable/disable MAX3421 INTR pin interrupt
 extern void tuh_max3421_int_api(uint8_t rhport, bool enabled);
 
+// Optional API to start transfer without waiting (e.g SPI with DMA), return false if not supported.
+// CS is handled by driver; complete_cb() must be invoked (can be in ISR) when transfer is done.
+TU_ATTR_WEAK bool tuh_max3421_spi_xfer_async_api(uint8_t rhport, uint8_t const* tx_buf, uint8_t* rx_buf,
+                                                 size_t xfer_bytes, void (*complete_cb)(uint8_t rhport)) {
+  (void) rhport;
+  (void) tx_buf;
+  (void) rx_buf;
+  (void) xfer_bytes;
+  (void) complete_cb;
+  return false;
+}
+
 // API to read MAX3421's register. Implemented by TinyUSB
 uint8_t tuh_max3421_reg_read(uint8_t rhport, uint8_t reg, bool in_isr);
 
@@ -249,33 +300,41 @@ static void max3421_spi_lock(uint8_t rhport, bool in_isr) {
   // disable interrupt and mutex lock (for pre-emptive RTOS) if not in_isr
   if (!in_isr) {
     (void) osal_mutex_lock(_hcd_data.spi_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    _hcd_data.spi_locked = true;
     tuh_max3421_int_api(rhport, false);
-  }
 
-  // assert CS
-  tuh_max3421_spi_cs_api(rhport, true);
+    // async FIFO load started by interrupt handler must finish first
+    while (_hcd_data.spi_async) {}
+  }
 }
 
 static void max3421_spi_unlock(uint8_t rhport, bool in_isr) {
-  // de-assert CS
-  tuh_max3421_spi_cs_api(rhport, false);
-
   // mutex unlock and re-enable interrupt
   if (!in_isr) {
+    _hcd_data.spi_locked = false;
     tuh_max3421_int_api(rhport, true);
     (void) osal_mutex_unlock(_hcd_data.spi_mutex);
   }
 }
 
+// Register access with lock held, HIRQ is returned with command byte since we are in full-duplex mode
+static bool spi_reg_xfer(uint8_t rhport, uint8_t const tx_buf[2], uint8_t rx_buf[2]) {
+  tuh_max3421_spi_cs_api(rhport, true);
+  bool const ret = tuh_max3421_spi_xfer_api(rhport, tx_buf, rx_buf, 2);
+  tuh_max3421_spi_cs_api(rhport, false);
+
+  _hcd_data.hirq = rx_buf[0];
+  return ret;
+}
+
 uint8_t tuh_max3421_reg_read(uint8_t rhport, uint8_t reg, bool in_isr) {
   uint8_t tx_buf[2] = {reg, 0};
   uint8_t rx_buf[2] = {0, 0};
 
   max3421_spi_lock(rhport, in_isr);
-  bool ret = tuh_max3421_spi_xfer_api(rhport, tx_buf, rx_buf, 2);
+  bool ret = spi_reg_xfer(rhport, tx_buf, rx_buf);
   max3421_spi_unlock(rhport, in_isr);
 
-  _hcd_data.hirq = rx_buf[0];
   return ret ? rx_buf[1] : 0;
 }
 
@@ -284,42 +343,119 @@ bool tuh_max3421_reg_write(uint8_t rhport, uint8_t reg, uint8_t data, bool in_is
   uint8_t rx_buf[2] = {0, 0};
 
   max3421_spi_lock(rhport, in_isr);
-  bool ret = tuh_max3421_spi_xfer_api(rhport, tx_buf, rx_buf, 2);
+  bool ret = spi_reg_xfer(rhport, tx_buf, rx_buf);
   max3421_spi_unlock(rhport, in_isr);
 
-  // HIRQ register since we are in full-duplex mode
-  _hcd_data.hirq = rx_buf[0];
-
   return ret;
 }
 
-static void fifo_write(uint8_t rhport, uint8_t reg, uint8_t const * buffer, uint16_t len, bool in_isr) {
+// Send FIFO command byte, CS is left asserted for data
+static void fifo_command(uint8_t rhport, uint8_t reg) {
   uint8_t hirq;
-  reg |= CMDBYTE_WRITE;
+  tuh_max3421_spi_cs_api(rhport, true);
+  tuh_max3421_spi_xfer_api(rhport, &reg, &hirq, 1);
+  _hcd_data.hirq = hirq;
+}
 
+static void fifo_read(uint8_t rhport, uint8_t * buffer, uint16_t len, bool in_isr) {
   max3421_spi_lock(rhport, in_isr);
 
-  tuh_max3421_spi_xfer_api(rhport, &reg, &hirq, 1);
-  _hcd_data.hirq = hirq;
-  tuh_max3421_spi_xfer_api(rhport, buffer, NULL, len);
+  fifo_command(rhport, RCVVFIFO_ADDR);
+  tuh_max3421_spi_xfer_api(rhport, NULL, buffer, len);
+  tuh_max3421_spi_cs_api(rhport, false);
 
   max3421_spi_unlock(rhport, in_isr);
+}
 
+//------------- batched transaction -------------//
+TU_ATTR_ALWAYS_INLINE static inline void batch_fifo_write(max3421_batch_t* batch, uint8_t reg, uint8_t const* buffer, uint8_t len) {
+  batch->fifo_reg = reg | CMDBYTE_WRITE;
+  batch->fifo_buf = buffer;
+  batch->fifo_len = len;
 }
 
-static void fifo_read(uint8_t rhport, uint8_t * buffer, uint16_t len, bool in_isr) {
-  uint8_t hirq;
-  uint8_t const reg = RCVVFIFO_ADDR;
+TU_ATTR_ALWAYS_INLINE static inline void batch_reg_write(max3421_batch_t* batch, uint8_t reg, uint8_t data) {
+  TU_ASSERT(batch->count < BATCH_REG_MAX,);
+  batch->reg[batch->count][0] = reg | CMDBYTE_WRITE;
+  batch->reg[batch->count][1] = data;
+  batch->count++;
+}
+
+// peraddr/hxfr/sndbc registers are cached
+static void batch_peraddr_write(max3421_batch_t* batch, uint8_t data) {
+  if (_hcd_data.peraddr == data) return; // no need to change address
+  _hcd_data.peraddr = data;
+  batch_reg_write(batch, PERADDR_ADDR, data);
+}
+
+static void batch_hxfr_write(max3421_batch_t* batch, uint8_t data) {
+  _hcd_data.hxfr = data;
+  batch_reg_write(batch, HXFR_ADDR, data);
+}
+
+static void batch_sndbc_write(max3421_batch_t* batch, uint8_t data) {
+  _hcd_data.sndbc = data;
+  batch_reg_write(batch, SNDBC_ADDR, data);
+}
+
+// register writes of batch with lock held, FIFO load is already done
+static void batch_reg_send(uint8_t rhport, max3421_batch_t const* batch) {
+  uint8_t rx_buf[2];
+  for (uint8_t i = 0; i < batch->count; i++) {
+    spi_reg_xfer(rhport, batch->reg[i], rx_buf);
+  }
+}
+
+static void batch_send(uint8_t rhport, max3421_batch_t const* batch, bool in_isr) {
+  // FIFO load is deferred to the end of interrupt handler to run asynchronously
+  if (in_isr && !_hcd_data.async_staged && !_hcd_data.async_unsupported &&
+      batch->fifo_len >= CFG_TUH_MAX3421_SPI_ASYNC_THRESHOLD) {
+    _hcd_data.async_batch = *batch;
+    _hcd_data.async_staged = true;
+    return;
+  }
 
   max3421_spi_lock(rhport, in_isr);
 
-  tuh_max3421_spi_xfer_api(rhport, &reg, &hirq, 1);
-  _hcd_data.hirq = hirq;
-  tuh_max3421_spi_xfer_api(rhport, NULL, buffer, len);
+  if (batch->fifo_len) {
+    fifo_command(rhport, batch->fifo_reg);
+    tuh_max3421_spi_xfer_api(rhport, batch->fifo_buf, NULL, batch->fifo_len);
+    tuh_max3421_spi_cs_api(rhport, false);
+  }
+  batch_reg_send(rhport, batch);
 
   max3421_spi_unlock(rhport, in_isr);
 }
 
+static void spi_async_complete(uint8_t rhport) {
+  tuh_max3421_spi_cs_api(rhport, false);
+  batch_reg_send(rhport, &_hcd_data.async_batch);
+  _hcd_data.spi_async = false;
+
+  // thread context re-enables interrupt when it unlocks
+  if (!_hcd_data.spi_locked) {
+    tuh_max3421_int_api(rhport, true);
+  }
+}
+
+// Start FIFO load staged by interrupt handler, MAX3421 interrupt is disabled until it completes
+static void spi_async_start(uint8_t rhport) {
+  if (!_hcd_data.async_staged) return;
+  _hcd_data.async_staged = false;
+
+  max3421_batch_t const* batch = &_hcd_data.async_batch;
+  tuh_max3421_int_api(rhport, false);
+  _hcd_data.spi_async = true;
+
+  fifo_command(rhport, batch->fifo_reg);
+  if (!tuh_max3421_spi_xfer_async_api(rhport, batch->fifo_buf, NULL, batch->fifo_len, spi_async_complete)) {
+    // fallback to blocking transfer
+    _hcd_data.async_unsupported = true;
+    tuh_max3421_spi_xfer_api(rhport, batch->fifo_buf, NULL, batch->fifo_len);
+    spi_async_complete(rhport);
+  }
+}
+
 //------------- register write helper -------------//
 static inline void hirq_write(uint8_t rhport, uint8_t data, bool in_isr) {
   reg_write(rhport, HIRQ_ADDR, data, in_isr);
@@ -337,23 +473,11 @@ static inline void mode_write(uint8_t rhport, uint8_t data, bool in_isr) {
   reg_write(rhport, MODE_ADDR, data, in_isr);
 }
 
-static inline void peraddr_write(uint8_t rhport, uint8_t data, bool in_isr) {
-  if ( _hcd_data.peraddr == data ) return; // no need to change address
-
-  _hcd_data.peraddr = data;
-  reg_write(rhport, PERADDR_ADDR, data, in_isr);
-}
-
 static inline void hxfr_write(uint8_t rhport, uint8_t data, bool in_isr) {
   _hcd_data.hxfr = data;
   reg_write(rhport, HXFR_ADDR, data, in_isr);
 }
 
-static inline void sndbc_write(uint8_t rhport, uint8_t data, bool in_isr) {
-  _hcd_data.sndbc = data;
-  reg_write(rhport, SNDBC_ADDR, data, in_isr);
-}
-
 //--------------------------------------------------------------------+
 // Endpoint helper
 //--------------------------------------------------------------------+
@@ -399,7 +523,7 @@ static max3421_ep_t * find_next_pending_ep(max3421_ep_t * cur_ep) {
   // starting from next endpoint
   for (size_t i = idx + 1; i < CFG_TUH_MAX3421_ENDPOINT_TOTAL; i++) {
     max3421_ep_t* ep = &_hcd_data.ep[i];
-    if (ep->xfer_pending && ep->packet_size) {
+    if (ep->xfer_pending && ep->packet_size && !ep->nak_wait) {
 //      TU_LOG3("next pending i = %u\r\n", i);
       return ep;
     }
@@ -408,7 +532,7 @@ static max3421_ep_t * find_next_pending_ep(max3421_ep_t * cur_ep) {
   // wrap around including current endpoint
   for (size_t i = 0; i <= idx; i++) {
     max3421_ep_t* ep = &_hcd_data.ep[i];
-    if (ep->xfer_pending && ep->packet_size) {
+    if (ep->xfer_pending && ep->packet_size && !ep->nak_wait) {
 //      TU_LOG3("next pending i = %u\r\n", i);
       return ep;
     }
@@ -567,52 +691,64 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const * e
 void xact_out(uint8_t rhport, max3421_ep_t *ep, bool switch_ep, bool in_isr) {
   // Page 12: Programming BULK-OUT Transfers
   // TODO double buffered
+  max3421_batch_t batch = { 0 };
+
   if (switch_ep) {
-    peraddr_write(rhport, ep->daddr, in_isr);
+    batch_peraddr_write(&batch, ep->daddr);
 
     uint8_t const hctl = (ep->data_toggle ? HCTL_SNDTOG1 : HCTL_SNDTOG0);
-    reg_write(rhport, HCTL_ADDR, hctl, in_isr);
+    batch_reg_write(&batch, HCTL_ADDR, hctl);
   }
 
   uint8_t const xact_len = (uint8_t) tu_min16(ep->total_len - ep->xferred_len, ep->packet_size);
   TU_ASSERT(_hcd_data.hirq & HIRQ_SNDBAV_IRQ,);
   if (xact_len) {
-    fifo_write(rhport, SNDFIFO_ADDR, ep->buf, xact_len, in_isr);
+    batch_fifo_write(&batch, SNDFIFO_ADDR, ep->buf, xact_len);
   }
-  sndbc_write(rhport, xact_len, in_isr);
+  batch_sndbc_write(&batch, xact_len);
 
   uint8_t const hxfr = (uint8_t ) (ep->ep_num | HXFR_OUT_NIN | (ep->is_iso ? HXFR_ISO : 0));
-  hxfr_write(rhport, hxfr, in_isr);
+  batch_hxfr_write(&batch, hxfr);
+
+  batch_send(rhport, &batch, in_isr);
 }
 
 void xact_in(uint8_t rhport, max3421_ep_t *ep, bool switch_ep, bool in_isr) {
   // Page 13: Programming BULK-IN Transfers
+  max3421_batch_t batch = { 0 };
+
   if (switch_ep) {
-    peraddr_write(rhport, ep->daddr, in_isr);
+    batch_peraddr_write(&batch, ep->daddr);
 
     uint8_t const hctl = (ep->data_toggle ? HCTL_RCVTOG1 : HCTL_RCVTOG0);
-    reg_write(rhport, HCTL_ADDR, hctl, in_isr);
+    batch_reg_write(&batch, HCTL_ADDR, hctl);
   }
 
   uint8_t const hxfr = (uint8_t) (ep->ep_num | (ep->is_iso ? HXFR_ISO : 0));
-  hxfr_write(rhport, hxfr, in_isr);
+  batch_hxfr_write(&batch, hxfr);
+
+  batch_send(rhport, &batch, in_isr);
 }
 
 TU_ATTR_ALWAYS_INLINE static inline void xact_inout(uint8_t rhport, max3421_ep_t *ep, bool switch_ep, bool in_isr) {
   if (ep->ep_num == 0 ) {
+    max3421_batch_t batch = { 0 };
+
     // setup
     if (ep->is_setup) {
-      peraddr_write(rhport, ep->daddr, in_isr);
-      fifo_write(rhport, SUDFIFO_ADDR, ep->buf, 8, in_isr);
-      hxfr_write(rhport, HXFR_SETUP, in_isr);
+      batch_peraddr_write(&batch, ep->daddr);
+      batch_fifo_write(&batch, SUDFIFO_ADDR, ep->buf, 8);
+      batch_hxfr_write(&batch, HXFR_SETUP);
+      batch_send(rhport, &batch, in_isr);
       return;
     }
 
     // status
     if (ep->buf == NULL || ep->total_len == 0) {
       uint8_t const hxfr = HXFR_HS | (ep->ep_dir ? 0 : HXFR_OUT_NIN);
-      peraddr_write(rhport, ep->daddr, in_isr);
-      hxfr_write(rhport, hxfr, in_isr);
+      batch_peraddr_write(&batch, ep->daddr);
+      batch_hxfr_write(&batch, hxfr);
+      batch_send(rhport, &batch, in_isr);
       return;
     }
   }
@@ -758,6 +894,8 @@ static void xfer_complete_isr(uint8_t rhport, max3421_ep_t *ep, xfer_result_t re
   }
 
   ep->xfer_pending = 0;
+  ep->nak_count = 0;
+  ep->nak_backoff = 0;
   hcd_event_xfer_complete(ep->daddr, ep_addr, ep->xferred_len, result, in_isr);
 
   // Find next pending endpoint
@@ -796,7 +934,13 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
         // NAK on control, retry immediately
         hxfr_write(rhport, _hcd_data.hxfr, in_isr);
       }else {
-        // NAK on non-control, find next pending to switch
+        // NAK on non-control: back off if it keeps NAKing, then find next pending to switch
+        if (++ep->nak_count >= NAK_RETRY_MAX) {
+          ep->nak_count = 0;
+          ep->nak_backoff = ep->nak_backoff ? tu_min8(2 * ep->nak_backoff, NAK_BACKOFF_MAX) : 1;
+          ep->nak_wait = ep->nak_backoff;
+        }
+
         max3421_ep_t *next_ep = find_next_pending_ep(ep);
 
         if (ep == next_ep) {
@@ -806,7 +950,8 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
           // switch to next pending TODO could have issue with double buffered if not clear previously out data
           xact_inout(rhport, next_ep, true, in_isr);
         }else {
-          TU_ASSERT(false,);
+          // all pending endpoints are backing off, resumed by frame interrupt
+          atomic_flag_clear(&_hcd_data.busy);
         }
       }
       return;
@@ -882,14 +1027,36 @@ void print_hirq(uint8_t hirq) {
   #define print_hirq(hirq)
 #endif
 
+// Count down back off of NAKed endpoints, restart scheduling if bus went idle while all were backing off
+static void nak_wait_tick(uint8_t rhport, bool in_isr) {
+  bool ready = false;
+  for (size_t i = 0; i < CFG_TUH_MAX3421_ENDPOINT_TOTAL; i++) {
+    max3421_ep_t* ep = &_hcd_data.ep[i];
+    if (ep->nak_wait && !--ep->nak_wait && ep->xfer_pending) ready = true;
+  }
+
+  if (ready && !atomic_flag_test_and_set(&_hcd_data.busy)) {
+    max3421_ep_t* next_ep = find_next_pending_ep(&_hcd_data.ep[CFG_TUH_MAX3421_ENDPOINT_TOTAL - 1]);
+    if (next_ep) {
+      xact_inout(rhport, next_ep, true, in_isr);
+    } else {
+      atomic_flag_clear(&_hcd_data.busy);
+    }
+  }
+}
+
 // Interrupt handler
-void hcd_int_handler(uint8_t rhport, bool in_isr) {
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  // SPI is busy with async FIFO load, interrupt is processed once it completes
+  if (_hcd_data.spi_async) return;
+
   uint8_t hirq = reg_read(rhport, HIRQ_ADDR, in_isr) & _hcd_data.hien;
   if (!hirq) return;
 //  print_hirq(hirq);
 
   if (hirq & HIRQ_FRAME_IRQ) {
     _hcd_data.frame_count++;
+    nak_wait_tick(rhport, in_isr);
   }
 
   if (hirq & HIRQ_CONDET_IRQ) {
@@ -937,6 +1104,9 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   if ( hirq ) {
     hirq_write(rhport, hirq, in_isr);
   }
+
+  // FIFO load queued while handling transfer
+  spi_async_start(rhport);
 }
 
 #endif
@@ -950,7 +950,7 @@ void _ft9xx_usbd_ISR(void)
   dcd_int_handler(BOARD_TUD_RHPORT);
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void)rhport;
 
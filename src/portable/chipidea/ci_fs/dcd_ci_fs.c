@@ -192,6 +192,15 @@ static void process_tokdne(uint8_t rhport)
     }
     return;
   }
+
+  /* A short packet ends the transfer early: take back the BD pre-armed for the
+   * following packet so that the next transfer starts from it with its toggle intact. */
+  buffer_descriptor_t *other = odd ? bd - 1 : bd + 1;
+  if (remaining && other->own) {
+    other->own = 0;
+    __DSB();
+  }
+
   const unsigned length = ep->length;
   dcd_event_xfer_complete(rhport,
                           tu_edpt_addr(epnum, dir),
@@ -506,7 +515,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 //--------------------------------------------------------------------+
 // ISR
 //--------------------------------------------------------------------+
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint32_t is  = CI_REG->INT_STAT;
   uint32_t msk = CI_REG->INT_EN;
@@ -560,7 +569,10 @@ void dcd_int_handler(uint8_t rhport)
   }
 
   if (is & USB_ISTAT_TOKDNE_MASK) {
-    process_tokdne(rhport);
+    /* STAT is a 4-entry FIFO: drain all queued tokens within a single interrupt */
+    do {
+      process_tokdne(rhport);
+    } while (CI_REG->INT_STAT & USB_ISTAT_TOKDNE_MASK);
   }
 }
 
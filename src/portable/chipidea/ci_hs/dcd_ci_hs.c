@@ -58,23 +58,22 @@
   #error "Unsupported MCUs"
 #endif
 
-  TU_ATTR_WEAK void dcd_dcache_clean(void const* addr, uint32_t data_size) {
-    (void) addr; (void) data_size;
-  }
-
-  TU_ATTR_WEAK void dcd_dcache_invalidate(void const* addr, uint32_t data_size) {
-    (void) addr; (void) data_size;
-  }
-
-  TU_ATTR_WEAK void dcd_dcache_clean_invalidate(void const* addr, uint32_t data_size) {
-    (void) addr; (void) data_size;
-  }
+// non-cacheable MCU use weak dcd_dcache_*() of usbd
 #endif
 
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
+// Number of dTDs shared by all endpoints. A transfer larger than a dTD (16 KB, up to 20 KB if 4K aligned) is
+// split into linked dTDs, transfers queued on a busy endpoint are appended to its dTD list.
+#ifndef CFG_TUD_CI_HS_QTD_COUNT
+  #define CFG_TUD_CI_HS_QTD_COUNT  (4*TUP_DCD_ENDPOINT_MAX)
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_CI_HS_QTD_COUNT >= 2*TUP_DCD_ENDPOINT_MAX && CFG_TUD_CI_HS_QTD_COUNT < 255,
+                 "dTD count is not correct");
+
 // ENDPTCTRL
 enum {
   ENDPTCTRL_STALL          = TU_BIT(0),
@@ -126,7 +125,8 @@ typedef struct
   // Therefore there are 4 bytes padding that we can use.
   //--------------------------------------------------------------------+
   uint16_t expected_bytes;
-  uint8_t reserved[2];
+  uint8_t sw_next; ///< next dTD (index + 1) of endpoint list, including dTDs not linked to hardware yet
+  uint8_t flags;
 } dcd_qtd_t;
 
 TU_VERIFY_STATIC( sizeof(dcd_qtd_t) == 32, "size is not correct");
@@ -156,7 +156,11 @@ typedef struct
   // Therefore there are 16 bytes padding that we can use.
   //--------------------------------------------------------------------+
   tu_fifo_t * ff;
-  uint8_t reserved[12];
+  uint16_t xfer_len;   ///< bytes transferred by retired dTDs of the oldest transfer
+  uint8_t qtd_head;    ///< oldest dTD (index + 1), 0 if none
+  uint8_t qtd_tail;    ///< newest dTD
+  uint8_t qtd_hw_tail; ///< last dTD linked to hardware list
+  uint8_t reserved[7];
 } dcd_qhd_t;
 
 TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
@@ -167,16 +171,30 @@ TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
 
 #define QTD_NEXT_INVALID 0x01
 
+enum {
+  QTD_FLAG_USED     = TU_BIT(0),
+  QTD_FLAG_XFER_END = TU_BIT(1), // last dTD of a transfer
+  QTD_FLAG_FIFO     = TU_BIT(2), // transfer with dcd_edpt_xfer_fifo()
+};
+
+// With multiple ports, each port's queue head list must start at 2K alignment within the data array
+#if CFG_TUD_RHPORT_NUM > 1
+  #define QHD_LIST_ALIGN  2048
+#else
+  #define QHD_LIST_ALIGN  64
+#endif
+
 typedef struct {
   // Must be at 2K alignment
   // Each endpoint with direction (IN/OUT) occupies a queue head
-  // for portability, TinyUSB only queue 1 TD for each Qhd
-  dcd_qhd_t qhd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(64);
-  dcd_qtd_t qtd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(32);
+  dcd_qhd_t qhd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(QHD_LIST_ALIGN);
+
+  // dTD pool, each endpoint has a list of dTDs of its queued transfers
+  dcd_qtd_t qtd[CFG_TUD_CI_HS_QTD_COUNT] TU_ATTR_ALIGNED(32);
 }dcd_data_t;
 
 CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(2048)
-static dcd_data_t _dcd_data;
+static dcd_data_t _dcd_data[CFG_TUD_RHPORT_NUM];
 
 //--------------------------------------------------------------------+
 // Prototypes and Helper Functions
@@ -188,6 +206,26 @@ static inline uint8_t ci_ep_count(ci_hs_regs_t const* dcd_reg)
   return dcd_reg->DCCPARAMS & DCCPARAMS_DEN_MASK;
 }
 
+TU_ATTR_ALWAYS_INLINE static inline dcd_data_t* get_dcd_data(uint8_t rhport)
+{
+#if CFG_TUD_RHPORT_NUM > 1
+  return &_dcd_data[rhport];
+#else
+  (void) rhport;
+  return &_dcd_data[0];
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline dcd_qtd_t* qtd_get(dcd_data_t* dcd, uint8_t idx)
+{
+  return idx ? &dcd->qtd[idx-1] : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t qtd_index(dcd_data_t const* dcd, dcd_qtd_t const* p_qtd)
+{
+  return (uint8_t) (p_qtd - dcd->qtd + 1);
+}
+
 //--------------------------------------------------------------------+
 // Controller API
 //--------------------------------------------------------------------+
@@ -196,6 +234,7 @@ static inline uint8_t ci_ep_count(ci_hs_regs_t const* dcd_reg)
 static void bus_reset(uint8_t rhport)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  dcd_data_t* dcd = get_dcd_data(rhport);
 
   // The reset value for all endpoint types is the control endpoint. If one endpoint
   // direction is enabled and the paired endpoint of opposite direction is disabled, then the
@@ -222,21 +261,22 @@ static void bus_reset(uint8_t rhport)
   // read reset bit in portsc
 
   //------------- Queue Head & Queue TD -------------//
-  tu_memclr(&_dcd_data, sizeof(dcd_data_t));
+  tu_memclr(dcd, sizeof(dcd_data_t));
 
   //------------- Set up Control Endpoints (0 OUT, 1 IN) -------------//
-  _dcd_data.qhd[0][0].zero_length_termination = _dcd_data.qhd[0][1].zero_length_termination = 1;
-  _dcd_data.qhd[0][0].max_packet_size  = _dcd_data.qhd[0][1].max_packet_size  = CFG_TUD_ENDPOINT0_SIZE;
-  _dcd_data.qhd[0][0].qtd_overlay.next = _dcd_data.qhd[0][1].qtd_overlay.next = QTD_NEXT_INVALID;
+  dcd->qhd[0][0].zero_length_termination = dcd->qhd[0][1].zero_length_termination = 1;
+  dcd->qhd[0][0].max_packet_size  = dcd->qhd[0][1].max_packet_size  = CFG_TUD_ENDPOINT0_SIZE;
+  dcd->qhd[0][0].qtd_overlay.next = dcd->qhd[0][1].qtd_overlay.next = QTD_NEXT_INVALID;
 
-  _dcd_data.qhd[0][0].int_on_setup = 1; // OUT only
+  dcd->qhd[0][0].int_on_setup = 1; // OUT only
 
-  dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
+  dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
 }
 
 void dcd_init(uint8_t rhport)
 {
-  tu_memclr(&_dcd_data, sizeof(dcd_data_t));
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  tu_memclr(dcd, sizeof(dcd_data_t));
 
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
 
@@ -257,9 +297,9 @@ void dcd_init(uint8_t rhport)
   dcd_reg->PORTSC1 = PORTSC1_FORCE_FULL_SPEED;
 #endif
 
-  dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
+  dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
 
-  dcd_reg->ENDPTLISTADDR = (uint32_t) _dcd_data.qhd; // Endpoint List Address has to be 2K alignment
+  dcd_reg->ENDPTLISTADDR = (uint32_t) dcd->qhd; // Endpoint List Address has to be 2K alignment
   dcd_reg->USBSTS  = dcd_reg->USBSTS;
   dcd_reg->USBINTR = INTR_USB | INTR_ERROR | INTR_PORT_CHANGE | INTR_SUSPEND;
 
@@ -349,6 +389,104 @@ static void qtd_init(dcd_qtd_t* p_qtd, void * data_ptr, uint16_t total_bytes)
   }
 }
 
+static dcd_qtd_t* qtd_alloc(dcd_data_t* dcd)
+{
+  for(uint8_t i=0; i<CFG_TUD_CI_HS_QTD_COUNT; i++)
+  {
+    dcd_qtd_t* p_qtd = &dcd->qtd[i];
+    if ( !(p_qtd->flags & QTD_FLAG_USED) )
+    {
+      p_qtd->flags = QTD_FLAG_USED;
+      return p_qtd;
+    }
+  }
+  return NULL;
+}
+
+// Free dTDs starting from idx following sw_next, until (including) last_idx or end of list
+static void qtd_free_list(dcd_data_t* dcd, uint8_t idx, uint8_t last_idx)
+{
+  while (idx)
+  {
+    dcd_qtd_t* p_qtd = qtd_get(dcd, idx);
+    uint8_t const next = p_qtd->sw_next;
+
+    p_qtd->flags   = 0;
+    p_qtd->sw_next = 0;
+
+    if (idx == last_idx) break;
+    idx = next;
+  }
+}
+
+typedef struct
+{
+  uint8_t first;
+  uint8_t last;
+} qtd_chain_t;
+
+// Split buffer into dTDs added to chain. dTD boundaries within a transfer are multiple of packet size so that
+// no short packet is sent/expected in the middle of it.
+static bool qtd_chain_add(dcd_data_t* dcd, qtd_chain_t* chain, uint8_t* buffer, uint16_t total_bytes, uint16_t packet_size, uint8_t flags)
+{
+  do
+  {
+    uint32_t const capacity = 5*4096 - tu_offset4k((uint32_t) buffer);
+    uint16_t len = total_bytes;
+    if (len > capacity)
+    {
+      len = (uint16_t) (capacity - capacity % packet_size);
+    }
+
+    dcd_qtd_t* p_qtd = qtd_alloc(dcd);
+    if (p_qtd == NULL)
+    {
+      qtd_free_list(dcd, chain->first, chain->last);
+      chain->first = chain->last = 0;
+      return false;
+    }
+
+    qtd_init(p_qtd, buffer, len);
+    p_qtd->flags = QTD_FLAG_USED | flags;
+
+    uint8_t const idx = qtd_index(dcd, p_qtd);
+    if (chain->last)
+    {
+      qtd_get(dcd, chain->last)->sw_next = idx;
+    }else
+    {
+      chain->first = idx;
+    }
+    chain->last = idx;
+
+    if (buffer) buffer += len;
+    total_bytes = (uint16_t) (total_bytes - len);
+  } while (total_bytes);
+
+  return true;
+}
+
+// OUT endpoint stops after a dTD that does not end its transfer, since a short packet would otherwise make the
+// controller continue with the remaining dTDs. Remaining dTDs are linked once it completes without short packet.
+TU_ATTR_ALWAYS_INLINE static inline bool qtd_is_hw_stop(dcd_qtd_t const* p_qtd, uint8_t dir)
+{
+  return (dir == TUSB_DIR_OUT) && !(p_qtd->flags & QTD_FLAG_XFER_END);
+}
+
+// Drop all dTDs of endpoint, hardware must not be using them (flushed)
+static void qhd_reset_list(dcd_data_t* dcd, dcd_qhd_t* p_qhd)
+{
+  uint32_t const primask = __get_PRIMASK();
+  __disable_irq();
+
+  qtd_free_list(dcd, p_qhd->qtd_head, 0);
+  p_qhd->qtd_head    = p_qhd->qtd_tail = p_qhd->qtd_hw_tail = 0;
+  p_qhd->xfer_len    = 0;
+  p_qhd->ff          = NULL;
+
+  __set_PRIMASK(primask);
+}
+
 //--------------------------------------------------------------------+
 // DCD Endpoint Port
 //--------------------------------------------------------------------+
@@ -361,7 +499,12 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   dcd_reg->ENDPTCTRL[epnum] |= ENDPTCTRL_STALL << (dir ? 16 : 0);
 
   // flush to abort any primed buffer
-  dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
+  uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
+  dcd_reg->ENDPTFLUSH = flush_mask;
+  while(dcd_reg->ENDPTFLUSH & flush_mask) {}
+
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  qhd_reset_list(dcd, &dcd->qhd[epnum][dir]);
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
@@ -386,19 +529,22 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
   TU_ASSERT(epnum < ci_ep_count(dcd_reg));
 
   //------------- Prepare Queue Head -------------//
-  dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t * p_qhd = &dcd->qhd[epnum][dir];
+  qhd_reset_list(dcd, p_qhd);
   tu_memclr(p_qhd, sizeof(dcd_qhd_t));
 
   p_qhd->zero_length_termination = 1;
   p_qhd->max_packet_size         = tu_edpt_packet_size(p_endpoint_desc);
   if (p_endpoint_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS)
   {
-    p_qhd->iso_mult = 1;
+    // high-bandwidth endpoint has additional transactions per micro-frame
+    p_qhd->iso_mult = tu_edpt_hb_mult(p_endpoint_desc);
   }
 
   p_qhd->qtd_overlay.next        = QTD_NEXT_INVALID;
 
-  dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
+  dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
 
   // Enable EP Control
   uint32_t const epctrl = (p_endpoint_desc->bmAttributes.xfer << ENDPTCTRL_TYPE_POS) | ENDPTCTRL_ENABLE | ENDPTCTRL_TOGGLE_RESET;
@@ -417,16 +563,21 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
 void dcd_edpt_close_all (uint8_t rhport)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  dcd_data_t* dcd = get_dcd_data(rhport);
 
   // Disable all non-control endpoints
   uint8_t const ep_count = ci_ep_count(dcd_reg);
   for (uint8_t epnum = 1; epnum < ep_count; epnum++)
   {
-    _dcd_data.qhd[epnum][TUSB_DIR_OUT].qtd_overlay.halted = 1;
-    _dcd_data.qhd[epnum][TUSB_DIR_IN ].qtd_overlay.halted = 1;
+    dcd->qhd[epnum][TUSB_DIR_OUT].qtd_overlay.halted = 1;
+    dcd->qhd[epnum][TUSB_DIR_IN ].qtd_overlay.halted = 1;
 
     dcd_reg->ENDPTFLUSH = TU_BIT(epnum) |  TU_BIT(epnum+16);
+    while(dcd_reg->ENDPTFLUSH) {}
     dcd_reg->ENDPTCTRL[epnum] = (TUSB_XFER_BULK << ENDPTCTRL_TYPE_POS) | (TUSB_XFER_BULK << (16+ENDPTCTRL_TYPE_POS));
+
+    qhd_reset_list(dcd, &dcd->qhd[epnum][TUSB_DIR_OUT]);
+    qhd_reset_list(dcd, &dcd->qhd[epnum][TUSB_DIR_IN]);
   }
 }
 
@@ -436,29 +587,32 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   uint8_t const dir    = tu_edpt_dir(ep_addr);
 
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  dcd_data_t* dcd = get_dcd_data(rhport);
 
-  _dcd_data.qhd[epnum][dir].qtd_overlay.halted = 1;
+  dcd->qhd[epnum][dir].qtd_overlay.halted = 1;
 
   // Flush EP
   uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
   dcd_reg->ENDPTFLUSH = flush_mask;
   while(dcd_reg->ENDPTFLUSH & flush_mask);
 
+  qhd_reset_list(dcd, &dcd->qhd[epnum][dir]);
+
   // Clear EP enable
   dcd_reg->ENDPTCTRL[epnum] &=~(ENDPTCTRL_ENABLE << (dir ? 16 : 0));
 }
 
-static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
+static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir, dcd_qtd_t* p_qtd)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
-  dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t* p_qhd = &dcd->qhd[epnum][dir];
 
   p_qhd->qtd_overlay.halted = false;            // clear any previous error
   p_qhd->qtd_overlay.next   = (uint32_t) p_qtd; // link qtd to qhd
 
   // flush cache
-  dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
+  dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
 
   if ( epnum == 0 )
   {
@@ -471,32 +625,127 @@ static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
   dcd_reg->ENDPTPRIME = TU_BIT(epnum + (dir ? 16 : 0));
 }
 
+// Link dTDs of endpoint list that are not in hardware list yet, must be called with interrupt disabled
+static void qhd_link(uint8_t rhport, uint8_t epnum, uint8_t dir)
+{
+  ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t* p_qhd = &dcd->qhd[epnum][dir];
+  dcd_qtd_t* hw_tail = qtd_get(dcd, p_qhd->qtd_hw_tail);
+
+  if (hw_tail && qtd_is_hw_stop(hw_tail, dir)) return;
+
+  dcd_qtd_t* first = qtd_get(dcd, hw_tail ? hw_tail->sw_next : p_qhd->qtd_head);
+  if (first == NULL) return;
+
+  // link up to and including the first stop dTD
+  dcd_qtd_t* last = first;
+  while (!qtd_is_hw_stop(last, dir) && last->sw_next)
+  {
+    dcd_qtd_t* next = qtd_get(dcd, last->sw_next);
+    last->next = (uint32_t) next;
+    last = next;
+  }
+  last->next = QTD_NEXT_INVALID;
+  p_qhd->qtd_hw_tail = qtd_index(dcd, last);
+
+  if (hw_tail)
+  {
+    hw_tail->next = (uint32_t) first;
+    dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
+
+    // Adding dTD to a non-empty list: use ATDTW tripwire to find out if endpoint was still active after the link.
+    uint32_t const ep_mask = TU_BIT(epnum + (dir ? 16 : 0));
+    if (dcd_reg->ENDPTPRIME & ep_mask) return;
+
+    uint32_t ep_status;
+    do
+    {
+      dcd_reg->USBCMD |= USBCMD_ADD_QTD_TRIPWIRE;
+      ep_status = dcd_reg->ENDPTSTAT & ep_mask;
+    } while ( !(dcd_reg->USBCMD & USBCMD_ADD_QTD_TRIPWIRE) );
+    dcd_reg->USBCMD &= ~USBCMD_ADD_QTD_TRIPWIRE;
+
+    // controller will pick up new dTD
+    if (ep_status) return;
+  }
+
+  qhd_start_xfer(rhport, epnum, dir, first);
+}
+
+// Append chain of a new transfer to endpoint list and link it to hardware
+static void qhd_append(uint8_t rhport, uint8_t epnum, uint8_t dir, qtd_chain_t const* chain)
+{
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t* p_qhd = &dcd->qhd[epnum][dir];
+
+  dcd_qtd_t* last = qtd_get(dcd, chain->last);
+  last->flags |= QTD_FLAG_XFER_END;
+
+  // IN only needs interrupt at the end of transfer. OUT dTDs are either end of transfer or a stop dTD
+  if (dir == TUSB_DIR_IN)
+  {
+    for(uint8_t idx = chain->first; idx != chain->last; idx = qtd_get(dcd, idx)->sw_next)
+    {
+      qtd_get(dcd, idx)->int_on_complete = 0;
+    }
+
+    // High-bandwidth ISO IN: send only as many packets as the dTD has data, so that the DATA PID sequence
+    // of a shorter (rate adapted) micro-frame still matches its packet count
+    if (p_qhd->iso_mult > 1)
+    {
+      for(uint8_t idx = chain->first; idx; idx = (idx == chain->last) ? 0 : qtd_get(dcd, idx)->sw_next)
+      {
+        dcd_qtd_t* p_qtd = qtd_get(dcd, idx);
+        uint16_t const n_packets = (uint16_t) tu_div_ceil(p_qtd->total_bytes, p_qhd->max_packet_size);
+        p_qtd->iso_mult_override = tu_max16(1, tu_min16(n_packets, 3));
+      }
+    }
+  }
+
+  uint32_t const primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (p_qhd->qtd_tail)
+  {
+    qtd_get(dcd, p_qhd->qtd_tail)->sw_next = chain->first;
+  }else
+  {
+    p_qhd->qtd_head = chain->first;
+  }
+  p_qhd->qtd_tail = chain->last;
+
+  qhd_link(rhport, epnum, dir);
+
+  __set_PRIMASK(primask);
+}
+
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
-  dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t* p_qhd = &dcd->qhd[epnum][dir];
 
   // Prepare qtd
-  qtd_init(p_qtd, buffer, total_bytes);
+  qtd_chain_t chain = { 0 };
+  TU_ASSERT( qtd_chain_add(dcd, &chain, buffer, total_bytes, p_qhd->max_packet_size, 0) );
 
   // Start qhd transfer
-  p_qhd->ff = NULL;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_append(rhport, epnum, dir, &chain);
 
   return true;
 }
 
-// fifo has to be aligned to 4k boundary
 bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
-  dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t * p_qhd = &dcd->qhd[epnum][dir];
+  uint16_t const packet_size = p_qhd->max_packet_size;
 
   tu_fifo_buffer_info_t fifo_info;
 
@@ -508,46 +757,37 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
     tu_fifo_get_write_info(ff, &fifo_info);
   }
 
+  qtd_chain_t chain = { 0 };
+
   if ( fifo_info.len_lin >= total_bytes )
   {
     // Linear length is enough for this transfer
-    qtd_init(p_qtd, fifo_info.ptr_lin, total_bytes);
+    TU_ASSERT( qtd_chain_add(dcd, &chain, fifo_info.ptr_lin, total_bytes, packet_size, QTD_FLAG_FIFO) );
   }
-  else
+  else if ( fifo_info.len_lin && !(fifo_info.len_lin % packet_size) )
   {
-    // linear part is not enough
-
-    // prepare TD up to linear length
-    qtd_init(p_qtd, fifo_info.ptr_lin, fifo_info.len_lin);
-
-    if ( !tu_offset4k((uint32_t) fifo_info.ptr_wrap) && !tu_offset4k(tu_fifo_depth(ff)) )
-    {
-      // If buffer is aligned to 4K & buffer size is multiple of 4K
-      // We can make use of buffer page array to also combine the linear + wrapped length
-      p_qtd->total_bytes = p_qtd->expected_bytes = total_bytes;
+    // Wrapped part continues in its own dTD
+    TU_ASSERT( qtd_chain_add(dcd, &chain, fifo_info.ptr_lin, fifo_info.len_lin, packet_size, QTD_FLAG_FIFO) );
 
-      for(uint8_t i = 1, page = 0; i < 5; i++)
-      {
-        // pick up buffer array where linear ends
-        if (p_qtd->buffer[i] == 0)
-        {
-          p_qtd->buffer[i] = (uint32_t) fifo_info.ptr_wrap + 4096 * page;
-          page++;
-        }
-      }
-
-      dcd_dcache_clean_invalidate((uint32_t*) tu_align((uint32_t) fifo_info.ptr_wrap, 4), total_bytes - fifo_info.len_wrap + 31);
-    }
-    else
+    qtd_chain_t wrap = { 0 };
+    if ( !qtd_chain_add(dcd, &wrap, fifo_info.ptr_wrap, (uint16_t) (total_bytes - fifo_info.len_lin), packet_size, QTD_FLAG_FIFO) )
     {
-      // TODO we may need to carry the wrapped length after the linear part complete
-      // for now only transfer up to linear part
+      qtd_free_list(dcd, chain.first, chain.last);
+      TU_ASSERT(false);
     }
+
+    qtd_get(dcd, chain.last)->sw_next = wrap.first;
+    chain.last = wrap.last;
+  }
+  else
+  {
+    // linear part does not end on packet boundary, only transfer up to linear part
+    TU_ASSERT( qtd_chain_add(dcd, &chain, fifo_info.ptr_lin, fifo_info.len_lin, packet_size, QTD_FLAG_FIFO) );
   }
 
   // Start qhd transfer
   p_qhd->ff = ff;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_append(rhport, epnum, dir, &chain);
 
   return true;
 }
@@ -558,37 +798,77 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 
 static void process_edpt_complete_isr(uint8_t rhport, uint8_t epnum, uint8_t dir)
 {
-  dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
-
-  uint8_t result = p_qtd->halted ? XFER_RESULT_STALLED :
-      ( p_qtd->xact_err || p_qtd->buffer_err ) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
+  ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  dcd_data_t* dcd = get_dcd_data(rhport);
+  dcd_qhd_t * p_qhd = &dcd->qhd[epnum][dir];
 
-  if ( result != XFER_RESULT_SUCCESS )
+  // retire dTDs in order, a transfer completes with its last dTD or early with short packet/error
+  while ( p_qhd->qtd_head )
   {
-    ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
-    // flush to abort error buffer
-    dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
-  }
+    uint8_t const idx = p_qhd->qtd_head;
+    dcd_qtd_t * p_qtd = qtd_get(dcd, idx);
+    if ( p_qtd->active ) break;
 
-  uint16_t const xferred_bytes = p_qtd->expected_bytes - p_qtd->total_bytes;
+    uint8_t result = p_qtd->halted ? XFER_RESULT_STALLED :
+        ( p_qtd->xact_err || p_qtd->buffer_err ) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
 
-  if (p_qhd->ff)
-  {
-    if (dir == TUSB_DIR_IN)
+    p_qhd->xfer_len = (uint16_t) (p_qhd->xfer_len + p_qtd->expected_bytes - p_qtd->total_bytes);
+
+    uint8_t const flags = p_qtd->flags;
+    bool const xfer_end = (flags & QTD_FLAG_XFER_END) || (result != XFER_RESULT_SUCCESS) || (p_qtd->total_bytes != 0);
+
+    p_qhd->qtd_head = p_qtd->sw_next;
+    if ( p_qhd->qtd_hw_tail == idx ) p_qhd->qtd_hw_tail = 0;
+    qtd_free_list(dcd, idx, idx);
+
+    if ( !xfer_end ) continue;
+
+    if ( !(flags & QTD_FLAG_XFER_END) )
     {
-      tu_fifo_advance_read_pointer(p_qhd->ff, xferred_bytes);
-    } else
+      // ended early, drop remaining dTDs of this transfer
+      uint8_t end_idx = p_qhd->qtd_head;
+      while ( !(qtd_get(dcd, end_idx)->flags & QTD_FLAG_XFER_END) ) end_idx = qtd_get(dcd, end_idx)->sw_next;
+
+      uint8_t const next_idx = qtd_get(dcd, end_idx)->sw_next;
+      qtd_free_list(dcd, p_qhd->qtd_head, end_idx);
+      p_qhd->qtd_head = next_idx;
+    }
+
+    if ( result != XFER_RESULT_SUCCESS )
+    {
+      // flush to abort error buffer, following transfers are linked again below
+      dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
+      while ( dcd_reg->ENDPTFLUSH ) {}
+      p_qhd->qtd_hw_tail = 0;
+    }
+
+    if ( p_qhd->qtd_head == 0 ) p_qhd->qtd_tail = 0;
+
+    uint16_t const xferred_bytes = p_qhd->xfer_len;
+    p_qhd->xfer_len = 0;
+
+    if ( (flags & QTD_FLAG_FIFO) && p_qhd->ff )
     {
-      tu_fifo_advance_write_pointer(p_qhd->ff, xferred_bytes);
+      if (dir == TUSB_DIR_IN)
+      {
+        tu_fifo_advance_read_pointer(p_qhd->ff, xferred_bytes);
+      } else
+      {
+        tu_fifo_advance_write_pointer(p_qhd->ff, xferred_bytes);
+      }
     }
+
+    // only number of bytes in the IOC qtd
+    dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, (xfer_result_t) result, true);
   }
 
-  // only number of bytes in the IOC qtd
-  dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, result, true);
+  if ( p_qhd->qtd_head == 0 ) p_qhd->qtd_tail = 0;
+
+  // next dTD of a multi-dTD OUT transfer or transfers after an early ended one
+  qhd_link(rhport, epnum, dir);
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
 
@@ -649,7 +929,8 @@ void dcd_int_handler(uint8_t rhport)
   if (int_status & INTR_USB)
   {
     // Make sure we read the latest version of _dcd_data.
-    dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
+    dcd_data_t* dcd = get_dcd_data(rhport);
+    dcd_dcache_clean_invalidate(dcd, sizeof(dcd_data_t));
 
     uint32_t const edpt_complete = dcd_reg->ENDPTCOMPLETE;
     dcd_reg->ENDPTCOMPLETE = edpt_complete; // acknowledge
@@ -673,7 +954,14 @@ void dcd_int_handler(uint8_t rhport)
     // in the same frame and we should handle previous status first.
     if (dcd_reg->ENDPTSETUPSTAT) {
       dcd_reg->ENDPTSETUPSTAT = dcd_reg->ENDPTSETUPSTAT;
-      dcd_event_setup_received(rhport, (uint8_t *) (uintptr_t) &_dcd_data.qhd[0][0].setup_request, true);
+
+      // new setup aborts any unfinished control transfer
+      dcd_reg->ENDPTFLUSH = TU_BIT(0) | TU_BIT(16);
+      while (dcd_reg->ENDPTFLUSH & (TU_BIT(0) | TU_BIT(16))) {}
+      qhd_reset_list(dcd, &dcd->qhd[0][0]);
+      qhd_reset_list(dcd, &dcd->qhd[0][1]);
+
+      dcd_event_setup_received(rhport, (uint8_t *) (uintptr_t) &dcd->qhd[0][0].setup_request, true);
     }
   }
 
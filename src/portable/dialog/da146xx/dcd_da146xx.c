@@ -148,6 +148,13 @@ typedef struct
 #ifndef TU_DA146XX_DMA_RX_CHANNEL
 #define TU_DA146XX_DMA_RX_CHANNEL 6
 #endif
+
+// USB controller can route DMA requests of only one RX and one TX endpoint at a time.
+// When enabled, the DMA of a direction is handed over at packet boundaries to the endpoint
+// with the largest pending transfer, instead of staying with the first endpoint that took it.
+#ifndef TU_DA146XX_DMA_ARBITRATION
+#define TU_DA146XX_DMA_ARBITRATION 1
+#endif
 #define DA146XX_DMA_USB_MUX       (0x6 << (TU_DA146XX_DMA_RX_CHANNEL * 2))
 #define DA146XX_DMA_USB_MUX_MASK  (0xF << (TU_DA146XX_DMA_RX_CHANNEL * 2))
 
@@ -235,6 +242,8 @@ static struct
   xfer_ctl_t xfer_status[EP_MAX][2];
   // Endpoints that use DMA, one for each direction
   uint8_t dma_ep[2];
+  // Bit mask of endpoints that were refused DMA and fall back to FIFO interrupts, one for each direction
+  uint8_t dma_wanted[2];
 } _dcd =
 {
   .vbus_present = false,
@@ -323,9 +332,37 @@ static void fill_tx_fifo(xfer_ctl_t * xfer)
   }
 }
 
+#if TU_DA146XX_DMA_ARBITRATION
+// Check if other endpoint refused DMA before has more data to transfer than epnum.
+// In that case DMA is left idle for the duration of one packet so that the other endpoint
+// can get it when it starts its next packet.
+static bool dma_wanted_by_larger(uint8_t epnum, uint8_t dir)
+{
+  xfer_ctl_t const *xfer = XFER_CTL_BASE(epnum, dir);
+  uint16_t const remaining = xfer->total_len - xfer->transferred;
+
+  for (uint8_t ep = 1; ep < EP_MAX; ++ep)
+  {
+    if (ep == epnum || !(_dcd.dma_wanted[dir] & TU_BIT(ep))) continue;
+
+    xfer_ctl_t const *other = XFER_CTL_BASE(ep, dir);
+    if (other->total_len - other->transferred > remaining) return true;
+  }
+  return false;
+}
+#endif
+
 static bool try_allocate_dma(uint8_t epnum, uint8_t dir)
 {
   // TODO: Disable interrupts while checking
+#if TU_DA146XX_DMA_ARBITRATION
+  if (_dcd.dma_ep[dir] != 0 || dma_wanted_by_larger(epnum, dir))
+  {
+    _dcd.dma_wanted[dir] |= TU_BIT(epnum);
+    return false;
+  }
+  _dcd.dma_wanted[dir] &= ~TU_BIT(epnum);
+#endif
   if (_dcd.dma_ep[dir] == 0)
   {
     _dcd.dma_ep[dir] = epnum;
@@ -707,6 +744,10 @@ static void handle_bus_reset(void)
 
   dcd_event_bus_reset(0, TUSB_SPEED_FULL, true);
   USB->USB_DMA_CTRL_REG = 0;
+  _dcd.dma_ep[TUSB_DIR_OUT] = 0;
+  _dcd.dma_ep[TUSB_DIR_IN] = 0;
+  _dcd.dma_wanted[TUSB_DIR_OUT] = 0;
+  _dcd.dma_wanted[TUSB_DIR_IN] = 0;
 
   USB->USB_MAMSK_REG = USB_USB_MAMSK_REG_USB_M_INTR_Msk |
                        USB_USB_MAMSK_REG_USB_M_FRAME_Msk |
@@ -1006,6 +1047,7 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
         RX_DMA_REGS->DMAx_CTRL_REG &= ~DMA_DMA0_CTRL_REG_DMA_ON_Msk;
         _dcd.dma_ep[TUSB_DIR_OUT] = 0;
       }
+      _dcd.dma_wanted[TUSB_DIR_OUT] &= ~TU_BIT(epnum);
     }
     else
     {
@@ -1018,6 +1060,7 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
         TX_DMA_REGS->DMAx_CTRL_REG &= ~DMA_DMA1_CTRL_REG_DMA_ON_Msk;
         _dcd.dma_ep[TUSB_DIR_IN] = 0;
       }
+      _dcd.dma_wanted[TUSB_DIR_IN] &= ~TU_BIT(epnum);
     }
   }
   tu_memclr(xfer, sizeof(*xfer));
@@ -1128,7 +1171,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 /* Interrupt Handler
  *------------------------------------------------------------------*/
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint32_t int_status = USB->USB_MAEV_REG & USB->USB_MAMSK_REG;
 
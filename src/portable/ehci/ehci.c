@@ -44,32 +44,122 @@
 // Debug level of EHCI
 #define EHCI_DBG     2
 
-// Framelist size as small as possible to save SRAM
+// Periodic frame list size (number of 1 ms frames): 1024, 512 or 256 (USBCMD.FLS). ChipIdea (NXP Transdimension)
+// also supports 128 down to 8. Default to smallest supported to save SRAM and periodic schedule memory traffic.
+#ifndef CFG_TUH_EHCI_FRAMELIST_SIZE
+  #ifdef TUP_USBIP_CHIPIDEA_HS
+    #define CFG_TUH_EHCI_FRAMELIST_SIZE   8
+  #else
+    #define CFG_TUH_EHCI_FRAMELIST_SIZE   256
+  #endif
+#endif
+
+#if   CFG_TUH_EHCI_FRAMELIST_SIZE == 1024
+  #define FRAMELIST_SIZE_LOG2   10
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 512
+  #define FRAMELIST_SIZE_LOG2   9
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 256
+  #define FRAMELIST_SIZE_LOG2   8
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 128
+  #define FRAMELIST_SIZE_LOG2   7
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 64
+  #define FRAMELIST_SIZE_LOG2   6
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 32
+  #define FRAMELIST_SIZE_LOG2   5
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 16
+  #define FRAMELIST_SIZE_LOG2   4
+#elif CFG_TUH_EHCI_FRAMELIST_SIZE == 8
+  #define FRAMELIST_SIZE_LOG2   3
+#else
+  #error "CFG_TUH_EHCI_FRAMELIST_SIZE must be a power of 2 from 8 to 1024"
+#endif
+
+#define FRAMELIST_SIZE                  (1u << FRAMELIST_SIZE_LOG2)
+#define FRAMELIST_SIZE_BIT_VALUE        (10u - FRAMELIST_SIZE_LOG2)
+
 #ifdef TUP_USBIP_CHIPIDEA_HS
-  // NXP Transdimension: 8 elements
-  #define FRAMELIST_SIZE_BIT_VALUE      7u
   #define FRAMELIST_SIZE_USBCMD_VALUE   (((FRAMELIST_SIZE_BIT_VALUE &  3) << EHCI_USBCMD_FRAMELIST_SIZE_SHIFT) | \
                                          ((FRAMELIST_SIZE_BIT_VALUE >> 2) << EHCI_USBCMD_CHIPIDEA_FRAMELIST_SIZE_MSB_SHIFT))
 #else
-  // STD EHCI: 256 elements
-  #define FRAMELIST_SIZE_BIT_VALUE      2u
-  #define FRAMELIST_SIZE_USBCMD_VALUE   ((FRAMELIST_SIZE_BIT_VALUE &  3) << EHCI_USBCMD_POS_FRAMELIST_SIZE)
+  #if FRAMELIST_SIZE_LOG2 < 8
+    #error "Standard EHCI only supports frame list size of 1024, 512 or 256"
+  #endif
+  #define FRAMELIST_SIZE_USBCMD_VALUE   (FRAMELIST_SIZE_BIT_VALUE << EHCI_USBCMD_FRAMELIST_SIZE_SHIFT)
 #endif
 
-#define FRAMELIST_SIZE                  (1024 >> FRAMELIST_SIZE_BIT_VALUE)
+// Interrupt tree has one dummy head QHD per polling interval of 1, 2, 4 ... ms, up to frame list size but no more
+// than 32 ms. Endpoints with longer interval are polled every PERIOD_INTERVAL_MAX which is allowed by USB spec.
+#define PERIOD_HEAD_COUNT               (TU_MIN(FRAMELIST_SIZE_LOG2, 5) + 1)
+#define PERIOD_INTERVAL_MAX             (1u << (PERIOD_HEAD_COUNT - 1))
 
 // Total queue head pool. TODO should be user configurable and more optimize memory usage in the future
 #define QHD_MAX      (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX + CFG_TUH_HUB)
-#define QTD_MAX      QHD_MAX
+// Total qTD pool, a transfer larger than a qTD can hold (16-20KB) is chained across multiple qTDs
+#ifndef CFG_TUH_EHCI_QTD_MAX
+  #define QTD_MAX    QHD_MAX
+#else
+  #define QTD_MAX    CFG_TUH_EHCI_QTD_MAX
+#endif
+
+// Number of highspeed isochronous endpoints, full/low speed isochronous (siTD) is not supported
+#ifndef CFG_TUH_EHCI_ISO_EDPT_MAX
+  #define CFG_TUH_EHCI_ISO_EDPT_MAX   0
+#endif
+
+// Number of iTD (one per frame) of an isochronous endpoint i.e max frames a transfer can span.
+// Transfer is scheduled ISO_SCHEDULE_AHEAD frames ahead and must not wrap around the frame list.
+#define ISO_SCHEDULE_AHEAD   2
+#ifndef CFG_TUH_EHCI_ISO_FRAME_MAX
+  #define ISO_FRAME_MAX      TU_MIN(FRAMELIST_SIZE - ISO_SCHEDULE_AHEAD, 8)
+#else
+  #define ISO_FRAME_MAX      CFG_TUH_EHCI_ISO_FRAME_MAX
+#endif
+
+// Interrupt threshold control (USBCMD ITC) in micro-frames: 1, 2, 4, 8, 16, 32 or 64. Completions are coalesced
+// and reported at most once per threshold, 0 keeps controller's default (usually 8). Since it applies to all
+// endpoints, thresholds above 8 (1 ms) also delay interrupt endpoints e.g HID reports.
+#ifndef CFG_TUH_EHCI_INT_THRESHOLD
+  #define CFG_TUH_EHCI_INT_THRESHOLD   0
+#endif
+
+// NAK counter reload (QHD RL) of high speed bulk/control endpoints: after that many NAKs HC skips the QHD until
+// the next micro-frame instead of spinning the async schedule on an idle endpoint. 0 disables NAK throttling.
+#ifndef CFG_TUH_EHCI_NAK_RELOAD
+  #define CFG_TUH_EHCI_NAK_RELOAD   4
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_EHCI_NAK_RELOAD <= 15, "CFG_TUH_EHCI_NAK_RELOAD is 4-bit");
+
+TU_VERIFY_STATIC(CFG_TUH_EHCI_INT_THRESHOLD <= 64 && (CFG_TUH_EHCI_INT_THRESHOLD & (CFG_TUH_EHCI_INT_THRESHOLD - 1)) == 0,
+                 "CFG_TUH_EHCI_INT_THRESHOLD must be 0 or a power of 2 up to 64");
+
+#if CFG_TUH_EHCI_ISO_EDPT_MAX
+typedef struct {
+  ehci_itd_t itd[ISO_FRAME_MAX];
+
+  uint8_t daddr;
+  uint8_t ep_addr;          // 0 if not opened
+  uint8_t interval_log2;    // service interval is 2^interval_log2 micro-frames
+  uint8_t mult;             // transactions per micro-frame
+  uint16_t packet_size;     // max packet size of a transaction
+
+  uint8_t itd_count;        // number of iTD linked to frame list, 0 if idle
+  uint16_t first_frame;     // frame list index of first iTD
+  uint16_t next_frame;      // frame list index following the last transfer, to continue the stream
+
+  uint8_t* buffer;
+  tuh_iso_packet_t* packets;
+  uint16_t packet_count;
+} ehci_iso_t;
+#endif
 
 typedef struct
 {
   ehci_link_t period_framelist[FRAMELIST_SIZE];
 
-  // TODO only implement 1 ms & 2 ms & 4 ms, 8 ms (framelist)
-  // [0] : 1ms, [1] : 2ms, [2] : 4ms, [3] : 8 ms
+  // [0] : 1ms, [1] : 2ms, [2] : 4ms, [3] : 8 ms ... up to PERIOD_INTERVAL_MAX
   // TODO better implementation without dummy head to save SRAM
-  ehci_qhd_t period_head_arr[4];
+  ehci_qhd_t period_head_arr[PERIOD_HEAD_COUNT];
 
   // Note control qhd of dev0 is used as head of async list
   struct {
@@ -79,6 +169,11 @@ typedef struct
 
   ehci_qhd_t qhd_pool[QHD_MAX];
   ehci_qtd_t qtd_pool[QTD_MAX] TU_ATTR_ALIGNED(32);
+  ehci_qtd_t* qtd_free; // free list of qtd_pool, linked with next pointer
+
+  #if CFG_TUH_EHCI_ISO_EDPT_MAX
+  ehci_iso_t iso[CFG_TUH_EHCI_ISO_EDPT_MAX];
+  #endif
 
   ehci_registers_t* regs;         // operational register
   ehci_cap_registers_t* cap_regs; // capability register
@@ -141,7 +236,9 @@ static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd);
 static void qhd_remove_qtd(ehci_qhd_t *qhd);
 
 TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr);
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_find_free (void);
+static ehci_qtd_t* qtd_alloc (void);
+static void qtd_free (ehci_qtd_t* qtd);
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_next (ehci_qtd_t const * qtd);
 static void qtd_init (ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes);
 
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint32_t interval_ms);
@@ -150,6 +247,13 @@ TU_ATTR_ALWAYS_INLINE static inline void list_insert (ehci_link_t *current, ehci
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_next (ehci_link_t const *p_link);
 static void list_remove_qhd_by_daddr(ehci_link_t* list_head, uint8_t dev_addr);
 
+#if CFG_TUH_EHCI_ISO_EDPT_MAX
+static ehci_iso_t* iso_get_from_addr(uint8_t dev_addr, uint8_t ep_addr);
+static bool iso_open(uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
+static void iso_remove_itd(ehci_iso_t* iso);
+static void iso_xfer_complete_isr(ehci_iso_t* iso);
+#endif
+
 static void ehci_disable_schedule(ehci_registers_t* regs, bool is_period) {
   // maybe have a timeout for status
   if (is_period) {
@@ -227,6 +331,44 @@ bool hcd_port_connect_status(uint8_t rhport)
   return ehci_data.regs->portsc_bm.current_connect_status;
 }
 
+bool hcd_port_suspend(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+
+  // EHCI 4.3.1 Port Suspend: port must be enabled, schedules skip transactions to suspended port
+  TU_VERIFY(regs->portsc_bm.port_enabled);
+  regs->portsc = (regs->portsc & ~EHCI_PORTSC_MASK_W1C) | EHCI_PORTSC_MASK_PORT_SUSPEND;
+
+  return true;
+}
+
+bool hcd_port_resume(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+
+  // Force Port Resume is already set by HC if resume is driven by device (remote wakeup)
+  TU_VERIFY(regs->portsc_bm.suspend);
+  regs->portsc = (regs->portsc & ~EHCI_PORTSC_MASK_W1C) | EHCI_PORTSC_MASK_FORCE_RESUME;
+
+  return true;
+}
+
+void hcd_port_resume_end(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+
+  // skip if resume is already complete
+  if (!regs->portsc_bm.force_port_resume) {
+    return;
+  }
+
+  // HC completes resume with low-speed EOP then clears Suspend
+  regs->portsc = regs->portsc & ~(EHCI_PORTSC_MASK_W1C | EHCI_PORTSC_MASK_FORCE_RESUME);
+}
+
 tusb_speed_t hcd_port_speed_get(uint8_t rhport)
 {
   (void) rhport;
@@ -249,6 +391,16 @@ void hcd_device_close(uint8_t rhport, uint8_t daddr)
     list_remove_qhd_by_daddr((ehci_link_t *) &ehci_data.period_head_arr[i], daddr);
   }
 
+  #if CFG_TUH_EHCI_ISO_EDPT_MAX
+  for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EDPT_MAX; i++) {
+    ehci_iso_t* iso = &ehci_data.iso[i];
+    if (iso->ep_addr && iso->daddr == daddr) {
+      iso_remove_itd(iso);
+      iso->ep_addr = 0;
+    }
+  }
+  #endif
+
   // Async doorbell (EHCI 4.8.2 for operational details)
   ehci_data.regs->command_bm.async_adv_doorbell = 1;
 }
@@ -256,39 +408,33 @@ void hcd_device_close(uint8_t rhport, uint8_t daddr)
 static void init_periodic_list(uint8_t rhport) {
   (void) rhport;
 
-  // Build the polling interval tree with 1 ms, 2 ms, 4 ms and 8 ms (framesize) only
+  // Build the polling interval tree with 1 ms, 2 ms, 4 ms ... PERIOD_INTERVAL_MAX
   for ( uint32_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++ ) {
     ehci_data.period_head_arr[i].int_smask          = 1; // queue head in period list must have smask non-zero
     ehci_data.period_head_arr[i].qtd_overlay.halted = 1; // dummy node, always inactive
   }
 
-  // TODO EHCI_FRAMELIST_SIZE with other size than 8
   // all links --> period_head_arr[0] (1ms)
   // 0, 2, 4, 6 etc --> period_head_arr[1] (2ms)
-  // 1, 5 --> period_head_arr[2] (4ms)
-  // 3 --> period_head_arr[3] (8ms)
+  // 1, 5, 9 etc --> period_head_arr[2] (4ms)
+  // 3, 11 etc --> period_head_arr[3] (8ms)
+  // level n is linked from frames (2^(n-1) - 1) mod 2^n, each frame has at most one level linked before 1ms head
 
   ehci_link_t * const framelist  = ehci_data.period_framelist;
   ehci_link_t * const head_1ms = (ehci_link_t *) &ehci_data.period_head_arr[0];
-  ehci_link_t * const head_2ms = (ehci_link_t *) &ehci_data.period_head_arr[1];
-  ehci_link_t * const head_4ms = (ehci_link_t *) &ehci_data.period_head_arr[2];
-  ehci_link_t * const head_8ms = (ehci_link_t *) &ehci_data.period_head_arr[3];
 
   for (uint32_t i = 0; i < FRAMELIST_SIZE; i++) {
     framelist[i].address = (uint32_t) head_1ms;
     framelist[i].type = EHCI_QTYPE_QHD;
   }
 
-  for (uint32_t i = 0; i < FRAMELIST_SIZE; i += 2) {
-    list_insert(framelist + i, head_2ms, EHCI_QTYPE_QHD);
-  }
-
-  for (uint32_t i = 1; i < FRAMELIST_SIZE; i += 4) {
-    list_insert(framelist + i, head_4ms, EHCI_QTYPE_QHD);
+  for (uint32_t level = 1; level < PERIOD_HEAD_COUNT; level++) {
+    uint32_t const interval = 1u << level;
+    for (uint32_t i = (interval >> 1) - 1; i < FRAMELIST_SIZE; i += interval) {
+      list_insert(framelist + i, (ehci_link_t *) &ehci_data.period_head_arr[level], EHCI_QTYPE_QHD);
+    }
   }
 
-  list_insert(framelist + 3, head_8ms, EHCI_QTYPE_QHD);
-
   head_1ms->terminate = 1;
 }
 
@@ -296,6 +442,11 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
 {
   tu_memclr(&ehci_data, sizeof(ehci_data_t));
 
+  // all qTDs are free
+  for (uint32_t i = 0; i < QTD_MAX; i++) {
+    qtd_free(&ehci_data.qtd_pool[i]);
+  }
+
   ehci_data.regs = (ehci_registers_t*) operatial_reg;
   ehci_data.cap_regs = (ehci_cap_registers_t*) capability_reg;
 
@@ -339,6 +490,9 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
   regs->nxp_tt_control = 0;
 
   //------------- USB CMD Register -------------//
+  #if CFG_TUH_EHCI_INT_THRESHOLD
+  regs->command_bm.int_threshold = CFG_TUH_EHCI_INT_THRESHOLD;
+  #endif
   regs->command |= EHCI_USBCMD_RUN_STOP | EHCI_USBCMD_PERIOD_SCHEDULE_ENABLE | EHCI_USBCMD_ASYNC_SCHEDULE_ENABLE |
                    FRAMELIST_SIZE_USBCMD_VALUE;
 
@@ -379,8 +533,13 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 {
   (void) rhport;
 
-  // TODO not support ISO yet
-  TU_ASSERT (ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+    #if CFG_TUH_EHCI_ISO_EDPT_MAX
+    return iso_open(dev_addr, ep_desc);
+    #else
+    return false;
+    #endif
+  }
 
   //------------- Prepare Queue Head -------------//
   ehci_qhd_t *p_qhd = (ep_desc->bEndpointAddress == 0) ? qhd_control(dev_addr) : qhd_find_free();
@@ -405,10 +564,6 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
       list_head = list_get_period_head(rhport, p_qhd->interval_ms);
     break;
 
-    case TUSB_XFER_ISOCHRONOUS:
-      // TODO iso is not supported
-    break;
-
     default: break;
   }
   TU_ASSERT(list_head);
@@ -470,11 +625,51 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
     // skip if endpoint is halted
     TU_VERIFY(!qhd->qtd_overlay.halted);
 
-    qtd = qtd_find_free();
-    TU_ASSERT(qtd);
+    // Chain qTDs if buffer does not fit into one. Except the last one, qTD length must be multiple of
+    // max packet size. Only the last qTD interrupts on complete, short packet also raises interrupt.
+    uint16_t const mps = qhd->max_packet_size;
+    ehci_qtd_t* prev = NULL;
+    uint8_t* cur_buf = buffer;
+    uint32_t remaining = buflen;
+    qtd = NULL;
+
+    hcd_int_disable(rhport);
+    do {
+      uint32_t len = 5*4096u - ((uint32_t) cur_buf & 0xfffu);
+      if (remaining > len) {
+        len -= len % mps;
+      } else {
+        len = remaining;
+      }
 
-    qtd_init(qtd, buffer, buflen);
-    qtd->pid = qhd->pid;
+      ehci_qtd_t* cur = qtd_alloc();
+      if (cur == NULL) {
+        // not enough qTD, free allocated ones
+        while (qtd) {
+          ehci_qtd_t* next = qtd_next(qtd);
+          qtd_free(qtd);
+          qtd = next;
+        }
+        hcd_int_enable(rhport);
+        TU_ASSERT(false);
+      }
+
+      qtd_init(cur, cur_buf, (uint16_t) len);
+      cur->pid = qhd->pid;
+
+      if (prev) {
+        prev->int_on_complete = 0;
+        prev->next.address = (uint32_t) cur;
+        hcd_dcache_clean(prev, sizeof(ehci_qtd_t));
+      } else {
+        qtd = cur;
+      }
+
+      prev = cur;
+      cur_buf += len;
+      remaining -= len;
+    } while (remaining);
+    hcd_int_enable(rhport);
   }
 
   // IN transfer: invalidate buffer, OUT transfer: clean buffer
@@ -490,24 +685,42 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   return true;
 }
 
+// Check if any TD in the chain is still active
+static bool qtd_chain_active(ehci_qtd_t* qtd) {
+  while (qtd) {
+    hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t));
+    if (qtd->active) return true;
+    qtd = qtd_next(qtd);
+  }
+  return false;
+}
+
 bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
-  (void) rhport;
+  #if CFG_TUH_EHCI_ISO_EDPT_MAX
+  ehci_iso_t* iso = iso_get_from_addr(dev_addr, ep_addr);
+  if (iso) {
+    hcd_int_disable(rhport);
+    bool const active = (iso->itd_count > 0);
+    iso_remove_itd(iso);
+    hcd_int_enable(rhport);
+    return active;
+  }
+  #endif
 
-  // TODO ISO not supported yet
   ehci_qhd_t* qhd = qhd_get_from_addr(dev_addr, ep_addr);
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
   TU_VERIFY(qtd != NULL); // no queued transfer
 
-  hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t));
-  TU_VERIFY(qtd->active); // transfer is already complete
+  TU_VERIFY(qtd_chain_active(qtd)); // transfer is already complete
 
   // HC is still processing, disable HC list schedule before making changes
   bool const is_period = (qhd->interval_ms > 0);
 
   ehci_disable_schedule(ehci_data.regs, is_period);
+  hcd_int_disable(rhport);
 
   // check active bit again just in case HC has just processed the TD
-  bool const still_active = qtd->active;
+  bool const still_active = (qhd->attached_qtd != NULL) && qtd_chain_active(qhd->attached_qtd);
   if (still_active) {
     // remove TD from QH overlay
     qhd->qtd_overlay.next.terminate = 1;
@@ -517,6 +730,7 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
     qhd_remove_qtd(qhd);
   }
 
+  hcd_int_enable(rhport);
   ehci_enable_schedule(ehci_data.regs, is_period);
 
   return still_active; // true if removed an active transfer
@@ -591,11 +805,21 @@ void qhd_xfer_complete_isr(ehci_qhd_t * qhd) {
       xfer_result = XFER_RESULT_SUCCESS;
     }
 
+    // Sum up transferred bytes of chained TDs. Transfer is complete when all TDs are retired, or it is
+    // halted, or ended with a short packet. Otherwise HC has not advanced to next TD yet.
     ehci_qtd_t * volatile qtd = qhd->attached_qtd;
-    hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t)); // HC may have written back TD
+    uint32_t xferred_bytes = 0;
+    for (ehci_qtd_t* cur = qtd; cur != NULL; cur = qtd_next(cur)) {
+      hcd_dcache_invalidate(cur, sizeof(ehci_qtd_t)); // HC may have written back TD
+      if (cur->active) {
+        if (!qtd_overlay->halted) return;
+        break;
+      }
+      xferred_bytes += (uint32_t) (cur->expected_bytes - cur->total_bytes);
+      if (cur->total_bytes || cur->halted) break; // short packet or error
+    }
 
     uint8_t const dir = (qtd->pid == EHCI_PID_IN) ? 1 : 0;
-    uint32_t const xferred_bytes = qtd->expected_bytes - qtd->total_bytes;
 
     // invalidate dcache if IN transfer with data
     if (dir == 1 && qhd->attached_buffer != 0 && xferred_bytes > 0) {
@@ -656,7 +880,7 @@ void process_period_xfer_isr(uint8_t rhport, uint32_t interval_ms)
 }
 
 //------------- Host Controller Driver's Interrupt Handler -------------//
-void hcd_int_handler(uint8_t rhport, bool in_isr) {
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr) {
   (void) in_isr;
   ehci_registers_t* regs = ehci_data.regs;
   uint32_t const int_status = regs->status;
@@ -682,6 +906,11 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
       port_connect_status_change_isr(rhport);
     }
 
+    // J-K transition on suspended port: remote wakeup, software must end resume after 20ms
+    if (regs->portsc_bm.force_port_resume && regs->portsc_bm.suspend) {
+      hcd_event_device_resume(rhport, true);
+    }
+
     regs->portsc |= port_status; // Acknowledge change bits in portsc
     regs->status = EHCI_INT_MASK_PORT_CHANGE; // Acknowledge
   }
@@ -691,10 +920,16 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   if (usb_int) {
     proccess_async_xfer_isr(list_get_async_head(rhport));
 
-    for ( uint32_t i = 1; i <= FRAMELIST_SIZE; i *= 2 ) {
+    for ( uint32_t i = 1; i <= PERIOD_INTERVAL_MAX; i *= 2 ) {
       process_period_xfer_isr(rhport, i);
     }
 
+    #if CFG_TUH_EHCI_ISO_EDPT_MAX
+    for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EDPT_MAX; i++) {
+      iso_xfer_complete_isr(&ehci_data.iso[i]);
+    }
+    #endif
+
     regs->status = usb_int; // Acknowledge
   }
 
@@ -713,7 +948,7 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
 // Get head of periodic list
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint32_t interval_ms) {
   (void) rhport;
-  return (ehci_link_t*) &ehci_data.period_head_arr[ tu_log2( tu_min32(FRAMELIST_SIZE, interval_ms) ) ];
+  return (ehci_link_t*) &ehci_data.period_head_arr[ tu_log2( tu_min32(PERIOD_INTERVAL_MAX, interval_ms) ) ];
 }
 
 // Get head of async list
@@ -811,6 +1046,32 @@ static ehci_qhd_t *qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr) {
   return NULL;
 }
 
+// Find least loaded uframe (0-3) to start split of periodic full/low speed endpoint. Load is summed from
+// max packet size of other interrupt QHDs using the same Transaction Translator: the parent hub, or its
+// port if hub is multi-TT.
+static uint8_t split_get_start_uframe(hcd_devtree_info_t const* devtree_info) {
+  uint32_t load[4] = { 0 };
+  ehci_qhd_t const* qhd_pool = ehci_data.qhd_pool;
+
+  for (uint32_t i = 0; i < QHD_MAX; i++) {
+    ehci_qhd_t const* qhd = &qhd_pool[i];
+    if (qhd->used && !qhd->removing && qhd->ep_speed != TUSB_SPEED_HIGH && qhd->int_smask &&
+        qhd->fl_hub_addr == devtree_info->hub_addr &&
+        (!devtree_info->hub_multi_tt || qhd->fl_hub_port == devtree_info->hub_port)) {
+      for (uint8_t uframe = 0; uframe < 4; uframe++) {
+        if (tu_bit_test(qhd->int_smask, uframe)) load[uframe] += qhd->max_packet_size;
+      }
+    }
+  }
+
+  uint8_t best = 0;
+  for (uint8_t uframe = 1; uframe < 4; uframe++) {
+    if (load[uframe] < load[best]) best = uframe;
+  }
+
+  return best;
+}
+
 // Init queue head with endpoint descriptor
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
 {
@@ -833,7 +1094,9 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
   p_qhd->head_list_flag     = (dev_addr == 0) ? 1 : 0; // addr0's endpoint is the static asyn list head
   p_qhd->max_packet_size    = tu_edpt_packet_size(ep_desc);
   p_qhd->fl_ctrl_ep_flag    = ((xfer_type == TUSB_XFER_CONTROL) && (p_qhd->ep_speed != TUSB_SPEED_HIGH))  ? 1 : 0;
-  p_qhd->nak_reload         = 0;
+  // NAK throttling is for async schedule only, RL must be zero for interrupt (and split) QHD
+  p_qhd->nak_reload         = (xfer_type != TUSB_XFER_INTERRUPT && p_qhd->ep_speed == TUSB_SPEED_HIGH) ?
+                              CFG_TUH_EHCI_NAK_RELOAD : 0;
 
   // Bulk/Control -> smask = cmask = 0
   // TODO Isochronous
@@ -855,9 +1118,11 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
     }else
     {
       TU_ASSERT( 0 != interval, );
-      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at 1 us & complete split at 2,3,4 uframes
-      p_qhd->int_smask    = 0x01;
-      p_qhd->fl_int_cmask = TU_BIN8(11100);
+      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at uframe N & complete split at N+2, N+3, N+4.
+      // Start split is placed in the least loaded uframe of the Transaction Translator to spread splits.
+      uint8_t const ss_uframe = split_get_start_uframe(&devtree_info);
+      p_qhd->int_smask    = (uint8_t) TU_BIT(ss_uframe);
+      p_qhd->fl_int_cmask = (uint8_t) (TU_BIN8(11100) << ss_uframe);
       p_qhd->interval_ms  = interval;
     }
   }else
@@ -898,7 +1163,7 @@ static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd) {
   hcd_dcache_clean_invalidate(qhd, sizeof(ehci_qhd_t));
 }
 
-// Remove an attached TD from queue head
+// Remove an attached TD (chain) from queue head
 static void qhd_remove_qtd(ehci_qhd_t *qhd) {
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
 
@@ -906,8 +1171,11 @@ static void qhd_remove_qtd(ehci_qhd_t *qhd) {
   qhd->attached_buffer = 0;
   hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
 
-  qtd->used = 0; // free QTD
-  hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
+  while (qtd) {
+    ehci_qtd_t* next = qtd_next(qtd);
+    qtd_free(qtd);
+    qtd = next;
+  }
 }
 
 //--------------------------------------------------------------------+
@@ -919,11 +1187,30 @@ TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr) {
   return &ehci_data.control[dev_addr].qtd;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t *qtd_find_free(void) {
-  for (uint32_t i = 0; i < QTD_MAX; i++) {
-    if (!ehci_data.qtd_pool[i].used) return &ehci_data.qtd_pool[i];
+// Get next TD in chain, NULL if last one
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_next(ehci_qtd_t const * qtd) {
+  return qtd->next.terminate ? NULL : (ehci_qtd_t*) tu_align32(qtd->next.address);
+}
+
+// Take a TD from free list. Note: caller must prevent race with qtd_free() in ISR
+static ehci_qtd_t* qtd_alloc(void) {
+  ehci_qtd_t* qtd = ehci_data.qtd_free;
+  if (qtd) {
+    ehci_data.qtd_free = (ehci_qtd_t*) qtd->next.address;
   }
-  return NULL;
+  return qtd;
+}
+
+// Return TD to free list, control TD is not part of pool
+static void qtd_free(ehci_qtd_t* qtd) {
+  qtd->used = 0;
+
+  if (qtd >= ehci_data.qtd_pool && qtd < ehci_data.qtd_pool + QTD_MAX) {
+    qtd->next.address = (uint32_t) ehci_data.qtd_free;
+    ehci_data.qtd_free = qtd;
+  }
+
+  hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
 }
 
 static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes) {
@@ -945,4 +1232,227 @@ static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes)
   }
 }
 
+//--------------------------------------------------------------------+
+// Isochronous (highspeed iTD)
+//--------------------------------------------------------------------+
+#if CFG_TUH_EHCI_ISO_EDPT_MAX
+
+static ehci_iso_t* iso_get_from_addr(uint8_t dev_addr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EDPT_MAX; i++) {
+    ehci_iso_t* iso = &ehci_data.iso[i];
+    if (iso->ep_addr && iso->ep_addr == ep_addr && iso->daddr == dev_addr) return iso;
+  }
+  return NULL;
+}
+
+// Below 1 ms interval multiple packets are transferred in one iTD (frame), otherwise there is one packet per iTD
+TU_ATTR_ALWAYS_INLINE static inline uint8_t iso_packet_per_itd(ehci_iso_t const* iso) {
+  return (iso->interval_log2 < 3) ? (uint8_t) (8u >> iso->interval_log2) : 1u;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t iso_frame_step(ehci_iso_t const* iso) {
+  return (iso->interval_log2 < 3) ? 1u : (1u << (iso->interval_log2 - 3));
+}
+
+// micro-frame of the n-th packet within its iTD
+TU_ATTR_ALWAYS_INLINE static inline uint8_t iso_packet_uframe(ehci_iso_t const* iso, uint16_t n) {
+  uint8_t const idx = (uint8_t) (n % iso_packet_per_itd(iso));
+  return (iso->interval_log2 < 3) ? (uint8_t) (idx << iso->interval_log2) : 0u;
+}
+
+static bool iso_open(uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc) {
+  hcd_devtree_info_t devtree_info;
+  hcd_devtree_get_info(dev_addr, &devtree_info);
+
+  // full/low speed device behind a hub requires split isochronous (siTD) which is not supported
+  TU_ASSERT(devtree_info.speed == TUSB_SPEED_HIGH);
+
+  // re-open e.g when alternate setting is changed reuses the same slot
+  ehci_iso_t* iso = iso_get_from_addr(dev_addr, ep_desc->bEndpointAddress);
+  for (uint8_t i = 0; iso == NULL && i < CFG_TUH_EHCI_ISO_EDPT_MAX; i++) {
+    if (ehci_data.iso[i].ep_addr == 0) iso = &ehci_data.iso[i];
+  }
+  TU_ASSERT(iso);
+  TU_VERIFY(iso->itd_count == 0);
+
+  uint16_t const wMaxPacketSize = tu_le16toh(ep_desc->wMaxPacketSize);
+
+  iso->daddr         = dev_addr;
+  iso->ep_addr       = ep_desc->bEndpointAddress;
+  iso->packet_size   = tu_edpt_packet_size(ep_desc);
+  iso->mult          = (uint8_t) (((wMaxPacketSize >> 11) & 0x3u) + 1u);
+  iso->interval_log2 = (uint8_t) (tu_min8(tu_max8(ep_desc->bInterval, 1), 16) - 1);
+  iso->next_frame    = 0;
+
+  return true;
+}
+
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer,
+                       tuh_iso_packet_t* packets, uint16_t packet_count) {
+  ehci_iso_t* iso = iso_get_from_addr(daddr, ep_addr);
+  TU_ASSERT(iso && packet_count);
+  TU_VERIFY(iso->itd_count == 0);
+
+  uint8_t  const pkt_per_itd = iso_packet_per_itd(iso);
+  uint32_t const frame_step  = iso_frame_step(iso);
+  uint32_t const itd_count   = (packet_count + pkt_per_itd - 1u) / pkt_per_itd;
+  uint32_t const span        = (itd_count - 1u) * frame_step; // frames between first and last iTD
+
+  // transfer must not wrap around frame list
+  TU_ASSERT(itd_count <= ISO_FRAME_MAX && span < FRAMELIST_SIZE - ISO_SCHEDULE_AHEAD);
+
+  uint16_t const max_len = (uint16_t) (iso->packet_size * iso->mult);
+  uint32_t total_len = 0;
+  for (uint16_t n = 0; n < packet_count; n++) {
+    TU_ASSERT(packets[n].length <= max_len);
+    total_len += packets[n].length;
+  }
+
+  uint8_t const epnum  = tu_edpt_number(ep_addr);
+  uint8_t const dir_in = tu_edpt_dir(ep_addr);
+
+  // Each iTD has 7 page pointers starting from its first packet, which always covers 8 packets of 3072 bytes
+  uint8_t* pkt_buf = buffer;
+  uint16_t n = 0;
+  for (uint32_t i = 0; i < itd_count; i++) {
+    ehci_itd_t* itd = &iso->itd[i];
+    tu_memclr(itd, sizeof(ehci_itd_t));
+
+    uint32_t const page0 = tu_align4k((uint32_t) pkt_buf);
+    uint8_t uframe = 0;
+
+    for (uint8_t t = 0; t < pkt_per_itd && n < packet_count; t++, n++) {
+      uint32_t const addr = (uint32_t) pkt_buf;
+      uframe = iso_packet_uframe(iso, n);
+
+      itd->xact[uframe].offset      = addr & 0xfffu;
+      itd->xact[uframe].page_select = (addr - page0) >> 12;
+      itd->xact[uframe].length      = packets[n].length;
+      itd->xact[uframe].active      = 1;
+
+      pkt_buf += packets[n].length;
+    }
+
+    // only last transaction of the transfer interrupts on complete
+    if (i == itd_count - 1) {
+      itd->xact[uframe].int_on_complete = 1;
+    }
+
+    for (uint8_t p = 0; p < TU_ARRAY_SIZE(itd->BufferPointer); p++) {
+      itd->BufferPointer[p] = page0 + p * 4096u;
+    }
+    itd->BufferPointer[0] |= ((uint32_t) epnum << 8) | daddr;
+    itd->BufferPointer[1] |= ((uint32_t) dir_in << 11) | iso->packet_size;
+    itd->BufferPointer[2] |= iso->mult;
+  }
+
+  // IN transfer: invalidate buffer, OUT transfer: clean buffer
+  if (dir_in) {
+    hcd_dcache_invalidate(buffer, total_len);
+  } else {
+    hcd_dcache_clean(buffer, total_len);
+  }
+
+  iso->buffer       = buffer;
+  iso->packets      = packets;
+  iso->packet_count = packet_count;
+
+  hcd_int_disable(rhport);
+
+  // Continue the stream if its next frame is still ahead, otherwise restart ISO_SCHEDULE_AHEAD frames from now
+  uint32_t const cur_frame = (ehci_data.regs->frame_index >> 3) & (FRAMELIST_SIZE - 1u);
+  uint32_t const ahead = (iso->next_frame - cur_frame) & (FRAMELIST_SIZE - 1u);
+  uint32_t first_frame = iso->next_frame;
+  if (ahead == 0 || ahead > FRAMELIST_SIZE / 2 || ahead + span >= FRAMELIST_SIZE) {
+    first_frame = cur_frame + ISO_SCHEDULE_AHEAD;
+  }
+
+  // iTDs are placed before queue heads of the frame
+  for (uint32_t i = 0; i < itd_count; i++) {
+    ehci_link_t* entry = &ehci_data.period_framelist[(first_frame + i * frame_step) & (FRAMELIST_SIZE - 1u)];
+    list_insert(entry, &iso->itd[i].next, EHCI_QTYPE_ITD);
+    hcd_dcache_clean(&iso->itd[i], sizeof(ehci_itd_t));
+    hcd_dcache_clean(entry, sizeof(ehci_link_t));
+  }
+
+  iso->first_frame = (uint16_t) (first_frame & (FRAMELIST_SIZE - 1u));
+  iso->next_frame  = (uint16_t) ((first_frame + itd_count * frame_step) & (FRAMELIST_SIZE - 1u));
+  iso->itd_count   = (uint8_t) itd_count;
+
+  hcd_int_enable(rhport);
+
+  return true;
+}
+
+// Unlink all iTDs of the endpoint from frame list
+static void iso_remove_itd(ehci_iso_t* iso) {
+  uint32_t const frame_step = iso_frame_step(iso);
+
+  for (uint8_t i = 0; i < iso->itd_count; i++) {
+    ehci_link_t* prev = &ehci_data.period_framelist[(iso->first_frame + i * frame_step) & (FRAMELIST_SIZE - 1u)];
+    uint32_t const itd_addr = (uint32_t) &iso->itd[i];
+
+    while (prev->type == EHCI_QTYPE_ITD && !prev->terminate) {
+      if (tu_align32(prev->address) == itd_addr) {
+        prev->address = iso->itd[i].next.address;
+        hcd_dcache_clean(prev, sizeof(ehci_link_t));
+        break;
+      }
+      prev = list_next(prev);
+    }
+  }
+
+  iso->itd_count = 0;
+}
+
+// Check if all iTDs of an isochronous transfer are retired
+static void iso_xfer_complete_isr(ehci_iso_t* iso) {
+  if (iso->itd_count == 0) return;
+
+  for (uint8_t i = 0; i < iso->itd_count; i++) {
+    ehci_itd_t* itd = &iso->itd[i];
+    hcd_dcache_invalidate(itd, sizeof(ehci_itd_t)); // HC may have written back status
+    for (uint8_t u = 0; u < 8; u++) {
+      if (itd->xact[u].active) return;
+    }
+  }
+
+  uint8_t const pkt_per_itd = iso_packet_per_itd(iso);
+  uint8_t const dir_in = tu_edpt_dir(iso->ep_addr);
+  uint32_t total_len = 0;
+  uint32_t xferred_bytes = 0;
+  uint16_t failed_count = 0;
+
+  for (uint16_t n = 0; n < iso->packet_count; n++) {
+    ehci_itd_t const* itd = &iso->itd[n / pkt_per_itd];
+    uint8_t const uframe = iso_packet_uframe(iso, n);
+    tuh_iso_packet_t* pkt = &iso->packets[n];
+
+    if (itd->xact[uframe].error || itd->xact[uframe].babble_err || itd->xact[uframe].buffer_err) {
+      pkt->actual_len = 0;
+      pkt->result = XFER_RESULT_FAILED;
+      failed_count++;
+    } else {
+      // HC writes back received byte count for IN
+      pkt->actual_len = dir_in ? (uint16_t) itd->xact[uframe].length : pkt->length;
+      pkt->result = XFER_RESULT_SUCCESS;
+    }
+
+    total_len += pkt->length;
+    xferred_bytes += pkt->actual_len;
+  }
+
+  if (dir_in && xferred_bytes > 0) {
+    hcd_dcache_invalidate(iso->buffer, total_len);
+  }
+
+  iso_remove_itd(iso);
+
+  // transfer only fails if none of its packets succeeded, otherwise check per-packet result
+  xfer_result_t const result = (failed_count == iso->packet_count) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
+  hcd_event_xfer_complete(iso->daddr, iso->ep_addr, xferred_bytes, result, true);
+}
+
+#endif
+
 #endif
@@ -52,6 +52,19 @@
 // Max number of IN EP FIFOs
 #define EP_FIFO_NUM 5
 
+// Allocate USB interrupt with ESP_INTR_FLAG_IRAM so that it is still serviced while flash is being
+// written. Interrupt path of the stack is placed in IRAM with TU_ATTR_FAST_FUNC, callbacks invoked in
+// ISR context (e.g SOF, xfer_isr) must be IRAM-safe as well.
+#ifndef CFG_TUD_ESP32_ISR_IRAM
+  #define CFG_TUD_ESP32_ISR_IRAM  0
+#endif
+
+#if CFG_TUD_ESP32_ISR_IRAM
+  #define USB_INTR_FLAGS  (ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM)
+#else
+  #define USB_INTR_FLAGS  ESP_INTR_FLAG_LOWMED
+#endif
+
 typedef struct {
     uint8_t *buffer;
     // tu_fifo_t * ff; // TODO support dcd_edpt_xfer_fifo API
@@ -82,7 +95,7 @@ static uint8_t get_free_fifo(void)
 }
 
 // Setup the control endpoint 0.
-static void bus_reset(void)
+TU_ATTR_FAST_FUNC static void bus_reset(void)
 {
   for (int ep_num = 0; ep_num < USB_OUT_EP_NUM; ep_num++) {
     USB0.out_ep_reg[ep_num].doepctl |= USB_DO_SNAK0_M; // DOEPCTL0_SNAK
@@ -136,7 +149,7 @@ static void bus_reset(void)
   USB0.gintmsk |= USB_IEPINTMSK_M | USB_OEPINTMSK_M;
 }
 
-static void enum_done_processing(void)
+TU_ATTR_FAST_FUNC static void enum_done_processing(void)
 {
   ESP_EARLY_LOGV(TAG, "dcd_int_handler - Speed enumeration done! Sending DCD_EVENT_BUS_RESET then");
   // On current silicon on the Full Speed core, speed is fixed to Full Speed.
@@ -348,7 +361,7 @@ void dcd_edpt_close_all(uint8_t rhport)
   _allocated_fifos = 1;
 }
 
-bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
 {
   (void)rhport;
 
@@ -501,7 +514,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 
 /*------------------------------------------------------------------*/
 
-static void receive_packet(xfer_ctl_t *xfer, /* usb_out_endpoint_t * out_ep, */ uint16_t xfer_size)
+TU_ATTR_FAST_FUNC static void receive_packet(xfer_ctl_t *xfer, /* usb_out_endpoint_t * out_ep, */ uint16_t xfer_size)
 {
   ESP_EARLY_LOGV(TAG, "USB - receive_packet");
   volatile uint32_t *rx_fifo = USB0.fifo[0];
@@ -532,37 +545,8 @@ static void receive_packet(xfer_ctl_t *xfer, /* usb_out_endpoint_t * out_ep, */
   else
 #endif
   {
-    uint8_t to_recv_rem = to_recv_size % 4;
-    uint16_t to_recv_size_aligned = to_recv_size - to_recv_rem;
-
-    // Do not assume xfer buffer is aligned.
-    uint8_t *base = (xfer->buffer + xfer->queued_len);
-
-    // This for loop always runs at least once- skip if less than 4 bytes
-    // to collect.
-    if (to_recv_size >= 4) {
-      for (uint16_t i = 0; i < to_recv_size_aligned; i += 4) {
-        uint32_t tmp = (*rx_fifo);
-        base[i] = tmp & 0x000000FF;
-        base[i + 1] = (tmp & 0x0000FF00) >> 8;
-        base[i + 2] = (tmp & 0x00FF0000) >> 16;
-        base[i + 3] = (tmp & 0xFF000000) >> 24;
-      }
-    }
-
-    // Do not read invalid bytes from RX FIFO.
-    if (to_recv_rem != 0) {
-      uint32_t tmp = (*rx_fifo);
-      uint8_t *last_32b_bound = base + to_recv_size_aligned;
-
-      last_32b_bound[0] = tmp & 0x000000FF;
-      if (to_recv_rem > 1) {
-        last_32b_bound[1] = (tmp & 0x0000FF00) >> 8;
-      }
-      if (to_recv_rem > 2) {
-        last_32b_bound[2] = (tmp & 0x00FF0000) >> 16;
-      }
-    }
+    // Do not assume xfer buffer is aligned, trailing bytes are taken from one last word
+    tu_hwfifo_read(rx_fifo, xfer->buffer + xfer->queued_len, to_recv_size, TU_HWFIFO_REG32);
   }
 
   xfer->queued_len += xfer_size;
@@ -572,7 +556,7 @@ static void receive_packet(xfer_ctl_t *xfer, /* usb_out_endpoint_t * out_ep, */
   xfer->short_packet = (xfer_size < xfer->max_size);
 }
 
-static void transmit_packet(xfer_ctl_t *xfer, volatile usb_in_endpoint_t *in_ep, uint8_t fifo_num)
+TU_ATTR_FAST_FUNC static void transmit_packet(xfer_ctl_t *xfer, volatile usb_in_endpoint_t *in_ep, uint8_t fifo_num)
 {
   ESP_EARLY_LOGV(TAG, "USB - transmit_packet");
   volatile uint32_t *tx_fifo = USB0.fifo[fifo_num];
@@ -590,42 +574,12 @@ static void transmit_packet(xfer_ctl_t *xfer, volatile usb_in_endpoint_t *in_ep,
   else
 #endif
   {
-    uint8_t to_xfer_rem = to_xfer_size % 4;
-    uint16_t to_xfer_size_aligned = to_xfer_size - to_xfer_rem;
-
-    // Buffer might not be aligned to 32b, so we need to force alignment
-    // by copying to a temp var.
-    uint8_t *base = (xfer->buffer + xfer->queued_len);
-
-    // This for loop always runs at least once- skip if less than 4 bytes
-    // to send off.
-    if (to_xfer_size >= 4) {
-      for (uint16_t i = 0; i < to_xfer_size_aligned; i += 4) {
-        uint32_t tmp = base[i] | (base[i + 1] << 8) |
-            (base[i + 2] << 16) | (base[i + 3] << 24);
-        (*tx_fifo) = tmp;
-      }
-    }
-
-    // Do not read beyond end of buffer if not divisible by 4.
-    if (to_xfer_rem != 0) {
-      uint32_t tmp = 0;
-      uint8_t *last_32b_bound = base + to_xfer_size_aligned;
-
-      tmp |= last_32b_bound[0];
-      if (to_xfer_rem > 1) {
-        tmp |= (last_32b_bound[1] << 8);
-      }
-      if (to_xfer_rem > 2) {
-        tmp |= (last_32b_bound[2] << 16);
-      }
-
-      (*tx_fifo) = tmp;
-    }
+    // Buffer might not be aligned to 32b, trailing bytes are pushed as one zero-padded word
+    tu_hwfifo_write(tx_fifo, xfer->buffer + xfer->queued_len, to_xfer_size, TU_HWFIFO_REG32);
   }
 }
 
-static void read_rx_fifo(void)
+TU_ATTR_FAST_FUNC static void read_rx_fifo(void)
 {
   // Pop control word off FIFO (completed xfers will have 2 control words,
   // we only pop one ctl word each interrupt).
@@ -674,7 +628,7 @@ static void read_rx_fifo(void)
   }
 }
 
-static void handle_epout_ints(void)
+TU_ATTR_FAST_FUNC static void handle_epout_ints(void)
 {
   // GINTSTS will be cleared with DAINT == 0
   // DAINT for a given EP clears when DOEPINTx is cleared.
@@ -709,7 +663,7 @@ static void handle_epout_ints(void)
   }
 }
 
-static void handle_epin_ints(void)
+TU_ATTR_FAST_FUNC static void handle_epin_ints(void)
 {
   // GINTSTS will be cleared with DAINT == 0
   // DAINT for a given EP clears when DIEPINTx is cleared.
@@ -750,7 +704,7 @@ static void handle_epin_ints(void)
 }
 
 
-static void _dcd_int_handler(void* arg)
+TU_ATTR_FAST_FUNC static void _dcd_int_handler(void* arg)
 {
   (void) arg;
   uint8_t const rhport = 0;
@@ -864,7 +818,7 @@ static void _dcd_int_handler(void* arg)
 void dcd_int_enable (uint8_t rhport)
 {
   (void) rhport;
-  esp_intr_alloc(ETS_USB_INTR_SOURCE, ESP_INTR_FLAG_LOWMED, (intr_handler_t) _dcd_int_handler, NULL, &usb_ih);
+  esp_intr_alloc(ETS_USB_INTR_SOURCE, USB_INTR_FLAGS, (intr_handler_t) _dcd_int_handler, NULL, &usb_ih);
 }
 
 void dcd_int_disable (uint8_t rhport)
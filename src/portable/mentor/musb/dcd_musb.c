@@ -52,6 +52,16 @@ _Pragma("GCC diagnostic ignored \"-Waddress-of-packed-member\"");
   #error "Unsupported MCUs"
 #endif
 
+// Use the integrated DMA controller (DMA request mode 1) for multi-packet bulk transfers.
+// Buffer must be 4-byte aligned and transfer spans at least 2 packets, otherwise PIO is used.
+#ifndef CFG_TUD_MUSB_DMA
+  #define CFG_TUD_MUSB_DMA  0
+#endif
+
+#if CFG_TUD_MUSB_DMA && !TU_CHECK_MCU(OPT_MCU_MSP432E4, OPT_MCU_TM4C129)
+  #error "CFG_TUD_MUSB_DMA requires the integrated USB DMA controller (MSP432E4, TM4C129)"
+#endif
+
 /*------------------------------------------------------------------
  * MACRO TYPEDEF CONSTANT ENUM DECLARATION
  *------------------------------------------------------------------*/
@@ -73,12 +83,6 @@ typedef struct TU_ATTR_PACKED {
   uint16_t RESERVED[3];
 } hw_endpoint_t;
 
-typedef union {
-  uint8_t   u8;
-  uint16_t  u16;
-  uint32_t  u32;
-} hw_fifo_t;
-
 typedef struct TU_ATTR_PACKED
 {
   void      *buf;      /* the start address of a transfer data buffer */
@@ -86,6 +90,17 @@ typedef struct TU_ATTR_PACKED
   uint16_t  remaining; /* the number of bytes remaining in the buffer */
 } pipe_state_t;
 
+#if CFG_TUD_MUSB_DMA
+#define DMA_CHANNEL_COUNT  8
+
+typedef struct {
+  uint32_t CTL;
+  uint32_t ADDR;
+  uint32_t COUNT;
+  uint32_t RESERVED;
+} hw_dma_channel_t;
+#endif
+
 typedef struct
 {
   tusb_control_request_t setup_packet;
@@ -94,6 +109,10 @@ typedef struct
   pipe_state_t pipe0;
   pipe_state_t pipe[2][7];   /* pipe[direction][endpoint number - 1] */
   uint16_t     pipe_buf_is_fifo[2]; /* Bitmap. Each bit means whether 1:TU_FIFO or 0:POD. */
+#if CFG_TUD_MUSB_DMA
+  uint16_t     pipe_is_bulk[2];     /* Bitmap. Each bit means whether 1:bulk (can use DMA) or 0:other. */
+  uint8_t      dma_ep[DMA_CHANNEL_COUNT]; /* Endpoint address served by each DMA channel, 0 if free. */
+#endif
 } dcd_data_t;
 
 /*------------------------------------------------------------------
@@ -222,66 +241,124 @@ static inline volatile hw_endpoint_t* edpt_regs(unsigned epnum_minus1)
   return regs + epnum_minus1;
 }
 
-static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
+#if CFG_TUD_MUSB_DMA
+/* DMA registers are located at offset 0x200: DMAINTR followed by 8 channels of CTL, ADDR and COUNT */
+static inline volatile hw_dma_channel_t* dma_regs(unsigned ch)
 {
-  volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    reg->u32 = *(uint32_t const *)addr;
-    addr += 4;
-    len  -= 4;
-  }
-  if (len >= 2) {
-    reg->u16 = *(uint16_t const *)addr;
-    addr += 2;
-    len  -= 2;
+  return (volatile hw_dma_channel_t*)((uintptr_t)USB0 + 0x204) + ch;
+}
+
+static inline uint_fast8_t dma_int_status(void)
+{
+  return *(volatile uint8_t*)((uintptr_t)USB0 + 0x200); /* read and clear interrupt status */
+}
+
+static int dma_find_channel(uint_fast8_t ep_addr)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_COUNT; ++ch) {
+    if (_dcd.dma_ep[ch] == ep_addr) return (int)ch;
   }
-  if (len) {
-    reg->u8 = *(uint8_t const *)addr;
+  return -1;
+}
+
+/* Move whole packets of the pipe with DMA request mode 1: AUTOSET/AUTOCL let the core set TXRDY or clear RXRDY
+ * for each packet and only the end of the DMA transfer raises an interrupt. The remainder is left to PIO.
+ * OUT always leaves the last packet to PIO so that RXRDY keeps NAKing the host after transfer completion. */
+static bool dma_xfer_start(uint_fast8_t ep_addr)
+{
+  unsigned const epnum        = tu_edpt_number(ep_addr);
+  unsigned const epnum_minus1 = epnum - 1;
+  unsigned const dir_in       = tu_edpt_dir(ep_addr);
+  pipe_state_t  *pipe         = &_dcd.pipe[dir_in][epnum_minus1];
+
+  if (!(_dcd.pipe_is_bulk[dir_in] & TU_BIT(epnum_minus1))) return false;
+  if (_dcd.pipe_buf_is_fifo[dir_in] & TU_BIT(epnum_minus1)) return false;
+  if ((uintptr_t)pipe->buf & 3) return false;
+
+  volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
+  unsigned const mps = dir_in ? regs->TXMAXP : regs->RXMAXP;
+  unsigned const rem = pipe->remaining;
+  if ((mps & 3) || (rem < 2 * mps)) return false;
+
+  unsigned const len = dir_in ? (rem / mps) * mps : ((rem - 1) / mps) * mps;
+  if (len < 2 * mps) return false;
+
+  int const ch = dma_find_channel(0);
+  if (ch < 0) return false; /* all channels are busy, fall back to PIO */
+  _dcd.dma_ep[ch] = ep_addr;
+
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->ADDR  = (uint32_t)(uintptr_t)pipe->buf;
+  dma->COUNT = len;
+  if (dir_in) {
+    regs->TXCSRH |= USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN | USB_TXCSRH1_DMAMOD;
+    dma->CTL = (epnum << USB_DMACTL0_EP_S) | USB_DMACTL0_IE | USB_DMACTL0_MODE | USB_DMACTL0_DIR | USB_DMACTL0_ENABLE;
+  } else {
+    regs->RXCSRH |= USB_RXCSRH1_AUTOCL | USB_RXCSRH1_DMAEN | USB_RXCSRH1_DMAMOD;
+    dma->CTL = (epnum << USB_DMACTL0_EP_S) | USB_DMACTL0_IE | USB_DMACTL0_MODE | USB_DMACTL0_ENABLE;
   }
+  return true;
 }
 
-static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
+/* Stop DMA of the endpoint and account the bytes it has moved, also used to abort */
+static void dma_xfer_stop(unsigned ch)
 {
-  volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    *(uint32_t *)addr = reg->u32;
-    addr += 4;
-    len  -= 4;
+  uint_fast8_t const ep_addr  = _dcd.dma_ep[ch];
+  unsigned const epnum_minus1 = tu_edpt_number(ep_addr) - 1;
+  unsigned const dir_in       = tu_edpt_dir(ep_addr);
+  pipe_state_t  *pipe         = &_dcd.pipe[dir_in][epnum_minus1];
+
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->CTL = 0;
+  _dcd.dma_ep[ch] = 0;
+
+  volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
+  if (dir_in) {
+    regs->TXCSRH &= ~(USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN | USB_TXCSRH1_DMAMOD);
+  } else {
+    regs->RXCSRH &= ~(USB_RXCSRH1_AUTOCL | USB_RXCSRH1_DMAEN | USB_RXCSRH1_DMAMOD);
   }
-  if (len >= 2) {
-    *(uint16_t *)addr = reg->u16;
-    addr += 2;
-    len  -= 2;
+
+  if (pipe->buf) {
+    unsigned const moved = dma->ADDR - (uint32_t)(uintptr_t)pipe->buf;
+    pipe->buf        = (uint8_t*)pipe->buf + moved;
+    pipe->remaining -= moved;
   }
-  if (len) {
-    *(uint8_t *)addr = reg->u8;
+}
+
+static void dma_release(uint_fast8_t ep_addr)
+{
+  int const ch = dma_find_channel(ep_addr);
+  if (ch >= 0) dma_xfer_stop(ch);
+}
+
+static void dma_release_all(void)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_COUNT; ++ch) {
+    dma_regs(ch)->CTL = 0;
+    _dcd.dma_ep[ch] = 0;
   }
 }
+#endif
+
+static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
+{
+  // FIFO accepts 32-bit accesses followed by 16/8-bit accesses for trailing bytes
+  tu_hwfifo_write(fifo, buf, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+}
+
+static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
+{
+  tu_hwfifo_read(fifo, buf, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+}
 
 static void pipe_read_write_packet_ff(tu_fifo_t *f, volatile void *fifo, unsigned len, unsigned dir)
 {
-  static const struct {
-    void (*tu_fifo_get_info)(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
-    void (*tu_fifo_advance)(tu_fifo_t *f, uint16_t n);
-    void (*pipe_read_write)(void *buf, volatile void *fifo, unsigned len);
-  } ops[] = {
-    /* OUT */ {tu_fifo_get_write_info,tu_fifo_advance_write_pointer,pipe_read_packet},
-    /* IN  */ {tu_fifo_get_read_info, tu_fifo_advance_read_pointer, pipe_write_packet},
-  };
-  tu_fifo_buffer_info_t info;
-  ops[dir].tu_fifo_get_info(f, &info);
-  unsigned total_len = len;
-  len = TU_MIN(total_len, info.len_lin);
-  ops[dir].pipe_read_write(info.ptr_lin, fifo, len);
-  unsigned rem = total_len - len;
-  if (rem) {
-    len = TU_MIN(rem, info.len_wrap);
-    ops[dir].pipe_read_write(info.ptr_wrap, fifo, len);
-    rem -= len;
-  }
-  ops[dir].tu_fifo_advance(f, total_len - rem);
+  if (dir == TUSB_DIR_IN) {
+    tu_hwfifo_write_from_fifo(fifo, f, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+  } else {
+    tu_hwfifo_read_to_fifo(fifo, f, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+  }
 }
 
 static void process_setup_packet(uint8_t rhport)
@@ -309,8 +386,9 @@ static bool handle_xfer_in(uint_fast8_t ep_addr)
   const unsigned rem  = pipe->remaining;
 
   if (!rem) {
+    void *buf = pipe->buf;
     pipe->buf = NULL;
-    return true;
+    return NULL != buf;
   }
 
   volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
@@ -376,8 +454,14 @@ static bool edpt_n_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16
   pipe->remaining    = total_bytes;
 
   if (dir_in) {
+#if CFG_TUD_MUSB_DMA
+    if (dma_xfer_start(ep_addr)) return true;
+#endif
     handle_xfer_in(ep_addr);
   } else {
+#if CFG_TUD_MUSB_DMA
+    dma_xfer_start(ep_addr); /* must be armed before RXRDY is cleared */
+#endif
     volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
     if (regs->RXCSRL & USB_RXCSRL1_RXRDY) regs->RXCSRL = 0;
   }
@@ -544,6 +628,11 @@ static void process_edpt_n(uint8_t rhport, uint_fast8_t ep_addr)
       regs->TXCSRL &= ~(USB_TXCSRL1_STALLED | USB_TXCSRL1_UNDRN);
       return;
     }
+#if CFG_TUD_MUSB_DMA
+    /* Packets are loaded by DMA, or the last one is still waiting to be sent */
+    if (dma_find_channel(ep_addr) >= 0) return;
+    if (regs->TXCSRL & USB_TXCSRL1_TXRDY) return;
+#endif
     completed = handle_xfer_in(ep_addr);
   } else {
     // TU_LOG1(" RXCSRL%d = %x\r\n", epn_minus1 + 1, regs->RXCSRL);
@@ -551,6 +640,11 @@ static void process_edpt_n(uint8_t rhport, uint_fast8_t ep_addr)
       regs->RXCSRL &= ~(USB_RXCSRL1_STALLED | USB_RXCSRL1_OVER);
       return;
     }
+#if CFG_TUD_MUSB_DMA
+    /* A short packet ends the DMA transfer early, the rest is read by PIO */
+    dma_release(ep_addr);
+    if (!(regs->RXCSRL & USB_RXCSRL1_RXRDY)) return;
+#endif
     completed = handle_xfer_out(ep_addr);
   }
 
@@ -562,6 +656,31 @@ static void process_edpt_n(uint8_t rhport, uint_fast8_t ep_addr)
   }
 }
 
+#if CFG_TUD_MUSB_DMA
+static void process_dma(uint8_t rhport, unsigned ch)
+{
+  uint_fast8_t const ep_addr = _dcd.dma_ep[ch];
+  if (!ep_addr) return;
+
+  bool const bus_error = dma_regs(ch)->CTL & USB_DMACTL0_ERR;
+  dma_xfer_stop(ch);
+  if (bus_error) {
+    pipe_state_t *pipe = &_dcd.pipe[tu_edpt_dir(ep_addr)][tu_edpt_number(ep_addr) - 1];
+    pipe->buf = NULL;
+    dcd_event_xfer_complete(rhport, ep_addr, pipe->length - pipe->remaining, XFER_RESULT_FAILED, true);
+    return;
+  }
+
+  /* Continue with PIO: remaining IN packet or the last OUT packet may already be pending */
+  volatile hw_endpoint_t *regs = edpt_regs(tu_edpt_number(ep_addr) - 1);
+  if (tu_edpt_dir(ep_addr)) {
+    if (!(regs->TXCSRL & USB_TXCSRL1_TXRDY)) process_edpt_n(rhport, ep_addr);
+  } else {
+    if (regs->RXCSRL & USB_RXCSRL1_RXRDY) process_edpt_n(rhport, ep_addr);
+  }
+}
+#endif
+
 static void process_bus_reset(uint8_t rhport)
 {
   /* When bmRequestType is REQUEST_TYPE_INVALID(0xFF),
@@ -574,6 +693,10 @@ static void process_bus_reset(uint8_t rhport)
   USB0->TXIE = 1; /* Enable only EP0 */
   USB0->RXIE = 0;
 
+#if CFG_TUD_MUSB_DMA
+  dma_release_all();
+#endif
+
   /* Clear FIFO settings */
   for (unsigned i = 1; i < TUP_DCD_ENDPOINT_MAX; ++i) {
     USB0->EPIDX     = i;
@@ -598,6 +721,26 @@ void dcd_init(uint8_t rhport)
   dcd_connect(rhport);
 }
 
+#if CFG_TUSB_OTG
+// Switch from host mode: end host session and force device mode, clock is kept
+void dcd_role_enter(uint8_t rhport)
+{
+  USB0->DEVCTL &= ~USB_DEVCTL_SESSION;
+  USB0->GPCS    = USB_GPCS_DEVMOD_DEVVBUS;
+
+  /* Drop interrupts of host pipes, status registers are cleared on read */
+  USB0->TXIE = 1; /* Enable only EP0 */
+  USB0->RXIE = 0;
+  USB0->IE   = USB_IE_RESET | USB_IE_RESUME;
+  (void) USB0->IS;
+  (void) USB0->TXIS;
+  (void) USB0->RXIS;
+
+  tu_memclr(&_dcd, sizeof(_dcd));
+  dcd_init(rhport);
+}
+#endif
+
 void dcd_int_enable(uint8_t rhport)
 {
   (void)rhport;
@@ -697,6 +840,14 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
     USB0->RXIE |= TU_BIT(epn);
   }
 
+#if CFG_TUD_MUSB_DMA
+  if (xfer == TUSB_XFER_BULK) {
+    _dcd.pipe_is_bulk[dir_in] |= TU_BIT(epn - 1);
+  } else {
+    _dcd.pipe_is_bulk[dir_in] &= ~TU_BIT(epn - 1);
+  }
+#endif
+
   /* Setup FIFO */
   int size_in_log2_minus3 = 28 - TU_MIN(28, __CLZ((uint32_t)mps));
   if ((8u << size_in_log2_minus3) < mps) ++size_in_log2_minus3;
@@ -723,6 +874,9 @@ void dcd_edpt_close_all(uint8_t rhport)
   NVIC_DisableIRQ(USB0_IRQn);
   USB0->TXIE = 1; /* Enable only EP0 */
   USB0->RXIE = 0;
+#if CFG_TUD_MUSB_DMA
+  dma_release_all();
+#endif
   for (unsigned i = 1; i < TUP_DCD_ENDPOINT_MAX; ++i) {
     regs->TXMAXP = 0;
     regs->TXCSRH = 0;
@@ -756,6 +910,9 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   hw_endpoint_t volatile *regs = edpt_regs(epn - 1);
   unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
   NVIC_DisableIRQ(USB0_IRQn);
+#if CFG_TUD_MUSB_DMA
+  dma_release(ep_addr);
+#endif
   if (dir_in) {
     USB0->TXIE  &= ~TU_BIT(epn);
     regs->TXMAXP = 0;
@@ -833,6 +990,9 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
     }
   } else {
     volatile hw_endpoint_t *regs = edpt_regs(epn - 1);
+#if CFG_TUD_MUSB_DMA
+    dma_release(ep_addr);
+#endif
     if (tu_edpt_dir(ep_addr)) { /* IN */
       regs->TXCSRL = USB_TXCSRL1_STALL;
     } else { /* OUT */
@@ -862,13 +1022,16 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 /*-------------------------------------------------------------------
  * ISR
  *-------------------------------------------------------------------*/
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint_fast8_t is, txis, rxis;
 
   is   = USB0->IS;   /* read and clear interrupt status */
   txis = USB0->TXIS; /* read and clear interrupt status */
   rxis = USB0->RXIS; /* read and clear interrupt status */
+#if CFG_TUD_MUSB_DMA
+  uint_fast8_t dmais = dma_int_status();
+#endif
   // TU_LOG1("D%2x T%2x R%2x\r\n", is, txis, rxis);
 
   is &= USB0->IE; /* Clear disabled interrupts */
@@ -887,6 +1050,14 @@ void dcd_int_handler(uint8_t rhport)
     dcd_event_bus_signal(rhport, DCD_EVENT_SUSPEND, true);
   }
 
+#if CFG_TUD_MUSB_DMA
+  while (dmais) {
+    unsigned const ch = __builtin_ctz(dmais);
+    process_dma(rhport, ch);
+    dmais &= ~TU_BIT(ch);
+  }
+#endif
+
   txis &= USB0->TXIE; /* Clear disabled interrupts */
   if (txis & USB_TXIE_EP0) {
     process_ep0(rhport);
@@ -55,6 +55,16 @@ _Pragma("GCC diagnostic ignored \"-Waddress-of-packed-member\"");
 # define HCD_ATTR_ENDPOINT_MAX 8
 #endif
 
+// Use the integrated DMA controller (DMA request mode 1) for multi-packet bulk transfers.
+// Buffer must be 4-byte aligned and transfer spans at least 2 packets, otherwise PIO is used.
+#ifndef CFG_TUH_MUSB_DMA
+  #define CFG_TUH_MUSB_DMA  0
+#endif
+
+#if CFG_TUH_MUSB_DMA && !TU_CHECK_MCU(OPT_MCU_MSP432E4, OPT_MCU_TM4C129)
+  #error "CFG_TUH_MUSB_DMA requires the integrated USB DMA controller (MSP432E4, TM4C129)"
+#endif
+
 /*------------------------------------------------------------------
  * MACRO TYPEDEF CONSTANT ENUM DECLARATION
  *------------------------------------------------------------------*/
@@ -91,12 +101,6 @@ typedef struct TU_ATTR_PACKED {
   uint16_t RESERVED;
 } hw_endpoint_t;
 
-typedef union {
-  uint8_t   u8;
-  uint16_t  u16;
-  uint32_t  u32;
-} hw_fifo_t;
-
 typedef struct TU_ATTR_PACKED
 {
   void      *buf;      /* the start address of a transfer data buffer */
@@ -110,6 +114,18 @@ typedef struct TU_ATTR_PACKED
   uint8_t ep;
 } pipe_addr_t;
 
+#if CFG_TUH_MUSB_DMA
+#define DMA_CHANNEL_COUNT  8
+#define DMA_PIPE_TX        0x80u
+
+typedef struct {
+  uint32_t CTL;
+  uint32_t ADDR;
+  uint32_t COUNT;
+  uint32_t RESERVED;
+} hw_dma_channel_t;
+#endif
+
 typedef struct
 {
   bool         need_reset;     /* The device has not been reset after connection. */
@@ -118,6 +134,10 @@ typedef struct
   pipe_state_t pipe0;
   pipe_state_t pipe[7][2];   /* pipe[pipe number - 1][direction 0:RX 1:TX] */
   pipe_addr_t  addr[7][2];   /* addr[pipe number - 1][direction 0:RX 1:TX] */
+#if CFG_TUH_MUSB_DMA
+  uint8_t      pipe_is_bulk[2]; /* Bitmap. pipe_is_bulk[direction 0:RX 1:TX], bit means pipe number - 1 */
+  uint8_t      dma_pipe[DMA_CHANNEL_COUNT]; /* Pipe number | DMA_PIPE_TX served by each DMA channel, 0 if free. */
+#endif
 } hcd_data_t;
 
 /*------------------------------------------------------------------
@@ -240,44 +260,104 @@ static unsigned find_pipe(uint_fast8_t dev_addr, uint_fast8_t ep_addr)
   return 0;
 }
 
-static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
+#if CFG_TUH_MUSB_DMA
+/* DMA registers are located at offset 0x200: DMAINTR followed by 8 channels of CTL, ADDR and COUNT */
+static inline volatile hw_dma_channel_t* dma_regs(unsigned ch)
 {
-  volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    reg->u32 = *(uint32_t const *)addr;
-    addr += 4;
-    len  -= 4;
-  }
-  if (len >= 2) {
-    reg->u16 = *(uint16_t const *)addr;
-    addr += 2;
-    len  -= 2;
-  }
-  if (len) {
-    reg->u8 = *(uint8_t const *)addr;
+  return (volatile hw_dma_channel_t*)((uintptr_t)USB0 + 0x204) + ch;
+}
+
+static inline uint_fast8_t dma_int_status(void)
+{
+  return *(volatile uint8_t*)((uintptr_t)USB0 + 0x200); /* read and clear interrupt status */
+}
+
+static int dma_find_channel(uint_fast8_t id)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_COUNT; ++ch) {
+    if (_hcd.dma_pipe[ch] == id) return (int)ch;
   }
+  return -1;
 }
 
-static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
+/* Move whole packets of the pipe with DMA request mode 1: AUTOSET/AUTOCL+AUTORQ let the core set TXRDY,
+ * or clear RXRDY and request the next packet, and only the end of the DMA transfer raises an interrupt.
+ * The remainder is left to PIO, RX always leaves the last packet to PIO. */
+static bool dma_xfer_start(uint_fast8_t pipenum, unsigned dir_tx)
 {
-  volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    *(uint32_t *)addr = reg->u32;
-    addr += 4;
-    len  -= 4;
+  if (!(_hcd.pipe_is_bulk[dir_tx] & TU_BIT(pipenum - 1))) return false;
+
+  pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
+  if ((uintptr_t)pipe->buf & 3) return false;
+
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
+  unsigned const mps = dir_tx ? regs->TXMAXP : regs->RXMAXP;
+  unsigned const rem = pipe->remaining;
+  if ((mps & 3) || (rem < 2 * mps)) return false;
+
+  unsigned const len = dir_tx ? (rem / mps) * mps : ((rem - 1) / mps) * mps;
+  if (len < 2 * mps) return false;
+
+  int const ch = dma_find_channel(0);
+  if (ch < 0) return false; /* all channels are busy, fall back to PIO */
+  _hcd.dma_pipe[ch] = pipenum | (dir_tx ? DMA_PIPE_TX : 0);
+
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->ADDR  = (uint32_t)(uintptr_t)pipe->buf;
+  dma->COUNT = len;
+  if (dir_tx) {
+    regs->TXCSRH |= USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN | USB_TXCSRH1_DMAMOD;
+    dma->CTL = (pipenum << USB_DMACTL0_EP_S) | USB_DMACTL0_IE | USB_DMACTL0_MODE | USB_DMACTL0_DIR | USB_DMACTL0_ENABLE;
+  } else {
+    regs->RXCSRH |= USB_RXCSRH1_AUTOCL | USB_RXCSRH1_AUTORQ | USB_RXCSRH1_DMAEN | USB_RXCSRH1_DMAMOD;
+    dma->CTL = (pipenum << USB_DMACTL0_EP_S) | USB_DMACTL0_IE | USB_DMACTL0_MODE | USB_DMACTL0_ENABLE;
   }
-  if (len >= 2) {
-    *(uint16_t *)addr = reg->u16;
-    addr += 2;
-    len  -= 2;
+  return true;
+}
+
+/* Stop DMA of the pipe and account the bytes it has moved, also used to abort */
+static void dma_xfer_stop(unsigned ch)
+{
+  unsigned const pipenum = _hcd.dma_pipe[ch] & ~DMA_PIPE_TX;
+  unsigned const dir_tx  = (_hcd.dma_pipe[ch] & DMA_PIPE_TX) ? 1 : 0;
+  pipe_state_t  *pipe    = &_hcd.pipe[pipenum - 1][dir_tx];
+
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->CTL = 0;
+  _hcd.dma_pipe[ch] = 0;
+
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
+  if (dir_tx) {
+    regs->TXCSRH &= ~(USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN | USB_TXCSRH1_DMAMOD);
+  } else {
+    regs->RXCSRH &= ~(USB_RXCSRH1_AUTOCL | USB_RXCSRH1_AUTORQ | USB_RXCSRH1_DMAEN | USB_RXCSRH1_DMAMOD);
   }
-  if (len) {
-    *(uint8_t *)addr = reg->u8;
+
+  if (pipe->buf) {
+    unsigned const moved = dma->ADDR - (uint32_t)(uintptr_t)pipe->buf;
+    pipe->buf        = (uint8_t*)pipe->buf + moved;
+    pipe->remaining -= moved;
   }
 }
 
+static void dma_release(uint_fast8_t pipenum, unsigned dir_tx)
+{
+  int const ch = dma_find_channel(pipenum | (dir_tx ? DMA_PIPE_TX : 0));
+  if (ch >= 0) dma_xfer_stop(ch);
+}
+#endif
+
+static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
+{
+  // FIFO accepts 32-bit accesses followed by 16/8-bit accesses for trailing bytes
+  tu_hwfifo_write(fifo, buf, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+}
+
+static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
+{
+  tu_hwfifo_read(fifo, buf, (uint16_t) len, TU_HWFIFO_REG32_NARROW);
+}
+
 static bool edpt0_xfer_out(void)
 {
   pipe_state_t *pipe = &_hcd.pipe0;
@@ -354,8 +434,9 @@ static bool pipe_xfer_out(uint_fast8_t pipenum)
   pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][1];
   unsigned const rem = pipe->remaining;
   if (!rem) {
+    void *buf = pipe->buf;
     pipe->buf = NULL;
-    return true;
+    return NULL != buf;
   }
   hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
   unsigned const mps = regs->TXMAXP;
@@ -405,8 +486,14 @@ static bool edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t
   pipe->length       = buflen;
   pipe->remaining    = buflen;
   if (dir_tx) {
+#if CFG_TUH_MUSB_DMA
+    if (dma_xfer_start(pipenum, dir_tx)) return true;
+#endif
     pipe_xfer_out(pipenum);
   } else {
+#if CFG_TUH_MUSB_DMA
+    dma_xfer_start(pipenum, dir_tx);
+#endif
     volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
     regs->RXCSRL = USB_RXCSRL1_REQPKT;
   }
@@ -510,6 +597,9 @@ static void process_pipe_tx(uint8_t rhport, uint_fast8_t pipenum)
   unsigned const csrl = regs->TXCSRL;
   // TU_LOG1(" TXCSRL%d = %x\r\n", pipenum, csrl);
   if (csrl & (USB_TXCSRL1_STALLED | USB_TXCSRL1_ERROR)) {
+#if CFG_TUH_MUSB_DMA
+    dma_release(pipenum, 1);
+#endif
     if (csrl & USB_TXCSRL1_TXRDY)
       regs->TXCSRL = (csrl & ~(USB_TXCSRL1_STALLED | USB_TXCSRL1_ERROR)) | USB_TXCSRL1_FLUSH;
     else
@@ -517,6 +607,11 @@ static void process_pipe_tx(uint8_t rhport, uint_fast8_t pipenum)
     completed = true;
     result    = (csrl & USB_TXCSRL1_STALLED) ? XFER_RESULT_STALLED: XFER_RESULT_FAILED;
   } else {
+#if CFG_TUH_MUSB_DMA
+    /* Packets are loaded by DMA, or the last one is still waiting to be sent */
+    if (dma_find_channel(pipenum | DMA_PIPE_TX) >= 0) return;
+    if (csrl & USB_TXCSRL1_TXRDY) return;
+#endif
     completed = pipe_xfer_out(pipenum);
     result    = XFER_RESULT_SUCCESS;
   }
@@ -536,6 +631,10 @@ static void process_pipe_rx(uint8_t rhport, uint_fast8_t pipenum)
   uint8_t result;
 
   volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
+#if CFG_TUH_MUSB_DMA
+  /* A short packet or an error ends the DMA transfer early, the rest is read by PIO */
+  dma_release(pipenum, 0);
+#endif
   unsigned const csrl = regs->RXCSRL;
   // TU_LOG1(" RXCSRL%d = %x\r\n", pipenum, csrl);
   if (csrl & (USB_RXCSRL1_STALLED | USB_RXCSRL1_ERROR)) {
@@ -546,6 +645,9 @@ static void process_pipe_rx(uint8_t rhport, uint_fast8_t pipenum)
     completed = true;
     result    = (csrl & USB_RXCSRL1_STALLED) ? XFER_RESULT_STALLED: XFER_RESULT_FAILED;
   } else {
+#if CFG_TUH_MUSB_DMA
+    if (!(csrl & USB_RXCSRL1_RXRDY)) return;
+#endif
     completed = pipe_xfer_in(pipenum);
     result    = XFER_RESULT_SUCCESS;
   }
@@ -558,6 +660,39 @@ static void process_pipe_rx(uint8_t rhport, uint_fast8_t pipenum)
   }
 }
 
+#if CFG_TUH_MUSB_DMA
+static void process_dma(uint8_t rhport, unsigned ch)
+{
+  uint_fast8_t const id = _hcd.dma_pipe[ch];
+  if (!id) return;
+
+  unsigned const pipenum = id & ~DMA_PIPE_TX;
+  unsigned const dir_tx  = (id & DMA_PIPE_TX) ? 1 : 0;
+  bool const bus_error   = dma_regs(ch)->CTL & USB_DMACTL0_ERR;
+  dma_xfer_stop(ch);
+  if (bus_error) {
+    pipe_addr_t  *addr = &_hcd.addr[pipenum - 1][dir_tx];
+    pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
+    pipe->buf = NULL;
+    hcd_event_xfer_complete(addr->dev, addr->ep, pipe->length - pipe->remaining, XFER_RESULT_FAILED, true);
+    return;
+  }
+
+  /* Continue with PIO: remaining TX packet or the last RX packet may already be pending */
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
+  if (dir_tx) {
+    if (!(regs->TXCSRL & USB_TXCSRL1_TXRDY)) process_pipe_tx(rhport, pipenum);
+  } else {
+    unsigned const csrl = regs->RXCSRL;
+    if (csrl & USB_RXCSRL1_RXRDY) {
+      process_pipe_rx(rhport, pipenum);
+    } else if (!(csrl & USB_RXCSRL1_REQPKT)) {
+      regs->RXCSRL = USB_RXCSRL1_REQPKT;
+    }
+  }
+}
+#endif
+
 /*------------------------------------------------------------------
  * Host API
  *------------------------------------------------------------------*/
@@ -573,6 +708,24 @@ bool hcd_init(uint8_t rhport)
   return true;
 }
 
+#if CFG_TUSB_OTG
+// Switch from device mode: force host mode with VBUS and start a new session, clock is kept
+bool hcd_role_enter(uint8_t rhport)
+{
+  USB0->GPCS = USB_GPCS_DEVMOD_HOSTVBUS;
+
+  /* Drop interrupts of device endpoints, status registers are cleared on read */
+  USB0->TXIE = 1; /* Enable only EP0 */
+  USB0->RXIE = 0;
+  (void) USB0->IS;
+  (void) USB0->TXIS;
+  (void) USB0->RXIS;
+
+  tu_memclr(&_hcd, sizeof(_hcd));
+  return hcd_init(rhport);
+}
+#endif
+
 void hcd_int_enable(uint8_t rhport)
 {
   (void)rhport;
@@ -646,6 +799,9 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
   for (unsigned i = 0; i < sizeof(_hcd.addr)/sizeof(_hcd.addr[0]); ++i) {
     for (unsigned j = 0; j < 2; ++j, ++p) {
       if (dev_addr != p->dev) continue;
+#if CFG_TUH_MUSB_DMA
+      dma_release(i + 1, j);
+#endif
       hw_addr_t volatile     *fadr = (hw_addr_t volatile*)&USB0->TXFUNCADDR0 + i + 1;
       hw_endpoint_t volatile *regs = edpt_regs(i);
       USB0->EPIDX = i + 1;
@@ -793,6 +949,14 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     USB0->RXIE |= TU_BIT(pipenum);
   }
 
+#if CFG_TUH_MUSB_DMA
+  if (xfer == TUSB_XFER_BULK) {
+    _hcd.pipe_is_bulk[dir_tx] |= TU_BIT(pipenum - 1);
+  } else {
+    _hcd.pipe_is_bulk[dir_tx] &= ~TU_BIT(pipenum - 1);
+  }
+#endif
+
   /* Setup FIFO */
   int size_in_log2_minus3 = 28 - TU_MIN(28, __CLZ((uint32_t)mps));
   if ((8u << size_in_log2_minus3) < mps) ++size_in_log2_minus3;
@@ -847,7 +1011,7 @@ bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 /*-------------------------------------------------------------------
  * ISR
  *-------------------------------------------------------------------*/
-void hcd_int_handler(uint8_t rhport, bool in_isr)
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr)
 {
   (void) in_isr;
 
@@ -856,6 +1020,9 @@ void hcd_int_handler(uint8_t rhport, bool in_isr)
   is   = USB0->IS;   /* read and clear interrupt status */
   txis = USB0->TXIS; /* read and clear interrupt status */
   rxis = USB0->RXIS; /* read and clear interrupt status */
+#if CFG_TUH_MUSB_DMA
+  uint_fast8_t dmais = dma_int_status();
+#endif
   // TU_LOG1("D%2x T%2x R%2x\r\n", is, txis, rxis);
 
   is &= USB0->IE; /* Clear disabled interrupts */
@@ -870,6 +1037,13 @@ void hcd_int_handler(uint8_t rhport, bool in_isr)
   }
   if (is & USB_IS_BABBLE) {
   }
+#if CFG_TUH_MUSB_DMA
+  while (dmais) {
+    unsigned const ch = __builtin_ctz(dmais);
+    process_dma(rhport, ch);
+    dmais &= ~TU_BIT(ch);
+  }
+#endif
   txis &= USB0->TXIE; /* Clear disabled interrupts */
   if (txis & USB_TXIE_EP0) {
     process_ep0(rhport);
@@ -696,7 +696,7 @@ static void ep0_handle_int(void)
   USB_REGS->INDEXbits.ENDPOINT = old_index;
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   int i;
   uint8_t mask;
@@ -37,8 +37,31 @@
 /*------------------------------------------------------------------*/
 /* MACRO TYPEDEF CONSTANT ENUM
  *------------------------------------------------------------------*/
+
+// Use both banks for a bulk IN endpoint whose OUT direction is not opened (ping-pong), so that
+// the next chunk of a large transfer is already armed when the current one completes
+#ifndef CFG_TUD_SAMD_DUAL_BANK
+  #define CFG_TUD_SAMD_DUAL_BANK  0
+#endif
+
+// BYTE_COUNT and MULTI_PACKET_SIZE are 14-bit, larger transfers are queued in chunks
+#define XFER_CHUNK_MAX  0x3FFFu
+
 static TU_ATTR_ALIGNED(4) UsbDeviceDescBank sram_registers[8][2];
 
+// Transfer control for endpoint 1-7
+typedef struct {
+  uint8_t* buffer;
+  uint16_t total_len;
+  uint16_t queued_len;
+  uint16_t actual_len;
+  uint16_t chunk_max;  // multiple of packet size
+  uint8_t  dual_bank;
+  uint8_t  bank;       // next bank to complete
+} xfer_ctl_t;
+
+static xfer_ctl_t _xfer[8][2];
+
 // Setup packet is only 8 bytes in length. However under certain scenario,
 // USB DMA controller may decide to overwrite/overflow the buffer  with
 // 2 extra bytes of CRC. From datasheet's "Management of SETUP Transactions" section
@@ -235,9 +258,16 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * desc_edpt)
 
   UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
 
+  xfer_ctl_t* xfer = &_xfer[epnum][dir];
+  uint16_t const mps = tu_edpt_packet_size(desc_edpt);
+  tu_varclr(xfer);
+  xfer->chunk_max = mps ? (uint16_t) ((XFER_CHUNK_MAX / mps) * mps) : XFER_CHUNK_MAX;
+
   if ( dir == TUSB_DIR_OUT )
   {
+    // OUT shares bank0 with a dual bank IN endpoint, which falls back to single bank
     ep->EPCFG.bit.EPTYPE0 = desc_edpt->bmAttributes.xfer + 1;
+    _xfer[epnum][TUSB_DIR_IN].dual_bank = 0;
     ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_STALLRQ0 | USB_DEVICE_EPSTATUSCLR_DTGLOUT; // clear stall & dtoggle
     ep->EPINTENSET.bit.TRCPT0 = true;
   }else
@@ -245,6 +275,18 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * desc_edpt)
     ep->EPCFG.bit.EPTYPE1 = desc_edpt->bmAttributes.xfer + 1;
     ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_STALLRQ1 | USB_DEVICE_EPSTATUSCLR_DTGLIN; // clear stall & dtoggle
     ep->EPINTENSET.bit.TRCPT1 = true;
+
+#if CFG_TUD_SAMD_DUAL_BANK
+    if ( epnum && desc_edpt->bmAttributes.xfer == TUSB_XFER_BULK && ep->EPCFG.bit.EPTYPE0 == 0 )
+    {
+      // EPTYPE0 = 5: bank0 is also used by IN endpoint, starting with bank0
+      sram_registers[epnum][0].PCKSIZE.bit.SIZE = size_value;
+      ep->EPCFG.bit.EPTYPE0 = 0x5;
+      ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_CURBK | USB_DEVICE_EPSTATUSCLR_BK0RDY | USB_DEVICE_EPSTATUSCLR_BK1RDY;
+      ep->EPINTENSET.bit.TRCPT0 = true;
+      xfer->dual_bank = 1;
+    }
+#endif
   }
 
   return true;
@@ -263,6 +305,32 @@ void dcd_edpt_close_all (uint8_t rhport)
   // TODO implement dcd_edpt_close_all()
 }
 
+// Arm a bank with the next chunk of the transfer
+static void xfer_queue_chunk(uint8_t epnum, uint8_t dir, uint8_t bank_ix)
+{
+  xfer_ctl_t* xfer = &_xfer[epnum][dir];
+  UsbDeviceDescBank* bank = &sram_registers[epnum][bank_ix];
+  UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
+  uint16_t const len = tu_min16((uint16_t) (xfer->total_len - xfer->queued_len), xfer->chunk_max);
+
+  bank->ADDR.reg = (uint32_t) (xfer->buffer + xfer->queued_len);
+  xfer->queued_len += len;
+
+  if ( dir == TUSB_DIR_OUT )
+  {
+    bank->PCKSIZE.bit.MULTI_PACKET_SIZE = len;
+    bank->PCKSIZE.bit.BYTE_COUNT = 0;
+    ep->EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRFAIL0;
+    ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_BK0RDY;
+  } else
+  {
+    bank->PCKSIZE.bit.MULTI_PACKET_SIZE = 0;
+    bank->PCKSIZE.bit.BYTE_COUNT = len;
+    ep->EPINTFLAG.reg = bank_ix ? USB_DEVICE_EPINTFLAG_TRFAIL1 : USB_DEVICE_EPINTFLAG_TRFAIL0;
+    ep->EPSTATUSSET.reg = bank_ix ? USB_DEVICE_EPSTATUSSET_BK1RDY : USB_DEVICE_EPSTATUSSET_BK0RDY;
+  }
+}
+
 bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
 {
   (void) rhport;
@@ -270,6 +338,30 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
+  if ( epnum )
+  {
+    xfer_ctl_t* xfer = &_xfer[epnum][dir];
+    xfer->buffer     = buffer;
+    xfer->total_len  = total_bytes;
+    xfer->queued_len = 0;
+    xfer->actual_len = 0;
+
+    if ( dir == TUSB_DIR_OUT )
+    {
+      xfer_queue_chunk(epnum, dir, 0);
+    } else if ( xfer->dual_bank )
+    {
+      // hardware continues with the bank after the last completed one
+      xfer_queue_chunk(epnum, dir, xfer->bank);
+      if ( xfer->queued_len < xfer->total_len ) xfer_queue_chunk(epnum, dir, xfer->bank ^ 1);
+    } else
+    {
+      xfer_queue_chunk(epnum, dir, 1);
+    }
+
+    return true;
+  }
+
   UsbDeviceDescBank* bank = &sram_registers[epnum][dir];
   UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
 
@@ -330,6 +422,28 @@ void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
 //--------------------------------------------------------------------+
 // Interrupt Handler
 //--------------------------------------------------------------------+
+
+// A bank of endpoint 1-7 has completed, queue next chunk or complete the transfer
+static void xfer_bank_complete(uint8_t epnum, uint8_t dir, uint8_t bank_ix)
+{
+  xfer_ctl_t* xfer = &_xfer[epnum][dir];
+  UsbDeviceDescBank* bank = &sram_registers[epnum][bank_ix];
+  uint16_t const count = bank->PCKSIZE.bit.BYTE_COUNT;
+
+  xfer->actual_len += count;
+
+  // OUT transfer also ends with a short packet
+  bool const short_packet = (dir == TUSB_DIR_OUT) && (count < bank->PCKSIZE.bit.MULTI_PACKET_SIZE);
+
+  if ( short_packet || xfer->actual_len >= xfer->total_len )
+  {
+    dcd_event_xfer_complete(0, tu_edpt_addr(epnum, dir), xfer->actual_len, XFER_RESULT_SUCCESS, true);
+  } else if ( xfer->queued_len < xfer->total_len )
+  {
+    xfer_queue_chunk(epnum, dir, bank_ix);
+  }
+}
+
 void maybe_transfer_complete(void) {
   uint32_t epints = USB->DEVICE.EPINTSMRY.reg;
 
@@ -341,6 +455,40 @@ void maybe_transfer_complete(void) {
     UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
     uint32_t epintflag = ep->EPINTFLAG.reg;
 
+    if ( epnum )
+    {
+      xfer_ctl_t* xfer_in = &_xfer[epnum][TUSB_DIR_IN];
+
+      if ( xfer_in->dual_bank )
+      {
+        // banks complete in order, both may be pending
+        uint8_t const trcpt[2] = { USB_DEVICE_EPINTFLAG_TRCPT0, USB_DEVICE_EPINTFLAG_TRCPT1 };
+        while ( epintflag & trcpt[xfer_in->bank] )
+        {
+          uint8_t const bank_ix = xfer_in->bank;
+          ep->EPINTFLAG.reg = trcpt[bank_ix];
+          epintflag &= ~trcpt[bank_ix];
+          xfer_in->bank ^= 1;
+          xfer_bank_complete(epnum, TUSB_DIR_IN, bank_ix);
+        }
+        continue;
+      }
+
+      if ( epintflag & USB_DEVICE_EPINTFLAG_TRCPT1 )
+      {
+        ep->EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT1;
+        xfer_bank_complete(epnum, TUSB_DIR_IN, 1);
+      }
+
+      if ( epintflag & USB_DEVICE_EPINTFLAG_TRCPT0 )
+      {
+        ep->EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT0;
+        xfer_bank_complete(epnum, TUSB_DIR_OUT, 0);
+      }
+
+      continue;
+    }
+
     // Handle IN completions
     if ((epintflag & USB_DEVICE_EPINTFLAG_TRCPT1) != 0) {
       UsbDeviceDescBank* bank = &sram_registers[epnum][TUSB_DIR_IN];
@@ -364,7 +512,7 @@ void maybe_transfer_complete(void) {
 }
 
 
-void dcd_int_handler (uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler (uint8_t rhport)
 {
   (void) rhport;
 
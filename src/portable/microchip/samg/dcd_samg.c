@@ -43,7 +43,7 @@
 typedef struct
 {
   uint8_t* buffer;
-  // tu_fifo_t* ff; // TODO support dcd_edpt_xfer_fifo API
+  tu_fifo_t* ff;
   uint16_t total_len;
   volatile uint16_t actual_len;
   uint16_t  epsize;
@@ -60,7 +60,7 @@ void xfer_epsize_set(xfer_desc_t* xfer, uint16_t epsize)
 void xfer_begin(xfer_desc_t* xfer, uint8_t * buffer, uint16_t total_bytes)
 {
   xfer->buffer     = buffer;
-  // xfer->ff         = NULL; // TODO support dcd_edpt_xfer_fifo API
+  xfer->ff         = NULL;
   xfer->total_len  = total_bytes;
   xfer->actual_len = 0;
 }
@@ -68,7 +68,7 @@ void xfer_begin(xfer_desc_t* xfer, uint8_t * buffer, uint16_t total_bytes)
 void xfer_end(xfer_desc_t* xfer)
 {
   xfer->buffer     = NULL;
-  // xfer->ff         = NULL; // TODO support dcd_edpt_xfer_fifo API
+  xfer->ff         = NULL;
   xfer->total_len  = 0;
   xfer->actual_len = 0;
 }
@@ -83,31 +83,40 @@ void xfer_packet_done(xfer_desc_t* xfer)
 {
   uint16_t const xact_len = xfer_packet_len(xfer);
 
-  xfer->buffer += xact_len;
+  if (!xfer->ff) xfer->buffer += xact_len;
   xfer->actual_len += xact_len;
 }
 
 //------------- Transaction helpers -------------//
 
-// Write data to EP FIFO, return number of written bytes
-static void xact_ep_write(uint8_t epnum, uint8_t* buffer, uint16_t xact_len)
+// Write data to EP FIFO, UDP_FDR is a byte data register
+static void xact_ep_write(uint8_t epnum, xfer_desc_t* xfer, uint16_t xact_len)
 {
-  for(uint16_t i=0; i<xact_len; i++)
+  if (xfer->ff)
   {
-    UDP->UDP_FDR[epnum] = (uint32_t) buffer[i];
+    tu_hwfifo_write_from_fifo(&UDP->UDP_FDR[epnum], xfer->ff, xact_len, TU_HWFIFO_REG8);
+  }
+  else
+  {
+    tu_hwfifo_write(&UDP->UDP_FDR[epnum], xfer->buffer, xact_len, TU_HWFIFO_REG8);
   }
 }
 
 // Read data from EP FIFO
-static void xact_ep_read(uint8_t epnum, uint8_t* buffer, uint16_t xact_len)
+static void xact_ep_read(uint8_t epnum, xfer_desc_t* xfer, uint16_t xact_len)
 {
-  for(uint16_t i=0; i<xact_len; i++)
+  if (xfer->ff)
+  {
+    tu_hwfifo_read_to_fifo(&UDP->UDP_FDR[epnum], xfer->ff, xact_len, TU_HWFIFO_REG8);
+  }
+  else
   {
-    buffer[i] = (uint8_t) UDP->UDP_FDR[epnum];
+    tu_hwfifo_read(&UDP->UDP_FDR[epnum], xfer->buffer, xact_len, TU_HWFIFO_REG8);
   }
 }
 
 
+
 //! Bitmap for all status bits in CSR that are not affected by a value 1.
 #define CSR_NO_EFFECT_1_ALL (UDP_CSR_RX_DATA_BK0 | UDP_CSR_RX_DATA_BK1 | UDP_CSR_STALLSENT | UDP_CSR_RXSETUP | UDP_CSR_TXCOMP)
 
@@ -133,6 +142,22 @@ static inline void csr_clear(uint8_t epnum, uint32_t mask)
   csr_write(epnum, (UDP->UDP_CSR[epnum] | CSR_NO_EFFECT_1_ALL) & ~mask);
 }
 
+static void xfer_start(uint8_t epnum, uint8_t dir, xfer_desc_t* xfer)
+{
+  if (dir == TUSB_DIR_OUT)
+  {
+    // Enable interrupt when starting OUT transfer
+    if (epnum != 0) UDP->UDP_IER |= (1 << epnum);
+  }
+  else
+  {
+    xact_ep_write(epnum, xfer, xfer_packet_len(xfer));
+
+    // TX ready for transfer
+    csr_set(epnum, UDP_CSR_TXPKTRDY_Msk);
+  }
+}
+
 /*------------------------------------------------------------------*/
 /* Device API
  *------------------------------------------------------------------*/
@@ -294,29 +319,27 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   xfer_desc_t* xfer = &_dcd_xfer[epnum];
   xfer_begin(xfer, buffer, total_bytes);
 
-  if (dir == TUSB_DIR_OUT)
-  {
-    // Enable interrupt when starting OUT transfer
-    if (epnum != 0) UDP->UDP_IER |= (1 << epnum);
-  }
-  else
-  {
-    xact_ep_write(epnum, xfer->buffer, xfer_packet_len(xfer));
-
-    // TX ready for transfer
-    csr_set(epnum, UDP_CSR_TXPKTRDY_Msk);
-  }
+  xfer_start(epnum, dir, xfer);
 
   return true;
 }
 
-#if 0 // TODO support dcd_edpt_xfer_fifo API
+// Submit a transfer where is read/write from/to fifo
 bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
 {
   (void) rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  xfer_desc_t* xfer = &_dcd_xfer[epnum];
+  xfer_begin(xfer, NULL, total_bytes);
+  xfer->ff = ff;
+
+  xfer_start(epnum, dir, xfer);
+
   return true;
 }
-#endif
 
 // Stall endpoint
 void dcd_edpt_stall (uint8_t rhport, uint8_t ep_addr)
@@ -351,7 +374,7 @@ void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
 //--------------------------------------------------------------------+
 // ISR
 //--------------------------------------------------------------------+
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint32_t const intr_mask   = UDP->UDP_IMR;
   uint32_t const intr_status = UDP->UDP_ISR & intr_mask;
@@ -427,16 +450,7 @@ void dcd_int_handler(uint8_t rhport)
         if (xact_len)
         {
           // write to EP fifo
-#if 0 // TODO support dcd_edpt_xfer_fifo
-          if (xfer->ff)
-          {
-            tu_fifo_read_n_const_addr_full_words(xfer->ff, (void *) &UDP->UDP_FDR[epnum], xact_len);
-          }
-          else
-#endif
-          {
-            xact_ep_write(epnum, xfer->buffer, xact_len);
-          }
+          xact_ep_write(epnum, xfer, xact_len);
 
           // TX ready for transfer
           csr_set(epnum, UDP_CSR_TXPKTRDY_Msk);
@@ -462,16 +476,7 @@ void dcd_int_handler(uint8_t rhport)
         uint16_t const xact_len = (uint16_t) ((UDP->UDP_CSR[epnum] & UDP_CSR_RXBYTECNT_Msk) >> UDP_CSR_RXBYTECNT_Pos);
 
         // Read from EP fifo
-#if 0 // TODO support dcd_edpt_xfer_fifo API
-        if (xfer->ff)
-        {
-          tu_fifo_write_n_const_addr_full_words(xfer->ff, (const void *) &UDP->UDP_FDR[epnum], xact_len);
-        }
-        else
-#endif
-        {
-          xact_ep_read(epnum, xfer->buffer, xact_len);
-        }
+        xact_ep_read(epnum, xfer, xact_len);
 
         xfer_packet_done(xfer);
 
@@ -43,16 +43,15 @@
 #endif
 
 // Dual bank can improve performance, but need 2 times bigger packet buffer
-// As SAM7x has only 4KB packet buffer, use with caution !
-// Enable in FS mode as packets are smaller
+// As SAM7x has only 4KB packet buffer, an endpoint falls back to single bank
+// when the remaining DPRAM is not enough for 2 banks
 #ifndef USE_DUAL_BANK
-#  if TUD_OPT_HIGH_SPEED
-#    define USE_DUAL_BANK   0
-#  else
-#    define USE_DUAL_BANK   1
-#  endif
+#  define USE_DUAL_BANK   1
 #endif
 
+// Endpoint banks are allocated from DPRAM in endpoint order
+#define EP_DPRAM_SIZE     4096
+
 #define EP_GET_FIFO_PTR(ep, scale) (((TU_XSTRCAT(TU_STRCAT(uint, scale),_t) (*)[0x8000 / ((scale) / 8)])FIFO_RAM_ADDR)[(ep)])
 
 // DMA Channel Transfer Descriptor
@@ -81,6 +80,9 @@ CFG_TUD_MEM_SECTION static dma_desc_t dma_desc[6];
 
 static xfer_ctl_t xfer_status[EP_MAX];
 
+// DPRAM bytes allocated to each endpoint
+static uint16_t ep_dpram_size[EP_MAX];
+
 static const tusb_desc_endpoint_t ep0_desc =
 {
   .bEndpointAddress = 0x00,
@@ -99,6 +101,14 @@ TU_ATTR_ALWAYS_INLINE static inline void CleanInValidateCache(uint32_t *addr, in
     __ISB();
   }
 }
+
+TU_ATTR_ALWAYS_INLINE static inline void InValidateCache(uint32_t *addr, int32_t size)
+{
+  if (SCB->CCR & SCB_CCR_DC_Msk)
+  {
+    SCB_InvalidateDCache_by_Addr(addr, size);
+  }
+}
 //------------------------------------------------------------------
 // Device API
 //------------------------------------------------------------------
@@ -361,11 +371,13 @@ static void dcd_dma_handler(uint8_t ep_ix)
     dcd_event_xfer_complete(0, 0x80 + ep_ix, count, XFER_RESULT_SUCCESS, true);
   } else
   {
+    // Drop lines speculatively fetched while DMA was writing the buffer
+    if (xfer->buffer && count) InValidateCache((uint32_t*) tu_align((uint32_t) xfer->buffer, 4), count + 31);
     dcd_event_xfer_complete(0, ep_ix, count, XFER_RESULT_SUCCESS, true);
   }
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void) rhport;
   uint32_t int_status = USB_REG->DEVISR;
@@ -483,6 +495,32 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
   }
   xfer_status[epnum].max_packet_size = epMaxPktSize;
 
+  // High bandwidth isochronous needs one bank per transaction of a microframe
+  uint8_t nbtrans = 1;
+  if (eptype == TUSB_XFER_ISOCHRONOUS && get_speed() == TUSB_SPEED_HIGH)
+  {
+    nbtrans = (uint8_t) (1u + ((tu_le16toh(ep_desc->wMaxPacketSize) >> 11) & 0x3u));
+  }
+  uint8_t banks = nbtrans;
+#if USE_DUAL_BANK
+  if ((eptype == TUSB_XFER_ISOCHRONOUS || eptype == TUSB_XFER_BULK) && banks < 2)
+  {
+    banks = 2;
+  }
+#endif
+
+  uint32_t dpram_used = 0;
+  for (uint8_t i = 0; i < EP_MAX; i++)
+  {
+    if (i != epnum) dpram_used += ep_dpram_size[i];
+  }
+  while (banks > nbtrans && dpram_used + banks * defaultEndpointSize > EP_DPRAM_SIZE)
+  {
+    banks--;
+  }
+  TU_ASSERT(dpram_used + banks * defaultEndpointSize <= EP_DPRAM_SIZE);
+  ep_dpram_size[epnum] = (uint16_t) (banks * defaultEndpointSize);
+
   USB_REG->DEVEPT |= 1 << (DEVEPT_EPRST0_Pos + epnum);
   USB_REG->DEVEPT &=~(1 << (DEVEPT_EPRST0_Pos + epnum));
 
@@ -523,20 +561,14 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
       (
        (fifoSize << DEVEPTCFG_EPSIZE_Pos)            |
        (eptype  << DEVEPTCFG_EPTYPE_Pos)             |
-       (DEVEPTCFG_EPBK_1_BANK << DEVEPTCFG_EPBK_Pos) |
+       ((banks - 1u) << DEVEPTCFG_EPBK_Pos)          |
        DEVEPTCFG_AUTOSW |
        ((dir & 0x01) << DEVEPTCFG_EPDIR_Pos)
        );
     if (eptype == TUSB_XFER_ISOCHRONOUS)
     {
-      USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_NBTRANS_1_TRANS;
-    }
-#if USE_DUAL_BANK
-    if (eptype == TUSB_XFER_ISOCHRONOUS || eptype == TUSB_XFER_BULK)
-    {
-      USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_EPBK_2_BANK;
+      USB_REG->DEVEPTCFG[epnum] |= ((uint32_t) nbtrans << DEVEPTCFG_NBTRANS_Pos);
     }
-#endif
     USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_ALLOC;
     USB_REG->DEVEPTIER[epnum] = DEVEPTIER_RSTDTS;
     USB_REG->DEVEPTIDR[epnum] = DEVEPTIDR_CTRL_STALLRQC;
@@ -51,7 +51,6 @@
 
 // TODO remove later
 #include "device/usbd.h"
-#include "device/usbd_pvt.h" // to use defer function helper
 
 #if CFG_TUSB_OS == OPT_OS_MYNEWT
 #include "mcu/mcu.h"
@@ -76,6 +75,17 @@ enum
   EP_CBI_COUNT = 8  // Control Bulk Interrupt endpoints count
 };
 
+// Bit position of EasyDMA request in _dcd.dma_pending
+enum
+{
+  DMA_REQ_IN_POS    = 0,  // STARTEPIN0-7, STARTISOIN
+  DMA_REQ_OUT_POS   = 16, // STARTEPOUT0-7, STARTISOOUT
+  DMA_REQ_EP0STATUS = 30,
+  DMA_REQ_EP0RCVOUT = 31,
+
+  DMA_REQ_ISO_MASK  = (1UL << (DMA_REQ_IN_POS + EP_ISO_NUM)) | (1UL << (DMA_REQ_OUT_POS + EP_ISO_NUM))
+};
+
 // Transfer Descriptor
 typedef struct
 {
@@ -104,6 +114,10 @@ static struct
 
   // nRF can only carry one DMA at a time, this is used to guard the access to EasyDMA
   atomic_bool dma_running;
+
+  // EasyDMA requests waiting for the running DMA to complete, see DMA_REQ_*
+  atomic_uint dma_pending;
+  uint8_t dma_last; // last started request, for round-robin arbitration
 }_dcd;
 
 /*------------------------------------------------------------------*/
@@ -146,17 +160,6 @@ static void start_dma(volatile uint32_t* reg_startep)
   }
 }
 
-static void edpt_dma_start(volatile uint32_t* reg_startep)
-{
-  if ( atomic_flag_test_and_set(&_dcd.dma_running) )
-  {
-    usbd_defer_func((osal_task_func_t) edpt_dma_start, (void*) (uintptr_t) reg_startep, true);
-  }else
-  {
-    start_dma(reg_startep);
-  }
-}
-
 // DMA is complete
 static void edpt_dma_end(void)
 {
@@ -170,26 +173,13 @@ static inline xfer_td_t* get_td(uint8_t epnum, uint8_t dir)
   return &_dcd.xfer[epnum][dir];
 }
 
-static void xact_out_dma(uint8_t epnum);
-// Function wraps xact_out_dma which wants uint8_t while usbd_defer_func wants void (*)(void *)
-static void xact_out_dma_wrapper(void *epnum)
-{
-  xact_out_dma((uint8_t)((uintptr_t)epnum));
-}
-
-// Start DMA to move data from Endpoint -> RAM
-static void xact_out_dma(uint8_t epnum)
+// Start DMA to move data from Endpoint -> RAM, EasyDMA must be already acquired
+static void xact_out_dma_start(uint8_t epnum)
 {
   xfer_td_t* xfer = get_td(epnum, TUSB_DIR_OUT);
   uint32_t xact_len;
 
-  // DMA can't be active during read of SIZE.EPOUT or SIZE.ISOOUT, so try to lock,
-  // If already running defer call regardless if it was called from ISR or task,
-  if ( atomic_flag_test_and_set(&_dcd.dma_running) )
-  {
-    usbd_defer_func((osal_task_func_t)xact_out_dma_wrapper, (void *)(uint32_t)epnum, is_in_isr());
-    return;
-  }
+  // DMA can't be active during read of SIZE.EPOUT or SIZE.ISOOUT
   if (epnum == EP_ISO_NUM)
   {
     xact_len = NRF_USBD->SIZE.ISOOUT;
@@ -226,6 +216,76 @@ static void xact_out_dma(uint8_t epnum)
   }
 }
 
+// Pick next pending request: ISO first since it must complete within the frame,
+// others are round-robin starting after the last started one so that a busy endpoint
+// can't starve the rest.
+static uint8_t dma_next_request(uint32_t pending)
+{
+  if (pending & DMA_REQ_ISO_MASK) pending &= DMA_REQ_ISO_MASK;
+
+  uint8_t bit = _dcd.dma_last;
+  do
+  {
+    bit = (bit + 1) & 31;
+  } while ( !(pending & (1UL << bit)) );
+
+  _dcd.dma_last = bit;
+  return bit;
+}
+
+// Start queued requests as long as EasyDMA is available. Called by requester after queuing
+// and by ISR when DMA is complete, whoever acquires EasyDMA starts the next request.
+static void dma_service(void)
+{
+  while ( atomic_load(&_dcd.dma_pending) )
+  {
+    // DMA is running, request will be started when it is complete
+    if ( atomic_flag_test_and_set(&_dcd.dma_running) ) return;
+
+    uint32_t const pending = atomic_load(&_dcd.dma_pending);
+    if ( !pending )
+    {
+      // consumed by other context, release and re-check for request queued in between
+      atomic_flag_clear(&_dcd.dma_running);
+      continue;
+    }
+
+    uint8_t const bit = dma_next_request(pending);
+    atomic_fetch_and(&_dcd.dma_pending, ~(1UL << bit));
+
+    // EP0STATUS, EP0RCVOUT and empty ISOOUT release EasyDMA right away and continue with next request
+    if ( bit == DMA_REQ_EP0STATUS )
+    {
+      start_dma(&NRF_USBD->TASKS_EP0STATUS);
+    }
+    else if ( bit == DMA_REQ_EP0RCVOUT )
+    {
+      start_dma(&NRF_USBD->TASKS_EP0RCVOUT);
+    }
+    else if ( bit >= DMA_REQ_OUT_POS )
+    {
+      xact_out_dma_start(bit - DMA_REQ_OUT_POS);
+    }
+    else
+    {
+      // STARTEPIN[8] is STARTISOIN
+      start_dma(&NRF_USBD->TASKS_STARTEPIN[bit - DMA_REQ_IN_POS]);
+    }
+  }
+}
+
+// Queue an EasyDMA request, it is started immediately if DMA is available
+static void dma_request(uint8_t bit)
+{
+  atomic_fetch_or(&_dcd.dma_pending, 1UL << bit);
+  dma_service();
+}
+
+static void xact_out_dma(uint8_t epnum)
+{
+  dma_request(DMA_REQ_OUT_POS + epnum);
+}
+
 // Prepare for a CBI transaction IN, call at the start
 // it start DMA to transfer data from RAM -> Endpoint
 static void xact_in_dma(uint8_t epnum)
@@ -238,7 +298,7 @@ static void xact_in_dma(uint8_t epnum)
   NRF_USBD->EPIN[epnum].PTR    = (uint32_t) xfer->buffer;
   NRF_USBD->EPIN[epnum].MAXCNT = xact_len;
 
-  edpt_dma_start(&NRF_USBD->TASKS_STARTEPIN[epnum]);
+  dma_request(DMA_REQ_IN_POS + epnum);
 }
 
 //--------------------------------------------------------------------+
@@ -457,6 +517,9 @@ void dcd_edpt_close (uint8_t rhport, uint8_t ep_addr)
     if (_dcd.xfer[EP_ISO_NUM][TUSB_DIR_IN].mps + _dcd.xfer[EP_ISO_NUM][TUSB_DIR_OUT].mps == 0) NRF_USBD->INTENCLR = USBD_INTENCLR_SOF_Msk;
   }
   _dcd.xfer[epnum][dir].started = false;
+
+  // drop queued DMA request of this endpoint
+  atomic_fetch_and(&_dcd.dma_pending, ~(1UL << ((dir == TUSB_DIR_IN ? DMA_REQ_IN_POS : DMA_REQ_OUT_POS) + epnum)));
   __ISB(); __DSB();
 }
 
@@ -480,7 +543,7 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   if ( control_status )
   {
     // Status Phase also requires EasyDMA has to be available as well !!!!
-    edpt_dma_start(&NRF_USBD->TASKS_EP0STATUS);
+    dma_request(DMA_REQ_EP0STATUS);
 
     // The nRF doesn't interrupt on status transmit so we queue up a success response.
     dcd_event_xfer_complete(0, ep_addr, 0, XFER_RESULT_SUCCESS, is_in_isr());
@@ -491,7 +554,7 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
     if ( epnum == 0 )
     {
       // Accept next Control Out packet. TASKS_EP0RCVOUT also require EasyDMA
-      edpt_dma_start(&NRF_USBD->TASKS_EP0RCVOUT);
+      dma_request(DMA_REQ_EP0RCVOUT);
     }else
     {
       // started just set, it could start DMA transfer if interrupt was trigger after this line
@@ -593,6 +656,9 @@ void bus_reset(void)
   NRF_USBD->TASKS_STARTISOIN  = 0;
   NRF_USBD->TASKS_STARTISOOUT = 0;
 
+  // Queued DMA requests are no longer valid
+  atomic_store(&_dcd.dma_pending, 0);
+
   // Clear USB Event Interrupt
   NRF_USBD->EVENTS_USBEVENT = 0;
   NRF_USBD->EVENTCAUSE |= NRF_USBD->EVENTCAUSE;
@@ -607,7 +673,7 @@ void bus_reset(void)
   _dcd.xfer[0][TUSB_DIR_OUT].mps = MAX_PACKET_SIZE;
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void) rhport;
 
@@ -744,6 +810,9 @@ void dcd_int_handler(uint8_t rhport)
     // DMA complete move data from SRAM <-> Endpoint
     // Must before endpoint transfer handling
     edpt_dma_end();
+
+    // Start next queued request
+    dma_service();
   }
 
   //--------------------------------------------------------------------+
@@ -798,7 +867,7 @@ void dcd_int_handler(uint8_t rhport)
         if ( epnum == 0 )
         {
           // Accept next Control Out packet. TASKS_EP0RCVOUT also require EasyDMA
-          edpt_dma_start(&NRF_USBD->TASKS_EP0RCVOUT);
+          dma_request(DMA_REQ_EP0RCVOUT);
         }else
         {
           // nRF auto accept next Bulk/Interrupt OUT packet
@@ -81,7 +81,7 @@ static bool active_ep0_xfer;
 static struct xfer_ctl_t
 {
   uint8_t *data_ptr;         /* data_ptr tracks where to next copy data to (for OUT) or from (for IN) */
-  // tu_fifo_t * ff; // TODO support dcd_edpt_xfer_fifo API
+  tu_fifo_t * ff;            /* pointer to FIFO required for dcd_edpt_xfer_fifo() */
   union {
     uint16_t in_remaining_bytes; /* for IN endpoints, we track how many bytes are left to transfer */
     uint16_t out_bytes_so_far;   /* but for OUT endpoints, we track how many bytes we've transferred so far */
@@ -104,11 +104,6 @@ static void usb_detach(void)
   USBD->SE0 |= USBD_SE0_SE0_Msk;
 }
 
-static inline void usb_memcpy(uint8_t *dest, uint8_t *src, uint16_t size)
-{
-  while(size--) *dest++ = *src++;
-}
-
 static void usb_control_send_zlp(void)
 {
   USBD->EP[PERIPH_EP0].CFG |= USBD_CFG_DSQSYNC_Msk;
@@ -153,16 +148,14 @@ static void dcd_in_xfer(struct xfer_ctl_t *xfer, USBD_EP_T *ep)
 {
   uint16_t bytes_now = tu_min16(xfer->in_remaining_bytes, xfer->max_packet_size);
 
-#if 0 // TODO support dcd_edpt_xfer_fifo API
+  // USB SRAM seems to only support byte access and memcpy could possibly do it by words
   if (xfer->ff)
   {
-    tu_fifo_read_n(xfer->ff, (void *) (USBD_BUF_BASE + ep->BUFSEG), bytes_now);
+    tu_hwfifo_write_from_fifo((void *) (USBD_BUF_BASE + ep->BUFSEG), xfer->ff, bytes_now, TU_HWFIFO_MEM8);
   }
   else
-#endif
   {
-    // USB SRAM seems to only support byte access and memcpy could possibly do it by words
-    usb_memcpy((uint8_t *)(USBD_BUF_BASE + ep->BUFSEG), xfer->data_ptr, bytes_now);
+    tu_hwfifo_write((void *) (USBD_BUF_BASE + ep->BUFSEG), xfer->data_ptr, bytes_now, TU_HWFIFO_MEM8);
   }
 
   ep->MXPLD = bytes_now;
@@ -318,7 +311,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
 
   /* store away the information we'll needing now and later */
   xfer->data_ptr = buffer;
-  // xfer->ff       = NULL; // TODO support dcd_edpt_xfer_fifo API
+  xfer->ff       = NULL;
   xfer->in_remaining_bytes = total_bytes;
   xfer->total_bytes = total_bytes;
 
@@ -338,7 +331,6 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
   return true;
 }
 
-#if 0 // TODO support dcd_edpt_xfer_fifo API
 bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
 {
   (void) rhport;
@@ -366,7 +358,6 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 
   return true;
 }
-#endif
 
 void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 {
@@ -382,7 +373,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
   ep->CFG = (ep->CFG & ~USBD_CFG_DSQSYNC_Msk) | USBD_CFG_CSTALL_Msk;
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void) rhport;
 
@@ -475,16 +466,14 @@ void dcd_int_handler(uint8_t rhport)
         if (out_ep)
         {
           /* copy the data from the PC to the previously provided buffer */
-#if 0 // TODO support dcd_edpt_xfer_fifo API
+          // USB SRAM seems to only support byte access and memcpy could possibly do it by words
           if (xfer->ff)
           {
-            tu_fifo_write_n(xfer->ff, (const void *) (USBD_BUF_BASE + ep->BUFSEG), available_bytes);
+            tu_hwfifo_read_to_fifo((const void *) (USBD_BUF_BASE + ep->BUFSEG), xfer->ff, available_bytes, TU_HWFIFO_MEM8);
           }
           else
-#endif
           {
-            // USB SRAM seems to only support byte access and memcpy could possibly do it by words
-            usb_memcpy(xfer->data_ptr, (uint8_t *)(USBD_BUF_BASE + ep->BUFSEG), available_bytes);
+            tu_hwfifo_read((const void *) (USBD_BUF_BASE + ep->BUFSEG), xfer->data_ptr, available_bytes, TU_HWFIFO_MEM8);
             xfer->data_ptr += available_bytes;
           }
 
@@ -500,7 +489,7 @@ void dcd_int_handler(uint8_t rhport)
         {
           /* update the bookkeeping to reflect the data that has now been sent to the PC */
           xfer->in_remaining_bytes -= available_bytes;
-          xfer->data_ptr += available_bytes;
+          if (!xfer->ff) xfer->data_ptr += available_bytes;
 
           /* if more data to send, send it; otherwise, alert TinyUSB that we've finished */
           if (xfer->in_remaining_bytes)
@@ -43,9 +43,13 @@
 /*
  * The DMA functionality of the USBD peripheral does not appear to succeed with
  * transfer lengths that are longer (> 64 bytes) and are not a multiple of 4.
- * Keep disabled for now.
+ * Therefore DMA only ever moves the word-aligned, multiple-of-4 bulk of a packet;
+ * the remaining 1-3 tail bytes (and packets from/to unaligned buffers) are copied by the CPU.
+ * Set CFG_TUD_NUC505_DMA to 0 to always copy packets by CPU.
  */
-#define USE_DMA     0
+#ifndef CFG_TUD_NUC505_DMA
+#define CFG_TUD_NUC505_DMA     1
+#endif
 
 /* rather important info unfortunately not provided by device include files */
 #define USBD_BUF_SIZE          2048 /* how much USB buffer space there is */
@@ -103,6 +107,9 @@ static struct xfer_ctl_t
   uint16_t total_bytes;      /* quantity needed to pass as argument to dcd_event_xfer_complete() (for IN endpoints) */
   uint8_t ep_addr;
   bool dma_requested;
+  bool dma_short;            /* OUT packet being DMAed is a short packet i.e ends the transfer */
+  uint16_t dma_len;          /* bytes of the current packet moved by DMA */
+  uint16_t dma_pkt_len;      /* total bytes of the current packet, the part beyond dma_len is copied by CPU */
 } xfer_table[PERIPH_MAX_EP];
 
 /* in addition to xfer_table, additional bespoke bookkeeping is maintained for control EP0 IN */
@@ -115,6 +122,9 @@ static struct
 
 static volatile struct xfer_ctl_t *current_dma_xfer;
 
+/* round-robin start point of service_dma(), so that a busy endpoint cannot starve the others */
+static enum ep_enum dma_next_ep;
+
 
 /*
   local helper functions
@@ -163,34 +173,19 @@ static USBD_EP_T *ep_entry(uint8_t ep_addr, bool add)
   return NULL;
 }
 
-/* perform a non-control IN endpoint transfer; this is called by the ISR  */
-static void dcd_userEP_in_xfer(struct xfer_ctl_t *xfer, USBD_EP_T *ep)
+/* copy (the rest of) an IN packet into the endpoint buffer by CPU; pkt_len is the size of the whole packet */
+static void ep_write_packet(struct xfer_ctl_t *xfer, USBD_EP_T *ep, uint16_t pkt_len, uint16_t count)
 {
-  uint16_t const bytes_now = tu_min16(xfer->in_remaining_bytes, xfer->max_packet_size);
-
-  /* precompute what amount of data will be left */
-  xfer->in_remaining_bytes -= bytes_now;
-
-  /*
-  if there will be no more data to send, we replace the BUFEMPTYIF EP interrupt with TXPKIF;
-  that way, we alert TinyUSB as soon as this last packet has been sent
-  */
-  if (0 == xfer->in_remaining_bytes)
-  {
-    ep->EPINTSTS = USBD_EPINTSTS_TXPKIF_Msk;
-    ep->EPINTEN = USBD_EPINTEN_TXPKIEN_Msk;
-  }
-
   /* provided buffers are thankfully 32-bit aligned, allowing most data to be transferred as 32-bit */
 #if 0 // TODO support dcd_edpt_xfer_fifo API
   if (xfer->ff)
   {
-    tu_fifo_read_n_const_addr_full_words(xfer->ff, (void *) (&ep->EPDAT_BYTE), bytes_now);
+    tu_fifo_read_n_const_addr_full_words(xfer->ff, (void *) (&ep->EPDAT_BYTE), count);
   }
   else
 #endif
   {
-    uint16_t countdown = bytes_now;
+    uint16_t countdown = count;
     while (countdown > 3)
     {
       uint32_t u32;
@@ -204,7 +199,84 @@ static void dcd_userEP_in_xfer(struct xfer_ctl_t *xfer, USBD_EP_T *ep)
   }
 
   /* for short packets, we must nudge the peripheral to say 'that's all folks' */
-  if (bytes_now != xfer->max_packet_size) ep->EPRSPCTL = USBD_EPRSPCTL_SHORTTXEN_Msk;
+  if (pkt_len != xfer->max_packet_size) ep->EPRSPCTL = USBD_EPRSPCTL_SHORTTXEN_Msk;
+}
+
+/* copy count bytes of an OUT packet from the endpoint buffer by CPU */
+static void ep_read_packet(struct xfer_ctl_t *xfer, USBD_EP_T *ep, uint16_t count)
+{
+#if 0 // TODO support dcd_edpt_xfer_fifo API
+  if (xfer->ff)
+  {
+    tu_fifo_write_n_const_addr_full_words(xfer->ff, (const void *) &ep->EPDAT_BYTE, count);
+  }
+  else
+#endif
+  {
+    for (uint16_t i = 0; i < count; i++) *xfer->data_ptr++ = ep->EPDAT_BYTE;
+  }
+
+  xfer->out_bytes_so_far += count;
+}
+
+/* when the OUT transfer is finished, alert TinyUSB; otherwise, continue accepting more data */
+static void ep_out_check_complete(struct xfer_ctl_t *xfer, USBD_EP_T *ep, bool short_packet)
+{
+  if ( (xfer->total_bytes == xfer->out_bytes_so_far) || short_packet )
+  {
+    ep->EPINTEN = 0;
+    dcd_event_xfer_complete(0, xfer->ep_addr, xfer->out_bytes_so_far, XFER_RESULT_SUCCESS, true);
+  }
+  else
+  {
+    ep->EPINTEN = USBD_EPINTEN_RXPKIEN_Msk;
+  }
+}
+
+#if CFG_TUD_NUC505_DMA
+static void service_dma(void);
+
+/* number of bytes of a packet that DMA can safely move: none for an unaligned buffer, otherwise the multiple-of-4 part */
+static inline uint16_t dma_length(uint8_t const *buf, uint16_t len)
+{
+  if ((uintptr_t) buf & 3) return 0;
+  return tu_min16(len & ~3u, USBD_MAX_DMA_LEN);
+}
+#endif
+
+/* perform a non-control IN endpoint transfer; this is called by the ISR  */
+static void dcd_userEP_in_xfer(struct xfer_ctl_t *xfer, USBD_EP_T *ep)
+{
+  uint16_t const bytes_now = tu_min16(xfer->in_remaining_bytes, xfer->max_packet_size);
+
+  /* precompute what amount of data will be left */
+  xfer->in_remaining_bytes -= bytes_now;
+
+  /*
+  if there will be no more data to send, we replace the BUFEMPTYIF EP interrupt with TXPKIF;
+  that way, we alert TinyUSB as soon as this last packet has been sent
+  */
+  if (0 == xfer->in_remaining_bytes)
+  {
+    ep->EPINTSTS = USBD_EPINTSTS_TXPKIF_Msk;
+    ep->EPINTEN = USBD_EPINTEN_TXPKIEN_Msk;
+  }
+
+#if CFG_TUD_NUC505_DMA
+  uint16_t const dma_len = dma_length(xfer->data_ptr, bytes_now);
+  if (dma_len)
+  {
+    /* the rest of the packet is written by dma_done(); until then, mute BUFEMPTYIF of this endpoint */
+    if (xfer->in_remaining_bytes) ep->EPINTEN = 0;
+    xfer->dma_len = dma_len;
+    xfer->dma_pkt_len = bytes_now;
+    xfer->dma_requested = true;
+    service_dma();
+    return;
+  }
+#endif
+
+  ep_write_packet(xfer, ep, bytes_now, bytes_now);
 }
 
 /* called by dcd_init() as well as by the ISR during a USB bus reset */
@@ -232,41 +304,81 @@ static void bus_reset(void)
   USBD->FADDR = 0;
 
   current_dma_xfer = NULL;
+  dma_next_ep = PERIPH_EPA;
 }
 
-#if USE_DMA
+#if CFG_TUD_NUC505_DMA
 /* this must only be called by the ISR; it does its best to share the single DMA engine across all user EPs (IN and OUT) */
 static void service_dma(void)
 {
   if (current_dma_xfer)
     return;
 
-  enum ep_enum ep_index;
-  struct xfer_ctl_t *xfer;
-  USBD_EP_T *ep;
-
-  for (ep_index = PERIPH_EPA, xfer = &xfer_table[PERIPH_EPA], ep = &USBD->EP[PERIPH_EPA]; ep_index < PERIPH_MAX_EP; ep_index++, xfer++, ep++)
+  for (unsigned i = 0; i < PERIPH_MAX_EP; i++)
   {
-    uint16_t const available_bytes = ep->EPDATCNT & USBD_EPDATCNT_DATCNT_Msk;
+    enum ep_enum const ep_index = (enum ep_enum) ((dma_next_ep + i) % PERIPH_MAX_EP);
+    struct xfer_ctl_t *xfer = &xfer_table[ep_index];
 
-    if (!xfer->dma_requested || !available_bytes)
+    if (!xfer->dma_requested)
       continue;
 
     /*
-    instruct DMA to copy the data from the PC to the previously provided buffer
-    when the bus interrupt DMADONEIEN subsequently fires, the transfer will have finished
+    instruct DMA to copy the packet between the endpoint buffer and the previously provided buffer;
+    DMARD means the DMA reads from memory (IN endpoint) instead of writing to it (OUT endpoint).
+    when the bus interrupt DMADONEIEN subsequently fires, dma_done() handles the rest of the packet
     */
-    USBD->DMACTL = xfer->ep_addr & USBD_DMACTL_EPNUM_Msk;
+    uint32_t dmactl = xfer->ep_addr & USBD_DMACTL_EPNUM_Msk;
+    if (TUSB_DIR_IN == tu_edpt_dir(xfer->ep_addr))
+    {
+      dmactl |= USBD_DMACTL_DMARD_Msk;
+#ifdef USBD_DMACTL_SVINEP_Msk
+      dmactl |= USBD_DMACTL_SVINEP_Msk;
+#endif
+    }
+
+    USBD->DMACTL = dmactl;
     USBD->DMAADDR = (uint32_t)xfer->data_ptr;
-    USBD->DMACNT = available_bytes;
+    USBD->DMACNT = xfer->dma_len;
     USBD->BUSINTSTS = USBD_BUSINTSTS_DMADONEIF_Msk;
-    xfer->out_bytes_so_far += available_bytes;
     current_dma_xfer = xfer;
+    dma_next_ep = (enum ep_enum) ((ep_index + 1) % PERIPH_MAX_EP);
     USBD->DMACTL |= USBD_DMACTL_DMAEN_Msk;
 
     return;
   }
 }
+
+/* called by the ISR when the DMA started by service_dma() has finished */
+static void dma_done(void)
+{
+  struct xfer_ctl_t *xfer = (struct xfer_ctl_t *) current_dma_xfer;
+  if (!xfer)
+    return;
+
+  USBD_EP_T *ep = &USBD->EP[xfer - xfer_table];
+  uint16_t const tail = xfer->dma_pkt_len - xfer->dma_len;
+
+  xfer->dma_requested = false;
+  xfer->data_ptr += xfer->dma_len;
+  current_dma_xfer = NULL;
+
+  if (TUSB_DIR_IN == tu_edpt_dir(xfer->ep_addr))
+  {
+    /* a full packet was already validated by DMA itself; a short one needs its tail bytes and SHORTTXEN */
+    ep_write_packet(xfer, ep, xfer->dma_pkt_len, tail);
+
+    /* the last packet was already switched over to TXPKIEN by dcd_userEP_in_xfer() */
+    if (xfer->in_remaining_bytes) ep->EPINTEN = USBD_EPINTEN_BUFEMPTYIEN_Msk;
+  }
+  else
+  {
+    xfer->out_bytes_so_far += xfer->dma_len;
+    ep_read_packet(xfer, ep, tail);
+    ep_out_check_complete(xfer, ep, xfer->dma_short);
+  }
+
+  service_dma();
+}
 #endif
 
 /* centralized location for USBD interrupt enable bit masks */
@@ -481,7 +593,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
   }
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void) rhport;
 
@@ -529,22 +641,8 @@ void dcd_int_handler(uint8_t rhport)
 
     if (bus_state & USBD_BUSINTSTS_DMADONEIF_Msk)
     {
-#if USE_DMA
-      if (current_dma_xfer)
-      {
-        current_dma_xfer->dma_requested = false;
-
-        uint16_t available_bytes = USBD->DMACNT & USBD_DMACNT_DMACNT_Msk;
-
-        /* if the most recent DMA finishes the transfer, alert TinyUSB; otherwise, the next RXPKIF/INTKIF endpoint interrupt will prompt the next DMA */
-        if ( (current_dma_xfer->total_bytes == current_dma_xfer->out_bytes_so_far) || (available_bytes < current_dma_xfer->max_packet_size) )
-        {
-          dcd_event_xfer_complete(0, current_dma_xfer->ep_addr, current_dma_xfer->out_bytes_so_far, XFER_RESULT_SUCCESS, true);
-        }
-
-        current_dma_xfer = NULL;
-        service_dma();
-      }
+#if CFG_TUD_NUC505_DMA
+      dma_done();
 #endif
     }
 
@@ -662,33 +760,32 @@ void dcd_int_handler(uint8_t rhport)
 
         if (out_ep)
         {
-#if USE_DMA
-          xfer->dma_requested = true;
-          service_dma();
-#else
-          uint16_t const available_bytes = ep->EPDATCNT & USBD_EPDATCNT_DATCNT_Msk;
-          /* copy the data from the PC to the previously provided buffer */
-#if 0 // TODO support dcd_edpt_xfer_fifo API
-          if (xfer->ff)
+          if (ep_state & USBD_EPINTSTS_RXPKIF_Msk)
           {
-            tu_fifo_write_n_const_addr_full_words(xfer->ff, (const void *) &ep->EPDAT_BYTE, tu_min16(available_bytes, xfer->total_bytes - xfer->out_bytes_so_far));
-          }
-          else
+            uint16_t const available_bytes = ep->EPDATCNT & USBD_EPDATCNT_DATCNT_Msk;
+            uint16_t const count = tu_min16(available_bytes, xfer->total_bytes - xfer->out_bytes_so_far);
+            bool const short_packet = available_bytes < xfer->max_packet_size;
+
+#if CFG_TUD_NUC505_DMA
+            uint16_t const dma_len = dma_length(xfer->data_ptr, count);
+            if (dma_len)
+            {
+              /* copy the data from the PC to the previously provided buffer by DMA, RXPKIF is muted until dma_done() */
+              ep->EPINTEN = 0;
+              xfer->dma_len = dma_len;
+              xfer->dma_pkt_len = count;
+              xfer->dma_short = short_packet;
+              xfer->dma_requested = true;
+              service_dma();
+            }
+            else
 #endif
-          {
-            for (int count = 0; (count < available_bytes) && (xfer->out_bytes_so_far < xfer->total_bytes); count++, xfer->out_bytes_so_far++)
             {
-              *xfer->data_ptr++ = ep->EPDAT_BYTE;
+              /* copy the data from the PC to the previously provided buffer */
+              ep_read_packet(xfer, ep, count);
+              ep_out_check_complete(xfer, ep, short_packet);
             }
           }
-
-          /* when the transfer is finished, alert TinyUSB; otherwise, continue accepting more data */
-          if ( (xfer->total_bytes == xfer->out_bytes_so_far) || (available_bytes < xfer->max_packet_size) )
-          {
-            dcd_event_xfer_complete(0, ep_addr, xfer->out_bytes_so_far, XFER_RESULT_SUCCESS, true);
-          }
-#endif
-
         }
         else if (ep_state & USBD_EPINTSTS_BUFEMPTYIF_Msk)
         {
@@ -190,6 +190,15 @@ static void process_tokdne(uint8_t rhport)
     }
     return;
   }
+  if (remaining && !dir) {
+    /* A short packet ended the transfer while the ping-pong buffer may still
+     * be armed for its next packet, take it back so that next transfer starts on it. */
+    buffer_descriptor_t *next = odd ? bd - 1 : bd + 1;
+    if (next->own) {
+      next->own = 0;
+      __DSB();
+    }
+  }
   const unsigned length = ep->length;
   dcd_event_xfer_complete(rhport,
                           tu_edpt_addr(epnum, dir),
@@ -518,7 +527,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 //--------------------------------------------------------------------+
 // ISR
 //--------------------------------------------------------------------+
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint32_t is  = KHCI->ISTAT;
   uint32_t msk = KHCI->INTEN;
@@ -587,7 +587,7 @@ bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 /*--------------------------------------------------------------------+
  * ISR
  *--------------------------------------------------------------------+*/
-void hcd_int_handler(uint8_t rhport, bool in_isr)
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr)
 {
   (void) in_isr;
   uint32_t is  = KHCI->ISTAT;
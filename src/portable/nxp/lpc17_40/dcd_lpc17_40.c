@@ -68,10 +68,16 @@ typedef struct TU_ATTR_ALIGNED(4)
                                     // For iso : number of packets
 
   //------------- Word 4 -------------//
-  //	uint32_t iso_packet_size_addr;		// iso only, can be omitted for non-iso
+  uint32_t iso_packet_size_addr; // iso only: array of packet length, one word per packet
 }dma_desc_t;
 
-TU_VERIFY_STATIC( sizeof(dma_desc_t) == 16, "size is not correct"); // TODO not support ISO for now
+TU_VERIFY_STATIC( sizeof(dma_desc_t) == 20, "size is not correct");
+
+// iso packet length word: [15:0] length, [16] valid (OUT only), [31:17] frame number (OUT only)
+enum {
+  ISO_PACKET_LENGTH_MASK = 0xFFFFu,
+  ISO_PACKET_VALID_MASK  = TU_BIT(16),
+};
 
 typedef struct
 {
@@ -81,6 +87,9 @@ typedef struct
   // TODO DMA does not support control transfer (0-1 are not used, offset to reduce memory)
   dma_desc_t dd[DCD_ENDPOINT_MAX];
 
+  // packet length for iso DD, one packet per transfer (a frame)
+  volatile uint32_t iso_packet_size[DCD_ENDPOINT_MAX];
+
   struct
   {
     uint8_t* out_buffer;
@@ -264,6 +273,17 @@ static void control_ep_write(void const * buffer, uint8_t len)
   sie_write(SIE_CMDCODE_BUFFER_VALIDATE  , 0, 0);
 }
 
+// send zero-length packet on a non-control IN endpoint in slave mode
+static void edpt_in_zlp(uint8_t epnum, uint8_t ep_id)
+{
+  LPC_USB->Ctrl   = USBCTRL_WRITE_ENABLE_MASK | (uint32_t) (epnum << 2); // logical endpoint at [5:2]
+  LPC_USB->TxPLen = 0;
+  LPC_USB->Ctrl   = 0;
+
+  sie_write(SIE_CMDCODE_ENDPOINT_SELECT + ep_id, 0, 0);
+  sie_write(SIE_CMDCODE_BUFFER_VALIDATE        , 0, 0);
+}
+
 static uint8_t control_ep_read(void * buffer, uint8_t len)
 {
   LPC_USB->Ctrl = USBCTRL_READ_ENABLE_MASK; // logical endpoint = 0
@@ -338,7 +358,16 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
 void dcd_edpt_close_all (uint8_t rhport)
 {
   (void) rhport;
-  // TODO implement dcd_edpt_close_all()
+
+  // disable DMA and slow interrupt for all non-control endpoints
+  LPC_USB->EpDMADis = 0xFFFFFFFCUL;
+  LPC_USB->EpIntEn &= 0x03UL;
+
+  for ( uint8_t ep_id = 2; ep_id < DCD_ENDPOINT_MAX; ep_id++ )
+  {
+    _dcd.udca[ep_id] = NULL;
+    _dcd.dd[ep_id].retired = 1;
+  }
 }
 
 void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
@@ -413,7 +442,30 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
     dd->isochronous = is_iso;
     dd->max_packet_size = ep_size;
     dd->buffer = (uint32_t) buffer;
-    dd->buflen = total_bytes;
+
+    if ( is_iso )
+    {
+      // iso DD counts packets, length of each packet is described by the packet size array
+      TU_ASSERT(total_bytes <= ep_size);
+      _dcd.iso_packet_size[ep_id] = (ep_id % 2) ? total_bytes : ep_size;
+      dd->iso_packet_size_addr = (uint32_t) &_dcd.iso_packet_size[ep_id];
+      dd->buflen = 1;
+    }else
+    {
+      dd->buflen = total_bytes;
+    }
+
+    if ( (ep_id % 2) && !is_iso && (total_bytes == 0) )
+    {
+      // DMA cannot send zero-length packet: validate an empty buffer in slave mode and
+      // complete on the endpoint interrupt
+      LPC_USB->EpDMADis = TU_BIT(ep_id);
+      edpt_in_zlp(tu_edpt_number(ep_addr), ep_id);
+
+      dd->status = DD_STATUS_NORMAL;
+      LPC_USB->EpIntEn |= TU_BIT(ep_id);
+      return true;
+    }
 
     _dcd.udca[ep_id] = dd;
 
@@ -515,12 +567,26 @@ static void dd_complete_isr(uint8_t rhport, uint8_t ep_id)
   dma_desc_t* const dd = &_dcd.dd[ep_id];
   uint8_t result = (dd->status == DD_STATUS_NORMAL || dd->status == DD_STATUS_DATA_UNDERUN) ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED;
   uint8_t const ep_addr = (ep_id / 2) | ((ep_id & 0x01) ? TUSB_DIR_IN_MASK : 0);
+  uint32_t len = dd->present_count;
+
+  if ( dd->isochronous )
+  {
+    // present_count is number of packets, actual length is reported in the packet size array
+    uint32_t const pkt = _dcd.iso_packet_size[ep_id];
+    if ( ep_id & 0x01 )
+    {
+      len = len ? (pkt & ISO_PACKET_LENGTH_MASK) : 0;
+    }else
+    {
+      len = (len && (pkt & ISO_PACKET_VALID_MASK)) ? (pkt & ISO_PACKET_LENGTH_MASK) : 0;
+    }
+  }
 
-  dcd_event_xfer_complete(rhport, ep_addr, dd->present_count, result, true);
+  dcd_event_xfer_complete(rhport, ep_addr, len, result, true);
 }
 
 // main USB IRQ handler
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint32_t const dev_int_status = LPC_USB->DevIntSt & LPC_USB->DevIntEn;
   LPC_USB->DevIntClr = dev_int_status;// Acknowledge handled interrupt
@@ -562,6 +628,7 @@ void dcd_int_handler(uint8_t rhport)
   // DMA transfer complete (RAM <-> EP) for Non-Control
   // OUT: USB transfer is fully complete
   // IN : UBS transfer is still on-going -> enable EpIntEn to know when it is complete
+  // ISO: packet is moved at frame boundary, there is no endpoint interrupt -> complete now
   uint32_t const dma_int_status = LPC_USB->DMAIntSt & LPC_USB->DMAIntEn;
   if (dma_int_status & DMA_INT_END_OF_XFER_MASK)
   {
@@ -572,7 +639,7 @@ void dcd_int_handler(uint8_t rhport)
     {
       if ( tu_bit_test(eot, ep_id) )
       {
-        if ( ep_id & 0x01 )
+        if ( (ep_id & 0x01) && !_dcd.dd[ep_id].isochronous )
         {
           // IN enable EpInt for end of usb transfer
           LPC_USB->EpIntEn |= TU_BIT(ep_id);
@@ -51,6 +51,13 @@
 
 #include "device/dcd.h"
 
+// Bulk endpoints of full speed port use both buffers of the endpoint (EPBUFCFG): next packet is armed while
+// hardware is busy with current one, which removes NAK gap between packets of a transfer. High speed port
+// already transfers up to NBYTES_CBI_HS_MAX per buffer and is not affected.
+#ifndef CFG_TUD_IP3511_DOUBLE_BUFFER
+  #define CFG_TUD_IP3511_DOUBLE_BUFFER  1
+#endif
+
 //--------------------------------------------------------------------+
 // IP3511 Registers
 //--------------------------------------------------------------------+
@@ -159,6 +166,20 @@ typedef struct
 
   // prevent unaligned access on Highspeed port on USB_SRAM
   uint16_t TU_RESERVED;
+
+#if CFG_TUD_IP3511_DOUBLE_BUFFER
+  // Double buffered endpoint
+  uint8_t* buffer;        // NULL when there is no transfer in progress
+  uint16_t queued_bytes;  // bytes armed to hardware so far
+  uint16_t db_nbytes[2];  // nbytes armed in buffer 0/1
+  uint8_t  buf_idx;       // buffer to be completed next by hardware
+  uint8_t  buf_count;     // number of armed buffers
+
+  // OUT: packet received by other buffer after a short packet, it is the start of next transfer
+  uint8_t  carry_short;
+  uint16_t carry_len;
+  uint8_t const* carry_buf;
+#endif
 }xfer_dma_t;
 
 // Absolute max of endpoints pairs for all port
@@ -170,7 +191,7 @@ typedef struct
 // current_td is used to keep track of number of remaining & xferred bytes of the current request.
 typedef struct
 {
-  // 256 byte aligned, 2 for double buffer (not used)
+  // 256 byte aligned, 2 for double buffer (full speed bulk endpoints)
   // Each cmd_sts can only transfer up to DMA_NBYTES_MAX bytes each
   ep_cmd_sts_t ep[2*MAX_EP_PAIRS][2];
   xfer_dma_t dma[2*MAX_EP_PAIRS];
@@ -251,6 +272,10 @@ TU_ATTR_ALWAYS_INLINE static inline bool rhport_is_highspeed(uint8_t rhport) {
   return _dcd_controller[rhport].is_highspeed;
 }
 
+TU_ATTR_ALWAYS_INLINE static inline bool ep_is_double_buffered(uint8_t rhport, uint8_t ep_id) {
+  return CFG_TUD_IP3511_DOUBLE_BUFFER && tu_bit_test(_dcd_controller[rhport].regs->EPBUFCFG, ep_id);
+}
+
 //--------------------------------------------------------------------+
 // CONTROLLER API
 //--------------------------------------------------------------------+
@@ -345,22 +370,32 @@ void dcd_sof_enable(uint8_t rhport, bool en)
 //--------------------------------------------------------------------+
 void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 {
-  (void) rhport;
-
   // TODO cannot able to STALL Control OUT endpoint !!!!! FIXME try some walk-around
   uint8_t const ep_id = ep_addr2id(ep_addr);
   _dcd.ep[ep_id][0].cmd_sts.stall = 1;
+
+  // stall bit must be set in both buffers of a double buffered endpoint
+  if (ep_is_double_buffered(rhport, ep_id)) {
+    _dcd.ep[ep_id][1].cmd_sts.stall = 1;
+  }
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 {
-  (void) rhport;
-
   uint8_t const ep_id = ep_addr2id(ep_addr);
 
   _dcd.ep[ep_id][0].cmd_sts.stall        = 0;
   _dcd.ep[ep_id][0].cmd_sts.toggle_reset = 1;
   _dcd.ep[ep_id][0].cmd_sts.rf_tv        = 0;
+
+#if CFG_TUD_IP3511_DOUBLE_BUFFER
+  if (ep_is_double_buffered(rhport, ep_id)) {
+    _dcd.ep[ep_id][1].cmd_sts.stall = 0;
+    _dcd.dma[ep_id].carry_len = 0;
+  }
+#else
+  (void) rhport;
+#endif
 }
 
 bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
@@ -394,8 +429,20 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
     default: break;
   }
 
-  // Enable EP interrupt
   dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+
+#if CFG_TUD_IP3511_DOUBLE_BUFFER
+  // both buffers are inactive, EPINUSE can be written
+  tu_memclr(&_dcd.dma[ep_id], sizeof(xfer_dma_t));
+  dcd_reg->EPINUSE &= ~TU_BIT(ep_id);
+  if ( (p_endpoint_desc->bmAttributes.xfer == TUSB_XFER_BULK) && !rhport_is_highspeed(rhport) ) {
+    dcd_reg->EPBUFCFG |= TU_BIT(ep_id);
+  } else {
+    dcd_reg->EPBUFCFG &= ~TU_BIT(ep_id);
+  }
+#endif
+
+  // Enable EP interrupt
   dcd_reg->INTEN |= TU_BIT(ep_id);
 
   return true;
@@ -419,7 +466,7 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   _dcd.ep[ep_id][0].cmd_sts.disable = _dcd.ep[ep_id][1].cmd_sts.disable = 1;
 }
 
-static void prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint16_t buf_offset, uint16_t total_bytes) {
+static uint16_t prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint8_t buf_idx, uint16_t buf_offset, uint16_t total_bytes) {
   uint16_t nbytes;
   ep_cmd_sts_t* ep_cs = get_ep_cs(ep_id);
 
@@ -439,18 +486,119 @@ static void prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint16_t buf_offset,
     }
     #endif
 
-    ep_cs[0].buffer_hs.offset = buf_offset;
-    ep_cs[0].buffer_hs.nbytes = nbytes;
+    ep_cs[buf_idx].buffer_hs.offset = buf_offset;
+    ep_cs[buf_idx].buffer_hs.nbytes = nbytes;
   }else {
     nbytes = tu_min16(total_bytes, is_iso ? NBYTES_ISO_FS_MAX : NBYTES_CBI_FS_MAX);
-    ep_cs[0].buffer_fs.offset = buf_offset;
-    ep_cs[0].buffer_fs.nbytes = nbytes;
+    ep_cs[buf_idx].buffer_fs.offset = buf_offset;
+    ep_cs[buf_idx].buffer_fs.nbytes = nbytes;
+  }
+
+  ep_cs[buf_idx].cmd_sts.active = 1;
+  return nbytes;
+}
+
+#if CFG_TUD_IP3511_DOUBLE_BUFFER
+// Arm the buffer following the ones already armed with next chunk of the transfer
+static void db_arm_next(uint8_t rhport, uint8_t ep_id) {
+  xfer_dma_t* xfer = &_dcd.dma[ep_id];
+  uint8_t const idx = (xfer->buf_idx + xfer->buf_count) & 0x01;
+
+  uint16_t const nbytes = prepare_ep_xfer(rhport, ep_id, idx, get_buf_offset(xfer->buffer + xfer->queued_bytes),
+                                          xfer->total_bytes - xfer->queued_bytes);
+  xfer->db_nbytes[idx] = nbytes;
+  xfer->queued_bytes += nbytes;
+  xfer->buf_count++;
+}
+
+static bool db_xfer_start(uint8_t rhport, uint8_t ep_id, uint8_t* buffer, uint16_t total_bytes) {
+  dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+  xfer_dma_t* xfer = &_dcd.dma[ep_id];
+
+  uint8_t  const carry_short = xfer->carry_short;
+  uint16_t const carry_len   = xfer->carry_len;
+  uint8_t const* carry_buf   = xfer->carry_buf;
+
+  tu_memclr(xfer, sizeof(xfer_dma_t));
+  xfer->buffer      = buffer;
+  xfer->total_bytes = total_bytes;
+  // next buffer to be used by hardware
+  xfer->buf_idx     = tu_bit_test(dcd_reg->EPINUSE, ep_id) ? 1 : 0;
+
+  if (carry_len && total_bytes) {
+    // Data is still in the buffer of previous transfer, which class driver does not touch beyond the
+    // reported length until re-submitting it.
+    uint16_t const len = tu_min16(carry_len, total_bytes);
+    memmove(buffer, carry_buf, len);
+    xfer->xferred_bytes = xfer->queued_bytes = len;
+
+    if (carry_short || (len == total_bytes)) {
+      // nothing to arm, complete the transfer in ISR
+      dcd_reg->INTSETSTAT = TU_BIT(ep_id);
+      return true;
+    }
+  }
+
+  db_arm_next(rhport, ep_id);
+  if (xfer->queued_bytes < xfer->total_bytes) {
+    db_arm_next(rhport, ep_id);
   }
 
-  _dcd.dma[ep_id].nbytes = nbytes;
-  ep_cs[0].cmd_sts.active = 1;
+  return true;
 }
 
+static void db_xfer_isr(uint8_t rhport, uint8_t ep_id) {
+  ep_cmd_sts_t* ep_cs = get_ep_cs(ep_id);
+  xfer_dma_t* xfer = &_dcd.dma[ep_id];
+  bool is_short = false;
+
+  // Both buffers may be completed before interrupt is serviced: process them in the order they were armed
+  while (xfer->buf_count && !ep_cs[xfer->buf_idx].cmd_sts.active) {
+    uint8_t const idx = xfer->buf_idx;
+    uint16_t const remaining = ep_cs[idx].buffer_fs.nbytes;
+
+    xfer->xferred_bytes += xfer->db_nbytes[idx] - remaining;
+    xfer->buf_idx ^= 1;
+    xfer->buf_count--;
+
+    if (remaining) {
+      is_short = true;
+      break;
+    }
+
+    if (xfer->queued_bytes < xfer->total_bytes) {
+      db_arm_next(rhport, ep_id);
+    }
+  }
+
+  if (is_short && xfer->buf_count) {
+    // OUT transfer is ended by short packet while other buffer is still armed: deactivate it
+    dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+    uint8_t const idx = xfer->buf_idx;
+
+    if (ep_cs[idx].cmd_sts.active) {
+      dcd_reg->EPSKIP = TU_BIT(ep_id);
+      while (dcd_reg->EPSKIP & TU_BIT(ep_id)) {}
+    }
+
+    // host may already send next transfer's packet into it
+    uint16_t const received = xfer->db_nbytes[idx] - ep_cs[idx].buffer_fs.nbytes;
+    if (received) {
+      xfer->carry_short = (received < NBYTES_CBI_FS_MAX) ? 1 : 0;
+      xfer->carry_len   = received;
+      xfer->carry_buf   = xfer->buffer + xfer->queued_bytes - xfer->db_nbytes[idx];
+    }
+    xfer->buf_count = 0;
+  }
+
+  if (xfer->buf_count == 0 && xfer->buffer) {
+    xfer->buffer = NULL;
+    uint8_t const ep_addr = tu_edpt_addr(ep_id / 2, ep_id & 0x01);
+    dcd_event_xfer_complete(rhport, ep_addr, xfer->xferred_bytes, XFER_RESULT_SUCCESS, true);
+  }
+}
+#endif
+
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
   uint8_t const ep_id = ep_addr2id(ep_addr);
 
@@ -460,10 +608,15 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
     buffer = (uint8_t *) (uint32_t) dummy;
   }
 
+#if CFG_TUD_IP3511_DOUBLE_BUFFER
+  if (ep_is_double_buffered(rhport, ep_id)) {
+    return db_xfer_start(rhport, ep_id, buffer, total_bytes);
+  }
+#endif
+
   tu_memclr(&_dcd.dma[ep_id], sizeof(xfer_dma_t));
   _dcd.dma[ep_id].total_bytes = total_bytes;
-
-  prepare_ep_xfer(rhport, ep_id, get_buf_offset(buffer), total_bytes);
+  _dcd.dma[ep_id].nbytes = prepare_ep_xfer(rhport, ep_id, 0, get_buf_offset(buffer), total_bytes);
 
   return true;
 }
@@ -498,6 +651,13 @@ static void process_xfer_isr(uint8_t rhport, uint32_t int_status) {
 
   for(uint8_t ep_id = 0; ep_id < max_ep; ep_id++ ) {
     if ( tu_bit_test(int_status, ep_id) ) {
+      #if CFG_TUD_IP3511_DOUBLE_BUFFER
+      if ( ep_is_double_buffered(rhport, ep_id) ) {
+        db_xfer_isr(rhport, ep_id);
+        continue;
+      }
+      #endif
+
       ep_cmd_sts_t * ep_cs = &_dcd.ep[ep_id][0];
       xfer_dma_t* xfer_dma = &_dcd.dma[ep_id];
 
@@ -530,7 +690,7 @@ static void process_xfer_isr(uint8_t rhport, uint32_t int_status) {
       if ( (buf_nbytes == 0) && (xfer_dma->total_bytes > xfer_dma->xferred_bytes) ) {
         // There is more data to transfer
         // buff_offset has been already increased by hw to correct value for next transfer
-        prepare_ep_xfer(rhport, ep_id, buf_offset, xfer_dma->total_bytes - xfer_dma->xferred_bytes);
+        xfer_dma->nbytes = prepare_ep_xfer(rhport, ep_id, 0, buf_offset, xfer_dma->total_bytes - xfer_dma->xferred_bytes);
       } else {
         // for detecting ZLP
         xfer_dma->total_bytes = xfer_dma->xferred_bytes;
@@ -544,7 +704,7 @@ static void process_xfer_isr(uint8_t rhport, uint32_t int_status) {
   }
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
 
@@ -268,6 +268,27 @@ void hcd_port_reset_end(uint8_t rhport)
   (void) rhport;
 }
 
+bool hcd_port_suspend(uint8_t hostid)
+{
+  // write 1 to Port Suspend Status: SetPortSuspend
+  TU_VERIFY(OHCI_REG->rhport_status_bit[hostid].port_enable_status);
+  OHCI_REG->rhport_status[hostid] = RHPORT_PORT_SUSPEND_STATUS_MASK;
+  return true;
+}
+
+bool hcd_port_resume(uint8_t hostid)
+{
+  // write 1 to Port Over Current Indicator: ClearSuspendStatus, HC drives resume signaling for 20ms
+  // and sets Port Suspend Status Change when complete
+  OHCI_REG->rhport_status[hostid] = RHPORT_PORT_OVER_CURRENT_INDICATOR_MASK;
+  return true;
+}
+
+void hcd_port_resume_end(uint8_t rhport)
+{
+  (void) rhport;
+}
+
 bool hcd_port_connect_status(uint8_t hostid)
 {
   return OHCI_REG->rhport_status_bit[hostid].current_connect_status;
@@ -532,17 +553,61 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   }else
   {
     ohci_ed_t * ed = ed_from_addr(dev_addr, ep_addr);
-    ohci_gtd_t* gtd = gtd_find_free();
+    uint8_t const ed_idx = (uint8_t) (ed - ohci_data.ed_pool);
+
+    // A TD can only cross one 4K page boundary, chain more TDs for larger buffer. Except the last one, TD length
+    // is multiple of max packet size and short packet is an error (data underrun) that halts the ED so that HC
+    // does not continue with the rest of the chain. Only the last TD interrupts on complete.
+    ohci_gtd_t* head = NULL;
+    ohci_gtd_t* prev = NULL;
+    uint32_t remaining = buflen;
+
+    do {
+      uint32_t len = 8192u - tu_offset4k((uint32_t) buffer);
+      if (remaining > len) {
+        len -= len % ed->max_packet_size;
+      } else {
+        len = remaining;
+      }
+
+      ohci_gtd_t* gtd = gtd_find_free();
+      if (gtd == NULL) {
+        // not enough TD, free allocated ones
+        while (head) {
+          head->used = 0;
+          head = head->next ? (ohci_gtd_t*) _virt_addr((void*) head->next) : NULL;
+        }
+        TU_ASSERT(false);
+      }
 
-    TU_ASSERT(gtd);
+      gtd_init(gtd, buffer, (uint16_t) len);
+      gtd->index = ed_idx;
 
-    gtd_init(gtd, buffer, buflen);
-    gtd->index = ed-ohci_data.ed_pool;
-    gtd->delay_interrupt = OHCI_INT_ON_COMPLETE_YES;
+      if (prev) {
+        prev->next = (uint32_t) _phys_addr(gtd);
+      } else {
+        head = gtd;
+      }
+
+      prev = gtd;
+      buffer += len;
+      remaining -= len;
+    } while (remaining);
+
+    if (head != prev) {
+      // all TDs except the last one do not allow short packet
+      for (ohci_gtd_t* gtd = head; gtd != prev; gtd = (ohci_gtd_t*) _virt_addr((void*) gtd->next)) {
+        gtd->buffer_rounding = 0;
+      }
+    }
+    tusb_xfer_type_t xfer_type = ed_get_xfer_type(ed);
 
-    td_insert_to_ed(ed, gtd);
+    // last TD marks the transfer end, bulk completion interrupt may be delayed to coalesce with others
+    prev->delay_interrupt = (TUSB_XFER_BULK == xfer_type) ? CFG_TUH_OHCI_BULK_INT_DELAY : OHCI_INT_ON_COMPLETE_YES;
+
+    ohci_data.ed_extra[ed_idx].xferred_bytes = 0;
+    td_insert_to_ed(ed, head);
 
-    tusb_xfer_type_t xfer_type = ed_get_xfer_type( ed_from_addr(dev_addr, ep_addr) );
     if (TUSB_XFER_BULK == xfer_type) OHCI_REG->command_status_bit.bulk_list_filled = 1;
   }
 
@@ -631,6 +696,23 @@ static inline uint32_t gtd_xfer_byte_left(uint32_t buffer_end, uint32_t current_
       tu_offset4k(buffer_end) - tu_offset4k(current_buffer) + 1;
 }
 
+// Free remaining TDs of current transfer (up to the one with interrupt on complete) queued in a halted ED
+static void ed_remove_xfer_tds(ohci_ed_t* ed)
+{
+  uint32_t td_addr = tu_align16(ed->td_head.address);
+
+  while (td_addr)
+  {
+    ohci_gtd_t* gtd = (ohci_gtd_t*) _virt_addr((void*) td_addr);
+    td_addr = tu_align16(gtd->next);
+    gtd->used = 0;
+    if (gtd->delay_interrupt != OHCI_INT_ON_COMPLETE_NO) break;
+  }
+
+  // keep halted and toggle carry bits
+  ed->td_head.address = td_addr | (ed->td_head.address & 0x0Ful);
+}
+
 static void done_queue_isr(uint8_t hostid)
 {
   (void) hostid;
@@ -644,14 +726,44 @@ static void done_queue_isr(uint8_t hostid)
     // TODO check if td_head is iso td
     //------------- Non ISO transfer -------------//
     ohci_gtd_t * const qtd = (ohci_gtd_t *) td_head;
-    xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
+    xfer_result_t event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
                                 (qtd->condition_code == OHCI_CCODE_STALL) ? XFER_RESULT_STALLED : XFER_RESULT_FAILED;
 
     qtd->used = 0; // free TD
-    if ( (qtd->delay_interrupt == OHCI_INT_ON_COMPLETE_YES) || (event != XFER_RESULT_SUCCESS) )
+
+    ohci_ed_t * const ed  = gtd_get_ed(qtd);
+    uint32_t xferred_bytes = gtd_get_extra_data(qtd)->expected_bytes - gtd_xfer_byte_left((uint32_t) qtd->buffer_end, (uint32_t) qtd->current_buffer_pointer);
+    bool is_last = (qtd->delay_interrupt != OHCI_INT_ON_COMPLETE_NO);
+
+    if ( !gtd_is_control(qtd) )
+    {
+      // chained TDs: accumulate transferred bytes, only complete transfer is reported to usbh
+      ed_extra_data_t* ed_extra = &ohci_data.ed_extra[ed - ohci_data.ed_pool];
+      ed_extra->xferred_bytes = (uint16_t) (ed_extra->xferred_bytes + xferred_bytes);
+
+      if ( !is_last && (event != XFER_RESULT_SUCCESS) )
+      {
+        // remove the rest of the chain from halted ED
+        ed_remove_xfer_tds(ed);
+        is_last = true;
+
+        if ( qtd->condition_code == OHCI_CCODE_DATA_UNDERRUN )
+        {
+          // short packet in the middle of the chain: transfer completes successfully
+          event = XFER_RESULT_SUCCESS;
+          ed->td_head.halted = 0;
+        }
+      }
+
+      if ( is_last )
+      {
+        xferred_bytes = ed_extra->xferred_bytes;
+        ed_extra->xferred_bytes = 0;
+      }
+    }
+
+    if ( is_last || (event != XFER_RESULT_SUCCESS) )
     {
-      ohci_ed_t * const ed  = gtd_get_ed(qtd);
-      uint32_t const xferred_bytes = gtd_get_extra_data(qtd)->expected_bytes - gtd_xfer_byte_left((uint32_t) qtd->buffer_end, (uint32_t) qtd->current_buffer_pointer);
 
       // NOTE Assuming the current list is BULK and there is no other EDs in the list has queued TDs.
       // When there is a error resulting this ED is halted, and this EP still has other queued TD
@@ -676,7 +788,7 @@ static void done_queue_isr(uint8_t hostid)
   }
 }
 
-void hcd_int_handler(uint8_t hostid, bool in_isr) {
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t hostid, bool in_isr) {
   (void) in_isr;
 
   uint32_t const int_en     = OHCI_REG->interrupt_enable;
@@ -715,7 +827,8 @@ void hcd_int_handler(uint8_t hostid, bool in_isr) {
 
       if ( rhport_status & RHPORT_PORT_SUSPEND_CHANGE_MASK)
       {
-
+        // resume is complete, either remote wakeup or hcd_port_resume()
+        hcd_event_device_resume(i, true);
       }
 
       OHCI_REG->rhport_status[i] = rhport_status; // acknowledge all interrupt
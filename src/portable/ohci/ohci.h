@@ -43,7 +43,20 @@ enum {
 };
 
 #define ED_MAX       (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
-#define GTD_MAX      ED_MAX
+// General TD pool, transfer crossing more than one 4K page boundary is chained across multiple TDs
+#ifndef CFG_TUH_OHCI_GTD_MAX
+  #define GTD_MAX    ED_MAX
+#else
+  #define GTD_MAX    CFG_TUH_OHCI_GTD_MAX
+#endif
+
+// Frames (0-6) HC may delay the done queue interrupt of a completed bulk transfer, so that completions of several
+// transfers are coalesced into one WDH interrupt. Control and interrupt transfers always interrupt immediately.
+#ifndef CFG_TUH_OHCI_BULK_INT_DELAY
+  #define CFG_TUH_OHCI_BULK_INT_DELAY   0
+#endif
+
+TU_VERIFY_STATIC(CFG_TUH_OHCI_BULK_INT_DELAY <= 6, "CFG_TUH_OHCI_BULK_INT_DELAY must be 0-6 frames");
 
 // tinyUSB's OHCI implementation caps number of EDs to 8 bits
 TU_VERIFY_STATIC (ED_MAX <= 256, "Reduce CFG_TUH_DEVICE_MAX or CFG_TUH_ENDPOINT_MAX");
@@ -158,6 +171,10 @@ typedef struct {
   uint16_t expected_bytes; // up to 8192 bytes so max is 13 bits
 } gtd_extra_data_t;
 
+typedef struct {
+  uint16_t xferred_bytes; // accumulated from retired TDs of current transfer
+} ed_extra_data_t;
+
 // structure with member alignment required from large to small
 typedef struct TU_ATTR_ALIGNED(256) {
   ohci_hcca_t hcca;
@@ -178,6 +195,7 @@ typedef struct TU_ATTR_ALIGNED(256) {
   // extra data needed by TDs that can't fit in the TD struct
   gtd_extra_data_t gtd_extra_control[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1];
   gtd_extra_data_t gtd_extra[GTD_MAX];
+  ed_extra_data_t ed_extra[ED_MAX];
 
   volatile uint16_t frame_number_hi;
 } ohci_data_t;
@@ -34,6 +34,10 @@
 
 #include "device/dcd.h"
 
+#if CFG_TUD_RPI_PIO_USB_DEDICATED_CORE
+#include "hardware/sync.h"
+#endif
+
 //--------------------------------------------------------------------+
 // MACRO TYPEDEF CONSTANT ENUM DECLARATION
 //--------------------------------------------------------------------+
@@ -45,6 +49,11 @@
 static usb_device_t *usb_device = NULL;
 static usb_descriptor_buffers_t desc;
 
+#if CFG_TUD_RPI_PIO_USB_DEDICATED_CORE
+static volatile bool _core_init_req = false; // set by dcd_init()
+static volatile bool _core_ready = false;    // set by dedicated core once PIO device is initialized
+#endif
+
 /*------------------------------------------------------------------*/
 /* Device API
  *------------------------------------------------------------------*/
@@ -54,9 +63,39 @@ void dcd_init (uint8_t rhport)
 {
   (void) rhport;
 
+#if CFG_TUD_RPI_PIO_USB_DEDICATED_CORE
+  // PIO and its interrupts are set up on the dedicated core, wait until it is done
+  _core_init_req = true;
+  while (!_core_ready) {
+    tight_loop_contents();
+  }
+  __dmb();
+#else
+  static pio_usb_configuration_t config = PIO_USB_DEFAULT_CONFIG;
+  usb_device = pio_usb_device_init(&config, &desc);
+#endif
+}
+
+#if CFG_TUD_RPI_PIO_USB_DEDICATED_CORE
+// Entry of the core dedicated to USB: initialize PIO device on this core (so that PIO/timer interrupts are serviced
+// here) then poll the device state machine forever. DCD events are generated on this core and handed to tud_task()
+// on the other core through the usbd event queue, which is protected by a multicore-safe spin lock.
+void __no_inline_not_in_flash_func(dcd_pio_usb_core_loop)(void)
+{
+  while (!_core_init_req) {
+    tight_loop_contents();
+  }
+
   static pio_usb_configuration_t config = PIO_USB_DEFAULT_CONFIG;
   usb_device = pio_usb_device_init(&config, &desc);
+  __dmb();
+  _core_ready = true;
+
+  while (1) {
+    pio_usb_device_task();
+  }
 }
+#endif
 
 // Enable device interrupt
 void dcd_int_enable (uint8_t rhport)
@@ -45,13 +45,41 @@
 
 static pio_usb_configuration_t pio_host_cfg = PIO_USB_DEFAULT_CONFIG;
 
+// Additional root ports share the PIO state machines and SOF timer (frame schedule) of the first one, only their
+// pins are configured. pin_dp = 0 means not used.
+typedef struct {
+  uint8_t pin_dp;
+  PIO_USB_PINOUT pinout;
+} pio_port_cfg_t;
+
+static pio_port_cfg_t _extra_port[PIO_USB_ROOT_PORT_CNT > 1 ? PIO_USB_ROOT_PORT_CNT - 1 : 1];
+static bool _host_inited = false;
+
 //--------------------------------------------------------------------+
 // HCD API
 //--------------------------------------------------------------------+
+
+// rhport RHPORT_OFFSET (or lower) configures the PIO host (pio, dma, pins of first root port). Higher rhport adds a
+// root port using only pin_dp/pinout of the configuration, ports configured after tuh_init() are added immediately.
 bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
-  (void) rhport;
   TU_VERIFY(cfg_id == TUH_CFGID_RPI_PIO_USB_CONFIGURATION);
-  memcpy(&pio_host_cfg, cfg_param, sizeof(pio_usb_configuration_t));
+  pio_usb_configuration_t const *cfg = (pio_usb_configuration_t const *) cfg_param;
+
+  if (rhport <= RHPORT_OFFSET) {
+    memcpy(&pio_host_cfg, cfg, sizeof(pio_usb_configuration_t));
+  } else {
+    uint8_t const pio_rhport = RHPORT_PIO(rhport);
+    TU_VERIFY(pio_rhport < PIO_USB_ROOT_PORT_CNT);
+
+    pio_port_cfg_t *port = &_extra_port[pio_rhport - 1];
+    port->pin_dp = cfg->pin_dp;
+    port->pinout = cfg->pinout;
+
+    if (_host_inited) {
+      TU_ASSERT(pio_usb_host_add_port(port->pin_dp, port->pinout) == 0);
+    }
+  }
+
   return true;
 }
 
@@ -60,6 +88,16 @@ bool hcd_init(uint8_t rhport) {
 
   // To run USB SOF interrupt in core1, call this init in core1
   pio_usb_host_init(&pio_host_cfg);
+  _host_inited = true;
+
+  // add configured root ports in order so that their root index matches rhport
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(_extra_port); i++) {
+    pio_port_cfg_t const *port = &_extra_port[i];
+    if (port->pin_dp == 0) {
+      break;
+    }
+    TU_ASSERT(pio_usb_host_add_port(port->pin_dp, port->pinout) == 0);
+  }
 
   return true;
 }
@@ -163,13 +201,14 @@ static void __no_inline_not_in_flash_func(handle_endpoint_irq)(root_port_t *rpor
   (void) rport;
   const uint32_t ep_all = *ep_reg;
 
-  for ( uint8_t ep_idx = 0; ep_idx < PIO_USB_EP_POOL_CNT; ep_idx++ ) {
-    uint32_t const mask = (1u << ep_idx);
+  // only visit completed endpoints: with many root ports most of the pool is idle in a given frame
+  uint32_t pending = ep_all;
+  while (pending) {
+    uint8_t const ep_idx = (uint8_t) __builtin_ctz(pending);
+    pending &= pending - 1;
 
-    if ( ep_all & mask ) {
-      endpoint_t * ep = PIO_USB_ENDPOINT(ep_idx);
-      hcd_event_xfer_complete(ep->dev_addr, ep->ep_num, ep->actual_len, result, true);
-    }
+    endpoint_t * ep = PIO_USB_ENDPOINT(ep_idx);
+    hcd_event_xfer_complete(ep->dev_addr, ep->ep_num, ep->actual_len, result, true);
   }
 
   // clear all
@@ -182,6 +221,11 @@ void __no_inline_not_in_flash_func(pio_usb_host_irq_handler)(uint8_t root_id) {
   root_port_t *rport = PIO_USB_ROOT_PORT(root_id);
   uint32_t const ints = rport->ints;
 
+  // invoked for every root port each frame, return early when there is no activity
+  if (ints == 0) {
+    return;
+  }
+
   if ( ints & PIO_USB_INTS_ENDPOINT_COMPLETE_BITS ) {
     handle_endpoint_irq(rport, XFER_RESULT_SUCCESS, &rport->ep_complete);
   }
@@ -70,8 +70,9 @@ static void _hw_endpoint_alloc(struct hw_endpoint* ep, uint8_t transfer_type) {
   // size must be multiple of 64
   uint size = tu_div_ceil(ep->wMaxPacketSize, 64) * 64u;
 
-  // double buffered Bulk endpoint
-  if (transfer_type == TUSB_XFER_BULK) {
+  // double buffered Bulk (and Interrupt) endpoint
+  bool const dbuf = hw_endpoint_is_double_buffered(ep);
+  if (dbuf || transfer_type == TUSB_XFER_BULK) {
     size *= 2u;
   }
 
@@ -85,7 +86,10 @@ static void _hw_endpoint_alloc(struct hw_endpoint* ep, uint8_t transfer_type) {
   pico_info("  Allocated %d bytes at offset 0x%x (0x%p)\r\n", size, dpram_offset, ep->hw_data_buf);
 
   // Fill in endpoint control register with buffer offset
-  uint32_t const reg = EP_CTRL_ENABLE_BITS | ((uint) transfer_type << EP_CTRL_BUFFER_TYPE_LSB) | dpram_offset;
+  uint32_t reg = EP_CTRL_ENABLE_BITS | ((uint) transfer_type << EP_CTRL_BUFFER_TYPE_LSB) | dpram_offset;
+  if (dbuf) {
+    reg |= EP_CTRL_DOUBLE_BUFFERED_BITS | EP_CTRL_INTERRUPT_PER_BUFFER;
+  }
 
   *ep->endpoint_control = reg;
 }
@@ -164,7 +168,25 @@ static void hw_endpoint_init(uint8_t ep_addr, uint16_t wMaxPacketSize, uint8_t t
 
 static void hw_endpoint_xfer(uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
   struct hw_endpoint* ep = hw_endpoint_get_by_addr(ep_addr);
-  hw_endpoint_xfer_start(ep, buffer, total_bytes);
+
+  // Double buffered OUT endpoint may hold a packet received ahead, which is synced (and can complete
+  // the transfer) here: keep our ISR out meanwhile
+  bool const irq_en = irq_is_enabled(USBCTRL_IRQ);
+  irq_set_enabled(USBCTRL_IRQ, false);
+
+  bool const done = hw_endpoint_xfer_start(ep, buffer, total_bytes);
+  uint16_t const xferred_len = ep->xferred_len;
+  if (done) {
+    hw_endpoint_reset_transfer(ep);
+  }
+
+  if (irq_en) {
+    irq_set_enabled(USBCTRL_IRQ, true);
+  }
+
+  if (done) {
+    dcd_event_xfer_complete(0, ep_addr, xferred_len, XFER_RESULT_SUCCESS, false);
+  }
 }
 
 static void __tusb_irq_path_func(hw_handle_buff_status)(void) {
@@ -180,7 +202,9 @@ static void __tusb_irq_path_func(hw_handle_buff_status)(void) {
       struct hw_endpoint* ep = hw_endpoint_get_by_num(i >> 1u, (i & 1u) ? TUSB_DIR_OUT : TUSB_DIR_IN);
 
       // Continue xfer
+      TU_PROF_BEGIN(TU_PROF_FIFO);
       bool done = hw_endpoint_xfer_continue(ep);
+      TU_PROF_END(0, TU_PROF_FIFO);
       if (done) {
         // Notify
         dcd_event_xfer_complete(0, ep->ep_addr, ep->xferred_len, XFER_RESULT_SUCCESS, true);
@@ -238,6 +262,7 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
   uint32_t handled = 0;
 
   if (status & USB_INTF_DEV_SOF_BITS) {
+    TU_PROF_BEGIN(TU_PROF_SOF);
     bool keep_sof_alive = false;
 
     handled |= USB_INTF_DEV_SOF_BITS;
@@ -270,16 +295,20 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
     if (!keep_sof_alive && !_sof_enable) usb_hw_clear->inte = USB_INTS_DEV_SOF_BITS;
 
     dcd_event_sof(0, usb_hw->sof_rd & USB_SOF_RD_BITS, true);
+    TU_PROF_END(0, TU_PROF_SOF);
   }
 
   // xfer events are handled before setup req. So if a transfer completes immediately
   // before closing the EP, the events will be delivered in same order.
   if (status & USB_INTS_BUFF_STATUS_BITS) {
     handled |= USB_INTS_BUFF_STATUS_BITS;
+    TU_PROF_BEGIN(TU_PROF_XFER);
     hw_handle_buff_status();
+    TU_PROF_END(0, TU_PROF_XFER);
   }
 
   if (status & USB_INTS_SETUP_REQ_BITS) {
+    TU_PROF_BEGIN(TU_PROF_SETUP);
     handled |= USB_INTS_SETUP_REQ_BITS;
     uint8_t const* setup = remove_volatile_cast(uint8_t const*, &usb_dpram->setup_packet);
 
@@ -289,6 +318,7 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
     // Pass setup packet to tiny usb
     dcd_event_setup_received(0, setup, true);
     usb_hw_clear->sie_status = USB_SIE_STATUS_SETUP_REC_BITS;
+    TU_PROF_END(0, TU_PROF_SETUP);
   }
 
 #if FORCE_VBUS_DETECT == 0
@@ -314,6 +344,7 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
   // SE0 for 2.5 us or more (will last at least 10ms)
   if (status & USB_INTS_BUS_RESET_BITS) {
     pico_trace("BUS RESET\r\n");
+    TU_PROF_BEGIN(TU_PROF_BUS);
 
     handled |= USB_INTS_BUS_RESET_BITS;
 
@@ -326,6 +357,7 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
     // Only run enumeration workaround if pull up is enabled
     if (usb_hw->sie_ctrl & USB_SIE_CTRL_PULLUP_EN_BITS) rp2040_usb_device_enumeration_fix();
 #endif
+    TU_PROF_END(0, TU_PROF_BUS);
   }
 
   /* Note from pico datasheet 4.1.2.6.4 (v1.2)
@@ -353,6 +385,18 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
   }
 }
 
+#if CFG_TUSB_PROF
+// IRQ is registered by driver instead of application calling tud_int_handler() which profiles whole ISR
+static void __tusb_irq_path_func(dcd_rp2040_irq_prof)(void) {
+  TU_PROF_BEGIN(TU_PROF_ISR);
+  dcd_rp2040_irq();
+  TU_PROF_END(0, TU_PROF_ISR);
+}
+  #define DCD_RP2040_IRQ_HANDLER  dcd_rp2040_irq_prof
+#else
+  #define DCD_RP2040_IRQ_HANDLER  dcd_rp2040_irq
+#endif
+
 #define USB_INTS_ERROR_BITS ( \
     USB_INTS_ERROR_DATA_SEQ_BITS      |  \
     USB_INTS_ERROR_BIT_STUFF_BITS     |  \
@@ -364,11 +408,6 @@ static void __tusb_irq_path_func(dcd_rp2040_irq)(void) {
 /* Controller API
  *------------------------------------------------------------------*/
 
-// older SDK
-#ifndef PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY
-#define PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY 0xff
-#endif
-
 void dcd_init(uint8_t rhport) {
   assert(rhport == 0);
 
@@ -382,7 +421,7 @@ void dcd_init(uint8_t rhport) {
   usb_hw->pwr = USB_USB_PWR_VBUS_DETECT_BITS | USB_USB_PWR_VBUS_DETECT_OVERRIDE_EN_BITS;
 #endif
 
-  irq_add_shared_handler(USBCTRL_IRQ, dcd_rp2040_irq, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+  rp2040_usb_irq_handler_set(DCD_RP2040_IRQ_HANDLER);
 
   // Init control endpoints
   tu_memclr(hw_endpoints[0], 2 * sizeof(hw_endpoint_t));
@@ -511,6 +550,7 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
   // stall and clear current pending buffer
   // may need to use EP_ABORT
   _hw_endpoint_buffer_control_set_value32(ep, USB_BUF_CTRL_STALL);
+  ep->buf_armed = 0;
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
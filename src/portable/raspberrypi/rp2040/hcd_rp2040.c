@@ -52,10 +52,32 @@
 #endif
 static_assert(PICO_USB_HOST_INTERRUPT_ENDPOINTS <= USB_MAX_ENDPOINTS, "");
 
+// Endpoints that do not get a hardware interrupt endpoint are scheduled by software on epx, together with
+// control transfers. Pending transfers take turns (round-robin), one that is NAKed for a whole frame gives
+// epx to the next one and backs off for a few frames.
+#ifndef CFG_TUH_RP2040_EPX_ENDPOINTS
+#define CFG_TUH_RP2040_EPX_ENDPOINTS 8
+#endif
+
+// Max number of frames a NAKed epx transfer backs off
+#define EPX_NAK_BACKOFF_MAX 8
+
+// Time for an in-flight full speed packet to finish after STOP_TRANS
+#define EPX_STOP_TRANS_US   80
+
 // Host mode uses one shared endpoint register for non-interrupt endpoint
 static struct hw_endpoint ep_pool[1 + PICO_USB_HOST_INTERRUPT_ENDPOINTS];
 #define epx (ep_pool[0])
 
+// Software scheduled endpoints sharing epx with control endpoint (index 0 of epx scheduler)
+static struct hw_endpoint epx_pool[CFG_TUH_RP2040_EPX_ENDPOINTS];
+#define EPX_SCHED_COUNT (1 + CFG_TUH_RP2040_EPX_ENDPOINTS)
+
+// Endpoint whose transfer is on epx hardware, last scheduled index, and setup packet queued on epx
+static struct hw_endpoint *epx_cur;
+static uint8_t epx_rr;
+static bool epx_setup;
+
 // Flags we set by default in sie_ctrl (we add other bits on top)
 enum {
   SIE_CTRL_BASE = USB_SIE_CTRL_SOF_EN_BITS      | USB_SIE_CTRL_KEEP_ALIVE_EN_BITS |
@@ -73,9 +95,48 @@ static struct hw_endpoint *get_dev_ep(uint8_t dev_addr, uint8_t ep_addr)
     if ( ep->configured && (ep->dev_addr == dev_addr) && (ep->ep_addr == ep_addr) ) return ep;
   }
 
+  for ( uint32_t i = 0; i < TU_ARRAY_SIZE(epx_pool); i++ )
+  {
+    struct hw_endpoint *ep = &epx_pool[i];
+    if ( ep->configured && (ep->dev_addr == dev_addr) && (ep->ep_addr == ep_addr) ) return ep;
+  }
+
   return NULL;
 }
 
+// Endpoint uses the shared epx registers
+TU_ATTR_ALWAYS_INLINE static inline bool is_epx_user(struct hw_endpoint const *ep)
+{
+  return ep->endpoint_control == &usbh_dpram->epx_ctrl;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline struct hw_endpoint *epx_sched_ep(uint i)
+{
+  return i ? &epx_pool[i - 1] : &epx;
+}
+
+// Transfer is waiting for epx hardware
+TU_ATTR_ALWAYS_INLINE static inline bool epx_is_queued(struct hw_endpoint const *ep)
+{
+  return ep->active && ep->pending;
+}
+
+static uint32_t hw_endpoint_ctrl_value(struct hw_endpoint *ep)
+{
+  uint32_t ep_reg = EP_CTRL_ENABLE_BITS
+                    | EP_CTRL_INTERRUPT_PER_BUFFER
+                    | (ep->transfer_type << EP_CTRL_BUFFER_TYPE_LSB)
+                    | hw_data_offset(ep->hw_data_buf);
+
+  // polling interval is only used by hardware interrupt endpoints
+  if ( ep->interval && !is_epx_user(ep) )
+  {
+    ep_reg |= (uint32_t) ((ep->interval - 1) << EP_CTRL_HOST_INTERRUPT_INTERVAL_LSB);
+  }
+
+  return ep_reg;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline uint8_t dev_speed(void)
 {
   return (usb_hw->sie_status & USB_SIE_STATUS_SPEED_BITS) >> USB_SIE_STATUS_SPEED_LSB;
@@ -98,6 +159,193 @@ static void __tusb_irq_path_func(hw_xfer_complete)(struct hw_endpoint *ep, xfer_
   hcd_event_xfer_complete(dev_addr, ep_addr, xferred_len, xfer_result, true);
 }
 
+//--------------------------------------------------------------------+
+// epx scheduler
+//--------------------------------------------------------------------+
+
+// Program shared epx registers for this endpoint and start its transfer
+static void __tusb_irq_path_func(epx_start)(struct hw_endpoint *ep)
+{
+  uint8_t const ep_num = tu_edpt_number(ep->ep_addr);
+  bool const setup = (ep == &epx) && epx_setup;
+
+  epx_cur = ep;
+  ep->pending = 0;
+  if ( setup ) epx_setup = false;
+
+  *ep->endpoint_control = hw_endpoint_ctrl_value(ep);
+  usb_hw_clear->sie_status = USB_SIE_STATUS_NAK_REC_BITS;
+  usb_hw->dev_addr_ctrl = (uint32_t) (ep->dev_addr | (ep_num << USB_ADDR_ENDP_ENDPOINT_LSB));
+
+  uint32_t flags = USB_SIE_CTRL_START_TRANS_BITS | SIE_CTRL_BASE |
+                   (need_pre(ep->dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
+
+  if ( setup )
+  {
+    flags |= USB_SIE_CTRL_SEND_SETUP_BITS;
+  }
+  else
+  {
+    // That has set up buffer control, for host we have to initiate the transfer
+    hw_endpoint_start_next_buffer(ep);
+    flags |= (tu_edpt_dir(ep->ep_addr) ? USB_SIE_CTRL_RECEIVE_DATA_BITS : USB_SIE_CTRL_SEND_DATA_BITS);
+  }
+
+  // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
+  // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
+  // We write everything except the START_TRANS bit first, then wait some cycles.
+  usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
+  busy_wait_at_least_cycles(12);
+  usb_hw->sie_ctrl = flags;
+}
+
+// Start next queued transfer (round-robin) if epx is idle
+static void __tusb_irq_path_func(epx_schedule)(void)
+{
+  if ( epx_cur == NULL )
+  {
+    for ( uint n = 1; n <= EPX_SCHED_COUNT; n++ )
+    {
+      uint const i = (epx_rr + n) % EPX_SCHED_COUNT;
+      struct hw_endpoint *ep = epx_sched_ep(i);
+      if ( epx_is_queued(ep) && !ep->nak_wait )
+      {
+        epx_rr = (uint8_t) i;
+        epx_start(ep);
+        break;
+      }
+    }
+  }
+
+  // SOF interrupt is only needed (for back off and time slicing) while transfers are waiting
+  bool has_queued = false;
+  for ( uint i = 0; i < EPX_SCHED_COUNT; i++ )
+  {
+    if ( epx_is_queued(epx_sched_ep(i)) )
+    {
+      has_queued = true;
+      break;
+    }
+  }
+
+  if ( has_queued )
+  {
+    usb_hw_set->inte = USB_INTE_HOST_SOF_BITS;
+  }
+  else
+  {
+    usb_hw_clear->inte = USB_INTE_HOST_SOF_BITS;
+  }
+}
+
+// Queue transfer for epx, called in thread context
+static void epx_queue(struct hw_endpoint *ep, bool setup)
+{
+  bool const irq_en = irq_is_enabled(USBCTRL_IRQ);
+  irq_set_enabled(USBCTRL_IRQ, false);
+
+  if ( setup ) epx_setup = true;
+  ep->nak_wait = 0;
+  ep->pending = 1;
+  epx_schedule();
+
+  if ( irq_en ) irq_set_enabled(USBCTRL_IRQ, true);
+}
+
+static void __tusb_irq_path_func(epx_xfer_complete)(xfer_result_t xfer_result)
+{
+  struct hw_endpoint *ep = epx_cur;
+  epx_cur = NULL;
+  ep->nak_backoff = 0;
+
+  hw_xfer_complete(ep, xfer_result);
+  epx_schedule();
+}
+
+// Stop transfer that is NAKed and put it back to queue with back off, non-control epx transfers
+// are single buffered.
+static void __tusb_irq_path_func(epx_preempt)(void)
+{
+  struct hw_endpoint *ep = epx_cur;
+  bool data_moved = false;
+
+  usb_hw_set->sie_ctrl = USB_SIE_CTRL_STOP_TRANS_BITS;
+  busy_wait_us_32(EPX_STOP_TRANS_US);
+
+  if ( !(*ep->buffer_control & USB_BUF_CTRL_AVAIL) )
+  {
+    // Packet completed meanwhile, sync it
+    data_moved = true;
+    usb_hw_clear->buf_status = 1u;
+    if ( hw_endpoint_xfer_continue(ep) )
+    {
+      epx_xfer_complete(XFER_RESULT_SUCCESS);
+      return;
+    }
+  }
+
+  // Take back armed buffer, it is prepared again when the transfer is rescheduled
+  uint32_t const buf_ctrl = *ep->buffer_control;
+  if ( buf_ctrl & USB_BUF_CTRL_AVAIL )
+  {
+    uint16_t const len = buf_ctrl & USB_BUF_CTRL_LEN_MASK;
+    *ep->buffer_control = 0;
+
+    ep->remaining_len = (uint16_t) (ep->remaining_len + len);
+    ep->next_pid ^= 1u;
+    if ( !ep->rx ) ep->user_buf -= len;
+  }
+
+  if ( data_moved )
+  {
+    ep->nak_backoff = 0;
+  }
+  else
+  {
+    ep->nak_backoff = ep->nak_backoff ? tu_min8(2 * ep->nak_backoff, EPX_NAK_BACKOFF_MAX) : 1;
+  }
+
+  // interrupt endpoint is not polled more often than its bInterval while being NAKed
+  ep->nak_wait = (ep->transfer_type == TUSB_XFER_INTERRUPT) ? tu_max8(ep->interval, ep->nak_backoff) : ep->nak_backoff;
+  ep->pending = 1;
+  epx_cur = NULL;
+
+  pico_trace("epx preempt dev %u ep %02X, retry in %u frames\n", ep->dev_addr, ep->ep_addr, ep->nak_wait);
+}
+
+static void __tusb_irq_path_func(epx_sof_handler)(void)
+{
+  (void) usb_hw->sof_rd; // clear SOF interrupt
+
+  bool other_ready = false;
+  for ( uint i = 0; i < EPX_SCHED_COUNT; i++ )
+  {
+    struct hw_endpoint *ep = epx_sched_ep(i);
+    if ( epx_is_queued(ep) )
+    {
+      if ( ep->nak_wait ) ep->nak_wait--;
+      if ( !ep->nak_wait ) other_ready = true;
+    }
+  }
+
+  struct hw_endpoint *ep = epx_cur;
+  if ( ep )
+  {
+    // Control transfers are not preempted
+    if ( other_ready && tu_edpt_number(ep->ep_addr) && (usb_hw->sie_status & USB_SIE_STATUS_NAK_REC_BITS) )
+    {
+      epx_preempt();
+    }
+    else
+    {
+      // NAK_REC then tells whether the transfer was NAKed during next frame
+      usb_hw_clear->sie_status = USB_SIE_STATUS_NAK_REC_BITS;
+    }
+  }
+
+  epx_schedule();
+}
+
 static void __tusb_irq_path_func(_handle_buff_status_bit)(uint bit, struct hw_endpoint *ep)
 {
   usb_hw_clear->buf_status = bit;
@@ -120,20 +368,28 @@ static void __tusb_irq_path_func(hw_handle_buff_status)(void)
   if ( remaining_buffers & bit )
   {
     remaining_buffers &= ~bit;
-    struct hw_endpoint * ep = &epx;
+    usb_hw_clear->buf_status = bit;
 
-    uint32_t ep_ctrl = *ep->endpoint_control;
-    if ( ep_ctrl & EP_CTRL_DOUBLE_BUFFERED_BITS )
-    {
-      TU_LOG(3, "Double Buffered: ");
-    }
-    else
+    // Endpoint currently on epx
+    struct hw_endpoint * ep = epx_cur;
+    if ( ep )
     {
-      TU_LOG(3, "Single Buffered: ");
-    }
-    TU_LOG_HEX(3, ep_ctrl);
+      uint32_t ep_ctrl = *ep->endpoint_control;
+      if ( ep_ctrl & EP_CTRL_DOUBLE_BUFFERED_BITS )
+      {
+        TU_LOG(3, "Double Buffered: ");
+      }
+      else
+      {
+        TU_LOG(3, "Single Buffered: ");
+      }
+      TU_LOG_HEX(3, ep_ctrl);
 
-    _handle_buff_status_bit(bit, ep);
+      if ( hw_endpoint_xfer_continue(ep) )
+      {
+        epx_xfer_complete(XFER_RESULT_SUCCESS);
+      }
+    }
   }
 
   // Check "interrupt" (asynchronous) endpoints for both IN and OUT
@@ -170,10 +426,10 @@ static void __tusb_irq_path_func(hw_trans_complete)(void)
   {
     pico_trace("Sent setup packet\n");
     struct hw_endpoint *ep = &epx;
-    assert(ep->active);
+    assert(ep->active && epx_cur == ep);
     // Set transferred length to 8 for a setup packet
     ep->xferred_len = 8;
-    hw_xfer_complete(ep, XFER_RESULT_SUCCESS);
+    epx_xfer_complete(XFER_RESULT_SUCCESS);
   }
   else
   {
@@ -213,7 +469,7 @@ static void __tusb_irq_path_func(hcd_rp2040_irq)(void)
     pico_trace("Stall REC\n");
     handled |= USB_INTS_STALL_BITS;
     usb_hw_clear->sie_status = USB_SIE_STATUS_STALL_REC_BITS;
-    hw_xfer_complete(&epx, XFER_RESULT_STALLED);
+    if ( epx_cur ) epx_xfer_complete(XFER_RESULT_STALLED);
   }
 
   if ( status & USB_INTS_BUFF_STATUS_BITS )
@@ -231,6 +487,13 @@ static void __tusb_irq_path_func(hcd_rp2040_irq)(void)
     hw_trans_complete();
   }
 
+  // after buffer and transfer complete so that finished transfers are not preempted
+  if ( status & USB_INTS_HOST_SOF_BITS )
+  {
+    handled |= USB_INTS_HOST_SOF_BITS;
+    epx_sof_handler();
+  }
+
   if ( status & USB_INTS_ERROR_RX_TIMEOUT_BITS )
   {
     handled |= USB_INTS_ERROR_RX_TIMEOUT_BITS;
@@ -260,10 +523,9 @@ void __tusb_irq_path_func(hcd_int_handler)(uint8_t rhport, bool in_isr) {
 
 static struct hw_endpoint *_next_free_interrupt_ep(void)
 {
-  struct hw_endpoint * ep = NULL;
   for ( uint i = 1; i < TU_ARRAY_SIZE(ep_pool); i++ )
   {
-    ep = &ep_pool[i];
+    struct hw_endpoint * ep = &ep_pool[i];
     if ( !ep->configured )
     {
       // Will be configured by _hw_endpoint_init / _hw_endpoint_allocate
@@ -271,10 +533,78 @@ static struct hw_endpoint *_next_free_interrupt_ep(void)
       return ep;
     }
   }
-  return ep;
+  return NULL;
 }
 
-static struct hw_endpoint *_hw_endpoint_allocate(uint8_t transfer_type)
+static struct hw_endpoint *_next_free_epx_ep(void)
+{
+  for ( uint i = 0; i < TU_ARRAY_SIZE(epx_pool); i++ )
+  {
+    struct hw_endpoint * ep = &epx_pool[i];
+    if ( !ep->configured )
+    {
+      ep->buffer_control = &usbh_dpram->epx_buf_ctrl;
+      ep->endpoint_control = &usbh_dpram->epx_ctrl;
+      ep->hw_data_buf = &usbh_dpram->epx_data[0];
+      return ep;
+    }
+  }
+  return NULL;
+}
+
+// Hardware interrupt endpoints go to interrupt endpoints with smallest bInterval first, then bulk.
+// Larger value is lower priority.
+TU_ATTR_ALWAYS_INLINE static inline uint16_t _slot_priority(uint8_t transfer_type, uint8_t interval)
+{
+  return (transfer_type == TUSB_XFER_INTERRUPT) ? interval : 0x100u;
+}
+
+// No free hardware interrupt endpoint: take one from an idle endpoint with lower priority, which moves to epx
+static struct hw_endpoint *_hw_endpoint_reclaim(uint8_t transfer_type, uint8_t interval)
+{
+  uint16_t victim_prio = _slot_priority(transfer_type, interval);
+  struct hw_endpoint * victim = NULL;
+
+  for ( uint i = 1; i < TU_ARRAY_SIZE(ep_pool); i++ )
+  {
+    struct hw_endpoint * ep = &ep_pool[i];
+    uint16_t const prio = _slot_priority(ep->transfer_type, ep->interval);
+    if ( ep->configured && !ep->active && prio > victim_prio )
+    {
+      victim = ep;
+      victim_prio = prio;
+    }
+  }
+  TU_VERIFY(victim, NULL);
+
+  struct hw_endpoint * sw_ep = _next_free_epx_ep();
+  TU_VERIFY(sw_ep, NULL);
+
+  uint8_t const interrupt_num = victim->interrupt_num;
+  pico_info("Move dev %d ep %02X from interrupt ep %d to epx\n", victim->dev_addr, victim->ep_addr, interrupt_num);
+
+  // disable hardware interrupt endpoint
+  usb_hw_clear->int_ep_ctrl = (1 << (interrupt_num + 1));
+  usb_hw->int_ep_addr_ctrl[interrupt_num] = 0;
+  *victim->endpoint_control = 0;
+  *victim->buffer_control = 0;
+
+  // keep address, packet size and data toggle
+  io_rw_32 * const buffer_control = sw_ep->buffer_control;
+  io_rw_32 * const endpoint_control = sw_ep->endpoint_control;
+  uint8_t * const hw_data_buf = sw_ep->hw_data_buf;
+  *sw_ep = *victim;
+  sw_ep->buffer_control = buffer_control;
+  sw_ep->endpoint_control = endpoint_control;
+  sw_ep->hw_data_buf = hw_data_buf;
+
+  tu_memclr(victim, sizeof(hw_endpoint_t));
+  victim->interrupt_num = interrupt_num;
+
+  return victim;
+}
+
+static struct hw_endpoint *_hw_endpoint_allocate(uint8_t transfer_type, uint8_t interval)
 {
   struct hw_endpoint * ep = NULL;
 
@@ -283,8 +613,17 @@ static struct hw_endpoint *_hw_endpoint_allocate(uint8_t transfer_type)
     // Note: even though datasheet name these "Interrupt" endpoints. These are actually
     // "Asynchronous" endpoints and can be used for other type such as: Bulk  (ISO need confirmation)
     ep = _next_free_interrupt_ep();
+    if ( !ep ) ep = _hw_endpoint_reclaim(transfer_type, interval);
+
+    if ( !ep )
+    {
+      // Scheduled by software on epx
+      ep = _next_free_epx_ep();
+      if ( ep ) pico_info("Allocate %s ep on epx\n", tu_edpt_type_str(transfer_type));
+      return ep;
+    }
+
     pico_info("Allocate %s ep %d\n", tu_edpt_type_str(transfer_type), ep->interrupt_num);
-    assert(ep);
     ep->buffer_control = &usbh_dpram->int_ep_buffer_ctrl[ep->interrupt_num].ctrl;
     ep->endpoint_control = &usbh_dpram->int_ep_ctrl[ep->interrupt_num].ctrl;
     // 0 for epx (double buffered): TODO increase to 1024 for ISO
@@ -316,6 +655,7 @@ static void _hw_endpoint_init(struct hw_endpoint *ep, uint8_t dev_addr, uint8_t
 
   ep->ep_addr = ep_addr;
   ep->dev_addr = dev_addr;
+  ep->interval = bmInterval;
 
   // For host, IN to host == RX, anything else rx == false
   ep->rx = (dir == TUSB_DIR_IN);
@@ -329,25 +669,19 @@ static void _hw_endpoint_init(struct hw_endpoint *ep, uint8_t dev_addr, uint8_t
              ep_dir_string[tu_edpt_dir(ep->ep_addr)], ep->transfer_type);
   pico_trace("dev %d ep %d %s setup buffer @ 0x%p\n", ep->dev_addr, tu_edpt_number(ep->ep_addr),
              ep_dir_string[tu_edpt_dir(ep->ep_addr)], ep->hw_data_buf);
-  uint dpram_offset = hw_data_offset(ep->hw_data_buf);
   // Bits 0-5 should be 0
-  assert(!(dpram_offset & 0b111111));
+  assert(!(hw_data_offset(ep->hw_data_buf) & 0b111111));
 
-  // Fill in endpoint control register with buffer offset
-  uint32_t ep_reg = EP_CTRL_ENABLE_BITS
-                    | EP_CTRL_INTERRUPT_PER_BUFFER
-                    | (ep->transfer_type << EP_CTRL_BUFFER_TYPE_LSB)
-                    | dpram_offset;
-  if ( bmInterval )
-  {
-    ep_reg |= (uint32_t) ((bmInterval - 1) << EP_CTRL_HOST_INTERRUPT_INTERVAL_LSB);
-  }
-  *ep->endpoint_control = ep_reg;
-  pico_trace("endpoint control (0x%p) <- 0x%x\n", ep->endpoint_control, ep_reg);
   ep->configured = true;
 
-  if ( ep != &epx )
+  // epx registers are shared and written when the transfer is scheduled
+  if ( !is_epx_user(ep) )
   {
+    // Fill in endpoint control register with buffer offset
+    uint32_t const ep_reg = hw_endpoint_ctrl_value(ep);
+    *ep->endpoint_control = ep_reg;
+    pico_trace("endpoint control (0x%p) <- 0x%x\n", ep->endpoint_control, ep_reg);
+
     // Endpoint has its own addr_endp and interrupt bits to be setup!
     // This is an interrupt/async endpoint. so need to set up ADDR_ENDP register with:
     // - device address
@@ -389,13 +723,15 @@ bool hcd_init(uint8_t rhport)
   // Force VBUS detect to always present, for now we assume vbus is always provided (without using VBUS En)
   usb_hw->pwr = USB_USB_PWR_VBUS_DETECT_BITS | USB_USB_PWR_VBUS_DETECT_OVERRIDE_EN_BITS;
 
-  // Remove shared irq if it was previously added so as not to fill up shared irq slots
-  irq_remove_handler(USBCTRL_IRQ, hcd_rp2040_irq);
-
-  irq_add_shared_handler(USBCTRL_IRQ, hcd_rp2040_irq, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+  // Replace device handler (dual-role) and avoid adding the same shared irq twice on re-init
+  rp2040_usb_irq_handler_set(hcd_rp2040_irq);
 
   // clear epx and interrupt eps
   memset(&ep_pool, 0, sizeof(ep_pool));
+  memset(&epx_pool, 0, sizeof(epx_pool));
+  epx_cur = NULL;
+  epx_rr = 0;
+  epx_setup = false;
 
   // Enable in host mode with SOF / Keep alive on
   usb_hw->main_ctrl = USB_MAIN_CTRL_CONTROLLER_EN_BITS | USB_MAIN_CTRL_HOST_NDEVICE_BITS;
@@ -458,6 +794,9 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
 
   if (dev_addr == 0) return;
 
+  bool const irq_en = irq_is_enabled(USBCTRL_IRQ);
+  irq_set_enabled(USBCTRL_IRQ, false);
+
   for (size_t i = 1; i < TU_ARRAY_SIZE(ep_pool); i++)
   {
     hw_endpoint_t* ep = &ep_pool[i];
@@ -475,6 +814,30 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
       hw_endpoint_reset_transfer(ep);
     }
   }
+
+  for (size_t i = 0; i < TU_ARRAY_SIZE(epx_pool); i++)
+  {
+    hw_endpoint_t* ep = &epx_pool[i];
+
+    if (ep->dev_addr == dev_addr && ep->configured)
+    {
+      // epx registers are shared, only touch them if this endpoint is using them
+      if (ep == epx_cur)
+      {
+        usb_hw_set->sie_ctrl = USB_SIE_CTRL_STOP_TRANS_BITS;
+        busy_wait_us_32(EPX_STOP_TRANS_US);
+        *ep->buffer_control = 0;
+        epx_cur = NULL;
+      }
+
+      ep->configured = false;
+      hw_endpoint_reset_transfer(ep);
+    }
+  }
+
+  epx_schedule();
+
+  if (irq_en) irq_set_enabled(USBCTRL_IRQ, true);
 }
 
 uint32_t hcd_frame_number(uint8_t rhport)
@@ -509,7 +872,7 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
   pico_trace("hcd_edpt_open dev_addr %d, ep_addr %d\n", dev_addr, ep_desc->bEndpointAddress);
 
   // Allocated differently based on if it's an interrupt endpoint or not
-  struct hw_endpoint *ep = _hw_endpoint_allocate(ep_desc->bmAttributes.xfer);
+  struct hw_endpoint *ep = _hw_endpoint_allocate(ep_desc->bmAttributes.xfer, ep_desc->bInterval);
   TU_ASSERT(ep);
 
   _hw_endpoint_init(ep,
@@ -529,7 +892,7 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   pico_trace("hcd_edpt_xfer dev_addr %d, ep_addr 0x%x, len %d\n", dev_addr, ep_addr, buflen);
 
   uint8_t const ep_num = tu_edpt_number(ep_addr);
-  tusb_dir_t const ep_dir = tu_edpt_dir(ep_addr);
+  (void) ep_num;
 
   // Get appropriate ep. Either EPX or interrupt endpoint
   struct hw_endpoint *ep = get_dev_ep(dev_addr, ep_addr);
@@ -548,26 +911,15 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
     _hw_endpoint_init(ep, dev_addr, ep_addr, ep->wMaxPacketSize, ep->transfer_type, 0);
   }
 
-  // If a normal transfer (non-interrupt) then initiate using
-  // sie ctrl registers. Otherwise interrupt ep registers should
-  // already be configured
-  if ( ep == &epx )
+  // Transfer on epx is started by the scheduler using sie ctrl registers.
+  // Otherwise interrupt ep registers should already be configured
+  if ( is_epx_user(ep) )
   {
-    hw_endpoint_xfer_start(ep, buffer, buflen);
-
-    // That has set up buffer control, endpoint control etc
-    // for host we have to initiate the transfer
-    usb_hw->dev_addr_ctrl = (uint32_t) (dev_addr | (ep_num << USB_ADDR_ENDP_ENDPOINT_LSB));
-
-    uint32_t flags = USB_SIE_CTRL_START_TRANS_BITS | SIE_CTRL_BASE |
-                     (ep_dir ? USB_SIE_CTRL_RECEIVE_DATA_BITS : USB_SIE_CTRL_SEND_DATA_BITS) |
-                     (need_pre(dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
-    // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
-    // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
-    // We write everything except the START_TRANS bit first, then wait some cycles.
-    usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
-    busy_wait_at_least_cycles(12);
-    usb_hw->sie_ctrl = flags;
+    ep->remaining_len = buflen;
+    ep->xferred_len = 0;
+    ep->user_buf = buffer;
+    ep->active = true;
+    epx_queue(ep, false);
   }else
   {
     hw_endpoint_xfer_start(ep, buffer, buflen);
@@ -595,7 +947,7 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   }
 
   // Configure EP0 struct with setup info for the trans complete
-  struct hw_endpoint * ep = _hw_endpoint_allocate(0);
+  struct hw_endpoint * ep = _hw_endpoint_allocate(0, 0);
   TU_ASSERT(ep);
 
   // EPX should be inactive
@@ -608,19 +960,8 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   ep->remaining_len = 8;
   ep->active = true;
 
-  // Set device address
-  usb_hw->dev_addr_ctrl = dev_addr;
-
-  // Set pre if we are a low speed device on full speed hub
-  uint32_t const flags = SIE_CTRL_BASE | USB_SIE_CTRL_SEND_SETUP_BITS | USB_SIE_CTRL_START_TRANS_BITS |
-                         (need_pre(dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
-
-  // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
-  // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
-  // We write everything except the START_TRANS bit first, then wait some cycles.
-  usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
-  busy_wait_at_least_cycles(12);
-  usb_hw->sie_ctrl = flags;
+  // Setup is sent once epx is free, control transfers are never preempted
+  epx_queue(ep, true);
 
   return true;
 }
@@ -79,6 +79,21 @@ void rp2040_usb_init(void) {
   TU_LOG2_INT(sizeof(hw_endpoint_t));
 }
 
+// Only one of dcd/hcd handler must be installed, otherwise both would react to the same irq after a role switch
+static irq_handler_t _usb_irq_handler = NULL;
+
+void rp2040_usb_irq_handler_set(irq_handler_t handler) {
+  if (_usb_irq_handler == handler) {
+    return;
+  }
+
+  if (_usb_irq_handler) {
+    irq_remove_handler(USBCTRL_IRQ, _usb_irq_handler);
+  }
+  irq_add_shared_handler(USBCTRL_IRQ, handler, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+  _usb_irq_handler = handler;
+}
+
 void __tusb_irq_path_func(hw_endpoint_reset_transfer)(struct hw_endpoint* ep) {
   ep->active = false;
   ep->remaining_len = 0;
@@ -144,8 +159,111 @@ static uint32_t __tusb_irq_path_func(prepare_ep_buffer)(struct hw_endpoint* ep,
   return buf_ctrl;
 }
 
+//--------------------------------------------------------------------+
+// Device double buffered endpoint
+//
+// Endpoint control is configured once as double buffered with interrupt per buffer. Buffers complete
+// in the order they are used (starting with buffer 0 after USB_BUF_CTRL_SEL), the completed one is
+// re-armed with the next packet while hardware works with the other.
+// A short OUT packet completes the transfer while the other buffer may still be armed: it is kept
+// and continues the next transfer, so that a packet host sent right after is not lost.
+//--------------------------------------------------------------------+
+
+// Update buffer control of one buffer only, the other one may be in use by hardware
+static void __tusb_irq_path_func(_hw_endpoint_buffer_control_update16)(struct hw_endpoint* ep, uint8_t buf_id,
+                                                                      uint16_t value) {
+  io_rw_16* buf_ctrl16 = ((io_rw_16*) (uintptr_t) ep->buffer_control) + buf_id;
+
+  if (value & USB_BUF_CTRL_AVAIL) {
+    if (*buf_ctrl16 & USB_BUF_CTRL_AVAIL) {
+      panic("ep %02X buffer %u was already available", ep->ep_addr, buf_id);
+    }
+    // 4.1.2.5.1 Con-current access: 12 cycles after write to buffer control
+    *buf_ctrl16 = (uint16_t) (value & ~USB_BUF_CTRL_AVAIL);
+    busy_wait_at_least_cycles(12);
+  }
+
+  *buf_ctrl16 = value;
+}
+
+static void __tusb_irq_path_func(dbuf_arm_buffer)(struct hw_endpoint* ep, uint8_t buf_id, uint16_t extra_bits) {
+  ep->buf_len[buf_id] = tu_min16(ep->remaining_len, ep->wMaxPacketSize);
+
+  uint32_t const buf_ctrl = prepare_ep_buffer(ep, buf_id);
+  uint16_t const value = (uint16_t) ((buf_id ? tu_u32_high16(buf_ctrl) : tu_u32_low16(buf_ctrl)) | extra_bits);
+
+  ep->buf_armed |= (uint8_t) TU_BIT(buf_id);
+  _hw_endpoint_buffer_control_update16(ep, buf_id, value);
+}
+
+static void __tusb_irq_path_func(dbuf_start_next_buffer)(struct hw_endpoint* ep) {
+  if (ep->buf_armed == 0) {
+    // Idle: restart with buffer 0, this may also be a zero-length packet
+    ep->buf_next = 0;
+    dbuf_arm_buffer(ep, 0, USB_BUF_CTRL_SEL);
+  }
+
+  // Buffer after the one hardware is using
+  uint8_t const buf_id = ep->buf_next ^ 1u;
+  if (ep->remaining_len && !(ep->buf_armed & TU_BIT(buf_id))) {
+    dbuf_arm_buffer(ep, buf_id, 0);
+  }
+}
+
+// Sync a completed buffer, return true if it is a short packet
+static bool __tusb_irq_path_func(dbuf_sync_buffer)(struct hw_endpoint* ep, uint8_t buf_id) {
+  uint32_t buf_ctrl = _hw_endpoint_buffer_control_get_value32(ep);
+  if (buf_id) buf_ctrl = buf_ctrl >> 16;
+
+  uint16_t const xferred_bytes = buf_ctrl & USB_BUF_CTRL_LEN_MASK;
+
+  if (!ep->rx) {
+    ep->xferred_len = (uint16_t) (ep->xferred_len + xferred_bytes);
+  } else {
+    // A buffer armed by previous transfer could hold more than this transfer has room for
+    uint16_t const copy_len = tu_min16(xferred_bytes, ep->buf_len[buf_id]);
+    if (copy_len < xferred_bytes) {
+      TU_LOG(1, "WARN: ep %02X drop %u bytes exceeding transfer length\r\n", ep->ep_addr, xferred_bytes - copy_len);
+    }
+
+    memcpy(ep->user_buf, ep->hw_data_buf + buf_id * 64, copy_len);
+    ep->xferred_len = (uint16_t) (ep->xferred_len + copy_len);
+    ep->user_buf += copy_len;
+  }
+
+  return xferred_bytes < ep->wMaxPacketSize;
+}
+
+// Sync completed buffers in the order hardware used them, return true if transfer is complete
+static bool __tusb_irq_path_func(dbuf_xfer_sync)(struct hw_endpoint* ep) {
+  while (ep->buf_armed & TU_BIT(ep->buf_next)) {
+    uint8_t const buf_id = ep->buf_next;
+
+    uint32_t buf_ctrl = _hw_endpoint_buffer_control_get_value32(ep);
+    if (buf_id) buf_ctrl = buf_ctrl >> 16;
+    if (buf_ctrl & USB_BUF_CTRL_AVAIL) break; // still in use by hardware
+
+    ep->buf_armed &= (uint8_t) ~TU_BIT(buf_id);
+    ep->buf_next ^= 1u;
+
+    if (dbuf_sync_buffer(ep, buf_id)) {
+      // short packet: the other buffer, if armed, is left for the next transfer
+      pico_trace("  Short packet on buffer %d\r\n", buf_id);
+      ep->remaining_len = 0;
+      return true;
+    }
+  }
+
+  return (ep->remaining_len == 0) && (ep->buf_armed == 0);
+}
+
 // Prepare buffer control register value
 void __tusb_irq_path_func(hw_endpoint_start_next_buffer)(struct hw_endpoint* ep) {
+  if (hw_endpoint_is_double_buffered(ep)) {
+    dbuf_start_next_buffer(ep);
+    return;
+  }
+
   uint32_t ep_ctrl = *ep->endpoint_control;
 
   // always compute and start with buffer 0
@@ -184,7 +302,9 @@ void __tusb_irq_path_func(hw_endpoint_start_next_buffer)(struct hw_endpoint* ep)
   _hw_endpoint_buffer_control_set_value32(ep, buf_ctrl);
 }
 
-void hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t total_len) {
+// Returns true if transfer is already complete. This only happens to a device double buffered OUT
+// endpoint with data received ahead, caller should prevent the ISR from running meanwhile.
+bool hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t total_len) {
   hw_endpoint_lock_update(ep, 1);
 
   if (ep->active) {
@@ -199,6 +319,18 @@ void hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t to
   ep->active = true;
   ep->user_buf = buffer;
 
+  if (hw_endpoint_is_double_buffered(ep) && ep->buf_armed) {
+    // OUT buffer armed during previous transfer continues this one
+    uint8_t const buf_id = ep->buf_next;
+    ep->buf_len[buf_id] = tu_min16(ep->remaining_len, ep->buf_len[buf_id]);
+    ep->remaining_len = (uint16_t) (ep->remaining_len - ep->buf_len[buf_id]);
+
+    if (dbuf_xfer_sync(ep)) {
+      hw_endpoint_lock_update(ep, -1);
+      return true;
+    }
+  }
+
   if (e15_is_bulkin_ep(ep)) {
     usb_hw_set->inte = USB_INTS_DEV_SOF_BITS;
   }
@@ -210,6 +342,7 @@ void hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t to
   }
 
   hw_endpoint_lock_update(ep, -1);
+  return false;
 }
 
 // sync endpoint buffer and return transferred bytes
@@ -295,22 +428,36 @@ static void __tusb_irq_path_func(_hw_endpoint_xfer_sync)(struct hw_endpoint* ep)
 bool __tusb_irq_path_func(hw_endpoint_xfer_continue)(struct hw_endpoint* ep) {
   hw_endpoint_lock_update(ep, 1);
 
+  bool const dbuf = hw_endpoint_is_double_buffered(ep);
+
   // Part way through a transfer
   if (!ep->active) {
+    // Double buffered OUT: packet received ahead of next transfer is kept in buffer,
+    // or buffer status is set again for a buffer already synced
+    if (dbuf) {
+      hw_endpoint_lock_update(ep, -1);
+      return false;
+    }
     panic("Can't continue xfer on inactive ep %02X", ep->ep_addr);
   }
 
-  // Update EP struct from hardware state
-  _hw_endpoint_xfer_sync(ep);
+  bool done;
+  if (dbuf) {
+    done = dbuf_xfer_sync(ep);
+  } else {
+    // Update EP struct from hardware state
+    _hw_endpoint_xfer_sync(ep);
+    done = (ep->remaining_len == 0);
+  }
 
   // Now we have synced our state with the hardware. Is there more data to transfer?
   // If we are done then notify tinyusb
-  if (ep->remaining_len == 0) {
+  if (done) {
     pico_trace("Completed transfer of %d bytes on ep %02X\r\n", ep->xferred_len, ep->ep_addr);
     // Notify caller we are done so it can notify the tinyusb stack
     hw_endpoint_lock_update(ep, -1);
     return true;
-  } else {
+  } else if (!dbuf || ep->remaining_len) {
     if (e15_is_critical_frame_period(ep)) {
       ep->pending = 1;
     } else {
@@ -30,6 +30,12 @@
 #define PICO_RP2040_USB_FAST_IRQ 0
 #endif
 
+// Device bulk and interrupt endpoints use both dpram buffers independently: each buffer is re-armed with
+// the next packet as soon as it completes, so hardware always has the other one while the CPU copies.
+#ifndef TUD_OPT_RP2040_USB_DEVICE_DOUBLE_BUFFER
+#define TUD_OPT_RP2040_USB_DEVICE_DOUBLE_BUFFER 1
+#endif
+
 #if PICO_RP2040_USB_FAST_IRQ
 #define __tusb_irq_path_func(x) __no_inline_not_in_flash_func(x)
 #else
@@ -83,12 +89,23 @@ typedef struct hw_endpoint
     // Transfer scheduled but not active
     uint8_t pending;
 
+    // Device double buffered: bitmap of buffers armed with hardware, buffer hardware completes next,
+    // and number of bytes of the user buffer reserved by each buffer
+    uint8_t buf_armed;
+    uint8_t buf_next;
+    uint16_t buf_len[2];
+
 #if CFG_TUH_ENABLED
     // Only needed for host
     uint8_t dev_addr;
 
     // If interrupt endpoint
     uint8_t interrupt_num;
+
+    // bInterval, and frames to wait before retrying on epx after NAKs
+    uint8_t interval;
+    uint8_t nak_backoff;
+    uint8_t nak_wait;
 #endif
 
 } hw_endpoint_t;
@@ -97,9 +114,17 @@ typedef struct hw_endpoint
 extern volatile uint32_t e15_last_sof;
 #endif
 
+// older SDK
+#ifndef PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY
+#define PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY 0xff
+#endif
+
 void rp2040_usb_init(void);
 
-void hw_endpoint_xfer_start(struct hw_endpoint *ep, uint8_t *buffer, uint16_t total_len);
+// Install device or host irq handler, replacing the one of the other role if any
+void rp2040_usb_irq_handler_set(irq_handler_t handler);
+
+bool hw_endpoint_xfer_start(struct hw_endpoint *ep, uint8_t *buffer, uint16_t total_len);
 bool hw_endpoint_xfer_continue(struct hw_endpoint *ep);
 void hw_endpoint_reset_transfer(struct hw_endpoint *ep);
 void hw_endpoint_start_next_buffer(struct hw_endpoint *ep);
@@ -132,6 +157,14 @@ TU_ATTR_ALWAYS_INLINE static inline void _hw_endpoint_buffer_control_clear_mask3
   _hw_endpoint_buffer_control_update32(ep, ~value, 0);
 }
 
+// Device endpoint (except EP0) whose buffers are used as described by TUD_OPT_RP2040_USB_DEVICE_DOUBLE_BUFFER
+TU_ATTR_ALWAYS_INLINE static inline bool hw_endpoint_is_double_buffered(struct hw_endpoint *ep)
+{
+  return TUD_OPT_RP2040_USB_DEVICE_DOUBLE_BUFFER && !(usb_hw->main_ctrl & USB_MAIN_CTRL_HOST_NDEVICE_BITS) &&
+         tu_edpt_number(ep->ep_addr) != 0 &&
+         (ep->transfer_type == TUSB_XFER_BULK || ep->transfer_type == TUSB_XFER_INTERRUPT);
+}
+
 static inline uintptr_t hw_data_offset (uint8_t *buf)
 {
   // Remove usb base from buffer pointer
@@ -54,6 +54,28 @@
   #error "Unsupported MCU"
 #endif
 
+// Move bulk pipe data through D0FIFO/D1FIFO with DMAC/DTC, see tusb_rusb2_dma_xfer_api()
+#ifndef CFG_TUD_RUSB2_DMA
+  #define CFG_TUD_RUSB2_DMA  0
+#endif
+
+#if CFG_TUD_RUSB2_DMA
+  #if defined(RENESAS_CORTEX_M23)
+    #error "CFG_TUD_RUSB2_DMA requires D0FIFO/D1FIFO"
+  #endif
+
+  // D0FIFO and D1FIFO are reserved for DMA, CPU accesses pipe 1-9 through CFIFO shared with the DCP
+  #define PIPE_FIFO       CFIFO
+  #define PIPE_FIFOSEL_b  CFIFOSEL_b
+  #define PIPE_FIFOCTR    CFIFOCTR
+  #define PIPE_FIFOCTR_b  CFIFOCTR_b
+#else
+  #define PIPE_FIFO       D0FIFO
+  #define PIPE_FIFOSEL_b  D0FIFOSEL_b
+  #define PIPE_FIFOCTR    D0FIFOCTR
+  #define PIPE_FIFOCTR_b  D0FIFOCTR_b
+#endif
+
 //--------------------------------------------------------------------+
 // MACRO TYPEDEF CONSTANT ENUM
 //--------------------------------------------------------------------+
@@ -77,10 +99,22 @@ typedef struct TU_ATTR_PACKED
 TU_ATTR_PACKED_END  // End of definition of packed structs (used by the CCRX toolchain)
 TU_ATTR_BIT_FIELD_ORDER_END
 
+#if CFG_TUD_RUSB2_DMA
+typedef struct
+{
+  uint16_t num; /* pipe bound to the DnFIFO port, 0 if free */
+  uint16_t len; /* bytes programmed to DMA */
+} dma_port_t;
+#endif
+
 typedef struct
 {
   pipe_state_t pipe[10];
   uint8_t ep[2][16];   /* a lookup table for a pipe index from an endpoint address */
+#if CFG_TUD_RUSB2_DMA
+  dma_port_t dma[2];   /* D0FIFO, D1FIFO */
+  uint16_t   cfifosel; /* DCP selection of CFIFO saved during pipe access */
+#endif
 } dcd_data_t;
 
 static dcd_data_t _dcd;
@@ -178,8 +212,32 @@ static uint16_t edpt_max_packet_size(rusb2_reg_t *rusb, unsigned num)
 
 static inline void pipe_wait_for_ready(rusb2_reg_t * rusb, unsigned num)
 {
-  while ( rusb->D0FIFOSEL_b.CURPIPE != num ) {}
-  while ( !rusb->D0FIFOCTR_b.FRDY ) {}
+  while ( rusb->PIPE_FIFOSEL_b.CURPIPE != num ) {}
+  while ( !rusb->PIPE_FIFOCTR_b.FRDY ) {}
+}
+
+// Select pipe 1-9 on the CPU access port
+static inline void pipe_port_select(rusb2_reg_t * rusb, uint16_t sel)
+{
+#if CFG_TUD_RUSB2_DMA
+  _dcd.cfifosel = rusb->CFIFOSEL;
+  rusb->CFIFOSEL = sel;
+#else
+  rusb->D0FIFOSEL = sel;
+#endif
+}
+
+static inline void pipe_port_release(rusb2_reg_t * rusb)
+{
+#if CFG_TUD_RUSB2_DMA
+  // give CFIFO back to the DCP
+  const uint16_t sel = _dcd.cfifosel;
+  rusb->CFIFOSEL = sel;
+  while ( (rusb->CFIFOSEL ^ sel) & (RUSB2_CFIFOSEL_CURPIPE_Msk | RUSB2_CFIFOSEL_ISEL_Msk) ) {}
+#else
+  rusb->D0FIFOSEL = 0;
+  while (rusb->D0FIFOSEL_b.CURPIPE) {} /* if CURPIPE bits changes, check written value */
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -352,7 +410,7 @@ static bool pipe_xfer_in(rusb2_reg_t* rusb, unsigned num)
     return true;
   }
 
-  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_16BIT | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
+  pipe_port_select(rusb, num | RUSB2_FIFOSEL_MBW_16BIT | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0));
   const uint16_t mps  = edpt_max_packet_size(rusb, num);
   pipe_wait_for_ready(rusb, num);
   const uint16_t len  = tu_min16(rem, mps);
@@ -360,19 +418,18 @@ static bool pipe_xfer_in(rusb2_reg_t* rusb, unsigned num)
 
   if (len) {
     if (pipe->ff) {
-      pipe_write_packet_ff(rusb, (tu_fifo_t*)buf, (volatile void*)&rusb->D0FIFO, len);
+      pipe_write_packet_ff(rusb, (tu_fifo_t*)buf, (volatile void*)&rusb->PIPE_FIFO, len);
     } else {
-      pipe_write_packet(rusb, buf, (volatile void*)&rusb->D0FIFO, len);
+      pipe_write_packet(rusb, buf, (volatile void*)&rusb->PIPE_FIFO, len);
       pipe->buf = (uint8_t*)buf + len;
     }
   }
 
   if (len < mps) {
-    rusb->D0FIFOCTR = RUSB2_CFIFOCTR_BVAL_Msk;
+    rusb->PIPE_FIFOCTR = RUSB2_CFIFOCTR_BVAL_Msk;
   }
 
-  rusb->D0FIFOSEL = 0;
-  while (rusb->D0FIFOSEL_b.CURPIPE) {} /* if CURPIPE bits changes, check written value */
+  pipe_port_release(rusb);
 
   pipe->remaining = rem - len;
 
@@ -384,29 +441,28 @@ static bool pipe_xfer_out(rusb2_reg_t* rusb, unsigned num)
   pipe_state_t  *pipe = &_dcd.pipe[num];
   const uint16_t rem  = pipe->remaining;
 
-  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_8BIT;
+  pipe_port_select(rusb, num | RUSB2_FIFOSEL_MBW_8BIT);
   const uint16_t mps = edpt_max_packet_size(rusb, num);
   pipe_wait_for_ready(rusb, num);
 
-  const uint16_t vld  = rusb->D0FIFOCTR_b.DTLN;
+  const uint16_t vld  = rusb->PIPE_FIFOCTR_b.DTLN;
   const uint16_t len  = tu_min16(tu_min16(rem, mps), vld);
   void          *buf  = pipe->buf;
 
   if (len) {
     if (pipe->ff) {
-      pipe_read_packet_ff(rusb, (tu_fifo_t*)buf, (volatile void*)&rusb->D0FIFO, len);
+      pipe_read_packet_ff(rusb, (tu_fifo_t*)buf, (volatile void*)&rusb->PIPE_FIFO, len);
     } else {
-      pipe_read_packet(rusb, buf, (volatile void*)&rusb->D0FIFO, len);
+      pipe_read_packet(rusb, buf, (volatile void*)&rusb->PIPE_FIFO, len);
       pipe->buf = (uint8_t*)buf + len;
     }
   }
 
   if (len < mps) {
-    rusb->D0FIFOCTR = RUSB2_CFIFOCTR_BCLR_Msk;
+    rusb->PIPE_FIFOCTR = RUSB2_CFIFOCTR_BCLR_Msk;
   }
 
-  rusb->D0FIFOSEL = 0;
-  while (rusb->D0FIFOSEL_b.CURPIPE) {} /* if CURPIPE bits changes, check written value */
+  pipe_port_release(rusb);
 
   pipe->remaining = rem - len;
   if ((len < mps) || (rem == len)) {
@@ -417,6 +473,190 @@ static bool pipe_xfer_out(rusb2_reg_t* rusb, unsigned num)
   return false;
 }
 
+#if CFG_TUD_RUSB2_DMA
+//--------------------------------------------------------------------+
+// DMA Transfer
+//
+// A bulk pipe transfer of at least 2 packets is bound to a free D0FIFO/D1FIFO port and moved by the
+// application DMAC/DTC channel. IN: DMA fills buffer memory, the CPU writes the unaligned tail and the
+// transfer completes on buffer empty (BEMP). OUT: BFRE defers buffer ready (BRDY) until DMA has read
+// the last packet, the number of bytes moved is reported by tusb_rusb2_dma_stop_api().
+//--------------------------------------------------------------------+
+
+static inline volatile uint16_t* dma_port_sel(rusb2_reg_t* rusb, unsigned port)
+{
+  return port ? &rusb->D1FIFOSEL : &rusb->D0FIFOSEL;
+}
+
+static inline void dma_port_write_sel(rusb2_reg_t* rusb, unsigned port, uint16_t sel)
+{
+  volatile uint16_t *reg = dma_port_sel(rusb, port);
+  *reg = sel;
+  while ( (*reg & RUSB2_D0FIFOSEL_CURPIPE_Msk) != (sel & RUSB2_D0FIFOSEL_CURPIPE_Msk) ) {}
+}
+
+static inline void pipe_set_bfre(rusb2_reg_t* rusb, unsigned num, bool en)
+{
+  rusb->PIPESEL = num;
+  if (en) {
+    rusb->PIPECFG |= RUSB2_PIPECFG_BFRE_Msk;
+  } else {
+    rusb->PIPECFG &= ~RUSB2_PIPECFG_BFRE_Msk;
+  }
+}
+
+static int dma_find_port(unsigned num)
+{
+  for (unsigned i = 0; i < TU_ARRAY_SIZE(_dcd.dma); ++i) {
+    if (_dcd.dma[i].num == num) return (int) i;
+  }
+  return -1;
+}
+
+// Bind pipe to a free DnFIFO port and start DMA, OUT pipe must be NAK. Return false to fall back to PIO
+static bool dma_xfer_start(uint8_t rhport, unsigned num)
+{
+  rusb2_reg_t   *rusb = RUSB2_REG(rhport);
+  pipe_state_t  *pipe = &_dcd.pipe[num];
+  const unsigned dir  = tu_edpt_dir(pipe->ep);
+
+  rusb->PIPESEL = num;
+  if (pipe->ff || (rusb->PIPECFG & RUSB2_PIPECFG_TYPE_Msk) != RUSB2_PIPECFG_TYPE_BULK) return false;
+
+  const uint16_t mps = rusb->PIPEMAXP & RUSB2_PIPEMAXP_MXPS_Msk;
+  if (pipe->remaining < 2u * mps) return false;
+
+  // IN uses the widest access, OUT reads bytewise so that the length of a short packet is exact
+  const uint8_t unit = dir ? (rusb2_is_highspeed_reg(rusb) ? 4 : 2) : 1;
+  if ((uintptr_t) pipe->buf & (unit - 1u)) return false;
+
+  const int port = dma_find_port(0);
+  if (port < 0) return false;
+
+  const uint16_t mbw = (4 == unit) ? RUSB2_FIFOSEL_MBW_32BIT : ((2 == unit) ? RUSB2_FIFOSEL_MBW_16BIT : RUSB2_FIFOSEL_MBW_8BIT);
+  const uint16_t len = pipe->remaining & ~(unit - 1u);
+  volatile void *fifo = port ? (volatile void*) &rusb->D1FIFO : (volatile void*) &rusb->D0FIFO;
+
+  if (dir) {
+    rusb->BRDYENB &= ~TU_BIT(num); /* buffer ready is served by DMA */
+    dma_port_write_sel(rusb, port, num | mbw | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0) |
+                                   RUSB2_D0FIFOSEL_DREQE_Msk);
+  } else {
+    pipe_set_bfre(rusb, num, true);
+    dma_port_write_sel(rusb, port, num | mbw | RUSB2_D0FIFOSEL_DCLRM_Msk | RUSB2_D0FIFOSEL_DREQE_Msk);
+  }
+
+  if (!tusb_rusb2_dma_xfer_api(rhport, (uint8_t) port, dir, fifo, pipe->buf, len / unit, unit)) {
+    dma_port_write_sel(rusb, port, 0);
+    if (dir) {
+      rusb->BRDYENB |= TU_BIT(num);
+    } else {
+      pipe_set_bfre(rusb, num, false);
+    }
+    return false;
+  }
+
+  _dcd.dma[port].num = (uint16_t) num;
+  _dcd.dma[port].len = len;
+  return true;
+}
+
+// Abort DMA and restore pipe interrupts, used when the pipe is closed
+static void dma_xfer_abort(uint8_t rhport, unsigned port)
+{
+  rusb2_reg_t   *rusb = RUSB2_REG(rhport);
+  const unsigned num  = _dcd.dma[port].num;
+
+  (void) tusb_rusb2_dma_stop_api(rhport, (uint8_t) port);
+  dma_port_write_sel(rusb, port, 0);
+  rusb->BEMPENB &= ~TU_BIT(num);
+  rusb->BRDYENB |= TU_BIT(num);
+  pipe_set_bfre(rusb, num, false);
+  _dcd.dma[port].num = 0;
+}
+
+static void dma_xfer_in_complete(uint8_t rhport, unsigned num)
+{
+  rusb2_reg_t  *rusb = RUSB2_REG(rhport);
+  pipe_state_t *pipe = &_dcd.pipe[num];
+
+  rusb->BEMPENB &= ~TU_BIT(num);
+  rusb->BRDYENB |= TU_BIT(num);
+  dcd_event_xfer_complete(rhport, pipe->ep, pipe->length, XFER_RESULT_SUCCESS, true);
+}
+
+// DMA has filled buffer memory, write the tail and wait for the last packet to be sent
+static void dma_xfer_in_end(uint8_t rhport, unsigned port)
+{
+  rusb2_reg_t   *rusb = RUSB2_REG(rhport);
+  dma_port_t    *dma  = &_dcd.dma[port];
+  const unsigned num  = dma->num;
+  pipe_state_t  *pipe = &_dcd.pipe[num];
+  const uint16_t tail = pipe->remaining - dma->len;
+  volatile void *fifo = port ? (volatile void*) &rusb->D1FIFO : (volatile void*) &rusb->D0FIFO;
+
+  pipe->buf = (uint8_t*) pipe->buf + dma->len;
+
+  // stop DMA request, tail is written by CPU with 16-bit access like PIO
+  dma_port_write_sel(rusb, port, num | RUSB2_FIFOSEL_MBW_16BIT | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0));
+  if (tail) {
+    while ( 0 == (*(volatile uint16_t*) (port ? &rusb->D1FIFOCTR : &rusb->D0FIFOCTR) & RUSB2_CFIFOCTR_FRDY_Msk) ) {}
+    pipe_write_packet(rusb, pipe->buf, fifo, tail);
+    pipe->buf = (uint8_t*) pipe->buf + tail;
+  }
+  if (pipe->length % edpt_max_packet_size(rusb, num)) {
+    *(port ? &rusb->D1FIFOCTR : &rusb->D0FIFOCTR) = RUSB2_CFIFOCTR_BVAL_Msk;
+  }
+  dma_port_write_sel(rusb, port, 0);
+  dma->num = 0;
+  pipe->remaining = 0;
+
+  // BEMP status is set regardless of BEMPENB, clear stale one before enabling it
+  rusb->BEMPSTS = (uint16_t) ~TU_BIT(num);
+  rusb->BEMPENB |= TU_BIT(num);
+  if (0 == (rusb->PIPE_CTR[num - 1] & RUSB2_PIPE_CTR_INBUFM_Msk)) {
+    // already sent
+    rusb->BEMPSTS = (uint16_t) ~TU_BIT(num);
+    dma_xfer_in_complete(rhport, num);
+  }
+}
+
+// BRDY of OUT pipe with BFRE: DMA has read the last packet
+static void dma_xfer_out_end(uint8_t rhport, unsigned port)
+{
+  rusb2_reg_t   *rusb = RUSB2_REG(rhport);
+  dma_port_t    *dma  = &_dcd.dma[port];
+  const unsigned num  = dma->num;
+  pipe_state_t  *pipe = &_dcd.pipe[num];
+
+  const uint16_t moved = tu_min16(tusb_rusb2_dma_stop_api(rhport, (uint8_t) port), pipe->remaining);
+  dma_port_write_sel(rusb, port, 0);
+  dma->num = 0;
+
+  // BFRE must only be changed while PID is NAK, the next transfer sets BUF again
+  volatile uint16_t *ctr = get_pipectr(rusb, num);
+  *ctr = RUSB2_PIPE_CTR_PID_NAK;
+  while (*ctr & RUSB2_PIPE_CTR_PBUSY_Msk) {}
+  pipe_set_bfre(rusb, num, false);
+
+  pipe->buf        = (uint8_t*) pipe->buf + moved;
+  pipe->remaining -= moved;
+  dcd_event_xfer_complete(rhport, pipe->ep, pipe->length - pipe->remaining, XFER_RESULT_SUCCESS, true);
+}
+
+void tud_rusb2_dma_complete(uint8_t rhport, uint8_t fifo_num)
+{
+  TU_VERIFY(fifo_num < TU_ARRAY_SIZE(_dcd.dma), );
+  dcd_int_disable(rhport);
+  const unsigned num = _dcd.dma[fifo_num].num;
+  // OUT completes with BRDY since the DMA count is only an upper bound
+  if (num && tu_edpt_dir(_dcd.pipe[num].ep)) {
+    dma_xfer_in_end(rhport, fifo_num);
+  }
+  dcd_int_enable(rhport);
+}
+#endif
+
 static void process_setup_packet(uint8_t rhport)
 {
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
@@ -486,8 +726,9 @@ static bool process_pipe0_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_ad
   return true;
 }
 
-static bool process_pipe_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_addr, void* buffer, uint16_t total_bytes)
+static bool process_pipe_xfer(uint8_t rhport, int buffer_type, uint8_t ep_addr, void* buffer, uint16_t total_bytes)
 {
+  rusb2_reg_t* rusb = RUSB2_REG(rhport);
   const unsigned epn = tu_edpt_number(ep_addr);
   const unsigned dir = tu_edpt_dir(ep_addr);
   const unsigned num = _dcd.ep[dir][epn];
@@ -503,15 +744,16 @@ static bool process_pipe_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_add
   if (dir) {
     /* IN */
     if (total_bytes) {
+#if CFG_TUD_RUSB2_DMA
+      if (dma_xfer_start(rhport, num)) return true;
+#endif
       pipe_xfer_in(rusb, num);
     } else {
       /* ZLP */
-      rusb->D0FIFOSEL = num;
+      pipe_port_select(rusb, num);
       pipe_wait_for_ready(rusb, num);
-      rusb->D0FIFOCTR = RUSB2_CFIFOCTR_BVAL_Msk;
-      rusb->D0FIFOSEL = 0;
-      /* if CURPIPE bits changes, check written value */
-      while (rusb->D0FIFOSEL_b.CURPIPE) {}
+      rusb->PIPE_FIFOCTR = RUSB2_CFIFOCTR_BVAL_Msk;
+      pipe_port_release(rusb);
     }
   } else {
     // OUT
@@ -523,6 +765,10 @@ static bool process_pipe_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_add
 
       if (*ctr & 0x3) *ctr = RUSB2_PIPE_CTR_PID_NAK;
 
+#if CFG_TUD_RUSB2_DMA
+      (void) dma_xfer_start(rhport, num);
+#endif
+
       pt->TRE   = TU_BIT(8);
       pt->TRN   = (total_bytes + mps - 1) / mps;
       pt->TRENB = 1;
@@ -534,13 +780,13 @@ static bool process_pipe_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_add
   return true;
 }
 
-static bool process_edpt_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_addr, void* buffer, uint16_t total_bytes)
+static bool process_edpt_xfer(uint8_t rhport, int buffer_type, uint8_t ep_addr, void* buffer, uint16_t total_bytes)
 {
   const unsigned epn = tu_edpt_number(ep_addr);
   if (0 == epn) {
-    return process_pipe0_xfer(rusb, buffer_type, ep_addr, buffer, total_bytes);
+    return process_pipe0_xfer(RUSB2_REG(rhport), buffer_type, ep_addr, buffer, total_bytes);
   } else {
-    return process_pipe_xfer(rusb, buffer_type, ep_addr, buffer, total_bytes);
+    return process_pipe_xfer(rhport, buffer_type, ep_addr, buffer, total_bytes);
   }
 }
 
@@ -562,6 +808,16 @@ static void process_pipe_brdy(uint8_t rhport, unsigned num)
   const unsigned dir  = tu_edpt_dir(pipe->ep);
   bool completed;
 
+#if CFG_TUD_RUSB2_DMA
+  if (!dir && num) {
+    const int port = dma_find_port(num);
+    if (port >= 0) {
+      dma_xfer_out_end(rhport, (unsigned) port);
+      return;
+    }
+  }
+#endif
+
   if (dir) {
     /* IN */
     completed = pipe_xfer_in(rusb, num);
@@ -585,6 +841,12 @@ static void process_bus_reset(uint8_t rhport)
 {
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
 
+#if CFG_TUD_RUSB2_DMA
+  for (unsigned i = 0; i < TU_ARRAY_SIZE(_dcd.dma); ++i) {
+    if (_dcd.dma[i].num) (void) tusb_rusb2_dma_stop_api(rhport, (uint8_t) i);
+  }
+#endif
+
   rusb->BEMPENB = 1;
   rusb->BRDYENB = 1;
   rusb->CFIFOCTR = RUSB2_CFIFOCTR_BCLR_Msk;
@@ -688,6 +950,27 @@ static void enable_interrupt(uint32_t pswi)
 }
 #endif
 
+// Default control pipe and interrupts, common to init and role switch
+static void device_mode_init(uint8_t rhport)
+{
+  rusb2_reg_t* rusb = RUSB2_REG(rhport);
+
+  /* Setup default control pipe */
+  rusb->DCPMAXP_b.MXPS = 64;
+
+  rusb->INTSTS0 = 0;
+  rusb->INTENB0 = RUSB2_INTSTS0_VBINT_Msk | RUSB2_INTSTS0_BRDY_Msk | RUSB2_INTSTS0_BEMP_Msk |
+                  RUSB2_INTSTS0_DVST_Msk | RUSB2_INTSTS0_CTRT_Msk | (USE_SOF ? RUSB2_INTSTS0_SOFR_Msk : 0) |
+                  RUSB2_INTSTS0_RESM_Msk;
+  rusb->BEMPENB = 1;
+  rusb->BRDYENB = 1;
+
+  // If VBUS (detect) pin is not used, application need to call tud_connect() manually after tud_init()
+  if (rusb->INTSTS0_b.VBSTS) {
+    dcd_connect(rhport);
+  }
+}
+
 void dcd_init(uint8_t rhport)
 {
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
@@ -732,21 +1015,31 @@ void dcd_init(uint8_t rhport)
     rusb->DPUSR0R_FS_b.FIXPHY0 = 0u; /* USB_BASE Transceiver Output fixed */
   }
 
-  /* Setup default control pipe */
-  rusb->DCPMAXP_b.MXPS = 64;
+  device_mode_init(rhport);
+}
 
-  rusb->INTSTS0 = 0;
-  rusb->INTENB0 = RUSB2_INTSTS0_VBINT_Msk | RUSB2_INTSTS0_BRDY_Msk | RUSB2_INTSTS0_BEMP_Msk |
-                  RUSB2_INTSTS0_DVST_Msk | RUSB2_INTSTS0_CTRT_Msk | (USE_SOF ? RUSB2_INTSTS0_SOFR_Msk : 0) |
-                  RUSB2_INTSTS0_RESM_Msk;
-  rusb->BEMPENB = 1;
-  rusb->BRDYENB = 1;
+#if CFG_TUSB_OTG
+// Switch from host role: module clock and PHY are left running, only the function controller is re-selected
+void dcd_role_enter(uint8_t rhport)
+{
+  rusb2_reg_t* rusb = RUSB2_REG(rhport);
 
-  // If VBUS (detect) pin is not used, application need to call tud_connect() manually after tud_init()
-  if (rusb->INTSTS0_b.VBSTS) {
-    dcd_connect(rhport);
-  }
+  rusb->DVSTCTR0_b.VBUSEN = 0;
+  rusb->INTENB1 = 0;
+  rusb->NRDYENB = 0;
+  rusb->INTSTS1 = 0;
+
+  rusb->SYSCFG_b.USBE = 0;
+  rusb->SYSCFG_b.DRPD = 0;
+  rusb->SYSCFG_b.DCFM = 0;
+  rusb->SYSCFG_b.USBE = 1;
+
+  rusb->DCPCFG = 0;
+  tu_memclr(&_dcd, sizeof(_dcd));
+
+  device_mode_init(rhport);
 }
+#endif
 
 void dcd_int_enable(uint8_t rhport) {
   rusb2_int_enable(rhport);
@@ -876,6 +1169,12 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   const unsigned dir = tu_edpt_dir(ep_addr);
   const unsigned num = _dcd.ep[dir][epn];
 
+#if CFG_TUD_RUSB2_DMA
+  const int port = dma_find_port(num);
+  if (num && port >= 0) dma_xfer_abort(rhport, (unsigned) port);
+  rusb->BEMPENB &= ~TU_BIT(num);
+#endif
+
   rusb->BRDYENB &= ~TU_BIT(num);
   volatile uint16_t *ctr = get_pipectr(rusb, num);
   *ctr = 0;
@@ -887,10 +1186,8 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
 
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes)
 {
-  rusb2_reg_t* rusb = RUSB2_REG(rhport);
-
   dcd_int_disable(rhport);
-  bool r = process_edpt_xfer(rusb, 0, ep_addr, buffer, total_bytes);
+  bool r = process_edpt_xfer(rhport, 0, ep_addr, buffer, total_bytes);
   dcd_int_enable(rhport);
 
   return r;
@@ -900,10 +1197,9 @@ bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_
 {
   // USB buffers always work in bytes so to avoid unnecessary divisions we demand item_size = 1
   TU_ASSERT(ff->item_size == 1);
-  rusb2_reg_t* rusb = RUSB2_REG(rhport);
 
   dcd_int_disable(rhport);
-  bool r = process_edpt_xfer(rusb, 1, ep_addr, ff, total_bytes);
+  bool r = process_edpt_xfer(rhport, 1, ep_addr, ff, total_bytes);
   dcd_int_enable(rhport);
 
   return r;
@@ -944,7 +1240,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 //--------------------------------------------------------------------+
 // ISR
 //--------------------------------------------------------------------+
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
 
@@ -1021,11 +1317,27 @@ void dcd_int_handler(uint8_t rhport)
 
   // Buffer empty
   if ( is0 & RUSB2_INTSTS0_BEMP_Msk ) {
+#if CFG_TUD_RUSB2_DMA
+    unsigned s = rusb->BEMPSTS;
+    rusb->BEMPSTS = ~s;
+    if ( s & 1 ) {
+      process_pipe0_bemp(rhport);
+    }
+    // last packet of DMA IN transfer has been sent
+    s &= rusb->BEMPENB & ~1u;
+    for (unsigned num = 1; s; ++num) {
+      if (s & TU_BIT(num)) {
+        dma_xfer_in_complete(rhport, num);
+        s &= ~TU_BIT(num);
+      }
+    }
+#else
     const uint16_t s = rusb->BEMPSTS;
     rusb->BEMPSTS = 0;
     if ( s & 1 ) {
       process_pipe0_bemp(rhport);
     }
+#endif
   }
 
   // Buffer ready
@@ -479,6 +479,21 @@ static void enable_interrupt(uint32_t pswi)
 }
 #endif
 
+// Default control pipe and interrupts, common to init and role switch
+static void host_mode_init(uint8_t rhport)
+{
+  rusb2_reg_t* rusb = RUSB2_REG(rhport);
+
+  /* Setup default control pipe */
+  rusb->DCPCFG  = RUSB2_PIPECFG_SHTNAK_Msk;
+  rusb->DCPMAXP = 64;
+  rusb->INTENB0 = RUSB2_INTSTS0_BRDY_Msk | RUSB2_INTSTS0_NRDY_Msk | RUSB2_INTSTS0_BEMP_Msk;
+  rusb->INTENB1 = RUSB2_INTSTS1_SACK_Msk | RUSB2_INTSTS1_SIGN_Msk | RUSB2_INTSTS1_ATTCH_Msk | RUSB2_INTSTS1_DTCH_Msk;
+  rusb->BEMPENB = 1;
+  rusb->NRDYENB = 1;
+  rusb->BRDYENB = 1;
+}
+
 bool hcd_init(uint8_t rhport)
 {
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
@@ -527,17 +542,41 @@ bool hcd_init(uint8_t rhport)
     rusb->DPUSR0R_FS_b.FIXPHY0 = 0u; /* Transceiver Output fixed */
   }
 
-  /* Setup default control pipe */
-  rusb->DCPCFG  = RUSB2_PIPECFG_SHTNAK_Msk;
-  rusb->DCPMAXP = 64;
-  rusb->INTENB0 = RUSB2_INTSTS0_BRDY_Msk | RUSB2_INTSTS0_NRDY_Msk | RUSB2_INTSTS0_BEMP_Msk;
-  rusb->INTENB1 = RUSB2_INTSTS1_SACK_Msk | RUSB2_INTSTS1_SIGN_Msk | RUSB2_INTSTS1_ATTCH_Msk | RUSB2_INTSTS1_DTCH_Msk;
-  rusb->BEMPENB = 1;
-  rusb->NRDYENB = 1;
-  rusb->BRDYENB = 1;
+  host_mode_init(rhport);
+  return true;
+}
+
+#if CFG_TUSB_OTG
+// Switch from device role: module clock and PHY are left running, only the host controller is re-selected
+bool hcd_role_enter(uint8_t rhport)
+{
+  rusb2_reg_t* rusb = RUSB2_REG(rhport);
+
+  rusb->INTENB0 = 0;
+  rusb->INTSTS0 = 0;
 
+  rusb->SYSCFG_b.USBE = 0;
+  rusb->SYSCFG_b.DPRPU = 0;
+  rusb->SYSCFG_b.DCFM = 1;
+  rusb->SYSCFG_b.DRPD = 1;
+#ifdef RUSB2_SUPPORT_HIGHSPEED
+  if (rusb2_is_highspeed_rhport(rhport)) {
+    rusb->SYSCFG_b.CNEN = 1;
+    rusb->SOFCFG_b.INTL = 1;
+    rusb->CFIFOSEL_b.MBW = 1;
+    rusb->D0FIFOSEL_b.MBW = 1;
+    rusb->D1FIFOSEL_b.MBW = 1;
+  }
+#endif
+  rusb->DVSTCTR0_b.VBUSEN = 1;
+  rusb->SYSCFG_b.USBE = 1;
+
+  tu_memclr(&_hcd, sizeof(_hcd));
+
+  host_mode_init(rhport);
   return true;
 }
+#endif
 
 void hcd_int_enable(uint8_t rhport) {
   rusb2_int_enable(rhport);
@@ -771,7 +810,7 @@ bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 //--------------------------------------------------------------------+
 // ISR
 //--------------------------------------------------------------------+
-void hcd_int_handler(uint8_t rhport, bool in_isr) {
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr) {
   (void) in_isr;
 
   rusb2_reg_t* rusb = RUSB2_REG(rhport);
@@ -57,5 +57,19 @@ void tusb_rusb2_set_irqnum(uint8_t rhport, int32_t irqnum) {
   #error "Unsupported MCU"
 #endif
 
+//--------------------------------------------------------------------+
+// DMA API, override when CFG_TUD_RUSB2_DMA is enabled
+//--------------------------------------------------------------------+
+TU_ATTR_WEAK bool tusb_rusb2_dma_xfer_api(uint8_t rhport, uint8_t fifo_num, bool to_fifo, volatile void* fifo,
+                                          void* buf, uint16_t count, uint8_t unit_size) {
+  (void) rhport; (void) fifo_num; (void) to_fifo; (void) fifo; (void) buf; (void) count; (void) unit_size;
+  return false;
+}
+
+TU_ATTR_WEAK uint16_t tusb_rusb2_dma_stop_api(uint8_t rhport, uint8_t fifo_num) {
+  (void) rhport; (void) fifo_num;
+  return 0;
+}
+
 
 #endif
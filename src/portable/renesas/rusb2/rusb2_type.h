@@ -27,6 +27,7 @@
 #ifndef _TUSB_RUSB2_TYPE_H_
 #define _TUSB_RUSB2_TYPE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -1773,6 +1774,25 @@ TU_VERIFY_STATIC(offsetof(rusb2_reg_t, DPUSRCR    ) == 0x016A, "incorrect offset
 TU_VERIFY_STATIC(offsetof(rusb2_reg_t, DPUSR0R_FS ) == 0x0400, "incorrect offset");
 TU_VERIFY_STATIC(offsetof(rusb2_reg_t, DPUSR1R_FS ) == 0x0404, "incorrect offset");
 
+//--------------------------------------------------------------------+
+// DMA API (CFG_TUD_RUSB2_DMA)
+// The driver binds bulk pipes to D0FIFO (fifo_num 0) or D1FIFO (fifo_num 1), the application moves
+// data with a DMAC/DTC channel triggered by the matching D0FIFO/D1FIFO transfer request.
+//--------------------------------------------------------------------+
+
+// Start a transfer of count units of unit_size (1, 2 or 4) bytes between buf and fifo register.
+// to_fifo is true for buf -> fifo (IN endpoint). Return false if no channel is available,
+// the driver then uses CPU access. Default implementation returns false.
+bool tusb_rusb2_dma_xfer_api(uint8_t rhport, uint8_t fifo_num, bool to_fifo, volatile void* fifo, void* buf,
+                             uint16_t count, uint8_t unit_size);
+
+// Stop the channel of fifo_num and return the number of bytes it has moved
+uint16_t tusb_rusb2_dma_stop_api(uint8_t rhport, uint8_t fifo_num);
+
+// Must be called by the application when the channel started with to_fifo = true ends. The DMA end
+// interrupt must not have higher priority than the USB interrupt.
+void tud_rusb2_dma_complete(uint8_t rhport, uint8_t fifo_num);
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,11 +66,12 @@
  * Current driver limitations (i.e., a list of features for you to add):
  * - STALL handled, but not tested.
  *   - Does it work? No clue.
- * - All EP BTABLE buffers are created based on max packet size of first EP opened with that address.
+ * - All EP BTABLE buffers are created based on max packet size of first EP opened with that address,
+ *   unless the PMA is planned for the whole configuration by dcd_edpt_config_plan().
  * - Packet buffer memory is copied in the interrupt.
  *   - This is better for performance, but means interrupts are disabled for longer
  *   - DMA may be the best choice, but it could also be pushed to the USBD task.
- * - No double-buffering
+ * - Double-buffering only for bulk endpoints, and only if CFG_TUD_FSDEV_DOUBLE_BUFFER is enabled
  * - No DMA
  * - Minimal error handling
  *   - Perhaps error interrupts should be reported to the stack, or cause a device reset?
@@ -132,6 +133,14 @@
 #  define DCD_STM32_BTABLE_SIZE (FSDEV_PMA_SIZE - DCD_STM32_BTABLE_BASE)
 #endif
 
+// Use hardware double-buffering (DBL_BUF) for bulk endpoints: the next packet is received/transmitted
+// from the second buffer while the ISR copies the current one, avoiding a NAK per packet.
+// Each double-buffered bulk endpoint takes twice the PMA space and a whole hardware endpoint
+// register (the opposite direction with the same number is placed on another register).
+#ifndef CFG_TUD_FSDEV_DOUBLE_BUFFER
+#  define CFG_TUD_FSDEV_DOUBLE_BUFFER 0
+#endif
+
 /***************************************************
  * Checks, structs, defines, function definitions, etc.
  */
@@ -155,6 +164,8 @@ typedef struct
   uint16_t max_packet_size;
   uint16_t pma_alloc_size;
   uint8_t ep_idx; // index for USB_EPnR register
+  bool dbuf;         // double-buffered bulk endpoint
+  bool dbuf_pending; // IN: next packet is loaded into the application buffer but not yet handed to hardware
 } xfer_ctl_t;
 
 // EP allocator
@@ -185,9 +196,14 @@ static void dcd_ep_ctr_handler(void);
 // PMA allocation/access
 static uint8_t open_ep_count;
 static uint16_t ep_buf_ptr; ///< Points to first free memory location
+static bool pma_planned;    ///< PMA of all endpoints (any alternate setting) is laid out by dcd_edpt_config_plan()
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+static uint16_t pma_single_buf; ///< Bulk endpoints planned single-buffered due to lack of PMA, bit (epnum + 8*dir)
+#endif
 static void dcd_pma_alloc_reset(void);
-static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length);
+static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length, bool dbuf);
 static void dcd_pma_free(uint8_t ep_addr);
+static void dcd_pma_reset_to_ep0(void);
 static void dcd_ep_free(uint8_t ep_addr);
 static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type);
 static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes);
@@ -210,6 +226,25 @@ TU_ATTR_ALWAYS_INLINE static inline xfer_ctl_t* xfer_ctl_ptr(uint32_t ep_addr)
   return &xfer_status[epnum][dir];
 }
 
+// Bulk endpoint is double-buffered unless the PMA plan could not afford it
+TU_ATTR_ALWAYS_INLINE static inline bool ep_dbuf(uint8_t ep_addr, uint8_t ep_type)
+{
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  uint8_t const ep_bit = (uint8_t) (tu_edpt_number(ep_addr) + 8*tu_edpt_dir(ep_addr));
+  return (ep_type == TUSB_XFER_BULK) && !tu_bit_test(pma_single_buf, ep_bit);
+#else
+  (void) ep_addr;
+  (void) ep_type;
+  return false;
+#endif
+}
+
+// Endpoints that need a whole USB_EPnR register (both buffer descriptors) for one direction
+TU_ATTR_ALWAYS_INLINE static inline bool ep_exclusive(uint8_t ep_addr, uint8_t ep_type)
+{
+  return (ep_type == TUSB_XFER_ISOCHRONOUS) || ep_dbuf(ep_addr, ep_type);
+}
+
 //--------------------------------------------------------------------+
 // Controller API
 //--------------------------------------------------------------------+
@@ -502,6 +537,131 @@ static void dcd_handle_bus_reset(void)
   USB->DADDR = USB_DADDR_EF; // Set enable flag, and leaving the device address as zero.
 }
 
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+//--------------------------------------------------------------------+
+// Double-buffered bulk endpoint
+//
+// Buffer 0 is described by ADDRn_TX/COUNTn_TX and buffer 1 by ADDRn_RX/COUNTn_RX. Hardware uses the
+// buffer selected by its data toggle (DTOG_TX for IN, DTOG_RX for OUT), the application owns the one
+// selected by SW_BUF (the DTOG bit of the opposite direction). When both are equal hardware NAKs, the
+// application hands a buffer over by toggling SW_BUF.
+//--------------------------------------------------------------------+
+
+// Load next packet of an IN transfer into the application owned buffer
+static void dbuf_load_packet(xfer_ctl_t * xfer, uint32_t ep_ix)
+{
+  uint16_t const len = tu_min16((uint16_t)(xfer->total_len - xfer->queued_len), xfer->max_packet_size);
+  bool const buf1 = (pcd_get_endpoint(USB, ep_ix) & USB_EP_DTOG_RX) != 0; // SW_BUF
+  uint16_t const addr_ptr = (uint16_t) (buf1 ? pcd_get_ep_rx_address(USB, ep_ix) : pcd_get_ep_tx_address(USB, ep_ix));
+
+  if (xfer->ff)
+  {
+    dcd_write_packet_memory_ff(xfer->ff, addr_ptr, len);
+  }
+  else
+  {
+    dcd_write_packet_memory(addr_ptr, &(xfer->buffer[xfer->queued_len]), len);
+  }
+  xfer->queued_len = (uint16_t)(xfer->queued_len + len);
+
+  if (buf1)
+  {
+    pcd_set_ep_rx_cnt(USB, ep_ix, len);
+  }
+  else
+  {
+    pcd_set_ep_tx_cnt(USB, ep_ix, len);
+  }
+
+  xfer->dbuf_pending = true;
+}
+
+// Hand the loaded packet to hardware, then pre-load the following one while it is being sent
+static void dbuf_transmit_next(xfer_ctl_t * xfer, uint32_t ep_ix)
+{
+  pcd_rx_dtog(USB, ep_ix); // toggle SW_BUF
+  xfer->dbuf_pending = false;
+
+  if (xfer->queued_len != xfer->total_len)
+  {
+    dbuf_load_packet(xfer, ep_ix);
+  }
+}
+
+// Set size of the OUT buffer that hardware fills next
+static void dbuf_set_rx_bufsize(xfer_ctl_t * xfer, uint32_t ep_ix, bool buf1, uint16_t queued_len)
+{
+  uint16_t const size = tu_min16((uint16_t)(xfer->total_len - queued_len), xfer->max_packet_size);
+
+  if (buf1)
+  {
+    pcd_set_ep_rx_bufsize(USB, ep_ix, size);
+  }
+  else
+  {
+    pcd_set_ep_tx_bufsize(USB, ep_ix, size);
+  }
+}
+
+static void dbuf_xfer_start(xfer_ctl_t * xfer, uint32_t ep_ix, uint8_t dir)
+{
+  if (dir == TUSB_DIR_OUT)
+  {
+    // Both buffers are owned by application (NAK) when idle: release the one hardware points to
+    bool const buf1 = (pcd_get_endpoint(USB, ep_ix) & USB_EP_DTOG_RX) != 0;
+    dbuf_set_rx_bufsize(xfer, ep_ix, buf1, 0);
+    pcd_tx_dtog(USB, ep_ix); // toggle SW_BUF
+    pcd_set_ep_rx_status(USB, ep_ix, USB_EP_RX_VALID);
+  }
+  else
+  {
+    dbuf_load_packet(xfer, ep_ix);
+    dbuf_transmit_next(xfer, ep_ix);
+    pcd_set_ep_tx_status(USB, ep_ix, USB_EP_TX_VALID);
+  }
+}
+
+static void dbuf_receive_packet(xfer_ctl_t * xfer, uint8_t ep_addr, uint32_t ep_ix, uint32_t ep_reg)
+{
+  // DTOG_RX is toggled by hardware once a packet is received: set means it is in buffer 0
+  bool const buf1 = (ep_reg & USB_EP_DTOG_RX) == 0;
+  uint16_t const count    = (uint16_t) (buf1 ? pcd_get_ep_rx_cnt(USB, ep_ix) : pcd_get_ep_tx_cnt(USB, ep_ix));
+  uint16_t const addr     = (uint16_t) (buf1 ? pcd_get_ep_rx_address(USB, ep_ix) : pcd_get_ep_tx_address(USB, ep_ix));
+  uint16_t const rx_total = (uint16_t) (xfer->queued_len + count);
+  bool const complete     = (count < xfer->max_packet_size) || (rx_total >= xfer->total_len);
+
+  TU_ASSERT(count <= xfer->max_packet_size, /**/);
+
+  pcd_clear_rx_ep_ctr(USB, ep_ix);
+
+  // More packets expected: release the other buffer first, so that the host can send the next packet
+  // while this one is copied. Otherwise keep it, hardware NAKs until next transfer is queued.
+  if (!complete)
+  {
+    dbuf_set_rx_bufsize(xfer, ep_ix, !buf1, rx_total);
+    pcd_tx_dtog(USB, ep_ix); // toggle SW_BUF
+  }
+
+  if (count != 0U)
+  {
+    if (xfer->ff)
+    {
+      dcd_read_packet_memory_ff(xfer->ff, addr, count);
+    }
+    else
+    {
+      dcd_read_packet_memory(&(xfer->buffer[xfer->queued_len]), addr, count);
+    }
+  }
+  xfer->queued_len = rx_total;
+
+  if (complete)
+  {
+    dcd_event_xfer_complete(0, ep_addr, xfer->queued_len, XFER_RESULT_SUCCESS, true);
+  }
+}
+#endif
+
 // Handle CTR interrupt for the TX/IN direction
 //
 // Upon call, (wIstr & USB_ISTR_DIR) == 0U
@@ -522,9 +682,18 @@ static void dcd_ep_ctr_tx_handler(uint32_t wIstr)
   pcd_clear_tx_ep_ctr(USB, EPindex);
 
   xfer_ctl_t * xfer = xfer_ctl_ptr(ep_addr);
-  if((xfer->total_len != xfer->queued_len)) /* TX not complete */
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  if (xfer->dbuf && xfer->dbuf_pending)
+  {
+    dbuf_transmit_next(xfer, EPindex);
+  }
+  else
+#endif
+  if(!xfer->dbuf && (xfer->total_len != xfer->queued_len)) /* TX not complete */
   {
+      TU_PROF_BEGIN(TU_PROF_FIFO);
       dcd_transmit_packet(xfer, EPindex);
+      TU_PROF_END(0, TU_PROF_FIFO);
   }
   else /* TX Complete */
   {
@@ -552,6 +721,7 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
 
   if((ep_addr == 0U) && ((wEPRegVal & USB_EP_SETUP) != 0U)) /* Setup packet */
   {
+    TU_PROF_BEGIN(TU_PROF_SETUP);
     uint32_t count = pcd_get_ep_rx_cnt(USB, EPindex);
     /* Get SETUP Packet*/
     if(count == 8) // Setup packet should always be 8 bytes. If not, ignore it, and try again.
@@ -569,7 +739,14 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
       dcd_event_setup_received(0, (uint8_t*)userMemBuf, true);
 #endif
     }
+    TU_PROF_END(0, TU_PROF_SETUP);
+  }
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  else if (xfer->dbuf)
+  {
+    dbuf_receive_packet(xfer, ep_addr, EPindex, wEPRegVal);
   }
+#endif
   else
   {
     uint32_t count;
@@ -590,6 +767,7 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
 
     if (count != 0U)
     {
+      TU_PROF_BEGIN(TU_PROF_FIFO);
       uint16_t addr = pcd_get_ep_rx_address(USB, EPindex);
 
       if (xfer->ff)
@@ -600,6 +778,7 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
       {
         dcd_read_packet_memory(&(xfer->buffer[xfer->queued_len]), addr, count);
       }
+      TU_PROF_END(0, TU_PROF_FIFO);
 
       xfer->queued_len = (uint16_t)(xfer->queued_len + count);
     }
@@ -658,7 +837,7 @@ static void dcd_ep_ctr_handler(void)
   }
 }
 
-void dcd_int_handler(uint8_t rhport) {
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport) {
 
   (void) rhport;
 
@@ -673,15 +852,19 @@ void dcd_int_handler(uint8_t rhport) {
 
   /* Put SOF flag at the beginning of ISR in case to get least amount of jitter if it is used for timing purposes */
   if(int_status & USB_ISTR_SOF) {
+    TU_PROF_BEGIN(TU_PROF_SOF);
     USB->ISTR = (fsdev_bus_t)~USB_ISTR_SOF;
     dcd_event_sof(0, USB->FNR & USB_FNR_FN, true);
+    TU_PROF_END(0, TU_PROF_SOF);
   }
 
   if(int_status & USB_ISTR_RESET) {
+    TU_PROF_BEGIN(TU_PROF_BUS);
     // USBRST is start of reset.
     USB->ISTR = (fsdev_bus_t)~USB_ISTR_RESET;
     dcd_handle_bus_reset();
     dcd_event_bus_reset(0, TUSB_SPEED_FULL, true);
+    TU_PROF_END(0, TU_PROF_BUS);
     return; // Don't do the rest of the things here; perhaps they've been cleared?
   }
 
@@ -689,7 +872,9 @@ void dcd_int_handler(uint8_t rhport) {
   {
     /* servicing of the endpoint correct transfer interrupt */
     /* clear of the CTR flag into the sub */
+    TU_PROF_BEGIN(TU_PROF_XFER);
     dcd_ep_ctr_handler();
+    TU_PROF_END(0, TU_PROF_XFER);
   }
 
   if (int_status & USB_ISTR_WKUP)
@@ -753,6 +938,10 @@ void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request_t const * re
 static void dcd_pma_alloc_reset(void)
 {
   open_ep_count = 0;
+  pma_planned = false;
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  pma_single_buf = 0;
+#endif
   ep_buf_ptr = DCD_STM32_BTABLE_BASE + 8*MAX_EP_COUNT; // 8 bytes per endpoint (two TX and two RX words, each)
   //TU_LOG2("dcd_pma_alloc_reset()\r\n");
   for(uint32_t i=0; i<MAX_EP_COUNT; i++)
@@ -773,18 +962,10 @@ static void dcd_pma_alloc_reset(void)
  *
  * During failure, TU_ASSERT is used. If this happens, rework/reallocate memory manually.
  */
-static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length)
+static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length, bool dbuf)
 {
   xfer_ctl_t* epXferCtl = xfer_ctl_ptr(ep_addr);
 
-  if(epXferCtl->pma_alloc_size != 0U)
-  {
-    //TU_LOG2("dcd_pma_alloc(%x,%x)=%x (cached)\r\n",ep_addr,length,epXferCtl->pma_ptr);
-    // Previously allocated
-    TU_ASSERT(length <= epXferCtl->pma_alloc_size, 0xFFFF);  // Verify no larger than previous alloc
-    return epXferCtl->pma_ptr;
-  }
-
   // Ensure allocated buffer is aligned
 #ifdef FSDEV_BUS_32BIT
   length = (length + 3) & ~0x03;
@@ -792,6 +973,27 @@ static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length)
   length = (length + 1) & ~0x01;
 #endif
 
+  // Double-buffered endpoint: second buffer follows the first one, see dcd_pma_dbuf1()
+  if (dbuf)
+  {
+    length = (uint16_t)(2*length);
+  }
+
+  if(epXferCtl->pma_alloc_size != 0U)
+  {
+    //TU_LOG2("dcd_pma_alloc(%x,%x)=%x (cached)\r\n",ep_addr,length,epXferCtl->pma_ptr);
+    // Previously allocated or planned
+    if (length <= epXferCtl->pma_alloc_size)
+    {
+      open_ep_count++;
+      return epXferCtl->pma_ptr;
+    }
+
+    // Larger than planned (e.g dcd_edpt_iso_alloc() with larger size than descriptors): allocate after the plan,
+    // otherwise verify no larger than previous alloc
+    TU_ASSERT(pma_planned, 0xFFFF);
+  }
+
   open_ep_count++;
 
   uint16_t addr = ep_buf_ptr;
@@ -807,6 +1009,13 @@ static uint16_t dcd_pma_alloc(uint8_t ep_addr, uint16_t length)
   return addr;
 }
 
+// PMA address of the second buffer of a double-buffered endpoint
+TU_ATTR_ALWAYS_INLINE static inline uint16_t dcd_pma_dbuf1(uint8_t ep_addr)
+{
+  xfer_ctl_t* epXferCtl = xfer_ctl_ptr(ep_addr);
+  return (uint16_t)(epXferCtl->pma_ptr + epXferCtl->pma_alloc_size/2);
+}
+
 /***
  * Free a block of PMA space
  */
@@ -817,20 +1026,34 @@ static void dcd_pma_free(uint8_t ep_addr)
   TU_ASSERT(xfer_ctl_ptr(ep_addr)->max_packet_size != 0, /**/);
   open_ep_count--;
 
-  // If count is 2, only EP0 should be open, so allocations can be mostly reset.
-
-  if(open_ep_count == 2)
+  // Planned buffers are kept for the whole configuration, the endpoint (e.g another alternate setting)
+  // reuses it when opened again. If count is 2, only EP0 should be open, so allocations can be mostly reset.
+  if(!pma_planned && open_ep_count == 2)
   {
-    ep_buf_ptr = DCD_STM32_BTABLE_BASE + 8*MAX_EP_COUNT + 2*CFG_TUD_ENDPOINT0_SIZE; // 8 bytes per endpoint (two TX and two RX words, each), and EP0
+    dcd_pma_reset_to_ep0();
+  }
+}
 
-    // Skip EP0
-    for(uint32_t i=1; i<MAX_EP_COUNT; i++)
-    {
-      xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_OUT))->pma_alloc_size = 0U;
-      xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_IN))->pma_alloc_size = 0U;
-      xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_OUT))->pma_ptr = 0U;
-      xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_IN))->pma_ptr = 0U;
-    }
+/***
+ * Release all PMA except EP0 buffers
+ */
+static void dcd_pma_reset_to_ep0(void)
+{
+  open_ep_count = 2;
+  pma_planned = false;
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  pma_single_buf = 0;
+#endif
+
+  ep_buf_ptr = DCD_STM32_BTABLE_BASE + 8*MAX_EP_COUNT + 2*CFG_TUD_ENDPOINT0_SIZE; // 8 bytes per endpoint (two TX and two RX words, each), and EP0
+
+  // Skip EP0
+  for(uint32_t i=1; i<MAX_EP_COUNT; i++)
+  {
+    xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_OUT))->pma_alloc_size = 0U;
+    xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_IN))->pma_alloc_size = 0U;
+    xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_OUT))->pma_ptr = 0U;
+    xfer_ctl_ptr(tu_edpt_addr(i,TUSB_DIR_IN))->pma_ptr = 0U;
   }
 }
 
@@ -853,9 +1076,9 @@ static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type)
     }
 
     // If EP of current direction is not allocated
-    // Except for ISO endpoint, both direction should be free
+    // Except for ISO (and double-buffered bulk) endpoint, both direction should be free
     if(!ep_alloc_status[i].allocated[dir] &&
-       (ep_type != TUSB_XFER_ISOCHRONOUS || !ep_alloc_status[i].allocated[dir ^ 1]))
+       (!ep_exclusive(ep_addr, ep_type) || !ep_alloc_status[i].allocated[dir ^ 1]))
     {
       // Check if EP number is the same
       if(ep_alloc_status[i].ep_num == 0xFF ||
@@ -894,8 +1117,8 @@ static void dcd_ep_free(uint8_t ep_addr)
        ep_alloc_status[i].allocated[dir] == dir)
     {
       ep_alloc_status[i].allocated[dir] = false;
-      // Reset entry if ISO endpoint or both direction are free
-      if(ep_alloc_status[i].ep_type == TUSB_XFER_ISOCHRONOUS ||
+      // Reset entry if ISO (or double-buffered bulk) endpoint or both direction are free
+      if(ep_exclusive(ep_addr, ep_alloc_status[i].ep_type) ||
          !ep_alloc_status[i].allocated[dir ^ 1])
       {
         ep_alloc_status[i].ep_num = 0xFF;
@@ -907,6 +1130,126 @@ static void dcd_ep_free(uint8_t ep_addr)
   }
 }
 
+// Lay out PMA for all endpoints (any alternate setting) of the configuration at once:
+// - each endpoint address gets a fixed buffer sized for its largest packet among all alternate settings,
+//   switching alternate setting (SET_INTERFACE) therefore reuses the same buffer instead of leaking PMA
+// - bulk endpoints are double-buffered (CFG_TUD_FSDEV_DOUBLE_BUFFER) as long as PMA and hardware endpoint
+//   registers allow, otherwise the highest numbered ones fall back to single buffer
+// If the configuration does not fit, PMA is allocated incrementally by dcd_edpt_open() as before
+void dcd_edpt_config_plan(uint8_t rhport, tusb_desc_configuration_t const * desc_cfg)
+{
+  (void) rhport;
+
+  // Only plan when there is no other open endpoint than EP0
+  if (open_ep_count != 2) return;
+  dcd_pma_reset_to_ep0();
+
+  uint16_t ep_size[MAX_EP_COUNT][2] = { 0 };
+  uint8_t  ep_type[MAX_EP_COUNT][2] = { 0 };
+
+  uint8_t const* p_desc   = (uint8_t const*) desc_cfg;
+  uint8_t const* desc_end = p_desc + tu_le16toh(desc_cfg->wTotalLength);
+
+  while (p_desc < desc_end)
+  {
+    if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT)
+    {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+      uint8_t const dir   = tu_edpt_dir(desc_ep->bEndpointAddress);
+      if (epnum == 0 || epnum >= MAX_EP_COUNT) return; // let dcd_edpt_open() report the error
+
+      // same alignment as dcd_pma_alloc()
+      uint16_t size = pcd_aligned_buffer_size(tu_edpt_packet_size(desc_ep));
+#ifdef FSDEV_BUS_32BIT
+      size = (size + 3) & ~0x03;
+#else
+      size = (size + 1) & ~0x01;
+#endif
+
+      ep_size[epnum][dir] = tu_max16(ep_size[epnum][dir], size);
+      ep_type[epnum][dir] = desc_ep->bmAttributes.xfer;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  uint16_t single_buf = 0;
+
+  while (1)
+  {
+    uint32_t pma_end = ep_buf_ptr;
+    uint8_t ep_regs = 1; // EP0
+
+    for (uint8_t epnum = 1; epnum < MAX_EP_COUNT; epnum++)
+    {
+      bool exclusive[2];
+      for (uint8_t dir = 0; dir < 2; dir++)
+      {
+        bool const dbuf = CFG_TUD_FSDEV_DOUBLE_BUFFER && (ep_type[epnum][dir] == TUSB_XFER_BULK) &&
+                          !tu_bit_test(single_buf, epnum + 8*dir);
+        exclusive[dir] = dbuf || (ep_type[epnum][dir] == TUSB_XFER_ISOCHRONOUS);
+        pma_end += (uint32_t) ep_size[epnum][dir] * (dbuf ? 2 : 1);
+      }
+
+      // Both directions share one register if none is exclusive and type is the same
+      if (ep_size[epnum][0] && ep_size[epnum][1])
+      {
+        ep_regs += (!exclusive[0] && !exclusive[1] && ep_type[epnum][0] == ep_type[epnum][1]) ? 1 : 2;
+      }
+      else if (ep_size[epnum][0] || ep_size[epnum][1])
+      {
+        ep_regs++;
+      }
+    }
+
+    if (pma_end <= FSDEV_PMA_SIZE && ep_regs <= STFSDEV_EP_COUNT) break;
+
+    // Demote highest numbered double-buffered bulk endpoint to single buffer
+    bool demoted = false;
+    for (uint8_t i = 2*MAX_EP_COUNT; CFG_TUD_FSDEV_DOUBLE_BUFFER && i > 0 && !demoted; i--)
+    {
+      uint8_t const epnum = (uint8_t) ((i - 1) / 2);
+      uint8_t const dir   = (uint8_t) ((i - 1) & 1);
+      uint8_t const bit   = (uint8_t) (epnum + 8*dir);
+      if (ep_type[epnum][dir] == TUSB_XFER_BULK && !tu_bit_test(single_buf, bit))
+      {
+        single_buf |= (uint16_t) TU_BIT(bit);
+        demoted = true;
+      }
+    }
+
+    if (!demoted)
+    {
+      TU_LOG2("  PMA plan: %lu bytes, %u endpoint registers required\r\n", (unsigned long) pma_end, ep_regs);
+      return;
+    }
+  }
+
+  // Apply: buffers follow EP0 in ascending endpoint order, OUT then IN
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  pma_single_buf = single_buf;
+#endif
+
+  for (uint8_t epnum = 1; epnum < MAX_EP_COUNT; epnum++)
+  {
+    for (uint8_t dir = 0; dir < 2; dir++)
+    {
+      if (ep_size[epnum][dir] == 0) continue;
+
+      uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+      uint16_t const size = (uint16_t) (ep_size[epnum][dir] * (ep_dbuf(ep_addr, ep_type[epnum][dir]) ? 2 : 1));
+
+      xfer_ctl_t* xfer = xfer_ctl_ptr(ep_addr);
+      xfer->pma_ptr = ep_buf_ptr;
+      xfer->pma_alloc_size = size;
+      ep_buf_ptr = (uint16_t) (ep_buf_ptr + size);
+    }
+  }
+
+  pma_planned = true;
+  TU_LOG2("  PMA plan: %u of %u bytes\r\n", ep_buf_ptr, (unsigned) FSDEV_PMA_SIZE);
+}
+
 // The STM32F0 doesn't seem to like |= or &= to manipulate the EP#R registers,
 // so I'm using the #define from HAL here, instead.
 
@@ -917,6 +1260,7 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc
   uint8_t const dir   = tu_edpt_dir(p_endpoint_desc->bEndpointAddress);
   const uint16_t packet_size = tu_edpt_packet_size(p_endpoint_desc);
   const uint16_t buffer_size = pcd_aligned_buffer_size(packet_size);
+  const bool dbuf = ep_dbuf(p_endpoint_desc->bEndpointAddress, p_endpoint_desc->bmAttributes.xfer);
   uint16_t pma_addr;
   uint32_t wType;
 
@@ -932,7 +1276,8 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc
     wType = USB_EP_ISOCHRONOUS;
     break;
   case TUSB_XFER_BULK:
-    wType = USB_EP_CONTROL;
+    // DBL_BUF is the EP_KIND meaning of the bulk type only
+    wType = dbuf ? USB_EP_BULK : USB_EP_CONTROL;
     break;
 
   case TUSB_XFER_INTERRUPT:
@@ -945,26 +1290,60 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc
 
   pcd_set_eptype(USB, ep_idx, wType);
   pcd_set_ep_address(USB, ep_idx, tu_edpt_number(p_endpoint_desc->bEndpointAddress));
-  // Be normal, for now, instead of only accepting zero-byte packets (on control endpoint)
-  // or being double-buffered (bulk endpoints)
-  pcd_clear_ep_kind(USB,0);
+
+  xfer_ctl_ptr(p_endpoint_desc->bEndpointAddress)->dbuf = dbuf;
+  xfer_ctl_ptr(p_endpoint_desc->bEndpointAddress)->dbuf_pending = false;
+
+  if (dbuf)
+  {
+    pcd_set_ep_kind(USB, ep_idx);
+  }
+  else
+  {
+    // Be normal, for now, instead of only accepting zero-byte packets (on control endpoint)
+    pcd_clear_ep_kind(USB, ep_idx);
+  }
 
   /* Create a packet memory buffer area. For isochronous endpoints,
    * use the same buffer as the double buffer, essentially disabling double buffering */
-  pma_addr = dcd_pma_alloc(p_endpoint_desc->bEndpointAddress, buffer_size);
+  pma_addr = dcd_pma_alloc(p_endpoint_desc->bEndpointAddress, buffer_size, dbuf);
 
-  if( (dir == TUSB_DIR_IN) || (wType == USB_EP_ISOCHRONOUS) )
+  if (dbuf)
   {
+    // Buffer 0 uses the TX descriptor, buffer 1 the RX descriptor. Both toggles are cleared,
+    // DTOG == SW_BUF means the application owns both buffers i.e hardware NAKs until a transfer is queued.
     pcd_set_ep_tx_address(USB, ep_idx, pma_addr);
-    pcd_set_ep_tx_bufsize(USB, ep_idx, buffer_size);
+    pcd_set_ep_rx_address(USB, ep_idx, dcd_pma_dbuf1(p_endpoint_desc->bEndpointAddress));
+
+    if (dir == TUSB_DIR_IN)
+    {
+      pcd_set_ep_tx_cnt(USB, ep_idx, 0);
+      pcd_set_ep_rx_cnt(USB, ep_idx, 0);
+    }
+    else
+    {
+      pcd_set_ep_tx_bufsize(USB, ep_idx, buffer_size);
+      pcd_set_ep_rx_bufsize(USB, ep_idx, buffer_size);
+    }
+
     pcd_clear_tx_dtog(USB, ep_idx);
+    pcd_clear_rx_dtog(USB, ep_idx);
   }
-
-  if( (dir == TUSB_DIR_OUT) || (wType == USB_EP_ISOCHRONOUS) )
+  else
   {
-    pcd_set_ep_rx_address(USB, ep_idx, pma_addr);
-    pcd_set_ep_rx_bufsize(USB, ep_idx, buffer_size);
-    pcd_clear_rx_dtog(USB, ep_idx);
+    if( (dir == TUSB_DIR_IN) || (wType == USB_EP_ISOCHRONOUS) )
+    {
+      pcd_set_ep_tx_address(USB, ep_idx, pma_addr);
+      pcd_set_ep_tx_bufsize(USB, ep_idx, buffer_size);
+      pcd_clear_tx_dtog(USB, ep_idx);
+    }
+
+    if( (dir == TUSB_DIR_OUT) || (wType == USB_EP_ISOCHRONOUS) )
+    {
+      pcd_set_ep_rx_address(USB, ep_idx, pma_addr);
+      pcd_set_ep_rx_bufsize(USB, ep_idx, buffer_size);
+      pcd_clear_rx_dtog(USB, ep_idx);
+    }
   }
 
   /* Enable endpoint */
@@ -993,7 +1372,20 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc
 void dcd_edpt_close_all (uint8_t rhport)
 {
   (void) rhport;
-  // TODO implement dcd_edpt_close_all()
+
+  // EP0 always takes hardware endpoint register 0, disable all others and release their PMA
+  for (uint32_t i = 1; i < STFSDEV_EP_COUNT; i++)
+  {
+    pcd_set_ep_tx_status(USB, i, USB_EP_TX_DIS);
+    pcd_set_ep_rx_status(USB, i, USB_EP_RX_DIS);
+
+    ep_alloc_status[i].ep_num = 0xFF;
+    ep_alloc_status[i].ep_type = 0xFF;
+    ep_alloc_status[i].allocated[0] = false;
+    ep_alloc_status[i].allocated[1] = false;
+  }
+
+  dcd_pma_reset_to_ep0();
 }
 
 /**
@@ -1036,7 +1428,7 @@ bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet
 
   /* Create a packet memory buffer area. For isochronous endpoints,
    * use the same buffer as the double buffer, essentially disabling double buffering */
-  uint16_t pma_addr = dcd_pma_alloc(ep_addr, buffer_size);
+  uint16_t pma_addr = dcd_pma_alloc(ep_addr, buffer_size, false);
 
   xfer_ctl_ptr(ep_addr)->ep_idx = ep_idx;
 
@@ -1081,7 +1473,7 @@ bool dcd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpo
   return true;
 }
 
-// Currently, single-buffered, and only 64 bytes at a time (max)
+// Currently, single-buffered (see dbuf_load_packet() for double-buffered bulk), and only 64 bytes at a time (max)
 
 static void dcd_transmit_packet(xfer_ctl_t * xfer, uint16_t ep_ix)
 {
@@ -1128,6 +1520,14 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   xfer->total_len = total_bytes;
   xfer->queued_len = 0;
 
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  if (xfer->dbuf)
+  {
+    dbuf_xfer_start(xfer, ep_idx, dir);
+    return true;
+  }
+#endif
+
   if ( dir == TUSB_DIR_OUT )
   {
     // A setup token can occur immediately after an OUT STATUS packet so make sure we have a valid
@@ -1165,6 +1565,14 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   xfer->total_len = total_bytes;
   xfer->queued_len = 0;
 
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  if (xfer->dbuf)
+  {
+    dbuf_xfer_start(xfer, epnum, dir);
+    return true;
+  }
+#endif
+
   if ( dir == TUSB_DIR_OUT )
   {
     if(total_bytes > xfer->max_packet_size)
@@ -1216,6 +1624,13 @@ void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
 
     /* Reset to DATA0 if clearing stall condition. */
     pcd_clear_tx_dtog(USB, ep_idx);
+
+    // Double-buffered: SW_BUF follows DTOG, application owns both buffers
+    if (xfer->dbuf)
+    {
+      pcd_clear_rx_dtog(USB, ep_idx);
+      xfer->dbuf_pending = false;
+    }
   }
   else
   { // OUT
@@ -1224,319 +1639,67 @@ void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
     }
     /* Reset to DATA0 if clearing stall condition. */
     pcd_clear_rx_dtog(USB, ep_idx);
-  }
-}
-
-#ifdef FSDEV_BUS_32BIT
-static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
-{
-  const uint8_t* srcVal = src;
-  volatile uint32_t* dst32 = (volatile uint32_t*)(USB_PMAADDR + dst);
-
-  for (uint32_t n = wNBytes / 4; n > 0; --n) {
-    *dst32++ = tu_unaligned_read32(srcVal);
-    srcVal += 4;
-  }
 
-  wNBytes = wNBytes & 0x03;
-  if (wNBytes)
-  {
-    uint32_t wrVal = *srcVal;
-    wNBytes--;
-
-    if (wNBytes)
+    if (xfer->dbuf)
     {
-      wrVal |= *++srcVal << 8;
-      wNBytes--;
-
-      if (wNBytes)
-      {
-        wrVal |= *++srcVal << 16;
-      }
+      pcd_clear_tx_dtog(USB, ep_idx);
     }
-
-    *dst32 = wrVal;
   }
-
-  return true;
 }
+
+// Packet memory is accessed with bus width (16 or 32-bit), 16-bit PMA with 1x2 access scheme has
+// each halfword mapped in a 32-bit word (FSDEV_PMA_STRIDE = 2)
+#ifdef FSDEV_BUS_32BIT
+  #define FSDEV_PMA_ACCESS        TU_HWFIFO_MEM32
+  #define FSDEV_PMA_PTR(_offset)  ((volatile void*) &pma32[(_offset) >> 2])
 #else
-// Packet buffer access can only be 8- or 16-bit.
+  #define FSDEV_PMA_ACCESS        TU_HWFIFO_ACCESS(2, 2*FSDEV_PMA_STRIDE, false)
+  #define FSDEV_PMA_PTR(_offset)  ((volatile void*) &pma[FSDEV_PMA_STRIDE * ((_offset) >> 1)])
+#endif
+
 /**
   * @brief Copy a buffer from user memory area to packet memory area (PMA).
-  *        This uses byte-access for user memory (so support non-aligned buffers)
-  *        and 16-bit access for packet memory.
-  * @param   dst, byte address in PMA; must be 16-bit aligned
-  * @param   src pointer to user memory area.
-  * @param   wPMABufAddr address into PMA.
+  * @param   dst, byte address in PMA; must be bus width aligned
+  * @param   src pointer to user memory area, can be unaligned.
   * @param   wNBytes no. of bytes to be copied.
-  * @retval None
   */
 static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
 {
-  uint32_t n = (uint32_t)wNBytes >> 1U;
-  uint16_t temp1, temp2;
-  const uint8_t * srcVal;
-
-  // The GCC optimizer will combine access to 32-bit sizes if we let it. Force
-  // it volatile so that it won't do that.
-  __IO uint16_t *pdwVal;
-
-  srcVal = src;
-  pdwVal = &pma[FSDEV_PMA_STRIDE * (dst >> 1)];
-
-  while (n--)
-  {
-    temp1 = (uint16_t)*srcVal;
-    srcVal++;
-    temp2 = temp1 | ((uint16_t)(((uint16_t)(*srcVal)) << 8U)) ;
-    *pdwVal = temp2;
-    pdwVal += FSDEV_PMA_STRIDE;
-    srcVal++;
-  }
-
-  if (wNBytes)
-  {
-    temp1 = *srcVal;
-    *pdwVal = temp1;
-  }
-
+  tu_hwfifo_write(FSDEV_PMA_PTR(dst), src, wNBytes, FSDEV_PMA_ACCESS);
   return true;
 }
-#endif
 
 /**
   * @brief Copy from FIFO to packet memory area (PMA).
-  *        Uses byte-access of system memory and 16-bit access of packet memory
+  *        Wrapped part of the FIFO is combined so that PMA is always access aligned
   * @param   wNBytes no. of bytes to be copied.
-  * @retval None
   */
 static bool dcd_write_packet_memory_ff(tu_fifo_t * ff, uint16_t dst, uint16_t wNBytes)
 {
-  // Since we copy from a ring buffer FIFO, a wrap might occur making it necessary to conduct two copies
-  tu_fifo_buffer_info_t info;
-  tu_fifo_get_read_info(ff, &info);
-
-  uint16_t cnt_lin =  TU_MIN(wNBytes, info.len_lin);
-  uint16_t cnt_wrap = TU_MIN(wNBytes - cnt_lin, info.len_wrap);
-
-  // We want to read from the FIFO and write it into the PMA, if LIN part is ODD and has WRAPPED part,
-  // last lin byte will be combined with wrapped part
-  // To ensure PMA is always access aligned (dst aligned to 16 or 32 bit)
-#ifdef FSDEV_BUS_32BIT
-  if((cnt_lin & 0x03) && cnt_wrap)
-  {
-    // Copy first linear part
-    dcd_write_packet_memory(dst, info.ptr_lin, cnt_lin &~0x03);
-    dst += cnt_lin &~0x03;
-
-    // Copy last linear bytes & first wrapped bytes to buffer
-    uint32_t i;
-    uint8_t tmp[4];
-    for (i = 0; i < (cnt_lin & 0x03); i++)
-    {
-      tmp[i] = ((uint8_t*)info.ptr_lin)[(cnt_lin &~0x03) + i];
-    }
-    uint32_t wCnt = cnt_wrap;
-    for (; i < 4 && wCnt > 0; i++, wCnt--)
-    {
-      tmp[i] = *(uint8_t*)info.ptr_wrap;
-      info.ptr_wrap = (uint8_t*)info.ptr_wrap + 1;
-    }
-
-    // Write unaligned buffer
-    dcd_write_packet_memory(dst, &tmp, 4);
-    dst += 4;
-
-    // Copy rest of wrapped byte
-    if (wCnt)
-        dcd_write_packet_memory(dst, info.ptr_wrap, wCnt);
-  }
-#else
-  if((cnt_lin & 0x01) && cnt_wrap)
-  {
-    // Copy first linear part
-    dcd_write_packet_memory(dst, info.ptr_lin, cnt_lin &~0x01);
-    dst += cnt_lin &~0x01;
-
-    // Copy last linear byte & first wrapped byte
-    uint16_t tmp = ((uint8_t*)info.ptr_lin)[cnt_lin - 1] | ((uint16_t)(((uint8_t*)info.ptr_wrap)[0]) << 8U);
-    dcd_write_packet_memory(dst, &tmp, 2);
-    dst += 2;
-
-    // Copy rest of wrapped byte
-    dcd_write_packet_memory(dst, ((uint8_t*)info.ptr_wrap) + 1, cnt_wrap - 1);
-  }
-#endif
-  else
-  {
-    // Copy linear part
-    dcd_write_packet_memory(dst, info.ptr_lin, cnt_lin);
-    dst += info.len_lin;
-
-    if(info.len_wrap)
-    {
-      // Copy wrapped byte
-      dcd_write_packet_memory(dst, info.ptr_wrap, cnt_wrap);
-    }
-  }
-
-  tu_fifo_advance_read_pointer(ff, cnt_lin + cnt_wrap);
-
+  (void) tu_hwfifo_write_from_fifo(FSDEV_PMA_PTR(dst), ff, wNBytes, FSDEV_PMA_ACCESS);
   return true;
 }
 
-#ifdef FSDEV_BUS_32BIT
-static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
-{
-  uint8_t* dstVal = dst;
-  volatile uint32_t* src32 = (volatile uint32_t*)(USB_PMAADDR + src);
-
-  for (uint32_t n = wNBytes / 4; n > 0; --n) {
-    tu_unaligned_write32(dstVal, *src32++);
-    dstVal += 4;
-  }
-
-  wNBytes = wNBytes & 0x03;
-  if (wNBytes)
-  {
-    uint32_t rdVal = *src32;
-
-    *dstVal = tu_u32_byte0(rdVal);
-    wNBytes--;
-
-    if (wNBytes)
-    {
-      *++dstVal = tu_u32_byte1(rdVal);
-      wNBytes--;
-
-      if (wNBytes)
-      {
-        *++dstVal = tu_u32_byte2(rdVal);
-      }
-    }
-  }
-
-  return true;
-}
-#else
 /**
   * @brief Copy a buffer from packet memory area (PMA) to user memory area.
-  *        Uses byte-access of system memory and 16-bit access of packet memory
+  * @param   dst pointer to user memory area, can be unaligned.
+  * @param   src, byte address in PMA; must be bus width aligned
   * @param   wNBytes no. of bytes to be copied.
-  * @retval None
   */
 static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
 {
-  uint32_t n = (uint32_t)wNBytes >> 1U;
-  // The GCC optimizer will combine access to 32-bit sizes if we let it. Force
-  // it volatile so that it won't do that.
-  __IO const uint16_t *pdwVal;
-  uint32_t temp;
-
-  pdwVal = &pma[FSDEV_PMA_STRIDE * (src >> 1)];
-  uint8_t *dstVal = (uint8_t*)dst;
-
-  while (n--)
-  {
-    temp = *pdwVal;
-    pdwVal += FSDEV_PMA_STRIDE;
-    *dstVal++ = ((temp >> 0) & 0xFF);
-    *dstVal++ = ((temp >> 8) & 0xFF);
-  }
-
-  if (wNBytes & 0x01)
-  {
-    temp = *pdwVal;
-    pdwVal += FSDEV_PMA_STRIDE;
-    *dstVal++ = ((temp >> 0) & 0xFF);
-  }
+  tu_hwfifo_read(FSDEV_PMA_PTR(src), dst, wNBytes, FSDEV_PMA_ACCESS);
   return true;
 }
-#endif
 
 /**
   * @brief Copy a buffer from user packet memory area (PMA) to FIFO.
-  *        Uses byte-access of system memory and 16-bit access of packet memory
+  *        Wrapped part of the FIFO is combined so that PMA is always access aligned
   * @param   wNBytes no. of bytes to be copied.
-  * @retval None
   */
 static bool dcd_read_packet_memory_ff(tu_fifo_t * ff, uint16_t src, uint16_t wNBytes)
 {
-  // Since we copy into a ring buffer FIFO, a wrap might occur making it necessary to conduct two copies
-  // Check for first linear part
-  tu_fifo_buffer_info_t info;
-  tu_fifo_get_write_info(ff, &info);  // We want to read from the FIFO
-
-  uint16_t cnt_lin =  TU_MIN(wNBytes, info.len_lin);
-  uint16_t cnt_wrap = TU_MIN(wNBytes - cnt_lin, info.len_wrap);
-
-
-  // We want to read from PMA and write it into the FIFO, if LIN part is ODD and has WRAPPED part,
-  // last lin byte will be combined with wrapped part
-  // To ensure PMA is always access aligned (src aligned to 16 or 32 bit)
-#ifdef FSDEV_BUS_32BIT
-  if((cnt_lin & 0x03) && cnt_wrap)
-  {
-    // Copy first linear part
-    dcd_read_packet_memory(info.ptr_lin, src, cnt_lin &~0x03);
-    src += cnt_lin &~0x03;
-
-    // Copy last linear bytes & first wrapped bytes
-    uint8_t tmp[4];
-    dcd_read_packet_memory(tmp, src, 4);
-    src += 4;
-
-    uint32_t i;
-    for (i = 0; i < (cnt_lin & 0x03); i++)
-    {
-      ((uint8_t*)info.ptr_lin)[(cnt_lin &~0x03) + i] = tmp[i];
-    }
-    uint32_t wCnt = cnt_wrap;
-    for (; i < 4 && wCnt > 0; i++, wCnt--)
-    {
-      *(uint8_t*)info.ptr_wrap = tmp[i];
-      info.ptr_wrap = (uint8_t*)info.ptr_wrap + 1;
-    }
-
-    // Copy rest of wrapped byte
-    if (wCnt)
-      dcd_read_packet_memory(info.ptr_wrap, src, wCnt);
-  }
-#else
-  if((cnt_lin & 0x01) && cnt_wrap)
-  {
-    // Copy first linear part
-    dcd_read_packet_memory(info.ptr_lin, src, cnt_lin &~0x01);
-    src += cnt_lin &~0x01;
-
-    // Copy last linear byte & first wrapped byte
-    uint8_t tmp[2];
-    dcd_read_packet_memory(tmp, src, 2);
-    src += 2;
-
-    ((uint8_t*)info.ptr_lin)[cnt_lin - 1] = tmp[0];
-    ((uint8_t*)info.ptr_wrap)[0] = tmp[1];
-
-    // Copy rest of wrapped byte
-    dcd_read_packet_memory(((uint8_t*)info.ptr_wrap) + 1, src, cnt_wrap - 1);
-  }
-#endif
-  else
-  {
-    // Copy linear part
-    dcd_read_packet_memory(info.ptr_lin, src, cnt_lin);
-    src += cnt_lin;
-
-    if(info.len_wrap)
-    {
-      // Copy wrapped byte
-      dcd_read_packet_memory(info.ptr_wrap, src, cnt_wrap);
-    }
-  }
-
-  tu_fifo_advance_write_pointer(ff, cnt_lin + cnt_wrap);
-
+  (void) tu_hwfifo_read_to_fifo(FSDEV_PMA_PTR(src), ff, wNBytes, FSDEV_PMA_ACCESS);
   return true;
 }
 
@@ -1165,7 +1165,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 }
 
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   uint8_t is;
   uint16_t txis, rxis;
@@ -67,19 +67,35 @@
 // Debug level for DWC2
 #define DWC2_DEBUG    2
 
+// Cache maintenance of DMA buffer, default to dcd_dcache_*() which can be implemented by application
+// e.g STM32H7/F7 with D-Cache enabled
 #ifndef dcache_clean
-#define dcache_clean(_addr, _size)
+#define dcache_clean(_addr, _size)             dcd_dcache_clean(_addr, _size)
 #endif
 
 #ifndef dcache_invalidate
-#define dcache_invalidate(_addr, _size)
+#define dcache_invalidate(_addr, _size)        dcd_dcache_invalidate(_addr, _size)
 #endif
 
 #ifndef dcache_clean_invalidate
-#define dcache_clean_invalidate(_addr, _size)
+#define dcache_clean_invalidate(_addr, _size)  dcd_dcache_clean_invalidate(_addr, _size)
 #endif
 
-static TU_ATTR_ALIGNED(4) uint32_t _setup_packet[2];
+// Use internal (buffer) DMA of HS cores and ESP32-S2/S3: packets are moved between memory and FIFO by the core
+// without CPU involvement, one interrupt per transfer. Transfer buffers must be word aligned and DMA accessible.
+#ifndef CFG_TUD_DWC2_DMA
+  #define CFG_TUD_DWC2_DMA   0
+#endif
+
+// SETUP packet is also a DMA target, occupy whole cache line(s) so that invalidating it is safe
+typedef struct {
+  union {
+    TU_ATTR_ALIGNED(4) uint32_t setup_packet[2];
+    TUD_EPBUF_DCACHE_ALIGNED uint8_t setup_packet_dcache_padding[TUD_EPBUF_DCACHE_SIZE(8)];
+  };
+} dwc2_epbuf_t;
+
+CFG_TUD_MEM_SECTION static dwc2_epbuf_t _dwc2_epbuf;
 
 typedef struct {
   uint8_t* buffer;
@@ -102,12 +118,47 @@ static bool _out_ep_closed;                   // Flag to check if RX FIFO size n
 // SOF enabling flag - required for SOF to not get disabled in ISR when SOF was enabled by
 static bool _sof_en;
 
+// DMA mode: EP0 OUT transfer is requested by stack, otherwise EP0 OUT is only armed for SETUP
+static bool _ep0_out_xfer;
+
+TU_ATTR_ALWAYS_INLINE static inline bool dma_enabled(dwc2_regs_t* dwc2) {
+  // architecture 2 = internal DMA
+  return CFG_TUD_DWC2_DMA && (dwc2->ghwcfg2_bm.arch == 2);
+}
+
+// DMA mode: arm EP0 OUT to receive SETUP packets into setup_packet. Since status stage ZLP is also received
+// there, EP0 OUT does not need to be re-programmed for it.
+TU_ATTR_FAST_FUNC static void dma_setup_prepare(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2_epout_t* epout = &dwc2->epout[0];
+
+  if (epout->doepctl & DOEPCTL_EPENA) return; // already armed
+
+  epout->doeptsiz = (3 << DOEPTSIZ_STUPCNT_Pos) | (1 << DOEPTSIZ_PKTCNT_Pos) | (8 << DOEPTSIZ_XFRSIZ_Pos);
+  epout->doepdma = (uint32_t) (uintptr_t) _dwc2_epbuf.setup_packet;
+  epout->doepctl |= DOEPCTL_EPENA | DOEPCTL_CNAK;
+}
+
+// TX FIFO size in words of each IN endpoint planned from configuration descriptor, 0 if not planned
+static uint16_t _fifo_plan_tx[DWC2_EP_MAX];
+static bool _fifo_planned;
+
 // Calculate the RX FIFO size according to recommendations from reference manual
 static inline uint16_t calc_grxfsiz(uint16_t max_ep_size, uint8_t ep_count) {
   return 15 + 2 * (max_ep_size / 4) + 2 * ep_count;
 }
 
-static void update_grxfsiz(uint8_t rhport) {
+// Top of FIFO RAM in words. In DMA mode the core stores its DMA addresses above EPInfoBaseAddr
+TU_ATTR_FAST_FUNC static uint16_t dfifo_top(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint16_t top = (uint16_t) (_dwc2_controller[rhport].ep_fifo_size / 4);
+  if (dma_enabled(dwc2)) {
+    top = tu_min16(top, (uint16_t) (dwc2->gdfifocfg >> 16));
+  }
+  return top;
+}
+
+TU_ATTR_FAST_FUNC static void update_grxfsiz(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
 
@@ -122,14 +173,18 @@ static void update_grxfsiz(uint8_t rhport) {
 }
 
 // Start of Bus Reset
-static void bus_reset(uint8_t rhport) {
+TU_ATTR_FAST_FUNC static void bus_reset(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
 
   tu_memclr(xfer_status, sizeof(xfer_status));
   _out_ep_closed = false;
 
+  tu_memclr(_fifo_plan_tx, sizeof(_fifo_plan_tx));
+  _fifo_planned = false;
+
   _sof_en = false;
+  _ep0_out_xfer = false;
 
   // clear device address
   dwc2->dcfg &= ~DCFG_DAD_Msk;
@@ -201,39 +256,61 @@ static void bus_reset(uint8_t rhport) {
   _allocated_fifo_words_tx = 16;
 
   // Control IN uses FIFO 0 with 64 bytes ( 16 32-bit word )
-  dwc2->dieptxf0 = (16 << DIEPTXF0_TX0FD_Pos) | (_dwc2_controller[rhport].ep_fifo_size / 4 - _allocated_fifo_words_tx);
+  dwc2->dieptxf0 = (16 << DIEPTXF0_TX0FD_Pos) | (dfifo_top(rhport) - _allocated_fifo_words_tx);
 
   // Fixed control EP0 size to 64 bytes
   dwc2->epin[0].diepctl &= ~(0x03 << DIEPCTL_MPSIZ_Pos);
   xfer_status[0][TUSB_DIR_OUT].max_size = 64;
   xfer_status[0][TUSB_DIR_IN].max_size = 64;
 
-  dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+  if (dma_enabled(dwc2)) {
+    dma_setup_prepare(rhport);
+  } else {
+    dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+  }
 
   dwc2->gintmsk |= GINTMSK_OEPINT | GINTMSK_IEPINT;
 }
 
-static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t const num_packets,
+TU_ATTR_FAST_FUNC static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t const num_packets,
                                   uint16_t total_bytes) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  xfer_ctl_t* const xfer = XFER_CTL_BASE(epnum, dir);
+  bool const is_dma = dma_enabled(dwc2);
+  uint8_t* dma_buf = xfer->buffer;
 
   // EP0 is limited to one packet each xfer
   // We use multiple transaction of xfer->max_size length to get a whole transfer done
   if (epnum == 0) {
-    xfer_ctl_t* const xfer = XFER_CTL_BASE(epnum, dir);
+    // DMA continues where previous packet ended
+    if (dma_buf) dma_buf += xfer->total_len - ep0_pending[dir];
     total_bytes = tu_min16(ep0_pending[dir], xfer->max_size);
     ep0_pending[dir] -= total_bytes;
   }
 
+  // zero length packet still needs a valid DMA address
+  if (dma_buf == NULL) dma_buf = (uint8_t*) _dwc2_epbuf.setup_packet;
+
   // IN and OUT endpoint xfers are interrupt-driven, we just schedule them here.
   if (dir == TUSB_DIR_IN) {
     dwc2_epin_t* epin = dwc2->epin;
 
     // A full IN transfer (multiple packets, possibly) triggers XFRC.
-    epin[epnum].dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
-                           ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+    uint32_t dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
+                        ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+
+    // High-bandwidth ISO transfer sends its (up to 3) packets within one micro-frame
+    if ((epin[epnum].diepctl & DIEPCTL_EPTYP) == DIEPCTL_EPTYP_0 && num_packets > 1) {
+      dieptsiz |= ((uint32_t) tu_min16(num_packets, 3) << DIEPTSIZ_MULCNT_Pos);
+    }
+    epin[epnum].dieptsiz = dieptsiz;
+
+    if (is_dma) {
+      dcache_clean(dma_buf, total_bytes);
+      epin[epnum].diepdma = (uint32_t) (uintptr_t) dma_buf;
+    }
 
     epin[epnum].diepctl |= DIEPCTL_EPENA | DIEPCTL_CNAK;
 
@@ -243,13 +320,21 @@ static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t c
       uint32_t const odd_frame_now = (dwc2->dsts & (1u << DSTS_FNSOF_Pos));
       epin[epnum].diepctl |= (odd_frame_now ? DIEPCTL_SD0PID_SEVNFRM_Msk : DIEPCTL_SODDFRM_Msk);
     }
-    // Enable fifo empty interrupt only if there are something to put in the fifo.
-    if (total_bytes != 0) {
+    // Enable fifo empty interrupt only if there are something to put in the fifo. Not needed with DMA
+    if (total_bytes != 0 && !is_dma) {
       dwc2->diepempmsk |= (1 << epnum);
     }
   } else {
     dwc2_epout_t* epout = dwc2->epout;
 
+    if (is_dma) {
+      // status stage ZLP is received by EP0 OUT which is already armed for SETUP
+      if (epnum == 0 && total_bytes == 0 && (epout[0].doepctl & DOEPCTL_EPENA)) return;
+
+      dcache_invalidate(dma_buf, total_bytes);
+      epout[epnum].doepdma = (uint32_t) (uintptr_t) dma_buf;
+    }
+
     // A full OUT transfer (multiple packets, possibly) triggers XFRC.
     epout[epnum].doeptsiz &= ~(DOEPTSIZ_PKTCNT_Msk | DOEPTSIZ_XFRSIZ);
     epout[epnum].doeptsiz |= (num_packets << DOEPTSIZ_PKTCNT_Pos) |
@@ -325,9 +410,6 @@ static void phy_fs_init(dwc2_regs_t* dwc2) {
 
   // MCU specific PHY update post reset
   dwc2_phy_update(dwc2, HS_PHY_TYPE_NONE);
-
-  // set max speed
-  dwc2->dcfg = (dwc2->dcfg & ~DCFG_DSPD_Msk) | (DCFG_DSPD_FS << DCFG_DSPD_Pos);
 }
 
 static void phy_hs_init(dwc2_regs_t* dwc2) {
@@ -378,15 +460,21 @@ static void phy_hs_init(dwc2_regs_t* dwc2) {
 
   // MCU specific PHY update post reset
   dwc2_phy_update(dwc2, dwc2->ghwcfg2_bm.hs_phy_type);
+}
+
+// Set max speed according to selected PHY
+static void dcfg_speed_init(dwc2_regs_t* dwc2) {
+  uint32_t dcfg = dwc2->dcfg & ~DCFG_DSPD_Msk;
 
-  // Set max speed
-  uint32_t dcfg = dwc2->dcfg;
-  dcfg &= ~DCFG_DSPD_Msk;
-  dcfg |= DCFG_DSPD_HS << DCFG_DSPD_Pos;
+  if (dwc2->gusbcfg & GUSBCFG_PHYSEL) {
+    dcfg |= DCFG_DSPD_FS << DCFG_DSPD_Pos;
+  } else {
+    dcfg |= DCFG_DSPD_HS << DCFG_DSPD_Pos;
 
-  // XCVRDLY: transceiver delay between xcvr_sel and txvalid during device chirp is required
-  // when using with some PHYs such as USB334x (USB3341, USB3343, USB3346, USB3347)
-  if (dwc2->ghwcfg2_bm.hs_phy_type == HS_PHY_TYPE_ULPI) dcfg |= DCFG_XCVRDLY;
+    // XCVRDLY: transceiver delay between xcvr_sel and txvalid during device chirp is required
+    // when using with some PHYs such as USB334x (USB3341, USB3343, USB3346, USB3347)
+    if (dwc2->ghwcfg2_bm.hs_phy_type == HS_PHY_TYPE_ULPI) dcfg |= DCFG_XCVRDLY;
+  }
 
   dwc2->dcfg = dcfg;
 }
@@ -406,6 +494,8 @@ static bool check_dwc2(dwc2_regs_t* dwc2) {
   return true;
 }
 
+static void device_mode_init(uint8_t rhport);
+
 void dcd_init(uint8_t rhport) {
   // Programming model begins in the last section of the chapter on the USB
   // peripheral in each Reference Manual.
@@ -424,6 +514,39 @@ void dcd_init(uint8_t rhport) {
     phy_fs_init(dwc2); // core does not support highspeed or hs phy is not present
   }
 
+  device_mode_init(rhport);
+}
+
+#if CFG_TUSB_OTG
+// Switch from host mode: PHY and core are already initialized by hcd_init(), only device mode is set up
+void dcd_role_enter(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // host and device are built for different max speed: PHY must be selected again
+  if (phy_hs_supported(dwc2) == ((dwc2->gusbcfg & GUSBCFG_PHYSEL) != 0)) {
+    dcd_init(rhport);
+    return;
+  }
+
+  dwc2->gahbcfg &= ~GAHBCFG_GINT;
+
+  // power off the port and stop host channels before leaving host mode
+  if (dwc2->gintsts & GINTSTS_CMOD) {
+    // mask out write-1-to-clear bits
+    dwc2->hprt = dwc2->hprt & ~(HPRT_PCDET | HPRT_PENA | HPRT_PENCHNG | HPRT_POCCHNG | HPRT_PPWR);
+    dwc2->haintmsk = 0;
+  }
+  // host fifo empty interrupts and DMA setting are not used or set again by device mode
+  dwc2->gahbcfg &= ~(GAHBCFG_TXFELVL | GAHBCFG_PTXFELVL | GAHBCFG_DMAEN);
+
+  device_mode_init(rhport);
+}
+#endif
+
+// Set up device mode after PHY and core are initialized
+static void device_mode_init(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
   // Restart PHY clock
   dwc2->pcgctl &= ~(PCGCTL_STOPPCLK | PCGCTL_GATEHCLK | PCGCTL_PWRCLMP | PCGCTL_RSTPDWNMODULE);
 
@@ -437,8 +560,11 @@ void dcd_init(uint8_t rhport) {
    */
   dwc2->gusbcfg |= (7ul << GUSBCFG_TOCAL_Pos);
 
-  // Force device mode
+  // Force device mode and wait for the mode switch to take effect (up to 25 ms)
   dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_FHMOD) | GUSBCFG_FDMOD;
+  while (dwc2->gintsts & GINTSTS_CMOD) {}
+
+  dcfg_speed_init(dwc2);
 
   // Clear A override, force B Valid
   dwc2->gotgctl = (dwc2->gotgctl & ~GOTGCTL_AVALOEN) | GOTGCTL_BVALOEN | GOTGCTL_BVALOVAL;
@@ -464,8 +590,24 @@ void dcd_init(uint8_t rhport) {
   // Required as part of core initialization.
   // TODO: How should mode mismatch be handled? It will cause
   // the core to stop working/require reset.
-  dwc2->gintmsk = GINTMSK_OTGINT | GINTMSK_MMISM | GINTMSK_RXFLVLM |
-                  GINTMSK_USBSUSPM | GINTMSK_USBRST | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+  uint32_t gintmsk = GINTMSK_OTGINT | GINTMSK_MMISM | GINTMSK_USBSUSPM | GINTMSK_USBRST | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+
+  if (dma_enabled(dwc2)) {
+    // Core moves packets to/from memory by itself, RX FIFO level interrupt is not used
+    dwc2->gahbcfg |= GAHBCFG_DMAEN | GAHBCFG_HBSTLEN_2;
+  } else {
+    gintmsk |= GINTMSK_RXFLVLM;
+  }
+
+#if CFG_TUD_LPM
+  if (dwc2->ghwcfg3_bm.lpm_mode) {
+    // ACK LPM token and allow L1 shallow sleep (PHY clock gated), resume is handled by core
+    dwc2->glpmcfg |= GLPMCFG_LPMEN | GLPMCFG_LPMACK | GLPMCFG_L1SSEN;
+    gintmsk |= GINTMSK_LPMINTM;
+  }
+#endif
+
+  dwc2->gintmsk = gintmsk;
 
   // Enable global interrupt
   dwc2->gahbcfg |= GAHBCFG_GINT;
@@ -502,6 +644,14 @@ void dcd_remote_wakeup(uint8_t rhport) {
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
 
+#if CFG_TUD_LPM
+  if (dwc2->glpmcfg & GLPMCFG_SLPSTS) {
+    // L1: core drives resume for TL1DevDrvResume (50 us) and clears RWUSIG by itself
+    dwc2->dctl |= DCTL_RWUSIG;
+    return;
+  }
+#endif
+
   // set remote wakeup
   dwc2->dctl |= DCTL_RWUSIG;
 
@@ -546,6 +696,100 @@ void dcd_sof_enable(uint8_t rhport, bool en) {
 /* DCD Endpoint port
  *------------------------------------------------------------------*/
 
+// Partition FIFO RAM for all endpoints (any alternate setting) of the configuration at once:
+// - RX FIFO per databook formula with largest OUT packet and actual number of OUT endpoints
+// - each IN endpoint gets its own FIFO at fixed location, double-buffered when possible with priority
+//   isochronous > bulk > interrupt
+// - remaining space is given to RX FIFO to receive more back-to-back OUT packets
+// If the configuration does not fit, FIFO is allocated incrementally by dcd_edpt_open() as before
+void dcd_edpt_config_plan(uint8_t rhport, tusb_desc_configuration_t const* desc_cfg) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
+  uint16_t const fifo_top = dfifo_top(rhport);
+
+  uint16_t in_words[DWC2_EP_MAX] = { 0 };
+  uint8_t in_type[DWC2_EP_MAX] = { 0 };
+  uint16_t out_max_size = 64; // EP0
+  uint32_t out_bitmap = 1;
+
+  uint8_t const* p_desc = (uint8_t const*) desc_cfg;
+  uint8_t const* desc_end = p_desc + tu_le16toh(desc_cfg->wTotalLength);
+
+  while (p_desc < desc_end) {
+    if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+      if (epnum == 0 || epnum >= ep_count) return; // let dcd_edpt_open() report the error
+
+      // high-bandwidth (highspeed periodic) endpoint has additional transactions per micro-frame
+      uint16_t const packet_size = tu_edpt_hb_size(desc_ep);
+
+      if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+        in_words[epnum] = tu_max16(in_words[epnum], tu_div_ceil(packet_size, 4));
+        in_type[epnum] = desc_ep->bmAttributes.xfer;
+      } else {
+        out_max_size = tu_max16(out_max_size, packet_size);
+        out_bitmap |= TU_BIT(epnum);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  uint8_t out_count = 0;
+  for (uint8_t epnum = 0; epnum < ep_count; epnum++) {
+    if (out_bitmap & TU_BIT(epnum)) out_count++;
+  }
+
+  uint16_t rx_words = calc_grxfsiz(out_max_size, out_count);
+  uint16_t tx_words = 16; // EP0 IN
+  for (uint8_t epnum = 1; epnum < ep_count; epnum++) {
+    tx_words += in_words[epnum];
+  }
+
+  if (rx_words + tx_words > fifo_top) {
+    TU_LOG(DWC2_DEBUG, "  FIFO plan: %u words required, only %u available\r\n", rx_words + tx_words, fifo_top);
+    return;
+  }
+
+  uint16_t plan_tx[DWC2_EP_MAX] = { 0 };
+  for (uint8_t epnum = 1; epnum < ep_count; epnum++) {
+    plan_tx[epnum] = in_words[epnum];
+  }
+
+  uint8_t const double_buf_order[] = { TUSB_XFER_ISOCHRONOUS, TUSB_XFER_BULK, TUSB_XFER_INTERRUPT };
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(double_buf_order); i++) {
+    for (uint8_t epnum = 1; epnum < ep_count; epnum++) {
+      if (in_words[epnum] && in_type[epnum] == double_buf_order[i] &&
+          rx_words + tx_words + in_words[epnum] <= fifo_top) {
+        plan_tx[epnum] += in_words[epnum];
+        tx_words += in_words[epnum];
+      }
+    }
+  }
+
+  rx_words = fifo_top - tx_words;
+
+  // Apply: RX FIFO at bottom, EP0 IN at top then IN endpoints in ascending order below it
+  dwc2->grxfsiz = rx_words;
+  TU_LOG(DWC2_DEBUG, "  FIFO plan (words): RX %u", rx_words);
+
+  uint16_t start = fifo_top - 16;
+  dwc2->dieptxf0 = (16 << DIEPTXF0_TX0FD_Pos) | start;
+
+  for (uint8_t epnum = 1; epnum < ep_count; epnum++) {
+    _fifo_plan_tx[epnum] = plan_tx[epnum];
+    if (plan_tx[epnum]) {
+      start -= plan_tx[epnum];
+      dwc2->dieptxf[epnum - 1] = (plan_tx[epnum] << DIEPTXF_INEPTXFD_Pos) | start;
+      TU_LOG(DWC2_DEBUG, ", IN%u %u%s", epnum, plan_tx[epnum], (plan_tx[epnum] > in_words[epnum]) ? " (x2)" : "");
+    }
+  }
+  TU_LOG(DWC2_DEBUG, ", EP0 IN 16, total %u\r\n", fifo_top);
+
+  _allocated_fifo_words_tx = tx_words;
+  _fifo_planned = true;
+}
+
 bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
   (void) rhport;
 
@@ -561,7 +805,8 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
   xfer->max_size = tu_edpt_packet_size(desc_edpt);
   xfer->interval = desc_edpt->bInterval;
 
-  uint16_t const fifo_size = tu_div_ceil(xfer->max_size, 4);
+  // high-bandwidth endpoint has up to 3 packets per micro-frame in FIFO
+  uint16_t const fifo_size = tu_div_ceil(tu_edpt_hb_size(desc_edpt), 4);
 
   if (dir == TUSB_DIR_OUT) {
     // Calculate required size of RX FIFO
@@ -569,7 +814,7 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
 
     // If size_rx needs to be extended check if possible and if so enlarge it
     if (dwc2->grxfsiz < sz) {
-      TU_ASSERT(sz + _allocated_fifo_words_tx <= _dwc2_controller[rhport].ep_fifo_size / 4);
+      TU_ASSERT(sz + _allocated_fifo_words_tx <= dfifo_top(rhport));
 
       // Enlarge RX FIFO
       dwc2->grxfsiz = sz;
@@ -603,18 +848,21 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
     // In FIFO is allocated by following rules:
     // - IN EP 1 gets FIFO 1, IN EP "n" gets FIFO "n".
 
-    // Check if free space is available
-    TU_ASSERT(_allocated_fifo_words_tx + fifo_size + dwc2->grxfsiz <= _dwc2_controller[rhport].ep_fifo_size / 4);
+    // FIFO is already allocated if planned by dcd_edpt_config_plan()
+    if (!(_fifo_planned && _fifo_plan_tx[epnum])) {
+      // Check if free space is available
+      TU_ASSERT(_allocated_fifo_words_tx + fifo_size + dwc2->grxfsiz <= dfifo_top(rhport));
 
-    _allocated_fifo_words_tx += fifo_size;
+      _allocated_fifo_words_tx += fifo_size;
 
-    TU_LOG(DWC2_DEBUG, "    Allocated %u bytes at offset %lu", fifo_size * 4,
-           _dwc2_controller[rhport].ep_fifo_size - _allocated_fifo_words_tx * 4);
+      TU_LOG(DWC2_DEBUG, "    Allocated %u bytes at offset %u", fifo_size * 4,
+             (dfifo_top(rhport) - _allocated_fifo_words_tx) * 4);
 
-    // DIEPTXF starts at FIFO #1.
-    // Both TXFD and TXSA are in unit of 32-bit words.
-    dwc2->dieptxf[epnum - 1] = (fifo_size << DIEPTXF_INEPTXFD_Pos) |
-                               (_dwc2_controller[rhport].ep_fifo_size / 4 - _allocated_fifo_words_tx);
+      // DIEPTXF starts at FIFO #1.
+      // Both TXFD and TXSA are in unit of 32-bit words.
+      dwc2->dieptxf[epnum - 1] = (fifo_size << DIEPTXF_INEPTXFD_Pos) |
+                                 (dfifo_top(rhport) - _allocated_fifo_words_tx);
+    }
 
     dwc2->epin[epnum].diepctl |= (1 << DIEPCTL_USBAEP_Pos) |
                                  (epnum << DIEPCTL_TXFNUM_Pos) |
@@ -648,9 +896,11 @@ void dcd_edpt_close_all(uint8_t rhport) {
 
   // reset allocated fifo IN
   _allocated_fifo_words_tx = 16;
+  tu_memclr(_fifo_plan_tx, sizeof(_fifo_plan_tx));
+  _fifo_planned = false;
 }
 
-bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
@@ -662,6 +912,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
   // EP0 can only handle one packet
   if (epnum == 0) {
     ep0_pending[dir] = total_bytes;
+    if (dir == TUSB_DIR_OUT) _ep0_out_xfer = true;
 
     // Schedule the first transaction for EP0 transfer
     edpt_schedule_packets(rhport, epnum, dir, 1, ep0_pending[dir]);
@@ -691,8 +942,27 @@ bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   xfer_ctl_t* xfer = XFER_CTL_BASE(epnum, dir);
-  xfer->buffer = NULL;
+  uint8_t* buffer = NULL;
+
+  if (dma_enabled(DWC2_REG(rhport))) {
+    // DMA only transfers up to linear part of the fifo, its pointer is advanced on completion
+    tu_fifo_buffer_info_t fifo_info;
+    if (dir == TUSB_DIR_IN) {
+      tu_fifo_get_read_info(ff, &fifo_info);
+    } else {
+      tu_fifo_get_write_info(ff, &fifo_info);
+    }
+
+    // DMA needs word-aligned address: decline without touching endpoint state, usbd then moves the span
+    // through bounce buffer of CFG_TUD_EDPT_XFER_FIFO_FALLBACK if enabled
+    TU_VERIFY(((uintptr_t) fifo_info.ptr_lin & 3) == 0);
+    buffer = (uint8_t*) fifo_info.ptr_lin;
+    total_bytes = tu_min16(total_bytes, fifo_info.len_lin);
+  }
+
+  xfer->buffer = buffer;
   xfer->ff = ff;
+
   xfer->total_len = total_bytes;
 
   uint16_t num_packets = (total_bytes / xfer->max_size);
@@ -776,12 +1046,15 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   // Update max_size
   xfer_status[epnum][dir].max_size = 0;  // max_size = 0 marks a disabled EP - required for changing FIFO allocation
 
+  // planned FIFO layout is fixed for the whole configuration
+  if (_fifo_planned) return;
+
   if (dir == TUSB_DIR_IN) {
     uint16_t const fifo_size = (dwc2->dieptxf[epnum - 1] & DIEPTXF_INEPTXFD_Msk) >> DIEPTXF_INEPTXFD_Pos;
     uint16_t const fifo_start = (dwc2->dieptxf[epnum - 1] & DIEPTXF_INEPTXSA_Msk) >> DIEPTXF_INEPTXSA_Pos;
 
     // For now only the last opened endpoint can be closed without fuss.
-    TU_ASSERT(fifo_start == _dwc2_controller[rhport].ep_fifo_size / 4 - _allocated_fifo_words_tx,);
+    TU_ASSERT(fifo_start == dfifo_top(rhport) - _allocated_fifo_words_tx,);
     _allocated_fifo_words_tx -= fifo_size;
   } else {
     _out_ep_closed = true;     // Set flag such that RX FIFO gets reduced in size once RX FIFO is empty
@@ -813,7 +1086,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
 /*------------------------------------------------------------------*/
 
 // Read a single data packet from receive FIFO
-static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
+TU_ATTR_FAST_FUNC static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
@@ -837,7 +1110,7 @@ static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
 }
 
 // Write a single data packet to EPIN FIFO
-static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* src, uint16_t len) {
+TU_ATTR_FAST_FUNC static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* src, uint16_t len) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
@@ -861,7 +1134,7 @@ static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* s
   }
 }
 
-static void handle_rxflvl_irq(uint8_t rhport) {
+TU_ATTR_FAST_FUNC static void handle_rxflvl_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   volatile uint32_t const* rx_fifo = dwc2->fifo[0];
 
@@ -894,8 +1167,8 @@ static void handle_rxflvl_irq(uint8_t rhport) {
 
       // We can receive up to three setup packets in succession, but
       // only the last one is valid.
-      _setup_packet[0] = (*rx_fifo);
-      _setup_packet[1] = (*rx_fifo);
+      _dwc2_epbuf.setup_packet[0] = (*rx_fifo);
+      _dwc2_epbuf.setup_packet[1] = (*rx_fifo);
       break;
 
     case GRXSTS_PKTSTS_SETUPDONE:
@@ -960,9 +1233,47 @@ static void handle_rxflvl_irq(uint8_t rhport) {
   }
 }
 
-static void handle_epout_irq(uint8_t rhport) {
+// DMA mode: OUT transfer complete, received bytes is derived from remaining transfer size
+TU_ATTR_FAST_FUNC static void handle_epout_dma_xfrc(uint8_t rhport, uint8_t epnum, uint32_t doepint) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2_epout_t* epout = &dwc2->epout[epnum];
+  xfer_ctl_t* xfer = XFER_CTL_BASE(epnum, TUSB_DIR_OUT);
+
+  if (epnum == 0) {
+    // SETUP also completes the transfer on newer cores, skip it and the ones EP0 is only armed for SETUP
+    if ((doepint & (DOEPINT_STUP | DOEPINT_STPKTRX)) || !_ep0_out_xfer) {
+      dma_setup_prepare(rhport);
+      return;
+    }
+  }
+
+  uint16_t const remaining = (uint16_t) ((epout->doeptsiz & DOEPTSIZ_XFRSIZ_Msk) >> DOEPTSIZ_XFRSIZ_Pos);
+  uint16_t const scheduled = (uint16_t) (xfer->total_len - ((epnum == 0) ? ep0_pending[TUSB_DIR_OUT] : 0));
+  uint16_t const received = (scheduled > remaining) ? (uint16_t) (scheduled - remaining) : 0;
+
+  if (epnum == 0) {
+    // EP0 can only handle one packet, schedule next one unless it is a short packet
+    if (ep0_pending[TUSB_DIR_OUT] && remaining == 0) {
+      edpt_schedule_packets(rhport, epnum, TUSB_DIR_OUT, 1, ep0_pending[TUSB_DIR_OUT]);
+      return;
+    }
+
+    ep0_pending[TUSB_DIR_OUT] = 0;
+    _ep0_out_xfer = false;
+    dma_setup_prepare(rhport);
+  }
+
+  xfer->total_len = received;
+  if (xfer->buffer) dcache_invalidate(xfer->buffer, received);
+  if (xfer->ff) tu_fifo_advance_write_pointer(xfer->ff, received);
+
+  dcd_event_xfer_complete(rhport, epnum, received, XFER_RESULT_SUCCESS, true);
+}
+
+TU_ATTR_FAST_FUNC static void handle_epout_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
+  bool const is_dma = dma_enabled(dwc2);
 
   // DAINT for a given EP clears when DOEPINTx is cleared.
   // OEPINT will be cleared when DAINT's out bits are cleared.
@@ -974,6 +1285,7 @@ static void handle_epout_irq(uint8_t rhport) {
 
       // SETUP packet Setup Phase done.
       if (doepint & DOEPINT_STUP) {
+        TU_PROF_BEGIN(TU_PROF_SETUP);
         uint32_t clear_flag = DOEPINT_STUP;
 
         // STPKTRX is only available for version from 3_00a
@@ -982,28 +1294,40 @@ static void handle_epout_irq(uint8_t rhport) {
         }
 
         epout->doepint = clear_flag;
-        dcd_event_setup_received(rhport, (uint8_t*) _setup_packet, true);
+
+        if (is_dma) {
+          // new SETUP cancels previous control transfer
+          _ep0_out_xfer = false;
+          dcache_invalidate(_dwc2_epbuf.setup_packet, 8);
+        }
+
+        dcd_event_setup_received(rhport, (uint8_t*) _dwc2_epbuf.setup_packet, true);
+        TU_PROF_END(rhport, TU_PROF_SETUP);
       }
 
       // OUT XFER complete
       if (epout->doepint & DOEPINT_XFRC) {
+        TU_PROF_BEGIN(TU_PROF_XFER);
         epout->doepint = DOEPINT_XFRC;
 
         xfer_ctl_t* xfer = XFER_CTL_BASE(n, TUSB_DIR_OUT);
 
-        // EP0 can only handle one packet
-        if ((n == 0) && ep0_pending[TUSB_DIR_OUT]) {
+        if (is_dma) {
+          handle_epout_dma_xfrc(rhport, n, doepint);
+        } else if ((n == 0) && ep0_pending[TUSB_DIR_OUT]) {
+          // EP0 can only handle one packet
           // Schedule another packet to be received.
           edpt_schedule_packets(rhport, n, TUSB_DIR_OUT, 1, ep0_pending[TUSB_DIR_OUT]);
         } else {
           dcd_event_xfer_complete(rhport, n, xfer->total_len, XFER_RESULT_SUCCESS, true);
         }
+        TU_PROF_END(rhport, TU_PROF_XFER);
       }
     }
   }
 }
 
-static void handle_epin_irq(uint8_t rhport) {
+TU_ATTR_FAST_FUNC static void handle_epin_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
   dwc2_epin_t* epin = dwc2->epin;
@@ -1016,6 +1340,7 @@ static void handle_epin_irq(uint8_t rhport) {
       xfer_ctl_t* xfer = XFER_CTL_BASE(n, TUSB_DIR_IN);
 
       if (epin[n].diepint & DIEPINT_XFRC) {
+        TU_PROF_BEGIN(TU_PROF_XFER);
         epin[n].diepint = DIEPINT_XFRC;
 
         // EP0 can only handle one packet
@@ -1023,12 +1348,21 @@ static void handle_epin_irq(uint8_t rhport) {
           // Schedule another packet to be transmitted.
           edpt_schedule_packets(rhport, n, TUSB_DIR_IN, 1, ep0_pending[TUSB_DIR_IN]);
         } else {
+          if (dma_enabled(dwc2)) {
+            if (xfer->ff) tu_fifo_advance_read_pointer(xfer->ff, xfer->total_len);
+
+            // re-arm EP0 OUT for next SETUP, which also receives status stage ZLP
+            if (n == 0) dma_setup_prepare(rhport);
+          }
+
           dcd_event_xfer_complete(rhport, n | TUSB_DIR_IN_MASK, xfer->total_len, XFER_RESULT_SUCCESS, true);
         }
+        TU_PROF_END(rhport, TU_PROF_XFER);
       }
 
       // XFER FIFO empty
       if ((epin[n].diepint & DIEPINT_TXFE) && (dwc2->diepempmsk & (1 << n))) {
+        TU_PROF_BEGIN(TU_PROF_FIFO);
         // diepint's TXFE bit is read-only, software cannot clear it.
         // It will only be cleared by hardware when written bytes is more than
         // - 64 bytes or
@@ -1063,21 +1397,24 @@ static void handle_epin_irq(uint8_t rhport) {
         if (((epin[n].dieptsiz & DIEPTSIZ_XFRSIZ_Msk) >> DIEPTSIZ_XFRSIZ_Pos) == 0) {
           dwc2->diepempmsk &= ~(1 << n);
         }
+        TU_PROF_END(rhport, TU_PROF_FIFO);
       }
     }
   }
 }
 
-void dcd_int_handler(uint8_t rhport) {
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
 
   uint32_t const int_mask = dwc2->gintmsk;
   uint32_t const int_status = dwc2->gintsts & int_mask;
 
   if (int_status & GINTSTS_USBRST) {
+    TU_PROF_BEGIN(TU_PROF_BUS);
     // USBRST is start of reset.
     dwc2->gintsts = GINTSTS_USBRST;
     bus_reset(rhport);
+    TU_PROF_END(rhport, TU_PROF_BUS);
   }
 
   if (int_status & GINTSTS_ENUMDNE) {
@@ -1116,6 +1453,18 @@ void dcd_int_handler(uint8_t rhport) {
     dcd_event_bus_signal(rhport, DCD_EVENT_RESUME, true);
   }
 
+#if CFG_TUD_LPM
+  // LPM token ACKed and link entered L1, exit is reported by WKUINT
+  if (int_status & GINTSTS_LPMINT) {
+    dwc2->gintsts = GINTSTS_LPMINT;
+    uint32_t const glpmcfg = dwc2->glpmcfg;
+    if (glpmcfg & GLPMCFG_SLPSTS) {
+      dcd_event_lpm_sleep(rhport, (uint8_t) ((glpmcfg & GLPMCFG_BESL) >> GLPMCFG_BESL_Pos),
+                          (glpmcfg & GLPMCFG_REMWAKE) != 0, true);
+    }
+  }
+#endif
+
   // TODO check GINTSTS_DISCINT for disconnect detection
   // if(int_status & GINTSTS_DISCINT)
 
@@ -1131,6 +1480,7 @@ void dcd_int_handler(uint8_t rhport) {
   }
 
   if(int_status & GINTSTS_SOF) {
+    TU_PROF_BEGIN(TU_PROF_SOF);
     dwc2->gintsts = GINTSTS_SOF;
 
     if (_sof_en) {
@@ -1142,10 +1492,12 @@ void dcd_int_handler(uint8_t rhport) {
     }
 
     dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+    TU_PROF_END(rhport, TU_PROF_SOF);
   }
 
   // RxFIFO non-empty interrupt handling.
   if (int_status & GINTSTS_RXFLVL) {
+    TU_PROF_BEGIN(TU_PROF_FIFO);
     // RXFLVL bit is read-only
 
     // Mask out RXFLVL while reading data from FIFO
@@ -1165,6 +1517,7 @@ void dcd_int_handler(uint8_t rhport) {
     }
 
     dwc2->gintmsk |= GINTMSK_RXFLVLM;
+    TU_PROF_END(rhport, TU_PROF_FIFO);
   }
 
   // OUT endpoint interrupt handling.
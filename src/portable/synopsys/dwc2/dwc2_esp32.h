@@ -44,9 +44,22 @@ static const dwc2_controller_t _dwc2_controller[] =
   { .reg_base = DWC2_REG_BASE, .irqnum = 0, .ep_count = DWC2_EP_MAX, .ep_fifo_size = 1024 }
 };
 
+// Allocate USB interrupt with ESP_INTR_FLAG_IRAM so that it is still serviced while flash is being
+// written. Interrupt path of the stack is placed in IRAM with TU_ATTR_FAST_FUNC, callbacks invoked in
+// ISR context (e.g SOF, xfer_isr) must be IRAM-safe as well.
+#ifndef CFG_TUD_ESP32_ISR_IRAM
+  #define CFG_TUD_ESP32_ISR_IRAM  0
+#endif
+
+#if CFG_TUD_ESP32_ISR_IRAM
+  #define DWC2_INTR_FLAGS  (ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM)
+#else
+  #define DWC2_INTR_FLAGS  ESP_INTR_FLAG_LOWMED
+#endif
+
 static intr_handle_t usb_ih;
 
-static void dcd_int_handler_wrap(void* arg)
+TU_ATTR_FAST_FUNC static void dcd_int_handler_wrap(void* arg)
 {
   (void) arg;
   dcd_int_handler(0);
@@ -56,7 +69,7 @@ TU_ATTR_ALWAYS_INLINE
 static inline void dwc2_dcd_int_enable (uint8_t rhport)
 {
   (void) rhport;
-  esp_intr_alloc(ETS_USB_INTR_SOURCE, ESP_INTR_FLAG_LOWMED, dcd_int_handler_wrap, NULL, &usb_ih);
+  esp_intr_alloc(ETS_USB_INTR_SOURCE, DWC2_INTR_FLAGS, dcd_int_handler_wrap, NULL, &usb_ih);
 }
 
 TU_ATTR_ALWAYS_INLINE
@@ -0,0 +1,1127 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+// ESP32-S2/S3 port allocates its irq on enable and dispatches it to the device stack only, not supported yet
+#if CFG_TUH_ENABLED && defined(TUP_USBIP_DWC2) && !CFG_TUH_MAX3421 && !TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)
+
+#include "host/hcd.h"
+#include "dwc2_type.h"
+
+// Following symbols must be defined by port header
+// - _dwc2_controller[]: array of controllers
+// - dwc2_phy_init/dwc2_phy_update: phy init called before and after core reset
+// - dwc2_dcd_int_enable/dwc2_dcd_int_disable: controller irq, shared by host and device mode
+
+#if defined(TUP_USBIP_DWC2_STM32)
+  #include "dwc2_stm32.h"
+#elif TU_CHECK_MCU(OPT_MCU_GD32VF103)
+  #include "dwc2_gd32.h"
+#elif TU_CHECK_MCU(OPT_MCU_BCM2711, OPT_MCU_BCM2835, OPT_MCU_BCM2837)
+  #include "dwc2_bcm.h"
+#elif TU_CHECK_MCU(OPT_MCU_EFM32GG)
+  #include "dwc2_efm32.h"
+#elif TU_CHECK_MCU(OPT_MCU_XMC4000)
+  #include "dwc2_xmc.h"
+#else
+  #error "Unsupported MCUs"
+#endif
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+// DWC2 registers
+#define DWC2_REG(_port)       ((dwc2_regs_t*) _dwc2_controller[_port].reg_base)
+
+// Debug level for DWC2
+#define DWC2_DEBUG    2
+
+// Use internal (buffer) DMA of HS cores: packets are moved between memory and FIFO by the core and a channel
+// only interrupts once it is halted. Transfer buffers must be word aligned and DMA accessible, IN buffers must
+// also have room for a whole max packet size since the core writes complete packets.
+#ifndef CFG_TUH_DWC2_DMA
+  #define CFG_TUH_DWC2_DMA   0
+#endif
+
+// Number of endpoints (both directions, each device's EP0 takes two) that can be opened at the same time
+#ifndef CFG_TUH_DWC2_ENDPOINT_MAX
+  #define CFG_TUH_DWC2_ENDPOINT_MAX   16
+#endif
+
+#define DWC2_CHANNEL_COUNT_MAX   16
+
+// Frame number in hfnum wraps at 14 bits
+#define HFNUM_FRNUM_MAX          0x3FFFu
+
+// Consecutive transaction errors before a transfer is failed, same as EHCI's CERR
+#define XFER_ERROR_MAX           3
+
+// Consecutive NYETs of a periodic complete split before the start split is re-issued next interval
+#define XFER_NYET_MAX            3
+
+// HPRT bits that are cleared (or port disabled for PENA) by writing 1, must be masked out when modifying others
+#define HPRT_W1C_MASK            (HPRT_PCDET | HPRT_PENA | HPRT_PENCHNG | HPRT_POCCHNG)
+
+// HCTSIZ data PID
+enum {
+  HCTSIZ_PID_DATA0 = 0,
+  HCTSIZ_PID_DATA2 = 1,
+  HCTSIZ_PID_DATA1 = 2,
+  HCTSIZ_PID_SETUP = 3,
+};
+
+enum {
+  EDPT_STATE_IDLE = 0,  // opened, no transfer
+  EDPT_STATE_PENDING,   // transfer queued, waiting for a free channel or its (micro)frame
+  EDPT_STATE_ACTIVE,    // transfer is running on a channel
+};
+
+// Cache maintenance of DMA buffer, default to hcd_dcache_*() which can be implemented by application
+#ifndef dcache_clean
+#define dcache_clean(_addr, _size)             hcd_dcache_clean(_addr, _size)
+#endif
+
+#ifndef dcache_invalidate
+#define dcache_invalidate(_addr, _size)        hcd_dcache_invalidate(_addr, _size)
+#endif
+
+typedef struct {
+  uint32_t hcchar;        // channel characteristics without CHENA/CHDIS/ODDFRM
+  uint32_t hcsplt;        // split control, 0 if device is not a FS/LS device behind a HS hub
+  uint8_t* buffer;
+  uint16_t buflen;
+  uint16_t xferred;       // bytes transferred so far, survives channel re-programming
+  uint16_t interval;      // periodic service interval in hfnum unit: frame (FS root port) or microframe (HS)
+  uint16_t frame_next;    // hfnum (micro)frame in which next periodic transaction is due
+  uint8_t daddr;
+  uint8_t ep_addr;
+  uint8_t next_pid;       // HCTSIZ_PID_*
+  uint8_t err_count;
+  volatile uint8_t state; // EDPT_STATE_*
+  bool allocated;
+  bool do_ping;           // HS OUT: probe with PING after NAK/NYET
+} hcd_endpoint_t;
+
+typedef struct {
+  uint32_t hcint;         // slave: events accumulated until channel is halted
+  uint16_t xfer_len;      // bytes programmed in this round
+  uint16_t pkt_count;     // packets programmed in this round
+  uint16_t fifo_bytes;    // slave: OUT bytes written to tx fifo, IN bytes read from rx fifo
+  uint8_t ep_id;
+  uint8_t nyet_count;
+  bool allocated;
+  bool do_csplit;         // split: start split is acknowledged, next transaction is complete split
+  bool aborting;          // halted by abort/close, release without event
+} hcd_channel_t;
+
+typedef struct {
+  hcd_endpoint_t edpt[CFG_TUH_DWC2_ENDPOINT_MAX];
+  hcd_channel_t channel[DWC2_CHANNEL_COUNT_MAX];
+} hcd_data_t;
+
+static hcd_data_t _hcd_data;
+
+TU_ATTR_WEAK bool hcd_dcache_clean(void const* addr, uint32_t data_size) { (void) addr; (void) data_size; return true; }
+TU_ATTR_WEAK bool hcd_dcache_invalidate(void const* addr, uint32_t data_size) { (void) addr; (void) data_size; return true; }
+
+TU_ATTR_ALWAYS_INLINE static inline bool dma_host_enabled(dwc2_regs_t const* dwc2) {
+  // architecture 2 = internal DMA
+  return CFG_TUH_DWC2_DMA && (dwc2->ghwcfg2_bm.arch == 2);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t channel_count(dwc2_regs_t const* dwc2) {
+  return (uint8_t) tu_min32(dwc2->ghwcfg2_bm.num_host_ch + 1u, DWC2_CHANNEL_COUNT_MAX);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t edpt_packet_size(hcd_endpoint_t const* ep) {
+  return (uint16_t) ((ep->hcchar & HCCHAR_MPSIZ_Msk) >> HCCHAR_MPSIZ_Pos);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t edpt_xfer_type(hcd_endpoint_t const* ep) {
+  return (uint8_t) ((ep->hcchar & HCCHAR_EPTYP_Msk) >> HCCHAR_EPTYP_Pos);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool edpt_is_periodic(hcd_endpoint_t const* ep) {
+  uint8_t const xfer_type = edpt_xfer_type(ep);
+  return xfer_type == TUSB_XFER_INTERRUPT || xfer_type == TUSB_XFER_ISOCHRONOUS;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool edpt_is_in(hcd_endpoint_t const* ep) {
+  return (ep->hcchar & HCCHAR_EPDIR) != 0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t frame_current(dwc2_regs_t const* dwc2) {
+  return (uint16_t) (dwc2->hfnum & HFNUM_FRNUM_MAX);
+}
+
+// true if frame is now or already passed, taking wrap-around into account
+TU_ATTR_ALWAYS_INLINE static inline bool frame_is_due(uint16_t frame, uint16_t now) {
+  uint16_t const diff = (uint16_t) ((frame - now) & HFNUM_FRNUM_MAX);
+  return diff == 0 || diff > (HFNUM_FRNUM_MAX >> 1);
+}
+
+static uint8_t edpt_find(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_DWC2_ENDPOINT_MAX; i++) {
+    hcd_endpoint_t const* ep = &_hcd_data.edpt[i];
+    if (ep->allocated && ep->daddr == daddr && ep->ep_addr == ep_addr) return i;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static uint8_t edpt_alloc(void) {
+  for (uint8_t i = 0; i < CFG_TUH_DWC2_ENDPOINT_MAX; i++) {
+    if (!_hcd_data.edpt[i].allocated) return i;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static uint8_t channel_alloc(dwc2_regs_t const* dwc2) {
+  uint8_t const ch_count = channel_count(dwc2);
+  for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+    hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+    if (!ch->allocated) {
+      tu_memclr(ch, sizeof(hcd_channel_t));
+      ch->allocated = true;
+      return ch_id;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static void channel_release(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  dwc2->channel[ch_id].hcintmsk = 0;
+  dwc2->haintmsk &= ~TU_BIT(ch_id);
+  _hcd_data.channel[ch_id].allocated = false;
+}
+
+// Disable channel, core will flush its queued requests and raise CHH when done
+static void channel_halt(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+  channel->hcintmsk |= HCINT_CHH;
+  channel->hcchar |= HCCHAR_CHENA | HCCHAR_CHDIS;
+}
+
+//--------------------------------------------------------------------
+// Slave mode FIFO access
+//--------------------------------------------------------------------
+
+// Read a packet from rx fifo, bytes that do not fit in buffer are discarded
+static void read_fifo_packet(dwc2_regs_t* dwc2, uint8_t* dst, uint16_t len, uint16_t room) {
+  volatile const uint32_t* rx_fifo = dwc2->fifo[0];
+  uint16_t const word_count = (uint16_t) ((len + 3) >> 2);
+
+  for (uint16_t i = 0; i < word_count; i++) {
+    uint32_t const tmp = *rx_fifo;
+    for (uint8_t b = 0; b < 4 && room; b++, room--) {
+      *dst++ = (uint8_t) (tmp >> (8 * b));
+    }
+  }
+}
+
+// Write a packet to the tx fifo of a channel
+static void write_fifo_packet(dwc2_regs_t* dwc2, uint8_t ch_id, uint8_t const* src, uint16_t len) {
+  volatile uint32_t* tx_fifo = dwc2->fifo[ch_id];
+
+  uint16_t full_words = len >> 2;
+  while (full_words--) {
+    *tx_fifo = tu_unaligned_read32(src);
+    src += 4;
+  }
+
+  uint8_t const bytes_rem = len & 0x03;
+  if (bytes_rem) {
+    uint32_t tmp_word = src[0];
+    if (bytes_rem > 1) tmp_word |= (src[1] << 8);
+    if (bytes_rem > 2) tmp_word |= (src[2] << 16);
+    *tx_fifo = tmp_word;
+  }
+}
+
+// Push as many OUT packets of a channel as fifo and request queue allow. Return true if all are pushed
+static bool channel_fifo_push(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t const* ep = &_hcd_data.edpt[ch->ep_id];
+  uint16_t const mps = edpt_packet_size(ep);
+  bool const periodic = edpt_is_periodic(ep);
+
+  while (ch->fifo_bytes < ch->xfer_len) {
+    uint16_t const len = tu_min16(mps, ch->xfer_len - ch->fifo_bytes);
+    uint32_t const txsts = periodic ? dwc2->hptxsts : dwc2->gnptxsts;
+    uint16_t const space_words = (uint16_t) (txsts & GNPTXSTS_NPTXFSAV_Msk);
+    uint8_t const queue_space = (uint8_t) ((txsts & GNPTXSTS_NPTQXSAV_Msk) >> GNPTXSTS_NPTQXSAV_Pos);
+
+    if (space_words < ((len + 3) >> 2) || queue_space == 0) return false;
+
+    write_fifo_packet(dwc2, ch_id, ep->buffer + ep->xferred + ch->fifo_bytes, len);
+    ch->fifo_bytes += len;
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------
+// Channel scheduling
+//--------------------------------------------------------------------
+
+// Program channel with the next round of the endpoint's transfer and enable it.
+// Non-split non-periodic transfers are programmed as a whole (up to packet count limit), split and periodic
+// transfers are programmed one packet at a time: one packet per (micro)frame or per split transaction.
+static void channel_xfer_start(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ch->ep_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  bool const is_in = edpt_is_in(ep);
+  bool const is_dma = dma_host_enabled(dwc2);
+  uint16_t const mps = edpt_packet_size(ep);
+  uint16_t const remaining = ep->buflen - ep->xferred;
+
+  uint16_t pkt_count;
+  if (ep->hcsplt || edpt_is_periodic(ep) || remaining == 0) {
+    pkt_count = 1;
+  } else {
+    pkt_count = tu_min16(tu_div_ceil(remaining, mps), HCTSIZ_PKTCNT_Msk >> HCTSIZ_PKTCNT_Pos);
+  }
+  ch->pkt_count = pkt_count;
+  ch->xfer_len = (uint16_t) tu_min32(remaining, (uint32_t) pkt_count * mps);
+  ch->fifo_bytes = 0;
+  ch->hcint = 0;
+
+  // IN transfer size must be multiple of packet size
+  uint32_t const xfrsiz = is_in ? (uint32_t) pkt_count * mps : ch->xfer_len;
+  uint32_t hctsiz = ((uint32_t) ep->next_pid << HCTSIZ_DPID_Pos) | ((uint32_t) pkt_count << HCTSIZ_PKTCNT_Pos) |
+                    (xfrsiz << HCTSIZ_XFRSIZ_Pos);
+  if (ep->do_ping && !is_in && !ep->hcsplt) hctsiz |= HCTSIZ_DOPING;
+  ep->do_ping = false;
+
+  channel->hcsplt = ep->hcsplt ? (ep->hcsplt | (ch->do_csplit ? HCSPLT_COMPLSPLT : 0)) : 0;
+  channel->hctsiz = hctsiz;
+  channel->hcint = 0xFFFFFFFFu; // clear all pending
+
+  uint8_t* buf = ep->buffer + ep->xferred;
+  if (is_dma) {
+    // core halts channel on every terminal condition, all events are decoded from hcint at CHH
+    channel->hcdma = (uint32_t) (uintptr_t) buf;
+    if (ch->xfer_len) {
+      if (is_in) {
+        dcache_invalidate(buf, xfrsiz);
+      } else {
+        dcache_clean(buf, ch->xfer_len);
+      }
+    }
+    channel->hcintmsk = HCINT_CHH | HCINT_AHBERR;
+  } else {
+    uint32_t hcintmsk = HCINT_XFRC | HCINT_CHH | HCINT_STALL | HCINT_NAK | HCINT_TXERR | HCINT_BBERR |
+                        HCINT_DTERR | HCINT_FRMOR;
+    if (ep->hcsplt || !is_in) hcintmsk |= HCINT_ACK | HCINT_NYET;
+    channel->hcintmsk = hcintmsk;
+  }
+  dwc2->haintmsk |= TU_BIT(ch_id);
+
+  uint32_t hcchar = ep->hcchar | HCCHAR_CHENA;
+  if (edpt_is_periodic(ep) && !(frame_current(dwc2) & 1u)) {
+    hcchar |= HCCHAR_ODDFRM; // transaction is scheduled in next frame, which is odd
+  }
+  channel->hcchar = hcchar;
+  ep->state = EDPT_STATE_ACTIVE;
+
+  if (!is_dma && !is_in && !channel_fifo_push(dwc2, ch_id)) {
+    // wait for tx fifo space
+    dwc2->gintmsk |= edpt_is_periodic(ep) ? GINTMSK_PTXFEM : GINTMSK_NPTXFEM;
+  }
+}
+
+// Queue endpoint's transfer: start it now if possible, otherwise leave it pending for channel or frame
+static void edpt_schedule(dwc2_regs_t* dwc2, uint8_t ep_id) {
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+  ep->state = EDPT_STATE_PENDING;
+
+  if (edpt_is_periodic(ep)) {
+    // started from SOF handler one (micro)frame ahead of its due frame
+    uint16_t const now = frame_current(dwc2);
+    if (frame_is_due(ep->frame_next, now)) ep->frame_next = (uint16_t) ((now + 1u) & HFNUM_FRNUM_MAX);
+    dwc2->gintmsk |= GINTMSK_SOFM;
+    return;
+  }
+
+  uint8_t const ch_id = channel_alloc(dwc2);
+  if (ch_id < DWC2_CHANNEL_COUNT_MAX) {
+    _hcd_data.channel[ch_id].ep_id = ep_id;
+    channel_xfer_start(dwc2, ch_id);
+  }
+}
+
+// Start pending non-periodic transfers on free channels
+static void schedule_pending(dwc2_regs_t* dwc2) {
+  for (uint8_t ep_id = 0; ep_id < CFG_TUH_DWC2_ENDPOINT_MAX; ep_id++) {
+    hcd_endpoint_t const* ep = &_hcd_data.edpt[ep_id];
+    if (ep->allocated && ep->state == EDPT_STATE_PENDING && !edpt_is_periodic(ep)) {
+      uint8_t const ch_id = channel_alloc(dwc2);
+      if (ch_id >= DWC2_CHANNEL_COUNT_MAX) return;
+      _hcd_data.channel[ch_id].ep_id = ep_id;
+      channel_xfer_start(dwc2, ch_id);
+    }
+  }
+}
+
+// Start periodic transfers due in next (micro)frame, disable SOF when nothing is pending
+static void schedule_periodic(dwc2_regs_t* dwc2) {
+  uint16_t const next = (uint16_t) ((frame_current(dwc2) + 1u) & HFNUM_FRNUM_MAX);
+  bool has_pending = false;
+
+  for (uint8_t ep_id = 0; ep_id < CFG_TUH_DWC2_ENDPOINT_MAX; ep_id++) {
+    hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+    if (!(ep->allocated && ep->state == EDPT_STATE_PENDING && edpt_is_periodic(ep))) continue;
+
+    if (frame_is_due(ep->frame_next, next)) {
+      uint8_t const ch_id = channel_alloc(dwc2);
+      if (ch_id < DWC2_CHANNEL_COUNT_MAX) {
+        _hcd_data.channel[ch_id].ep_id = ep_id;
+        channel_xfer_start(dwc2, ch_id);
+        continue;
+      }
+    }
+    has_pending = true;
+  }
+
+  if (!has_pending) dwc2->gintmsk &= ~GINTMSK_SOFM;
+}
+
+// Periodic endpoint missed (NAK, frame overrun or complete split gave up): retry next service interval
+static void edpt_reschedule_periodic(dwc2_regs_t* dwc2, hcd_endpoint_t* ep) {
+  ep->frame_next = (uint16_t) ((frame_current(dwc2) + ep->interval) & HFNUM_FRNUM_MAX);
+  ep->state = EDPT_STATE_PENDING;
+  dwc2->gintmsk |= GINTMSK_SOFM;
+}
+
+// Channel is halted (DMA mode) or all events leading to halt are collected (slave mode): decide what's next
+static void channel_xfer_halted(dwc2_regs_t* dwc2, uint8_t ch_id, uint32_t hcint, bool in_isr) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ch->ep_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  if (ch->aborting) {
+    channel_release(dwc2, ch_id);
+    schedule_pending(dwc2);
+    return;
+  }
+
+  bool const is_in = edpt_is_in(ep);
+  bool const is_split = ep->hcsplt != 0;
+  bool const periodic = edpt_is_periodic(ep);
+  uint16_t const mps = edpt_packet_size(ep);
+  uint32_t const hctsiz = channel->hctsiz;
+
+  // bytes moved in this round
+  uint16_t moved;
+  if (is_in) {
+    if (dma_host_enabled(dwc2)) {
+      uint32_t const xfrsiz_left = (hctsiz & HCTSIZ_XFRSIZ_Msk) >> HCTSIZ_XFRSIZ_Pos;
+      moved = (uint16_t) tu_min32((uint32_t) ch->pkt_count * mps - xfrsiz_left, ch->xfer_len);
+    } else {
+      moved = ch->fifo_bytes;
+    }
+  } else if (hcint & HCINT_XFRC) {
+    moved = ch->xfer_len;
+  } else {
+    uint16_t const pkt_left = (uint16_t) ((hctsiz & HCTSIZ_PKTCNT_Msk) >> HCTSIZ_PKTCNT_Pos);
+    moved = (uint16_t) tu_min32((uint32_t) (ch->pkt_count - pkt_left) * mps, ch->xfer_len);
+  }
+
+  // split data toggle is tracked by us (start split ACK does not advance it), others by the core
+  if (!is_split) ep->next_pid = (uint8_t) ((hctsiz & HCTSIZ_DPID_Msk) >> HCTSIZ_DPID_Pos);
+
+  xfer_result_t result = XFER_RESULT_INVALID; // not complete yet
+  bool retry = false;
+
+  if (hcint & HCINT_STALL) {
+    result = XFER_RESULT_STALLED;
+  } else if (hcint & (HCINT_AHBERR | HCINT_BBERR)) {
+    result = XFER_RESULT_FAILED;
+  } else if (hcint & (HCINT_TXERR | HCINT_DTERR)) {
+    if (is_split) ch->do_csplit = false;
+    if (++ep->err_count >= XFER_ERROR_MAX) {
+      result = XFER_RESULT_FAILED;
+    } else {
+      retry = true;
+    }
+  } else if (hcint & HCINT_XFRC) {
+    ep->err_count = 0;
+    ep->xferred += moved;
+    if (is_split) {
+      ch->do_csplit = false;
+      ch->nyet_count = 0;
+      ep->next_pid = (ep->next_pid == HCTSIZ_PID_DATA0) ? HCTSIZ_PID_DATA1 : HCTSIZ_PID_DATA0;
+    }
+
+    bool const short_packet = is_in && (moved < ch->xfer_len || (moved % mps) != 0);
+    if (ep->xferred >= ep->buflen || short_packet || !(is_split || periodic)) {
+      result = XFER_RESULT_SUCCESS;
+    } else if (periodic) {
+      // next packet in next service interval
+      ep->frame_next = (uint16_t) ((frame_current(dwc2) + ep->interval) & HFNUM_FRNUM_MAX);
+      ep->state = EDPT_STATE_PENDING;
+      dwc2->gintmsk |= GINTMSK_SOFM;
+    } else {
+      retry = true;
+    }
+  } else if (is_split && (hcint & HCINT_ACK) && !ch->do_csplit) {
+    // start split is accepted by hub's TT, follow with complete split
+    ep->err_count = 0;
+    ch->do_csplit = true;
+    retry = true;
+  } else if (hcint & HCINT_NYET) {
+    if (is_split) {
+      // TT has no result yet, repeat complete split
+      if (periodic && ++ch->nyet_count > XFER_NYET_MAX) {
+        ch->do_csplit = false;
+        ch->nyet_count = 0;
+        edpt_reschedule_periodic(dwc2, ep);
+      } else {
+        retry = true;
+      }
+    } else {
+      // HS OUT: packet accepted but device can not take next one yet
+      ep->xferred += moved;
+      ep->do_ping = true;
+      if (ep->xferred >= ep->buflen) {
+        result = XFER_RESULT_SUCCESS;
+      } else {
+        retry = true;
+      }
+    }
+  } else if (hcint & (HCINT_NAK | HCINT_FRMOR)) {
+    if (!is_split) ep->xferred += moved;
+    if (!is_in && !is_split) ep->do_ping = true;
+    ch->do_csplit = false;
+    if (periodic) {
+      edpt_reschedule_periodic(dwc2, ep);
+    } else {
+      retry = true;
+    }
+  } else {
+    // halted without a known reason, start the round again
+    retry = true;
+  }
+
+  if (retry) {
+    channel_xfer_start(dwc2, ch_id);
+    return;
+  }
+
+  channel_release(dwc2, ch_id);
+
+  if (result != XFER_RESULT_INVALID) {
+    ep->state = EDPT_STATE_IDLE;
+    if (is_in && dma_host_enabled(dwc2) && ep->xferred) dcache_invalidate(ep->buffer, ep->xferred);
+    hcd_event_xfer_complete(ep->daddr, ep->ep_addr, ep->xferred, result, in_isr);
+  }
+
+  schedule_pending(dwc2);
+}
+
+//--------------------------------------------------------------------
+// PHY and core init
+//--------------------------------------------------------------------
+
+static void reset_core(dwc2_regs_t* dwc2) {
+  // reset core
+  dwc2->grstctl |= GRSTCTL_CSRST;
+
+  // wait for reset bit is cleared
+  while (dwc2->grstctl & GRSTCTL_CSRST) {}
+
+  // wait for AHB master IDLE
+  while (!(dwc2->grstctl & GRSTCTL_AHBIDL)) {}
+}
+
+static bool phy_hs_supported(dwc2_regs_t* dwc2) {
+  return TUH_OPT_HIGH_SPEED && dwc2->ghwcfg2_bm.hs_phy_type != HS_PHY_TYPE_NONE;
+}
+
+static void phy_fs_init(dwc2_regs_t* dwc2) {
+  TU_LOG(DWC2_DEBUG, "Fullspeed PHY init\r\n");
+
+  dwc2->gusbcfg |= GUSBCFG_PHYSEL;
+  dwc2_phy_init(dwc2, HS_PHY_TYPE_NONE);
+  reset_core(dwc2);
+  dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_TRDT_Msk) | (5u << GUSBCFG_TRDT_Pos);
+  dwc2_phy_update(dwc2, HS_PHY_TYPE_NONE);
+}
+
+static void phy_hs_init(dwc2_regs_t* dwc2) {
+  uint32_t gusbcfg = dwc2->gusbcfg & ~GUSBCFG_PHYSEL;
+
+  if (dwc2->ghwcfg2_bm.hs_phy_type == HS_PHY_TYPE_ULPI) {
+    TU_LOG(DWC2_DEBUG, "Highspeed ULPI PHY init\r\n");
+    gusbcfg |= GUSBCFG_ULPI_UTMI_SEL;
+    gusbcfg &= ~(GUSBCFG_PHYIF16 | GUSBCFG_DDRSEL | GUSBCFG_ULPIFSLS | GUSBCFG_ULPICSM);
+    // host drives VBUS through ULPI PHY
+    gusbcfg |= GUSBCFG_ULPIEVBUSD;
+  } else {
+    TU_LOG(DWC2_DEBUG, "Highspeed UTMI+ PHY init\r\n");
+    gusbcfg &= ~(GUSBCFG_ULPI_UTMI_SEL | GUSBCFG_PHYIF16);
+    if (dwc2->ghwcfg4_bm.utmi_phy_data_width) gusbcfg |= GUSBCFG_PHYIF16;
+  }
+  dwc2->gusbcfg = gusbcfg;
+
+  dwc2_phy_init(dwc2, dwc2->ghwcfg2_bm.hs_phy_type);
+  reset_core(dwc2);
+
+  gusbcfg &= ~GUSBCFG_TRDT_Msk;
+  gusbcfg |= (dwc2->ghwcfg4_bm.utmi_phy_data_width ? 5u : 9u) << GUSBCFG_TRDT_Pos;
+  dwc2->gusbcfg = gusbcfg;
+
+  dwc2_phy_update(dwc2, dwc2->ghwcfg2_bm.hs_phy_type);
+}
+
+static bool check_dwc2(dwc2_regs_t* dwc2) {
+  // For some reasons: GD32VF103 snpsid and all hwcfg register are always zero (skip it)
+  (void) dwc2;
+#if !TU_CHECK_MCU(OPT_MCU_GD32VF103)
+  uint32_t const gsnpsid = dwc2->gsnpsid & GSNPSID_ID_MASK;
+  TU_ASSERT(gsnpsid == DWC2_OTG_ID || gsnpsid == DWC2_FS_IOT_ID || gsnpsid == DWC2_HS_IOT_ID);
+#endif
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Controller API
+//--------------------------------------------------------------------+
+
+static void host_mode_init(uint8_t rhport);
+
+bool hcd_init(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // Check Synopsys ID register, failed if controller clock/power is not enabled
+  TU_ASSERT(check_dwc2(dwc2));
+
+  tu_memclr(&_hcd_data, sizeof(_hcd_data));
+
+  // disable global interrupt
+  dwc2->gahbcfg &= ~GAHBCFG_GINT;
+
+  if (phy_hs_supported(dwc2)) {
+    phy_hs_init(dwc2);
+  } else {
+    phy_fs_init(dwc2);
+  }
+
+  host_mode_init(rhport);
+  return true;
+}
+
+#if CFG_TUSB_OTG
+// Switch from device mode: PHY and core are already initialized by dcd_init(), only host mode is set up
+bool hcd_role_enter(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // host and device are built for different max speed: PHY must be selected again
+  if (phy_hs_supported(dwc2) == ((dwc2->gusbcfg & GUSBCFG_PHYSEL) != 0)) {
+    return hcd_init(rhport);
+  }
+
+  tu_memclr(&_hcd_data, sizeof(_hcd_data));
+  dwc2->gahbcfg &= ~(GAHBCFG_GINT | GAHBCFG_DMAEN);
+
+  // release B-valid override set by device mode
+  dwc2->gotgctl &= ~(GOTGCTL_BVALOEN | GOTGCTL_BVALOVAL);
+
+  host_mode_init(rhport);
+  return true;
+}
+#endif
+
+// Set up host mode after PHY and core are initialized
+static void host_mode_init(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // force host mode and wait for the mode switch to take effect (up to 25 ms)
+  dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_FDMOD) | GUSBCFG_FHMOD;
+  while (!(dwc2->gintsts & GINTSTS_CMOD)) {}
+
+  // FS/LS only with 48 MHz PHY clock, or HS capable with 30/60 MHz PHY clock
+  dwc2->hcfg = (dwc2->gusbcfg & GUSBCFG_PHYSEL) ? (HCFG_FSLSS | HCFG_FSLSPCS_0) : 0;
+
+  // FIFO in words: half for rx, a quarter each for non-periodic and periodic tx
+  uint16_t const fifo_words = (uint16_t) (_dwc2_controller[rhport].ep_fifo_size / 4);
+  uint16_t const rx_words = fifo_words / 2;
+  uint16_t const nptx_words = fifo_words / 4;
+  uint16_t const ptx_words = (uint16_t) (fifo_words - rx_words - nptx_words);
+  dwc2->grxfsiz = rx_words;
+  dwc2->gnptxfsiz = ((uint32_t) nptx_words << 16) | rx_words;
+  dwc2->hptxfsiz = ((uint32_t) ptx_words << 16) | (uint32_t) (rx_words + nptx_words);
+
+  // flush all tx and rx fifo
+  dwc2->grstctl = GRSTCTL_TXFFLSH | (0x10u << GRSTCTL_TXFNUM_Pos);
+  while (dwc2->grstctl & GRSTCTL_TXFFLSH_Msk) {}
+
+  dwc2->grstctl = GRSTCTL_RXFFLSH;
+  while (dwc2->grstctl & GRSTCTL_RXFFLSH_Msk) {}
+
+  // disable and clear all channel interrupts
+  for (uint8_t ch_id = 0; ch_id < DWC2_CHANNEL_COUNT_MAX; ch_id++) {
+    dwc2->channel[ch_id].hcintmsk = 0;
+    dwc2->channel[ch_id].hcint = 0xFFFFFFFFu;
+  }
+  dwc2->haintmsk = 0;
+
+  // clear pending OTG and global interrupts
+  dwc2->gotgint = dwc2->gotgint;
+  dwc2->gintsts = 0xFFFFFFFFu;
+
+  uint32_t gintmsk = GINTMSK_PRTIM | GINTMSK_HCIM | GINTMSK_DISCINT;
+  if (dma_host_enabled(dwc2)) {
+    dwc2->gahbcfg |= GAHBCFG_DMAEN | GAHBCFG_HBSTLEN_2;
+  } else {
+    // tx fifo empty interrupts are triggered when fifos are completely empty
+    dwc2->gahbcfg |= GAHBCFG_TXFELVL | GAHBCFG_PTXFELVL;
+    gintmsk |= GINTMSK_RXFLVLM;
+  }
+  dwc2->gintmsk = gintmsk;
+
+  // enable global interrupt
+  dwc2->gahbcfg |= GAHBCFG_GINT;
+
+  // power the port
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PPWR;
+}
+
+void hcd_int_enable(uint8_t rhport) {
+  dwc2_dcd_int_enable(rhport);
+}
+
+void hcd_int_disable(uint8_t rhport) {
+  dwc2_dcd_int_disable(rhport);
+}
+
+uint32_t hcd_frame_number(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const frnum = frame_current(dwc2);
+  // HS port counts microframe
+  return (hcd_port_speed_get(rhport) == TUSB_SPEED_HIGH) ? (frnum >> 3) : frnum;
+}
+
+//--------------------------------------------------------------------+
+// Port API
+//--------------------------------------------------------------------+
+
+bool hcd_port_connect_status(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  return (dwc2->hprt & HPRT_PCSTS) != 0;
+}
+
+void hcd_port_reset(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PRST;
+}
+
+void hcd_port_reset_end(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = dwc2->hprt & ~(HPRT_W1C_MASK | HPRT_PRST);
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  switch ((dwc2->hprt & HPRT_PSPD_Msk) >> HPRT_PSPD_Pos) {
+    case 0: return TUSB_SPEED_HIGH;
+    case 1: return TUSB_SPEED_FULL;
+    case 2: return TUSB_SPEED_LOW;
+    default: return TUSB_SPEED_INVALID;
+  }
+}
+
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  hcd_int_disable(rhport);
+
+  uint8_t const ch_count = channel_count(dwc2);
+  for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+    hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+    if (ch->allocated && _hcd_data.edpt[ch->ep_id].daddr == dev_addr) {
+      ch->aborting = true;
+      channel_halt(dwc2, ch_id);
+    }
+  }
+
+  for (uint8_t ep_id = 0; ep_id < CFG_TUH_DWC2_ENDPOINT_MAX; ep_id++) {
+    hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+    if (ep->allocated && ep->daddr == dev_addr) {
+      tu_memclr(ep, sizeof(hcd_endpoint_t));
+    }
+  }
+
+  hcd_int_enable(rhport);
+}
+
+//--------------------------------------------------------------------+
+// Endpoints API
+//--------------------------------------------------------------------+
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const* ep_desc) {
+  hcd_devtree_info_t devtree;
+  hcd_devtree_get_info(dev_addr, &devtree);
+
+  bool const rh_high_speed = (hcd_port_speed_get(rhport) == TUSB_SPEED_HIGH);
+  uint8_t const ep_num = tu_edpt_number(ep_desc->bEndpointAddress);
+  uint8_t const xfer_type = ep_desc->bmAttributes.xfer;
+  uint16_t const mps = tu_edpt_packet_size(ep_desc);
+
+  uint32_t hcsplt = 0;
+  if (rh_high_speed && devtree.speed != TUSB_SPEED_HIGH) {
+    // FS/LS device behind a HS hub: all-in-one split transaction through hub's TT
+    hcsplt = HCSPLT_SPLITEN | HCSPLT_XACTPOS | ((uint32_t) devtree.hub_addr << HCSPLT_HUBADDR_Pos) |
+             ((uint32_t) devtree.hub_port << HCSPLT_PRTADDR_Pos);
+  }
+
+  // service interval in hfnum unit
+  uint16_t interval = 0;
+  if (xfer_type == TUSB_XFER_INTERRUPT || xfer_type == TUSB_XFER_ISOCHRONOUS) {
+    uint8_t const binterval = tu_max8(ep_desc->bInterval, 1);
+    uint32_t itv;
+    if (devtree.speed == TUSB_SPEED_HIGH || xfer_type == TUSB_XFER_ISOCHRONOUS) {
+      itv = 1u << (tu_min8(binterval, 16) - 1); // 2^(bInterval-1)
+    } else {
+      itv = binterval; // FS/LS interrupt: in frames
+    }
+    if (rh_high_speed && devtree.speed != TUSB_SPEED_HIGH) itv *= 8; // frames to microframes
+    interval = (uint16_t) tu_min32(itv, (HFNUM_FRNUM_MAX + 1u) >> 2);
+  }
+
+  // EP0 is opened for both directions
+  uint8_t const dir_count = (ep_num == 0) ? 2 : 1;
+  for (uint8_t i = 0; i < dir_count; i++) {
+    uint8_t const ep_addr = (ep_num == 0) ? tu_edpt_addr(0, i) : ep_desc->bEndpointAddress;
+
+    uint8_t ep_id = edpt_find(dev_addr, ep_addr);
+    if (ep_id >= CFG_TUH_DWC2_ENDPOINT_MAX) ep_id = edpt_alloc();
+    TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+
+    hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+    tu_memclr(ep, sizeof(hcd_endpoint_t));
+
+    ep->hcchar = ((uint32_t) mps << HCCHAR_MPSIZ_Pos) | ((uint32_t) ep_num << HCCHAR_EPNUM_Pos) |
+                 (tu_edpt_dir(ep_addr) == TUSB_DIR_IN ? HCCHAR_EPDIR : 0) |
+                 (devtree.speed == TUSB_SPEED_LOW ? HCCHAR_LSDEV : 0) |
+                 ((uint32_t) xfer_type << HCCHAR_EPTYP_Pos) | (1u << HCCHAR_MC_Pos) |
+                 ((uint32_t) dev_addr << HCCHAR_DAD_Pos);
+    ep->hcsplt = hcsplt;
+    ep->interval = interval;
+    ep->daddr = dev_addr;
+    ep->ep_addr = ep_addr;
+    ep->next_pid = HCTSIZ_PID_DATA0;
+    ep->allocated = true;
+  }
+
+  return true;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint16_t buflen) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+  TU_VERIFY(ep->state == EDPT_STATE_IDLE);
+
+  ep->buffer = buffer;
+  ep->buflen = buflen;
+  ep->xferred = 0;
+  ep->err_count = 0;
+
+  // control data and status stage always start with DATA1
+  if (tu_edpt_number(ep_addr) == 0) ep->next_pid = HCTSIZ_PID_DATA1;
+
+  hcd_int_disable(rhport);
+  edpt_schedule(dwc2, ep_id);
+  hcd_int_enable(rhport);
+
+  return true;
+}
+
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_VERIFY(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+
+  hcd_int_disable(rhport);
+
+  bool aborted = false;
+  if (ep->state == EDPT_STATE_ACTIVE) {
+    uint8_t const ch_count = channel_count(dwc2);
+    for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+      hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+      if (ch->allocated && ch->ep_id == ep_id) {
+        ch->aborting = true;
+        channel_halt(dwc2, ch_id);
+      }
+    }
+    aborted = true;
+  } else if (ep->state == EDPT_STATE_PENDING) {
+    aborted = true;
+  }
+  ep->state = EDPT_STATE_IDLE;
+
+  hcd_int_enable(rhport);
+
+  return aborted;
+}
+
+bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet[8]) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, tu_edpt_addr(0, TUSB_DIR_OUT));
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+
+  hcd_endpoint_t* ep = &_hcd_data.edpt[ep_id];
+  TU_VERIFY(ep->state == EDPT_STATE_IDLE);
+
+  ep->buffer = (uint8_t*) (uintptr_t) setup_packet;
+  ep->buflen = 8;
+  ep->xferred = 0;
+  ep->err_count = 0;
+  ep->next_pid = HCTSIZ_PID_SETUP;
+
+  hcd_int_disable(rhport);
+  edpt_schedule(dwc2, ep_id);
+  hcd_int_enable(rhport);
+
+  return true;
+}
+
+bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  _hcd_data.edpt[ep_id].next_pid = HCTSIZ_PID_DATA0;
+
+  return true;
+}
+
+//--------------------------------------------------------------------
+// Interrupt Handler
+//--------------------------------------------------------------------
+
+static void handle_rxflvl_irq(dwc2_regs_t* dwc2) {
+  uint32_t const grxstsp = dwc2->grxstsp;
+  uint8_t const ch_id = (uint8_t) ((grxstsp & GRXSTSP_EPNUM_Msk) >> GRXSTSP_EPNUM_Pos);
+  uint16_t const bcnt = (uint16_t) ((grxstsp & GRXSTSP_BCNT_Msk) >> GRXSTSP_BCNT_Pos);
+  uint8_t const pktsts = (uint8_t) ((grxstsp & GRXSTSP_PKTSTS_Msk) >> GRXSTSP_PKTSTS_Pos);
+
+  if (pktsts != GRXSTS_PKTSTS_HCHIN || bcnt == 0) return;
+
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t const* ep = &_hcd_data.edpt[ch->ep_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  uint16_t const room = (uint16_t) (ch->xfer_len - tu_min16(ch->fifo_bytes, ch->xfer_len));
+  read_fifo_packet(dwc2, ep->buffer + ep->xferred + ch->fifo_bytes, bcnt, tu_min16(bcnt, room));
+  ch->fifo_bytes += tu_min16(bcnt, room);
+
+  // more packets to come: slave mode requires channel to be re-enabled for each IN packet
+  if ((channel->hctsiz & HCTSIZ_PKTCNT_Msk) && bcnt == edpt_packet_size(ep)) {
+    channel->hcchar = (channel->hcchar & ~HCCHAR_CHDIS) | HCCHAR_CHENA;
+  }
+}
+
+// Slave mode: collect events, halt channel on any terminal one and make decision once it is halted
+static void handle_channel_slave(dwc2_regs_t* dwc2, uint8_t ch_id, uint32_t hcint, bool in_isr) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t const* ep = &_hcd_data.edpt[ch->ep_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  uint32_t const events = hcint & channel->hcintmsk;
+  ch->hcint |= hcint;
+
+  if (events & HCINT_CHH) {
+    channel_xfer_halted(dwc2, ch_id, ch->hcint, in_isr);
+    return;
+  }
+
+  // non-split bulk/control IN NAK: just re-issue the token, no need to halt
+  if ((events & HCINT_NAK) && edpt_is_in(ep) && !ep->hcsplt && !edpt_is_periodic(ep) &&
+      !(events & ~(HCINT_NAK | HCINT_ACK))) {
+    ch->hcint &= ~HCINT_NAK;
+    channel->hcchar = (channel->hcchar & ~HCCHAR_CHDIS) | HCCHAR_CHENA;
+    return;
+  }
+
+  // ACK alone is only terminal for start split
+  if (events == HCINT_ACK && !(ep->hcsplt && !ch->do_csplit)) {
+    _hcd_data.edpt[ch->ep_id].err_count = 0;
+    return;
+  }
+
+  if (events) channel_halt(dwc2, ch_id);
+}
+
+static void handle_channel_irq(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  bool const is_dma = dma_host_enabled(dwc2);
+  uint32_t const haint = dwc2->haint;
+
+  uint8_t const ch_count = channel_count(dwc2);
+  for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+    if (!tu_bit_test(haint, ch_id)) continue;
+
+    dwc2_channel_t* channel = &dwc2->channel[ch_id];
+    uint32_t const hcint = channel->hcint;
+    channel->hcint = hcint; // clear
+
+    if (!_hcd_data.channel[ch_id].allocated) {
+      channel->hcintmsk = 0;
+      continue;
+    }
+
+    if (is_dma) {
+      if (hcint & HCINT_CHH) channel_xfer_halted(dwc2, ch_id, hcint, in_isr);
+    } else {
+      handle_channel_slave(dwc2, ch_id, hcint, in_isr);
+    }
+  }
+}
+
+// Slave mode: tx fifo has space, push remaining OUT packets of periodic or non-periodic channels
+static void handle_txfifo_empty(dwc2_regs_t* dwc2, bool periodic) {
+  bool done = true;
+
+  uint8_t const ch_count = channel_count(dwc2);
+  for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+    hcd_channel_t const* ch = &_hcd_data.channel[ch_id];
+    if (!ch->allocated || ch->aborting) continue;
+
+    hcd_endpoint_t const* ep = &_hcd_data.edpt[ch->ep_id];
+    if (edpt_is_in(ep) || edpt_is_periodic(ep) != periodic || ch->fifo_bytes >= ch->xfer_len) continue;
+
+    if (!channel_fifo_push(dwc2, ch_id)) done = false;
+  }
+
+  if (done) dwc2->gintmsk &= ~(periodic ? GINTMSK_PTXFEM : GINTMSK_NPTXFEM);
+}
+
+static void handle_hprt_irq(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const hprt = dwc2->hprt;
+  uint32_t hprt_w = hprt & ~HPRT_W1C_MASK;
+
+  if (hprt & HPRT_PCDET) {
+    hprt_w |= HPRT_PCDET;
+    if (hprt & HPRT_PCSTS) hcd_event_device_attach(rhport, in_isr);
+  }
+
+  if (hprt & HPRT_PENCHNG) {
+    hprt_w |= HPRT_PENCHNG;
+
+    if (hprt & HPRT_PENA) {
+      // port enabled after reset: adjust FS/LS PHY clock and frame interval to detected speed
+      uint32_t const pspd = (hprt & HPRT_PSPD_Msk) >> HPRT_PSPD_Pos;
+      if (pspd != 0) {
+        uint32_t hcfg = dwc2->hcfg & ~HCFG_FSLSPCS_Msk;
+        if (pspd == 2) {
+          hcfg |= HCFG_FSLSPCS_1; // 6 MHz
+          dwc2->hfir = 6000;
+        } else {
+          hcfg |= HCFG_FSLSPCS_0; // 48 MHz
+          dwc2->hfir = 48000;
+        }
+        dwc2->hcfg = hcfg;
+      }
+    }
+  }
+
+  if (hprt & HPRT_POCCHNG) hprt_w |= HPRT_POCCHNG;
+
+  dwc2->hprt = hprt_w;
+}
+
+// Port disconnected: core stops all channels, release them without waiting for a halt
+static void handle_disconnect(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ch_count = channel_count(dwc2);
+  for (uint8_t ch_id = 0; ch_id < ch_count; ch_id++) {
+    if (_hcd_data.channel[ch_id].allocated) {
+      dwc2->channel[ch_id].hcchar |= HCCHAR_CHDIS;
+      channel_release(dwc2, ch_id);
+    }
+  }
+
+  dwc2->gintmsk &= ~(GINTMSK_SOFM | GINTMSK_NPTXFEM | GINTMSK_PTXFEM);
+  hcd_event_device_remove(rhport, in_isr);
+}
+
+void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const int_status = dwc2->gintsts & dwc2->gintmsk;
+
+  if (int_status & GINTSTS_DISCINT) {
+    dwc2->gintsts = GINTSTS_DISCINT;
+    handle_disconnect(rhport, in_isr);
+  }
+
+  if (int_status & GINTSTS_HPRTINT) {
+    // cleared by acknowledging hprt bits
+    handle_hprt_irq(rhport, in_isr);
+  }
+
+  if (int_status & GINTSTS_RXFLVL) {
+    // RXFLVL bit is read-only, mask it while reading to not trigger again
+    dwc2->gintmsk &= ~GINTMSK_RXFLVLM;
+    do {
+      handle_rxflvl_irq(dwc2);
+    } while (dwc2->gintsts & GINTSTS_RXFLVL);
+    dwc2->gintmsk |= GINTMSK_RXFLVLM;
+  }
+
+  if (int_status & GINTSTS_NPTXFE) {
+    handle_txfifo_empty(dwc2, false);
+  }
+
+  if (int_status & GINTSTS_PTXFE) {
+    handle_txfifo_empty(dwc2, true);
+  }
+
+  if (int_status & GINTSTS_HCINT) {
+    // cleared by clearing channel interrupts
+    handle_channel_irq(rhport, in_isr);
+  }
+
+  if (int_status & GINTSTS_SOF) {
+    dwc2->gintsts = GINTSTS_SOF;
+    schedule_periodic(dwc2);
+  }
+}
+
+#endif
@@ -631,7 +631,7 @@ static void handle_setup(void)
 
   usb_setup_ev_pending_write(1);
 }
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   (void)rhport;
   uint8_t next_ev;
@@ -35,18 +35,36 @@
 // Max number of bi-directional endpoints including EP0
 #define EP_MAX 16
 
+// Number of endpoints doing fifo transfer (e.g CDC RX + TX) that can use a bounce buffer, see bounce_get()
+#ifndef CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM
+#define CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM 2
+#endif
+
+#define BOUNCE_BUFSIZE 512
+
 typedef struct {
     uint8_t *buffer;
-    // tu_fifo_t * ff; // TODO support dcd_edpt_xfer_fifo API
+    tu_fifo_t *ff;
     uint16_t total_len;
     uint16_t queued_len;
     uint16_t max_size;
+    uint16_t pkt_len;   // size of packet currently armed (non-control endpoint)
+    uint8_t *bounce;    // packet currently armed is in bounce buffer instead of fifo memory
     bool short_packet;
 } xfer_ctl_t;
 
 #define XFER_CTL_BASE(_ep, _dir) &xfer_status[_ep][_dir]
 static xfer_ctl_t xfer_status[EP_MAX][2];
 
+// DMA needs 4-byte aligned address and room for the whole packet. When the fifo pointer does not meet that (wrap
+// around or after a non-aligned packet), the packet goes through a bounce buffer owned by the endpoint
+typedef struct {
+    TU_ATTR_ALIGNED(4) uint8_t buf[BOUNCE_BUFSIZE];
+    uint8_t ep_addr; // 0 if free
+} bounce_buf_t;
+
+static bounce_buf_t _bounce[CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM];
+
 #define EP_TX_LEN(ep) *(volatile uint16_t *)((volatile uint16_t *)&(USBHSD->UEP0_TX_LEN) + (ep)*2)
 #define EP_TX_CTRL(ep) *(volatile uint8_t *)((volatile uint8_t *)&(USBHSD->UEP0_TX_CTRL) + (ep)*4)
 #define EP_RX_CTRL(ep) *(volatile uint8_t *)((volatile uint8_t *)&(USBHSD->UEP0_RX_CTRL) + (ep)*4)
@@ -121,6 +139,10 @@ void dcd_int_disable(uint8_t rhport) {
 
 void dcd_edpt_close_all(uint8_t rhport) {
     (void)rhport;
+
+    for (uint8_t i = 0; i < CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM; i++) {
+        _bounce[i].ep_addr = 0;
+    }
 }
 
 void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
@@ -161,7 +183,8 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_edpt) {
 
     if (epnum != 0) {
         if (tu_edpt_dir(desc_edpt->bEndpointAddress) == TUSB_DIR_OUT) {
-            EP_RX_CTRL(epnum) = USBHS_EP_R_AUTOTOG | USBHS_EP_R_RES_ACK;
+            // NAK until a transfer is armed with its DMA address
+            EP_RX_CTRL(epnum) = USBHS_EP_R_AUTOTOG | USBHS_EP_R_RES_NAK;
         } else {
             EP_TX_LEN(epnum) = 0;
             EP_TX_CTRL(epnum) = USBHS_EP_T_AUTOTOG | USBHS_EP_T_RES_NAK | USBHS_EP_T_TOG_0;
@@ -220,6 +243,144 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
     }
 }
 
+//--------------------------------------------------------------------+
+// Non-control endpoint transfer
+// Each packet is DMA'ed directly from/to the buffer (or fifo). Next DMA address is advanced from the ISR
+// without going through the stack until the transfer is complete.
+//--------------------------------------------------------------------+
+
+// Get bounce buffer of fifo endpoint, assign a free one on first use
+static uint8_t *bounce_get(uint8_t ep_addr) {
+    bounce_buf_t *free_buf = NULL;
+    for (uint8_t i = 0; i < CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM; i++) {
+        if (_bounce[i].ep_addr == ep_addr) {
+            return _bounce[i].buf;
+        }
+        if (_bounce[i].ep_addr == 0 && free_buf == NULL) {
+            free_buf = &_bounce[i];
+        }
+    }
+
+    TU_ASSERT(free_buf != NULL, NULL); // increase CFG_TUD_CH32_USBHS_FIFO_BOUNCE_NUM
+    free_buf->ep_addr = ep_addr;
+    return free_buf->buf;
+}
+
+static void edpt_in_arm_packet(uint8_t epnum, xfer_ctl_t *xfer) {
+    uint16_t const pkt_len = tu_min16((uint16_t)(xfer->total_len - xfer->queued_len), xfer->max_size);
+    uint8_t *src;
+
+    xfer->bounce = NULL;
+    if (xfer->ff == NULL) {
+        src = xfer->buffer + xfer->queued_len;
+    } else {
+        tu_fifo_buffer_info_t info;
+        tu_fifo_get_read_info(xfer->ff, &info);
+        src = (uint8_t *)info.ptr_lin;
+
+        if ((((uintptr_t)src) & 3) || info.len_lin < pkt_len) {
+            // fifo read pointer is advanced now instead of on completion
+            xfer->bounce = bounce_get(tu_edpt_addr(epnum, TUSB_DIR_IN));
+            TU_ASSERT(xfer->bounce, );
+            src = xfer->bounce;
+            tu_fifo_read_n(xfer->ff, src, pkt_len);
+        }
+    }
+
+    xfer->pkt_len = pkt_len;
+    EP_TX_DMA_ADDR(epnum) = (uint32_t)src;
+    EP_TX_LEN(epnum) = pkt_len;
+    EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
+}
+
+static void edpt_out_arm_packet(uint8_t epnum, xfer_ctl_t *xfer) {
+    uint8_t *dst;
+
+    xfer->bounce = NULL;
+    if (xfer->ff == NULL) {
+        dst = xfer->buffer + xfer->queued_len;
+    } else {
+        tu_fifo_buffer_info_t info;
+        tu_fifo_get_write_info(xfer->ff, &info);
+        dst = (uint8_t *)info.ptr_lin;
+
+        // DMA can write up to max packet size
+        if ((((uintptr_t)dst) & 3) || info.len_lin < xfer->max_size) {
+            xfer->bounce = bounce_get(tu_edpt_addr(epnum, TUSB_DIR_OUT));
+            TU_ASSERT(xfer->bounce, );
+            dst = xfer->bounce;
+        }
+    }
+
+    EP_RX_DMA_ADDR(epnum) = (uint32_t)dst;
+    EP_RX_CTRL(epnum) = (EP_RX_CTRL(epnum) & ~(USBHS_EP_R_RES_MASK)) | USBHS_EP_R_RES_ACK;
+}
+
+static void edpt_in_complete(uint8_t epnum, xfer_ctl_t *xfer) {
+    uint16_t const pkt_len = xfer->pkt_len;
+    if (xfer->ff && !xfer->bounce) {
+        tu_fifo_advance_read_pointer(xfer->ff, pkt_len);
+    }
+    xfer->queued_len += pkt_len;
+
+    if (pkt_len < xfer->max_size || xfer->queued_len >= xfer->total_len) {
+        EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_NAK;
+        dcd_event_xfer_complete(0, tu_edpt_addr(epnum, TUSB_DIR_IN), xfer->queued_len, XFER_RESULT_SUCCESS, true);
+    } else {
+        edpt_in_arm_packet(epnum, xfer);
+    }
+}
+
+static void edpt_out_complete(uint8_t epnum, xfer_ctl_t *xfer) {
+    uint16_t const rx_len = tu_min16(USBHSD->RX_LEN, (uint16_t)(xfer->total_len - xfer->queued_len));
+    if (xfer->ff) {
+        if (xfer->bounce) {
+            tu_fifo_write_n(xfer->ff, xfer->bounce, rx_len);
+        } else {
+            tu_fifo_advance_write_pointer(xfer->ff, rx_len);
+        }
+    }
+    xfer->queued_len += rx_len;
+
+    // short packet (including zlp) or all bytes received
+    if (rx_len < xfer->max_size || xfer->queued_len >= xfer->total_len) {
+        EP_RX_CTRL(epnum) = (EP_RX_CTRL(epnum) & ~(USBHS_EP_R_RES_MASK)) | USBHS_EP_R_RES_NAK;
+        dcd_event_xfer_complete(0, tu_edpt_addr(epnum, TUSB_DIR_OUT), xfer->queued_len, XFER_RESULT_SUCCESS, true);
+    } else {
+        edpt_out_arm_packet(epnum, xfer);
+    }
+}
+
+static void edpt_xfer_start(uint8_t epnum, uint8_t dir, xfer_ctl_t *xfer) {
+    if (dir == TUSB_DIR_IN) {
+        USBHSD->ENDP_CONFIG |= (USBHS_EP0_T_EN << epnum);
+        edpt_in_arm_packet(epnum, xfer);
+    } else {
+        USBHSD->ENDP_CONFIG |= (USBHS_EP0_R_EN << epnum);
+        edpt_out_arm_packet(epnum, xfer);
+    }
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t *ff, uint16_t total_bytes) {
+    (void)rhport;
+    uint8_t const epnum = tu_edpt_number(ep_addr);
+    uint8_t const dir = tu_edpt_dir(ep_addr);
+
+    // USB buffers always work in bytes so to avoid unnecessary divisions we demand item_size = 1
+    TU_ASSERT(ff->item_size == 1 && epnum != 0);
+
+    xfer_ctl_t *xfer = XFER_CTL_BASE(epnum, dir);
+    TU_ASSERT(xfer->max_size <= BOUNCE_BUFSIZE);
+
+    xfer->buffer = NULL;
+    xfer->ff = ff;
+    xfer->total_len = total_bytes;
+    xfer->queued_len = 0;
+
+    edpt_xfer_start(epnum, dir, xfer);
+    return true;
+}
+
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes) {
     (void)rhport;
     uint8_t const epnum = tu_edpt_number(ep_addr);
@@ -227,11 +388,16 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
 
     xfer_ctl_t *xfer = XFER_CTL_BASE(epnum, dir);
     xfer->buffer = buffer;
-    // xfer->ff           = NULL; // TODO support dcd_edpt_xfer_fifo API
+    xfer->ff = NULL;
     xfer->total_len = total_bytes;
     xfer->queued_len = 0;
     xfer->short_packet = false;
 
+    if (epnum != 0) {
+        edpt_xfer_start(epnum, dir, xfer);
+        return true;
+    }
+
     // uint16_t num_packets = (total_bytes / xfer->max_size);
     uint16_t short_packet_size = total_bytes % (xfer->max_size + 1);
 
@@ -240,51 +406,30 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
         xfer->short_packet = true;
     }
 
-    if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
+    if (dir == TUSB_DIR_IN) {
         if (!total_bytes) {
             xfer->short_packet = true;
-            if (epnum == 0) {
-                USBHSD->UEP0_TX_LEN = 0;
-                USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
-                USBHS_Dev_Endp0_Tog ^= 1;
-            } else {
-                EP_TX_LEN(epnum) = 0;
-                EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
-            }
+            USBHSD->UEP0_TX_LEN = 0;
+            USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
+            USBHS_Dev_Endp0_Tog ^= 1;
         } else {
-            if (epnum == 0) {
-                xfer->queued_len += short_packet_size;
-                memcpy(&EP0_DatabufHD[0], buffer, short_packet_size);
-
-                USBHSD->UEP0_TX_LEN = short_packet_size;
-                USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
-                USBHS_Dev_Endp0_Tog ^= 1;
-            } else {
-                xfer->queued_len += short_packet_size;
+            xfer->queued_len += short_packet_size;
+            memcpy(&EP0_DatabufHD[0], buffer, short_packet_size);
 
-                EP_TX_DMA_ADDR(epnum) = (uint32_t)buffer;
-                USBHSD->ENDP_CONFIG |= (USBHS_EP0_T_EN << epnum);
-                EP_TX_LEN(epnum) = short_packet_size;
-                EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
-            }
+            USBHSD->UEP0_TX_LEN = short_packet_size;
+            USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
+            USBHS_Dev_Endp0_Tog ^= 1;
         }
     } else { /* TUSB_DIR_OUT */
-        if (epnum == 0) {
-            uint32_t read_count = USBHSD->RX_LEN;
-            read_count = TU_MIN(read_count, total_bytes);
+        uint32_t read_count = USBHSD->RX_LEN;
+        read_count = TU_MIN(read_count, total_bytes);
 
-            if ((total_bytes == 8)) {
-                read_count = 8;
-                memcpy(buffer, &EP0_DatabufHD[0], 8);
-            } else {
-                memcpy(buffer, &EP0_DatabufHD[0], read_count);
-            }
+        if ((total_bytes == 8)) {
+            read_count = 8;
+            memcpy(buffer, &EP0_DatabufHD[0], 8);
         } else {
-            EP_RX_DMA_ADDR(epnum) = (uint32_t)xfer->buffer;
-            USBHSD->ENDP_CONFIG |= (USBHS_EP0_R_EN << epnum);
+            memcpy(buffer, &EP0_DatabufHD[0], read_count);
         }
-
-        // usbd_ep_read(ep_addr, buffer, total_bytes, &ret_bytes);
     }
     return true;
 }
@@ -315,7 +460,7 @@ static void receive_packet(xfer_ctl_t *xfer, uint16_t xfer_size) {
     xfer->short_packet = (xfer_size < xfer->max_size);
 }
 
-void dcd_int_handler(uint8_t rhport) {
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport) {
     (void)rhport;
 
     uint32_t end_num, rx_token;
@@ -332,7 +477,14 @@ void dcd_int_handler(uint8_t rhport) {
 
         xfer_ctl_t *xfer = XFER_CTL_BASE(end_num, tu_edpt_dir(endp));
 
-        if (rx_token == PID_OUT) {
+        if (end_num != 0) {
+            // non-control endpoint: advance to next packet or complete transfer
+            if (rx_token == PID_OUT) {
+                edpt_out_complete(end_num, xfer);
+            } else if (rx_token == PID_IN) {
+                edpt_in_complete(end_num, xfer);
+            }
+        } else if (rx_token == PID_OUT) {
             uint16_t rx_len = USBHSD->RX_LEN;
 
             receive_packet(xfer, rx_len);
@@ -374,6 +526,8 @@ void dcd_int_handler(uint8_t rhport) {
         xfer_status[0][TUSB_DIR_OUT].max_size = 64;
         xfer_status[0][TUSB_DIR_IN].max_size = 64;
 
+        dcd_edpt_close_all(rhport);
+
         dcd_event_bus_reset(0, TUSB_SPEED_HIGH, true);
 
         USBHSD->DEV_AD = 0;
@@ -12,6 +12,7 @@ TINYUSB_SRC_C += \
 	src/class/hid/hid_device.c \
 	src/class/midi/midi_device.c \
 	src/class/msc/msc_device.c \
+	src/class/msc/uas_device.c \
 	src/class/net/ecm_rndis_device.c \
 	src/class/net/ncm_device.c \
 	src/class/usbtmc/usbtmc_device.c \
@@ -19,8 +20,28 @@ TINYUSB_SRC_C += \
 	src/class/vendor/vendor_device.c \
   src/host/usbh.c \
   src/host/hub.c \
+  src/class/audio/audio_host.c \
   src/class/cdc/cdc_host.c \
+  src/class/cdc/cdc_rndis_host.c \
   src/class/hid/hid_host.c \
+  src/class/midi/midi_host.c \
   src/class/msc/msc_host.c \
+  src/class/net/ncm_host.c \
   src/class/vendor/vendor_host.c \
+  src/class/bridge/usb_bridge.c \
   src/typec/usbc.c \
+
+# TINYUSB_AMALGAMATION=1 compiles common and device stack as one translation unit (tinyusb_all.c generated by
+# tools/amalgamate.py) so that compiler can inline fifo/endpoint helpers into class drivers without LTO.
+# Host stack is still compiled per file.
+ifeq ($(TINYUSB_AMALGAMATION),1)
+TINYUSB_SRC_HOST_C := $(filter src/host/% %_host.c src/class/bridge/%,$(TINYUSB_SRC_C))
+TINYUSB_SRC_DEVICE_C := $(filter-out $(TINYUSB_SRC_HOST_C),$(TINYUSB_SRC_C))
+TINYUSB_ALL_C := $(BUILD)/tinyusb_all.c
+
+$(TINYUSB_ALL_C): $(addprefix $(TOP)/,$(TINYUSB_SRC_DEVICE_C)) $(TOP)/tools/amalgamate.py
+	@echo GEN $@
+	@$(PYTHON) $(TOP)/tools/amalgamate.py --top $(TOP) -o $@ $(TINYUSB_SRC_DEVICE_C)
+
+TINYUSB_SRC_C := $(TINYUSB_ALL_C) $(TINYUSB_SRC_HOST_C)
+endif
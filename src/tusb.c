@@ -39,15 +39,30 @@
 #include "host/usbh_pvt.h"
 #endif
 
+#if CFG_TUSB_OTG
+#include "device/dcd.h"
+#include "host/hcd.h"
+#endif
+
 //--------------------------------------------------------------------+
 // Public API
 //--------------------------------------------------------------------+
 
 bool tusb_init(void)
 {
+#if CFG_TUSB_OTG && defined(TUD_OPT_RHPORT) && defined(TUH_OPT_RHPORT) && (TUD_OPT_RHPORT == TUH_OPT_RHPORT)
+  // dual-role port starts as device
+  TU_ASSERT(tusb_otg_init(TUD_OPT_RHPORT, TUSB_ROLE_DEVICE));
+#else
+
 #if CFG_TUD_ENABLED && defined(TUD_OPT_RHPORT)
   // init device stack CFG_TUSB_RHPORTx_MODE must be defined
   TU_ASSERT ( tud_init(TUD_OPT_RHPORT) );
+
+  #if CFG_TUD_RHPORT_NUM > 1 && TUD_OPT_RHPORT == 0 && defined(CFG_TUSB_RHPORT1_MODE)
+  // both controllers run device stack
+  if ( (CFG_TUSB_RHPORT1_MODE) & OPT_MODE_DEVICE ) TU_ASSERT ( tud_init(1) );
+  #endif
 #endif
 
 #if CFG_TUH_ENABLED && defined(TUH_OPT_RHPORT)
@@ -55,6 +70,8 @@ bool tusb_init(void)
   TU_ASSERT( tuh_init(TUH_OPT_RHPORT) );
 #endif
 
+#endif // CFG_TUSB_OTG
+
   return true;
 }
 
@@ -73,6 +90,74 @@ bool tusb_inited(void)
   return ret;
 }
 
+//--------------------------------------------------------------------+
+// Dual-role (OTG) port
+// Both stacks stay initialized, only controller driver of current role is running. Switching tears down the
+// previous role while its controller mode is still active, then enters the new mode with dcd/hcd_role_enter()
+// which keeps clock and PHY set up, or with full dcd/hcd_init() if the port does not implement it.
+//--------------------------------------------------------------------+
+#if CFG_TUSB_OTG
+static uint8_t _otg_rhport = TUSB_INDEX_INVALID_8;
+static volatile uint8_t _otg_role = TUSB_ROLE_NONE;
+
+bool tusb_otg_init(uint8_t rhport, tusb_role_t role) {
+  TU_ASSERT(role == TUSB_ROLE_DEVICE || role == TUSB_ROLE_HOST);
+  _otg_rhport = rhport;
+  _otg_role = (uint8_t) role;
+
+  // tud_init()/tuh_init() only start controller driver of current role
+  TU_ASSERT(tud_init(rhport));
+  TU_ASSERT(tuh_init(rhport));
+
+  return true;
+}
+
+tusb_role_t tusb_role_get(uint8_t rhport) {
+  return (rhport == _otg_rhport) ? (tusb_role_t) _otg_role : TUSB_ROLE_NONE;
+}
+
+bool tusb_role_switch(uint8_t rhport, tusb_role_t role) {
+  TU_VERIFY(rhport == _otg_rhport && (role == TUSB_ROLE_DEVICE || role == TUSB_ROLE_HOST));
+  if (role == _otg_role) return true;
+
+  if (role == TUSB_ROLE_HOST) {
+    usbd_role_exit(rhport);
+    _otg_role = TUSB_ROLE_HOST;
+    if (hcd_role_enter) {
+      TU_ASSERT(hcd_role_enter(rhport));
+    } else {
+      TU_ASSERT(hcd_init(rhport));
+    }
+    hcd_int_enable(rhport);
+  } else {
+    usbh_role_exit(rhport);
+    _otg_role = TUSB_ROLE_DEVICE;
+    if (dcd_role_enter) {
+      dcd_role_enter(rhport);
+    } else {
+      dcd_init(rhport);
+    }
+    dcd_int_enable(rhport);
+  }
+
+  return true;
+}
+
+void tusb_int_handler(uint8_t rhport, bool in_isr) {
+  switch (tusb_role_get(rhport)) {
+    case TUSB_ROLE_DEVICE:
+      tud_int_handler(rhport);
+      break;
+
+    case TUSB_ROLE_HOST:
+      tuh_int_handler(rhport, in_isr);
+      break;
+
+    default: break;
+  }
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Descriptor helper
 //--------------------------------------------------------------------+
@@ -157,6 +242,8 @@ bool tu_edpt_validate(tusb_desc_endpoint_t const * desc_ep, tusb_speed_t speed)
     {
       uint16_t const spec_size = (speed == TUSB_SPEED_HIGH ? 1024 : 1023);
       TU_ASSERT(max_packet_size <= spec_size);
+      // additional transactions per micro-frame are only for highspeed
+      TU_ASSERT(speed == TUSB_SPEED_HIGH || tu_edpt_hb_mult(desc_ep) == 1);
     }
     break;
 
@@ -234,6 +321,60 @@ uint16_t tu_desc_get_interface_total_len(tusb_desc_interface_t const* desc_itf,
   return len;
 }
 
+//--------------------------------------------------------------------+
+// Endpoint Statistics
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_STATS || CFG_TUH_EDPT_STATS
+
+TU_ATTR_FAST_FUNC void tu_edpt_stats_arm(tu_edpt_stats_state_t* s) {
+  // already armed e.g transfers appended by DCD: latency counts from the first one
+  if (s->armed) return;
+
+  uint32_t const now = (uint32_t) CFG_TUSB_EDPT_STATS_TIMESTAMP();
+  if (s->active) {
+    s->stats.idle_time += now - s->last_time;
+  }
+  s->last_time = now;
+  s->armed = 1;
+  s->active = 1;
+}
+
+TU_ATTR_FAST_FUNC void tu_edpt_stats_complete(tu_edpt_stats_state_t* s, uint8_t result, uint32_t xferred_bytes) {
+  uint32_t const now = (uint32_t) CFG_TUSB_EDPT_STATS_TIMESTAMP();
+  tusb_edpt_stats_t* stats = &s->stats;
+
+  if (s->armed) {
+    uint32_t const latency = now - s->last_time;
+    stats->armed_time += latency;
+
+    // log2 bin: number of significant bits of latency
+    uint8_t bin = 0;
+    for (uint32_t v = latency; v && bin < CFG_TUSB_EDPT_STATS_HIST_BINS - 1; v >>= 1) {
+      bin++;
+    }
+    stats->latency_hist[bin]++;
+  }
+  s->last_time = now;
+  s->armed = 0;
+
+  switch (result) {
+    case XFER_RESULT_SUCCESS:
+      stats->xfer_count++;
+      stats->bytes += xferred_bytes;
+      break;
+
+    case XFER_RESULT_STALLED:
+      stats->stall_count++;
+      break;
+
+    default:
+      stats->error_count++;
+      break;
+  }
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // Endpoint Stream Helper for both Host and Device stack
 //--------------------------------------------------------------------+
@@ -252,9 +393,29 @@ bool tu_edpt_stream_init(tu_edpt_stream_t* s, bool is_host, bool is_tx, bool ove
   s->ep_buf = ep_buf;
   s->ep_bufsize = ep_bufsize;
 
+  s->ep_buf_base = ep_buf;
+  s->ep_buf_stride = ep_bufsize;
+  s->ep_buf_num = 1;
+  s->ep_buf_idx = 0;
+  s->tx_staged = 0;
+
   return true;
 }
 
+TU_ATTR_ALWAYS_INLINE static inline
+uint8_t* stream_next_buf(tu_edpt_stream_t* s)
+{
+  uint8_t const idx = (uint8_t) ((s->ep_buf_idx + 1) % s->ep_buf_num);
+  return s->ep_buf_base + idx * s->ep_buf_stride;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline
+void stream_rotate_buf(tu_edpt_stream_t* s)
+{
+  s->ep_buf = stream_next_buf(s);
+  s->ep_buf_idx = (uint8_t) ((s->ep_buf_idx + 1) % s->ep_buf_num);
+}
+
 TU_ATTR_ALWAYS_INLINE static inline
 bool stream_claim(tu_edpt_stream_t* s)
 {
@@ -284,6 +445,9 @@ bool stream_xfer(tu_edpt_stream_t* s, uint16_t count)
   }else
   {
     #if CFG_TUD_ENABLED
+    if (s->ep_buf == NULL && count) {
+      return usbd_edpt_xfer_fifo(s->rhport, s->ep_addr, &s->ff, count);
+    }
     return usbd_edpt_xfer(s->rhport, s->ep_addr, count ? s->ep_buf : NULL, count);
     #endif
   }
@@ -291,6 +455,25 @@ bool stream_xfer(tu_edpt_stream_t* s, uint16_t count)
   return false;
 }
 
+// Transfer in flight (not merely claimed)
+TU_ATTR_ALWAYS_INLINE static inline
+bool stream_busy(tu_edpt_stream_t* s)
+{
+  if (s->is_host)
+  {
+    #if CFG_TUH_ENABLED
+    return usbh_edpt_busy(s->daddr, s->ep_addr);
+    #endif
+  }else
+  {
+    #if CFG_TUD_ENABLED
+    return usbd_edpt_busy(s->rhport, s->ep_addr);
+    #endif
+  }
+
+  return false;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline
 bool stream_release(tu_edpt_stream_t* s)
 {
@@ -316,7 +499,8 @@ bool stream_release(tu_edpt_stream_t* s)
 bool tu_edpt_stream_write_zlp_if_needed(tu_edpt_stream_t* s, uint32_t last_xferred_bytes)
 {
   // ZLP condition: no pending data, last transferred bytes is multiple of packet size
-  TU_VERIFY( !tu_fifo_count(&s->ff) && last_xferred_bytes && (0 == (last_xferred_bytes & (s->ep_packetsize-1))) );
+  TU_VERIFY( !tu_fifo_count(&s->ff) && !s->tx_staged && last_xferred_bytes &&
+             (0 == (last_xferred_bytes & (s->ep_packetsize-1))) );
 
   TU_VERIFY( stream_claim(s) );
   TU_ASSERT( stream_xfer(s, 0) );
@@ -327,13 +511,36 @@ bool tu_edpt_stream_write_zlp_if_needed(tu_edpt_stream_t* s, uint32_t last_xferr
 uint32_t tu_edpt_stream_write_xfer(tu_edpt_stream_t* s)
 {
   // skip if no data
-  TU_VERIFY( tu_fifo_count(&s->ff), 0 );
+  TU_VERIFY( s->tx_staged || tu_fifo_count(&s->ff), 0 );
 
   // Claim the endpoint
-  TU_VERIFY( stream_claim(s), 0 );
+  if ( !stream_claim(s) )
+  {
+    // transfer in flight: copy next one to spare buffer meanwhile, it is posted right when current one completes.
+    // Only stage when busy (not merely claimed by other caller, which has yet to pull its data from fifo)
+    if ( s->ep_buf_num > 1 && !s->tx_staged && stream_busy(s) )
+    {
+      s->tx_staged = tu_fifo_read_n(&s->ff, stream_next_buf(s), s->ep_bufsize);
+    }
+    return 0;
+  }
 
-  // Pull data from FIFO -> EP buf
-  uint16_t const count = tu_fifo_read_n(&s->ff, s->ep_buf, s->ep_bufsize);
+  uint16_t count;
+  if ( s->tx_staged )
+  {
+    // data is already in spare buffer
+    stream_rotate_buf(s);
+    count = s->tx_staged;
+    s->tx_staged = 0;
+  }else if ( s->ep_buf == NULL )
+  {
+    // xfer fifo: DCD pulls data from FIFO
+    count = tu_min16(tu_fifo_count(&s->ff), s->ep_bufsize);
+  }else
+  {
+    // Pull data from FIFO -> EP buf
+    count = tu_fifo_read_n(&s->ff, s->ep_buf, s->ep_bufsize);
+  }
 
   if ( count )
   {
@@ -401,6 +608,28 @@ uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s)
   }
 }
 
+uint8_t const* tu_edpt_stream_read_xfer_rotate(tu_edpt_stream_t* s, uint32_t xferred_bytes)
+{
+  uint8_t const* rx_buf = s->ep_buf;
+
+  if ( s->ep_buf_num > 1 )
+  {
+    stream_rotate_buf(s);
+
+    // post next transfer only if fifo can take both received (not yet written) and next data
+    uint16_t const available = tu_fifo_remaining(&s->ff);
+    if ( available >= xferred_bytes + s->ep_packetsize && stream_claim(s) )
+    {
+      // multiple of packet size limit by ep bufsize
+      uint16_t count = (uint16_t) ((available - xferred_bytes) & ~(s->ep_packetsize - 1u));
+      count = tu_min16(count, s->ep_bufsize);
+      TU_ASSERT( stream_xfer(s, count), rx_buf );
+    }
+  }
+
+  return rx_buf;
+}
+
 uint32_t tu_edpt_stream_read(tu_edpt_stream_t* s, void* buffer, uint32_t bufsize)
 {
   uint32_t num_read = tu_fifo_read_n(&s->ff, buffer, (uint16_t) bufsize);
@@ -520,4 +749,151 @@ void tu_print_mem(void const *buf, uint32_t count, uint8_t indent)
 
 #endif
 
+//--------------------------------------------------------------------+
+// Trace
+//--------------------------------------------------------------------+
+#if CFG_TUSB_TRACE
+
+tu_static tu_trace_record_t _tu_trace_buf[CFG_TUSB_TRACE_DEPTH];
+tu_static volatile uint32_t _tu_trace_total;
+
+TU_ATTR_FAST_FUNC void tu_trace_record(uint8_t id, uint8_t param, uint16_t arg) {
+  // Reserve a slot: writers (task and ISRs) never block each other. Cortex-M0+ has no atomic instruction,
+  // an ISR preempting between the load and store could then overwrite the same slot, losing a record.
+#if defined(__GNUC__) && !defined(__ARM_ARCH_6M__)
+  uint32_t const idx = __atomic_fetch_add(&_tu_trace_total, 1, __ATOMIC_RELAXED);
+#else
+  uint32_t const idx = _tu_trace_total++;
+#endif
+
+  tu_trace_record_t* rec = &_tu_trace_buf[idx & (CFG_TUSB_TRACE_DEPTH - 1)];
+  rec->timestamp = (uint32_t) CFG_TUSB_TRACE_TIMESTAMP();
+  rec->id = id;
+  rec->param = param;
+  rec->arg = arg;
+
+#ifdef CFG_TUSB_TRACE_SINK
+  CFG_TUSB_TRACE_SINK(rec);
+#endif
+}
+
+uint32_t tu_trace_read(tu_trace_record_t* records, uint32_t count) {
+  uint32_t const total = _tu_trace_total;
+  uint32_t const available = tu_min32(total, CFG_TUSB_TRACE_DEPTH);
+  count = tu_min32(count, available);
+
+  for (uint32_t i = 0; i < count; i++) {
+    records[i] = _tu_trace_buf[(total - count + i) & (CFG_TUSB_TRACE_DEPTH - 1)];
+  }
+
+  return count;
+}
+
+uint32_t tu_trace_total(void) {
+  return _tu_trace_total;
+}
+
+#endif
+
+//--------------------------------------------------------------------+
+// Capture
+//--------------------------------------------------------------------+
+#if CFG_TUSB_CAPTURE
+
+tu_static uint8_t _tu_capture_buf[CFG_TUSB_CAPTURE_BUFSIZE];
+tu_static tu_fifo_t _tu_capture_ff = TU_FIFO_INIT(_tu_capture_buf, CFG_TUSB_CAPTURE_BUFSIZE, uint8_t, false);
+tu_static volatile uint16_t _tu_capture_seq;
+tu_static volatile uint32_t _tu_capture_dropped;
+
+TU_ATTR_FAST_FUNC void tu_capture_record(uint8_t type, uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint16_t len,
+                                         uint8_t result, void const* data, uint16_t data_len) {
+  if (data == NULL) data_len = 0;
+  data_len = tu_min16(data_len, CFG_TUSB_CAPTURE_PAYLOAD);
+
+  // record is assembled first then written as a whole, so that a full buffer drops records, never bytes of one
+  uint8_t record[sizeof(tu_capture_header_t) + CFG_TUSB_CAPTURE_PAYLOAD];
+  tu_capture_header_t* hdr = (tu_capture_header_t*) record;
+  hdr->sync = TU_CAPTURE_SYNC;
+  hdr->type = type;
+  hdr->rhport = rhport;
+  hdr->ep_addr = ep_addr;
+  hdr->timestamp = tu_htole32((uint32_t) CFG_TUSB_CAPTURE_TIMESTAMP());
+  hdr->len = tu_htole16(len);
+  hdr->daddr = daddr;
+  hdr->result = result;
+  hdr->data_len = tu_htole16(data_len);
+  if (data_len) memcpy(record + sizeof(tu_capture_header_t), data, data_len);
+
+  uint16_t const size = (uint16_t) (sizeof(tu_capture_header_t) + data_len);
+
+#if CFG_TUSB_FIFO_MULTI_PRODUCER
+  hdr->seq = tu_htole16((uint16_t) __atomic_fetch_add(&_tu_capture_seq, 1, __ATOMIC_RELAXED));
+  bool const written = (tu_fifo_mp_write_n(&_tu_capture_ff, record, size) == size);
+#else
+  hdr->seq = tu_htole16(_tu_capture_seq++);
+  bool const written = (tu_fifo_remaining(&_tu_capture_ff) >= size) &&
+                       (tu_fifo_write_n(&_tu_capture_ff, record, size) == size);
+#endif
+
+  if (!written) {
+    _tu_capture_dropped++;
+    return;
+  }
+
+#ifdef CFG_TUSB_CAPTURE_SINK
+  CFG_TUSB_CAPTURE_SINK(record, size);
+#endif
+}
+
+uint32_t tu_capture_read(void* buffer, uint32_t bufsize) {
+  return tu_fifo_read_n(&_tu_capture_ff, buffer, (tu_fifo_idx_t) tu_min32(bufsize, CFG_TUSB_CAPTURE_BUFSIZE));
+}
+
+uint32_t tu_capture_dropped(void) {
+  return _tu_capture_dropped;
+}
+
+#endif
+
+//--------------------------------------------------------------------+
+// ISR Profiling
+//--------------------------------------------------------------------+
+#if CFG_TUSB_PROF
+
+tu_static tu_prof_stat_t _tu_prof[CFG_TUSB_PROF_RHPORT_NUM][TU_PROF_SOURCE_COUNT];
+
+TU_ATTR_FAST_FUNC void tu_prof_record(uint8_t rhport, uint8_t source, uint32_t duration) {
+  if (rhport >= CFG_TUSB_PROF_RHPORT_NUM || source >= TU_PROF_SOURCE_COUNT) {
+    return;
+  }
+
+  tu_prof_stat_t* stat = &_tu_prof[rhport][source];
+  stat->count++;
+  stat->total += duration;
+  if (duration > stat->max) {
+    stat->max = duration;
+  }
+}
+
+bool tu_prof_get(uint8_t rhport, tu_prof_source_t source, tu_prof_stat_t* stat) {
+  TU_VERIFY(rhport < CFG_TUSB_PROF_RHPORT_NUM && source < TU_PROF_SOURCE_COUNT && stat != NULL);
+
+  // stats are updated in ISR, retry if a record lands while copying
+  tu_prof_stat_t const volatile* src = &_tu_prof[rhport][source];
+  do {
+    stat->count = src->count;
+    stat->max = src->max;
+    stat->total = src->total;
+  } while (stat->count != src->count);
+
+  return true;
+}
+
+void tu_prof_clear(uint8_t rhport) {
+  TU_VERIFY(rhport < CFG_TUSB_PROF_RHPORT_NUM,);
+  tu_memclr(_tu_prof[rhport], sizeof(_tu_prof[rhport]));
+}
+
+#endif
+
 #endif // host or device enabled
@@ -53,6 +53,10 @@
     #include "class/hid/hid_host.h"
   #endif
 
+  #if CFG_TUH_MIDI
+    #include "class/midi/midi_host.h"
+  #endif
+
   #if CFG_TUH_MSC
     #include "class/msc/msc_host.h"
   #endif
@@ -61,9 +65,21 @@
     #include "class/cdc/cdc_host.h"
   #endif
 
+  #if CFG_TUH_CDC_RNDIS
+    #include "class/cdc/cdc_rndis_host.h"
+  #endif
+
   #if CFG_TUH_VENDOR
     #include "class/vendor/vendor_host.h"
   #endif
+
+  #if CFG_TUH_NCM
+    #include "class/net/ncm_host.h"
+  #endif
+
+  #if CFG_TUH_AUDIO
+    #include "class/audio/audio_host.h"
+  #endif
 #else
   #ifndef tuh_int_handler
   #define tuh_int_handler(...)
@@ -86,6 +102,10 @@
     #include "class/msc/msc_device.h"
   #endif
 
+  #if CFG_TUD_MSC_UAS
+    #include "class/msc/uas_device.h"
+  #endif
+
   #if CFG_TUD_AUDIO
     #include "class/audio/audio_device.h"
   #endif
@@ -127,6 +147,11 @@
   #endif
 #endif
 
+//------------- DUAL ROLE -------------//
+#if CFG_TUSB_BRIDGE
+  #include "class/bridge/usb_bridge.h"
+#endif
+
 
 //--------------------------------------------------------------------+
 // APPLICATION API
@@ -140,6 +165,30 @@ bool tusb_init(void);
 // Check if stack is initialized
 bool tusb_inited(void);
 
+#if CFG_TUSB_OTG
+typedef enum {
+  TUSB_ROLE_NONE = 0,
+  TUSB_ROLE_DEVICE,
+  TUSB_ROLE_HOST,
+} tusb_role_t;
+
+// Initialize both device and host stack on a dual-role rhport, controller is started in role.
+// tusb_init() does this with device role if the same rhport is configured for both modes.
+bool tusb_otg_init(uint8_t rhport, tusb_role_t role);
+
+// Switch role of dual-role rhport e.g on ID pin or Type-C data role change. Configuration (device) or attached
+// devices (host) of the previous role are torn down immediately with tud_umount_cb()/tuh_umount_cb() and its pending
+// events are dropped. Must be called in the same context as tud_task()/tuh_task().
+bool tusb_role_switch(uint8_t rhport, tusb_role_t role);
+
+// Current role of rhport, TUSB_ROLE_NONE if it is not a dual-role port
+tusb_role_t tusb_role_get(uint8_t rhport);
+
+// Interrupt handler of dual-role rhport, forwarded to tud_int_handler() or tuh_int_handler() of current role.
+// Use this instead of tud_int_handler()/tuh_int_handler() in USB IRQ handler
+void tusb_int_handler(uint8_t rhport, bool in_isr);
+#endif
+
 // TODO
 // bool tusb_teardown(void);
 
@@ -193,6 +193,8 @@
 #define OPT_OS_PICO       5  ///< Raspberry Pi Pico SDK
 #define OPT_OS_RTTHREAD   6  ///< RT-Thread
 #define OPT_OS_RTX4       7  ///< Keil RTX 4
+#define OPT_OS_THREADX    8  ///< ThreadX (Azure RTOS)
+#define OPT_OS_ZEPHYR     9  ///< Zephyr
 
 // Allow to use command line to change the config name/location
 #ifdef CFG_TUSB_CONFIG_FILE
@@ -301,6 +303,12 @@
   #define CFG_TUSB_DEBUG 0
 #endif
 
+// Release profile: failed TU_ASSERT() only returns its error value, without printing message or halting at
+// breakpoint (TU_BREAKPOINT() is empty). Checks themselves are kept, for smaller code on the hot path.
+#ifndef CFG_TUSB_RELEASE
+  #define CFG_TUSB_RELEASE 0
+#endif
+
 // Level where CFG_TUSB_DEBUG must be at least for USBH is logged
 #ifndef CFG_TUH_LOG_LEVEL
   #define CFG_TUH_LOG_LEVEL   2
@@ -311,16 +319,145 @@
   #define CFG_TUD_LOG_LEVEL   2
 #endif
 
+// Binary trace of the hot path (ISR, event post, task dispatch, xfer callback, endpoint arm) into a RAM ring
+// buffer. Unlike logging, each record is only a few stores and can be left enabled in production.
+#ifndef CFG_TUSB_TRACE
+  #define CFG_TUSB_TRACE 0
+#endif
+
+// Number of records in trace ring buffer, must be power of 2. Oldest records are overwritten.
+#ifndef CFG_TUSB_TRACE_DEPTH
+  #define CFG_TUSB_TRACE_DEPTH 256
+#endif
+
+// Timestamp of trace record, typically a cycle counter e.g (DWT->CYCCNT) on Cortex-M3 and above
+#ifndef CFG_TUSB_TRACE_TIMESTAMP
+  #define CFG_TUSB_TRACE_TIMESTAMP()  0
+#endif
+
+// On-target capture of USB transactions (setup packets, transfer submissions and completions) of usbd/usbh into
+// a byte stream, read with tu_capture_read() and converted to pcapng by tools/capture_to_pcapng.py
+#ifndef CFG_TUSB_CAPTURE
+  #define CFG_TUSB_CAPTURE 0
+#endif
+
+// Size of capture ring buffer in bytes, must be power of 2. New records are dropped when it is full.
+#ifndef CFG_TUSB_CAPTURE_BUFSIZE
+  #define CFG_TUSB_CAPTURE_BUFSIZE 2048
+#endif
+
+// Max number of payload bytes captured per transfer, 0 for headers only
+#ifndef CFG_TUSB_CAPTURE_PAYLOAD
+  #define CFG_TUSB_CAPTURE_PAYLOAD 0
+#endif
+
+// Timestamp of capture record, default to the trace timestamp
+#ifndef CFG_TUSB_CAPTURE_TIMESTAMP
+  #define CFG_TUSB_CAPTURE_TIMESTAMP()  CFG_TUSB_TRACE_TIMESTAMP()
+#endif
+
+// Duration (max/average) of dcd_int_handler() broken down by interrupt source, read with tu_prof_get()
+#ifndef CFG_TUSB_PROF
+  #define CFG_TUSB_PROF 0
+#endif
+
+// Time base of ISR profiling in any unit (cycles, us), default to the trace timestamp
+#ifndef CFG_TUSB_PROF_TIMESTAMP
+  #define CFG_TUSB_PROF_TIMESTAMP()  CFG_TUSB_TRACE_TIMESTAMP()
+#endif
+
+// Number of root hub ports profiled, records of ports above are discarded
+#ifndef CFG_TUSB_PROF_RHPORT_NUM
+  #define CFG_TUSB_PROF_RHPORT_NUM  2
+#endif
+
+// Per-endpoint runtime statistics (bytes, transfers, errors, armed/idle time, latency histogram),
+// read with tud_edpt_stats_get() / tuh_edpt_stats_get()
+#ifndef CFG_TUD_EDPT_STATS
+  #define CFG_TUD_EDPT_STATS  0
+#endif
+
+#ifndef CFG_TUH_EDPT_STATS
+  #define CFG_TUH_EDPT_STATS  0
+#endif
+
+// Event queue statistics of usbd/usbh task (high-water mark, overflow by event id),
+// read with tud_event_queue_stats() / tuh_event_queue_stats()
+#ifndef CFG_TUD_TASK_QUEUE_STATS
+  #define CFG_TUD_TASK_QUEUE_STATS  0
+#endif
+
+#ifndef CFG_TUH_TASK_QUEUE_STATS
+  #define CFG_TUH_TASK_QUEUE_STATS  0
+#endif
+
+// Timestamp dcd/hcd events when they are queued, measure ISR to task latency with tud_event_timestamp() /
+// tuh_event_timestamp() and event queue statistics (latency_max, latency_total)
+#ifndef CFG_TUD_EVENT_TIMESTAMP
+  #define CFG_TUD_EVENT_TIMESTAMP  0
+#endif
+
+#ifndef CFG_TUH_EVENT_TIMESTAMP
+  #define CFG_TUH_EVENT_TIMESTAMP  0
+#endif
+
+// Time base of event timestamp in any unit (cycles, us), default to the trace timestamp
+#ifndef CFG_TUSB_EVENT_TIMESTAMP
+  #define CFG_TUSB_EVENT_TIMESTAMP()  CFG_TUSB_TRACE_TIMESTAMP()
+#endif
+
+// Dispatch hot-path callbacks (xfer, control, sof) of built-in class drivers with a switch over compile-time
+// constant indices instead of a function pointer, so that compiler can resolve and inline them. Mostly useful for
+// static builds with few classes. Application drivers from usbd/usbh_app_driver_get_cb() are still supported.
+#ifndef CFG_TUD_DRIVER_STATIC_DISPATCH
+  #define CFG_TUD_DRIVER_STATIC_DISPATCH  0
+#endif
+
+#ifndef CFG_TUH_DRIVER_STATIC_DISPATCH
+  #define CFG_TUH_DRIVER_STATIC_DISPATCH  0
+#endif
+
+// Number of log2 bins of arm-to-complete latency histogram
+#ifndef CFG_TUSB_EDPT_STATS_HIST_BINS
+  #define CFG_TUSB_EDPT_STATS_HIST_BINS  16
+#endif
+
+// Time base of endpoint statistics in any unit (cycles, us), default to the trace timestamp
+#ifndef CFG_TUSB_EDPT_STATS_TIMESTAMP
+  #define CFG_TUSB_EDPT_STATS_TIMESTAMP()  CFG_TUSB_TRACE_TIMESTAMP()
+#endif
+
+// Vendor request code (bRequest) answered by usbd with the statistics of endpoint in wIndex, before
+// tud_vendor_control_xfer_cb() is invoked. 0 to disable.
+#ifndef CFG_TUD_EDPT_STATS_VENDOR_REQUEST
+  #define CFG_TUD_EDPT_STATS_VENDOR_REQUEST  0
+#endif
+
 // Memory section for placing buffer used for usb transferring. If MEM_SECTION is different for
 // host and device use: CFG_TUD_MEM_SECTION, CFG_TUH_MEM_SECTION instead
 #ifndef CFG_TUSB_MEM_SECTION
   #define CFG_TUSB_MEM_SECTION
 #endif
 
+// USB DMA buffers are in cacheable memory (e.g Cortex-M7 with D-Cache). Endpoint buffers are then aligned
+// and padded to whole cache lines, so that cache clean/invalidate by the controller driver never touches
+// data of the CPU. If different for host and device use: CFG_TUD_MEM_DCACHE_ENABLE, CFG_TUH_MEM_DCACHE_ENABLE
+#ifndef CFG_TUSB_MEM_DCACHE_ENABLE
+  #define CFG_TUSB_MEM_DCACHE_ENABLE     0
+#endif
+
+#ifndef CFG_TUSB_MEM_DCACHE_LINE_SIZE
+  #define CFG_TUSB_MEM_DCACHE_LINE_SIZE  32
+#endif
+
 // Alignment requirement of buffer used for usb transferring. if MEM_ALIGN is different for
 // host and device controller use: CFG_TUD_MEM_ALIGN, CFG_TUH_MEM_ALIGN instead
 #ifndef CFG_TUSB_MEM_ALIGN
-  #define CFG_TUSB_MEM_ALIGN      TU_ATTR_ALIGNED(4)
+  #if CFG_TUSB_MEM_DCACHE_ENABLE
+    #define CFG_TUSB_MEM_ALIGN    TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+  #else
+    #define CFG_TUSB_MEM_ALIGN    TU_ATTR_ALIGNED(4)
+  #endif
 #endif
 
 // OS selection
@@ -332,6 +469,63 @@
   #define CFG_TUSB_OS_INC_PATH
 #endif
 
+// FreeRTOS: usbd/usbh event queues are ring buffers with direct-to-task notification instead of FreeRTOS
+// queues. ISR copies event and notifies the task waiting in tud_task()/tuh_task() without critical section.
+// Default notification (index 0) of that task is used. Not supported on multi-core MCUs.
+#ifndef CFG_TUSB_OS_FREERTOS_NOTIFY
+  #define CFG_TUSB_OS_FREERTOS_NOTIFY  0
+#endif
+
+// OS NONE: event queue is single producer (dcd/hcd ISR) single consumer (tud_task/tuh_task), reading it
+// relies on acquire/release publication of fifo indices instead of disabling USB interrupt. Events queued
+// from task context (e.g usbd_defer_func) still disable USB interrupt while writing.
+#ifndef CFG_TUSB_OS_NONE_LOCKFREE_QUEUE
+  #define CFG_TUSB_OS_NONE_LOCKFREE_QUEUE  0
+#endif
+
+// OS PICO: same for pico-sdk, tud_task()/tuh_task() must only be called from one core. Reading the event queue
+// then neither masks interrupts nor takes the queue spinlock, senders still take it shortly since they can be
+// USB ISR, other ISRs or tasks on either core.
+#ifndef CFG_TUSB_OS_PICO_LOCKFREE_QUEUE
+  #define CFG_TUSB_OS_PICO_LOCKFREE_QUEUE  0
+#endif
+
+// Single-producer single-consumer fifo: each tu_fifo_t is written by only one context and read by only
+// one context (e.g application task and USB ISR/tud_task). Fifo mutexes are skipped, write/read indices
+// are published with acquire/release ordering instead.
+#ifndef CFG_TUSB_FIFO_SPSC
+  #define CFG_TUSB_FIFO_SPSC      0
+#endif
+
+// Fifo with power of two depth always use masked index arithmetic. Enable this if all fifos have power
+// of two depth to also remove the runtime depth check. Other depths fail to compile with TU_FIFO_INIT/DEF
+// and are rejected (asserted) by tu_fifo_config().
+#ifndef CFG_TUSB_FIFO_DEPTH_POW2
+  #define CFG_TUSB_FIFO_DEPTH_POW2  0
+#endif
+
+// Collect per-fifo statistics (high-water mark, totals, overflow/underflow), see tu_fifo_stats_get()
+#ifndef CFG_TUSB_FIFO_STATS
+  #define CFG_TUSB_FIFO_STATS     0
+#endif
+
+// Use 32-bit FIFO index and count (default 16-bit) to allow FIFO depth beyond 32K items
+#ifndef CFG_TUSB_FIFO_IDX32
+  #define CFG_TUSB_FIFO_IDX32     0
+#endif
+
+// Lock-free multi-producer write API tu_fifo_mp_write_*(): concurrent tasks reserve space with CAS so that
+// each message is written contiguously without taking the write mutex. Requires atomic compare-and-swap.
+#ifndef CFG_TUSB_FIFO_MULTI_PRODUCER
+  #define CFG_TUSB_FIFO_MULTI_PRODUCER  0
+#endif
+
+// Lock-free overwrite API tu_fifo_ow_*(): a single writer (e.g ISR) stores in constant time without any lock,
+// overwriting oldest data when full. Reader detects being lapped by free running sequence and resynchronizes.
+#ifndef CFG_TUSB_FIFO_LOCKFREE_OVERWRITE
+  #define CFG_TUSB_FIFO_LOCKFREE_OVERWRITE  0
+#endif
+
 //--------------------------------------------------------------------
 // Device Options (Default)
 //--------------------------------------------------------------------
@@ -346,6 +540,65 @@
   #define CFG_TUD_MEM_ALIGN       CFG_TUSB_MEM_ALIGN
 #endif
 
+// Endpoint buffers of device stack are in cacheable memory (default: CFG_TUSB_MEM_DCACHE_ENABLE)
+#ifndef CFG_TUD_MEM_DCACHE_ENABLE
+  #define CFG_TUD_MEM_DCACHE_ENABLE     CFG_TUSB_MEM_DCACHE_ENABLE
+#endif
+
+#ifndef CFG_TUD_MEM_DCACHE_LINE_SIZE
+  #define CFG_TUD_MEM_DCACHE_LINE_SIZE  CFG_TUSB_MEM_DCACHE_LINE_SIZE
+#endif
+
+// Size of RAM arena shared by class drivers of the active configuration, 0 to disable. Supported drivers
+// (currently MSC) take their endpoint buffers from the arena when opened instead of reserving them statically,
+// all allocations are released when configuration is reset (bus reset, unplug or set configuration).
+#ifndef CFG_TUD_ARENA_SIZE
+  #define CFG_TUD_ARENA_SIZE  0
+#endif
+
+// Alignment of each arena allocation, must satisfy DMA of device controller
+#ifndef CFG_TUD_ARENA_ALIGN
+  #if CFG_TUD_MEM_DCACHE_ENABLE
+    #define CFG_TUD_ARENA_ALIGN  CFG_TUD_MEM_DCACHE_LINE_SIZE
+  #else
+    #define CFG_TUD_ARENA_ALIGN  4
+  #endif
+#endif
+
+// Generic usbd_edpt_xfer_fifo() for ports without dcd_edpt_xfer_fifo() or when it declines a transfer (e.g dwc2
+// DMA with unaligned fifo span): number of endpoints that can have a fifo transfer in progress at the same time.
+// Transfer is split at fifo wrap point on packet boundary, each segment is transferred with dcd_edpt_xfer()
+// directly from/to fifo memory, or through a bounce buffer if the linear span is not word-aligned or shorter
+// than a packet.
+#ifndef CFG_TUD_EDPT_XFER_FIFO_FALLBACK
+  #define CFG_TUD_EDPT_XFER_FIFO_FALLBACK  0
+#endif
+
+// Bounce buffer of each fallback slot, must hold the largest packet or a whole ISO transfer
+#ifndef CFG_TUD_EDPT_XFER_FIFO_BOUNCE_SIZE
+  #define CFG_TUD_EDPT_XFER_FIFO_BOUNCE_SIZE  (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
+// usbd_edpt_xfer_fifo() is usable by class drivers: natively by port or with generic fallback
+#define TUD_EDPT_XFER_FIFO  (TUP_DCD_EDPT_XFER_FIFO || CFG_TUD_EDPT_XFER_FIFO_FALLBACK)
+
+// Always-armed ISO streaming: usbd re-arms the endpoint from ISR through a ring of per-frame
+// packet slots, see usbd_edpt_iso_stream_start()
+#ifndef CFG_TUD_ISO_STREAM
+  #define CFG_TUD_ISO_STREAM  0
+#endif
+
+// USB 2.0 Link Power Management (L1 sleep), DCD must support it and application must declare LPM in
+// the BOS USB 2.0 Extension descriptor, see TUD_BOS_USB20_EXT_LPM_DESCRIPTOR()
+#ifndef CFG_TUD_LPM
+  #define CFG_TUD_LPM  0
+#endif
+
+// Central SOF scheduler: drivers register periodic callbacks, see usbd_sof_sched_add()
+#ifndef CFG_TUD_SOF_SCHED
+  #define CFG_TUD_SOF_SCHED  0
+#endif
+
 #ifndef CFG_TUD_ENDPOINT0_SIZE
   #define CFG_TUD_ENDPOINT0_SIZE  64
 #endif
@@ -354,6 +607,41 @@
   #define CFG_TUD_INTERFACE_MAX   16
 #endif
 
+// Number of device controllers (rhport) running device stack at the same time e.g both USB0 and USB1 of
+// LPC43xx/iMXRT. Each port has its own configuration and multi-instance class drivers (CDC, HID, ...), single
+// instance classes (MSC, net, ...) can only be used by one port at a time. Events share one task queue.
+// With more than 1 port, rhport is used as index, therefore controllers must be number 0 to CFG_TUD_RHPORT_NUM-1.
+#ifndef CFG_TUD_RHPORT_NUM
+  #define CFG_TUD_RHPORT_NUM      1
+#endif
+
+// Number of transfers that can be queued on a busy (non-control) endpoint. Queued transfers are
+// submitted to DCD right in the completion interrupt of the previous one, 0 to disable.
+// Note: DCD must allow dcd_edpt_xfer() to be called from its interrupt handler.
+#ifndef CFG_TUD_EDPT_XFER_QUEUE
+  #define CFG_TUD_EDPT_XFER_QUEUE   0
+#endif
+
+// Allow class driver to opt-in merging of transfer complete events of the same endpoint that are
+// still waiting in usbd event queue, see usbd_edpt_xfer_coalesce().
+#ifndef CFG_TUD_EDPT_XFER_COALESCE
+  #define CFG_TUD_EDPT_XFER_COALESCE   0
+#endif
+
+// Queue the whole data stage of tud_control_xfer_direct() as a single multi-packet EP0 transfer
+// instead of one transfer per CFG_TUD_ENDPOINT0_SIZE packet. DCD must support EP0 transfer larger
+// than its max packet size.
+#ifndef CFG_TUD_CONTROL_MULTI_PACKET
+  #define CFG_TUD_CONTROL_MULTI_PACKET   0
+#endif
+
+// Number of configuration descriptors whose interface-to-driver index is kept after SET_CONFIGURATION.
+// Setting the same configuration again (same descriptor address and length) opens the bound drivers
+// directly instead of offering every interface to every driver. 0 to disable.
+#ifndef CFG_TUD_CONFIG_CACHE
+  #define CFG_TUD_CONFIG_CACHE   0
+#endif
+
 //------------- Device Class Driver -------------//
 #ifndef CFG_TUD_BTH
   #define CFG_TUD_BTH             0
@@ -371,6 +659,10 @@
   #define CFG_TUD_MSC             0
 #endif
 
+#ifndef CFG_TUD_MSC_UAS
+  #define CFG_TUD_MSC_UAS         0
+#endif
+
 #ifndef CFG_TUD_HID
   #define CFG_TUD_HID             0
 #endif
@@ -416,6 +708,17 @@
   #define CFG_TUD_NCM         0
 #endif
 
+// ECM/NCM: apply SET_ETHERNET_PACKET_FILTER and SET_ETHERNET_MULTICAST_FILTERS of the host to received frames,
+// unwanted broadcast/multicast frames are dropped before tud_network_recv_cb()
+#ifndef CFG_TUD_NET_PACKET_FILTER
+  #define CFG_TUD_NET_PACKET_FILTER   0
+#endif
+
+// Number of multicast addresses accepted per SET_ETHERNET_MULTICAST_FILTERS, they are kept in a 64-bit hash
+#ifndef CFG_TUD_NET_MC_FILTER_MAX
+  #define CFG_TUD_NET_MC_FILTER_MAX   16
+#endif
+
 //--------------------------------------------------------------------
 // Host Options (Default)
 //--------------------------------------------------------------------
@@ -427,6 +730,97 @@
   #ifndef CFG_TUH_ENUMERATION_BUFSIZE
     #define CFG_TUH_ENUMERATION_BUFSIZE 256
   #endif
+
+  // Number of devices (behind hubs) that can be enumerated in parallel, each has its own enumeration buffer.
+  // Address 0 is still used by one device at a time.
+  #ifndef CFG_TUH_ENUMERATION_NUM
+    #define CFG_TUH_ENUMERATION_NUM 1
+  #endif
+
+  // Number of control transfers that can run concurrently, each on a different device. Only HCDs with a
+  // separate control pipe per device (e.g EHCI, OHCI) can use more than 1.
+  #ifndef CFG_TUH_CTRL_XFER_NUM
+    #define CFG_TUH_CTRL_XFER_NUM 1
+  #endif
+
+  // Number of non-control endpoints shared by all devices. If 0, each device has its own
+  // CFG_TUH_ENDPOINT_MAX x 2 endpoint table. Pool saves RAM when supporting lots of (small) devices behind hubs
+  #ifndef CFG_TUH_ENDPOINT_POOL_NUM
+    #define CFG_TUH_ENDPOINT_POOL_NUM 0
+  #endif
+
+  // Periodic bandwidth accounting: interrupt/isochronous endpoints are assigned to the least loaded
+  // (micro)frames for their bInterval, tuh_edpt_open() fails if periodic bus time budget is exceeded
+  #ifndef CFG_TUH_PERIODIC_BW
+    #define CFG_TUH_PERIODIC_BW 0
+  #endif
+
+  // Selective suspend of individual (non-hub) devices with tuh_suspend()/tuh_resume() via hub port or roothub
+  // port suspend. Pending transfers are taken off the schedule while suspended and restarted on resume.
+  #ifndef CFG_TUH_SUSPEND
+    #define CFG_TUH_SUSPEND 0
+  #endif
+
+  // Suspend device automatically after it has no completed transfer for this many ms, 0 to disable.
+  // Device with pending IN transfer is only suspended if it supports remote wakeup.
+  #ifndef CFG_TUH_SUSPEND_IDLE_MS
+    #define CFG_TUH_SUSPEND_IDLE_MS 0
+  #endif
+
+  // Port reset duration and connection debounce delay (ms) before enumerating a newly attached device. Can be
+  // changed per port with tuh_enum_timing_cb() e.g shorter debounce for soldered-down devices. USB specs: reset is
+  // 10 to 50 ms, debounce is at least 100 ms for hot-plugged devices.
+  #ifndef CFG_TUH_ENUM_RESET_DELAY_MS
+    #define CFG_TUH_ENUM_RESET_DELAY_MS 50
+  #endif
+
+  #ifndef CFG_TUH_ENUM_DEBOUNCE_DELAY_MS
+    #define CFG_TUH_ENUM_DEBOUNCE_DELAY_MS 450
+  #endif
+
+  // Request the whole enumeration buffer for the configuration descriptor in a single transfer instead of
+  // 9-byte header first then wTotalLength. Falls back to the two-step fetch if the result is truncated.
+  #ifndef CFG_TUH_ENUM_CONFIG_SPECULATIVE
+    #define CFG_TUH_ENUM_CONFIG_SPECULATIVE 0
+  #endif
+
+  // Cache configuration descriptor of devices to skip fetching it when the same device is re-attached.
+  // Cached entry is looked up by device descriptor (VID/PID/bcdDevice ...) and validated by 9-byte header.
+  #ifndef CFG_TUH_DESC_CACHE
+    #define CFG_TUH_DESC_CACHE 0
+  #endif
+
+  // Number of cache entries in RAM, can be 0 if application only uses tuh_descriptor_cache_load_cb()
+  #ifndef CFG_TUH_DESC_CACHE_NUM
+    #define CFG_TUH_DESC_CACHE_NUM 2
+  #endif
+
+  // Largest configuration descriptor that can be cached in RAM
+  #ifndef CFG_TUH_DESC_CACHE_BUFSIZE
+    #define CFG_TUH_DESC_CACHE_BUFSIZE CFG_TUH_ENUMERATION_BUFSIZE
+  #endif
+
+  // Prefetch language ID, manufacturer, product and serial strings during enumeration (before tuh_mount_cb) into a
+  // per-device UTF-8 cache read with tuh_manufacturer_string_get() etc. without extra control transfers.
+  #ifndef CFG_TUH_STRING_CACHE
+    #define CFG_TUH_STRING_CACHE 0
+  #endif
+
+  // Size in bytes (including null terminator) of each cached UTF-8 string, longer string is truncated
+  #ifndef CFG_TUH_STRING_CACHE_LEN
+    #define CFG_TUH_STRING_CACHE_LEN 32
+  #endif
+
+  // Number of interface (alternate setting) and endpoint descriptors indexed in a single pass over the
+  // configuration descriptor before class drivers are opened. Drivers look up descriptors of an interface with
+  // usbh_desc_itf_*() instead of walking them. Larger configuration falls back to walking, 0 to disable index.
+  #ifndef CFG_TUH_CONFIG_INDEX_ITF_MAX
+    #define CFG_TUH_CONFIG_INDEX_ITF_MAX 16
+  #endif
+
+  #ifndef CFG_TUH_CONFIG_INDEX_EP_MAX
+    #define CFG_TUH_CONFIG_INDEX_EP_MAX 32
+  #endif
 #endif // CFG_TUH_ENABLED
 
 // Attribute to place data in accessible RAM for host controller (default: CFG_TUSB_MEM_SECTION)
@@ -439,6 +833,15 @@
   #define CFG_TUH_MEM_ALIGN     CFG_TUSB_MEM_ALIGN
 #endif
 
+// Endpoint buffers of host stack are in cacheable memory (default: CFG_TUSB_MEM_DCACHE_ENABLE)
+#ifndef CFG_TUH_MEM_DCACHE_ENABLE
+  #define CFG_TUH_MEM_DCACHE_ENABLE     CFG_TUSB_MEM_DCACHE_ENABLE
+#endif
+
+#ifndef CFG_TUH_MEM_DCACHE_LINE_SIZE
+  #define CFG_TUH_MEM_DCACHE_LINE_SIZE  CFG_TUSB_MEM_DCACHE_LINE_SIZE
+#endif
+
 //------------- CLASS -------------//
 
 #ifndef CFG_TUH_HUB
@@ -449,6 +852,11 @@
   #define CFG_TUH_CDC    0
 #endif
 
+#ifndef CFG_TUH_CDC_RNDIS
+  // RNDIS is a separate driver but claims CDC-ACM interfaces with vendor protocol 0xFF
+  #define CFG_TUH_CDC_RNDIS 0
+#endif
+
 #ifndef CFG_TUH_CDC_FTDI
   // FTDI is not part of CDC class, only to re-use CDC driver API
   #define CFG_TUH_CDC_FTDI 0
@@ -506,10 +914,24 @@
   #define CFG_TUH_VENDOR 0
 #endif
 
+#ifndef CFG_TUH_NCM
+  #define CFG_TUH_NCM    0
+#endif
+
+#ifndef CFG_TUH_AUDIO
+  #define CFG_TUH_AUDIO  0
+#endif
+
 #ifndef CFG_TUH_API_EDPT_XFER
   #define CFG_TUH_API_EDPT_XFER 0
 #endif
 
+// Number of tuh_edpt_xfer() transfers (shared by all endpoints) that can be queued behind the one in progress
+// on the same endpoint. Queued transfer is started as soon as previous one completes. Require CFG_TUH_API_EDPT_XFER
+#ifndef CFG_TUH_API_EDPT_XFER_QUEUE_NUM
+  #define CFG_TUH_API_EDPT_XFER_QUEUE_NUM 0
+#endif
+
 // Enable PIO-USB software host controller
 #ifndef CFG_TUH_RPI_PIO_USB
   #define CFG_TUH_RPI_PIO_USB 0
@@ -519,6 +941,12 @@
   #define CFG_TUD_RPI_PIO_USB 0
 #endif
 
+// Run PIO-USB device on a dedicated core (no USB interrupt on the core running tud_task()). That core must execute
+// dcd_pio_usb_core_loop() e.g multicore_launch_core1(dcd_pio_usb_core_loop) before tud_init()/tusb_init().
+#ifndef CFG_TUD_RPI_PIO_USB_DEDICATED_CORE
+  #define CFG_TUD_RPI_PIO_USB_DEDICATED_CORE 0
+#endif
+
 // MAX3421 Host controller option
 #ifndef CFG_TUH_MAX3421
   #define CFG_TUH_MAX3421  0
@@ -534,6 +962,22 @@
 #define tuc_int_handler(_p)
 #endif
 
+//--------------------------------------------------------------------+
+// Dual Role Options (Default)
+//--------------------------------------------------------------------+
+
+// Number of bridge pipes forwarding data between an endpoint of attached device (host stack) and an endpoint
+// of our device port without copying, see class/bridge/usb_bridge.h
+#ifndef CFG_TUSB_BRIDGE
+  #define CFG_TUSB_BRIDGE   0
+#endif
+
+// Dual-role (OTG) port: device and host stack are both initialized on the same rhport (CFG_TUSB_RHPORTx_MODE has
+// both OPT_MODE_DEVICE and OPT_MODE_HOST), tusb_role_switch() swaps controller mode without re-initializing stacks
+#ifndef CFG_TUSB_OTG
+  #define CFG_TUSB_OTG      0
+#endif
+
 //------------------------------------------------------------------
 // Configuration Validation
 //------------------------------------------------------------------
@@ -541,6 +985,18 @@
   #error Control Endpoint Max Packet Size cannot be larger than 64
 #endif
 
+#if CFG_TUSB_BRIDGE && !(CFG_TUD_ENABLED && CFG_TUH_ENABLED && CFG_TUH_API_EDPT_XFER)
+  #error CFG_TUSB_BRIDGE requires both device and host stack, and CFG_TUH_API_EDPT_XFER
+#endif
+
+#if CFG_TUSB_OTG && !(CFG_TUD_ENABLED && CFG_TUH_ENABLED)
+  #error CFG_TUSB_OTG requires both device and host stack
+#endif
+
+#if CFG_TUH_AUDIO && !CFG_TUH_API_EDPT_XFER
+  #error CFG_TUH_AUDIO requires CFG_TUH_API_EDPT_XFER for isochronous transfer
+#endif
+
 // To avoid GCC compiler warnings when -pedantic option is used (strict ISO C)
 typedef int make_iso_compilers_happy;
 
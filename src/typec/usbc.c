@@ -52,13 +52,61 @@ static bool _usbc_inited = false;
 static bool _port_inited[TUP_TYPEC_RHPORTS_NUM];
 
 // Max possible PD size is 262 bytes
-static uint8_t _rx_buf[64] TU_ATTR_ALIGNED(4);
+static uint8_t _rx_buf[CFG_TUC_RX_BUF_NUM][64] TU_ATTR_ALIGNED(4);
 static uint8_t _tx_buf[64] TU_ATTR_ALIGNED(4);
 
+// RX ring: buffers are filled in order by ISR and consumed in order by task
+static struct {
+  uint8_t wr;             // buffer being filled by controller
+  uint8_t rd;             // next buffer to process by task
+  volatile uint8_t count; // number of received but not yet processed buffers
+  volatile bool armed;    // controller is receiving into _rx_buf[wr]
+} _rx_ring;
+
+TU_VERIFY_STATIC(CFG_TUC_RX_BUF_NUM > 0 && CFG_TUC_RX_BUF_NUM < 256, "invalid number of rx buffers");
+
+// start receiving into the next free buffer, if any
+static void rx_ring_arm(uint8_t rhport) {
+  if (_rx_ring.count < CFG_TUC_RX_BUF_NUM) {
+    _rx_ring.armed = true;
+    tcd_msg_receive(rhport, _rx_buf[_rx_ring.wr], sizeof(_rx_buf[0]));
+  } else {
+    _rx_ring.armed = false;
+  }
+}
+
+// MessageID counter of transmitted messages
+static uint8_t _tx_msg_id[TUP_TYPEC_RHPORTS_NUM];
+
 bool usbc_msg_send(uint8_t rhport, pd_header_t const* header, void const* data);
 bool parse_msg_data(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end);
 bool parse_msg_control(uint8_t rhport, pd_header_t const* header);
 
+#if CFG_TUC_PE_SINK
+enum {
+  PE_SNK_WAIT_CAPS = 0,
+  PE_SNK_WAIT_ACCEPT,
+  PE_SNK_TRANSITION,
+  PE_SNK_READY,
+};
+
+typedef struct {
+  uint32_t src_caps[7]; // cached Source_Capabilities
+  uint32_t rdo;         // precomputed RDO for cached capabilities
+  uint16_t voltage_mv;  // preferred voltage
+  uint16_t current_ma;  // preferred current
+  uint8_t  src_cap_count;
+  uint8_t  state;
+  bool     contract;    // explicit contract established
+} pe_sink_t;
+
+static pe_sink_t _pe[TUP_TYPEC_RHPORTS_NUM];
+
+static void pe_attach(uint8_t rhport);
+static void pe_process_data(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end);
+static void pe_process_control(uint8_t rhport, pd_header_t const* header);
+#endif
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
@@ -85,6 +133,12 @@ bool tuc_init(uint8_t rhport, uint32_t port_type) {
   TU_LOG_USBC("USBC init on port %u\r\n", rhport);
   TU_LOG_INT(USBC_DEBUG, sizeof(tcd_event_t));
 
+  #if CFG_TUC_PE_SINK
+  tu_memclr(&_pe[rhport], sizeof(pe_sink_t));
+  _pe[rhport].voltage_mv = CFG_TUC_PE_SINK_VOLTAGE_MV;
+  _pe[rhport].current_ma = CFG_TUC_PE_SINK_CURRENT_MA;
+  #endif
+
   TU_ASSERT(tcd_init(rhport, port_type));
   tcd_int_enable(rhport);
 
@@ -107,25 +161,36 @@ void tuc_task_ext(uint32_t timeout_ms, bool in_isr) {
       case TCD_EVENT_CC_CHANGED:
         break;
 
-      case TCD_EVENT_RX_COMPLETE:
-        // TODO process message here in ISR, move to thread later
+      case TCD_EVENT_RX_COMPLETE: {
+        // reception is already re-armed in ISR, buffer is consumed in the order it is filled
+        uint8_t* rx_buf = _rx_buf[_rx_ring.rd];
+
         if (event.xfer_complete.result == XFER_RESULT_SUCCESS) {
-          pd_header_t const* header = (pd_header_t const*) _rx_buf;
+          pd_header_t const* header = (pd_header_t const*) rx_buf;
 
           if (header->n_data_obj == 0) {
             parse_msg_control(event.rhport, header);
 
           }else {
-            uint8_t const* p_end = _rx_buf + event.xfer_complete.xferred_bytes;
-            uint8_t const * dobj = _rx_buf + sizeof(pd_header_t);
+            uint8_t const* p_end = rx_buf + event.xfer_complete.xferred_bytes;
+            uint8_t const * dobj = rx_buf + sizeof(pd_header_t);
 
             parse_msg_data(event.rhport, header, dobj, p_end);
           }
         }
 
-        // prepare for next message
-        tcd_msg_receive(event.rhport, _rx_buf, sizeof(_rx_buf));
+        // release buffer, re-arm if ISR ran out of free buffers
+        usbc_int_set(false);
+        _rx_ring.rd = (uint8_t) ((_rx_ring.rd + 1) % CFG_TUC_RX_BUF_NUM);
+        if (_rx_ring.count) {
+          _rx_ring.count--;
+        }
+        if (!_rx_ring.armed) {
+          rx_ring_arm(event.rhport);
+        }
+        usbc_int_set(true);
         break;
+      }
 
       case TCD_EVENT_TX_COMPLETE:
         break;
@@ -136,6 +201,11 @@ void tuc_task_ext(uint32_t timeout_ms, bool in_isr) {
 }
 
 bool parse_msg_data(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end) {
+  #if CFG_TUC_PE_SINK
+  // policy engine responds first, application is only notified
+  pe_process_data(rhport, header, dobj, p_end);
+  #endif
+
   if (tuc_pd_data_received_cb) {
     tuc_pd_data_received_cb(rhport, header, dobj, p_end);
   }
@@ -144,6 +214,10 @@ bool parse_msg_data(uint8_t rhport, pd_header_t const* header, uint8_t const* do
 }
 
 bool parse_msg_control(uint8_t rhport, pd_header_t const* header) {
+  #if CFG_TUC_PE_SINK
+  pe_process_control(rhport, header);
+  #endif
+
   if (tuc_pd_control_received_cb) {
     tuc_pd_control_received_cb(rhport, header);
   }
@@ -156,8 +230,11 @@ bool parse_msg_control(uint8_t rhport, pd_header_t const* header) {
 //--------------------------------------------------------------------+
 
 bool usbc_msg_send(uint8_t rhport, pd_header_t const* header, void const* data) {
-  // copy header
-  memcpy(_tx_buf, header, sizeof(pd_header_t));
+  // copy header with our MessageID
+  pd_header_t hdr = *header;
+  hdr.msg_id = _tx_msg_id[rhport];
+  _tx_msg_id[rhport] = (uint8_t) ((_tx_msg_id[rhport] + 1) & 0x07);
+  memcpy(_tx_buf, &hdr, sizeof(pd_header_t));
 
   // copy data objcet if available
   uint16_t const n_data_obj = header->n_data_obj;
@@ -188,9 +265,24 @@ void tcd_event_handler(tcd_event_t const * event, bool in_isr) {
     case TCD_EVENT_CC_CHANGED:
       if (event->cc_changed.cc_state[0] || event->cc_changed.cc_state[1]) {
         // Attach, start receiving
-        tcd_msg_receive(event->rhport, _rx_buf, sizeof(_rx_buf));
+        _tx_msg_id[event->rhport] = 0;
+        tu_memclr(&_rx_ring, sizeof(_rx_ring));
+        #if CFG_TUC_PE_SINK
+        pe_attach(event->rhport);
+        #endif
+        rx_ring_arm(event->rhport);
       }else {
         // Detach
+        _rx_ring.armed = false;
+      }
+      break;
+
+    case TCD_EVENT_RX_COMPLETE:
+      // re-arm reception on the next free buffer right away to keep up with back-to-back messages
+      if (_rx_ring.armed) {
+        _rx_ring.wr = (uint8_t) ((_rx_ring.wr + 1) % CFG_TUC_RX_BUF_NUM);
+        _rx_ring.count++;
+        rx_ring_arm(event->rhport);
       }
       break;
 
@@ -200,6 +292,210 @@ void tcd_event_handler(tcd_event_t const * event, bool in_isr) {
   osal_queue_send(_usbc_q, event, in_isr);
 }
 
+//--------------------------------------------------------------------+
+// Sink Policy Engine
+//--------------------------------------------------------------------+
+#if CFG_TUC_PE_SINK
+
+static bool pe_send_control(uint8_t rhport, uint8_t msg_type) {
+  pd_header_t const header = {
+      .msg_type = msg_type,
+      .data_role = PD_DATA_ROLE_UFP,
+      .specs_rev = PD_REV_30,
+      .power_role = PD_POWER_ROLE_SINK,
+      .msg_id = 0,
+      .n_data_obj = 0,
+      .extended = 0,
+  };
+
+  return usbc_msg_send(rhport, &header, NULL);
+}
+
+// fixed PDO with preferred voltage, then PPS APDO covering preferred voltage, then highest fixed PDO below it
+static uint32_t pe_rdo_default(pe_sink_t const* pe) {
+  uint8_t  fixed_pos = 1; // vSafe5V is always the first PDO
+  uint32_t fixed_mv = 0;
+  uint8_t  pps_pos = 0;
+
+  for (uint8_t i = 0; i < pe->src_cap_count; i++) {
+    uint32_t const pdo = pe->src_caps[i];
+
+    switch ((pdo >> 30) & 0x03ul) {
+      case PD_PDO_TYPE_FIXED: {
+        pd_pdo_fixed_t const* fixed = (pd_pdo_fixed_t const*) &pdo;
+        uint32_t const mv = fixed->voltage_50mv * 50u;
+        if (mv <= pe->voltage_mv && mv > fixed_mv) {
+          fixed_pos = i + 1;
+          fixed_mv = mv;
+        }
+        break;
+      }
+
+      case PD_PDO_TYPE_APDO: {
+        pd_pdo_apdo_t const* apdo = (pd_pdo_apdo_t const*) &pdo;
+        if (pps_pos == 0 && apdo->spr_programmable == 0 &&
+            apdo->voltage_min_100mv * 100u <= pe->voltage_mv && pe->voltage_mv <= apdo->voltage_max_100mv * 100u &&
+            pe->current_ma <= apdo->current_max_50ma * 50u) {
+          pps_pos = i + 1;
+        }
+        break;
+      }
+
+      default: break;
+    }
+  }
+
+  uint32_t rdo = 0;
+
+  if (fixed_mv != pe->voltage_mv && pps_pos) {
+    pd_rdo_pps_t* pps = (pd_rdo_pps_t*) &rdo;
+    pps->current_operate_50ma = (uint32_t) (pe->current_ma / 50u) & 0x7Fu;
+    pps->voltage_output_20mv  = (uint32_t) (pe->voltage_mv / 20u) & 0xFFFu;
+    pps->usb_comm_capable     = 1;
+    pps->object_position      = pps_pos;
+  } else {
+    pd_pdo_fixed_t const* fixed = (pd_pdo_fixed_t const*) &pe->src_caps[fixed_pos - 1];
+    uint32_t const current_10ma = tu_min32(pe->current_ma / 10u, fixed->current_max_10ma);
+
+    pd_rdo_fixed_variable_t* fv = (pd_rdo_fixed_variable_t*) &rdo;
+    fv->current_extremum_10ma = current_10ma & 0x3FFu;
+    fv->current_operate_10ma  = current_10ma & 0x3FFu;
+    fv->usb_comm_capable      = 1;
+    fv->capability_mismatch   = (fixed_mv == 0) ? 1 : 0;
+    fv->object_position       = fixed_pos;
+  }
+
+  return rdo;
+}
+
+static void pe_rdo_update(uint8_t rhport) {
+  pe_sink_t* pe = &_pe[rhport];
+  uint32_t rdo = 0;
+
+  if (!(tuc_pe_rdo_select_cb && tuc_pe_rdo_select_cb(rhport, pe->src_caps, pe->src_cap_count, &rdo))) {
+    rdo = pe_rdo_default(pe);
+  }
+
+  pe->rdo = rdo;
+}
+
+static bool pe_request(uint8_t rhport) {
+  pe_sink_t* pe = &_pe[rhport];
+  TU_VERIFY(pe->src_cap_count && pe->rdo);
+
+  pe->state = PE_SNK_WAIT_ACCEPT;
+  return tuc_msg_request(rhport, &pe->rdo);
+}
+
+static void pe_attach(uint8_t rhport) {
+  // keep cached capabilities, they are validated against the next Source_Capabilities
+  _pe[rhport].state = PE_SNK_WAIT_CAPS;
+  _pe[rhport].contract = false;
+}
+
+static void pe_process_data(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end) {
+  pe_sink_t* pe = &_pe[rhport];
+
+  if (header->msg_type != PD_DATA_SOURCE_CAP) return;
+
+  uint32_t caps[7];
+  uint8_t count = 0;
+  while (count < header->n_data_obj && dobj + 4 <= p_end) {
+    caps[count++] = tu_le32toh(tu_unaligned_read32(dobj));
+    dobj += 4;
+  }
+  if (count == 0) return;
+
+  // only recompute RDO when capabilities change e.g. after Soft_Reset source re-sends the same list
+  if (count != pe->src_cap_count || 0 != memcmp(caps, pe->src_caps, count * 4) || pe->rdo == 0) {
+    memcpy(pe->src_caps, caps, count * 4);
+    pe->src_cap_count = count;
+    pe_rdo_update(rhport);
+  }
+
+  pe_request(rhport);
+}
+
+static void pe_process_control(uint8_t rhport, pd_header_t const* header) {
+  pe_sink_t* pe = &_pe[rhport];
+
+  switch (header->msg_type) {
+    case PD_CTRL_ACCEPT:
+      if (pe->state == PE_SNK_WAIT_ACCEPT) {
+        pe->state = PE_SNK_TRANSITION;
+      }
+      break;
+
+    case PD_CTRL_REJECT:
+    case PD_CTRL_WAIT:
+      if (pe->state == PE_SNK_WAIT_ACCEPT) {
+        // previous contract (if any) stays in place
+        pe->state = pe->contract ? PE_SNK_READY : PE_SNK_WAIT_CAPS;
+        if (tuc_pe_contract_cb) {
+          tuc_pe_contract_cb(rhport, pe->rdo, false);
+        }
+      }
+      break;
+
+    case PD_CTRL_PS_READY:
+      if (pe->state == PE_SNK_TRANSITION) {
+        pe->state = PE_SNK_READY;
+        pe->contract = true;
+        if (tuc_pe_contract_cb) {
+          tuc_pe_contract_cb(rhport, pe->rdo, true);
+        }
+      }
+      break;
+
+    case PD_CTRL_SOFT_RESET:
+      // reset protocol layer and wait for Source_Capabilities, RDO is reused if they are unchanged
+      _tx_msg_id[rhport] = 0;
+      pe->state = PE_SNK_WAIT_CAPS;
+      pe->contract = false;
+      pe_send_control(rhport, PD_CTRL_ACCEPT);
+      break;
+
+    case PD_CTRL_DR_SWAP:
+    case PD_CTRL_PR_SWAP:
+    case PD_CTRL_VCONN_SWAP:
+    case PD_CTRL_FR_SWAP:
+      // sink only
+      pe_send_control(rhport, PD_CTRL_NOT_SUPPORTED);
+      break;
+
+    default: break;
+  }
+}
+
+bool tuc_pe_set_preferred(uint8_t rhport, uint16_t voltage_mv, uint16_t current_ma) {
+  pe_sink_t* pe = &_pe[rhport];
+  pe->voltage_mv = voltage_mv;
+  pe->current_ma = current_ma;
+
+  if (pe->src_cap_count == 0) {
+    return true; // will be applied to next Source_Capabilities
+  }
+
+  pe_rdo_update(rhport);
+  return (pe->state == PE_SNK_READY) ? pe_request(rhport) : true;
+}
+
+bool tuc_pe_rerequest(uint8_t rhport) {
+  TU_VERIFY(_pe[rhport].state == PE_SNK_READY);
+  return pe_request(rhport);
+}
+
+uint8_t tuc_pe_source_caps(uint8_t rhport, uint32_t const** pdos) {
+  *pdos = _pe[rhport].src_caps;
+  return _pe[rhport].src_cap_count;
+}
+
+bool tuc_pe_contract_ready(uint8_t rhport) {
+  return _pe[rhport].contract;
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
@@ -42,6 +42,28 @@ extern "C" {
 #define CFG_TUC_TASK_QUEUE_SZ   8
 #endif
 
+// Number of PD message RX buffers. Reception is re-armed from ISR on the next free buffer so that
+// back-to-back messages are not lost while the task is still processing the previous one.
+#ifndef CFG_TUC_RX_BUF_NUM
+#define CFG_TUC_RX_BUF_NUM      4
+#endif
+
+// Built-in sink policy engine: cache Source_Capabilities and answer with a precomputed Request
+// without going through application callbacks. Contract is renegotiated in one round trip after
+// Soft_Reset when the source advertises the same capabilities.
+#ifndef CFG_TUC_PE_SINK
+#define CFG_TUC_PE_SINK         0
+#endif
+
+// Default preferred voltage & current for sink policy engine, can be changed with tuc_pe_set_preferred()
+#ifndef CFG_TUC_PE_SINK_VOLTAGE_MV
+#define CFG_TUC_PE_SINK_VOLTAGE_MV   5000
+#endif
+
+#ifndef CFG_TUC_PE_SINK_CURRENT_MA
+#define CFG_TUC_PE_SINK_CURRENT_MA   500
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -77,12 +99,36 @@ extern void tcd_int_handler(uint8_t rhport);
 TU_ATTR_WEAK bool tuc_pd_data_received_cb(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end);
 TU_ATTR_WEAK bool tuc_pd_control_received_cb(uint8_t rhport, pd_header_t const* header);
 
+#if CFG_TUC_PE_SINK
+// Invoked when Source_Capabilities changed to select the RDO. Return false to use the default selection:
+// fixed PDO with preferred voltage, then PPS APDO covering preferred voltage, then highest fixed PDO below it.
+TU_ATTR_WEAK bool tuc_pe_rdo_select_cb(uint8_t rhport, uint32_t const* pdos, uint8_t count, uint32_t* rdo);
+
+// Invoked when requested contract is established (PS_RDY) or rejected by source
+TU_ATTR_WEAK void tuc_pe_contract_cb(uint8_t rhport, uint32_t rdo, bool accepted);
+#endif
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
 
 bool tuc_msg_request(uint8_t rhport, void const* rdo);
 
+#if CFG_TUC_PE_SINK
+// Set preferred voltage & current. If source capabilities are known, the RDO is recomputed
+// and re-requested right away (e.g to step PPS output voltage).
+bool tuc_pe_set_preferred(uint8_t rhport, uint16_t voltage_mv, uint16_t current_ma);
+
+// Re-send the cached RDO to renegotiate the current contract
+bool tuc_pe_rerequest(uint8_t rhport);
+
+// Get cached Source_Capabilities, return number of PDOs
+uint8_t tuc_pe_source_caps(uint8_t rhport, uint32_t const** pdos);
+
+// Check if an explicit contract is established
+bool tuc_pe_contract_ready(uint8_t rhport);
+#endif
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,149 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Device side application of the benchmarks: RAM disk, network and audio callbacks shared by the loopback
+ * benchmark (main.c) and the session replay (replay.c).
+ */
+
+#include <string.h>
+
+#include "tusb.h"
+#include "bench.h"
+
+static uint8_t _msc_disk[BENCH_MSC_BLOCK_COUNT][BENCH_MSC_BLOCK_SIZE];
+static uint8_t _audio_samples[CFG_TUD_AUDIO_EP_SZ_IN];
+
+uint32_t bench_msc_block_count = BENCH_MSC_BLOCK_COUNT;
+volatile uint32_t bench_ncm_rx_count;
+static bool _ncm_rx_pending;
+
+void bench_ncm_rx_renew(void) {
+  if (_ncm_rx_pending) {
+    _ncm_rx_pending = false;
+    tud_network_recv_renew();
+  }
+}
+
+//--------------------------------------------------------------------+
+// MSC
+// Disk may be advertised larger than RAM (bench_msc_block_count) to replay sessions recorded on real disks,
+// blocks beyond RAM are mirrored since data content does not matter.
+//--------------------------------------------------------------------+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
+  (void) lun;
+  memcpy(vendor_id, "TinyUSB", 7);
+  memcpy(product_id, "Bench RAM Disk", 14);
+  memcpy(product_rev, "1.0", 3);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size) {
+  (void) lun;
+  *block_count = bench_msc_block_count;
+  *block_size = BENCH_MSC_BLOCK_SIZE;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  (void) lun;
+  TU_VERIFY(lba < bench_msc_block_count, -1);
+  memcpy(buffer, _msc_disk[lba % BENCH_MSC_BLOCK_COUNT] + offset, bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  (void) lun;
+  TU_VERIFY(lba < bench_msc_block_count, -1);
+  memcpy(_msc_disk[lba % BENCH_MSC_BLOCK_COUNT] + offset, buffer, bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize) {
+  (void) scsi_cmd;
+  (void) buffer;
+  (void) bufsize;
+  tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+  return -1;
+}
+
+//--------------------------------------------------------------------+
+// HID
+//--------------------------------------------------------------------+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer,
+                               uint16_t reqlen) {
+  (void) instance;
+  (void) report_id;
+  (void) report_type;
+  (void) buffer;
+  (void) reqlen;
+  return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer,
+                           uint16_t bufsize) {
+  (void) instance;
+  (void) report_id;
+  (void) report_type;
+  (void) buffer;
+  (void) bufsize;
+}
+
+//--------------------------------------------------------------------+
+// NCM
+//--------------------------------------------------------------------+
+uint8_t tud_network_mac_address[6] = {0x02, 0x02, 0x84, 0x6A, 0x96, 0x00};
+
+void tud_network_init_cb(void) {
+}
+
+bool tud_network_recv_cb(const uint8_t* src, uint16_t size) {
+  (void) src;
+  (void) size;
+  bench_ncm_rx_count++;
+  _ncm_rx_pending = true;
+  return true;
+}
+
+uint16_t tud_network_xmit_cb(uint8_t* dst, void* ref, uint16_t arg) {
+  memcpy(dst, ref, arg);
+  return arg;
+}
+
+//--------------------------------------------------------------------+
+// Audio
+//--------------------------------------------------------------------+
+// keep microphone streaming: load one frame of samples for every isochronous packet
+bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in, uint8_t cur_alt_setting) {
+  (void) rhport;
+  (void) itf;
+  (void) ep_in;
+  (void) cur_alt_setting;
+  tud_audio_write(_audio_samples, CFG_TUD_AUDIO_EP_SZ_IN - CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX);
+  return true;
+}
@@ -0,0 +1,271 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Micro-benchmark of tu_fifo operations across depths, item sizes, transfer lengths and wrap positions.
+ * Host-native build times with clock_gettime() and reports ns per call, on Cortex-M (ARMv7-M or later) DWT
+ * cycle counter is used and cycles per call are reported. Mutex configuration is selected at compile time
+ * (see Makefile fifo flavors), so results of each flavor can be compared side by side.
+ *
+ *   fifo_bench [--filter=<substring>] [--json]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tusb.h"
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
+  #define FIFO_BENCH_DWT 1
+  #include "bsp/board_api.h"
+#else
+  #define FIFO_BENCH_DWT 0
+  #include <time.h>
+#endif
+
+#ifndef FIFO_BENCH_REPEAT
+#define FIFO_BENCH_REPEAT   2000
+#endif
+
+#if CFG_FIFO_MUTEX
+  #define FIFO_BENCH_FLAVOR "mutex"
+#elif CFG_TUSB_FIFO_SPSC
+  #define FIFO_BENCH_FLAVOR "spsc"
+#elif CFG_TUSB_FIFO_STATS
+  #define FIFO_BENCH_FLAVOR "stats"
+#else
+  #define FIFO_BENCH_FLAVOR "none"
+#endif
+
+//--------------------------------------------------------------------+
+// Timer
+//--------------------------------------------------------------------+
+#if FIFO_BENCH_DWT
+#define TIME_UNIT "cycles"
+
+#define DEMCR         (*(volatile uint32_t*) 0xE000EDFCu)
+#define DWT_CTRL      (*(volatile uint32_t*) 0xE0001000u)
+#define DWT_CYCCNT    (*(volatile uint32_t*) 0xE0001004u)
+
+static void timer_init(void) {
+  DEMCR |= (1u << 24); // TRCENA
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 1u;      // CYCCNTENA
+}
+
+static inline uint32_t timer_now(void) {
+  return DWT_CYCCNT;
+}
+#else
+#define TIME_UNIT "ns"
+
+static void timer_init(void) {
+}
+
+static inline uint32_t timer_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec);
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Cases
+//--------------------------------------------------------------------+
+typedef enum {
+  OP_WRITE_N = 0,
+  OP_READ_N,
+  OP_PEEK_N,
+  OP_WRITE_N_CONST_ADDR,
+  OP_READ_N_CONST_ADDR,
+  OP_WRITE_N_OVERWRITE, // write to a full overwritable fifo
+  OP_COUNT
+} fifo_op_t;
+
+static char const* const _op_name[OP_COUNT] = {
+  "write_n", "read_n", "peek_n", "write_n_const_addr", "read_n_const_addr", "write_n_overwrite"
+};
+
+static uint16_t const _depths[]     = { 64, 256, 1024, 4096 };
+static uint16_t const _item_sizes[] = { 1, 2, 4 };
+static uint16_t const _lengths[]    = { 1, 16, 64 }; // in items
+
+static uint8_t _ff_buf[4096 * 4];
+static uint8_t _data[64 * 4];
+static volatile uint32_t _reg; // fixed address register for const addr variants
+
+#if CFG_FIFO_MUTEX
+static osal_mutex_def_t _mutex_wr_def, _mutex_rd_def;
+#endif
+
+// place fifo so that the next access of n items starts at index start and holds count items
+static void fifo_setup(tu_fifo_t* ff, fifo_op_t op, uint16_t start, uint16_t n) {
+  uint16_t const depth = ff->depth;
+  if (op == OP_WRITE_N || op == OP_WRITE_N_CONST_ADDR) {
+    ff->rd_idx = start;
+    ff->wr_idx = start;
+  } else if (op == OP_WRITE_N_OVERWRITE) {
+    ff->rd_idx = start;
+    ff->wr_idx = (uint16_t) ((start + depth) % (2 * depth));
+  } else {
+    ff->rd_idx = start;
+    ff->wr_idx = (uint16_t) ((start + n) % (2 * depth));
+  }
+}
+
+static uint32_t fifo_measure(tu_fifo_t* ff, fifo_op_t op, uint16_t start, uint16_t n) {
+  uint32_t total = 0;
+
+  for (uint32_t i = 0; i < FIFO_BENCH_REPEAT; i++) {
+    fifo_setup(ff, op, start, n);
+
+    uint32_t const t0 = timer_now();
+    switch (op) {
+      case OP_WRITE_N:
+      case OP_WRITE_N_OVERWRITE:
+        tu_fifo_write_n(ff, _data, n);
+        break;
+
+      case OP_READ_N:
+        tu_fifo_read_n(ff, _data, n);
+        break;
+
+      case OP_PEEK_N:
+        tu_fifo_peek_n(ff, _data, n);
+        break;
+
+      case OP_WRITE_N_CONST_ADDR:
+        tu_fifo_write_n_const_addr_full_words(ff, (void const*) (uintptr_t) &_reg, n);
+        break;
+
+      case OP_READ_N_CONST_ADDR:
+        tu_fifo_read_n_const_addr_full_words(ff, (void*) (uintptr_t) &_reg, n);
+        break;
+
+      default: break;
+    }
+    total += timer_now() - t0;
+  }
+
+  return total;
+}
+
+int main(int argc, char* argv[]) {
+  char const* filter = NULL;
+  bool json = false;
+
+#if FIFO_BENCH_DWT
+  (void) argc;
+  (void) argv;
+  board_init();
+#else
+  for (int i = 1; i < argc; i++) {
+    if (0 == strncmp(argv[i], "--filter=", 9)) {
+      filter = argv[i] + 9;
+    } else if (0 == strcmp(argv[i], "--json")) {
+      json = true;
+    } else {
+      fprintf(stderr, "usage: %s [--filter=<substring>] [--json]\n", argv[0]);
+      return 2;
+    }
+  }
+#endif
+
+  timer_init();
+
+  // timer overhead, subtracted from all results
+  uint32_t overhead = UINT32_MAX;
+  for (uint32_t i = 0; i < FIFO_BENCH_REPEAT; i++) {
+    uint32_t const t0 = timer_now();
+    overhead = tu_min32(overhead, timer_now() - t0);
+  }
+
+  if (json) {
+    printf("{\n  \"context\": {\"mutex\": \"%s\", \"time_unit\": \"%s\"},\n  \"benchmarks\": [\n",
+           FIFO_BENCH_FLAVOR, TIME_UNIT);
+  } else {
+    printf("tu_fifo benchmark, flavor = %s, time in %s per call\n", FIFO_BENCH_FLAVOR, TIME_UNIT);
+    printf("%-48s %10s\n", "Benchmark", "Time");
+  }
+
+  bool first = true;
+  for (uint8_t op = 0; op < OP_COUNT; op++) {
+    for (size_t s = 0; s < TU_ARRAY_SIZE(_item_sizes); s++) {
+      uint16_t const item_size = _item_sizes[s];
+
+      // const addr variants transfer bytes from/to a 32-bit register
+      if ((op == OP_WRITE_N_CONST_ADDR || op == OP_READ_N_CONST_ADDR) && item_size != 1) continue;
+
+      for (size_t d = 0; d < TU_ARRAY_SIZE(_depths); d++) {
+        uint16_t const depth = _depths[d];
+
+        for (size_t l = 0; l < TU_ARRAY_SIZE(_lengths); l++) {
+          uint16_t const n = _lengths[l];
+
+          // linear access from start of buffer and access wrapped around end of buffer
+          for (uint8_t wrap = 0; wrap < 2; wrap++) {
+            if (wrap && n == 1) continue;
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s/depth:%u/item:%u/n:%u/%s", _op_name[op], depth, item_size, n,
+                     wrap ? "wrap" : "linear");
+            if (filter && !strstr(name, filter)) continue;
+
+            tu_fifo_t ff;
+            tu_fifo_config(&ff, _ff_buf, depth, item_size, op == OP_WRITE_N_OVERWRITE);
+#if CFG_FIFO_MUTEX
+            tu_fifo_config_mutex(&ff, osal_mutex_create(&_mutex_wr_def), osal_mutex_create(&_mutex_rd_def));
+#endif
+
+            uint16_t const start = wrap ? (uint16_t) (depth - n / 2) : 0;
+            uint32_t const total = fifo_measure(&ff, (fifo_op_t) op, start, n);
+            uint32_t const per_call = total / FIFO_BENCH_REPEAT;
+            uint32_t const result = per_call > overhead ? per_call - overhead : 0;
+
+            if (json) {
+              printf("%s    {\"name\": \"%s\", \"time\": %lu}", first ? "" : ",\n", name, (unsigned long) result);
+            } else {
+              printf("%-48s %10lu\n", name, (unsigned long) result);
+            }
+            first = false;
+          }
+        }
+      }
+    }
+  }
+
+  if (json) {
+    printf("\n  ]\n}\n");
+  }
+
+#if FIFO_BENCH_DWT
+  while (1) {}
+#endif
+
+  return 0;
+}
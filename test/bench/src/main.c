@@ -0,0 +1,472 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Benchmark of CPU cost per transfer of device + host stack running end-to-end over simulated controllers.
+ * All cases run both stacks in the same thread: each operation is one class-level transfer, cost includes
+ * both sides plus the (cheap) simulated bus. Output format follows Google Benchmark:
+ *
+ *   bench [--filter=<substring>] [--min_time=<seconds>] [--json]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "host/usbh_pvt.h"
+#include "bench.h"
+#include "sim_usb.h"
+
+// maximum number of task rounds without completing an operation
+#define WAIT_ROUNDS_MAX   10000
+
+// run both stacks until condition is met, fail the case if it takes too long
+#define BENCH_WAIT(_cond) \
+  do { \
+    uint32_t _rounds = 0; \
+    while (!(_cond)) { \
+      stack_task(); \
+      if (++_rounds > WAIT_ROUNDS_MAX) return false; \
+    } \
+  } while (0)
+
+static void stack_task(void) {
+  tud_task();
+  tuh_task();
+}
+
+static uint8_t _tx_buf[4096];
+static uint8_t _rx_buf[4096];
+
+//--------------------------------------------------------------------+
+// Host state
+//--------------------------------------------------------------------+
+static uint8_t _daddr;
+static uint8_t _cdc_idx = TUSB_INDEX_INVALID_8;
+static uint8_t _ncm_idx = TUSB_INDEX_INVALID_8;
+static uint8_t _hid_idx = TUSB_INDEX_INVALID_8;
+static bool _msc_mounted;
+static bool _msc_done;
+static bool _audio_mounted;
+
+static volatile uint32_t _hid_count;
+static volatile uint32_t _ncm_host_rx_count;
+static volatile uint32_t _audio_count;
+
+void tuh_mount_cb(uint8_t daddr) {
+  _daddr = daddr;
+}
+
+// simulated device never bounces, and bus time only advances in osal_task_delay(): debounce would never expire
+void tuh_enum_timing_cb(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port, tuh_enum_timing_t* timing) {
+  (void) rhport;
+  (void) hub_addr;
+  (void) hub_port;
+  timing->debounce_ms = 0;
+}
+
+void tuh_cdc_mount_cb(uint8_t idx) {
+  _cdc_idx = idx;
+}
+
+void tuh_msc_mount_cb(uint8_t daddr) {
+  (void) daddr;
+  _msc_mounted = true;
+}
+
+void tuh_hid_mount_cb(uint8_t daddr, uint8_t idx, uint8_t const* report_desc, uint16_t desc_len) {
+  (void) report_desc;
+  (void) desc_len;
+  _hid_idx = idx;
+  tuh_hid_receive_report(daddr, idx);
+}
+
+void tuh_hid_report_received_cb(uint8_t daddr, uint8_t idx, uint8_t const* report, uint16_t len) {
+  (void) report;
+  (void) len;
+  _hid_count++;
+  tuh_hid_receive_report(daddr, idx);
+}
+
+void tuh_ncm_mount_cb(uint8_t idx) {
+  _ncm_idx = idx;
+}
+
+void tuh_ncm_rx_cb(uint8_t idx, uint8_t const* frame, uint16_t len) {
+  (void) idx;
+  (void) frame;
+  (void) len;
+  _ncm_host_rx_count++;
+}
+
+static bool msc_complete_cb(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  (void) daddr;
+  _msc_done = (cb_data->csw->status == MSC_CSW_STATUS_PASSED);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Host audio streaming driver
+// There is no audio host class driver: this minimal application driver selects the streaming alternate and
+// keeps an isochronous IN transfer pending while streaming is enabled
+//--------------------------------------------------------------------+
+static struct {
+  uint8_t itf_as;
+  uint8_t alt;
+  bool streaming;
+  tusb_desc_endpoint_t desc_ep;
+  uint8_t buf[CFG_TUD_AUDIO_EP_SZ_IN];
+} _audioh;
+
+static void audioh_init(void) {
+  tu_memclr(&_audioh, sizeof(_audioh));
+}
+
+static bool audioh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+  (void) daddr;
+  TU_VERIFY(TUSB_CLASS_AUDIO == desc_itf->bInterfaceClass && AUDIO_SUBCLASS_CONTROL == desc_itf->bInterfaceSubClass);
+
+  // find isochronous endpoint of streaming interface's alternate setting
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* itf = (tusb_desc_interface_t const*) p_desc;
+      _audioh.itf_as = itf->bInterfaceNumber;
+      _audioh.alt = itf->bAlternateSetting;
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      memcpy(&_audioh.desc_ep, p_desc, sizeof(tusb_desc_endpoint_t));
+      return true;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return false;
+}
+
+static void audioh_set_itf_complete(tuh_xfer_t* xfer) {
+  TU_ASSERT(XFER_RESULT_SUCCESS == xfer->result,);
+  TU_ASSERT(tuh_edpt_open(xfer->daddr, &_audioh.desc_ep),);
+  _audio_mounted = true;
+  usbh_driver_set_config_complete(xfer->daddr, _audioh.itf_as);
+}
+
+static bool audioh_set_config(uint8_t daddr, uint8_t itf_num) {
+  (void) itf_num;
+  return tuh_interface_set(daddr, _audioh.itf_as, _audioh.alt, audioh_set_itf_complete, 0);
+}
+
+static bool audioh_xfer(uint8_t daddr) {
+  uint8_t const ep_addr = _audioh.desc_ep.bEndpointAddress;
+  TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+  if (!usbh_edpt_xfer(daddr, ep_addr, _audioh.buf, sizeof(_audioh.buf))) {
+    usbh_edpt_release(daddr, ep_addr);
+    return false;
+  }
+  return true;
+}
+
+static bool audioh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) ep_addr;
+  if (XFER_RESULT_SUCCESS == result && xferred_bytes) {
+    _audio_count++;
+  }
+  if (_audioh.streaming) {
+    audioh_xfer(daddr);
+  }
+  return true;
+}
+
+static void audioh_close(uint8_t daddr) {
+  (void) daddr;
+  _audio_mounted = false;
+  _audioh.streaming = false;
+}
+
+static usbh_class_driver_t const _audioh_driver = {
+#if CFG_TUSB_DEBUG >= CFG_TUH_LOG_LEVEL
+  .name       = "AUDIO-BENCH",
+#endif
+  .init       = audioh_init,
+  .open       = audioh_open,
+  .set_config = audioh_set_config,
+  .xfer_cb    = audioh_xfer_cb,
+  .close      = audioh_close
+};
+
+usbh_class_driver_t const* usbh_app_driver_get_cb(uint8_t* driver_count) {
+  *driver_count = 1;
+  return &_audioh_driver;
+}
+
+//--------------------------------------------------------------------+
+// Benchmark cases
+//--------------------------------------------------------------------+
+#define CDC_XFER_SIZE   512
+#define MSC_XFER_BLOCKS 8
+#define CDC_ECHO_SIZE   64
+
+// host -> device
+static bool bm_cdc_write(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    TU_VERIFY(CDC_XFER_SIZE == tuh_cdc_write(_cdc_idx, _tx_buf, CDC_XFER_SIZE));
+    tuh_cdc_write_flush(_cdc_idx);
+
+    uint32_t count = 0;
+    BENCH_WAIT((count += tud_cdc_read(_rx_buf, sizeof(_rx_buf))) >= CDC_XFER_SIZE);
+  }
+  return true;
+}
+
+// device -> host
+static bool bm_cdc_read(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    TU_VERIFY(CDC_XFER_SIZE == tud_cdc_write(_tx_buf, CDC_XFER_SIZE));
+    tud_cdc_write_flush();
+
+    uint32_t count = 0;
+    BENCH_WAIT((count += tuh_cdc_read(_cdc_idx, _rx_buf, sizeof(_rx_buf))) >= CDC_XFER_SIZE);
+  }
+  return true;
+}
+
+// host -> device -> host round trip, device echoes back what it receives
+static bool bm_cdc_echo(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    tuh_cdc_write(_cdc_idx, _tx_buf, CDC_ECHO_SIZE);
+    tuh_cdc_write_flush(_cdc_idx);
+
+    uint32_t count = 0;
+    while (count < CDC_ECHO_SIZE) {
+      uint32_t rounds = 0;
+      while (!tud_cdc_available() && !tuh_cdc_read_available(_cdc_idx)) {
+        stack_task();
+        TU_VERIFY(++rounds < WAIT_ROUNDS_MAX);
+      }
+      uint32_t const n = tud_cdc_read(_rx_buf, sizeof(_rx_buf));
+      if (n) {
+        tud_cdc_write(_rx_buf, n);
+        tud_cdc_write_flush();
+      }
+      count += tuh_cdc_read(_cdc_idx, _rx_buf, sizeof(_rx_buf));
+    }
+  }
+  return true;
+}
+
+static bool bm_msc_read10(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    _msc_done = false;
+    TU_VERIFY(tuh_msc_read10(_daddr, 0, _rx_buf, 0, MSC_XFER_BLOCKS, msc_complete_cb, 0));
+    BENCH_WAIT(_msc_done);
+  }
+  return true;
+}
+
+static bool bm_msc_write10(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    _msc_done = false;
+    TU_VERIFY(tuh_msc_write10(_daddr, 0, _tx_buf, 0, MSC_XFER_BLOCKS, msc_complete_cb, 0));
+    BENCH_WAIT(_msc_done);
+  }
+  return true;
+}
+
+static bool bm_hid_report(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t const count = _hid_count;
+    BENCH_WAIT(tud_hid_ready());
+    TU_VERIFY(tud_hid_report(0, _tx_buf, BENCH_HID_REPORT_SIZE));
+    BENCH_WAIT(_hid_count != count);
+  }
+  return true;
+}
+
+// device -> host, one frame per NTB
+static bool bm_ncm_rx(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t const count = _ncm_host_rx_count;
+    BENCH_WAIT(tud_network_can_xmit(BENCH_NET_MTU));
+    tud_network_xmit(_tx_buf, BENCH_NET_MTU);
+    BENCH_WAIT(_ncm_host_rx_count != count);
+  }
+  return true;
+}
+
+// host -> device, one frame per NTB
+static bool bm_ncm_tx(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t const count = bench_ncm_rx_count;
+    BENCH_WAIT(tuh_ncm_xmit(_ncm_idx, _tx_buf, BENCH_NET_MTU));
+    BENCH_WAIT(bench_ncm_rx_count != count);
+    bench_ncm_rx_renew();
+  }
+  return true;
+}
+
+// device -> host isochronous packets of one frame of samples
+static bool bm_audio_iso_in(uint32_t iterations) {
+  uint32_t const target = _audio_count + iterations;
+  _audioh.streaming = true;
+  if (!usbh_edpt_busy(_daddr, _audioh.desc_ep.bEndpointAddress)) {
+    TU_VERIFY(audioh_xfer(_daddr));
+  }
+
+  uint32_t rounds = 0;
+  while (_audio_count < target) {
+    stack_task();
+    TU_VERIFY(++rounds < WAIT_ROUNDS_MAX * iterations);
+  }
+  _audioh.streaming = false;
+  return true;
+}
+
+typedef struct {
+  char const* name;
+  uint32_t bytes_per_op;
+  bool (*run)(uint32_t iterations);
+} bench_case_t;
+
+static bench_case_t const _cases[] = {
+  { "BM_CDC_Write/512"    , CDC_XFER_SIZE                       , bm_cdc_write    },
+  { "BM_CDC_Read/512"     , CDC_XFER_SIZE                       , bm_cdc_read     },
+  { "BM_CDC_Echo/64"      , CDC_ECHO_SIZE                       , bm_cdc_echo     },
+  { "BM_MSC_Read10/4096"  , MSC_XFER_BLOCKS*BENCH_MSC_BLOCK_SIZE, bm_msc_read10   },
+  { "BM_MSC_Write10/4096" , MSC_XFER_BLOCKS*BENCH_MSC_BLOCK_SIZE, bm_msc_write10  },
+  { "BM_HID_Report/64"    , BENCH_HID_REPORT_SIZE               , bm_hid_report   },
+  { "BM_NCM_Rx/1514"      , BENCH_NET_MTU                       , bm_ncm_rx       },
+  { "BM_NCM_Tx/1514"      , BENCH_NET_MTU                       , bm_ncm_tx       },
+  { "BM_Audio_IsoIn/96"   , CFG_TUD_AUDIO_EP_SZ_IN - CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX, bm_audio_iso_in },
+};
+
+//--------------------------------------------------------------------+
+// Runner
+//--------------------------------------------------------------------+
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static bool enumerate(void) {
+  tud_init(BOARD_TUD_RHPORT);
+  tuh_init(BOARD_TUH_RHPORT);
+
+  uint32_t rounds = 0;
+  while (!(_cdc_idx != TUSB_INDEX_INVALID_8 && _msc_mounted && _hid_idx != TUSB_INDEX_INVALID_8 &&
+           _ncm_idx != TUSB_INDEX_INVALID_8 && _audio_mounted && tud_mounted())) {
+    stack_task();
+    if (++rounds > WAIT_ROUNDS_MAX) {
+      fprintf(stderr, "Enumeration failed: cdc %u msc %u hid %u ncm %u audio %u device %u\n",
+              _cdc_idx != TUSB_INDEX_INVALID_8, _msc_mounted, _hid_idx != TUSB_INDEX_INVALID_8,
+              _ncm_idx != TUSB_INDEX_INVALID_8, _audio_mounted, tud_mounted());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  char const* filter = NULL;
+  double min_time = 0.5;
+  bool json = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strncmp(argv[i], "--filter=", 9)) {
+      filter = argv[i] + 9;
+    } else if (0 == strncmp(argv[i], "--min_time=", 11)) {
+      min_time = atof(argv[i] + 11);
+    } else if (0 == strcmp(argv[i], "--json")) {
+      json = true;
+    } else {
+      fprintf(stderr, "usage: %s [--filter=<substring>] [--min_time=<seconds>] [--json]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  for (size_t i = 0; i < sizeof(_tx_buf); i++) {
+    _tx_buf[i] = (uint8_t) i;
+  }
+
+  if (!enumerate()) return 1;
+
+  if (json) {
+    printf("{\n  \"context\": {\"speed\": \"%s\"},\n  \"benchmarks\": [\n",
+           tud_speed_get() == TUSB_SPEED_HIGH ? "high" : "full");
+  } else {
+    printf("%-24s %14s %12s %14s\n", "Benchmark", "CPU", "Iterations", "Bytes/s");
+    printf("-------------------------------------------------------------------\n");
+  }
+
+  int ret = 0;
+  bool first = true;
+  for (size_t i = 0; i < TU_ARRAY_SIZE(_cases); i++) {
+    bench_case_t const* bc = &_cases[i];
+    if (filter && !strstr(bc->name, filter)) continue;
+
+    // warm up, then grow iterations until run is long enough to be measured
+    uint32_t iterations = 1;
+    uint64_t elapsed = 0;
+    bool ok = bc->run(iterations);
+    while (ok) {
+      uint64_t const start = cpu_time_ns();
+      ok = bc->run(iterations);
+      elapsed = cpu_time_ns() - start;
+      if (elapsed >= (uint64_t) (min_time * 1e9) || iterations >= (1u << 30)) break;
+
+      // estimate iterations needed, at most 10x each step
+      uint64_t next = elapsed ? (uint64_t) (iterations * min_time * 1.4e9 / (double) elapsed) : iterations * 10ull;
+      iterations = (uint32_t) tu_min32((uint32_t) tu_max32((uint32_t) next, iterations + 1), iterations * 10);
+    }
+
+    if (!ok) {
+      fprintf(stderr, "%s failed\n", bc->name);
+      ret = 1;
+      continue;
+    }
+
+    double const ns_per_op = (double) elapsed / iterations;
+    double const bytes_per_sec = bc->bytes_per_op * 1e9 / ns_per_op;
+
+    if (json) {
+      printf("%s    {\"name\": \"%s\", \"iterations\": %u, \"cpu_time\": %.1f, \"time_unit\": \"ns\", "
+             "\"bytes_per_second\": %.0f}", first ? "" : ",\n", bc->name, iterations, ns_per_op, bytes_per_sec);
+    } else {
+      printf("%-24s %11.0f ns %12u %12.1fM/s\n", bc->name, ns_per_op, iterations, bytes_per_sec / (1024 * 1024));
+    }
+    first = false;
+  }
+
+  if (json) {
+    printf("\n  ]\n}\n");
+  }
+
+  return ret;
+}
@@ -0,0 +1,431 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Replay of recorded host sessions against the device stack over the simulated controller. Host stack is not
+ * used: the simulated bus is driven in raw host mode with the transfers of the session, so the device stack
+ * sees the same sequence of setup packets and data as on the recorded bus e.g an MSC file copy, an OS
+ * enumerating an audio function or NCM iperf traffic. CPU time of the device stack (plus the cheap simulated
+ * bus) is reported per session and per phase.
+ *
+ *   replay [--realtime] [--repeat=<n>] [--msc_blocks=<n>] [--json] <session>...
+ *
+ * --realtime advances bus time (SOF) by the gaps between recorded transfers, otherwise transfers are replayed
+ * back to back as fast as possible. Sessions are made from USBPcap pcapng captures (Wireshark on the host, or
+ * tools/capture_to_pcapng.py from an on-target capture) by tools/pcapng_to_corpus.py --session.
+ *
+ * Session file: "TUSR", u16 version (1), u16 reserved then records of
+ *   u32 time_us, u8 type, u8 ep_addr, u16 reserved, u32 len, followed by len bytes for SETUP, OUT and PHASE
+ * all little endian. SETUP data is the 8 byte request followed by its OUT data stage if any, IN len is the
+ * number of bytes host received.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "device/dcd.h"
+#include "host/hcd.h"
+#include "bench.h"
+#include "sim_usb.h"
+
+enum {
+  REPLAY_BUS_RESET = 0,
+  REPLAY_SETUP,
+  REPLAY_OUT,
+  REPLAY_IN,
+  REPLAY_PHASE,
+};
+
+#define REPLAY_VERSION     1
+#define REPLAY_HEADER_LEN  8
+#define REPLAY_RECORD_LEN  12
+
+// host transfers are split into chunks of this size, multiple of all max packet sizes so that no short packet
+// is created in between
+#define REPLAY_CHUNK       16384
+
+#define PHASE_MAX          16
+#define SESSION_MAX        16
+#define PHASE_NAME_LEN     32
+
+typedef struct {
+  char name[PHASE_NAME_LEN];
+  uint32_t records;
+  uint32_t xfers;    // completed transfers including control
+  uint32_t stalls;
+  uint32_t naks;     // transfers device never answered, aborted
+  uint64_t bytes;    // data bytes both directions
+  uint64_t cpu_ns;
+} replay_phase_t;
+
+static struct {
+  bool realtime;
+  uint32_t repeat;
+  bool json;
+} _opt = { false, 1, false };
+
+static struct {
+  char const* name;
+  uint64_t cpu_ns;
+} _session[SESSION_MAX];
+
+static replay_phase_t _phase[PHASE_MAX];
+static uint8_t _phase_count;
+static replay_phase_t* _cur_phase;
+static uint64_t _phase_start_ns;
+
+static uint8_t _buf[REPLAY_CHUNK];
+
+// completion of raw host transfers
+static struct {
+  volatile bool done;
+  uint32_t len;
+  uint8_t result;
+} _xfer[TUP_DCD_ENDPOINT_MAX][2];
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t get_u32(uint8_t const* p) {
+  return tu_le32toh(tu_unaligned_read32(p));
+}
+
+//--------------------------------------------------------------------+
+// Phase accounting
+//--------------------------------------------------------------------+
+static void phase_switch(char const* name, uint32_t len) {
+  uint64_t const now = cpu_time_ns();
+  if (_cur_phase) _cur_phase->cpu_ns += now - _phase_start_ns;
+
+  char pname[PHASE_NAME_LEN];
+  len = tu_min32(len, PHASE_NAME_LEN - 1);
+  memcpy(pname, name, len);
+  pname[len] = 0;
+
+  // same phase name across repeats and sessions is accumulated
+  _cur_phase = NULL;
+  for (uint8_t i = 0; i < _phase_count; i++) {
+    if (0 == strcmp(_phase[i].name, pname)) _cur_phase = &_phase[i];
+  }
+  if (!_cur_phase) {
+    _cur_phase = &_phase[tu_min8(_phase_count, PHASE_MAX - 1)];
+    if (_phase_count < PHASE_MAX) _phase_count++;
+    memset(_cur_phase, 0, sizeof(replay_phase_t));
+    memcpy(_cur_phase->name, pname, len + 1);
+  }
+
+  _phase_start_ns = cpu_time_ns();
+}
+
+static void phase_end(void) {
+  if (_cur_phase) _cur_phase->cpu_ns += cpu_time_ns() - _phase_start_ns;
+  _cur_phase = NULL;
+}
+
+//--------------------------------------------------------------------+
+// Raw host
+//--------------------------------------------------------------------+
+static void host_xfer_cb(uint8_t ep_addr, uint32_t len, uint8_t result) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  _xfer[epnum][dir].len = len;
+  _xfer[epnum][dir].result = result;
+  _xfer[epnum][dir].done = true;
+}
+
+// run device until transfer on endpoint completes. Device stack is event driven: once there is no event left
+// and endpoint is still not armed, it would NAK forever.
+static bool host_xfer_wait(uint8_t ep_addr) {
+  volatile bool* done = &_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].done;
+  while (!*done) {
+    bench_ncm_rx_renew();
+    if (*done) break;
+    if (!tud_task_event_ready()) {
+      hcd_edpt_abort_xfer(BOARD_TUH_RHPORT, 0, ep_addr);
+      _cur_phase->naks++;
+      return false;
+    }
+    tud_task();
+  }
+  return true;
+}
+
+// carry out a host transfer of any length, return false if stalled or not answered
+static bool host_xfer(uint8_t ep_addr, uint8_t const* data, uint32_t len) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  uint32_t offset = 0;
+
+  do {
+    uint16_t const chunk = (uint16_t) tu_min32(len - offset, REPLAY_CHUNK);
+    if (dir == TUSB_DIR_OUT && chunk) {
+      // data may be truncated in the capture, rest is zero
+      memset(_buf, 0, chunk);
+      if (data) memcpy(_buf, data + offset, chunk);
+    }
+
+    _xfer[epnum][dir].done = false;
+    hcd_edpt_xfer(BOARD_TUH_RHPORT, 0, ep_addr, _buf, chunk);
+    if (!host_xfer_wait(ep_addr)) return false;
+
+    uint32_t const xferred = _xfer[epnum][dir].len;
+    _cur_phase->bytes += xferred;
+    if (_xfer[epnum][dir].result != XFER_RESULT_SUCCESS) {
+      _cur_phase->stalls++;
+      return false;
+    }
+
+    offset += chunk;
+    if (xferred < chunk) break; // short packet ends the transfer
+  } while (offset < len);
+
+  return true;
+}
+
+static void control_xfer(uint8_t const* data, uint32_t len) {
+  if (len < 8) return;
+  tusb_control_request_t request;
+  memcpy(&request, data, 8);
+  uint16_t const wLength = tu_le16toh(request.wLength);
+  bool const dir_in = (request.bmRequestType_bit.direction == TUSB_DIR_IN);
+
+  hcd_setup_send(BOARD_TUH_RHPORT, 0, data);
+
+  // data stage
+  if (wLength) {
+    if (!host_xfer(dir_in ? 0x80 : 0x00, dir_in ? NULL : data + 8, dir_in ? wLength : tu_min32(wLength, len - 8))) {
+      return;
+    }
+  }
+
+  // status stage: zero length packet in opposite direction
+  if (host_xfer((wLength && dir_in) ? 0x00 : 0x80, NULL, 0)) {
+    _cur_phase->xfers++;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Session
+//--------------------------------------------------------------------+
+static uint8_t* load_file(char const* path, size_t* size) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  long const fsize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t* buf = (fsize > 0) ? malloc((size_t) fsize) : NULL;
+  if (buf && fread(buf, 1, (size_t) fsize, f) != (size_t) fsize) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+
+  *size = (size_t) fsize;
+  return buf;
+}
+
+static bool replay_session(uint8_t const* session, size_t size) {
+  TU_VERIFY(size >= REPLAY_HEADER_LEN && 0 == memcmp(session, "TUSR", 4) &&
+            tu_le16toh(tu_unaligned_read16(session + 4)) == REPLAY_VERSION);
+
+  phase_switch("session", 7);
+
+  uint32_t last_us = 0;
+  uint32_t frame_us = 0; // bus time not yet advanced
+  size_t pos = REPLAY_HEADER_LEN;
+
+  while (pos + REPLAY_RECORD_LEN <= size) {
+    uint8_t const* rec = session + pos;
+    uint32_t const time_us = get_u32(rec);
+    uint8_t const type = rec[4];
+    uint8_t const ep_addr = rec[5];
+    uint32_t const len = get_u32(rec + 8);
+    uint8_t const* data = rec + REPLAY_RECORD_LEN;
+    uint32_t const data_len = (type == REPLAY_IN) ? 0 : len;
+
+    TU_VERIFY(pos + REPLAY_RECORD_LEN + data_len <= size);
+    pos += REPLAY_RECORD_LEN + data_len;
+
+    if (type == REPLAY_PHASE) {
+      phase_switch((char const*) data, len);
+      continue;
+    }
+    _cur_phase->records++;
+
+    if (_opt.realtime) {
+      // bus time between recorded transfers: SOF and device task keep running as on hardware
+      frame_us += time_us - last_us;
+      while (frame_us >= 1000) {
+        frame_us -= 1000;
+        sim_usb_frame_advance(1);
+        tud_task();
+      }
+    }
+    last_us = time_us;
+
+    switch (type) {
+      case REPLAY_BUS_RESET:
+        hcd_port_reset(BOARD_TUH_RHPORT);
+        while (tud_task_event_ready()) tud_task();
+        break;
+
+      case REPLAY_SETUP:
+        control_xfer(data, len);
+        break;
+
+      case REPLAY_OUT:
+      case REPLAY_IN:
+        if (tu_edpt_number(ep_addr) < TUP_DCD_ENDPOINT_MAX &&
+            host_xfer(ep_addr, (type == REPLAY_OUT) ? data : NULL, len)) {
+          _cur_phase->xfers++;
+        }
+        break;
+
+      default: break;
+    }
+  }
+
+  phase_end();
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Host stack is linked but not used
+//--------------------------------------------------------------------+
+void tuh_hid_report_received_cb(uint8_t daddr, uint8_t idx, uint8_t const* report, uint16_t len) {
+}
+
+//--------------------------------------------------------------------+
+// Main
+//--------------------------------------------------------------------+
+static void print_report(void) {
+  if (_opt.json) {
+    printf("{\n  \"context\": {\"realtime\": %s, \"repeat\": %u},\n  \"phases\": [\n",
+           _opt.realtime ? "true" : "false", _opt.repeat);
+  } else {
+    printf("%-20s %12s %10s %10s %14s %10s %6s %6s\n", "Phase", "CPU", "Records", "Xfers", "Bytes", "Bytes/s",
+           "Stall", "NAK");
+    printf("------------------------------------------------------------------------------------------------\n");
+  }
+
+  bool first = true;
+  for (uint8_t i = 0; i < _phase_count; i++) {
+    replay_phase_t const* p = &_phase[i];
+    if (p->records == 0) continue; // e.g implicit phase of session starting with a named one
+    double const cpu_ns = (double) p->cpu_ns / _opt.repeat;
+    double const bytes_per_sec = cpu_ns > 0 ? ((double) p->bytes / _opt.repeat) * 1e9 / cpu_ns : 0;
+
+    if (_opt.json) {
+      printf("%s    {\"name\": \"%s\", \"cpu_time\": %.0f, \"time_unit\": \"ns\", \"records\": %u, \"xfers\": %u, "
+             "\"bytes\": %llu, \"bytes_per_second\": %.0f, \"stalls\": %u, \"naks\": %u}", first ? "" : ",\n", p->name,
+             cpu_ns, p->records / _opt.repeat, p->xfers / _opt.repeat, (unsigned long long) p->bytes / _opt.repeat,
+             bytes_per_sec, p->stalls / _opt.repeat, p->naks / _opt.repeat);
+      first = false;
+    } else {
+      printf("%-20s %9.3f ms %10u %10u %14llu %8.1fM/s %6u %6u\n", p->name, cpu_ns / 1e6, p->records / _opt.repeat,
+             p->xfers / _opt.repeat, (unsigned long long) p->bytes / _opt.repeat, bytes_per_sec / (1024 * 1024),
+             p->stalls / _opt.repeat, p->naks / _opt.repeat);
+    }
+  }
+
+  if (_opt.json) {
+    printf("\n  ],\n  \"sessions\": [\n");
+  } else {
+    printf("\n%-20s %12s\n", "Session", "CPU");
+  }
+
+  for (uint8_t i = 0; i < SESSION_MAX && _session[i].name; i++) {
+    double const cpu_ns = (double) _session[i].cpu_ns / _opt.repeat;
+    if (_opt.json) {
+      printf("%s    {\"name\": \"%s\", \"cpu_time\": %.0f, \"time_unit\": \"ns\"}", i ? ",\n" : "",
+             _session[i].name, cpu_ns);
+    } else {
+      printf("%-20s %9.3f ms\n", _session[i].name, cpu_ns / 1e6);
+    }
+  }
+
+  if (_opt.json) printf("\n  ]\n}\n");
+}
+
+int main(int argc, char* argv[]) {
+  int nsession = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--realtime")) {
+      _opt.realtime = true;
+    } else if (0 == strncmp(argv[i], "--repeat=", 9)) {
+      _opt.repeat = (uint32_t) tu_max32((uint32_t) strtoul(argv[i] + 9, NULL, 0), 1);
+    } else if (0 == strncmp(argv[i], "--msc_blocks=", 13)) {
+      bench_msc_block_count = (uint32_t) strtoul(argv[i] + 13, NULL, 0);
+    } else if (0 == strcmp(argv[i], "--json")) {
+      _opt.json = true;
+    } else if (argv[i][0] == '-') {
+      nsession = 0;
+      break;
+    } else if (nsession < SESSION_MAX) {
+      _session[nsession++].name = argv[i];
+    }
+  }
+
+  if (nsession == 0) {
+    fprintf(stderr, "usage: %s [--realtime] [--repeat=<n>] [--msc_blocks=<n>] [--json] <session>...\n", argv[0]);
+    return 2;
+  }
+
+  sim_usb_host_raw(host_xfer_cb);
+  tud_init(BOARD_TUD_RHPORT);
+
+  for (int s = 0; s < nsession; s++) {
+    size_t size;
+    uint8_t* session = load_file(_session[s].name, &size);
+    if (!session) {
+      fprintf(stderr, "%s: cannot read\n", _session[s].name);
+      return 1;
+    }
+
+    uint64_t const start_ns = cpu_time_ns();
+    for (uint32_t r = 0; r < _opt.repeat; r++) {
+      if (!replay_session(session, size)) {
+        fprintf(stderr, "%s: invalid session\n", _session[s].name);
+        free(session);
+        return 1;
+      }
+    }
+    _session[s].cpu_ns = cpu_time_ns() - start_ns;
+    free(session);
+  }
+
+  print_report();
+  return 0;
+}
@@ -0,0 +1,448 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Simulated controller pair: a virtual DCD wired to a virtual HCD in the same process.
+ *
+ * Device stack runs on rhport BOARD_TUD_RHPORT, host stack on BOARD_TUH_RHPORT with the device attached
+ * directly to its root port. A transfer is carried out as soon as both sides have armed the same endpoint,
+ * packet by packet with endpoint's max packet size: the sender completes when all its bytes are sent,
+ * the receiver completes when its buffer is full or a short packet is received. Completion events are
+ * queued as if raised from interrupt, so all class driver code runs in tud_task() / tuh_task() as on
+ * hardware. Time only advances with osal_task_delay() or sim_usb_frame_advance(), which makes runs
+ * deterministic.
+ */
+
+#include "tusb.h"
+#include "device/dcd.h"
+#include "host/hcd.h"
+#include "sim_usb.h"
+
+typedef struct {
+  uint8_t* buffer;
+  tu_fifo_t* ff;
+  uint16_t total_len;
+  uint16_t actual_len;
+  uint16_t mps;
+  uint8_t daddr;   // host side only
+  bool opened;
+  bool active;
+  bool stalled;    // device side only
+} sim_edpt_t;
+
+typedef struct {
+  bool dcd_int_en;
+  bool hcd_int_en;
+  bool connected;   // device pull-up enabled
+  bool attached;    // attach event is sent to host
+  uint8_t dev_addr;
+  uint32_t frame;
+
+  sim_edpt_t dev_ep[TUP_DCD_ENDPOINT_MAX][2];
+  sim_edpt_t host_ep[TUP_DCD_ENDPOINT_MAX][2];
+
+  sim_usb_stats_t stats;
+  sim_usb_host_xfer_cb_t raw_xfer_cb;
+} sim_usb_t;
+
+static sim_usb_t _sim;
+
+static void host_xfer_complete(uint8_t daddr, uint8_t ep_addr, uint32_t len, xfer_result_t result) {
+  if (_sim.raw_xfer_cb) {
+    _sim.raw_xfer_cb(ep_addr, len, (uint8_t) result);
+  } else {
+    hcd_event_xfer_complete(daddr, ep_addr, len, result, true);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Bus engine
+//--------------------------------------------------------------------+
+
+// copy one packet from sender to receiver, device side may use a fifo
+static void packet_copy(sim_edpt_t* dev, sim_edpt_t* host, uint8_t dir, uint16_t len) {
+  if (len == 0) return;
+
+  if (dir == TUSB_DIR_IN) {
+    uint8_t* dst = host->buffer + host->actual_len;
+    if (dev->ff) {
+      tu_fifo_read_n(dev->ff, dst, len);
+    } else {
+      memcpy(dst, dev->buffer + dev->actual_len, len);
+    }
+  } else {
+    uint8_t const* src = host->buffer + host->actual_len;
+    if (dev->ff) {
+      tu_fifo_write_n(dev->ff, src, len);
+    } else {
+      memcpy(dev->buffer + dev->actual_len, src, len);
+    }
+  }
+}
+
+// carry out transfer on an endpoint if both sides are armed
+static void bus_service(uint8_t epnum, uint8_t dir) {
+  sim_edpt_t* dev = &_sim.dev_ep[epnum][dir];
+  sim_edpt_t* host = &_sim.host_ep[epnum][dir];
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+
+  if (!host->active || !_sim.connected) return;
+
+  if (dev->stalled) {
+    host->active = false;
+    host_xfer_complete(host->daddr, ep_addr, host->actual_len, XFER_RESULT_STALLED);
+    return;
+  }
+
+  if (!dev->active) return; // NAK
+
+  sim_edpt_t* sender = (dir == TUSB_DIR_IN) ? dev : host;
+  sim_edpt_t* receiver = (dir == TUSB_DIR_IN) ? host : dev;
+  uint16_t const mps = dev->mps ? dev->mps : CFG_TUD_ENDPOINT0_SIZE;
+  bool sender_done, receiver_done;
+
+  do {
+    uint16_t pkt_len = tu_min16(mps, (uint16_t) (sender->total_len - sender->actual_len));
+    bool const short_pkt = pkt_len < mps;
+
+    // babble: receiver only takes what fits its buffer
+    pkt_len = tu_min16(pkt_len, (uint16_t) (receiver->total_len - receiver->actual_len));
+
+    packet_copy(dev, host, dir, pkt_len);
+    sender->actual_len += pkt_len;
+    receiver->actual_len += pkt_len;
+    _sim.stats.packets++;
+    _sim.stats.bytes += pkt_len;
+
+    sender_done = short_pkt || (sender->actual_len == sender->total_len);
+    receiver_done = short_pkt || (receiver->actual_len == receiver->total_len);
+  } while (!sender_done && !receiver_done);
+
+  if (sender_done) sender->active = false;
+  if (receiver_done) receiver->active = false;
+
+  if (!dev->active) {
+    dcd_event_xfer_complete(BOARD_TUD_RHPORT, ep_addr, dev->actual_len, XFER_RESULT_SUCCESS, true);
+  }
+
+  if (!host->active) {
+    _sim.stats.xfers++;
+    host_xfer_complete(host->daddr, ep_addr, host->actual_len, XFER_RESULT_SUCCESS);
+  }
+}
+
+static void edpt_arm(sim_edpt_t* ep, uint8_t* buffer, tu_fifo_t* ff, uint16_t total_bytes) {
+  ep->buffer = buffer;
+  ep->ff = ff;
+  ep->total_len = total_bytes;
+  ep->actual_len = 0;
+  ep->active = true;
+}
+
+static void port_update(void) {
+  bool const attach = _sim.connected && _sim.hcd_int_en;
+  if (attach != _sim.attached) {
+    _sim.attached = attach;
+    if (attach) {
+      hcd_event_device_attach(BOARD_TUH_RHPORT, true);
+    } else {
+      hcd_event_device_remove(BOARD_TUH_RHPORT, true);
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Simulation API
+//--------------------------------------------------------------------+
+void sim_usb_frame_advance(uint32_t count) {
+  while (count--) {
+    _sim.frame++;
+    if (_sim.dcd_int_en) dcd_event_sof(BOARD_TUD_RHPORT, _sim.frame & 0x7FF, true);
+  }
+}
+
+uint32_t sim_usb_frame(void) {
+  return _sim.frame;
+}
+
+void sim_usb_stats_get(sim_usb_stats_t* stats) {
+  *stats = _sim.stats;
+}
+
+void sim_usb_host_raw(sim_usb_host_xfer_cb_t xfer_cb) {
+  _sim.raw_xfer_cb = xfer_cb;
+}
+
+// OS NONE delay used by host enumeration: advance virtual time instead of spinning. Device is another
+// MCU running concurrently on real hardware, let its task run meanwhile e.g to complete bus reset.
+void osal_task_delay(uint32_t msec) {
+  while (msec--) {
+    sim_usb_frame_advance(1);
+    tud_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device Controller
+//--------------------------------------------------------------------+
+void dcd_init(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(_sim.dev_ep, sizeof(_sim.dev_ep));
+  _sim.dev_addr = 0;
+  dcd_connect(rhport);
+}
+
+void dcd_int_handler(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+  _sim.dcd_int_en = true;
+}
+
+void dcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+  _sim.dcd_int_en = false;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
+  _sim.dev_addr = dev_addr;
+  // Response with status first before changing device address
+  dcd_edpt_xfer(rhport, tu_edpt_addr(0, TUSB_DIR_IN), NULL, 0);
+}
+
+void dcd_remote_wakeup(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_connect(uint8_t rhport) {
+  (void) rhport;
+  _sim.connected = true;
+  port_update();
+}
+
+void dcd_disconnect(uint8_t rhport) {
+  (void) rhport;
+  _sim.connected = false;
+  port_update();
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en) {
+  (void) rhport;
+  (void) en;
+  // SOF is generated by sim_usb_frame_advance() regardless, usbd filters it out
+}
+
+void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request_t const* request) {
+  (void) rhport;
+  (void) request;
+}
+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+  uint8_t const dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+  TU_ASSERT(epnum < TUP_DCD_ENDPOINT_MAX);
+
+  sim_edpt_t* ep = &_sim.dev_ep[epnum][dir];
+  tu_memclr(ep, sizeof(sim_edpt_t));
+  ep->mps = tu_edpt_packet_size(desc_ep);
+  ep->opened = true;
+
+  return true;
+}
+
+void dcd_edpt_close_all(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(&_sim.dev_ep[1], sizeof(_sim.dev_ep) - sizeof(_sim.dev_ep[0]));
+}
+
+void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  tu_memclr(&_sim.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], sizeof(sim_edpt_t));
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  edpt_arm(&_sim.dev_ep[epnum][dir], buffer, NULL, total_bytes);
+  bus_service(epnum, dir);
+
+  return true;
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  edpt_arm(&_sim.dev_ep[epnum][dir], NULL, ff, total_bytes);
+  bus_service(epnum, dir);
+
+  return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  sim_edpt_t* ep = &_sim.dev_ep[epnum][dir];
+  ep->active = false;
+  ep->stalled = true;
+  bus_service(epnum, dir);
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  _sim.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stalled = false;
+}
+
+//--------------------------------------------------------------------+
+// Host Controller
+//--------------------------------------------------------------------+
+bool hcd_init(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(_sim.host_ep, sizeof(_sim.host_ep));
+  return true;
+}
+
+void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  (void) rhport;
+  (void) in_isr;
+}
+
+void hcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+  _sim.hcd_int_en = true;
+  port_update();
+}
+
+void hcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+  _sim.hcd_int_en = false;
+}
+
+uint32_t hcd_frame_number(uint8_t rhport) {
+  (void) rhport;
+  return _sim.frame;
+}
+
+bool hcd_port_connect_status(uint8_t rhport) {
+  (void) rhport;
+  return _sim.connected;
+}
+
+void hcd_port_reset(uint8_t rhport) {
+  (void) rhport;
+
+  // device loses its address and all endpoints
+  tu_memclr(_sim.dev_ep, sizeof(_sim.dev_ep));
+  _sim.dev_addr = 0;
+  dcd_event_bus_reset(BOARD_TUD_RHPORT, hcd_port_speed_get(rhport), true);
+}
+
+void hcd_port_reset_end(uint8_t rhport) {
+  (void) rhport;
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport) {
+  (void) rhport;
+  return (TUD_OPT_HIGH_SPEED && TUH_OPT_HIGH_SPEED) ? TUSB_SPEED_HIGH : TUSB_SPEED_FULL;
+}
+
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
+  (void) rhport;
+  for (uint8_t epnum = 0; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      if (_sim.host_ep[epnum][dir].daddr == dev_addr) {
+        tu_memclr(&_sim.host_ep[epnum][dir], sizeof(sim_edpt_t));
+      }
+    }
+  }
+}
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const* ep_desc) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_desc->bEndpointAddress);
+  uint8_t const dir = tu_edpt_dir(ep_desc->bEndpointAddress);
+  TU_ASSERT(epnum < TUP_DCD_ENDPOINT_MAX);
+
+  // only one device is attached, control endpoint is shared between address 0 and assigned address
+  sim_edpt_t* ep = &_sim.host_ep[epnum][dir];
+  tu_memclr(ep, sizeof(sim_edpt_t));
+  ep->mps = tu_edpt_packet_size(ep_desc);
+  ep->daddr = daddr;
+  ep->opened = true;
+
+  return true;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t buflen) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  sim_edpt_t* ep = &_sim.host_ep[epnum][dir];
+  ep->daddr = daddr;
+  edpt_arm(ep, buffer, NULL, buflen);
+  bus_service(epnum, dir);
+
+  return true;
+}
+
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) dev_addr;
+  sim_edpt_t* ep = &_sim.host_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  bool const ret = ep->active;
+  ep->active = false;
+  return ret;
+}
+
+bool hcd_setup_send(uint8_t rhport, uint8_t daddr, uint8_t const setup_packet[8]) {
+  (void) rhport;
+
+  // SETUP cancels any pending control transfer and clears stall on both sides
+  _sim.dev_ep[0][TUSB_DIR_OUT].active = _sim.dev_ep[0][TUSB_DIR_IN].active = false;
+  _sim.dev_ep[0][TUSB_DIR_OUT].stalled = _sim.dev_ep[0][TUSB_DIR_IN].stalled = false;
+  _sim.host_ep[0][TUSB_DIR_OUT].active = _sim.host_ep[0][TUSB_DIR_IN].active = false;
+
+  _sim.stats.packets++;
+  dcd_event_setup_received(BOARD_TUD_RHPORT, setup_packet, true);
+  host_xfer_complete(daddr, 0, 8, XFER_RESULT_SUCCESS);
+
+  return true;
+}
+
+bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) dev_addr;
+  (void) ep_addr;
+  return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef SIM_USB_H_
+#define SIM_USB_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+typedef struct {
+  uint32_t xfers;    // completed host transfers
+  uint32_t packets;  // data and setup packets
+  uint64_t bytes;    // data bytes on the bus
+} sim_usb_stats_t;
+
+// Advance bus time by count frames, generating SOF to device
+void sim_usb_frame_advance(uint32_t count);
+
+// Current frame number
+uint32_t sim_usb_frame(void);
+
+// Get bus statistics since start
+void sim_usb_stats_get(sim_usb_stats_t* stats);
+
+// Raw host mode: host stack is not used, bus is driven by calling hcd_port_reset(), hcd_setup_send() and
+// hcd_edpt_xfer() directly e.g to replay a recorded session. Completions of these are reported to xfer_cb
+// (result is xfer_result_t) instead of host stack events.
+typedef void (*sim_usb_host_xfer_cb_t)(uint8_t ep_addr, uint32_t len, uint8_t result);
+void sim_usb_host_raw(sim_usb_host_xfer_cb_t xfer_cb);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
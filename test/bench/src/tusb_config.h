@@ -0,0 +1,141 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Simulated Controller Configuration
+//--------------------------------------------------------------------+
+
+// Both stacks run in the same process: device on rhport 0, host on rhport 1 wired by sim_usb.c
+#define BOARD_TUD_RHPORT      0
+#define BOARD_TUH_RHPORT      1
+
+#ifndef CFG_TUSB_MCU
+#define CFG_TUSB_MCU          OPT_MCU_NONE
+#endif
+
+// properties of simulated controller
+#define TUP_DCD_ENDPOINT_MAX  16
+#define TUP_RHPORT_HIGHSPEED  1
+
+#ifndef BENCH_MAX_SPEED
+#define BENCH_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#endif
+
+//--------------------------------------------------------------------
+// Common Configuration
+//--------------------------------------------------------------------
+
+#define CFG_TUSB_OS           OPT_OS_NONE
+
+#ifndef CFG_TUSB_DEBUG
+#define CFG_TUSB_DEBUG        0
+#endif
+
+#define CFG_TUSB_MEM_SECTION
+#define CFG_TUSB_MEM_ALIGN    __attribute__ ((aligned(4)))
+
+#define CFG_TUD_ENABLED       1
+#define CFG_TUD_MAX_SPEED     BENCH_MAX_SPEED
+
+#define CFG_TUH_ENABLED       1
+#define CFG_TUH_MAX_SPEED     BENCH_MAX_SPEED
+
+//--------------------------------------------------------------------
+// DEVICE CONFIGURATION
+//--------------------------------------------------------------------
+
+#define CFG_TUD_ENDPOINT0_SIZE    64
+
+//------------- CLASS -------------//
+#define CFG_TUD_CDC               1
+#define CFG_TUD_MSC               1
+#define CFG_TUD_HID               1
+#define CFG_TUD_NCM               1
+#define CFG_TUD_AUDIO             1
+
+// CDC FIFO size of TX and RX
+#define CFG_TUD_CDC_RX_BUFSIZE    2048
+#define CFG_TUD_CDC_TX_BUFSIZE    2048
+#define CFG_TUD_CDC_EP_BUFSIZE    512
+
+// MSC Buffer size of Device Mass storage
+#define CFG_TUD_MSC_EP_BUFSIZE    4096
+
+// HID buffer size Should be sufficient to hold ID (if any) + Data
+#define CFG_TUD_HID_EP_BUFSIZE    64
+
+// NCM
+#define CFG_TUD_NCM_IN_NTB_MAX_SIZE   3200
+#define CFG_TUD_NCM_OUT_NTB_MAX_SIZE  3200
+
+// AUDIO: one channel microphone, 48 kHz 16-bit
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN            TUD_AUDIO_MIC_ONE_CH_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT            1
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ         64
+
+#define CFG_TUD_AUDIO_ENABLE_EP_IN               1
+#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX  2
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX       1
+#define CFG_TUD_AUDIO_EP_SZ_IN                   ((48 + 1) * CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX)
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX        CFG_TUD_AUDIO_EP_SZ_IN
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ     (4 * CFG_TUD_AUDIO_EP_SZ_IN)
+
+//--------------------------------------------------------------------
+// HOST CONFIGURATION
+//--------------------------------------------------------------------
+
+// Size of buffer to hold descriptors and other data used for enumeration
+#define CFG_TUH_ENUMERATION_BUFSIZE 512
+
+#define CFG_TUH_HUB                 0
+#define CFG_TUH_DEVICE_MAX          1
+
+#define CFG_TUH_CDC                 1
+#define CFG_TUH_HID                 1
+#define CFG_TUH_MSC                 1
+#define CFG_TUH_NCM                 1
+
+#define CFG_TUH_CDC_RX_BUFSIZE      2048
+#define CFG_TUH_CDC_TX_BUFSIZE      2048
+
+#define CFG_TUH_HID_EPIN_BUFSIZE    64
+#define CFG_TUH_HID_EPOUT_BUFSIZE   64
+
+#define CFG_TUH_NCM_RX_BUFSIZE      CFG_TUD_NCM_IN_NTB_MAX_SIZE
+#define CFG_TUH_NCM_TX_BUFSIZE      CFG_TUD_NCM_OUT_NTB_MAX_SIZE
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_CONFIG_H_ */
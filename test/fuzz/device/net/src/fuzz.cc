@@ -54,16 +54,20 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
   fuzz_init(callback_data.data(), callback_data.size());
   // init device stack on configured roothub port
   tud_init(BOARD_TUD_RHPORT);
+  fuzz_perf_input_begin();
 
   for (int i = 0; i < FUZZ_ITERATIONS; i++) {
     if (provider.remaining_bytes() == 0) {
-      return 0;
+      break;
     }
     tud_int_handler(provider.ConsumeIntegral<uint8_t>());
+    fuzz_perf_task_begin();
     tud_task(); // tinyusb device task
+    fuzz_perf_task_end();
     net_task(&provider);
   }
 
+  fuzz_perf_input_end();
   return 0;
 }
 
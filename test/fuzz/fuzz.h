@@ -24,6 +24,7 @@
  */
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -32,6 +33,16 @@ extern "C" {
 
 int fuzz_init(const uint8_t *data, size_t size);
 
+// Performance mode (make PERF=1): work done by the stack for each input is accounted and the input is
+// reported as a crash when it exceeds a budget, see fuzz_perf.cc. These are no-op otherwise.
+void fuzz_perf_input_begin(void);
+void fuzz_perf_input_end(void);
+void fuzz_perf_task_begin(void);
+void fuzz_perf_task_end(void);
+
+// CFG_TUSB_TRACE_SINK() in performance mode
+void fuzz_perf_trace_sink(void const *record);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,212 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Performance mode of the fuzz harnesses: instead of only crashes, flag inputs that make the stack do an
+// excessive amount of work e.g long descriptor walks in process_set_config(), NTB parsing or audio entity
+// lookups, or that saturate the event queue. Built with CFG_TUSB_TRACE and this file as trace sink, work is
+// counted per tud_task() call and per input. When a budget is exceeded, the counters are printed and the
+// harness aborts so that libFuzzer saves the offending input. Budgets can be changed with environment
+// variables, 0 disables a check:
+//   FUZZ_PERF_TASK_EVENTS  events dispatched by a single tud_task() call (default 64)
+//   FUZZ_PERF_TASK_US      wall time of a single tud_task() call in us (default 0, sanitizers make it noisy)
+//   FUZZ_PERF_INPUT_BYTES  bytes queued to endpoints for one input (default 4 MB)
+//   FUZZ_PERF_QUEUE_FULL   1 to flag inputs filling up the event queue (default 1)
+
+#include "fuzz/fuzz.h"
+
+#ifdef FUZZ_PERF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tusb.h"
+
+#ifndef CFG_TUD_TASK_QUEUE_SZ
+  #define CFG_TUD_TASK_QUEUE_SZ   16
+#endif
+
+namespace {
+
+struct Budget {
+  uint32_t task_events;
+  uint32_t task_us;
+  uint64_t input_bytes;
+  uint32_t queue_full;
+};
+
+struct Counter {
+  // per tud_task() call
+  uint32_t task_events;
+  uint64_t task_start_ns;
+
+  // per input
+  uint32_t tasks;
+  uint32_t events;
+  uint32_t xfer_cb;
+  uint32_t edpt_xfer;
+  uint64_t xfer_bytes;
+  uint32_t task_events_max;
+  uint64_t task_us_max;
+  uint16_t queue_max;
+};
+
+Budget budget;
+Counter counter;
+Counter worst; // input with the longest tud_task() call so far
+bool in_input = false;
+
+uint32_t env_u32(const char *name, uint32_t default_value) {
+  const char *s = getenv(name);
+  return s ? (uint32_t)strtoul(s, NULL, 0) : default_value;
+}
+
+uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void print_counter(const char *title, Counter const *c) {
+  fprintf(stderr,
+          "%s: tasks %u, events %u, xfer_cb %u, edpt_xfer %u (%llu bytes), "
+          "max events/task %u, max task %llu us, max queue depth %u/%u\n",
+          title, c->tasks, c->events, c->xfer_cb, c->edpt_xfer, (unsigned long long)c->xfer_bytes,
+          c->task_events_max, (unsigned long long)c->task_us_max, c->queue_max, CFG_TUD_TASK_QUEUE_SZ);
+}
+
+void print_worst(void) {
+  print_counter("fuzz perf: worst input", &worst);
+}
+
+[[noreturn]] void over_budget(const char *what, unsigned long long value, unsigned long long limit) {
+  fprintf(stderr, "==fuzz perf== %s %llu exceeds budget %llu\n", what, value, limit);
+  print_counter("fuzz perf: this input", &counter);
+  abort();
+}
+
+} // namespace
+
+extern "C" {
+
+void fuzz_perf_input_begin(void) {
+  static bool initialized = false;
+  if (!initialized) {
+    initialized = true;
+    budget.task_events = env_u32("FUZZ_PERF_TASK_EVENTS", 64);
+    budget.task_us = env_u32("FUZZ_PERF_TASK_US", 0);
+    budget.input_bytes = env_u32("FUZZ_PERF_INPUT_BYTES", 4u * 1024 * 1024);
+    budget.queue_full = env_u32("FUZZ_PERF_QUEUE_FULL", 1);
+    atexit(print_worst);
+  }
+
+  counter = Counter();
+  in_input = true;
+}
+
+void fuzz_perf_input_end(void) {
+  in_input = false;
+  if (counter.task_us_max >= worst.task_us_max) {
+    worst = counter;
+  }
+}
+
+void fuzz_perf_task_begin(void) {
+  counter.task_events = 0;
+  counter.task_start_ns = now_ns();
+}
+
+void fuzz_perf_task_end(void) {
+  uint64_t const us = (now_ns() - counter.task_start_ns) / 1000;
+
+  counter.tasks++;
+  if (counter.task_events > counter.task_events_max) {
+    counter.task_events_max = counter.task_events;
+  }
+  if (us > counter.task_us_max) {
+    counter.task_us_max = us;
+  }
+
+  if (budget.task_events && counter.task_events > budget.task_events) {
+    over_budget("events in one tud_task()", counter.task_events, budget.task_events);
+  }
+  if (budget.task_us && us > budget.task_us) {
+    over_budget("us in one tud_task()", us, budget.task_us);
+  }
+}
+
+void fuzz_perf_trace_sink(void const *record) {
+  if (!in_input) {
+    return;
+  }
+
+  tu_trace_record_t const *rec = (tu_trace_record_t const *)record;
+  switch (rec->id) {
+    case TU_TRACE_EVENT_POST:
+      if (rec->arg > counter.queue_max) {
+        counter.queue_max = rec->arg;
+      }
+      // depth after post is only reported with OS NONE/PICO
+      if (budget.queue_full && rec->arg >= CFG_TUD_TASK_QUEUE_SZ) {
+        over_budget("event queue depth", rec->arg, CFG_TUD_TASK_QUEUE_SZ - 1);
+      }
+      break;
+
+    case TU_TRACE_TASK_DISPATCH:
+      counter.events++;
+      counter.task_events++;
+      break;
+
+    case TU_TRACE_XFER_CB_START:
+      counter.xfer_cb++;
+      break;
+
+    case TU_TRACE_EDPT_XFER:
+      counter.edpt_xfer++;
+      counter.xfer_bytes += rec->arg;
+      if (budget.input_bytes && counter.xfer_bytes > budget.input_bytes) {
+        over_budget("bytes queued to endpoints", counter.xfer_bytes, budget.input_bytes);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+}
+
+#else
+
+extern "C" {
+void fuzz_perf_input_begin(void) {}
+void fuzz_perf_input_end(void) {}
+void fuzz_perf_task_begin(void) {}
+void fuzz_perf_task_end(void) {}
+void fuzz_perf_trace_sink(void const *record) { (void)record; }
+}
+
+#endif
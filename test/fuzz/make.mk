@@ -128,6 +128,16 @@ ifneq ($(LOG),)
   CFLAGS += -DCFG_TUSB_DEBUG=$(LOG)
 endif
 
+# Performance mode: flag inputs exceeding a work budget, see fuzz_perf.cc
+ifeq ($(PERF),1)
+  BUILD := _build_perf
+  CFLAGS += \
+    -DFUZZ_PERF=1 \
+    -DCFG_TUSB_TRACE=1 \
+    -DCFG_TUSB_TRACE_SINK=fuzz_perf_trace_sink \
+    -include $(TOP)/test/fuzz/fuzz.h
+endif
+
 # Logger: default is uart, can be set to rtt or swo
 ifneq ($(LOGGER),)
 	CMAKE_DEFSYM +=	-DLOGGER=$(LOGGER)
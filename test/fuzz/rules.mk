@@ -31,6 +31,7 @@ SRC_C += \
 	src/class/hid/hid_device.c \
 	src/class/midi/midi_device.c \
 	src/class/msc/msc_device.c \
+	src/class/msc/uas_device.c \
 	src/class/net/ecm_rndis_device.c \
 	src/class/net/ncm_device.c \
 	src/class/usbtmc/usbtmc_device.c \
@@ -42,6 +43,7 @@ SRC_C += \
 SRC_CXX += \
 	test/fuzz/dcd_fuzz.cc \
 	test/fuzz/fuzz.cc \
+	test/fuzz/fuzz_perf.cc \
 	test/fuzz/msc_fuzz.cc \
 	test/fuzz/net_fuzz.cc \
 	test/fuzz/usbd_fuzz.cc
@@ -153,6 +155,17 @@ size: $(BUILD)/$(PROJECT)
 linkermap: $(BUILD)/$(PROJECT)
 	@linkermap -v $<.map
 
+# Run all inputs of the seed corpus once, e.g with PERF=1 to check them against the work budget.
+# CORPUS can be set to a directory of inputs e.g generated by tools/pcapng_to_corpus.py --dir
+CORPUS ?= $(BUILD)/corpus
+run-corpus: $(BUILD)/$(PROJECT)
+ifeq ($(CORPUS),$(BUILD)/corpus)
+	@$(RM) -rf $(CORPUS)
+	@$(MKDIR) -p $(CORPUS)
+	$(if $(wildcard *_seed_corpus.zip),@unzip -q -o $(wildcard *_seed_corpus.zip) -d $(CORPUS))
+endif
+	$(BUILD)/$(PROJECT) -runs=0 $(CORPUS)
+
 # Print out the value of a make variable.
 # https://stackoverflow.com/questions/16467718/how-to-print-out-a-variable-in-makefile
 print-%:
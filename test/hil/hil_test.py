@@ -33,6 +33,7 @@ import serial
 import subprocess
 import json
 import glob
+import statistics
 
 # for RPI double reset
 try:
@@ -43,6 +44,9 @@ except ImportError:
 
 ENUM_TIMEOUT = 10
 
+# default allowed performance regression against stored baseline, in percent
+PERF_THRESHOLD = 10
+
 
 # get usb serial by id
 def get_serial_dev(id, vendor_str, product_str, ifnum):
@@ -58,7 +62,6 @@ def get_serial_dev(id, vendor_str, product_str, ifnum):
         return port_list[0]
 
 
-# Currently not used, left as reference
 def get_disk_dev(id, vendor_str, lun):
     # get usb disk by id
     return f'/dev/disk/by-id/usb-{vendor_str}_Mass_Storage_{id}-0:{lun}'
@@ -300,13 +303,183 @@ def test_hid_composite_freertos(id):
     pass
 
 
+def test_usb_benchmark(id):
+    ret = run_usb_benchmark(id, 'bulk', 'in', 0.5)
+    assert ret['bytes'] > 0, 'No data from benchmark device'
+
+
+# -------------------------------------------------------------
+# Performance Tests
+# Each returns {metric: (value, higher_is_better)}, compared against baseline stored per board
+# -------------------------------------------------------------
+def run_usb_benchmark(id, pipe, direction, duration=2.0):
+    script = os.path.join(os.path.dirname(__file__), '../../examples/device/usb_benchmark/usb_benchmark.py')
+    timeout = ENUM_TIMEOUT
+    while timeout:
+        ret = subprocess.run(f'{sys.executable} {script} --serial {id} --pipe {pipe} --dir {direction} '
+                             f'--duration {duration} --json',
+                             shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        if ret.returncode == 0:
+            return json.loads(ret.stdout.decode())
+        time.sleep(1)
+        timeout = timeout - 1
+    assert timeout, 'Benchmark failed\n' + ret.stderr.decode()
+
+
+def perf_cdc_msc(id):
+    # CDC echo round-trip latency
+    port = get_serial_dev(id, 'TinyUSB', "TinyUSB_Device", 0)
+    ser = open_serial_dev(port)
+    rtt = []
+    for i in range(100):
+        start = time.perf_counter()
+        ser.write(b'x')
+        ser.flush()
+        assert ser.read(1) == b'x', 'CDC wrong data'
+        rtt.append(time.perf_counter() - start)
+    ser.close()
+
+    # MSC sequential read/write on raw disk, write back same data to keep disk contents
+    disk = get_disk_dev(id, 'TinyUSB', 0)
+    timeout = ENUM_TIMEOUT
+    while timeout and not os.path.exists(disk):
+        time.sleep(1)
+        timeout = timeout - 1
+    assert timeout, 'Disk not available'
+
+    loops = 20
+    fd = os.open(disk, os.O_RDWR)
+    try:
+        size = os.lseek(fd, 0, os.SEEK_END)
+        data = os.pread(fd, size, 0)
+
+        start = time.perf_counter()
+        for i in range(loops):
+            os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+            assert os.pread(fd, size, 0) == data, 'MSC wrong data'
+        read_time = time.perf_counter() - start
+
+        start = time.perf_counter()
+        for i in range(loops):
+            os.pwrite(fd, data, 0)
+            os.fsync(fd)
+        write_time = time.perf_counter() - start
+    finally:
+        os.close(fd)
+
+    return {
+        'cdc_echo_latency_us': (statistics.median(rtt) * 1e6, False),
+        'msc_read_MBps': (loops * size / read_time / 1e6, True),
+        'msc_write_MBps': (loops * size / write_time / 1e6, True),
+    }
+
+
+def perf_dfu(id):
+    test_dfu(id)  # wait for enumeration
+
+    image = bytes(i & 0xff for i in range(4096))
+    with open('dfu_perf', 'wb') as f:
+        f.write(image)
+
+    start = time.perf_counter()
+    ret = subprocess.run(f'dfu-util -S {id} -a 0 -D dfu_perf',
+                         shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    download_time = time.perf_counter() - start
+    os.remove('dfu_perf')
+    assert ret.returncode == 0, 'Download failed'
+
+    return {
+        'dfu_download_4k_s': (download_time, False),
+    }
+
+
+def perf_usb_benchmark(id):
+    bulk_in = run_usb_benchmark(id, 'bulk', 'in')
+    bulk_out = run_usb_benchmark(id, 'bulk', 'out')
+    int_in = run_usb_benchmark(id, 'int', 'in')
+    return {
+        'bulk_in_MBps': (bulk_in['MBps'], True),
+        'bulk_out_MBps': (bulk_out['MBps'], True),
+        # same as HID report rate: one report per interrupt transfer
+        'int_in_rate_hz': (int_in['transfers'] / int_in['duration_s'], True),
+        'int_in_latency_p99_us': (int_in['latency_us']['99'], False),
+    }
+
+
+def perf_check(board, results, perf_dir, threshold, update):
+    """Compare results against baseline of board, return list of regressions. Baseline is created if not existed"""
+    os.makedirs(perf_dir, exist_ok=True)
+    baseline_file = os.path.join(perf_dir, f'{board["name"]}.json')
+    baseline = {}
+    if os.path.isfile(baseline_file):
+        with open(baseline_file) as f:
+            baseline = json.load(f)
+
+    threshold = board.get('perf_threshold', threshold)
+    regressions = []
+    for metric, (value, higher_is_better) in results.items():
+        print(f'    {metric}: {value:.3f}', end='')
+        if metric in baseline:
+            ref = baseline[metric]
+            change = (value - ref) / ref * 100 if ref else 0
+            print(f' (baseline {ref:.3f}, {change:+.1f}%)', end='')
+            if (-change if higher_is_better else change) > threshold:
+                regressions.append(f'{metric} {value:.3f} vs baseline {ref:.3f} ({change:+.1f}%)')
+                print(' REGRESSED', end='')
+        print()
+
+    if update or not baseline:
+        baseline.update({metric: value for metric, (value, _) in results.items()})
+        with open(baseline_file, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+
+    return regressions
+
+
 # -------------------------------------------------------------
 # Main
 # -------------------------------------------------------------
+def flash_test(item, test):
+    fw_list = [
+        # cmake: esp32 & samd51 use .bin file
+        f'cmake-build/cmake-build-{item["name"]}/device/{test}/{test}.elf',
+        f'cmake-build/cmake-build-{item["name"]}/device/{test}/{test}.bin',
+        # make
+        f'examples/device/{test}/_build/{item["name"]}/{test}.elf'
+    ]
+
+    fw = None
+    for f in fw_list:
+        if os.path.isfile(f):
+            fw = f
+            break
+
+    if fw is None:
+        print(f'Cannot find binary file for {test}')
+        sys.exit(-1)
+
+    flasher = item['flasher'].lower()
+
+    # flash firmware. It may fail randomly, retry a few times
+    for i in range(3):
+        ret = globals()[f'flash_{flasher}'](item, fw)
+        if ret.returncode == 0:
+            break
+        else:
+            print(f'Flashing failed, retry {i+1}')
+            time.sleep(1)
+
+    assert ret.returncode == 0, 'Flash failed\n' + ret.stdout.decode()
+
+
 @click.command()
 @click.argument('config_file')
 @click.option('-b', '--board', multiple=True, default=None, help='Boards to test, all if not specified')
-def main(config_file, board):
+@click.option('-p', '--perf', is_flag=True, help='Run performance tests and compare with per-board baseline')
+@click.option('--perf-dir', default='perf', help='Directory (relative to this script) of per-board baseline')
+@click.option('--perf-threshold', default=PERF_THRESHOLD, help='Allowed regression in percent')
+@click.option('--perf-update', is_flag=True, help='Store results as new baseline')
+def main(config_file, board, perf, perf_dir, perf_threshold, perf_update):
     """
     Hardware test on specified boards
     """
@@ -319,6 +492,13 @@ def main(config_file, board):
         'cdc_dual_ports', 'cdc_msc', 'dfu', 'dfu_runtime', 'hid_boot_interface',
     ]
 
+    # all possible performance tests
+    all_perf_tests = [
+        'cdc_msc', 'dfu', 'usb_benchmark',
+    ]
+    perf_dir = os.path.join(os.path.dirname(__file__), perf_dir)
+    perf_failed = []
+
     if len(board) == 0:
         config_boards = config['boards']
     else:
@@ -326,7 +506,6 @@ def main(config_file, board):
 
     for item in config_boards:
         print(f'Testing board:{item["name"]}')
-        flasher = item['flasher'].lower()
 
         # default to all tests
         if 'tests' in item:
@@ -343,43 +522,31 @@ def main(config_file, board):
                 if skip in test_list:
                     test_list.remove(skip)
 
-        for test in test_list:
-            fw_list = [
-                # cmake: esp32 & samd51 use .bin file
-                f'cmake-build/cmake-build-{item["name"]}/device/{test}/{test}.elf',
-                f'cmake-build/cmake-build-{item["name"]}/device/{test}/{test}.bin',
-                # make
-                f'examples/device/{test}/_build/{item["name"]}/{test}.elf'
-            ]
-
-            fw = None
-            for f in fw_list:
-                if os.path.isfile(f):
-                    fw = f
-                    break
-
-            if fw is None:
-                print(f'Cannot find binary file for {test}')
-                sys.exit(-1)
-
-            print(f'  {test} ...', end='')
+        # performance tests run before board_test which disables board's usb
+        if perf:
+            perf_list = item.get('perf_tests', all_perf_tests)
+            if 'tests' in item:
+                perf_list = [t for t in perf_list if t in test_list]
+            perf_results = {}
+            for test in perf_list:
+                print(f'  perf {test} ...')
+                flash_test(item, test)
+                perf_results.update(globals()[f'perf_{test}'](item['uid']))
 
-            # flash firmware. It may fail randomly, retry a few times
-            for i in range(3):
-                ret = globals()[f'flash_{flasher}'](item, fw)
-                if ret.returncode == 0:
-                    break
-                else:
-                    print(f'Flashing failed, retry {i+1}')
-                    time.sleep(1)
+            regressions = perf_check(item, perf_results, perf_dir, perf_threshold, perf_update)
+            perf_failed += [f'{item["name"]}: {r}' for r in regressions]
 
-            assert ret.returncode == 0, 'Flash failed\n' + ret.stdout.decode()
+        for test in test_list:
+            print(f'  {test} ...', end='')
+            flash_test(item, test)
 
             # run test
             globals()[f'test_{test}'](item['uid'])
 
             print('OK')
 
+    assert not perf_failed, 'Performance regression:\n' + '\n'.join(perf_failed)
+
 
 if __name__ == '__main__':
     main()
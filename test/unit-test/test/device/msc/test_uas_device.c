@@ -0,0 +1,312 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+TEST_FILE("usbd_control.c")
+TEST_FILE("msc_device.c")
+TEST_FILE("uas_device.c")
+
+// Mock File
+#include "mock_dcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CTRL_OUT = 0x00,
+  EDPT_CTRL_IN  = 0x80,
+
+  EDPT_UAS_CMD      = 0x01,
+  EDPT_UAS_STATUS   = 0x82,
+  EDPT_UAS_DATA_IN  = 0x83,
+  EDPT_UAS_DATA_OUT = 0x04,
+};
+
+uint8_t const rhport = 0;
+
+enum
+{
+  ITF_NUM_MSC,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_MSC_UAS_DESC_LEN)
+
+uint8_t const data_desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+
+  // Interface number, string index, EP Command, Status, Data In, Data Out address, EP size
+  TUD_MSC_UAS_DESCRIPTOR(ITF_NUM_MSC, 0, EDPT_UAS_CMD, EDPT_UAS_STATUS, EDPT_UAS_DATA_IN, EDPT_UAS_DATA_OUT, 512),
+};
+
+tusb_control_request_t const request_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0,
+  .wLength       = 0
+};
+
+uint8_t const* desc_configuration;
+
+enum
+{
+  DISK_BLOCK_NUM  = 16,
+  DISK_BLOCK_SIZE = 512
+};
+
+uint8_t msc_disk[DISK_BLOCK_NUM][DISK_BLOCK_SIZE];
+
+//--------------------------------------------------------------------+
+// MSC callbacks
+//--------------------------------------------------------------------+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
+{
+  (void) lun;
+
+  const char vid[] = "TinyUSB";
+  const char pid[] = "Mass Storage";
+  const char rev[] = "1.0";
+
+  memcpy(vendor_id  , vid, strlen(vid));
+  memcpy(product_id , pid, strlen(pid));
+  memcpy(product_rev, rev, strlen(rev));
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun)
+{
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size)
+{
+  (void) lun;
+
+  *block_count = DISK_BLOCK_NUM;
+  *block_size  = DISK_BLOCK_SIZE;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  uint8_t const* addr = msc_disk[lba] + offset;
+  memcpy(buffer, addr, bufsize);
+
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  uint8_t* addr = msc_disk[lba] + offset;
+  memcpy(addr, buffer, bufsize);
+
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize)
+{
+  (void) lun;
+  (void) buffer;
+  (void) bufsize;
+
+  // accepted without response data, as application handling MODE SELECT would do
+  if ( scsi_cmd[0] == SCSI_CMD_MODE_SELECT_6 ) return 0;
+
+  return -1;
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  return desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) langid;
+
+  return NULL;
+}
+
+void setUp(void)
+{
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+
+  if ( !tud_inited() )
+  {
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+
+  dcd_event_bus_reset(rhport, TUSB_SPEED_HIGH, false);
+  tud_task();
+}
+
+void tearDown(void)
+{
+}
+
+// Configure device and receive command_iu on command pipe
+static void uas_configure(uas_iu_command_t const* command_iu)
+{
+  desc_configuration = data_desc_configuration;
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+
+  dcd_edpt_config_plan_Expect(rhport, (tusb_desc_configuration_t const*) desc_configuration);
+
+  // open endpoints, each is followed by pipe usage descriptor
+  for(uint8_t i=0; i<4; i++)
+  {
+    dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+    desc_ep = tu_desc_next(tu_desc_next(desc_ep));
+  }
+
+  // Prepare for Command IU
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(uas_iu_command_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer((uint8_t*) command_iu, sizeof(uas_iu_command_t));
+
+  // command received
+  dcd_event_xfer_complete(rhport, EDPT_UAS_CMD, sizeof(uas_iu_command_t), 0, true);
+
+  // control status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+void test_uas_read10(void)
+{
+  // Read 1 LBA = 0, Block count = 1
+  uas_iu_command_t command_iu =
+  {
+    .iu_id = UAS_IU_ID_COMMAND,
+    .tag   = tu_htons(1),
+  };
+
+  scsi_read10_t cmd_read10 =
+  {
+      .cmd_code    = SCSI_CMD_READ_10,
+      .lba         = tu_htonl(0),
+      .block_count = tu_htons(1)
+  };
+
+  memcpy(command_iu.cdb, &cmd_read10, sizeof(cmd_read10));
+
+  uas_configure(&command_iu);
+
+  // READ READY IU, then accept next command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_STATUS, NULL, sizeof(uas_iu_ready_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(uas_iu_command_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, sizeof(uas_iu_ready_t), 0, true);
+
+  // Data transfer
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_DATA_IN, NULL, 512, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_DATA_IN, 512, 0, true);
+
+  // Sense IU with GOOD status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_STATUS, NULL, offsetof(uas_iu_sense_t, sense), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, offsetof(uas_iu_sense_t, sense), 0, true);
+
+  tud_task();
+}
+
+void test_uas_incorrect_lun(void)
+{
+  uas_iu_command_t command_iu =
+  {
+    .iu_id = UAS_IU_ID_COMMAND,
+    .tag   = tu_htons(1),
+    .lun   = { 0, 1 },
+    .cdb   = { SCSI_CMD_TEST_UNIT_READY }
+  };
+
+  uas_configure(&command_iu);
+
+  // Response IU, next IU is accepted once it is sent
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_STATUS, NULL, sizeof(uas_iu_response_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, sizeof(uas_iu_response_t), 0, true);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(uas_iu_command_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+
+  tud_task();
+}
+
+void test_uas_mode_select_not_supported(void)
+{
+  // MODE SELECT (6) with 12 bytes parameter list in data-out
+  uas_iu_command_t command_iu =
+  {
+    .iu_id = UAS_IU_ID_COMMAND,
+    .tag   = tu_htons(1),
+    .cdb   = { SCSI_CMD_MODE_SELECT_6, 0x10, 0, 0, 12, 0 }
+  };
+
+  uas_configure(&command_iu);
+
+  // no data phase, Sense IU with CHECK CONDITION, next IU is accepted once it is sent
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_STATUS, NULL, sizeof(uas_iu_sense_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, sizeof(uas_iu_sense_t), 0, true);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(uas_iu_command_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+
+  tud_task();
+}
@@ -29,11 +29,13 @@
 #include "tusb_fifo.h"
 #include "tusb.h"
 #include "usbd.h"
+#include "usbd_pvt.h"
 TEST_FILE("usbd_control.c")
 
 // Mock File
 #include "mock_dcd.h"
 #include "mock_msc_device.h"
+#include "mock_uas_device.h"
 
 //--------------------------------------------------------------------+
 // MACRO TYPEDEF CONSTANT ENUM DECLARATION
@@ -127,6 +129,7 @@ void setUp(void)
   if ( !tud_inited() )
   {
     mscd_init_Expect();
+    uasd_init_Expect();
     dcd_init_Expect(rhport);
     tusb_init();
   }
@@ -242,3 +245,198 @@ void test_usbd_control_in_zlp(void)
 
   tud_task();
 }
+
+//--------------------------------------------------------------------+
+// Arena
+//--------------------------------------------------------------------+
+
+void test_usbd_arena_alloc(void)
+{
+  uint32_t const remaining = usbd_arena_remaining(rhport);
+
+  uint8_t* buf1 = (uint8_t*) usbd_arena_alloc(rhport, 5);
+  uint8_t* buf2 = (uint8_t*) usbd_arena_alloc(rhport, 64);
+  TEST_ASSERT_NOT_NULL(buf1);
+  TEST_ASSERT_NOT_NULL(buf2);
+
+  // each allocation is aligned, size is rounded up
+  TEST_ASSERT_EQUAL(0, ((uintptr_t) buf1) % CFG_TUD_ARENA_ALIGN);
+  TEST_ASSERT_EQUAL(0, ((uintptr_t) buf2) % CFG_TUD_ARENA_ALIGN);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, buf2 - buf1);
+  TEST_ASSERT_EQUAL(remaining - (buf2 - buf1) - 64, usbd_arena_remaining(rhport));
+
+  // exhausted
+  TEST_ASSERT_NULL(usbd_arena_alloc(rhport, usbd_arena_remaining(rhport) + 1));
+  TEST_ASSERT_NOT_NULL(usbd_arena_alloc(rhport, usbd_arena_remaining(rhport)));
+  TEST_ASSERT_EQUAL(0, usbd_arena_remaining(rhport));
+  TEST_ASSERT_NULL(usbd_arena_alloc(rhport, 1));
+}
+
+void test_usbd_arena_release_on_bus_reset(void)
+{
+  usbd_arena_alloc(rhport, 100);
+  TEST_ASSERT_LESS_THAN(CFG_TUD_ARENA_SIZE, usbd_arena_remaining(rhport));
+
+  mscd_reset_Expect(rhport);
+  uasd_reset_Expect(rhport);
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(CFG_TUD_ARENA_SIZE, usbd_arena_remaining(rhport));
+}
+
+//--------------------------------------------------------------------+
+// ISO Stream
+//--------------------------------------------------------------------+
+
+void test_usbd_iso_stream_in(void)
+{
+  uint8_t buf[4][16];
+  uint16_t len[4];
+  usbd_iso_stream_t stream = { .buffer = buf[0], .length = len, .slot_size = 16, .num_slots = 4 };
+
+  // empty ring: armed with ZLP
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x81, NULL, 0, true);
+  TEST_ASSERT_TRUE(usbd_edpt_iso_stream_start(rhport, 0x81, &stream));
+  TEST_ASSERT_TRUE(usbd_edpt_busy(rhport, 0x81));
+
+  uint8_t* slot = usbd_iso_stream_write_slot(&stream);
+  TEST_ASSERT_EQUAL_PTR(buf[0], slot);
+  usbd_iso_stream_commit(&stream, 10);
+  usbd_iso_stream_commit(&stream, 12);
+  TEST_ASSERT_EQUAL(2, usbd_iso_stream_count(&stream));
+
+  // re-armed in ISR with queued slots, without going through usbd task
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x81, buf[0], 10, true);
+  dcd_event_xfer_complete(rhport, 0x81, 0, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_EQUAL(1, stream.missed);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x81, buf[1], 12, true);
+  dcd_event_xfer_complete(rhport, 0x81, 10, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_EQUAL(1, usbd_iso_stream_count(&stream));
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x81, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, 0x81, 12, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_EQUAL(0, usbd_iso_stream_count(&stream));
+  TEST_ASSERT_FALSE(tud_task_event_ready());
+
+  usbd_edpt_iso_stream_stop(rhport, 0x81);
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, 0x81));
+}
+
+void test_usbd_iso_stream_out_overrun(void)
+{
+  uint8_t buf[2][16];
+  uint16_t len[2];
+  usbd_iso_stream_t stream = { .buffer = buf[0], .length = len, .slot_size = 16, .num_slots = 2 };
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x01, buf[0], 16, true);
+  TEST_ASSERT_TRUE(usbd_edpt_iso_stream_start(rhport, 0x01, &stream));
+
+  // first packet is committed, hardware moves on to the reserved slot
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x01, buf[1], 16, true);
+  dcd_event_xfer_complete(rhport, 0x01, 7, XFER_RESULT_SUCCESS, true);
+
+  // ring is full: packet dropped, same slot re-armed
+  dcd_edpt_xfer_ExpectAndReturn(rhport, 0x01, buf[1], 16, true);
+  dcd_event_xfer_complete(rhport, 0x01, 9, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_EQUAL(1, stream.missed);
+
+  uint16_t rx_len = 0;
+  TEST_ASSERT_EQUAL_PTR(buf[0], usbd_iso_stream_read_slot(&stream, &rx_len));
+  TEST_ASSERT_EQUAL(7, rx_len);
+  usbd_iso_stream_release(&stream);
+  TEST_ASSERT_NULL(usbd_iso_stream_read_slot(&stream, &rx_len));
+
+  usbd_edpt_iso_stream_stop(rhport, 0x01);
+}
+
+//--------------------------------------------------------------------+
+// SOF Scheduler
+//--------------------------------------------------------------------+
+static uint32_t sof_sched_count[2];
+
+static void sof_sched_cb(uint8_t rhport_, uint32_t frame_count, void* arg)
+{
+  (void) rhport_; (void) frame_count;
+  sof_sched_count[(uintptr_t) arg]++;
+}
+
+void test_usbd_sof_sched(void)
+{
+  usbd_sof_sched_t s1, s2;
+  sof_sched_count[0] = sof_sched_count[1] = 0;
+
+  // SOF is enabled by the first registration only
+  dcd_sof_enable_Expect(rhport, true);
+  TEST_ASSERT_TRUE(usbd_sof_sched_add(rhport, &s1, 1, sof_sched_cb, (void*) 0));
+  TEST_ASSERT_TRUE(usbd_sof_sched_add(rhport, &s2, 4, sof_sched_cb, (void*) 1));
+
+  for (uint32_t i = 0; i < 8; i++) {
+    dcd_event_sof(rhport, i, true);
+  }
+  TEST_ASSERT_EQUAL(8, sof_sched_count[0]);
+  TEST_ASSERT_EQUAL(2, sof_sched_count[1]);
+  TEST_ASSERT_FALSE(tud_task_event_ready());
+
+  // SOF is disabled when the last registration is removed
+  usbd_sof_sched_remove(rhport, &s1);
+  dcd_event_sof(rhport, 8, true);
+  TEST_ASSERT_EQUAL(8, sof_sched_count[0]);
+
+  dcd_sof_enable_Expect(rhport, false);
+  usbd_sof_sched_remove(rhport, &s2);
+}
+
+//--------------------------------------------------------------------+
+// Transfer Complete Coalescing
+//--------------------------------------------------------------------+
+uint8_t const data_desc_configuration_msc[] =
+{
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN, 0, 100),
+  TUD_MSC_DESCRIPTOR(0, 0, 0x01, 0x81, 64),
+};
+
+tusb_control_request_t const req_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest = TUSB_REQ_SET_CONFIGURATION,
+  .wValue = 1,
+  .wIndex = 0x0000,
+  .wLength = 0
+};
+
+void test_usbd_xfer_coalesce_first_failure(void)
+{
+  // bind endpoints to (mocked) MSC driver
+  desc_configuration = data_desc_configuration_msc;
+  dcd_edpt_config_plan_Expect(rhport, (tusb_desc_configuration_t const*) data_desc_configuration_msc);
+  mscd_open_ExpectAndReturn(rhport, (tusb_desc_interface_t const*) (data_desc_configuration_msc + TUD_CONFIG_DESC_LEN),
+                            TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  dcd_event_setup_received(rhport, (uint8_t const*) &req_set_configuration, false);
+  tud_task();
+  TEST_ASSERT_TRUE(tud_mounted());
+
+  usbd_edpt_xfer_coalesce(rhport, 0x81, true);
+
+  // completions arriving while the first one is still queued are merged, first failure is kept
+  dcd_event_xfer_complete(rhport, 0x81, 64, XFER_RESULT_SUCCESS, true);
+  dcd_event_xfer_complete(rhport, 0x81, 64, XFER_RESULT_FAILED, true);
+  dcd_event_xfer_complete(rhport, 0x81, 64, XFER_RESULT_STALLED, true);
+  dcd_event_xfer_complete(rhport, 0x81, 32, XFER_RESULT_SUCCESS, true);
+
+  mscd_xfer_cb_ExpectAndReturn(rhport, 0x81, XFER_RESULT_FAILED, 224, true);
+  tud_task();
+  TEST_ASSERT_FALSE(tud_task_event_ready());
+
+  // next completion is queued on its own again
+  dcd_event_xfer_complete(rhport, 0x81, 16, XFER_RESULT_SUCCESS, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, 0x81, XFER_RESULT_SUCCESS, 16, true);
+  tud_task();
+
+  mscd_reset_Expect(rhport);
+  uasd_reset_Expect(rhport);
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  tud_task();
+}
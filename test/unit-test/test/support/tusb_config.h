@@ -49,6 +49,10 @@
 
 #define CFG_TUSB_OS              OPT_OS_NONE
 
+#define CFG_TUSB_FIFO_MULTI_PRODUCER  1
+#define CFG_TUSB_FIFO_LOCKFREE_OVERWRITE  1
+#define CFG_TUSB_FIFO_STATS  1
+
 // CFG_TUSB_DEBUG is defined by compiler in DEBUG build
 #ifndef CFG_TUSB_DEBUG
 #define CFG_TUSB_DEBUG           1
@@ -79,6 +83,7 @@
 //------------- CLASS -------------//
 //#define CFG_TUD_CDC              0
 #define CFG_TUD_MSC              1
+#define CFG_TUD_MSC_UAS          1
 //#define CFG_TUD_HID              0
 //#define CFG_TUD_MIDI             0
 //#define CFG_TUD_VENDOR           0
@@ -94,6 +99,24 @@
 // Buffer size of Device Mass storage
 #define CFG_TUD_MSC_BUFSIZE      512
 
+// LUN 0 can be served directly from memory
+#define CFG_TUD_MSC_MEMMAP       1
+
+// Small write-through sector cache
+#define CFG_TUD_MSC_CACHE_BLOCKS 4
+
+// RAM arena shared by drivers of active configuration
+#define CFG_TUD_ARENA_SIZE       2048
+
+// Always-armed ISO streaming
+#define CFG_TUD_ISO_STREAM       1
+
+// Central SOF scheduler
+#define CFG_TUD_SOF_SCHED        1
+
+// Merge transfer completions of opted-in endpoints
+#define CFG_TUD_EDPT_XFER_COALESCE 1
+
 //------------- HID -------------//
 
 // Should be sufficient to hold ID (if any) + Data
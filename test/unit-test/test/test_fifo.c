@@ -359,6 +359,11 @@ void test_rd_idx_wrap()
   uint8_t buf[10];
   uint8_t dst[10];
 
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  TEST_ASSERT_FALSE(tu_fifo_config(&ff10, buf, 10, 1, false));
+  TEST_IGNORE_MESSAGE("non power of two depth is rejected with CFG_TUSB_FIFO_DEPTH_POW2");
+#endif
+
   tu_fifo_config(&ff10, buf, 10, 1, 1);
 
   uint16_t n;
@@ -376,3 +381,307 @@ void test_rd_idx_wrap()
   TEST_ASSERT_EQUAL(n, 2);
   TEST_ASSERT_EQUAL(ff10.rd_idx, 6);
 }
+
+void test_non_pow2_depth_wrap(void)
+{
+  tu_fifo_t ff10;
+  uint8_t buf[10];
+  uint8_t dst[10];
+
+#if CFG_TUSB_FIFO_DEPTH_POW2
+  TEST_ASSERT_FALSE(tu_fifo_config(&ff10, buf, 10, 1, false));
+  TEST_IGNORE_MESSAGE("non power of two depth is rejected with CFG_TUSB_FIFO_DEPTH_POW2");
+#endif
+
+  tu_fifo_config(&ff10, buf, 10, 1, false);
+
+  // keep index crossing both depth and 2*depth boundary
+  for(uint8_t i=0; i < 7; i++)
+  {
+    TEST_ASSERT_EQUAL(7, tu_fifo_write_n(&ff10, test_data + 7*i, 7));
+    TEST_ASSERT_EQUAL(7, tu_fifo_count(&ff10));
+    TEST_ASSERT_EQUAL(3, tu_fifo_remaining(&ff10));
+
+    TEST_ASSERT_EQUAL(7, tu_fifo_read_n(&ff10, dst, 10));
+    TEST_ASSERT_EQUAL_MEMORY(test_data + 7*i, dst, 7);
+    TEST_ASSERT_TRUE(tu_fifo_empty(&ff10));
+  }
+}
+
+void test_pow2_depth_max_wrap(void)
+{
+  // largest depth, index space 2*depth is equal to uint16_t range
+  static uint8_t buf[0x8000];
+  tu_fifo_t ff_max;
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff_max, buf, 0x8000, 1, false));
+
+  ff_max.wr_idx = 0xFFFE;
+  ff_max.rd_idx = 0xFFFE;
+
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_n(&ff_max, test_data, 4));
+  TEST_ASSERT_EQUAL(2, ff_max.wr_idx);
+  TEST_ASSERT_EQUAL(4, tu_fifo_count(&ff_max));
+
+  TEST_ASSERT_EQUAL(4, tu_fifo_read_n(&ff_max, rd_buf, 4));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, 4);
+  TEST_ASSERT_EQUAL(2, ff_max.rd_idx);
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff_max));
+}
+
+void test_write_reserve_commit(void)
+{
+  // move index so that reservation wraps around
+  tu_fifo_write_n(ff, test_data, 60);
+  tu_fifo_read_n(ff, rd_buf, 60);
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_write_reserve(ff, &info));
+  TEST_ASSERT_EQUAL(4, info.len_lin);
+  TEST_ASSERT_EQUAL(FIFO_SIZE-4, info.len_wrap);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer+60, info.ptr_lin);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, info.ptr_wrap);
+
+  // build data directly in fifo memory
+  memcpy(info.ptr_lin, test_data, 4);
+  memcpy(info.ptr_wrap, test_data+4, 6);
+  tu_fifo_write_commit(ff, 10);
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(10, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, 10);
+}
+
+void test_mp_write_publish_in_order(void)
+{
+  tu_fifo_buffer_info_t info_a, info_b;
+
+  TEST_ASSERT_EQUAL(3, tu_fifo_mp_write_reserve(ff, 3, &info_a));
+  TEST_ASSERT_EQUAL(2, tu_fifo_mp_write_reserve(ff, 2, &info_b));
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, info_a.ptr_lin);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer+3, info_b.ptr_lin);
+
+  // later reservation committed first is not published until earlier one is committed
+  memcpy(info_b.ptr_lin, "de", 2);
+  tu_fifo_mp_write_commit(ff);
+  TEST_ASSERT_EQUAL(0, tu_fifo_count(ff));
+
+  memcpy(info_a.ptr_lin, "abc", 3);
+  tu_fifo_mp_write_commit(ff);
+  TEST_ASSERT_EQUAL(5, tu_fifo_count(ff));
+
+  TEST_ASSERT_EQUAL(5, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY("abcde", rd_buf, 5);
+}
+
+void test_mp_write_all_or_nothing(void)
+{
+  // move index so that message wraps around
+  tu_fifo_mp_write_n(ff, test_data, 60);
+  tu_fifo_read_n(ff, rd_buf, 60);
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_mp_write_n(ff, test_data, 10));
+  TEST_ASSERT_EQUAL(0, tu_fifo_mp_write_n(ff, test_data, FIFO_SIZE-9));
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE-10, tu_fifo_mp_write_n(ff, test_data+10, FIFO_SIZE-10));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, FIFO_SIZE);
+}
+
+void test_ow_write_read(void)
+{
+  uint32_t lost = 1;
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_ow_write_n(ff, test_data, 10));
+  TEST_ASSERT_EQUAL(10, tu_fifo_ow_count(ff));
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_ow_read_n(ff, rd_buf, FIFO_SIZE, &lost));
+  TEST_ASSERT_EQUAL(0, lost);
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, 10);
+  TEST_ASSERT_EQUAL(0, tu_fifo_ow_read_n(ff, rd_buf, FIFO_SIZE, &lost));
+}
+
+void test_ow_reader_lapped(void)
+{
+  uint32_t lost;
+
+  // writer keeps going without reader, wraps several times
+  for ( int i = 0; i < 10; i++ )
+  {
+    tu_fifo_ow_write_n(ff, test_data + 30*i, 30);
+  }
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_ow_count(ff));
+
+  // reader resynchronizes to the oldest data still in fifo
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_ow_read_n(ff, rd_buf, FIFO_SIZE, &lost));
+  TEST_ASSERT_EQUAL(300 - FIFO_SIZE, lost);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 300 - FIFO_SIZE, rd_buf, FIFO_SIZE);
+
+  // write larger than depth keeps only the newest items
+  TEST_ASSERT_EQUAL(100, tu_fifo_ow_write_n(ff, test_data, 100));
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_ow_read_n(ff, rd_buf, FIFO_SIZE, &lost));
+  TEST_ASSERT_EQUAL(100 - FIFO_SIZE, lost);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 100 - FIFO_SIZE, rd_buf, FIFO_SIZE);
+}
+
+void test_ow_overwritten_while_reading(void)
+{
+  uint32_t lost;
+
+  tu_fifo_ow_write_n(ff, test_data, FIFO_SIZE);
+
+  // writer (e.g ISR) has claimed 10 slots and is overwriting them while reader copies
+  ff->ow_claim_seq += 10;
+
+  // oldest 10 items are discarded, remaining ones are intact
+  TEST_ASSERT_EQUAL(FIFO_SIZE - 10, tu_fifo_ow_read_n(ff, rd_buf, FIFO_SIZE, &lost));
+  TEST_ASSERT_EQUAL(10, lost);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 10, rd_buf, FIFO_SIZE - 10);
+}
+
+void test_read_reserve_commit(void)
+{
+  uint32_t buf4[8];
+  uint32_t data4[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  tu_fifo_t ff4;
+
+  tu_fifo_config(&ff4, buf4, 8, sizeof(uint32_t), false);
+
+  uint32_t dummy[4];
+  tu_fifo_write_n(&ff4, data4, 6);
+  tu_fifo_read_n(&ff4, dummy, 4);
+  tu_fifo_write_n(&ff4, data4+6, 2);
+  tu_fifo_write_n(&ff4, data4, 1);
+
+  // 5 items: 2 linear then 1 wrapped, pointer must account for item size
+  TEST_ASSERT_EQUAL(5, tu_fifo_read_reserve(&ff4, &info));
+  TEST_ASSERT_EQUAL(4, info.len_lin);
+  TEST_ASSERT_EQUAL(1, info.len_wrap);
+  TEST_ASSERT_EQUAL_PTR(buf4+4, info.ptr_lin);
+  TEST_ASSERT_EQUAL_PTR(buf4, info.ptr_wrap);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(data4+4, info.ptr_lin, 4);
+
+  // consume only part of it
+  tu_fifo_read_commit(&ff4, 3);
+  TEST_ASSERT_EQUAL(2, tu_fifo_count(&ff4));
+
+  uint32_t rd4[2];
+  TEST_ASSERT_EQUAL(2, tu_fifo_read_n(&ff4, rd4, 2));
+  TEST_ASSERT_EQUAL(8, rd4[0]);
+  TEST_ASSERT_EQUAL(1, rd4[1]);
+
+  // empty reserve
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_reserve(&ff4, &info));
+  TEST_ASSERT_NULL(info.ptr_lin);
+  tu_fifo_read_commit(&ff4, 0);
+}
+
+void test_stats(void)
+{
+#if !CFG_TUSB_FIFO_STATS
+  TEST_IGNORE_MESSAGE("CFG_TUSB_FIFO_STATS is disabled");
+#else
+  tu_fifo_t ff8;
+  uint8_t buf8[8];
+  tu_fifo_stats_t stats;
+
+  tu_fifo_config(&ff8, buf8, 8, 1, false);
+
+  tu_fifo_write_n(&ff8, test_data, 6);
+  tu_fifo_read_n(&ff8, rd_buf, 2);
+  tu_fifo_write_n(&ff8, test_data, 6); // only 4 fit
+  tu_fifo_read_n(&ff8, rd_buf, 10);    // only 8 available
+
+  tu_fifo_stats_get(&ff8, &stats);
+  TEST_ASSERT_EQUAL(8, stats.max_count);
+  TEST_ASSERT_EQUAL(10, stats.write_total);
+  TEST_ASSERT_EQUAL(10, stats.read_total);
+  TEST_ASSERT_EQUAL(1, stats.overflow_count);
+  TEST_ASSERT_EQUAL(1, stats.underflow_count);
+  TEST_ASSERT_EQUAL(2, stats.writes_since_empty);
+
+  tu_fifo_write(&ff8, test_data);
+  tu_fifo_stats_get(&ff8, &stats);
+  TEST_ASSERT_EQUAL(1, stats.writes_since_empty);
+
+  tu_fifo_stats_clear(&ff8);
+  tu_fifo_stats_get(&ff8, &stats);
+  TEST_ASSERT_EQUAL(0, stats.write_total);
+  TEST_ASSERT_EQUAL(0, stats.max_count);
+#endif
+}
+
+void test_const_addr_aligned(void)
+{
+  uint32_t buf4[4];
+  tu_fifo_t ff8;
+  tu_fifo_config(&ff8, buf4, sizeof(buf4), 1, false);
+
+  // word-aligned fifo buffer with a trailing partial word
+  volatile uint32_t reg = 0x44332211;
+  TEST_ASSERT_EQUAL(6, tu_fifo_write_n_const_addr_full_words(&ff8, (void const*) &reg, 6));
+  TEST_ASSERT_EQUAL(6, tu_fifo_count(&ff8));
+
+  uint8_t const expected[6] = { 0x11, 0x22, 0x33, 0x44, 0x11, 0x22 };
+  TEST_ASSERT_EQUAL_MEMORY(expected, buf4, 6);
+
+  reg = 0;
+  TEST_ASSERT_EQUAL(6, tu_fifo_read_n_const_addr_full_words(&ff8, (void*) &reg, 6));
+  TEST_ASSERT_EQUAL(0x2211, reg);
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff8));
+}
+
+void test_hwfifo_mem_unaligned(void)
+{
+  uint32_t pma[4] = { 0 };
+
+  // unaligned source, 32-bit packet memory with zero padded tail
+  tu_hwfifo_write(pma, test_data + 1, 7, TU_HWFIFO_MEM32);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 1, pma, 7);
+  TEST_ASSERT_EQUAL(0, ((uint8_t*) pma)[7]);
+
+  tu_hwfifo_read(pma, rd_buf + 3, 7, TU_HWFIFO_MEM32);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 1, rd_buf + 3, 7);
+
+  // 16-bit packet memory
+  memset(pma, 0, sizeof(pma));
+  tu_hwfifo_write(pma, test_data, 5, TU_HWFIFO_MEM16);
+  TEST_ASSERT_EQUAL_MEMORY(test_data, pma, 5);
+}
+
+void test_hwfifo_fifo_wrap(void)
+{
+  uint32_t pma[4];
+  memcpy(pma, test_data + 100, 10);
+
+  // move index so that linear part is 3 bytes, not a multiple of access width
+  tu_fifo_write_n(ff, test_data, FIFO_SIZE - 3);
+  tu_fifo_read_n(ff, rd_buf, FIFO_SIZE - 3);
+
+  // packet memory to fifo
+  TEST_ASSERT_EQUAL(10, tu_hwfifo_read_to_fifo(pma, ff, 10, TU_HWFIFO_MEM32));
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 100, tu_ff_buf + FIFO_SIZE - 3, 3);
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 103, tu_ff_buf, 7);
+
+  // fifo back to packet memory, limited by fifo count
+  memset(pma, 0, sizeof(pma));
+  TEST_ASSERT_EQUAL(10, tu_hwfifo_write_from_fifo(pma, ff, 20, TU_HWFIFO_MEM32));
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 100, pma, 10);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_hwfifo_reg8(void)
+{
+  // byte data register: every access transfers one byte
+  volatile uint32_t reg = 0xA5;
+  tu_hwfifo_read(&reg, rd_buf, 3, TU_HWFIFO_REG8);
+
+  uint8_t const expected[3] = { 0xA5, 0xA5, 0xA5 };
+  TEST_ASSERT_EQUAL_MEMORY(expected, rd_buf, 3);
+
+  tu_hwfifo_write(&reg, test_data + 7, 2, TU_HWFIFO_REG8);
+  TEST_ASSERT_EQUAL(8, reg & 0xFF);
+}
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Generate single translation unit (amalgamation) of TinyUSB sources.
+
+All given C sources are concatenated into one tinyusb_all.c so that the whole configured stack is compiled as
+one unit. The compiler can then inline small helpers such as tu_fifo_*() and usbd_edpt_*() into class drivers
+without relying on LTO, which is weak or missing on some vendor toolchains.
+
+- quoted includes relative to a source file are rewritten relative to src/ (which stays on the include path,
+  as is the directory of tusb_config.h), headers are still included since they are guarded and configured by the
+  application.
+- macros defined by a source file (not by a header) are #undef after it so that they do not leak into next one.
+- #line directives keep compiler diagnostics and debug info pointing to original files.
+
+    amalgamate.py -o _build/tinyusb_all.c src/tusb.c src/common/tusb_fifo.c src/device/usbd.c ...
+    amalgamate.py -o tinyusb_all.c --top path/to/tinyusb $(TINYUSB_SRC_C)
+"""
+import argparse
+import os
+import re
+import sys
+
+INCLUDE_RE = re.compile(r'^(\s*#\s*include\s+)"([^"]+)"(.*)$')
+DEFINE_RE = re.compile(r'^\s*#\s*define\s+([A-Za-z_]\w*)')
+
+
+def header_macros(src_dir):
+    """Macros defined by any header of the stack, these must not be undefined between sources"""
+    macros = set()
+    for root, _, files in os.walk(src_dir):
+        for fname in files:
+            if fname.endswith('.h'):
+                with open(os.path.join(root, fname), encoding='utf-8', errors='replace') as f:
+                    for line in f:
+                        m = DEFINE_RE.match(line)
+                        if m:
+                            macros.add(m.group(1))
+    return macros
+
+
+def unix_path(path):
+    return path.replace(os.sep, '/')
+
+
+def amalgamate_file(path, top, src_dir, keep_macros, line_directive):
+    """Return content of one source with rewritten includes, followed by #undef of its local macros"""
+    rel = unix_path(os.path.relpath(path, top))
+    src_base = os.path.dirname(path)
+
+    out = [f'/*** {rel} ***/\n']
+    if line_directive:
+        out.append(f'#line 1 "{rel}"\n')
+
+    defined = []
+    with open(path, encoding='utf-8', errors='replace') as f:
+        for line in f:
+            m = INCLUDE_RE.match(line)
+            if m:
+                inc = os.path.normpath(os.path.join(src_base, m.group(2)))
+                # only rewrite include relative to source file, that is not found via src/ include path
+                if os.path.isfile(inc) and not os.path.isfile(os.path.join(src_dir, m.group(2))):
+                    if os.path.commonpath([inc, src_dir]) == src_dir:
+                        inc = os.path.relpath(inc, src_dir)
+                    line = f'{m.group(1)}"{unix_path(inc)}"{m.group(3)}\n'
+
+            m = DEFINE_RE.match(line)
+            if m and m.group(1) not in keep_macros and m.group(1) not in defined:
+                defined.append(m.group(1))
+
+            out.append(line)
+
+    if not out[-1].endswith('\n'):
+        out.append('\n')
+
+    for name in defined:
+        out.append(f'#undef {name}\n')
+    out.append('\n')
+    return ''.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('sources', nargs='+', help='C sources, relative to --top or absolute')
+    parser.add_argument('-o', '--output', required=True, help='generated file e.g tinyusb_all.c')
+    parser.add_argument('--top', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'),
+                        help='root of TinyUSB tree (default: parent of this script)')
+    parser.add_argument('--no-line', action='store_true',
+                        help='omit #line directives, for compiler without __COUNTER__ where TU_VERIFY_STATIC() '
+                             'falls back to __LINE__')
+    args = parser.parse_args()
+
+    top = os.path.abspath(args.top)
+    src_dir = os.path.join(top, 'src')
+    keep_macros = header_macros(src_dir)
+
+    # source list may contain duplicates e.g typec/usbc.c in tinyusb.mk
+    sources = []
+    for s in args.sources:
+        path = os.path.abspath(s if os.path.isabs(s) else os.path.join(top, s))
+        if not os.path.isfile(path):
+            sys.exit(f'amalgamate.py: {s} not found')
+        if path not in sources:
+            sources.append(path)
+
+    content = [
+        '// Generated by tools/amalgamate.py, do not edit\n',
+        '// Single translation unit of TinyUSB, compile in place of the listed sources\n',
+        '\n',
+    ]
+    for path in sources:
+        content.append(amalgamate_file(path, top, src_dir, keep_macros, not args.no_line))
+
+    content = ''.join(content)
+
+    # only write if changed to avoid unnecessary rebuild
+    if os.path.isfile(args.output):
+        with open(args.output, encoding='utf-8') as f:
+            if f.read() == content:
+                return
+
+    out_dir = os.path.dirname(os.path.abspath(args.output))
+    os.makedirs(out_dir, exist_ok=True)
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write(content)
+
+
+if __name__ == '__main__':
+    main()
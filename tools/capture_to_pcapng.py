@@ -0,0 +1,137 @@
+#!/bin/python3
+import argparse
+import struct
+import sys
+
+# Record stream of CFG_TUSB_CAPTURE, see tu_capture_header_t in src/common/tusb_debug.h
+CAPTURE_SYNC = 0xA5
+CAPTURE_HEADER = struct.Struct('<BBBBIHHBBH')
+CAPTURE_SETUP, CAPTURE_SUBMIT, CAPTURE_COMPLETE = 0, 1, 2
+CAPTURE_HOST = 0x80
+
+# USBPcap link type and header, see https://desowin.org/usbpcap/captureformat.html
+LINKTYPE_USBPCAP = 249
+USBPCAP_HEADER = struct.Struct('<HQIHBHHBBI')
+URB_FUNCTION_CONTROL_TRANSFER = 0x0008
+URB_FUNCTION_BULK_OR_INTERRUPT_TRANSFER = 0x0009
+USBPCAP_TRANSFER_BULK, USBPCAP_TRANSFER_CONTROL = 3, 2
+USBPCAP_STAGE_SETUP, USBPCAP_STAGE_DATA, USBPCAP_STAGE_STATUS = 0, 1, 2
+
+# xfer_result_t to USBD_STATUS
+USBD_STATUS = {0: 0x00000000, 1: 0xC0000011, 2: 0xC0000004, 3: 0xC0000012, 4: 0xC0000011}
+
+
+def parse_records(stream):
+    """Splits a capture stream into (header, payload) tuples, skipping bytes until the next sync byte if the
+    stream was joined mid-way or is corrupted. Also returns number of records dropped on target."""
+    records = []
+    dropped = 0
+    last_seq = None
+    pos = 0
+    while pos + CAPTURE_HEADER.size <= len(stream):
+        if stream[pos] != CAPTURE_SYNC:
+            pos += 1
+            continue
+        hdr = CAPTURE_HEADER.unpack_from(stream, pos)
+        data_len = hdr[9]
+        end = pos + CAPTURE_HEADER.size + data_len
+        if end > len(stream):
+            break
+        seq = hdr[5]
+        if last_seq is not None:
+            dropped += (seq - last_seq - 1) & 0xFFFF
+        last_seq = seq
+        records.append((hdr, stream[pos + CAPTURE_HEADER.size:end]))
+        pos = end
+    return records, dropped
+
+
+def pcapng_block(block_type, body):
+    body += b'\x00' * (-len(body) % 4)
+    length = 12 + len(body)
+    return struct.pack('<II', block_type, length) + body + struct.pack('<I', length)
+
+
+def pcapng_header():
+    shb = pcapng_block(0x0A0D0D0A, struct.pack('<IHHq', 0x1A2B3C4D, 1, 0, -1))
+    # if_tsresol option: microsecond resolution
+    options = struct.pack('<HHB3x', 9, 1, 6) + struct.pack('<HH', 0, 0)
+    idb = pcapng_block(0x00000001, struct.pack('<HHI', LINKTYPE_USBPCAP, 0, 0) + options)
+    return shb + idb
+
+
+def pcapng_packet(timestamp_us, packet):
+    body = struct.pack('<IIIII', 0, timestamp_us >> 32, timestamp_us & 0xFFFFFFFF, len(packet), len(packet))
+    return pcapng_block(0x00000006, body + packet)
+
+
+def convert(records, tick_hz):
+    out = bytearray(pcapng_header())
+    irp_id = {}       # (bus, device, endpoint) -> irp id of transfer in progress
+    ctrl_stage = {}   # (bus, device) -> current control stage
+    next_irp = 1
+    last_ts = None
+    ticks = 0
+
+    for hdr, payload in records:
+        _, rtype, rhport, ep_addr, timestamp, _, length, daddr, result, _ = hdr
+
+        # unwrap 32-bit target timestamp
+        if last_ts is not None:
+            ticks += (timestamp - last_ts) & 0xFFFFFFFF
+        last_ts = timestamp
+        timestamp_us = ticks * 1000000 // tick_hz
+
+        kind = rtype & ~CAPTURE_HOST
+        epnum = ep_addr & 0x7F
+        key = (rhport, daddr, ep_addr)
+
+        if kind == CAPTURE_SETUP:
+            ctrl_stage[(rhport, daddr)] = USBPCAP_STAGE_SETUP
+            irp_id[key] = next_irp
+            next_irp += 1
+        elif kind == CAPTURE_SUBMIT:
+            if epnum == 0:
+                ctrl_stage[(rhport, daddr)] = USBPCAP_STAGE_DATA if length else USBPCAP_STAGE_STATUS
+            irp_id[key] = next_irp
+            next_irp += 1
+
+        info = 1 if kind == CAPTURE_COMPLETE else 0
+        status = USBD_STATUS.get(result, 0xC0000011) if kind == CAPTURE_COMPLETE else 0
+        irp = irp_id.pop(key, 0) if kind == CAPTURE_COMPLETE else irp_id[key]
+
+        if epnum == 0:
+            stage = ctrl_stage.get((rhport, daddr), USBPCAP_STAGE_SETUP)
+            header = USBPCAP_HEADER.pack(USBPCAP_HEADER.size + 1, irp, status, URB_FUNCTION_CONTROL_TRANSFER, info,
+                                         rhport, daddr, ep_addr, USBPCAP_TRANSFER_CONTROL, len(payload))
+            header += struct.pack('<B', stage)
+        else:
+            header = USBPCAP_HEADER.pack(USBPCAP_HEADER.size, irp, status, URB_FUNCTION_BULK_OR_INTERRUPT_TRANSFER,
+                                         info, rhport, daddr, ep_addr, USBPCAP_TRANSFER_BULK, len(payload))
+
+        out += pcapng_packet(timestamp_us, header + payload)
+
+    return out
+
+
+def main(capture_file, pcapng_file, tick_hz):
+    with open(capture_file, 'rb') as f:
+        records, dropped = parse_records(f.read())
+    with open(pcapng_file, 'wb') as f:
+        f.write(convert(records, tick_hz))
+    print(f'{len(records)} records converted, {dropped} dropped on target')
+    return 0
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        prog = "capture_to_pcapng.py",
+        description="""Converts a stream captured on target with CFG_TUSB_CAPTURE (read with
+                    tu_capture_read() and saved by e.g RTT/UART logger) to a USBPcap pcapng file
+                    which can be opened with wireshark.""")
+    parser.add_argument('capture_file')
+    parser.add_argument('pcapng_file')
+    parser.add_argument('--tick-hz', type=int, default=1000000,
+                        help='frequency of CFG_TUSB_CAPTURE_TIMESTAMP() (default 1000000 i.e microseconds)')
+    args = parser.parse_args()
+    sys.exit(main(args.capture_file, args.pcapng_file, args.tick_hz))
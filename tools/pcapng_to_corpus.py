@@ -3,17 +3,122 @@ import argparse
 import pcapng
 import zipfile
 import hashlib
+import os
+import struct
+from collections import Counter
 
-def extract_packets(pcap_file):
-    """Reads a wireshark packet capture and extracts the binary packets"""
+# USBPcap header, see https://desowin.org/usbpcap/captureformat.html
+USBPCAP_HEADER = struct.Struct('<HQIHBHHBBI')
+USBPCAP_TRANSFER_ISOCHRONOUS, USBPCAP_TRANSFER_INTERRUPT, USBPCAP_TRANSFER_CONTROL, USBPCAP_TRANSFER_BULK = 0, 1, 2, 3
+USBPCAP_STAGE_SETUP, USBPCAP_STAGE_DATA = 0, 1
+
+# Session records replayed by test/bench replay, see test/bench/src/replay.c
+SESSION_BUS_RESET, SESSION_SETUP, SESSION_OUT, SESSION_IN, SESSION_PHASE = 0, 1, 2, 3, 4
+
+
+def extract_packets(pcap_file, with_timestamp=False):
+    """Reads a wireshark packet capture and extracts the binary packets, optionally as (timestamp, packet)"""
     packets = []
     with open(pcap_file, 'rb') as fp:
         scanner = pcapng.FileScanner(fp)
         for block in scanner:
             if isinstance(block, pcapng.blocks.EnhancedPacket):
-                packets.append(block.packet_data)
+                packets.append((block.timestamp, block.packet_data) if with_timestamp else block.packet_data)
     return packets
 
+
+def build_session(packets, device=None, bus=None, map_ep=None, map_itf=None, phases=None):
+    """Converts USBPcap packets of one device to a session replayed by the benchmark against the device stack.
+
+    OUT transfers are taken on submission (with their data), IN transfers on completion (with the length host
+    received). Endpoints and interfaces can be remapped to match the benchmark device, isochronous transfers
+    are skipped. Returns session bytes and number of skipped transfers.
+    """
+    map_ep = map_ep or {}
+    map_itf = map_itf or {}
+    phases = sorted(phases or [])
+
+    urbs = []
+    for ts, pkt in packets:
+        if len(pkt) < USBPCAP_HEADER.size:
+            continue
+        hdr_len, _, _, _, info, pbus, pdev, ep, xfer_type, data_len = USBPCAP_HEADER.unpack_from(pkt)
+        stage = pkt[USBPCAP_HEADER.size] if xfer_type == USBPCAP_TRANSFER_CONTROL and hdr_len > USBPCAP_HEADER.size \
+            else None
+        urbs.append((ts, info & 1, pbus, pdev, ep, xfer_type, data_len, stage, pkt[hdr_len:]))
+
+    # default to the device with most traffic, address 0 is also kept for its enumeration
+    if device is None:
+        count = Counter(u[3] for u in urbs if u[3] != 0)
+        device = count.most_common(1)[0][0] if count else 0
+    urbs = [u for u in urbs if u[3] in (0, device) and (bus is None or u[2] == bus)]
+
+    out = bytearray(b'TUSR' + struct.pack('<HH', 1, 0))
+    start = urbs[0][0] if urbs else 0
+    skipped = 0
+    setup = None  # last setup record, OUT data stage is appended to it
+
+    def record(ts, rtype, ep_addr, length, data=b''):
+        time_us = int((ts - start) * 1000000) & 0xFFFFFFFF
+        out.extend(struct.pack('<IBBHI', time_us, rtype, ep_addr, 0, length) + data)
+
+    def phase(ts, name):
+        name = name.encode()[:31]
+        record(ts, SESSION_PHASE, 0, len(name), name)
+
+    phase(start, 'enumeration')
+    record(start, SESSION_BUS_RESET, 0, 0)
+
+    def flush_setup():
+        nonlocal setup
+        if setup is not None:
+            ts, data = setup
+            record(ts, SESSION_SETUP, 0, len(data), bytes(data))
+            setup = None
+
+    for ts, is_completion, _, _, ep, xfer_type, data_len, stage, data in urbs:
+        while phases and ts - start >= phases[0][0]:
+            flush_setup()
+            phase(ts, phases.pop(0)[1])
+
+        if xfer_type == USBPCAP_TRANSFER_CONTROL:
+            if is_completion:
+                continue
+            if stage == USBPCAP_STAGE_SETUP and len(data) >= 8:
+                flush_setup()
+                bm_request_type, b_request, w_value, w_index, w_length = struct.unpack_from('<BBHHH', data)
+                recipient = bm_request_type & 0x1F
+                if recipient == 1:
+                    w_index = (w_index & 0xFF00) | map_itf.get(w_index & 0xFF, w_index & 0xFF)
+                elif recipient == 2:
+                    w_index = (w_index & 0xFF00) | map_ep.get(w_index & 0xFF, w_index & 0xFF)
+                request = struct.pack('<BBHHH', bm_request_type, b_request, w_value, w_index, w_length)
+                # SET_CONFIGURATION ends enumeration
+                if bm_request_type == 0x00 and b_request == 9:
+                    record(ts, SESSION_SETUP, 0, 8, request)
+                    phase(ts, 'configured')
+                else:
+                    setup = (ts, bytearray(request))
+            elif stage == USBPCAP_STAGE_DATA and setup is not None and not (ep & 0x80):
+                setup[1].extend(data)
+            continue
+
+        flush_setup()
+        if xfer_type == USBPCAP_TRANSFER_ISOCHRONOUS:
+            skipped += 1
+            continue
+
+        ep = map_ep.get(ep, ep)
+        if ep & 0x80:
+            if is_completion:
+                record(ts, SESSION_IN, ep, data_len)
+        elif not is_completion:
+            # data may be truncated by capture snaplen, replay pads it with zero
+            record(ts, SESSION_OUT, ep, data_len, bytes(data[:data_len]))
+
+    flush_setup()
+    return bytes(out), skipped
+
 def build_corpus_zip(zip_file_output, packets):
     """Builds a zip file with a file per packet
 
@@ -27,9 +132,43 @@ def build_corpus_zip(zip_file_output, packets):
                 out.writestr(hash, packet)
 
 
-def main(pcap_file, output_zip_file):
+def build_corpus_dir(dir_output, packets):
+    """Same content addressable layout as zip but as plain files, which can be
+    passed directly to a libFuzzer harness e.g `make run-corpus PERF=1 CORPUS=<dir>`
+    """
+    os.makedirs(dir_output, exist_ok=True)
+    for packet in packets:
+        path = os.path.join(dir_output, hashlib.sha256(packet).hexdigest())
+        if not os.path.exists(path):
+            with open(path, 'wb') as f:
+                f.write(packet)
+
+
+def parse_map(values):
+    """Parses OLD=NEW pairs, numbers in any base e.g 0x81=0x83"""
+    return {int(old, 0): int(new, 0) for old, new in (v.split('=') for v in values or [])}
+
+
+def parse_phases(values):
+    """Parses SECONDS:NAME pairs"""
+    return [(float(sec), name) for sec, name in (v.split(':', 1) for v in values or [])]
+
+
+def main(pcap_file, output, as_dir, args=None):
+    if args is not None and args.session:
+        session, skipped = build_session(extract_packets(pcap_file, with_timestamp=True), args.device, args.bus,
+                                         parse_map(args.map_ep), parse_map(args.map_itf), parse_phases(args.phase))
+        with open(output, 'wb') as f:
+            f.write(session)
+        if skipped:
+            print(f'{skipped} isochronous transfers skipped')
+        return
+
     packets = extract_packets(pcap_file)
-    build_corpus_zip(output_zip_file, packets)
+    if as_dir:
+        build_corpus_dir(output, packets)
+    else:
+        build_corpus_zip(output, packets)
 
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(
@@ -37,8 +176,20 @@ if __name__ == "__main__":
         description="""Converts a wireshark capture to a zip of binary packet
                     files suitable for an oss-fuzz corpus. In the case the
                     zip corpus already exists, this script will modify
-                    the zip file in place adding seed entries.""")
+                    the zip file in place adding seed entries. With --session
+                    the transfers of one device are converted instead to a session
+                    for the replay benchmark in test/bench.""")
     parser.add_argument('pcapng_capture_file')
     parser.add_argument('oss_fuzz_corpus_zip')
+    parser.add_argument('--dir', action='store_true',
+                        help='write seeds into oss_fuzz_corpus_zip as a directory instead of a zip')
+    parser.add_argument('--session', action='store_true',
+                        help='write a replay session (test/bench replay) into oss_fuzz_corpus_zip instead')
+    parser.add_argument('--device', type=int, help='device address of session (default: most traffic)')
+    parser.add_argument('--bus', type=int, help='bus (root hub) of session')
+    parser.add_argument('--map-ep', action='append', metavar='OLD=NEW', help='remap endpoint address')
+    parser.add_argument('--map-itf', action='append', metavar='OLD=NEW', help='remap interface number')
+    parser.add_argument('--phase', action='append', metavar='SECONDS:NAME',
+                        help='start a named phase at given time from start of capture')
     args = parser.parse_args()
-    main(args.pcapng_capture_file, args.oss_fuzz_corpus_zip)
+    main(args.pcapng_capture_file, args.oss_fuzz_corpus_zip, args.dir, args)
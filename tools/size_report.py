@@ -0,0 +1,336 @@
+#!/usr/bin/env python3
+"""Code-size and static RAM report from a GNU ld linker map.
+
+Sizes are broken down per component (usbd/usbh core, each class driver, each portable port, application,
+libraries), per object file and per symbol. Build with -ffunction-sections -fdata-sections (default for
+examples) and preferably NO_LTO=1 so that each function/variable has its own input section.
+
+Flash is .text/.rodata plus initialized data load image, RAM is .data/.bss/.noinit and other sections which
+are placed in a RAM memory region.
+
+    size_report.py _build/feather_nrf52840_express/cdc_msc.elf.map
+    size_report.py cdc_msc.elf.map --json size.json
+    size_report.py cdc_msc.elf.map --baseline size.json --max-growth 64
+"""
+import argparse
+import json
+import os
+import re
+import sys
+
+# output sections that do not occupy target memory
+NON_ALLOC_SECTIONS = ('.debug', '.comment', '.ARM.attributes', '.note.GNU-stack', '.stab', '.gnu.attributes',
+                      '.riscv.attributes', '.gnu_debuglink', '.xtensa.info', '/DISCARD/')
+
+RAM_INPUT_PREFIXES = ('.bss', '.sbss', '.tbss', 'COMMON', '.noinit', '.scommon')
+DATA_INPUT_PREFIXES = ('.data', '.sdata', '.tdata')
+SYMBOL_PREFIXES = ('.text.', '.rodata.', '.bss.', '.sbss.', '.data.', '.sdata.', '.noinit.', '.tbss.', '.tdata.',
+                   '.srodata.', '.ramfunc.', '.time_critical.')
+
+RAM_REGION_RE = re.compile(r'RAM|DTCM|SRAM|CCM|OCRAM|DATA', re.IGNORECASE)
+
+# tinyusb component from object path: make   _build/<board>/obj/src/class/msc/msc_device.o
+#                                      cmake  CMakeFiles/<target>-tinyusb.dir/__/__/src/class/msc/msc_device.c.obj
+TUSB_COMPONENT_RE = [
+    (re.compile(r'(?:^|/)(class/[^/]+)/[^/]+$'), r'\1'),
+    (re.compile(r'(?:^|/)(portable/[^/]+/[^/]+)/(?:.*/)?[^/]+$'), r'\1'),
+    (re.compile(r'(?:^|/)(device|host|typec)/[^/]+$'), r'\1'),
+    (re.compile(r'(?:^|/)(common|osal)/[^/]+$'), r'common'),
+    (re.compile(r'(?:^|/)tusb\.(?:c\.)?o(?:bj)?$'), r'common'),
+]
+
+ARCHIVE_RE = re.compile(r'^(.*?)([^/\\]+\.a)\((.+)\)$')
+
+RE_OUTPUT = re.compile(r'^(\S+)(\s+\(\w+\))?(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(.*))?$')
+RE_INPUT = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+))?$')
+RE_CONT = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$')
+RE_SYMBOL = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_.$][\w.$]*)\s*$')
+RE_REGION = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+
+
+def obj_name(path):
+    """Normalize object path: archive members become lib.a(member.o), build prefix is stripped"""
+    path = path.strip().replace('\\', '/')
+    m = ARCHIVE_RE.match(path)
+    if m:
+        return '{}({})'.format(m.group(2), m.group(3))
+    for marker in ('/obj/', '.dir/'):
+        i = path.rfind(marker)
+        if i >= 0:
+            path = path[i + len(marker):]
+            break
+    while path.startswith('__/'):
+        path = path[3:]
+    return path
+
+
+def component_of(obj):
+    m = ARCHIVE_RE.match(obj)
+    if m:
+        return 'lib/' + m.group(2)
+    # only look at the part after tinyusb's src/ if present, to skip app sources in examples/device/xxx/src
+    tail = obj.split('src/', 1)[1] if obj.startswith('src/') or '/src/' in obj else obj
+    for regex, repl in TUSB_COMPONENT_RE:
+        m = regex.search(tail)
+        if m:
+            return 'tinyusb/' + m.expand(repl)
+    if os.path.isabs(obj):
+        return 'lib/toolchain'
+    return 'app'
+
+
+class Section:
+    def __init__(self, name, addr, size, obj, out_sec):
+        self.name = name
+        self.addr = addr
+        self.size = size
+        self.obj = obj
+        self.out_sec = out_sec
+        self.symbols = []
+
+
+def parse_map(path):
+    """Return (memory regions, input sections) from a GNU ld map file"""
+    with open(path, 'r', errors='replace') as f:
+        lines = f.read().splitlines()
+
+    if not any(ln.startswith('Linker script and memory map') for ln in lines):
+        sys.exit('{}: not a GNU ld map file'.format(path))
+
+    regions = []
+    sections = []
+
+    state = None
+    cur_out = None
+    pending_out = None
+    pending_in = None
+    for ln in lines:
+        if ln.startswith('Memory Configuration'):
+            state = 'mem'
+            continue
+        if ln.startswith('Linker script and memory map'):
+            state = 'map'
+            continue
+        if state == 'mem':
+            m = RE_REGION.match(ln)
+            if m and m.group(1) != '*default*':
+                origin, length = int(m.group(2), 16), int(m.group(3), 16)
+                regions.append((m.group(1), origin, origin + length))
+            continue
+        if state != 'map' or not ln.strip():
+            continue
+
+        # output section, possibly with address/size on next line
+        if pending_out is not None:
+            m = RE_CONT.match(ln) or re.match(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(.*)$', ln)
+            if m:
+                cur_out = {'name': pending_out, 'addr': int(m.group(1), 16), 'load': 'load address' in ln,
+                           'noload': False}
+            pending_out = None
+            continue
+        if pending_in is not None:
+            m = RE_CONT.match(ln)
+            if m and cur_out is not None:
+                sections.append(Section(pending_in, int(m.group(1), 16), int(m.group(2), 16),
+                                        obj_name(m.group(3)), cur_out))
+            pending_in = None
+            if m:
+                continue
+
+        if not ln[0].isspace():
+            m = RE_OUTPUT.match(ln)
+            if m and (m.group(1).startswith('.') or m.group(1).startswith('/')):
+                name = m.group(1)
+                if m.group(3) is None:
+                    pending_out = name
+                else:
+                    cur_out = {'name': name, 'addr': int(m.group(3), 16), 'load': 'load address' in (m.group(5) or ''),
+                               'noload': 'NOLOAD' in (m.group(2) or '')}
+            continue
+
+        if cur_out is None or cur_out['name'].startswith(NON_ALLOC_SECTIONS):
+            continue
+
+        m = RE_INPUT.match(ln)
+        if m and not m.group(1).startswith('0x'):
+            name = m.group(1)
+            if name.startswith('*'):
+                continue  # input section pattern or *fill*
+            if m.group(2) is None:
+                pending_in = name
+            else:
+                sections.append(Section(name, int(m.group(2), 16), int(m.group(3), 16), obj_name(m.group(4)), cur_out))
+            continue
+
+        m = RE_SYMBOL.match(ln)
+        if m and sections and sections[-1].out_sec is cur_out:
+            sec = sections[-1]
+            addr = int(m.group(1), 16)
+            if sec.addr <= addr < sec.addr + sec.size:
+                sec.symbols.append((addr, m.group(2)))
+
+    return regions, sections
+
+
+def memory_type(sec, regions):
+    """Return (flash, ram) bytes used by an input section"""
+    name = sec.name
+    if name.startswith(RAM_INPUT_PREFIXES) or sec.out_sec['noload']:
+        return 0, sec.size
+    if name.startswith(DATA_INPUT_PREFIXES) or sec.out_sec['load']:
+        return sec.size, sec.size
+    for rname, start, end in regions:
+        if start <= sec.out_sec['addr'] < end:
+            if RAM_REGION_RE.search(rname):
+                return 0, sec.size
+            break
+    return sec.size, 0
+
+
+def symbols_of(sec):
+    """Split input section into symbols: name from -ffunction/data-sections or from symbol addresses"""
+    for prefix in SYMBOL_PREFIXES:
+        if sec.name.startswith(prefix) and len(sec.name) > len(prefix):
+            return [(sec.name[len(prefix):], sec.size)]
+
+    if not sec.symbols:
+        return [(sec.name, sec.size)]
+
+    result = []
+    syms = sorted(sec.symbols)
+    if syms[0][0] > sec.addr:
+        result.append((sec.name, syms[0][0] - sec.addr))
+    for i, (addr, name) in enumerate(syms):
+        end = syms[i + 1][0] if i + 1 < len(syms) else sec.addr + sec.size
+        result.append((name, end - addr))
+    return result
+
+
+def build_report(path):
+    regions, sections = parse_map(path)
+
+    components = {}
+    objects = {}
+    symbols = {}
+    for sec in sections:
+        if sec.size == 0:
+            continue
+        flash, ram = memory_type(sec, regions)
+        comp = component_of(sec.obj)
+
+        for table, key in ((components, comp), (objects, sec.obj)):
+            entry = table.setdefault(key, {'flash': 0, 'ram': 0})
+            entry['flash'] += flash
+            entry['ram'] += ram
+
+        for sym, size in symbols_of(sec):
+            if size == 0:
+                continue
+            key = '{} ({})'.format(sym, os.path.basename(sec.obj))
+            entry = symbols.setdefault(key, {'flash': 0, 'ram': 0, 'component': comp})
+            entry['flash'] += size if flash else 0
+            entry['ram'] += size if ram else 0
+
+    total = {'flash': sum(c['flash'] for c in components.values()),
+             'ram': sum(c['ram'] for c in components.values())}
+    return {'map': os.path.basename(path), 'total': total, 'components': components, 'objects': objects,
+            'symbols': symbols}
+
+
+def print_table(title, rows, baseline, limit):
+    """rows: dict name -> {flash, ram}, baseline: same-shaped dict or None"""
+    keys = set(rows)
+    if baseline is not None:
+        keys |= set(baseline)
+
+    def delta(k, field):
+        return rows.get(k, {}).get(field, 0) - (baseline or {}).get(k, {}).get(field, 0)
+
+    if baseline is not None:
+        keys = [k for k in keys if delta(k, 'flash') or delta(k, 'ram')]
+        keys.sort(key=lambda k: (-abs(delta(k, 'flash')) - abs(delta(k, 'ram')), k))
+    else:
+        keys = sorted(keys, key=lambda k: (-rows[k]['flash'] - rows[k]['ram'], k))
+    if limit:
+        keys = keys[:limit]
+    if not keys:
+        return
+
+    width = max(len(title), max(len(k) for k in keys))
+    if baseline is not None:
+        print('{:{w}} {:>9} {:>8} {:>9} {:>8}'.format(title, 'Flash', '+/-', 'RAM', '+/-', w=width))
+    else:
+        print('{:{w}} {:>9} {:>9}'.format(title, 'Flash', 'RAM', w=width))
+    print('-' * (width + (38 if baseline is not None else 20)))
+    for k in keys:
+        r = rows.get(k, {'flash': 0, 'ram': 0})
+        if baseline is not None:
+            print('{:{w}} {:>9} {:>+8} {:>9} {:>+8}'.format(k, r['flash'], delta(k, 'flash'), r['ram'],
+                                                           delta(k, 'ram'), w=width))
+        else:
+            print('{:{w}} {:>9} {:>9}'.format(k, r['flash'], r['ram'], w=width))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Code-size and static RAM report from a GNU ld linker map')
+    parser.add_argument('map', help='linker map file e.g _build/<board>/<example>.elf.map')
+    parser.add_argument('--json', metavar='FILE', help='write report as json, can be used as baseline later')
+    parser.add_argument('--baseline', metavar='FILE', help='json report to compare against')
+    parser.add_argument('--objects', action='store_true', help='also list per-object breakdown')
+    parser.add_argument('--symbols', type=int, default=20, metavar='N', help='number of largest symbols to list, 0 for none')
+    parser.add_argument('--filter', metavar='REGEX', help='only list components/objects/symbols matching regex')
+    parser.add_argument('--max-growth', type=int, metavar='BYTES',
+                        help='exit with error if total flash or RAM grows more than BYTES over baseline')
+    args = parser.parse_args()
+
+    report = build_report(args.map)
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    def select(table, base_table):
+        if args.filter:
+            regex = re.compile(args.filter)
+            match = lambda k, v: regex.search(k) or regex.search(v.get('component', ''))
+            table = {k: v for k, v in table.items() if match(k, v)}
+            if base_table is not None:
+                base_table = {k: v for k, v in base_table.items() if match(k, v)}
+        return table, base_table
+
+    print('Size report: {}'.format(args.map))
+    if baseline is not None:
+        print('Baseline   : {}'.format(args.baseline))
+    print()
+
+    sections = [('Component', 'components', 0)]
+    if args.objects:
+        sections.append(('Object', 'objects', 0))
+    if args.symbols:
+        sections.append(('Symbol', 'symbols', args.symbols))
+    for title, key, limit in sections:
+        rows, base_rows = select(report[key], baseline[key] if baseline is not None else None)
+        print_table(title, rows, base_rows, limit)
+
+    total = report['total']
+    if baseline is None:
+        print('Total: flash {} bytes, RAM {} bytes'.format(total['flash'], total['ram']))
+        return 0
+
+    base_total = baseline['total']
+    df = total['flash'] - base_total['flash']
+    dr = total['ram'] - base_total['ram']
+    print('Total: flash {} bytes ({:+}), RAM {} bytes ({:+})'.format(total['flash'], df, total['ram'], dr))
+    if args.max_growth is not None and (df > args.max_growth or dr > args.max_growth):
+        print('Size grows more than {} bytes over baseline'.format(args.max_growth))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())